@@ -1,100 +1,210 @@
 #include <cassert>
 #include <utility>
 
+#include "CPUFeatures.h"
+
 #include "ByteSwap.h"
 
-uint8_t SwapByte( uint8_t value )
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <immintrin.h>
+
+#define BYTESWAP_SSSE3
+#define BYTESWAP_TARGET_SSSE3
+#define BYTESWAP_TARGET_AVX2
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <immintrin.h>
+
+#define BYTESWAP_SSSE3
+//Only the vector functions are compiled for SSSE3 and AVX2, so the rest runs on any CPU.
+#define BYTESWAP_TARGET_SSSE3 __attribute__( ( target( "ssse3" ) ) )
+#define BYTESWAP_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#endif
+
+namespace
+{
+/**
+*	Swaps values one at a time. Values are copied in and out so they don't have to be aligned.
+*/
+template<typename T, T ( *SWAP )( T )>
+void SwapArrayScalar( uint8_t* pData, const size_t uiCount )
 {
-	return value;
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex, pData += sizeof( T ) )
+	{
+		T value;
+
+		memcpy( &value, pData, sizeof( T ) );
+
+		value = SWAP( value );
+
+		memcpy( pData, &value, sizeof( T ) );
+	}
 }
 
-int16_t SwapShort( int16_t value )
-{
-	int16_t result = 
-		( ( value << 8 ) & 0xFF00 ) | 
-		( ( value >> 8 ) & 0xFF );
+#ifdef BYTESWAP_SSSE3
+/**
+*	Reverses the bytes of values in a block of data. Returns the number of bytes swapped, a multiple of the block size.
+*/
+typedef size_t ( *SwapBlocksFunction_t )( uint8_t* pData, const size_t uiSize );
 
-	return result;
+size_t SwapBlocksNone( uint8_t*, const size_t )
+{
+	return 0;
 }
 
-int32_t SwapLong( int32_t value )
+/**
+*	Builds the shuffle that reverses the bytes of each value in a 16 byte lane.
+*/
+template<size_t VALUE_SIZE>
+void MakeSwapShuffle( uint8_t ( &shuffle )[ 16 ] )
 {
-	const int8_t b1 = value & 0xFF;
-	const int8_t b2 = ( value >> 8 ) & 0xFF;
-	const int8_t b3 = ( value >> 16 ) & 0xFF;
-	const int8_t b4 = ( value >> 24 ) & 0xFF;
-
-	return 
-		( b1 << 24 ) | 
-		( b2 << 16 ) | 
-		( b3 << 8 ) | 
-		b4;
+	for( size_t uiIndex = 0; uiIndex < sizeof( shuffle ); ++uiIndex )
+	{
+		//Index of the byte at the opposite end of the same value.
+		shuffle[ uiIndex ] = static_cast<uint8_t>( ( uiIndex - uiIndex % VALUE_SIZE ) + ( VALUE_SIZE - 1 - uiIndex % VALUE_SIZE ) );
+	}
 }
 
-int64_t SwapLongLong( int64_t value )
+/**
+*	Reverses the bytes of each value in 16 byte blocks with a shuffle. Returns the number of bytes swapped.
+*/
+template<size_t VALUE_SIZE>
+BYTESWAP_TARGET_SSSE3 size_t SwapBlocksSSSE3( uint8_t* pData, const size_t uiSize )
 {
-	const int8_t b1 = value & 0xFF;
-	const int8_t b2 = ( value >> 8 ) & 0xFF;
-	const int8_t b3 = ( value >> 16 ) & 0xFF;
-	const int8_t b4 = ( value >> 24 ) & 0xFF;
-	const int8_t b5 = ( value >> 32 ) & 0xFF;
-	const int8_t b6 = ( value >> 40 ) & 0xFF;
-	const int8_t b7 = ( value >> 48 ) & 0xFF;
-	const int8_t b8 = ( value >> 56 ) & 0xFF;
-
-	return 
-		( static_cast<int64_t>( b1 ) << 56 ) | 
-		( static_cast<int64_t>( b2 ) << 48 ) | 
-		( static_cast<int64_t>( b3 ) << 40 ) | 
-		( static_cast<int64_t>( b4 ) << 32 ) | 
-		( b5 << 24 ) | 
-		( b6 << 16 ) | 
-		( b7 << 8 ) | 
-		b8;
+	alignas( 16 ) uint8_t shuffle[ 16 ];
+
+	MakeSwapShuffle<VALUE_SIZE>( shuffle );
+
+	const __m128i mask = _mm_load_si128( reinterpret_cast<const __m128i*>( shuffle ) );
+
+	size_t uiOffset = 0;
+
+	//Two blocks at a time so the loads and shuffles overlap.
+	for( ; uiSize - uiOffset >= 32; uiOffset += 32 )
+	{
+		const __m128i first = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pData + uiOffset ) );
+		const __m128i second = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pData + uiOffset + 16 ) );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pData + uiOffset ), _mm_shuffle_epi8( first, mask ) );
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pData + uiOffset + 16 ), _mm_shuffle_epi8( second, mask ) );
+	}
+
+	if( uiSize - uiOffset >= 16 )
+	{
+		const __m128i block = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pData + uiOffset ) );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pData + uiOffset ), _mm_shuffle_epi8( block, mask ) );
+
+		uiOffset += 16;
+	}
+
+	return uiOffset;
 }
 
-float SwapFloat( float value )
+/**
+*	Same as SwapBlocksSSSE3, 32 bytes at a time. Shuffles stay within 16 byte lanes, so both lanes use the same shuffle.
+*/
+template<size_t VALUE_SIZE>
+BYTESWAP_TARGET_AVX2 size_t SwapBlocksAVX2( uint8_t* pData, const size_t uiSize )
 {
-	static_assert( sizeof( float ) == 4, "Byte swapping does not support floats != 4 bytes large!" );
+	alignas( 16 ) uint8_t shuffle[ 16 ];
+
+	MakeSwapShuffle<VALUE_SIZE>( shuffle );
+
+	const __m256i mask = _mm256_broadcastsi128_si256( _mm_load_si128( reinterpret_cast<const __m128i*>( shuffle ) ) );
+
+	size_t uiOffset = 0;
+
+	for( ; uiSize - uiOffset >= 64; uiOffset += 64 )
+	{
+		const __m256i first = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pData + uiOffset ) );
+		const __m256i second = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pData + uiOffset + 32 ) );
+
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( pData + uiOffset ), _mm256_shuffle_epi8( first, mask ) );
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( pData + uiOffset + 32 ), _mm256_shuffle_epi8( second, mask ) );
+	}
 
-	union
+	if( uiSize - uiOffset >= 32 )
 	{
-		float value;
-		uint8_t bytes[ sizeof( float ) ];
-	} input, result;
+		const __m256i block = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pData + uiOffset ) );
+
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( pData + uiOffset ), _mm256_shuffle_epi8( block, mask ) );
+
+		uiOffset += 32;
+	}
+
+	//Clear the upper halves so the SSE code that follows doesn't pay for the transition.
+	_mm256_zeroupper();
 
-	input.value = value;
+	//The last 16 bytes, if any.
+	return uiOffset + SwapBlocksSSSE3<VALUE_SIZE>( pData + uiOffset, uiSize - uiOffset );
+}
+#endif
+
+/**
+*	Best block swap for the CPU, picked on first use.
+*/
+template<size_t VALUE_SIZE>
+SwapBlocksFunction_t GetSwapBlocks()
+{
+	static const CPUKernel_t<SwapBlocksFunction_t> KERNELS[] =
+	{
+#ifdef BYTESWAP_SSSE3
+		{ CPUFeature::AVX2 | CPUFeature::SSSE3, &SwapBlocksAVX2<VALUE_SIZE> },
+		{ CPUFeature::SSSE3, &SwapBlocksSSSE3<VALUE_SIZE> },
+#endif
+		{ CPUFeature::NONE, &SwapBlocksNone }
+	};
 
-	result.bytes[ 0 ] = input.bytes[ 3 ];
-	result.bytes[ 1 ] = input.bytes[ 2 ];
-	result.bytes[ 2 ] = input.bytes[ 1 ];
-	result.bytes[ 3 ] = input.bytes[ 0 ];
+	static const SwapBlocksFunction_t pSwapBlocks = Plat_SelectKernel( KERNELS );
 
-	return result.value;
+	return pSwapBlocks;
 }
 
-double SwapDouble( double value )
+template<typename T, T ( *SWAP )( T )>
+void SwapArray( void* pData, const size_t uiCount )
 {
-	static_assert( sizeof( double ) == 8, "Byte swapping does not support double != 8 bytes large!" );
+	assert( pData || uiCount == 0 );
+
+	auto pBytes = reinterpret_cast<uint8_t*>( pData );
+
+	size_t uiRemaining = uiCount;
 
-	union
+	const size_t uiSwapped = GetSwapBlocks<sizeof( T )>()( pBytes, uiCount * sizeof( T ) );
+
+	pBytes += uiSwapped;
+	uiRemaining -= uiSwapped / sizeof( T );
+
+	//The rest, or everything if there's no shuffle.
+	SwapArrayScalar<T, SWAP>( pBytes, uiRemaining );
+}
+
+/**
+*	Swaps a single field. Fields can be at any offset, so they're copied in and out.
+*/
+void SwapField( uint8_t* pField, const size_t uiSize )
+{
+	switch( uiSize )
 	{
-		double value;
-		uint8_t bytes[ sizeof( double ) ];
-	} input, result;
-
-	input.value = value;
-
-	result.bytes[ 0 ] = input.bytes[ 7 ];
-	result.bytes[ 1 ] = input.bytes[ 6 ];
-	result.bytes[ 2 ] = input.bytes[ 5 ];
-	result.bytes[ 3 ] = input.bytes[ 4 ];
-	result.bytes[ 4 ] = input.bytes[ 3 ];
-	result.bytes[ 5 ] = input.bytes[ 2 ];
-	result.bytes[ 6 ] = input.bytes[ 1 ];
-	result.bytes[ 7 ] = input.bytes[ 0 ];
-
-	return result.value;
+	case 1:
+		break;
+
+	case 2:
+		SwapArrayScalar<uint16_t, &SwapUnsignedShort>( pField, 1 );
+		break;
+
+	case 4:
+		SwapArrayScalar<uint32_t, &SwapUnsignedLong>( pField, 1 );
+		break;
+
+	case 8:
+		SwapArrayScalar<uint64_t, &SwapUnsignedLongLong>( pField, 1 );
+		break;
+
+	default:
+		SwapBytes( pField, uiSize );
+		break;
+	}
+}
 }
 
 uint8_t* SwapBytes( uint8_t* pBytes, const size_t uiSize )
@@ -107,4 +217,71 @@ uint8_t* SwapBytes( uint8_t* pBytes, const size_t uiSize )
 	}
 
 	return pBytes;
-}
\ No newline at end of file
+}
+
+void SwapArray16( void* pData, const size_t uiCount )
+{
+	SwapArray<uint16_t, &SwapUnsignedShort>( pData, uiCount );
+}
+
+void SwapArray32( void* pData, const size_t uiCount )
+{
+	SwapArray<uint32_t, &SwapUnsignedLong>( pData, uiCount );
+}
+
+void SwapArray64( void* pData, const size_t uiCount )
+{
+	SwapArray<uint64_t, &SwapUnsignedLongLong>( pData, uiCount );
+}
+
+bool IsSwapArrayVectorized()
+{
+	return GetSwapBlocks<4>() != &SwapBlocksNone;
+}
+
+void SwapStructs( void* pData, const size_t uiStructSize, const size_t uiCount, const SwapField_t* pFields, const size_t uiFieldCount )
+{
+	assert( pData || uiCount == 0 );
+	assert( pFields || uiFieldCount == 0 );
+
+	auto pStruct = reinterpret_cast<uint8_t*>( pData );
+
+	for( size_t uiStruct = 0; uiStruct < uiCount; ++uiStruct, pStruct += uiStructSize )
+	{
+		for( size_t uiField = 0; uiField < uiFieldCount; ++uiField )
+		{
+			const SwapField_t& field = pFields[ uiField ];
+
+			assert( field.uiOffset + field.uiSize * field.uiCount <= uiStructSize );
+
+			uint8_t* pField = pStruct + field.uiOffset;
+
+			//Long runs, like vectors and bounding boxes, are swapped a block at a time.
+			if( field.uiSize * field.uiCount >= 16 )
+			{
+				switch( field.uiSize )
+				{
+				case 2:
+					SwapArray16( pField, field.uiCount );
+					continue;
+
+				case 4:
+					SwapArray32( pField, field.uiCount );
+					continue;
+
+				case 8:
+					SwapArray64( pField, field.uiCount );
+					continue;
+
+				default:
+					break;
+				}
+			}
+
+			for( size_t uiIndex = 0; uiIndex < field.uiCount; ++uiIndex, pField += field.uiSize )
+			{
+				SwapField( pField, field.uiSize );
+			}
+		}
+	}
+}
@@ -2,51 +2,286 @@
 #define UTILITY_BYTESWAP_H
 
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include <cstring>
 #include <type_traits>
 
+#ifdef _MSC_VER
+#include <stdlib.h>
+#endif
+
 /**
 *	@defgroup ByteSwap Byte swapping functions
 *
 *	@{
 */
 
+//The build defines IS_LITTLE_ENDIAN. If the compiler knows the byte order as well, make sure they agree.
+#if defined( __BYTE_ORDER__ ) && defined( __ORDER_LITTLE_ENDIAN__ )
+#ifndef IS_LITTLE_ENDIAN
+#define IS_LITTLE_ENDIAN ( __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ )
+#endif
+
+static_assert( ( IS_LITTLE_ENDIAN != 0 ) == ( __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__ ), "IS_LITTLE_ENDIAN doesn't match the target's byte order!" );
+#elif defined( _MSC_VER ) && !defined( IS_LITTLE_ENDIAN )
+//All targets supported by Visual Studio are little endian.
+#define IS_LITTLE_ENDIAN 1
+#endif
+
 /**
 *	Swaps a single byte. Effectively does nothing.
 */
-uint8_t SwapByte( uint8_t value );
+inline uint8_t SwapByte( uint8_t value )
+{
+	return value;
+}
+
+/**
+*	Swaps an unsigned short.
+*/
+inline uint16_t SwapUnsignedShort( uint16_t value )
+{
+#ifdef _MSC_VER
+	return _byteswap_ushort( value );
+#elif defined( __GNUC__ )
+	return __builtin_bswap16( value );
+#else
+	return static_cast<uint16_t>( ( value << 8 ) | ( value >> 8 ) );
+#endif
+}
+
+/**
+*	Swaps an unsigned long.
+*/
+inline uint32_t SwapUnsignedLong( uint32_t value )
+{
+#ifdef _MSC_VER
+	return _byteswap_ulong( value );
+#elif defined( __GNUC__ )
+	return __builtin_bswap32( value );
+#else
+	return 
+		( value << 24 ) | 
+		( ( value << 8 ) & 0x00FF0000 ) | 
+		( ( value >> 8 ) & 0x0000FF00 ) | 
+		( value >> 24 );
+#endif
+}
+
+/**
+*	Swaps an unsigned long long.
+*/
+inline uint64_t SwapUnsignedLongLong( uint64_t value )
+{
+#ifdef _MSC_VER
+	return _byteswap_uint64( value );
+#elif defined( __GNUC__ )
+	return __builtin_bswap64( value );
+#else
+	return 
+		( static_cast<uint64_t>( SwapUnsignedLong( static_cast<uint32_t>( value ) ) ) << 32 ) | 
+		SwapUnsignedLong( static_cast<uint32_t>( value >> 32 ) );
+#endif
+}
 
 /**
 *	Swaps a short.
 */
-int16_t SwapShort( int16_t value );
+inline int16_t SwapShort( int16_t value )
+{
+	return static_cast<int16_t>( SwapUnsignedShort( static_cast<uint16_t>( value ) ) );
+}
 
 /**
 *	Swaps a long.
 */
-int32_t SwapLong( int32_t value );
+inline int32_t SwapLong( int32_t value )
+{
+	return static_cast<int32_t>( SwapUnsignedLong( static_cast<uint32_t>( value ) ) );
+}
 
 /**
 *	Swaps a long long.
 */
-int64_t SwapLongLong( int64_t value );
+inline int64_t SwapLongLong( int64_t value )
+{
+	return static_cast<int64_t>( SwapUnsignedLongLong( static_cast<uint64_t>( value ) ) );
+}
 
 /**
 *	Swaps a float.
 */
-float SwapFloat( float value );
+inline float SwapFloat( float value )
+{
+	static_assert( sizeof( float ) == 4, "Byte swapping does not support floats != 4 bytes large!" );
+
+	uint32_t uiBits;
+
+	memcpy( &uiBits, &value, sizeof( uiBits ) );
+
+	uiBits = SwapUnsignedLong( uiBits );
+
+	memcpy( &value, &uiBits, sizeof( value ) );
+
+	return value;
+}
 
 /**
 *	Swaps a double.
 */
-double SwapDouble( double value );
+inline double SwapDouble( double value )
+{
+	static_assert( sizeof( double ) == 8, "Byte swapping does not support double != 8 bytes large!" );
+
+	uint64_t uiBits;
+
+	memcpy( &uiBits, &value, sizeof( uiBits ) );
+
+	uiBits = SwapUnsignedLongLong( uiBits );
+
+	memcpy( &value, &uiBits, sizeof( value ) );
+
+	return value;
+}
 
 /**
 *	Swaps an arbitrary size value.
 */
 uint8_t* SwapBytes( uint8_t* pBytes, const size_t uiSize );
 
+/**
+*	Swaps an array of 2 byte values in place.
+*	@param pData Values to swap. Doesn't have to be aligned.
+*	@param uiCount Number of values.
+*/
+void SwapArray16( void* pData, const size_t uiCount );
+
+/**
+*	Swaps an array of 4 byte values in place.
+*	@copydetails SwapArray16
+*/
+void SwapArray32( void* pData, const size_t uiCount );
+
+/**
+*	Swaps an array of 8 byte values in place.
+*	@copydetails SwapArray16
+*/
+void SwapArray64( void* pData, const size_t uiCount );
+
+/**
+*	@return Whether the SwapArray functions use AVX2 or SSSE3 to swap 32 or 16 bytes at a time.
+*	If not, they swap one value at a time. Both produce the same results.
+*/
+bool IsSwapArrayVectorized();
+
+namespace byteswap
+{
+template<size_t SIZE>
+struct ArraySwapper;
+
+template<>
+struct ArraySwapper<1>
+{
+	static void Swap( void*, const size_t )
+	{
+	}
+};
+
+template<>
+struct ArraySwapper<2>
+{
+	static void Swap( void* pData, const size_t uiCount )
+	{
+		SwapArray16( pData, uiCount );
+	}
+};
+
+template<>
+struct ArraySwapper<4>
+{
+	static void Swap( void* pData, const size_t uiCount )
+	{
+		SwapArray32( pData, uiCount );
+	}
+};
+
+template<>
+struct ArraySwapper<8>
+{
+	static void Swap( void* pData, const size_t uiCount )
+	{
+		SwapArray64( pData, uiCount );
+	}
+};
+}
+
+/**
+*	Swaps an array of values in place.
+*	@tparam T Arithmetic or enum type of 1, 2, 4 or 8 bytes.
+*/
+template<typename T>
+void SwapArray( T* pValues, const size_t uiCount )
+{
+	static_assert( std::is_arithmetic<T>::value || std::is_enum<T>::value, "SwapArray only swaps arithmetic and enum types!" );
+
+	assert( pValues || uiCount == 0 );
+
+	byteswap::ArraySwapper<sizeof( T )>::Swap( pValues, uiCount );
+}
+
+/**
+*	Describes a run of same size fields in a struct, for SwapStructs.
+*	Use SWAP_FIELD to describe a struct member.
+*/
+struct SwapField_t
+{
+	/**
+	*	Offset of the first field in the struct.
+	*/
+	size_t uiOffset;
+
+	/**
+	*	Size of each field. 1, 2, 4 or 8. 1 byte fields don't need swapping, so they can be left out.
+	*/
+	size_t uiSize;
+
+	/**
+	*	Number of consecutive fields.
+	*/
+	size_t uiCount;
+};
+
+/**
+*	Describes a member for SwapStructs. Array members are described as a run of their elements.
+*/
+#define SWAP_FIELD( structType, member )																			\
+SwapField_t{																										\
+	offsetof( structType, member ),																					\
+	sizeof( std::remove_all_extents<decltype( structType::member )>::type ),										\
+	sizeof( decltype( structType::member ) ) / sizeof( std::remove_all_extents<decltype( structType::member )>::type )	\
+}
+
+/**
+*	Swaps the fields of an array of structs in place.
+*	Runs of at least 16 bytes are swapped with SwapArray16/32/64, the rest one field at a time.
+*	@param pData Structs to swap. Doesn't have to be aligned.
+*	@param uiStructSize Size of each struct, including padding.
+*	@param uiCount Number of structs.
+*	@param pFields Fields to swap in each struct.
+*	@param uiFieldCount Number of fields.
+*/
+void SwapStructs( void* pData, const size_t uiStructSize, const size_t uiCount, const SwapField_t* pFields, const size_t uiFieldCount );
+
+/**
+*	@copydoc SwapStructs( void*, const size_t, const size_t, const SwapField_t*, const size_t )
+*/
+template<typename T, size_t FIELD_COUNT>
+void SwapStructs( T* pStructs, const size_t uiCount, const SwapField_t ( &fields )[ FIELD_COUNT ] )
+{
+	SwapStructs( pStructs, sizeof( T ), uiCount, fields, FIELD_COUNT );
+}
+
 /**
 *	Swaps a value.
 */
@@ -68,18 +303,36 @@ inline int16_t SwapValue<int16_t>( int16_t value )
 	return SwapShort( value );
 }
 
+template<>
+inline uint16_t SwapValue<uint16_t>( uint16_t value )
+{
+	return SwapUnsignedShort( value );
+}
+
 template<>
 inline int32_t SwapValue<int32_t>( int32_t value )
 {
 	return SwapLong( value );
 }
 
+template<>
+inline uint32_t SwapValue<uint32_t>( uint32_t value )
+{
+	return SwapUnsignedLong( value );
+}
+
 template<>
 inline int64_t SwapValue<int64_t>( int64_t value )
 {
 	return SwapLongLong( value );
 }
 
+template<>
+inline uint64_t SwapValue<uint64_t>( uint64_t value )
+{
+	return SwapUnsignedLongLong( value );
+}
+
 template<>
 inline float SwapValue<float>( float value )
 {
@@ -125,6 +378,42 @@ public:
 	{
 		assert( !"Undefined byte swap order!" );
 	}
+
+	/**
+	*	Byte swaps an array of values to little endian in place.
+	*/
+	template<typename T>
+	static void LittleArray( T* pValues, const size_t uiCount )
+	{
+		assert( !"Undefined byte swap order!" );
+	}
+
+	/**
+	*	Byte swaps an array of values to big endian in place.
+	*/
+	template<typename T>
+	static void BigArray( T* pValues, const size_t uiCount )
+	{
+		assert( !"Undefined byte swap order!" );
+	}
+
+	/**
+	*	Byte swaps the fields of an array of structs to little endian in place.
+	*/
+	template<typename T, size_t FIELD_COUNT>
+	static void LittleStructs( T* pStructs, const size_t uiCount, const SwapField_t ( &fields )[ FIELD_COUNT ] )
+	{
+		assert( !"Undefined byte swap order!" );
+	}
+
+	/**
+	*	Byte swaps the fields of an array of structs to big endian in place.
+	*/
+	template<typename T, size_t FIELD_COUNT>
+	static void BigStructs( T* pStructs, const size_t uiCount, const SwapField_t ( &fields )[ FIELD_COUNT ] )
+	{
+		assert( !"Undefined byte swap order!" );
+	}
 };
 
 template<>
@@ -148,6 +437,28 @@ public:
 	{
 		return SwapValue( value );
 	}
+
+	template<typename T>
+	static void LittleArray( T*, const size_t )
+	{
+	}
+
+	template<typename T>
+	static void BigArray( T* pValues, const size_t uiCount )
+	{
+		SwapArray( pValues, uiCount );
+	}
+
+	template<typename T, size_t FIELD_COUNT>
+	static void LittleStructs( T*, const size_t, const SwapField_t ( & )[ FIELD_COUNT ] )
+	{
+	}
+
+	template<typename T, size_t FIELD_COUNT>
+	static void BigStructs( T* pStructs, const size_t uiCount, const SwapField_t ( &fields )[ FIELD_COUNT ] )
+	{
+		SwapStructs( pStructs, uiCount, fields );
+	}
 };
 
 template<>
@@ -171,6 +482,28 @@ public:
 	{
 		return value;
 	}
+
+	template<typename T>
+	static void LittleArray( T* pValues, const size_t uiCount )
+	{
+		SwapArray( pValues, uiCount );
+	}
+
+	template<typename T>
+	static void BigArray( T*, const size_t )
+	{
+	}
+
+	template<typename T, size_t FIELD_COUNT>
+	static void LittleStructs( T* pStructs, const size_t uiCount, const SwapField_t ( &fields )[ FIELD_COUNT ] )
+	{
+		SwapStructs( pStructs, uiCount, fields );
+	}
+
+	template<typename T, size_t FIELD_COUNT>
+	static void BigStructs( T*, const size_t, const SwapField_t ( & )[ FIELD_COUNT ] )
+	{
+	}
 };
 
 /**
@@ -211,6 +544,44 @@ T BigEnumValue( T value )
 	return static_cast<T>( ByteSwap<>::BigValue( static_cast<typename std::underlying_type<T>::type>( value ) ) );
 }
 
+/**
+*	On a big endian system, this will byte swap an array of values in place. On a little endian system, this does nothing.
+*/
+template<typename T>
+void LittleArray( T* pValues, const size_t uiCount )
+{
+	ByteSwap<>::LittleArray( pValues, uiCount );
+}
+
+/**
+*	On a little endian system, this will byte swap an array of values in place. On a big endian system, this does nothing.
+*/
+template<typename T>
+void BigArray( T* pValues, const size_t uiCount )
+{
+	ByteSwap<>::BigArray( pValues, uiCount );
+}
+
+/**
+*	On a big endian system, this will byte swap the fields of an array of structs in place. On a little endian system, this does nothing.
+*	@see SwapStructs
+*/
+template<typename T, size_t FIELD_COUNT>
+void LittleStructs( T* pStructs, const size_t uiCount, const SwapField_t ( &fields )[ FIELD_COUNT ] )
+{
+	ByteSwap<>::LittleStructs( pStructs, uiCount, fields );
+}
+
+/**
+*	On a little endian system, this will byte swap the fields of an array of structs in place. On a big endian system, this does nothing.
+*	@see SwapStructs
+*/
+template<typename T, size_t FIELD_COUNT>
+void BigStructs( T* pStructs, const size_t uiCount, const SwapField_t ( &fields )[ FIELD_COUNT ] )
+{
+	ByteSwap<>::BigStructs( pStructs, uiCount, fields );
+}
+
 /** @} */
 
 #endif //UTILITY_BYTESWAP_H
\ No newline at end of file
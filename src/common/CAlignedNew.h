@@ -0,0 +1,51 @@
+#ifndef COMMON_CALIGNEDNEW_H
+#define COMMON_CALIGNEDNEW_H
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#ifdef WIN32
+#include <malloc.h>
+#endif
+
+/**
+*	Base class that makes new and delete honor the alignment of the class that derives from it.
+*	C++14 allocates with the default alignment, which isn't enough for classes that hold cache line aligned members like CSPSCQueue's indices.
+*	@tparam DERIVED Class that derives from this one.
+*/
+template<typename DERIVED>
+class CAlignedNew
+{
+public:
+	static void* operator new( const size_t uiSize )
+	{
+		//posix_memalign needs at least the alignment of a pointer.
+		const size_t uiAlignment = alignof( DERIVED ) < sizeof( void* ) ? sizeof( void* ) : alignof( DERIVED );
+
+		void* pMemory;
+
+#ifdef WIN32
+		pMemory = _aligned_malloc( uiSize, uiAlignment );
+#else
+		if( posix_memalign( &pMemory, uiAlignment, uiSize ) != 0 )
+			pMemory = nullptr;
+#endif
+
+		if( !pMemory )
+			throw std::bad_alloc();
+
+		return pMemory;
+	}
+
+	static void operator delete( void* pMemory )
+	{
+#ifdef WIN32
+		_aligned_free( pMemory );
+#else
+		free( pMemory );
+#endif
+	}
+};
+
+#endif //COMMON_CALIGNEDNEW_H
@@ -0,0 +1,360 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#include "ILogSink.h"
+
+#include "CAsyncLogger.h"
+
+const size_t CAsyncLogger::NUM_SLOTS;
+const size_t CAsyncLogger::SLOT_TEXT_SIZE;
+const size_t CAsyncLogger::MAX_MESSAGE_SIZE;
+const unsigned int CAsyncLogger::IDLE_WAIT_MS;
+
+static_assert( ( CAsyncLogger::NUM_SLOTS & ( CAsyncLogger::NUM_SLOTS - 1 ) ) == 0, "CAsyncLogger::NUM_SLOTS must be a power of 2" );
+static_assert( CAsyncLogger::MAX_MESSAGE_SIZE <= CAsyncLogger::NUM_SLOTS * CAsyncLogger::SLOT_TEXT_SIZE, "CAsyncLogger::MAX_MESSAGE_SIZE must fit in the ring" );
+
+CAsyncLogger::CAsyncLogger()
+	: m_Slots( NUM_SLOTS )
+	, m_EnqueuePos( 0 )
+	, m_DequeuePos( 0 )
+	, m_uiDropped( 0 )
+	, m_uiTotalDropped( 0 )
+	, m_State( State::NOT_STARTED )
+	, m_bSleeping( false )
+{
+	for( size_t uiIndex = 0; uiIndex < NUM_SLOTS; ++uiIndex )
+	{
+		m_Slots[ uiIndex ].sequence.store( uiIndex, std::memory_order_relaxed );
+	}
+
+	m_Output.reserve( NUM_SLOTS * SLOT_TEXT_SIZE );
+}
+
+CAsyncLogger::~CAsyncLogger()
+{
+	Shutdown();
+}
+
+bool CAsyncLogger::Write( const char* pszText, size_t uiLength )
+{
+	assert( pszText );
+
+	if( uiLength == 0 )
+		return true;
+
+	if( uiLength > MAX_MESSAGE_SIZE )
+		uiLength = MAX_MESSAGE_SIZE;
+
+	const auto state = m_State.load( std::memory_order_acquire );
+
+	if( state == State::NOT_STARTED )
+	{
+		Start();
+	}
+	else if( state == State::SHUT_DOWN )
+	{
+		std::lock_guard<std::mutex> lock( m_DrainMutex );
+
+		Output( pszText, uiLength );
+
+		return true;
+	}
+
+	const size_t uiNumSlots = ( uiLength + SLOT_TEXT_SIZE - 1 ) / SLOT_TEXT_SIZE;
+
+	size_t uiPos = m_EnqueuePos.load( std::memory_order_relaxed );
+
+	//Claim consecutive slots, so the worker writes them out in one piece.
+	while( true )
+	{
+		bool bRetry = false;
+
+		for( size_t uiSlot = 0; uiSlot < uiNumSlots; ++uiSlot )
+		{
+			const auto uiSequence = m_Slots[ ( uiPos + uiSlot ) & ( NUM_SLOTS - 1 ) ].sequence.load( std::memory_order_acquire );
+
+			const auto iDiff = static_cast<intptr_t>( uiSequence - ( uiPos + uiSlot ) );
+
+			if( iDiff < 0 )
+			{
+				//The worker hasn't gotten to this slot yet.
+				m_uiDropped.fetch_add( 1, std::memory_order_relaxed );
+				m_uiTotalDropped.fetch_add( 1, std::memory_order_relaxed );
+
+				return false;
+			}
+
+			if( iDiff > 0 )
+			{
+				//Another thread claimed it first.
+				bRetry = true;
+				break;
+			}
+		}
+
+		if( bRetry )
+		{
+			uiPos = m_EnqueuePos.load( std::memory_order_relaxed );
+			continue;
+		}
+
+		if( m_EnqueuePos.compare_exchange_weak( uiPos, uiPos + uiNumSlots, std::memory_order_relaxed ) )
+			break;
+	}
+
+	for( size_t uiSlot = 0; uiSlot < uiNumSlots; ++uiSlot )
+	{
+		auto& slot = m_Slots[ ( uiPos + uiSlot ) & ( NUM_SLOTS - 1 ) ];
+
+		const size_t uiOffset = uiSlot * SLOT_TEXT_SIZE;
+		const size_t uiChunkLength = ( uiLength - uiOffset ) < SLOT_TEXT_SIZE ? uiLength - uiOffset : SLOT_TEXT_SIZE;
+
+		memcpy( slot.szText, pszText + uiOffset, uiChunkLength );
+		slot.uiLength = static_cast<uint32_t>( uiChunkLength );
+
+		slot.sequence.store( uiPos + uiSlot + 1, std::memory_order_release );
+	}
+
+	//Pairs with the worker setting m_bSleeping before checking for pending text.
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+
+	if( m_bSleeping.load( std::memory_order_relaxed ) )
+		m_WorkAvailable.notify_one();
+
+	return true;
+}
+
+void CAsyncLogger::Flush()
+{
+	const auto state = m_State.load( std::memory_order_acquire );
+
+	if( state == State::RUNNING )
+	{
+		//Have the worker flush the sinks, so only it writes to them.
+		const size_t uiTarget = m_EnqueuePos.load( std::memory_order_acquire );
+
+		std::unique_lock<std::mutex> lock( m_Mutex );
+
+		if( !m_bFlushRequested || static_cast<intptr_t>( uiTarget - m_uiFlushRequestPos ) > 0 )
+			m_uiFlushRequestPos = uiTarget;
+
+		m_bFlushRequested = true;
+
+		m_WorkAvailable.notify_one();
+
+		m_WorkFinished.wait( lock, [ this, uiTarget ]()
+		{
+			return m_State.load( std::memory_order_acquire ) == State::SHUT_DOWN ||
+				static_cast<intptr_t>( m_uiFlushedPos - uiTarget ) >= 0;
+		} );
+
+		if( m_State.load( std::memory_order_acquire ) != State::SHUT_DOWN )
+			return;
+	}
+
+	Drain();
+
+	std::lock_guard<std::mutex> lock( m_DrainMutex );
+
+	for( auto pSink : m_Sinks )
+	{
+		pSink->Flush();
+	}
+}
+
+void CAsyncLogger::AddSink( ILogSink* pSink )
+{
+	assert( pSink );
+
+	std::lock_guard<std::mutex> lock( m_DrainMutex );
+
+	m_Sinks.push_back( pSink );
+}
+
+void CAsyncLogger::RemoveSink( ILogSink* pSink )
+{
+	//Write out text that was logged while the sink was added.
+	Flush();
+
+	std::lock_guard<std::mutex> lock( m_DrainMutex );
+
+	auto it = std::find( m_Sinks.begin(), m_Sinks.end(), pSink );
+
+	if( it != m_Sinks.end() )
+		m_Sinks.erase( it );
+}
+
+void CAsyncLogger::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_State.store( State::SHUT_DOWN, std::memory_order_release );
+	}
+
+	m_WorkAvailable.notify_all();
+	m_WorkFinished.notify_all();
+
+	//The worker writes everything that is queued before it stops.
+	if( m_Thread.joinable() )
+		m_Thread.join();
+
+	//Catch text from writers that claimed slots while the worker was stopping.
+	Drain();
+
+	std::lock_guard<std::mutex> lock( m_DrainMutex );
+
+	for( auto pSink : m_Sinks )
+	{
+		pSink->Flush();
+	}
+}
+
+void CAsyncLogger::Start()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_State.load( std::memory_order_relaxed ) != State::NOT_STARTED )
+		return;
+
+	m_Thread = std::thread( &CAsyncLogger::WorkerThread, this );
+
+	m_State.store( State::RUNNING, std::memory_order_release );
+}
+
+void CAsyncLogger::WorkerThread()
+{
+	while( true )
+	{
+		const bool bStop = m_State.load( std::memory_order_acquire ) == State::SHUT_DOWN;
+
+		const bool bWrote = Drain();
+
+		const size_t uiPos = m_DequeuePos.load( std::memory_order_acquire );
+
+		bool bFlushSinks;
+
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			bFlushSinks = m_bFlushRequested && static_cast<intptr_t>( uiPos - m_uiFlushRequestPos ) >= 0;
+		}
+
+		if( bFlushSinks )
+		{
+			std::lock_guard<std::mutex> lock( m_DrainMutex );
+
+			for( auto pSink : m_Sinks )
+			{
+				pSink->Flush();
+			}
+		}
+
+		{
+			//Lock so Flush can't miss the notification between checking its condition and waiting.
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			if( bFlushSinks )
+			{
+				m_uiFlushedPos = uiPos;
+
+				if( static_cast<intptr_t>( uiPos - m_uiFlushRequestPos ) >= 0 )
+					m_bFlushRequested = false;
+			}
+		}
+
+		m_WorkFinished.notify_all();
+
+		if( bStop )
+			break;
+
+		if( bWrote )
+			continue;
+
+		std::unique_lock<std::mutex> lock( m_Mutex );
+
+		m_bSleeping.store( true, std::memory_order_relaxed );
+
+		std::atomic_thread_fence( std::memory_order_seq_cst );
+
+		if( !HasPending() && !m_bFlushRequested && m_State.load( std::memory_order_acquire ) != State::SHUT_DOWN )
+			m_WorkAvailable.wait_for( lock, std::chrono::milliseconds( IDLE_WAIT_MS ) );
+
+		m_bSleeping.store( false, std::memory_order_relaxed );
+	}
+}
+
+bool CAsyncLogger::Drain()
+{
+	std::lock_guard<std::mutex> lock( m_DrainMutex );
+
+	size_t uiPos = m_DequeuePos.load( std::memory_order_relaxed );
+
+	while( true )
+	{
+		auto& slot = m_Slots[ uiPos & ( NUM_SLOTS - 1 ) ];
+
+		if( slot.sequence.load( std::memory_order_acquire ) != uiPos + 1 )
+			break;
+
+		m_Output.insert( m_Output.end(), slot.szText, slot.szText + slot.uiLength );
+
+		//Free the slot before writing, so writers have room while the console catches up.
+		slot.sequence.store( uiPos + NUM_SLOTS, std::memory_order_release );
+
+		++uiPos;
+	}
+
+	const size_t uiDropped = m_uiDropped.exchange( 0, std::memory_order_relaxed );
+
+	if( uiDropped > 0 )
+	{
+		char szBuffer[ 64 ];
+
+		const int iLength = snprintf( szBuffer, sizeof( szBuffer ), "%u log messages dropped\n", static_cast<unsigned int>( uiDropped ) );
+
+		if( iLength > 0 )
+			m_Output.insert( m_Output.end(), szBuffer, szBuffer + iLength );
+	}
+
+	const bool bWrote = !m_Output.empty();
+
+	if( bWrote )
+	{
+		Output( m_Output.data(), m_Output.size() );
+
+		m_Output.clear();
+
+		m_DequeuePos.store( uiPos, std::memory_order_release );
+	}
+
+	//Lets sinks flush on a timer, the worker drains at least every IDLE_WAIT_MS.
+	for( auto pSink : m_Sinks )
+	{
+		pSink->Update();
+	}
+
+	return bWrote;
+}
+
+void CAsyncLogger::Output( const char* pszText, const size_t uiLength )
+{
+	fwrite( pszText, 1, uiLength, stdout );
+	fflush( stdout );
+
+	for( auto pSink : m_Sinks )
+	{
+		pSink->Write( pszText, uiLength );
+	}
+}
+
+bool CAsyncLogger::HasPending() const
+{
+	const size_t uiPos = m_DequeuePos.load( std::memory_order_relaxed );
+
+	return m_Slots[ uiPos & ( NUM_SLOTS - 1 ) ].sequence.load( std::memory_order_acquire ) == uiPos + 1 ||
+		m_uiDropped.load( std::memory_order_relaxed ) > 0;
+}
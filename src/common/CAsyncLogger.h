@@ -0,0 +1,180 @@
+#ifndef COMMON_CASYNCLOGGER_H
+#define COMMON_CASYNCLOGGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ILogSink;
+
+/**
+*	Writes log text to stdout and any added sinks on a background thread, so callers never block on the console or disk.
+*	Text is copied into a fixed size ring of slots that any number of threads can write to without locking.
+*	A message longer than a slot takes several consecutive slots, so messages are never interleaved.
+*	If the ring is full, the message is dropped, and the number of dropped messages is logged once there is room again.
+*/
+class CAsyncLogger final
+{
+public:
+	/**
+	*	Number of slots in the ring. Must be a power of 2.
+	*/
+	static const size_t NUM_SLOTS = 4096;
+
+	/**
+	*	Number of bytes of text that fit in a single slot.
+	*/
+	static const size_t SLOT_TEXT_SIZE = 240;
+
+	/**
+	*	Longest message that can be written. Longer messages are truncated.
+	*/
+	static const size_t MAX_MESSAGE_SIZE = 4096;
+
+	/**
+	*	How long the worker sleeps when it has nothing to do, in milliseconds. A wakeup can be missed, in which case text is written after this long.
+	*/
+	static const unsigned int IDLE_WAIT_MS = 50;
+
+public:
+	CAsyncLogger();
+	~CAsyncLogger();
+
+	/**
+	*	Queues text to be written. Starts the worker thread if needed.
+	*	After the logger is shut down, text is written immediately instead.
+	*	@return Whether the text was queued or written. False if it was dropped because the ring is full.
+	*/
+	bool Write( const char* pszText, size_t uiLength );
+
+	/**
+	*	Waits until all text queued before this call has been written, and the sinks have been flushed.
+	*	While the logger is running, the sinks are flushed by the worker thread.
+	*/
+	void Flush();
+
+	/**
+	*	Adds a sink that receives all text written from now on. The sink is only called from the worker thread while the logger is running.
+	*/
+	void AddSink( ILogSink* pSink );
+
+	/**
+	*	Flushes and removes a sink. Once this returns, the sink is no longer used.
+	*/
+	void RemoveSink( ILogSink* pSink );
+
+	/**
+	*	Writes all queued text and stops the worker thread. Text written after this is written immediately.
+	*/
+	void Shutdown();
+
+	/**
+	*	@return Total number of messages dropped because the ring was full.
+	*/
+	size_t GetDroppedCount() const { return m_uiTotalDropped.load( std::memory_order_relaxed ); }
+
+private:
+	enum class State
+	{
+		NOT_STARTED = 0,
+		RUNNING,
+		SHUT_DOWN
+	};
+
+	struct Slot_t
+	{
+		/**
+		*	Equal to the slot's position when it is free, and its position + 1 once it holds text.
+		*/
+		std::atomic<size_t> sequence;
+
+		uint32_t uiLength;
+
+		char szText[ SLOT_TEXT_SIZE ];
+	};
+
+	void Start();
+
+	void WorkerThread();
+
+	/**
+	*	Moves all text that is ready out of the ring and writes it.
+	*	Only one thread can drain at a time.
+	*	@return Whether any text was written.
+	*/
+	bool Drain();
+
+	/**
+	*	Writes text to stdout and the sinks. Must be called with m_DrainMutex held.
+	*/
+	void Output( const char* pszText, const size_t uiLength );
+
+	/**
+	*	@return Whether any text has been queued that hasn't been written yet.
+	*/
+	bool HasPending() const;
+
+private:
+	std::vector<Slot_t> m_Slots;
+
+	/**
+	*	Position of the next slot that writers will claim.
+	*/
+	std::atomic<size_t> m_EnqueuePos;
+
+	/**
+	*	Position of the next slot that will be drained. Only modified while holding m_DrainMutex.
+	*/
+	std::atomic<size_t> m_DequeuePos;
+
+	std::atomic<size_t> m_uiDropped;
+	std::atomic<size_t> m_uiTotalDropped;
+
+	std::atomic<State> m_State;
+
+	/**
+	*	Whether the worker is waiting for work. Writers only wake it up if it is.
+	*/
+	std::atomic<bool> m_bSleeping;
+
+	std::mutex m_DrainMutex;
+
+	/**
+	*	Text taken from the ring that is being written. Only used while holding m_DrainMutex.
+	*/
+	std::vector<char> m_Output;
+
+	/**
+	*	Only used while holding m_DrainMutex.
+	*/
+	std::vector<ILogSink*> m_Sinks;
+
+	std::mutex m_Mutex;
+
+	std::condition_variable m_WorkAvailable;
+	std::condition_variable m_WorkFinished;
+
+	/**
+	*	Whether Flush is waiting for the worker to flush the sinks once it has written up to m_uiFlushRequestPos.
+	*	Guarded by m_Mutex, like m_uiFlushedPos.
+	*/
+	bool m_bFlushRequested = false;
+	size_t m_uiFlushRequestPos = 0;
+
+	/**
+	*	Position up to which text has been written and the sinks flushed.
+	*/
+	size_t m_uiFlushedPos = 0;
+
+	std::thread m_Thread;
+
+private:
+	CAsyncLogger( const CAsyncLogger& ) = delete;
+	CAsyncLogger& operator=( const CAsyncLogger& ) = delete;
+};
+
+#endif //COMMON_CASYNCLOGGER_H
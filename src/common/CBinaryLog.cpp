@@ -0,0 +1,565 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+
+#include "CBinaryLog.h"
+
+const size_t CBinaryLog::BUFFER_SIZE;
+const size_t CBinaryLog::MAX_RECORD_SIZE;
+const size_t CBinaryLog::MAX_STRING_LENGTH;
+const unsigned int CBinaryLog::DECODE_INTERVAL_MS;
+
+static_assert( ( CBinaryLog::BUFFER_SIZE & ( CBinaryLog::BUFFER_SIZE - 1 ) ) == 0, "CBinaryLog::BUFFER_SIZE must be a power of 2" );
+
+namespace
+{
+/**
+*	Copies data into a ring buffer, wrapping around the end.
+*/
+void CopyToRing( uint8_t* pRing, const size_t uiPos, const void* pData, const size_t uiSize )
+{
+	const size_t uiOffset = uiPos & ( CBinaryLog::BUFFER_SIZE - 1 );
+	const size_t uiFirst = std::min( uiSize, CBinaryLog::BUFFER_SIZE - uiOffset );
+
+	memcpy( pRing + uiOffset, pData, uiFirst );
+	memcpy( pRing, reinterpret_cast<const uint8_t*>( pData ) + uiFirst, uiSize - uiFirst );
+}
+
+void CopyFromRing( const uint8_t* pRing, const size_t uiPos, void* pData, const size_t uiSize )
+{
+	const size_t uiOffset = uiPos & ( CBinaryLog::BUFFER_SIZE - 1 );
+	const size_t uiFirst = std::min( uiSize, CBinaryLog::BUFFER_SIZE - uiOffset );
+
+	memcpy( pData, pRing + uiOffset, uiFirst );
+	memcpy( reinterpret_cast<uint8_t*>( pData ) + uiFirst, pRing, uiSize - uiFirst );
+}
+
+/**
+*	Reads arguments back out of a record.
+*/
+class CArgReader final
+{
+public:
+	struct Arg_t
+	{
+		CBinaryLog::ArgType type;
+
+		long long iValue;
+		unsigned long long uiValue;
+		double flValue;
+		const void* pValue;
+		const char* pszValue;
+	};
+
+public:
+	CArgReader( const uint8_t* pData, const uint8_t* pEnd )
+		: m_pData( pData )
+		, m_pEnd( pEnd )
+	{
+	}
+
+	bool Next( Arg_t& arg )
+	{
+		if( m_pData >= m_pEnd )
+			return false;
+
+		arg.type = static_cast<CBinaryLog::ArgType>( *m_pData++ );
+
+		switch( arg.type )
+		{
+		case CBinaryLog::ArgType::INT:
+			Read( &arg.iValue, sizeof( arg.iValue ) );
+			arg.uiValue = static_cast<unsigned long long>( arg.iValue );
+			arg.flValue = static_cast<double>( arg.iValue );
+			break;
+
+		case CBinaryLog::ArgType::UINT:
+			Read( &arg.uiValue, sizeof( arg.uiValue ) );
+			arg.iValue = static_cast<long long>( arg.uiValue );
+			arg.flValue = static_cast<double>( arg.uiValue );
+			break;
+
+		case CBinaryLog::ArgType::DOUBLE:
+			Read( &arg.flValue, sizeof( arg.flValue ) );
+			arg.iValue = static_cast<long long>( arg.flValue );
+			arg.uiValue = static_cast<unsigned long long>( arg.iValue );
+			break;
+
+		case CBinaryLog::ArgType::POINTER:
+			Read( &arg.pValue, sizeof( arg.pValue ) );
+			arg.iValue = static_cast<long long>( reinterpret_cast<uintptr_t>( arg.pValue ) );
+			arg.uiValue = reinterpret_cast<uintptr_t>( arg.pValue );
+			arg.flValue = 0;
+			break;
+
+		case CBinaryLog::ArgType::STRING:
+			{
+				uint16_t uiLength;
+				Read( &uiLength, sizeof( uiLength ) );
+
+				//Stored with its null terminator.
+				arg.pszValue = reinterpret_cast<const char*>( m_pData );
+				m_pData += uiLength + 1;
+
+				arg.iValue = 0;
+				arg.uiValue = 0;
+				arg.flValue = 0;
+				break;
+			}
+
+		default: return false;
+		}
+
+		return m_pData <= m_pEnd;
+	}
+
+private:
+	void Read( void* pDest, const size_t uiSize )
+	{
+		memcpy( pDest, m_pData, uiSize );
+		m_pData += uiSize;
+	}
+
+private:
+	const uint8_t* m_pData;
+	const uint8_t* m_pEnd;
+};
+
+/**
+*	Formats a single conversion, passing the * widths and precisions before the value.
+*/
+template<typename T>
+int FormatArg( char* pszBuffer, const size_t uiBufferSize, const char* pszSpec, const uint8_t uiNumStars, const int* pStars, const T value )
+{
+	switch( uiNumStars )
+	{
+	default:
+	case 0: return snprintf( pszBuffer, uiBufferSize, pszSpec, value );
+	case 1: return snprintf( pszBuffer, uiBufferSize, pszSpec, pStars[ 0 ], value );
+	case 2: return snprintf( pszBuffer, uiBufferSize, pszSpec, pStars[ 0 ], pStars[ 1 ], value );
+	}
+}
+}
+
+void CBinaryLog::CRecord::AddValue( const ArgType type, const void* pValue, const size_t uiSize )
+{
+	if( m_uiSize + 1 + uiSize > sizeof( m_Data ) )
+	{
+		m_bOverflow = true;
+		return;
+	}
+
+	m_Data[ m_uiSize++ ] = static_cast<uint8_t>( type );
+
+	memcpy( m_Data + m_uiSize, pValue, uiSize );
+	m_uiSize += uiSize;
+}
+
+void CBinaryLog::CRecord::AddString( const char* pszValue )
+{
+	if( !pszValue )
+		pszValue = "(null)";
+
+	const size_t uiOverhead = 1 + sizeof( uint16_t ) + 1;
+
+	if( m_uiSize + uiOverhead > sizeof( m_Data ) )
+	{
+		m_bOverflow = true;
+		return;
+	}
+
+	size_t uiLength = strnlen( pszValue, MAX_STRING_LENGTH );
+
+	//Truncate strings that don't fit, so the rest of the message is still recorded.
+	uiLength = std::min( uiLength, sizeof( m_Data ) - m_uiSize - uiOverhead );
+
+	const uint16_t uiLength16 = static_cast<uint16_t>( uiLength );
+
+	m_Data[ m_uiSize++ ] = static_cast<uint8_t>( ArgType::STRING );
+
+	memcpy( m_Data + m_uiSize, &uiLength16, sizeof( uiLength16 ) );
+	m_uiSize += sizeof( uiLength16 );
+
+	memcpy( m_Data + m_uiSize, pszValue, uiLength );
+	m_uiSize += uiLength;
+
+	m_Data[ m_uiSize++ ] = '\0';
+}
+
+struct CBinaryLog::ThreadState_t
+{
+	CBinaryLog* pLog = nullptr;
+
+	std::shared_ptr<ThreadBuffer_t> buffer;
+
+	~ThreadState_t()
+	{
+		if( buffer )
+			buffer->bAbandoned.store( true, std::memory_order_release );
+	}
+};
+
+CBinaryLog::CBinaryLog( OutputFn pfnOutput )
+	: m_pfnOutput( pfnOutput )
+{
+	assert( pfnOutput );
+}
+
+CBinaryLog::~CBinaryLog()
+{
+	Shutdown();
+}
+
+LogFormatID_t CBinaryLog::RegisterFormat( const char* pszFormat )
+{
+	assert( pszFormat );
+
+	Format_t format;
+
+	ParseFormat( pszFormat, format );
+
+	std::lock_guard<std::mutex> lock( m_FormatMutex );
+
+	m_Formats.emplace_back( std::move( format ) );
+
+	return static_cast<LogFormatID_t>( m_Formats.size() - 1 );
+}
+
+bool CBinaryLog::Write( const LogFormatID_t formatID, const CRecord& record )
+{
+	auto& buffer = GetThreadBuffer();
+
+	Header_t header;
+
+	header.uiSize = static_cast<uint32_t>( sizeof( header ) + record.GetSize() );
+	header.formatID = formatID;
+	header.timestamp = static_cast<uint64_t>( std::chrono::steady_clock::now().time_since_epoch().count() );
+
+	const size_t uiHead = buffer.head.load( std::memory_order_relaxed );
+	const size_t uiTail = buffer.tail.load( std::memory_order_acquire );
+
+	if( BUFFER_SIZE - ( uiHead - uiTail ) < header.uiSize )
+	{
+		m_uiDropped.fetch_add( 1, std::memory_order_relaxed );
+		return false;
+	}
+
+	CopyToRing( buffer.data.get(), uiHead, &header, sizeof( header ) );
+	CopyToRing( buffer.data.get(), uiHead + sizeof( header ), record.GetData(), record.GetSize() );
+
+	buffer.head.store( uiHead + header.uiSize, std::memory_order_release );
+
+	if( m_bShutdown.load( std::memory_order_acquire ) )
+		Decode();
+
+	return true;
+}
+
+void CBinaryLog::Flush()
+{
+	Decode();
+}
+
+void CBinaryLog::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_ThreadMutex );
+
+		m_bShutdown.store( true, std::memory_order_release );
+	}
+
+	m_Wake.notify_all();
+
+	if( m_Thread.joinable() )
+		m_Thread.join();
+
+	Decode();
+}
+
+CBinaryLog::ThreadBuffer_t& CBinaryLog::GetThreadBuffer()
+{
+	static thread_local ThreadState_t state;
+
+	if( state.pLog == this )
+		return *state.buffer;
+
+	if( state.buffer )
+		state.buffer->bAbandoned.store( true, std::memory_order_release );
+
+	state.pLog = this;
+	state.buffer = std::make_shared<ThreadBuffer_t>();
+
+	{
+		std::lock_guard<std::mutex> lock( m_BuffersMutex );
+
+		m_Buffers.push_back( state.buffer );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_ThreadMutex );
+
+		if( !m_bStarted && !m_bShutdown.load( std::memory_order_relaxed ) )
+		{
+			m_bStarted = true;
+
+			m_Thread = std::thread( &CBinaryLog::DecoderThread, this );
+		}
+	}
+
+	return *state.buffer;
+}
+
+void CBinaryLog::DecoderThread()
+{
+	std::unique_lock<std::mutex> lock( m_ThreadMutex );
+
+	while( !m_bShutdown.load( std::memory_order_relaxed ) )
+	{
+		m_Wake.wait_for( lock, std::chrono::milliseconds( DECODE_INTERVAL_MS ) );
+
+		lock.unlock();
+
+		Decode();
+
+		lock.lock();
+	}
+}
+
+void CBinaryLog::Decode()
+{
+	std::lock_guard<std::mutex> decodeLock( m_DecodeMutex );
+
+	m_Scratch.clear();
+	m_Pending.clear();
+
+	{
+		std::lock_guard<std::mutex> lock( m_BuffersMutex );
+
+		for( auto it = m_Buffers.begin(); it != m_Buffers.end(); )
+		{
+			auto& buffer = **it;
+
+			//Check before reading the head, so nothing written before the thread exited is missed.
+			const bool bAbandoned = buffer.bAbandoned.load( std::memory_order_acquire );
+
+			const size_t uiHead = buffer.head.load( std::memory_order_acquire );
+			size_t uiTail = buffer.tail.load( std::memory_order_relaxed );
+
+			while( uiTail != uiHead )
+			{
+				Header_t header;
+
+				CopyFromRing( buffer.data.get(), uiTail, &header, sizeof( header ) );
+
+				const size_t uiOffset = m_Scratch.size();
+
+				m_Scratch.resize( uiOffset + header.uiSize );
+
+				CopyFromRing( buffer.data.get(), uiTail, m_Scratch.data() + uiOffset, header.uiSize );
+
+				m_Pending.push_back( { header.timestamp, uiOffset } );
+
+				uiTail += header.uiSize;
+			}
+
+			buffer.tail.store( uiTail, std::memory_order_release );
+
+			if( bAbandoned )
+				it = m_Buffers.erase( it );
+			else
+				++it;
+		}
+	}
+
+	if( m_Pending.empty() )
+		return;
+
+	//Merge the threads' messages back into the order they were recorded in.
+	std::stable_sort( m_Pending.begin(), m_Pending.end(), []( const Pending_t& lhs, const Pending_t& rhs )
+	{
+		return lhs.timestamp < rhs.timestamp;
+	} );
+
+	std::lock_guard<std::mutex> formatLock( m_FormatMutex );
+
+	for( const auto& pending : m_Pending )
+	{
+		m_szOutput.clear();
+
+		FormatRecord( m_Scratch.data() + pending.uiOffset, m_szOutput );
+
+		if( !m_szOutput.empty() )
+			m_pfnOutput( m_szOutput.data(), m_szOutput.size() );
+	}
+}
+
+void CBinaryLog::FormatRecord( const uint8_t* pRecord, std::string& szOutput ) const
+{
+	Header_t header;
+
+	memcpy( &header, pRecord, sizeof( header ) );
+
+	if( header.formatID >= m_Formats.size() )
+		return;
+
+	const auto& format = m_Formats[ header.formatID ];
+
+	CArgReader reader( pRecord + sizeof( header ), pRecord + header.uiSize );
+
+	CArgReader::Arg_t arg;
+
+	char szBuffer[ 512 ];
+
+	for( const auto& segment : format.segments )
+	{
+		if( !segment.conversion )
+		{
+			szOutput += segment.szText;
+			continue;
+		}
+
+		int stars[ 2 ] = {};
+
+		bool bMissing = false;
+
+		for( uint8_t uiStar = 0; uiStar < segment.uiNumStars && !bMissing; ++uiStar )
+		{
+			if( reader.Next( arg ) )
+				stars[ uiStar ] = static_cast<int>( arg.iValue );
+			else
+				bMissing = true;
+		}
+
+		if( bMissing || !reader.Next( arg ) )
+		{
+			szOutput += "<missing>";
+			continue;
+		}
+
+		const char* pszSpec = segment.szText.c_str();
+
+		int iLength;
+
+		switch( segment.conversion )
+		{
+		case 'd':
+		case 'i':
+			iLength = FormatArg( szBuffer, sizeof( szBuffer ), pszSpec, segment.uiNumStars, stars, arg.iValue );
+			break;
+
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			iLength = FormatArg( szBuffer, sizeof( szBuffer ), pszSpec, segment.uiNumStars, stars, arg.uiValue );
+			break;
+
+		case 'c':
+			iLength = FormatArg( szBuffer, sizeof( szBuffer ), pszSpec, segment.uiNumStars, stars, static_cast<int>( arg.iValue ) );
+			break;
+
+		case 'p':
+			iLength = FormatArg( szBuffer, sizeof( szBuffer ), pszSpec, segment.uiNumStars, stars, 
+				arg.type == ArgType::POINTER ? arg.pValue : reinterpret_cast<const void*>( static_cast<uintptr_t>( arg.uiValue ) ) );
+			break;
+
+		case 's':
+			iLength = FormatArg( szBuffer, sizeof( szBuffer ), pszSpec, segment.uiNumStars, stars, 
+				arg.type == ArgType::STRING ? arg.pszValue : "<not a string>" );
+			break;
+
+		default:
+			iLength = FormatArg( szBuffer, sizeof( szBuffer ), pszSpec, segment.uiNumStars, stars, arg.flValue );
+			break;
+		}
+
+		if( iLength > 0 )
+			szOutput.append( szBuffer, std::min( static_cast<size_t>( iLength ), sizeof( szBuffer ) - 1 ) );
+	}
+}
+
+void CBinaryLog::ParseFormat( const char* pszFormat, Format_t& format )
+{
+	const char* pszLiteral = pszFormat;
+
+	auto addLiteral = [ & ]( const char* pszEnd )
+	{
+		if( pszEnd > pszLiteral )
+			format.segments.push_back( { '\0', 0, std::string( pszLiteral, pszEnd ) } );
+	};
+
+	const char* pszCursor = pszFormat;
+
+	while( *pszCursor )
+	{
+		if( *pszCursor != '%' )
+		{
+			++pszCursor;
+			continue;
+		}
+
+		if( pszCursor[ 1 ] == '%' )
+		{
+			//Keep one percent sign as literal text.
+			addLiteral( pszCursor + 1 );
+			pszCursor += 2;
+			pszLiteral = pszCursor;
+			continue;
+		}
+
+		addLiteral( pszCursor );
+
+		Segment_t segment{ '\0', 0, "%" };
+
+		const char* pszSpec = pszCursor + 1;
+
+		//Flags, width and precision.
+		while( *pszSpec && strchr( "-+ #0123456789.*", *pszSpec ) )
+		{
+			if( *pszSpec == '*' && segment.uiNumStars < 2 )
+				++segment.uiNumStars;
+
+			segment.szText += *pszSpec++;
+		}
+
+		//Length modifiers are replaced by the recorded width.
+		while( *pszSpec && strchr( "hlLqjzt", *pszSpec ) )
+			++pszSpec;
+
+		if( !*pszSpec || !strchr( "diouxXcpseEfFgGaAn", *pszSpec ) )
+		{
+			//Not a valid conversion, print it as is.
+			pszLiteral = pszCursor;
+			pszCursor = *pszSpec ? pszSpec + 1 : pszSpec;
+			continue;
+		}
+
+		segment.conversion = *pszSpec;
+
+		switch( segment.conversion )
+		{
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			segment.szText += "ll";
+			break;
+
+		default: break;
+		}
+
+		segment.szText += segment.conversion;
+
+		//%n writes to its argument, which can't be done after the fact.
+		if( segment.conversion != 'n' )
+			format.segments.push_back( std::move( segment ) );
+
+		pszCursor = pszSpec + 1;
+		pszLiteral = pszCursor;
+	}
+
+	addLiteral( pszCursor );
+}
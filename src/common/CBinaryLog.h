@@ -0,0 +1,280 @@
+#ifndef COMMON_CBINARYLOG_H
+#define COMMON_CBINARYLOG_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+*	Identifies a format string registered with CBinaryLog::RegisterFormat.
+*/
+using LogFormatID_t = uint32_t;
+
+/**
+*	Records log messages as a format ID and the raw arguments, and formats them on a background thread.
+*	Each thread writes to its own buffer, so recording a message only copies the arguments and never locks.
+*	The decoder merges the buffers in the order messages were recorded, formats them and passes them to an output function.
+*	If a thread's buffer is full, the message is dropped.
+*	Use the LOG_BINARY macro in Logging.h, which registers the format string once.
+*/
+class CBinaryLog final
+{
+public:
+	/**
+	*	Size of each thread's buffer. Must be a power of 2.
+	*/
+	static const size_t BUFFER_SIZE = 64 * 1024;
+
+	/**
+	*	Largest encoded message. Strings are truncated to fit.
+	*/
+	static const size_t MAX_RECORD_SIZE = 1024;
+
+	/**
+	*	Longest string argument that is recorded. Longer strings are truncated.
+	*/
+	static const size_t MAX_STRING_LENGTH = 256;
+
+	/**
+	*	How often the decoder checks for messages, in milliseconds.
+	*/
+	static const unsigned int DECODE_INTERVAL_MS = 20;
+
+	/**
+	*	Receives each formatted message.
+	*/
+	using OutputFn = void ( * )( const char* pszText, size_t uiLength );
+
+	enum class ArgType : uint8_t
+	{
+		INT = 0,
+		UINT,
+		DOUBLE,
+		STRING,
+		POINTER
+	};
+
+	/**
+	*	Encodes a message's arguments on the stack.
+	*/
+	class CRecord final
+	{
+	public:
+		CRecord() = default;
+
+		const uint8_t* GetData() const { return m_Data; }
+
+		size_t GetSize() const { return m_uiSize; }
+
+		/**
+		*	@return Whether any argument didn't fit.
+		*/
+		bool HasOverflowed() const { return m_bOverflow; }
+
+		void AddInt( const long long iValue ) { AddValue( ArgType::INT, &iValue, sizeof( iValue ) ); }
+
+		void AddUInt( const unsigned long long uiValue ) { AddValue( ArgType::UINT, &uiValue, sizeof( uiValue ) ); }
+
+		void AddDouble( const double flValue ) { AddValue( ArgType::DOUBLE, &flValue, sizeof( flValue ) ); }
+
+		void AddPointer( const void* pValue ) { AddValue( ArgType::POINTER, &pValue, sizeof( pValue ) ); }
+
+		void AddString( const char* pszValue );
+
+		template<typename T>
+		std::enable_if_t<std::is_integral<T>::value && std::is_signed<T>::value> Add( const T value ) { AddInt( value ); }
+
+		template<typename T>
+		std::enable_if_t<std::is_integral<T>::value && std::is_unsigned<T>::value> Add( const T value ) { AddUInt( value ); }
+
+		template<typename T>
+		std::enable_if_t<std::is_floating_point<T>::value> Add( const T value ) { AddDouble( value ); }
+
+		template<typename T>
+		std::enable_if_t<std::is_enum<T>::value> Add( const T value ) { Add( static_cast<std::underlying_type_t<T>>( value ) ); }
+
+		void Add( const char* pszValue ) { AddString( pszValue ); }
+
+		void Add( const void* pValue ) { AddPointer( pValue ); }
+
+		void AddAll() {}
+
+		template<typename T, typename... Args>
+		void AddAll( const T value, const Args... args )
+		{
+			Add( value );
+			AddAll( args... );
+		}
+
+	private:
+		void AddValue( const ArgType type, const void* pValue, const size_t uiSize );
+
+	private:
+		uint8_t m_Data[ MAX_RECORD_SIZE ];
+		size_t m_uiSize = 0;
+		bool m_bOverflow = false;
+	};
+
+public:
+	explicit CBinaryLog( OutputFn pfnOutput );
+	~CBinaryLog();
+
+	/**
+	*	Registers a format string. The string must remain valid for the lifetime of the log.
+	*	Supports the printf conversions, except %n. Length modifiers are ignored, since arguments are recorded at full width.
+	*/
+	LogFormatID_t RegisterFormat( const char* pszFormat );
+
+	/**
+	*	Records a message. Starts the decoder thread if needed.
+	*	@return Whether the message was recorded. False if the thread's buffer is full.
+	*/
+	template<typename... Args>
+	bool Record( const LogFormatID_t formatID, const Args... args )
+	{
+		CRecord record;
+
+		record.AddAll( args... );
+
+		return Write( formatID, record );
+	}
+
+	/**
+	*	Records an encoded message.
+	*/
+	bool Write( const LogFormatID_t formatID, const CRecord& record );
+
+	/**
+	*	Formats all messages recorded so far on the calling thread.
+	*/
+	void Flush();
+
+	/**
+	*	Formats all recorded messages and stops the decoder thread.
+	*	Messages recorded after this are formatted immediately.
+	*/
+	void Shutdown();
+
+	/**
+	*	@return Total number of messages dropped because a buffer was full.
+	*/
+	size_t GetDroppedCount() const { return m_uiDropped.load( std::memory_order_relaxed ); }
+
+private:
+	struct Header_t
+	{
+		uint32_t uiSize;
+		LogFormatID_t formatID;
+		uint64_t timestamp;
+	};
+
+	struct ThreadBuffer_t
+	{
+		std::unique_ptr<uint8_t[]> data{ new uint8_t[ BUFFER_SIZE ] };
+
+		/**
+		*	Only written by the owning thread.
+		*/
+		std::atomic<size_t> head{ 0 };
+
+		/**
+		*	Only written by the decoder.
+		*/
+		std::atomic<size_t> tail{ 0 };
+
+		/**
+		*	Set when the owning thread exits. The buffer is freed once it has been drained.
+		*/
+		std::atomic<bool> bAbandoned{ false };
+	};
+
+	/**
+	*	Part of a format string: either literal text, or a single conversion.
+	*/
+	struct Segment_t
+	{
+		/**
+		*	Conversion character, or 0 for literal text.
+		*/
+		char conversion;
+
+		/**
+		*	Number of * widths and precisions that take an argument.
+		*/
+		uint8_t uiNumStars;
+
+		/**
+		*	Literal text, or the conversion specification with its length modifiers removed and a length modifier for the recorded width added.
+		*/
+		std::string szText;
+	};
+
+	struct Format_t
+	{
+		std::vector<Segment_t> segments;
+	};
+
+	struct Pending_t
+	{
+		uint64_t timestamp;
+		size_t uiOffset;
+	};
+
+	struct ThreadState_t;
+
+	ThreadBuffer_t& GetThreadBuffer();
+
+	void DecoderThread();
+
+	/**
+	*	Formats all messages that have been recorded. Only one thread can decode at a time.
+	*/
+	void Decode();
+
+	void FormatRecord( const uint8_t* pRecord, std::string& szOutput ) const;
+
+	static void ParseFormat( const char* pszFormat, Format_t& format );
+
+private:
+	OutputFn m_pfnOutput;
+
+	mutable std::mutex m_FormatMutex;
+
+	std::deque<Format_t> m_Formats;
+
+	std::mutex m_BuffersMutex;
+
+	std::vector<std::shared_ptr<ThreadBuffer_t>> m_Buffers;
+
+	std::mutex m_DecodeMutex;
+
+	/**
+	*	Copies of records that are being decoded. Only used while holding m_DecodeMutex.
+	*/
+	std::vector<uint8_t> m_Scratch;
+	std::vector<Pending_t> m_Pending;
+	std::string m_szOutput;
+
+	std::atomic<size_t> m_uiDropped{ 0 };
+
+	std::mutex m_ThreadMutex;
+	std::condition_variable m_Wake;
+	std::thread m_Thread;
+	bool m_bStarted = false;
+	std::atomic<bool> m_bShutdown{ false };
+
+private:
+	CBinaryLog( const CBinaryLog& ) = delete;
+	CBinaryLog& operator=( const CBinaryLog& ) = delete;
+};
+
+#endif //COMMON_CBINARYLOG_H
@@ -0,0 +1,124 @@
+#include "CPUFeatures.h"
+
+#include "CCharacterSet.h"
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <intrin.h>
+#include <tmmintrin.h>
+
+#define CHARACTERSET_SSSE3
+#define CHARACTERSET_TARGET_SSSE3
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <tmmintrin.h>
+
+#define CHARACTERSET_SSSE3
+//Only the vector functions are compiled for SSSE3, so the rest runs on any CPU.
+#define CHARACTERSET_TARGET_SSSE3 __attribute__( ( target( "ssse3" ) ) )
+#endif
+
+const size_t CCharacterSet::MAX_CHARS;
+const size_t CCharacterSet::BLOCK_SIZE;
+
+namespace
+{
+unsigned int ClassifyBlockScalar( const CCharacterSet& set, const char* pszData )
+{
+	unsigned int uiMask = 0;
+
+	for( size_t uiIndex = 0; uiIndex < CCharacterSet::BLOCK_SIZE; ++uiIndex )
+	{
+		if( set.InSet( pszData[ uiIndex ] ) )
+			uiMask |= 1 << uiIndex;
+	}
+
+	return uiMask;
+}
+
+#ifdef CHARACTERSET_SSSE3
+/**
+*	Looks up each character's low nibble in the half of the bitset for its high nibble's top bit,
+*	then tests the bit for the rest of the high nibble.
+*/
+CHARACTERSET_TARGET_SSSE3 unsigned int ClassifyBlockSSSE3( const uint8_t* pBits, const char* pszData )
+{
+	const __m128i lowTable = _mm_load_si128( reinterpret_cast<const __m128i*>( pBits ) );
+	const __m128i highTable = _mm_load_si128( reinterpret_cast<const __m128i*>( pBits + 16 ) );
+
+	const __m128i highNibbleBits = _mm_setr_epi8( 1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128 );
+
+	const __m128i block = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pszData ) );
+
+	//Shuffles produce 0 for indices with the top bit set, so each table only gives results for its own half.
+	const __m128i row = _mm_or_si128(
+		_mm_shuffle_epi8( lowTable, block ),
+		_mm_shuffle_epi8( highTable, _mm_xor_si128( block, _mm_set1_epi8( -128 ) ) ) );
+
+	const __m128i highNibbles = _mm_and_si128( _mm_srli_epi16( block, 4 ), _mm_set1_epi8( 0x0F ) );
+
+	const __m128i match = _mm_and_si128( row, _mm_shuffle_epi8( highNibbleBits, highNibbles ) );
+
+	return ~static_cast<unsigned int>( _mm_movemask_epi8( _mm_cmpeq_epi8( match, _mm_setzero_si128() ) ) ) & 0xFFFF;
+}
+#endif
+
+inline unsigned int FindLowestBit( const unsigned int uiMask )
+{
+#ifdef _MSC_VER
+	unsigned long uiIndex;
+
+	_BitScanForward( &uiIndex, uiMask );
+
+	return static_cast<unsigned int>( uiIndex );
+#else
+	return static_cast<unsigned int>( __builtin_ctz( uiMask ) );
+#endif
+}
+}
+
+unsigned int CCharacterSet::ClassifyBlock( const char* pszData ) const
+{
+	assert( pszData );
+
+#ifdef CHARACTERSET_SSSE3
+	if( IsVectorized() )
+		return ClassifyBlockSSSE3( m_Bits, pszData );
+#endif
+
+	return ClassifyBlockScalar( *this, pszData );
+}
+
+const char* CCharacterSet::FindFirst( const char* pszData, const size_t uiLength ) const
+{
+	assert( pszData );
+
+	const char* const pszEnd = pszData + uiLength;
+
+#ifdef CHARACTERSET_SSSE3
+	if( IsVectorized() )
+	{
+		for( ; static_cast<size_t>( pszEnd - pszData ) >= BLOCK_SIZE; pszData += BLOCK_SIZE )
+		{
+			if( const unsigned int uiMask = ClassifyBlockSSSE3( m_Bits, pszData ) )
+				return pszData + FindLowestBit( uiMask );
+		}
+	}
+#endif
+
+	//The rest, or everything if blocks can't be classified at once.
+	for( ; pszData < pszEnd; ++pszData )
+	{
+		if( InSet( *pszData ) )
+			return pszData;
+	}
+
+	return nullptr;
+}
+
+bool CCharacterSet::IsVectorized()
+{
+#ifdef CHARACTERSET_SSSE3
+	return Plat_HasCPUFeatures( CPUFeature::SSSE3 );
+#else
+	return false;
+#endif
+}
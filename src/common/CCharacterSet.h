@@ -3,15 +3,23 @@
 
 #include <cassert>
 #include <climits>
+#include <cstddef>
+#include <cstdint>
 
 /**
-*	Represents a set of ASCII characters. Used to quickly check if a character falls in a group of non-sequential characters.
+*	Represents a set of characters. Used to quickly check if a character falls in a group of non-sequential characters.
+*	Stored as a 256 bit bitset, laid out so that whole blocks of characters can be classified at once with a nibble lookup.
 */
 class CCharacterSet final
 {
 public:
 	static const size_t MAX_CHARS = 1 << CHAR_BIT;
 
+	/**
+	*	Number of characters that ClassifyBlock examines.
+	*/
+	static const size_t BLOCK_SIZE = 16;
+
 public:
 	CCharacterSet() = default;
 
@@ -20,13 +28,56 @@ public:
 
 	CCharacterSet( const char* pszCharacters );
 
+	/**
+	*	Adds a character to the set.
+	*/
+	inline void Add( const char cCharacter )
+	{
+		const auto uiChar = static_cast<unsigned char>( cCharacter );
+
+		m_Bits[ GetIndex( uiChar ) ] |= static_cast<uint8_t>( 1 << ( ( uiChar >> 4 ) & 7 ) );
+	}
+
 	inline bool InSet( const char cCharacter ) const
 	{
-		return m_szChars[ cCharacter ];
+		const auto uiChar = static_cast<unsigned char>( cCharacter );
+
+		return ( ( m_Bits[ GetIndex( uiChar ) ] >> ( ( uiChar >> 4 ) & 7 ) ) & 1 ) != 0;
+	}
+
+	/**
+	*	Classifies BLOCK_SIZE characters.
+	*	@param pszData Characters to classify. Doesn't have to be aligned or null terminated.
+	*	@return Mask with bit i set if pszData[ i ] is in the set.
+	*/
+	unsigned int ClassifyBlock( const char* pszData ) const;
+
+	/**
+	*	Finds the first character that is in the set. Classifies a block at a time.
+	*	@param pszData Characters to search. Doesn't have to be null terminated.
+	*	@param uiLength Number of characters to search.
+	*	@return The first character in the set, or null if there are none.
+	*/
+	const char* FindFirst( const char* pszData, const size_t uiLength ) const;
+
+	/**
+	*	@return Whether ClassifyBlock uses SSSE3 to classify a block with a few instructions.
+	*	If not, it checks one character at a time. Both produce the same results.
+	*/
+	static bool IsVectorized();
+
+private:
+	/**
+	*	Characters with a high nibble below 8 are in the first 16 bytes, the rest in the last 16.
+	*	Each byte is indexed by the low nibble, and has a bit for each high nibble.
+	*/
+	static inline size_t GetIndex( const unsigned int uiChar )
+	{
+		return ( ( uiChar >> 7 ) << 4 ) | ( uiChar & 15 );
 	}
 
 private:
-	bool m_szChars[ MAX_CHARS ] = {};
+	alignas( 16 ) uint8_t m_Bits[ MAX_CHARS / CHAR_BIT ] = {};
 };
 
 inline CCharacterSet::CCharacterSet( const char* pszCharacters )
@@ -35,7 +86,7 @@ inline CCharacterSet::CCharacterSet( const char* pszCharacters )
 
 	while( *pszCharacters )
 	{
-		m_szChars[ *pszCharacters ] = true;
+		Add( *pszCharacters );
 
 		++pszCharacters;
 	}
@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cassert>
+
+#include "CClientSnapshots.h"
+
+const size_t CClientSnapshots::FRAME_COUNT;
+
+static_assert( ( CClientSnapshots::FRAME_COUNT & ( CClientSnapshots::FRAME_COUNT - 1 ) ) == 0, "The frame count must be a power of 2" );
+
+CClientSnapshots::CClientSnapshots( CEntityStatePool& pool )
+	: m_Pool( pool )
+{
+}
+
+CClientSnapshots::~CClientSnapshots()
+{
+	Reset();
+}
+
+void CClientSnapshots::BeginFrame( const uint32_t uiSequence )
+{
+	auto& frame = m_Frames[ uiSequence & ( FRAME_COUNT - 1 ) ];
+
+	ReleaseFrame( frame );
+
+	frame.uiSequence = uiSequence;
+	frame.bValid = true;
+
+	m_pCurrentFrame = &frame;
+}
+
+bool CClientSnapshots::AddEntity( const uint32_t uiEntity, const CEntityStatePool::StateIndex uiState )
+{
+	assert( m_pCurrentFrame );
+
+	if( !m_pCurrentFrame )
+		return false;
+
+	auto& entities = m_pCurrentFrame->entities;
+
+	if( !entities.empty() && entities.back().uiEntity >= uiEntity )
+		return false;
+
+	m_Pool.AddRef( uiState );
+
+	entities.push_back( { uiEntity, uiState } );
+
+	return true;
+}
+
+const CClientSnapshots::Frame_t* CClientSnapshots::GetFrame( const uint32_t uiSequence ) const
+{
+	const auto& frame = m_Frames[ uiSequence & ( FRAME_COUNT - 1 ) ];
+
+	if( !frame.bValid || frame.uiSequence != uiSequence )
+		return nullptr;
+
+	return &frame;
+}
+
+void CClientSnapshots::Acknowledge( const uint32_t uiSequence )
+{
+	//Acknowledgements can arrive out of order, only newer ones matter.
+	if( !GetFrame( uiSequence ) || ( m_bHasAcknowledged && uiSequence <= m_uiAcknowledged ) )
+		return;
+
+	m_bHasAcknowledged = true;
+	m_uiAcknowledged = uiSequence;
+
+	for( auto& frame : m_Frames )
+	{
+		if( frame.bValid && frame.uiSequence < uiSequence && &frame != m_pCurrentFrame )
+			ReleaseFrame( frame );
+	}
+}
+
+const CClientSnapshots::Frame_t* CClientSnapshots::GetBaseline() const
+{
+	if( !m_bHasAcknowledged )
+		return nullptr;
+
+	return GetFrame( m_uiAcknowledged );
+}
+
+void CClientSnapshots::Reset()
+{
+	for( auto& frame : m_Frames )
+		ReleaseFrame( frame );
+
+	m_pCurrentFrame = nullptr;
+	m_bHasAcknowledged = false;
+	m_uiAcknowledged = 0;
+}
+
+const CClientSnapshots::EntityRef_t* CClientSnapshots::FindEntity( const Frame_t& frame, const uint32_t uiEntity )
+{
+	auto it = std::lower_bound( frame.entities.begin(), frame.entities.end(), uiEntity,
+		[]( const EntityRef_t& entity, const uint32_t uiValue )
+		{
+			return entity.uiEntity < uiValue;
+		}
+	);
+
+	if( it == frame.entities.end() || it->uiEntity != uiEntity )
+		return nullptr;
+
+	return &( *it );
+}
+
+void CClientSnapshots::ReleaseFrame( Frame_t& frame )
+{
+	if( !frame.bValid )
+		return;
+
+	for( const auto& entity : frame.entities )
+		m_Pool.Release( entity.uiState );
+
+	//Keeps its capacity for the next frame in this slot.
+	frame.entities.clear();
+
+	frame.bValid = false;
+
+	if( m_pCurrentFrame == &frame )
+		m_pCurrentFrame = nullptr;
+}
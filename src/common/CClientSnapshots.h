@@ -0,0 +1,112 @@
+#ifndef COMMON_CCLIENTSNAPSHOTS_H
+#define COMMON_CCLIENTSNAPSHOTS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CEntityStatePool.h"
+
+/**
+*	The frames recently sent to a client, kept as delta baselines until the client acknowledges a newer one.
+*	Frames are stored in a fixed size ring indexed by sequence number, so the baseline for an acknowledged sequence is found in constant time.
+*	A frame is a sorted list of the entities the client was sent, each referring to a state in a CEntityStatePool shared by all clients,
+*	so memory grows with the states that changed, not with the number of clients times the number of entities.
+*	Frame entity lists keep their capacity when the ring wraps around, so nothing is allocated once the client's entity count settles.
+*/
+class CClientSnapshots final
+{
+public:
+	/**
+	*	Number of frames kept. Must be a power of 2. A client that only acknowledges frames older than this needs a full update.
+	*/
+	static const size_t FRAME_COUNT = 64;
+
+	struct EntityRef_t
+	{
+		uint32_t uiEntity;
+
+		CEntityStatePool::StateIndex uiState;
+	};
+
+	struct Frame_t
+	{
+		uint32_t uiSequence = 0;
+
+		bool bValid = false;
+
+		/**
+		*	Entities sent in the frame, sorted by entity index.
+		*/
+		std::vector<EntityRef_t> entities;
+	};
+
+public:
+	CClientSnapshots( CEntityStatePool& pool );
+	~CClientSnapshots();
+
+	/**
+	*	Starts a frame, replacing the frame FRAME_COUNT sequence numbers before it.
+	*	@param uiSequence Sequence number of the frame. Must be newer than the previous frame's.
+	*/
+	void BeginFrame( const uint32_t uiSequence );
+
+	/**
+	*	Adds an entity to the current frame, and a reference to its state.
+	*	@param uiEntity Entity index. Entities must be added in increasing order.
+	*	@param uiState State of the entity, from the shared pool.
+	*	@return Whether the entity was added.
+	*/
+	bool AddEntity( const uint32_t uiEntity, const CEntityStatePool::StateIndex uiState );
+
+	/**
+	*	@return The frame with the given sequence number, or null if it's no longer kept.
+	*/
+	const Frame_t* GetFrame( const uint32_t uiSequence ) const;
+
+	/**
+	*	Records that the client received a frame. Older frames are released, since they'll never be a baseline again.
+	*/
+	void Acknowledge( const uint32_t uiSequence );
+
+	/**
+	*	@return The most recent acknowledged frame, to delta against, or null if there is none and a full update is needed.
+	*/
+	const Frame_t* GetBaseline() const;
+
+	/**
+	*	Releases all frames, for a new connection.
+	*/
+	void Reset();
+
+	/**
+	*	@return The entity in a frame, or null if it wasn't sent in that frame.
+	*/
+	static const EntityRef_t* FindEntity( const Frame_t& frame, const uint32_t uiEntity );
+
+private:
+	/**
+	*	Releases the states of a frame and marks it as invalid.
+	*/
+	void ReleaseFrame( Frame_t& frame );
+
+private:
+	CEntityStatePool& m_Pool;
+
+	Frame_t m_Frames[ FRAME_COUNT ];
+
+	/**
+	*	Frame being built, or null.
+	*/
+	Frame_t* m_pCurrentFrame = nullptr;
+
+	bool m_bHasAcknowledged = false;
+
+	uint32_t m_uiAcknowledged = 0;
+
+private:
+	CClientSnapshots( const CClientSnapshots& ) = delete;
+	CClientSnapshots& operator=( const CClientSnapshots& ) = delete;
+};
+
+#endif //COMMON_CCLIENTSNAPSHOTS_H
@@ -0,0 +1,231 @@
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
+
+#include "Tokenization.h"
+
+#include "CCommandView.h"
+
+void CCommandView::Reset()
+{
+	m_Tokens.clear();
+
+	m_pszCommand = nullptr;
+	m_pszArguments = nullptr;
+	m_ppArgV = nullptr;
+
+	m_bMaterialized = false;
+	m_bBuiltCommandString = false;
+}
+
+bool CCommandView::Initialize( const char* pszCommand )
+{
+	assert( pszCommand );
+
+	Reset();
+
+	m_pszCommand = pszCommand;
+	m_pszArguments = "";
+
+	Token_t token;
+
+	while( 1 )
+	{
+		// skip whitespace up to a /n
+		while( *pszCommand && ( *pszCommand ) <= ' ' && *pszCommand != '\n' )
+			++pszCommand;
+
+		if( *pszCommand == '\n' )
+		{
+			// a newline seperates commands in the buffer
+			++pszCommand;
+			break;
+		}
+
+		if( !( *pszCommand ) )
+			break;
+
+		pszCommand = tokenization::ParseSpan( pszCommand, token.pszData, token.uiLength );
+		if( !pszCommand ) break;
+
+		m_Tokens.push_back( token );
+
+		if( m_Tokens.size() == 1 )
+			m_pszArguments = pszCommand;
+	}
+
+	return IsValid();
+}
+
+bool CCommandView::Initialize( const int iArgC, const char* const* ppArgV )
+{
+	assert( iArgC > 0 );
+	assert( ppArgV != nullptr );
+
+	Reset();
+
+	m_ppArgV = ppArgV;
+
+	for( int iIndex = 0; iIndex < iArgC; ++iIndex )
+	{
+		m_Tokens.push_back( Token_t{ ppArgV[ iIndex ], strlen( ppArgV[ iIndex ] ) } );
+	}
+
+	return IsValid();
+}
+
+const CCommandView::Token_t& CCommandView::GetToken( const int iIndex ) const
+{
+	assert( iIndex >= 0 && iIndex < ArgC() );
+
+	return m_Tokens[ iIndex ];
+}
+
+bool CCommandView::ArgEquals( const int iIndex, const char* const pszString ) const
+{
+	assert( pszString );
+
+	if( iIndex < 0 || iIndex >= ArgC() )
+		return false;
+
+	const Token_t& token = m_Tokens[ iIndex ];
+
+	return strncmp( token.pszData, pszString, token.uiLength ) == 0 && pszString[ token.uiLength ] == '\0';
+}
+
+const char* CCommandView::GetCommandString() const
+{
+	if( !IsValid() )
+		return "";
+
+	if( m_pszCommand )
+		return m_pszCommand;
+
+	BuildCommandString();
+
+	return m_szCommandString.c_str();
+}
+
+const char* CCommandView::GetArgumentsString() const
+{
+	if( !IsValid() )
+		return "";
+
+	if( m_pszCommand )
+		return m_pszArguments;
+
+	BuildCommandString();
+
+	return m_szCommandString.c_str() + m_uiCommandNameLength;
+}
+
+const char* const* CCommandView::ArgV() const
+{
+	if( m_ppArgV )
+		return m_ppArgV;
+
+	Materialize();
+
+	return m_ArgV.data();
+}
+
+const char* CCommandView::operator[]( const int iIndex ) const
+{
+	return Arg( iIndex );
+}
+
+const char* CCommandView::Arg( const int iIndex ) const
+{
+	if( iIndex < 0 || iIndex >= ArgC() )
+	{
+		assert( !"CCommandView::Arg: Index out of range!" );
+
+		return "";
+	}
+
+	return ArgV()[ iIndex ];
+}
+
+const char* CCommandView::FindArg( const char* pszArgument ) const
+{
+	assert( pszArgument );
+	assert( *pszArgument );
+
+	for( int iIndex = 0; iIndex < ArgC(); ++iIndex )
+	{
+		if( ArgEquals( iIndex, pszArgument ) )
+		{
+			return ( iIndex + 1 ) < ArgC() ? Arg( iIndex + 1 ) : "";
+		}
+	}
+
+	return nullptr;
+}
+
+int CCommandView::FindIntArg( const char* pszArgument, const int iDefault ) const
+{
+	const char* pszValue = FindArg( pszArgument );
+
+	if( !pszValue )
+		return iDefault;
+
+	return atoi( pszValue );
+}
+
+void CCommandView::Materialize() const
+{
+	if( m_bMaterialized )
+		return;
+
+	m_bMaterialized = true;
+
+	m_ArgsBuffer.clear();
+	m_ArgV.clear();
+
+	for( const auto& token : m_Tokens )
+	{
+		m_ArgsBuffer.insert( m_ArgsBuffer.end(), token.pszData, token.pszData + token.uiLength );
+		m_ArgsBuffer.push_back( '\0' );
+	}
+
+	//Only point into the buffer once it's done growing.
+	const char* pszArg = m_ArgsBuffer.data();
+
+	for( const auto& token : m_Tokens )
+	{
+		m_ArgV.push_back( pszArg );
+		pszArg += token.uiLength + 1;
+	}
+}
+
+void CCommandView::BuildCommandString() const
+{
+	if( m_bBuiltCommandString )
+		return;
+
+	m_bBuiltCommandString = true;
+
+	m_szCommandString.clear();
+	m_uiCommandNameLength = 0;
+
+	for( size_t uiIndex = 0; uiIndex < m_Tokens.size(); ++uiIndex )
+	{
+		const Token_t& token = m_Tokens[ uiIndex ];
+
+		const bool bContainsSpace = memchr( token.pszData, ' ', token.uiLength ) != nullptr;
+
+		if( bContainsSpace )
+			m_szCommandString += '\"';
+
+		m_szCommandString.append( token.pszData, token.uiLength );
+
+		if( bContainsSpace )
+			m_szCommandString += '\"';
+
+		if( uiIndex == 0 )
+			m_uiCommandNameLength = m_szCommandString.size();
+
+		if( uiIndex + 1 < m_Tokens.size() )
+			m_szCommandString += ' ';
+	}
+}
@@ -0,0 +1,171 @@
+#ifndef COMMON_CCOMMANDVIEW_H
+#define COMMON_CCOMMANDVIEW_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+*	Contains command arguments, like CCommand, but without copying them.
+*	Tokens are stored as spans into the source text, which must remain valid while the command is in use.
+*	Null terminated copies of the arguments are only made when they are requested.
+*	There is no limit on the number of tokens or the length of the command.
+*/
+class CCommandView final
+{
+public:
+	/**
+	*	A token in the source text. Not null terminated.
+	*/
+	struct Token_t
+	{
+		const char* pszData;
+		size_t uiLength;
+	};
+
+public:
+	/**
+	*	Default constructor. Initializes the command to an invalid state.
+	*/
+	CCommandView() = default;
+
+	/**
+	*	Resets the command. This command is invalid after the method returns.
+	*/
+	void Reset();
+
+	/**
+	*	Initializes the command by breaking up the given command into tokens. Tokenizes the same way as CCommand.
+	*	@param pszCommand Command string. Must remain valid while the command is in use.
+	*	@return Whether any tokens were found.
+	*/
+	bool Initialize( const char* pszCommand );
+
+	/**
+	*	Initializes the command with the given arguments. The arguments are not copied.
+	*	@param iArgC Argument count.
+	*	@param ppArgV Argument vector. Must remain valid while the command is in use.
+	*	@return Whether there are any arguments.
+	*/
+	bool Initialize( const int iArgC, const char* const* ppArgV );
+
+	/**
+	*	Returns whether this command is valid (has any arguments).
+	*/
+	bool IsValid() const { return !m_Tokens.empty(); }
+
+	/**
+	*	Gets the argument count.
+	*/
+	int ArgC() const { return static_cast<int>( m_Tokens.size() ); }
+
+	/**
+	*	Gets the token for the given argument. The data is not null terminated.
+	*/
+	const Token_t& GetToken( const int iIndex ) const;
+
+	/**
+	*	@return Whether the given argument is equal to pszString.
+	*/
+	bool ArgEquals( const int iIndex, const char* const pszString ) const;
+
+	/**
+	*	Gets the entire command as a string.
+	*/
+	const char* GetCommandString() const;
+
+	/**
+	*	Gets all arguments as a single string.
+	*/
+	const char* GetArgumentsString() const;
+
+	/**
+	*	Gets the argument vector. Copies the arguments the first time it's called.
+	*/
+	const char* const* ArgV() const;
+
+	/**
+	*	Gets the argument by index. Copies the arguments the first time it's called.
+	*/
+	const char* operator[]( const int iIndex ) const;
+
+	/**
+	*	@see operator[]( const int iIndex ) const
+	*/
+	const char* Arg( const int iIndex ) const;
+
+	/**
+	*	 Find a value for a given argument
+	*	 Returns nullptr if no such argument exists
+	*	 Returns an empty string if the argument exists, but no value exists for it
+	*	 Otherwise, returns the value
+	*/
+	const char* FindArg( const char* pszArgument ) const;
+
+	/**
+	*	 Find an int value for a given argument
+	*	 Returns iDefault if no such argument exists, or no value exists for it
+	*	 Otherwise, returns the value, converted to an int
+	*/
+	int FindIntArg( const char* pszArgument, const int iDefault = 0 ) const;
+
+private:
+	/**
+	*	Makes null terminated copies of all arguments.
+	*/
+	void Materialize() const;
+
+	/**
+	*	Builds the command string out of the argument vector, the same way CCommand does.
+	*/
+	void BuildCommandString() const;
+
+private:
+	std::vector<Token_t> m_Tokens;
+
+	/**
+	*	Source text, if initialized from a command string.
+	*/
+	const char* m_pszCommand = nullptr;
+
+	/**
+	*	Start of the arguments in the source text, if initialized from a command string.
+	*/
+	const char* m_pszArguments = nullptr;
+
+	/**
+	*	Argument vector, if initialized from one.
+	*/
+	const char* const* m_ppArgV = nullptr;
+
+	//Filled on demand.
+	mutable bool m_bMaterialized = false;
+
+	/**
+	*	Contains a series of null terminated strings.
+	*/
+	mutable std::vector<char> m_ArgsBuffer;
+
+	/**
+	*	Points into m_ArgsBuffer.
+	*/
+	mutable std::vector<const char*> m_ArgV;
+
+	mutable bool m_bBuiltCommandString = false;
+
+	/**
+	*	Command string built out of the argument vector, with quotes added if an argument contains spaces.
+	*/
+	mutable std::string m_szCommandString;
+
+	/**
+	*	Length of the command name in m_szCommandString, including quotes.
+	*/
+	mutable size_t m_uiCommandNameLength = 0;
+
+private:
+	CCommandView( const CCommandView& ) = delete;
+	CCommandView& operator=( const CCommandView& ) = delete;
+};
+
+#endif //COMMON_CCOMMANDVIEW_H
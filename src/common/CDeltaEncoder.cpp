@@ -0,0 +1,332 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "CNetworkBuffer.h"
+#include "Logging.h"
+
+#include "CDeltaEncoder.h"
+
+const size_t CDeltaEncoder::MAX_FIELDS;
+
+namespace
+{
+/**
+*	Number of bits used to write the size of the changed field mask, in bytes.
+*/
+const size_t MASK_SIZE_BITS = 4;
+
+/**
+*	@return Mask of the lowest uiNumBits bits.
+*/
+inline uint32_t LowBits( const size_t uiNumBits )
+{
+	return static_cast<uint32_t>( ( static_cast<uint64_t>( 1 ) << uiNumBits ) - 1 );
+}
+}
+
+bool CDeltaEncoder::Initialize( const DeltaField_t* pFields, const size_t uiNumFields )
+{
+	m_Fields.clear();
+	m_uiMaxBits = 0;
+
+	if( !pFields || uiNumFields == 0 || uiNumFields > MAX_FIELDS )
+	{
+		Warning( "CDeltaEncoder::Initialize: Tables must have between 1 and %u fields\n", static_cast<unsigned int>( MAX_FIELDS ) );
+		return false;
+	}
+
+	std::vector<Field_t> fields;
+
+	fields.reserve( uiNumFields );
+
+	size_t uiMaxBits = MASK_SIZE_BITS + ByteBit( BitByte( uiNumFields ) );
+
+	for( size_t uiIndex = 0; uiIndex < uiNumFields; ++uiIndex )
+	{
+		const auto& source = pFields[ uiIndex ];
+
+		Field_t field;
+
+		field.uiOffset = source.uiOffset;
+		field.uiSize = source.uiSize;
+		field.type = source.type;
+		field.uiNumBits = source.type == DeltaType::BITFLOAT ? 32 : source.uiNumBits;
+		field.flMultiplier = source.flMultiplier;
+		field.iMin = 0;
+		field.iMax = 0;
+
+		const bool bIsFloat = field.type == DeltaType::FLOAT || field.type == DeltaType::BITFLOAT;
+
+		if( bIsFloat ? field.uiSize != sizeof( float ) : ( field.uiSize != 1 && field.uiSize != 2 && field.uiSize != 4 ) )
+		{
+			Warning( "CDeltaEncoder::Initialize: Field \"%s\" has an invalid size\n", source.pszName );
+			return false;
+		}
+
+		if( field.uiNumBits < 1 || field.uiNumBits > 32 )
+		{
+			Warning( "CDeltaEncoder::Initialize: Field \"%s\" must have between 1 and 32 bits\n", source.pszName );
+			return false;
+		}
+
+		if( field.type == DeltaType::FLOAT )
+		{
+			if( !( field.flMultiplier > 0 ) )
+			{
+				Warning( "CDeltaEncoder::Initialize: Field \"%s\" must have a positive multiplier\n", source.pszName );
+				return false;
+			}
+
+			//Range of the sign and magnitude encoding used by WriteSignedBitLong.
+			field.iMin = static_cast<int>( -( static_cast<int64_t>( 1 ) << ( field.uiNumBits - 1 ) ) );
+			field.iMax = static_cast<int>( ( static_cast<int64_t>( 1 ) << ( field.uiNumBits - 1 ) ) - 1 );
+		}
+
+		uiMaxBits += field.uiNumBits;
+
+		fields.push_back( field );
+	}
+
+	m_Fields = std::move( fields );
+	m_uiMaxBits = uiMaxBits;
+
+	return true;
+}
+
+uint64_t CDeltaEncoder::GetChangedFields( const void* pBaseline, const void* pState ) const
+{
+	auto pBaselineBytes = reinterpret_cast<const uint8_t*>( pBaseline );
+	auto pStateBytes = reinterpret_cast<const uint8_t*>( pState );
+
+	uint64_t uiChanged = 0;
+
+	for( size_t uiIndex = 0; uiIndex < m_Fields.size(); ++uiIndex )
+	{
+		const auto& field = m_Fields[ uiIndex ];
+
+		//Cheap check first, most fields don't change between updates.
+		if( memcmp( pBaselineBytes + field.uiOffset, pStateBytes + field.uiOffset, field.uiSize ) == 0 )
+			continue;
+
+		if( GetValue( field, pBaselineBytes ) != GetValue( field, pStateBytes ) )
+			uiChanged |= static_cast<uint64_t>( 1 ) << uiIndex;
+	}
+
+	return uiChanged;
+}
+
+bool CDeltaEncoder::Encode( CNetworkBuffer& buffer, const void* pBaseline, const void* pState ) const
+{
+	const uint64_t uiChanged = GetChangedFields( pBaseline, pState );
+
+	size_t uiMaskBytes = 0;
+
+	while( uiMaskBytes < sizeof( uiChanged ) && ( uiChanged >> ByteBit( uiMaskBytes ) ) != 0 )
+		++uiMaskBytes;
+
+	auto pStateBytes = reinterpret_cast<const uint8_t*>( pState );
+
+	CNetworkBitWriter writer( buffer );
+
+	writer.WriteUnsignedBitLong( static_cast<unsigned int>( uiMaskBytes ), MASK_SIZE_BITS );
+
+	for( size_t uiByte = 0; uiByte < uiMaskBytes; ++uiByte )
+	{
+		writer.WriteUnsignedBitLong( static_cast<unsigned int>( ( uiChanged >> ByteBit( uiByte ) ) & 0xFF ), 8 );
+	}
+
+	for( uint64_t uiFields = uiChanged; uiFields; uiFields &= uiFields - 1 )
+	{
+		size_t uiIndex = 0;
+
+		while( !( uiFields & ( static_cast<uint64_t>( 1 ) << uiIndex ) ) )
+			++uiIndex;
+
+		const auto& field = m_Fields[ uiIndex ];
+
+		//Signed values are already in the sign and magnitude encoding, so this is bit-compatible with WriteSignedBitLong.
+		writer.WriteUnsignedBitLong( GetValue( field, pStateBytes ), field.uiNumBits );
+	}
+
+	writer.Flush();
+
+	return !writer.HasOverflowed();
+}
+
+bool CDeltaEncoder::Decode( CNetworkBuffer& buffer, const void* pBaseline, void* pState ) const
+{
+	auto pBaselineBytes = reinterpret_cast<const uint8_t*>( pBaseline );
+	auto pStateBytes = reinterpret_cast<uint8_t*>( pState );
+
+	CNetworkBitReader reader( buffer );
+
+	const size_t uiMaskBytes = reader.ReadUnsignedBitLong( MASK_SIZE_BITS );
+
+	if( uiMaskBytes > BitByte( m_Fields.size() ) )
+	{
+		//Malformed packets can trigger this at packet rate, so don't format on the network thread.
+		LOG_BINARY( "Warning: CDeltaEncoder::Decode: Changed field mask is too large (%u bytes)\n", uiMaskBytes );
+		return false;
+	}
+
+	uint64_t uiChanged = 0;
+
+	for( size_t uiByte = 0; uiByte < uiMaskBytes; ++uiByte )
+	{
+		uiChanged |= static_cast<uint64_t>( reader.ReadUnsignedBitLong( 8 ) ) << ByteBit( uiByte );
+	}
+
+	if( m_Fields.size() < MAX_FIELDS && ( uiChanged >> m_Fields.size() ) != 0 )
+	{
+		LOG_BINARY( "Warning: CDeltaEncoder::Decode: Changed field mask has fields that don't exist\n" );
+		return false;
+	}
+
+	for( size_t uiIndex = 0; uiIndex < m_Fields.size(); ++uiIndex )
+	{
+		const auto& field = m_Fields[ uiIndex ];
+
+		if( uiChanged & ( static_cast<uint64_t>( 1 ) << uiIndex ) )
+		{
+			SetValue( field, pStateBytes, reader.ReadUnsignedBitLong( field.uiNumBits ) );
+		}
+		else if( pStateBytes != pBaselineBytes )
+		{
+			memcpy( pStateBytes + field.uiOffset, pBaselineBytes + field.uiOffset, field.uiSize );
+		}
+	}
+
+	reader.Flush();
+
+	return !reader.HasOverflowed();
+}
+
+uint32_t CDeltaEncoder::GetValue( const Field_t& field, const uint8_t* pState )
+{
+	const uint8_t* pMember = pState + field.uiOffset;
+
+	int iValue;
+
+	switch( field.type )
+	{
+	case DeltaType::FLOAT:
+		{
+			float flValue;
+			memcpy( &flValue, pMember, sizeof( flValue ) );
+
+			const double flScaled = std::floor( static_cast<double>( flValue ) * field.flMultiplier + 0.5 );
+
+			//Out of range values are clamped, NaN ends up as the maximum.
+			iValue = flScaled < field.iMax ? ( flScaled > field.iMin ? static_cast<int>( flScaled ) : field.iMin ) : field.iMax;
+			break;
+		}
+
+	case DeltaType::BITFLOAT:
+		{
+			uint32_t uiValue;
+			memcpy( &uiValue, pMember, sizeof( uiValue ) );
+
+			return uiValue;
+		}
+
+	default:
+		{
+			uint32_t uiValue;
+
+			switch( field.uiSize )
+			{
+			case 1:
+				{
+					uint8_t value;
+					memcpy( &value, pMember, sizeof( value ) );
+
+					iValue = field.type == DeltaType::SIGNED ? static_cast<int8_t>( value ) : value;
+					break;
+				}
+
+			case 2:
+				{
+					uint16_t value;
+					memcpy( &value, pMember, sizeof( value ) );
+
+					iValue = field.type == DeltaType::SIGNED ? static_cast<int16_t>( value ) : value;
+					break;
+				}
+
+			default:
+				{
+					memcpy( &uiValue, pMember, sizeof( uiValue ) );
+
+					iValue = static_cast<int>( uiValue );
+					break;
+				}
+			}
+
+			if( field.type == DeltaType::UNSIGNED )
+				return static_cast<uint32_t>( iValue ) & LowBits( field.uiNumBits );
+
+			break;
+		}
+	}
+
+	//Sign and magnitude bits, same as WriteSignedBitLong.
+	return ( static_cast<uint32_t>( iValue ) & LowBits( field.uiNumBits - 1 ) ) | ( ( iValue < 0 ? 1U : 0U ) << ( field.uiNumBits - 1 ) );
+}
+
+void CDeltaEncoder::SetValue( const Field_t& field, uint8_t* pState, const uint32_t uiValue )
+{
+	uint8_t* pMember = pState + field.uiOffset;
+
+	if( field.type == DeltaType::BITFLOAT )
+	{
+		memcpy( pMember, &uiValue, sizeof( uiValue ) );
+		return;
+	}
+
+	int iValue;
+
+	if( field.type == DeltaType::UNSIGNED )
+	{
+		iValue = static_cast<int>( uiValue );
+	}
+	else
+	{
+		//Same as ReadSignedBitLong.
+		iValue = static_cast<int>( uiValue & LowBits( field.uiNumBits - 1 ) );
+
+		if( uiValue >> ( field.uiNumBits - 1 ) )
+			iValue = static_cast<int>( static_cast<int64_t>( iValue ) - ( static_cast<int64_t>( 1 ) << ( field.uiNumBits - 1 ) ) );
+	}
+
+	if( field.type == DeltaType::FLOAT )
+	{
+		const float flValue = static_cast<float>( static_cast<double>( iValue ) / field.flMultiplier );
+
+		memcpy( pMember, &flValue, sizeof( flValue ) );
+		return;
+	}
+
+	switch( field.uiSize )
+	{
+	case 1:
+		{
+			const auto value = static_cast<uint8_t>( iValue );
+			memcpy( pMember, &value, sizeof( value ) );
+			break;
+		}
+
+	case 2:
+		{
+			const auto value = static_cast<uint16_t>( iValue );
+			memcpy( pMember, &value, sizeof( value ) );
+			break;
+		}
+
+	default:
+		{
+			memcpy( pMember, &iValue, sizeof( iValue ) );
+			break;
+		}
+	}
+}
@@ -0,0 +1,164 @@
+#ifndef COMMON_CDELTAENCODER_H
+#define COMMON_CDELTAENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CNetworkBuffer;
+
+/**
+*	How a delta field is encoded.
+*/
+enum class DeltaType
+{
+	/**
+	*	Unsigned integer. Written with WriteUnsignedBitLong.
+	*/
+	UNSIGNED = 0,
+
+	/**
+	*	Signed integer. Written with WriteSignedBitLong.
+	*/
+	SIGNED,
+
+	/**
+	*	Float, multiplied by the field's multiplier, rounded and written as a signed integer. Clamped to the field's range.
+	*/
+	FLOAT,
+
+	/**
+	*	Float written as all 32 bits, same as WriteBitFloat.
+	*/
+	BITFLOAT
+};
+
+/**
+*	Describes a field of an entity state struct.
+*/
+struct DeltaField_t
+{
+	const char* pszName;
+
+	/**
+	*	Offset and size of the member, in bytes. Integers are 1, 2 or 4 bytes, floats 4.
+	*/
+	size_t uiOffset;
+	size_t uiSize;
+
+	DeltaType type;
+
+	/**
+	*	Number of bits written, between 1 and 32. Ignored for BITFLOAT.
+	*/
+	size_t uiNumBits;
+
+	/**
+	*	FLOAT only: values are sent in steps of 1 / multiplier.
+	*/
+	float flMultiplier;
+};
+
+/**
+*	Declares a delta field for a member of a struct.
+*/
+#define DELTA_FIELD( structType, member, type, numBits, multiplier ) \
+	{ #member, offsetof( structType, member ), sizeof( static_cast<structType*>( nullptr )->member ), type, numBits, multiplier }
+
+/**
+*	Encodes entity states as the difference against a baseline state, using a table of fields.
+*	Changed fields are found by comparing their encoded values, so float changes smaller than a step aren't sent.
+*	The encoded state is a bit mask of changed fields, prefixed by its size in bytes, followed by the changed fields in table order.
+*/
+class CDeltaEncoder final
+{
+public:
+	/**
+	*	Maximum number of fields in a table.
+	*/
+	static const size_t MAX_FIELDS = 64;
+
+public:
+	/**
+	*	Default constructor. Initializes the encoder to an invalid state.
+	*/
+	CDeltaEncoder() = default;
+
+	/**
+	*	Compiles a field table.
+	*	@param pFields Fields, in the order they are encoded in.
+	*	@param uiNumFields Number of fields. At most MAX_FIELDS.
+	*	@return Whether all fields are valid.
+	*/
+	bool Initialize( const DeltaField_t* pFields, const size_t uiNumFields );
+
+	bool IsValid() const { return !m_Fields.empty(); }
+
+	size_t GetFieldCount() const { return m_Fields.size(); }
+
+	/**
+	*	@return Largest encoded state, in bits.
+	*/
+	size_t GetMaxBits() const { return m_uiMaxBits; }
+
+	/**
+	*	Gets the bit mask of the fields that changed between two states.
+	*/
+	uint64_t GetChangedFields( const void* pBaseline, const void* pState ) const;
+
+	/**
+	*	Writes the difference between a state and its baseline to a buffer.
+	*	@return Whether the buffer didn't overflow.
+	*/
+	bool Encode( CNetworkBuffer& buffer, const void* pBaseline, const void* pState ) const;
+
+	/**
+	*	Reads a state that was written by Encode. Fields that weren't sent are copied from the baseline.
+	*	pState must not overlap pBaseline, unless they are the same.
+	*	@return Whether the buffer didn't overflow.
+	*/
+	bool Decode( CNetworkBuffer& buffer, const void* pBaseline, void* pState ) const;
+
+private:
+	/**
+	*	Compiled field.
+	*/
+	struct Field_t
+	{
+		size_t uiOffset;
+		size_t uiSize;
+
+		DeltaType type;
+
+		size_t uiNumBits;
+
+		float flMultiplier;
+
+		/**
+		*	Range of FLOAT values after quantization.
+		*/
+		int iMin;
+		int iMax;
+	};
+
+	/**
+	*	Gets the value of a field as the bits written to the buffer.
+	*/
+	static uint32_t GetValue( const Field_t& field, const uint8_t* pState );
+
+	/**
+	*	Stores a value that was read from the buffer.
+	*/
+	static void SetValue( const Field_t& field, uint8_t* pState, const uint32_t uiValue );
+
+private:
+	std::vector<Field_t> m_Fields;
+
+	size_t m_uiMaxBits = 0;
+
+private:
+	CDeltaEncoder( const CDeltaEncoder& ) = delete;
+	CDeltaEncoder& operator=( const CDeltaEncoder& ) = delete;
+};
+
+#endif //COMMON_CDELTAENCODER_H
@@ -0,0 +1,149 @@
+#include <cassert>
+#include <cstring>
+
+#include "XXHash.h"
+
+#include "CEntityStatePool.h"
+
+const CEntityStatePool::StateIndex CEntityStatePool::INVALID_INDEX;
+const size_t CEntityStatePool::CHUNK_BLOCKS;
+
+CEntityStatePool::CEntityStatePool( const size_t uiStateSize )
+	: m_uiStateSize( uiStateSize )
+	, m_uiStride( ( uiStateSize + 7 ) & ~static_cast<size_t>( 7 ) )
+{
+	assert( uiStateSize > 0 );
+}
+
+CEntityStatePool::StateIndex CEntityStatePool::Intern( const void* pState )
+{
+	const uint64_t uiHash = xxhash::Hash64( pState, m_uiStateSize );
+
+	if( !m_Table.empty() )
+	{
+		const StateIndex uiIndex = m_Table[ FindSlot( pState, uiHash ) ];
+
+		if( uiIndex != INVALID_INDEX )
+		{
+			++m_Blocks[ uiIndex ].uiRefCount;
+			return uiIndex;
+		}
+	}
+
+	//Keep the table at most half full.
+	if( ( m_uiCount + 1 ) * 2 > m_Table.size() )
+		Grow();
+
+	StateIndex uiIndex;
+
+	if( !m_FreeBlocks.empty() )
+	{
+		uiIndex = m_FreeBlocks.back();
+		m_FreeBlocks.pop_back();
+	}
+	else
+	{
+		if( m_Blocks.size() == m_Chunks.size() * CHUNK_BLOCKS )
+			m_Chunks.emplace_back( new uint8_t[ CHUNK_BLOCKS * m_uiStride ] );
+
+		uiIndex = static_cast<StateIndex>( m_Blocks.size() );
+		m_Blocks.emplace_back();
+	}
+
+	memcpy( GetData( uiIndex ), pState, m_uiStateSize );
+
+	auto& block = m_Blocks[ uiIndex ];
+
+	block.uiHash = uiHash;
+	block.uiRefCount = 1;
+
+	m_Table[ FindSlot( pState, uiHash ) ] = uiIndex;
+
+	++m_uiCount;
+
+	return uiIndex;
+}
+
+void CEntityStatePool::AddRef( const StateIndex uiIndex )
+{
+	assert( uiIndex < m_Blocks.size() && m_Blocks[ uiIndex ].uiRefCount > 0 );
+
+	++m_Blocks[ uiIndex ].uiRefCount;
+}
+
+void CEntityStatePool::Release( const StateIndex uiIndex )
+{
+	assert( uiIndex < m_Blocks.size() && m_Blocks[ uiIndex ].uiRefCount > 0 );
+
+	if( --m_Blocks[ uiIndex ].uiRefCount > 0 )
+		return;
+
+	Remove( uiIndex );
+
+	m_FreeBlocks.push_back( uiIndex );
+
+	--m_uiCount;
+}
+
+size_t CEntityStatePool::FindSlot( const void* pState, const uint64_t uiHash ) const
+{
+	const size_t uiMask = m_Table.size() - 1;
+
+	size_t uiSlot = static_cast<size_t>( uiHash ) & uiMask;
+
+	for( ; m_Table[ uiSlot ] != INVALID_INDEX; uiSlot = ( uiSlot + 1 ) & uiMask )
+	{
+		const StateIndex uiIndex = m_Table[ uiSlot ];
+
+		if( m_Blocks[ uiIndex ].uiHash == uiHash && memcmp( GetState( uiIndex ), pState, m_uiStateSize ) == 0 )
+			break;
+	}
+
+	return uiSlot;
+}
+
+void CEntityStatePool::Remove( const StateIndex uiIndex )
+{
+	const size_t uiMask = m_Table.size() - 1;
+
+	size_t uiHole = static_cast<size_t>( m_Blocks[ uiIndex ].uiHash ) & uiMask;
+
+	while( m_Table[ uiHole ] != uiIndex )
+		uiHole = ( uiHole + 1 ) & uiMask;
+
+	//Shift back the entries after it that would no longer be found past the hole, so lookups never need tombstones.
+	for( size_t uiSlot = ( uiHole + 1 ) & uiMask; m_Table[ uiSlot ] != INVALID_INDEX; uiSlot = ( uiSlot + 1 ) & uiMask )
+	{
+		const size_t uiHome = static_cast<size_t>( m_Blocks[ m_Table[ uiSlot ] ].uiHash ) & uiMask;
+
+		if( ( ( uiSlot - uiHome ) & uiMask ) >= ( ( uiSlot - uiHole ) & uiMask ) )
+		{
+			m_Table[ uiHole ] = m_Table[ uiSlot ];
+			uiHole = uiSlot;
+		}
+	}
+
+	m_Table[ uiHole ] = INVALID_INDEX;
+}
+
+void CEntityStatePool::Grow()
+{
+	std::vector<StateIndex> oldTable( m_Table.empty() ? 64 : m_Table.size() * 2, INVALID_INDEX );
+
+	oldTable.swap( m_Table );
+
+	const size_t uiMask = m_Table.size() - 1;
+
+	for( const auto uiIndex : oldTable )
+	{
+		if( uiIndex == INVALID_INDEX )
+			continue;
+
+		size_t uiSlot = static_cast<size_t>( m_Blocks[ uiIndex ].uiHash ) & uiMask;
+
+		while( m_Table[ uiSlot ] != INVALID_INDEX )
+			uiSlot = ( uiSlot + 1 ) & uiMask;
+
+		m_Table[ uiSlot ] = uiIndex;
+	}
+}
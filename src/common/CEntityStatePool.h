@@ -0,0 +1,130 @@
+#ifndef COMMON_CENTITYSTATEPOOL_H
+#define COMMON_CENTITYSTATEPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+*	Stores entity states shared by the snapshots of all clients. Each distinct state is stored once, in a reference counted block,
+*	so an entity that didn't change, or that many clients see, costs one block no matter how many snapshots refer to it.
+*	States are fixed size and compared byte for byte, so padding in state structs must be zeroed.
+*	Blocks are allocated in chunks and reused once their last reference is released.
+*	Not thread safe.
+*/
+class CEntityStatePool final
+{
+public:
+	/**
+	*	Identifies a stored state.
+	*/
+	using StateIndex = uint32_t;
+
+	/**
+	*	Index that never refers to a state.
+	*/
+	static const StateIndex INVALID_INDEX = UINT32_MAX;
+
+	/**
+	*	Number of blocks allocated at once.
+	*/
+	static const size_t CHUNK_BLOCKS = 256;
+
+public:
+	/**
+	*	@param uiStateSize Size of each state, in bytes.
+	*/
+	CEntityStatePool( const size_t uiStateSize );
+
+	size_t GetStateSize() const { return m_uiStateSize; }
+
+	/**
+	*	Stores a state, or finds the block that already stores it, and adds a reference to it.
+	*	@return Index of the state's block.
+	*/
+	StateIndex Intern( const void* pState );
+
+	/**
+	*	Adds a reference to a state.
+	*/
+	void AddRef( const StateIndex uiIndex );
+
+	/**
+	*	Releases a reference to a state. The block is freed once the last reference is released.
+	*/
+	void Release( const StateIndex uiIndex );
+
+	/**
+	*	@return The state stored in a block.
+	*/
+	const void* GetState( const StateIndex uiIndex ) const
+	{
+		return m_Chunks[ uiIndex / CHUNK_BLOCKS ].get() + ( uiIndex % CHUNK_BLOCKS ) * m_uiStride;
+	}
+
+	/**
+	*	@return Number of states stored.
+	*/
+	size_t GetCount() const { return m_uiCount; }
+
+	/**
+	*	@return Number of bytes allocated for states.
+	*/
+	size_t GetMemoryUsage() const { return m_Chunks.size() * CHUNK_BLOCKS * m_uiStride; }
+
+private:
+	struct Block_t
+	{
+		uint64_t uiHash = 0;
+
+		uint32_t uiRefCount = 0;
+	};
+
+	/**
+	*	@return The table slot that refers to the state, or the empty slot where it belongs.
+	*/
+	size_t FindSlot( const void* pState, const uint64_t uiHash ) const;
+
+	/**
+	*	Removes a block from the table.
+	*/
+	void Remove( const StateIndex uiIndex );
+
+	/**
+	*	Doubles the size of the table.
+	*/
+	void Grow();
+
+	uint8_t* GetData( const StateIndex uiIndex )
+	{
+		return m_Chunks[ uiIndex / CHUNK_BLOCKS ].get() + ( uiIndex % CHUNK_BLOCKS ) * m_uiStride;
+	}
+
+private:
+	const size_t m_uiStateSize;
+
+	/**
+	*	Distance between blocks, in bytes. States are aligned to 8 bytes.
+	*/
+	const size_t m_uiStride;
+
+	std::vector<std::unique_ptr<uint8_t[]>> m_Chunks;
+
+	std::vector<Block_t> m_Blocks;
+
+	std::vector<StateIndex> m_FreeBlocks;
+
+	/**
+	*	Open addressing table of the stored states' indices. Size is a power of 2.
+	*/
+	std::vector<StateIndex> m_Table;
+
+	size_t m_uiCount = 0;
+
+private:
+	CEntityStatePool( const CEntityStatePool& ) = delete;
+	CEntityStatePool& operator=( const CEntityStatePool& ) = delete;
+};
+
+#endif //COMMON_CENTITYSTATEPOOL_H
@@ -100,6 +100,16 @@ public:
 	*/
 	char* ReadLine( char* pOutput, int maxChars );
 
+	/**
+	*	@see IFileSystem::GetReadBuffer
+	*/
+	void* GetReadBuffer( int* pOutBufferSize, bool bFailIfNotInCache = false );
+
+	/**
+	*	@see IFileSystem::ReleaseReadBuffer
+	*/
+	void ReleaseReadBuffer( void* pReadBuffer );
+
 private:
 	FileHandle_t m_hFile = FILESYSTEM_INVALID_HANDLE;
 
@@ -218,4 +228,18 @@ inline char* CFile::ReadLine( char* pOutput, int maxChars )
 	return g_pFileSystem->ReadLine( pOutput, maxChars, m_hFile );
 }
 
+inline void* CFile::GetReadBuffer( int* pOutBufferSize, bool bFailIfNotInCache )
+{
+	ASSERT( IsOpen() );
+
+	return g_pFileSystem->GetReadBuffer( m_hFile, pOutBufferSize, bFailIfNotInCache );
+}
+
+inline void CFile::ReleaseReadBuffer( void* pReadBuffer )
+{
+	ASSERT( IsOpen() );
+
+	g_pFileSystem->ReleaseReadBuffer( m_hFile, pReadBuffer );
+}
+
 #endif //COMMON_CFILE_H
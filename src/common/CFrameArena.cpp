@@ -0,0 +1,137 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "CFrameArena.h"
+
+const size_t CFrameArena::INITIAL_SIZE;
+const size_t CFrameArena::MAX_SIZE;
+
+void* CFrameArena::Allocate( const size_t uiSize, const size_t uiAlignment )
+{
+	assert( uiAlignment > 0 && ( uiAlignment & ( uiAlignment - 1 ) ) == 0 );
+	assert( uiAlignment <= alignof( std::max_align_t ) );
+
+	auto& buffer = m_Buffers[ m_uiCurrent ];
+
+	if( !buffer.data.GetData() )
+	{
+		//Rounding up to the large page size makes the whole of it usable.
+		if( !buffer.data.Allocate( std::max( buffer.uiSize, INITIAL_SIZE ), m_bLargePages ) )
+			throw std::bad_alloc();
+
+		buffer.uiSize = buffer.data.GetSize();
+	}
+
+	const uintptr_t base = reinterpret_cast<uintptr_t>( buffer.data.GetData() );
+	const size_t uiOffset = ( ( base + buffer.uiUsed + uiAlignment - 1 ) & ~( uiAlignment - 1 ) ) - base;
+
+	//Zero sized allocations still get a unique address.
+	const size_t uiAllocSize = std::max<size_t>( uiSize, 1 );
+
+	if( uiOffset <= buffer.uiSize && uiAllocSize <= buffer.uiSize - uiOffset )
+	{
+		buffer.uiUsed = uiOffset + uiAllocSize;
+
+		m_uiPeakBytes = std::max( m_uiPeakBytes, buffer.uiUsed + buffer.uiHeapBytes );
+
+		return buffer.data.GetData() + uiOffset;
+	}
+
+	//Doesn't fit. The buffer grows to fit this the next time it's reset.
+	const size_t uiBlocks = ( uiAllocSize + sizeof( std::max_align_t ) - 1 ) / sizeof( std::max_align_t );
+
+	buffer.heapAllocations.emplace_back( new std::max_align_t[ uiBlocks ] );
+	buffer.uiHeapBytes += uiAllocSize;
+
+	++m_uiHeapAllocations;
+
+	m_uiPeakBytes = std::max( m_uiPeakBytes, buffer.uiUsed + buffer.uiHeapBytes );
+
+	return buffer.heapAllocations.back().get();
+}
+
+const char* CFrameArena::CopyString( const char* const pszString )
+{
+	if( !pszString )
+		return nullptr;
+
+	return CopyString( pszString, strlen( pszString ) );
+}
+
+const char* CFrameArena::CopyString( const char* const pszString, const size_t uiLength )
+{
+	auto pszCopy = AllocateArray<char>( uiLength + 1 );
+
+	memcpy( pszCopy, pszString, uiLength );
+	pszCopy[ uiLength ] = '\0';
+
+	return pszCopy;
+}
+
+void CFrameArena::EndFrame()
+{
+	m_uiCurrent = ( m_uiCurrent + 1 ) % 2;
+
+	//This buffer was used two frames ago, nothing it holds is used anymore.
+	ResetBuffer( m_Buffers[ m_uiCurrent ] );
+
+	++m_uiFrames;
+}
+
+void CFrameArena::Clear()
+{
+	for( auto& buffer : m_Buffers )
+	{
+		buffer = Buffer_t();
+	}
+
+	m_uiCurrent = 0;
+}
+
+void CFrameArena::GetStats( Stats_t& stats ) const
+{
+	const auto& buffer = m_Buffers[ m_uiCurrent ];
+
+	stats.uiUsedBytes = buffer.uiUsed + buffer.uiHeapBytes;
+	stats.uiPeakBytes = m_uiPeakBytes;
+	stats.uiCapacityBytes = m_Buffers[ 0 ].data.GetSize() + m_Buffers[ 1 ].data.GetSize();
+	stats.uiHeapAllocations = m_uiHeapAllocations;
+	stats.uiFrames = m_uiFrames;
+	//A buffer that is due to grow has no memory until it's used again.
+	stats.backing = std::max( m_Buffers[ 0 ].data.GetBacking(), m_Buffers[ 1 ].data.GetBacking() );
+}
+
+void CFrameArena::ResetStats()
+{
+	m_uiPeakBytes = 0;
+	m_uiHeapAllocations = 0;
+}
+
+void CFrameArena::ResetBuffer( Buffer_t& buffer )
+{
+	if( buffer.uiHeapBytes > 0 )
+	{
+		//Grow by at least half so a frame that keeps growing doesn't reallocate every time.
+		const size_t uiNeeded = buffer.uiUsed + buffer.uiHeapBytes;
+		const size_t uiSize = std::min( MAX_SIZE, std::max( uiNeeded, buffer.uiSize + buffer.uiSize / 2 ) );
+
+		if( uiSize > buffer.uiSize )
+		{
+			buffer.data.Free();
+			buffer.uiSize = uiSize;
+		}
+
+		buffer.heapAllocations.clear();
+		buffer.uiHeapBytes = 0;
+	}
+
+	buffer.uiUsed = 0;
+}
+
+CFrameArena& GetFrameArena()
+{
+	static CFrameArena arena;
+
+	return arena;
+}
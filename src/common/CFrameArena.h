@@ -0,0 +1,219 @@
+#ifndef COMMON_CFRAMEARENA_H
+#define COMMON_CFRAMEARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "CLargePageBuffer.h"
+
+/**
+*	Bump allocator for data that only lives for a frame or two, so short-lived allocations are a pointer increment and don't fragment the heap.
+*	There are two buffers: allocations come from the current one, and EndFrame switches to the other one after resetting it.
+*	Allocations therefore remain valid until the end of the next frame, so data built in one frame can be consumed in the next.
+*	Nothing is freed individually. Allocations that don't fit come from the heap and are freed when their buffer is reset,
+*	which grows the buffer so the next time it's used they fit.
+*	The buffers can be backed by large pages, which rounds them up to the large page size.
+*	Must only be used on the main thread.
+*/
+class CFrameArena final
+{
+public:
+	/**
+	*	Initial size of each buffer.
+	*/
+	static const size_t INITIAL_SIZE = 256 * 1024;
+
+	/**
+	*	Buffers don't grow beyond this size. Frames that need more keep using heap allocations for the rest.
+	*/
+	static const size_t MAX_SIZE = 16 * 1024 * 1024;
+
+	struct Stats_t
+	{
+		/**
+		*	Bytes allocated in the current frame, including heap allocations.
+		*/
+		size_t uiUsedBytes = 0;
+
+		/**
+		*	Most bytes allocated in a frame.
+		*/
+		size_t uiPeakBytes = 0;
+
+		/**
+		*	Total size of both buffers.
+		*/
+		size_t uiCapacityBytes = 0;
+
+		/**
+		*	Allocations that didn't fit in a buffer, since the stats were last reset.
+		*/
+		size_t uiHeapAllocations = 0;
+
+		uint64_t uiFrames = 0;
+
+		PageBacking backing = PageBacking::NORMAL;
+	};
+
+public:
+	CFrameArena() = default;
+
+	bool IsUsingLargePages() const { return m_bLargePages; }
+
+	/**
+	*	Sets whether the buffers are backed by large pages. Takes effect when a buffer is next allocated, which happens when it grows.
+	*	Call Clear afterwards to apply it to the current buffers.
+	*/
+	void SetLargePages( const bool bLargePages )
+	{
+		m_bLargePages = bLargePages;
+	}
+
+	/**
+	*	Allocates memory that remains valid until the end of the next frame. Never returns null.
+	*	@param uiAlignment Alignment of the memory. Must be a power of 2.
+	*/
+	void* Allocate( const size_t uiSize, const size_t uiAlignment = alignof( std::max_align_t ) );
+
+	/**
+	*	Allocates an uninitialized array of objects.
+	*/
+	template<typename T>
+	T* AllocateArray( const size_t uiCount )
+	{
+		return static_cast<T*>( Allocate( uiCount * sizeof( T ), alignof( T ) ) );
+	}
+
+	/**
+	*	Copies a string into the arena.
+	*	@param pszString String to copy. May be null.
+	*	@return The copy, or null if pszString is null.
+	*/
+	const char* CopyString( const char* const pszString );
+
+	/**
+	*	Copies a string into the arena.
+	*	@param pszString String to copy. Doesn't have to be null terminated.
+	*	@return The copy, which is null terminated.
+	*/
+	const char* CopyString( const char* const pszString, const size_t uiLength );
+
+	/**
+	*	Ends the frame, and frees everything that was allocated in the frame before it.
+	*/
+	void EndFrame();
+
+	/**
+	*	Frees all buffers.
+	*/
+	void Clear();
+
+	void GetStats( Stats_t& stats ) const;
+
+	/**
+	*	Resets the peak and heap allocation counts.
+	*/
+	void ResetStats();
+
+private:
+	struct Buffer_t
+	{
+		CLargePageBuffer data;
+
+		size_t uiSize = 0;
+		size_t uiUsed = 0;
+
+		/**
+		*	Allocations that didn't fit.
+		*/
+		std::vector<std::unique_ptr<std::max_align_t[]>> heapAllocations;
+		size_t uiHeapBytes = 0;
+	};
+
+private:
+	/**
+	*	Frees a buffer's allocations, and grows it if it overflowed.
+	*/
+	void ResetBuffer( Buffer_t& buffer );
+
+private:
+	Buffer_t m_Buffers[ 2 ];
+
+	size_t m_uiCurrent = 0;
+
+	size_t m_uiPeakBytes = 0;
+	size_t m_uiHeapAllocations = 0;
+
+	uint64_t m_uiFrames = 0;
+
+	bool m_bLargePages = false;
+
+private:
+	CFrameArena( const CFrameArena& ) = delete;
+	CFrameArena& operator=( const CFrameArena& ) = delete;
+};
+
+/**
+*	@return The frame arena shared by this module.
+*/
+CFrameArena& GetFrameArena();
+
+/**
+*	Allocator for standard containers that allocates from a frame arena. Deallocation does nothing.
+*	Containers using it must not outlive the next frame, and shouldn't be grown over and over since old storage isn't reused.
+*/
+template<typename T>
+class CFrameAllocator
+{
+public:
+	using value_type = T;
+
+	template<typename U>
+	friend class CFrameAllocator;
+
+public:
+	CFrameAllocator()
+		: m_pArena( &GetFrameArena() )
+	{
+	}
+
+	explicit CFrameAllocator( CFrameArena& arena )
+		: m_pArena( &arena )
+	{
+	}
+
+	template<typename U>
+	CFrameAllocator( const CFrameAllocator<U>& other )
+		: m_pArena( other.m_pArena )
+	{
+	}
+
+	T* allocate( const size_t uiCount )
+	{
+		return m_pArena->AllocateArray<T>( uiCount );
+	}
+
+	void deallocate( T*, const size_t )
+	{
+	}
+
+	template<typename U>
+	bool operator==( const CFrameAllocator<U>& other ) const { return m_pArena == other.m_pArena; }
+
+	template<typename U>
+	bool operator!=( const CFrameAllocator<U>& other ) const { return m_pArena != other.m_pArena; }
+
+private:
+	CFrameArena* m_pArena;
+};
+
+/**
+*	Vector whose storage is allocated from the frame arena.
+*/
+template<typename T>
+using FrameVector_t = std::vector<T, CFrameAllocator<T>>;
+
+#endif //COMMON_CFRAMEARENA_H
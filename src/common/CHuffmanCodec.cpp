@@ -0,0 +1,253 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <vector>
+
+#include "CNetworkBuffer.h"
+
+#include "CHuffmanCodec.h"
+
+const size_t CHuffmanCodec::NUM_SYMBOLS;
+const size_t CHuffmanCodec::MAX_CODE_LENGTH;
+
+void CHuffmanCodec::Initialize( const uint32_t* pFrequencies )
+{
+	//Every symbol can be encoded, unseen ones just get long codes.
+	uint64_t weights[ NUM_SYMBOLS ];
+
+	for( size_t uiSymbol = 0; uiSymbol < NUM_SYMBOLS; ++uiSymbol )
+	{
+		weights[ uiSymbol ] = std::max<uint64_t>( pFrequencies[ uiSymbol ], 1 );
+	}
+
+	//Build the tree. Leaves are nodes 0 to NUM_SYMBOLS - 1, the rest are internal nodes.
+	typedef std::pair<uint64_t, size_t> Node_t;
+
+	std::priority_queue<Node_t, std::vector<Node_t>, std::greater<Node_t>> queue;
+
+	for( size_t uiSymbol = 0; uiSymbol < NUM_SYMBOLS; ++uiSymbol )
+	{
+		queue.emplace( weights[ uiSymbol ], uiSymbol );
+	}
+
+	size_t parents[ NUM_SYMBOLS * 2 ];
+
+	size_t uiNextNode = NUM_SYMBOLS;
+
+	while( queue.size() > 1 )
+	{
+		const auto first = queue.top();
+		queue.pop();
+		const auto second = queue.top();
+		queue.pop();
+
+		parents[ first.second ] = uiNextNode;
+		parents[ second.second ] = uiNextNode;
+
+		queue.emplace( first.first + second.first, uiNextNode++ );
+	}
+
+	const size_t uiRoot = uiNextNode - 1;
+
+	size_t lengths[ NUM_SYMBOLS ];
+
+	for( size_t uiSymbol = 0; uiSymbol < NUM_SYMBOLS; ++uiSymbol )
+	{
+		size_t uiLength = 0;
+
+		for( size_t uiNode = uiSymbol; uiNode != uiRoot; uiNode = parents[ uiNode ] )
+			++uiLength;
+
+		lengths[ uiSymbol ] = uiLength;
+	}
+
+	//Limit the code lengths. The Kraft sum is counted in units of the longest code, a complete code sums to 1 << MAX_CODE_LENGTH.
+	size_t byFrequency[ NUM_SYMBOLS ];
+
+	for( size_t uiSymbol = 0; uiSymbol < NUM_SYMBOLS; ++uiSymbol )
+	{
+		byFrequency[ uiSymbol ] = uiSymbol;
+	}
+
+	std::stable_sort( byFrequency, byFrequency + NUM_SYMBOLS, [ & ]( size_t lhs, size_t rhs )
+	{
+		return weights[ lhs ] < weights[ rhs ];
+	} );
+
+	const size_t uiKraftLimit = static_cast<size_t>( 1 ) << MAX_CODE_LENGTH;
+
+	size_t uiKraft = 0;
+
+	for( auto& uiLength : lengths )
+	{
+		uiLength = std::min( uiLength, MAX_CODE_LENGTH );
+
+		uiKraft += uiKraftLimit >> uiLength;
+	}
+
+	//Lengthen the least frequent codes until the code fits again.
+	while( uiKraft > uiKraftLimit )
+	{
+		for( const auto uiSymbol : byFrequency )
+		{
+			if( lengths[ uiSymbol ] < MAX_CODE_LENGTH )
+			{
+				++lengths[ uiSymbol ];
+				uiKraft -= uiKraftLimit >> lengths[ uiSymbol ];
+				break;
+			}
+		}
+	}
+
+	//Then shorten the most frequent codes where there is room left.
+	for( auto it = std::rbegin( byFrequency ); it != std::rend( byFrequency ); ++it )
+	{
+		while( lengths[ *it ] > 1 && uiKraft + ( uiKraftLimit >> lengths[ *it ] ) <= uiKraftLimit )
+		{
+			uiKraft += uiKraftLimit >> lengths[ *it ];
+			--lengths[ *it ];
+		}
+	}
+
+	for( size_t uiSymbol = 0; uiSymbol < NUM_SYMBOLS; ++uiSymbol )
+	{
+		m_Lengths[ uiSymbol ] = static_cast<uint8_t>( lengths[ uiSymbol ] );
+	}
+
+	BuildCodes();
+}
+
+bool CHuffmanCodec::InitializeFromLengths( const uint8_t* pLengths )
+{
+	memcpy( m_Lengths, pLengths, sizeof( m_Lengths ) );
+
+	return BuildCodes();
+}
+
+size_t CHuffmanCodec::GetEncodedBits( const void* pData, const size_t uiSize ) const
+{
+	auto pBytes = reinterpret_cast<const uint8_t*>( pData );
+
+	size_t uiBits = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiSize; ++uiIndex )
+	{
+		uiBits += m_Lengths[ pBytes[ uiIndex ] ];
+	}
+
+	return uiBits;
+}
+
+bool CHuffmanCodec::Encode( CNetworkBuffer& buffer, const void* pData, const size_t uiSize ) const
+{
+	assert( m_bValid );
+
+	auto pBytes = reinterpret_cast<const uint8_t*>( pData );
+
+	CNetworkBitWriter writer( buffer );
+
+	for( size_t uiIndex = 0; uiIndex < uiSize; ++uiIndex )
+	{
+		writer.WriteUnsignedBitLong( m_Codes[ pBytes[ uiIndex ] ], m_Lengths[ pBytes[ uiIndex ] ] );
+	}
+
+	writer.Flush();
+
+	return !writer.HasOverflowed();
+}
+
+bool CHuffmanCodec::Decode( CNetworkBuffer& buffer, void* pBuffer, const size_t uiSize ) const
+{
+	assert( m_bValid );
+
+	auto pBytes = reinterpret_cast<uint8_t*>( pBuffer );
+
+	CNetworkBitReader reader( buffer );
+
+	for( size_t uiIndex = 0; uiIndex < uiSize; ++uiIndex )
+	{
+		const uint16_t entry = m_DecodeTable[ reader.PeekUnsignedBits( MAX_CODE_LENGTH ) ];
+
+		//Bits that aren't a code can only come from corrupt data, or reading past the end.
+		if( !( entry >> 8 ) || !reader.SkipBits( entry >> 8 ) )
+			return false;
+
+		pBytes[ uiIndex ] = static_cast<uint8_t>( entry );
+	}
+
+	reader.Flush();
+
+	return !reader.HasOverflowed();
+}
+
+bool CHuffmanCodec::BuildCodes()
+{
+	m_bValid = false;
+
+	memset( m_Codes, 0, sizeof( m_Codes ) );
+	memset( m_DecodeTable, 0, sizeof( m_DecodeTable ) );
+
+	const size_t uiKraftLimit = static_cast<size_t>( 1 ) << MAX_CODE_LENGTH;
+
+	size_t uiKraft = 0;
+
+	for( const auto length : m_Lengths )
+	{
+		if( length < 1 || length > MAX_CODE_LENGTH )
+			return false;
+
+		uiKraft += uiKraftLimit >> length;
+	}
+
+	if( uiKraft > uiKraftLimit )
+		return false;
+
+	//Canonical codes: shorter codes first, then in symbol order.
+	size_t symbols[ NUM_SYMBOLS ];
+
+	for( size_t uiSymbol = 0; uiSymbol < NUM_SYMBOLS; ++uiSymbol )
+	{
+		symbols[ uiSymbol ] = uiSymbol;
+	}
+
+	std::stable_sort( symbols, symbols + NUM_SYMBOLS, [ this ]( size_t lhs, size_t rhs )
+	{
+		return m_Lengths[ lhs ] < m_Lengths[ rhs ];
+	} );
+
+	uint32_t uiCode = 0;
+	size_t uiPreviousLength = m_Lengths[ symbols[ 0 ] ];
+
+	for( const auto uiSymbol : symbols )
+	{
+		const size_t uiLength = m_Lengths[ uiSymbol ];
+
+		uiCode <<= uiLength - uiPreviousLength;
+		uiPreviousLength = uiLength;
+
+		//The bit writer writes the lowest bit first, so the first bit of the code goes there.
+		uint32_t uiReversed = 0;
+
+		for( size_t uiBit = 0; uiBit < uiLength; ++uiBit )
+		{
+			uiReversed |= ( ( uiCode >> uiBit ) & 1 ) << ( uiLength - 1 - uiBit );
+		}
+
+		m_Codes[ uiSymbol ] = static_cast<uint16_t>( uiReversed );
+
+		//Every value of the bits that follow the code decodes to this symbol.
+		for( size_t uiFill = uiReversed; uiFill < uiKraftLimit; uiFill += static_cast<size_t>( 1 ) << uiLength )
+		{
+			m_DecodeTable[ uiFill ] = static_cast<uint16_t>( ( uiLength << 8 ) | uiSymbol );
+		}
+
+		++uiCode;
+	}
+
+	m_bValid = true;
+
+	return true;
+}
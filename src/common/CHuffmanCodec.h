@@ -0,0 +1,93 @@
+#ifndef COMMON_CHUFFMANCODEC_H
+#define COMMON_CHUFFMANCODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+class CNetworkBuffer;
+
+/**
+*	Static Huffman coding of byte streams, with canonical codes built from symbol frequencies.
+*	Tables are trained offline from captured traffic with Initialize, and shipped as their code lengths (GetCodeLengths).
+*	Every byte value gets a code, even ones that weren't seen while training.
+*	Codes are limited to MAX_CODE_LENGTH bits, so decoding is a single table lookup per symbol.
+*/
+class CHuffmanCodec final
+{
+public:
+	static const size_t NUM_SYMBOLS = 256;
+
+	/**
+	*	Maximum length of a code, in bits. Also the number of bits looked up at once while decoding.
+	*/
+	static const size_t MAX_CODE_LENGTH = 12;
+
+public:
+	/**
+	*	Default constructor. Initializes the codec to an invalid state.
+	*/
+	CHuffmanCodec() = default;
+
+	/**
+	*	Builds the codes from symbol frequencies.
+	*	@param pFrequencies Number of times each byte value occurs, NUM_SYMBOLS entries.
+	*/
+	void Initialize( const uint32_t* pFrequencies );
+
+	/**
+	*	Builds the codes from code lengths that were returned by GetCodeLengths.
+	*	@param pLengths Length of the code for each byte value, NUM_SYMBOLS entries.
+	*	@return Whether the lengths describe a complete code.
+	*/
+	bool InitializeFromLengths( const uint8_t* pLengths );
+
+	bool IsValid() const { return m_bValid; }
+
+	/**
+	*	@return Length of the code of each byte value, NUM_SYMBOLS entries.
+	*/
+	const uint8_t* GetCodeLengths() const { return m_Lengths; }
+
+	/**
+	*	@return Number of bits that encoding the given data takes.
+	*/
+	size_t GetEncodedBits( const void* pData, const size_t uiSize ) const;
+
+	/**
+	*	Writes data to a buffer. The size is not written, the reader must know it.
+	*	@return Whether the buffer didn't overflow.
+	*/
+	bool Encode( CNetworkBuffer& buffer, const void* pData, const size_t uiSize ) const;
+
+	/**
+	*	Reads data that was written by Encode.
+	*	@param pBuffer Destination. Must be at least uiSize bytes.
+	*	@param uiSize Number of bytes to read.
+	*	@return Whether the buffer didn't overflow.
+	*/
+	bool Decode( CNetworkBuffer& buffer, void* pBuffer, const size_t uiSize ) const;
+
+private:
+	/**
+	*	Assigns canonical codes for the current lengths and builds the decode table.
+	*	@return Whether the lengths describe a complete code.
+	*/
+	bool BuildCodes();
+
+private:
+	bool m_bValid = false;
+
+	uint8_t m_Lengths[ NUM_SYMBOLS ] = {};
+
+	/**
+	*	Code of each symbol, with the first bit in the lowest bit, as written by the bit writer.
+	*/
+	uint16_t m_Codes[ NUM_SYMBOLS ] = {};
+
+	/**
+	*	Symbol and code length for each value of the next MAX_CODE_LENGTH bits, symbol in the low byte.
+	*/
+	uint16_t m_DecodeTable[ 1 << MAX_CODE_LENGTH ] = {};
+};
+
+#endif //COMMON_CHUFFMANCODEC_H
@@ -0,0 +1,440 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "CPUFeatures.h"
+#include "CVisibilityCache.h"
+
+#include "CInterestSets.h"
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <immintrin.h>
+
+#define INTERESTSETS_SSE2
+#define INTERESTSETS_TARGET_SSE2
+#define INTERESTSETS_TARGET_AVX2
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <immintrin.h>
+
+#define INTERESTSETS_SSE2
+//Only the vector functions are compiled for SSE2 and AVX2, so the rest runs on any CPU.
+#define INTERESTSETS_TARGET_SSE2 __attribute__( ( target( "sse2" ) ) )
+#define INTERESTSETS_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#endif
+
+static_assert( CInterestSets::ROW_ALIGNMENT_WORDS == CVisibilityCache::ROW_ALIGNMENT_WORDS, "Rows must have the same layout" );
+
+const size_t CInterestSets::WORD_BITS;
+const size_t CInterestSets::ROW_ALIGNMENT_WORDS;
+const size_t CInterestSets::MAX_ENTITY_LEAFS;
+
+namespace
+{
+using Word_t = CInterestSets::Word_t;
+
+/**
+*	Stores pA & pB in pDest, for uiWords words. uiWords is a multiple of ROW_ALIGNMENT_WORDS.
+*	Returns whether any bit is set in the result.
+*/
+typedef bool ( *AndFunction_t )( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords );
+
+/**
+*	ORs pSource into pDest, for uiWords words. uiWords is a multiple of ROW_ALIGNMENT_WORDS.
+*/
+typedef void ( *OrFunction_t )( Word_t* pDest, const Word_t* pSource, const size_t uiWords );
+
+bool AndScalar( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords )
+{
+	Word_t any = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiWords; ++uiIndex )
+	{
+		pDest[ uiIndex ] = pA[ uiIndex ] & pB[ uiIndex ];
+		any |= pDest[ uiIndex ];
+	}
+
+	return any != 0;
+}
+
+void OrScalar( Word_t* pDest, const Word_t* pSource, const size_t uiWords )
+{
+	for( size_t uiIndex = 0; uiIndex < uiWords; ++uiIndex )
+	{
+		pDest[ uiIndex ] |= pSource[ uiIndex ];
+	}
+}
+
+#ifdef INTERESTSETS_SSE2
+INTERESTSETS_TARGET_SSE2 bool AndSSE2( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords )
+{
+	__m128i any = _mm_setzero_si128();
+
+	for( size_t uiIndex = 0; uiIndex < uiWords; uiIndex += 2 )
+	{
+		const __m128i result = _mm_and_si128(
+			_mm_loadu_si128( reinterpret_cast<const __m128i*>( pA + uiIndex ) ),
+			_mm_loadu_si128( reinterpret_cast<const __m128i*>( pB + uiIndex ) ) );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + uiIndex ), result );
+
+		any = _mm_or_si128( any, result );
+	}
+
+	return _mm_movemask_epi8( _mm_cmpeq_epi8( any, _mm_setzero_si128() ) ) != 0xFFFF;
+}
+
+INTERESTSETS_TARGET_SSE2 void OrSSE2( Word_t* pDest, const Word_t* pSource, const size_t uiWords )
+{
+	for( size_t uiIndex = 0; uiIndex < uiWords; uiIndex += 2 )
+	{
+		const __m128i result = _mm_or_si128(
+			_mm_loadu_si128( reinterpret_cast<const __m128i*>( pDest + uiIndex ) ),
+			_mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + uiIndex ) ) );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + uiIndex ), result );
+	}
+}
+
+INTERESTSETS_TARGET_AVX2 bool AndAVX2( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords )
+{
+	__m256i any = _mm256_setzero_si256();
+
+	for( size_t uiIndex = 0; uiIndex < uiWords; uiIndex += 4 )
+	{
+		const __m256i result = _mm256_and_si256(
+			_mm256_loadu_si256( reinterpret_cast<const __m256i*>( pA + uiIndex ) ),
+			_mm256_loadu_si256( reinterpret_cast<const __m256i*>( pB + uiIndex ) ) );
+
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + uiIndex ), result );
+
+		any = _mm256_or_si256( any, result );
+	}
+
+	return !_mm256_testz_si256( any, any );
+}
+
+INTERESTSETS_TARGET_AVX2 void OrAVX2( Word_t* pDest, const Word_t* pSource, const size_t uiWords )
+{
+	for( size_t uiIndex = 0; uiIndex < uiWords; uiIndex += 4 )
+	{
+		const __m256i result = _mm256_or_si256(
+			_mm256_loadu_si256( reinterpret_cast<const __m256i*>( pDest + uiIndex ) ),
+			_mm256_loadu_si256( reinterpret_cast<const __m256i*>( pSource + uiIndex ) ) );
+
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + uiIndex ), result );
+	}
+}
+#endif
+
+AndFunction_t GetAnd()
+{
+	static const CPUKernel_t<AndFunction_t> KERNELS[] =
+	{
+#ifdef INTERESTSETS_SSE2
+		{ CPUFeature::AVX2 | CPUFeature::SSE2, &AndAVX2 },
+		{ CPUFeature::SSE2, &AndSSE2 },
+#endif
+		{ CPUFeature::NONE, &AndScalar }
+	};
+
+	static const AndFunction_t pAnd = Plat_SelectKernel( KERNELS );
+
+	return pAnd;
+}
+
+OrFunction_t GetOr()
+{
+	static const CPUKernel_t<OrFunction_t> KERNELS[] =
+	{
+#ifdef INTERESTSETS_SSE2
+		{ CPUFeature::AVX2 | CPUFeature::SSE2, &OrAVX2 },
+		{ CPUFeature::SSE2, &OrSSE2 },
+#endif
+		{ CPUFeature::NONE, &OrScalar }
+	};
+
+	static const OrFunction_t pOr = Plat_SelectKernel( KERNELS );
+
+	return pOr;
+}
+
+inline unsigned int FindLowestBit( const uint64_t uiMask )
+{
+#ifdef _MSC_VER
+	unsigned long uiIndex;
+
+	//Not _BitScanForward64, which 32 bit builds don't have.
+	if( _BitScanForward( &uiIndex, static_cast<unsigned long>( uiMask ) ) )
+		return static_cast<unsigned int>( uiIndex );
+
+	_BitScanForward( &uiIndex, static_cast<unsigned long>( uiMask >> 32 ) );
+
+	return static_cast<unsigned int>( uiIndex ) + 32;
+#else
+	return static_cast<unsigned int>( __builtin_ctzll( uiMask ) );
+#endif
+}
+
+/**
+*	@return Number of words needed for uiBits bits, padded to ROW_ALIGNMENT_WORDS.
+*/
+size_t GetWordCount( const size_t uiBits )
+{
+	const size_t uiWords = ( uiBits + CInterestSets::WORD_BITS - 1 ) / CInterestSets::WORD_BITS;
+
+	return ( uiWords + CInterestSets::ROW_ALIGNMENT_WORDS - 1 ) / CInterestSets::ROW_ALIGNMENT_WORDS * CInterestSets::ROW_ALIGNMENT_WORDS;
+}
+
+inline void SetBit( Word_t* pBits, const size_t uiBit )
+{
+	pBits[ uiBit / CInterestSets::WORD_BITS ] |= Word_t( 1 ) << ( uiBit % CInterestSets::WORD_BITS );
+}
+}
+
+void CInterestSets::Reset( const size_t uiLeafCount )
+{
+	m_uiLeafCount = uiLeafCount;
+	m_uiLeafWords = GetWordCount( uiLeafCount );
+
+	for( size_t uiSet = 0; uiSet < static_cast<size_t>( Set::COUNT ); ++uiSet )
+	{
+		m_Rows[ uiSet ].assign( m_uiLeafCount * m_uiLeafWords, 0 );
+
+		//One more for positions outside the map.
+		m_Sets[ uiSet ].clear();
+		m_Sets[ uiSet ].resize( m_uiLeafCount + 1 );
+	}
+
+	m_OccupiedLeafs.assign( m_uiLeafWords, 0 );
+	m_VisibleLeafs.assign( m_uiLeafWords, 0 );
+
+	BeginFrame( 0 );
+}
+
+void CInterestSets::SetVisible( const size_t uiFromLeaf, const size_t uiToLeaf )
+{
+	assert( uiFromLeaf < m_uiLeafCount && uiToLeaf < m_uiLeafCount );
+
+	SetBit( GetRow( Set::PVS, uiFromLeaf ), uiToLeaf );
+}
+
+void CInterestSets::SetAllVisible( const size_t uiLeaf )
+{
+	assert( uiLeaf < m_uiLeafCount );
+
+	auto pRow = GetRow( Set::PVS, uiLeaf );
+
+	//Padding bits stay clear, so they never match an occupied leaf.
+	std::fill_n( pRow, m_uiLeafCount / WORD_BITS, ~Word_t( 0 ) );
+
+	if( m_uiLeafCount % WORD_BITS )
+		pRow[ m_uiLeafCount / WORD_BITS ] = ( Word_t( 1 ) << ( m_uiLeafCount % WORD_BITS ) ) - 1;
+}
+
+void CInterestSets::SetCompressedRow( const size_t uiLeaf, const uint8_t* pData, const size_t uiSize, const size_t uiFirstLeaf )
+{
+	assert( uiLeaf < m_uiLeafCount );
+
+	CVisibilityCache::DecompressRow( GetRow( Set::PVS, uiLeaf ), m_uiLeafCount, pData, uiSize, uiFirstLeaf );
+}
+
+void CInterestSets::BuildPAS()
+{
+	static const auto pOr = GetOr();
+
+	auto& pas = m_Rows[ static_cast<size_t>( Set::PAS ) ];
+
+	std::fill( pas.begin(), pas.end(), 0 );
+
+	for( size_t uiLeaf = 0; uiLeaf < m_uiLeafCount; ++uiLeaf )
+	{
+		const auto pVisible = GetRow( Set::PVS, uiLeaf );
+		auto pAudible = GetRow( Set::PAS, uiLeaf );
+
+		for( size_t uiWord = 0; uiWord < m_uiLeafWords; ++uiWord )
+		{
+			for( auto word = pVisible[ uiWord ]; word; word &= word - 1 )
+			{
+				pOr( pAudible, GetRow( Set::PVS, uiWord * WORD_BITS + FindLowestBit( word ) ), m_uiLeafWords );
+			}
+		}
+	}
+
+	for( auto& cachedSet : m_Sets[ static_cast<size_t>( Set::PAS ) ] )
+	{
+		cachedSet.uiFrame = 0;
+	}
+}
+
+void CInterestSets::BeginFrame( const size_t uiEntityCount )
+{
+	//Sets built in a frame with the same number are taken to be current, so forget them all when the counter wraps around.
+	if( ++m_uiFrame == 0 )
+	{
+		for( auto& sets : m_Sets )
+		{
+			for( auto& cachedSet : sets )
+			{
+				cachedSet.uiFrame = 0;
+			}
+		}
+
+		m_uiFrame = 1;
+	}
+
+	m_uiEntityWords = GetWordCount( uiEntityCount );
+
+	m_Links.clear();
+	m_bLinksSorted = false;
+
+	std::fill( m_OccupiedLeafs.begin(), m_OccupiedLeafs.end(), 0 );
+
+	m_GlobalEntities.assign( m_uiEntityWords, 0 );
+	m_EntityBits.resize( m_uiEntityWords );
+
+	m_Stats = Stats_t();
+}
+
+void CInterestSets::LinkEntity( const uint32_t uiEntity, const uint32_t* pLeafs, const size_t uiCount )
+{
+	if( uiCount == 0 || uiCount > MAX_ENTITY_LEAFS )
+	{
+		LinkEverywhere( uiEntity );
+		return;
+	}
+
+	assert( uiEntity < m_uiEntityWords * WORD_BITS );
+
+	//Sets that were already built don't have this entity.
+	assert( !m_bLinksSorted );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const uint32_t uiLeaf = pLeafs[ uiIndex ];
+
+		if( uiLeaf >= m_uiLeafCount )
+			continue;
+
+		m_Links.push_back( { uiLeaf, uiEntity } );
+
+		SetBit( m_OccupiedLeafs.data(), uiLeaf );
+	}
+}
+
+void CInterestSets::LinkEverywhere( const uint32_t uiEntity )
+{
+	assert( uiEntity < m_uiEntityWords * WORD_BITS );
+	assert( !m_bLinksSorted );
+
+	auto& word = m_GlobalEntities[ uiEntity / WORD_BITS ];
+	const Word_t bit = Word_t( 1 ) << ( uiEntity % WORD_BITS );
+
+	if( !( word & bit ) )
+	{
+		word |= bit;
+		++m_Stats.uiGlobalEntities;
+	}
+}
+
+const std::vector<uint32_t>& CInterestSets::GetEntities( const size_t uiLeaf, const Set set )
+{
+	//Clients outside the map see everything, like clients in the solid leaf.
+	const size_t uiSetLeaf = std::min( uiLeaf, m_uiLeafCount );
+
+	auto& cachedSet = m_Sets[ static_cast<size_t>( set ) ][ uiSetLeaf ];
+
+	if( cachedSet.uiFrame == m_uiFrame )
+	{
+		++m_Stats.uiSetsReused;
+		return cachedSet.entities;
+	}
+
+	if( !m_bLinksSorted )
+		SortLinks();
+
+	BuildSet( uiSetLeaf, set, cachedSet.entities );
+
+	cachedSet.uiFrame = m_uiFrame;
+
+	++m_Stats.uiSetsBuilt;
+
+	return cachedSet.entities;
+}
+
+void CInterestSets::SortLinks()
+{
+	//Counting sort, since there are few leafs compared to the work it saves.
+	m_LeafStarts.assign( m_uiLeafCount + 1, 0 );
+
+	for( const auto& link : m_Links )
+	{
+		++m_LeafStarts[ link.uiLeaf ];
+	}
+
+	//Each leaf's entry becomes the end of its entities, then is moved back to the start as they're stored.
+	uint32_t uiEnd = 0;
+
+	for( size_t uiLeaf = 0; uiLeaf < m_uiLeafCount; ++uiLeaf )
+	{
+		if( m_LeafStarts[ uiLeaf ] > 0 )
+			++m_Stats.uiOccupiedLeafs;
+
+		uiEnd += m_LeafStarts[ uiLeaf ];
+		m_LeafStarts[ uiLeaf ] = uiEnd;
+	}
+
+	m_LeafStarts[ m_uiLeafCount ] = uiEnd;
+
+	m_LeafEntities.resize( m_Links.size() );
+
+	for( const auto& link : m_Links )
+	{
+		m_LeafEntities[ --m_LeafStarts[ link.uiLeaf ] ] = link.uiEntity;
+	}
+
+	m_bLinksSorted = true;
+}
+
+void CInterestSets::BuildSet( const size_t uiLeaf, const Set set, std::vector<uint32_t>& entities )
+{
+	static const auto pAnd = GetAnd();
+
+	entities.clear();
+
+	if( m_uiEntityWords == 0 )
+		return;
+
+	std::copy( m_GlobalEntities.begin(), m_GlobalEntities.end(), m_EntityBits.begin() );
+
+	const Word_t* pRow = uiLeaf < m_uiLeafCount ? GetRow( set, uiLeaf ) : m_OccupiedLeafs.data();
+
+	//Only leafs that are both relevant and occupied are visited.
+	if( m_uiLeafWords > 0 && pAnd( m_VisibleLeafs.data(), pRow, m_OccupiedLeafs.data(), m_uiLeafWords ) )
+	{
+		for( size_t uiWord = 0; uiWord < m_uiLeafWords; ++uiWord )
+		{
+			for( auto word = m_VisibleLeafs[ uiWord ]; word; word &= word - 1 )
+			{
+				const size_t uiVisibleLeaf = uiWord * WORD_BITS + FindLowestBit( word );
+
+				//Entities in several leafs are set more than once, and the bits put them in order.
+				for( auto uiIndex = m_LeafStarts[ uiVisibleLeaf ]; uiIndex < m_LeafStarts[ uiVisibleLeaf + 1 ]; ++uiIndex )
+				{
+					SetBit( m_EntityBits.data(), m_LeafEntities[ uiIndex ] );
+				}
+			}
+		}
+	}
+
+	for( size_t uiWord = 0; uiWord < m_uiEntityWords; ++uiWord )
+	{
+		for( auto word = m_EntityBits[ uiWord ]; word; word &= word - 1 )
+		{
+			entities.push_back( static_cast<uint32_t>( uiWord * WORD_BITS + FindLowestBit( word ) ) );
+		}
+	}
+}
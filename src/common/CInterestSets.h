@@ -0,0 +1,244 @@
+#ifndef COMMON_CINTERESTSETS_H
+#define COMMON_CINTERESTSETS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+*	Decides which entities are relevant to a client from the leaf it is in, so snapshots only encode what the client could see or hear.
+*	Each leaf has a row of bits for the leafs that are potentially visible from it (PVS), and one for those that are potentially audible (PAS),
+*	the leafs visible from any leaf in its PVS. Each frame the entities are linked to the leafs they touch, and the entities relevant to a leaf
+*	are found by ANDing its row with the set of occupied leafs, so only leafs that have entities in them are visited.
+*	The result is built once per leaf and frame, and shared by every client in that leaf.
+*	Leafs are numbered however the map numbers them; a BSP map's leaf 0 is the solid leaf outside the world.
+*	Not thread safe: build the sets of all leafs clients are in before reading them from several threads.
+*/
+class CInterestSets final
+{
+public:
+	using Word_t = uint64_t;
+
+	static const size_t WORD_BITS = 64;
+
+	/**
+	*	Rows are padded to a multiple of this many words, so the vector code never needs a scalar tail.
+	*/
+	static const size_t ROW_ALIGNMENT_WORDS = 4;
+
+	/**
+	*	Most leafs an entity is linked to. Entities that touch more are relevant everywhere, like GoldSource's MAX_ENT_LEAFS.
+	*/
+	static const size_t MAX_ENTITY_LEAFS = 48;
+
+	enum class Set
+	{
+		/**
+		*	Potentially visible set.
+		*/
+		PVS = 0,
+
+		/**
+		*	Potentially audible set.
+		*/
+		PAS,
+
+		COUNT
+	};
+
+	struct Stats_t
+	{
+		/**
+		*	Entity sets built this frame.
+		*/
+		size_t uiSetsBuilt = 0;
+
+		/**
+		*	Requests this frame that were answered with a set that was already built.
+		*/
+		size_t uiSetsReused = 0;
+
+		/**
+		*	Leafs that have entities in them this frame.
+		*/
+		size_t uiOccupiedLeafs = 0;
+
+		/**
+		*	Entities that are relevant to every leaf.
+		*/
+		size_t uiGlobalEntities = 0;
+	};
+
+public:
+	CInterestSets() = default;
+	~CInterestSets() = default;
+
+	size_t GetLeafCount() const { return m_uiLeafCount; }
+
+	/**
+	*	Sets the number of leafs. No leaf can see any other leaf until rows are set, and no entities are linked.
+	*/
+	void Reset( const size_t uiLeafCount );
+
+	/**
+	*	Makes a leaf visible from another. Visibility is not made mutual.
+	*/
+	void SetVisible( const size_t uiFromLeaf, const size_t uiToLeaf );
+
+	/**
+	*	Makes every leaf visible from a leaf, for leafs that have no visibility data.
+	*/
+	void SetAllVisible( const size_t uiLeaf );
+
+	/**
+	*	Sets a leaf's PVS from GoldSource's compressed visibility data: a zero byte is followed by the number of zero bytes it stands for,
+	*	other bytes are stored as they are.
+	*	@param pData Start of the leaf's row. Decompression stops at the end of the data, or once all leafs are covered.
+	*	@param uiFirstLeaf Leaf that the first bit stands for. BSP rows start at leaf 1, since leaf 0 is never visible.
+	*/
+	void SetCompressedRow( const size_t uiLeaf, const uint8_t* pData, const size_t uiSize, const size_t uiFirstLeaf );
+
+	/**
+	*	Builds the PAS of every leaf from the PVS. Call once all PVS rows are set.
+	*/
+	void BuildPAS();
+
+	/**
+	*	@return Number of words in a row of leaf bits.
+	*/
+	size_t GetRowWords() const { return m_uiLeafWords; }
+
+	/**
+	*	@return The leafs visible from a leaf, as bits. Must be less than GetLeafCount.
+	*/
+	const Word_t* GetLeafRow( const size_t uiLeaf, const Set set = Set::PVS ) const
+	{
+		return GetRow( set, uiLeaf );
+	}
+
+	bool IsVisible( const size_t uiFromLeaf, const size_t uiToLeaf, const Set set = Set::PVS ) const
+	{
+		if( uiFromLeaf >= m_uiLeafCount || uiToLeaf >= m_uiLeafCount )
+			return false;
+
+		return ( GetRow( set, uiFromLeaf )[ uiToLeaf / WORD_BITS ] & ( Word_t( 1 ) << ( uiToLeaf % WORD_BITS ) ) ) != 0;
+	}
+
+	/**
+	*	Starts a frame: unlinks all entities and forgets the sets built for the last frame.
+	*	@param uiEntityCount Entities are numbered [ 0, uiEntityCount ).
+	*/
+	void BeginFrame( const size_t uiEntityCount );
+
+	/**
+	*	Links an entity to the leafs it touches. An entity should only be linked once per frame.
+	*	@param uiCount Number of leafs. Entities with more than MAX_ENTITY_LEAFS, or none, are linked everywhere.
+	*/
+	void LinkEntity( const uint32_t uiEntity, const uint32_t* pLeafs, const size_t uiCount );
+
+	/**
+	*	Makes an entity relevant to every leaf.
+	*/
+	void LinkEverywhere( const uint32_t uiEntity );
+
+	/**
+	*	Gets the entities relevant to clients in a leaf, in increasing order.
+	*	@param uiLeaf Leaf the client is in. Clients outside the map, at GetLeafCount() or above, get every linked entity.
+	*	@return The set, which stays valid until the next call to BeginFrame or Reset.
+	*/
+	const std::vector<uint32_t>& GetEntities( const size_t uiLeaf, const Set set = Set::PVS );
+
+	const Stats_t& GetStats() const { return m_Stats; }
+
+private:
+	struct Link_t
+	{
+		uint32_t uiLeaf;
+		uint32_t uiEntity;
+	};
+
+	struct CachedSet_t
+	{
+		/**
+		*	Frame the set was built in. 0 if it never was.
+		*/
+		uint32_t uiFrame = 0;
+
+		std::vector<uint32_t> entities;
+	};
+
+	const Word_t* GetRow( const Set set, const size_t uiLeaf ) const
+	{
+		return m_Rows[ static_cast<size_t>( set ) ].data() + uiLeaf * m_uiLeafWords;
+	}
+
+	Word_t* GetRow( const Set set, const size_t uiLeaf )
+	{
+		return m_Rows[ static_cast<size_t>( set ) ].data() + uiLeaf * m_uiLeafWords;
+	}
+
+	/**
+	*	Sorts this frame's links by leaf, once all entities are linked.
+	*/
+	void SortLinks();
+
+	void BuildSet( const size_t uiLeaf, const Set set, std::vector<uint32_t>& entities );
+
+private:
+	size_t m_uiLeafCount = 0;
+
+	/**
+	*	Words in a row of leaf bits, padded to ROW_ALIGNMENT_WORDS.
+	*/
+	size_t m_uiLeafWords = 0;
+
+	/**
+	*	PVS and PAS rows, one after another.
+	*/
+	std::vector<Word_t> m_Rows[ static_cast<size_t>( Set::COUNT ) ];
+
+	size_t m_uiEntityWords = 0;
+
+	/**
+	*	Frame number, starting at 1 so no set counts as built before the first frame.
+	*/
+	uint32_t m_uiFrame = 1;
+
+	std::vector<Link_t> m_Links;
+
+	bool m_bLinksSorted = false;
+
+	/**
+	*	Leafs that have entities in them.
+	*/
+	std::vector<Word_t> m_OccupiedLeafs;
+
+	/**
+	*	Where each leaf's entities start in m_LeafEntities, once the links are sorted. m_uiLeafCount + 1 entries.
+	*/
+	std::vector<uint32_t> m_LeafStarts;
+
+	std::vector<uint32_t> m_LeafEntities;
+
+	/**
+	*	Entities that are relevant everywhere, as bits.
+	*/
+	std::vector<Word_t> m_GlobalEntities;
+
+	/**
+	*	Sets of each leaf, and of positions outside the map at the end.
+	*/
+	std::vector<CachedSet_t> m_Sets[ static_cast<size_t>( Set::COUNT ) ];
+
+	//Scratch space for building sets.
+	std::vector<Word_t> m_VisibleLeafs;
+	std::vector<Word_t> m_EntityBits;
+
+	Stats_t m_Stats;
+
+private:
+	CInterestSets( const CInterestSets& ) = delete;
+	CInterestSets& operator=( const CInterestSets& ) = delete;
+};
+
+#endif //COMMON_CINTERESTSETS_H
@@ -0,0 +1,370 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+
+#include "CJobSystem.h"
+
+const size_t CJobSystem::MAX_WORKERS;
+const unsigned int CJobSystem::WAIT_POLL_MS;
+
+namespace
+{
+/**
+*	Job system and queue index of the worker running on this thread, if any.
+*/
+thread_local const CJobSystem* g_pWorkerSystem = nullptr;
+thread_local size_t g_uiWorkerIndex = 0;
+}
+
+CJobSystem::~CJobSystem()
+{
+	Stop();
+}
+
+void CJobSystem::Start( const size_t uiWorkers )
+{
+	Stop();
+
+	m_MainThreadID = std::this_thread::get_id();
+
+	const size_t uiCount = std::min( uiWorkers, MAX_WORKERS );
+
+	m_WorkerQueues.clear();
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		m_WorkerQueues.emplace_back( std::make_unique<Queue_t>() );
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_SleepMutex );
+		m_bStop = false;
+	}
+
+	m_Threads.reserve( uiCount );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		m_Threads.emplace_back( &CJobSystem::WorkerThread, this, uiIndex );
+	}
+
+	m_bRunning = true;
+}
+
+void CJobSystem::Stop()
+{
+	if( !m_bRunning )
+		return;
+
+	assert( IsMainThread() );
+
+	//Workers finish everything that can run anywhere before they exit.
+	{
+		std::lock_guard<std::mutex> lock( m_SleepMutex );
+		m_bStop = true;
+	}
+
+	m_WorkAvailable.notify_all();
+
+	//Main thread jobs can be queued by the jobs that are still running, so keep running them until the workers are gone.
+	for( auto& thread : m_Threads )
+	{
+		while( thread.joinable() )
+		{
+			RunMainThreadJobs();
+
+			if( m_uiQueued.load( std::memory_order_acquire ) == 0 )
+			{
+				thread.join();
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	m_Threads.clear();
+
+	//Without workers, or with jobs queued by the last jobs to finish.
+	Job_t job;
+
+	while( TryTakeJob( job, true ) )
+	{
+		Execute( job );
+	}
+
+	m_WorkerQueues.clear();
+
+	m_bRunning = false;
+}
+
+void CJobSystem::Submit( JobFn_t job, CCounter* pCounter, const Affinity affinity )
+{
+	assert( job );
+
+	if( pCounter )
+		pCounter->m_uiCount.fetch_add( 1, std::memory_order_relaxed );
+
+	Enqueue( { std::move( job ), pCounter, affinity } );
+}
+
+void CJobSystem::SubmitAfter( CCounter& dependency, JobFn_t job, CCounter* pCounter, const Affinity affinity )
+{
+	assert( job );
+
+	if( pCounter )
+		pCounter->m_uiCount.fetch_add( 1, std::memory_order_relaxed );
+
+	{
+		std::lock_guard<std::mutex> lock( dependency.m_Mutex );
+
+		//The last job to finish takes the waiting jobs under this lock, so a job added here is never missed.
+		if( !dependency.IsDone() )
+		{
+			dependency.m_Waiting.push_back( { std::move( job ), pCounter, affinity } );
+			return;
+		}
+	}
+
+	Enqueue( { std::move( job ), pCounter, affinity } );
+}
+
+void CJobSystem::Wait( CCounter& counter )
+{
+	const bool bMainThread = IsMainThread();
+
+	Job_t job;
+
+	while( !counter.IsDone() )
+	{
+		if( TryTakeJob( job, true ) )
+		{
+			Execute( job );
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( m_SleepMutex );
+
+		m_WorkAvailable.wait_for( lock, std::chrono::milliseconds( WAIT_POLL_MS ), [ & ]()
+		{
+			return counter.IsDone() ||
+				m_uiQueued.load( std::memory_order_acquire ) > 0 ||
+				( bMainThread && m_uiMainThreadQueued.load( std::memory_order_acquire ) > 0 );
+		} );
+	}
+
+	//The last job counts down under the lock. Taking it waits for that job to let go of the counter, so the caller can destroy it.
+	std::lock_guard<std::mutex> lock( counter.m_Mutex );
+}
+
+size_t CJobSystem::RunMainThreadJobs()
+{
+	assert( IsMainThread() );
+
+	//Without workers nobody else would run the other jobs.
+	const bool bAnyAffinity = m_Threads.empty();
+
+	size_t uiCount = 0;
+
+	Job_t job;
+
+	while( TryTakeJob( job, bAnyAffinity ) )
+	{
+		Execute( job );
+		++uiCount;
+	}
+
+	return uiCount;
+}
+
+void CJobSystem::Enqueue( Job_t&& job )
+{
+	const bool bMainThreadJob = job.affinity == Affinity::MAIN_THREAD;
+
+	if( bMainThreadJob )
+	{
+		std::lock_guard<std::mutex> lock( m_MainThreadQueue.mutex );
+		m_MainThreadQueue.jobs.emplace_back( std::move( job ) );
+
+		m_uiMainThreadQueued.fetch_add( 1, std::memory_order_release );
+	}
+	else
+	{
+		//Workers keep the jobs they create, they're likely to use the same data.
+		auto& queue = g_pWorkerSystem == this ? *m_WorkerQueues[ g_uiWorkerIndex ] : m_SharedQueue;
+
+		std::lock_guard<std::mutex> lock( queue.mutex );
+		queue.jobs.emplace_back( std::move( job ) );
+
+		m_uiQueued.fetch_add( 1, std::memory_order_release );
+	}
+
+	//The main thread can only be waiting in Wait, so it always has to be woken up for its own jobs.
+	Notify( bMainThreadJob );
+}
+
+bool CJobSystem::TryTakeJob( Job_t& job, const bool bAnyAffinity )
+{
+	const bool bWorker = g_pWorkerSystem == this;
+
+	if( bWorker )
+	{
+		auto& queue = *m_WorkerQueues[ g_uiWorkerIndex ];
+
+		std::lock_guard<std::mutex> lock( queue.mutex );
+
+		//Newest first, its data is most likely still in the cache.
+		if( !queue.jobs.empty() )
+		{
+			job = std::move( queue.jobs.back() );
+			queue.jobs.pop_back();
+			m_uiQueued.fetch_sub( 1, std::memory_order_relaxed );
+			return true;
+		}
+	}
+	else if( IsMainThread() )
+	{
+		std::lock_guard<std::mutex> lock( m_MainThreadQueue.mutex );
+
+		if( !m_MainThreadQueue.jobs.empty() )
+		{
+			job = std::move( m_MainThreadQueue.jobs.front() );
+			m_MainThreadQueue.jobs.pop_front();
+			m_uiMainThreadQueued.fetch_sub( 1, std::memory_order_relaxed );
+			return true;
+		}
+	}
+
+	if( !bAnyAffinity || m_uiQueued.load( std::memory_order_acquire ) == 0 )
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock( m_SharedQueue.mutex );
+
+		if( !m_SharedQueue.jobs.empty() )
+		{
+			job = std::move( m_SharedQueue.jobs.front() );
+			m_SharedQueue.jobs.pop_front();
+			m_uiQueued.fetch_sub( 1, std::memory_order_relaxed );
+			return true;
+		}
+	}
+
+	//Steal the oldest job, starting with the next worker so thieves spread out.
+	const size_t uiCount = m_WorkerQueues.size();
+	const size_t uiStart = bWorker ? g_uiWorkerIndex + 1 : 0;
+
+	for( size_t uiOffset = 0; uiOffset < uiCount; ++uiOffset )
+	{
+		const size_t uiIndex = ( uiStart + uiOffset ) % uiCount;
+
+		if( bWorker && uiIndex == g_uiWorkerIndex )
+			continue;
+
+		auto& queue = *m_WorkerQueues[ uiIndex ];
+
+		std::lock_guard<std::mutex> lock( queue.mutex );
+
+		if( !queue.jobs.empty() )
+		{
+			job = std::move( queue.jobs.front() );
+			queue.jobs.pop_front();
+			m_uiQueued.fetch_sub( 1, std::memory_order_relaxed );
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CJobSystem::Execute( Job_t& job )
+{
+	job.function();
+
+	//Release whatever the job captured before anything waiting for it runs.
+	job.function = nullptr;
+
+	auto pCounter = job.pCounter;
+
+	if( !pCounter )
+		return;
+
+	size_t uiCount = pCounter->m_uiCount.load( std::memory_order_relaxed );
+
+	//Jobs that aren't the last don't need the lock.
+	while( uiCount > 1 )
+	{
+		if( pCounter->m_uiCount.compare_exchange_weak( uiCount, uiCount - 1, std::memory_order_acq_rel, std::memory_order_relaxed ) )
+			return;
+	}
+
+	std::vector<Job_t> waiting;
+
+	{
+		std::lock_guard<std::mutex> lock( pCounter->m_Mutex );
+
+		//The last decrement happens under the lock, so the waiting jobs are taken before anyone can see the counter is done.
+		//Another job could have been counted in the meantime, in which case this isn't the last one.
+		if( pCounter->m_uiCount.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+			waiting.swap( pCounter->m_Waiting );
+	}
+
+	//The counter may have been destroyed by now, so it must not be touched again.
+	for( auto& waitingJob : waiting )
+	{
+		Enqueue( std::move( waitingJob ) );
+	}
+
+	//Wake up threads waiting for the counter.
+	Notify( true );
+}
+
+void CJobSystem::Notify( const bool bAll )
+{
+	//Taking the lock makes sure a thread that is about to sleep sees the change.
+	{
+		std::lock_guard<std::mutex> lock( m_SleepMutex );
+	}
+
+	if( bAll )
+		m_WorkAvailable.notify_all();
+	else
+		m_WorkAvailable.notify_one();
+}
+
+void CJobSystem::WorkerThread( const size_t uiIndex )
+{
+	g_pWorkerSystem = this;
+	g_uiWorkerIndex = uiIndex;
+
+	Job_t job;
+
+	while( true )
+	{
+		if( TryTakeJob( job, true ) )
+		{
+			Execute( job );
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock( m_SleepMutex );
+
+		if( m_bStop && m_uiQueued.load( std::memory_order_acquire ) == 0 )
+			break;
+
+		m_WorkAvailable.wait( lock, [ this ]()
+		{
+			return m_bStop || m_uiQueued.load( std::memory_order_acquire ) > 0;
+		} );
+	}
+
+	g_pWorkerSystem = nullptr;
+}
+
+CJobSystem& GetJobSystem()
+{
+	static CJobSystem jobs;
+
+	return jobs;
+}
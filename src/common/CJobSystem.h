@@ -0,0 +1,212 @@
+#ifndef COMMON_CJOBSYSTEM_H
+#define COMMON_CJOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+*	Runs jobs on a pool of worker threads, so subsystems share one set of threads instead of each starting their own.
+*	Each worker has its own queue: jobs submitted by a worker go on its queue and are run newest first, and idle workers steal
+*	the oldest jobs from other queues. Jobs submitted from other threads go on a shared queue.
+*	Jobs that must run on the main thread (anything that touches GL) are only run by the main thread, in Wait and RunMainThreadJobs.
+*	Completion is tracked with counters: jobs can be made to wait for a counter, and threads can wait for one while running other jobs.
+*	Jobs must not block on I/O or locks for long; that's what dedicated threads are for.
+*/
+class CJobSystem final
+{
+public:
+	using JobFn_t = std::function<void()>;
+
+	enum class Affinity
+	{
+		ANY = 0,
+
+		/**
+		*	Only runs on the thread that started the job system.
+		*/
+		MAIN_THREAD
+	};
+
+	/**
+	*	Most worker threads that can be started.
+	*/
+	static const size_t MAX_WORKERS = 32;
+
+	/**
+	*	How long threads waiting for a counter sleep before checking it again, in milliseconds. Counters wake them up when they're done,
+	*	this only limits how long a missed wakeup can take.
+	*/
+	static const unsigned int WAIT_POLL_MS = 1;
+
+	class CCounter;
+
+private:
+	struct Job_t
+	{
+		JobFn_t function;
+
+		/**
+		*	Counter that is decremented once the job has run. May be null.
+		*/
+		CCounter* pCounter;
+
+		Affinity affinity;
+	};
+
+public:
+	/**
+	*	Number of jobs that haven't finished yet. Jobs that are waiting for another counter count as well.
+	*	Must outlive the jobs it counts. Once Wait has returned for it, it can be destroyed.
+	*/
+	class CCounter final
+	{
+	public:
+		CCounter() = default;
+
+		bool IsDone() const { return m_uiCount.load( std::memory_order_acquire ) == 0; }
+
+	private:
+		friend class CJobSystem;
+
+		std::atomic<size_t> m_uiCount{ 0 };
+
+		std::mutex m_Mutex;
+
+		/**
+		*	Jobs to submit once the count reaches 0.
+		*/
+		std::vector<Job_t> m_Waiting;
+
+	private:
+		CCounter( const CCounter& ) = delete;
+		CCounter& operator=( const CCounter& ) = delete;
+	};
+
+public:
+	CJobSystem() = default;
+	~CJobSystem();
+
+	/**
+	*	Starts the worker threads. The calling thread becomes the main thread.
+	*	@param uiWorkers Number of worker threads. If 0, all jobs run on the main thread.
+	*/
+	void Start( const size_t uiWorkers );
+
+	/**
+	*	Runs all jobs that are queued, and stops the worker threads. Must be called on the main thread.
+	*/
+	void Stop();
+
+	bool IsRunning() const { return m_bRunning; }
+
+	size_t GetWorkerCount() const { return m_Threads.size(); }
+
+	/**
+	*	@return Whether the calling thread is the main thread.
+	*/
+	bool IsMainThread() const { return std::this_thread::get_id() == m_MainThreadID; }
+
+	/**
+	*	Queues a job.
+	*	@param pCounter Counter that is decremented once the job has run. May be null.
+	*/
+	void Submit( JobFn_t job, CCounter* pCounter = nullptr, const Affinity affinity = Affinity::ANY );
+
+	/**
+	*	Queues a job once all jobs counted by a counter have finished.
+	*	@param dependency Counter to wait for.
+	*	@param pCounter Counter that is decremented once the job has run. It counts the job from now on. May be null.
+	*/
+	void SubmitAfter( CCounter& dependency, JobFn_t job, CCounter* pCounter = nullptr, const Affinity affinity = Affinity::ANY );
+
+	/**
+	*	Runs jobs until all jobs counted by a counter have finished. The main thread also runs main thread jobs while it waits.
+	*/
+	void Wait( CCounter& counter );
+
+	/**
+	*	Runs the main thread jobs that are queued. Called once a frame. Without workers, this runs all queued jobs.
+	*	@return Number of jobs that were run.
+	*/
+	size_t RunMainThreadJobs();
+
+private:
+	struct Queue_t
+	{
+		std::mutex mutex;
+		std::deque<Job_t> jobs;
+	};
+
+	void Enqueue( Job_t&& job );
+
+	/**
+	*	Takes a job to run: from the calling worker's own queue first, then the main thread queue if this is the main thread,
+	*	then the shared queue, and finally from other workers.
+	*	@param bAnyAffinity Whether to take jobs that can run on any thread. The main thread can opt to only run main thread jobs.
+	*/
+	bool TryTakeJob( Job_t& job, const bool bAnyAffinity );
+
+	/**
+	*	Runs a job, and submits the jobs waiting for its counter if it was the last one.
+	*/
+	void Execute( Job_t& job );
+
+	/**
+	*	Wakes up threads that are waiting for work or a counter.
+	*/
+	void Notify( const bool bAll );
+
+	void WorkerThread( const size_t uiIndex );
+
+private:
+	bool m_bRunning = false;
+
+	std::thread::id m_MainThreadID;
+
+	std::vector<std::thread> m_Threads;
+
+	/**
+	*	One queue per worker.
+	*/
+	std::vector<std::unique_ptr<Queue_t>> m_WorkerQueues;
+
+	Queue_t m_SharedQueue;
+	Queue_t m_MainThreadQueue;
+
+	/**
+	*	Number of jobs in the worker and shared queues.
+	*/
+	std::atomic<size_t> m_uiQueued{ 0 };
+
+	/**
+	*	Number of jobs in the main thread queue.
+	*/
+	std::atomic<size_t> m_uiMainThreadQueued{ 0 };
+
+	std::mutex m_SleepMutex;
+
+	std::condition_variable m_WorkAvailable;
+
+	/**
+	*	Guarded by m_SleepMutex.
+	*/
+	bool m_bStop = false;
+
+private:
+	CJobSystem( const CJobSystem& ) = delete;
+	CJobSystem& operator=( const CJobSystem& ) = delete;
+};
+
+/**
+*	@return The job system shared by this module.
+*/
+CJobSystem& GetJobSystem();
+
+#endif //COMMON_CJOBSYSTEM_H
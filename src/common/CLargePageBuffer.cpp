@@ -0,0 +1,242 @@
+#include <cstring>
+#include <utility>
+
+#include "Platform.h"
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+#include "CLargePageBuffer.h"
+
+namespace
+{
+#ifdef WIN32
+/**
+*	Large pages can only be allocated by processes that hold SeLockMemoryPrivilege, and it has to be enabled first.
+*/
+bool EnableLockMemoryPrivilege()
+{
+	HANDLE hToken;
+
+	if( !OpenProcessToken( GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &hToken ) )
+		return false;
+
+	TOKEN_PRIVILEGES privileges{};
+
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[ 0 ].Attributes = SE_PRIVILEGE_ENABLED;
+
+	bool bEnabled = false;
+
+	if( LookupPrivilegeValueA( nullptr, "SeLockMemoryPrivilege", &privileges.Privileges[ 0 ].Luid ) )
+	{
+		//Succeeds without enabling anything if the account doesn't have the privilege.
+		bEnabled = AdjustTokenPrivileges( hToken, FALSE, &privileges, 0, nullptr, nullptr ) && GetLastError() == ERROR_SUCCESS;
+	}
+
+	CloseHandle( hToken );
+
+	return bEnabled;
+}
+#else
+size_t GetPageSize()
+{
+	static const size_t uiPageSize = static_cast<size_t>( sysconf( _SC_PAGESIZE ) );
+
+	return uiPageSize;
+}
+#endif
+
+size_t RoundUp( const size_t uiSize, const size_t uiMultiple )
+{
+	return ( uiSize + uiMultiple - 1 ) / uiMultiple * uiMultiple;
+}
+}
+
+CLargePageBuffer::CLargePageBuffer( CLargePageBuffer&& other )
+	: m_pData( other.m_pData )
+	, m_uiSize( other.m_uiSize )
+	, m_Backing( other.m_Backing )
+{
+	other.m_pData = nullptr;
+	other.m_uiSize = 0;
+	other.m_Backing = PageBacking::NORMAL;
+}
+
+CLargePageBuffer& CLargePageBuffer::operator=( CLargePageBuffer&& other )
+{
+	if( this != &other )
+	{
+		Free();
+
+		std::swap( m_pData, other.m_pData );
+		std::swap( m_uiSize, other.m_uiSize );
+		std::swap( m_Backing, other.m_Backing );
+	}
+
+	return *this;
+}
+
+bool CLargePageBuffer::Allocate( const size_t uiSize, const bool bLargePages )
+{
+	Free();
+
+	if( uiSize == 0 )
+		return false;
+
+	const size_t uiLargePageSize = bLargePages ? Plat_GetLargePageSize() : 0;
+
+#ifdef WIN32
+	if( uiLargePageSize > 0 )
+	{
+		static const bool bHavePrivilege = EnableLockMemoryPrivilege();
+
+		if( bHavePrivilege )
+		{
+			const size_t uiLargeSize = RoundUp( uiSize, uiLargePageSize );
+
+			if( auto pData = VirtualAlloc( nullptr, uiLargeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE ) )
+			{
+				m_pData = reinterpret_cast<uint8_t*>( pData );
+				m_uiSize = uiLargeSize;
+				m_Backing = PageBacking::LARGE;
+
+				return true;
+			}
+		}
+	}
+
+	//Rounded up to the page size by VirtualAlloc.
+	auto pData = VirtualAlloc( nullptr, uiSize, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE );
+
+	if( !pData )
+		return false;
+
+	m_pData = reinterpret_cast<uint8_t*>( pData );
+	m_uiSize = uiSize;
+	m_Backing = PageBacking::NORMAL;
+#else
+	if( uiLargePageSize > 0 )
+	{
+		const size_t uiLargeSize = RoundUp( uiSize, uiLargePageSize );
+
+		void* pData = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+		//Fails unless huge pages were reserved, e.g. with vm.nr_hugepages.
+		pData = mmap( nullptr, uiLargeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0 );
+
+		if( pData != MAP_FAILED )
+		{
+			m_pData = reinterpret_cast<uint8_t*>( pData );
+			m_uiSize = uiLargeSize;
+			m_Backing = PageBacking::LARGE;
+
+			return true;
+		}
+#endif
+
+		//Transparent huge pages only back ranges that are aligned to the large page size, so map extra and trim it off.
+		pData = mmap( nullptr, uiLargeSize + uiLargePageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+		if( pData == MAP_FAILED )
+			return false;
+
+		const uintptr_t start = reinterpret_cast<uintptr_t>( pData );
+		const uintptr_t alignedStart = RoundUp( start, uiLargePageSize );
+
+		if( alignedStart > start )
+			munmap( pData, alignedStart - start );
+
+		if( uiLargePageSize > alignedStart - start )
+			munmap( reinterpret_cast<void*>( alignedStart + uiLargeSize ), uiLargePageSize - ( alignedStart - start ) );
+
+		m_pData = reinterpret_cast<uint8_t*>( alignedStart );
+		m_uiSize = uiLargeSize;
+		m_Backing = Plat_AdviseLargePages( m_pData, m_uiSize ) ? PageBacking::TRANSPARENT : PageBacking::NORMAL;
+
+		return true;
+	}
+
+	const size_t uiPageSize = RoundUp( uiSize, GetPageSize() );
+
+	void* pData = mmap( nullptr, uiPageSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+
+	if( pData == MAP_FAILED )
+		return false;
+
+	m_pData = reinterpret_cast<uint8_t*>( pData );
+	m_uiSize = uiPageSize;
+	m_Backing = PageBacking::NORMAL;
+#endif
+
+	return true;
+}
+
+void CLargePageBuffer::Free()
+{
+	if( m_pData )
+	{
+#ifdef WIN32
+		VirtualFree( m_pData, 0, MEM_RELEASE );
+#else
+		munmap( m_pData, m_uiSize );
+#endif
+	}
+
+	m_pData = nullptr;
+	m_uiSize = 0;
+	m_Backing = PageBacking::NORMAL;
+}
+
+size_t Plat_GetLargePageSize()
+{
+#ifdef WIN32
+	static const size_t uiSize = static_cast<size_t>( GetLargePageMinimum() );
+#elif defined( PLAT_LINUX )
+	static const size_t uiSize = []() -> size_t
+	{
+		//The default huge page size, 2 MiB on x86.
+		size_t uiKiB = 0;
+
+		if( FILE* pFile = fopen( "/proc/meminfo", "r" ) )
+		{
+			char szLine[ 256 ];
+
+			while( fgets( szLine, sizeof( szLine ), pFile ) )
+			{
+				if( !strncmp( szLine, "Hugepagesize:", 13 ) )
+				{
+					uiKiB = strtoul( szLine + 13, nullptr, 10 );
+					break;
+				}
+			}
+
+			fclose( pFile );
+		}
+
+		return uiKiB > 0 ? uiKiB * 1024 : 0;
+	}();
+#else
+	static const size_t uiSize = 0;
+#endif
+
+	return uiSize;
+}
+
+bool Plat_AdviseLargePages( const void* pData, const size_t uiSize )
+{
+#if defined( PLAT_LINUX ) && defined( MADV_HUGEPAGE )
+	if( !pData || uiSize == 0 )
+		return false;
+
+	//madvise wants a page aligned start.
+	const uintptr_t start = reinterpret_cast<uintptr_t>( pData ) & ~( GetPageSize() - 1 );
+	const size_t uiLength = reinterpret_cast<uintptr_t>( pData ) + uiSize - start;
+
+	return madvise( reinterpret_cast<void*>( start ), uiLength, MADV_HUGEPAGE ) == 0;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,89 @@
+#ifndef COMMON_CLARGEPAGEBUFFER_H
+#define COMMON_CLARGEPAGEBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+*	How a buffer's memory is backed.
+*/
+enum class PageBacking
+{
+	/**
+	*	Regular pages.
+	*/
+	NORMAL = 0,
+
+	/**
+	*	Regular pages that the kernel was asked to back with huge pages when it can (Linux transparent huge pages).
+	*/
+	TRANSPARENT,
+
+	/**
+	*	Explicit large pages: MAP_HUGETLB on Linux, MEM_LARGE_PAGES on Windows.
+	*/
+	LARGE
+};
+
+/**
+*	Page aligned buffer allocated straight from the OS, optionally backed by large (2 MiB) pages.
+*	Large pages cover big buffers such as caches and arenas with a handful of TLB entries instead of hundreds.
+*	Explicit large pages need a reserved huge page pool on Linux and the "Lock pages in memory" privilege on Windows;
+*	if they can't be had the buffer falls back to regular pages, with a transparent huge page hint on Linux.
+*	The memory starts out zeroed. Regular pages are only backed by memory once they're touched, explicit large pages are backed when allocated.
+*/
+class CLargePageBuffer final
+{
+public:
+	CLargePageBuffer() = default;
+	CLargePageBuffer( CLargePageBuffer&& other );
+	CLargePageBuffer& operator=( CLargePageBuffer&& other );
+
+	~CLargePageBuffer()
+	{
+		Free();
+	}
+
+	/**
+	*	Allocates the buffer. Any previously allocated memory is freed first.
+	*	@param uiSize Size in bytes. Rounded up to the page size, or the large page size if large pages are requested.
+	*	@param bLargePages Whether to try large pages.
+	*	@return Whether the memory was allocated, with any backing.
+	*/
+	bool Allocate( const size_t uiSize, const bool bLargePages );
+
+	void Free();
+
+	uint8_t* GetData() const { return m_pData; }
+
+	/**
+	*	@return Size of the buffer after rounding, in bytes.
+	*/
+	size_t GetSize() const { return m_uiSize; }
+
+	PageBacking GetBacking() const { return m_Backing; }
+
+private:
+	uint8_t* m_pData = nullptr;
+	size_t m_uiSize = 0;
+
+	PageBacking m_Backing = PageBacking::NORMAL;
+
+private:
+	CLargePageBuffer( const CLargePageBuffer& ) = delete;
+	CLargePageBuffer& operator=( const CLargePageBuffer& ) = delete;
+};
+
+/**
+*	@return Size of a large page, or 0 if the OS doesn't support them.
+*/
+size_t Plat_GetLargePageSize();
+
+/**
+*	Asks the OS to back a range of memory that is already mapped, such as a file mapping, with huge pages where it can.
+*	Only Linux supports this, and only for file mappings if the kernel has read-only transparent huge pages for files. Does nothing elsewhere.
+*	@return Whether the hint was accepted.
+*/
+bool Plat_AdviseLargePages( const void* pData, const size_t uiSize );
+
+#endif //COMMON_CLARGEPAGEBUFFER_H
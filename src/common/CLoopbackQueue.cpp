@@ -0,0 +1,61 @@
+#include "CLoopbackQueue.h"
+
+const size_t CLoopbackQueue::NUM_SLOTS;
+const size_t CLoopbackQueue::MAX_MESSAGE_SIZE;
+
+static_assert( ( CLoopbackQueue::NUM_SLOTS & ( CLoopbackQueue::NUM_SLOTS - 1 ) ) == 0, "The number of loopback slots must be a power of 2" );
+
+CLoopbackQueue::CLoopbackQueue( const char* pszDebugName )
+	: m_pszDebugName( pszDebugName )
+	, m_Slots( new Slot_t[ NUM_SLOTS ] )
+{
+}
+
+CNetworkBuffer* CLoopbackQueue::BeginWrite()
+{
+	const size_t uiWrite = m_uiWriteIndex.load( std::memory_order_relaxed );
+
+	if( uiWrite - m_uiReadIndex.load( std::memory_order_acquire ) == NUM_SLOTS )
+	{
+		m_uiDropped.fetch_add( 1, std::memory_order_relaxed );
+		return nullptr;
+	}
+
+	m_WriteBuffer.SetBuffer( m_pszDebugName, m_Slots[ uiWrite & ( NUM_SLOTS - 1 ) ].data, MAX_MESSAGE_SIZE );
+
+	return &m_WriteBuffer;
+}
+
+void CLoopbackQueue::EndWrite()
+{
+	if( m_WriteBuffer.HasOverflowed() )
+	{
+		m_uiDropped.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	const size_t uiWrite = m_uiWriteIndex.load( std::memory_order_relaxed );
+
+	m_Slots[ uiWrite & ( NUM_SLOTS - 1 ) ].uiNumBits = m_WriteBuffer.GetBitsInBuffer();
+
+	m_uiWriteIndex.store( uiWrite + 1, std::memory_order_release );
+}
+
+CNetworkBuffer* CLoopbackQueue::BeginRead()
+{
+	const size_t uiRead = m_uiReadIndex.load( std::memory_order_relaxed );
+
+	if( uiRead == m_uiWriteIndex.load( std::memory_order_acquire ) )
+		return nullptr;
+
+	auto& slot = m_Slots[ uiRead & ( NUM_SLOTS - 1 ) ];
+
+	m_ReadBuffer.SetBuffer( m_pszDebugName, slot.data, BitByte( slot.uiNumBits ) );
+
+	return &m_ReadBuffer;
+}
+
+void CLoopbackQueue::EndRead()
+{
+	m_uiReadIndex.store( m_uiReadIndex.load( std::memory_order_relaxed ) + 1, std::memory_order_release );
+}
@@ -0,0 +1,94 @@
+#ifndef COMMON_CLOOPBACKQUEUE_H
+#define COMMON_CLOOPBACKQUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "CNetworkBuffer.h"
+
+/**
+*	Lock-free queue of network messages between two threads in the same process, used in place of a socket between a local server and client.
+*	Has one writing thread and one reading thread. Messages are written and read in place in a fixed ring of slots,
+*	so nothing is allocated or copied once the queue is created. If the reader falls behind and the ring fills up, new messages are dropped.
+*/
+class CLoopbackQueue final
+{
+public:
+	/**
+	*	Number of messages the queue can hold. Must be a power of 2.
+	*/
+	static const size_t NUM_SLOTS = 64;
+
+	/**
+	*	Largest message, in bytes.
+	*/
+	static const size_t MAX_MESSAGE_SIZE = 4096;
+
+public:
+	/**
+	*	@param pszDebugName Debug name of the messages' buffers. Must point to a static string.
+	*/
+	CLoopbackQueue( const char* pszDebugName );
+
+	/**
+	*	Starts writing a message. Only used by the writing thread.
+	*	@return Buffer to write the message to, or null if the queue is full. Valid until EndWrite.
+	*/
+	CNetworkBuffer* BeginWrite();
+
+	/**
+	*	Makes the message started by BeginWrite visible to the reader. Messages that overflowed are dropped.
+	*/
+	void EndWrite();
+
+	/**
+	*	Starts reading the oldest message. Only used by the reading thread.
+	*	@return Buffer to read the message from, or null if the queue is empty. Valid until EndRead.
+	*/
+	CNetworkBuffer* BeginRead();
+
+	/**
+	*	Frees the message started by BeginRead.
+	*/
+	void EndRead();
+
+	/**
+	*	@return Number of messages dropped because the queue was full or the message overflowed.
+	*/
+	uint64_t GetDroppedCount() const { return m_uiDropped.load( std::memory_order_relaxed ); }
+
+private:
+	struct Slot_t
+	{
+		/**
+		*	Bits written to the message.
+		*/
+		size_t uiNumBits = 0;
+
+		//CNetworkBuffer accesses whole dwords.
+		alignas( 4 ) uint8_t data[ MAX_MESSAGE_SIZE ];
+	};
+
+private:
+	const char* const m_pszDebugName;
+
+	std::unique_ptr<Slot_t[]> m_Slots;
+
+	//Written by the reader and the writer respectively, so they're kept on separate cache lines.
+	alignas( 64 ) std::atomic<size_t> m_uiReadIndex{ 0 };
+	alignas( 64 ) std::atomic<size_t> m_uiWriteIndex{ 0 };
+
+	std::atomic<uint64_t> m_uiDropped{ 0 };
+
+	//Only used by the thread that owns each side.
+	CNetworkBuffer m_WriteBuffer;
+	CNetworkBuffer m_ReadBuffer;
+
+private:
+	CLoopbackQueue( const CLoopbackQueue& ) = delete;
+	CLoopbackQueue& operator=( const CLoopbackQueue& ) = delete;
+};
+
+#endif //COMMON_CLOOPBACKQUEUE_H
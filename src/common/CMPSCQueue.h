@@ -0,0 +1,238 @@
+#ifndef COMMON_CMPSCQUEUE_H
+#define COMMON_CMPSCQUEUE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "CQueueSignal.h"
+
+/**
+*	Bounded lock-free queue with any number of producer threads and a single consumer thread.
+*	Values are stored in a fixed ring that is allocated once. Each slot has a sequence number that says whether it is free or holds a value,
+*	so producers claim a slot with a single compare and swap and never wait for each other, and the consumer never needs one.
+*	Values pushed by the same thread are popped in the order they were pushed.
+*	Pushing never blocks: if the ring is full, the value isn't pushed. Popping can either return immediately or wait for a value.
+*	@tparam T Type of the values. Must be nothrow move constructible.
+*/
+template<typename T>
+class CMPSCQueue final
+{
+public:
+	static_assert( std::is_nothrow_move_constructible<T>::value, "CMPSCQueue: values must be nothrow move constructible" );
+
+	/**
+	*	@param uiCapacity Number of values the queue can hold. Rounded up to a power of 2.
+	*/
+	explicit CMPSCQueue( const size_t uiCapacity );
+	~CMPSCQueue();
+
+	size_t GetCapacity() const { return m_uiMask + 1; }
+
+	/**
+	*	Pushes a value. Can be called from any thread.
+	*	@return Whether the value was pushed. False if the queue is full, in which case the value isn't moved from.
+	*/
+	bool TryPush( T&& value )
+	{
+		return TryEmplace( std::move( value ) );
+	}
+
+	bool TryPush( const T& value )
+	{
+		return TryEmplace( value );
+	}
+
+	/**
+	*	Constructs a value in place. Can be called from any thread.
+	*	@return Whether the value was pushed. False if the queue is full.
+	*/
+	template<typename... ARGS>
+	bool TryEmplace( ARGS&&... args );
+
+	/**
+	*	Pops the oldest value. Only called by the consumer.
+	*	@return Whether a value was popped. False if the queue is empty, or the oldest value is still being pushed.
+	*/
+	bool TryPop( T& value );
+
+	/**
+	*	Pops the oldest value, waiting until one is pushed or the queue is closed. Only called by the consumer.
+	*	@return Whether a value was popped. False if the queue is closed and empty.
+	*/
+	bool Pop( T& value );
+
+	/**
+	*	Pops the oldest value, waiting at most the given time for one to be pushed. Only called by the consumer.
+	*	@return Whether a value was popped.
+	*/
+	bool Pop( T& value, const std::chrono::milliseconds timeout );
+
+	/**
+	*	Wakes up the consumer and makes Pop return false once the queue is empty. Can be called from any thread.
+	*	Values can still be pushed, and are popped as usual.
+	*/
+	void Close() { m_Signal.Close(); }
+
+	bool IsClosed() const { return m_Signal.IsClosed(); }
+
+private:
+	struct Slot_t
+	{
+		/**
+		*	Equal to the slot's position when it is free, and its position + 1 once it holds a value.
+		*/
+		std::atomic<size_t> sequence;
+
+		typename std::aligned_storage<sizeof( T ), alignof( T )>::type storage;
+
+		T* GetValue() { return reinterpret_cast<T*>( &storage ); }
+	};
+
+	bool IsReady()
+	{
+		const size_t uiReadIndex = m_uiReadIndex;
+
+		return m_Slots[ uiReadIndex & m_uiMask ].sequence.load( std::memory_order_seq_cst ) == uiReadIndex + 1;
+	}
+
+private:
+	const size_t m_uiMask;
+
+	std::unique_ptr<Slot_t[]> m_Slots;
+
+	//Claimed by producers.
+	alignas( 64 ) std::atomic<size_t> m_uiWriteIndex{ 0 };
+
+	//Only used by the consumer. Producers find out whether the ring is full from the slots.
+	alignas( 64 ) size_t m_uiReadIndex = 0;
+
+	alignas( 64 ) CQueueSignal m_Signal;
+
+private:
+	CMPSCQueue( const CMPSCQueue& ) = delete;
+	CMPSCQueue& operator=( const CMPSCQueue& ) = delete;
+};
+
+template<typename T>
+CMPSCQueue<T>::CMPSCQueue( const size_t uiCapacity )
+	: m_uiMask( CQueueSignal::RoundUpCapacity( uiCapacity ) - 1 )
+	, m_Slots( new Slot_t[ m_uiMask + 1 ] )
+{
+	for( size_t uiIndex = 0; uiIndex <= m_uiMask; ++uiIndex )
+	{
+		m_Slots[ uiIndex ].sequence.store( uiIndex, std::memory_order_relaxed );
+	}
+}
+
+template<typename T>
+CMPSCQueue<T>::~CMPSCQueue()
+{
+	for( size_t uiIndex = m_uiReadIndex; ; ++uiIndex )
+	{
+		auto& slot = m_Slots[ uiIndex & m_uiMask ];
+
+		if( slot.sequence.load( std::memory_order_relaxed ) != uiIndex + 1 )
+			break;
+
+		slot.GetValue()->~T();
+	}
+}
+
+template<typename T>
+template<typename... ARGS>
+bool CMPSCQueue<T>::TryEmplace( ARGS&&... args )
+{
+	size_t uiWriteIndex = m_uiWriteIndex.load( std::memory_order_relaxed );
+
+	Slot_t* pSlot;
+
+	for( ;; )
+	{
+		pSlot = &m_Slots[ uiWriteIndex & m_uiMask ];
+
+		const size_t uiSequence = pSlot->sequence.load( std::memory_order_acquire );
+
+		const auto iDifference = static_cast<ptrdiff_t>( uiSequence - uiWriteIndex );
+
+		if( iDifference == 0 )
+		{
+			if( m_uiWriteIndex.compare_exchange_weak( uiWriteIndex, uiWriteIndex + 1, std::memory_order_relaxed ) )
+				break;
+		}
+		else if( iDifference < 0 )
+		{
+			//The slot still holds the value from a lap ago.
+			return false;
+		}
+		else
+		{
+			//Another producer claimed it first.
+			uiWriteIndex = m_uiWriteIndex.load( std::memory_order_relaxed );
+		}
+	}
+
+	new ( pSlot->GetValue() ) T( std::forward<ARGS>( args )... );
+
+	//Sequentially consistent so the consumer either sees the value or is seen waiting.
+	pSlot->sequence.store( uiWriteIndex + 1, std::memory_order_seq_cst );
+
+	m_Signal.Notify();
+
+	return true;
+}
+
+template<typename T>
+bool CMPSCQueue<T>::TryPop( T& value )
+{
+	const size_t uiReadIndex = m_uiReadIndex;
+
+	auto& slot = m_Slots[ uiReadIndex & m_uiMask ];
+
+	if( slot.sequence.load( std::memory_order_acquire ) != uiReadIndex + 1 )
+		return false;
+
+	T* pValue = slot.GetValue();
+
+	value = std::move( *pValue );
+	pValue->~T();
+
+	//Free the slot for the producer that will claim it on the next lap.
+	slot.sequence.store( uiReadIndex + m_uiMask + 1, std::memory_order_release );
+
+	m_uiReadIndex = uiReadIndex + 1;
+
+	return true;
+}
+
+template<typename T>
+bool CMPSCQueue<T>::Pop( T& value )
+{
+	while( !TryPop( value ) )
+	{
+		if( !m_Signal.Wait( [ this ]() { return IsReady(); } ) )
+			return TryPop( value );
+	}
+
+	return true;
+}
+
+template<typename T>
+bool CMPSCQueue<T>::Pop( T& value, const std::chrono::milliseconds timeout )
+{
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+	while( !TryPop( value ) )
+	{
+		if( !m_Signal.WaitUntil( [ this ]() { return IsReady(); }, deadline ) )
+			return TryPop( value );
+	}
+
+	return true;
+}
+
+#endif //COMMON_CMPSCQUEUE_H
@@ -0,0 +1,115 @@
+#include <limits>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "CLargePageBuffer.h"
+
+#include "CMappedFile.h"
+
+bool CMappedFile::Open( const char* pszFileName, const bool bLargePages )
+{
+	Close();
+
+	if( !pszFileName )
+		return false;
+
+#ifdef WIN32
+	m_hFile = CreateFileA( pszFileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr );
+
+	if( m_hFile == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER size;
+
+	//Empty files can't be mapped.
+	if( !GetFileSizeEx( m_hFile, &size ) || size.QuadPart <= 0 ||
+		static_cast<uint64_t>( size.QuadPart ) > std::numeric_limits<size_t>::max() )
+	{
+		Close();
+		return false;
+	}
+
+	m_hMapping = CreateFileMappingA( m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr );
+
+	if( !m_hMapping )
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = reinterpret_cast<const uint8_t*>( MapViewOfFile( m_hMapping, FILE_MAP_READ, 0, 0, 0 ) );
+
+	if( !m_pData )
+	{
+		Close();
+		return false;
+	}
+
+	m_uiSize = static_cast<uint64_t>( size.QuadPart );
+
+	//Views of files can't use large pages on Windows.
+	( void ) bLargePages;
+#else
+	const int fd = open( pszFileName, O_RDONLY );
+
+	if( fd == -1 )
+		return false;
+
+	struct stat64 buffer{};
+
+	//Empty files can't be mapped.
+	if( fstat64( fd, &buffer ) == -1 || buffer.st_size <= 0 ||
+		static_cast<uint64_t>( buffer.st_size ) > std::numeric_limits<size_t>::max() )
+	{
+		close( fd );
+		return false;
+	}
+
+	void* pData = mmap( nullptr, static_cast<size_t>( buffer.st_size ), PROT_READ, MAP_PRIVATE, fd, 0 );
+
+	//The mapping keeps its own reference to the file.
+	close( fd );
+
+	if( pData == MAP_FAILED )
+		return false;
+
+	m_pData = reinterpret_cast<const uint8_t*>( pData );
+	m_uiSize = static_cast<uint64_t>( buffer.st_size );
+
+	//Only a hint, the kernel falls back to regular pages if it doesn't support huge pages for files.
+	if( bLargePages )
+		Plat_AdviseLargePages( pData, static_cast<size_t>( m_uiSize ) );
+#endif
+
+	return true;
+}
+
+void CMappedFile::Close()
+{
+#ifdef WIN32
+	if( m_pData )
+		UnmapViewOfFile( m_pData );
+
+	if( m_hMapping )
+	{
+		CloseHandle( m_hMapping );
+		m_hMapping = nullptr;
+	}
+
+	if( m_hFile != INVALID_HANDLE_VALUE )
+	{
+		CloseHandle( m_hFile );
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+#else
+	if( m_pData )
+		munmap( const_cast<uint8_t*>( m_pData ), static_cast<size_t>( m_uiSize ) );
+#endif
+
+	m_pData = nullptr;
+	m_uiSize = 0;
+}
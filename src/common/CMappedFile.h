@@ -0,0 +1,72 @@
+#ifndef COMMON_CMAPPEDFILE_H
+#define COMMON_CMAPPEDFILE_H
+
+#include <cstdint>
+
+#include "Platform.h"
+
+/**
+*	A read-only memory mapping of an entire file.
+*	Used to serve pack file entries and to play demos without going through stdio.
+*/
+class CMappedFile
+{
+public:
+	/**
+	*	Constructs a mapping that maps no file.
+	*/
+	CMappedFile() = default;
+
+	~CMappedFile()
+	{
+		Close();
+	}
+
+	/**
+	*	Maps the given file into memory. Any previously mapped file is unmapped first.
+	*	@param pszFileName Name of the file to map.
+	*	@param bLargePages Whether to ask the OS to back the mapping with huge pages. Only a hint, and only honoured on Linux.
+	*	@return Whether the file was successfully mapped.
+	*/
+	bool Open( const char* pszFileName, const bool bLargePages = false );
+
+	/**
+	*	Unmaps the file, if one is mapped.
+	*/
+	void Close();
+
+	bool IsOpen() const { return m_pData != nullptr; }
+
+	/**
+	*	@return Pointer to the start of the mapped file.
+	*/
+	const uint8_t* GetData() const { return m_pData; }
+
+	/**
+	*	@return Size of the mapped file, in bytes.
+	*/
+	uint64_t GetSize() const { return m_uiSize; }
+
+	/**
+	*	@return Whether the given range lies within the mapped file.
+	*/
+	bool IsValidRange( uint64_t uiOffset, uint64_t uiLength ) const
+	{
+		return uiOffset <= m_uiSize && uiLength <= m_uiSize - uiOffset;
+	}
+
+private:
+	const uint8_t* m_pData = nullptr;
+	uint64_t m_uiSize = 0;
+
+#ifdef WIN32
+	HANDLE m_hFile = INVALID_HANDLE_VALUE;
+	HANDLE m_hMapping = nullptr;
+#endif
+
+private:
+	CMappedFile( const CMappedFile& ) = delete;
+	CMappedFile& operator=( const CMappedFile& ) = delete;
+};
+
+#endif //COMMON_CMAPPEDFILE_H
@@ -0,0 +1,350 @@
+#include <algorithm>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+
+#include "Logging.h"
+
+#include "CMetricsRegistry.h"
+
+namespace
+{
+void AtomicAdd( std::atomic<double>& value, const double flValue )
+{
+	double flOld = value.load( std::memory_order_relaxed );
+
+	while( !value.compare_exchange_weak( flOld, flOld + flValue, std::memory_order_relaxed ) )
+	{
+	}
+}
+
+void AppendNumber( std::string& szText, const double flValue )
+{
+	if( std::isnan( flValue ) )
+	{
+		szText += "NaN";
+		return;
+	}
+
+	if( std::isinf( flValue ) )
+	{
+		szText += flValue > 0 ? "+Inf" : "-Inf";
+		return;
+	}
+
+	char szBuffer[ 32 ];
+
+	snprintf( szBuffer, sizeof( szBuffer ), "%.15g", flValue );
+
+	szText += szBuffer;
+}
+
+void AppendInteger( std::string& szText, const uint64_t uiValue )
+{
+	char szBuffer[ 32 ];
+
+	snprintf( szBuffer, sizeof( szBuffer ), "%" PRIu64, uiValue );
+
+	szText += szBuffer;
+}
+
+/**
+*	Appends a metric's name and labels. pszExtraLabel is added after the labels, if given.
+*/
+void AppendSeries( std::string& szText, const std::string& szName, const char* pszSuffix, const std::string& szLabels, const char* pszExtraLabel = nullptr )
+{
+	szText += szName;
+	szText += pszSuffix;
+
+	if( !szLabels.empty() || pszExtraLabel )
+	{
+		szText += '{';
+		szText += szLabels;
+
+		if( pszExtraLabel )
+		{
+			if( !szLabels.empty() )
+				szText += ',';
+
+			szText += pszExtraLabel;
+		}
+
+		szText += '}';
+	}
+
+	szText += ' ';
+}
+
+const char* GetTypeName( const CMetricsRegistry::MetricType type )
+{
+	switch( type )
+	{
+	case CMetricsRegistry::MetricType::COUNTER:		return "counter";
+	case CMetricsRegistry::MetricType::GAUGE:		return "gauge";
+	case CMetricsRegistry::MetricType::HISTOGRAM:	return "histogram";
+
+	default:										return "untyped";
+	}
+}
+}
+
+void CMetricGauge::Add( const double flValue )
+{
+	AtomicAdd( m_flValue, flValue );
+}
+
+CMetricHistogram::CMetricHistogram( const double* pflBounds, const size_t uiCount )
+	: m_Bounds( pflBounds, pflBounds + uiCount )
+	, m_Buckets( new std::atomic<uint64_t>[ uiCount + 1 ] )
+{
+	for( size_t uiIndex = 0; uiIndex <= uiCount; ++uiIndex )
+	{
+		m_Buckets[ uiIndex ].store( 0, std::memory_order_relaxed );
+	}
+}
+
+void CMetricHistogram::Observe( const double flValue )
+{
+	//Bounds are inclusive.
+	const size_t uiBucket = std::lower_bound( m_Bounds.begin(), m_Bounds.end(), flValue ) - m_Bounds.begin();
+
+	m_Buckets[ uiBucket ].fetch_add( 1, std::memory_order_relaxed );
+
+	AtomicAdd( m_flSum, flValue );
+}
+
+CMetricCounter* CMetricsRegistry::AddCounter( const char* pszName, const char* pszHelp, const char* pszLabels, const double flScale )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	Family_t* pFamily;
+
+	if( auto pMetric = FindMetric( pszName, pszHelp, MetricType::COUNTER, pszLabels, pFamily ) )
+		return static_cast<CMetricCounter*>( pMetric );
+
+	m_Counters.emplace_back( flScale );
+
+	auto pCounter = &m_Counters.back();
+
+	if( pFamily )
+		pFamily->metrics.push_back( { pszLabels, pCounter } );
+
+	return pCounter;
+}
+
+CMetricGauge* CMetricsRegistry::AddGauge( const char* pszName, const char* pszHelp, const char* pszLabels )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	Family_t* pFamily;
+
+	if( auto pMetric = FindMetric( pszName, pszHelp, MetricType::GAUGE, pszLabels, pFamily ) )
+		return static_cast<CMetricGauge*>( pMetric );
+
+	m_Gauges.emplace_back();
+
+	auto pGauge = &m_Gauges.back();
+
+	if( pFamily )
+		pFamily->metrics.push_back( { pszLabels, pGauge } );
+
+	return pGauge;
+}
+
+CMetricHistogram* CMetricsRegistry::AddHistogram( const char* pszName, const char* pszHelp, const double* pflBounds, const size_t uiCount, const char* pszLabels )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	Family_t* pFamily;
+
+	if( auto pMetric = FindMetric( pszName, pszHelp, MetricType::HISTOGRAM, pszLabels, pFamily ) )
+		return static_cast<CMetricHistogram*>( pMetric );
+
+	m_Histograms.emplace_back( pflBounds, uiCount );
+
+	auto pHistogram = &m_Histograms.back();
+
+	if( pFamily )
+		pFamily->metrics.push_back( { pszLabels, pHistogram } );
+
+	return pHistogram;
+}
+
+void CMetricsRegistry::AddCollector( Collector_t collector, void* pContext )
+{
+	std::lock_guard<std::mutex> lock( m_CollectorMutex );
+
+	m_Collectors.push_back( { collector, pContext } );
+}
+
+void CMetricsRegistry::RemoveCollector( Collector_t collector, void* pContext )
+{
+	std::lock_guard<std::mutex> lock( m_CollectorMutex );
+
+	m_Collectors.erase( std::remove_if( m_Collectors.begin(), m_Collectors.end(),
+		[ & ]( const CollectorEntry_t& entry )
+		{
+			return entry.collector == collector && entry.pContext == pContext;
+		}
+	), m_Collectors.end() );
+}
+
+void CMetricsRegistry::WriteText( std::string& szText )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_CollectorMutex );
+
+		for( const auto& entry : m_Collectors )
+		{
+			entry.collector( *this, entry.pContext );
+		}
+	}
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	std::string szLabel;
+
+	for( const auto& family : m_Families )
+	{
+		if( family.metrics.empty() )
+			continue;
+
+		szText += "# HELP ";
+		szText += family.szName;
+		szText += ' ';
+
+		for( const char* pszChar = family.szHelp.c_str(); *pszChar; ++pszChar )
+		{
+			switch( *pszChar )
+			{
+			case '\\':	szText += "\\\\"; break;
+			case '\n':	szText += "\\n"; break;
+			default:	szText += *pszChar; break;
+			}
+		}
+
+		szText += "\n# TYPE ";
+		szText += family.szName;
+		szText += ' ';
+		szText += GetTypeName( family.type );
+		szText += '\n';
+
+		for( const auto& metric : family.metrics )
+		{
+			switch( family.type )
+			{
+			case MetricType::COUNTER:
+				{
+					const auto pCounter = static_cast<const CMetricCounter*>( metric.pMetric );
+
+					AppendSeries( szText, family.szName, "", metric.szLabels );
+
+					if( pCounter->GetScale() == 1 )
+						AppendInteger( szText, pCounter->Get() );
+					else
+						AppendNumber( szText, pCounter->Get() * pCounter->GetScale() );
+
+					szText += '\n';
+					break;
+				}
+
+			case MetricType::GAUGE:
+				{
+					AppendSeries( szText, family.szName, "", metric.szLabels );
+					AppendNumber( szText, static_cast<const CMetricGauge*>( metric.pMetric )->Get() );
+					szText += '\n';
+					break;
+				}
+
+			case MetricType::HISTOGRAM:
+				{
+					const auto pHistogram = static_cast<const CMetricHistogram*>( metric.pMetric );
+
+					//Buckets are exported as cumulative counts. The count is their total, so it's consistent with them while observations are added.
+					uint64_t uiTotal = 0;
+
+					for( size_t uiIndex = 0; uiIndex <= pHistogram->GetBoundCount(); ++uiIndex )
+					{
+						uiTotal += pHistogram->GetBucket( uiIndex );
+
+						szLabel = "le=\"";
+						AppendNumber( szLabel, uiIndex < pHistogram->GetBoundCount() ? pHistogram->GetBound( uiIndex ) : INFINITY );
+						szLabel += '"';
+
+						AppendSeries( szText, family.szName, "_bucket", metric.szLabels, szLabel.c_str() );
+						AppendInteger( szText, uiTotal );
+						szText += '\n';
+					}
+
+					AppendSeries( szText, family.szName, "_sum", metric.szLabels );
+					AppendNumber( szText, pHistogram->GetSum() );
+					szText += '\n';
+
+					AppendSeries( szText, family.szName, "_count", metric.szLabels );
+					AppendInteger( szText, uiTotal );
+					szText += '\n';
+					break;
+				}
+			}
+		}
+	}
+}
+
+void CMetricsRegistry::FormatLabel( std::string& szLabels, const char* pszName, const char* pszValue )
+{
+	if( !szLabels.empty() )
+		szLabels += ',';
+
+	szLabels += pszName;
+	szLabels += "=\"";
+
+	for( ; *pszValue; ++pszValue )
+	{
+		switch( *pszValue )
+		{
+		case '\\':	szLabels += "\\\\"; break;
+		case '"':	szLabels += "\\\""; break;
+		case '\n':	szLabels += "\\n"; break;
+		default:	szLabels += *pszValue; break;
+		}
+	}
+
+	szLabels += '"';
+}
+
+void* CMetricsRegistry::FindMetric( const char* pszName, const char* pszHelp, const MetricType type, const char* pszLabels, Family_t*& pFamily )
+{
+	auto it = m_FamilyIndices.find( pszName );
+
+	if( it == m_FamilyIndices.end() )
+	{
+		m_FamilyIndices.emplace( pszName, m_Families.size() );
+
+		m_Families.push_back( { pszName, pszHelp, type, {} } );
+
+		pFamily = &m_Families.back();
+
+		return nullptr;
+	}
+
+	auto& family = m_Families[ it->second ];
+
+	if( family.type != type )
+	{
+		Warning( "Metric \"%s\" is a %s, not a %s; it won't be exported\n", pszName, GetTypeName( family.type ), GetTypeName( type ) );
+
+		pFamily = nullptr;
+
+		return nullptr;
+	}
+
+	pFamily = &family;
+
+	for( const auto& metric : family.metrics )
+	{
+		if( metric.szLabels == pszLabels )
+			return metric.pMetric;
+	}
+
+	return nullptr;
+}
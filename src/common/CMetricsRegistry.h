@@ -0,0 +1,230 @@
+#ifndef COMMON_CMETRICSREGISTRY_H
+#define COMMON_CMETRICSREGISTRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+*	Counter that only goes up, until the process restarts.
+*	Updates are a single relaxed atomic add, so they're safe and cheap on any thread.
+*/
+class CMetricCounter final
+{
+public:
+	/**
+	*	@param flScale Factor that the value is multiplied by when it's exported, e.g. 1e-6 to export microseconds as seconds.
+	*/
+	explicit CMetricCounter( const double flScale = 1 )
+		: m_flScale( flScale )
+	{
+	}
+
+	void Add( const uint64_t uiValue = 1 ) { m_uiValue.fetch_add( uiValue, std::memory_order_relaxed ); }
+
+	/**
+	*	Sets the value, for publishing a total that is counted elsewhere.
+	*/
+	void Set( const uint64_t uiValue ) { m_uiValue.store( uiValue, std::memory_order_relaxed ); }
+
+	uint64_t Get() const { return m_uiValue.load( std::memory_order_relaxed ); }
+
+	double GetScale() const { return m_flScale; }
+
+private:
+	std::atomic<uint64_t> m_uiValue{ 0 };
+
+	const double m_flScale;
+
+private:
+	CMetricCounter( const CMetricCounter& ) = delete;
+	CMetricCounter& operator=( const CMetricCounter& ) = delete;
+};
+
+/**
+*	Value that can go up and down. Safe to use on any thread.
+*/
+class CMetricGauge final
+{
+public:
+	CMetricGauge() = default;
+
+	void Set( const double flValue ) { m_flValue.store( flValue, std::memory_order_relaxed ); }
+
+	void Add( const double flValue );
+
+	double Get() const { return m_flValue.load( std::memory_order_relaxed ); }
+
+private:
+	std::atomic<double> m_flValue{ 0 };
+
+private:
+	CMetricGauge( const CMetricGauge& ) = delete;
+	CMetricGauge& operator=( const CMetricGauge& ) = delete;
+};
+
+/**
+*	Counts observations in buckets with fixed upper bounds, and keeps their sum.
+*	Observing is a scan of the bounds and two relaxed atomic updates. Safe to use on any thread.
+*/
+class CMetricHistogram final
+{
+public:
+	/**
+	*	@param pflBounds Upper bounds of the buckets, in increasing order. Values above the last bound go in an implicit +Inf bucket.
+	*/
+	CMetricHistogram( const double* pflBounds, const size_t uiCount );
+
+	void Observe( const double flValue );
+
+	size_t GetBoundCount() const { return m_Bounds.size(); }
+
+	double GetBound( const size_t uiIndex ) const { return m_Bounds[ uiIndex ]; }
+
+	/**
+	*	@param uiIndex Index of the bucket. GetBoundCount() is the +Inf bucket.
+	*	@return Number of observations in the bucket, not counting lower buckets.
+	*/
+	uint64_t GetBucket( const size_t uiIndex ) const { return m_Buckets[ uiIndex ].load( std::memory_order_relaxed ); }
+
+	double GetSum() const { return m_flSum.load( std::memory_order_relaxed ); }
+
+private:
+	const std::vector<double> m_Bounds;
+
+	std::unique_ptr<std::atomic<uint64_t>[]> m_Buckets;
+
+	std::atomic<double> m_flSum{ 0 };
+
+private:
+	CMetricHistogram( const CMetricHistogram& ) = delete;
+	CMetricHistogram& operator=( const CMetricHistogram& ) = delete;
+};
+
+/**
+*	Registry of named metrics, exported in the Prometheus text format.
+*	Metrics are created once and updated through the returned pointer, which stays valid for the registry's lifetime,
+*	so updates never touch the registry or take a lock. The lock is only taken to register metrics and to export them.
+*	Subsystems that already count things can register a collector instead, which publishes their counters when metrics are exported.
+*/
+class CMetricsRegistry final
+{
+public:
+	/**
+	*	Called when metrics are exported, on the thread that exports them.
+	*	May register metrics, but must not add or remove collectors.
+	*/
+	using Collector_t = void ( * )( CMetricsRegistry& registry, void* pContext );
+
+	enum class MetricType
+	{
+		COUNTER,
+		GAUGE,
+		HISTOGRAM
+	};
+
+public:
+	CMetricsRegistry() = default;
+
+	/**
+	*	Gets a counter, creating it if it doesn't exist yet.
+	*	@param pszName Name of the metric. Counter names should end in _total.
+	*	@param pszHelp Description of the metric. Only the first registration's description is used.
+	*	@param pszLabels Labels that tell the metric apart from others with the same name, as made by FormatLabel and separated by commas.
+	*	@param flScale Factor that the value is multiplied by when it's exported.
+	*	@return The counter. If the name is used by a metric of another type, the counter is valid but isn't exported.
+	*/
+	CMetricCounter* AddCounter( const char* pszName, const char* pszHelp, const char* pszLabels = "", const double flScale = 1 );
+
+	/**
+	*	@see AddCounter
+	*/
+	CMetricGauge* AddGauge( const char* pszName, const char* pszHelp, const char* pszLabels = "" );
+
+	/**
+	*	@param pflBounds Upper bounds of the buckets. Ignored if the histogram already exists.
+	*	@see AddCounter
+	*/
+	CMetricHistogram* AddHistogram( const char* pszName, const char* pszHelp, const double* pflBounds, const size_t uiCount, const char* pszLabels = "" );
+
+	void AddCollector( Collector_t collector, void* pContext );
+
+	/**
+	*	Removes a collector. Waits for it to return if metrics are being exported.
+	*/
+	void RemoveCollector( Collector_t collector, void* pContext );
+
+	/**
+	*	Runs the collectors, and appends all metrics in the Prometheus text exposition format, version 0.0.4.
+	*/
+	void WriteText( std::string& szText );
+
+	/**
+	*	Appends a label, escaping its value.
+	*/
+	static void FormatLabel( std::string& szLabels, const char* pszName, const char* pszValue );
+
+private:
+	struct Metric_t
+	{
+		std::string szLabels;
+
+		void* pMetric;
+	};
+
+	struct Family_t
+	{
+		std::string szName;
+		std::string szHelp;
+
+		MetricType type;
+
+		std::vector<Metric_t> metrics;
+	};
+
+	struct CollectorEntry_t
+	{
+		Collector_t collector;
+		void* pContext;
+	};
+
+	/**
+	*	Finds a metric, or the family that it should be added to, creating the family if needed. Must be called with the lock held.
+	*	@param[ out ] pFamily The family, or null if the name is used by another type.
+	*	@return The metric, or null if it doesn't exist yet or the name is used by another type.
+	*/
+	void* FindMetric( const char* pszName, const char* pszHelp, const MetricType type, const char* pszLabels, Family_t*& pFamily );
+
+private:
+	/**
+	*	Guards the families and metric storage.
+	*/
+	std::mutex m_Mutex;
+
+	std::vector<Family_t> m_Families;
+	std::unordered_map<std::string, size_t> m_FamilyIndices;
+
+	//Deques don't move their elements, so metrics can be handed out.
+	std::deque<CMetricCounter> m_Counters;
+	std::deque<CMetricGauge> m_Gauges;
+	std::deque<CMetricHistogram> m_Histograms;
+
+	/**
+	*	Guards the collectors, and is held while they run.
+	*/
+	std::mutex m_CollectorMutex;
+
+	std::vector<CollectorEntry_t> m_Collectors;
+
+private:
+	CMetricsRegistry( const CMetricsRegistry& ) = delete;
+	CMetricsRegistry& operator=( const CMetricsRegistry& ) = delete;
+};
+
+#endif //COMMON_CMETRICSREGISTRY_H
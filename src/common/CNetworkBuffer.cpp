@@ -6,9 +6,28 @@
 
 #include "CNetworkBuffer.h"
 
+#if defined( __SSE2__ ) || defined( _M_X64 ) || ( defined( _M_IX86_FP ) && _M_IX86_FP >= 2 )
+#include <emmintrin.h>
+
+#define NETWORKBUFFER_SSE2
+#endif
+
 static unsigned int BitWriteMasks[ 32 ][ 33 ];
 static unsigned int ExtraMasks[ 32 ];
 
+static inline uint32_t LoadDWord( const uint8_t* pBytes )
+{
+	return pBytes[ 0 ] | ( pBytes[ 1 ] << 8 ) | ( pBytes[ 2 ] << 16 ) | ( static_cast<uint32_t>( pBytes[ 3 ] ) << 24 );
+}
+
+static inline void StoreDWord( uint8_t* pBytes, const uint32_t uiValue )
+{
+	pBytes[ 0 ] = static_cast<uint8_t>( uiValue );
+	pBytes[ 1 ] = static_cast<uint8_t>( uiValue >> 8 );
+	pBytes[ 2 ] = static_cast<uint8_t>( uiValue >> 16 );
+	pBytes[ 3 ] = static_cast<uint8_t>( uiValue >> 24 );
+}
+
 void CNetworkBuffer::InitMasks()
 {
 	unsigned int startbit, endbit;
@@ -164,39 +183,55 @@ void CNetworkBuffer::WriteSignedBitLong( int iValue, const size_t uiNumBits )
 bool CNetworkBuffer::WriteBits( const void* pData, const size_t uiNumBits )
 {
 	auto pOut = ( const uint8_t* ) pData;
-	size_t uiBitsLeft = uiNumBits;
 
-	// get output dword-aligned.
-	while( ( ( unsigned int ) pOut & 3 ) != 0 && uiBitsLeft >= 8 )
-	{
-		WriteUnsignedBitLong( *pOut, 8 );
+	//Nothing is written if it doesn't all fit.
+	if( Overflow( uiNumBits ) )
+		return false;
 
-		uiBitsLeft -= 8;
-		++pOut;
-	}
+	const size_t uiNumBytes = uiNumBits >> 3;
 
-	// read dwords.
-	while( uiBitsLeft >= 32 )
+	if( ( m_uiCurrentBit & 7 ) == 0 )
 	{
-		WriteUnsignedBitLong( *( ( const unsigned int* ) pOut ), 32 );
+		memcpy( m_pData + ( m_uiCurrentBit >> 3 ), pOut, uiNumBytes );
 
-		pOut += sizeof( unsigned int );
-		uiBitsLeft -= 32;
+		m_uiCurrentBit += ByteBit( uiNumBytes );
 	}
-
-	// read the remaining bytes.
-	while( uiBitsLeft >= 8 )
+	else if( uiNumBytes > 0 )
 	{
-		WriteUnsignedBitLong( *pOut, 8 );
+		//Not byte aligned, each byte straddles two destination bytes. Shift a dword at a time, carrying the high bits over.
+		//The write ends before the end of the buffer's last byte, so the byte after the last one is in the buffer.
+		const size_t uiShift = m_uiCurrentBit & 7;
+		const uint8_t lowMask = static_cast<uint8_t>( ( 1 << uiShift ) - 1 );
 
-		uiBitsLeft -= 8;
-		++pOut;
+		uint8_t* pDest = m_pData + ( m_uiCurrentBit >> 3 );
+
+		uint32_t carry = pDest[ 0 ] & lowMask;
+
+		size_t uiByte = 0;
+
+		for( ; uiByte + 4 <= uiNumBytes; uiByte += 4 )
+		{
+			const uint32_t uiValue = LoadDWord( pOut + uiByte );
+
+			StoreDWord( pDest + uiByte, carry | ( uiValue << uiShift ) );
+			carry = uiValue >> ( 32 - uiShift );
+		}
+
+		for( ; uiByte < uiNumBytes; ++uiByte )
+		{
+			pDest[ uiByte ] = static_cast<uint8_t>( carry | ( pOut[ uiByte ] << uiShift ) );
+			carry = pOut[ uiByte ] >> ( 8 - uiShift );
+		}
+
+		pDest[ uiNumBytes ] = static_cast<uint8_t>( ( pDest[ uiNumBytes ] & ~lowMask ) | carry );
+
+		m_uiCurrentBit += ByteBit( uiNumBytes );
 	}
 
-	// Read the remaining bits.
-	if( uiBitsLeft )
+	// Write the remaining bits.
+	if( const size_t uiBitsLeft = uiNumBits & 7 )
 	{
-		WriteUnsignedBitLong( *pOut, uiBitsLeft );
+		WriteUnsignedBitLong( pOut[ uiNumBytes ], uiBitsLeft );
 	}
 
 	return !m_fOverflowed;
@@ -246,18 +281,71 @@ bool CNetworkBuffer::WriteBytes( const void* pData, const size_t uiNumBytes )
 
 bool CNetworkBuffer::WriteString( const char* pszString )
 {
+	//Characters are written as signed 8 bit values, which is bit-compatible with writing the string's bytes.
 	if( pszString )
+		return WriteBytes( pszString, strlen( pszString ) + 1 );
+
+	WriteChar( 0 );
+
+	return !m_fOverflowed;
+}
+
+void CNetworkBuffer::WriteVarInt32( uint32_t uiValue )
+{
+	//Gather the bytes first, so most values take a single write.
+	uint64_t uiBytes = 0;
+	size_t uiNumBits = 0;
+
+	while( uiValue >= 0x80 )
 	{
-		do
-		{
-			WriteChar( *pszString );
-		}
-		while( *pszString++ );
+		uiBytes |= static_cast<uint64_t>( ( uiValue & 0x7F ) | 0x80 ) << uiNumBits;
+		uiValue >>= 7;
+		uiNumBits += 8;
+	}
+
+	uiBytes |= static_cast<uint64_t>( uiValue ) << uiNumBits;
+	uiNumBits += 8;
+
+	//Check the whole varint up front, so an overflow doesn't leave part of it in the buffer.
+	if( Overflow( uiNumBits ) )
+		return;
+
+	if( uiNumBits <= 32 )
+	{
+		WriteUnsignedBitLong( static_cast<unsigned int>( uiBytes ), uiNumBits );
 	}
 	else
-		WriteChar( 0 );
+	{
+		WriteUnsignedBitLong( static_cast<unsigned int>( uiBytes ), 32 );
+		WriteUnsignedBitLong( static_cast<unsigned int>( uiBytes >> 32 ), uiNumBits - 32 );
+	}
+}
 
-	return !m_fOverflowed;
+void CNetworkBuffer::WriteGammaInt32( const uint32_t uiValue )
+{
+	const uint64_t uiCode = static_cast<uint64_t>( uiValue ) + 1;
+
+	//Number of bits after the leading one.
+	size_t uiNumBits = 0;
+
+	while( ( uiCode >> ( uiNumBits + 1 ) ) != 0 )
+		++uiNumBits;
+
+	if( Overflow( uiNumBits * 2 + 1 ) )
+		return;
+
+	const unsigned int uiLowBits = static_cast<unsigned int>( uiCode & ( ( static_cast<uint64_t>( 1 ) << uiNumBits ) - 1 ) );
+
+	//Values up to 65534 fit in a single write.
+	if( uiNumBits < 16 )
+	{
+		WriteUnsignedBitLong( ( 1U << uiNumBits ) | ( uiLowBits << ( uiNumBits + 1 ) ), uiNumBits * 2 + 1 );
+		return;
+	}
+
+	WriteUnsignedBitLong( 0, uiNumBits );
+	WriteOneBit( 1 );
+	WriteUnsignedBitLong( uiLowBits, uiNumBits );
 }
 
 bool CNetworkBuffer::PadToByte()
@@ -415,8 +503,49 @@ bool CNetworkBuffer::ReadBits( void* pBuffer, const size_t uiNumBits )
 	uint8_t *pOut = ( uint8_t* ) pBuffer;
 	size_t uiBitsLeft = uiNumBits;
 
+	if( !m_fOverflowed && !CheckOverflow( uiNumBits ) )
+	{
+		const size_t uiNumBytes = uiNumBits >> 3;
+
+		if( ( m_uiCurrentBit & 7 ) == 0 )
+		{
+			memcpy( pOut, m_pData + ( m_uiCurrentBit >> 3 ), uiNumBytes );
+
+			m_uiCurrentBit += ByteBit( uiNumBytes );
+		}
+		else
+		{
+			//Not byte aligned, each byte straddles two source bytes. Both are in the buffer, see WriteBits.
+			const size_t uiShift = m_uiCurrentBit & 7;
+
+			const uint8_t* pSource = m_pData + ( m_uiCurrentBit >> 3 );
+
+			size_t uiByte = 0;
+
+			for( ; uiByte + 4 <= uiNumBytes; uiByte += 4 )
+			{
+				StoreDWord( pOut + uiByte, static_cast<uint32_t>( ( LoadDWord( pSource + uiByte ) | ( static_cast<uint64_t>( pSource[ uiByte + 4 ] ) << 32 ) ) >> uiShift ) );
+			}
+
+			for( ; uiByte < uiNumBytes; ++uiByte )
+			{
+				pOut[ uiByte ] = static_cast<uint8_t>( ( pSource[ uiByte ] >> uiShift ) | ( pSource[ uiByte + 1 ] << ( 8 - uiShift ) ) );
+			}
+
+			m_uiCurrentBit += ByteBit( uiNumBytes );
+		}
+
+		if( const size_t uiExtraBits = uiNumBits & 7 )
+		{
+			pOut[ uiNumBytes ] = ReadUnsignedBitLong( uiExtraBits );
+		}
+
+		return true;
+	}
+
+	//Reads past the end take the long way around, since bytes read at the end of the message are 0 instead of overflowing.
 	// get output dword-aligned.
-	while( ( ( unsigned int ) pOut & 3 ) != 0 && uiBitsLeft >= 8 )
+	while( ( reinterpret_cast<uintptr_t>( pOut ) & 3 ) != 0 && uiBitsLeft >= 8 )
 	{
 		*pOut = ( uint8_t ) ReadUnsignedBitLong( 8 );
 		++pOut;
@@ -488,11 +617,53 @@ bool CNetworkBuffer::ReadBytes( void* pBuffer, const size_t uiNumBytes )
 	return ReadBits( pBuffer, uiNumBytes << 3 );
 }
 
+uint32_t CNetworkBuffer::ReadVarInt32()
+{
+	uint32_t uiValue = 0;
+
+	for( size_t uiShift = 0; uiShift < 35; uiShift += 7 )
+	{
+		const unsigned int uiByte = ReadUnsignedBitLong( 8 );
+
+		uiValue |= ( uiByte & 0x7F ) << uiShift;
+
+		if( !( uiByte & 0x80 ) )
+			break;
+	}
+
+	return uiValue;
+}
+
+uint32_t CNetworkBuffer::ReadGammaInt32()
+{
+	size_t uiNumBits = 0;
+
+	while( !ReadOneBit() )
+	{
+		//Also stops at the end of the buffer, since reads return 0 after overflowing.
+		if( ++uiNumBits > 32 || m_fOverflowed )
+		{
+			Overflow( GetBitsLeft() + 1 );
+			return 0;
+		}
+	}
+
+	if( uiNumBits == 0 )
+		return 0;
+
+	const uint64_t uiCode = ( static_cast<uint64_t>( 1 ) << uiNumBits ) | ReadUnsignedBitLong( uiNumBits );
+
+	return static_cast<uint32_t>( uiCode - 1 );
+}
+
 bool CNetworkBuffer::ReadString( char* pszBuffer, const size_t uiBufferSize, const bool fIsLine )
 {
 	assert( pszBuffer );
 	assert( uiBufferSize > 0 );
 
+	if( ( m_uiCurrentBit & 7 ) == 0 )
+		return ReadAlignedString( pszBuffer, uiBufferSize, fIsLine );
+
 	size_t uiLength = 0;
 
 	int c;
@@ -521,6 +692,73 @@ bool CNetworkBuffer::ReadString( char* pszBuffer, const size_t uiBufferSize, con
 	return ( *pszBuffer ) != '\0';
 }
 
+bool CNetworkBuffer::ReadAlignedString( char* pszBuffer, const size_t uiBufferSize, const bool fIsLine )
+{
+	const uint8_t* pSource = m_pData + ( m_uiCurrentBit >> 3 );
+
+	//The end of the message acts like a terminator that isn't read.
+	const size_t uiMaxLength = std::min( BitByte( m_uiMaxBits - m_uiCurrentBit ), uiBufferSize - 1 );
+
+	size_t uiLength = 0;
+
+	bool fTerminated = false;
+
+#ifdef NETWORKBUFFER_SSE2
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i newline = _mm_set1_epi8( fIsLine ? '\n' : '\0' );
+	const __m128i percent = _mm_set1_epi8( '%' );
+	const __m128i dot = _mm_set1_epi8( '.' );
+
+	for( ; uiLength + 16 <= uiMaxLength; uiLength += 16 )
+	{
+		__m128i chars = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSource + uiLength ) );
+
+		const int terminators = _mm_movemask_epi8( _mm_or_si128( _mm_cmpeq_epi8( chars, zero ), _mm_cmpeq_epi8( chars, newline ) ) );
+
+		const __m128i percents = _mm_cmpeq_epi8( chars, percent );
+
+		chars = _mm_or_si128( _mm_andnot_si128( percents, chars ), _mm_and_si128( percents, dot ) );
+
+		//All 16 bytes fit in the destination, anything past the terminator is overwritten by the terminator below.
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pszBuffer + uiLength ), chars );
+
+		if( terminators )
+		{
+			size_t uiIndex = 0;
+
+			while( !( terminators & ( 1 << uiIndex ) ) )
+				++uiIndex;
+
+			uiLength += uiIndex;
+			fTerminated = true;
+			break;
+		}
+	}
+#endif
+
+	for( ; !fTerminated && uiLength < uiMaxLength; ++uiLength )
+	{
+		const char c = static_cast<char>( pSource[ uiLength ] );
+
+		if( c == '\0' || ( fIsLine && c == '\n' ) )
+		{
+			fTerminated = true;
+			break;
+		}
+
+		// translate all fmt spec to avoid crash bugs
+		// NOTE: but game strings leave unchanged. see pfnWriteString for details
+		pszBuffer[ uiLength ] = c == '%' ? '.' : c;
+	}
+
+	pszBuffer[ uiLength ] = '\0';
+
+	//The terminator is read as well.
+	m_uiCurrentBit += ByteBit( fTerminated ? uiLength + 1 : uiLength );
+
+	return ( *pszBuffer ) != '\0';
+}
+
 bool CNetworkBuffer::ReadAndDiscardBits( const size_t uiNumBits )
 {
 	if( Overflow( uiNumBits ) )
@@ -534,4 +772,84 @@ bool CNetworkBuffer::ReadAndDiscardBits( const size_t uiNumBits )
 bool CNetworkBuffer::ReadAndDiscardBytes( const size_t uiNumBytes )
 {
 	return ReadAndDiscardBits( ByteBit( uiNumBytes ) );
-}
\ No newline at end of file
+}
+CNetworkBitWriter::CNetworkBitWriter( CNetworkBuffer& buffer )
+	: m_Buffer( buffer )
+	, m_pData( buffer.m_pData )
+	, m_uiMaxBits( buffer.m_uiMaxBits )
+	, m_uiByte( ( buffer.m_uiCurrentBit >> 5 ) << 2 )
+	, m_fOverflowed( buffer.m_fOverflowed )
+{
+	//Start with the bits that are already in the current dword, so storing it doesn't clobber them.
+	m_uiAccumulatorBits = buffer.m_uiCurrentBit & 31;
+
+	for( size_t uiIndex = 0; uiIndex < BitByte( m_uiAccumulatorBits ); ++uiIndex )
+	{
+		m_uiAccumulator |= static_cast<uint64_t>( m_pData[ m_uiByte + uiIndex ] ) << ( uiIndex * 8 );
+	}
+
+	m_uiAccumulator &= ( static_cast<uint64_t>( 1 ) << m_uiAccumulatorBits ) - 1;
+}
+
+void CNetworkBitWriter::Flush()
+{
+	const size_t uiFullBytes = m_uiAccumulatorBits >> 3;
+
+	for( size_t uiIndex = 0; uiIndex < uiFullBytes; ++uiIndex )
+	{
+		m_pData[ m_uiByte + uiIndex ] = static_cast<uint8_t>( m_uiAccumulator >> ( uiIndex * 8 ) );
+	}
+
+	if( const size_t uiExtraBits = m_uiAccumulatorBits & 7 )
+	{
+		const uint8_t mask = static_cast<uint8_t>( ( 1 << uiExtraBits ) - 1 );
+
+		uint8_t& byte = m_pData[ m_uiByte + uiFullBytes ];
+
+		byte = ( byte & ~mask ) | ( static_cast<uint8_t>( m_uiAccumulator >> ( uiFullBytes * 8 ) ) & mask );
+	}
+
+	if( m_fOverflowed )
+	{
+		//Same as CNetworkBuffer::Overflow.
+		m_Buffer.m_fOverflowed = true;
+		m_Buffer.m_uiCurrentBit = m_Buffer.m_uiMaxBits;
+	}
+	else
+	{
+		m_Buffer.m_uiCurrentBit = GetBitsInBuffer();
+	}
+}
+
+CNetworkBitReader::CNetworkBitReader( CNetworkBuffer& buffer )
+	: m_Buffer( buffer )
+	, m_pData( buffer.m_pData )
+	, m_uiMaxBits( buffer.m_uiMaxBits )
+	, m_uiMaxBytes( buffer.GetMaxBytes() )
+	, m_uiByte( buffer.m_uiCurrentBit >> 3 )
+	, m_uiCurrentBit( buffer.m_uiCurrentBit )
+	, m_fOverflowed( buffer.m_fOverflowed )
+{
+	//Skip the bits before the current position in the current byte.
+	if( const size_t uiSkipBits = m_uiCurrentBit & 7 )
+	{
+		Refill();
+
+		m_uiAccumulator >>= uiSkipBits;
+		m_uiAccumulatorBits -= uiSkipBits;
+	}
+}
+
+void CNetworkBitReader::Flush()
+{
+	if( m_fOverflowed )
+	{
+		//Same as CNetworkBuffer::Overflow.
+		m_Buffer.m_fOverflowed = true;
+		m_Buffer.m_uiCurrentBit = m_Buffer.m_uiMaxBits;
+	}
+	else
+	{
+		m_Buffer.m_uiCurrentBit = m_uiCurrentBit;
+	}
+}
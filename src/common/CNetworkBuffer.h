@@ -1,8 +1,12 @@
 #ifndef CNETWORKBUFFER_H
 #define CNETWORKBUFFER_H
 
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
 
+class CNetworkStats;
+
 /**
 *	@defgroup Networking Networking systems
 *
@@ -37,6 +41,22 @@ inline T ByteBit( const T iBytes )
 	return iBytes << 3;
 }
 
+/**
+*	Maps signed integers to unsigned integers so values close to zero stay small: 0, -1, 1, -2, 2 become 0, 1, 2, 3, 4.
+*/
+inline uint32_t ZigZagEncode32( const int32_t iValue )
+{
+	return ( static_cast<uint32_t>( iValue ) << 1 ) ^ static_cast<uint32_t>( iValue >> 31 );
+}
+
+/**
+*	Inverse of ZigZagEncode32.
+*/
+inline int32_t ZigZagDecode32( const uint32_t uiValue )
+{
+	return static_cast<int32_t>( ( uiValue >> 1 ) ^ ( 0U - ( uiValue & 1 ) ) );
+}
+
 /**
 *	A network buffer that points to a buffer containing arbitrary data
 */
@@ -67,6 +87,17 @@ public:
 	*/
 	const char* GetDebugName() const { return m_pszDebugName; }
 
+	/**
+	*	@return Counters that messages written to this buffer count towards, besides the global ones, or null.
+	*/
+	CNetworkStats* GetStats() const { return m_pStats; }
+
+	/**
+	*	Sets the counters that messages written to this buffer count towards, like those of the client it's sent to. Kept by SetBuffer.
+	*	@see CNetMessageScope
+	*/
+	void SetStats( CNetworkStats* pStats ) { m_pStats = pStats; }
+
 	/**
 	*	@return Whether this buffer has overflowed as a result of read or write operations.
 	*/
@@ -265,6 +296,28 @@ public:
 	*/
 	bool WriteString( const char* pszString );
 
+	/**
+	*	Writes an unsigned integer as a LEB128 varint: 7 bits per byte, lowest bits first, with the high bit of each byte set if another byte follows.
+	*	Values below 128 take 8 bits, the largest values take 40 bits. The bytes don't need to be byte aligned.
+	*/
+	void WriteVarInt32( uint32_t uiValue );
+
+	/**
+	*	Writes a signed integer as a zigzag encoded varint, so small negative values are as small as small positive values.
+	*/
+	void WriteSignedVarInt32( const int32_t iValue ) { WriteVarInt32( ZigZagEncode32( iValue ) ); }
+
+	/**
+	*	Writes an unsigned integer as an Elias gamma code of the value plus one: for a value with N bits after its leading one bit,
+	*	N zero bits, a one bit, and the N bits. Unlike varints this is bit granular: 0 takes 1 bit, 1-2 take 3 bits, 3-6 take 5 bits, up to 65 bits.
+	*/
+	void WriteGammaInt32( const uint32_t uiValue );
+
+	/**
+	*	Writes a signed integer as a zigzag encoded gamma code.
+	*/
+	void WriteSignedGammaInt32( const int32_t iValue ) { WriteGammaInt32( ZigZagEncode32( iValue ) ); }
+
 	/**
 	*	Pads the buffer to the nearest byte.
 	*	@return Whether the buffer overflowed after performing this operation.
@@ -411,6 +464,30 @@ public:
 	*/
 	bool ReadString( char* pszBuffer, const size_t uiBufferSize, const bool fIsLine = false );
 
+	/**
+	*	Reads an unsigned integer written by WriteVarInt32. Stops after 5 bytes if the varint is malformed.
+	*	@return Value that was read.
+	*/
+	uint32_t ReadVarInt32();
+
+	/**
+	*	Reads a signed integer written by WriteSignedVarInt32.
+	*	@return Value that was read.
+	*/
+	int32_t ReadSignedVarInt32() { return ZigZagDecode32( ReadVarInt32() ); }
+
+	/**
+	*	Reads an unsigned integer written by WriteGammaInt32. A code longer than 65 bits overflows the buffer.
+	*	@return Value that was read.
+	*/
+	uint32_t ReadGammaInt32();
+
+	/**
+	*	Reads a signed integer written by WriteSignedGammaInt32.
+	*	@return Value that was read.
+	*/
+	int32_t ReadSignedGammaInt32() { return ZigZagDecode32( ReadGammaInt32() ); }
+
 	/**
 	*	Reads and discards a number of bits.
 	*	@param uiNumBits Number of bits to read.
@@ -426,17 +503,491 @@ public:
 	bool ReadAndDiscardBytes( const size_t uiNumBytes );
 
 private:
+	/**
+	*	ReadString for when the current position is byte aligned. Scans 16 bytes at a time where SSE2 is available.
+	*/
+	bool ReadAlignedString( char* pszBuffer, const size_t uiBufferSize, const bool fIsLine );
+
+private:
+	friend class CNetworkBitWriter;
+	friend class CNetworkBitReader;
+
 	const char* m_pszDebugName;	//Debug name. Points to a static const string
 	bool m_fOverflowed;			//Whether a read or write operation overflowed
 	uint8_t* m_pData;			//Pointer to destination buffer
 	size_t m_uiMaxBits;			//Size of the destination buffer, in bits
 	size_t m_uiCurrentBit;		//Next bit we're reading from or writing to
+	CNetworkStats* m_pStats = nullptr;	//Per destination message statistics, or null
 
 private:
 	CNetworkBuffer( const CNetworkBuffer& ) = delete;
 	CNetworkBuffer& operator=( const CNetworkBuffer& ) = delete;
 };
 
+/**
+*	Writes bits to a network buffer through a 64 bit accumulator. Meant to live on the stack while a batch of fields is written,
+*	so the accumulator stays in a register and memory is only touched once per 32 bits.
+*	The bits written are identical to those written by CNetworkBuffer::WriteUnsignedBitLong and friends.
+*	The buffer must not be used directly until the writer is flushed or destroyed.
+*/
+class CNetworkBitWriter final
+{
+public:
+	/**
+	*	Starts writing at the buffer's current position.
+	*/
+	explicit CNetworkBitWriter( CNetworkBuffer& buffer );
+
+	~CNetworkBitWriter()
+	{
+		Flush();
+	}
+
+	/**
+	*	@return Number of bits in the buffer, including the bits written by this writer.
+	*/
+	size_t GetBitsInBuffer() const { return ByteBit( m_uiByte ) + m_uiAccumulatorBits; }
+
+	/**
+	*	@return Whether a write overflowed the buffer. Every write after it is discarded.
+	*/
+	bool HasOverflowed() const { return m_fOverflowed; }
+
+	/**
+	*	@return Whether the given number of bits can be written without overflowing.
+	*/
+	bool CanWrite( const size_t uiNumBits ) const
+	{
+		return !m_fOverflowed && GetBitsInBuffer() + uiNumBits <= m_uiMaxBits;
+	}
+
+	/**
+	*	@copydoc CNetworkBuffer::WriteOneBit
+	*/
+	void WriteOneBit( const int iValue )
+	{
+		WriteUnsignedBitLong( iValue ? 1 : 0, 1 );
+	}
+
+	/**
+	*	@copydoc CNetworkBuffer::WriteUnsignedBitLong
+	*/
+	void WriteUnsignedBitLong( const unsigned int iValue, const size_t uiNumBits )
+	{
+		assert( uiNumBits <= 32 );
+
+		if( !CanWrite( uiNumBits ) )
+		{
+			m_fOverflowed = true;
+			return;
+		}
+
+		Put( iValue, uiNumBits );
+	}
+
+	/**
+	*	Writes an unsigned value with a width known at compile time, so the masks and shifts are folded.
+	*/
+	template<size_t NUM_BITS>
+	void WriteUnsignedBits( const unsigned int iValue )
+	{
+		static_assert( NUM_BITS <= 32, "CNetworkBitWriter::WriteUnsignedBits: at most 32 bits can be written at once" );
+
+		WriteUnsignedBitLong( iValue, NUM_BITS );
+	}
+
+	/**
+	*	Same as WriteUnsignedBits, but doesn't check for overflow. CanWrite must have been checked for at least this many bits.
+	*/
+	template<size_t NUM_BITS>
+	void WriteUnsignedBitsUnchecked( const unsigned int iValue )
+	{
+		static_assert( NUM_BITS <= 32, "CNetworkBitWriter::WriteUnsignedBitsUnchecked: at most 32 bits can be written at once" );
+
+		assert( CanWrite( NUM_BITS ) );
+
+		Put( iValue, NUM_BITS );
+	}
+
+	/**
+	*	Writes a signed value with a width known at compile time. Same encoding as WriteSignedBitLong.
+	*/
+	template<size_t NUM_BITS>
+	void WriteSignedBits( const int iValue )
+	{
+		static_assert( NUM_BITS >= 1 && NUM_BITS <= 32, "CNetworkBitWriter::WriteSignedBits: between 1 and 32 bits can be written at once" );
+
+		if( !CanWrite( NUM_BITS ) )
+		{
+			m_fOverflowed = true;
+			return;
+		}
+
+		WriteSignedBitsUnchecked<NUM_BITS>( iValue );
+	}
+
+	/**
+	*	Same as WriteSignedBits, but doesn't check for overflow. CanWrite must have been checked for at least this many bits.
+	*/
+	template<size_t NUM_BITS>
+	void WriteSignedBitsUnchecked( const int iValue )
+	{
+		static_assert( NUM_BITS >= 1 && NUM_BITS <= 32, "CNetworkBitWriter::WriteSignedBitsUnchecked: between 1 and 32 bits can be written at once" );
+
+		assert( CanWrite( NUM_BITS ) );
+
+		//The magnitude bits and the sign bit in one go. The low bits of 0x80000000 + iValue are those of iValue.
+		Put( static_cast<unsigned int>( ( static_cast<unsigned int>( iValue ) & ( ( static_cast<uint64_t>( 1 ) << ( NUM_BITS - 1 ) ) - 1 ) ) |
+			 ( ( iValue < 0 ? 1U : 0U ) << ( NUM_BITS - 1 ) ) ), NUM_BITS );
+	}
+
+	/**
+	*	@copydoc CNetworkBuffer::WriteSignedBitLong
+	*/
+	void WriteSignedBitLong( const int iValue, const size_t uiNumBits )
+	{
+		assert( uiNumBits >= 1 );
+
+		//Same encoding as CNetworkBuffer: the magnitude bits, then the sign bit.
+		if( iValue < 0 )
+		{
+			WriteUnsignedBitLong( ( unsigned int ) ( 0x80000000 + iValue ), uiNumBits - 1 );
+			WriteOneBit( 1 );
+		}
+		else
+		{
+			WriteUnsignedBitLong( ( unsigned int ) iValue, uiNumBits - 1 );
+			WriteOneBit( 0 );
+		}
+	}
+
+	/**
+	*	@copydoc CNetworkBuffer::WriteBitLong
+	*/
+	void WriteBitLong( const unsigned int iValue, const size_t uiNumBits, const bool fSigned )
+	{
+		if( fSigned )
+			WriteSignedBitLong( ( int ) iValue, uiNumBits );
+		else
+			WriteUnsignedBitLong( iValue, uiNumBits );
+	}
+
+	/**
+	*	Writes the bits that are still in the accumulator to the buffer, and updates the buffer's position and overflow flag.
+	*	Bits in the buffer past the written bits are left alone. Writing can continue afterwards.
+	*/
+	void Flush();
+
+private:
+	/**
+	*	Adds bits to the accumulator, and stores the lowest dword once it's full. There must be room for them.
+	*/
+	void Put( const unsigned int iValue, const size_t uiNumBits )
+	{
+		//Only the given number of bits is written, higher bits of the value are ignored.
+		m_uiAccumulator |= ( static_cast<uint64_t>( iValue ) & ( ( static_cast<uint64_t>( 1 ) << uiNumBits ) - 1 ) ) << m_uiAccumulatorBits;
+		m_uiAccumulatorBits += uiNumBits;
+
+		if( m_uiAccumulatorBits >= 32 )
+		{
+			const uint32_t uiWord = static_cast<uint32_t>( m_uiAccumulator );
+
+			m_pData[ m_uiByte ] = static_cast<uint8_t>( uiWord );
+			m_pData[ m_uiByte + 1 ] = static_cast<uint8_t>( uiWord >> 8 );
+			m_pData[ m_uiByte + 2 ] = static_cast<uint8_t>( uiWord >> 16 );
+			m_pData[ m_uiByte + 3 ] = static_cast<uint8_t>( uiWord >> 24 );
+
+			m_uiAccumulator >>= 32;
+			m_uiAccumulatorBits -= 32;
+			m_uiByte += 4;
+		}
+	}
+
+private:
+	CNetworkBuffer& m_Buffer;
+
+	uint8_t* const m_pData;
+	const size_t m_uiMaxBits;
+
+	/**
+	*	Bits that haven't been stored yet, starting with the lowest bit, and how many there are.
+	*	They belong at the dword aligned byte offset m_uiByte.
+	*/
+	uint64_t m_uiAccumulator = 0;
+	size_t m_uiAccumulatorBits = 0;
+	size_t m_uiByte;
+
+	bool m_fOverflowed = false;
+
+private:
+	CNetworkBitWriter( const CNetworkBitWriter& ) = delete;
+	CNetworkBitWriter& operator=( const CNetworkBitWriter& ) = delete;
+};
+
+/**
+*	Reads bits from a network buffer through a 64 bit accumulator. Loads 32 bits at a time.
+*	@see CNetworkBitWriter
+*/
+class CNetworkBitReader final
+{
+public:
+	/**
+	*	Starts reading at the buffer's current position.
+	*/
+	explicit CNetworkBitReader( CNetworkBuffer& buffer );
+
+	~CNetworkBitReader()
+	{
+		Flush();
+	}
+
+	/**
+	*	@return Current read position, in bits.
+	*/
+	size_t GetBitsInBuffer() const { return m_uiCurrentBit; }
+
+	/**
+	*	@return Number of bits left to read.
+	*/
+	size_t GetBitsLeft() const { return m_uiMaxBits - m_uiCurrentBit; }
+
+	/**
+	*	@return Whether a read overflowed the buffer. Every read after it returns 0.
+	*/
+	bool HasOverflowed() const { return m_fOverflowed; }
+
+	/**
+	*	@return Whether the given number of bits can be read without overflowing.
+	*/
+	bool CanRead( const size_t uiNumBits ) const
+	{
+		return !m_fOverflowed && m_uiCurrentBit + uiNumBits <= m_uiMaxBits;
+	}
+
+	/**
+	*	@copydoc CNetworkBuffer::ReadOneBit
+	*/
+	int ReadOneBit()
+	{
+		return static_cast<int>( ReadUnsignedBitLong( 1 ) );
+	}
+
+	/**
+	*	@copydoc CNetworkBuffer::ReadUnsignedBitLong
+	*/
+	unsigned int ReadUnsignedBitLong( const size_t uiNumBits )
+	{
+		assert( uiNumBits <= 32 );
+
+		//Same as CNetworkBuffer: a byte read at the end of the message returns 0 without overflowing.
+		if( uiNumBits == 8 && GetBitsLeft() < 8 )
+			return 0;
+
+		if( !CanRead( uiNumBits ) )
+		{
+			m_fOverflowed = true;
+			return 0;
+		}
+
+		return Take( uiNumBits );
+	}
+
+	/**
+	*	Reads an unsigned value with a width known at compile time, so the masks and shifts are folded.
+	*/
+	template<size_t NUM_BITS>
+	unsigned int ReadUnsignedBits()
+	{
+		static_assert( NUM_BITS <= 32, "CNetworkBitReader::ReadUnsignedBits: at most 32 bits can be read at once" );
+
+		return ReadUnsignedBitLong( NUM_BITS );
+	}
+
+	/**
+	*	Same as ReadUnsignedBits, but doesn't check for overflow. CanRead must have been checked for at least this many bits.
+	*/
+	template<size_t NUM_BITS>
+	unsigned int ReadUnsignedBitsUnchecked()
+	{
+		static_assert( NUM_BITS <= 32, "CNetworkBitReader::ReadUnsignedBitsUnchecked: at most 32 bits can be read at once" );
+
+		assert( CanRead( NUM_BITS ) );
+
+		return Take( NUM_BITS );
+	}
+
+	/**
+	*	Reads a signed value with a width known at compile time. Same encoding as ReadSignedBitLong.
+	*/
+	template<size_t NUM_BITS>
+	int ReadSignedBits()
+	{
+		static_assert( NUM_BITS >= 1 && NUM_BITS <= 32, "CNetworkBitReader::ReadSignedBits: between 1 and 32 bits can be read at once" );
+
+		//Reads the sign bit separately so reading past the end acts the same as ReadSignedBitLong.
+		if( !CanRead( NUM_BITS ) )
+			return ReadSignedBitLong( NUM_BITS );
+
+		return ReadSignedBitsUnchecked<NUM_BITS>();
+	}
+
+	/**
+	*	Same as ReadSignedBits, but doesn't check for overflow. CanRead must have been checked for at least this many bits.
+	*/
+	template<size_t NUM_BITS>
+	int ReadSignedBitsUnchecked()
+	{
+		static_assert( NUM_BITS >= 1 && NUM_BITS <= 32, "CNetworkBitReader::ReadSignedBitsUnchecked: between 1 and 32 bits can be read at once" );
+
+		assert( CanRead( NUM_BITS ) );
+
+		const unsigned int uiValue = Take( NUM_BITS );
+
+		int r = static_cast<int>( uiValue & ( ( static_cast<uint64_t>( 1 ) << ( NUM_BITS - 1 ) ) - 1 ) );
+
+		if( uiValue >> ( NUM_BITS - 1 ) ) r = -( ( 1 << ( NUM_BITS - 1 ) ) - r );
+
+		return r;
+	}
+
+	/**
+	*	Gets the next bits without reading them. Bits past the end of the buffer are 0.
+	*	@param uiNumBits Number of bits to get, at most 32.
+	*/
+	unsigned int PeekUnsignedBits( const size_t uiNumBits )
+	{
+		assert( uiNumBits <= 32 );
+
+		if( m_fOverflowed )
+			return 0;
+
+		if( m_uiAccumulatorBits < uiNumBits && m_uiByte < m_uiMaxBytes )
+			Refill();
+
+		return static_cast<unsigned int>( m_uiAccumulator & ( ( static_cast<uint64_t>( 1 ) << uiNumBits ) - 1 ) );
+	}
+
+	/**
+	*	Skips bits, usually after peeking them.
+	*	@return Whether the bits were in the buffer. If not, the reader overflows.
+	*/
+	bool SkipBits( const size_t uiNumBits )
+	{
+		assert( uiNumBits <= 32 );
+
+		if( !CanRead( uiNumBits ) )
+		{
+			m_fOverflowed = true;
+			return false;
+		}
+
+		Take( uiNumBits );
+
+		return true;
+	}
+
+	/**
+	*	@copydoc CNetworkBuffer::ReadSignedBitLong
+	*/
+	int ReadSignedBitLong( const size_t uiNumBits )
+	{
+		int r = ReadUnsignedBitLong( uiNumBits - 1 );
+
+		const int sign = ReadOneBit();
+		if( sign ) r = -( ( 1 << ( uiNumBits - 1 ) ) - r );
+
+		return r;
+	}
+
+	/**
+	*	@copydoc CNetworkBuffer::ReadBitLong
+	*/
+	unsigned int ReadBitLong( const size_t uiNumBits, const bool fSigned )
+	{
+		if( fSigned )
+			return ( unsigned int ) ReadSignedBitLong( uiNumBits );
+		else
+			return ReadUnsignedBitLong( uiNumBits );
+	}
+
+	/**
+	*	Updates the buffer's position and overflow flag. Reading can continue afterwards.
+	*/
+	void Flush();
+
+private:
+	/**
+	*	Removes bits from the accumulator, loading more first if needed. There must be enough bits left in the buffer.
+	*/
+	unsigned int Take( const size_t uiNumBits )
+	{
+		if( m_uiAccumulatorBits < uiNumBits )
+			Refill();
+
+		const auto uiValue = static_cast<unsigned int>( m_uiAccumulator & ( ( static_cast<uint64_t>( 1 ) << uiNumBits ) - 1 ) );
+
+		m_uiAccumulator >>= uiNumBits;
+		m_uiAccumulatorBits -= uiNumBits;
+		m_uiCurrentBit += uiNumBits;
+
+		return uiValue;
+	}
+
+	/**
+	*	Loads up to 32 more bits into the accumulator. Fewer are loaded at the end of the buffer.
+	*/
+	void Refill()
+	{
+		const uint8_t* pBytes = m_pData + m_uiByte;
+
+		size_t uiBytes;
+		uint64_t uiWord;
+
+		if( m_uiMaxBytes - m_uiByte >= 4 )
+		{
+			uiBytes = 4;
+			uiWord = static_cast<uint64_t>( pBytes[ 0 ] | ( pBytes[ 1 ] << 8 ) | ( pBytes[ 2 ] << 16 ) | ( static_cast<uint32_t>( pBytes[ 3 ] ) << 24 ) );
+		}
+		else
+		{
+			uiBytes = m_uiMaxBytes - m_uiByte;
+			uiWord = 0;
+
+			for( size_t uiIndex = 0; uiIndex < uiBytes; ++uiIndex )
+			{
+				uiWord |= static_cast<uint64_t>( pBytes[ uiIndex ] ) << ( uiIndex * 8 );
+			}
+		}
+
+		m_uiAccumulator |= uiWord << m_uiAccumulatorBits;
+		m_uiAccumulatorBits += ByteBit( uiBytes );
+		m_uiByte += uiBytes;
+	}
+
+private:
+	CNetworkBuffer& m_Buffer;
+
+	const uint8_t* const m_pData;
+	const size_t m_uiMaxBits;
+	const size_t m_uiMaxBytes;
+
+	/**
+	*	Bits that were loaded but not read yet, starting with the lowest bit, and how many there are.
+	*	m_uiByte is the offset of the next byte to load.
+	*/
+	uint64_t m_uiAccumulator = 0;
+	size_t m_uiAccumulatorBits = 0;
+	size_t m_uiByte;
+
+	size_t m_uiCurrentBit;
+
+	bool m_fOverflowed = false;
+
+private:
+	CNetworkBitReader( const CNetworkBitReader& ) = delete;
+	CNetworkBitReader& operator=( const CNetworkBitReader& ) = delete;
+};
+
 /** @} */
 
 #endif //CNETWORKBUFFER_H
\ No newline at end of file
@@ -0,0 +1,102 @@
+#include "MemoryTracking.h"
+
+#include "CNetworkChunkPool.h"
+
+const size_t CNetworkChunkPool::CHUNK_SIZE;
+const size_t CNetworkChunkPool::CHUNK_ALIGNMENT;
+const size_t CNetworkChunkPool::CHUNKS_PER_SLAB;
+const size_t CNetworkChunkPool::MAX_SLABS;
+const uint32_t CNetworkChunkPool::INVALID_CHUNK;
+const size_t CNetworkChunkPool::SLAB_BYTES;
+
+CNetworkChunkPool::~CNetworkChunkPool()
+{
+	for( auto& slab : m_Slabs )
+	{
+		if( auto pSlab = slab.load( std::memory_order_relaxed ) )
+		{
+			Mem_RecordFree( MemoryTag::NETWORK, SLAB_BYTES );
+			delete pSlab;
+		}
+	}
+}
+
+uint32_t CNetworkChunkPool::Allocate()
+{
+	uint64_t uiHead = m_uiHead.load( std::memory_order_acquire );
+
+	for( ;; )
+	{
+		const auto uiChunk = static_cast<uint32_t>( uiHead );
+
+		if( uiChunk == INVALID_CHUNK )
+			return Grow();
+
+		//Slabs are never freed, so this is safe even if another thread popped the chunk in the meantime. The swap fails in that case.
+		const uint32_t uiNext = GetNext( uiChunk ).load( std::memory_order_relaxed );
+
+		if( m_uiHead.compare_exchange_weak( uiHead, MakeHead( ( uiHead >> 32 ) + 1, uiNext ), std::memory_order_acquire, std::memory_order_acquire ) )
+			return uiChunk;
+	}
+}
+
+void CNetworkChunkPool::Free( const uint32_t uiChunk )
+{
+	if( uiChunk != INVALID_CHUNK )
+		Push( uiChunk );
+}
+
+void CNetworkChunkPool::Push( const uint32_t uiChunk )
+{
+	uint64_t uiHead = m_uiHead.load( std::memory_order_relaxed );
+
+	do
+	{
+		GetNext( uiChunk ).store( static_cast<uint32_t>( uiHead ), std::memory_order_relaxed );
+	}
+	while( !m_uiHead.compare_exchange_weak( uiHead, MakeHead( ( uiHead >> 32 ) + 1, uiChunk ), std::memory_order_release, std::memory_order_relaxed ) );
+}
+
+uint32_t CNetworkChunkPool::Grow()
+{
+	std::lock_guard<std::mutex> lock( m_GrowMutex );
+
+	//Another thread may have grown the pool while this one was waiting.
+	uint64_t uiHead = m_uiHead.load( std::memory_order_acquire );
+
+	while( static_cast<uint32_t>( uiHead ) != INVALID_CHUNK )
+	{
+		const auto uiChunk = static_cast<uint32_t>( uiHead );
+
+		if( m_uiHead.compare_exchange_weak( uiHead, MakeHead( ( uiHead >> 32 ) + 1, GetNext( uiChunk ).load( std::memory_order_relaxed ) ),
+											std::memory_order_acquire, std::memory_order_acquire ) )
+			return uiChunk;
+	}
+
+	const size_t uiSlab = m_uiSlabCount.load( std::memory_order_relaxed );
+
+	if( uiSlab >= MAX_SLABS )
+		return INVALID_CHUNK;
+
+	auto pSlab = new Slab_t;
+
+	pSlab->storage.reset( new uint8_t[ SLAB_BYTES ] );
+
+	Mem_RecordAlloc( MemoryTag::NETWORK, SLAB_BYTES );
+
+	const auto uiAddress = reinterpret_cast<uintptr_t>( pSlab->storage.get() );
+
+	pSlab->pData = pSlab->storage.get() + ( ( CHUNK_ALIGNMENT - uiAddress % CHUNK_ALIGNMENT ) % CHUNK_ALIGNMENT );
+
+	m_Slabs[ uiSlab ].store( pSlab, std::memory_order_release );
+	m_uiSlabCount.store( uiSlab + 1, std::memory_order_relaxed );
+
+	const auto uiFirstChunk = static_cast<uint32_t>( uiSlab * CHUNKS_PER_SLAB );
+
+	for( uint32_t uiChunk = 1; uiChunk < CHUNKS_PER_SLAB; ++uiChunk )
+	{
+		Push( uiFirstChunk + uiChunk );
+	}
+
+	return uiFirstChunk;
+}
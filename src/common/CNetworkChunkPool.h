@@ -0,0 +1,134 @@
+#ifndef COMMON_CNETWORKCHUNKPOOL_H
+#define COMMON_CNETWORKCHUNKPOOL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+/**
+*	Pool of fixed size, cache line aligned memory chunks for network messages.
+*	Allocating and freeing is lock-free. Chunks are allocated in slabs that are kept until the pool is destroyed,
+*	so once the pool has warmed up there are no more heap allocations.
+*	Chunks are identified by index, see GetData.
+*/
+class CNetworkChunkPool final
+{
+public:
+	/**
+	*	Size of a chunk, in bytes.
+	*/
+	static const size_t CHUNK_SIZE = 1024;
+
+	/**
+	*	Alignment of chunks, in bytes.
+	*/
+	static const size_t CHUNK_ALIGNMENT = 64;
+
+	/**
+	*	Number of chunks allocated together.
+	*/
+	static const size_t CHUNKS_PER_SLAB = 64;
+
+	/**
+	*	Maximum number of slabs. Allocations fail once all chunks of all slabs are in use.
+	*/
+	static const size_t MAX_SLABS = 1024;
+
+	/**
+	*	Returned by Allocate if no chunk could be allocated.
+	*/
+	static const uint32_t INVALID_CHUNK = UINT32_MAX;
+
+public:
+	CNetworkChunkPool() = default;
+	~CNetworkChunkPool();
+
+	/**
+	*	Allocates a chunk. Can be called from any thread.
+	*	@return Index of the chunk, or INVALID_CHUNK if the pool is exhausted.
+	*/
+	uint32_t Allocate();
+
+	/**
+	*	Returns a chunk to the pool. Can be called from any thread.
+	*/
+	void Free( const uint32_t uiChunk );
+
+	/**
+	*	@return Memory of a chunk, CHUNK_SIZE bytes.
+	*/
+	uint8_t* GetData( const uint32_t uiChunk ) const
+	{
+		return m_Slabs[ uiChunk / CHUNKS_PER_SLAB ].load( std::memory_order_acquire )->pData + ( uiChunk % CHUNKS_PER_SLAB ) * CHUNK_SIZE;
+	}
+
+	/**
+	*	@return Number of chunks that were allocated from the heap, in use or not.
+	*/
+	size_t GetChunkCount() const { return m_uiSlabCount.load( std::memory_order_relaxed ) * CHUNKS_PER_SLAB; }
+
+private:
+	/**
+	*	Size of a slab's storage, with room to align the chunks.
+	*/
+	static const size_t SLAB_BYTES = CHUNKS_PER_SLAB * CHUNK_SIZE + CHUNK_ALIGNMENT - 1;
+
+	struct Slab_t
+	{
+		std::unique_ptr<uint8_t[]> storage;
+
+		/**
+		*	Aligned start of the chunks in storage.
+		*/
+		uint8_t* pData;
+
+		/**
+		*	Next free chunk after each chunk, while it is free.
+		*/
+		std::atomic<uint32_t> next[ CHUNKS_PER_SLAB ];
+	};
+
+	std::atomic<uint32_t>& GetNext( const uint32_t uiChunk ) const
+	{
+		return m_Slabs[ uiChunk / CHUNKS_PER_SLAB ].load( std::memory_order_acquire )->next[ uiChunk % CHUNKS_PER_SLAB ];
+	}
+
+	static uint64_t MakeHead( const uint64_t uiTag, const uint32_t uiChunk )
+	{
+		return ( uiTag << 32 ) | uiChunk;
+	}
+
+	/**
+	*	Pushes a chunk on the free list.
+	*/
+	void Push( const uint32_t uiChunk );
+
+	/**
+	*	Allocates a new slab and returns one of its chunks. The rest are freed.
+	*/
+	uint32_t Grow();
+
+private:
+	/**
+	*	Top of the free list in the low 32 bits, and a counter in the high 32 bits that is changed on every update,
+	*	so a chunk that was popped and pushed back between loading and swapping the head is noticed.
+	*/
+	std::atomic<uint64_t> m_uiHead{ INVALID_CHUNK };
+
+	std::atomic<Slab_t*> m_Slabs[ MAX_SLABS ] = {};
+
+	std::atomic<size_t> m_uiSlabCount{ 0 };
+
+	/**
+	*	Held while growing.
+	*/
+	std::mutex m_GrowMutex;
+
+private:
+	CNetworkChunkPool( const CNetworkChunkPool& ) = delete;
+	CNetworkChunkPool& operator=( const CNetworkChunkPool& ) = delete;
+};
+
+#endif //COMMON_CNETWORKCHUNKPOOL_H
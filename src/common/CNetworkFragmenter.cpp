@@ -0,0 +1,92 @@
+#include <algorithm>
+
+#include "CNetworkBuffer.h"
+#include "CNetworkMessage.h"
+#include "CPacketBuilder.h"
+
+#include "CNetworkFragmenter.h"
+
+const size_t CNetworkFragmenter::FRAGMENT_SIZE;
+const size_t CNetworkFragmenter::MAX_FRAGMENTS;
+const size_t CNetworkFragmenter::MAX_MESSAGE_SIZE;
+const size_t CNetworkFragmenter::MAX_STREAMS;
+const size_t CNetworkFragmenter::HEADER_SIZE;
+
+static_assert( CNetworkFragmenter::MAX_FRAGMENTS <= 256, "Fragment indices are sent as bytes" );
+static_assert( CNetworkFragmenter::FRAGMENT_SIZE <= UINT16_MAX, "Fragment sizes are sent as words" );
+
+bool CNetworkFragmenter::Begin( const size_t uiStream, const void* pData, const size_t uiSize )
+{
+	m_uiFragmentCount = 0;
+
+	if( uiStream >= MAX_STREAMS || !pData || uiSize == 0 || uiSize > MAX_MESSAGE_SIZE )
+		return false;
+
+	m_pData = reinterpret_cast<const uint8_t*>( pData );
+	m_pMessage = nullptr;
+	m_uiSize = uiSize;
+	m_uiFragmentCount = ( uiSize + FRAGMENT_SIZE - 1 ) / FRAGMENT_SIZE;
+	m_uiStream = static_cast<uint8_t>( uiStream );
+	m_uiSequence = m_uiNextSequence[ uiStream ]++;
+
+	return true;
+}
+
+bool CNetworkFragmenter::Begin( const size_t uiStream, const CNetworkMessage& message )
+{
+	m_uiFragmentCount = 0;
+
+	const size_t uiSize = message.GetBytesInMessage();
+
+	if( uiStream >= MAX_STREAMS || message.HasOverflowed() || uiSize == 0 || uiSize > MAX_MESSAGE_SIZE )
+		return false;
+
+	m_pData = nullptr;
+	m_pMessage = &message;
+	m_uiSize = uiSize;
+	m_uiFragmentCount = message.GetChunkCount();
+	m_uiStream = static_cast<uint8_t>( uiStream );
+	m_uiSequence = m_uiNextSequence[ uiStream ]++;
+
+	return true;
+}
+
+bool CNetworkFragmenter::AddFragment( const size_t uiIndex, CNetworkBuffer& header, CPacketBuilder& packet ) const
+{
+	if( uiIndex >= m_uiFragmentCount || packet.GetSegmentCount() + 2 > CPacketBuilder::MAX_SEGMENTS )
+		return false;
+
+	const size_t uiPayloadSize = GetPayloadSize( uiIndex );
+
+	if( !header.PadToByte() )
+		return false;
+
+	const uint8_t* pHeader = header.GetCurrentData();
+
+	header.WriteByte( m_uiStream );
+	header.WriteWord( m_uiSequence );
+	header.WriteByte( static_cast<int>( uiIndex ) );
+	header.WriteByte( static_cast<int>( m_uiFragmentCount - 1 ) );
+	header.WriteWord( static_cast<int>( uiPayloadSize ) );
+
+	if( header.HasOverflowed() )
+		return false;
+
+	packet.AddSegment( pHeader, HEADER_SIZE );
+	packet.AddSegment( GetPayload( uiIndex ), uiPayloadSize );
+
+	return true;
+}
+
+const uint8_t* CNetworkFragmenter::GetPayload( const size_t uiIndex ) const
+{
+	if( m_pMessage )
+		return m_pMessage->GetChunkData( uiIndex );
+
+	return m_pData + uiIndex * FRAGMENT_SIZE;
+}
+
+size_t CNetworkFragmenter::GetPayloadSize( const size_t uiIndex ) const
+{
+	return std::min( FRAGMENT_SIZE, m_uiSize - uiIndex * FRAGMENT_SIZE );
+}
@@ -0,0 +1,114 @@
+#ifndef COMMON_CNETWORKFRAGMENTER_H
+#define COMMON_CNETWORKFRAGMENTER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CNetworkChunkPool.h"
+
+class CNetworkBuffer;
+class CNetworkMessage;
+class CPacketBuilder;
+
+/**
+*	Splits messages that are too large for one packet into fixed size fragments, reassembled by CNetworkReassembler.
+*	Each fragment is a small header followed by its payload. The payload is added to the packet as a segment that references the message,
+*	so it's never copied before it's sent; the message must stay valid and unchanged until all of its fragments are sent.
+*	Messages are sent on streams, each with its own sequence numbers, so a large message on one stream doesn't hold up the others.
+*/
+class CNetworkFragmenter final
+{
+public:
+	/**
+	*	Payload size of every fragment but the last, in bytes. Matches the chunk size, so each chunk of a CNetworkMessage is one fragment.
+	*/
+	static const size_t FRAGMENT_SIZE = CNetworkChunkPool::CHUNK_SIZE;
+
+	/**
+	*	Maximum number of fragments in a message.
+	*/
+	static const size_t MAX_FRAGMENTS = 256;
+
+	/**
+	*	Largest message, in bytes.
+	*/
+	static const size_t MAX_MESSAGE_SIZE = FRAGMENT_SIZE * MAX_FRAGMENTS;
+
+	/**
+	*	Number of streams.
+	*/
+	static const size_t MAX_STREAMS = 16;
+
+	/**
+	*	Size of a fragment's header, in bytes: stream, sequence, fragment index, last fragment index and payload size.
+	*/
+	static const size_t HEADER_SIZE = 7;
+
+public:
+	CNetworkFragmenter() = default;
+
+	/**
+	*	Starts sending a message. Assigns it the next sequence number of its stream.
+	*	@param uiStream Stream to send it on.
+	*	@param pData Message. Must stay valid until all fragments are sent.
+	*	@param uiSize Size of the message, in bytes. Must be at least 1 and at most MAX_MESSAGE_SIZE.
+	*	@return Whether the message can be sent.
+	*/
+	bool Begin( const size_t uiStream, const void* pData, const size_t uiSize );
+
+	/**
+	*	@copydoc Begin( const size_t, const void*, const size_t )
+	*	Each of the message's chunks is sent as a fragment.
+	*/
+	bool Begin( const size_t uiStream, const CNetworkMessage& message );
+
+	/**
+	*	@return Number of fragments in the current message.
+	*/
+	size_t GetFragmentCount() const { return m_uiFragmentCount; }
+
+	/**
+	*	Adds a fragment of the current message to a packet. Fragments can be added in any order, and again if they were lost.
+	*	@param uiIndex Index of the fragment.
+	*	@param header Buffer the fragment's header is appended to, at the next byte. The packet references it, so it must stay valid until the packet is sent.
+	*		The fragments in a packet can share a buffer.
+	*	@param packet Packet to add the header and payload to.
+	*	@return Whether the fragment fit in the packet. If not, nothing is added.
+	*/
+	bool AddFragment( const size_t uiIndex, CNetworkBuffer& header, CPacketBuilder& packet ) const;
+
+private:
+	/**
+	*	@return Payload of a fragment.
+	*/
+	const uint8_t* GetPayload( const size_t uiIndex ) const;
+
+	size_t GetPayloadSize( const size_t uiIndex ) const;
+
+private:
+	const uint8_t* m_pData = nullptr;
+
+	/**
+	*	If the current message is a CNetworkMessage, the message. Its chunks are the payloads.
+	*/
+	const CNetworkMessage* m_pMessage = nullptr;
+
+	size_t m_uiSize = 0;
+
+	size_t m_uiFragmentCount = 0;
+
+	uint8_t m_uiStream = 0;
+
+	uint16_t m_uiSequence = 0;
+
+	/**
+	*	Sequence number of the next message on each stream.
+	*/
+	uint16_t m_uiNextSequence[ MAX_STREAMS ] = {};
+
+private:
+	CNetworkFragmenter( const CNetworkFragmenter& ) = delete;
+	CNetworkFragmenter& operator=( const CNetworkFragmenter& ) = delete;
+};
+
+#endif //COMMON_CNETWORKFRAGMENTER_H
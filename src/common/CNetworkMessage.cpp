@@ -0,0 +1,182 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "Logging.h"
+
+#include "CNetworkMessage.h"
+
+CNetworkMessage::CNetworkMessage( CNetworkChunkPool& pool, const char* pszDebugName )
+	: m_Pool( pool )
+	, m_pszDebugName( pszDebugName )
+{
+}
+
+CNetworkMessage::~CNetworkMessage()
+{
+	Reset();
+}
+
+void CNetworkMessage::Reset()
+{
+	for( const auto uiChunk : m_Chunks )
+	{
+		m_Pool.Free( uiChunk );
+	}
+
+	m_Chunks.clear();
+
+	m_Buffer.ResetToEmpty();
+
+	m_bOverflowed = false;
+}
+
+bool CNetworkMessage::CopyTo( void* pDest, const size_t uiMaxBytes ) const
+{
+	const size_t uiNumBytes = GetBytesInMessage();
+
+	if( uiNumBytes > uiMaxBytes )
+		return false;
+
+	auto pDestBytes = reinterpret_cast<uint8_t*>( pDest );
+
+	for( size_t uiIndex = 0; uiIndex < m_Chunks.size(); ++uiIndex )
+	{
+		const size_t uiOffset = uiIndex * CNetworkChunkPool::CHUNK_SIZE;
+
+		memcpy( pDestBytes + uiOffset, GetChunkData( uiIndex ), std::min( uiNumBytes - uiOffset, CNetworkChunkPool::CHUNK_SIZE ) );
+	}
+
+	return true;
+}
+
+bool CNetworkMessage::WriteTo( CNetworkBuffer& buffer ) const
+{
+	const size_t uiNumBits = GetBitsInMessage();
+
+	for( size_t uiIndex = 0; uiIndex < m_Chunks.size(); ++uiIndex )
+	{
+		const size_t uiOffset = ByteBit( uiIndex * CNetworkChunkPool::CHUNK_SIZE );
+
+		if( !buffer.WriteBits( GetChunkData( uiIndex ), std::min( uiNumBits - uiOffset, ByteBit( CNetworkChunkPool::CHUNK_SIZE ) ) ) )
+			return false;
+	}
+
+	return !buffer.HasOverflowed();
+}
+
+void CNetworkMessage::WriteUnsignedBitLong( unsigned int iValue, const size_t uiNumBits )
+{
+	assert( uiNumBits <= 32 );
+
+	if( m_bOverflowed || uiNumBits == 0 )
+		return;
+
+	const size_t uiBitsLeft = m_Buffer.GetBitsLeft();
+
+	if( uiNumBits <= uiBitsLeft )
+	{
+		m_Buffer.WriteUnsignedBitLong( iValue, uiNumBits );
+		return;
+	}
+
+	//Split the value between this chunk and the next.
+	if( uiBitsLeft > 0 )
+		m_Buffer.WriteUnsignedBitLong( iValue & ( ( 1U << uiBitsLeft ) - 1 ), uiBitsLeft );
+
+	if( !NextChunk() )
+		return;
+
+	m_Buffer.WriteUnsignedBitLong( uiBitsLeft < 32 ? iValue >> uiBitsLeft : 0, uiNumBits - uiBitsLeft );
+}
+
+void CNetworkMessage::WriteSignedBitLong( int iValue, const size_t uiNumBits )
+{
+	assert( uiNumBits >= 1 );
+
+	//Same bits as CNetworkBuffer::WriteSignedBitLong: the magnitude bits, then the sign bit.
+	const unsigned int uiMagnitude = static_cast<unsigned int>( iValue ) & static_cast<unsigned int>( ( static_cast<uint64_t>( 1 ) << ( uiNumBits - 1 ) ) - 1 );
+
+	WriteUnsignedBitLong( uiMagnitude | ( ( iValue < 0 ? 1U : 0U ) << ( uiNumBits - 1 ) ), uiNumBits );
+}
+
+void CNetworkMessage::WriteBitFloat( const float flValue )
+{
+	int iVal;
+
+	memcpy( &iVal, &flValue, sizeof( iVal ) );
+
+	WriteSignedBitLong( iVal, 32 );
+}
+
+bool CNetworkMessage::WriteBits( const void* pData, const size_t uiNumBits )
+{
+	auto pBytes = reinterpret_cast<const uint8_t*>( pData );
+
+	size_t uiBitsLeft = uiNumBits;
+
+	while( uiBitsLeft > 0 && !m_bOverflowed )
+	{
+		const size_t uiChunkBitsLeft = m_Buffer.GetBitsLeft();
+
+		if( uiChunkBitsLeft == 0 )
+		{
+			NextChunk();
+			continue;
+		}
+
+		if( uiBitsLeft <= uiChunkBitsLeft )
+		{
+			m_Buffer.WriteBits( pBytes, uiBitsLeft );
+			break;
+		}
+
+		//The whole bytes that fit, then the byte that straddles the chunks.
+		const size_t uiBytes = uiChunkBitsLeft >> 3;
+
+		m_Buffer.WriteBits( pBytes, ByteBit( uiBytes ) );
+
+		pBytes += uiBytes;
+		uiBitsLeft -= ByteBit( uiBytes );
+
+		const size_t uiStraddleBits = std::min<size_t>( uiBitsLeft, 8 );
+
+		WriteUnsignedBitLong( *pBytes, uiStraddleBits );
+
+		++pBytes;
+		uiBitsLeft -= uiStraddleBits;
+	}
+
+	return !m_bOverflowed;
+}
+
+bool CNetworkMessage::WriteString( const char* pszString )
+{
+	//Same bits as writing each character with WriteChar.
+	if( pszString )
+		return WriteBytes( pszString, strlen( pszString ) + 1 );
+
+	WriteChar( 0 );
+
+	return !m_bOverflowed;
+}
+
+bool CNetworkMessage::NextChunk()
+{
+	const uint32_t uiChunk = m_Pool.Allocate();
+
+	if( uiChunk == CNetworkChunkPool::INVALID_CHUNK )
+	{
+		Warning( "CNetworkMessage::NextChunk: Out of network chunks, message \"%s\" is truncated at %u bytes\n",
+				 m_pszDebugName, static_cast<unsigned int>( GetBytesInMessage() ) );
+
+		m_bOverflowed = true;
+		return false;
+	}
+
+	m_Chunks.push_back( uiChunk );
+
+	m_Buffer.SetBuffer( m_pszDebugName, m_Pool.GetData( uiChunk ), CNetworkChunkPool::CHUNK_SIZE );
+
+	return true;
+}
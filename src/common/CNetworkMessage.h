@@ -0,0 +1,144 @@
+#ifndef COMMON_CNETWORKMESSAGE_H
+#define COMMON_CNETWORKMESSAGE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CNetworkBuffer.h"
+#include "CNetworkChunkPool.h"
+
+/**
+*	Network message that grows as it's written, by chaining chunks from a CNetworkChunkPool.
+*	The chunks form a single bit stream, identical to what CNetworkBuffer would write into one large buffer.
+*	Reset returns the chunks to the pool and keeps the chunk list's memory, so messages can be reused every frame without heap allocations.
+*	A message only overflows if the pool is exhausted, which is reported.
+*/
+class CNetworkMessage final
+{
+public:
+	/**
+	*	@param pool Pool to allocate chunks from. Must outlive the message.
+	*	@param pszDebugName Debug name. Must point to a static string.
+	*/
+	CNetworkMessage( CNetworkChunkPool& pool, const char* pszDebugName );
+	~CNetworkMessage();
+
+	const char* GetDebugName() const { return m_pszDebugName; }
+
+	/**
+	*	@return Whether the pool ran out of chunks. Every write after it is discarded.
+	*/
+	bool HasOverflowed() const { return m_bOverflowed; }
+
+	/**
+	*	@return Number of bits written.
+	*/
+	size_t GetBitsInMessage() const
+	{
+		return m_Chunks.empty() ? 0 : ByteBit( ( m_Chunks.size() - 1 ) * CNetworkChunkPool::CHUNK_SIZE ) + m_Buffer.GetBitsInBuffer();
+	}
+
+	/**
+	*	@return Number of bytes written, rounded up.
+	*/
+	size_t GetBytesInMessage() const { return BitByte( GetBitsInMessage() ); }
+
+	size_t GetChunkCount() const { return m_Chunks.size(); }
+
+	/**
+	*	@return Memory of a chunk. All chunks are full except the last one.
+	*/
+	const uint8_t* GetChunkData( const size_t uiIndex ) const { return m_Pool.GetData( m_Chunks[ uiIndex ] ); }
+
+	/**
+	*	Frees all chunks, and clears the overflow flag.
+	*/
+	void Reset();
+
+	/**
+	*	Copies the message to contiguous memory.
+	*	@return Whether the message fit. If not, nothing is copied.
+	*/
+	bool CopyTo( void* pDest, const size_t uiMaxBytes ) const;
+
+	/**
+	*	Appends the message to a buffer, at its current position.
+	*	@return Whether the buffer didn't overflow.
+	*/
+	bool WriteTo( CNetworkBuffer& buffer ) const;
+
+	/**
+	*	@see CNetworkBuffer::WriteOneBit
+	*/
+	void WriteOneBit( const int iValue )
+	{
+		WriteUnsignedBitLong( iValue ? 1 : 0, 1 );
+	}
+
+	/**
+	*	@see CNetworkBuffer::WriteUnsignedBitLong
+	*/
+	void WriteUnsignedBitLong( unsigned int iValue, const size_t uiNumBits );
+
+	/**
+	*	@see CNetworkBuffer::WriteSignedBitLong
+	*/
+	void WriteSignedBitLong( int iValue, const size_t uiNumBits );
+
+	/**
+	*	@see CNetworkBuffer::WriteBitFloat
+	*/
+	void WriteBitFloat( const float flValue );
+
+	/**
+	*	@see CNetworkBuffer::WriteBits
+	*/
+	bool WriteBits( const void* pData, const size_t uiNumBits );
+
+	void WriteChar( const int iValue ) { WriteSignedBitLong( iValue, sizeof( char ) << 3 ); }
+
+	void WriteByte( const int iValue ) { WriteUnsignedBitLong( ( unsigned int ) iValue, sizeof( uint8_t ) << 3 ); }
+
+	void WriteShort( const int iValue ) { WriteSignedBitLong( iValue, sizeof( short ) << 3 ); }
+
+	void WriteWord( const int iValue ) { WriteUnsignedBitLong( iValue, sizeof( unsigned short ) << 3 ); }
+
+	void WriteLong( const int iValue ) { WriteSignedBitLong( iValue, sizeof( int ) << 3 ); }
+
+	void WriteFloat( const float flValue ) { WriteBits( &flValue, sizeof( float ) << 3 ); }
+
+	bool WriteBytes( const void* pData, const size_t uiNumBytes ) { return WriteBits( pData, uiNumBytes << 3 ); }
+
+	/**
+	*	@see CNetworkBuffer::WriteString
+	*/
+	bool WriteString( const char* pszString );
+
+private:
+	/**
+	*	Starts writing to a new chunk.
+	*	@return Whether a chunk could be allocated.
+	*/
+	bool NextChunk();
+
+private:
+	CNetworkChunkPool& m_Pool;
+
+	const char* m_pszDebugName;
+
+	std::vector<uint32_t> m_Chunks;
+
+	/**
+	*	Writes to the last chunk.
+	*/
+	CNetworkBuffer m_Buffer;
+
+	bool m_bOverflowed = false;
+
+private:
+	CNetworkMessage( const CNetworkMessage& ) = delete;
+	CNetworkMessage& operator=( const CNetworkMessage& ) = delete;
+};
+
+#endif //COMMON_CNETWORKMESSAGE_H
@@ -0,0 +1,193 @@
+#include <cstring>
+
+#include "MemoryTracking.h"
+
+#include "CNetworkReassembler.h"
+
+const size_t CNetworkReassembler::DEFAULT_BUFFERS;
+const uint64_t CNetworkReassembler::DEFAULT_TIMEOUT_MS;
+const size_t CNetworkReassembler::BITMAP_WORDS;
+
+CNetworkReassembler::CNetworkReassembler( const char* pszDebugName, const size_t uiBuffers )
+	: m_pszDebugName( pszDebugName )
+	, m_uiBufferCount( uiBuffers )
+	, m_Buffers( new Buffer_t[ uiBuffers ] )
+	//CNetworkBuffer accesses whole dwords.
+	, m_Storage( new uint32_t[ uiBuffers * CNetworkFragmenter::MAX_MESSAGE_SIZE / sizeof( uint32_t ) ] )
+{
+	Mem_RecordAlloc( MemoryTag::NETWORK, m_uiBufferCount * CNetworkFragmenter::MAX_MESSAGE_SIZE );
+
+	for( size_t uiBuffer = 0; uiBuffer < m_uiBufferCount; ++uiBuffer )
+	{
+		m_Buffers[ uiBuffer ].pData = reinterpret_cast<uint8_t*>( m_Storage.get() ) + uiBuffer * CNetworkFragmenter::MAX_MESSAGE_SIZE;
+	}
+}
+
+CNetworkReassembler::~CNetworkReassembler()
+{
+	Mem_RecordFree( MemoryTag::NETWORK, m_uiBufferCount * CNetworkFragmenter::MAX_MESSAGE_SIZE );
+}
+
+CNetworkBuffer* CNetworkReassembler::ReadFragment( CNetworkBuffer& packet, const uint64_t uiTimeMS )
+{
+	const uint8_t uiStream = packet.ReadByte();
+	const uint16_t uiSequence = packet.ReadWord();
+	const size_t uiIndex = packet.ReadByte();
+	const size_t uiFragmentCount = static_cast<size_t>( packet.ReadByte() ) + 1;
+	const size_t uiPayloadSize = packet.ReadWord();
+
+	++m_Stats.uiFragments;
+
+	//Every fragment but the last is full, and the last one isn't empty.
+	const bool bIsLast = uiIndex + 1 == uiFragmentCount;
+
+	if( packet.HasOverflowed() || uiStream >= CNetworkFragmenter::MAX_STREAMS || uiIndex >= uiFragmentCount ||
+		( bIsLast ? uiPayloadSize == 0 || uiPayloadSize > CNetworkFragmenter::FRAGMENT_SIZE : uiPayloadSize != CNetworkFragmenter::FRAGMENT_SIZE ) ||
+		ByteBit( uiPayloadSize ) > packet.GetBitsLeft() )
+	{
+		++m_Stats.uiDropped;
+		packet.ExternalBytesWritten( uiPayloadSize );
+		return nullptr;
+	}
+
+	if( IsCompleted( uiStream, uiSequence ) )
+	{
+		++m_Stats.uiDuplicates;
+		packet.ExternalBytesWritten( uiPayloadSize );
+		return nullptr;
+	}
+
+	auto pBuffer = Find( uiStream, uiSequence );
+
+	if( !pBuffer )
+	{
+		pBuffer = Allocate();
+
+		if( !pBuffer )
+		{
+			++m_Stats.uiDropped;
+			packet.ExternalBytesWritten( uiPayloadSize );
+			return nullptr;
+		}
+
+		pBuffer->state = BufferState::ASSEMBLING;
+		pBuffer->uiStream = uiStream;
+		pBuffer->uiSequence = uiSequence;
+		pBuffer->uiFragmentCount = uiFragmentCount;
+		pBuffer->uiReceivedCount = 0;
+		pBuffer->uiSize = 0;
+
+		memset( pBuffer->received, 0, sizeof( pBuffer->received ) );
+	}
+	else if( pBuffer->uiFragmentCount != uiFragmentCount )
+	{
+		++m_Stats.uiDropped;
+		packet.ExternalBytesWritten( uiPayloadSize );
+		return nullptr;
+	}
+
+	pBuffer->uiLastTimeMS = uiTimeMS;
+
+	const uint64_t uiBit = static_cast<uint64_t>( 1 ) << ( uiIndex % 64 );
+
+	if( pBuffer->received[ uiIndex / 64 ] & uiBit )
+	{
+		++m_Stats.uiDuplicates;
+		packet.ExternalBytesWritten( uiPayloadSize );
+		return nullptr;
+	}
+
+	//The only copy, straight to where it goes in the message.
+	packet.ReadBytes( pBuffer->pData + uiIndex * CNetworkFragmenter::FRAGMENT_SIZE, uiPayloadSize );
+
+	pBuffer->received[ uiIndex / 64 ] |= uiBit;
+
+	if( bIsLast )
+		pBuffer->uiSize = uiIndex * CNetworkFragmenter::FRAGMENT_SIZE + uiPayloadSize;
+
+	if( ++pBuffer->uiReceivedCount < pBuffer->uiFragmentCount )
+		return nullptr;
+
+	pBuffer->state = BufferState::COMPLETE;
+
+	m_uiLastCompleted[ uiStream ] = uiSequence;
+	m_bHasCompleted[ uiStream ] = true;
+
+	++m_Stats.uiMessages;
+
+	pBuffer->message.SetBuffer( m_pszDebugName, pBuffer->pData, pBuffer->uiSize );
+
+	return &pBuffer->message;
+}
+
+void CNetworkReassembler::Release( CNetworkBuffer* pMessage )
+{
+	for( size_t uiBuffer = 0; uiBuffer < m_uiBufferCount; ++uiBuffer )
+	{
+		auto& buffer = m_Buffers[ uiBuffer ];
+
+		if( &buffer.message == pMessage )
+		{
+			buffer.state = BufferState::FREE;
+			buffer.message.ResetToEmpty();
+			return;
+		}
+	}
+}
+
+void CNetworkReassembler::Update( const uint64_t uiTimeMS )
+{
+	for( size_t uiBuffer = 0; uiBuffer < m_uiBufferCount; ++uiBuffer )
+	{
+		auto& buffer = m_Buffers[ uiBuffer ];
+
+		if( buffer.state == BufferState::ASSEMBLING && uiTimeMS - buffer.uiLastTimeMS >= m_uiTimeoutMS )
+		{
+			buffer.state = BufferState::FREE;
+
+			++m_Stats.uiTimedOut;
+		}
+	}
+}
+
+void CNetworkReassembler::Reset()
+{
+	for( size_t uiBuffer = 0; uiBuffer < m_uiBufferCount; ++uiBuffer )
+	{
+		auto& buffer = m_Buffers[ uiBuffer ];
+
+		if( buffer.state == BufferState::ASSEMBLING )
+			buffer.state = BufferState::FREE;
+	}
+
+	memset( m_bHasCompleted, 0, sizeof( m_bHasCompleted ) );
+}
+
+CNetworkReassembler::Buffer_t* CNetworkReassembler::Find( const uint8_t uiStream, const uint16_t uiSequence )
+{
+	for( size_t uiBuffer = 0; uiBuffer < m_uiBufferCount; ++uiBuffer )
+	{
+		auto& buffer = m_Buffers[ uiBuffer ];
+
+		if( buffer.state == BufferState::ASSEMBLING && buffer.uiStream == uiStream && buffer.uiSequence == uiSequence )
+			return &buffer;
+	}
+
+	return nullptr;
+}
+
+CNetworkReassembler::Buffer_t* CNetworkReassembler::Allocate()
+{
+	for( size_t uiBuffer = 0; uiBuffer < m_uiBufferCount; ++uiBuffer )
+	{
+		if( m_Buffers[ uiBuffer ].state == BufferState::FREE )
+			return &m_Buffers[ uiBuffer ];
+	}
+
+	return nullptr;
+}
+
+bool CNetworkReassembler::IsCompleted( const uint8_t uiStream, const uint16_t uiSequence ) const
+{
+	return m_bHasCompleted[ uiStream ] && m_uiLastCompleted[ uiStream ] == uiSequence;
+}
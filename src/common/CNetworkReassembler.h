@@ -0,0 +1,175 @@
+#ifndef COMMON_CNETWORKREASSEMBLER_H
+#define COMMON_CNETWORKREASSEMBLER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "CNetworkBuffer.h"
+#include "CNetworkFragmenter.h"
+
+/**
+*	Reassembles messages that were split by CNetworkFragmenter.
+*	Each message being reassembled gets a buffer from a pool that is allocated up front, and tracks which fragments arrived in a bitmap.
+*	Payloads are read from the packet straight to their place in the buffer, so they're copied once and nothing is allocated per fragment.
+*	Fragments can arrive in any order and more than once. Messages that stop receiving fragments are dropped after a timeout,
+*	and fragments are dropped while all buffers are in use.
+*/
+class CNetworkReassembler final
+{
+public:
+	/**
+	*	Default number of messages that can be reassembled at once.
+	*/
+	static const size_t DEFAULT_BUFFERS = 4;
+
+	/**
+	*	Default time after which a message that didn't receive any fragments is dropped, in milliseconds.
+	*/
+	static const uint64_t DEFAULT_TIMEOUT_MS = 5000;
+
+	struct Stats_t
+	{
+		uint64_t uiFragments = 0;
+		uint64_t uiMessages = 0;
+
+		/**
+		*	Number of fragments that were received more than once.
+		*/
+		uint64_t uiDuplicates = 0;
+
+		/**
+		*	Number of fragments dropped because they were malformed, or all buffers were in use.
+		*/
+		uint64_t uiDropped = 0;
+
+		/**
+		*	Number of messages dropped because they timed out.
+		*/
+		uint64_t uiTimedOut = 0;
+	};
+
+public:
+	/**
+	*	@param pszDebugName Debug name of the messages' buffers. Must point to a static string.
+	*	@param uiBuffers Number of messages that can be reassembled at once. Each buffer is CNetworkFragmenter::MAX_MESSAGE_SIZE bytes.
+	*/
+	CNetworkReassembler( const char* pszDebugName, const size_t uiBuffers = DEFAULT_BUFFERS );
+	~CNetworkReassembler();
+
+	void SetTimeout( const uint64_t uiTimeoutMS ) { m_uiTimeoutMS = uiTimeoutMS; }
+
+	/**
+	*	Reads a fragment from a packet, at its current position. The read position is moved past the fragment, even if it's dropped.
+	*	@param packet Packet to read from.
+	*	@param uiTimeMS Current time, in milliseconds.
+	*	@return If the fragment completed a message, a buffer to read the message from, valid until it's passed to Release. Otherwise null.
+	*/
+	CNetworkBuffer* ReadFragment( CNetworkBuffer& packet, const uint64_t uiTimeMS );
+
+	/**
+	*	Returns a completed message's buffer to the pool.
+	*/
+	void Release( CNetworkBuffer* pMessage );
+
+	/**
+	*	Drops messages that timed out. Call regularly.
+	*	@param uiTimeMS Current time, in milliseconds.
+	*/
+	void Update( const uint64_t uiTimeMS );
+
+	/**
+	*	Drops all messages that are being reassembled. Completed messages stay valid until they're released.
+	*/
+	void Reset();
+
+	const Stats_t& GetStats() const { return m_Stats; }
+
+private:
+	enum class BufferState : uint8_t
+	{
+		FREE,
+		ASSEMBLING,
+		COMPLETE
+	};
+
+	static const size_t BITMAP_WORDS = ( CNetworkFragmenter::MAX_FRAGMENTS + 63 ) / 64;
+
+	struct Buffer_t
+	{
+		BufferState state = BufferState::FREE;
+
+		uint8_t uiStream = 0;
+
+		uint16_t uiSequence = 0;
+
+		size_t uiFragmentCount = 0;
+
+		size_t uiReceivedCount = 0;
+
+		/**
+		*	Size of the message, known once the last fragment arrived.
+		*/
+		size_t uiSize = 0;
+
+		/**
+		*	When the last fragment arrived.
+		*/
+		uint64_t uiLastTimeMS = 0;
+
+		/**
+		*	Which fragments arrived.
+		*/
+		uint64_t received[ BITMAP_WORDS ];
+
+		uint8_t* pData = nullptr;
+
+		/**
+		*	Reads the message once it's complete.
+		*/
+		CNetworkBuffer message;
+	};
+
+	/**
+	*	@return The buffer that reassembles a message, if it's being reassembled.
+	*/
+	Buffer_t* Find( const uint8_t uiStream, const uint16_t uiSequence );
+
+	/**
+	*	@return A free buffer, or null if all are in use.
+	*/
+	Buffer_t* Allocate();
+
+	/**
+	*	@return Whether a message was the last one completed on its stream, so its fragments are late duplicates.
+	*/
+	bool IsCompleted( const uint8_t uiStream, const uint16_t uiSequence ) const;
+
+private:
+	const char* const m_pszDebugName;
+
+	const size_t m_uiBufferCount;
+
+	std::unique_ptr<Buffer_t[]> m_Buffers;
+
+	/**
+	*	Backing memory of all buffers.
+	*/
+	std::unique_ptr<uint32_t[]> m_Storage;
+
+	uint64_t m_uiTimeoutMS = DEFAULT_TIMEOUT_MS;
+
+	/**
+	*	Sequence number of the last message completed on each stream, if m_bHasCompleted is set for it.
+	*/
+	uint16_t m_uiLastCompleted[ CNetworkFragmenter::MAX_STREAMS ] = {};
+	bool m_bHasCompleted[ CNetworkFragmenter::MAX_STREAMS ] = {};
+
+	Stats_t m_Stats;
+
+private:
+	CNetworkReassembler( const CNetworkReassembler& ) = delete;
+	CNetworkReassembler& operator=( const CNetworkReassembler& ) = delete;
+};
+
+#endif //COMMON_CNETWORKREASSEMBLER_H
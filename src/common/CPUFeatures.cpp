@@ -0,0 +1,233 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "CPUFeatures.h"
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <intrin.h>
+
+#define CPUFEATURES_X86
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <cpuid.h>
+
+#define CPUFEATURES_X86
+#endif
+
+namespace
+{
+const char* const FEATURE_NAMES[ CPUFeature::NUM_FEATURES ] =
+{
+	"sse2",
+	"ssse3",
+	"sse4.2",
+	"avx2",
+	"avx512",
+	"neon"
+};
+
+#ifdef CPUFEATURES_X86
+enum Register
+{
+	EAX = 0,
+	EBX,
+	ECX,
+	EDX
+};
+
+/**
+*	@return Whether the leaf is supported.
+*/
+bool CPUID( const unsigned int uiLeaf, const unsigned int uiSubLeaf, unsigned int ( &registers )[ 4 ] )
+{
+#ifdef _MSC_VER
+	int info[ 4 ];
+
+	__cpuid( info, 0 );
+
+	if( static_cast<unsigned int>( info[ 0 ] ) < uiLeaf )
+		return false;
+
+	__cpuidex( info, static_cast<int>( uiLeaf ), static_cast<int>( uiSubLeaf ) );
+
+	for( int iRegister = 0; iRegister < 4; ++iRegister )
+	{
+		registers[ iRegister ] = static_cast<unsigned int>( info[ iRegister ] );
+	}
+#else
+	if( __get_cpuid_max( 0, nullptr ) < uiLeaf )
+		return false;
+
+	__cpuid_count( uiLeaf, uiSubLeaf, registers[ EAX ], registers[ EBX ], registers[ ECX ], registers[ EDX ] );
+#endif
+
+	return true;
+}
+
+/**
+*	@return Which register states the operating system saves on context switches.
+*/
+uint64_t GetEnabledRegisterStates()
+{
+#ifdef _MSC_VER
+	return _xgetbv( 0 );
+#else
+	unsigned int uiLow, uiHigh;
+
+	//Not _xgetbv, which would need the whole file compiled for XSAVE.
+	__asm__ __volatile__( "xgetbv" : "=a" ( uiLow ), "=d" ( uiHigh ) : "c" ( 0 ) );
+
+	return ( static_cast<uint64_t>( uiHigh ) << 32 ) | uiLow;
+#endif
+}
+
+CPUFeatures_t DetectX86Features()
+{
+	CPUFeatures_t features = CPUFeature::NONE;
+
+	unsigned int registers[ 4 ];
+
+	if( !CPUID( 1, 0, registers ) )
+		return features;
+
+	if( registers[ EDX ] & ( 1 << 26 ) )
+		features |= CPUFeature::SSE2;
+
+	if( registers[ ECX ] & ( 1 << 9 ) )
+		features |= CPUFeature::SSSE3;
+
+	if( registers[ ECX ] & ( 1 << 20 ) )
+		features |= CPUFeature::SSE42;
+
+	//The wider registers can only be used if the operating system saves them, which OSXSAVE and XGETBV report.
+	const bool bOSXSAVE = ( registers[ ECX ] & ( 1 << 27 ) ) != 0;
+	const bool bAVX = ( registers[ ECX ] & ( 1 << 28 ) ) != 0;
+
+	if( !bOSXSAVE || !bAVX )
+		return features;
+
+	const uint64_t uiStates = GetEnabledRegisterStates();
+
+	//XMM and YMM.
+	const bool bYMMSaved = ( uiStates & 0x6 ) == 0x6;
+
+	//Mask registers and both halves of ZMM, on top of the above.
+	const bool bZMMSaved = bYMMSaved && ( uiStates & 0xE0 ) == 0xE0;
+
+	if( !bYMMSaved || !CPUID( 7, 0, registers ) )
+		return features;
+
+	if( registers[ EBX ] & ( 1 << 5 ) )
+		features |= CPUFeature::AVX2;
+
+	//Foundation, byte and word, and vector length.
+	const unsigned int uiAVX512Bits = ( 1u << 16 ) | ( 1u << 30 ) | ( 1u << 31 );
+
+	if( bZMMSaved && ( registers[ EBX ] & uiAVX512Bits ) == uiAVX512Bits )
+		features |= CPUFeature::AVX512;
+
+	return features;
+}
+#endif
+
+/**
+*	@return Features named in HL_DISABLE_CPU_FEATURES.
+*/
+CPUFeatures_t GetDisabledFeatures()
+{
+	const char* pszNames = getenv( "HL_DISABLE_CPU_FEATURES" );
+
+	if( !pszNames )
+		return CPUFeature::NONE;
+
+	CPUFeatures_t disabled = CPUFeature::NONE;
+
+	while( *pszNames )
+	{
+		const char* pszEnd = strchr( pszNames, ',' );
+
+		const size_t uiLength = pszEnd ? static_cast<size_t>( pszEnd - pszNames ) : strlen( pszNames );
+
+		if( uiLength == 3 && !strncmp( pszNames, "all", 3 ) )
+			return ~CPUFeature::NONE;
+
+		for( size_t uiFeature = 0; uiFeature < CPUFeature::NUM_FEATURES; ++uiFeature )
+		{
+			if( strlen( FEATURE_NAMES[ uiFeature ] ) == uiLength && !strncmp( pszNames, FEATURE_NAMES[ uiFeature ], uiLength ) )
+				disabled |= 1 << uiFeature;
+		}
+
+		if( !pszEnd )
+			break;
+
+		pszNames = pszEnd + 1;
+	}
+
+	return disabled;
+}
+
+CPUFeatures_t DetectFeatures()
+{
+	CPUFeatures_t features = CPUFeature::NONE;
+
+#if defined( CPUFEATURES_X86 )
+	features = DetectX86Features();
+#elif defined( __aarch64__ ) || defined( _M_ARM64 ) || defined( __ARM_NEON )
+	//Always there on 64 bit ARM. 32 bit builds only get here if they were compiled for it.
+	features = CPUFeature::NEON;
+#endif
+
+	return features & ~GetDisabledFeatures();
+}
+}
+
+CPUFeatures_t Plat_GetCPUFeatures()
+{
+	static const CPUFeatures_t features = DetectFeatures();
+
+	return features;
+}
+
+const char* Plat_GetCPUFeatureName( const CPUFeatures_t feature )
+{
+	for( size_t uiFeature = 0; uiFeature < CPUFeature::NUM_FEATURES; ++uiFeature )
+	{
+		if( feature == ( 1u << uiFeature ) )
+			return FEATURE_NAMES[ uiFeature ];
+	}
+
+	return nullptr;
+}
+
+size_t Plat_GetCPUFeatureString( char* pszBuffer, const size_t uiBufferSize )
+{
+	if( uiBufferSize == 0 )
+		return 0;
+
+	const CPUFeatures_t features = Plat_GetCPUFeatures();
+
+	size_t uiLength = 0;
+
+	pszBuffer[ 0 ] = '\0';
+
+	for( size_t uiFeature = 0; uiFeature < CPUFeature::NUM_FEATURES; ++uiFeature )
+	{
+		if( !( features & ( 1u << uiFeature ) ) )
+			continue;
+
+		const char* pszName = FEATURE_NAMES[ uiFeature ];
+
+		const size_t uiNameLength = strlen( pszName ) + ( uiLength > 0 ? 1 : 0 );
+
+		if( uiLength + uiNameLength >= uiBufferSize )
+			break;
+
+		if( uiLength > 0 )
+			pszBuffer[ uiLength++ ] = ' ';
+
+		strcpy( pszBuffer + uiLength, pszName );
+
+		uiLength += strlen( pszName );
+	}
+
+	return uiLength;
+}
@@ -0,0 +1,105 @@
+#ifndef COMMON_CPUFEATURES_H
+#define COMMON_CPUFEATURES_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+*	@file
+*	Runtime CPU feature detection, so a single build can use the best vector code each CPU supports.
+*	Vector functions are compiled for their instruction set with a target attribute, the rest of the code runs on any CPU,
+*	and the function to call is picked once with Plat_SelectKernel.
+*	Features can be turned off with the HL_DISABLE_CPU_FEATURES environment variable, a comma separated list of feature names
+*	as returned by Plat_GetCPUFeatureName, or "all". Used to test the fallbacks, and to compare kernels on the same machine.
+*/
+
+typedef uint32_t CPUFeatures_t;
+
+namespace CPUFeature
+{
+enum CPUFeature : CPUFeatures_t
+{
+	NONE	= 0,
+
+	SSE2	= 1 << 0,
+	SSSE3	= 1 << 1,
+	SSE42	= 1 << 2,
+
+	/**
+	*	AVX2, with the operating system saving the YMM registers.
+	*/
+	AVX2	= 1 << 3,
+
+	/**
+	*	AVX-512 foundation, byte and word, and vector length instructions, with the operating system saving the ZMM and mask registers.
+	*/
+	AVX512	= 1 << 4,
+
+	NEON	= 1 << 5,
+};
+
+/**
+*	Number of features.
+*/
+const size_t NUM_FEATURES = 6;
+}
+
+/**
+*	@return Features the CPU and operating system support, minus the ones that were turned off. Detected on the first call.
+*/
+CPUFeatures_t Plat_GetCPUFeatures();
+
+/**
+*	@return Whether all of the given features are supported.
+*/
+inline bool Plat_HasCPUFeatures( const CPUFeatures_t features )
+{
+	return ( Plat_GetCPUFeatures() & features ) == features;
+}
+
+/**
+*	@return Name of a single feature, or null if it isn't one.
+*/
+const char* Plat_GetCPUFeatureName( const CPUFeatures_t feature );
+
+/**
+*	Writes the names of the supported features, separated by spaces.
+*	@return Number of characters written, excluding the terminator.
+*/
+size_t Plat_GetCPUFeatureString( char* pszBuffer, const size_t uiBufferSize );
+
+/**
+*	Implementation of a function for CPUs with the given features.
+*/
+template<typename FUNCTION>
+struct CPUKernel_t
+{
+	CPUFeatures_t requiredFeatures;
+	FUNCTION pFunction;
+};
+
+/**
+*	Picks the best implementation of a function. Meant to initialize a static, so the choice is made once:
+*	@code
+*	static const auto pSwap = Plat_SelectKernel( SWAP_KERNELS );
+*	@endcode
+*	@param kernels Implementations, best first. The last one must not require any features.
+*	@return The first implementation whose features are all supported.
+*/
+template<typename FUNCTION, size_t COUNT>
+FUNCTION Plat_SelectKernel( const CPUKernel_t<FUNCTION> ( &kernels )[ COUNT ] )
+{
+	static_assert( COUNT > 0, "Plat_SelectKernel: no kernels" );
+
+	const CPUFeatures_t features = Plat_GetCPUFeatures();
+
+	for( const auto& kernel : kernels )
+	{
+		if( ( features & kernel.requiredFeatures ) == kernel.requiredFeatures )
+			return kernel.pFunction;
+	}
+
+	return kernels[ COUNT - 1 ].pFunction;
+}
+
+#endif //COMMON_CPUFEATURES_H
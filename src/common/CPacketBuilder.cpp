@@ -0,0 +1,90 @@
+#include <algorithm>
+#include <cstring>
+
+#include "CNetworkBuffer.h"
+#include "CNetworkMessage.h"
+
+#include "CPacketBuilder.h"
+
+const size_t CPacketBuilder::MAX_SEGMENTS;
+
+bool CPacketBuilder::AddSegment( const void* pData, const size_t uiSize )
+{
+	if( uiSize == 0 )
+		return true;
+
+	if( m_uiSegmentCount >= MAX_SEGMENTS )
+		return false;
+
+	auto& segment = m_Segments[ m_uiSegmentCount++ ];
+
+	segment.pData = reinterpret_cast<const uint8_t*>( pData );
+	segment.uiSize = uiSize;
+
+	m_uiSize += uiSize;
+
+	return true;
+}
+
+bool CPacketBuilder::AddSegment( const CNetworkBuffer& buffer )
+{
+	if( buffer.HasOverflowed() )
+		return false;
+
+	return AddSegment( buffer.GetData(), buffer.GetBytesInBuffer() );
+}
+
+bool CPacketBuilder::AddSegment( const CNetworkMessage& message )
+{
+	if( message.HasOverflowed() || m_uiSegmentCount + message.GetChunkCount() > MAX_SEGMENTS )
+		return false;
+
+	size_t uiBytesLeft = message.GetBytesInMessage();
+
+	for( size_t uiIndex = 0; uiIndex < message.GetChunkCount(); ++uiIndex )
+	{
+		const size_t uiSize = std::min( uiBytesLeft, CNetworkChunkPool::CHUNK_SIZE );
+
+		AddSegment( message.GetChunkData( uiIndex ), uiSize );
+
+		uiBytesLeft -= uiSize;
+	}
+
+	return true;
+}
+
+size_t CPacketBuilder::GetIOVecs( IOVec_t* pVecs ) const
+{
+	for( size_t uiIndex = 0; uiIndex < m_uiSegmentCount; ++uiIndex )
+	{
+		const auto& segment = m_Segments[ uiIndex ];
+
+		//The send calls don't modify the data, they just aren't declared const.
+#ifdef WIN32
+		pVecs[ uiIndex ].buf = reinterpret_cast<CHAR*>( const_cast<uint8_t*>( segment.pData ) );
+		pVecs[ uiIndex ].len = static_cast<ULONG>( segment.uiSize );
+#else
+		pVecs[ uiIndex ].iov_base = const_cast<uint8_t*>( segment.pData );
+		pVecs[ uiIndex ].iov_len = segment.uiSize;
+#endif
+	}
+
+	return m_uiSegmentCount;
+}
+
+bool CPacketBuilder::CopyTo( void* pDest, const size_t uiMaxBytes ) const
+{
+	if( m_uiSize > uiMaxBytes )
+		return false;
+
+	auto pDestBytes = reinterpret_cast<uint8_t*>( pDest );
+
+	for( size_t uiIndex = 0; uiIndex < m_uiSegmentCount; ++uiIndex )
+	{
+		memcpy( pDestBytes, m_Segments[ uiIndex ].pData, m_Segments[ uiIndex ].uiSize );
+
+		pDestBytes += m_Segments[ uiIndex ].uiSize;
+	}
+
+	return true;
+}
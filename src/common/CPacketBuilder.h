@@ -0,0 +1,108 @@
+#ifndef COMMON_CPACKETBUILDER_H
+#define COMMON_CPACKETBUILDER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef WIN32
+#include <winsock2.h>
+#else
+#include <sys/uio.h>
+#endif
+
+class CNetworkBuffer;
+class CNetworkMessage;
+
+/**
+*	Scatter/gather vector entry for the platform's gathering send call: WSABUF for WSASend, iovec for sendmsg.
+*/
+#ifdef WIN32
+typedef WSABUF IOVec_t;
+#else
+typedef struct iovec IOVec_t;
+#endif
+
+/**
+*	A contiguous run of bytes that is part of a packet.
+*/
+struct PacketSegment_t
+{
+	const uint8_t* pData;
+	size_t uiSize;
+};
+
+/**
+*	Assembles a packet from segments that are sent with a single gathering send, without copying them into one buffer.
+*	Segments are referenced, not copied, so a segment shared by several packets, like a broadcast message, is written once.
+*	Referenced memory must stay valid and unchanged until the packet is sent.
+*	Each segment is a whole number of bytes. Segments written with bit buffers are padded to the next byte.
+*/
+class CPacketBuilder final
+{
+public:
+	/**
+	*	Maximum number of segments in a packet. Most platforms allow at least this many buffers per send.
+	*/
+	static const size_t MAX_SEGMENTS = 16;
+
+public:
+	CPacketBuilder() = default;
+
+	size_t GetSegmentCount() const { return m_uiSegmentCount; }
+
+	const PacketSegment_t& GetSegment( const size_t uiIndex ) const { return m_Segments[ uiIndex ]; }
+
+	/**
+	*	@return Size of the packet, in bytes.
+	*/
+	size_t GetSize() const { return m_uiSize; }
+
+	/**
+	*	Removes all segments.
+	*/
+	void Reset()
+	{
+		m_uiSegmentCount = 0;
+		m_uiSize = 0;
+	}
+
+	/**
+	*	Adds a segment. Empty segments are ignored.
+	*	@return Whether there was room for the segment.
+	*/
+	bool AddSegment( const void* pData, const size_t uiSize );
+
+	/**
+	*	Adds the bytes written to a buffer, up to its current position.
+	*	@return Whether there was room for the segment, and the buffer didn't overflow.
+	*/
+	bool AddSegment( const CNetworkBuffer& buffer );
+
+	/**
+	*	Adds each chunk of a message as a segment.
+	*	@return Whether there was room for all chunks, and the message didn't overflow. If not, nothing is added.
+	*/
+	bool AddSegment( const CNetworkMessage& message );
+
+	/**
+	*	Fills in the vector passed to the send call.
+	*	@param pVecs Destination. Must have room for GetSegmentCount() entries.
+	*	@return Number of entries filled in.
+	*/
+	size_t GetIOVecs( IOVec_t* pVecs ) const;
+
+	/**
+	*	Copies the packet to contiguous memory, for sends that can't gather.
+	*	@return Whether the packet fit. If not, nothing is copied.
+	*/
+	bool CopyTo( void* pDest, const size_t uiMaxBytes ) const;
+
+private:
+	PacketSegment_t m_Segments[ MAX_SEGMENTS ];
+
+	size_t m_uiSegmentCount = 0;
+
+	size_t m_uiSize = 0;
+};
+
+#endif //COMMON_CPACKETBUILDER_H
@@ -0,0 +1,136 @@
+#ifndef COMMON_CQUEUESIGNAL_H
+#define COMMON_CQUEUESIGNAL_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+
+/**
+*	Lets the consumer of a lock-free queue sleep while the queue is empty. Used by CSPSCQueue and CMPSCQueue.
+*	Producers only lock if the consumer is waiting, so pushing stays lock-free while the consumer keeps up.
+*	The queue must publish values with a sequentially consistent store, and the consumer's predicate must check for them
+*	with a sequentially consistent load, so that either the consumer sees the value or the producer sees the consumer waiting.
+*/
+class CQueueSignal final
+{
+public:
+	/**
+	*	Number of times the consumer checks for a value, yielding in between, before it goes to sleep.
+	*/
+	static const unsigned int SPIN_COUNT = 64;
+
+public:
+	CQueueSignal() = default;
+
+	/**
+	*	@return The capacity to use for a queue that should hold at least the given number of values: the next power of 2, and at least 2.
+	*/
+	static size_t RoundUpCapacity( const size_t uiCapacity )
+	{
+		size_t uiRounded = 2;
+
+		while( uiRounded < uiCapacity )
+			uiRounded <<= 1;
+
+		return uiRounded;
+	}
+
+	/**
+	*	Wakes up the consumer if it is waiting. Called by producers after publishing a value.
+	*/
+	void Notify()
+	{
+		if( m_bWaiting.load( std::memory_order_seq_cst ) )
+		{
+			//Locking makes sure the consumer is either still checking its predicate or already waiting.
+			std::lock_guard<std::mutex> lock( m_Mutex );
+			m_Condition.notify_one();
+		}
+	}
+
+	/**
+	*	Waits until the predicate returns true or the signal is closed.
+	*	@return Whether the predicate returned true. False if the signal was closed first.
+	*/
+	template<typename PREDICATE>
+	bool Wait( PREDICATE predicate )
+	{
+		return WaitUntil( predicate, std::chrono::steady_clock::time_point::max() );
+	}
+
+	/**
+	*	Waits until the predicate returns true, the signal is closed or the deadline passes.
+	*	@return Whether the predicate returned true.
+	*/
+	template<typename PREDICATE>
+	bool WaitUntil( PREDICATE predicate, const std::chrono::steady_clock::time_point deadline );
+
+	/**
+	*	Wakes up the consumer for good. Waits return false from now on unless the predicate is already true.
+	*/
+	void Close()
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bClosed.store( true, std::memory_order_relaxed );
+
+		m_Condition.notify_all();
+	}
+
+	bool IsClosed() const { return m_bClosed.load( std::memory_order_relaxed ); }
+
+private:
+	std::atomic<bool> m_bWaiting{ false };
+	std::atomic<bool> m_bClosed{ false };
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+
+private:
+	CQueueSignal( const CQueueSignal& ) = delete;
+	CQueueSignal& operator=( const CQueueSignal& ) = delete;
+};
+
+template<typename PREDICATE>
+bool CQueueSignal::WaitUntil( PREDICATE predicate, const std::chrono::steady_clock::time_point deadline )
+{
+	//Values usually arrive soon after the queue runs dry, so try a few times before paying for a sleep and a wakeup.
+	for( unsigned int uiSpin = 0; uiSpin < SPIN_COUNT; ++uiSpin )
+	{
+		if( predicate() )
+			return true;
+
+		if( IsClosed() )
+			return false;
+
+		std::this_thread::yield();
+	}
+
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	m_bWaiting.store( true, std::memory_order_seq_cst );
+
+	bool bReady;
+
+	while( !( bReady = predicate() ) && !IsClosed() )
+	{
+		if( deadline == std::chrono::steady_clock::time_point::max() )
+		{
+			m_Condition.wait( lock );
+		}
+		else if( m_Condition.wait_until( lock, deadline ) == std::cv_status::timeout )
+		{
+			bReady = predicate();
+			break;
+		}
+	}
+
+	m_bWaiting.store( false, std::memory_order_relaxed );
+
+	return bReady;
+}
+
+#endif //COMMON_CQUEUESIGNAL_H
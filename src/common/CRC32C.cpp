@@ -0,0 +1,168 @@
+#include <cstring>
+
+#include "ByteSwap.h"
+#include "CPUFeatures.h"
+
+#include "CRC32C.h"
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <intrin.h>
+#include <nmmintrin.h>
+
+#define CRC32C_HARDWARE
+#define CRC32C_TARGET_SSE42
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <nmmintrin.h>
+
+#define CRC32C_HARDWARE
+//Only the hardware functions are compiled for SSE 4.2, so the rest runs on any CPU.
+#define CRC32C_TARGET_SSE42 __attribute__( ( target( "sse4.2" ) ) )
+#endif
+
+namespace crc32c
+{
+namespace
+{
+/**
+*	Reversed Castagnoli polynomial.
+*/
+const uint32_t POLYNOMIAL = 0x82F63B78;
+
+/**
+*	Tables for processing 8 bytes at a time. Table 0 is the regular byte at a time table.
+*/
+struct Tables_t
+{
+	uint32_t values[ 8 ][ 256 ];
+
+	Tables_t()
+	{
+		for( uint32_t uiIndex = 0; uiIndex < 256; ++uiIndex )
+		{
+			uint32_t uiValue = uiIndex;
+
+			for( int iBit = 0; iBit < 8; ++iBit )
+			{
+				uiValue = ( uiValue >> 1 ) ^ ( ( uiValue & 1 ) ? POLYNOMIAL : 0 );
+			}
+
+			values[ 0 ][ uiIndex ] = uiValue;
+		}
+
+		for( uint32_t uiIndex = 0; uiIndex < 256; ++uiIndex )
+		{
+			for( size_t uiTable = 1; uiTable < 8; ++uiTable )
+			{
+				const uint32_t uiPrevious = values[ uiTable - 1 ][ uiIndex ];
+
+				values[ uiTable ][ uiIndex ] = ( uiPrevious >> 8 ) ^ values[ 0 ][ uiPrevious & 0xFF ];
+			}
+		}
+	}
+};
+
+const Tables_t& GetTables()
+{
+	static const Tables_t tables;
+
+	return tables;
+}
+
+inline uint32_t Read32( const uint8_t* pData )
+{
+	uint32_t uiValue;
+
+	memcpy( &uiValue, pData, sizeof( uiValue ) );
+
+	return LittleValue( uiValue );
+}
+
+uint32_t UpdateSoftware( uint32_t uiCRC, const uint8_t* pData, size_t uiSize )
+{
+	const auto& tables = GetTables().values;
+
+	for( ; uiSize >= 8; uiSize -= 8, pData += 8 )
+	{
+		const uint32_t uiLow = Read32( pData ) ^ uiCRC;
+		const uint32_t uiHigh = Read32( pData + 4 );
+
+		uiCRC =
+			tables[ 7 ][ uiLow & 0xFF ] ^
+			tables[ 6 ][ ( uiLow >> 8 ) & 0xFF ] ^
+			tables[ 5 ][ ( uiLow >> 16 ) & 0xFF ] ^
+			tables[ 4 ][ uiLow >> 24 ] ^
+			tables[ 3 ][ uiHigh & 0xFF ] ^
+			tables[ 2 ][ ( uiHigh >> 8 ) & 0xFF ] ^
+			tables[ 1 ][ ( uiHigh >> 16 ) & 0xFF ] ^
+			tables[ 0 ][ uiHigh >> 24 ];
+	}
+
+	for( ; uiSize > 0; --uiSize, ++pData )
+	{
+		uiCRC = ( uiCRC >> 8 ) ^ tables[ 0 ][ ( uiCRC ^ *pData ) & 0xFF ];
+	}
+
+	return uiCRC;
+}
+
+#ifdef CRC32C_HARDWARE
+CRC32C_TARGET_SSE42 uint32_t UpdateHardware( uint32_t uiCRC, const uint8_t* pData, size_t uiSize )
+{
+#if defined( _M_X64 ) || defined( __x86_64__ )
+	uint64_t uiCRC64 = uiCRC;
+
+	for( ; uiSize >= 8; uiSize -= 8, pData += 8 )
+	{
+		uint64_t uiValue;
+
+		memcpy( &uiValue, pData, sizeof( uiValue ) );
+
+		uiCRC64 = _mm_crc32_u64( uiCRC64, uiValue );
+	}
+
+	uiCRC = static_cast<uint32_t>( uiCRC64 );
+#endif
+
+	for( ; uiSize >= 4; uiSize -= 4, pData += 4 )
+	{
+		uint32_t uiValue;
+
+		memcpy( &uiValue, pData, sizeof( uiValue ) );
+
+		uiCRC = _mm_crc32_u32( uiCRC, uiValue );
+	}
+
+	for( ; uiSize > 0; --uiSize, ++pData )
+	{
+		uiCRC = _mm_crc32_u8( uiCRC, *pData );
+	}
+
+	return uiCRC;
+}
+#endif
+}
+
+uint32_t Update( const uint32_t uiCRC, const void* pData, const size_t uiSize )
+{
+	if( !pData )
+		return uiCRC;
+
+	auto pBytes = reinterpret_cast<const uint8_t*>( pData );
+
+#ifdef CRC32C_HARDWARE
+	if( IsHardwareAccelerated() )
+		return ~UpdateHardware( ~uiCRC, pBytes, uiSize );
+#endif
+
+	return ~UpdateSoftware( ~uiCRC, pBytes, uiSize );
+}
+
+bool IsHardwareAccelerated()
+{
+#ifdef CRC32C_HARDWARE
+	return Plat_HasCPUFeatures( CPUFeature::SSE42 );
+#else
+	return false;
+#endif
+}
+}
@@ -0,0 +1,38 @@
+#ifndef COMMON_CRC32C_H
+#define COMMON_CRC32C_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+*	@file
+*	CRC-32C (Castagnoli) checksums, as used by iSCSI and SSE 4.2.
+*	Uses the CPU's CRC32 instruction when it's available, and a table driven implementation otherwise.
+*/
+
+namespace crc32c
+{
+/**
+*	Continues a checksum with more data.
+*	@param uiCRC Checksum of the data that came before, or 0 to start a new checksum.
+*	@param pData Data to add.
+*	@param uiSize Size of the data, in bytes.
+*	@return The checksum.
+*/
+uint32_t Update( const uint32_t uiCRC, const void* pData, const size_t uiSize );
+
+/**
+*	Computes the checksum of a block of data.
+*/
+inline uint32_t Compute( const void* pData, const size_t uiSize )
+{
+	return Update( 0, pData, uiSize );
+}
+
+/**
+*	@return Whether checksums are computed using the CPU's CRC32 instruction.
+*/
+bool IsHardwareAccelerated();
+}
+
+#endif //COMMON_CRC32C_H
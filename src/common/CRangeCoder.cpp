@@ -0,0 +1,163 @@
+#include "CRangeCoder.h"
+
+const uint32_t CRangeCoderModel::PROBABILITY_BITS;
+const uint32_t CRangeCoderModel::ADAPT_SHIFT;
+
+namespace
+{
+/**
+*	The range is renormalized when it gets below this.
+*/
+const uint32_t RANGE_TOP = 1 << 24;
+}
+
+void CRangeEncoder::EncodeByte( const uint8_t value )
+{
+	//Walk down the tree from the highest bit.
+	size_t uiNode = 1;
+
+	for( int iBit = 7; iBit >= 0; --iBit )
+	{
+		const uint32_t bit = ( value >> iBit ) & 1;
+
+		EncodeBit( m_Model.GetProbability( uiNode ), bit );
+
+		uiNode = ( uiNode << 1 ) | bit;
+	}
+}
+
+void CRangeEncoder::Encode( const void* pData, const size_t uiSize )
+{
+	auto pBytes = reinterpret_cast<const uint8_t*>( pData );
+
+	for( size_t uiIndex = 0; uiIndex < uiSize; ++uiIndex )
+	{
+		EncodeByte( pBytes[ uiIndex ] );
+	}
+}
+
+bool CRangeEncoder::Finish()
+{
+	if( !m_bFinished )
+	{
+		m_bFinished = true;
+
+		for( int iByte = 0; iByte < 5; ++iByte )
+		{
+			ShiftLow();
+		}
+
+		m_Writer.Flush();
+	}
+
+	return !m_Writer.HasOverflowed();
+}
+
+void CRangeEncoder::EncodeBit( uint16_t& probability, const uint32_t bit )
+{
+	const uint32_t uiBound = ( m_uiRange >> CRangeCoderModel::PROBABILITY_BITS ) * probability;
+
+	if( bit == 0 )
+	{
+		m_uiRange = uiBound;
+		probability += ( ( 1 << CRangeCoderModel::PROBABILITY_BITS ) - probability ) >> CRangeCoderModel::ADAPT_SHIFT;
+	}
+	else
+	{
+		m_uiLow += uiBound;
+		m_uiRange -= uiBound;
+		probability -= probability >> CRangeCoderModel::ADAPT_SHIFT;
+	}
+
+	while( m_uiRange < RANGE_TOP )
+	{
+		m_uiRange <<= 8;
+		ShiftLow();
+	}
+}
+
+void CRangeEncoder::ShiftLow()
+{
+	//Bytes of 0xFF can't be written until it's known whether a carry ripples through them.
+	if( static_cast<uint32_t>( m_uiLow ) < 0xFF000000 || ( m_uiLow >> 32 ) != 0 )
+	{
+		const auto carry = static_cast<uint8_t>( m_uiLow >> 32 );
+
+		uint8_t temp = m_Cache;
+
+		do
+		{
+			m_Writer.WriteUnsignedBitLong( static_cast<uint8_t>( temp + carry ), 8 );
+			temp = 0xFF;
+		}
+		while( --m_uiCacheSize != 0 );
+
+		m_Cache = static_cast<uint8_t>( m_uiLow >> 24 );
+	}
+
+	++m_uiCacheSize;
+
+	m_uiLow = ( m_uiLow & 0x00FFFFFF ) << 8;
+}
+
+CRangeDecoder::CRangeDecoder( CNetworkBuffer& buffer )
+	: m_Reader( buffer )
+{
+	for( int iByte = 0; iByte < 5; ++iByte )
+	{
+		m_uiCode = ( m_uiCode << 8 ) | m_Reader.ReadUnsignedBitLong( 8 );
+	}
+}
+
+uint8_t CRangeDecoder::DecodeByte()
+{
+	size_t uiNode = 1;
+
+	while( uiNode < 256 )
+	{
+		uiNode = ( uiNode << 1 ) | DecodeBit( m_Model.GetProbability( uiNode ) );
+	}
+
+	return static_cast<uint8_t>( uiNode );
+}
+
+bool CRangeDecoder::Decode( void* pBuffer, const size_t uiSize )
+{
+	auto pBytes = reinterpret_cast<uint8_t*>( pBuffer );
+
+	for( size_t uiIndex = 0; uiIndex < uiSize; ++uiIndex )
+	{
+		pBytes[ uiIndex ] = DecodeByte();
+	}
+
+	return !m_Reader.HasOverflowed();
+}
+
+uint32_t CRangeDecoder::DecodeBit( uint16_t& probability )
+{
+	const uint32_t uiBound = ( m_uiRange >> CRangeCoderModel::PROBABILITY_BITS ) * probability;
+
+	uint32_t bit;
+
+	if( m_uiCode < uiBound )
+	{
+		m_uiRange = uiBound;
+		probability += ( ( 1 << CRangeCoderModel::PROBABILITY_BITS ) - probability ) >> CRangeCoderModel::ADAPT_SHIFT;
+		bit = 0;
+	}
+	else
+	{
+		m_uiCode -= uiBound;
+		m_uiRange -= uiBound;
+		probability -= probability >> CRangeCoderModel::ADAPT_SHIFT;
+		bit = 1;
+	}
+
+	while( m_uiRange < RANGE_TOP )
+	{
+		m_uiRange <<= 8;
+		m_uiCode = ( m_uiCode << 8 ) | m_Reader.ReadUnsignedBitLong( 8 );
+	}
+
+	return bit;
+}
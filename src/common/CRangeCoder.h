@@ -0,0 +1,151 @@
+#ifndef COMMON_CRANGECODER_H
+#define COMMON_CRANGECODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CNetworkBuffer.h"
+
+/**
+*	@file
+*	Adaptive binary range coding of byte streams. Unlike CHuffmanCodec it needs no training,
+*	and learns the byte distribution of each stream as it goes. Costs more CPU per byte.
+*	The encoded data is a whole number of bytes. The size is not written, the reader must know it.
+*/
+
+/**
+*	Adaptive model of the byte values in a stream. The encoder and decoder each have one that starts out the same.
+*	Bytes are coded as 8 binary decisions, each with its own probability, in a binary tree.
+*/
+class CRangeCoderModel final
+{
+public:
+	/**
+	*	Number of bits used to store probabilities.
+	*/
+	static const uint32_t PROBABILITY_BITS = 11;
+
+	/**
+	*	How quickly probabilities adapt. Higher is slower.
+	*/
+	static const uint32_t ADAPT_SHIFT = 5;
+
+public:
+	CRangeCoderModel()
+	{
+		Reset();
+	}
+
+	/**
+	*	Resets all probabilities to even.
+	*/
+	void Reset()
+	{
+		for( auto& probability : m_Probabilities )
+		{
+			probability = 1 << ( PROBABILITY_BITS - 1 );
+		}
+	}
+
+	/**
+	*	@return Probability that the next decision is a 0, for the given tree node.
+	*/
+	uint16_t& GetProbability( const size_t uiNode ) { return m_Probabilities[ uiNode ]; }
+
+private:
+	uint16_t m_Probabilities[ 256 ];
+};
+
+/**
+*	Range encodes bytes to a network buffer. Meant to live on the stack while a stream is written.
+*	The buffer must not be used directly until the encoder is finished.
+*/
+class CRangeEncoder final
+{
+public:
+	explicit CRangeEncoder( CNetworkBuffer& buffer )
+		: m_Writer( buffer )
+	{
+	}
+
+	~CRangeEncoder()
+	{
+		Finish();
+	}
+
+	void EncodeByte( const uint8_t value );
+
+	void Encode( const void* pData, const size_t uiSize );
+
+	/**
+	*	Writes the bytes that are still pending. Must be called once after the last byte.
+	*	@return Whether the buffer didn't overflow.
+	*/
+	bool Finish();
+
+private:
+	void EncodeBit( uint16_t& probability, const uint32_t bit );
+
+	/**
+	*	Writes the top byte of the low end of the range, handling carries into bytes that weren't written yet.
+	*/
+	void ShiftLow();
+
+private:
+	CNetworkBitWriter m_Writer;
+
+	CRangeCoderModel m_Model;
+
+	uint64_t m_uiLow = 0;
+	uint32_t m_uiRange = 0xFFFFFFFF;
+
+	/**
+	*	Byte that may still get a carry, and the number of pending bytes including it.
+	*/
+	uint8_t m_Cache = 0;
+	uint64_t m_uiCacheSize = 1;
+
+	bool m_bFinished = false;
+
+private:
+	CRangeEncoder( const CRangeEncoder& ) = delete;
+	CRangeEncoder& operator=( const CRangeEncoder& ) = delete;
+};
+
+/**
+*	Decodes bytes that were written by CRangeEncoder.
+*/
+class CRangeDecoder final
+{
+public:
+	explicit CRangeDecoder( CNetworkBuffer& buffer );
+
+	uint8_t DecodeByte();
+
+	/**
+	*	@return Whether the buffer didn't overflow.
+	*/
+	bool Decode( void* pBuffer, const size_t uiSize );
+
+	/**
+	*	Updates the buffer's position. Reading can continue afterwards.
+	*/
+	void Flush() { m_Reader.Flush(); }
+
+private:
+	uint32_t DecodeBit( uint16_t& probability );
+
+private:
+	CNetworkBitReader m_Reader;
+
+	CRangeCoderModel m_Model;
+
+	uint32_t m_uiRange = 0xFFFFFFFF;
+	uint32_t m_uiCode = 0;
+
+private:
+	CRangeDecoder( const CRangeDecoder& ) = delete;
+	CRangeDecoder& operator=( const CRangeDecoder& ) = delete;
+};
+
+#endif //COMMON_CRANGECODER_H
@@ -0,0 +1,295 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "CReliableChannel.h"
+
+const size_t CReliableChannel::WINDOW_SIZE;
+const size_t CReliableChannel::MAX_MESSAGE_SIZE;
+const uint64_t CReliableChannel::INITIAL_TIMEOUT_MS;
+const uint64_t CReliableChannel::MIN_TIMEOUT_MS;
+const uint64_t CReliableChannel::MAX_TIMEOUT_MS;
+const uint64_t CReliableChannel::MIN_TIMEOUT_MARGIN_MS;
+const unsigned int CReliableChannel::MAX_BACKOFF;
+
+static_assert( CReliableChannel::WINDOW_SIZE <= 64, "Acknowledgements cover the window with a 64 bit field" );
+static_assert( CReliableChannel::MAX_MESSAGE_SIZE <= UINT16_MAX, "Message sizes are sent as words" );
+
+CReliableChannel::CReliableChannel( const char* pszDebugName )
+	: m_pszDebugName( pszDebugName )
+	, m_SendSlots( new SendSlot_t[ WINDOW_SIZE ] )
+	, m_ReceiveSlots( new ReceiveSlot_t[ WINDOW_SIZE ] )
+{
+}
+
+void CReliableChannel::Reset()
+{
+	for( size_t uiSlot = 0; uiSlot < WINDOW_SIZE; ++uiSlot )
+	{
+		m_SendSlots[ uiSlot ].bAcknowledged = false;
+		m_SendSlots[ uiSlot ].uiSendCount = 0;
+		m_ReceiveSlots[ uiSlot ].bReceived = false;
+	}
+
+	m_uiSendBase = 0;
+	m_uiNextSequence = 0;
+	m_uiUnacknowledged = 0;
+
+	m_uiReceiveBase = 0;
+	m_uiLatestReceived = 0;
+	m_uiReceivedBits = 0;
+	m_bHasReceived = false;
+	m_bPendingAcks = false;
+	m_bReading = false;
+
+	m_bHasRTT = false;
+	m_flSmoothedRTT = 0;
+	m_flRTTVariance = 0;
+	m_uiTimeoutMS = INITIAL_TIMEOUT_MS;
+
+	m_ReadBuffer.ResetToEmpty();
+
+	m_Stats = Stats_t();
+}
+
+bool CReliableChannel::Send( const void* pData, const size_t uiSize )
+{
+	if( !CanSend() || !pData || uiSize == 0 || uiSize > MAX_MESSAGE_SIZE )
+		return false;
+
+	auto& slot = m_SendSlots[ m_uiNextSequence % WINDOW_SIZE ];
+
+	memcpy( slot.data, pData, uiSize );
+
+	slot.uiSize = static_cast<uint16_t>( uiSize );
+	slot.bAcknowledged = false;
+	slot.uiSendCount = 0;
+
+	++m_uiNextSequence;
+	++m_uiUnacknowledged;
+
+	return true;
+}
+
+void CReliableChannel::WriteAcks( CNetworkBuffer& packet )
+{
+	packet.WriteOneBit( m_bHasReceived );
+
+	if( m_bHasReceived )
+	{
+		packet.WriteWord( m_uiLatestReceived );
+		packet.WriteUnsignedBitLong( static_cast<unsigned int>( m_uiReceivedBits ), 32 );
+		packet.WriteUnsignedBitLong( static_cast<unsigned int>( m_uiReceivedBits >> 32 ), 32 );
+	}
+
+	m_bPendingAcks = false;
+}
+
+void CReliableChannel::ReadAcks( CNetworkBuffer& packet, const uint64_t uiTimeMS )
+{
+	if( !packet.ReadOneBit() )
+		return;
+
+	const uint16_t uiLatest = packet.ReadWord();
+
+	uint64_t uiBits = packet.ReadUnsignedBitLong( 32 );
+
+	uiBits |= static_cast<uint64_t>( packet.ReadUnsignedBitLong( 32 ) ) << 32;
+
+	if( packet.HasOverflowed() )
+		return;
+
+	Acknowledge( uiLatest, uiTimeMS );
+
+	for( uint16_t uiBit = 0; uiBits; ++uiBit, uiBits >>= 1 )
+	{
+		if( uiBits & 1 )
+			Acknowledge( static_cast<uint16_t>( uiLatest - 1 - uiBit ), uiTimeMS );
+	}
+
+	AdvanceSendBase();
+}
+
+size_t CReliableChannel::WriteMessages( CNetworkBuffer& packet, const uint64_t uiTimeMS )
+{
+	size_t uiCount = 0;
+
+	for( uint16_t uiSequence = m_uiSendBase; uiSequence != m_uiNextSequence; ++uiSequence )
+	{
+		auto& slot = m_SendSlots[ uiSequence % WINDOW_SIZE ];
+
+		if( slot.bAcknowledged || ( slot.uiSendCount > 0 && uiTimeMS < slot.uiResendTimeMS ) )
+			continue;
+
+		//Continuation bit, sequence number, size, data, and the bit that ends the list.
+		if( packet.GetBitsLeft() < 1 + 16 + 16 + ByteBit<size_t>( slot.uiSize ) + 1 )
+			break;
+
+		packet.WriteOneBit( 1 );
+		packet.WriteWord( uiSequence );
+		packet.WriteWord( slot.uiSize );
+		packet.WriteBytes( slot.data, slot.uiSize );
+
+		if( slot.uiSendCount > 0 )
+			++m_Stats.uiRetransmitted;
+		else
+			++m_Stats.uiSent;
+
+		++slot.uiSendCount;
+
+		const unsigned int uiBackoff = std::min( slot.uiSendCount - 1, MAX_BACKOFF );
+
+		slot.uiSentTimeMS = uiTimeMS;
+		slot.uiResendTimeMS = uiTimeMS + std::min( m_uiTimeoutMS << uiBackoff, MAX_TIMEOUT_MS );
+
+		++uiCount;
+	}
+
+	packet.WriteOneBit( 0 );
+
+	return uiCount;
+}
+
+bool CReliableChannel::ReadMessages( CNetworkBuffer& packet )
+{
+	while( packet.ReadOneBit() )
+	{
+		const uint16_t uiSequence = packet.ReadWord();
+		const size_t uiSize = packet.ReadWord();
+
+		if( packet.HasOverflowed() || uiSize == 0 || uiSize > MAX_MESSAGE_SIZE || ByteBit( uiSize ) > packet.GetBitsLeft() )
+			return false;
+
+		auto& slot = m_ReceiveSlots[ uiSequence % WINDOW_SIZE ];
+
+		//Older messages were delivered already. The sender never gets further ahead than the window.
+		if( static_cast<uint16_t>( uiSequence - m_uiReceiveBase ) >= WINDOW_SIZE || slot.bReceived )
+		{
+			++m_Stats.uiDuplicates;
+
+			//The acknowledgement was probably lost, so send it again.
+			m_bPendingAcks = true;
+
+			packet.ExternalBytesWritten( uiSize );
+			continue;
+		}
+
+		packet.ReadBytes( slot.data, uiSize );
+
+		slot.uiSize = static_cast<uint16_t>( uiSize );
+		slot.bReceived = true;
+
+		++m_Stats.uiReceived;
+
+		RecordReceived( uiSequence );
+
+		m_bPendingAcks = true;
+	}
+
+	return !packet.HasOverflowed();
+}
+
+CNetworkBuffer* CReliableChannel::BeginRead()
+{
+	auto& slot = m_ReceiveSlots[ m_uiReceiveBase % WINDOW_SIZE ];
+
+	if( !slot.bReceived )
+		return nullptr;
+
+	m_ReadBuffer.SetBuffer( m_pszDebugName, slot.data, slot.uiSize );
+
+	m_bReading = true;
+
+	return &m_ReadBuffer;
+}
+
+void CReliableChannel::EndRead()
+{
+	if( !m_bReading )
+		return;
+
+	m_ReceiveSlots[ m_uiReceiveBase % WINDOW_SIZE ].bReceived = false;
+
+	++m_uiReceiveBase;
+
+	m_bReading = false;
+}
+
+void CReliableChannel::AdvanceSendBase()
+{
+	while( m_uiSendBase != m_uiNextSequence && m_SendSlots[ m_uiSendBase % WINDOW_SIZE ].bAcknowledged )
+		++m_uiSendBase;
+}
+
+void CReliableChannel::Acknowledge( const uint16_t uiSequence, const uint64_t uiTimeMS )
+{
+	if( static_cast<uint16_t>( uiSequence - m_uiSendBase ) >= static_cast<uint16_t>( m_uiNextSequence - m_uiSendBase ) )
+		return;
+
+	auto& slot = m_SendSlots[ uiSequence % WINDOW_SIZE ];
+
+	//Also covers messages that were queued but not sent yet, which a corrupt acknowledgement could claim.
+	if( slot.bAcknowledged || slot.uiSendCount == 0 )
+		return;
+
+	slot.bAcknowledged = true;
+
+	--m_uiUnacknowledged;
+
+	//Resent messages can't tell which send was acknowledged.
+	if( slot.uiSendCount == 1 && uiTimeMS >= slot.uiSentTimeMS )
+		AddRoundTripSample( static_cast<double>( uiTimeMS - slot.uiSentTimeMS ) );
+}
+
+void CReliableChannel::RecordReceived( const uint16_t uiSequence )
+{
+	if( !m_bHasReceived )
+	{
+		m_bHasReceived = true;
+		m_uiLatestReceived = uiSequence;
+		m_uiReceivedBits = 0;
+		return;
+	}
+
+	if( IsSequenceNewer( uiSequence, m_uiLatestReceived ) )
+	{
+		const size_t uiShift = static_cast<uint16_t>( uiSequence - m_uiLatestReceived );
+
+		//The previous latest becomes bit uiShift - 1.
+		if( uiShift < 64 )
+			m_uiReceivedBits = ( m_uiReceivedBits << uiShift ) | ( static_cast<uint64_t>( 1 ) << ( uiShift - 1 ) );
+		else if( uiShift == 64 )
+			m_uiReceivedBits = static_cast<uint64_t>( 1 ) << 63;
+		else
+			m_uiReceivedBits = 0;
+
+		m_uiLatestReceived = uiSequence;
+	}
+	else
+	{
+		const size_t uiDistance = static_cast<uint16_t>( m_uiLatestReceived - uiSequence );
+
+		if( uiDistance >= 1 && uiDistance <= 64 )
+			m_uiReceivedBits |= static_cast<uint64_t>( 1 ) << ( uiDistance - 1 );
+	}
+}
+
+void CReliableChannel::AddRoundTripSample( const double flRTT )
+{
+	//RFC 6298.
+	if( !m_bHasRTT )
+	{
+		m_bHasRTT = true;
+		m_flSmoothedRTT = flRTT;
+		m_flRTTVariance = flRTT / 2;
+	}
+	else
+	{
+		m_flRTTVariance = 0.75 * m_flRTTVariance + 0.25 * std::fabs( m_flSmoothedRTT - flRTT );
+		m_flSmoothedRTT = 0.875 * m_flSmoothedRTT + 0.125 * flRTT;
+	}
+
+	const double flTimeout = std::ceil( m_flSmoothedRTT + std::max( static_cast<double>( MIN_TIMEOUT_MARGIN_MS ), 4 * m_flRTTVariance ) );
+
+	m_uiTimeoutMS = std::min( std::max( static_cast<uint64_t>( flTimeout ), MIN_TIMEOUT_MS ), MAX_TIMEOUT_MS );
+}
@@ -0,0 +1,272 @@
+#ifndef COMMON_CRELIABLECHANNEL_H
+#define COMMON_CRELIABLECHANNEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "CNetworkBuffer.h"
+#include "CNetworkFragmenter.h"
+
+/**
+*	Reliable, ordered message channel on top of unreliable packets.
+*	Messages are numbered and kept in a sliding send window until the other side acknowledges them.
+*	Acknowledgements are selective: the latest received sequence number and a bitfield of the ones before it,
+*	written into whatever packet goes out next, so losing one packet only resends the messages it carried and never stalls the rest of the window.
+*	Messages are resent when their own timer runs out, which is derived from the measured round trip time and backs off on every resend.
+*	The receiver buffers messages that arrive early, and delivers them in order.
+*	Nothing is allocated after construction.
+*/
+class CReliableChannel final
+{
+public:
+	/**
+	*	Number of messages that can be unacknowledged at once. Also the number of sequence numbers covered by an acknowledgement.
+	*/
+	static const size_t WINDOW_SIZE = 64;
+
+	/**
+	*	Largest message, in bytes. Large enough for a fragment, larger messages can be sent with CNetworkFragmenter.
+	*/
+	static const size_t MAX_MESSAGE_SIZE = CNetworkFragmenter::FRAGMENT_SIZE + CNetworkFragmenter::HEADER_SIZE;
+
+	/**
+	*	Retransmit timeout used before the round trip time is known, in milliseconds.
+	*/
+	static const uint64_t INITIAL_TIMEOUT_MS = 200;
+
+	/**
+	*	Bounds of the retransmit timeout, in milliseconds.
+	*/
+	static const uint64_t MIN_TIMEOUT_MS = 30;
+	static const uint64_t MAX_TIMEOUT_MS = 2000;
+
+	/**
+	*	Least time the timeout is above the round trip time, in milliseconds. Only messages that were sent once are measured,
+	*	so without it slow round trips would stop being measured once the timeout shrinks below them, and it would keep shrinking.
+	*/
+	static const uint64_t MIN_TIMEOUT_MARGIN_MS = 25;
+
+	/**
+	*	Maximum number of times the timeout of a message is doubled.
+	*/
+	static const unsigned int MAX_BACKOFF = 4;
+
+	struct Stats_t
+	{
+		uint64_t uiSent = 0;
+
+		/**
+		*	Number of messages that were sent again because they weren't acknowledged in time.
+		*/
+		uint64_t uiRetransmitted = 0;
+
+		uint64_t uiReceived = 0;
+
+		/**
+		*	Number of messages that were received more than once.
+		*/
+		uint64_t uiDuplicates = 0;
+	};
+
+public:
+	/**
+	*	@param pszDebugName Debug name of the delivered messages' buffers. Must point to a static string.
+	*/
+	CReliableChannel( const char* pszDebugName );
+
+	/**
+	*	Forgets all messages and starts over at sequence number 0, for a new connection.
+	*/
+	void Reset();
+
+	/**
+	*	Queues a message.
+	*	@return Whether there was room in the send window. If not, the message must be sent later.
+	*/
+	bool Send( const void* pData, const size_t uiSize );
+
+	/**
+	*	@return Whether a message can be queued.
+	*/
+	bool CanSend() const { return static_cast<uint16_t>( m_uiNextSequence - m_uiSendBase ) < WINDOW_SIZE; }
+
+	/**
+	*	@return Number of messages that weren't acknowledged yet.
+	*/
+	size_t GetUnacknowledgedCount() const { return m_uiUnacknowledged; }
+
+	/**
+	*	Writes the acknowledgement of the received messages. Should be written to every packet, reliable or not.
+	*/
+	void WriteAcks( CNetworkBuffer& packet );
+
+	/**
+	*	Reads an acknowledgement written by WriteAcks, and frees the messages it acknowledges.
+	*	@param uiTimeMS Current time, in milliseconds.
+	*/
+	void ReadAcks( CNetworkBuffer& packet, const uint64_t uiTimeMS );
+
+	/**
+	*	@return Whether messages were received that haven't been acknowledged in a packet yet.
+	*	If nothing else is being sent, a packet should be sent with just the acknowledgement.
+	*/
+	bool HasPendingAcks() const { return m_bPendingAcks; }
+
+	/**
+	*	Writes messages that haven't been sent yet, and ones whose timer ran out, oldest first, for as long as they fit.
+	*	@param uiTimeMS Current time, in milliseconds.
+	*	@return Number of messages written.
+	*/
+	size_t WriteMessages( CNetworkBuffer& packet, const uint64_t uiTimeMS );
+
+	/**
+	*	Reads messages written by WriteMessages. They can be read with BeginRead once all messages before them arrived.
+	*	@return Whether the messages could be read. If not, the packet is malformed.
+	*/
+	bool ReadMessages( CNetworkBuffer& packet );
+
+	/**
+	*	Starts reading the next message in order.
+	*	@return Buffer to read the message from, or null if the next message didn't arrive yet. Valid until EndRead.
+	*/
+	CNetworkBuffer* BeginRead();
+
+	/**
+	*	Frees the message started by BeginRead.
+	*/
+	void EndRead();
+
+	/**
+	*	@return Smoothed round trip time, in milliseconds, or 0 if it wasn't measured yet.
+	*/
+	double GetRoundTripTime() const { return m_flSmoothedRTT; }
+
+	/**
+	*	@return Retransmit timeout before backing off, in milliseconds.
+	*/
+	uint64_t GetTimeout() const { return m_uiTimeoutMS; }
+
+	const Stats_t& GetStats() const { return m_Stats; }
+
+	/**
+	*	@return Whether sequence number a comes after b, allowing for wrap around.
+	*/
+	static bool IsSequenceNewer( const uint16_t a, const uint16_t b )
+	{
+		return static_cast<int16_t>( a - b ) > 0;
+	}
+
+private:
+	struct SendSlot_t
+	{
+		uint16_t uiSize = 0;
+
+		bool bAcknowledged = false;
+
+		/**
+		*	Number of times the message was sent.
+		*/
+		unsigned int uiSendCount = 0;
+
+		/**
+		*	When the message was last sent.
+		*/
+		uint64_t uiSentTimeMS = 0;
+
+		/**
+		*	When the message is sent again if it isn't acknowledged.
+		*/
+		uint64_t uiResendTimeMS = 0;
+
+		uint8_t data[ MAX_MESSAGE_SIZE ];
+	};
+
+	struct ReceiveSlot_t
+	{
+		uint16_t uiSize = 0;
+
+		bool bReceived = false;
+
+		//CNetworkBuffer accesses whole dwords, and reads may touch the ones after the message.
+		alignas( 4 ) uint8_t data[ MAX_MESSAGE_SIZE + sizeof( uint64_t ) ];
+	};
+
+	/**
+	*	Frees acknowledged messages at the start of the send window.
+	*/
+	void AdvanceSendBase();
+
+	/**
+	*	Marks a message as acknowledged, if it's in the send window.
+	*/
+	void Acknowledge( const uint16_t uiSequence, const uint64_t uiTimeMS );
+
+	/**
+	*	Adds a received message to the acknowledgement.
+	*/
+	void RecordReceived( const uint16_t uiSequence );
+
+	/**
+	*	Updates the round trip time with a measurement.
+	*/
+	void AddRoundTripSample( const double flRTT );
+
+private:
+	const char* const m_pszDebugName;
+
+	std::unique_ptr<SendSlot_t[]> m_SendSlots;
+	std::unique_ptr<ReceiveSlot_t[]> m_ReceiveSlots;
+
+	/**
+	*	Oldest unacknowledged message.
+	*/
+	uint16_t m_uiSendBase = 0;
+
+	/**
+	*	Sequence number of the next message that is queued.
+	*/
+	uint16_t m_uiNextSequence = 0;
+
+	size_t m_uiUnacknowledged = 0;
+
+	/**
+	*	Sequence number of the next message that is delivered.
+	*/
+	uint16_t m_uiReceiveBase = 0;
+
+	/**
+	*	Latest sequence number that was received, and which of the WINDOW_SIZE before it were received. Bit 0 is the one before it.
+	*/
+	uint16_t m_uiLatestReceived = 0;
+	uint64_t m_uiReceivedBits = 0;
+
+	/**
+	*	Whether any message was received yet.
+	*/
+	bool m_bHasReceived = false;
+
+	bool m_bPendingAcks = false;
+
+	/**
+	*	Whether a message is being read.
+	*/
+	bool m_bReading = false;
+
+	bool m_bHasRTT = false;
+
+	double m_flSmoothedRTT = 0;
+	double m_flRTTVariance = 0;
+
+	uint64_t m_uiTimeoutMS = INITIAL_TIMEOUT_MS;
+
+	CNetworkBuffer m_ReadBuffer;
+
+	Stats_t m_Stats;
+
+private:
+	CReliableChannel( const CReliableChannel& ) = delete;
+	CReliableChannel& operator=( const CReliableChannel& ) = delete;
+};
+
+#endif //COMMON_CRELIABLECHANNEL_H
@@ -0,0 +1,215 @@
+#ifndef COMMON_CSPSCQUEUE_H
+#define COMMON_CSPSCQUEUE_H
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "CQueueSignal.h"
+
+/**
+*	Bounded lock-free queue with a single producer thread and a single consumer thread.
+*	Values are stored in a fixed ring that is allocated once. The read and write positions are kept on separate cache lines,
+*	and each side keeps a copy of the other side's position so it only reads the shared one when the ring looks full or empty.
+*	Pushing never blocks: if the ring is full, the value isn't pushed. Popping can either return immediately or wait for a value.
+*	@tparam T Type of the values. Must be nothrow move constructible.
+*/
+template<typename T>
+class CSPSCQueue final
+{
+public:
+	static_assert( std::is_nothrow_move_constructible<T>::value, "CSPSCQueue: values must be nothrow move constructible" );
+
+	/**
+	*	@param uiCapacity Number of values the queue can hold. Rounded up to a power of 2.
+	*/
+	explicit CSPSCQueue( const size_t uiCapacity );
+	~CSPSCQueue();
+
+	size_t GetCapacity() const { return m_uiMask + 1; }
+
+	/**
+	*	Approximate number of values in the queue. Only exact when called from the producer or consumer with the other side idle.
+	*/
+	size_t GetSize() const
+	{
+		return m_uiWriteIndex.load( std::memory_order_acquire ) - m_uiReadIndex.load( std::memory_order_acquire );
+	}
+
+	/**
+	*	Pushes a value. Only called by the producer.
+	*	@return Whether the value was pushed. False if the queue is full, in which case the value isn't moved from.
+	*/
+	bool TryPush( T&& value )
+	{
+		return TryEmplace( std::move( value ) );
+	}
+
+	bool TryPush( const T& value )
+	{
+		return TryEmplace( value );
+	}
+
+	/**
+	*	Constructs a value in place. Only called by the producer.
+	*	@return Whether the value was pushed. False if the queue is full.
+	*/
+	template<typename... ARGS>
+	bool TryEmplace( ARGS&&... args );
+
+	/**
+	*	Pops the oldest value. Only called by the consumer.
+	*	@return Whether a value was popped. False if the queue is empty.
+	*/
+	bool TryPop( T& value );
+
+	/**
+	*	Pops the oldest value, waiting until one is pushed or the queue is closed. Only called by the consumer.
+	*	@return Whether a value was popped. False if the queue is closed and empty.
+	*/
+	bool Pop( T& value );
+
+	/**
+	*	Pops the oldest value, waiting at most the given time for one to be pushed. Only called by the consumer.
+	*	@return Whether a value was popped.
+	*/
+	bool Pop( T& value, const std::chrono::milliseconds timeout );
+
+	/**
+	*	Wakes up the consumer and makes Pop return false once the queue is empty. Can be called from any thread.
+	*	Values can still be pushed, and are popped as usual.
+	*/
+	void Close() { m_Signal.Close(); }
+
+	bool IsClosed() const { return m_Signal.IsClosed(); }
+
+private:
+	typedef typename std::aligned_storage<sizeof( T ), alignof( T )>::type Storage_t;
+
+	T* GetSlot( const size_t uiIndex )
+	{
+		return reinterpret_cast<T*>( &m_Slots[ uiIndex & m_uiMask ] );
+	}
+
+	bool IsEmpty()
+	{
+		return m_uiReadIndex.load( std::memory_order_relaxed ) == m_uiWriteIndex.load( std::memory_order_seq_cst );
+	}
+
+private:
+	const size_t m_uiMask;
+
+	std::unique_ptr<Storage_t[]> m_Slots;
+
+	//Written by the consumer. The consumer's copy of the write index sits on the same line since only the consumer uses it.
+	alignas( 64 ) std::atomic<size_t> m_uiReadIndex{ 0 };
+	size_t m_uiCachedWriteIndex = 0;
+
+	//Written by the producer.
+	alignas( 64 ) std::atomic<size_t> m_uiWriteIndex{ 0 };
+	size_t m_uiCachedReadIndex = 0;
+
+	alignas( 64 ) CQueueSignal m_Signal;
+
+private:
+	CSPSCQueue( const CSPSCQueue& ) = delete;
+	CSPSCQueue& operator=( const CSPSCQueue& ) = delete;
+};
+
+template<typename T>
+CSPSCQueue<T>::CSPSCQueue( const size_t uiCapacity )
+	: m_uiMask( CQueueSignal::RoundUpCapacity( uiCapacity ) - 1 )
+	, m_Slots( new Storage_t[ m_uiMask + 1 ] )
+{
+}
+
+template<typename T>
+CSPSCQueue<T>::~CSPSCQueue()
+{
+	const size_t uiEnd = m_uiWriteIndex.load( std::memory_order_relaxed );
+
+	for( size_t uiIndex = m_uiReadIndex.load( std::memory_order_relaxed ); uiIndex != uiEnd; ++uiIndex )
+	{
+		GetSlot( uiIndex )->~T();
+	}
+}
+
+template<typename T>
+template<typename... ARGS>
+bool CSPSCQueue<T>::TryEmplace( ARGS&&... args )
+{
+	const size_t uiWriteIndex = m_uiWriteIndex.load( std::memory_order_relaxed );
+
+	if( uiWriteIndex - m_uiCachedReadIndex > m_uiMask )
+	{
+		m_uiCachedReadIndex = m_uiReadIndex.load( std::memory_order_acquire );
+
+		if( uiWriteIndex - m_uiCachedReadIndex > m_uiMask )
+			return false;
+	}
+
+	new ( GetSlot( uiWriteIndex ) ) T( std::forward<ARGS>( args )... );
+
+	//Sequentially consistent so the consumer either sees the value or is seen waiting.
+	m_uiWriteIndex.store( uiWriteIndex + 1, std::memory_order_seq_cst );
+
+	m_Signal.Notify();
+
+	return true;
+}
+
+template<typename T>
+bool CSPSCQueue<T>::TryPop( T& value )
+{
+	const size_t uiReadIndex = m_uiReadIndex.load( std::memory_order_relaxed );
+
+	if( uiReadIndex == m_uiCachedWriteIndex )
+	{
+		m_uiCachedWriteIndex = m_uiWriteIndex.load( std::memory_order_acquire );
+
+		if( uiReadIndex == m_uiCachedWriteIndex )
+			return false;
+	}
+
+	T* pValue = GetSlot( uiReadIndex );
+
+	value = std::move( *pValue );
+	pValue->~T();
+
+	m_uiReadIndex.store( uiReadIndex + 1, std::memory_order_release );
+
+	return true;
+}
+
+template<typename T>
+bool CSPSCQueue<T>::Pop( T& value )
+{
+	while( !TryPop( value ) )
+	{
+		if( !m_Signal.Wait( [ this ]() { return !IsEmpty(); } ) )
+			return TryPop( value );
+	}
+
+	return true;
+}
+
+template<typename T>
+bool CSPSCQueue<T>::Pop( T& value, const std::chrono::milliseconds timeout )
+{
+	const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+	while( !TryPop( value ) )
+	{
+		if( !m_Signal.WaitUntil( [ this ]() { return !IsEmpty(); }, deadline ) )
+			return TryPop( value );
+	}
+
+	return true;
+}
+
+#endif //COMMON_CSPSCQUEUE_H
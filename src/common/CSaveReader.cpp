@@ -0,0 +1,174 @@
+#include <algorithm>
+
+#include "CRC32C.h"
+#include "LZ4.h"
+
+#include "CSaveReader.h"
+
+CSaveReader::~CSaveReader()
+{
+	Close();
+}
+
+bool CSaveReader::Open( IFileSystem2& fileSystem, const char* pszFileName, const char* pszPathID )
+{
+	Close();
+
+	m_pFileSystem = &fileSystem;
+
+	m_hFile = m_pFileSystem->Open( pszFileName, "rb", pszPathID );
+
+	if( m_hFile == FILESYSTEM_INVALID_HANDLE )
+		return false;
+
+	m_bFailed = false;
+	m_bEnd = false;
+
+	save::Header_t header;
+
+	if( !ReadFile( &header, sizeof( header ) ) ||
+		memcmp( header.identifier, save::IDENTIFIER, sizeof( header.identifier ) ) || header.uiVersion != save::VERSION )
+	{
+		Close();
+		return false;
+	}
+
+	m_uiDataVersion = header.uiDataVersion;
+
+	if( !m_Buffer )
+	{
+		m_Buffer.reset( new uint8_t[ save::BLOCK_SIZE ] );
+		m_Compressed.reset( new uint8_t[ save::BLOCK_SIZE ] );
+	}
+
+	return true;
+}
+
+void CSaveReader::Close()
+{
+	if( m_hFile != FILESYSTEM_INVALID_HANDLE )
+	{
+		m_pFileSystem->Close( m_hFile );
+		m_hFile = FILESYSTEM_INVALID_HANDLE;
+	}
+
+	m_uiDataVersion = 0;
+	m_uiBufferSize = 0;
+	m_uiBufferPos = 0;
+}
+
+void CSaveReader::ReadSlow( uint8_t* pData, size_t uiSize )
+{
+	if( !IsOpen() )
+		Fail();
+
+	while( uiSize > 0 )
+	{
+		if( m_bFailed )
+		{
+			memset( pData, 0, uiSize );
+			return;
+		}
+
+		const size_t uiAvailable = m_uiBufferSize - m_uiBufferPos;
+
+		if( uiAvailable > 0 )
+		{
+			const size_t uiCopy = std::min( uiSize, uiAvailable );
+
+			memcpy( pData, m_Buffer.get() + m_uiBufferPos, uiCopy );
+
+			m_uiBufferPos += uiCopy;
+			pData += uiCopy;
+			uiSize -= uiCopy;
+			continue;
+		}
+
+		if( m_bEnd )
+		{
+			Fail();
+			continue;
+		}
+
+		const size_t uiRead = ReadBlock( pData, uiSize );
+
+		pData += uiRead;
+		uiSize -= uiRead;
+	}
+}
+
+size_t CSaveReader::ReadBlock( uint8_t* pDest, const size_t uiDestSize )
+{
+	m_uiBufferSize = 0;
+	m_uiBufferPos = 0;
+
+	save::BlockHeader_t header;
+
+	if( !ReadFile( &header, sizeof( header ) ) )
+		return 0;
+
+	if( header.uiSize == 0 )
+	{
+		m_bEnd = true;
+		return 0;
+	}
+
+	if( header.uiSize > save::BLOCK_SIZE || header.uiStoredSize > header.uiSize )
+	{
+		Fail();
+		return 0;
+	}
+
+	if( header.uiStoredSize == header.uiSize )
+	{
+		uint8_t* pTarget = header.uiSize <= uiDestSize ? pDest : m_Buffer.get();
+
+		if( !ReadFile( pTarget, header.uiSize ) )
+			return 0;
+
+		if( crc32c::Compute( pTarget, header.uiSize ) != header.uiChecksum )
+		{
+			Fail();
+			return 0;
+		}
+
+		if( pTarget == pDest )
+			return header.uiSize;
+
+		m_uiBufferSize = header.uiSize;
+
+		return 0;
+	}
+
+	if( !ReadFile( m_Compressed.get(), header.uiStoredSize ) )
+		return 0;
+
+	if( crc32c::Compute( m_Compressed.get(), header.uiStoredSize ) != header.uiChecksum ||
+		!lz4::Decompress( m_Compressed.get(), header.uiStoredSize, m_Buffer.get(), header.uiSize ) )
+	{
+		Fail();
+		return 0;
+	}
+
+	m_uiBufferSize = header.uiSize;
+
+	return 0;
+}
+
+bool CSaveReader::ReadFile( void* pData, const size_t uiSize )
+{
+	if( m_pFileSystem->Read( pData, static_cast<int>( uiSize ), m_hFile ) != static_cast<int>( uiSize ) )
+	{
+		Fail();
+		return false;
+	}
+
+	return true;
+}
+
+void CSaveReader::Fail()
+{
+	m_bFailed = true;
+	m_uiBufferSize = 0;
+	m_uiBufferPos = 0;
+}
@@ -0,0 +1,134 @@
+#ifndef COMMON_CSAVEREADER_H
+#define COMMON_CSAVEREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "FileSystem2.h"
+
+#include "SaveFile.h"
+
+/**
+*	Streams serialized data from a save file written by CSaveWriter through the filesystem.
+*	Blocks are read and decompressed one at a time. Reads that cover a whole uncompressed block go straight into the caller's memory.
+*	Once a read fails, because the save is corrupt or ends too soon, it and every later read return zeroes, like reads past the end of a network buffer.
+*	@see CSaveWriter
+*	@see save::Schema
+*/
+class CSaveReader final
+{
+public:
+	CSaveReader() = default;
+	~CSaveReader();
+
+	bool IsOpen() const { return m_hFile != FILESYSTEM_INVALID_HANDLE; }
+
+	/**
+	*	@return Whether a read failed.
+	*/
+	bool HasFailed() const { return m_bFailed; }
+
+	/**
+	*	Opens a save file. Closes the previous save first.
+	*	@param fileSystem Filesystem to read through. Must outlive the save.
+	*	@param pszFileName Name of the save file.
+	*	@param pszPathID Path ID to read from.
+	*	@return Whether the file could be opened and has a valid header.
+	*/
+	bool Open( IFileSystem2& fileSystem, const char* pszFileName, const char* pszPathID = nullptr );
+
+	void Close();
+
+	/**
+	*	@return Version of the data, as given to CSaveWriter::Open.
+	*/
+	uint32_t GetDataVersion() const { return m_uiDataVersion; }
+
+	/**
+	*	Reads bytes.
+	*/
+	void Read( void* pData, const size_t uiSize )
+	{
+		if( uiSize < m_uiBufferSize - m_uiBufferPos )
+		{
+			memcpy( pData, m_Buffer.get() + m_uiBufferPos, uiSize );
+			m_uiBufferPos += uiSize;
+		}
+		else
+		{
+			ReadSlow( reinterpret_cast<uint8_t*>( pData ), uiSize );
+		}
+	}
+
+	/**
+	*	Reads a value written with CSaveWriter::WriteValue.
+	*/
+	template<typename T>
+	void ReadValue( T& value )
+	{
+		static_assert( std::is_trivially_copyable<T>::value, "CSaveReader::ReadValue: only trivially copyable types can be read as is" );
+
+		Read( &value, sizeof( value ) );
+	}
+
+	/**
+	*	Reads an array of values written with CSaveWriter::WriteArray, in one copy.
+	*/
+	template<typename T>
+	void ReadArray( T* pValues, const size_t uiCount )
+	{
+		static_assert( std::is_trivially_copyable<T>::value, "CSaveReader::ReadArray: only trivially copyable types can be read as is" );
+
+		Read( pValues, uiCount * sizeof( T ) );
+	}
+
+	/**
+	*	@return Whether all of the data has been read. The end of a save is only found once a read reaches it.
+	*/
+	bool IsAtEnd() const { return m_bEnd && m_uiBufferPos == m_uiBufferSize; }
+
+private:
+	void ReadSlow( uint8_t* pData, size_t uiSize );
+
+	/**
+	*	Reads the next block. Uncompressed blocks that fit are read into pDest, others into the block buffer.
+	*	@return Number of bytes read into pDest.
+	*/
+	size_t ReadBlock( uint8_t* pDest, const size_t uiDestSize );
+
+	bool ReadFile( void* pData, const size_t uiSize );
+
+	void Fail();
+
+private:
+	IFileSystem2* m_pFileSystem = nullptr;
+
+	FileHandle_t m_hFile = FILESYSTEM_INVALID_HANDLE;
+
+	uint32_t m_uiDataVersion = 0;
+
+	bool m_bFailed = false;
+
+	/**
+	*	Whether the block that marks the end was read.
+	*/
+	bool m_bEnd = false;
+
+	/**
+	*	Current block. Allocated when a save is opened.
+	*/
+	std::unique_ptr<uint8_t[]> m_Buffer;
+	size_t m_uiBufferSize = 0;
+	size_t m_uiBufferPos = 0;
+
+	std::unique_ptr<uint8_t[]> m_Compressed;
+
+private:
+	CSaveReader( const CSaveReader& ) = delete;
+	CSaveReader& operator=( const CSaveReader& ) = delete;
+};
+
+#endif //COMMON_CSAVEREADER_H
@@ -0,0 +1,155 @@
+#include <algorithm>
+
+#include "CRC32C.h"
+#include "LZ4.h"
+
+#include "CSaveWriter.h"
+
+CSaveWriter::~CSaveWriter()
+{
+	Close();
+}
+
+bool CSaveWriter::Open( IFileSystem2& fileSystem, const char* pszFileName, const char* pszPathID, const uint32_t uiDataVersion, const bool bCompress )
+{
+	Close();
+
+	m_pFileSystem = &fileSystem;
+
+	m_hFile = m_pFileSystem->Open( pszFileName, "wb", pszPathID );
+
+	if( m_hFile == FILESYSTEM_INVALID_HANDLE )
+		return false;
+
+	m_bCompress = bCompress;
+	m_bFailed = false;
+
+	if( !m_Buffer )
+		m_Buffer.reset( new uint8_t[ save::BLOCK_SIZE ] );
+
+	//Compressed blocks are only kept if they're smaller.
+	if( m_bCompress && !m_Compressed )
+		m_Compressed.reset( new uint8_t[ save::BLOCK_SIZE ] );
+
+	m_uiBufferUsed = 0;
+	m_uiBufferSize = save::BLOCK_SIZE;
+	m_uiBytesWritten = 0;
+	m_uiBytesStored = 0;
+
+	save::Header_t header{};
+
+	memcpy( header.identifier, save::IDENTIFIER, sizeof( header.identifier ) );
+	header.uiVersion = save::VERSION;
+	header.uiDataVersion = uiDataVersion;
+
+	WriteFile( &header, sizeof( header ) );
+
+	return true;
+}
+
+bool CSaveWriter::Close()
+{
+	if( !IsOpen() )
+		return false;
+
+	if( m_uiBufferUsed > 0 )
+		WriteBlock( m_Buffer.get(), m_uiBufferUsed );
+
+	const save::BlockHeader_t end{};
+
+	WriteFile( &end, sizeof( end ) );
+
+	//Write errors are only known once everything is on disk.
+	m_pFileSystem->Flush( m_hFile );
+
+	const bool bSuccess = !m_bFailed && m_pFileSystem->IsOk( m_hFile );
+
+	m_pFileSystem->Close( m_hFile );
+	m_hFile = FILESYSTEM_INVALID_HANDLE;
+
+	m_uiBufferUsed = 0;
+	m_uiBufferSize = 0;
+
+	return bSuccess;
+}
+
+void CSaveWriter::WriteSlow( const uint8_t* pData, size_t uiSize )
+{
+	if( m_uiBufferSize == 0 )
+		return;
+
+	while( uiSize > 0 )
+	{
+		//Whole blocks are written straight from the caller's data.
+		if( m_uiBufferUsed == 0 && uiSize >= save::BLOCK_SIZE )
+		{
+			WriteBlock( pData, save::BLOCK_SIZE );
+
+			pData += save::BLOCK_SIZE;
+			uiSize -= save::BLOCK_SIZE;
+			continue;
+		}
+
+		const size_t uiCopy = std::min( uiSize, save::BLOCK_SIZE - m_uiBufferUsed );
+
+		memcpy( m_Buffer.get() + m_uiBufferUsed, pData, uiCopy );
+
+		m_uiBufferUsed += uiCopy;
+		pData += uiCopy;
+		uiSize -= uiCopy;
+
+		if( m_uiBufferUsed == save::BLOCK_SIZE )
+		{
+			WriteBlock( m_Buffer.get(), m_uiBufferUsed );
+			m_uiBufferUsed = 0;
+		}
+	}
+}
+
+void CSaveWriter::WriteBlock( const uint8_t* pData, const size_t uiSize )
+{
+	save::BlockHeader_t header{};
+
+	header.uiSize = static_cast<uint32_t>( uiSize );
+
+	const uint8_t* pStored = pData;
+	size_t uiStoredSize = uiSize;
+
+	if( m_bCompress )
+	{
+		const size_t uiCompressedSize = lz4::Compress( pData, uiSize, m_Compressed.get(), uiSize - 1 );
+
+		//0 if it didn't get smaller.
+		if( uiCompressedSize > 0 )
+		{
+			pStored = m_Compressed.get();
+			uiStoredSize = uiCompressedSize;
+		}
+	}
+
+	header.uiStoredSize = static_cast<uint32_t>( uiStoredSize );
+	header.uiChecksum = crc32c::Compute( pStored, uiStoredSize );
+
+	WriteFile( &header, sizeof( header ) );
+	WriteFile( pStored, uiStoredSize );
+
+	m_uiBytesWritten += uiSize;
+}
+
+void CSaveWriter::WriteFile( const void* pData, const size_t uiSize )
+{
+	if( m_bFailed )
+		return;
+
+	if( m_pFileSystem->Write( pData, static_cast<int>( uiSize ), m_hFile ) != static_cast<int>( uiSize ) )
+	{
+		m_bFailed = true;
+
+		//Discard everything that is written from now on.
+		m_uiBufferUsed = 0;
+		m_uiBufferSize = 0;
+		return;
+	}
+
+	m_uiBytesStored += uiSize;
+}
@@ -0,0 +1,144 @@
+#ifndef COMMON_CSAVEWRITER_H
+#define COMMON_CSAVEWRITER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "FileSystem2.h"
+
+#include "SaveFile.h"
+
+/**
+*	Streams serialized data to a save file through the filesystem.
+*	Data is collected into blocks, and each full block is optionally compressed and written out, so memory use doesn't depend on the size of the save.
+*	Writes that fill whole blocks skip the block buffer. With write-behind enabled the disk is never touched on the calling thread.
+*	@see CSaveReader
+*	@see save::Schema
+*/
+class CSaveWriter final
+{
+public:
+	CSaveWriter() = default;
+
+	/**
+	*	Closes the save, if one is open.
+	*/
+	~CSaveWriter();
+
+	bool IsOpen() const { return m_hFile != FILESYSTEM_INVALID_HANDLE; }
+
+	/**
+	*	@return Whether a write failed. Nothing is written after that.
+	*/
+	bool HasFailed() const { return m_bFailed; }
+
+	/**
+	*	Creates a save file. Closes the previous save first.
+	*	@param fileSystem Filesystem to write through. Must outlive the save.
+	*	@param pszFileName Name of the save file.
+	*	@param pszPathID Path ID to write to.
+	*	@param uiDataVersion Version of the data that will be written, returned by CSaveReader::GetDataVersion.
+	*	@param bCompress Whether to compress blocks with LZ4.
+	*	@return Whether the file could be created.
+	*/
+	bool Open( IFileSystem2& fileSystem, const char* pszFileName, const char* pszPathID, const uint32_t uiDataVersion, const bool bCompress );
+
+	/**
+	*	Writes the rest of the data and closes the file.
+	*	@return Whether everything was written.
+	*/
+	bool Close();
+
+	/**
+	*	Writes bytes.
+	*/
+	void Write( const void* pData, const size_t uiSize )
+	{
+		//Most writes are small, and fit in the current block without filling it.
+		if( uiSize < m_uiBufferSize - m_uiBufferUsed )
+		{
+			memcpy( m_Buffer.get() + m_uiBufferUsed, pData, uiSize );
+			m_uiBufferUsed += uiSize;
+		}
+		else
+		{
+			WriteSlow( reinterpret_cast<const uint8_t*>( pData ), uiSize );
+		}
+	}
+
+	/**
+	*	Writes a value as it is in memory.
+	*/
+	template<typename T>
+	void WriteValue( const T& value )
+	{
+		static_assert( std::is_trivially_copyable<T>::value, "CSaveWriter::WriteValue: only trivially copyable types can be written as is" );
+
+		Write( &value, sizeof( value ) );
+	}
+
+	/**
+	*	Writes an array of values as they are in memory, in one copy. The count isn't written.
+	*/
+	template<typename T>
+	void WriteArray( const T* pValues, const size_t uiCount )
+	{
+		static_assert( std::is_trivially_copyable<T>::value, "CSaveWriter::WriteArray: only trivially copyable types can be written as is" );
+
+		Write( pValues, uiCount * sizeof( T ) );
+	}
+
+	/**
+	*	@return Number of bytes written so far, before compression.
+	*/
+	uint64_t GetSize() const { return m_uiBytesWritten + m_uiBufferUsed; }
+
+	/**
+	*	@return Number of bytes written to the file so far.
+	*/
+	uint64_t GetStoredSize() const { return m_uiBytesStored; }
+
+private:
+	void WriteSlow( const uint8_t* pData, size_t uiSize );
+
+	/**
+	*	Compresses a block if that makes it smaller, and writes it to the file.
+	*/
+	void WriteBlock( const uint8_t* pData, const size_t uiSize );
+
+	void WriteFile( const void* pData, const size_t uiSize );
+
+private:
+	IFileSystem2* m_pFileSystem = nullptr;
+
+	FileHandle_t m_hFile = FILESYSTEM_INVALID_HANDLE;
+
+	bool m_bCompress = false;
+
+	bool m_bFailed = false;
+
+	/**
+	*	Block being collected. Allocated when a save is opened.
+	*/
+	std::unique_ptr<uint8_t[]> m_Buffer;
+	size_t m_uiBufferUsed = 0;
+
+	/**
+	*	Size of the block buffer, or 0 if no save is open or a write failed, so every write takes the slow path.
+	*/
+	size_t m_uiBufferSize = 0;
+
+	std::unique_ptr<uint8_t[]> m_Compressed;
+
+	uint64_t m_uiBytesWritten = 0;
+	uint64_t m_uiBytesStored = 0;
+
+private:
+	CSaveWriter( const CSaveWriter& ) = delete;
+	CSaveWriter& operator=( const CSaveWriter& ) = delete;
+};
+
+#endif //COMMON_CSAVEWRITER_H
@@ -0,0 +1,164 @@
+#include <cinttypes>
+#include <cstdio>
+
+#include "FileSystem2.h"
+#include "Logging.h"
+
+#include "CStartupProfiler.h"
+
+void CStartupProfiler::Start()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_StartTime = std::chrono::steady_clock::now();
+
+	m_Phases.clear();
+	m_Threads.clear();
+	m_OpenPhases.clear();
+
+	//The main thread comes first.
+	GetThreadIndex();
+
+	m_iTotalUS = 0;
+	m_bFinished = false;
+}
+
+void CStartupProfiler::BeginPhase( const char* pszName )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_bFinished )
+		return;
+
+	auto& openPhases = m_OpenPhases[ GetThreadIndex() ];
+
+	Phase_t phase;
+
+	phase.szName = pszName;
+	phase.uiDepth = openPhases.size();
+	phase.uiThread = GetThreadIndex();
+	phase.iStartUS = GetElapsedUS();
+	phase.iEndUS = phase.iStartUS;
+
+	openPhases.push_back( m_Phases.size() );
+	m_Phases.emplace_back( std::move( phase ) );
+}
+
+void CStartupProfiler::EndPhase()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto& openPhases = m_OpenPhases[ GetThreadIndex() ];
+
+	if( openPhases.empty() )
+		return;
+
+	m_Phases[ openPhases.back() ].iEndUS = GetElapsedUS();
+
+	openPhases.pop_back();
+}
+
+void CStartupProfiler::Finish()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_bFinished )
+		return;
+
+	m_iTotalUS = GetElapsedUS();
+
+	//Phases that were cut short by a failure end here.
+	for( auto& openPhases : m_OpenPhases )
+	{
+		for( auto uiPhase : openPhases )
+		{
+			m_Phases[ uiPhase ].iEndUS = m_iTotalUS;
+		}
+
+		openPhases.clear();
+	}
+
+	m_bFinished = true;
+}
+
+void CStartupProfiler::PrintReport() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	Msg( "Startup took %.1f ms:\n", m_iTotalUS / 1000.0 );
+
+	for( const auto& phase : m_Phases )
+	{
+		const int64_t iDurationUS = phase.iEndUS - phase.iStartUS;
+
+		char szThread[ 32 ] = "";
+
+		if( phase.uiThread != 0 )
+			snprintf( szThread, sizeof( szThread ), " (thread %u)", static_cast<unsigned int>( phase.uiThread ) );
+
+		Msg( "%*s%-*s %9.1f ms %5.1f%%%s\n",
+			 static_cast<int>( phase.uiDepth * 2 ), "",
+			 static_cast<int>( 32 - phase.uiDepth * 2 ), phase.szName.c_str(),
+			 iDurationUS / 1000.0, m_iTotalUS > 0 ? iDurationUS * 100.0 / m_iTotalUS : 0.0, szThread );
+	}
+}
+
+bool CStartupProfiler::WriteTrace( IFileSystem& fileSystem, const char* pszFileName ) const
+{
+	FileHandle_t hFile = fileSystem.Open( pszFileName, "wb" );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Msg( "Couldn't open startup trace file \"%s\"\n", pszFileName );
+		return false;
+	}
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	std::string szTrace = "{\"traceEvents\":[\n";
+
+	char szEvent[ 256 ];
+
+	for( size_t uiIndex = 0; uiIndex < m_Phases.size(); ++uiIndex )
+	{
+		const auto& phase = m_Phases[ uiIndex ];
+
+		//Complete events. Phase names are identifiers, so they don't need escaping.
+		snprintf( szEvent, sizeof( szEvent ), "%s{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":%" PRId64 ",\"dur\":%" PRId64 ",\"pid\":1,\"tid\":%u}",
+				  uiIndex > 0 ? ",\n" : "", phase.szName.c_str(), phase.iStartUS, phase.iEndUS - phase.iStartUS, static_cast<unsigned int>( phase.uiThread + 1 ) );
+
+		szTrace += szEvent;
+	}
+
+	szTrace += "\n]}\n";
+
+	const bool bSuccess = fileSystem.Write( szTrace.data(), static_cast<int>( szTrace.size() ), hFile ) == static_cast<int>( szTrace.size() );
+
+	fileSystem.Close( hFile );
+
+	if( !bSuccess )
+		Msg( "Couldn't write startup trace file \"%s\"\n", pszFileName );
+
+	return bSuccess;
+}
+
+size_t CStartupProfiler::GetThreadIndex()
+{
+	const auto id = std::this_thread::get_id();
+
+	for( size_t uiIndex = 0; uiIndex < m_Threads.size(); ++uiIndex )
+	{
+		if( m_Threads[ uiIndex ] == id )
+			return uiIndex;
+	}
+
+	m_Threads.push_back( id );
+	m_OpenPhases.emplace_back();
+
+	return m_Threads.size() - 1;
+}
+
+int64_t CStartupProfiler::GetElapsedUS() const
+{
+	return std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - m_StartTime ).count();
+}
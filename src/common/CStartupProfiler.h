@@ -0,0 +1,108 @@
+#ifndef COMMON_CSTARTUPPROFILER_H
+#define COMMON_CSTARTUPPROFILER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+class IFileSystem;
+
+/**
+*	Records how long each phase of startup takes. Phases can be nested, and are tracked separately for each thread,
+*	so subsystems that start up concurrently can time themselves.
+*	Prints a report once startup is done, and can write the phases as a Chrome trace (chrome://tracing, Perfetto) for tracking regressions.
+*	Start, Finish and the report must be used on the main thread, phases can be recorded on any thread.
+*/
+class CStartupProfiler final
+{
+public:
+	struct Phase_t
+	{
+		std::string szName;
+
+		/**
+		*	Number of phases this one is nested in.
+		*/
+		size_t uiDepth;
+
+		/**
+		*	Thread the phase ran on, in the order threads first recorded a phase. The main thread is 0.
+		*/
+		size_t uiThread;
+
+		/**
+		*	Times relative to the start of startup, in microseconds.
+		*/
+		int64_t iStartUS;
+		int64_t iEndUS;
+	};
+
+public:
+	CStartupProfiler() = default;
+
+	/**
+	*	Starts timing startup. Phases are timed relative to this.
+	*/
+	void Start();
+
+	void BeginPhase( const char* pszName );
+
+	/**
+	*	Ends the innermost phase.
+	*/
+	void EndPhase();
+
+	/**
+	*	Ends any phases that are still open, and marks startup as done. Phases started after this aren't recorded.
+	*/
+	void Finish();
+
+	bool IsFinished() const { return m_bFinished; }
+
+	/**
+	*	Prints each phase's time, indented by nesting.
+	*/
+	void PrintReport() const;
+
+	/**
+	*	Writes the phases as a Chrome trace event file.
+	*	@return Whether the file was written.
+	*/
+	bool WriteTrace( IFileSystem& fileSystem, const char* pszFileName ) const;
+
+private:
+	int64_t GetElapsedUS() const;
+
+	/**
+	*	@return Index of the calling thread. Must be called with the mutex held.
+	*/
+	size_t GetThreadIndex();
+
+private:
+	mutable std::mutex m_Mutex;
+
+	std::chrono::steady_clock::time_point m_StartTime = std::chrono::steady_clock::now();
+
+	std::vector<Phase_t> m_Phases;
+
+	std::vector<std::thread::id> m_Threads;
+
+	/**
+	*	Indices of the phases that are open on each thread, innermost last.
+	*/
+	std::vector<std::vector<size_t>> m_OpenPhases;
+
+	int64_t m_iTotalUS = 0;
+
+	bool m_bFinished = false;
+
+private:
+	CStartupProfiler( const CStartupProfiler& ) = delete;
+	CStartupProfiler& operator=( const CStartupProfiler& ) = delete;
+};
+
+#endif //COMMON_CSTARTUPPROFILER_H
@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include "StringUtils.h"
+
+#include "CStringPool.h"
+
+const size_t CStringPool::BLOCK_SIZE;
+
+const char* CStringPool::Intern( const char* const pszString )
+{
+	if( !pszString )
+		return nullptr;
+
+	return Intern( pszString, strlen( pszString ) );
+}
+
+const char* CStringPool::Intern( const char* const pszString, const size_t uiLength )
+{
+	assert( pszString );
+
+	const size_t uiHash = StringHash( pszString, uiLength );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( !m_Table.empty() )
+	{
+		const Entry_t& entry = m_Table[ FindSlot( pszString, uiLength, uiHash ) ];
+
+		if( entry.pszString )
+			return entry.pszString;
+	}
+
+	//Keep the table at most half full.
+	if( ( m_uiCount + 1 ) * 2 > m_Table.size() )
+	{
+		std::vector<Entry_t> oldTable( std::max<size_t>( 64, m_Table.size() * 2 ), Entry_t{} );
+
+		oldTable.swap( m_Table );
+
+		const size_t uiMask = m_Table.size() - 1;
+
+		for( const auto& entry : oldTable )
+		{
+			if( !entry.pszString )
+				continue;
+
+			size_t uiSlot = entry.uiHash & uiMask;
+
+			while( m_Table[ uiSlot ].pszString )
+				uiSlot = ( uiSlot + 1 ) & uiMask;
+
+			m_Table[ uiSlot ] = entry;
+		}
+	}
+
+	Entry_t& entry = m_Table[ FindSlot( pszString, uiLength, uiHash ) ];
+
+	entry.pszString = Store( pszString, uiLength );
+	entry.uiHash = static_cast<uint32_t>( uiHash );
+	entry.uiLength = static_cast<uint32_t>( uiLength );
+
+	++m_uiCount;
+
+	return entry.pszString;
+}
+
+const char* CStringPool::Find( const char* const pszString ) const
+{
+	if( !pszString )
+		return nullptr;
+
+	const size_t uiLength = strlen( pszString );
+	const size_t uiHash = StringHash( pszString, uiLength );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_Table.empty() )
+		return nullptr;
+
+	return m_Table[ FindSlot( pszString, uiLength, uiHash ) ].pszString;
+}
+
+size_t CStringPool::GetCount() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_uiCount;
+}
+
+size_t CStringPool::GetMemoryUsage() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_uiMemoryUsage;
+}
+
+size_t CStringPool::FindSlot( const char* const pszString, const size_t uiLength, const size_t uiHash ) const
+{
+	const size_t uiMask = m_Table.size() - 1;
+
+	size_t uiSlot = uiHash & uiMask;
+
+	for( ; m_Table[ uiSlot ].pszString; uiSlot = ( uiSlot + 1 ) & uiMask )
+	{
+		const Entry_t& entry = m_Table[ uiSlot ];
+
+		if( entry.uiHash == static_cast<uint32_t>( uiHash ) && entry.uiLength == uiLength && memcmp( entry.pszString, pszString, uiLength ) == 0 )
+			break;
+	}
+
+	return uiSlot;
+}
+
+const char* CStringPool::Store( const char* const pszString, const size_t uiLength )
+{
+	const size_t uiSize = uiLength + 1;
+
+	char* pszStored;
+
+	if( uiSize > BLOCK_SIZE / 4 )
+	{
+		//Long strings get their own block, so they don't waste the rest of the current one.
+		m_Blocks.emplace_back( new char[ uiSize ] );
+		m_uiMemoryUsage += uiSize;
+
+		pszStored = m_Blocks.back().get();
+	}
+	else
+	{
+		if( uiSize > m_uiBlockRemaining )
+		{
+			m_Blocks.emplace_back( new char[ BLOCK_SIZE ] );
+			m_uiMemoryUsage += BLOCK_SIZE;
+
+			m_pBlockData = m_Blocks.back().get();
+			m_uiBlockRemaining = BLOCK_SIZE;
+		}
+
+		pszStored = m_pBlockData;
+
+		m_pBlockData += uiSize;
+		m_uiBlockRemaining -= uiSize;
+	}
+
+	memcpy( pszStored, pszString, uiLength );
+	pszStored[ uiLength ] = '\0';
+
+	return pszStored;
+}
+
+CStringPool& GetStringPool()
+{
+	//Never destroyed, so interned strings remain valid while other static objects are destroyed.
+	static CStringPool* const pPool = new CStringPool();
+
+	return *pPool;
+}
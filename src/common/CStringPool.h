@@ -0,0 +1,104 @@
+#ifndef COMMON_CSTRINGPOOL_H
+#define COMMON_CSTRINGPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+*	Interns strings, so that each distinct string is stored once.
+*	Interned strings are stored in large blocks and are never freed, so the pointers returned by Intern remain valid for the lifetime of the pool.
+*	Two interned strings are equal if and only if their pointers are equal.
+*	Thread safe.
+*/
+class CStringPool final
+{
+public:
+	/**
+	*	Size of the blocks that strings are allocated from. Strings longer than a quarter of a block get a block of their own.
+	*/
+	static const size_t BLOCK_SIZE = 16384;
+
+public:
+	CStringPool() = default;
+
+	/**
+	*	Interns a string.
+	*	@param pszString String to intern. May be null.
+	*	@return The interned string, or null if pszString is null.
+	*/
+	const char* Intern( const char* const pszString );
+
+	/**
+	*	Interns a string.
+	*	@param pszString String to intern. Doesn't have to be null terminated.
+	*	@param uiLength Length of the string.
+	*	@return The interned string, which is null terminated.
+	*/
+	const char* Intern( const char* const pszString, const size_t uiLength );
+
+	/**
+	*	Finds an interned string without interning it.
+	*	@return The interned string, or null if pszString is null or was never interned.
+	*/
+	const char* Find( const char* const pszString ) const;
+
+	/**
+	*	@return Number of interned strings.
+	*/
+	size_t GetCount() const;
+
+	/**
+	*	@return Number of bytes allocated for string storage.
+	*/
+	size_t GetMemoryUsage() const;
+
+private:
+	struct Entry_t
+	{
+		const char* pszString;
+		uint32_t uiHash;
+		uint32_t uiLength;
+	};
+
+	/**
+	*	@return The slot that contains the string, or the empty slot where it belongs.
+	*/
+	size_t FindSlot( const char* const pszString, const size_t uiLength, const size_t uiHash ) const;
+
+	/**
+	*	Copies a string into block storage.
+	*/
+	const char* Store( const char* const pszString, const size_t uiLength );
+
+private:
+	mutable std::mutex m_Mutex;
+
+	/**
+	*	Open addressing table of all interned strings. Size is a power of 2.
+	*/
+	std::vector<Entry_t> m_Table;
+
+	size_t m_uiCount = 0;
+
+	std::vector<std::unique_ptr<char[]>> m_Blocks;
+
+	char* m_pBlockData = nullptr;
+
+	size_t m_uiBlockRemaining = 0;
+
+	size_t m_uiMemoryUsage = 0;
+
+private:
+	CStringPool( const CStringPool& ) = delete;
+	CStringPool& operator=( const CStringPool& ) = delete;
+};
+
+/**
+*	@return The string pool shared by this module. Created on first use, so it can be used during static initialization.
+*/
+CStringPool& GetStringPool();
+
+#endif //COMMON_CSTRINGPOOL_H
@@ -0,0 +1,116 @@
+#include <cassert>
+
+#include "Logging.h"
+
+#include "CTaskGraph.h"
+
+CTaskGraph::Task_t CTaskGraph::AddTask( const char* pszName, TaskFn_t function, std::initializer_list<Task_t> dependencies, const bool bMainThread )
+{
+	assert( pszName );
+	assert( function );
+
+	const Task_t task = m_Tasks.size();
+
+	TaskData_t data;
+
+	data.szName = pszName;
+	data.function = std::move( function );
+	data.bMainThread = bMainThread;
+
+	for( auto dependency : dependencies )
+	{
+		assert( dependency < task );
+
+		m_Tasks[ dependency ].dependents.push_back( task );
+		++data.uiPending;
+	}
+
+	m_Tasks.emplace_back( std::move( data ) );
+
+	return task;
+}
+
+bool CTaskGraph::Run( CJobSystem* pJobs )
+{
+	m_bFailed = false;
+
+	if( !pJobs )
+	{
+		//Dependencies are always added first, so this order works.
+		for( const auto& task : m_Tasks )
+		{
+			if( !task.function() )
+			{
+				Msg( "Task \"%s\" failed\n", task.szName.c_str() );
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	assert( pJobs->IsMainThread() );
+
+	m_pJobs = pJobs;
+
+	for( Task_t task = 0; task < m_Tasks.size(); ++task )
+	{
+		if( m_Tasks[ task ].uiPending == 0 )
+			SubmitTask( task );
+	}
+
+	pJobs->Wait( m_Counter );
+
+	m_pJobs = nullptr;
+
+	return !m_bFailed;
+}
+
+void CTaskGraph::SubmitTask( const Task_t task )
+{
+	m_pJobs->Submit( [ this, task ]()
+	{
+		RunTask( task );
+	}, &m_Counter, m_Tasks[ task ].bMainThread ? CJobSystem::Affinity::MAIN_THREAD : CJobSystem::Affinity::ANY );
+}
+
+void CTaskGraph::RunTask( const Task_t task )
+{
+	auto& data = m_Tasks[ task ];
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( m_bFailed )
+			return;
+	}
+
+	const bool bSuccess = data.function();
+
+	std::vector<Task_t> ready;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( !bSuccess )
+		{
+			if( !m_bFailed )
+				Msg( "Task \"%s\" failed\n", data.szName.c_str() );
+
+			m_bFailed = true;
+			return;
+		}
+
+		for( auto dependent : data.dependents )
+		{
+			if( --m_Tasks[ dependent ].uiPending == 0 )
+				ready.push_back( dependent );
+		}
+	}
+
+	//Submitted before this task's job finishes, so the graph's counter can't reach 0 in between.
+	for( auto dependent : ready )
+	{
+		SubmitTask( dependent );
+	}
+}
@@ -0,0 +1,99 @@
+#ifndef COMMON_CTASKGRAPH_H
+#define COMMON_CTASKGRAPH_H
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "CJobSystem.h"
+
+/**
+*	Runs a set of tasks that depend on each other as jobs, so tasks whose dependencies are done run at the same time on the job system's workers.
+*	Tasks that have to run on the main thread (window creation, GL, anything not thread-safe) are main thread jobs,
+*	and are run by the thread that calls Run while it waits for the graph.
+*	Once a task fails, no new tasks are started, and Run returns false once the tasks that are running have finished.
+*	Tasks can only depend on tasks that were added before them, so there can't be any cycles.
+*/
+class CTaskGraph final
+{
+public:
+	using Task_t = size_t;
+
+	/**
+	*	@return Whether the task succeeded.
+	*/
+	using TaskFn_t = std::function<bool()>;
+
+public:
+	CTaskGraph() = default;
+
+	/**
+	*	Adds a task.
+	*	@param pszName Name of the task, used when reporting failures.
+	*	@param function Function to run.
+	*	@param dependencies Tasks that have to succeed before this one runs.
+	*	@param bMainThread Whether the task has to run on the job system's main thread.
+	*	@return Handle to the task, to depend on it.
+	*/
+	Task_t AddTask( const char* pszName, TaskFn_t function, std::initializer_list<Task_t> dependencies = {}, const bool bMainThread = false );
+
+	/**
+	*	Runs all tasks. Can only be called once, on the job system's main thread.
+	*	@param pJobs Job system to run the tasks on. If null, all tasks run on the calling thread in the order they were added in.
+	*	@return Whether all tasks succeeded.
+	*/
+	bool Run( CJobSystem* pJobs );
+
+private:
+	struct TaskData_t
+	{
+		std::string szName;
+
+		TaskFn_t function;
+
+		/**
+		*	Tasks that depend on this one.
+		*/
+		std::vector<Task_t> dependents;
+
+		/**
+		*	Number of dependencies that haven't finished yet. Guarded by m_Mutex while running.
+		*/
+		size_t uiPending = 0;
+
+		bool bMainThread = false;
+	};
+
+	/**
+	*	Submits a task whose dependencies are done.
+	*/
+	void SubmitTask( const Task_t task );
+
+	/**
+	*	Runs a task, and submits dependents that are ready.
+	*/
+	void RunTask( const Task_t task );
+
+private:
+	std::vector<TaskData_t> m_Tasks;
+
+	CJobSystem* m_pJobs = nullptr;
+
+	CJobSystem::CCounter m_Counter;
+
+	std::mutex m_Mutex;
+
+	/**
+	*	Guarded by m_Mutex.
+	*/
+	bool m_bFailed = false;
+
+private:
+	CTaskGraph( const CTaskGraph& ) = delete;
+	CTaskGraph& operator=( const CTaskGraph& ) = delete;
+};
+
+#endif //COMMON_CTASKGRAPH_H
@@ -0,0 +1,337 @@
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "CTimerWheel.h"
+
+const CTimerWheel::Handle CTimerWheel::INVALID_HANDLE;
+const size_t CTimerWheel::LEVELS;
+const unsigned int CTimerWheel::SLOT_BITS;
+const size_t CTimerWheel::SLOTS;
+const uint64_t CTimerWheel::MAX_TICKS;
+const uint32_t CTimerWheel::INVALID_INDEX;
+const uint32_t CTimerWheel::FIRING_LIST;
+const uint32_t CTimerWheel::NUM_LISTS;
+const uint64_t CTimerWheel::SLOT_MASK;
+
+namespace
+{
+inline unsigned int FindLowestBit( const uint64_t uiMask )
+{
+#ifdef _MSC_VER
+	unsigned long uiIndex;
+
+	//Not _BitScanForward64, which 32 bit builds don't have.
+	if( _BitScanForward( &uiIndex, static_cast<unsigned long>( uiMask ) ) )
+		return static_cast<unsigned int>( uiIndex );
+
+	_BitScanForward( &uiIndex, static_cast<unsigned long>( uiMask >> 32 ) );
+
+	return static_cast<unsigned int>( uiIndex ) + 32;
+#else
+	return static_cast<unsigned int>( __builtin_ctzll( uiMask ) );
+#endif
+}
+}
+
+CTimerWheel::CTimerWheel( const uint64_t uiTime, const uint64_t uiResolution )
+	: m_uiResolution( std::max<uint64_t>( uiResolution, 1 ) )
+	, m_uiTime( uiTime )
+	, m_uiTick( uiTime / m_uiResolution + 1 )
+{
+	std::fill( std::begin( m_Heads ), std::end( m_Heads ), INVALID_INDEX );
+}
+
+CTimerWheel::~CTimerWheel()
+{
+}
+
+CTimerWheel::Handle CTimerWheel::Schedule( const uint64_t uiDelay, Callback_t callback, const uint64_t uiInterval )
+{
+	uint32_t uiIndex;
+
+	if( m_uiFreeTimer != INVALID_INDEX )
+	{
+		uiIndex = m_uiFreeTimer;
+		m_uiFreeTimer = m_Timers[ uiIndex ].uiNext;
+	}
+	else
+	{
+		uiIndex = static_cast<uint32_t>( m_Timers.size() );
+
+		m_Timers.emplace_back();
+		m_Timers.back().uiGeneration = 0;
+	}
+
+	auto& timer = m_Timers[ uiIndex ];
+
+	timer.callback = std::move( callback );
+
+	//Round up, so the timer never runs early.
+	timer.uiExpiry = ( m_uiTime + uiDelay + m_uiResolution - 1 ) / m_uiResolution;
+	timer.uiInterval = uiInterval > 0 ? std::max<uint64_t>( 1, ( uiInterval + m_uiResolution - 1 ) / m_uiResolution ) : 0;
+
+	timer.uiList = INVALID_INDEX;
+
+	Insert( uiIndex );
+
+	++m_uiCount;
+
+	return MakeHandle( uiIndex, timer.uiGeneration );
+}
+
+bool CTimerWheel::Cancel( const Handle handle )
+{
+	const uint32_t uiIndex = GetIndex( handle );
+
+	if( uiIndex == INVALID_INDEX )
+		return false;
+
+	Unlink( uiIndex );
+	Free( uiIndex );
+
+	return true;
+}
+
+bool CTimerWheel::IsScheduled( const Handle handle ) const
+{
+	return GetIndex( handle ) != INVALID_INDEX;
+}
+
+void CTimerWheel::Clear()
+{
+	for( uint32_t uiIndex = 0; uiIndex < m_Timers.size(); ++uiIndex )
+	{
+		if( m_Timers[ uiIndex ].uiList != INVALID_INDEX )
+		{
+			Unlink( uiIndex );
+			Free( uiIndex );
+		}
+	}
+}
+
+size_t CTimerWheel::Advance( const uint64_t uiTime )
+{
+	if( uiTime <= m_uiTime )
+		return 0;
+
+	m_uiTime = uiTime;
+
+	//Ticks up to and including this one have ended.
+	const uint64_t uiLastTick = uiTime / m_uiResolution;
+
+	size_t uiRan = 0;
+
+	while( m_uiTick <= uiLastTick )
+	{
+		if( m_uiCount == 0 )
+		{
+			m_uiTick = uiLastTick + 1;
+			break;
+		}
+
+		const unsigned int uiSlot = static_cast<unsigned int>( m_uiTick & SLOT_MASK );
+
+		if( uiSlot == 0 )
+			Cascade();
+
+		if( m_Occupied[ 0 ] & ( static_cast<uint64_t>( 1 ) << uiSlot ) )
+		{
+			//Move the whole slot over, so timers scheduled by callbacks for this tick wait for the next one.
+			m_Heads[ FIRING_LIST ] = m_Heads[ uiSlot ];
+			m_Heads[ uiSlot ] = INVALID_INDEX;
+			m_Occupied[ 0 ] &= ~( static_cast<uint64_t>( 1 ) << uiSlot );
+
+			for( uint32_t uiIndex = m_Heads[ FIRING_LIST ]; uiIndex != INVALID_INDEX; uiIndex = m_Timers[ uiIndex ].uiNext )
+			{
+				m_Timers[ uiIndex ].uiList = FIRING_LIST;
+			}
+
+			++m_uiTick;
+
+			uiRan += RunFiring( uiLastTick );
+		}
+		else
+		{
+			++m_uiTick;
+		}
+
+		//Skip to the next occupied slot, or to where the finest level wraps around and the next cascade is due.
+		const unsigned int uiNextSlot = static_cast<unsigned int>( m_uiTick & SLOT_MASK );
+
+		if( uiNextSlot != 0 )
+		{
+			const uint64_t uiAhead = m_Occupied[ 0 ] & ( ~static_cast<uint64_t>( 0 ) << uiNextSlot );
+
+			const uint64_t uiNextTick = uiAhead ? ( m_uiTick & ~SLOT_MASK ) + FindLowestBit( uiAhead ) : ( m_uiTick | SLOT_MASK ) + 1;
+
+			m_uiTick = std::min( uiNextTick, uiLastTick + 1 );
+		}
+	}
+
+	return uiRan;
+}
+
+uint32_t CTimerWheel::GetIndex( const Handle handle ) const
+{
+	const uint32_t uiLow = static_cast<uint32_t>( handle );
+
+	if( uiLow == 0 || uiLow > m_Timers.size() )
+		return INVALID_INDEX;
+
+	const uint32_t uiIndex = uiLow - 1;
+
+	const auto& timer = m_Timers[ uiIndex ];
+
+	if( timer.uiList == INVALID_INDEX || timer.uiGeneration != static_cast<uint32_t>( handle >> 32 ) )
+		return INVALID_INDEX;
+
+	return uiIndex;
+}
+
+void CTimerWheel::Insert( const uint32_t uiIndex )
+{
+	auto& timer = m_Timers[ uiIndex ];
+
+	if( timer.uiExpiry < m_uiTick )
+		timer.uiExpiry = m_uiTick;
+
+	//Timers beyond the wheel's reach wait in the coarsest level, and are moved again when their slot comes up.
+	const uint64_t uiExpiry = std::min( timer.uiExpiry, m_uiTick + MAX_TICKS );
+	const uint64_t uiDelta = uiExpiry - m_uiTick;
+
+	size_t uiLevel = 0;
+
+	while( uiLevel + 1 < LEVELS && uiDelta >= ( static_cast<uint64_t>( 1 ) << ( SLOT_BITS * ( uiLevel + 1 ) ) ) )
+	{
+		++uiLevel;
+	}
+
+	const uint32_t uiSlot = static_cast<uint32_t>( ( uiExpiry >> ( SLOT_BITS * uiLevel ) ) & SLOT_MASK );
+
+	Link( uiIndex, static_cast<uint32_t>( uiLevel * SLOTS + uiSlot ) );
+}
+
+void CTimerWheel::Link( const uint32_t uiIndex, const uint32_t uiList )
+{
+	auto& timer = m_Timers[ uiIndex ];
+
+	timer.uiList = uiList;
+	timer.uiPrevious = INVALID_INDEX;
+	timer.uiNext = m_Heads[ uiList ];
+
+	if( timer.uiNext != INVALID_INDEX )
+		m_Timers[ timer.uiNext ].uiPrevious = uiIndex;
+
+	m_Heads[ uiList ] = uiIndex;
+
+	if( uiList != FIRING_LIST )
+		m_Occupied[ uiList / SLOTS ] |= static_cast<uint64_t>( 1 ) << ( uiList % SLOTS );
+}
+
+void CTimerWheel::Unlink( const uint32_t uiIndex )
+{
+	auto& timer = m_Timers[ uiIndex ];
+
+	assert( timer.uiList != INVALID_INDEX );
+
+	if( timer.uiPrevious != INVALID_INDEX )
+		m_Timers[ timer.uiPrevious ].uiNext = timer.uiNext;
+	else
+		m_Heads[ timer.uiList ] = timer.uiNext;
+
+	if( timer.uiNext != INVALID_INDEX )
+		m_Timers[ timer.uiNext ].uiPrevious = timer.uiPrevious;
+
+	if( timer.uiList != FIRING_LIST && m_Heads[ timer.uiList ] == INVALID_INDEX )
+		m_Occupied[ timer.uiList / SLOTS ] &= ~( static_cast<uint64_t>( 1 ) << ( timer.uiList % SLOTS ) );
+
+	timer.uiList = INVALID_INDEX;
+}
+
+void CTimerWheel::Free( const uint32_t uiIndex )
+{
+	auto& timer = m_Timers[ uiIndex ];
+
+	timer.callback = nullptr;
+
+	++timer.uiGeneration;
+
+	timer.uiNext = m_uiFreeTimer;
+	m_uiFreeTimer = uiIndex;
+
+	--m_uiCount;
+}
+
+void CTimerWheel::Cascade()
+{
+	for( size_t uiLevel = 1; uiLevel < LEVELS; ++uiLevel )
+	{
+		const uint32_t uiSlot = static_cast<uint32_t>( ( m_uiTick >> ( SLOT_BITS * uiLevel ) ) & SLOT_MASK );
+		const uint32_t uiList = static_cast<uint32_t>( uiLevel * SLOTS + uiSlot );
+
+		//Timers always move to a finer level, or to another slot if they're still out of reach, so this ends.
+		while( m_Heads[ uiList ] != INVALID_INDEX )
+		{
+			const uint32_t uiIndex = m_Heads[ uiList ];
+
+			Unlink( uiIndex );
+			Insert( uiIndex );
+		}
+
+		//The next level only needs to move down once this one has wrapped around as well.
+		if( uiSlot != 0 )
+			break;
+	}
+}
+
+size_t CTimerWheel::RunFiring( const uint64_t uiLastTick )
+{
+	size_t uiRan = 0;
+
+	while( m_Heads[ FIRING_LIST ] != INVALID_INDEX )
+	{
+		const uint32_t uiIndex = m_Heads[ FIRING_LIST ];
+
+		Unlink( uiIndex );
+
+		auto& timer = m_Timers[ uiIndex ];
+
+		//Moved out so the callback can schedule timers, which can move the timers around, and cancel its own timer.
+		auto callback = std::move( timer.callback );
+
+		if( timer.uiInterval > 0 )
+		{
+			const uint32_t uiGeneration = timer.uiGeneration;
+
+			timer.uiExpiry += timer.uiInterval;
+
+			//Skip the periods this call has already passed.
+			if( timer.uiExpiry <= uiLastTick )
+				timer.uiExpiry += ( ( uiLastTick - timer.uiExpiry ) / timer.uiInterval + 1 ) * timer.uiInterval;
+
+			Insert( uiIndex );
+
+			callback();
+
+			auto& repeating = m_Timers[ uiIndex ];
+
+			if( repeating.uiList != INVALID_INDEX && repeating.uiGeneration == uiGeneration )
+				repeating.callback = std::move( callback );
+		}
+		else
+		{
+			Free( uiIndex );
+
+			callback();
+		}
+
+		++uiRan;
+	}
+
+	return uiRan;
+}
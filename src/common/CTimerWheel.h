@@ -0,0 +1,192 @@
+#ifndef COMMON_CTIMERWHEEL_H
+#define COMMON_CTIMERWHEEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+*	Schedules callbacks to run after a delay, for retransmit timers, timeouts and periodic work. Ticked from the host loop with the current time.
+*	Timers are kept in a hierarchical wheel: LEVELS wheels of SLOTS slots each, every level SLOTS times coarser than the one below.
+*	A timer goes in the slot of its expiry time on the finest level that reaches that far, and moves down a level each time the level below wraps around.
+*	Scheduling and cancelling are constant time, and advancing skips empty slots, so a long frame doesn't cost one step per tick.
+*	Times are in any unit, as long as the same unit is used throughout, such as microseconds from Plat_GetMicroseconds.
+*	Not thread safe.
+*/
+class CTimerWheel final
+{
+public:
+	using Callback_t = std::function<void()>;
+
+	/**
+	*	Identifies a scheduled timer. Handles of timers that fired or were cancelled are never reused.
+	*/
+	using Handle = uint64_t;
+
+	static const Handle INVALID_HANDLE = 0;
+
+	static const size_t LEVELS = 4;
+
+	static const unsigned int SLOT_BITS = 6;
+
+	/**
+	*	Number of slots in each level. 64, so each level's occupied slots fit in one mask.
+	*/
+	static const size_t SLOTS = 1 << SLOT_BITS;
+
+	/**
+	*	Longest delay that's scheduled directly, in ticks. Timers that expire later are moved back up a level until they're in reach.
+	*/
+	static const uint64_t MAX_TICKS = ( static_cast<uint64_t>( 1 ) << ( SLOT_BITS * LEVELS ) ) - 1;
+
+public:
+	/**
+	*	@param uiTime Current time.
+	*	@param uiResolution Length of a tick. Timers fire on the first Advance call at or after the end of the tick they expire in.
+	*/
+	CTimerWheel( const uint64_t uiTime, const uint64_t uiResolution );
+	~CTimerWheel();
+
+	uint64_t GetResolution() const { return m_uiResolution; }
+
+	/**
+	*	@return Time passed to the last Advance call, or to the constructor.
+	*/
+	uint64_t GetTime() const { return m_uiTime; }
+
+	/**
+	*	@return Number of scheduled timers.
+	*/
+	size_t GetCount() const { return m_uiCount; }
+
+	/**
+	*	Schedules a callback. Can be called from a callback.
+	*	@param uiDelay Time from the last Advance call until the callback runs. Never runs early, and at most a tick late.
+	*	@param uiInterval If not 0, the timer repeats with this period until it's cancelled.
+	*		Periods missed during a long frame are skipped rather than run in a burst.
+	*	@return Handle of the timer.
+	*/
+	Handle Schedule( const uint64_t uiDelay, Callback_t callback, const uint64_t uiInterval = 0 );
+
+	/**
+	*	Cancels a timer. Can be called from a callback, including the timer's own.
+	*	@return Whether the timer was scheduled.
+	*/
+	bool Cancel( const Handle handle );
+
+	bool IsScheduled( const Handle handle ) const;
+
+	/**
+	*	Cancels all timers.
+	*/
+	void Clear();
+
+	/**
+	*	Runs the callbacks of timers that expired. Time never goes backwards: earlier times are ignored.
+	*	@return Number of callbacks that ran.
+	*/
+	size_t Advance( const uint64_t uiTime );
+
+private:
+	static const uint32_t INVALID_INDEX = UINT32_MAX;
+
+	/**
+	*	List of timers that are about to run. The lists before it are the slots, level by level.
+	*/
+	static const uint32_t FIRING_LIST = LEVELS * SLOTS;
+
+	static const uint32_t NUM_LISTS = FIRING_LIST + 1;
+
+	static const uint64_t SLOT_MASK = SLOTS - 1;
+
+	struct Timer_t
+	{
+		Callback_t callback;
+
+		/**
+		*	Tick the timer expires in.
+		*/
+		uint64_t uiExpiry;
+
+		/**
+		*	Period in ticks, or 0 if the timer doesn't repeat.
+		*/
+		uint64_t uiInterval;
+
+		uint32_t uiPrevious;
+		uint32_t uiNext;
+
+		/**
+		*	List the timer is in, or INVALID_INDEX if it's not scheduled.
+		*/
+		uint32_t uiList;
+
+		/**
+		*	Incremented when the timer is freed, so handles to it are detected.
+		*/
+		uint32_t uiGeneration;
+	};
+
+private:
+	static Handle MakeHandle( const uint32_t uiIndex, const uint32_t uiGeneration )
+	{
+		return ( static_cast<Handle>( uiGeneration ) << 32 ) | ( uiIndex + 1 );
+	}
+
+	/**
+	*	@return Index of the scheduled timer the handle refers to, or INVALID_INDEX.
+	*/
+	uint32_t GetIndex( const Handle handle ) const;
+
+	/**
+	*	Puts a timer in the slot for its expiry.
+	*/
+	void Insert( const uint32_t uiIndex );
+
+	void Link( const uint32_t uiIndex, const uint32_t uiList );
+
+	void Unlink( const uint32_t uiIndex );
+
+	void Free( const uint32_t uiIndex );
+
+	/**
+	*	Moves the timers of the coarser levels' current slots down, once the finest level has wrapped around.
+	*/
+	void Cascade();
+
+	/**
+	*	Runs the timers in the firing list.
+	*	@param uiLastTick Last tick the current Advance call processes. Repeating timers are rescheduled after it.
+	*/
+	size_t RunFiring( const uint64_t uiLastTick );
+
+private:
+	const uint64_t m_uiResolution;
+
+	uint64_t m_uiTime;
+
+	/**
+	*	Next tick to process.
+	*/
+	uint64_t m_uiTick;
+
+	std::vector<Timer_t> m_Timers;
+
+	uint32_t m_uiFreeTimer = INVALID_INDEX;
+
+	size_t m_uiCount = 0;
+
+	uint32_t m_Heads[ NUM_LISTS ];
+
+	/**
+	*	Which slots of each level have timers.
+	*/
+	uint64_t m_Occupied[ LEVELS ] = {};
+
+private:
+	CTimerWheel( const CTimerWheel& ) = delete;
+	CTimerWheel& operator=( const CTimerWheel& ) = delete;
+};
+
+#endif //COMMON_CTIMERWHEEL_H
@@ -0,0 +1,510 @@
+#include <algorithm>
+#include <cassert>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "CPUFeatures.h"
+
+#include "CVisibilityCache.h"
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <immintrin.h>
+
+#define VISIBILITYCACHE_SSE2
+#define VISIBILITYCACHE_TARGET_SSE2
+#define VISIBILITYCACHE_TARGET_SSSE3
+#define VISIBILITYCACHE_TARGET_AVX2
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <immintrin.h>
+
+#define VISIBILITYCACHE_SSE2
+//Only the vector functions are compiled for the instruction sets they use, so the rest runs on any CPU.
+#define VISIBILITYCACHE_TARGET_SSE2 __attribute__( ( target( "sse2" ) ) )
+#define VISIBILITYCACHE_TARGET_SSSE3 __attribute__( ( target( "ssse3" ) ) )
+#define VISIBILITYCACHE_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#endif
+
+const size_t CVisibilityCache::WORD_BITS;
+const size_t CVisibilityCache::ROW_ALIGNMENT_WORDS;
+const size_t CVisibilityCache::DEFAULT_CAPACITY;
+const uint32_t CVisibilityCache::ALL_VISIBLE;
+const uint32_t CVisibilityCache::NO_SLOT;
+
+namespace
+{
+using Word_t = CVisibilityCache::Word_t;
+
+typedef void ( *UnionFunction_t )( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords );
+
+typedef bool ( *IntersectFunction_t )( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords );
+
+typedef size_t ( *PopCountFunction_t )( const Word_t* pBits, const size_t uiWords );
+
+inline size_t PopCountWord( const uint64_t uiWord )
+{
+#ifdef __GNUC__
+	return static_cast<size_t>( __builtin_popcountll( uiWord ) );
+#else
+	//MSVC's __popcnt64 needs the POPCNT instruction, which the scalar fallback can't assume.
+	uint64_t uiBits = uiWord - ( ( uiWord >> 1 ) & 0x5555555555555555ULL );
+	uiBits = ( uiBits & 0x3333333333333333ULL ) + ( ( uiBits >> 2 ) & 0x3333333333333333ULL );
+	uiBits = ( uiBits + ( uiBits >> 4 ) ) & 0x0F0F0F0F0F0F0F0FULL;
+
+	return static_cast<size_t>( ( uiBits * 0x0101010101010101ULL ) >> 56 );
+#endif
+}
+
+void UnionScalar( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords )
+{
+	for( size_t uiIndex = 0; uiIndex < uiWords; ++uiIndex )
+	{
+		pDest[ uiIndex ] = pA[ uiIndex ] | pB[ uiIndex ];
+	}
+}
+
+bool IntersectScalar( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords )
+{
+	Word_t any = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiWords; ++uiIndex )
+	{
+		pDest[ uiIndex ] = pA[ uiIndex ] & pB[ uiIndex ];
+		any |= pDest[ uiIndex ];
+	}
+
+	return any != 0;
+}
+
+size_t PopCountScalar( const Word_t* pBits, const size_t uiWords )
+{
+	size_t uiCount = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiWords; ++uiIndex )
+	{
+		uiCount += PopCountWord( pBits[ uiIndex ] );
+	}
+
+	return uiCount;
+}
+
+#ifdef VISIBILITYCACHE_SSE2
+VISIBILITYCACHE_TARGET_SSE2 void UnionSSE2( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords )
+{
+	for( size_t uiIndex = 0; uiIndex < uiWords; uiIndex += 2 )
+	{
+		const __m128i result = _mm_or_si128(
+			_mm_loadu_si128( reinterpret_cast<const __m128i*>( pA + uiIndex ) ),
+			_mm_loadu_si128( reinterpret_cast<const __m128i*>( pB + uiIndex ) ) );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + uiIndex ), result );
+	}
+}
+
+VISIBILITYCACHE_TARGET_SSE2 bool IntersectSSE2( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords )
+{
+	__m128i any = _mm_setzero_si128();
+
+	for( size_t uiIndex = 0; uiIndex < uiWords; uiIndex += 2 )
+	{
+		const __m128i result = _mm_and_si128(
+			_mm_loadu_si128( reinterpret_cast<const __m128i*>( pA + uiIndex ) ),
+			_mm_loadu_si128( reinterpret_cast<const __m128i*>( pB + uiIndex ) ) );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + uiIndex ), result );
+
+		any = _mm_or_si128( any, result );
+	}
+
+	return _mm_movemask_epi8( _mm_cmpeq_epi8( any, _mm_setzero_si128() ) ) != 0xFFFF;
+}
+
+/*
+*	Counts the bits of each nibble with a table lookup in a shuffle, and sums the bytes with psadbw.
+*/
+VISIBILITYCACHE_TARGET_SSSE3 size_t PopCountSSSE3( const Word_t* pBits, const size_t uiWords )
+{
+	const __m128i lookup = _mm_setr_epi8( 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+	const __m128i lowMask = _mm_set1_epi8( 0x0F );
+
+	__m128i total = _mm_setzero_si128();
+
+	for( size_t uiIndex = 0; uiIndex < uiWords; uiIndex += 2 )
+	{
+		const __m128i bits = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pBits + uiIndex ) );
+
+		const __m128i counts = _mm_add_epi8(
+			_mm_shuffle_epi8( lookup, _mm_and_si128( bits, lowMask ) ),
+			_mm_shuffle_epi8( lookup, _mm_and_si128( _mm_srli_epi16( bits, 4 ), lowMask ) ) );
+
+		total = _mm_add_epi64( total, _mm_sad_epu8( counts, _mm_setzero_si128() ) );
+	}
+
+	return static_cast<size_t>( _mm_cvtsi128_si32( total ) ) + static_cast<size_t>( _mm_cvtsi128_si32( _mm_unpackhi_epi64( total, total ) ) );
+}
+
+VISIBILITYCACHE_TARGET_AVX2 void UnionAVX2( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords )
+{
+	for( size_t uiIndex = 0; uiIndex < uiWords; uiIndex += 4 )
+	{
+		const __m256i result = _mm256_or_si256(
+			_mm256_loadu_si256( reinterpret_cast<const __m256i*>( pA + uiIndex ) ),
+			_mm256_loadu_si256( reinterpret_cast<const __m256i*>( pB + uiIndex ) ) );
+
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + uiIndex ), result );
+	}
+}
+
+VISIBILITYCACHE_TARGET_AVX2 bool IntersectAVX2( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords )
+{
+	__m256i any = _mm256_setzero_si256();
+
+	for( size_t uiIndex = 0; uiIndex < uiWords; uiIndex += 4 )
+	{
+		const __m256i result = _mm256_and_si256(
+			_mm256_loadu_si256( reinterpret_cast<const __m256i*>( pA + uiIndex ) ),
+			_mm256_loadu_si256( reinterpret_cast<const __m256i*>( pB + uiIndex ) ) );
+
+		_mm256_storeu_si256( reinterpret_cast<__m256i*>( pDest + uiIndex ), result );
+
+		any = _mm256_or_si256( any, result );
+	}
+
+	return !_mm256_testz_si256( any, any );
+}
+
+VISIBILITYCACHE_TARGET_AVX2 size_t PopCountAVX2( const Word_t* pBits, const size_t uiWords )
+{
+	const __m256i lookup = _mm256_setr_epi8(
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+		0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 );
+	const __m256i lowMask = _mm256_set1_epi8( 0x0F );
+
+	__m256i total = _mm256_setzero_si256();
+
+	for( size_t uiIndex = 0; uiIndex < uiWords; uiIndex += 4 )
+	{
+		const __m256i bits = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( pBits + uiIndex ) );
+
+		const __m256i counts = _mm256_add_epi8(
+			_mm256_shuffle_epi8( lookup, _mm256_and_si256( bits, lowMask ) ),
+			_mm256_shuffle_epi8( lookup, _mm256_and_si256( _mm256_srli_epi16( bits, 4 ), lowMask ) ) );
+
+		total = _mm256_add_epi64( total, _mm256_sad_epu8( counts, _mm256_setzero_si256() ) );
+	}
+
+	const __m128i sum = _mm_add_epi64( _mm256_castsi256_si128( total ), _mm256_extracti128_si256( total, 1 ) );
+
+	return static_cast<size_t>( _mm_cvtsi128_si32( sum ) ) + static_cast<size_t>( _mm_cvtsi128_si32( _mm_unpackhi_epi64( sum, sum ) ) );
+}
+#endif
+
+UnionFunction_t GetUnion()
+{
+	static const CPUKernel_t<UnionFunction_t> KERNELS[] =
+	{
+#ifdef VISIBILITYCACHE_SSE2
+		{ CPUFeature::AVX2 | CPUFeature::SSE2, &UnionAVX2 },
+		{ CPUFeature::SSE2, &UnionSSE2 },
+#endif
+		{ CPUFeature::NONE, &UnionScalar }
+	};
+
+	static const UnionFunction_t pUnion = Plat_SelectKernel( KERNELS );
+
+	return pUnion;
+}
+
+IntersectFunction_t GetIntersect()
+{
+	static const CPUKernel_t<IntersectFunction_t> KERNELS[] =
+	{
+#ifdef VISIBILITYCACHE_SSE2
+		{ CPUFeature::AVX2 | CPUFeature::SSE2, &IntersectAVX2 },
+		{ CPUFeature::SSE2, &IntersectSSE2 },
+#endif
+		{ CPUFeature::NONE, &IntersectScalar }
+	};
+
+	static const IntersectFunction_t pIntersect = Plat_SelectKernel( KERNELS );
+
+	return pIntersect;
+}
+
+PopCountFunction_t GetPopCount()
+{
+	static const CPUKernel_t<PopCountFunction_t> KERNELS[] =
+	{
+#ifdef VISIBILITYCACHE_SSE2
+		{ CPUFeature::AVX2 | CPUFeature::SSE2, &PopCountAVX2 },
+		{ CPUFeature::SSSE3 | CPUFeature::SSE2, &PopCountSSSE3 },
+#endif
+		{ CPUFeature::NONE, &PopCountScalar }
+	};
+
+	static const PopCountFunction_t pPopCount = Plat_SelectKernel( KERNELS );
+
+	return pPopCount;
+}
+
+inline unsigned int FindLowestBit( const uint64_t uiMask )
+{
+#ifdef _MSC_VER
+	unsigned long uiIndex;
+
+	//Not _BitScanForward64, which 32 bit builds don't have.
+	if( _BitScanForward( &uiIndex, static_cast<unsigned long>( uiMask ) ) )
+		return static_cast<unsigned int>( uiIndex );
+
+	_BitScanForward( &uiIndex, static_cast<unsigned long>( uiMask >> 32 ) );
+
+	return static_cast<unsigned int>( uiIndex ) + 32;
+#else
+	return static_cast<unsigned int>( __builtin_ctzll( uiMask ) );
+#endif
+}
+
+/**
+*	@return Number of words needed for uiBits bits, padded to ROW_ALIGNMENT_WORDS.
+*/
+size_t GetWordCount( const size_t uiBits )
+{
+	const size_t uiWords = ( uiBits + CVisibilityCache::WORD_BITS - 1 ) / CVisibilityCache::WORD_BITS;
+
+	return ( uiWords + CVisibilityCache::ROW_ALIGNMENT_WORDS - 1 ) / CVisibilityCache::ROW_ALIGNMENT_WORDS * CVisibilityCache::ROW_ALIGNMENT_WORDS;
+}
+}
+
+void CVisibilityCache::Reset( const size_t uiLeafCount, const uint8_t* pData, const size_t uiSize, const size_t uiFirstLeaf, const size_t uiCapacity )
+{
+	m_uiLeafCount = uiLeafCount;
+	m_uiLeafWords = GetWordCount( uiLeafCount );
+
+	m_pData = pData;
+	m_uiDataSize = pData ? uiSize : 0;
+	m_uiFirstLeaf = uiFirstLeaf;
+
+	m_RowOffsets.assign( m_uiLeafCount, ALL_VISIBLE );
+	m_LeafSlots.assign( m_uiLeafCount, NO_SLOT );
+
+	//No more rows than there are leafs, but room for two so callers can combine rows.
+	m_uiCapacity = std::max<size_t>( std::min( uiCapacity, m_uiLeafCount ), 2 );
+
+	m_Slots.assign( m_uiCapacity, Slot_t() );
+
+	const size_t uiAlignment = ROW_ALIGNMENT_WORDS * sizeof( Word_t );
+
+	m_RowStorage.assign( m_uiCapacity * m_uiLeafWords + ROW_ALIGNMENT_WORDS - 1, 0 );
+
+	const uintptr_t uiStart = reinterpret_cast<uintptr_t>( m_RowStorage.data() );
+
+	m_pRows = reinterpret_cast<Word_t*>( ( uiStart + uiAlignment - 1 ) / uiAlignment * uiAlignment );
+
+	m_uiUseCounter = 0;
+
+	m_Stats = Stats_t();
+}
+
+void CVisibilityCache::Clear()
+{
+	m_uiLeafCount = 0;
+	m_uiLeafWords = 0;
+
+	m_pData = nullptr;
+	m_uiDataSize = 0;
+
+	m_RowOffsets.clear();
+	m_RowOffsets.shrink_to_fit();
+	m_LeafSlots.clear();
+	m_LeafSlots.shrink_to_fit();
+
+	m_uiCapacity = 0;
+
+	m_Slots.clear();
+	m_Slots.shrink_to_fit();
+	m_RowStorage.clear();
+	m_RowStorage.shrink_to_fit();
+
+	m_pRows = nullptr;
+}
+
+void CVisibilityCache::SetRowOffset( const size_t uiLeaf, const size_t uiOffset )
+{
+	assert( uiLeaf < m_uiLeafCount );
+
+	m_RowOffsets[ uiLeaf ] = uiOffset < m_uiDataSize ? static_cast<uint32_t>( uiOffset ) : ALL_VISIBLE;
+
+	Invalidate( uiLeaf );
+}
+
+void CVisibilityCache::SetAllVisible( const size_t uiLeaf )
+{
+	assert( uiLeaf < m_uiLeafCount );
+
+	m_RowOffsets[ uiLeaf ] = ALL_VISIBLE;
+
+	Invalidate( uiLeaf );
+}
+
+const CVisibilityCache::Word_t* CVisibilityCache::GetRow( const size_t uiLeaf )
+{
+	assert( uiLeaf < m_uiLeafCount );
+
+	const uint32_t uiCachedSlot = m_LeafSlots[ uiLeaf ];
+
+	if( uiCachedSlot != NO_SLOT )
+	{
+		m_Slots[ uiCachedSlot ].uiLastUse = ++m_uiUseCounter;
+
+		++m_Stats.uiHits;
+
+		return GetSlotRow( uiCachedSlot );
+	}
+
+	++m_Stats.uiMisses;
+
+	//Rows are decompressed far less often than they're found, so a scan for the least recently used slot is cheap enough.
+	size_t uiSlot = 0;
+
+	for( size_t uiIndex = 1; uiIndex < m_uiCapacity; ++uiIndex )
+	{
+		if( m_Slots[ uiIndex ].uiLastUse < m_Slots[ uiSlot ].uiLastUse )
+			uiSlot = uiIndex;
+	}
+
+	auto& slot = m_Slots[ uiSlot ];
+
+	if( slot.uiLeaf != NO_SLOT )
+	{
+		m_LeafSlots[ slot.uiLeaf ] = NO_SLOT;
+
+		++m_Stats.uiEvictions;
+	}
+
+	slot.uiLeaf = static_cast<uint32_t>( uiLeaf );
+	slot.uiLastUse = ++m_uiUseCounter;
+
+	m_LeafSlots[ uiLeaf ] = static_cast<uint32_t>( uiSlot );
+
+	auto pRow = GetSlotRow( uiSlot );
+
+	const uint32_t uiOffset = m_RowOffsets[ uiLeaf ];
+
+	if( uiOffset != ALL_VISIBLE )
+	{
+		DecompressRow( pRow, m_uiLeafCount, m_pData + uiOffset, m_uiDataSize - uiOffset, m_uiFirstLeaf );
+	}
+	else
+	{
+		//Padding bits stay clear, so they never count as leafs.
+		std::fill_n( pRow, m_uiLeafWords, 0 );
+		std::fill_n( pRow, m_uiLeafCount / WORD_BITS, ~Word_t( 0 ) );
+
+		if( m_uiLeafCount % WORD_BITS )
+			pRow[ m_uiLeafCount / WORD_BITS ] = ( Word_t( 1 ) << ( m_uiLeafCount % WORD_BITS ) ) - 1;
+	}
+
+	return pRow;
+}
+
+bool CVisibilityCache::IsVisible( const size_t uiFromLeaf, const size_t uiToLeaf )
+{
+	if( uiFromLeaf >= m_uiLeafCount || uiToLeaf >= m_uiLeafCount )
+		return false;
+
+	return ( GetRow( uiFromLeaf )[ uiToLeaf / WORD_BITS ] & ( Word_t( 1 ) << ( uiToLeaf % WORD_BITS ) ) ) != 0;
+}
+
+size_t CVisibilityCache::CountVisible( const size_t uiLeaf )
+{
+	return PopCount( GetRow( uiLeaf ), m_uiLeafWords );
+}
+
+void CVisibilityCache::GetAudible( const size_t uiLeaf, Word_t* pDest )
+{
+	static const auto pUnion = GetUnion();
+
+	std::fill_n( pDest, m_uiLeafWords, 0 );
+
+	//The visible leafs are walked one word at a time, and each word is read before any row is requested, so it doesn't matter if the row is evicted.
+	for( size_t uiWord = 0; uiWord < m_uiLeafWords; ++uiWord )
+	{
+		for( auto word = GetRow( uiLeaf )[ uiWord ]; word; word &= word - 1 )
+		{
+			pUnion( pDest, pDest, GetRow( uiWord * WORD_BITS + FindLowestBit( word ) ), m_uiLeafWords );
+		}
+	}
+}
+
+void CVisibilityCache::Union( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords )
+{
+	static const auto pUnion = GetUnion();
+
+	assert( uiWords % ROW_ALIGNMENT_WORDS == 0 );
+
+	pUnion( pDest, pA, pB, uiWords );
+}
+
+bool CVisibilityCache::Intersect( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords )
+{
+	static const auto pIntersect = GetIntersect();
+
+	assert( uiWords % ROW_ALIGNMENT_WORDS == 0 );
+
+	return pIntersect( pDest, pA, pB, uiWords );
+}
+
+size_t CVisibilityCache::PopCount( const Word_t* pBits, const size_t uiWords )
+{
+	static const auto pPopCount = GetPopCount();
+
+	assert( uiWords % ROW_ALIGNMENT_WORDS == 0 );
+
+	return pPopCount( pBits, uiWords );
+}
+
+void CVisibilityCache::DecompressRow( Word_t* pRow, const size_t uiLeafCount, const uint8_t* pData, const size_t uiSize, const size_t uiFirstLeaf )
+{
+	std::fill_n( pRow, GetWordCount( uiLeafCount ), 0 );
+
+	size_t uiNextLeaf = uiFirstLeaf;
+	size_t uiOffset = 0;
+
+	while( uiOffset < uiSize && uiNextLeaf < uiLeafCount )
+	{
+		const uint8_t uiByte = pData[ uiOffset++ ];
+
+		if( uiByte == 0 )
+		{
+			if( uiOffset >= uiSize )
+				break;
+
+			uiNextLeaf += 8 * pData[ uiOffset++ ];
+			continue;
+		}
+
+		for( size_t uiBit = 0; uiBit < 8; ++uiBit )
+		{
+			const size_t uiLeaf = uiNextLeaf + uiBit;
+
+			if( ( uiByte & ( 1 << uiBit ) ) && uiLeaf < uiLeafCount )
+				pRow[ uiLeaf / WORD_BITS ] |= Word_t( 1 ) << ( uiLeaf % WORD_BITS );
+		}
+
+		uiNextLeaf += 8;
+	}
+}
+
+void CVisibilityCache::Invalidate( const size_t uiLeaf )
+{
+	const uint32_t uiSlot = m_LeafSlots[ uiLeaf ];
+
+	if( uiSlot == NO_SLOT )
+		return;
+
+	m_LeafSlots[ uiLeaf ] = NO_SLOT;
+
+	m_Slots[ uiSlot ].uiLeaf = NO_SLOT;
+	m_Slots[ uiSlot ].uiLastUse = 0;
+}
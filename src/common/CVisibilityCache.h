@@ -0,0 +1,211 @@
+#ifndef COMMON_CVISIBILITYCACHE_H
+#define COMMON_CVISIBILITYCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+*	Decompresses a map's visibility data on demand, one leaf at a time, and keeps the most recently used rows of leaf bits.
+*	Rows are laid out like CInterestSets rows: bit N of a row is leaf N, and rows are padded to ROW_ALIGNMENT_WORDS words.
+*	They are also aligned to that many words, so the vector set operations never straddle a cache line.
+*	The compressed data is referred to, not copied, so several caches can share one loaded map; it has to stay loaded while this refers to it.
+*	Leafs are numbered however the map numbers them; a BSP map's leaf 0 is the solid leaf outside the world.
+*	Not thread safe: each thread that queries visibility should have its own cache.
+*/
+class CVisibilityCache final
+{
+public:
+	using Word_t = uint64_t;
+
+	static const size_t WORD_BITS = 64;
+
+	/**
+	*	Rows are padded to, and aligned to, a multiple of this many words.
+	*/
+	static const size_t ROW_ALIGNMENT_WORDS = 4;
+
+	/**
+	*	Number of rows kept if the user doesn't say otherwise.
+	*/
+	static const size_t DEFAULT_CAPACITY = 512;
+
+	struct Stats_t
+	{
+		/**
+		*	Rows that were requested and already decompressed.
+		*/
+		size_t uiHits = 0;
+
+		/**
+		*	Rows that had to be decompressed.
+		*/
+		size_t uiMisses = 0;
+
+		/**
+		*	Rows that were thrown out to make room for another.
+		*/
+		size_t uiEvictions = 0;
+	};
+
+public:
+	CVisibilityCache() = default;
+	~CVisibilityCache() = default;
+
+	size_t GetLeafCount() const { return m_uiLeafCount; }
+
+	size_t GetCapacity() const { return m_uiCapacity; }
+
+	/**
+	*	@return Number of words in a row of leaf bits.
+	*/
+	size_t GetRowWords() const { return m_uiLeafWords; }
+
+	/**
+	*	Uses new visibility data. Every leaf can see every leaf until its row is set.
+	*	@param pData Compressed rows of every leaf, or null if there are none. Must stay valid while this refers to it.
+	*	@param uiFirstLeaf Leaf that the first bit of each row stands for. BSP rows start at leaf 1, since leaf 0 is never visible.
+	*	@param uiCapacity Most rows that are kept decompressed. At least 2, so two rows can be used together.
+	*/
+	void Reset( const size_t uiLeafCount, const uint8_t* pData, const size_t uiSize, const size_t uiFirstLeaf, const size_t uiCapacity = DEFAULT_CAPACITY );
+
+	/**
+	*	Stops referring to the visibility data, and frees the rows.
+	*/
+	void Clear();
+
+	/**
+	*	Sets where a leaf's compressed row starts in the data. Rows end wherever the data says they do.
+	*	Offsets outside the data make every leaf visible from it, as for maps that weren't run through vis.
+	*/
+	void SetRowOffset( const size_t uiLeaf, const size_t uiOffset );
+
+	/**
+	*	Makes every leaf visible from a leaf, for leafs that have no visibility data.
+	*/
+	void SetAllVisible( const size_t uiLeaf );
+
+	/**
+	*	@return The leafs visible from a leaf, as bits. Must be less than GetLeafCount.
+	*	The row stays valid until GetCapacity() - 1 other rows have been requested, or the cache is reset.
+	*/
+	const Word_t* GetRow( const size_t uiLeaf );
+
+	bool IsVisible( const size_t uiFromLeaf, const size_t uiToLeaf );
+
+	/**
+	*	@return Number of leafs visible from a leaf.
+	*/
+	size_t CountVisible( const size_t uiLeaf );
+
+	/**
+	*	Gets the leafs that are potentially audible from a leaf: those visible from any leaf in its PVS.
+	*	Built on demand instead of for every leaf up front, so it decompresses the row of each visible leaf.
+	*	@param pDest GetRowWords() words.
+	*/
+	void GetAudible( const size_t uiLeaf, Word_t* pDest );
+
+	const Stats_t& GetStats() const { return m_Stats; }
+
+	void ResetStats() { m_Stats = Stats_t(); }
+
+	/**
+	*	Stores pA | pB in pDest. uiWords is a multiple of ROW_ALIGNMENT_WORDS. pDest may be pA or pB.
+	*/
+	static void Union( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords );
+
+	/**
+	*	Stores pA & pB in pDest. uiWords is a multiple of ROW_ALIGNMENT_WORDS. pDest may be pA or pB.
+	*	@return Whether any bit is set in the result.
+	*/
+	static bool Intersect( Word_t* pDest, const Word_t* pA, const Word_t* pB, const size_t uiWords );
+
+	/**
+	*	@return Number of bits set in uiWords words. uiWords is a multiple of ROW_ALIGNMENT_WORDS.
+	*/
+	static size_t PopCount( const Word_t* pBits, const size_t uiWords );
+
+	/**
+	*	Decompresses a row of GoldSource's visibility data: a zero byte is followed by the number of zero bytes it stands for,
+	*	other bytes are stored as they are.
+	*	@param pRow Row of uiLeafCount bits, which is cleared first.
+	*	@param pData Start of the row. Decompression stops at the end of the data, or once all leafs are covered.
+	*	@param uiFirstLeaf Leaf that the first bit stands for.
+	*/
+	static void DecompressRow( Word_t* pRow, const size_t uiLeafCount, const uint8_t* pData, const size_t uiSize, const size_t uiFirstLeaf );
+
+private:
+	/**
+	*	Offset of leafs that see every leaf.
+	*/
+	static const uint32_t ALL_VISIBLE = UINT32_MAX;
+
+	/**
+	*	Slot of leafs that aren't decompressed.
+	*/
+	static const uint32_t NO_SLOT = UINT32_MAX;
+
+	struct Slot_t
+	{
+		uint32_t uiLeaf = NO_SLOT;
+
+		/**
+		*	When the row was last requested, to find the least recently used one.
+		*/
+		uint64_t uiLastUse = 0;
+	};
+
+	Word_t* GetSlotRow( const size_t uiSlot ) { return m_pRows + uiSlot * m_uiLeafWords; }
+
+	/**
+	*	Forgets a leaf's row, if it's decompressed, after its offset changes.
+	*/
+	void Invalidate( const size_t uiLeaf );
+
+private:
+	size_t m_uiLeafCount = 0;
+
+	/**
+	*	Words in a row of leaf bits, padded to ROW_ALIGNMENT_WORDS.
+	*/
+	size_t m_uiLeafWords = 0;
+
+	const uint8_t* m_pData = nullptr;
+	size_t m_uiDataSize = 0;
+
+	size_t m_uiFirstLeaf = 0;
+
+	/**
+	*	Where each leaf's row starts in the data, or ALL_VISIBLE.
+	*/
+	std::vector<uint32_t> m_RowOffsets;
+
+	/**
+	*	Slot each leaf's row is decompressed in, or NO_SLOT.
+	*/
+	std::vector<uint32_t> m_LeafSlots;
+
+	size_t m_uiCapacity = 0;
+
+	std::vector<Slot_t> m_Slots;
+
+	/**
+	*	Storage of the rows, with room to align them.
+	*/
+	std::vector<Word_t> m_RowStorage;
+
+	/**
+	*	First row in m_RowStorage, aligned to ROW_ALIGNMENT_WORDS.
+	*/
+	Word_t* m_pRows = nullptr;
+
+	uint64_t m_uiUseCounter = 0;
+
+	Stats_t m_Stats;
+
+private:
+	CVisibilityCache( const CVisibilityCache& ) = delete;
+	CVisibilityCache& operator=( const CVisibilityCache& ) = delete;
+};
+
+#endif //COMMON_CVISIBILITYCACHE_H
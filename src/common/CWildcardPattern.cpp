@@ -0,0 +1,166 @@
+#include <cassert>
+#include <cstring>
+
+#include "CWildcardPattern.h"
+
+namespace
+{
+inline char FoldCase( const char c )
+{
+	return ( c >= 'A' && c <= 'Z' ) ? static_cast<char>( c - 'A' + 'a' ) : c;
+}
+
+inline char UpperCase( const char c )
+{
+	return ( c >= 'a' && c <= 'z' ) ? static_cast<char>( c - 'a' + 'A' ) : c;
+}
+}
+
+CWildcardPattern::CWildcardPattern( const char* pszPattern, const bool bCaseSensitive )
+{
+	Compile( pszPattern, bCaseSensitive );
+}
+
+void CWildcardPattern::Compile( const char* pszPattern, const bool bCaseSensitive )
+{
+	assert( pszPattern );
+
+	m_szPrefix.clear();
+	m_Segments.clear();
+	m_szSuffix.clear();
+	m_uiMinLength = 0;
+	m_bHasWildcard = false;
+	m_bCaseSensitive = bCaseSensitive;
+
+	std::string szLiteral;
+
+	for( const char* pszPos = pszPattern; ; ++pszPos )
+	{
+		if( *pszPos && *pszPos != '*' )
+		{
+			szLiteral += bCaseSensitive ? *pszPos : FoldCase( *pszPos );
+			continue;
+		}
+
+		m_uiMinLength += szLiteral.length();
+
+		if( !m_bHasWildcard )
+			m_szPrefix = std::move( szLiteral );
+		else if( !( *pszPos ) )
+			m_szSuffix = std::move( szLiteral );
+		else if( !szLiteral.empty() ) //Consecutive wildcards are the same as one.
+			m_Segments.emplace_back( std::move( szLiteral ) );
+
+		szLiteral.clear();
+
+		if( !( *pszPos ) )
+			break;
+
+		m_bHasWildcard = true;
+	}
+}
+
+bool CWildcardPattern::Matches( const char* pszString ) const
+{
+	assert( pszString );
+
+	//Patterns like "dir/*" only check the prefix, which doesn't need the length. A mismatch stops at the null terminator.
+	if( m_bHasWildcard && m_Segments.empty() && m_szSuffix.empty() )
+	{
+		if( m_bCaseSensitive )
+			return strncmp( pszString, m_szPrefix.data(), m_szPrefix.length() ) == 0;
+
+		return Equals( pszString, m_szPrefix.data(), m_szPrefix.length() );
+	}
+
+	return Matches( pszString, strlen( pszString ) );
+}
+
+bool CWildcardPattern::Matches( const char* pszString, const size_t uiLength ) const
+{
+	assert( pszString );
+
+	if( uiLength < m_uiMinLength )
+		return false;
+
+	if( !m_bHasWildcard )
+		return uiLength == m_szPrefix.length() && Equals( pszString, m_szPrefix.data(), uiLength );
+
+	if( !Equals( pszString, m_szPrefix.data(), m_szPrefix.length() ) )
+		return false;
+
+	//The suffix is anchored to the end, the segments are searched for in between.
+	const char* pszEnd = pszString + uiLength - m_szSuffix.length();
+
+	if( !Equals( pszEnd, m_szSuffix.data(), m_szSuffix.length() ) )
+		return false;
+
+	//Taking the first occurrence of each segment leaves the most room for the ones after it.
+	const char* pszPos = pszString + m_szPrefix.length();
+
+	for( const auto& szSegment : m_Segments )
+	{
+		pszPos = Find( pszPos, pszEnd, szSegment );
+
+		if( !pszPos )
+			return false;
+
+		pszPos += szSegment.length();
+	}
+
+	return true;
+}
+
+bool CWildcardPattern::Equals( const char* pszString, const char* pszLiteral, const size_t uiLength ) const
+{
+	if( m_bCaseSensitive )
+		return memcmp( pszString, pszLiteral, uiLength ) == 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiLength; ++uiIndex )
+	{
+		if( FoldCase( pszString[ uiIndex ] ) != pszLiteral[ uiIndex ] )
+			return false;
+	}
+
+	return true;
+}
+
+const char* CWildcardPattern::Find( const char* pszString, const char* pszEnd, const std::string& szLiteral ) const
+{
+	const size_t uiLength = szLiteral.length();
+
+	if( static_cast<size_t>( pszEnd - pszString ) < uiLength )
+		return nullptr;
+
+	//Last position the literal can start at.
+	const char* const pszLast = pszEnd - uiLength;
+
+	const char cFirst = szLiteral[ 0 ];
+	const char cFirstUpper = m_bCaseSensitive ? cFirst : UpperCase( cFirst );
+
+	while( pszString <= pszLast )
+	{
+		//Find candidates for the first character with memchr, then compare the rest.
+		const size_t uiRemaining = pszLast - pszString + 1;
+
+		const char* pszCandidate = reinterpret_cast<const char*>( memchr( pszString, cFirst, uiRemaining ) );
+
+		if( cFirstUpper != cFirst )
+		{
+			auto pszUpper = reinterpret_cast<const char*>( memchr( pszString, cFirstUpper, pszCandidate ? pszCandidate - pszString : uiRemaining ) );
+
+			if( pszUpper )
+				pszCandidate = pszUpper;
+		}
+
+		if( !pszCandidate )
+			return nullptr;
+
+		if( Equals( pszCandidate + 1, szLiteral.data() + 1, uiLength - 1 ) )
+			return pszCandidate;
+
+		pszString = pszCandidate + 1;
+	}
+
+	return nullptr;
+}
@@ -0,0 +1,98 @@
+#ifndef COMMON_CWILDCARDPATTERN_H
+#define COMMON_CWILDCARDPATTERN_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+*	A wildcard pattern that is compiled once and then matched against many strings.
+*	'*' matches 0 or more characters, all other characters match themselves.
+*	The pattern is split into a literal prefix, a literal suffix and the literal segments between them,
+*	so a match rejects most strings on their length or prefix before searching for the segments.
+*/
+class CWildcardPattern final
+{
+public:
+	/**
+	*	Default constructor. The pattern is empty, and only matches empty strings.
+	*/
+	CWildcardPattern() = default;
+
+	/**
+	*	@see Compile
+	*/
+	explicit CWildcardPattern( const char* pszPattern, const bool bCaseSensitive = true );
+
+	CWildcardPattern( CWildcardPattern&& other ) = default;
+	CWildcardPattern& operator=( CWildcardPattern&& other ) = default;
+
+	/**
+	*	Compiles a pattern.
+	*	@param pszPattern Pattern to compile.
+	*	@param bCaseSensitive Whether matching is case sensitive. If not, ASCII letters are folded; the pattern is folded once here.
+	*/
+	void Compile( const char* pszPattern, const bool bCaseSensitive = true );
+
+	/**
+	*	@return The pattern's characters before the first wildcard. Only strings that start with it can match.
+	*	Folded to lowercase if the pattern isn't case sensitive.
+	*/
+	const std::string& GetPrefix() const { return m_szPrefix; }
+
+	/**
+	*	@return Whether the pattern contains a wildcard. If not, it only matches itself.
+	*/
+	bool HasWildcard() const { return m_bHasWildcard; }
+
+	/**
+	*	@return Whether the string matches the pattern.
+	*/
+	bool Matches( const char* pszString ) const;
+
+	/**
+	*	@copydoc Matches( const char* pszString ) const
+	*	@param uiLength Length of the string.
+	*/
+	bool Matches( const char* pszString, const size_t uiLength ) const;
+
+private:
+	/**
+	*	Compares uiLength characters, folding pszString's if needed. pszLiteral is already folded.
+	*/
+	bool Equals( const char* pszString, const char* pszLiteral, const size_t uiLength ) const;
+
+	/**
+	*	Finds the first occurrence of a literal in a range of the string.
+	*	@return The occurrence, or null if it doesn't occur.
+	*/
+	const char* Find( const char* pszString, const char* pszEnd, const std::string& szLiteral ) const;
+
+private:
+	std::string m_szPrefix;
+
+	/**
+	*	Literals between wildcards, in order.
+	*/
+	std::vector<std::string> m_Segments;
+
+	/**
+	*	Characters after the last wildcard. Empty if the pattern ends with a wildcard.
+	*/
+	std::string m_szSuffix;
+
+	/**
+	*	Total length of all literals. Shorter strings can't match.
+	*/
+	size_t m_uiMinLength = 0;
+
+	bool m_bHasWildcard = false;
+
+	bool m_bCaseSensitive = true;
+
+private:
+	CWildcardPattern( const CWildcardPattern& ) = delete;
+	CWildcardPattern& operator=( const CWildcardPattern& ) = delete;
+};
+
+#endif //COMMON_CWILDCARDPATTERN_H
@@ -0,0 +1,231 @@
+#include <chrono>
+
+#include "Clock.h"
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <intrin.h>
+
+#define CLOCK_HAS_TSC
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <cpuid.h>
+#include <x86intrin.h>
+
+#define CLOCK_HAS_TSC
+#endif
+
+#ifdef WIN32
+#include "Platform.h"
+#endif
+
+namespace
+{
+/**
+*	How long the timestamp counter's rate is measured for, in nanoseconds.
+*	Longer is more accurate: the steady clock's resolution is well under a microsecond, so this is within a few parts per million.
+*/
+const uint64_t CALIBRATION_NS = 5000000;
+
+enum class ClockSource
+{
+	STEADY_CLOCK = 0,
+	TSC,
+	QPC
+};
+
+const char* const SOURCE_NAMES[] =
+{
+	"steady_clock",
+	"tsc",
+	"qpc"
+};
+
+/**
+*	Converts ticks to nanoseconds with a multiplication and shifts.
+*	The multiplier is kept under 32 bits so the low part of a tick count can be scaled without overflowing.
+*/
+struct Clock_t
+{
+	ClockSource source = ClockSource::STEADY_CLOCK;
+
+	uint64_t uiFrequency = 1000000000;
+
+	uint64_t uiMultiplier = 1;
+	unsigned int uiShift = 0;
+
+	/**
+	*	Counter value and steady clock time when the clock was set up. Times are measured from these.
+	*/
+	uint64_t uiBaseTicks = 0;
+	uint64_t uiBaseNS = 0;
+};
+
+uint64_t GetSteadyNS()
+{
+	return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+}
+
+#ifdef CLOCK_HAS_TSC
+/**
+*	@return Whether the timestamp counter runs at a constant rate in all power states, so it can be used as a clock.
+*/
+bool HasInvariantTSC()
+{
+#ifdef _MSC_VER
+	int info[ 4 ];
+
+	__cpuid( info, 0x80000000 );
+
+	if( static_cast<unsigned int>( info[ 0 ] ) < 0x80000007 )
+		return false;
+
+	__cpuid( info, 0x80000007 );
+
+	return ( info[ 3 ] & ( 1 << 8 ) ) != 0;
+#else
+	if( __get_cpuid_max( 0x80000000, nullptr ) < 0x80000007 )
+		return false;
+
+	unsigned int uiEAX, uiEBX, uiECX, uiEDX;
+
+	__cpuid( 0x80000007, uiEAX, uiEBX, uiECX, uiEDX );
+
+	return ( uiEDX & ( 1 << 8 ) ) != 0;
+#endif
+}
+#endif
+
+uint64_t ReadTicks( const ClockSource source )
+{
+	switch( source )
+	{
+#ifdef CLOCK_HAS_TSC
+	case ClockSource::TSC:			return __rdtsc();
+#endif
+
+#ifdef WIN32
+	case ClockSource::QPC:
+		{
+			LARGE_INTEGER counter;
+			QueryPerformanceCounter( &counter );
+			return static_cast<uint64_t>( counter.QuadPart );
+		}
+#endif
+
+	default:						return GetSteadyNS();
+	}
+}
+
+/**
+*	Measures how many ticks the timestamp counter advances per second.
+*/
+uint64_t MeasureTSCFrequency( const ClockSource source )
+{
+	const uint64_t uiStartNS = GetSteadyNS();
+	const uint64_t uiStartTicks = ReadTicks( source );
+
+	uint64_t uiEndNS;
+
+	do
+	{
+		uiEndNS = GetSteadyNS();
+	}
+	while( uiEndNS - uiStartNS < CALIBRATION_NS );
+
+	const uint64_t uiEndTicks = ReadTicks( source );
+
+	return static_cast<uint64_t>( static_cast<double>( uiEndTicks - uiStartTicks ) * 1000000000.0 / ( uiEndNS - uiStartNS ) );
+}
+
+Clock_t CreateClock()
+{
+	Clock_t clock;
+
+#ifdef CLOCK_HAS_TSC
+	if( HasInvariantTSC() )
+	{
+		clock.source = ClockSource::TSC;
+		clock.uiFrequency = MeasureTSCFrequency( clock.source );
+	}
+#endif
+
+#ifdef WIN32
+	if( clock.source == ClockSource::STEADY_CLOCK )
+	{
+		LARGE_INTEGER frequency;
+
+		if( QueryPerformanceFrequency( &frequency ) && frequency.QuadPart > 0 )
+		{
+			clock.source = ClockSource::QPC;
+			clock.uiFrequency = static_cast<uint64_t>( frequency.QuadPart );
+		}
+	}
+#endif
+
+	if( clock.uiFrequency == 0 )
+	{
+		clock.source = ClockSource::STEADY_CLOCK;
+		clock.uiFrequency = 1000000000;
+	}
+
+	//Largest shift that keeps the multiplier under 32 bits, for the most precision.
+	for( clock.uiShift = 32; clock.uiShift > 0; --clock.uiShift )
+	{
+		clock.uiMultiplier = ( static_cast<uint64_t>( 1000000000 ) << clock.uiShift ) / clock.uiFrequency;
+
+		if( clock.uiMultiplier <= UINT32_MAX )
+			break;
+	}
+
+	if( clock.uiShift == 0 )
+		clock.uiMultiplier = 1000000000 / clock.uiFrequency;
+
+	clock.uiBaseTicks = ReadTicks( clock.source );
+	clock.uiBaseNS = GetSteadyNS();
+
+	return clock;
+}
+
+const Clock_t& GetClock()
+{
+	static const Clock_t clock = CreateClock();
+
+	return clock;
+}
+
+uint64_t ToNanoseconds( const Clock_t& clock, const uint64_t uiTicks )
+{
+	const uint64_t uiMask = ( static_cast<uint64_t>( 1 ) << clock.uiShift ) - 1;
+
+	return ( uiTicks >> clock.uiShift ) * clock.uiMultiplier + ( ( ( uiTicks & uiMask ) * clock.uiMultiplier ) >> clock.uiShift );
+}
+}
+
+uint64_t Plat_GetClockTicks()
+{
+	return ReadTicks( GetClock().source );
+}
+
+uint64_t Plat_GetClockFrequency()
+{
+	return GetClock().uiFrequency;
+}
+
+uint64_t Plat_ClockTicksToNanoseconds( const uint64_t uiTicks )
+{
+	return ToNanoseconds( GetClock(), uiTicks );
+}
+
+uint64_t Plat_GetNanoseconds()
+{
+	const auto& clock = GetClock();
+
+	const uint64_t uiTicks = ReadTicks( clock.source );
+
+	//Counters of other cores can be slightly behind the one the clock was set up on.
+	return clock.uiBaseNS + ( uiTicks > clock.uiBaseTicks ? ToNanoseconds( clock, uiTicks - clock.uiBaseTicks ) : 0 );
+}
+
+const char* Plat_GetClockSource()
+{
+	return SOURCE_NAMES[ static_cast<int>( GetClock().source ) ];
+}
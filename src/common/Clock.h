@@ -0,0 +1,56 @@
+#ifndef COMMON_CLOCK_H
+#define COMMON_CLOCK_H
+
+#include <cstdint>
+
+/**
+*	@file
+*	Monotonic high resolution clock, the one time source for frame pacing, profiling, timers and budgets.
+*	Reads the CPU's timestamp counter if it runs at a constant rate and is synchronized between cores (invariant TSC),
+*	QueryPerformanceCounter on other Windows machines, and the standard steady clock elsewhere.
+*	The clock is set up the first time it's used: the timestamp counter's rate is measured against the steady clock over a few milliseconds.
+*	Times are on the steady clock's timeline, so they can be compared with times from other modules and from std::chrono::steady_clock.
+*/
+
+/**
+*	@return Current value of the clock's counter. Only meaningful relative to other counter values, see Plat_ClockTicksToNanoseconds.
+*/
+uint64_t Plat_GetClockTicks();
+
+/**
+*	@return Number of counter ticks per second.
+*/
+uint64_t Plat_GetClockFrequency();
+
+/**
+*	Converts a number of counter ticks, such as the difference between two Plat_GetClockTicks calls, to nanoseconds.
+*/
+uint64_t Plat_ClockTicksToNanoseconds( const uint64_t uiTicks );
+
+/**
+*	@return Current time in nanoseconds.
+*/
+uint64_t Plat_GetNanoseconds();
+
+/**
+*	@return Current time in microseconds.
+*/
+inline uint64_t Plat_GetMicroseconds()
+{
+	return Plat_GetNanoseconds() / 1000;
+}
+
+/**
+*	@return Current time in seconds.
+*/
+inline double Plat_GetSeconds()
+{
+	return Plat_GetNanoseconds() / 1000000000.0;
+}
+
+/**
+*	@return Name of the counter the clock reads: "tsc", "qpc" or "steady_clock".
+*/
+const char* Plat_GetClockSource();
+
+#endif //COMMON_CLOCK_H
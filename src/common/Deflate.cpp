@@ -0,0 +1,504 @@
+#include <cstring>
+
+#include "Deflate.h"
+
+namespace deflate
+{
+namespace
+{
+const unsigned int MAX_BITS = 15;
+
+const unsigned int MAX_LENGTH_CODES = 286;
+const unsigned int MAX_DISTANCE_CODES = 30;
+
+/**
+*	Fixed codes have 2 literal/length codes that are never used.
+*/
+const unsigned int FIXED_LENGTH_CODES = 288;
+
+const unsigned int FIXED_DISTANCE_CODES = 32;
+
+const unsigned int NUM_CODE_LENGTH_CODES = 19;
+
+const unsigned int END_OF_BLOCK = 256;
+
+/**
+*	Codes up to this long are decoded with a single table lookup, longer codes are decoded a bit at a time.
+*/
+const unsigned int FAST_BITS = 10;
+
+const uint16_t LENGTH_BASE[] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const uint8_t LENGTH_EXTRA[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+
+const uint16_t DISTANCE_BASE[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073,
+								   4097, 6145, 8193, 12289, 16385, 24577 };
+const uint8_t DISTANCE_EXTRA[] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+const uint8_t CODE_LENGTH_ORDER[ NUM_CODE_LENGTH_CODES ] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+/**
+*	Reads bits least significant first. Past the end of the input, zeros are read instead,
+*	so decoding doesn't have to check for the end of the input until it's done with a symbol.
+*/
+class CBitReader final
+{
+public:
+	CBitReader( const uint8_t* pData, const size_t uiSize )
+		: m_pIn( pData )
+		, m_pInEnd( pData + uiSize )
+	{
+	}
+
+	/**
+	*	Makes sure at least 57 bits are buffered.
+	*/
+	void Refill()
+	{
+		while( m_uiBitCount <= 56 )
+		{
+			if( m_pIn < m_pInEnd )
+				m_uiBits |= static_cast<uint64_t>( *m_pIn++ ) << m_uiBitCount;
+			else
+				m_uiPaddingBits += 8;
+
+			m_uiBitCount += 8;
+		}
+	}
+
+	uint32_t Peek( const unsigned int uiCount ) const
+	{
+		return static_cast<uint32_t>( m_uiBits & ( ( static_cast<uint64_t>( 1 ) << uiCount ) - 1 ) );
+	}
+
+	void Consume( const unsigned int uiCount )
+	{
+		m_uiBits >>= uiCount;
+		m_uiBitCount -= uiCount;
+	}
+
+	uint32_t Read( const unsigned int uiCount )
+	{
+		const auto value = Peek( uiCount );
+
+		Consume( uiCount );
+
+		return value;
+	}
+
+	/**
+	*	@return Whether more bits were read than the input has.
+	*/
+	bool IsOverrun() const { return m_uiBitCount < m_uiPaddingBits; }
+
+	/**
+	*	Discards the bits up to the next byte boundary, and returns the buffered bytes to the input.
+	*	Must not be overrun.
+	*	@return Position of the next byte.
+	*/
+	const uint8_t* AlignToByte()
+	{
+		Consume( m_uiBitCount & 7 );
+
+		m_pIn -= ( m_uiBitCount - m_uiPaddingBits ) / 8;
+
+		m_uiBits = 0;
+		m_uiBitCount = 0;
+		m_uiPaddingBits = 0;
+
+		return m_pIn;
+	}
+
+	const uint8_t* GetEnd() const { return m_pInEnd; }
+
+	/**
+	*	Continues reading at the given position. The bit buffer must be empty.
+	*/
+	void SetPosition( const uint8_t* pIn ) { m_pIn = pIn; }
+
+private:
+	const uint8_t* m_pIn;
+	const uint8_t* const m_pInEnd;
+
+	uint64_t m_uiBits = 0;
+	unsigned int m_uiBitCount = 0;
+
+	/**
+	*	Number of buffered bits that are past the end of the input. These are always the most significant bits.
+	*/
+	unsigned int m_uiPaddingBits = 0;
+};
+
+/**
+*	Canonical Huffman code.
+*/
+struct Huffman_t
+{
+	/**
+	*	Indexed by the next FAST_BITS bits: symbol << 4 | code length, or 0 if the code is longer.
+	*/
+	uint16_t fast[ 1 << FAST_BITS ];
+
+	/**
+	*	Number of codes of each length.
+	*/
+	uint16_t counts[ MAX_BITS + 1 ];
+
+	/**
+	*	Symbols ordered by code.
+	*/
+	uint16_t symbols[ FIXED_LENGTH_CODES ];
+};
+
+uint32_t ReverseBits( uint32_t uiCode, const unsigned int uiLength )
+{
+	uint32_t uiResult = 0;
+
+	for( unsigned int uiBit = 0; uiBit < uiLength; ++uiBit, uiCode >>= 1 )
+		uiResult = ( uiResult << 1 ) | ( uiCode & 1 );
+
+	return uiResult;
+}
+
+/**
+*	Builds a code from the code length of each symbol.
+*	Incomplete codes are only accepted if they have at most one code, which encoders use for blocks with one distance or none.
+*/
+bool BuildHuffman( Huffman_t& huffman, const uint8_t* pLengths, const unsigned int uiCount )
+{
+	memset( huffman.counts, 0, sizeof( huffman.counts ) );
+
+	for( unsigned int uiSymbol = 0; uiSymbol < uiCount; ++uiSymbol )
+		++huffman.counts[ pLengths[ uiSymbol ] ];
+
+	const unsigned int uiCodes = uiCount - huffman.counts[ 0 ];
+
+	huffman.counts[ 0 ] = 0;
+
+	int iLeft = 1;
+
+	for( unsigned int uiLength = 1; uiLength <= MAX_BITS; ++uiLength )
+	{
+		iLeft = ( iLeft << 1 ) - huffman.counts[ uiLength ];
+
+		//Over-subscribed.
+		if( iLeft < 0 )
+			return false;
+	}
+
+	if( iLeft > 0 && uiCodes > 1 )
+		return false;
+
+	uint16_t offsets[ MAX_BITS + 1 ];
+
+	offsets[ 1 ] = 0;
+
+	for( unsigned int uiLength = 1; uiLength < MAX_BITS; ++uiLength )
+		offsets[ uiLength + 1 ] = offsets[ uiLength ] + huffman.counts[ uiLength ];
+
+	for( unsigned int uiSymbol = 0; uiSymbol < uiCount; ++uiSymbol )
+	{
+		if( pLengths[ uiSymbol ] != 0 )
+			huffman.symbols[ offsets[ pLengths[ uiSymbol ] ]++ ] = static_cast<uint16_t>( uiSymbol );
+	}
+
+	memset( huffman.fast, 0, sizeof( huffman.fast ) );
+
+	//Codes are assigned in symbol order within each length, and are stored most significant bit first.
+	uint32_t uiCode = 0;
+	unsigned int uiIndex = 0;
+
+	for( unsigned int uiLength = 1; uiLength <= FAST_BITS; ++uiLength, uiCode <<= 1 )
+	{
+		for( unsigned int uiSymbol = 0; uiSymbol < huffman.counts[ uiLength ]; ++uiSymbol, ++uiCode, ++uiIndex )
+		{
+			const auto entry = static_cast<uint16_t>( ( huffman.symbols[ uiIndex ] << 4 ) | uiLength );
+
+			for( uint32_t uiSlot = ReverseBits( uiCode, uiLength ); uiSlot < ( 1u << FAST_BITS ); uiSlot += 1u << uiLength )
+				huffman.fast[ uiSlot ] = entry;
+		}
+	}
+
+	return true;
+}
+
+/**
+*	Decodes a symbol. At least MAX_BITS bits must be buffered.
+*/
+bool DecodeSymbol( CBitReader& reader, const Huffman_t& huffman, unsigned int& uiSymbol )
+{
+	const auto entry = huffman.fast[ reader.Peek( FAST_BITS ) ];
+
+	if( entry != 0 )
+	{
+		reader.Consume( entry & 0xF );
+		uiSymbol = entry >> 4;
+		return true;
+	}
+
+	const uint32_t uiBits = reader.Peek( MAX_BITS );
+
+	int iCode = 0;
+	int iFirst = 0;
+	int iIndex = 0;
+
+	for( unsigned int uiLength = 1; uiLength <= MAX_BITS; ++uiLength )
+	{
+		iCode |= ( uiBits >> ( uiLength - 1 ) ) & 1;
+
+		const int iCount = huffman.counts[ uiLength ];
+
+		if( iCode - iCount < iFirst )
+		{
+			reader.Consume( uiLength );
+			uiSymbol = huffman.symbols[ iIndex + ( iCode - iFirst ) ];
+			return true;
+		}
+
+		iIndex += iCount;
+		iFirst = ( iFirst + iCount ) << 1;
+		iCode <<= 1;
+	}
+
+	return false;
+}
+
+struct FixedCodes_t
+{
+	Huffman_t lengths;
+	Huffman_t distances;
+
+	FixedCodes_t()
+	{
+		uint8_t codeLengths[ FIXED_LENGTH_CODES ];
+
+		memset( codeLengths, 8, 144 );
+		memset( codeLengths + 144, 9, 256 - 144 );
+		memset( codeLengths + 256, 7, 280 - 256 );
+		memset( codeLengths + 280, 8, FIXED_LENGTH_CODES - 280 );
+
+		BuildHuffman( lengths, codeLengths, FIXED_LENGTH_CODES );
+
+		//The fixed distance code has 2 codes that are never used as well, which keeps it complete.
+		memset( codeLengths, 5, FIXED_DISTANCE_CODES );
+
+		BuildHuffman( distances, codeLengths, FIXED_DISTANCE_CODES );
+	}
+};
+
+const FixedCodes_t& GetFixedCodes()
+{
+	static const FixedCodes_t codes;
+
+	return codes;
+}
+
+bool InflateStored( CBitReader& reader, uint8_t*& pOut, uint8_t* const pOutEnd )
+{
+	if( reader.IsOverrun() )
+		return false;
+
+	const uint8_t* pIn = reader.AlignToByte();
+
+	if( reader.GetEnd() - pIn < 4 )
+		return false;
+
+	const size_t uiLength = pIn[ 0 ] | ( pIn[ 1 ] << 8 );
+	const size_t uiComplement = pIn[ 2 ] | ( pIn[ 3 ] << 8 );
+
+	pIn += 4;
+
+	if( uiLength != ( ~uiComplement & 0xFFFF ) )
+		return false;
+
+	if( static_cast<size_t>( reader.GetEnd() - pIn ) < uiLength || static_cast<size_t>( pOutEnd - pOut ) < uiLength )
+		return false;
+
+	memcpy( pOut, pIn, uiLength );
+
+	pOut += uiLength;
+
+	reader.SetPosition( pIn + uiLength );
+
+	return true;
+}
+
+bool InflateCodes( CBitReader& reader, const Huffman_t& lengths, const Huffman_t& distances,
+				   const uint8_t* const pDest, uint8_t*& pOut, uint8_t* const pOutEnd )
+{
+	unsigned int uiSymbol;
+
+	while( true )
+	{
+		reader.Refill();
+
+		if( !DecodeSymbol( reader, lengths, uiSymbol ) || reader.IsOverrun() )
+			return false;
+
+		if( uiSymbol < END_OF_BLOCK )
+		{
+			if( pOut == pOutEnd )
+				return false;
+
+			*pOut++ = static_cast<uint8_t>( uiSymbol );
+			continue;
+		}
+
+		if( uiSymbol == END_OF_BLOCK )
+			return true;
+
+		uiSymbol -= END_OF_BLOCK + 1;
+
+		if( uiSymbol >= sizeof( LENGTH_BASE ) / sizeof( LENGTH_BASE[ 0 ] ) )
+			return false;
+
+		const size_t uiLength = LENGTH_BASE[ uiSymbol ] + reader.Read( LENGTH_EXTRA[ uiSymbol ] );
+
+		reader.Refill();
+
+		if( !DecodeSymbol( reader, distances, uiSymbol ) || uiSymbol >= MAX_DISTANCE_CODES )
+			return false;
+
+		const size_t uiDistance = DISTANCE_BASE[ uiSymbol ] + reader.Read( DISTANCE_EXTRA[ uiSymbol ] );
+
+		if( reader.IsOverrun() || uiDistance > static_cast<size_t>( pOut - pDest ) || uiLength > static_cast<size_t>( pOutEnd - pOut ) )
+			return false;
+
+		const uint8_t* pMatch = pOut - uiDistance;
+
+		if( uiDistance >= uiLength )
+		{
+			memcpy( pOut, pMatch, uiLength );
+		}
+		else
+		{
+			//Matches can overlap the output, so copy one byte at a time.
+			for( size_t uiIndex = 0; uiIndex < uiLength; ++uiIndex )
+				pOut[ uiIndex ] = pMatch[ uiIndex ];
+		}
+
+		pOut += uiLength;
+	}
+}
+
+bool InflateDynamic( CBitReader& reader, const uint8_t* const pDest, uint8_t*& pOut, uint8_t* const pOutEnd )
+{
+	reader.Refill();
+
+	const unsigned int uiLengthCount = reader.Read( 5 ) + 257;
+	const unsigned int uiDistanceCount = reader.Read( 5 ) + 1;
+	const unsigned int uiCodeLengthCount = reader.Read( 4 ) + 4;
+
+	if( uiLengthCount > MAX_LENGTH_CODES || uiDistanceCount > MAX_DISTANCE_CODES )
+		return false;
+
+	uint8_t codeLengths[ MAX_LENGTH_CODES + MAX_DISTANCE_CODES ] = {};
+
+	for( unsigned int uiIndex = 0; uiIndex < uiCodeLengthCount; ++uiIndex )
+	{
+		reader.Refill();
+
+		codeLengths[ CODE_LENGTH_ORDER[ uiIndex ] ] = static_cast<uint8_t>( reader.Read( 3 ) );
+	}
+
+	Huffman_t lengths;
+	Huffman_t distances;
+
+	//The code length code is only needed until the other codes are built, so the distance code's storage is borrowed.
+	if( !BuildHuffman( distances, codeLengths, NUM_CODE_LENGTH_CODES ) )
+		return false;
+
+	const unsigned int uiTotal = uiLengthCount + uiDistanceCount;
+
+	for( unsigned int uiIndex = 0; uiIndex < uiTotal; )
+	{
+		reader.Refill();
+
+		unsigned int uiSymbol;
+
+		if( !DecodeSymbol( reader, distances, uiSymbol ) )
+			return false;
+
+		if( uiSymbol < 16 )
+		{
+			codeLengths[ uiIndex++ ] = static_cast<uint8_t>( uiSymbol );
+			continue;
+		}
+
+		uint8_t length = 0;
+		unsigned int uiRepeat;
+
+		if( uiSymbol == 16 )
+		{
+			if( uiIndex == 0 )
+				return false;
+
+			length = codeLengths[ uiIndex - 1 ];
+			uiRepeat = 3 + reader.Read( 2 );
+		}
+		else if( uiSymbol == 17 )
+		{
+			uiRepeat = 3 + reader.Read( 3 );
+		}
+		else
+		{
+			uiRepeat = 11 + reader.Read( 7 );
+		}
+
+		if( uiIndex + uiRepeat > uiTotal )
+			return false;
+
+		memset( codeLengths + uiIndex, length, uiRepeat );
+
+		uiIndex += uiRepeat;
+	}
+
+	if( reader.IsOverrun() )
+		return false;
+
+	//There has to be a way to end the block.
+	if( codeLengths[ END_OF_BLOCK ] == 0 )
+		return false;
+
+	if( !BuildHuffman( lengths, codeLengths, uiLengthCount ) || !BuildHuffman( distances, codeLengths + uiLengthCount, uiDistanceCount ) )
+		return false;
+
+	return InflateCodes( reader, lengths, distances, pDest, pOut, pOutEnd );
+}
+}
+
+bool Decompress( const uint8_t* pSource, const size_t uiSourceSize, uint8_t* pDest, const size_t uiDestSize )
+{
+	if( !pSource || ( !pDest && uiDestSize > 0 ) )
+		return false;
+
+	CBitReader reader( pSource, uiSourceSize );
+
+	uint8_t* pOut = pDest;
+	uint8_t* const pOutEnd = pDest + uiDestSize;
+
+	bool bFinal;
+
+	do
+	{
+		reader.Refill();
+
+		bFinal = reader.Read( 1 ) != 0;
+
+		bool bSuccess;
+
+		switch( reader.Read( 2 ) )
+		{
+		case 0:		bSuccess = InflateStored( reader, pOut, pOutEnd ); break;
+		case 1:		bSuccess = InflateCodes( reader, GetFixedCodes().lengths, GetFixedCodes().distances, pDest, pOut, pOutEnd ); break;
+		case 2:		bSuccess = InflateDynamic( reader, pDest, pOut, pOutEnd ); break;
+		default:	bSuccess = false; break;
+		}
+
+		if( !bSuccess )
+			return false;
+	}
+	while( !bFinal );
+
+	return !reader.IsOverrun() && pOut == pOutEnd;
+}
+}
@@ -0,0 +1,26 @@
+#ifndef COMMON_DEFLATE_H
+#define COMMON_DEFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+*	@file
+*	Decompression of raw DEFLATE streams (RFC 1951), as stored in ZIP files.
+*	There's no zlib or gzip framing, and no checksum is verified.
+*/
+
+namespace deflate
+{
+/**
+*	Decompresses a stream. Malformed input is detected; it never reads or writes out of bounds.
+*	@param pSource Compressed data.
+*	@param uiSourceSize Size of the compressed data, in bytes.
+*	@param pDest Buffer that receives the decompressed data.
+*	@param uiDestSize Exact size of the decompressed data, in bytes.
+*	@return Whether the stream was decompressed and had the expected size.
+*/
+bool Decompress( const uint8_t* pSource, const size_t uiSourceSize, uint8_t* pDest, const size_t uiDestSize );
+}
+
+#endif //COMMON_DEFLATE_H
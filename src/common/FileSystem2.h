@@ -6,6 +6,8 @@
 #include <cstdint>
 
 #include "FileSystem.h"
+#include "MemoryTracking.h"
+#include "Platform.h"
 
 typedef uint32_t FileSystemFindFlags_t;
 
@@ -23,6 +25,446 @@ enum FileSystemFindFlag : FileSystemFindFlags_t
 };
 }
 
+typedef uint32_t FileSystemOptions_t;
+
+namespace FileSystemOption
+{
+enum FileSystemOption : FileSystemOptions_t
+{
+	NONE					= 0,
+
+	/**
+	*	Map pack files into memory when they are added, and serve reads of their entries from the mapping.
+	*	If a pack file can't be mapped, it falls back to regular file I/O.
+	*/
+	MAP_PACK_FILES			= 1 << 0,
+
+	/**
+	*	Allow the filesystem to be used from multiple threads.
+	*	Lookups, opens and reads take a shared lock; only search path changes, file creation and removal take an exclusive lock.
+	*	A file handle must only be used by one thread at a time, and find handles belong to the thread that created them.
+	*	Must be set before other threads start using the filesystem.
+	*/
+	THREAD_SAFE				= 1 << 1,
+
+	/**
+	*	Look up files regardless of case, also on case sensitive platforms.
+	*	Names are folded when search paths are indexed, so a lookup folds the name once and probes the index.
+	*	Files that were created outside of the filesystem after their search path was added are only found with matching case.
+	*/
+	CASE_INSENSITIVE		= 1 << 2,
+
+	/**
+	*	Watch loose search paths for changes made outside of the filesystem, and keep the path index up to date with them.
+	*	Lookups of files that aren't indexed then never probe the disk, and files that are downloaded still appear promptly.
+	*	Search paths that can't be watched, or platforms that don't support it, fall back to probing.
+	*/
+	WATCH_LOOSE_PATHS		= 1 << 3,
+
+	/**
+	*	Share the buffers handed out by GetReadBuffer between files with identical contents, in any search path.
+	*	Contents are hashed when they're first loaded, and pack file entries remember them, so loading an entry that is in use needs no I/O.
+	*	Shared buffers must not be modified.
+	*/
+	SHARE_READ_BUFFERS		= 1 << 4,
+
+	/**
+	*	Buffer writes to files opened for writing only, and write them out on a background thread.
+	*	Flush and Close wait until everything that was written is on disk. Write errors are reported by IsOk after a Flush.
+	*/
+	WRITE_BEHIND			= 1 << 5,
+
+	/**
+	*	Verify pack files against their checksum files when they're added, and don't add pack files that are corrupt.
+	*	Pack files without checksum files are added without verification. Pack files that haven't changed since they were last verified aren't checked again.
+	*/
+	VERIFY_PACK_FILES		= 1 << 6,
+
+	/**
+	*	Keep loose files that were opened for binary reading open after they're closed, so reopening them needs no path walk, open or stat.
+	*	A bounded number of files is kept open. Files that were written to, replaced or removed since are opened again.
+	*	On Windows, files that are kept open can't be replaced or removed by other programs.
+	*/
+	CACHE_LOOSE_FILES		= 1 << 7,
+
+	/**
+	*	Count the memory held by pack directories by MemoryTag, for GetMemoryStats.
+	*	Must be set before search paths are added, and can't be cleared once set.
+	*/
+	TRACK_MEMORY			= 1 << 8,
+
+	/**
+	*	Keep the directories of pack files in a cache file between runs. Pack files that haven't changed since are added without reading their directories.
+	*	The cache is written when search paths are removed and when the filesystem is unmounted, if any pack file had to be read.
+	*/
+	CACHE_MOUNT_INDEX		= 1 << 9,
+
+	/**
+	*	Publish an immutable snapshot of the search paths whenever they change, and look files up in it for loads and asynchronous reads
+	*	instead of taking the search path lock. Search paths removed while a load still uses them are kept until it's done.
+	*	Loose search paths are probed on disk instead of through the path index, so this suits setups where most files come from pack files.
+	*	Only used in thread safe mode, and not when case is folded; lookups that reach a memory search path take the lock as usual.
+	*/
+	LOCK_FREE_LOOKUPS		= 1 << 10,
+
+	/**
+	*	Build the directory of each pack file in an arena that belongs to its search path, instead of allocating each of its tables from the heap.
+	*	Mounting then makes a few large allocations per pack file, and removing the search path frees its directory at once.
+	*	The arenas count towards MemoryTag::FILESYSTEM like the tables would, so TRACK_MEMORY shows the difference.
+	*/
+	PACK_DIRECTORY_ARENAS	= 1 << 11,
+
+	/**
+	*	Record every file access into per thread rings, for IFileSystem2::GetAccessAudit.
+	*	Unlike FILESYSTEM_WARNING_REPORTALLACCESSES, nothing is formatted or printed per access, so it can be left on to find unused and hot files.
+	*/
+	AUDIT_ACCESSES			= 1 << 12,
+
+	/**
+	*	Back the block cache with large (2 MiB) pages, and ask the OS to back mapped pack files with huge pages, so loads that touch
+	*	gigabytes of content don't spend their time on TLB misses. Falls back to regular pages where large pages can't be had.
+	*	Explicit large pages need a reserved huge page pool on Linux and the "Lock pages in memory" privilege on Windows.
+	*	Mapped pack files only get huge pages on Linux, and only if the kernel supports them for files; it applies to pack files added afterwards.
+	*/
+	LARGE_PAGES				= 1 << 13,
+};
+}
+
+/**
+*	Statistics for the cache of files that are known not to exist.
+*/
+struct FileSystemNegativeCacheStats_t
+{
+	/**
+	*	Number of lookups that checked the cache.
+	*/
+	uint64_t uiLookups;
+
+	/**
+	*	Number of lookups that were answered by the cache.
+	*/
+	uint64_t uiHits;
+
+	/**
+	*	Number of times entries were invalidated because files may have been created.
+	*/
+	uint64_t uiInvalidations;
+
+	/**
+	*	Number of file names currently cached.
+	*/
+	size_t uiEntries;
+};
+
+/**
+*	Statistics for the cache of pack file blocks.
+*/
+struct FileSystemBlockCacheStats_t
+{
+	uint64_t uiHits;
+	uint64_t uiMisses;
+	uint64_t uiEvictions;
+
+	/**
+	*	Number of reads that were too large to cache, and went to the disk directly.
+	*/
+	uint64_t uiBypasses;
+
+	/**
+	*	Bytes read from disk to fill blocks.
+	*/
+	uint64_t uiBytesRead;
+
+	/**
+	*	Number of blocks currently cached.
+	*/
+	size_t uiBlocks;
+
+	/**
+	*	Capacity of the cache, in bytes. 0 if it's disabled.
+	*/
+	size_t uiCapacity;
+
+	/**
+	*	Whether the cache is backed by large pages, explicit or transparent.
+	*	@see FileSystemOption::LARGE_PAGES
+	*/
+	bool bLargePages;
+};
+
+/**
+*	Handle to an asynchronous read.
+*/
+typedef uint32_t FileAsyncHandle_t;
+
+/**
+*	Invalid asynchronous read handle.
+*/
+#define FILESYSTEM_INVALID_ASYNC_HANDLE ( FileAsyncHandle_t ) 0
+
+enum class FileAsyncStatus
+{
+	/**
+	*	The read is queued or in progress.
+	*/
+	PENDING = 0,
+
+	/**
+	*	The read finished. Fewer bytes than requested may have been read if the end of the file was reached.
+	*/
+	COMPLETE,
+
+	/**
+	*	The read failed, or the handle is invalid.
+	*/
+	FAILED,
+
+	/**
+	*	The read was canceled before it started.
+	*/
+	CANCELED
+};
+
+/**
+*	Filesystem wide I/O counters.
+*/
+struct FileSystemStats_t
+{
+	/**
+	*	Number of files that were opened.
+	*/
+	uint64_t uiOpens;
+
+	/**
+	*	Number of opens that failed because the file couldn't be found or opened.
+	*/
+	uint64_t uiMisses;
+
+	uint64_t uiReads;
+	uint64_t uiBytesRead;
+	uint64_t uiSeeks;
+
+	/**
+	*	Time spent opening and reading files, in microseconds.
+	*/
+	uint64_t uiTime;
+
+	/**
+	*	Number of read buffer bytes that were shared with identical contents instead of being kept separately.
+	*	@see FileSystemOption::SHARE_READ_BUFFERS
+	*/
+	uint64_t uiSharedBytes;
+
+	/**
+	*	Number of accesses the access audit dropped because it was recording faster than it was being aggregated.
+	*	@see FileSystemOption::AUDIT_ACCESSES
+	*/
+	uint64_t uiAuditDropped;
+};
+
+/**
+*	I/O counters for a single search path.
+*/
+struct FileSystemPathStats_t
+{
+	char szPath[ MAX_PATH ];
+
+	/**
+	*	Path ID of the search path, or an empty string if it has none.
+	*/
+	char szPathID[ MAX_PATH ];
+
+	uint64_t uiOpens;
+	uint64_t uiReads;
+	uint64_t uiBytesRead;
+	uint64_t uiSeeks;
+
+	/**
+	*	Time spent opening and reading files, in microseconds.
+	*/
+	uint64_t uiTime;
+};
+
+/**
+*	Cost of a single file, measured from when it was opened until it was closed.
+*/
+struct FileSystemFileStats_t
+{
+	char szFileName[ MAX_PATH ];
+
+	/**
+	*	Time spent opening and reading the file, in microseconds.
+	*/
+	uint64_t uiTime;
+
+	uint64_t uiBytesRead;
+};
+
+/**
+*	How often a file was accessed, from the access audit.
+*	@see FileSystemOption::AUDIT_ACCESSES
+*/
+struct FileSystemAccessStats_t
+{
+	char szFileName[ MAX_PATH ];
+
+	/**
+	*	Number of times the file was closed or loaded.
+	*/
+	uint64_t uiAccesses;
+
+	uint64_t uiBytesRead;
+
+	/**
+	*	Time spent opening and reading the file, in microseconds.
+	*/
+	uint64_t uiTime;
+};
+
+/**
+*	A file or directory found by IFileSystem2::FindAll.
+*/
+struct FileSystemFindResult_t
+{
+	char szFileName[ MAX_PATH ];
+
+	bool bIsDirectory;
+};
+
+/**
+*	Allocates the buffer that a whole file is loaded into.
+*	@param uiSize Size of the file, in bytes.
+*	@param pContext Context that was passed to LoadFile.
+*	@return Buffer of at least uiSize bytes, or null to cancel the load.
+*/
+using FileAllocateFunc_t = void* ( * )( uint64_t uiSize, void* pContext );
+
+/**
+*	One file in a batched load.
+*/
+struct FileBatchRequest_t
+{
+	const char* pFileName = nullptr;
+
+	/**
+	*	Passed to the allocator.
+	*/
+	void* pContext = nullptr;
+
+	/**
+	*	Buffer returned by the allocator, or null if the file wasn't found or the allocation was canceled.
+	*	The caller owns it even if the read failed.
+	*/
+	void* pBuffer = nullptr;
+
+	/**
+	*	Number of bytes that were loaded.
+	*/
+	uint64_t uiSize = 0;
+
+	/**
+	*	Whether the whole file was loaded.
+	*/
+	bool bLoaded = false;
+};
+
+struct FileAsyncRequest_t;
+
+/**
+*	Called when an asynchronous read finishes. Called on an I/O worker thread, or on the calling thread if the read is canceled.
+*	@param request The request that was submitted.
+*	@param status Final status of the read.
+*	@param uiBytesRead Number of bytes that were read into the buffer.
+*/
+using FileAsyncCallback_t = void ( * )( const FileAsyncRequest_t& request, FileAsyncStatus status, uint64_t uiBytesRead );
+
+/**
+*	Describes an asynchronous read.
+*/
+struct FileAsyncRequest_t
+{
+	/**
+	*	Name of the file to read. Ignored if hFile is a valid handle.
+	*/
+	const char* pszFileName = nullptr;
+
+	/**
+	*	Optional. ID of the search paths to find the file in.
+	*/
+	const char* pszPathID = nullptr;
+
+	/**
+	*	Optional. Open file to read from. The file must not be closed until the read has finished.
+	*/
+	FileHandle_t hFile = FILESYSTEM_INVALID_HANDLE;
+
+	/**
+	*	Buffer to read into. Must be at least uiLength bytes large, and stay valid until the read has finished.
+	*/
+	void* pBuffer = nullptr;
+
+	/**
+	*	Offset in the file to start reading at.
+	*/
+	uint64_t uiOffset = 0;
+
+	/**
+	*	Number of bytes to read. 0 reads until the end of the file.
+	*/
+	uint64_t uiLength = 0;
+
+	/**
+	*	Optional. Called when the read has finished.
+	*/
+	FileAsyncCallback_t pCallback = nullptr;
+
+	/**
+	*	User data for the callback.
+	*/
+	void* pContext = nullptr;
+};
+
+/**
+*	Plain function entry points for the hottest IFileSystem calls, bound to the filesystem's implementation.
+*	Calling through these costs one indirect call, instead of a virtual call through a wrapper followed by one through the interface.
+*	Each function takes pContext as its first argument; the rest match the IFileSystem method of the same name.
+*/
+struct FileSystemFastPath_t
+{
+	void* pContext = nullptr;
+
+	FileHandle_t	( *pfnOpen )( void* pContext, const char *pFileName, const char *pOptions, const char *pathID ) = nullptr;
+	void			( *pfnClose )( void* pContext, FileHandle_t file ) = nullptr;
+	int				( *pfnRead )( void* pContext, void* pOutput, int size, FileHandle_t file ) = nullptr;
+	void			( *pfnSeek )( void* pContext, FileHandle_t file, int pos, FileSystemSeek_t seekType ) = nullptr;
+	unsigned int	( *pfnTell )( void* pContext, FileHandle_t file ) = nullptr;
+	bool			( *pfnFileExists )( void* pContext, const char *pFileName ) = nullptr;
+};
+
+/**
+*	Remote source of pack files that are installed while they're in use, for example a web server that supports HTTP range requests.
+*	The functions are called on the thread that needs the data and on the filesystem's install thread, possibly at the same time.
+*/
+struct FileContentSource_t
+{
+	void* pContext = nullptr;
+
+	/**
+	*	Gets the size of a pack file.
+	*	@param pszName Name that the pack file was added with.
+	*	@param[ out ] puiSize Receives the size of the pack file, in bytes.
+	*	@return Whether the size is known.
+	*/
+	bool			( *pfnGetSize )( void* pContext, const char* pszName, uint64_t* puiSize ) = nullptr;
+
+	/**
+	*	Reads a range of a pack file. Blocks until the range has been read.
+	*	@param pszName Name that the pack file was added with.
+	*	@return Whether the whole range was read.
+	*/
+	bool			( *pfnRead )( void* pContext, const char* pszName, uint64_t uiOffset, void* pBuffer, uint64_t uiSize ) = nullptr;
+};
+
 /**
 *	GoldSource2 filesystem interface. Provides extended functionality to the filesystem used by GoldSource.
 */
@@ -91,6 +533,257 @@ public:
 	*	@see FullPathToRelativePath
 	*/
 	virtual bool			FullPathToRelativePathEx( const char *pFullpath, char *pRelative, size_t uiSizeInChars ) = 0;
+
+	/**
+	*	@return The filesystem options.
+	*	@see FileSystemOption::FileSystemOption
+	*/
+	virtual FileSystemOptions_t GetOptions() const = 0;
+
+	/**
+	*	Sets the filesystem options. Options that affect how search paths are added only apply to search paths added afterwards.
+	*	@param options Options to set.
+	*	@see FileSystemOption::FileSystemOption
+	*/
+	virtual void			SetOptions( FileSystemOptions_t options ) = 0;
+
+	/**
+	*	Gets statistics for the cache of files that are known not to exist.
+	*	@param[ out ] stats Receives the statistics.
+	*/
+	virtual void			GetNegativeCacheStats( FileSystemNegativeCacheStats_t& stats ) = 0;
+
+	/**
+	*	Gets the filesystem wide I/O counters.
+	*	@param[ out ] stats Receives the counters.
+	*/
+	virtual void			GetStats( FileSystemStats_t& stats ) = 0;
+
+	/**
+	*	Gets the I/O counters for each search path. Search paths that have been removed are still reported.
+	*	Group by path ID to get per path ID counters.
+	*	@param[ out ] pStats Array that receives the counters. May be null if uiMaxCount is 0.
+	*	@param uiMaxCount Number of elements in pStats.
+	*	@return Total number of search paths that have counters.
+	*/
+	virtual size_t			GetSearchPathStats( FileSystemPathStats_t* pStats, size_t uiMaxCount ) = 0;
+
+	/**
+	*	Gets the files that took the longest, slowest first. Only closed files are considered.
+	*	@param[ out ] pFiles Array that receives the files. May be null if uiMaxCount is 0.
+	*	@param uiMaxCount Number of elements in pFiles.
+	*	@return Number of files written to pFiles.
+	*/
+	virtual size_t			GetSlowestFiles( FileSystemFileStats_t* pFiles, size_t uiMaxCount ) = 0;
+
+	/**
+	*	Resets all I/O counters.
+	*/
+	virtual void			ResetStats() = 0;
+
+	/**
+	*	Gets the filesystem's memory counters for every tag. Only counted if FileSystemOption::TRACK_MEMORY is set.
+	*	@param[ out ] pStats Array that receives the counters. May be null if uiMaxCount is 0.
+	*	@param uiMaxCount Number of elements in pStats.
+	*	@return NUM_MEMORY_TAGS.
+	*/
+	virtual size_t			GetMemoryStats( MemoryTagStats_t* pStats, size_t uiMaxCount ) = 0;
+
+	/**
+	*	Gets the filesystem's trace events that ended after a point in time, as Chrome trace event objects separated by commas.
+	*	Empty unless tracing was compiled in.
+	*	@see Trace_GetEvents
+	*/
+	virtual size_t			GetTraceEvents( char* pszBuffer, size_t uiBufferSize, uint64_t uiSinceUS, unsigned int uiProcessID ) = 0;
+
+	/**
+	*	Queues an asynchronous read. The file is located when the read is submitted, and read on an I/O worker thread.
+	*	@param request Describes the read.
+	*	@return Handle to the read, or FILESYSTEM_INVALID_ASYNC_HANDLE if the file couldn't be found. Must be released with ReleaseAsync.
+	*/
+	virtual FileAsyncHandle_t ReadAsync( const FileAsyncRequest_t& request ) = 0;
+
+	/**
+	*	Gets the status of an asynchronous read without blocking.
+	*	@param handle Handle to the read.
+	*	@param[ out ] puiBytesRead Optional. If the read has finished, receives the number of bytes that were read.
+	*/
+	virtual FileAsyncStatus	GetAsyncStatus( FileAsyncHandle_t handle, uint64_t* puiBytesRead = nullptr ) = 0;
+
+	/**
+	*	Blocks until an asynchronous read has finished.
+	*	@see GetAsyncStatus
+	*/
+	virtual FileAsyncStatus	WaitForAsync( FileAsyncHandle_t handle, uint64_t* puiBytesRead = nullptr ) = 0;
+
+	/**
+	*	Cancels an asynchronous read if it hasn't started yet.
+	*	@return Whether the read was canceled.
+	*/
+	virtual bool			CancelAsync( FileAsyncHandle_t handle ) = 0;
+
+	/**
+	*	Releases an asynchronous read handle. If the read is still pending, it runs to completion but its status can no longer be queried.
+	*/
+	virtual void			ReleaseAsync( FileAsyncHandle_t handle ) = 0;
+
+	/**
+	*	Loads a whole file into a buffer provided by the caller. The file is located once and read with a single read, without opening a handle.
+	*	@param pFileName Name of the file to load.
+	*	@param pathID Optional. Path ID to search in.
+	*	@param pfnAllocate Called once the file's size is known to get the buffer to load into.
+	*	@param pContext Passed to pfnAllocate.
+	*	@param[ out ] puiSize Optional. Receives the number of bytes that were loaded.
+	*	@return The buffer returned by pfnAllocate, or null if the file couldn't be loaded or the allocation was canceled.
+	*		If the file couldn't be read after allocating, the buffer is still owned by the caller but its contents are undefined.
+	*/
+	virtual void*			LoadFile( const char* pFileName, const char* pathID, FileAllocateFunc_t pfnAllocate, void* pContext, uint64_t* puiSize = nullptr ) = 0;
+
+	/**
+	*	Loads a batch of whole files. Files that are stored next to each other in the same pack file are read together,
+	*	so loading many small files takes a few large reads instead of one read each.
+	*	@param pRequests Files to load. The results are written back to each request.
+	*	@param uiCount Number of requests.
+	*	@param pathID Optional. Path ID to search in.
+	*	@param pfnAllocate Called once for each file that was found to get the buffer to load into.
+	*	@return Number of files that were loaded.
+	*/
+	virtual size_t			LoadFiles( FileBatchRequest_t* pRequests, size_t uiCount, const char* pathID, FileAllocateFunc_t pfnAllocate ) = 0;
+
+	/**
+	*	Adds a search path whose files are kept in memory. Reads from it never touch the disk.
+	*	Like other search paths, it is added to the end of the search paths, so it has to be added before the paths it should override.
+	*	Memory search paths are read only, and start out empty. Use AddMemoryFile or PinFile to fill them.
+	*	@param pName Name of the search path. Used instead of a path to refer to it, and removed with RemoveSearchPath.
+	*	@param pathID Optional. Path ID of the search path.
+	*	@return Whether the search path was added.
+	*/
+	virtual bool			AddMemorySearchPath( const char* pName, const char* pathID ) = 0;
+
+	/**
+	*	Adds a file to a memory search path. The data is copied. Replaces the file if it was already added;
+	*	handles that were opened before keep reading the old contents.
+	*	@param pSearchPath Name of the memory search path.
+	*	@param pFileName Name of the file relative to the search path.
+	*	@param pData Contents of the file.
+	*	@param uiSize Size of the contents, in bytes.
+	*	@return Whether the file was added.
+	*/
+	virtual bool			AddMemoryFile( const char* pSearchPath, const char* pFileName, const void* pData, uint64_t uiSize ) = 0;
+
+	/**
+	*	Loads a file from the search paths and adds it to a memory search path, so later reads are served from memory.
+	*	@param pSearchPath Name of the memory search path.
+	*	@param pFileName Name of the file to pin.
+	*	@param pathID Optional. Path ID to load the file from.
+	*	@return Whether the file was loaded and added.
+	*/
+	virtual bool			PinFile( const char* pSearchPath, const char* pFileName, const char* pathID = nullptr ) = 0;
+
+	/**
+	*	Removes a file from a memory search path. Handles that are open keep reading its contents.
+	*	@return Whether the file was in the search path.
+	*/
+	virtual bool			RemoveMemoryFile( const char* pSearchPath, const char* pFileName ) = 0;
+
+	/**
+	*	Gets the direct entry points for the hottest calls. They stay valid for as long as the filesystem does.
+	*/
+	virtual void			GetFastPath( FileSystemFastPath_t& fastPath ) = 0;
+
+	/**
+	*	Sets the size of the cache of pack file blocks. Reads of pack files that aren't memory mapped are served from it,
+	*	so neighbouring entries and repeated reads don't touch the disk. All cached blocks are discarded.
+	*	@param uiBytes Capacity in bytes. 0 disables the cache, which is the default.
+	*/
+	virtual void			SetBlockCacheSize( size_t uiBytes ) = 0;
+
+	virtual void			GetBlockCacheStats( FileSystemBlockCacheStats_t& stats ) = 0;
+
+	/**
+	*	Sets the size from which uncompressed entries of pack files that aren't memory mapped are streamed with unbuffered I/O.
+	*	Streamed entries bypass the OS page cache and the block cache, so reading large entries such as demos and movies once
+	*	doesn't evict everything else. They're read ahead in large aligned blocks on a background thread instead.
+	*	Entries on filesystems that don't support unbuffered I/O are read as usual. Only affects files opened afterwards.
+	*	@param uiBytes Threshold in bytes. 0 disables direct streaming, which is the default.
+	*/
+	virtual void			SetDirectStreamingThreshold( uint64_t uiBytes ) = 0;
+
+	/**
+	*	Adds a writable overlay search path, such as the directory that downloaded content is saved to.
+	*	The directory and the pack files in it are indexed once when it's added, and merged over the search paths after it like any other search path.
+	*	Lookups of files that aren't in the index never probe the disk for an overlay. Files written through the filesystem are indexed as they're opened;
+	*	files that are written, moved or removed by anything else, such as a downloader, must be reported with UpdateOverlayFile.
+	*	@param pPath Path of the directory.
+	*	@param pathID Optional. Path ID of the search path.
+	*	@return Whether the search path was added.
+	*/
+	virtual bool			AddOverlaySearchPath( const char* pPath, const char* pathID ) = 0;
+
+	/**
+	*	Updates the index of an overlay search path after a file or directory in it was created, replaced or removed outside of the filesystem.
+	*	Costs a single index update instead of a rescan. Directories are indexed with their contents.
+	*	@param pSearchPath Path the overlay search path was added with.
+	*	@param pFileName Name of the file relative to the search path.
+	*	@return Whether the search path is an overlay.
+	*/
+	virtual bool			UpdateOverlayFile( const char* pSearchPath, const char* pFileName ) = 0;
+
+	/**
+	*	Sets where pack files added with AddStreamingPackFile are installed from. Must be set before any are added, and stay valid until shutdown.
+	*/
+	virtual void			SetContentSource( const FileContentSource_t& source ) = 0;
+
+	/**
+	*	Adds a pack file that is installed while it's in use, so players can join before the download finishes.
+	*	A local copy is created at its full size, and only the header and directory are fetched before it's added.
+	*	Entries are fetched the first time they're opened or loaded, so the files the current map's load trace prefetches are fetched first;
+	*	the rest is downloaded in the background. Which parts are present is saved next to the copy, so an interrupted install resumes.
+	*	IsFileImmediatelyAvailable and IsAppReadyForOfflinePlay report what's present.
+	*	@param pFullPath Path of the local copy.
+	*	@param pRemoteName Name the content source knows the pack file by.
+	*	@param pathID Optional. Path ID of the search path.
+	*	@return Whether the pack file was added.
+	*/
+	virtual bool			AddStreamingPackFile( const char* pFullPath, const char* pRemoteName, const char* pathID ) = 0;
+
+	/**
+	*	Gets how much of the pack files added with AddStreamingPackFile is present.
+	*/
+	virtual void			GetInstallProgress( uint64_t* puiAvailableBytes, uint64_t* puiTotalBytes ) = 0;
+
+	/**
+	*	Compiles a resource list (.lst) against the current search paths and saves the result, so WaitForResources and HintResourceNeed
+	*	can prefetch its resources without looking each of them up. The manifest stores the pack file ranges to read, sorted and merged for sequential reads.
+	*	WaitForResources compiles lists that have no up to date manifest itself; calling this after the search paths are set up moves that cost out of loading.
+	*	Manifests are recompiled when the list, the search paths or a pack file they reference change.
+	*	@param pResourceList Name of the resource list file.
+	*	@return Whether the resource list was found and compiled.
+	*/
+	virtual bool			CompileResourceManifest( const char* pResourceList ) = 0;
+
+	/**
+	*	Gets the files recorded by the access audit, most accessed first. Only recorded if FileSystemOption::AUDIT_ACCESSES is set.
+	*	Files that are never listed weren't accessed since the audit was enabled or ResetStats was last called.
+	*	@param[ out ] pFiles Array that receives the files. May be null if uiMaxCount is 0.
+	*	@param uiMaxCount Number of elements in pFiles.
+	*	@return Total number of files that were accessed.
+	*/
+	virtual size_t			GetAccessAudit( FileSystemAccessStats_t* pFiles, size_t uiMaxCount ) = 0;
+
+	/**
+	*	Finds all files and directories matching a wildcard in one call, like a FindFirstEx/FindNext loop.
+	*	All search paths are searched at once, on several threads. Each name is returned once, even if several search paths provide it,
+	*	and results are sorted by name.
+	*	@param pWildCard Wildcard to match.
+	*	@param flags Find flags.
+	*	@param pathID Optional. Path ID to search in.
+	*	@param[ out ] pResults Array that receives the results. May be null if uiMaxCount is 0.
+	*	@param uiMaxCount Number of elements in pResults.
+	*	@return Total number of results. If larger than uiMaxCount, only the first uiMaxCount were written.
+	*	@see FileSystemFindFlag::FileSystemFindFlag
+	*/
+	virtual size_t			FindAll( const char* pWildCard, FileSystemFindFlags_t flags, const char* pathID, FileSystemFindResult_t* pResults, size_t uiMaxCount ) = 0;
 };
 
 /**
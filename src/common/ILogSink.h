@@ -0,0 +1,31 @@
+#ifndef COMMON_ILOGSINK_H
+#define COMMON_ILOGSINK_H
+
+#include <cstddef>
+
+/**
+*	Receives log text on the logging thread, in addition to stdout.
+*	Sinks are only called by one thread at a time, and must not log themselves.
+*/
+class ILogSink
+{
+public:
+	virtual ~ILogSink() = default;
+
+	/**
+	*	Writes a batch of log text. The text is not null terminated.
+	*/
+	virtual void Write( const char* pszText, const size_t uiLength ) = 0;
+
+	/**
+	*	Called regularly, whether there was text or not. Used for time based flushing.
+	*/
+	virtual void Update() {}
+
+	/**
+	*	Writes out anything that is buffered.
+	*/
+	virtual void Flush() = 0;
+};
+
+#endif //COMMON_ILOGSINK_H
@@ -6,6 +6,7 @@
 #include "SDL2/SDL.h"
 
 #include "interface.h"
+#include "Tracing.h"
 
 /**
 *	@defgroup MetaLoader Meta library loader
@@ -28,20 +29,76 @@ public:
 	virtual const char* GetGameDirectory( char* pszDest, size_t uiSizeInCharacters ) const = 0;
 
 	/**
-	*	Gets the original engine window.
+	*	Gets the engine window. Null until the engine has registered it with SetEngineWindow.
 	*/
 	virtual SDL_Window* GetEngineWindow() const = 0;
 
+	/**
+	*	Registers the engine window once it's created, or clears it with null before it's destroyed.
+	*/
+	virtual void SetEngineWindow( SDL_Window* pWindow ) = 0;
+
+	/**
+	*	Starts timing a startup phase. Phases are nested, and show up in the startup report.
+	*	@param pszName Name of the phase. Copied.
+	*/
+	virtual void BeginStartupPhase( const char* pszName ) = 0;
+
+	/**
+	*	Ends the innermost startup phase.
+	*/
+	virtual void EndStartupPhase() = 0;
+
 	/**
 	*	@return Whether this is a listen server or a dedicated server.
 	*/
 	virtual bool IsListenServer() const = 0;
+
+	/**
+	*	Checks whether the tool library has been rebuilt, if the loader was started with -toolreload.
+	*	Tools that support reloading call this regularly, and return from IMetaTool::Run once it returns true.
+	*	The loader then shuts the tool down and starts the rebuilt one, keeping the filesystem mounted.
+	*	Cheap enough to call every frame.
+	*/
+	virtual bool ShouldReloadTool() = 0;
 };
 
 /**
 *	Interface name.
 */
-#define IMETALOADER_NAME "IMetaLoaderV001"
+#define IMETALOADER_NAME "IMetaLoaderV004"
+
+/**
+*	Times a startup phase for as long as it's in scope. The phase is also recorded as a trace event, so the name must be a string literal.
+*/
+class CScopedStartupPhase final
+{
+public:
+	CScopedStartupPhase( IMetaLoader& loader, const char* pszName )
+		: m_Loader( loader )
+#ifdef ENABLE_TRACING
+		, m_Trace( pszName )
+#endif
+	{
+		m_Loader.BeginStartupPhase( pszName );
+	}
+
+	~CScopedStartupPhase()
+	{
+		m_Loader.EndStartupPhase();
+	}
+
+private:
+	IMetaLoader& m_Loader;
+
+#ifdef ENABLE_TRACING
+	CTraceScope m_Trace;
+#endif
+
+private:
+	CScopedStartupPhase( const CScopedStartupPhase& ) = delete;
+	CScopedStartupPhase& operator=( const CScopedStartupPhase& ) = delete;
+};
 
 /** @} */
 
@@ -0,0 +1,246 @@
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "LZ4.h"
+
+namespace lz4
+{
+namespace
+{
+const size_t MIN_MATCH = 4;
+
+/**
+*	The last match must start at least this many bytes before the end of the block.
+*/
+const size_t MF_LIMIT = 12;
+
+/**
+*	The last this many bytes of a block are always literals.
+*/
+const size_t LAST_LITERALS = 5;
+
+const size_t MAX_OFFSET = 0xFFFF;
+
+const size_t HASH_LOG = 12;
+
+const uint8_t RUN_MASK = 0x0F;
+
+inline uint32_t Read32( const uint8_t* pData )
+{
+	uint32_t value;
+
+	memcpy( &value, pData, sizeof( value ) );
+
+	return value;
+}
+
+inline uint32_t Hash( const uint32_t value )
+{
+	return ( value * 2654435761U ) >> ( 32 - HASH_LOG );
+}
+
+/**
+*	Writes the extra bytes of a length that doesn't fit in the token.
+*/
+inline bool WriteLength( uint8_t*& pOut, const uint8_t* pOutEnd, size_t uiLength )
+{
+	for( ; uiLength >= 255; uiLength -= 255 )
+	{
+		if( pOut >= pOutEnd )
+			return false;
+
+		*pOut++ = 255;
+	}
+
+	if( pOut >= pOutEnd )
+		return false;
+
+	*pOut++ = static_cast<uint8_t>( uiLength );
+
+	return true;
+}
+
+/**
+*	Reads the extra bytes of a length that didn't fit in the token.
+*/
+inline bool ReadLength( const uint8_t*& pIn, const uint8_t* pInEnd, size_t& uiLength )
+{
+	uint8_t value;
+
+	do
+	{
+		if( pIn >= pInEnd )
+			return false;
+
+		value = *pIn++;
+
+		uiLength += value;
+	}
+	while( value == 255 );
+
+	return true;
+}
+
+/**
+*	Writes a sequence of literals, optionally followed by a match.
+*/
+bool WriteSequence( uint8_t*& pOut, const uint8_t* pOutEnd,
+					const uint8_t* pLiterals, const size_t uiLiteralCount, const size_t uiOffset, const size_t uiMatchLength )
+{
+	if( pOut >= pOutEnd )
+		return false;
+
+	uint8_t* const pToken = pOut++;
+
+	*pToken = static_cast<uint8_t>( std::min<size_t>( uiLiteralCount, RUN_MASK ) << 4 );
+
+	if( uiLiteralCount >= RUN_MASK && !WriteLength( pOut, pOutEnd, uiLiteralCount - RUN_MASK ) )
+		return false;
+
+	if( static_cast<size_t>( pOutEnd - pOut ) < uiLiteralCount )
+		return false;
+
+	memcpy( pOut, pLiterals, uiLiteralCount );
+
+	pOut += uiLiteralCount;
+
+	//The last sequence has no match.
+	if( uiMatchLength == 0 )
+		return true;
+
+	if( pOutEnd - pOut < 2 )
+		return false;
+
+	*pOut++ = static_cast<uint8_t>( uiOffset & 0xFF );
+	*pOut++ = static_cast<uint8_t>( uiOffset >> 8 );
+
+	const size_t uiLength = uiMatchLength - MIN_MATCH;
+
+	*pToken |= static_cast<uint8_t>( std::min<size_t>( uiLength, RUN_MASK ) );
+
+	if( uiLength >= RUN_MASK && !WriteLength( pOut, pOutEnd, uiLength - RUN_MASK ) )
+		return false;
+
+	return true;
+}
+}
+
+size_t Compress( const uint8_t* pSource, const size_t uiSourceSize, uint8_t* pDest, const size_t uiDestSize )
+{
+	if( ( !pSource && uiSourceSize > 0 ) || !pDest )
+		return 0;
+
+	uint8_t* pOut = pDest;
+	const uint8_t* const pOutEnd = pDest + uiDestSize;
+
+	size_t uiAnchor = 0;
+
+	if( uiSourceSize > MF_LIMIT )
+	{
+		//Positions are stored plus one so 0 means no entry.
+		std::unique_ptr<uint32_t[]> table( new uint32_t[ 1 << HASH_LOG ]() );
+
+		const size_t uiMatchLimit = uiSourceSize - LAST_LITERALS;
+
+		for( size_t uiPos = 0; uiPos + MF_LIMIT <= uiSourceSize; )
+		{
+			const uint32_t uiValue = Read32( pSource + uiPos );
+
+			auto& uiEntry = table[ Hash( uiValue ) ];
+
+			const size_t uiCandidate = uiEntry;
+
+			uiEntry = static_cast<uint32_t>( uiPos + 1 );
+
+			if( uiCandidate == 0 || uiPos - ( uiCandidate - 1 ) > MAX_OFFSET || Read32( pSource + uiCandidate - 1 ) != uiValue )
+			{
+				++uiPos;
+				continue;
+			}
+
+			const size_t uiMatch = uiCandidate - 1;
+
+			size_t uiLength = MIN_MATCH;
+
+			while( uiPos + uiLength < uiMatchLimit && pSource[ uiMatch + uiLength ] == pSource[ uiPos + uiLength ] )
+				++uiLength;
+
+			if( !WriteSequence( pOut, pOutEnd, pSource + uiAnchor, uiPos - uiAnchor, uiPos - uiMatch, uiLength ) )
+				return 0;
+
+			uiPos += uiLength;
+			uiAnchor = uiPos;
+		}
+	}
+
+	if( !WriteSequence( pOut, pOutEnd, pSource + uiAnchor, uiSourceSize - uiAnchor, 0, 0 ) )
+		return 0;
+
+	return static_cast<size_t>( pOut - pDest );
+}
+
+bool Decompress( const uint8_t* pSource, const size_t uiSourceSize, uint8_t* pDest, const size_t uiDestSize )
+{
+	if( !pSource || ( !pDest && uiDestSize > 0 ) )
+		return false;
+
+	const uint8_t* pIn = pSource;
+	const uint8_t* const pInEnd = pSource + uiSourceSize;
+
+	uint8_t* pOut = pDest;
+	uint8_t* const pOutEnd = pDest + uiDestSize;
+
+	while( pIn < pInEnd )
+	{
+		const uint8_t token = *pIn++;
+
+		size_t uiLiteralCount = token >> 4;
+
+		if( uiLiteralCount == RUN_MASK && !ReadLength( pIn, pInEnd, uiLiteralCount ) )
+			return false;
+
+		if( static_cast<size_t>( pInEnd - pIn ) < uiLiteralCount || static_cast<size_t>( pOutEnd - pOut ) < uiLiteralCount )
+			return false;
+
+		memcpy( pOut, pIn, uiLiteralCount );
+
+		pIn += uiLiteralCount;
+		pOut += uiLiteralCount;
+
+		//The last sequence ends after its literals.
+		if( pIn == pInEnd )
+			break;
+
+		if( pInEnd - pIn < 2 )
+			return false;
+
+		const size_t uiOffset = pIn[ 0 ] | ( pIn[ 1 ] << 8 );
+
+		pIn += 2;
+
+		if( uiOffset == 0 || uiOffset > static_cast<size_t>( pOut - pDest ) )
+			return false;
+
+		size_t uiLength = token & RUN_MASK;
+
+		if( uiLength == RUN_MASK && !ReadLength( pIn, pInEnd, uiLength ) )
+			return false;
+
+		uiLength += MIN_MATCH;
+
+		if( static_cast<size_t>( pOutEnd - pOut ) < uiLength )
+			return false;
+
+		//Matches can overlap the output, so copy one byte at a time.
+		const uint8_t* pMatch = pOut - uiOffset;
+
+		for( size_t uiIndex = 0; uiIndex < uiLength; ++uiIndex )
+			pOut[ uiIndex ] = pMatch[ uiIndex ];
+
+		pOut += uiLength;
+	}
+
+	return pOut == pOutEnd;
+}
+}
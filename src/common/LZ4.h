@@ -0,0 +1,44 @@
+#ifndef COMMON_LZ4_H
+#define COMMON_LZ4_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+*	@file
+*	Compression and decompression of data in the LZ4 block format.
+*	Output is compatible with the reference implementation's LZ4_compress_default and LZ4_decompress_safe.
+*/
+
+namespace lz4
+{
+/**
+*	@return The largest size that compressing uiSize bytes can produce.
+*/
+inline size_t GetMaxCompressedSize( const size_t uiSize )
+{
+	return uiSize + ( uiSize / 255 ) + 16;
+}
+
+/**
+*	Compresses a block of data.
+*	@param pSource Data to compress.
+*	@param uiSourceSize Size of the data, in bytes.
+*	@param pDest Buffer that receives the compressed data.
+*	@param uiDestSize Size of the buffer, in bytes.
+*	@return Size of the compressed data, or 0 if it didn't fit in the buffer.
+*/
+size_t Compress( const uint8_t* pSource, const size_t uiSourceSize, uint8_t* pDest, const size_t uiDestSize );
+
+/**
+*	Decompresses a block of data. Malformed input is detected; it never reads or writes out of bounds.
+*	@param pSource Compressed data.
+*	@param uiSourceSize Size of the compressed data, in bytes.
+*	@param pDest Buffer that receives the decompressed data.
+*	@param uiDestSize Exact size of the decompressed data, in bytes.
+*	@return Whether the data was decompressed and had the expected size.
+*/
+bool Decompress( const uint8_t* pSource, const size_t uiSourceSize, uint8_t* pDest, const size_t uiDestSize );
+}
+
+#endif //COMMON_LZ4_H
@@ -1,10 +1,61 @@
 #include <cstdarg>
 #include <cstdio>
+#include <cstring>
 
 #include <SDL2/SDL.h>
 
+#include "CAsyncLogger.h"
+#include "ILogSink.h"
+
 #include "Logging.h"
 
+namespace
+{
+/**
+*	Sink that captures what this thread logs, if any.
+*/
+thread_local ILogSink* g_pCaptureSink = nullptr;
+
+CAsyncLogger& GetLogger()
+{
+	static CAsyncLogger logger;
+
+	return logger;
+}
+
+void WriteBinaryLogOutput( const char* pszText, size_t uiLength )
+{
+	GetLogger().Write( pszText, uiLength );
+}
+
+/**
+*	Formats a message and queues it. Only formatting happens on the calling thread.
+*/
+void LogV( const char* const pszPrefix, const char* const pszFormat, va_list list )
+{
+	char szBuffer[ CAsyncLogger::MAX_MESSAGE_SIZE ];
+
+	const size_t uiPrefixLength = strlen( pszPrefix );
+
+	memcpy( szBuffer, pszPrefix, uiPrefixLength );
+
+	const int iResult = vsnprintf( szBuffer + uiPrefixLength, sizeof( szBuffer ) - uiPrefixLength, pszFormat, list );
+
+	if( iResult < 0 )
+		return;
+
+	size_t uiLength = uiPrefixLength + static_cast<size_t>( iResult );
+
+	if( uiLength >= sizeof( szBuffer ) )
+		uiLength = sizeof( szBuffer ) - 1;
+
+	GetLogger().Write( szBuffer, uiLength );
+
+	if( g_pCaptureSink )
+		g_pCaptureSink->Write( szBuffer, uiLength );
+}
+}
+
 void UTIL_ShowMessageBox( const char* const pszMessage, const char* const pszCaption, const LogType logType )
 {
 	Uint32 type;
@@ -17,37 +68,78 @@ void UTIL_ShowMessageBox( const char* const pszMessage, const char* const pszCap
 	case LogType::ERROR:	type = SDL_MESSAGEBOX_ERROR; break;
 	}
 
+	//Get messages leading up to this onto the console first.
+	Log_Flush();
+
 	SDL_ShowSimpleMessageBox( type, pszCaption, pszMessage, nullptr );
 }
 
 void Msg( const char* const pszFormat, ... )
 {
-	char szBuffer[ 4096 ];
-
 	va_list list;
 
 	va_start( list, pszFormat );
 
-	const int iResult = vsnprintf( szBuffer, sizeof( szBuffer ), pszFormat, list );
+	LogV( "", pszFormat, list );
 
 	va_end( list );
-
-	//Log to stdout for now. - Solokiller
-	printf( "%s", szBuffer );
 }
 
 void Warning( const char* const pszFormat, ... )
 {
-	char szBuffer[ 4096 ];
-
 	va_list list;
 
 	va_start( list, pszFormat );
 
-	const int iResult = vsnprintf( szBuffer, sizeof( szBuffer ), pszFormat, list );
+	LogV( "Warning: ", pszFormat, list );
 
 	va_end( list );
+}
+
+LogFormatID_t Log_RegisterFormat( const char* const pszFormat )
+{
+	return Log_GetBinaryLog().RegisterFormat( pszFormat );
+}
+
+CBinaryLog& Log_GetBinaryLog()
+{
+	//Construct the text log first, so it's destroyed after this.
+	GetLogger();
+
+	static CBinaryLog log( &WriteBinaryLogOutput );
 
-	//Log to stdout for now. - Solokiller
-	printf( "Warning: %s", szBuffer );
+	return log;
+}
+
+void Log_AddSink( ILogSink* pSink )
+{
+	GetLogger().AddSink( pSink );
+}
+
+void Log_RemoveSink( ILogSink* pSink )
+{
+	GetLogger().RemoveSink( pSink );
+}
+
+void Log_BeginCapture( ILogSink* pSink )
+{
+	g_pCaptureSink = pSink;
+}
+
+void Log_EndCapture()
+{
+	g_pCaptureSink = nullptr;
+}
+
+void Log_Flush()
+{
+	Log_GetBinaryLog().Flush();
+	GetLogger().Flush();
+}
+
+void Log_Shutdown()
+{
+	//Binary messages are written to the text log, so stop this first.
+	Log_GetBinaryLog().Shutdown();
+	GetLogger().Shutdown();
 }
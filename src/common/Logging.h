@@ -1,8 +1,12 @@
 #ifndef COMMON_LOGGING_H
 #define COMMON_LOGGING_H
 
+#include "CBinaryLog.h"
+
 #undef ERROR
 
+class ILogSink;
+
 enum class LogType
 {
 	INFO = 0,
@@ -12,8 +16,69 @@ enum class LogType
 
 void UTIL_ShowMessageBox( const char* const pszMessage, const char* const pszCaption = "Message", const LogType logType = LogType::INFO );
 
+/**
+*	Logs a message. The message is written to stdout on a background thread, so this never blocks on the console.
+*/
 void Msg( const char* const pszFormat, ... );
 
+/**
+*	Logs a warning. The warning is written to stdout on a background thread, so this never blocks on the console.
+*/
 void Warning( const char* const pszFormat, ... );
 
+/**
+*	Registers a format string for LOG_BINARY.
+*/
+LogFormatID_t Log_RegisterFormat( const char* const pszFormat );
+
+/**
+*	@return The binary log used by LOG_BINARY.
+*/
+CBinaryLog& Log_GetBinaryLog();
+
+/**
+*	Logs a message as its format string ID and raw arguments, for messages logged at high rates.
+*	The message is formatted on a background thread. The format string must be a string literal.
+*/
+#define LOG_BINARY( pszFormat, ... )											\
+do																				\
+{																				\
+	static const LogFormatID_t s_LogFormatID = Log_RegisterFormat( pszFormat );	\
+	Log_GetBinaryLog().Record( s_LogFormatID, ##__VA_ARGS__ );					\
+}																				\
+while( false )
+
+/**
+*	Adds a sink that receives all text logged from now on, on the logging thread.
+*/
+void Log_AddSink( ILogSink* pSink );
+
+/**
+*	Flushes and removes a sink. Once this returns, the sink can be destroyed.
+*/
+void Log_RemoveSink( ILogSink* pSink );
+
+/**
+*	Also sends text that Msg and Warning log on the calling thread to a sink, until Log_EndCapture is called.
+*	The sink is called right away on the calling thread, so it gets exactly the output of the code that runs in between.
+*	Used to collect the output of a command. Captures don't nest, starting one replaces the previous one. LOG_BINARY messages aren't captured.
+*/
+void Log_BeginCapture( ILogSink* pSink );
+
+/**
+*	Stops the capture on the calling thread.
+*/
+void Log_EndCapture();
+
+/**
+*	Waits until all messages logged so far have been written.
+*/
+void Log_Flush();
+
+/**
+*	Writes all logged messages and stops the logging threads. Messages logged after this are written immediately.
+*	Must be called before the library that logs is unloaded.
+*/
+void Log_Shutdown();
+
 #endif //COMMON_LOGGING_H
@@ -0,0 +1,214 @@
+#include <algorithm>
+#include <cassert>
+#include <new>
+
+#include "MemoryResource.h"
+
+const size_t CMonotonicResource::DEFAULT_BLOCK_SIZE;
+const size_t CMonotonicResource::MAX_BLOCK_SIZE;
+
+CMonotonicResource::CMonotonicResource( const MemoryTag tag, const size_t uiBlockSize )
+	: m_Tag( tag )
+	, m_uiNextBlockSize( std::max<size_t>( uiBlockSize, alignof( std::max_align_t ) ) )
+{
+}
+
+CMonotonicResource::~CMonotonicResource()
+{
+	Release();
+}
+
+void* CMonotonicResource::Allocate( const size_t uiSize, const size_t uiAlignment )
+{
+	assert( uiAlignment > 0 && ( uiAlignment & ( uiAlignment - 1 ) ) == 0 );
+	assert( uiAlignment <= alignof( std::max_align_t ) );
+
+	//Zero sized allocations still get a unique address.
+	const size_t uiAllocSize = std::max<size_t>( uiSize, 1 );
+
+	if( m_pCurrent )
+	{
+		const uintptr_t current = reinterpret_cast<uintptr_t>( m_pCurrent );
+		const size_t uiPadding = ( ( current + uiAlignment - 1 ) & ~( uiAlignment - 1 ) ) - current;
+
+		if( uiPadding <= static_cast<size_t>( m_pEnd - m_pCurrent ) && uiAllocSize <= static_cast<size_t>( m_pEnd - m_pCurrent ) - uiPadding )
+		{
+			uint8_t* pMemory = m_pCurrent + uiPadding;
+
+			m_pCurrent = pMemory + uiAllocSize;
+
+			return pMemory;
+		}
+	}
+
+	//Blocks are aligned to max_align_t, so the start of a new one is always aligned.
+	if( uiAllocSize > m_uiNextBlockSize )
+	{
+		//Too large for the block that would come next, give it its own and keep using the current one.
+		return AllocateBlock( uiAllocSize );
+	}
+
+	const size_t uiBlockSize = m_uiNextBlockSize;
+
+	m_uiNextBlockSize = std::min( m_uiNextBlockSize * 2, std::max( MAX_BLOCK_SIZE, uiBlockSize ) );
+
+	m_pCurrent = AllocateBlock( uiBlockSize );
+	m_pEnd = m_pCurrent + uiBlockSize;
+
+	uint8_t* pMemory = m_pCurrent;
+
+	m_pCurrent += uiAllocSize;
+
+	return pMemory;
+}
+
+void CMonotonicResource::Release()
+{
+	for( const auto& block : m_Blocks )
+	{
+		Mem_RecordFree( m_Tag, block.uiSize );
+
+		::operator delete( block.pData );
+	}
+
+	m_Blocks.clear();
+
+	m_pCurrent = nullptr;
+	m_pEnd = nullptr;
+
+	m_uiReservedBytes = 0;
+}
+
+uint8_t* CMonotonicResource::AllocateBlock( const size_t uiSize )
+{
+	//Reserve first, so the block isn't leaked if that throws.
+	m_Blocks.reserve( m_Blocks.size() + 1 );
+
+	auto pData = static_cast<uint8_t*>( ::operator new( uiSize ) );
+
+	m_Blocks.push_back( { pData, uiSize } );
+
+	m_uiReservedBytes += uiSize;
+
+	Mem_RecordAlloc( m_Tag, uiSize );
+
+	return pData;
+}
+
+const size_t CPoolResource::MIN_POOLED_SIZE;
+const size_t CPoolResource::MAX_POOLED_SIZE;
+const size_t CPoolResource::NUM_SIZE_CLASSES;
+const size_t CPoolResource::CHUNK_SIZE;
+
+static_assert( CPoolResource::MIN_POOLED_SIZE << ( CPoolResource::NUM_SIZE_CLASSES - 1 ) == CPoolResource::MAX_POOLED_SIZE,
+			   "CPoolResource: size classes must go from MIN_POOLED_SIZE to MAX_POOLED_SIZE" );
+static_assert( CPoolResource::MIN_POOLED_SIZE % alignof( std::max_align_t ) == 0, "CPoolResource: pooled allocations must be aligned to max_align_t" );
+
+CPoolResource::CPoolResource( const MemoryTag tag )
+	: m_Tag( tag )
+{
+}
+
+CPoolResource::~CPoolResource()
+{
+	Release();
+}
+
+void* CPoolResource::Allocate( const size_t uiSize, const size_t uiAlignment )
+{
+	assert( uiAlignment > 0 && ( uiAlignment & ( uiAlignment - 1 ) ) == 0 );
+	assert( uiAlignment <= alignof( std::max_align_t ) );
+
+	( void ) uiAlignment;
+
+	if( uiSize > MAX_POOLED_SIZE )
+	{
+		Mem_RecordAlloc( m_Tag, uiSize );
+
+		return ::operator new( uiSize );
+	}
+
+	const size_t uiClass = GetSizeClass( uiSize );
+	const size_t uiClassSize = MIN_POOLED_SIZE << uiClass;
+
+	auto& sizeClass = m_SizeClasses[ uiClass ];
+
+	if( auto pBlock = sizeClass.pFree )
+	{
+		sizeClass.pFree = pBlock->pNext;
+
+		return pBlock;
+	}
+
+	if( sizeClass.pCurrent == sizeClass.pEnd )
+	{
+		m_Chunks.reserve( m_Chunks.size() + 1 );
+
+		auto pChunk = static_cast<uint8_t*>( ::operator new( CHUNK_SIZE ) );
+
+		m_Chunks.push_back( pChunk );
+
+		Mem_RecordAlloc( m_Tag, CHUNK_SIZE );
+
+		sizeClass.pCurrent = pChunk;
+		sizeClass.pEnd = pChunk + CHUNK_SIZE;
+	}
+
+	void* pMemory = sizeClass.pCurrent;
+
+	sizeClass.pCurrent += uiClassSize;
+
+	return pMemory;
+}
+
+void CPoolResource::Deallocate( void* pMemory, const size_t uiSize, const size_t )
+{
+	if( !pMemory )
+		return;
+
+	if( uiSize > MAX_POOLED_SIZE )
+	{
+		Mem_RecordFree( m_Tag, uiSize );
+
+		::operator delete( pMemory );
+		return;
+	}
+
+	auto& sizeClass = m_SizeClasses[ GetSizeClass( uiSize ) ];
+
+	auto pBlock = static_cast<FreeBlock_t*>( pMemory );
+
+	pBlock->pNext = sizeClass.pFree;
+	sizeClass.pFree = pBlock;
+}
+
+void CPoolResource::Release()
+{
+	for( auto pChunk : m_Chunks )
+	{
+		Mem_RecordFree( m_Tag, CHUNK_SIZE );
+
+		::operator delete( pChunk );
+	}
+
+	m_Chunks.clear();
+
+	for( auto& sizeClass : m_SizeClasses )
+	{
+		sizeClass = SizeClass_t();
+	}
+}
+
+size_t CPoolResource::GetSizeClass( const size_t uiSize )
+{
+	assert( uiSize <= MAX_POOLED_SIZE );
+
+	size_t uiClass = 0;
+
+	for( size_t uiClassSize = MIN_POOLED_SIZE; uiClassSize < uiSize; uiClassSize <<= 1 )
+	{
+		++uiClass;
+	}
+
+	return uiClass;
+}
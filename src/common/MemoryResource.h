@@ -0,0 +1,173 @@
+#ifndef COMMON_MEMORYRESOURCE_H
+#define COMMON_MEMORYRESOURCE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MemoryTracking.h"
+
+/**
+*	@file
+*	Memory resources that containers can allocate from. Containers opt in by constructing their CTrackedAllocator with one.
+*	Resources count the memory they get from the heap towards their tag, so the tagged stats show what a subsystem really holds,
+*	and how many heap allocations it makes, whether its containers use a resource or not.
+*	Alignments larger than alignof( std::max_align_t ) aren't supported.
+*/
+
+/**
+*	Resource for data that is built once and freed all at once, such as directories built while mounting.
+*	Allocations are carved from blocks that grow geometrically; nothing is freed until Release is called or the resource is destroyed.
+*	Memory that containers free, including the old storage of vectors that grew, is not reused, so containers should reserve up front.
+*	Not thread safe.
+*/
+class CMonotonicResource final : public IMemoryResource
+{
+public:
+	/**
+	*	Size of the first block.
+	*/
+	static const size_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+	/**
+	*	Blocks don't grow beyond this size. Larger allocations get a block of their own.
+	*/
+	static const size_t MAX_BLOCK_SIZE = 4 * 1024 * 1024;
+
+public:
+	/**
+	*	@param tag Tag that the blocks count towards.
+	*	@param uiBlockSize Size of the first block.
+	*/
+	explicit CMonotonicResource( const MemoryTag tag, const size_t uiBlockSize = DEFAULT_BLOCK_SIZE );
+	~CMonotonicResource();
+
+	void* Allocate( const size_t uiSize, const size_t uiAlignment ) override;
+
+	/**
+	*	Does nothing, memory is freed by Release.
+	*/
+	void Deallocate( void*, const size_t, const size_t ) override {}
+
+	/**
+	*	Frees all blocks. Memory allocated from the resource must no longer be used.
+	*/
+	void Release();
+
+	/**
+	*	@return Total size of the blocks, in bytes.
+	*/
+	size_t GetReservedBytes() const { return m_uiReservedBytes; }
+
+private:
+	struct Block_t
+	{
+		uint8_t* pData;
+		size_t uiSize;
+	};
+
+	uint8_t* AllocateBlock( const size_t uiSize );
+
+private:
+	const MemoryTag m_Tag;
+
+	size_t m_uiNextBlockSize;
+
+	std::vector<Block_t> m_Blocks;
+
+	uint8_t* m_pCurrent = nullptr;
+	uint8_t* m_pEnd = nullptr;
+
+	size_t m_uiReservedBytes = 0;
+
+private:
+	CMonotonicResource( const CMonotonicResource& ) = delete;
+	CMonotonicResource& operator=( const CMonotonicResource& ) = delete;
+};
+
+/**
+*	Resource for containers that allocate and free often, such as node based containers and small buffers that come and go.
+*	Small allocations are rounded up to a size class, and freed memory is kept on a free list per class for the next allocation of that class.
+*	The memory of each class is carved from chunks that are only freed by Release or when the resource is destroyed.
+*	Allocations larger than MAX_POOLED_SIZE come straight from the heap.
+*	Not thread safe.
+*/
+class CPoolResource final : public IMemoryResource
+{
+public:
+	/**
+	*	Smallest size class. Also the alignment of every pooled allocation.
+	*/
+	static const size_t MIN_POOLED_SIZE = 16;
+
+	/**
+	*	Largest size class.
+	*/
+	static const size_t MAX_POOLED_SIZE = 1024;
+
+	/**
+	*	Number of size classes, in powers of 2 from MIN_POOLED_SIZE to MAX_POOLED_SIZE.
+	*/
+	static const size_t NUM_SIZE_CLASSES = 7;
+
+	/**
+	*	Size of the chunks that size classes are carved from.
+	*/
+	static const size_t CHUNK_SIZE = 64 * 1024;
+
+public:
+	/**
+	*	@param tag Tag that the chunks and large allocations count towards.
+	*/
+	explicit CPoolResource( const MemoryTag tag );
+	~CPoolResource();
+
+	void* Allocate( const size_t uiSize, const size_t uiAlignment ) override;
+
+	void Deallocate( void* pMemory, const size_t uiSize, const size_t uiAlignment ) override;
+
+	/**
+	*	Frees all chunks. Memory allocated from the resource must no longer be used. Large allocations must have been freed already.
+	*/
+	void Release();
+
+	/**
+	*	@return Total size of the chunks, in bytes.
+	*/
+	size_t GetReservedBytes() const { return m_Chunks.size() * CHUNK_SIZE; }
+
+private:
+	struct FreeBlock_t
+	{
+		FreeBlock_t* pNext;
+	};
+
+	struct SizeClass_t
+	{
+		FreeBlock_t* pFree = nullptr;
+
+		/**
+		*	Part of the newest chunk that hasn't been handed out yet.
+		*/
+		uint8_t* pCurrent = nullptr;
+		uint8_t* pEnd = nullptr;
+	};
+
+	/**
+	*	@return Index of the size class that holds allocations of the given size. Must be no larger than MAX_POOLED_SIZE.
+	*/
+	static size_t GetSizeClass( const size_t uiSize );
+
+private:
+	const MemoryTag m_Tag;
+
+	SizeClass_t m_SizeClasses[ NUM_SIZE_CLASSES ];
+
+	std::vector<uint8_t*> m_Chunks;
+
+private:
+	CPoolResource( const CPoolResource& ) = delete;
+	CPoolResource& operator=( const CPoolResource& ) = delete;
+};
+
+#endif //COMMON_MEMORYRESOURCE_H
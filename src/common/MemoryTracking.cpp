@@ -0,0 +1,98 @@
+#include <cassert>
+
+#include "MemoryTracking.h"
+
+std::atomic<bool> g_bMemTrackingEnabled{ false };
+
+namespace
+{
+/**
+*	Counters for a tag, on their own cache line so tags that are allocated from on different threads don't contend.
+*/
+struct alignas( 64 ) TagCounters_t
+{
+	std::atomic<int64_t> iLiveBytes{ 0 };
+	std::atomic<int64_t> iPeakBytes{ 0 };
+	std::atomic<uint64_t> uiAllocations{ 0 };
+	std::atomic<uint64_t> uiAllocatedBytes{ 0 };
+};
+
+TagCounters_t g_TagCounters[ NUM_MEMORY_TAGS ];
+
+const char* const g_pszTagNames[ NUM_MEMORY_TAGS ] =
+{
+	"general",
+	"filesystem",
+	"render",
+	"vgui",
+	"console",
+	"network",
+	"steam"
+};
+
+TagCounters_t& GetCounters( const MemoryTag tag )
+{
+	assert( tag < MemoryTag::COUNT );
+
+	return g_TagCounters[ static_cast<size_t>( tag ) ];
+}
+}
+
+void Mem_EnableTracking()
+{
+	g_bMemTrackingEnabled.store( true, std::memory_order_relaxed );
+}
+
+void Mem_RecordAllocTracked( const MemoryTag tag, const size_t uiBytes )
+{
+	auto& counters = GetCounters( tag );
+
+	const int64_t iLive = counters.iLiveBytes.fetch_add( static_cast<int64_t>( uiBytes ), std::memory_order_relaxed ) + static_cast<int64_t>( uiBytes );
+
+	counters.uiAllocations.fetch_add( 1, std::memory_order_relaxed );
+	counters.uiAllocatedBytes.fetch_add( uiBytes, std::memory_order_relaxed );
+
+	int64_t iPeak = counters.iPeakBytes.load( std::memory_order_relaxed );
+
+	while( iLive > iPeak && !counters.iPeakBytes.compare_exchange_weak( iPeak, iLive, std::memory_order_relaxed ) )
+	{
+	}
+}
+
+void Mem_RecordFreeTracked( const MemoryTag tag, const size_t uiBytes )
+{
+	GetCounters( tag ).iLiveBytes.fetch_sub( static_cast<int64_t>( uiBytes ), std::memory_order_relaxed );
+}
+
+const char* Mem_GetTagName( const MemoryTag tag )
+{
+	if( tag >= MemoryTag::COUNT )
+		return "unknown";
+
+	return g_pszTagNames[ static_cast<size_t>( tag ) ];
+}
+
+size_t Mem_GetStats( MemoryTagStats_t* pStats, const size_t uiMaxCount )
+{
+	for( size_t uiTag = 0; uiTag < NUM_MEMORY_TAGS && uiTag < uiMaxCount; ++uiTag )
+	{
+		const auto& counters = g_TagCounters[ uiTag ];
+
+		auto& stats = pStats[ uiTag ];
+
+		stats.iLiveBytes = counters.iLiveBytes.load( std::memory_order_relaxed );
+		stats.iPeakBytes = counters.iPeakBytes.load( std::memory_order_relaxed );
+		stats.uiAllocations = counters.uiAllocations.load( std::memory_order_relaxed );
+		stats.uiAllocatedBytes = counters.uiAllocatedBytes.load( std::memory_order_relaxed );
+	}
+
+	return NUM_MEMORY_TAGS;
+}
+
+void Mem_ResetPeaks()
+{
+	for( auto& counters : g_TagCounters )
+	{
+		counters.iPeakBytes.store( counters.iLiveBytes.load( std::memory_order_relaxed ), std::memory_order_relaxed );
+	}
+}
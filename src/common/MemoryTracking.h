@@ -0,0 +1,219 @@
+#ifndef COMMON_MEMORYTRACKING_H
+#define COMMON_MEMORYTRACKING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/**
+*	@file
+*	Counts the memory held by each subsystem, by tag. Containers opt in by using CTrackedAllocator, other allocations are reported
+*	with Mem_RecordAlloc and Mem_RecordFree. Tracking is off by default, and then costs a relaxed load and a branch per allocation.
+*	Counters are kept per module, since each library has its own copy of this code. Thread safe.
+*	Containers can also allocate from a memory resource instead of the heap, like std::pmr containers. See MemoryResource.h.
+*/
+
+enum class MemoryTag
+{
+	GENERAL = 0,
+	FILESYSTEM,
+	RENDER,
+	VGUI,
+	CONSOLE,
+	NETWORK,
+	STEAM,
+
+	COUNT
+};
+
+const size_t NUM_MEMORY_TAGS = static_cast<size_t>( MemoryTag::COUNT );
+
+struct MemoryTagStats_t
+{
+	/**
+	*	Bytes that are allocated now.
+	*/
+	int64_t iLiveBytes;
+
+	/**
+	*	Most bytes that were allocated at once since the peaks were last reset.
+	*/
+	int64_t iPeakBytes;
+
+	/**
+	*	Number of allocations and bytes allocated since tracking was enabled. Sample twice to get the allocation rate.
+	*/
+	uint64_t uiAllocations;
+	uint64_t uiAllocatedBytes;
+};
+
+/**
+*	Set by Mem_EnableTracking. Only read through Mem_IsTrackingEnabled.
+*/
+extern std::atomic<bool> g_bMemTrackingEnabled;
+
+/**
+*	Enables tracking in this module. Can't be disabled again.
+*	Should be called before the tracked subsystems allocate anything: memory allocated before isn't counted,
+*	so freeing it afterwards makes the live counts too low.
+*/
+void Mem_EnableTracking();
+
+inline bool Mem_IsTrackingEnabled()
+{
+	return g_bMemTrackingEnabled.load( std::memory_order_relaxed );
+}
+
+void Mem_RecordAllocTracked( const MemoryTag tag, const size_t uiBytes );
+void Mem_RecordFreeTracked( const MemoryTag tag, const size_t uiBytes );
+
+/**
+*	Records an allocation of uiBytes bytes. Does nothing if tracking is disabled.
+*/
+inline void Mem_RecordAlloc( const MemoryTag tag, const size_t uiBytes )
+{
+	if( Mem_IsTrackingEnabled() )
+		Mem_RecordAllocTracked( tag, uiBytes );
+}
+
+/**
+*	Records that uiBytes bytes were freed. Does nothing if tracking is disabled.
+*/
+inline void Mem_RecordFree( const MemoryTag tag, const size_t uiBytes )
+{
+	if( Mem_IsTrackingEnabled() )
+		Mem_RecordFreeTracked( tag, uiBytes );
+}
+
+const char* Mem_GetTagName( const MemoryTag tag );
+
+/**
+*	Gets the counters for every tag, in tag order.
+*	@param[ out ] pStats Array that receives the counters. May be null if uiMaxCount is 0.
+*	@return NUM_MEMORY_TAGS.
+*/
+size_t Mem_GetStats( MemoryTagStats_t* pStats, const size_t uiMaxCount );
+
+/**
+*	Resets the peaks to the current live counts.
+*/
+void Mem_ResetPeaks();
+
+/**
+*	Source of memory for containers, like std::pmr::memory_resource.
+*	Resources count the memory they get from the heap towards a tag themselves.
+*/
+class IMemoryResource
+{
+public:
+	virtual ~IMemoryResource() = default;
+
+	/**
+	*	Allocates memory. Never returns null.
+	*	@param uiAlignment Alignment of the memory. Must be a power of 2, no larger than alignof( std::max_align_t ).
+	*/
+	virtual void* Allocate( const size_t uiSize, const size_t uiAlignment ) = 0;
+
+	/**
+	*	Frees memory allocated by this resource. The size and alignment must be the ones it was allocated with.
+	*/
+	virtual void Deallocate( void* pMemory, const size_t uiSize, const size_t uiAlignment ) = 0;
+};
+
+/**
+*	Allocator for standard containers that counts their storage towards a tag.
+*	If it is given a memory resource, storage comes from the resource instead of the heap, and the resource does the counting.
+*	Like std::pmr::polymorphic_allocator, copies of a container use the heap, but unlike it, moving or swapping a container
+*	moves the resource along with the storage, so containers can be built with a resource and moved into place.
+*	The resource must outlive the containers using it.
+*/
+template<typename T, MemoryTag TAG>
+class CTrackedAllocator
+{
+public:
+	using value_type = T;
+
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	template<typename U>
+	struct rebind
+	{
+		using other = CTrackedAllocator<U, TAG>;
+	};
+
+	template<typename U, MemoryTag OTHER_TAG>
+	friend class CTrackedAllocator;
+
+public:
+	CTrackedAllocator() = default;
+
+	/**
+	*	@param pResource Resource to allocate from, or null to use the heap.
+	*/
+	explicit CTrackedAllocator( IMemoryResource* pResource )
+		: m_pResource( pResource )
+	{
+	}
+
+	template<typename U>
+	CTrackedAllocator( const CTrackedAllocator<U, TAG>& other )
+		: m_pResource( other.m_pResource )
+	{
+	}
+
+	IMemoryResource* GetResource() const { return m_pResource; }
+
+	T* allocate( const size_t uiCount )
+	{
+		if( m_pResource )
+			return static_cast<T*>( m_pResource->Allocate( uiCount * sizeof( T ), alignof( T ) ) );
+
+		T* pMemory = std::allocator<T>().allocate( uiCount );
+
+		Mem_RecordAlloc( TAG, uiCount * sizeof( T ) );
+
+		return pMemory;
+	}
+
+	void deallocate( T* pMemory, const size_t uiCount )
+	{
+		if( m_pResource )
+		{
+			m_pResource->Deallocate( pMemory, uiCount * sizeof( T ), alignof( T ) );
+			return;
+		}
+
+		Mem_RecordFree( TAG, uiCount * sizeof( T ) );
+
+		std::allocator<T>().deallocate( pMemory, uiCount );
+	}
+
+	/**
+	*	Copies of containers use the heap, so they don't depend on the lifetime of the original's resource.
+	*/
+	CTrackedAllocator select_on_container_copy_construction() const
+	{
+		return CTrackedAllocator();
+	}
+
+	template<typename U>
+	bool operator==( const CTrackedAllocator<U, TAG>& other ) const { return m_pResource == other.m_pResource; }
+
+	template<typename U>
+	bool operator!=( const CTrackedAllocator<U, TAG>& other ) const { return m_pResource != other.m_pResource; }
+
+private:
+	IMemoryResource* m_pResource = nullptr;
+};
+
+/**
+*	Vector whose storage counts towards a tag.
+*/
+template<typename T, MemoryTag TAG>
+using TrackedVector_t = std::vector<T, CTrackedAllocator<T, TAG>>;
+
+#endif //COMMON_MEMORYTRACKING_H
@@ -0,0 +1,166 @@
+#ifndef COMMON_NETWORKSCHEMA_H
+#define COMMON_NETWORKSCHEMA_H
+
+#include <cstddef>
+#include <type_traits>
+
+#include "CNetworkBuffer.h"
+
+/**
+*	@file
+*	Describes the fields of a network message struct and their widths at compile time, and serializes them with the network bit writer and reader.
+*	The widths are template arguments, so all masks and shifts are folded, and the whole message is checked for overflow once.
+*	Example:
+*	struct Move_t
+*	{
+*		int iForward;
+*		unsigned int uiButtons;
+*		bool bDucking;
+*	};
+*
+*	typedef network::Schema<
+*		NETWORK_FIELD( Move_t, iForward, 12 ),
+*		NETWORK_FIELD( Move_t, uiButtons, 16 ),
+*		NETWORK_FIELD( Move_t, bDucking, 1 )
+*	> MoveSchema_t;
+*
+*	MoveSchema_t::Write( writer, move );
+*/
+
+/**
+*	Declares a field of a message struct with the given width in bits. Signed types are written as with WriteSignedBitLong.
+*/
+#define NETWORK_FIELD( structType, member, numBits ) network::Field<structType, decltype( structType::member ), &structType::member, numBits>
+
+namespace network
+{
+/**
+*	A field of a message struct. Use NETWORK_FIELD to declare fields.
+*/
+template<typename STRUCT, typename T, T STRUCT::*MEMBER, size_t NUM_BITS>
+struct Field final
+{
+	static_assert( std::is_integral<T>::value || std::is_enum<T>::value, "network::Field: only integer and enum fields can be serialized" );
+	static_assert( NUM_BITS >= 1 && NUM_BITS <= 32, "network::Field: fields are between 1 and 32 bits wide" );
+
+	typedef STRUCT Struct_t;
+
+	static const bool IS_SIGNED = std::is_signed<T>::value;
+
+	static const size_t MAX_BITS = NUM_BITS;
+
+	template<bool CHECKED>
+	static void Write( CNetworkBitWriter& writer, const STRUCT& data )
+	{
+		if( IS_SIGNED )
+		{
+			if( CHECKED )
+				writer.WriteSignedBits<NUM_BITS>( static_cast<int>( data.*MEMBER ) );
+			else
+				writer.WriteSignedBitsUnchecked<NUM_BITS>( static_cast<int>( data.*MEMBER ) );
+		}
+		else
+		{
+			if( CHECKED )
+				writer.WriteUnsignedBits<NUM_BITS>( static_cast<unsigned int>( data.*MEMBER ) );
+			else
+				writer.WriteUnsignedBitsUnchecked<NUM_BITS>( static_cast<unsigned int>( data.*MEMBER ) );
+		}
+	}
+
+	template<bool CHECKED>
+	static void Read( CNetworkBitReader& reader, STRUCT& data )
+	{
+		if( IS_SIGNED )
+			data.*MEMBER = static_cast<T>( CHECKED ? reader.ReadSignedBits<NUM_BITS>() : reader.ReadSignedBitsUnchecked<NUM_BITS>() );
+		else
+			data.*MEMBER = static_cast<T>( CHECKED ? reader.ReadUnsignedBits<NUM_BITS>() : reader.ReadUnsignedBitsUnchecked<NUM_BITS>() );
+	}
+};
+
+/**
+*	Sums the widths of a list of fields.
+*/
+template<typename... FIELDS>
+struct FieldBits;
+
+template<>
+struct FieldBits<>
+{
+	static const size_t VALUE = 0;
+};
+
+template<typename FIELD, typename... FIELDS>
+struct FieldBits<FIELD, FIELDS...>
+{
+	static const size_t VALUE = FIELD::MAX_BITS + FieldBits<FIELDS...>::VALUE;
+};
+
+/**
+*	A message made of the given fields, written and read in order.
+*	The bits are identical to writing each field with WriteBitLong.
+*/
+template<typename FIELD, typename... FIELDS>
+struct Schema final
+{
+	typedef typename FIELD::Struct_t Struct_t;
+
+	/**
+	*	Size of the message, in bits.
+	*/
+	static const size_t MAX_BITS = FieldBits<FIELD, FIELDS...>::VALUE;
+
+	/**
+	*	Size of the message, in bytes, rounded up.
+	*/
+	static const size_t MAX_BYTES = ( MAX_BITS + 7 ) >> 3;
+
+	/**
+	*	Writes a message. If it doesn't fit, the fields that fit are written, and the writer overflows.
+	*	@return Whether the message was written without overflowing.
+	*/
+	static bool Write( CNetworkBitWriter& writer, const Struct_t& data )
+	{
+		typedef int Expand_t[];
+
+		if( writer.CanWrite( MAX_BITS ) )
+		{
+			( void ) Expand_t{ ( FIELD::template Write<false>( writer, data ), 0 ), ( FIELDS::template Write<false>( writer, data ), 0 )... };
+		}
+		else
+		{
+			( void ) Expand_t{ ( FIELD::template Write<true>( writer, data ), 0 ), ( FIELDS::template Write<true>( writer, data ), 0 )... };
+		}
+
+		return !writer.HasOverflowed();
+	}
+
+	/**
+	*	Reads a message. If it doesn't fit, the fields that fit are read, and the rest act like CNetworkBitReader reads past the end.
+	*	@return Whether the message was read without overflowing.
+	*/
+	static bool Read( CNetworkBitReader& reader, Struct_t& data )
+	{
+		typedef int Expand_t[];
+
+		if( reader.CanRead( MAX_BITS ) )
+		{
+			( void ) Expand_t{ ( FIELD::template Read<false>( reader, data ), 0 ), ( FIELDS::template Read<false>( reader, data ), 0 )... };
+		}
+		else
+		{
+			( void ) Expand_t{ ( FIELD::template Read<true>( reader, data ), 0 ), ( FIELDS::template Read<true>( reader, data ), 0 )... };
+		}
+
+		return !reader.HasOverflowed();
+	}
+};
+
+template<typename FIELD, typename... FIELDS>
+const size_t Schema<FIELD, FIELDS...>::MAX_BITS;
+
+template<typename FIELD, typename... FIELDS>
+const size_t Schema<FIELD, FIELDS...>::MAX_BYTES;
+}
+
+#endif //COMMON_NETWORKSCHEMA_H
@@ -0,0 +1,168 @@
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+#include "NetworkStats.h"
+
+std::atomic<bool> g_bNetStatsEnabled{ false };
+
+namespace
+{
+int64_t GetTimeNS()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+std::atomic<const char*> g_pszTypeNames[ NUM_NET_MESSAGE_TYPES ] = {};
+
+/**
+*	Registered clients. Created on first use, since clients may be created during static initialization.
+*/
+struct ClientRegistry_t
+{
+	std::mutex mutex;
+
+	std::vector<CNetworkStats*> clients;
+};
+
+ClientRegistry_t& GetClientRegistry()
+{
+	static ClientRegistry_t registry;
+
+	return registry;
+}
+}
+
+CNetworkStats::CNetworkStats( const char* pszName )
+	: m_pszName( pszName )
+	, m_iResetTime( GetTimeNS() )
+{
+	//Make sure the registry is constructed first, so it's destroyed after static counters unregister themselves.
+	GetClientRegistry();
+}
+
+CNetworkStats::~CNetworkStats()
+{
+	NetStats_RemoveClient( this );
+}
+
+void CNetworkStats::Record( const NetMessageType_t type, const uint64_t uiBits, const uint64_t uiEncodeNS )
+{
+	auto& counters = m_Counters[ type ];
+
+	counters.uiCount.fetch_add( 1, std::memory_order_relaxed );
+	counters.uiBits.fetch_add( uiBits, std::memory_order_relaxed );
+	counters.uiEncodeNS.fetch_add( uiEncodeNS, std::memory_order_relaxed );
+}
+
+size_t CNetworkStats::GetStats( NetMessageStats_t* pStats, const size_t uiMaxCount ) const
+{
+	for( size_t uiType = 0; uiType < NUM_NET_MESSAGE_TYPES && uiType < uiMaxCount; ++uiType )
+	{
+		const auto& counters = m_Counters[ uiType ];
+
+		auto& stats = pStats[ uiType ];
+
+		stats.uiCount = counters.uiCount.load( std::memory_order_relaxed );
+		stats.uiBits = counters.uiBits.load( std::memory_order_relaxed );
+		stats.uiEncodeNS = counters.uiEncodeNS.load( std::memory_order_relaxed );
+	}
+
+	return NUM_NET_MESSAGE_TYPES;
+}
+
+double CNetworkStats::GetSeconds() const
+{
+	return ( GetTimeNS() - m_iResetTime.load( std::memory_order_relaxed ) ) / 1e9;
+}
+
+void CNetworkStats::Reset()
+{
+	for( auto& counters : m_Counters )
+	{
+		counters.uiCount.store( 0, std::memory_order_relaxed );
+		counters.uiBits.store( 0, std::memory_order_relaxed );
+		counters.uiEncodeNS.store( 0, std::memory_order_relaxed );
+	}
+
+	m_iResetTime.store( GetTimeNS(), std::memory_order_relaxed );
+}
+
+void NetStats_Enable( const bool bEnable )
+{
+	g_bNetStatsEnabled.store( bEnable, std::memory_order_relaxed );
+}
+
+void NetStats_RegisterType( const NetMessageType_t type, const char* pszName )
+{
+	g_pszTypeNames[ type ].store( pszName, std::memory_order_relaxed );
+}
+
+const char* NetStats_GetTypeName( const NetMessageType_t type )
+{
+	return g_pszTypeNames[ type ].load( std::memory_order_relaxed );
+}
+
+CNetworkStats& NetStats_GetGlobal()
+{
+	static CNetworkStats stats( "global" );
+
+	return stats;
+}
+
+void NetStats_AddClient( CNetworkStats* pStats )
+{
+	auto& registry = GetClientRegistry();
+
+	std::lock_guard<std::mutex> lock( registry.mutex );
+
+	if( std::find( registry.clients.begin(), registry.clients.end(), pStats ) == registry.clients.end() )
+		registry.clients.push_back( pStats );
+}
+
+void NetStats_RemoveClient( CNetworkStats* pStats )
+{
+	auto& registry = GetClientRegistry();
+
+	std::lock_guard<std::mutex> lock( registry.mutex );
+
+	registry.clients.erase( std::remove( registry.clients.begin(), registry.clients.end(), pStats ), registry.clients.end() );
+}
+
+void NetStats_ForEachClient( void ( *pfnCallback )( const CNetworkStats& stats, void* pContext ), void* pContext )
+{
+	auto& registry = GetClientRegistry();
+
+	std::lock_guard<std::mutex> lock( registry.mutex );
+
+	for( auto pStats : registry.clients )
+		pfnCallback( *pStats, pContext );
+}
+
+void NetStats_ResetAll()
+{
+	NetStats_GetGlobal().Reset();
+
+	auto& registry = GetClientRegistry();
+
+	std::lock_guard<std::mutex> lock( registry.mutex );
+
+	for( auto pStats : registry.clients )
+		pStats->Reset();
+}
+
+void CNetMessageScope::Record()
+{
+	const uint64_t uiEncodeNS = static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - m_StartTime ).count() );
+
+	//Overflowed messages are never sent.
+	if( m_pBuffer->HasOverflowed() )
+		return;
+
+	const uint64_t uiBits = m_pBuffer->GetBitsInBuffer() - m_uiStartBit;
+
+	NetStats_GetGlobal().Record( m_Type, uiBits, uiEncodeNS );
+
+	if( auto pStats = m_pBuffer->GetStats() )
+		pStats->Record( m_Type, uiBits, uiEncodeNS );
+}
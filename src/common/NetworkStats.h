@@ -0,0 +1,184 @@
+#ifndef COMMON_NETWORKSTATS_H
+#define COMMON_NETWORKSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include "CNetworkBuffer.h"
+
+/**
+*	@file
+*	Attributes the bits written to network buffers, and the time spent writing them, to message types.
+*	Messages are tagged by writing them inside a CNetMessageScope. Each message counts towards the global counters,
+*	and towards the counters of its buffer, if the buffer was given any with CNetworkBuffer::SetStats, like a client's.
+*	Off by default, and then a scope costs a relaxed load and a branch. Counters are kept per module, since each library has its own copy of this code. Thread safe.
+*/
+
+/**
+*	Identifies a type of message. Usually the byte that a message starts with.
+*/
+using NetMessageType_t = uint8_t;
+
+const size_t NUM_NET_MESSAGE_TYPES = 256;
+
+struct NetMessageStats_t
+{
+	/**
+	*	Number of messages written.
+	*/
+	uint64_t uiCount;
+
+	uint64_t uiBits;
+
+	/**
+	*	Time spent writing the messages, in nanoseconds.
+	*/
+	uint64_t uiEncodeNS;
+};
+
+/**
+*	Per message type counters, for one client or for everything.
+*/
+class CNetworkStats final
+{
+public:
+	/**
+	*	@param pszName Name shown in the statistics. Must point to a string that outlives the counters.
+	*/
+	CNetworkStats( const char* pszName );
+
+	/**
+	*	Unregisters the counters, if they were registered.
+	*/
+	~CNetworkStats();
+
+	const char* GetName() const { return m_pszName; }
+
+	void Record( const NetMessageType_t type, const uint64_t uiBits, const uint64_t uiEncodeNS );
+
+	/**
+	*	Gets the counters of every type, in type order.
+	*	@param[ out ] pStats Array that receives the counters. May be null if uiMaxCount is 0.
+	*	@return NUM_NET_MESSAGE_TYPES.
+	*/
+	size_t GetStats( NetMessageStats_t* pStats, const size_t uiMaxCount ) const;
+
+	/**
+	*	@return Seconds since the counters were created or last reset.
+	*/
+	double GetSeconds() const;
+
+	void Reset();
+
+private:
+	struct TypeCounters_t
+	{
+		std::atomic<uint64_t> uiCount{ 0 };
+		std::atomic<uint64_t> uiBits{ 0 };
+		std::atomic<uint64_t> uiEncodeNS{ 0 };
+	};
+
+private:
+	const char* const m_pszName;
+
+	TypeCounters_t m_Counters[ NUM_NET_MESSAGE_TYPES ];
+
+	std::atomic<int64_t> m_iResetTime;
+
+private:
+	CNetworkStats( const CNetworkStats& ) = delete;
+	CNetworkStats& operator=( const CNetworkStats& ) = delete;
+};
+
+/**
+*	Set by NetStats_Enable. Only read through NetStats_IsEnabled.
+*/
+extern std::atomic<bool> g_bNetStatsEnabled;
+
+void NetStats_Enable( const bool bEnable );
+
+inline bool NetStats_IsEnabled()
+{
+	return g_bNetStatsEnabled.load( std::memory_order_relaxed );
+}
+
+/**
+*	Names a message type for the statistics.
+*	@param pszName Name of the type. Must point to a static string.
+*/
+void NetStats_RegisterType( const NetMessageType_t type, const char* pszName );
+
+/**
+*	@return The name of a message type, or null if it wasn't registered.
+*/
+const char* NetStats_GetTypeName( const NetMessageType_t type );
+
+/**
+*	@return The counters of all messages.
+*/
+CNetworkStats& NetStats_GetGlobal();
+
+/**
+*	Registers a client's counters, so they can be listed. The counters unregister themselves when they're destroyed.
+*/
+void NetStats_AddClient( CNetworkStats* pStats );
+
+void NetStats_RemoveClient( CNetworkStats* pStats );
+
+/**
+*	Calls a function for each registered client's counters. Clients can't be added or removed until it returns.
+*/
+void NetStats_ForEachClient( void ( *pfnCallback )( const CNetworkStats& stats, void* pContext ), void* pContext );
+
+/**
+*	Resets the global counters and those of every registered client.
+*/
+void NetStats_ResetAll();
+
+/**
+*	Tags the bits written to a buffer during its lifetime as a message of a type.
+*	Scopes must not be nested, the outer message would count the inner one's bits again.
+*/
+class CNetMessageScope final
+{
+public:
+	CNetMessageScope( CNetworkBuffer& buffer, const NetMessageType_t type )
+		: m_Type( type )
+	{
+		if( NetStats_IsEnabled() )
+		{
+			m_pBuffer = &buffer;
+			m_uiStartBit = buffer.GetBitsInBuffer();
+			m_StartTime = std::chrono::steady_clock::now();
+		}
+	}
+
+	~CNetMessageScope()
+	{
+		if( m_pBuffer )
+			Record();
+	}
+
+private:
+	void Record();
+
+private:
+	/**
+	*	Null if statistics are disabled.
+	*/
+	CNetworkBuffer* m_pBuffer = nullptr;
+
+	NetMessageType_t m_Type;
+
+	size_t m_uiStartBit = 0;
+
+	std::chrono::steady_clock::time_point m_StartTime;
+
+private:
+	CNetMessageScope( const CNetMessageScope& ) = delete;
+	CNetMessageScope& operator=( const CNetMessageScope& ) = delete;
+};
+
+#endif //COMMON_NETWORKSTATS_H
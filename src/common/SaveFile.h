@@ -0,0 +1,68 @@
+#ifndef COMMON_SAVEFILE_H
+#define COMMON_SAVEFILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+*	@file
+*	Save file structures and constants.
+*	A save is a header, followed by blocks of serialized data, followed by an empty block that marks the end.
+*	Each block is stored either as is, or compressed with LZ4 if that makes it smaller, and is checksummed with CRC-32C as stored.
+*	Everything is stored in native byte order.
+*	@see CSaveWriter
+*	@see CSaveReader
+*/
+
+namespace save
+{
+const char IDENTIFIER[ 4 ] = { 'H', 'L', 'S', 'V' };
+
+/**
+*	Version of the file format. The version of the data in it is up to whoever writes it.
+*/
+const uint32_t VERSION = 1;
+
+/**
+*	Largest block, before compression.
+*/
+const size_t BLOCK_SIZE = 256 * 1024;
+
+struct Header_t
+{
+	char identifier[ 4 ];
+	uint32_t uiVersion;
+
+	/**
+	*	Version of the data, given by the writer.
+	*/
+	uint32_t uiDataVersion;
+
+	uint32_t uiReserved;
+};
+
+/**
+*	Header of a block. Followed by its stored data.
+*/
+struct BlockHeader_t
+{
+	/**
+	*	Size of the block's data, in bytes. 0 marks the end of the save.
+	*/
+	uint32_t uiSize;
+
+	/**
+	*	Size of the data as stored. The data is compressed if this is smaller than uiSize.
+	*/
+	uint32_t uiStoredSize;
+
+	/**
+	*	CRC-32C of the data as stored.
+	*/
+	uint32_t uiChecksum;
+
+	uint32_t uiReserved;
+};
+}
+
+#endif //COMMON_SAVEFILE_H
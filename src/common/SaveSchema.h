@@ -0,0 +1,225 @@
+#ifndef COMMON_SAVESCHEMA_H
+#define COMMON_SAVESCHEMA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "CSaveReader.h"
+#include "CSaveWriter.h"
+
+/**
+*	@file
+*	Describes the fields of a struct that is saved at compile time, the same way network::Schema describes network messages.
+*	Fields that are trivially copyable, including fixed size arrays of them, are copied as they are in memory, in one copy per field.
+*	Vectors of them are stored as a count followed by one copy of the elements. Other types can be supported by specializing save::Serializer.
+*	Fields added in later versions of the data are declared with the version they were added in, and are left alone when older saves are read.
+*	Example:
+*	struct Player_t
+*	{
+*		float flOrigin[ 3 ];
+*		int iHealth;
+*		std::vector<uint8_t> ammo;
+*	};
+*
+*	typedef save::Schema<
+*		SAVE_FIELD( Player_t, flOrigin ),
+*		SAVE_FIELD( Player_t, iHealth ),
+*		SAVE_FIELD_SINCE( Player_t, ammo, 2 )
+*	> PlayerSchema_t;
+*
+*	PlayerSchema_t::Write( writer, player );
+*/
+
+/**
+*	Declares a field of a struct that is saved.
+*/
+#define SAVE_FIELD( structType, member ) save::Field<structType, decltype( structType::member ), &structType::member, 0>
+
+/**
+*	Declares a field of a struct that is saved, that was added in the given version of the data.
+*/
+#define SAVE_FIELD_SINCE( structType, member, version ) save::Field<structType, decltype( structType::member ), &structType::member, version>
+
+namespace save
+{
+/**
+*	Reads a count followed by that many trivially copyable elements into a vector or string.
+*	The container grows a block at a time as the elements are read, so a count that doesn't match the data can't make it allocate more than the save holds.
+*/
+template<typename CONTAINER>
+void ReadElements( CSaveReader& reader, CONTAINER& container )
+{
+	typedef typename CONTAINER::value_type Value_t;
+
+	uint32_t uiCount = 0;
+
+	reader.ReadValue( uiCount );
+
+	const size_t uiMaxBatch = std::max<size_t>( BLOCK_SIZE / sizeof( Value_t ), 1 );
+
+	container.clear();
+
+	while( container.size() < uiCount && !reader.HasFailed() )
+	{
+		const size_t uiRead = container.size();
+		const size_t uiBatch = std::min<size_t>( uiCount - uiRead, uiMaxBatch );
+
+		container.resize( uiRead + uiBatch );
+
+		reader.ReadArray( &container[ uiRead ], uiBatch );
+	}
+}
+
+/**
+*	Writes and reads values of a type. The default copies trivially copyable types as they are in memory.
+*/
+template<typename T, typename = void>
+struct Serializer final
+{
+	static_assert( std::is_trivially_copyable<T>::value, "save::Serializer: specialize save::Serializer for types that aren't trivially copyable" );
+
+	static void Write( CSaveWriter& writer, const T& value )
+	{
+		writer.WriteValue( value );
+	}
+
+	static void Read( CSaveReader& reader, T& value )
+	{
+		reader.ReadValue( value );
+	}
+};
+
+/**
+*	Vectors of trivially copyable types are a count followed by the elements, in one copy.
+*/
+template<typename T>
+struct Serializer<std::vector<T>, typename std::enable_if<std::is_trivially_copyable<T>::value>::type> final
+{
+	static_assert( !std::is_same<T, bool>::value, "save::Serializer: std::vector<bool> can't be saved, use a vector of uint8_t" );
+
+	static void Write( CSaveWriter& writer, const std::vector<T>& values )
+	{
+		writer.WriteValue( static_cast<uint32_t>( values.size() ) );
+
+		if( !values.empty() )
+			writer.WriteArray( values.data(), values.size() );
+	}
+
+	static void Read( CSaveReader& reader, std::vector<T>& values )
+	{
+		ReadElements( reader, values );
+	}
+};
+
+template<>
+struct Serializer<std::string> final
+{
+	static void Write( CSaveWriter& writer, const std::string& szValue )
+	{
+		writer.WriteValue( static_cast<uint32_t>( szValue.size() ) );
+
+		if( !szValue.empty() )
+			writer.Write( szValue.data(), szValue.size() );
+	}
+
+	static void Read( CSaveReader& reader, std::string& szValue )
+	{
+		ReadElements( reader, szValue );
+	}
+};
+
+/**
+*	A field of a struct that is saved. Use SAVE_FIELD or SAVE_FIELD_SINCE to declare fields.
+*/
+template<typename STRUCT, typename T, T STRUCT::*MEMBER, uint32_t VERSION>
+struct Field final
+{
+	typedef STRUCT Struct_t;
+
+	static void Write( CSaveWriter& writer, const STRUCT& data )
+	{
+		Serializer<T>::Write( writer, data.*MEMBER );
+	}
+
+	static void Read( CSaveReader& reader, STRUCT& data )
+	{
+		if( reader.GetDataVersion() >= VERSION )
+			Serializer<T>::Read( reader, data.*MEMBER );
+	}
+};
+
+/**
+*	A struct made of the given fields, written and read in order.
+*/
+template<typename FIELD, typename... FIELDS>
+struct Schema final
+{
+	typedef typename FIELD::Struct_t Struct_t;
+
+	/**
+	*	@return Whether the writer hasn't failed.
+	*/
+	static bool Write( CSaveWriter& writer, const Struct_t& data )
+	{
+		typedef int Expand_t[];
+
+		( void ) Expand_t{ ( FIELD::Write( writer, data ), 0 ), ( FIELDS::Write( writer, data ), 0 )... };
+
+		return !writer.HasFailed();
+	}
+
+	/**
+	*	@return Whether the reader hasn't failed.
+	*/
+	static bool Read( CSaveReader& reader, Struct_t& data )
+	{
+		typedef int Expand_t[];
+
+		( void ) Expand_t{ ( FIELD::Read( reader, data ), 0 ), ( FIELDS::Read( reader, data ), 0 )... };
+
+		return !reader.HasFailed();
+	}
+
+	/**
+	*	Writes an array of structs, as a count followed by each struct.
+	*/
+	static bool WriteArray( CSaveWriter& writer, const Struct_t* pData, const size_t uiCount )
+	{
+		writer.WriteValue( static_cast<uint32_t>( uiCount ) );
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			Write( writer, pData[ uiIndex ] );
+		}
+
+		return !writer.HasFailed();
+	}
+
+	/**
+	*	Reads an array of structs written with WriteArray.
+	*/
+	static bool ReadArray( CSaveReader& reader, std::vector<Struct_t>& data )
+	{
+		uint32_t uiCount = 0;
+
+		reader.ReadValue( uiCount );
+
+		data.clear();
+
+		//Grows as structs are read, like ReadElements.
+		while( data.size() < uiCount && !reader.HasFailed() )
+		{
+			data.emplace_back();
+			Read( reader, data.back() );
+		}
+
+		return !reader.HasFailed();
+	}
+};
+}
+
+#endif //COMMON_SAVESCHEMA_H
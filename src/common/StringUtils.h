@@ -2,7 +2,9 @@
 #define STDLIB_STRINGUTILS_H
 
 #include <algorithm>
+#include <cstdint>
 #include <cstring>
+#include <functional>
 
 /**
 *	Checks if a printf operation was successful
@@ -13,30 +15,98 @@ inline bool PrintfSuccess( const int iRet, const size_t uiBufferSize )
 }
 
 /**
-*	Taken from MSVC string hash.
+*	Implementation details of StringHash.
 */
-inline size_t StringHash( const char* const pszString )
+namespace stringhash
+{
+const uint32_t SEED = 0x9E3779B9U;
+
+//Contain bytes that aren't ASCII, so a word of text never cancels a key out.
+const uint32_t KEY0 = 0xA0761D65U;
+const uint32_t KEY1 = 0xE7037ED1U;
+const uint32_t KEY2 = 0x8EBC6AF1U;
+
+/**
+*	Reads 4 characters as a little endian word. Compilers turn this into a single load on little endian targets.
+*/
+constexpr uint32_t Read32( const char* const pszString )
+{
+	return
+		static_cast<uint32_t>( static_cast<uint8_t>( pszString[ 0 ] ) ) |
+		( static_cast<uint32_t>( static_cast<uint8_t>( pszString[ 1 ] ) ) << 8 ) |
+		( static_cast<uint32_t>( static_cast<uint8_t>( pszString[ 2 ] ) ) << 16 ) |
+		( static_cast<uint32_t>( static_cast<uint8_t>( pszString[ 3 ] ) ) << 24 );
+}
+
+/**
+*	Multiplies 2 words and folds the high half of the product into the low half.
+*	Uses a 32 bit multiply with a 64 bit result, which is a single instruction on 32 bit targets as well.
+*/
+constexpr uint32_t Mix( const uint32_t a, const uint32_t b )
 {
-#if defined( _WIN64 ) || ( defined( __GNUC__ ) && ( __x86_64__ || __ppc64__ ) )
-	static_assert( sizeof( size_t ) == 8, "This code is for 64-bit size_t." );
-	const size_t _FNV_offset_basis = 14695981039346656037ULL;
-	const size_t _FNV_prime = 1099511628211ULL;
-
-#else /* defined(_WIN64) */
-	static_assert( sizeof( size_t ) == 4, "This code is for 32-bit size_t." );
-	const size_t _FNV_offset_basis = 2166136261U;
-	const size_t _FNV_prime = 16777619U;
-#endif /* defined(_WIN64) */
-
-	const size_t _Count = strlen( pszString );
-
-	size_t _Val = _FNV_offset_basis;
-	for( size_t _Next = 0; _Next < _Count; ++_Next )
-	{	// fold in another byte
-		_Val ^= ( size_t ) pszString[ _Next ];
-		_Val *= _FNV_prime;
+	return static_cast<uint32_t>( static_cast<uint64_t>( a ) * b ) ^ static_cast<uint32_t>( ( static_cast<uint64_t>( a ) * b ) >> 32 );
+}
+}
+
+/**
+*	Hashes a string 8 characters at a time. Can be evaluated at compile time.
+*	The result is 32 bits on all platforms, the same for a given string everywhere.
+*	@param pszString String to hash. Doesn't have to be null terminated.
+*	@param uiLength Number of characters to hash.
+*	@see operator"" _hash
+*/
+constexpr size_t StringHash( const char* const pszString, const size_t uiLength )
+{
+	using namespace stringhash;
+
+	uint32_t uiHash = SEED ^ static_cast<uint32_t>( uiLength );
+
+	size_t uiIndex = 0;
+
+	for( ; uiIndex + 8 <= uiLength; uiIndex += 8 )
+	{
+		uiHash = Mix( Read32( pszString + uiIndex ) ^ uiHash ^ KEY0, Read32( pszString + uiIndex + 4 ) ^ KEY1 );
 	}
-	return ( _Val );
+
+	const size_t uiRemaining = uiLength - uiIndex;
+
+	uint32_t a = 0;
+	uint32_t b = 0;
+
+	if( uiRemaining >= 4 )
+	{
+		//The words overlap if fewer than 8 characters remain.
+		a = Read32( pszString + uiIndex );
+		b = Read32( pszString + uiLength - 4 );
+	}
+	else if( uiRemaining > 0 )
+	{
+		a =
+			( static_cast<uint32_t>( static_cast<uint8_t>( pszString[ uiIndex ] ) ) << 16 ) |
+			( static_cast<uint32_t>( static_cast<uint8_t>( pszString[ uiIndex + uiRemaining / 2 ] ) ) << 8 ) |
+			static_cast<uint32_t>( static_cast<uint8_t>( pszString[ uiLength - 1 ] ) );
+	}
+
+	uiHash = Mix( a ^ uiHash ^ KEY0, b ^ KEY1 );
+
+	return Mix( uiHash ^ KEY2, static_cast<uint32_t>( uiLength ) ^ KEY1 );
+}
+
+/**
+*	@copydoc StringHash( const char* const pszString, const size_t uiLength )
+*/
+inline size_t StringHash( const char* const pszString )
+{
+	return StringHash( pszString, strlen( pszString ) );
+}
+
+/**
+*	Hashes a string literal at compile time. Equal to StringHash of the same string, so it can be used for case labels and compile time keys:
+*	switch( StringHash( pszName ) ) { case "sv_gravity"_hash: ... }
+*/
+constexpr size_t operator"" _hash( const char* pszString, size_t uiLength )
+{
+	return StringHash( pszString, uiLength );
 }
 
 template<typename STR>
@@ -79,6 +149,7 @@ const char* strnrstr( const char* pszString, const char* pszSubString, const siz
 /**
 *	Checks whether a token matches a string.
 *	The token can have '*' characters to signal 0 or more characters that can span the space between given characters.
+*	Compiles the token for each call; use CWildcardPattern to match a token against many strings.
 *	@param pszString String to match against.
 *	@param pszToken Token to match.
 *	@return Whether the token matches.
@@ -0,0 +1,87 @@
+#include <cstring>
+
+#include "TextureFile.h"
+
+namespace texfile
+{
+const char IDENTIFIER[ 4 ] = { 'G', 'T', 'E', 'X' };
+
+const char* const EXTENSION = ".gtx";
+
+std::string GetTextureFileName( const char* pszImageName )
+{
+	std::string szName( pszImageName );
+
+	const auto uiDot = szName.find_last_of( "./\\" );
+
+	if( uiDot != std::string::npos && szName[ uiDot ] == '.' )
+		szName.erase( uiDot );
+
+	szName += EXTENSION;
+
+	return szName;
+}
+
+size_t GetLevelSize( const Format format, const uint32_t uiWidth, const uint32_t uiHeight )
+{
+	const size_t uiBlocks = static_cast<size_t>( ( uiWidth + 3 ) / 4 ) * ( ( uiHeight + 3 ) / 4 );
+
+	switch( format )
+	{
+	case Format::RGBA8:	return static_cast<size_t>( uiWidth ) * uiHeight * 4;
+	case Format::BC1:	return uiBlocks * 8;
+	case Format::BC3:	return uiBlocks * 16;
+
+	default: return 0;
+	}
+}
+
+bool ParseTexture( const uint8_t* pData, const size_t uiSize, TextureView_t& view )
+{
+	Header_t header;
+
+	if( uiSize < sizeof( header ) )
+		return false;
+
+	memcpy( &header, pData, sizeof( header ) );
+
+	if( memcmp( header.identifier, IDENTIFIER, sizeof( IDENTIFIER ) ) || header.version != VERSION )
+		return false;
+
+	if( header.width == 0 || header.height == 0 || header.levelcount == 0 || header.levelcount > MAX_LEVELS )
+		return false;
+
+	if( uiSize < sizeof( header ) + header.levelcount * sizeof( Level_t ) )
+		return false;
+
+	view.format = static_cast<Format>( header.format );
+	view.uiWidth = header.width;
+	view.uiHeight = header.height;
+	view.uiLevelCount = header.levelcount;
+	view.pData = pData;
+
+	memcpy( view.levels, pData + sizeof( header ), header.levelcount * sizeof( Level_t ) );
+
+	for( uint32_t uiLevel = 0; uiLevel < view.uiLevelCount; ++uiLevel )
+	{
+		const auto& level = view.levels[ uiLevel ];
+
+		//Each level is half the size of the previous one, rounded down, and at least 1.
+		const uint32_t uiWidth = ( header.width >> uiLevel ) ? ( header.width >> uiLevel ) : 1;
+		const uint32_t uiHeight = ( header.height >> uiLevel ) ? ( header.height >> uiLevel ) : 1;
+
+		if( level.width != uiWidth || level.height != uiHeight )
+			return false;
+
+		const size_t uiLevelSize = GetLevelSize( view.format, level.width, level.height );
+
+		if( uiLevelSize == 0 || level.size != uiLevelSize )
+			return false;
+
+		if( level.offset > uiSize || uiSize - level.offset < level.size )
+			return false;
+	}
+
+	return true;
+}
+}
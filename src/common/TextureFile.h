@@ -0,0 +1,108 @@
+#ifndef COMMON_TEXTUREFILE_H
+#define COMMON_TEXTUREFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+*	@file
+*	Precompiled texture files. These store an image the way it's uploaded, so loading one needs no decoding.
+*	The header is followed by levelcount Level_t entries, largest first, and then the data of each level.
+*	RGBA8 data is tightly packed rows, top down. BC1 and BC3 data is 4x4 blocks, rows of blocks top down.
+*	All values are little endian.
+*/
+
+namespace texfile
+{
+enum class Format : uint32_t
+{
+	RGBA8	= 0,
+	BC1		= 1,
+	BC3		= 2
+};
+
+extern const char IDENTIFIER[ 4 ];
+
+/**
+*	Extension of precompiled textures. They're stored next to the image they were made from, with this extension instead of its own.
+*/
+extern const char* const EXTENSION;
+
+const uint32_t VERSION = 1;
+
+/**
+*	Enough for a 32768x32768 image.
+*/
+const uint32_t MAX_LEVELS = 16;
+
+struct Header_t
+{
+	char identifier[ 4 ];
+	uint32_t version;
+
+	/**
+	*	Format.
+	*/
+	uint32_t format;
+
+	uint32_t width;
+	uint32_t height;
+
+	uint32_t levelcount;
+};
+
+struct Level_t
+{
+	/**
+	*	Offset of the level's data from the start of the file.
+	*/
+	uint32_t offset;
+	uint32_t size;
+
+	uint32_t width;
+	uint32_t height;
+};
+
+/**
+*	A parsed texture file. Points into the file's data.
+*/
+struct TextureView_t
+{
+	Format format;
+
+	uint32_t uiWidth;
+	uint32_t uiHeight;
+
+	uint32_t uiLevelCount;
+	Level_t levels[ MAX_LEVELS ];
+
+	const uint8_t* pData;
+};
+
+/**
+*	@return Whether the format is block compressed.
+*/
+inline bool IsCompressed( const Format format )
+{
+	return format != Format::RGBA8;
+}
+
+/**
+*	@return Name of the texture file for the given image.
+*/
+std::string GetTextureFileName( const char* pszImageName );
+
+/**
+*	@return Size of a level of the given size in the given format, or 0 if the format is unknown.
+*/
+size_t GetLevelSize( const Format format, const uint32_t uiWidth, const uint32_t uiHeight );
+
+/**
+*	Checks a texture file and finds its levels. Every level must have the size that its dimensions need, and lie within the data.
+*	@return Whether the file is valid.
+*/
+bool ParseTexture( const uint8_t* pData, const size_t uiSize, TextureView_t& view );
+}
+
+#endif //COMMON_TEXTUREFILE_H
@@ -1,10 +1,299 @@
+#include <algorithm>
 #include <cassert>
 #include <cctype>
+#include <climits>
+#include <cstdint>
+
+#include "CPUFeatures.h"
 
 #include "Tokenization.h"
 
+//The vector compares are signed, so they only match the scalar code if char is signed.
+#if CHAR_MIN < 0
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <intrin.h>
+#include <emmintrin.h>
+
+#define TOKENIZATION_SSE2
+#define TOKENIZATION_TARGET_SSE2
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <emmintrin.h>
+
+#define TOKENIZATION_SSE2
+//Only the vector functions are compiled for SSE2, so the rest runs on any CPU.
+//Aligned blocks never cross a page, but can extend past the end of the string, which AddressSanitizer would report.
+#define TOKENIZATION_TARGET_SSE2 __attribute__( ( target( "sse2" ), no_sanitize_address ) )
+#endif
+#endif
+
 namespace tokenization
 {
+namespace
+{
+/**
+*	Runs shorter than this are scanned one character at a time before the vector scan is used.
+*	Most tokens, and the whitespace between them, are short enough that setting up a vector scan costs more than it saves.
+*/
+const size_t SHORT_RUN_LENGTH = 16;
+
+inline bool IsBreakChar( const char c, const char* pszBreakChars )
+{
+	for( ; *pszBreakChars; ++pszBreakChars )
+	{
+		if( *pszBreakChars == c )
+			return true;
+	}
+
+	return false;
+}
+
+/*
+*	The scalar scans stop after uiMaxLength characters, and return null if they haven't found a match by then.
+*/
+
+inline const char* SkipWhitespaceScalar( const char* pszData, size_t uiMaxLength )
+{
+	for( ; uiMaxLength > 0; --uiMaxLength, ++pszData )
+	{
+		if( !( *pszData ) || *pszData > ' ' )
+			return pszData;
+	}
+
+	return nullptr;
+}
+
+inline const char* FindCharScalar( const char* pszData, const char c, size_t uiMaxLength )
+{
+	for( ; uiMaxLength > 0; --uiMaxLength, ++pszData )
+	{
+		if( !( *pszData ) || *pszData == c )
+			return pszData;
+	}
+
+	return nullptr;
+}
+
+inline const char* FindWordEndScalar( const char* pszData, const char* pszBreakChars, size_t uiMaxLength )
+{
+	for( ; uiMaxLength > 0; --uiMaxLength, ++pszData )
+	{
+		if( *pszData <= ' ' || IsBreakChar( *pszData, pszBreakChars ) )
+			return pszData;
+	}
+
+	return nullptr;
+}
+
+/**
+*	Copies the rest of a token once its end is known.
+*	@param pszData Next character to copy.
+*	@param pszEnd End of the token.
+*	@param uiLength Number of characters that have already been copied.
+*	@return Whether the token fit in the buffer. If not, the buffer contains as much of the token as it can hold.
+*/
+bool FinishToken( const char* pszData, const char* pszEnd, char* pszBuffer, const size_t uiLength, const size_t uiBufferSize, bool* bBufferTooSmall )
+{
+	const size_t uiTotalLength = uiLength + ( pszEnd - pszData );
+
+	if( uiTotalLength >= uiBufferSize )
+	{
+		memcpy( pszBuffer + uiLength, pszData, uiBufferSize - 1 - uiLength );
+		pszBuffer[ uiBufferSize - 1 ] = '\0';
+
+		if( bBufferTooSmall )
+			*bBufferTooSmall = true;
+
+		return false;
+	}
+
+	memcpy( pszBuffer + uiLength, pszData, pszEnd - pszData );
+	pszBuffer[ uiTotalLength ] = '\0';
+
+	return true;
+}
+
+#ifdef TOKENIZATION_SSE2
+/**
+*	@return Index of the lowest set bit. uiMask must not be 0.
+*/
+inline unsigned int FindLowestBit( const unsigned int uiMask )
+{
+#ifdef _MSC_VER
+	unsigned long uiIndex;
+
+	_BitScanForward( &uiIndex, uiMask );
+
+	return uiIndex;
+#else
+	return __builtin_ctz( uiMask );
+#endif
+}
+
+/*
+*	The vector functions read 16 byte aligned blocks, starting with the block that contains pszData.
+*	Aligned blocks never cross a page boundary, so they can read past the null terminator without faulting.
+*	Bits for characters in front of pszData are cleared from the first block's mask.
+*/
+
+TOKENIZATION_TARGET_SSE2 const char* SkipWhitespaceSSE2( const char* pszData )
+{
+	const __m128i space = _mm_set1_epi8( ' ' );
+	const __m128i zero = _mm_setzero_si128();
+
+	unsigned int uiOffset = static_cast<unsigned int>( reinterpret_cast<uintptr_t>( pszData ) & 15 );
+
+	for( const char* pszBlock = pszData - uiOffset; ; pszBlock += 16, uiOffset = 0 )
+	{
+		const __m128i block = _mm_load_si128( reinterpret_cast<const __m128i*>( pszBlock ) );
+
+		//Characters after ' ', or the null terminator.
+		const __m128i match = _mm_or_si128( _mm_cmpgt_epi8( block, space ), _mm_cmpeq_epi8( block, zero ) );
+
+		const unsigned int uiMask = ( static_cast<unsigned int>( _mm_movemask_epi8( match ) ) >> uiOffset ) << uiOffset;
+
+		if( uiMask )
+			return pszBlock + FindLowestBit( uiMask );
+	}
+}
+
+/**
+*	Finds the first occurrence of c, or the null terminator.
+*/
+TOKENIZATION_TARGET_SSE2 const char* FindCharSSE2( const char* pszData, const char c )
+{
+	const __m128i target = _mm_set1_epi8( c );
+	const __m128i zero = _mm_setzero_si128();
+
+	unsigned int uiOffset = static_cast<unsigned int>( reinterpret_cast<uintptr_t>( pszData ) & 15 );
+
+	for( const char* pszBlock = pszData - uiOffset; ; pszBlock += 16, uiOffset = 0 )
+	{
+		const __m128i block = _mm_load_si128( reinterpret_cast<const __m128i*>( pszBlock ) );
+
+		const __m128i match = _mm_or_si128( _mm_cmpeq_epi8( block, target ), _mm_cmpeq_epi8( block, zero ) );
+
+		const unsigned int uiMask = ( static_cast<unsigned int>( _mm_movemask_epi8( match ) ) >> uiOffset ) << uiOffset;
+
+		if( uiMask )
+			return pszBlock + FindLowestBit( uiMask );
+	}
+}
+
+TOKENIZATION_TARGET_SSE2 const char* FindWordEndSSE2( const char* pszData, const char* pszBreakChars )
+{
+	//Space plus one, so that a single signed compare finds whitespace and the null terminator.
+	const __m128i wordChar = _mm_set1_epi8( ' ' + 1 );
+
+	__m128i breakChars[ MAX_BREAK_CHARS ];
+
+	size_t uiBreakCount = 0;
+
+	for( ; uiBreakCount < MAX_BREAK_CHARS && pszBreakChars[ uiBreakCount ]; ++uiBreakCount )
+	{
+		breakChars[ uiBreakCount ] = _mm_set1_epi8( pszBreakChars[ uiBreakCount ] );
+	}
+
+	unsigned int uiOffset = static_cast<unsigned int>( reinterpret_cast<uintptr_t>( pszData ) & 15 );
+
+	for( const char* pszBlock = pszData - uiOffset; ; pszBlock += 16, uiOffset = 0 )
+	{
+		const __m128i block = _mm_load_si128( reinterpret_cast<const __m128i*>( pszBlock ) );
+
+		__m128i match = _mm_cmplt_epi8( block, wordChar );
+
+		for( size_t uiIndex = 0; uiIndex < uiBreakCount; ++uiIndex )
+		{
+			match = _mm_or_si128( match, _mm_cmpeq_epi8( block, breakChars[ uiIndex ] ) );
+		}
+
+		const unsigned int uiMask = ( static_cast<unsigned int>( _mm_movemask_epi8( match ) ) >> uiOffset ) << uiOffset;
+
+		if( uiMask )
+			return pszBlock + FindLowestBit( uiMask );
+	}
+}
+#endif
+}
+
+bool IsVectorized()
+{
+#ifdef TOKENIZATION_SSE2
+	return Plat_HasCPUFeatures( CPUFeature::SSE2 );
+#else
+	return false;
+#endif
+}
+
+const char* SkipWhitespace( const char* pszData )
+{
+	assert( pszData );
+
+	if( auto pszResult = SkipWhitespaceScalar( pszData, SHORT_RUN_LENGTH ) )
+		return pszResult;
+
+	pszData += SHORT_RUN_LENGTH;
+
+#ifdef TOKENIZATION_SSE2
+	if( IsVectorized() )
+		return SkipWhitespaceSSE2( pszData );
+#endif
+
+	return SkipWhitespaceScalar( pszData, SIZE_MAX );
+}
+
+const char* FindLineEnd( const char* pszData )
+{
+	assert( pszData );
+
+	if( auto pszResult = FindCharScalar( pszData, '\n', SHORT_RUN_LENGTH ) )
+		return pszResult;
+
+	pszData += SHORT_RUN_LENGTH;
+
+#ifdef TOKENIZATION_SSE2
+	if( IsVectorized() )
+		return FindCharSSE2( pszData, '\n' );
+#endif
+
+	return FindCharScalar( pszData, '\n', SIZE_MAX );
+}
+
+const char* FindQuote( const char* pszData )
+{
+	assert( pszData );
+
+	if( auto pszResult = FindCharScalar( pszData, '\"', SHORT_RUN_LENGTH ) )
+		return pszResult;
+
+	pszData += SHORT_RUN_LENGTH;
+
+#ifdef TOKENIZATION_SSE2
+	if( IsVectorized() )
+		return FindCharSSE2( pszData, '\"' );
+#endif
+
+	return FindCharScalar( pszData, '\"', SIZE_MAX );
+}
+
+const char* FindWordEnd( const char* pszData, const char* pszBreakChars )
+{
+	assert( pszData );
+	assert( pszBreakChars );
+	assert( strlen( pszBreakChars ) <= MAX_BREAK_CHARS );
+
+	if( auto pszResult = FindWordEndScalar( pszData, pszBreakChars, SHORT_RUN_LENGTH ) )
+		return pszResult;
+
+	pszData += SHORT_RUN_LENGTH;
+
+#ifdef TOKENIZATION_SSE2
+	if( IsVectorized() )
+		return FindWordEndSSE2( pszData, pszBreakChars );
+#endif
+
+	return FindWordEndScalar( pszData, pszBreakChars, SIZE_MAX );
+}
+
 bool IsControlChar( const char c )
 {
 	return 
@@ -32,6 +321,13 @@ const char* Parse( const char* pszData, char* pszBuffer, const size_t uiBufferSi
 	if( !pszData )
 		return nullptr;
 
+	/*
+	*	Tokens are copied one character at a time, which is fastest for short tokens.
+	*	Tokens that reach SHORT_RUN_LENGTH are finished with a vector scan. The check shares a compare with the buffer size check.
+	*/
+	const size_t uiQuotedLimit = std::min( uiBufferSize, SHORT_RUN_LENGTH );
+	const size_t uiWordLimit = std::min( uiBufferSize, SHORT_RUN_LENGTH + 1 );
+
 	// skip whitespace
 skipwhite:
 	while( ( c = *pszData ) <= ' ' )
@@ -39,13 +335,16 @@ skipwhite:
 		if( c == '\0' )
 			return nullptr;                    // end of file;
 		++pszData;
+
+		//Skip the rest of longer runs, like indentation, in one go.
+		if( *pszData <= ' ' )
+			pszData = SkipWhitespace( pszData );
 	}
 
 	// skip // comments
 	if( c == '/' && pszData[ 1 ] == '/' )
 	{
-		while( *pszData && *pszData != '\n' )
-			++pszData;
+		pszData = FindLineEnd( pszData );
 		goto skipwhite;
 	}
 
@@ -56,15 +355,26 @@ skipwhite:
 		++pszData;
 		while( 1 )
 		{
-			//Buffer too small.
-			if( len >= uiBufferSize )
+			if( len >= uiQuotedLimit )
 			{
-				pszBuffer[ uiBufferSize - 1 ] = '\0';
+				//Buffer too small.
+				if( len >= uiBufferSize )
+				{
+					pszBuffer[ uiBufferSize - 1 ] = '\0';
 
-				if( bBufferTooSmall )
-					*bBufferTooSmall = true;
+					if( bBufferTooSmall )
+						*bBufferTooSmall = true;
 
-				return nullptr;
+					return nullptr;
+				}
+
+				const char* pszEnd = FindQuote( pszData );
+
+				if( !FinishToken( pszData, pszEnd, pszBuffer, len, uiBufferSize, bBufferTooSmall ) )
+					return nullptr;
+
+				//Skips the closing quote, or the null terminator if the string wasn't closed.
+				return pszEnd + 1;
 			}
 
 			c = *pszData++;
@@ -90,15 +400,25 @@ skipwhite:
 	// parse a regular word
 	do
 	{
-		//Buffer too small.
-		if( len >= uiBufferSize )
+		if( len + 1 >= uiWordLimit )
 		{
-			pszBuffer[ uiBufferSize - 1 ] = '\0';
+			//Buffer too small. The null terminator needs room as well.
+			if( len + 1 >= uiBufferSize )
+			{
+				pszBuffer[ uiBufferSize - 1 ] = '\0';
 
-			if( bBufferTooSmall )
-				*bBufferTooSmall = true;
+				if( bBufferTooSmall )
+					*bBufferTooSmall = true;
+
+				return nullptr;
+			}
+
+			const char* pszEnd = FindWordEnd( pszData, CONTROL_CHARS );
 
-			return nullptr;
+			if( !FinishToken( pszData, pszEnd, pszBuffer, len, uiBufferSize, bBufferTooSmall ) )
+				return nullptr;
+
+			return pszEnd;
 		}
 
 		pszBuffer[ len ] = c;
@@ -114,6 +434,78 @@ skipwhite:
 	return pszData;
 }
 
+const char* ParseSpan( const char* pszData, const char*& pszToken, size_t& uiLength )
+{
+	pszToken = nullptr;
+	uiLength = 0;
+
+	if( !pszData )
+		return nullptr;
+
+	char c;
+
+	//Same structure as Parse, short runs are scanned inline and longer runs are finished with a vector scan.
+
+	// skip whitespace
+skipwhite:
+	while( ( c = *pszData ) <= ' ' )
+	{
+		if( c == '\0' )
+			return nullptr;                    // end of file;
+		++pszData;
+
+		//Skip the rest of longer runs, like indentation, in one go.
+		if( *pszData <= ' ' )
+			pszData = SkipWhitespace( pszData );
+	}
+
+	// skip // comments
+	if( c == '/' && pszData[ 1 ] == '/' )
+	{
+		pszData = FindLineEnd( pszData );
+		goto skipwhite;
+	}
+
+	// handle quoted strings specially
+	if( c == '\"' )
+	{
+		pszToken = ++pszData;
+
+		size_t len = 0;
+
+		while( len < SHORT_RUN_LENGTH && ( c = pszData[ len ] ) != '\"' && c )
+			++len;
+
+		const char* pszEnd = len < SHORT_RUN_LENGTH ? pszData + len : FindQuote( pszData + len );
+
+		uiLength = pszEnd - pszData;
+
+		//Skips the closing quote. Unlike Parse, an unclosed string stops at the null terminator.
+		return *pszEnd ? pszEnd + 1 : pszEnd;
+	}
+
+	pszToken = pszData;
+
+	// parse single characters
+	if( IsControlChar( c ) )
+	{
+		uiLength = 1;
+		return pszData + 1;
+	}
+
+	// parse a regular word
+	size_t len = 1;
+
+	while( len < SHORT_RUN_LENGTH && ( c = pszData[ len ] ) > ' ' && !IsControlChar( c ) )
+		++len;
+
+	const char* pszEnd = len < SHORT_RUN_LENGTH ? pszData + len : FindWordEnd( pszData + len, CONTROL_CHARS );
+
+	uiLength = pszEnd - pszData;
+
+	return pszEnd;
+}
+
 bool TokenWaiting( const char* pszLine )
 {
 	const char* p = pszLine;
@@ -20,6 +20,47 @@ const size_t MINIMUM_BUFFER_SIZE = 1500;
 */
 bool IsControlChar( const char c );
 
+/**
+*	Control characters, as a string.
+*	@see IsControlChar
+*/
+const char CONTROL_CHARS[] = "{}()',";
+
+/**
+*	Maximum number of break characters that FindWordEnd accepts.
+*/
+const size_t MAX_BREAK_CHARS = 8;
+
+/**
+*	@return Whether the scanning functions below use SSE2 to examine 16 characters at a time.
+*	If not, they examine one character at a time. Both produce the same results.
+*/
+bool IsVectorized();
+
+/**
+*	Skips whitespace. Like Parse, every character up to and including ' ' is whitespace.
+*	@return The first character that isn't whitespace, or the null terminator.
+*/
+const char* SkipWhitespace( const char* pszData );
+
+/**
+*	@return The first newline, or the null terminator.
+*/
+const char* FindLineEnd( const char* pszData );
+
+/**
+*	@return The first double quote, or the null terminator.
+*/
+const char* FindQuote( const char* pszData );
+
+/**
+*	Finds the end of a word.
+*	@param pszData Start of the word.
+*	@param pszBreakChars Characters that end a word, in addition to whitespace. At most MAX_BREAK_CHARS characters.
+*	@return The first whitespace or break character, or the null terminator.
+*/
+const char* FindWordEnd( const char* pszData, const char* pszBreakChars );
+
 /**
 *	Parses a token out of a string.
 *	@param pszData string to parse.
@@ -32,6 +73,16 @@ bool IsControlChar( const char c );
 */
 const char* Parse( const char* pszData, char* pszBuffer, const size_t uiBufferSize, bool* bBufferTooSmall = nullptr );
 
+/**
+*	Parses a token out of a string without copying it. Follows the same rules as Parse, but tokens have no length limit.
+*	@param pszData string to parse.
+*	@param[ out ] pszToken Start of the token in pszData. Quoted tokens start after the opening quote.
+*	@param[ out ] uiLength Length of the token. The token is not null terminated.
+*	@return If a token was parsed, returns the position of the next token in pszData.
+*			If EOF was encountered before a token was found, returns null.
+*/
+const char* ParseSpan( const char* pszData, const char*& pszToken, size_t& uiLength );
+
 /**
 *	Returns true if additional data is waiting to be processed on this line.
 *	@param pszLine Line to check.
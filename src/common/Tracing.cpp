@@ -0,0 +1,205 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <intrin.h>
+#define TRACE_HAS_TSC
+#elif defined( __i386__ ) || defined( __x86_64__ )
+#include <x86intrin.h>
+#define TRACE_HAS_TSC
+#endif
+
+#include "Tracing.h"
+
+namespace
+{
+struct Event_t
+{
+	const char* pszName;
+	uint64_t uiStartTicks;
+	uint64_t uiEndTicks;
+};
+
+struct ThreadEvents_t
+{
+	/**
+	*	Index of the thread, in the order threads first recorded an event.
+	*/
+	unsigned int uiThread;
+
+	/**
+	*	Number of events ever recorded. Events are written to uiWritten % TRACE_EVENTS_PER_THREAD.
+	*/
+	std::atomic<uint64_t> uiWritten{ 0 };
+
+	Event_t events[ TRACE_EVENTS_PER_THREAD ];
+};
+
+/**
+*	Maps timestamp counter ticks to the trace timeline. Measured against the steady clock when tracing starts,
+*	and again whenever events are written, so the rate gets more accurate the longer the game runs.
+*/
+struct TickCalibration_t
+{
+	uint64_t uiTicks;
+	uint64_t uiTimeUS;
+};
+
+std::mutex g_ThreadsMutex;
+
+/**
+*	Buffers of all threads that recorded events. Kept after their threads exit, so their events can still be written.
+*/
+std::vector<std::unique_ptr<ThreadEvents_t>> g_Threads;
+
+thread_local ThreadEvents_t* g_pThreadEvents = nullptr;
+
+uint64_t GetSteadyTimeUS()
+{
+	return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+}
+
+const TickCalibration_t& GetStartCalibration()
+{
+	static const TickCalibration_t calibration{ Trace_GetTicks(), GetSteadyTimeUS() };
+
+	return calibration;
+}
+
+ThreadEvents_t& GetThreadEvents()
+{
+	if( !g_pThreadEvents )
+	{
+		//Calibrate as early as possible, the rate is measured from here.
+		GetStartCalibration();
+
+		std::lock_guard<std::mutex> lock( g_ThreadsMutex );
+
+		g_Threads.emplace_back( std::make_unique<ThreadEvents_t>() );
+
+		g_pThreadEvents = g_Threads.back().get();
+		g_pThreadEvents->uiThread = static_cast<unsigned int>( g_Threads.size() - 1 );
+	}
+
+	return *g_pThreadEvents;
+}
+}
+
+bool Trace_IsEnabled()
+{
+#ifdef ENABLE_TRACING
+	return true;
+#else
+	return false;
+#endif
+}
+
+uint64_t Trace_GetTimeUS()
+{
+	return GetSteadyTimeUS();
+}
+
+uint64_t Trace_GetTicks()
+{
+#ifdef TRACE_HAS_TSC
+	return __rdtsc();
+#else
+	return static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now().time_since_epoch() ).count() );
+#endif
+}
+
+void Trace_RecordEvent( const char* pszName, const uint64_t uiStartTicks )
+{
+	const uint64_t uiEndTicks = Trace_GetTicks();
+
+	auto& thread = GetThreadEvents();
+
+	const uint64_t uiIndex = thread.uiWritten.load( std::memory_order_relaxed );
+
+	thread.events[ uiIndex % TRACE_EVENTS_PER_THREAD ] = { pszName, uiStartTicks, uiEndTicks };
+
+	thread.uiWritten.store( uiIndex + 1, std::memory_order_release );
+}
+
+size_t Trace_GetEvents( char* pszBuffer, const size_t uiBufferSize, const uint64_t uiSinceUS, const unsigned int uiProcessID )
+{
+	const auto& start = GetStartCalibration();
+
+	const TickCalibration_t now{ Trace_GetTicks(), GetSteadyTimeUS() };
+
+	const double flUSPerTick = now.uiTicks > start.uiTicks ? static_cast<double>( now.uiTimeUS - start.uiTimeUS ) / ( now.uiTicks - start.uiTicks ) : 0;
+
+	auto ToUS = [ & ]( const uint64_t uiTicks )
+	{
+		//Events recorded before the first calibration are placed before it.
+		return start.uiTimeUS + ( static_cast<double>( uiTicks ) - start.uiTicks ) * flUSPerTick;
+	};
+
+	size_t uiLength = 0;
+
+	if( pszBuffer && uiBufferSize > 0 )
+		*pszBuffer = '\0';
+
+	char szEvent[ 256 ];
+
+	auto Append = [ & ]( const char* pszText, const int iTextLength )
+	{
+		if( iTextLength <= 0 )
+			return;
+
+		if( pszBuffer && uiLength < uiBufferSize )
+		{
+			const size_t uiCopy = std::min( static_cast<size_t>( iTextLength ), uiBufferSize - 1 - uiLength );
+
+			std::copy( pszText, pszText + uiCopy, pszBuffer + uiLength );
+			pszBuffer[ uiLength + uiCopy ] = '\0';
+		}
+
+		uiLength += static_cast<size_t>( iTextLength );
+	};
+
+	std::lock_guard<std::mutex> lock( g_ThreadsMutex );
+
+	for( const auto& thread : g_Threads )
+	{
+		const uint64_t uiWritten = thread->uiWritten.load( std::memory_order_acquire );
+		const uint64_t uiFirst = uiWritten > TRACE_EVENTS_PER_THREAD ? uiWritten - TRACE_EVENTS_PER_THREAD : 0;
+
+		std::vector<Event_t> events;
+
+		events.reserve( static_cast<size_t>( uiWritten - uiFirst ) );
+
+		for( uint64_t uiIndex = uiFirst; uiIndex < uiWritten; ++uiIndex )
+		{
+			events.push_back( thread->events[ uiIndex % TRACE_EVENTS_PER_THREAD ] );
+		}
+
+		//The thread keeps recording, skip the events it overwrote while they were being copied.
+		const uint64_t uiWrittenAfter = thread->uiWritten.load( std::memory_order_acquire );
+		const uint64_t uiValidFirst = uiWrittenAfter > TRACE_EVENTS_PER_THREAD ? uiWrittenAfter - TRACE_EVENTS_PER_THREAD : 0;
+
+		for( size_t uiEvent = static_cast<size_t>( std::max( uiFirst, uiValidFirst ) - uiFirst ); uiEvent < events.size(); ++uiEvent )
+		{
+			const auto& event = events[ uiEvent ];
+
+			const double flStartUS = ToUS( event.uiStartTicks );
+			const double flEndUS = ToUS( event.uiEndTicks );
+
+			if( flEndUS < uiSinceUS )
+				continue;
+
+			//Event names are identifiers, so they don't need escaping. Times are fractional so short events don't collapse to 0.
+			const int iEventLength = snprintf( szEvent, sizeof( szEvent ), "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%u,\"tid\":%u}",
+											   uiLength > 0 ? ",\n" : "", event.pszName, flStartUS, std::max( flEndUS - flStartUS, 0.0 ), uiProcessID, thread->uiThread + 1 );
+
+			Append( szEvent, std::min( iEventLength, static_cast<int>( sizeof( szEvent ) - 1 ) ) );
+		}
+	}
+
+	return uiLength;
+}
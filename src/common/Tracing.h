@@ -0,0 +1,89 @@
+#ifndef COMMON_TRACING_H
+#define COMMON_TRACING_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+*	@file
+*	Scoped trace events for diagnosing hitches. Only compiled in if ENABLE_TRACING is defined (the ENABLE_TRACING CMake option),
+*	otherwise the macros expand to nothing.
+*	Each thread records the events that end on it in its own ring buffer, so recording never locks and only keeps the most recent events.
+*	Timestamps come from the CPU's timestamp counter where available, and are converted to microseconds when events are written.
+*	Each library records its own events, libraries that are traced expose them so they can be written to the same trace.
+*/
+
+/**
+*	Records a trace event for the rest of the enclosing scope. The name must be a string literal.
+*/
+#ifdef ENABLE_TRACING
+#define TRACE_SCOPE( pszName ) CTraceScope TRACE_CONCAT( traceScope, __LINE__ )( pszName )
+#else
+#define TRACE_SCOPE( pszName )
+#endif
+
+#define TRACE_CONCAT_IMPL( a, b ) a##b
+#define TRACE_CONCAT( a, b ) TRACE_CONCAT_IMPL( a, b )
+
+/**
+*	Number of events kept per thread.
+*/
+const size_t TRACE_EVENTS_PER_THREAD = 16384;
+
+/**
+*	@return Whether tracing was compiled in.
+*/
+bool Trace_IsEnabled();
+
+/**
+*	@return The current time on the trace timeline, in microseconds. The same in all libraries.
+*/
+uint64_t Trace_GetTimeUS();
+
+/**
+*	@return The timestamp counter, or a steady clock where there is none.
+*/
+uint64_t Trace_GetTicks();
+
+/**
+*	Records an event that ran from uiStartTicks until now on the calling thread.
+*	@param pszName Name of the event. Must remain valid for as long as the library is loaded.
+*/
+void Trace_RecordEvent( const char* pszName, const uint64_t uiStartTicks );
+
+/**
+*	Writes this library's events that ended after a point in time as Chrome trace event objects, separated by commas.
+*	@param pszBuffer Buffer that receives the events, null terminated. May be null if uiBufferSize is 0.
+*	@param uiSinceUS Events that ended before this time, as returned by Trace_GetTimeUS, are skipped.
+*	@param uiProcessID Process ID to give the events, to tell libraries apart.
+*	@return Length of the events, excluding the null terminator. If it's not less than uiBufferSize, the events were cut off.
+*/
+size_t Trace_GetEvents( char* pszBuffer, const size_t uiBufferSize, const uint64_t uiSinceUS, const unsigned int uiProcessID );
+
+/**
+*	Records an event for as long as it's in scope. Use TRACE_SCOPE.
+*/
+class CTraceScope final
+{
+public:
+	explicit CTraceScope( const char* pszName )
+		: m_pszName( pszName )
+		, m_uiStartTicks( Trace_GetTicks() )
+	{
+	}
+
+	~CTraceScope()
+	{
+		Trace_RecordEvent( m_pszName, m_uiStartTicks );
+	}
+
+private:
+	const char* const m_pszName;
+	const uint64_t m_uiStartTicks;
+
+private:
+	CTraceScope( const CTraceScope& ) = delete;
+	CTraceScope& operator=( const CTraceScope& ) = delete;
+};
+
+#endif //COMMON_TRACING_H
@@ -0,0 +1,124 @@
+#include <cstring>
+
+#include "ByteSwap.h"
+
+#include "XXHash.h"
+
+namespace xxhash
+{
+namespace
+{
+const uint64_t PRIME_1 = 0x9E3779B185EBCA87ULL;
+const uint64_t PRIME_2 = 0xC2B2AE3D27D4EB4FULL;
+const uint64_t PRIME_3 = 0x165667B19E3779F9ULL;
+const uint64_t PRIME_4 = 0x85EBCA77C2B2AE63ULL;
+const uint64_t PRIME_5 = 0x27D4EB2F165667C5ULL;
+
+/**
+*	Size of the stripes that are processed by the four accumulators.
+*/
+const size_t STRIPE_SIZE = 32;
+
+inline uint64_t RotateLeft( const uint64_t uiValue, const int iBits )
+{
+	return ( uiValue << iBits ) | ( uiValue >> ( 64 - iBits ) );
+}
+
+inline uint64_t Read64( const uint8_t* pData )
+{
+	uint64_t uiValue;
+
+	memcpy( &uiValue, pData, sizeof( uiValue ) );
+
+	return LittleValue( uiValue );
+}
+
+inline uint32_t Read32( const uint8_t* pData )
+{
+	uint32_t uiValue;
+
+	memcpy( &uiValue, pData, sizeof( uiValue ) );
+
+	return LittleValue( uiValue );
+}
+
+inline uint64_t Round( uint64_t uiAccumulator, const uint64_t uiInput )
+{
+	uiAccumulator += uiInput * PRIME_2;
+	uiAccumulator = RotateLeft( uiAccumulator, 31 );
+
+	return uiAccumulator * PRIME_1;
+}
+
+inline uint64_t MergeRound( const uint64_t uiAccumulator, const uint64_t uiValue )
+{
+	return ( uiAccumulator ^ Round( 0, uiValue ) ) * PRIME_1 + PRIME_4;
+}
+}
+
+uint64_t Hash64( const void* pData, const size_t uiSize, const uint64_t uiSeed )
+{
+	auto p = reinterpret_cast<const uint8_t*>( pData );
+	const uint8_t* const pEnd = p + uiSize;
+
+	uint64_t uiHash;
+
+	if( uiSize >= STRIPE_SIZE )
+	{
+		uint64_t v1 = uiSeed + PRIME_1 + PRIME_2;
+		uint64_t v2 = uiSeed + PRIME_2;
+		uint64_t v3 = uiSeed;
+		uint64_t v4 = uiSeed - PRIME_1;
+
+		for( const uint8_t* const pLimit = pEnd - STRIPE_SIZE; p <= pLimit; p += STRIPE_SIZE )
+		{
+			v1 = Round( v1, Read64( p ) );
+			v2 = Round( v2, Read64( p + 8 ) );
+			v3 = Round( v3, Read64( p + 16 ) );
+			v4 = Round( v4, Read64( p + 24 ) );
+		}
+
+		uiHash = RotateLeft( v1, 1 ) + RotateLeft( v2, 7 ) + RotateLeft( v3, 12 ) + RotateLeft( v4, 18 );
+
+		uiHash = MergeRound( uiHash, v1 );
+		uiHash = MergeRound( uiHash, v2 );
+		uiHash = MergeRound( uiHash, v3 );
+		uiHash = MergeRound( uiHash, v4 );
+	}
+	else
+	{
+		uiHash = uiSeed + PRIME_5;
+	}
+
+	uiHash += static_cast<uint64_t>( uiSize );
+
+	//Process whatever didn't fill a stripe.
+	for( ; pEnd - p >= 8; p += 8 )
+	{
+		uiHash ^= Round( 0, Read64( p ) );
+		uiHash = RotateLeft( uiHash, 27 ) * PRIME_1 + PRIME_4;
+	}
+
+	if( pEnd - p >= 4 )
+	{
+		uiHash ^= static_cast<uint64_t>( Read32( p ) ) * PRIME_1;
+		uiHash = RotateLeft( uiHash, 23 ) * PRIME_2 + PRIME_3;
+		p += 4;
+	}
+
+	for( ; p < pEnd; ++p )
+	{
+		uiHash ^= *p * PRIME_5;
+		uiHash = RotateLeft( uiHash, 11 ) * PRIME_1;
+	}
+
+	//Avalanche.
+	uiHash ^= uiHash >> 33;
+	uiHash *= PRIME_2;
+	uiHash ^= uiHash >> 29;
+	uiHash *= PRIME_3;
+	uiHash ^= uiHash >> 32;
+
+	return uiHash;
+}
+}
@@ -0,0 +1,25 @@
+#ifndef COMMON_XXHASH_H
+#define COMMON_XXHASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+*	@file
+*	64 bit XXH64 hash. Output is compatible with the reference implementation's XXH64.
+*	Fast enough to hash file contents as they are loaded; not suitable for security purposes.
+*/
+
+namespace xxhash
+{
+/**
+*	Hashes a block of data.
+*	@param pData Data to hash.
+*	@param uiSize Size of the data, in bytes.
+*	@param uiSeed Seed to start from.
+*	@return The hash.
+*/
+uint64_t Hash64( const void* pData, const size_t uiSize, const uint64_t uiSeed = 0 );
+}
+
+#endif //COMMON_XXHASH_H
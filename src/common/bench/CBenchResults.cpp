@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "CBenchResults.h"
+
+namespace
+{
+void AppendJSONString( std::string& szOut, const std::string& szString )
+{
+	szOut += '\"';
+
+	for( const char c : szString )
+	{
+		if( c == '\"' || c == '\\' )
+			szOut += '\\';
+
+		//Names are formatted by the benchmarks, control characters never show up.
+		if( static_cast<unsigned char>( c ) >= ' ' )
+			szOut += c;
+	}
+
+	szOut += '\"';
+}
+}
+
+bool BenchOptions_t::ParseArg( const int argc, char* argv[], int& iArg )
+{
+	if( iArg + 1 >= argc )
+		return false;
+
+	const char* pszArg = argv[ iArg ];
+	const char* pszValue = argv[ iArg + 1 ];
+
+	if( !strcmp( pszArg, "-scale" ) )
+		flScale = std::max( 0.0, atof( pszValue ) );
+	else if( !strcmp( pszArg, "-json" ) )
+		szResultsFile = pszValue;
+	else
+		return false;
+
+	++iArg;
+
+	return true;
+}
+
+bool BenchOptions_t::ParseCommandLine( const int argc, char* argv[], const char* pszProgram )
+{
+	for( int iArg = 1; iArg < argc; ++iArg )
+	{
+		if( !ParseArg( argc, argv, iArg ) )
+		{
+			printf( "Usage: %s [-scale <iteration multiplier>] [-json <results file>]\n", pszProgram );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+size_t BenchOptions_t::Scale( const size_t uiCount ) const
+{
+	return std::max<size_t>( 1, static_cast<size_t>( uiCount * flScale ) );
+}
+
+CBenchResults::CBenchResults( const char* pszSuite )
+	: m_szSuite( pszSuite )
+{
+}
+
+void CBenchResults::Report( const char* pszName, const uint64_t uiOperations, const double flSeconds, const uint64_t uiBytes )
+{
+	const double flNanoseconds = uiOperations > 0 ? ( flSeconds * 1e9 ) / uiOperations : 0;
+
+	if( uiBytes > 0 )
+	{
+		printf( "%-44s %10llu ops %12.2f ns/op %10.1f MiB/s\n", pszName, static_cast<unsigned long long>( uiOperations ), flNanoseconds,
+				flSeconds > 0 ? ( uiBytes / ( 1024.0 * 1024.0 ) ) / flSeconds : 0.0 );
+	}
+	else
+	{
+		printf( "%-44s %10llu ops %12.2f ns/op\n", pszName, static_cast<unsigned long long>( uiOperations ), flNanoseconds );
+	}
+
+	m_Results.push_back( { pszName, uiOperations, flSeconds, uiBytes } );
+}
+
+bool CBenchResults::WriteJSON( const char* pszFileName ) const
+{
+	std::string szJSON = "{\"suite\":";
+
+	AppendJSONString( szJSON, m_szSuite );
+
+	szJSON += ",\"results\":[\n";
+
+	char szValues[ 256 ];
+
+	for( size_t uiIndex = 0; uiIndex < m_Results.size(); ++uiIndex )
+	{
+		const auto& result = m_Results[ uiIndex ];
+
+		if( uiIndex > 0 )
+			szJSON += ",\n";
+
+		szJSON += "{\"name\":";
+
+		AppendJSONString( szJSON, result.szName );
+
+		snprintf( szValues, sizeof( szValues ), ",\"ops\":%llu,\"seconds\":%.9f,\"ns_per_op\":%.3f",
+				  static_cast<unsigned long long>( result.uiOperations ), result.flSeconds,
+				  result.uiOperations > 0 ? ( result.flSeconds * 1e9 ) / result.uiOperations : 0.0 );
+
+		szJSON += szValues;
+
+		if( result.uiBytes > 0 )
+		{
+			snprintf( szValues, sizeof( szValues ), ",\"bytes_per_second\":%.1f", result.flSeconds > 0 ? result.uiBytes / result.flSeconds : 0.0 );
+
+			szJSON += szValues;
+		}
+
+		szJSON += '}';
+	}
+
+	szJSON += "\n]}\n";
+
+	FILE* pFile = fopen( pszFileName, "wb" );
+
+	if( !pFile )
+	{
+		printf( "Couldn't open results file \"%s\"\n", pszFileName );
+		return false;
+	}
+
+	const bool bSuccess = fwrite( szJSON.data(), 1, szJSON.size(), pFile ) == szJSON.size();
+
+	if( fclose( pFile ) != 0 || !bSuccess )
+	{
+		printf( "Couldn't write results file \"%s\"\n", pszFileName );
+		return false;
+	}
+
+	return true;
+}
+
+bool CBenchResults::WriteResultsFile( const BenchOptions_t& options ) const
+{
+	return options.szResultsFile.empty() || WriteJSON( options.szResultsFile.c_str() );
+}
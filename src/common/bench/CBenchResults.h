@@ -0,0 +1,119 @@
+#ifndef COMMON_BENCH_CBENCHRESULTS_H
+#define COMMON_BENCH_CBENCHRESULTS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+*	Times a benchmark from construction.
+*/
+class CBenchTimer final
+{
+public:
+	CBenchTimer()
+		: m_StartTime( std::chrono::steady_clock::now() )
+	{
+	}
+
+	double GetSeconds() const
+	{
+		return std::chrono::duration<double>( std::chrono::steady_clock::now() - m_StartTime ).count();
+	}
+
+private:
+	std::chrono::steady_clock::time_point m_StartTime;
+};
+
+/**
+*	Options that every benchmark program takes. Programs with options of their own derive from this.
+*/
+struct BenchOptions_t
+{
+	/**
+	*	Multiplies the number of iterations of each benchmark.
+	*/
+	double flScale = 1;
+
+	/**
+	*	File to write the results to as JSON. Empty to only print them.
+	*/
+	std::string szResultsFile;
+
+	/**
+	*	Handles the argument at iArg if it's -scale <iteration multiplier> or -json <results file>.
+	*	@param iArg Index of the argument. Advanced past the option's value if it was handled.
+	*	@return Whether the argument was handled.
+	*/
+	bool ParseArg( const int argc, char* argv[], int& iArg );
+
+	/**
+	*	Parses a command line that only has the shared options. Prints the usage if anything else is on it.
+	*	@param pszProgram Name of the program, for the usage.
+	*	@return Whether the command line was valid.
+	*/
+	bool ParseCommandLine( const int argc, char* argv[], const char* pszProgram );
+
+	/**
+	*	@return The iteration count multiplied by the scale, at least 1.
+	*/
+	size_t Scale( const size_t uiCount ) const;
+};
+
+/**
+*	Collects the results of a benchmark program so they can be written as JSON for tracking regressions.
+*	The file contains the suite name and an array of results: name, ops, seconds, ns_per_op and, for benchmarks that move data, bytes_per_second.
+*/
+class CBenchResults final
+{
+public:
+	struct Result_t
+	{
+		std::string szName;
+		uint64_t uiOperations;
+		double flSeconds;
+
+		/**
+		*	Bytes processed, or 0 if the benchmark doesn't measure throughput.
+		*/
+		uint64_t uiBytes;
+	};
+
+public:
+	/**
+	*	@param pszSuite Name of the benchmark program, written to the results file.
+	*/
+	CBenchResults( const char* pszSuite );
+
+	/**
+	*	Prints a result and records it.
+	*/
+	void Report( const char* pszName, const uint64_t uiOperations, const double flSeconds, const uint64_t uiBytes = 0 );
+
+	const std::vector<Result_t>& GetResults() const { return m_Results; }
+
+	/**
+	*	Writes the results to a JSON file.
+	*	@return Whether the file was written.
+	*/
+	bool WriteJSON( const char* pszFileName ) const;
+
+	/**
+	*	Writes the results to the options' results file, if they have one.
+	*	@return Whether there was no file to write or it was written.
+	*/
+	bool WriteResultsFile( const BenchOptions_t& options ) const;
+
+private:
+	std::string m_szSuite;
+
+	std::vector<Result_t> m_Results;
+
+private:
+	CBenchResults( const CBenchResults& ) = delete;
+	CBenchResults& operator=( const CBenchResults& ) = delete;
+};
+
+#endif //COMMON_BENCH_CBENCHRESULTS_H
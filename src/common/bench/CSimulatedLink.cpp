@@ -0,0 +1,90 @@
+#include <algorithm>
+
+#include "CSimulatedLink.h"
+
+const size_t CSimulatedLink::PACKET_OVERHEAD;
+
+CSimulatedLink::CSimulatedLink( const LinkConditions_t& conditions, const uint32_t uiSeed )
+	: m_Conditions( conditions )
+	, m_Random( uiSeed )
+	, m_Distribution( 0.0, 1.0 )
+{
+}
+
+void CSimulatedLink::Send( const void* pData, const size_t uiSize, const double flTimeMS )
+{
+	++m_Stats.uiSent;
+	m_Stats.uiBytesSent += uiSize;
+
+	if( Random() < m_Conditions.flLoss )
+	{
+		++m_Stats.uiLost;
+		return;
+	}
+
+	double flDepartureMS = flTimeMS;
+
+	if( m_Conditions.flBandwidth > 0 )
+	{
+		const double flStartMS = std::max( flTimeMS, m_flLinkFreeMS );
+
+		if( flStartMS - flTimeMS > m_Conditions.flQueueMS )
+		{
+			++m_Stats.uiQueueDropped;
+			return;
+		}
+
+		m_flLinkFreeMS = flStartMS + ( uiSize + PACKET_OVERHEAD ) * 1000.0 / m_Conditions.flBandwidth;
+
+		flDepartureMS = m_flLinkFreeMS;
+	}
+
+	double flArrivalMS = flDepartureMS + m_Conditions.flLatencyMS + Random() * m_Conditions.flJitterMS;
+
+	if( m_Conditions.flReorder > 0 && Random() < m_Conditions.flReorder )
+	{
+		//Doesn't hold up later packets, so they can overtake it.
+		flArrivalMS += Random() * m_Conditions.flReorderDelayMS;
+		++m_Stats.uiReordered;
+	}
+	else
+	{
+		flArrivalMS = std::max( flArrivalMS, m_flLastArrivalMS );
+		m_flLastArrivalMS = flArrivalMS;
+	}
+
+	Packet_t packet;
+
+	packet.flArrivalMS = flArrivalMS;
+	packet.uiOrder = m_uiNextOrder++;
+
+	if( !m_FreeBuffers.empty() )
+	{
+		packet.data.swap( m_FreeBuffers.back() );
+		m_FreeBuffers.pop_back();
+	}
+
+	const uint8_t* pBytes = reinterpret_cast<const uint8_t*>( pData );
+
+	packet.data.assign( pBytes, pBytes + uiSize );
+
+	m_Packets.push_back( std::move( packet ) );
+	std::push_heap( m_Packets.begin(), m_Packets.end(), &CSimulatedLink::ArrivesAfter );
+}
+
+bool CSimulatedLink::Receive( const double flTimeMS, std::vector<uint8_t>& packet )
+{
+	if( m_Packets.empty() || m_Packets.front().flArrivalMS > flTimeMS )
+		return false;
+
+	std::pop_heap( m_Packets.begin(), m_Packets.end(), &CSimulatedLink::ArrivesAfter );
+
+	packet.swap( m_Packets.back().data );
+
+	m_FreeBuffers.push_back( std::move( m_Packets.back().data ) );
+	m_Packets.pop_back();
+
+	++m_Stats.uiDelivered;
+
+	return true;
+}
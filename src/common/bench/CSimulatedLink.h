@@ -0,0 +1,157 @@
+#ifndef COMMON_BENCH_CSIMULATEDLINK_H
+#define COMMON_BENCH_CSIMULATEDLINK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/**
+*	Conditions of a simulated link, in one direction.
+*/
+struct LinkConditions_t
+{
+	/**
+	*	One way delay, in milliseconds.
+	*/
+	double flLatencyMS = 0;
+
+	/**
+	*	Most extra delay added to each packet at random, in milliseconds. Packets still arrive in order, unless they're reordered.
+	*/
+	double flJitterMS = 0;
+
+	/**
+	*	Chance that a packet is lost, between 0 and 1.
+	*/
+	double flLoss = 0;
+
+	/**
+	*	Chance that a packet is held back, so packets sent after it arrive first, between 0 and 1.
+	*/
+	double flReorder = 0;
+
+	/**
+	*	Most time a reordered packet is held back, in milliseconds.
+	*/
+	double flReorderDelayMS = 20;
+
+	/**
+	*	Speed of the link, in bytes per second, or 0 for no limit.
+	*/
+	double flBandwidth = 0;
+
+	/**
+	*	Longest time a packet waits for the link before it's dropped, in milliseconds. Only used with a bandwidth limit.
+	*/
+	double flQueueMS = 200;
+};
+
+/**
+*	Simulates one direction of a network link in virtual time: latency, jitter, loss, reordering and a bandwidth limit with a drop-tail queue.
+*	Packets are copied when they're sent, into buffers that are reused once they're received.
+*/
+class CSimulatedLink final
+{
+public:
+	/**
+	*	Bytes of IPv4 and UDP headers that each packet costs on top of its payload, counted against the bandwidth limit.
+	*/
+	static const size_t PACKET_OVERHEAD = 28;
+
+	struct Stats_t
+	{
+		uint64_t uiSent = 0;
+		uint64_t uiDelivered = 0;
+		uint64_t uiLost = 0;
+		uint64_t uiReordered = 0;
+
+		/**
+		*	Number of packets dropped because the link's queue was full.
+		*/
+		uint64_t uiQueueDropped = 0;
+
+		/**
+		*	Payload bytes sent, including packets that were lost.
+		*/
+		uint64_t uiBytesSent = 0;
+	};
+
+public:
+	CSimulatedLink( const LinkConditions_t& conditions, const uint32_t uiSeed );
+
+	/**
+	*	Sends a packet.
+	*	@param flTimeMS Current time, in milliseconds.
+	*/
+	void Send( const void* pData, const size_t uiSize, const double flTimeMS );
+
+	/**
+	*	Receives the next packet that arrived by the given time.
+	*	@param flTimeMS Current time, in milliseconds.
+	*	@param packet Receives the packet. Its previous buffer is reused for a later packet.
+	*	@return Whether a packet arrived.
+	*/
+	bool Receive( const double flTimeMS, std::vector<uint8_t>& packet );
+
+	const Stats_t& GetStats() const { return m_Stats; }
+
+private:
+	struct Packet_t
+	{
+		double flArrivalMS;
+
+		/**
+		*	Order the packet was sent in, so packets that arrive at the same time stay in order.
+		*/
+		uint64_t uiOrder;
+
+		std::vector<uint8_t> data;
+	};
+
+	/**
+	*	Orders the packet heap so the earliest arrival is at the front.
+	*/
+	static bool ArrivesAfter( const Packet_t& lhs, const Packet_t& rhs )
+	{
+		if( lhs.flArrivalMS != rhs.flArrivalMS )
+			return lhs.flArrivalMS > rhs.flArrivalMS;
+
+		return lhs.uiOrder > rhs.uiOrder;
+	}
+
+	double Random() { return m_Distribution( m_Random ); }
+
+private:
+	const LinkConditions_t m_Conditions;
+
+	std::mt19937 m_Random;
+	std::uniform_real_distribution<double> m_Distribution;
+
+	/**
+	*	Packets in flight, as a heap.
+	*/
+	std::vector<Packet_t> m_Packets;
+
+	std::vector<std::vector<uint8_t>> m_FreeBuffers;
+
+	/**
+	*	When the link finishes sending the packets queued so far.
+	*/
+	double m_flLinkFreeMS = 0;
+
+	/**
+	*	Arrival time of the last packet that wasn't reordered. Later packets don't arrive before it.
+	*/
+	double m_flLastArrivalMS = 0;
+
+	uint64_t m_uiNextOrder = 0;
+
+	Stats_t m_Stats;
+
+private:
+	CSimulatedLink( const CSimulatedLink& ) = delete;
+	CSimulatedLink& operator=( const CSimulatedLink& ) = delete;
+};
+
+#endif //COMMON_BENCH_CSIMULATEDLINK_H
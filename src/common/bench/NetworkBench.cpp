@@ -0,0 +1,376 @@
+/**
+*	@file
+*	CNetworkBuffer microbenchmarks. Measures the throughput of the bit level read and write methods across widths and start alignments.
+*	Usage: bench_network [-scale <iteration multiplier>] [-json <results file>]
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "CNetworkBuffer.h"
+
+#include "CBenchResults.h"
+
+namespace
+{
+/**
+*	Size of the buffer that is written to and read from. Large enough to hide the per pass overhead, small enough to stay in the cache.
+*/
+const size_t BUFFER_SIZE = 64 * 1024;
+
+/**
+*	Number of passes over the buffer that each benchmark makes, before scaling.
+*/
+const size_t PASSES = 2000;
+
+/**
+*	Widths that integers are written and read with.
+*/
+const size_t INTEGER_WIDTHS[] = { 1, 3, 8, 13, 17, 32 };
+
+/**
+*	Bit offsets that benchmarks start at. 0 is byte aligned.
+*/
+const size_t START_BITS[] = { 0, 3 };
+
+/**
+*	Sizes of the blocks written with WriteBits.
+*/
+const size_t BLOCK_SIZES[] = { 8, 64, 4096 };
+
+/**
+*	Lengths of the strings read with ReadString, excluding the terminator.
+*/
+const size_t STRING_LENGTHS[] = { 8, 64, 256 };
+
+/**
+*	Keeps reads from being optimized away.
+*/
+volatile unsigned int g_uiSink = 0;
+
+CBenchResults g_Results( "network" );
+
+void Report( const char* pszName, const uint64_t uiOperations, const double flSeconds, const uint64_t uiBits )
+{
+	g_Results.Report( pszName, uiOperations, flSeconds, uiBits / 8 );
+}
+
+/**
+*	Fills the buffer with values of the given width, each value being its index.
+*	@return Number of values written.
+*/
+size_t FillUnsigned( CNetworkBuffer& buffer, const size_t uiStartBit, const size_t uiNumBits )
+{
+	buffer.ResetToStart();
+	buffer.ExternalBitsWritten( uiStartBit );
+
+	const size_t uiCount = ( buffer.GetBitsLeft() - 32 ) / uiNumBits;
+	const unsigned int uiMask = static_cast<unsigned int>( ( static_cast<uint64_t>( 1 ) << uiNumBits ) - 1 );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		buffer.WriteUnsignedBitLong( static_cast<unsigned int>( uiIndex ) & uiMask, uiNumBits );
+	}
+
+	return uiCount;
+}
+
+void BenchWriteUnsigned( CNetworkBuffer& buffer, const BenchOptions_t& options )
+{
+	const size_t uiPasses = options.Scale( PASSES );
+
+	for( const auto uiNumBits : INTEGER_WIDTHS )
+	{
+		for( const auto uiStartBit : START_BITS )
+		{
+			uint64_t uiOperations = 0;
+
+			CBenchTimer timer;
+
+			for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+			{
+				uiOperations += FillUnsigned( buffer, uiStartBit, uiNumBits );
+			}
+
+			const double flSeconds = timer.GetSeconds();
+
+			char szName[ 64 ];
+
+			snprintf( szName, sizeof( szName ), "WriteUnsignedBitLong %2u bits, offset %u", static_cast<unsigned int>( uiNumBits ), static_cast<unsigned int>( uiStartBit ) );
+
+			Report( szName, uiOperations, flSeconds, uiOperations * uiNumBits );
+		}
+	}
+}
+
+void BenchWriteSigned( CNetworkBuffer& buffer, const BenchOptions_t& options )
+{
+	const size_t uiPasses = options.Scale( PASSES );
+
+	for( const auto uiNumBits : INTEGER_WIDTHS )
+	{
+		//Signed values need a sign bit.
+		if( uiNumBits < 2 )
+			continue;
+
+		for( const auto uiStartBit : START_BITS )
+		{
+			const size_t uiCount = ( buffer.GetMaxBits() - uiStartBit - 32 ) / uiNumBits;
+			const int iRange = static_cast<int>( std::min<uint64_t>( static_cast<uint64_t>( 1 ) << ( uiNumBits - 1 ), 0x40000000 ) );
+
+			uint64_t uiOperations = 0;
+
+			CBenchTimer timer;
+
+			for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+			{
+				buffer.ResetToStart();
+				buffer.ExternalBitsWritten( uiStartBit );
+
+				//Alternate between negative and positive values.
+				for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+				{
+					const int iValue = static_cast<int>( uiIndex % iRange );
+
+					buffer.WriteSignedBitLong( uiIndex & 1 ? -iValue : iValue, uiNumBits );
+				}
+
+				uiOperations += uiCount;
+			}
+
+			const double flSeconds = timer.GetSeconds();
+
+			char szName[ 64 ];
+
+			snprintf( szName, sizeof( szName ), "WriteSignedBitLong %2u bits, offset %u", static_cast<unsigned int>( uiNumBits ), static_cast<unsigned int>( uiStartBit ) );
+
+			Report( szName, uiOperations, flSeconds, uiOperations * uiNumBits );
+		}
+	}
+}
+
+void BenchWriteBits( CNetworkBuffer& buffer, const BenchOptions_t& options )
+{
+	const size_t uiPasses = options.Scale( PASSES );
+
+	std::vector<uint8_t> block;
+
+	for( const auto uiBlockSize : BLOCK_SIZES )
+	{
+		block.resize( uiBlockSize );
+
+		for( size_t uiByte = 0; uiByte < block.size(); ++uiByte )
+		{
+			block[ uiByte ] = static_cast<uint8_t>( uiByte * 7 );
+		}
+
+		for( const auto uiStartBit : START_BITS )
+		{
+			const size_t uiCount = ( buffer.GetMaxBytes() - 8 ) / uiBlockSize;
+
+			uint64_t uiOperations = 0;
+
+			CBenchTimer timer;
+
+			for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+			{
+				buffer.ResetToStart();
+				buffer.ExternalBitsWritten( uiStartBit );
+
+				for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+				{
+					buffer.WriteBits( block.data(), uiBlockSize << 3 );
+				}
+
+				uiOperations += uiCount;
+			}
+
+			const double flSeconds = timer.GetSeconds();
+
+			char szName[ 64 ];
+
+			snprintf( szName, sizeof( szName ), "WriteBits %4u bytes, offset %u", static_cast<unsigned int>( uiBlockSize ), static_cast<unsigned int>( uiStartBit ) );
+
+			Report( szName, uiOperations, flSeconds, uiOperations * ( uiBlockSize << 3 ) );
+		}
+	}
+}
+
+void BenchReadUnsigned( CNetworkBuffer& buffer, const BenchOptions_t& options )
+{
+	const size_t uiPasses = options.Scale( PASSES );
+
+	for( const auto uiNumBits : INTEGER_WIDTHS )
+	{
+		for( const auto uiStartBit : START_BITS )
+		{
+			const size_t uiCount = FillUnsigned( buffer, uiStartBit, uiNumBits );
+
+			uint64_t uiOperations = 0;
+
+			unsigned int uiSum = 0;
+
+			CBenchTimer timer;
+
+			for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+			{
+				buffer.ResetToStart();
+				buffer.ExternalBitsWritten( uiStartBit );
+
+				for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+				{
+					uiSum += buffer.ReadUnsignedBitLong( uiNumBits );
+				}
+
+				uiOperations += uiCount;
+			}
+
+			const double flSeconds = timer.GetSeconds();
+
+			g_uiSink = g_uiSink + uiSum;
+
+			char szName[ 64 ];
+
+			snprintf( szName, sizeof( szName ), "ReadUnsignedBitLong %2u bits, offset %u", static_cast<unsigned int>( uiNumBits ), static_cast<unsigned int>( uiStartBit ) );
+
+			Report( szName, uiOperations, flSeconds, uiOperations * uiNumBits );
+		}
+	}
+}
+
+void BenchReadBitFloat( CNetworkBuffer& buffer, const BenchOptions_t& options )
+{
+	const size_t uiPasses = options.Scale( PASSES );
+
+	for( const auto uiStartBit : START_BITS )
+	{
+		const size_t uiCount = ( buffer.GetMaxBits() - uiStartBit - 32 ) / 32;
+
+		buffer.ResetToStart();
+		buffer.ExternalBitsWritten( uiStartBit );
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			buffer.WriteBitFloat( uiIndex * ( uiIndex & 1 ? -0.25f : 0.25f ) );
+		}
+
+		uint64_t uiOperations = 0;
+
+		float flSum = 0;
+
+		CBenchTimer timer;
+
+		for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+		{
+			buffer.ResetToStart();
+			buffer.ExternalBitsWritten( uiStartBit );
+
+			for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+			{
+				flSum += buffer.ReadBitFloat();
+			}
+
+			uiOperations += uiCount;
+		}
+
+		const double flSeconds = timer.GetSeconds();
+
+		g_uiSink = g_uiSink + static_cast<unsigned int>( flSum );
+
+		char szName[ 64 ];
+
+		snprintf( szName, sizeof( szName ), "ReadBitFloat, offset %u", static_cast<unsigned int>( uiStartBit ) );
+
+		Report( szName, uiOperations, flSeconds, uiOperations * 32 );
+	}
+}
+
+void BenchReadString( CNetworkBuffer& buffer, const BenchOptions_t& options )
+{
+	const size_t uiPasses = options.Scale( PASSES );
+
+	std::vector<char> string;
+
+	for( const auto uiLength : STRING_LENGTHS )
+	{
+		string.assign( uiLength + 1, 0 );
+
+		for( size_t uiChar = 0; uiChar < uiLength; ++uiChar )
+		{
+			string[ uiChar ] = static_cast<char>( 'a' + uiChar % 26 );
+		}
+
+		for( const auto uiStartBit : START_BITS )
+		{
+			buffer.ResetToStart();
+			buffer.ExternalBitsWritten( uiStartBit );
+
+			const size_t uiCount = ( buffer.GetMaxBytes() - 8 ) / string.size();
+
+			for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+			{
+				buffer.WriteString( string.data() );
+			}
+
+			uint64_t uiOperations = 0;
+
+			char szString[ 512 ];
+
+			CBenchTimer timer;
+
+			for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+			{
+				buffer.ResetToStart();
+				buffer.ExternalBitsWritten( uiStartBit );
+
+				for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+				{
+					buffer.ReadString( szString, sizeof( szString ) );
+				}
+
+				uiOperations += uiCount;
+			}
+
+			const double flSeconds = timer.GetSeconds();
+
+			g_uiSink = g_uiSink + static_cast<unsigned char>( szString[ 0 ] );
+
+			char szName[ 64 ];
+
+			snprintf( szName, sizeof( szName ), "ReadString %3u chars, offset %u", static_cast<unsigned int>( uiLength ), static_cast<unsigned int>( uiStartBit ) );
+
+			Report( szName, uiOperations, flSeconds, uiOperations * ( string.size() << 3 ) );
+		}
+	}
+}
+}
+
+int main( int argc, char* argv[] )
+{
+	BenchOptions_t options;
+
+	if( !options.ParseCommandLine( argc, argv, "bench_network" ) )
+		return EXIT_FAILURE;
+
+	CNetworkBuffer::InitMasks();
+
+	//The buffer methods access whole dwords, so keep the memory aligned.
+	std::vector<uint32_t> data( BUFFER_SIZE / sizeof( uint32_t ) );
+
+	CNetworkBuffer buffer( "bench", reinterpret_cast<uint8_t*>( data.data() ), BUFFER_SIZE );
+
+	BenchWriteUnsigned( buffer, options );
+	BenchWriteSigned( buffer, options );
+	BenchWriteBits( buffer, options );
+	BenchReadUnsigned( buffer, options );
+	BenchReadBitFloat( buffer, options );
+	BenchReadString( buffer, options );
+
+	if( !g_Results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,585 @@
+/**
+*	@file
+*	CNetworkBuffer round trip fuzzer. Writes random sequences of fields with CNetworkBuffer and CNetworkBitWriter,
+*	checks the bits against a reference writer that works one bit at a time, then reads the fields back with CNetworkBuffer and CNetworkBitReader.
+*	Usage: fuzz_network [-iterations <count>] [-seed <seed>]
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CNetworkBuffer.h"
+
+namespace
+{
+struct Options_t
+{
+	size_t uiIterations = 100000;
+
+	unsigned int uiSeed = 1;
+};
+
+/**
+*	Largest buffer that is fuzzed, in bytes. Buffer sizes are a multiple of 4, since the buffer methods access whole dwords.
+*/
+const size_t MAX_BUFFER_SIZE = 1024;
+
+/**
+*	Longest string that is written, excluding the terminator.
+*/
+const size_t MAX_STRING_LENGTH = 48;
+
+/**
+*	Most bits written by a single WriteBits.
+*/
+const size_t MAX_BLOCK_BITS = 300;
+
+enum class FieldType
+{
+	UNSIGNED,
+	SIGNED,
+	BITFLOAT,
+	BITS,
+	STRING,
+	VARINT,
+	GAMMA,
+
+	COUNT
+};
+
+/**
+*	Number of types supported by CNetworkBitWriter and CNetworkBitReader. They only handle integers, which come first.
+*/
+const unsigned int INTEGER_TYPE_COUNT = static_cast<unsigned int>( FieldType::SIGNED ) + 1;
+
+struct Field_t
+{
+	FieldType type;
+
+	size_t uiNumBits;
+
+	/**
+	*	Integer value, or float bit pattern.
+	*/
+	unsigned int uiValue;
+
+	/**
+	*	Bits for BITS, characters for STRING.
+	*/
+	std::string szData;
+};
+
+/**
+*	Reference model of the bit stream: least significant bit first, one bit at a time.
+*/
+class CReferenceBits final
+{
+public:
+	size_t GetBitCount() const { return m_uiBitCount; }
+
+	const std::vector<uint8_t>& GetData() const { return m_Data; }
+
+	void WriteBit( const unsigned int uiBit )
+	{
+		if( ( m_uiBitCount & 7 ) == 0 )
+			m_Data.push_back( 0 );
+
+		m_Data.back() |= ( uiBit & 1 ) << ( m_uiBitCount & 7 );
+
+		++m_uiBitCount;
+	}
+
+	void WriteValue( const uint64_t uiValue, const size_t uiNumBits )
+	{
+		for( size_t uiBit = 0; uiBit < uiNumBits; ++uiBit )
+		{
+			WriteBit( static_cast<unsigned int>( uiValue >> uiBit ) );
+		}
+	}
+
+	void WriteField( const Field_t& field )
+	{
+		switch( field.type )
+		{
+		case FieldType::UNSIGNED:
+		case FieldType::SIGNED:
+		case FieldType::BITFLOAT:
+			WriteValue( field.uiValue, field.uiNumBits );
+			break;
+
+		case FieldType::BITS:
+			for( size_t uiBit = 0; uiBit < field.uiNumBits; ++uiBit )
+			{
+				WriteBit( static_cast<uint8_t>( field.szData[ uiBit >> 3 ] ) >> ( uiBit & 7 ) );
+			}
+			break;
+
+		case FieldType::STRING:
+			for( const char c : field.szData )
+			{
+				WriteValue( static_cast<uint8_t>( c ), 8 );
+			}
+
+			WriteValue( 0, 8 );
+			break;
+
+		case FieldType::VARINT:
+			{
+				unsigned int uiValue = field.uiValue;
+
+				for( ; uiValue >= 0x80; uiValue >>= 7 )
+				{
+					WriteValue( ( uiValue & 0x7F ) | 0x80, 8 );
+				}
+
+				WriteValue( uiValue, 8 );
+				break;
+			}
+
+		case FieldType::GAMMA:
+			{
+				const uint64_t uiCode = static_cast<uint64_t>( field.uiValue ) + 1;
+
+				size_t uiNumBits = 0;
+
+				while( uiCode >> ( uiNumBits + 1 ) )
+					++uiNumBits;
+
+				WriteValue( 0, uiNumBits );
+				WriteBit( 1 );
+				WriteValue( uiCode, uiNumBits );
+				break;
+			}
+
+		default: break;
+		}
+	}
+
+private:
+	std::vector<uint8_t> m_Data;
+
+	size_t m_uiBitCount = 0;
+};
+
+/**
+*	@return Mask of the lowest uiNumBits bits.
+*/
+unsigned int Mask( const size_t uiNumBits )
+{
+	return static_cast<unsigned int>( ( static_cast<uint64_t>( 1 ) << uiNumBits ) - 1 );
+}
+
+/**
+*	@return Value read by ReadSignedBitLong for the given bit pattern.
+*/
+int SignExtend( const unsigned int uiValue, const size_t uiNumBits )
+{
+	const unsigned int uiMagnitude = uiValue & Mask( uiNumBits - 1 );
+
+	if( uiValue & ( 1U << ( uiNumBits - 1 ) ) )
+		return -static_cast<int>( ( static_cast<uint64_t>( 1 ) << ( uiNumBits - 1 ) ) - uiMagnitude );
+
+	return static_cast<int>( uiMagnitude );
+}
+
+/**
+*	@return Size of the field, in bits.
+*/
+size_t GetFieldBits( const Field_t& field )
+{
+	switch( field.type )
+	{
+	case FieldType::STRING:
+		return ( field.szData.size() + 1 ) << 3;
+
+	case FieldType::VARINT:
+		{
+			size_t uiNumBits = 8;
+
+			for( unsigned int uiValue = field.uiValue; uiValue >= 0x80; uiValue >>= 7 )
+				uiNumBits += 8;
+
+			return uiNumBits;
+		}
+
+	case FieldType::GAMMA:
+		{
+			const uint64_t uiCode = static_cast<uint64_t>( field.uiValue ) + 1;
+
+			size_t uiNumBits = 0;
+
+			while( uiCode >> ( uiNumBits + 1 ) )
+				++uiNumBits;
+
+			return uiNumBits * 2 + 1;
+		}
+
+	default:
+		return field.uiNumBits;
+	}
+}
+
+Field_t MakeField( std::mt19937& random, const FieldType type )
+{
+	Field_t field;
+
+	field.type = type;
+
+	switch( type )
+	{
+	case FieldType::UNSIGNED:
+		field.uiNumBits = std::uniform_int_distribution<size_t>( 1, 32 )( random );
+		field.uiValue = random() & Mask( field.uiNumBits );
+		break;
+
+	case FieldType::SIGNED:
+		//The stored pattern. WriteSignedBitLong is passed the value it decodes to.
+		field.uiNumBits = std::uniform_int_distribution<size_t>( 2, 32 )( random );
+		field.uiValue = random() & Mask( field.uiNumBits );
+		break;
+
+	case FieldType::BITFLOAT:
+		field.uiNumBits = 32;
+		field.uiValue = random();
+		break;
+
+	case FieldType::BITS:
+		{
+			field.uiNumBits = std::uniform_int_distribution<size_t>( 0, MAX_BLOCK_BITS )( random );
+			field.szData.resize( BitByte( field.uiNumBits ) );
+
+			for( auto& c : field.szData )
+			{
+				c = static_cast<char>( random() );
+			}
+			break;
+		}
+
+	case FieldType::STRING:
+		{
+			field.szData.resize( std::uniform_int_distribution<size_t>( 0, MAX_STRING_LENGTH )( random ) );
+
+			//Any character but the terminator. Format specifiers are translated when read.
+			for( auto& c : field.szData )
+			{
+				c = static_cast<char>( std::uniform_int_distribution<int>( 1, 255 )( random ) );
+			}
+
+			field.uiNumBits = GetFieldBits( field );
+			break;
+		}
+
+	case FieldType::VARINT:
+	case FieldType::GAMMA:
+		//Mostly small values, which these encodings are meant for.
+		field.uiValue = random() & Mask( std::uniform_int_distribution<size_t>( 0, 32 )( random ) );
+		field.uiNumBits = GetFieldBits( field );
+		break;
+
+	default: break;
+	}
+
+	return field;
+}
+
+template<typename WRITER>
+void WriteInteger( WRITER& writer, const Field_t& field )
+{
+	if( field.type == FieldType::SIGNED )
+		writer.WriteSignedBitLong( SignExtend( field.uiValue, field.uiNumBits ), field.uiNumBits );
+	else
+		writer.WriteUnsignedBitLong( field.uiValue, field.uiNumBits );
+}
+
+void WriteField( CNetworkBuffer& buffer, const Field_t& field )
+{
+	switch( field.type )
+	{
+	case FieldType::UNSIGNED:
+	case FieldType::SIGNED:
+		WriteInteger( buffer, field );
+		break;
+
+	case FieldType::BITFLOAT:
+		{
+			float flValue;
+			memcpy( &flValue, &field.uiValue, sizeof( flValue ) );
+			buffer.WriteBitFloat( flValue );
+			break;
+		}
+
+	case FieldType::BITS:
+		buffer.WriteBits( field.szData.data(), field.uiNumBits );
+		break;
+
+	case FieldType::STRING:
+		buffer.WriteString( field.szData.c_str() );
+		break;
+
+	case FieldType::VARINT:
+		buffer.WriteVarInt32( field.uiValue );
+		break;
+
+	case FieldType::GAMMA:
+		buffer.WriteGammaInt32( field.uiValue );
+		break;
+
+	default: break;
+	}
+}
+
+template<typename READER>
+bool ReadInteger( READER& reader, const Field_t& field )
+{
+	if( field.type == FieldType::SIGNED )
+		return reader.ReadSignedBitLong( field.uiNumBits ) == SignExtend( field.uiValue, field.uiNumBits );
+
+	return reader.ReadUnsignedBitLong( field.uiNumBits ) == field.uiValue;
+}
+
+/**
+*	@return Whether the field read back is the one that was written.
+*/
+bool ReadField( CNetworkBuffer& buffer, const Field_t& field )
+{
+	switch( field.type )
+	{
+	case FieldType::UNSIGNED:
+	case FieldType::SIGNED:
+		return ReadInteger( buffer, field );
+
+	case FieldType::BITFLOAT:
+		{
+			const float flValue = buffer.ReadBitFloat();
+
+			unsigned int uiValue;
+			memcpy( &uiValue, &flValue, sizeof( uiValue ) );
+
+			return uiValue == field.uiValue;
+		}
+
+	case FieldType::BITS:
+		{
+			uint8_t data[ ( MAX_BLOCK_BITS + 7 ) / 8 ] = {};
+
+			buffer.ReadBits( data, field.uiNumBits );
+
+			//Bits in the last byte past the end are undefined.
+			for( size_t uiBit = 0; uiBit < field.uiNumBits; ++uiBit )
+			{
+				if( ( ( data[ uiBit >> 3 ] ^ static_cast<uint8_t>( field.szData[ uiBit >> 3 ] ) ) >> ( uiBit & 7 ) ) & 1 )
+					return false;
+			}
+
+			return true;
+		}
+
+	case FieldType::STRING:
+		{
+			char szString[ MAX_STRING_LENGTH + 2 ];
+
+			buffer.ReadString( szString, sizeof( szString ) );
+
+			std::string szExpected = field.szData;
+
+			std::replace( szExpected.begin(), szExpected.end(), '%', '.' );
+
+			return szExpected == szString;
+		}
+
+	case FieldType::VARINT:
+		return buffer.ReadVarInt32() == field.uiValue;
+
+	case FieldType::GAMMA:
+		return buffer.ReadGammaInt32() == field.uiValue;
+
+	default: return false;
+	}
+}
+
+/**
+*	Writes and reads back one random sequence of fields.
+*	@return Whether all checks passed.
+*/
+bool FuzzIteration( std::mt19937& random, const size_t uiIteration )
+{
+	const size_t uiBufferSize = std::uniform_int_distribution<size_t>( 1, MAX_BUFFER_SIZE / 4 )( random ) * 4;
+
+	//Whether only integers are used, so the accumulator writer and reader can be used too.
+	const bool bIntegersOnly = ( random() & 1 ) != 0;
+	const bool bUseBitWriter = bIntegersOnly && ( random() & 1 ) != 0;
+
+	const unsigned int uiTypeCount = bIntegersOnly ? INTEGER_TYPE_COUNT : static_cast<unsigned int>( FieldType::COUNT );
+
+	//Start at a random offset, so every alignment is covered.
+	const size_t uiStartBit = random() % 64;
+
+	std::vector<Field_t> fields;
+
+	size_t uiTotalBits = uiStartBit;
+
+	for( ;; )
+	{
+		auto field = MakeField( random, static_cast<FieldType>( random() % uiTypeCount ) );
+
+		if( uiTotalBits + GetFieldBits( field ) > ByteBit( uiBufferSize ) )
+			break;
+
+		uiTotalBits += GetFieldBits( field );
+		fields.emplace_back( std::move( field ) );
+	}
+
+	CReferenceBits reference;
+
+	reference.WriteValue( 0, uiStartBit );
+
+	for( const auto& field : fields )
+	{
+		reference.WriteField( field );
+	}
+
+	//Fill with garbage, the writers must clear the bits they write.
+	std::vector<uint32_t> data( uiBufferSize / sizeof( uint32_t ) );
+
+	for( auto& dword : data )
+	{
+		dword = random();
+	}
+
+	auto pData = reinterpret_cast<uint8_t*>( data.data() );
+
+	for( size_t uiByte = 0; uiByte < BitByte( uiStartBit ); ++uiByte )
+	{
+		pData[ uiByte ] = 0;
+	}
+
+	CNetworkBuffer buffer( "fuzz", pData, uiBufferSize, uiStartBit );
+
+	if( bUseBitWriter )
+	{
+		CNetworkBitWriter writer( buffer );
+
+		for( const auto& field : fields )
+		{
+			WriteInteger( writer, field );
+		}
+	}
+	else
+	{
+		for( const auto& field : fields )
+		{
+			WriteField( buffer, field );
+		}
+	}
+
+	if( buffer.HasOverflowed() || buffer.GetBitsInBuffer() != reference.GetBitCount() )
+	{
+		printf( "Iteration %u: wrote %u bits, expected %u\n", static_cast<unsigned int>( uiIteration ),
+				static_cast<unsigned int>( buffer.GetBitsInBuffer() ), static_cast<unsigned int>( reference.GetBitCount() ) );
+		return false;
+	}
+
+	for( size_t uiBit = 0; uiBit < reference.GetBitCount(); ++uiBit )
+	{
+		if( ( ( pData[ uiBit >> 3 ] ^ reference.GetData()[ uiBit >> 3 ] ) >> ( uiBit & 7 ) ) & 1 )
+		{
+			printf( "Iteration %u: bit %u differs from the reference (%s)\n", static_cast<unsigned int>( uiIteration ), static_cast<unsigned int>( uiBit ),
+					bUseBitWriter ? "CNetworkBitWriter" : "CNetworkBuffer" );
+			return false;
+		}
+	}
+
+	//A field that doesn't fit must overflow.
+	const size_t uiBitsLeft = buffer.GetBitsLeft();
+
+	buffer.WriteUnsignedBitLong( 0, std::min<size_t>( 32, uiBitsLeft + 1 ) );
+
+	if( uiBitsLeft < 32 && !buffer.HasOverflowed() )
+	{
+		printf( "Iteration %u: write past the end didn't overflow\n", static_cast<unsigned int>( uiIteration ) );
+		return false;
+	}
+
+	buffer.SetBuffer( "fuzz", pData, uiBufferSize, uiStartBit );
+
+	const bool bUseBitReader = bIntegersOnly && ( random() & 1 ) != 0;
+
+	bool bMatches = true;
+
+	if( bUseBitReader )
+	{
+		CNetworkBitReader reader( buffer );
+
+		for( size_t uiField = 0; uiField < fields.size() && bMatches; ++uiField )
+		{
+			bMatches = ReadInteger( reader, fields[ uiField ] );
+		}
+	}
+	else
+	{
+		for( size_t uiField = 0; uiField < fields.size() && bMatches; ++uiField )
+		{
+			bMatches = ReadField( buffer, fields[ uiField ] );
+		}
+	}
+
+	if( !bMatches || buffer.HasOverflowed() || buffer.GetBitsInBuffer() != reference.GetBitCount() )
+	{
+		printf( "Iteration %u: fields read back differ (%s)\n", static_cast<unsigned int>( uiIteration ),
+				bUseBitReader ? "CNetworkBitReader" : "CNetworkBuffer" );
+		return false;
+	}
+
+	return true;
+}
+}
+
+int main( int argc, char* argv[] )
+{
+	Options_t options;
+
+	for( int iArg = 1; iArg < argc; ++iArg )
+	{
+		const char* pszArg = argv[ iArg ];
+		const char* pszValue = iArg + 1 < argc ? argv[ iArg + 1 ] : nullptr;
+
+		if( !strcmp( pszArg, "-iterations" ) && pszValue )
+		{
+			options.uiIterations = strtoul( pszValue, nullptr, 10 );
+			++iArg;
+		}
+		else if( !strcmp( pszArg, "-seed" ) && pszValue )
+		{
+			options.uiSeed = strtoul( pszValue, nullptr, 10 );
+			++iArg;
+		}
+		else
+		{
+			printf( "Usage: fuzz_network [-iterations <count>] [-seed <seed>]\n" );
+			return EXIT_FAILURE;
+		}
+	}
+
+	CNetworkBuffer::InitMasks();
+
+	std::mt19937 random( options.uiSeed );
+
+	for( size_t uiIteration = 0; uiIteration < options.uiIterations; ++uiIteration )
+	{
+		if( !FuzzIteration( random, uiIteration ) )
+		{
+			printf( "Failed with seed %u\n", options.uiSeed );
+			return EXIT_FAILURE;
+		}
+	}
+
+	printf( "%u iterations passed\n", static_cast<unsigned int>( options.uiIterations ) );
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,882 @@
+/**
+*	@file
+*	Network load test. Runs a server with synthetic clients over simulated links in virtual time, and measures what the server spends on them:
+*	CPU time per client, bytes sent per tick and the time spent encoding delta snapshots into CNetworkBuffer messages.
+*	Snapshots use the same machinery a server would: entity states shared through CEntityStatePool, per client baselines in CClientSnapshots,
+*	and CDeltaEncoder to write the changed fields. Clients follow simple movement scripts and acknowledge the snapshots they receive.
+*	Only the server's work is timed; the links and clients are simulated between ticks.
+*	Which entities a client is sent is decided with CInterestSets: the world is split into cells that act as leafs, each cell's PVS is the cells
+*	within view distance of it, and only the entities in those cells are tested, once per cell and tick. -interest distance tests every entity instead.
+*	Usage: loadtest_network [-clients <count>] [-entities <count>] [-ticks <count>] [-tickrate <Hz>] [-latency <ms>] [-jitter <ms>] [-loss <percent>]
+*		[-reorder <percent>] [-bandwidth <kbit/s>] [-script <behaviour,...>] [-interest <pvs|distance>] [-seed <seed>] [-scale <tick multiplier>] [-json <results file>]
+*	Behaviours are idle, run, circle and random, assigned to clients in turn.
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "CClientSnapshots.h"
+#include "CDeltaEncoder.h"
+#include "CEntityStatePool.h"
+#include "CInterestSets.h"
+#include "CNetworkBuffer.h"
+#include "Logging.h"
+
+#include "CBenchResults.h"
+#include "CSimulatedLink.h"
+
+namespace
+{
+enum class Behaviour
+{
+	/**
+	*	Stands still.
+	*/
+	IDLE,
+
+	/**
+	*	Runs straight, turning every few seconds.
+	*/
+	RUN,
+
+	/**
+	*	Strafes in a circle.
+	*/
+	CIRCLE,
+
+	/**
+	*	Changes direction at random.
+	*/
+	RANDOM
+};
+
+/**
+*	How the entities that are sent to a client are found.
+*/
+enum class Interest
+{
+	/**
+	*	Tests the distance to every entity, for every client.
+	*/
+	DISTANCE,
+
+	/**
+	*	Only tests the entities in the PVS of the client's cell.
+	*/
+	PVS
+};
+
+struct Options_t : public BenchOptions_t
+{
+	size_t uiClients = 32;
+
+	/**
+	*	Number of entities that aren't players.
+	*/
+	size_t uiEntities = 512;
+
+	size_t uiTicks = 3000;
+
+	double flTickRate = 60;
+
+	/**
+	*	Conditions of every link. The bandwidth limit only applies to snapshots, moves are small.
+	*/
+	LinkConditions_t conditions;
+
+	std::vector<Behaviour> behaviours{ Behaviour::IDLE, Behaviour::RUN, Behaviour::CIRCLE, Behaviour::RANDOM };
+
+	Interest interest = Interest::PVS;
+
+	unsigned int uiSeed = 1;
+};
+
+/**
+*	Networked state of an entity. All members are 4 bytes, so there is no padding to compare.
+*/
+struct EntityState_t
+{
+	float origin[ 3 ];
+	float angles[ 3 ];
+	uint32_t uiModelIndex;
+	uint32_t uiSequence;
+	uint32_t uiFrame;
+	uint32_t uiEffects;
+};
+
+const DeltaField_t ENTITY_FIELDS[] =
+{
+	DELTA_FIELD( EntityState_t, origin[ 0 ], DeltaType::FLOAT, 24, 8.0f ),
+	DELTA_FIELD( EntityState_t, origin[ 1 ], DeltaType::FLOAT, 24, 8.0f ),
+	DELTA_FIELD( EntityState_t, origin[ 2 ], DeltaType::FLOAT, 24, 8.0f ),
+	DELTA_FIELD( EntityState_t, angles[ 0 ], DeltaType::FLOAT, 16, 65536.0f / 360.0f ),
+	DELTA_FIELD( EntityState_t, angles[ 1 ], DeltaType::FLOAT, 16, 65536.0f / 360.0f ),
+	DELTA_FIELD( EntityState_t, angles[ 2 ], DeltaType::FLOAT, 16, 65536.0f / 360.0f ),
+	DELTA_FIELD( EntityState_t, uiModelIndex, DeltaType::UNSIGNED, 10, 1.0f ),
+	DELTA_FIELD( EntityState_t, uiSequence, DeltaType::UNSIGNED, 8, 1.0f ),
+	DELTA_FIELD( EntityState_t, uiFrame, DeltaType::UNSIGNED, 8, 1.0f ),
+	DELTA_FIELD( EntityState_t, uiEffects, DeltaType::UNSIGNED, 8, 1.0f ),
+};
+
+const float PI = 3.14159265358979f;
+
+/**
+*	Size of the square world, in units. Entities are spread over it.
+*/
+const float WORLD_SIZE = 8192;
+
+/**
+*	Entities further than this from a client's player aren't sent to it.
+*/
+const float VIEW_DISTANCE = 2048;
+
+/**
+*	Size of the cells that stand in for a map's leafs, in units.
+*/
+const float INTEREST_CELL_SIZE = 512;
+
+const size_t INTEREST_CELLS_PER_AXIS = static_cast<size_t>( WORLD_SIZE / INTEREST_CELL_SIZE );
+
+const float PLAYER_SPEED = 320;
+
+const float NPC_SPEED = 120;
+
+/**
+*	Chance that an entity that isn't a player moves in a tick.
+*/
+const double NPC_MOVE_CHANCE = 0.25;
+
+/**
+*	Largest snapshot, in bytes. Larger snapshots are cut off and counted as overflowed.
+*/
+const size_t MAX_SNAPSHOT_SIZE = 64 * 1024;
+
+/**
+*	Size of a move packet, in bytes.
+*/
+const size_t MOVE_SIZE = 16;
+
+/**
+*	Time between turns of RUN clients, and direction changes of RANDOM clients, in ticks at 60 Hz.
+*/
+const size_t RUN_TURN_TICKS = 120;
+const size_t RANDOM_TURN_TICKS = 30;
+
+/**
+*	Bits of the entity index difference written before each entity in a snapshot.
+*/
+const size_t INDEX_BITS = 12;
+
+struct Move_t
+{
+	int iForward = 0;
+	int iSide = 0;
+
+	/**
+	*	View yaw, in degrees.
+	*/
+	float flYaw = 0;
+};
+
+struct Client_t
+{
+	Client_t( CEntityStatePool& pool, const LinkConditions_t& downConditions, const LinkConditions_t& upConditions, const uint32_t uiSeed )
+		: snapshots( pool )
+		, downlink( downConditions, uiSeed * 2 )
+		, uplink( upConditions, uiSeed * 2 + 1 )
+	{
+	}
+
+	Behaviour behaviour = Behaviour::IDLE;
+
+	/**
+	*	Player entity index.
+	*/
+	uint32_t uiEntity = 0;
+
+	CClientSnapshots snapshots;
+
+	CSimulatedLink downlink;
+	CSimulatedLink uplink;
+
+	//Client side.
+
+	/**
+	*	Latest snapshot sequence received, to acknowledge.
+	*/
+	bool bHasReceived = false;
+	uint32_t uiLatestReceived = 0;
+
+	Move_t move;
+
+	//Server side.
+
+	/**
+	*	Last move received from the client.
+	*/
+	Move_t lastMove;
+
+	std::unique_ptr<uint32_t[]> snapshotData;
+
+	size_t uiSnapshotSize = 0;
+};
+
+struct Totals_t
+{
+	double flServerSeconds = 0;
+	double flEncodeSeconds = 0;
+
+	uint64_t uiSnapshots = 0;
+	uint64_t uiSnapshotBytes = 0;
+	uint64_t uiMaxSnapshot = 0;
+	uint64_t uiOverflowed = 0;
+
+	/**
+	*	Entities written to snapshots, and entities that were sent before and unchanged, so weren't written.
+	*/
+	uint64_t uiEntitiesWritten = 0;
+	uint64_t uiEntitiesSkipped = 0;
+
+	uint64_t uiFullUpdates = 0;
+
+	/**
+	*	Entities whose relevance was tested, and interest sets that were built and reused.
+	*/
+	uint64_t uiEntitiesTested = 0;
+	uint64_t uiSetsBuilt = 0;
+	uint64_t uiSetsReused = 0;
+
+	size_t uiMaxStates = 0;
+	size_t uiMaxStateMemory = 0;
+};
+
+using Clock = std::chrono::steady_clock;
+
+bool ParseBehaviours( const char* pszScript, std::vector<Behaviour>& behaviours )
+{
+	behaviours.clear();
+
+	std::string szScript = pszScript;
+
+	size_t uiStart = 0;
+
+	while( uiStart <= szScript.size() )
+	{
+		size_t uiEnd = szScript.find( ',', uiStart );
+
+		if( uiEnd == std::string::npos )
+			uiEnd = szScript.size();
+
+		const std::string szName = szScript.substr( uiStart, uiEnd - uiStart );
+
+		if( szName == "idle" )
+			behaviours.push_back( Behaviour::IDLE );
+		else if( szName == "run" )
+			behaviours.push_back( Behaviour::RUN );
+		else if( szName == "circle" )
+			behaviours.push_back( Behaviour::CIRCLE );
+		else if( szName == "random" )
+			behaviours.push_back( Behaviour::RANDOM );
+		else
+			return false;
+
+		uiStart = uiEnd + 1;
+	}
+
+	return !behaviours.empty();
+}
+
+/**
+*	Runs a client's script for a tick.
+*/
+void UpdateMove( Client_t& client, const size_t uiTick, const double flTickRate, std::mt19937& random )
+{
+	//Scripts are written for 60 Hz, so scale them to the tick rate.
+	const size_t uiTick60 = static_cast<size_t>( uiTick * 60 / flTickRate );
+
+	auto& move = client.move;
+
+	switch( client.behaviour )
+	{
+	case Behaviour::IDLE:
+		move.iForward = 0;
+		move.iSide = 0;
+		break;
+
+	case Behaviour::RUN:
+		move.iForward = 400;
+		move.iSide = 0;
+		move.flYaw = static_cast<float>( ( uiTick60 / RUN_TURN_TICKS ) % 4 * 90 );
+		break;
+
+	case Behaviour::CIRCLE:
+		move.iForward = 0;
+		move.iSide = 400;
+		move.flYaw = static_cast<float>( std::fmod( uiTick * 180.0 / flTickRate, 360.0 ) );
+		break;
+
+	case Behaviour::RANDOM:
+		if( uiTick60 % RANDOM_TURN_TICKS == 0 )
+		{
+			move.iForward = static_cast<int>( random() % 801 ) - 400;
+			move.iSide = static_cast<int>( random() % 801 ) - 400;
+			move.flYaw = static_cast<float>( random() % 360 );
+		}
+		break;
+	}
+}
+
+/**
+*	Runs a client for a tick: reads the snapshots that arrived, and sends a move that acknowledges the latest one.
+*/
+void RunClient( Client_t& client, const double flTimeMS, std::vector<uint8_t>& packet )
+{
+	while( client.downlink.Receive( flTimeMS, packet ) )
+	{
+		if( packet.size() < sizeof( uint32_t ) )
+			continue;
+
+		//The sequence is the first thing in a snapshot.
+		uint32_t uiSequence;
+
+		memcpy( &uiSequence, packet.data(), sizeof( uiSequence ) );
+
+		if( !client.bHasReceived || uiSequence > client.uiLatestReceived )
+		{
+			client.bHasReceived = true;
+			client.uiLatestReceived = uiSequence;
+		}
+	}
+
+	uint32_t moveData[ MOVE_SIZE / sizeof( uint32_t ) ] = {};
+
+	CNetworkBuffer move( "move", reinterpret_cast<uint8_t*>( moveData ), sizeof( moveData ) );
+
+	move.WriteOneBit( client.bHasReceived ? 1 : 0 );
+	move.WriteUnsignedBitLong( client.uiLatestReceived, 32 );
+	move.WriteSignedBitLong( client.move.iForward, 12 );
+	move.WriteSignedBitLong( client.move.iSide, 12 );
+	move.WriteUnsignedBitLong( static_cast<unsigned int>( client.move.flYaw * 65536.0f / 360.0f ) & 0xFFFF, 16 );
+
+	client.uplink.Send( moveData, move.GetBytesInBuffer(), flTimeMS );
+}
+
+/**
+*	Reads the moves that arrived from a client.
+*/
+void ReadMoves( Client_t& client, const double flTimeMS, std::vector<uint8_t>& packet )
+{
+	while( client.uplink.Receive( flTimeMS, packet ) )
+	{
+		uint32_t moveData[ MOVE_SIZE / sizeof( uint32_t ) ] = {};
+
+		memcpy( moveData, packet.data(), std::min( packet.size(), sizeof( moveData ) ) );
+
+		CNetworkBuffer move( "move", reinterpret_cast<uint8_t*>( moveData ), std::min( packet.size(), sizeof( moveData ) ) );
+
+		const bool bHasAck = move.ReadOneBit() != 0;
+		const uint32_t uiAck = move.ReadUnsignedBitLong( 32 );
+
+		Move_t received;
+
+		received.iForward = move.ReadSignedBitLong( 12 );
+		received.iSide = move.ReadSignedBitLong( 12 );
+		received.flYaw = move.ReadUnsignedBitLong( 16 ) * 360.0f / 65536.0f;
+
+		if( move.HasOverflowed() )
+			continue;
+
+		if( bHasAck )
+			client.snapshots.Acknowledge( uiAck );
+
+		client.lastMove = received;
+	}
+}
+
+void Move( EntityState_t& state, const float flForward, const float flSide, const float flYaw, const float flDistance )
+{
+	const float flRadians = flYaw * PI / 180.0f;
+
+	const float flLength = std::sqrt( flForward * flForward + flSide * flSide );
+
+	if( flLength <= 0 )
+		return;
+
+	const float flDirX = ( flForward * std::cos( flRadians ) + flSide * std::sin( flRadians ) ) / flLength;
+	const float flDirY = ( flForward * std::sin( flRadians ) - flSide * std::cos( flRadians ) ) / flLength;
+
+	state.origin[ 0 ] = std::min( WORLD_SIZE, std::max( 0.0f, state.origin[ 0 ] + flDirX * flDistance ) );
+	state.origin[ 1 ] = std::min( WORLD_SIZE, std::max( 0.0f, state.origin[ 1 ] + flDirY * flDistance ) );
+	state.angles[ 1 ] = std::remainder( flYaw, 360.0f );
+}
+
+/**
+*	@return Cell that contains a point. Points on the far edges of the world are in the last cells.
+*/
+uint32_t GetInterestCell( const float* pOrigin )
+{
+	const size_t uiX = std::min( static_cast<size_t>( std::max( 0.0f, pOrigin[ 0 ] ) / INTEREST_CELL_SIZE ), INTEREST_CELLS_PER_AXIS - 1 );
+	const size_t uiY = std::min( static_cast<size_t>( std::max( 0.0f, pOrigin[ 1 ] ) / INTEREST_CELL_SIZE ), INTEREST_CELLS_PER_AXIS - 1 );
+
+	return static_cast<uint32_t>( uiY * INTEREST_CELLS_PER_AXIS + uiX );
+}
+
+/**
+*	Makes each cell's PVS the cells that have a point within view distance of any point in it, so it never misses an entity the distance test would send.
+*/
+void SetUpInterestCells( CInterestSets& sets )
+{
+	sets.Reset( INTEREST_CELLS_PER_AXIS * INTEREST_CELLS_PER_AXIS );
+
+	//Distance between the nearest points of two cells along an axis.
+	auto getGap = []( const size_t uiA, const size_t uiB )
+	{
+		const size_t uiGap = uiA > uiB ? uiA - uiB : uiB - uiA;
+
+		return uiGap <= 1 ? 0.0f : ( uiGap - 1 ) * INTEREST_CELL_SIZE;
+	};
+
+	for( size_t uiFrom = 0; uiFrom < sets.GetLeafCount(); ++uiFrom )
+	{
+		for( size_t uiTo = 0; uiTo < sets.GetLeafCount(); ++uiTo )
+		{
+			const float flX = getGap( uiFrom % INTEREST_CELLS_PER_AXIS, uiTo % INTEREST_CELLS_PER_AXIS );
+			const float flY = getGap( uiFrom / INTEREST_CELLS_PER_AXIS, uiTo / INTEREST_CELLS_PER_AXIS );
+
+			if( flX * flX + flY * flY <= VIEW_DISTANCE * VIEW_DISTANCE )
+				sets.SetVisible( uiFrom, uiTo );
+		}
+	}
+}
+
+/**
+*	Writes a client's snapshot: the entities it can see, as the difference against the last snapshot it acknowledged.
+*	Entities whose state is the same block as in the baseline are unchanged, and aren't written at all.
+*	@param candidates Entities that might be visible, in increasing order. The rest are not visible.
+*/
+void WriteSnapshot( Client_t& client, const uint32_t uiSequence, const std::vector<EntityState_t>& states, const std::vector<uint32_t>& candidates,
+	const std::vector<CEntityStatePool::StateIndex>& indices, const CEntityStatePool& pool, const CDeltaEncoder& encoder, Totals_t& totals )
+{
+	static const EntityState_t NULL_STATE = {};
+
+	const CClientSnapshots::Frame_t* pBaseline = client.snapshots.GetBaseline();
+
+	CNetworkBuffer buffer( "snapshot", reinterpret_cast<uint8_t*>( client.snapshotData.get() ), MAX_SNAPSHOT_SIZE );
+
+	buffer.WriteUnsignedBitLong( uiSequence, 32 );
+	buffer.WriteOneBit( pBaseline ? 1 : 0 );
+
+	if( pBaseline )
+		buffer.WriteUnsignedBitLong( pBaseline->uiSequence, 32 );
+	else
+		++totals.uiFullUpdates;
+
+	client.snapshots.BeginFrame( uiSequence );
+
+	const float* pViewOrigin = states[ client.uiEntity ].origin;
+
+	const size_t uiBaselineCount = pBaseline ? pBaseline->entities.size() : 0;
+
+	size_t uiBaselineIndex = 0;
+
+	uint32_t uiLastEntity = 0;
+
+	auto writeHeader = [ & ]( const uint32_t uiEntity, const bool bRemove )
+	{
+		buffer.WriteOneBit( 1 );
+		buffer.WriteUnsignedBitLong( uiEntity - uiLastEntity, INDEX_BITS );
+		buffer.WriteOneBit( bRemove ? 1 : 0 );
+
+		uiLastEntity = uiEntity;
+	};
+
+	for( const auto uiEntity : candidates )
+	{
+		//Entity 0 is the world, and is never sent.
+		if( uiEntity == 0 )
+			continue;
+
+		++totals.uiEntitiesTested;
+
+		const auto& state = states[ uiEntity ];
+
+		const float flX = state.origin[ 0 ] - pViewOrigin[ 0 ];
+		const float flY = state.origin[ 1 ] - pViewOrigin[ 1 ];
+
+		const bool bVisible = uiEntity == client.uiEntity || flX * flX + flY * flY <= VIEW_DISTANCE * VIEW_DISTANCE;
+
+		//Entities in the baseline that come before this one and are no longer visible are removed.
+		while( uiBaselineIndex < uiBaselineCount && pBaseline->entities[ uiBaselineIndex ].uiEntity < uiEntity )
+		{
+			writeHeader( pBaseline->entities[ uiBaselineIndex ].uiEntity, true );
+			++uiBaselineIndex;
+		}
+
+		const CClientSnapshots::EntityRef_t* pBaselineEntity = nullptr;
+
+		if( uiBaselineIndex < uiBaselineCount && pBaseline->entities[ uiBaselineIndex ].uiEntity == uiEntity )
+			pBaselineEntity = &pBaseline->entities[ uiBaselineIndex++ ];
+
+		if( !bVisible )
+		{
+			if( pBaselineEntity )
+				writeHeader( uiEntity, true );
+
+			continue;
+		}
+
+		client.snapshots.AddEntity( uiEntity, indices[ uiEntity ] );
+
+		if( pBaselineEntity && pBaselineEntity->uiState == indices[ uiEntity ] )
+		{
+			++totals.uiEntitiesSkipped;
+			continue;
+		}
+
+		writeHeader( uiEntity, false );
+
+		encoder.Encode( buffer, pBaselineEntity ? pool.GetState( pBaselineEntity->uiState ) : &NULL_STATE, &state );
+
+		++totals.uiEntitiesWritten;
+	}
+
+	while( uiBaselineIndex < uiBaselineCount )
+		writeHeader( pBaseline->entities[ uiBaselineIndex++ ].uiEntity, true );
+
+	buffer.WriteOneBit( 0 );
+
+	if( buffer.HasOverflowed() )
+		++totals.uiOverflowed;
+
+	client.uiSnapshotSize = buffer.GetBytesInBuffer();
+}
+
+/**
+*	Runs the load test.
+*/
+void Run( const Options_t& options, CBenchResults& results )
+{
+	CDeltaEncoder encoder;
+
+	if( !encoder.Initialize( ENTITY_FIELDS, sizeof( ENTITY_FIELDS ) / sizeof( ENTITY_FIELDS[ 0 ] ) ) )
+		return;
+
+	std::mt19937 random( options.uiSeed );
+	std::uniform_real_distribution<float> distribution( 0.0f, 1.0f );
+
+	CEntityStatePool pool( sizeof( EntityState_t ) );
+
+	//Moves are small, so they aren't held up by the bandwidth limit.
+	LinkConditions_t upConditions = options.conditions;
+
+	upConditions.flBandwidth = 0;
+
+	std::vector<std::unique_ptr<Client_t>> clients;
+
+	//Entity 0 is the world, players come next, then everything else.
+	std::vector<EntityState_t> states( 1 + options.uiClients + options.uiEntities );
+
+	memset( states.data(), 0, states.size() * sizeof( EntityState_t ) );
+
+	for( size_t uiIndex = 0; uiIndex < options.uiClients; ++uiIndex )
+	{
+		clients.emplace_back( new Client_t( pool, options.conditions, upConditions, static_cast<uint32_t>( options.uiSeed + uiIndex * 16 ) ) );
+
+		auto& client = *clients.back();
+
+		client.behaviour = options.behaviours[ uiIndex % options.behaviours.size() ];
+		client.uiEntity = static_cast<uint32_t>( 1 + uiIndex );
+		client.snapshotData.reset( new uint32_t[ MAX_SNAPSHOT_SIZE / sizeof( uint32_t ) ] );
+	}
+
+	for( size_t uiEntity = 1; uiEntity < states.size(); ++uiEntity )
+	{
+		auto& state = states[ uiEntity ];
+
+		state.origin[ 0 ] = distribution( random ) * WORLD_SIZE;
+		state.origin[ 1 ] = distribution( random ) * WORLD_SIZE;
+		state.angles[ 1 ] = static_cast<float>( random() % 360 );
+		state.uiModelIndex = static_cast<uint32_t>( uiEntity <= options.uiClients ? 1 : 2 + random() % 100 );
+	}
+
+	std::vector<CEntityStatePool::StateIndex> indices( states.size(), CEntityStatePool::INVALID_INDEX );
+
+	CInterestSets interestSets;
+
+	SetUpInterestCells( interestSets );
+
+	//Every entity is a candidate when testing distances.
+	std::vector<uint32_t> allEntities( states.size() );
+
+	for( size_t uiEntity = 0; uiEntity < allEntities.size(); ++uiEntity )
+		allEntities[ uiEntity ] = static_cast<uint32_t>( uiEntity );
+
+	std::vector<uint8_t> packet;
+
+	Totals_t totals;
+
+	const double flTickMS = 1000.0 / options.flTickRate;
+	const float flTickSeconds = static_cast<float>( 1.0 / options.flTickRate );
+
+	for( size_t uiTick = 0; uiTick < options.uiTicks; ++uiTick )
+	{
+		const double flTimeMS = uiTick * flTickMS;
+
+		for( auto& client : clients )
+		{
+			UpdateMove( *client, uiTick, options.flTickRate, random );
+			RunClient( *client, flTimeMS, packet );
+		}
+
+		//NPCs are simulated by the game, not the network code, so decide their moves outside of the timed part.
+		for( size_t uiEntity = 1 + options.uiClients; uiEntity < states.size(); ++uiEntity )
+		{
+			if( distribution( random ) < NPC_MOVE_CHANCE )
+			{
+				auto& state = states[ uiEntity ];
+
+				Move( state, 1, 0, state.angles[ 1 ] + ( distribution( random ) - 0.5f ) * 30.0f, NPC_SPEED * flTickSeconds );
+				state.uiFrame = ( state.uiFrame + 1 ) % 256;
+			}
+		}
+
+		const auto start = Clock::now();
+
+		for( auto& client : clients )
+		{
+			ReadMoves( *client, flTimeMS, packet );
+
+			const auto& move = client->lastMove;
+
+			Move( states[ client->uiEntity ], static_cast<float>( move.iForward ), static_cast<float>( move.iSide ), move.flYaw, PLAYER_SPEED * flTickSeconds );
+		}
+
+		for( size_t uiEntity = 1; uiEntity < states.size(); ++uiEntity )
+			indices[ uiEntity ] = pool.Intern( &states[ uiEntity ] );
+
+		if( options.interest == Interest::PVS )
+		{
+			interestSets.BeginFrame( states.size() );
+
+			for( uint32_t uiEntity = 1; uiEntity < states.size(); ++uiEntity )
+			{
+				const uint32_t uiCell = GetInterestCell( states[ uiEntity ].origin );
+
+				interestSets.LinkEntity( uiEntity, &uiCell, 1 );
+			}
+		}
+
+		const uint32_t uiSequence = static_cast<uint32_t>( uiTick + 1 );
+
+		double flEncodeSeconds = 0;
+
+		for( auto& client : clients )
+		{
+			const auto encodeStart = Clock::now();
+
+			//Clients in the same cell share its set.
+			const auto& candidates = options.interest == Interest::PVS
+				? interestSets.GetEntities( GetInterestCell( states[ client->uiEntity ].origin ) ) : allEntities;
+
+			WriteSnapshot( *client, uiSequence, states, candidates, indices, pool, encoder, totals );
+
+			flEncodeSeconds += std::chrono::duration<double>( Clock::now() - encodeStart ).count();
+		}
+
+		//The frames hold their own references now.
+		for( size_t uiEntity = 1; uiEntity < states.size(); ++uiEntity )
+			pool.Release( indices[ uiEntity ] );
+
+		totals.flServerSeconds += std::chrono::duration<double>( Clock::now() - start ).count();
+		totals.flEncodeSeconds += flEncodeSeconds;
+
+		if( options.interest == Interest::PVS )
+		{
+			totals.uiSetsBuilt += interestSets.GetStats().uiSetsBuilt;
+			totals.uiSetsReused += interestSets.GetStats().uiSetsReused;
+		}
+
+		for( auto& client : clients )
+		{
+			client->downlink.Send( client->snapshotData.get(), client->uiSnapshotSize, flTimeMS );
+
+			++totals.uiSnapshots;
+			totals.uiSnapshotBytes += client->uiSnapshotSize;
+			totals.uiMaxSnapshot = std::max<uint64_t>( totals.uiMaxSnapshot, client->uiSnapshotSize );
+		}
+
+		totals.uiMaxStates = std::max( totals.uiMaxStates, pool.GetCount() );
+		totals.uiMaxStateMemory = std::max( totals.uiMaxStateMemory, pool.GetMemoryUsage() );
+	}
+
+	CSimulatedLink::Stats_t downStats;
+
+	for( const auto& client : clients )
+	{
+		const auto& stats = client->downlink.GetStats();
+
+		downStats.uiSent += stats.uiSent;
+		downStats.uiDelivered += stats.uiDelivered;
+		downStats.uiLost += stats.uiLost;
+		downStats.uiReordered += stats.uiReordered;
+		downStats.uiQueueDropped += stats.uiQueueDropped;
+	}
+
+	const double flTicks = static_cast<double>( std::max<size_t>( 1, options.uiTicks ) );
+	const double flClientTicks = flTicks * std::max<size_t>( 1, options.uiClients );
+
+	const double flUSPerClient = totals.flServerSeconds * 1e6 / flClientTicks;
+	const double flTickBudgetUS = 1e6 / options.flTickRate;
+
+	printf( "%u clients, %u entities, %u ticks at %.0f Hz\n",
+		static_cast<unsigned int>( options.uiClients ), static_cast<unsigned int>( options.uiEntities ), static_cast<unsigned int>( options.uiTicks ), options.flTickRate );
+	printf( "Server CPU: %.2f us per client per tick, %.1f%% of the tick budget\n", flUSPerClient, totals.flServerSeconds * 1e6 / flTicks * 100.0 / flTickBudgetUS );
+
+	if( flUSPerClient > 0 )
+		printf( "Estimated clients per core: %.0f\n", flTickBudgetUS / flUSPerClient );
+
+	printf( "Snapshots: %.0f bytes per tick, %.1f bytes per client, largest %u, %u overflowed, %u full updates\n",
+		totals.uiSnapshotBytes / flTicks, totals.uiSnapshotBytes / flClientTicks, static_cast<unsigned int>( totals.uiMaxSnapshot ),
+		static_cast<unsigned int>( totals.uiOverflowed ), static_cast<unsigned int>( totals.uiFullUpdates ) );
+	printf( "Encode: %.2f us per snapshot, %llu entities written, %llu unchanged and skipped\n",
+		totals.uiSnapshots ? totals.flEncodeSeconds * 1e6 / totals.uiSnapshots : 0.0,
+		static_cast<unsigned long long>( totals.uiEntitiesWritten ), static_cast<unsigned long long>( totals.uiEntitiesSkipped ) );
+	printf( "Interest: %s, %.1f entities tested per snapshot, %.1f sets built and %.1f reused per tick\n",
+		options.interest == Interest::PVS ? "pvs" : "distance", totals.uiSnapshots ? static_cast<double>( totals.uiEntitiesTested ) / totals.uiSnapshots : 0.0,
+		totals.uiSetsBuilt / flTicks, totals.uiSetsReused / flTicks );
+	printf( "Shared states: at most %u, %u bytes\n", static_cast<unsigned int>( totals.uiMaxStates ), static_cast<unsigned int>( totals.uiMaxStateMemory ) );
+	printf( "Downlink: %llu sent, %llu delivered, %llu lost, %llu reordered, %llu dropped by the bandwidth limit\n",
+		static_cast<unsigned long long>( downStats.uiSent ), static_cast<unsigned long long>( downStats.uiDelivered ),
+		static_cast<unsigned long long>( downStats.uiLost ), static_cast<unsigned long long>( downStats.uiReordered ),
+		static_cast<unsigned long long>( downStats.uiQueueDropped ) );
+
+	results.Report( "server_tick", options.uiTicks, totals.flServerSeconds );
+	results.Report( "server_client_tick", static_cast<uint64_t>( flClientTicks ), totals.flServerSeconds );
+	results.Report( "snapshot_encode", totals.uiSnapshots, totals.flEncodeSeconds, totals.uiSnapshotBytes );
+}
+}
+
+//CDeltaEncoder logs through these. The load test doesn't need the engine's logging threads, so they write straight to the console.
+void Warning( const char* const pszFormat, ... )
+{
+	va_list list;
+
+	va_start( list, pszFormat );
+	vfprintf( stderr, pszFormat, list );
+	va_end( list );
+}
+
+static void WriteBinaryLogOutput( const char* pszText, size_t uiLength )
+{
+	fwrite( pszText, 1, uiLength, stderr );
+}
+
+LogFormatID_t Log_RegisterFormat( const char* const pszFormat )
+{
+	return Log_GetBinaryLog().RegisterFormat( pszFormat );
+}
+
+CBinaryLog& Log_GetBinaryLog()
+{
+	static CBinaryLog log( &WriteBinaryLogOutput );
+
+	return log;
+}
+
+int main( int argc, char* argv[] )
+{
+	Options_t options;
+
+	options.conditions.flLatencyMS = 40;
+	options.conditions.flJitterMS = 10;
+	options.conditions.flLoss = 0.01;
+	options.conditions.flBandwidth = 1000 * 1000 / 8;
+
+	for( int iArg = 1; iArg < argc; ++iArg )
+	{
+		if( options.ParseArg( argc, argv, iArg ) )
+			continue;
+
+		const char* pszArg = argv[ iArg ];
+		const char* pszValue = iArg + 1 < argc ? argv[ iArg + 1 ] : nullptr;
+
+		bool bValid = true;
+
+		if( !pszValue )
+			bValid = false;
+		else if( !strcmp( pszArg, "-clients" ) )
+			options.uiClients = static_cast<size_t>( std::max( 1, atoi( pszValue ) ) );
+		else if( !strcmp( pszArg, "-entities" ) )
+			options.uiEntities = static_cast<size_t>( std::max( 0, atoi( pszValue ) ) );
+		else if( !strcmp( pszArg, "-ticks" ) )
+			options.uiTicks = static_cast<size_t>( std::max( 1, atoi( pszValue ) ) );
+		else if( !strcmp( pszArg, "-tickrate" ) )
+			options.flTickRate = std::max( 1.0, atof( pszValue ) );
+		else if( !strcmp( pszArg, "-latency" ) )
+			options.conditions.flLatencyMS = std::max( 0.0, atof( pszValue ) );
+		else if( !strcmp( pszArg, "-jitter" ) )
+			options.conditions.flJitterMS = std::max( 0.0, atof( pszValue ) );
+		else if( !strcmp( pszArg, "-loss" ) )
+			options.conditions.flLoss = std::max( 0.0, atof( pszValue ) ) / 100.0;
+		else if( !strcmp( pszArg, "-reorder" ) )
+			options.conditions.flReorder = std::max( 0.0, atof( pszValue ) ) / 100.0;
+		else if( !strcmp( pszArg, "-bandwidth" ) )
+			options.conditions.flBandwidth = std::max( 0.0, atof( pszValue ) ) * 1000 / 8;
+		else if( !strcmp( pszArg, "-script" ) )
+			bValid = ParseBehaviours( pszValue, options.behaviours );
+		else if( !strcmp( pszArg, "-interest" ) )
+		{
+			if( !strcmp( pszValue, "pvs" ) )
+				options.interest = Interest::PVS;
+			else if( !strcmp( pszValue, "distance" ) )
+				options.interest = Interest::DISTANCE;
+			else
+				bValid = false;
+		}
+		else if( !strcmp( pszArg, "-seed" ) )
+			options.uiSeed = static_cast<unsigned int>( strtoul( pszValue, nullptr, 10 ) );
+		else
+			bValid = false;
+
+		if( !bValid )
+		{
+			printf( "Usage: loadtest_network [-clients <count>] [-entities <count>] [-ticks <count>] [-tickrate <Hz>] [-latency <ms>] [-jitter <ms>] [-loss <percent>]\n"
+				"\t[-reorder <percent>] [-bandwidth <kbit/s>] [-script <idle|run|circle|random,...>] [-interest <pvs|distance>] [-seed <seed>] [-scale <tick multiplier>]\n"
+				"\t[-json <results file>]\n" );
+			return EXIT_FAILURE;
+		}
+
+		++iArg;
+	}
+
+	//Snapshots write entity index differences with INDEX_BITS bits.
+	if( 1 + options.uiClients + options.uiEntities > ( 1 << INDEX_BITS ) )
+	{
+		printf( "At most %u clients and entities are supported\n", ( 1 << INDEX_BITS ) - 1 );
+		return EXIT_FAILURE;
+	}
+
+	options.uiTicks = options.Scale( options.uiTicks );
+
+	CNetworkBuffer::InitMasks();
+
+	CBenchResults results( "loadtest" );
+
+	Run( options, results );
+
+	if( !results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,415 @@
+/**
+*	@file
+*	Inter-thread queue benchmarks and stress test. Measures CSPSCQueue and CMPSCQueue, polling and blocking, against a mutex and a deque.
+*	Every run also checks that each producer's values arrive once and in order, and that blocking pops wake up and Close ends them,
+*	so build it with -fsanitize=thread after changing the queues to check them for races.
+*	Usage: bench_queues [-scale <iteration multiplier>] [-json <results file>]
+*/
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "CMPSCQueue.h"
+#include "CSPSCQueue.h"
+
+#include "CBenchResults.h"
+
+namespace
+{
+/**
+*	Number of values each producer pushes, before scaling.
+*/
+const size_t VALUES_PER_PRODUCER = 2000000;
+
+/**
+*	Capacity of the queues.
+*/
+const size_t CAPACITY = 1024;
+
+/**
+*	Number of producers in the multiple producer benchmarks.
+*/
+const unsigned int NUM_PRODUCERS = 4;
+
+CBenchResults g_Results( "queues" );
+
+bool g_bFailed = false;
+
+/**
+*	Values carry the producer in the upper bits and a sequence number in the lower ones, so the consumer can check the order.
+*/
+uint64_t MakeValue( const unsigned int uiProducer, const size_t uiSequence )
+{
+	return ( static_cast<uint64_t>( uiProducer ) << 40 ) | uiSequence;
+}
+
+/**
+*	Checks values as they are popped.
+*/
+class CValueChecker final
+{
+public:
+	CValueChecker( const unsigned int uiProducers )
+		: m_NextSequence( uiProducers, 0 )
+	{
+	}
+
+	void Check( const uint64_t uiValue )
+	{
+		const auto uiProducer = static_cast<size_t>( uiValue >> 40 );
+		const auto uiSequence = static_cast<size_t>( uiValue & ( ( static_cast<uint64_t>( 1 ) << 40 ) - 1 ) );
+
+		if( uiProducer >= m_NextSequence.size() || uiSequence != m_NextSequence[ uiProducer ] )
+		{
+			if( m_bValid )
+				printf( "Value out of order: producer %u, sequence %u\n", static_cast<unsigned int>( uiProducer ), static_cast<unsigned int>( uiSequence ) );
+
+			m_bValid = false;
+			return;
+		}
+
+		++m_NextSequence[ uiProducer ];
+	}
+
+	/**
+	*	@return Whether every producer's values all arrived in order.
+	*/
+	bool Finish( const char* pszName, const size_t uiValuesPerProducer ) const
+	{
+		bool bValid = m_bValid;
+
+		for( auto uiCount : m_NextSequence )
+		{
+			bValid = bValid && uiCount == uiValuesPerProducer;
+		}
+
+		if( !bValid )
+		{
+			printf( "%s: FAILED, values were lost, duplicated or reordered\n", pszName );
+			g_bFailed = true;
+		}
+
+		return bValid;
+	}
+
+private:
+	std::vector<size_t> m_NextSequence;
+
+	bool m_bValid = true;
+};
+
+/**
+*	Mutex and deque, the way queues were written before. Same interface as the lock-free queues.
+*/
+class CLockedQueue final
+{
+public:
+	CLockedQueue( const size_t uiCapacity )
+		: m_uiCapacity( uiCapacity )
+	{
+	}
+
+	bool TryPush( const uint64_t uiValue )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			if( m_Values.size() >= m_uiCapacity )
+				return false;
+
+			m_Values.push_back( uiValue );
+		}
+
+		m_Condition.notify_one();
+
+		return true;
+	}
+
+	bool TryPop( uint64_t& uiValue )
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( m_Values.empty() )
+			return false;
+
+		uiValue = m_Values.front();
+		m_Values.pop_front();
+
+		return true;
+	}
+
+	bool Pop( uint64_t& uiValue )
+	{
+		std::unique_lock<std::mutex> lock( m_Mutex );
+
+		m_Condition.wait( lock, [ this ]() { return !m_Values.empty() || m_bClosed; } );
+
+		if( m_Values.empty() )
+			return false;
+
+		uiValue = m_Values.front();
+		m_Values.pop_front();
+
+		return true;
+	}
+
+	void Close()
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+			m_bClosed = true;
+		}
+
+		m_Condition.notify_all();
+	}
+
+private:
+	const size_t m_uiCapacity;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+
+	std::deque<uint64_t> m_Values;
+
+	bool m_bClosed = false;
+};
+
+template<typename QUEUE>
+void Produce( QUEUE& queue, const unsigned int uiProducer, const size_t uiCount )
+{
+	for( size_t uiSequence = 0; uiSequence < uiCount; ++uiSequence )
+	{
+		while( !queue.TryPush( MakeValue( uiProducer, uiSequence ) ) )
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+/**
+*	Pushes values from producer threads and pops them on this thread, checking them as they arrive.
+*	@param bBlocking Whether the consumer uses Pop instead of polling with TryPop. The queue is closed once the producers finish.
+*/
+template<typename QUEUE>
+void BenchQueue( const char* pszName, QUEUE& queue, const unsigned int uiProducers, const size_t uiValuesPerProducer, const bool bBlocking )
+{
+	CValueChecker checker( uiProducers );
+
+	const size_t uiTotal = uiValuesPerProducer * uiProducers;
+
+	CBenchTimer timer;
+
+	std::vector<std::thread> producers;
+
+	for( unsigned int uiProducer = 0; uiProducer < uiProducers; ++uiProducer )
+	{
+		producers.emplace_back( [ &queue, uiProducer, uiValuesPerProducer ]()
+			{
+				Produce( queue, uiProducer, uiValuesPerProducer );
+			}
+		);
+	}
+
+	//Closes the queue once every producer is done, so the blocking consumer also checks that Close ends the wait.
+	std::thread closer( [ &queue, &producers ]()
+		{
+			for( auto& producer : producers )
+			{
+				producer.join();
+			}
+
+			queue.Close();
+		}
+	);
+
+	uint64_t uiValue;
+	size_t uiPopped = 0;
+
+	if( bBlocking )
+	{
+		while( queue.Pop( uiValue ) )
+		{
+			checker.Check( uiValue );
+			++uiPopped;
+		}
+	}
+	else
+	{
+		while( uiPopped < uiTotal )
+		{
+			if( queue.TryPop( uiValue ) )
+			{
+				checker.Check( uiValue );
+				++uiPopped;
+			}
+			else
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	const double flSeconds = timer.GetSeconds();
+
+	closer.join();
+
+	if( checker.Finish( pszName, uiValuesPerProducer ) )
+		g_Results.Report( pszName, uiPopped, flSeconds, uiPopped * sizeof( uint64_t ) );
+}
+
+void BenchSingleProducer( const BenchOptions_t& options )
+{
+	const size_t uiCount = options.Scale( VALUES_PER_PRODUCER );
+
+	{
+		CSPSCQueue<uint64_t> queue( CAPACITY );
+		BenchQueue( "CSPSCQueue TryPop", queue, 1, uiCount, false );
+	}
+
+	{
+		CSPSCQueue<uint64_t> queue( CAPACITY );
+		BenchQueue( "CSPSCQueue Pop", queue, 1, uiCount, true );
+	}
+
+	{
+		CMPSCQueue<uint64_t> queue( CAPACITY );
+		BenchQueue( "CMPSCQueue TryPop, 1 producer", queue, 1, uiCount, false );
+	}
+
+	{
+		CLockedQueue queue( CAPACITY );
+		BenchQueue( "mutex + deque Pop, 1 producer", queue, 1, uiCount, true );
+	}
+}
+
+void BenchMultipleProducers( const BenchOptions_t& options )
+{
+	const size_t uiCount = options.Scale( VALUES_PER_PRODUCER / NUM_PRODUCERS );
+
+	{
+		CMPSCQueue<uint64_t> queue( CAPACITY );
+		BenchQueue( "CMPSCQueue TryPop, 4 producers", queue, NUM_PRODUCERS, uiCount, false );
+	}
+
+	{
+		CMPSCQueue<uint64_t> queue( CAPACITY );
+		BenchQueue( "CMPSCQueue Pop, 4 producers", queue, NUM_PRODUCERS, uiCount, true );
+	}
+
+	{
+		CLockedQueue queue( CAPACITY );
+		BenchQueue( "mutex + deque Pop, 4 producers", queue, NUM_PRODUCERS, uiCount, true );
+	}
+}
+
+/**
+*	Measures how long a value takes to reach a consumer that is asleep in Pop, which is what a worker waiting for commands sees.
+*/
+template<typename QUEUE>
+void BenchWakeup( const char* pszName, const size_t uiRounds )
+{
+	QUEUE request( 2 );
+	QUEUE response( 2 );
+
+	std::thread echo( [ &request, &response ]()
+		{
+			uint64_t uiValue;
+
+			while( request.Pop( uiValue ) )
+			{
+				while( !response.TryPush( uiValue ) )
+				{
+					std::this_thread::yield();
+				}
+			}
+		}
+	);
+
+	CValueChecker checker( 1 );
+
+	CBenchTimer timer;
+
+	for( size_t uiRound = 0; uiRound < uiRounds; ++uiRound )
+	{
+		request.TryPush( MakeValue( 0, uiRound ) );
+
+		uint64_t uiValue;
+
+		if( response.Pop( uiValue ) )
+			checker.Check( uiValue );
+	}
+
+	const double flSeconds = timer.GetSeconds();
+
+	request.Close();
+	echo.join();
+
+	if( checker.Finish( pszName, uiRounds ) )
+		g_Results.Report( pszName, uiRounds, flSeconds );
+}
+
+void BenchWakeups( const BenchOptions_t& options )
+{
+	const size_t uiRounds = options.Scale( VALUES_PER_PRODUCER / 20 );
+
+	BenchWakeup<CSPSCQueue<uint64_t>>( "CSPSCQueue round trip", uiRounds );
+	BenchWakeup<CMPSCQueue<uint64_t>>( "CMPSCQueue round trip", uiRounds );
+}
+
+/**
+*	Checks that values the consumer never popped are destroyed with the queue.
+*/
+void CheckDestruction()
+{
+	const auto value = std::make_shared<int>( 0 );
+
+	{
+		CSPSCQueue<std::shared_ptr<int>> spsc( 4 );
+		CMPSCQueue<std::shared_ptr<int>> mpsc( 4 );
+
+		for( int iValue = 0; iValue < 3; ++iValue )
+		{
+			spsc.TryPush( value );
+			mpsc.TryPush( value );
+		}
+
+		std::shared_ptr<int> popped;
+
+		spsc.TryPop( popped );
+		mpsc.TryPop( popped );
+	}
+
+	if( value.use_count() != 1 )
+	{
+		printf( "Queues leaked %ld values\n", value.use_count() - 1 );
+		g_bFailed = true;
+	}
+}
+}
+
+int main( int argc, char* argv[] )
+{
+	BenchOptions_t options;
+
+	if( !options.ParseCommandLine( argc, argv, "bench_queues" ) )
+		return EXIT_FAILURE;
+
+	CheckDestruction();
+
+	BenchSingleProducer( options );
+	BenchMultipleProducers( options );
+	BenchWakeups( options );
+
+	if( !g_Results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return g_bFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
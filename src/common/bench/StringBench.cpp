@@ -0,0 +1,300 @@
+/**
+*	@file
+*	String handling microbenchmarks. Measures tokenization, CCommand and CCommandView construction, StringHash and UTIL_TokenMatches
+*	against a precompiled CWildcardPattern.
+*	Usage: bench_strings [-scale <iteration multiplier>] [-json <results file>]
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "CCommand.h"
+#include "CCommandView.h"
+#include "CWildcardPattern.h"
+#include "StringUtils.h"
+#include "Tokenization.h"
+
+#include "CBenchResults.h"
+
+namespace
+{
+/**
+*	Number of passes over the inputs that each benchmark makes, before scaling.
+*/
+const size_t PASSES = 20000;
+
+/**
+*	Commands as they show up in config files and the console.
+*/
+const char* const COMMANDS[] =
+{
+	"fps_max 100",
+	"bind \"MOUSE1\" \"+attack\"",
+	"exec config.cfg",
+	"connect 192.168.1.10:27015",
+	"alias +jumpduck \"+jump; +duck\"",
+	"say \"hello there, this is a longer chat message with a few words in it\"",
+	"developer 1",
+	"echo {test} (with) control, characters"
+};
+
+/**
+*	Names that are hashed, cvar names and longer file paths.
+*/
+const char* const NAMES[] =
+{
+	"fps_max",
+	"developer",
+	"sv_gravity",
+	"cl_updaterate",
+	"gfx/vgui/640_mouse.tga",
+	"resource/ui/scoreboard_background.tga",
+	"sound/weapons/explode3.wav",
+	"models/player/gordon/gordon.mdl"
+};
+
+/**
+*	Wildcard patterns, matched against NAMES.
+*/
+const char* const PATTERNS[] =
+{
+	"*.tga",
+	"gfx/*",
+	"sv_*",
+	"*player*.mdl",
+	"*/*/*"
+};
+
+/**
+*	Number of times the commands are repeated in the script that is tokenized.
+*/
+const size_t SCRIPT_REPEATS = 256;
+
+/**
+*	Keeps results from being optimized away.
+*/
+volatile size_t g_uiSink = 0;
+
+CBenchResults g_Results( "strings" );
+
+uint64_t GetCommandBytes()
+{
+	uint64_t uiBytes = 0;
+
+	for( const auto pszCommand : COMMANDS )
+	{
+		uiBytes += strlen( pszCommand );
+	}
+
+	return uiBytes;
+}
+
+void BenchParse( const BenchOptions_t& options )
+{
+	std::string szScript;
+
+	for( size_t uiRepeat = 0; uiRepeat < SCRIPT_REPEATS; ++uiRepeat )
+	{
+		for( const auto pszCommand : COMMANDS )
+		{
+			szScript += pszCommand;
+			szScript += '\n';
+		}
+	}
+
+	const size_t uiPasses = options.Scale( PASSES / SCRIPT_REPEATS );
+
+	char szToken[ tokenization::MINIMUM_BUFFER_SIZE ];
+
+	{
+		uint64_t uiTokens = 0;
+
+		CBenchTimer timer;
+
+		for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+		{
+			for( const char* pszData = tokenization::Parse( szScript.c_str(), szToken, sizeof( szToken ) ); pszData;
+				 pszData = tokenization::Parse( pszData, szToken, sizeof( szToken ) ) )
+			{
+				++uiTokens;
+			}
+		}
+
+		g_Results.Report( "tokenization::Parse", uiTokens, timer.GetSeconds(), uiPasses * szScript.size() );
+	}
+
+	{
+		uint64_t uiTokens = 0;
+
+		CBenchTimer timer;
+
+		const char* pszToken;
+		size_t uiLength;
+
+		for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+		{
+			for( const char* pszData = tokenization::ParseSpan( szScript.c_str(), pszToken, uiLength ); pszData;
+				 pszData = tokenization::ParseSpan( pszData, pszToken, uiLength ) )
+			{
+				++uiTokens;
+			}
+		}
+
+		g_Results.Report( "tokenization::ParseSpan", uiTokens, timer.GetSeconds(), uiPasses * szScript.size() );
+	}
+}
+
+void BenchCommand( const BenchOptions_t& options )
+{
+	const size_t uiPasses = options.Scale( PASSES );
+	const uint64_t uiBytes = GetCommandBytes();
+
+	{
+		CCommand command;
+
+		CBenchTimer timer;
+
+		for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+		{
+			for( const auto pszCommand : COMMANDS )
+			{
+				command.Initialize( pszCommand );
+				g_uiSink += command.ArgC();
+			}
+		}
+
+		g_Results.Report( "CCommand::Initialize", uiPasses * ( sizeof( COMMANDS ) / sizeof( *COMMANDS ) ), timer.GetSeconds(), uiPasses * uiBytes );
+	}
+
+	{
+		CCommandView command;
+
+		CBenchTimer timer;
+
+		for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+		{
+			for( const auto pszCommand : COMMANDS )
+			{
+				command.Initialize( pszCommand );
+				g_uiSink += command.ArgC();
+			}
+		}
+
+		g_Results.Report( "CCommandView::Initialize", uiPasses * ( sizeof( COMMANDS ) / sizeof( *COMMANDS ) ), timer.GetSeconds(), uiPasses * uiBytes );
+	}
+
+	{
+		CCommandView command;
+
+		CBenchTimer timer;
+
+		for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+		{
+			for( const auto pszCommand : COMMANDS )
+			{
+				command.Initialize( pszCommand );
+
+				//Asking for a C string materializes the tokens, which is what a command handler that uses Arg pays.
+				g_uiSink += strlen( command.Arg( command.ArgC() - 1 ) );
+			}
+		}
+
+		g_Results.Report( "CCommandView::Initialize + Arg", uiPasses * ( sizeof( COMMANDS ) / sizeof( *COMMANDS ) ), timer.GetSeconds(), uiPasses * uiBytes );
+	}
+}
+
+void BenchStringHash( const BenchOptions_t& options )
+{
+	const size_t uiPasses = options.Scale( PASSES * 4 );
+
+	uint64_t uiBytes = 0;
+
+	for( const auto pszName : NAMES )
+	{
+		uiBytes += strlen( pszName );
+	}
+
+	CBenchTimer timer;
+
+	for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+	{
+		for( const auto pszName : NAMES )
+		{
+			g_uiSink += StringHash( pszName );
+		}
+	}
+
+	g_Results.Report( "StringHash", uiPasses * ( sizeof( NAMES ) / sizeof( *NAMES ) ), timer.GetSeconds(), uiPasses * uiBytes );
+}
+
+void BenchTokenMatches( const BenchOptions_t& options )
+{
+	const size_t uiPasses = options.Scale( PASSES / 4 );
+
+	const uint64_t uiMatches = uiPasses * ( sizeof( PATTERNS ) / sizeof( *PATTERNS ) ) * ( sizeof( NAMES ) / sizeof( *NAMES ) );
+
+	{
+		CBenchTimer timer;
+
+		for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+		{
+			for( const auto pszPattern : PATTERNS )
+			{
+				for( const auto pszName : NAMES )
+				{
+					g_uiSink += UTIL_TokenMatches( pszName, pszPattern );
+				}
+			}
+		}
+
+		g_Results.Report( "UTIL_TokenMatches", uiMatches, timer.GetSeconds() );
+	}
+
+	{
+		std::vector<CWildcardPattern> patterns;
+
+		for( const auto pszPattern : PATTERNS )
+		{
+			patterns.emplace_back( pszPattern );
+		}
+
+		CBenchTimer timer;
+
+		for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+		{
+			for( const auto& pattern : patterns )
+			{
+				for( const auto pszName : NAMES )
+				{
+					g_uiSink += pattern.Matches( pszName );
+				}
+			}
+		}
+
+		g_Results.Report( "CWildcardPattern::Matches", uiMatches, timer.GetSeconds() );
+	}
+}
+}
+
+int main( int argc, char* argv[] )
+{
+	BenchOptions_t options;
+
+	if( !options.ParseCommandLine( argc, argv, "bench_strings" ) )
+		return EXIT_FAILURE;
+
+	BenchParse( options );
+	BenchCommand( options );
+	BenchStringHash( options );
+	BenchTokenMatches( options );
+
+	if( !g_Results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
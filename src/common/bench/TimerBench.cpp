@@ -0,0 +1,267 @@
+/**
+*	@file
+*	Clock and timer microbenchmarks. Measures reading Plat_GetNanoseconds against std::chrono::steady_clock,
+*	and CTimerWheel against timers kept in a std::multimap ordered by expiry, with a workload like retransmit timers:
+*	each tick, some timers are scheduled, most are cancelled before they expire, and the host loop advances the time.
+*	Every run also checks that the wheel runs the same timers as the map.
+*	Usage: bench_timers [-scale <iteration multiplier>] [-json <results file>]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <random>
+#include <vector>
+
+#include "Clock.h"
+#include "CTimerWheel.h"
+
+#include "CBenchResults.h"
+
+namespace
+{
+/**
+*	Number of clock reads, before scaling.
+*/
+const size_t CLOCK_READS = 10000000;
+
+/**
+*	Number of ticks the timer benchmarks run for, before scaling.
+*/
+const size_t TICKS = 20000;
+
+/**
+*	Timers scheduled each tick.
+*/
+const size_t TIMERS_PER_TICK = 64;
+
+/**
+*	Microseconds per tick, like a 1000 Hz host loop.
+*/
+const uint64_t TICK_US = 1000;
+
+/**
+*	Out of 16 timers, how many are cancelled before they expire, like retransmit timers of messages that were acknowledged.
+*/
+const unsigned int CANCELLED_PER_16 = 14;
+
+/**
+*	Keeps results from being optimized away.
+*/
+volatile uint64_t g_uiSink = 0;
+
+CBenchResults g_Results( "timers" );
+
+bool g_bFailed = false;
+
+void BenchClocks( const BenchOptions_t& options )
+{
+	const size_t uiReads = options.Scale( CLOCK_READS );
+
+	{
+		uint64_t uiSum = 0;
+
+		CBenchTimer timer;
+
+		for( size_t uiRead = 0; uiRead < uiReads; ++uiRead )
+		{
+			uiSum += Plat_GetNanoseconds();
+		}
+
+		g_Results.Report( "Plat_GetNanoseconds", uiReads, timer.GetSeconds() );
+
+		g_uiSink += uiSum;
+	}
+
+	{
+		uint64_t uiSum = 0;
+
+		CBenchTimer timer;
+
+		for( size_t uiRead = 0; uiRead < uiReads; ++uiRead )
+		{
+			uiSum += static_cast<uint64_t>( std::chrono::steady_clock::now().time_since_epoch().count() );
+		}
+
+		g_Results.Report( "steady_clock::now", uiReads, timer.GetSeconds() );
+
+		g_uiSink += uiSum;
+	}
+}
+
+/**
+*	Timers ordered by expiry, the usual alternative to a wheel.
+*/
+class CTimerMap final
+{
+public:
+	using Handle = std::multimap<uint64_t, std::function<void()>>::iterator;
+
+	Handle Schedule( const uint64_t uiTime, std::function<void()> callback )
+	{
+		return m_Timers.emplace( uiTime, std::move( callback ) );
+	}
+
+	void Cancel( const Handle handle )
+	{
+		m_Timers.erase( handle );
+	}
+
+	size_t Advance( const uint64_t uiTime )
+	{
+		size_t uiRan = 0;
+
+		while( !m_Timers.empty() && m_Timers.begin()->first <= uiTime )
+		{
+			auto callback = std::move( m_Timers.begin()->second );
+
+			m_Timers.erase( m_Timers.begin() );
+
+			callback();
+
+			++uiRan;
+		}
+
+		return uiRan;
+	}
+
+private:
+	std::multimap<uint64_t, std::function<void()>> m_Timers;
+};
+
+/**
+*	Runs the retransmit workload.
+*	@return Sum of the IDs of the timers that ran, to compare the implementations.
+*/
+template<typename SCHEDULE, typename CANCEL, typename ADVANCE>
+uint64_t RunTimers( const BenchOptions_t& options, const char* pszName, SCHEDULE schedule, CANCEL cancel, ADVANCE advance )
+{
+	const size_t uiTicks = options.Scale( TICKS );
+
+	std::mt19937 random( 1 );
+
+	std::uniform_int_distribution<uint64_t> delays( TICK_US, 500 * TICK_US );
+
+	uint64_t uiRanSum = 0;
+
+	//Timers that will be cancelled, by the tick they're cancelled on.
+	std::multimap<size_t, size_t> cancels;
+
+	CBenchTimer timer;
+
+	for( size_t uiTick = 0; uiTick < uiTicks; ++uiTick )
+	{
+		const uint64_t uiNow = uiTick * TICK_US;
+
+		for( size_t uiTimer = 0; uiTimer < TIMERS_PER_TICK; ++uiTimer )
+		{
+			const size_t uiID = uiTick * TIMERS_PER_TICK + uiTimer;
+
+			const uint64_t uiDelay = delays( random );
+
+			schedule( uiID, uiNow, uiDelay, [ &uiRanSum, uiID ]() { uiRanSum += uiID; } );
+
+			if( random() % 16 < CANCELLED_PER_16 )
+				cancels.emplace( uiTick + static_cast<size_t>( random() % ( uiDelay / TICK_US ) ), uiID );
+		}
+
+		for( auto it = cancels.begin(); it != cancels.end() && it->first <= uiTick; it = cancels.erase( it ) )
+		{
+			cancel( it->second );
+		}
+
+		advance( uiNow + TICK_US );
+	}
+
+	g_Results.Report( pszName, uiTicks * TIMERS_PER_TICK, timer.GetSeconds() );
+
+	return uiRanSum;
+}
+
+void BenchTimers( const BenchOptions_t& options )
+{
+	const size_t uiTimers = options.Scale( TICKS ) * TIMERS_PER_TICK;
+
+	uint64_t uiWheelSum;
+
+	{
+		CTimerWheel wheel( 0, TICK_US );
+
+		std::vector<CTimerWheel::Handle> handles( uiTimers );
+
+		uiWheelSum = RunTimers( options, "CTimerWheel",
+			[ & ]( size_t uiID, uint64_t, uint64_t uiDelay, std::function<void()> callback )
+			{
+				handles[ uiID ] = wheel.Schedule( uiDelay, std::move( callback ) );
+			},
+			[ & ]( size_t uiID )
+			{
+				wheel.Cancel( handles[ uiID ] );
+			},
+			[ & ]( uint64_t uiTime )
+			{
+				wheel.Advance( uiTime );
+			}
+		);
+	}
+
+	uint64_t uiMapSum;
+
+	{
+		CTimerMap map;
+
+		std::vector<CTimerMap::Handle> handles( uiTimers );
+		std::vector<bool> done( uiTimers );
+
+		uiMapSum = RunTimers( options, "std::multimap",
+			[ & ]( size_t uiID, uint64_t uiNow, uint64_t uiDelay, std::function<void()> callback )
+			{
+				//Expiry rounded up to the end of a tick, like the wheel does.
+				const uint64_t uiExpiry = ( uiNow + uiDelay + TICK_US - 1 ) / TICK_US * TICK_US;
+
+				handles[ uiID ] = map.Schedule( uiExpiry, [ &done, uiID, callback ]() { done[ uiID ] = true; callback(); } );
+			},
+			[ & ]( size_t uiID )
+			{
+				if( !done[ uiID ] )
+				{
+					map.Cancel( handles[ uiID ] );
+					done[ uiID ] = true;
+				}
+			},
+			[ & ]( uint64_t uiTime )
+			{
+				map.Advance( uiTime );
+			}
+		);
+	}
+
+	if( uiWheelSum != uiMapSum )
+	{
+		printf( "CTimerWheel ran different timers than std::multimap\n" );
+		g_bFailed = true;
+	}
+}
+}
+
+int main( int argc, char* argv[] )
+{
+	BenchOptions_t options;
+
+	if( !options.ParseCommandLine( argc, argv, "bench_timers" ) )
+		return EXIT_FAILURE;
+
+	printf( "Clock source: %s, %llu Hz\n", Plat_GetClockSource(), static_cast<unsigned long long>( Plat_GetClockFrequency() ) );
+
+	BenchClocks( options );
+	BenchTimers( options );
+
+	if( !g_Results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return g_bFailed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,140 @@
+#include <cassert>
+
+#include "lib/CLibrary.h"
+
+#include "CInterfaceCache.h"
+
+bool CInterfaceCache::AddLibrary( const CLibrary& library )
+{
+	assert( library.IsLoaded() );
+
+	auto factory = reinterpret_cast<CreateInterfaceFn>( library.GetFunctionAddress( CREATEINTERFACE_PROCNAME ) );
+
+	if( !factory )
+		return false;
+
+	AddFactory( library.GetName().c_str(), factory );
+
+	return true;
+}
+
+void CInterfaceCache::AddFactory( const char* pszLibrary, CreateInterfaceFn factory )
+{
+	assert( factory );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Factories.push_back( { pszLibrary ? pszLibrary : "", factory, pszLibrary == nullptr } );
+
+	//Interfaces that weren't found before might be provided by the new factory.
+	for( auto it = m_Interfaces.begin(); it != m_Interfaces.end(); )
+	{
+		if( !it->second )
+			it = m_Interfaces.erase( it );
+		else
+			++it;
+	}
+}
+
+void CInterfaceCache::RemoveFactory( const char* pszLibrary )
+{
+	assert( pszLibrary );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	for( auto it = m_Factories.begin(); it != m_Factories.end(); ++it )
+	{
+		if( !it->bAnonymous && it->szLibrary == pszLibrary )
+		{
+			m_Factories.erase( it );
+			break;
+		}
+	}
+
+	//Lookups in all factories could have come from the library too.
+	m_Interfaces.clear();
+}
+
+CreateInterfaceFn CInterfaceCache::GetFactory( const char* pszLibrary ) const
+{
+	assert( pszLibrary );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	for( const auto& factory : m_Factories )
+	{
+		if( !factory.bAnonymous && factory.szLibrary == pszLibrary )
+			return factory.factory;
+	}
+
+	return nullptr;
+}
+
+IBaseInterface* CInterfaceCache::Find( const char* pszVersion, const char* pszLibrary )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return FindLocked( pszVersion, pszLibrary );
+}
+
+bool CInterfaceCache::FindAll( const Request_t* pRequests, const size_t uiCount, const char* pszLibrary )
+{
+	assert( pRequests );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	bool bSuccess = true;
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		auto& request = pRequests[ uiIndex ];
+
+		*request.ppInterface = FindLocked( request.pszVersion, pszLibrary );
+
+		if( !( *request.ppInterface ) )
+			bSuccess = false;
+	}
+
+	return bSuccess;
+}
+
+void CInterfaceCache::Clear()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Factories.clear();
+	m_Interfaces.clear();
+}
+
+IBaseInterface* CInterfaceCache::FindLocked( const char* pszVersion, const char* pszLibrary )
+{
+	assert( pszVersion );
+
+	//Library names can't contain a null character, so this can't be ambiguous.
+	std::string szKey = pszLibrary ? pszLibrary : "";
+
+	szKey += '\0';
+	szKey += pszVersion;
+
+	auto it = m_Interfaces.find( szKey );
+
+	if( it != m_Interfaces.end() )
+		return it->second;
+
+	IBaseInterface* pInterface = nullptr;
+
+	for( const auto& factory : m_Factories )
+	{
+		if( pszLibrary && ( factory.bAnonymous || factory.szLibrary != pszLibrary ) )
+			continue;
+
+		pInterface = factory.factory( pszVersion, nullptr );
+
+		if( pInterface )
+			break;
+	}
+
+	m_Interfaces.emplace( std::move( szKey ), pInterface );
+
+	return pInterface;
+}
@@ -0,0 +1,111 @@
+#ifndef LIB_CINTERFACECACHE_H
+#define LIB_CINTERFACECACHE_H
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "interface.h"
+
+class CLibrary;
+
+/**
+*	Resolves interfaces from a set of library factories, and caches the result by library and interface version.
+*	Each lookup only walks a library's interface registry once, including lookups that fail.
+*	Only for interfaces exposed as singletons: a factory for interfaces that have multiple instances creates a new one each call, which this would hide.
+*	Thread-safe.
+*/
+class CInterfaceCache final
+{
+public:
+	struct Request_t
+	{
+		const char* pszVersion;
+
+		/**
+		*	Receives the interface, or null if it wasn't found.
+		*/
+		IBaseInterface** ppInterface;
+	};
+
+public:
+	CInterfaceCache() = default;
+
+	/**
+	*	Adds a library's factory, under the library's name.
+	*	@return Whether the library exports a factory.
+	*/
+	bool AddLibrary( const CLibrary& library );
+
+	/**
+	*	Adds a factory. Factories are searched in the order they were added in.
+	*	@param pszLibrary Name to look the factory up by. If null, the factory is only used by lookups that search all factories.
+	*/
+	void AddFactory( const char* pszLibrary, CreateInterfaceFn factory );
+
+	/**
+	*	Removes the factory that was added under the given name. Must be called before the library is freed.
+	*/
+	void RemoveFactory( const char* pszLibrary );
+
+	/**
+	*	@return The factory that was added under the given name, or null if there is none.
+	*/
+	CreateInterfaceFn GetFactory( const char* pszLibrary ) const;
+
+	/**
+	*	Finds an interface.
+	*	@param pszVersion Interface version.
+	*	@param pszLibrary Library to get it from. If null, all factories are searched.
+	*	@return The interface, or null if it wasn't found.
+	*/
+	IBaseInterface* Find( const char* pszVersion, const char* pszLibrary = nullptr );
+
+	/**
+	*	Finds several interfaces at once.
+	*	@param pszLibrary Library to get them from. If null, all factories are searched.
+	*	@return Whether all interfaces were found.
+	*/
+	bool FindAll( const Request_t* pRequests, const size_t uiCount, const char* pszLibrary = nullptr );
+
+	/**
+	*	Removes all factories and cached interfaces. Must be called before the libraries are freed.
+	*/
+	void Clear();
+
+private:
+	struct Factory_t
+	{
+		std::string szLibrary;
+
+		CreateInterfaceFn factory;
+
+		/**
+		*	Whether this factory is only used by lookups that search all factories.
+		*/
+		bool bAnonymous;
+	};
+
+	/**
+	*	Must be called with the mutex held.
+	*/
+	IBaseInterface* FindLocked( const char* pszVersion, const char* pszLibrary );
+
+private:
+	mutable std::mutex m_Mutex;
+
+	std::vector<Factory_t> m_Factories;
+
+	/**
+	*	Interfaces that have been looked up, keyed by library name and version. Lookups in all factories use an empty library name.
+	*/
+	std::unordered_map<std::string, IBaseInterface*> m_Interfaces;
+
+private:
+	CInterfaceCache( const CInterfaceCache& ) = delete;
+	CInterfaceCache& operator=( const CInterfaceCache& ) = delete;
+};
+
+#endif //LIB_CINTERFACECACHE_H
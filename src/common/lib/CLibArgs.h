@@ -2,9 +2,45 @@
 #define LIB_CLIBARGS_H
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
 
 #include "LibConstants.h"
 
+typedef uint32_t LibLoadFlags_t;
+
+/**
+*	Flags that control how a library is loaded. Flags that a platform doesn't support are ignored.
+*/
+namespace LibLoadFlag
+{
+enum LibLoadFlag : LibLoadFlags_t
+{
+	/**
+	*	Resolve all symbols when the library is loaded, so the first call to a function doesn't stall. This is the default.
+	*/
+	NONE				= 0,
+
+	/**
+	*	Resolve symbols the first time they're used. Loads faster, but the first call to each function is slower.
+	*	Windows always resolves imports when a library is loaded.
+	*/
+	LAZY_BINDING		= 1 << 0,
+
+	/**
+	*	Make the library's symbols available to libraries that are loaded after it. Lets a dependency be preloaded from a known path.
+	*	Linux and Mac only.
+	*/
+	GLOBAL_SYMBOLS		= 1 << 1,
+
+	/**
+	*	Prefer the library's own symbols over global symbols with the same name. Keeps libraries that bundle their own copy of a
+	*	dependency from binding to the host's copy. Linux only.
+	*/
+	DEEP_BIND			= 1 << 2,
+};
+}
+
 /**
 *	Builder for CLibrary load calls. Lets you specify platform specific settings as needed.
 */
@@ -122,11 +158,79 @@ public:
 		return *this;
 	}
 
+	/**
+	*	@return The load flags.
+	*	@see LibLoadFlag::LibLoadFlag
+	*/
+	LibLoadFlags_t GetFlags() const { return m_Flags; }
+
+	/**
+	*	Sets the load flags for the given platform.
+	*	@param platform Platform.
+	*/
+	CLibArgs& Flags( const LibLoadFlags_t flags, const Platform platform )
+	{
+		if( GetCurrentPlatform() == platform )
+			m_Flags = flags;
+
+		return *this;
+	}
+
+	/**
+	*	Sets the load flags.
+	*/
+	CLibArgs& Flags( const LibLoadFlags_t flags )
+	{
+		m_Flags = flags;
+
+		return *this;
+	}
+
+	/**
+	*	Maximum number of libraries that can be preloaded.
+	*/
+	static const size_t MAX_PRELOADS = 8;
+
+	/**
+	*	@return Number of libraries to preload.
+	*/
+	size_t GetNumPreloads() const { return m_uiNumPreloads; }
+
+	/**
+	*	@return The name of a library to preload.
+	*/
+	const char* GetPreload( const size_t uiIndex ) const
+	{
+		assert( uiIndex < m_uiNumPreloads );
+
+		return m_pszPreloads[ uiIndex ];
+	}
+
+	/**
+	*	Adds a dependency to load before the library, in the order they're added in.
+	*	Preloads are looked up the same way as the library, and are loaded with the same flags. They stay loaded until the library is freed.
+	*	@param pszFilename The base library filename.
+	*/
+	CLibArgs& Preload( const char* const pszFilename )
+	{
+		assert( pszFilename );
+		assert( m_uiNumPreloads < MAX_PRELOADS );
+
+		if( m_uiNumPreloads < MAX_PRELOADS )
+			m_pszPreloads[ m_uiNumPreloads++ ] = pszFilename;
+
+		return *this;
+	}
+
 private:
 	const char* m_pszFilename;
 	const char* m_pszPath = "";
 	bool m_bDisablePrefix = false;
 	const char* m_pszOverrideExt = nullptr;
+	LibLoadFlags_t m_Flags = LibLoadFlag::NONE;
+
+	const char* m_pszPreloads[ MAX_PRELOADS ] = {};
+	size_t m_uiNumPreloads = 0;
 
 private:
 	CLibArgs( const CLibArgs& ) = delete;
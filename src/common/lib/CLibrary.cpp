@@ -15,6 +15,8 @@
 
 #include "CLibrary.h"
 
+const size_t CLibArgs::MAX_PRELOADS;
+
 CLibrary::CLibrary()
 {
 }
@@ -23,6 +25,8 @@ CLibrary::CLibrary( CLibrary&& other )
 {
 	std::swap( m_szName, other.m_szName );
 	std::swap( m_hLibrary, other.m_hLibrary );
+	std::swap( m_Functions, other.m_Functions );
+	std::swap( m_Preloads, other.m_Preloads );
 }
 
 CLibrary& CLibrary::operator=( CLibrary&& other )
@@ -31,6 +35,8 @@ CLibrary& CLibrary::operator=( CLibrary&& other )
 
 	std::swap( m_szName, other.m_szName );
 	std::swap( m_hLibrary, other.m_hLibrary );
+	std::swap( m_Functions, other.m_Functions );
+	std::swap( m_Preloads, other.m_Preloads );
 
 	return *this;
 }
@@ -49,13 +55,13 @@ CLibrary::~CLibrary()
 	Free();
 }
 
-bool CLibrary::Load( const char* const pszFilename )
+bool CLibrary::Load( const char* const pszFilename, const LibLoadFlags_t flags )
 {
 	assert( pszFilename );
 
 	Free();
 
-	m_hLibrary = DoLoad( pszFilename );
+	m_hLibrary = DoLoad( pszFilename, flags );
 
 	if( !IsLoaded() )
 		return false;
@@ -69,41 +75,31 @@ bool CLibrary::Load( const CLibArgs& args )
 {
 	Free();
 
-	const auto& platform = CPlatform::GetCurrentPlatform();
-
-	char szBuffer[ MAX_PATH ];
-
-	const char* pszPrefix = !args.ShouldDisablePrefixes() ? platform.GetDefaultLibPrefix() : "";
-
-	//Handle the override extension as a list of 1 extension.
-	const char* const pszOverrideExt[] = 
-	{
-		args.GetOverrideExtension()
-	};
-
-	const char* const* pszExts = !args.GetOverrideExtension() ? platform.GetLibExts() : pszOverrideExt;
-
-	const size_t uiCount = !args.GetOverrideExtension() ? platform.GetNumLibExts() : 1;
-
-	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	for( size_t uiIndex = 0; uiIndex < args.GetNumPreloads(); ++uiIndex )
 	{
-		const int iResult = snprintf( szBuffer, sizeof( szBuffer ), "%s%s%s%s%s", args.GetPath(), *args.GetPath() ? "/" : "", pszPrefix, args.GetFilename(), pszExts[ uiIndex ] );
+		const auto hPreload = LoadWithArgs( args.GetPreload( uiIndex ), args );
 
-		if( iResult < 0 || static_cast<size_t>( iResult ) >= sizeof( szBuffer ) )
+		if( hPreload == NULL_HANDLE() )
+		{
+			FreePreloads();
 			return false;
+		}
 
-		m_hLibrary = DoLoad( szBuffer );
+		m_Preloads.push_back( hPreload );
+	}
 
-		if( IsLoaded() )
-		{
-			//Use the base name so users can compare it.
-			m_szName = args.GetFilename();
+	m_hLibrary = LoadWithArgs( args.GetFilename(), args );
 
-			return true;
-		}
+	if( !IsLoaded() )
+	{
+		FreePreloads();
+		return false;
 	}
 
-	return false;
+	//Use the base name so users can compare it.
+	m_szName = args.GetFilename();
+
+	return true;
 }
 
 void CLibrary::Free()
@@ -114,7 +110,10 @@ void CLibrary::Free()
 		m_hLibrary = NULL_HANDLE();
 
 		m_szName.clear();
+		m_Functions.clear();
 	}
+
+	FreePreloads();
 }
 
 const char* CLibrary::GetLoadErrorDescription()
@@ -170,12 +169,81 @@ void* CLibrary::GetFunctionAddress( const char* const pszName ) const
 	assert( IsLoaded() );
 	assert( pszName );
 
-	return DoGetFunctionAddress( m_hLibrary, pszName );
+	auto it = m_Functions.find( pszName );
+
+	if( it == m_Functions.end() )
+		it = m_Functions.emplace( pszName, DoGetFunctionAddress( m_hLibrary, pszName ) ).first;
+
+	return it->second;
+}
+
+bool CLibrary::GetFunctionAddresses( const char* const* ppszNames, void** ppAddresses, const size_t uiCount ) const
+{
+	assert( ppszNames );
+	assert( ppAddresses );
+
+	bool bSuccess = true;
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		ppAddresses[ uiIndex ] = GetFunctionAddress( ppszNames[ uiIndex ] );
+
+		if( !ppAddresses[ uiIndex ] )
+			bSuccess = false;
+	}
+
+	return bSuccess;
+}
+
+CLibrary::LibraryHandle_t CLibrary::LoadWithArgs( const char* const pszFilename, const CLibArgs& args )
+{
+	const auto& platform = CPlatform::GetCurrentPlatform();
+
+	char szBuffer[ MAX_PATH ];
+
+	const char* pszPrefix = !args.ShouldDisablePrefixes() ? platform.GetDefaultLibPrefix() : "";
+
+	//Handle the override extension as a list of 1 extension.
+	const char* const pszOverrideExt[] = 
+	{
+		args.GetOverrideExtension()
+	};
+
+	const char* const* pszExts = !args.GetOverrideExtension() ? platform.GetLibExts() : pszOverrideExt;
+
+	const size_t uiCount = !args.GetOverrideExtension() ? platform.GetNumLibExts() : 1;
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const int iResult = snprintf( szBuffer, sizeof( szBuffer ), "%s%s%s%s%s", args.GetPath(), *args.GetPath() ? "/" : "", pszPrefix, pszFilename, pszExts[ uiIndex ] );
+
+		if( iResult < 0 || static_cast<size_t>( iResult ) >= sizeof( szBuffer ) )
+			return NULL_HANDLE();
+
+		const auto hLibrary = DoLoad( szBuffer, args.GetFlags() );
+
+		if( hLibrary != NULL_HANDLE() )
+			return hLibrary;
+	}
+
+	return NULL_HANDLE();
+}
+
+void CLibrary::FreePreloads()
+{
+	//Free dependencies after the libraries that use them.
+	for( auto it = m_Preloads.rbegin(); it != m_Preloads.rend(); ++it )
+	{
+		DoFree( *it );
+	}
+
+	m_Preloads.clear();
 }
 
 #ifdef WIN32
-CLibrary::LibraryHandle_t CLibrary::DoLoad( const char* const pszFilename )
+CLibrary::LibraryHandle_t CLibrary::DoLoad( const char* const pszFilename, const LibLoadFlags_t )
 {
+	//Imports are always bound at load time, and exports are per module.
 	return LoadLibraryA( pszFilename );
 }
 
@@ -197,9 +265,18 @@ void* CLibrary::DoGetFunctionAddress( LibraryHandle_t hLibrary, const char* cons
 	return GetProcAddress( static_cast<HMODULE>( hLibrary ), pszName );
 }
 #else
-CLibrary::LibraryHandle_t CLibrary::DoLoad( const char* const pszFilename )
+CLibrary::LibraryHandle_t CLibrary::DoLoad( const char* const pszFilename, const LibLoadFlags_t flags )
 {
-	return dlopen( pszFilename, RTLD_NOW );
+	int iMode = ( flags & LibLoadFlag::LAZY_BINDING ) ? RTLD_LAZY : RTLD_NOW;
+
+	iMode |= ( flags & LibLoadFlag::GLOBAL_SYMBOLS ) ? RTLD_GLOBAL : RTLD_LOCAL;
+
+#ifdef RTLD_DEEPBIND
+	if( flags & LibLoadFlag::DEEP_BIND )
+		iMode |= RTLD_DEEPBIND;
+#endif
+
+	return dlopen( pszFilename, iMode );
 }
 
 void CLibrary::DoFree( LibraryHandle_t hLibrary )
@@ -2,11 +2,14 @@
 #define LIB_CLIBRARY_H
 
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "lib/CLibArgs.h"
 
 /**
 *	Represents a handle to single dynamic/shared library that can be loaded.
+*	Function addresses are cached, so a library must not be used by multiple threads at the same time.
 */
 class CLibrary final
 {
@@ -68,9 +71,11 @@ public:
 	/**
 	*	Loads the library with the given name. If this handle already has a handle to a library, it will be freed.
 	*	@param pszFilename Name of the library. This includes the path and extension.
+	*	@param flags Load flags.
 	*	@return true if the library was successfully loaded, false otherwise.
+	*	@see LibLoadFlag::LibLoadFlag
 	*/
-	bool Load( const char* const pszFilename );
+	bool Load( const char* const pszFilename, const LibLoadFlags_t flags = LibLoadFlag::NONE );
 
 	/**
 	*	Loads the given library. If this handle already has a handle to a library, it will be freed.
@@ -98,17 +103,36 @@ public:
 	const char* GetAbsoluteFilename() const;
 
 	/**
-	*	Gets a function from the library by name.
+	*	Gets a function from the library by name. The result is cached, so each function is only looked up once.
 	*	@param pszName Name of the function to get.
 	*	@return Pointer to the function on success, null otherwise.
 	*/
 	void* GetFunctionAddress( const char* const pszName ) const;
 
+	/**
+	*	Gets several functions from the library by name.
+	*	@param ppszNames Names of the functions to get.
+	*	@param ppAddresses Receives the address of each function, or null for functions that weren't found.
+	*	@param uiCount Number of functions to get.
+	*	@return Whether all functions were found.
+	*/
+	bool GetFunctionAddresses( const char* const* ppszNames, void** ppAddresses, const size_t uiCount ) const;
+
 private:
+	/**
+	*	Loads a library, trying each of the platform's extensions unless it's overridden.
+	*/
+	static LibraryHandle_t LoadWithArgs( const char* const pszFilename, const CLibArgs& args );
+
+	/**
+	*	Frees the preloaded dependencies.
+	*/
+	void FreePreloads();
+
 	/**
 	*	Does the actual of loading the library.
 	*/
-	static LibraryHandle_t DoLoad( const char* const pszFilename );
+	static LibraryHandle_t DoLoad( const char* const pszFilename, const LibLoadFlags_t flags );
 
 	/**
 	*	Does the actual freeing of the library.
@@ -129,6 +153,16 @@ private:
 	std::string m_szName;
 	LibraryHandle_t m_hLibrary = NULL_HANDLE();
 
+	/**
+	*	Dependencies that were loaded before the library, in load order.
+	*/
+	std::vector<LibraryHandle_t> m_Preloads;
+
+	/**
+	*	Addresses of functions that have been looked up, including ones that weren't found.
+	*/
+	mutable std::unordered_map<std::string, void*> m_Functions;
+
 private:
 	CLibrary( const CLibrary& ) = delete;
 	CLibrary& operator=( const CLibrary& ) = delete;
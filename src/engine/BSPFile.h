@@ -0,0 +1,177 @@
+#ifndef ENGINE_BSPFILE_H
+#define ENGINE_BSPFILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+*	@file
+*	GoldSource BSP file structures and constants.
+*	A map is a header with the location of each lump, followed by the lumps. Everything is little endian.
+*	Lumps are arrays of fixed size structures, apart from the entity string, the visibility and lighting data, and the textures.
+*/
+
+namespace bsp
+{
+const int32_t VERSION = 30;
+
+enum Lump
+{
+	LUMP_ENTITIES = 0,
+	LUMP_PLANES,
+	LUMP_TEXTURES,
+	LUMP_VERTEXES,
+	LUMP_VISIBILITY,
+	LUMP_NODES,
+	LUMP_TEXINFO,
+	LUMP_FACES,
+	LUMP_LIGHTING,
+	LUMP_CLIPNODES,
+	LUMP_LEAFS,
+	LUMP_MARKSURFACES,
+	LUMP_EDGES,
+	LUMP_SURFEDGES,
+	LUMP_MODELS,
+
+	NUM_LUMPS
+};
+
+const size_t MAX_MAP_HULLS = 4;
+
+const size_t MIPLEVELS = 4;
+
+const size_t MAX_TEXTURE_NAME = 16;
+
+const size_t NUM_AMBIENTS = 4;
+
+const size_t MAX_LIGHTMAPS = 4;
+
+struct LumpInfo_t
+{
+	int32_t fileofs;
+	int32_t filelen;
+};
+
+struct Header_t
+{
+	int32_t version;
+	LumpInfo_t lumps[ NUM_LUMPS ];
+};
+
+struct Model_t
+{
+	float mins[ 3 ];
+	float maxs[ 3 ];
+	float origin[ 3 ];
+	int32_t headnode[ MAX_MAP_HULLS ];
+	int32_t visleafs;
+	int32_t firstface;
+	int32_t numfaces;
+};
+
+struct Plane_t
+{
+	float normal[ 3 ];
+	float dist;
+	int32_t type;
+};
+
+struct Vertex_t
+{
+	float point[ 3 ];
+};
+
+struct Node_t
+{
+	int32_t planenum;
+
+	/**
+	*	Negative numbers are -( leafs + 1 ), not nodes.
+	*/
+	int16_t children[ 2 ];
+
+	int16_t mins[ 3 ];
+	int16_t maxs[ 3 ];
+	uint16_t firstface;
+	uint16_t numfaces;
+};
+
+struct ClipNode_t
+{
+	int32_t planenum;
+
+	/**
+	*	Negative numbers are contents.
+	*/
+	int16_t children[ 2 ];
+};
+
+struct TexInfo_t
+{
+	float vecs[ 2 ][ 4 ];
+	int32_t miptex;
+	int32_t flags;
+};
+
+struct Face_t
+{
+	int16_t planenum;
+	int16_t side;
+
+	int32_t firstedge;
+	int16_t numedges;
+	int16_t texinfo;
+
+	uint8_t styles[ MAX_LIGHTMAPS ];
+
+	/**
+	*	Offset into the lighting lump, or -1 for none.
+	*/
+	int32_t lightofs;
+};
+
+struct Leaf_t
+{
+	int32_t contents;
+
+	/**
+	*	Offset into the visibility lump, or -1 for none.
+	*/
+	int32_t visofs;
+
+	int16_t mins[ 3 ];
+	int16_t maxs[ 3 ];
+
+	uint16_t firstmarksurface;
+	uint16_t nummarksurfaces;
+
+	uint8_t ambient_level[ NUM_AMBIENTS ];
+};
+
+struct Edge_t
+{
+	uint16_t v[ 2 ];
+};
+
+/**
+*	Start of the texture lump. Followed by the offset of each texture from the start of the lump, or -1 for textures that are stored in WAD files.
+*/
+struct MipTexLump_t
+{
+	int32_t nummiptex;
+};
+
+struct MipTex_t
+{
+	char name[ MAX_TEXTURE_NAME ];
+	uint32_t width;
+	uint32_t height;
+
+	/**
+	*	Offset of each mip level from the start of this structure. 0 if the pixels are stored in a WAD file.
+	*/
+	uint32_t offsets[ MIPLEVELS ];
+};
+}
+
+#endif //ENGINE_BSPFILE_H
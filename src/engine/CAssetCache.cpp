@@ -0,0 +1,224 @@
+#include "Engine.h"
+#include "MemoryTracking.h"
+#include "TextureFile.h"
+
+#include "CAssetCache.h"
+
+CachedImage_t::~CachedImage_t()
+{
+	Mem_RecordFree( MemoryTag::VGUI, image.rgba.size() + textureFile.size() );
+
+	if( iTexture )
+		g_Video.GetTextureManager().ReleaseTexture( iTexture );
+}
+
+ImageHandle_t CAssetCache::FindImage( const char* pszFileName, const bool bInvertAlpha )
+{
+	auto pEntry = Find( MakeKey( pszFileName, bInvertAlpha ) );
+
+	return pEntry ? pEntry->image : nullptr;
+}
+
+ImageHandle_t CAssetCache::AddImage( const char* pszFileName, const bool bInvertAlpha, TGAImage_t&& image )
+{
+	auto cached = std::make_shared<CachedImage_t>();
+
+	cached->image = std::move( image );
+
+	return Add( MakeKey( pszFileName, bInvertAlpha ), std::move( cached ) );
+}
+
+ImageHandle_t CAssetCache::AddTextureFile( const char* pszFileName, const bool bInvertAlpha, std::vector<uint8_t>&& textureFile )
+{
+	texfile::TextureView_t view;
+
+	if( !texfile::ParseTexture( textureFile.data(), textureFile.size(), view ) )
+		return nullptr;
+
+	auto cached = std::make_shared<CachedImage_t>();
+
+	cached->image.iWidth = static_cast<int>( view.uiWidth );
+	cached->image.iHeight = static_cast<int>( view.uiHeight );
+	cached->textureFile = std::move( textureFile );
+
+	return Add( MakeKey( pszFileName, bInvertAlpha ), std::move( cached ) );
+}
+
+ModelHandle_t CAssetCache::FindModel( const char* pszFileName )
+{
+	auto pEntry = Find( MakeModelKey( pszFileName ) );
+
+	return pEntry ? pEntry->model : nullptr;
+}
+
+ModelHandle_t CAssetCache::AddModel( const char* pszFileName, std::shared_ptr<const CModelFile>&& model )
+{
+	auto key = MakeModelKey( pszFileName );
+
+	auto it = m_Entries.find( key );
+
+	if( it != m_Entries.end() )
+	{
+		m_LRU.splice( m_LRU.begin(), m_LRU, it->second.lru );
+
+		return it->second.model;
+	}
+
+	Entry_t entry;
+
+	entry.model = model;
+
+	Insert( std::move( key ), std::move( entry ) );
+
+	return model;
+}
+
+CAssetCache::Entry_t* CAssetCache::Find( const std::string& key )
+{
+	auto it = m_Entries.find( key );
+
+	if( it == m_Entries.end() )
+	{
+		++m_uiMisses;
+		return nullptr;
+	}
+
+	++m_uiHits;
+
+	m_LRU.splice( m_LRU.begin(), m_LRU, it->second.lru );
+
+	return &it->second;
+}
+
+ImageHandle_t CAssetCache::Add( std::string&& key, std::shared_ptr<CachedImage_t>&& cached )
+{
+	//Images don't change once they're added, the destructor frees the same amount.
+	Mem_RecordAlloc( MemoryTag::VGUI, GetImageBytes( *cached ) );
+
+	auto it = m_Entries.find( key );
+
+	if( it != m_Entries.end() )
+	{
+		m_LRU.splice( m_LRU.begin(), m_LRU, it->second.lru );
+
+		return it->second.image;
+	}
+
+	Entry_t entry;
+
+	entry.image = cached;
+
+	Insert( std::move( key ), std::move( entry ) );
+
+	return cached;
+}
+
+void CAssetCache::Insert( std::string&& key, Entry_t&& entry )
+{
+	m_LRU.push_front( key );
+
+	entry.lru = m_LRU.begin();
+
+	m_uiCPUBytes += GetEntryBytes( entry );
+
+	m_Entries.emplace( std::move( key ), std::move( entry ) );
+
+	Trim();
+}
+
+void CAssetCache::SetBudget( const size_t uiCPUBytes, const size_t uiGPUBytes )
+{
+	m_uiCPUBudget = uiCPUBytes;
+	m_uiGPUBudget = uiGPUBytes;
+}
+
+void CAssetCache::Trim()
+{
+	size_t uiGPUBytes = 0;
+
+	for( const auto& entry : m_Entries )
+	{
+		if( IsUploaded( entry.second ) )
+			uiGPUBytes += GetImageBytes( *entry.second.image );
+	}
+
+	//Walk from the least recently used end, skipping assets that are in use.
+	auto lru = m_LRU.end();
+
+	while( ( m_uiCPUBytes > m_uiCPUBudget || uiGPUBytes > m_uiGPUBudget ) && lru != m_LRU.begin() )
+	{
+		--lru;
+
+		auto it = m_Entries.find( *lru );
+
+		if( IsInUse( it->second ) )
+			continue;
+
+		if( IsUploaded( it->second ) )
+			uiGPUBytes -= GetImageBytes( *it->second.image );
+
+		//The iterator is invalidated by the eviction, so move past it first.
+		++lru;
+
+		Evict( it );
+	}
+}
+
+void CAssetCache::Clear()
+{
+	while( !m_Entries.empty() )
+	{
+		Evict( m_Entries.begin() );
+	}
+}
+
+void CAssetCache::GetStats( Stats_t& stats ) const
+{
+	stats = Stats_t();
+
+	stats.uiEntries = m_Entries.size();
+	stats.uiCPUBytes = m_uiCPUBytes;
+
+	for( const auto& entry : m_Entries )
+	{
+		if( entry.second.model )
+			++stats.uiModels;
+
+		if( IsUploaded( entry.second ) )
+			stats.uiGPUBytes += GetImageBytes( *entry.second.image );
+	}
+
+	stats.uiHits = m_uiHits;
+	stats.uiMisses = m_uiMisses;
+	stats.uiEvictions = m_uiEvictions;
+}
+
+std::string CAssetCache::MakeKey( const char* pszFileName, const bool bInvertAlpha )
+{
+	//Flags first, so they can't be confused with the name.
+	std::string key( 1, bInvertAlpha ? '1' : '0' );
+
+	key += pszFileName;
+
+	return key;
+}
+
+std::string CAssetCache::MakeModelKey( const char* pszFileName )
+{
+	//Can't be confused with image keys, which start with their flags.
+	std::string key( 1, 'm' );
+
+	key += pszFileName;
+
+	return key;
+}
+
+void CAssetCache::Evict( std::unordered_map<std::string, Entry_t>::iterator it )
+{
+	m_uiCPUBytes -= GetEntryBytes( it->second );
+
+	m_LRU.erase( it->second.lru );
+	m_Entries.erase( it );
+
+	++m_uiEvictions;
+}
@@ -0,0 +1,208 @@
+#ifndef ENGINE_CASSETCACHE_H
+#define ENGINE_CASSETCACHE_H
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "VGUI1/TGADecoder.h"
+
+#include "CModelFile.h"
+
+/**
+*	Decoded image shared by everything that loaded the same file with the same flags.
+*/
+struct CachedImage_t
+{
+	/**
+	*	Decoded pixels. Empty if the image was loaded from a precompiled texture file, only the size is set then.
+	*/
+	TGAImage_t image;
+
+	/**
+	*	Contents of the precompiled texture file, uploaded as is. Empty if the image was decoded.
+	*/
+	std::vector<uint8_t> textureFile;
+
+	/**
+	*	Texture handle that all users of the image draw with. 0 until the image is first drawn.
+	*/
+	int iTexture = 0;
+
+	/**
+	*	Cleared if the texture manager evicts the texture.
+	*/
+	bool bUploaded = false;
+
+	CachedImage_t() = default;
+
+	/**
+	*	Frees the texture.
+	*/
+	~CachedImage_t();
+
+private:
+	CachedImage_t( const CachedImage_t& ) = delete;
+	CachedImage_t& operator=( const CachedImage_t& ) = delete;
+};
+
+/**
+*	Reference to a cached image. The image stays cached for as long as a reference to it exists.
+*/
+using ImageHandle_t = std::shared_ptr<CachedImage_t>;
+
+/**
+*	Keeps decoded images and loaded models so loading the same file again is free.
+*	Assets nobody references anymore are kept until the memory budgets are exceeded, and then evicted least recently used first.
+*	Models count against the CPU budget with the size of their file.
+*	Must only be used on the main thread.
+*/
+class CAssetCache final
+{
+public:
+	struct Stats_t
+	{
+		size_t uiEntries = 0;
+
+		/**
+		*	Number of the entries that are models.
+		*/
+		size_t uiModels = 0;
+
+		/**
+		*	Size of the decoded images, and of the ones that were uploaded.
+		*/
+		size_t uiCPUBytes = 0;
+		size_t uiGPUBytes = 0;
+
+		size_t uiHits = 0;
+		size_t uiMisses = 0;
+		size_t uiEvictions = 0;
+	};
+
+public:
+	CAssetCache() = default;
+
+	/**
+	*	Looks up an image and marks it as used.
+	*	@return The image, or null if it isn't cached.
+	*/
+	ImageHandle_t FindImage( const char* pszFileName, const bool bInvertAlpha );
+
+	/**
+	*	Adds a decoded image. If the image was added in the meantime, the existing one is returned instead.
+	*/
+	ImageHandle_t AddImage( const char* pszFileName, const bool bInvertAlpha, TGAImage_t&& image );
+
+	/**
+	*	Adds a precompiled texture file for an image. It's cached under the image's name, so users don't need to know which one was loaded.
+	*	@param textureFile Contents of the file. Must have been validated with texfile::ParseTexture.
+	*/
+	ImageHandle_t AddTextureFile( const char* pszFileName, const bool bInvertAlpha, std::vector<uint8_t>&& textureFile );
+
+	/**
+	*	Looks up a model and marks it as used.
+	*	@return The model, or null if it isn't cached.
+	*/
+	ModelHandle_t FindModel( const char* pszFileName );
+
+	/**
+	*	Adds a loaded model. If the model was added in the meantime, the existing one is returned instead.
+	*/
+	ModelHandle_t AddModel( const char* pszFileName, std::shared_ptr<const CModelFile>&& model );
+
+	/**
+	*	Sets the memory budgets, in bytes. 0 doesn't keep images that aren't referenced.
+	*/
+	void SetBudget( const size_t uiCPUBytes, const size_t uiGPUBytes );
+
+	/**
+	*	Evicts images that aren't referenced until the cache is within its budgets. Images that are in use aren't evicted.
+	*/
+	void Trim();
+
+	/**
+	*	Drops all cached images. Images that are still referenced stay alive, but are no longer shared.
+	*/
+	void Clear();
+
+	void GetStats( Stats_t& stats ) const;
+
+private:
+	struct Entry_t
+	{
+		/**
+		*	Either an image or a model.
+		*/
+		ImageHandle_t image;
+		ModelHandle_t model;
+
+		/**
+		*	Position in the LRU list.
+		*/
+		std::list<std::string>::iterator lru;
+	};
+
+	static std::string MakeKey( const char* pszFileName, const bool bInvertAlpha );
+
+	static std::string MakeModelKey( const char* pszFileName );
+
+	static size_t GetImageBytes( const CachedImage_t& image ) { return image.image.rgba.size() + image.textureFile.size(); }
+
+	static size_t GetEntryBytes( const Entry_t& entry ) { return entry.image ? GetImageBytes( *entry.image ) : entry.model->GetSize(); }
+
+	static bool IsUploaded( const Entry_t& entry ) { return entry.image && entry.image->bUploaded; }
+
+	/**
+	*	@return Whether anything besides the cache references the entry's asset.
+	*/
+	static bool IsInUse( const Entry_t& entry ) { return entry.image ? entry.image.use_count() > 1 : entry.model.use_count() > 1; }
+
+	/**
+	*	Looks up an entry and marks it as used.
+	*	@return The entry, or null if it isn't cached.
+	*/
+	Entry_t* Find( const std::string& key );
+
+	/**
+	*	Adds an image unless one was added with the same key in the meantime.
+	*	@return The image that ended up in the cache.
+	*/
+	ImageHandle_t Add( std::string&& key, std::shared_ptr<CachedImage_t>&& cached );
+
+	/**
+	*	Adds an entry that isn't in the cache yet.
+	*/
+	void Insert( std::string&& key, Entry_t&& entry );
+
+	/**
+	*	Removes an entry. Its texture is freed once nothing references it anymore.
+	*/
+	void Evict( std::unordered_map<std::string, Entry_t>::iterator it );
+
+private:
+	std::unordered_map<std::string, Entry_t> m_Entries;
+
+	/**
+	*	Keys, most recently used first.
+	*/
+	std::list<std::string> m_LRU;
+
+	size_t m_uiCPUBudget = 0;
+	size_t m_uiGPUBudget = 0;
+
+	size_t m_uiCPUBytes = 0;
+
+	size_t m_uiHits = 0;
+	size_t m_uiMisses = 0;
+	size_t m_uiEvictions = 0;
+
+private:
+	CAssetCache( const CAssetCache& ) = delete;
+	CAssetCache& operator=( const CAssetCache& ) = delete;
+};
+
+#endif //ENGINE_CASSETCACHE_H
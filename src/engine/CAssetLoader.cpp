@@ -0,0 +1,357 @@
+#include <algorithm>
+
+#include "CFrameArena.h"
+#include "Engine.h"
+#include "Logging.h"
+#include "TextureFile.h"
+
+#include "CAssetLoader.h"
+
+const unsigned int CAssetLoader::MAX_THREAD_COUNT;
+const uint64_t CAssetLoader::READ_CHUNK_SIZE;
+
+CAssetLoader::~CAssetLoader()
+{
+	Stop();
+}
+
+void CAssetLoader::Stop()
+{
+	//Reads in progress write into the jobs' buffers, so they have to finish first.
+	for( auto& job : m_Jobs )
+	{
+		for( auto handle : job->handles )
+		{
+			g_pFileSystem->WaitForAsync( handle );
+			g_pFileSystem->ReleaseAsync( handle );
+		}
+
+		job->handles.clear();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bShutdown = true;
+	}
+
+	m_WorkAvailable.notify_all();
+
+	for( auto& thread : m_Threads )
+	{
+		thread.join();
+	}
+
+	m_Threads.clear();
+
+	m_DecodeQueue.clear();
+	m_Finished.clear();
+	m_Jobs.clear();
+
+	m_uiPending = 0;
+
+	m_bShutdown = false;
+}
+
+void CAssetLoader::LoadImage( const char* pszFileName, const bool bInvertAlpha, ImageCallback_t callback )
+{
+	if( m_Threads.empty() )
+		StartThreads();
+
+	auto job = std::make_unique<Job_t>();
+
+	job->pLoader = this;
+	job->szFileName = pszFileName;
+	job->bInvertAlpha = bInvertAlpha;
+	job->callback = std::move( callback );
+
+	auto pJob = job.get();
+
+	job->cached = m_Cache.FindImage( pszFileName, bInvertAlpha );
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_Jobs.emplace_back( std::move( job ) );
+	}
+
+	++m_uiPending;
+
+	if( pJob->cached )
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		Finish( pJob );
+		return;
+	}
+
+	if( g_Video.GetRenderer().IsCompressedTextureSupported() )
+	{
+		const auto szTextureFileName = texfile::GetTextureFileName( pszFileName );
+
+		pJob->bTextureFile = true;
+
+		if( StartRead( pJob, szTextureFileName.c_str() ) )
+			return;
+
+		pJob->bTextureFile = false;
+	}
+
+	if( !StartRead( pJob, pszFileName ) )
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		Finish( pJob );
+	}
+}
+
+void CAssetLoader::Update()
+{
+	FrameVector_t<Job_t*> finished;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( m_Finished.empty() )
+			return;
+
+		//Copied out so m_Finished keeps its storage.
+		finished.assign( m_Finished.begin(), m_Finished.end() );
+		m_Finished.clear();
+	}
+
+	for( auto pJob : finished )
+	{
+		for( auto handle : pJob->handles )
+		{
+			g_pFileSystem->ReleaseAsync( handle );
+		}
+
+		pJob->handles.clear();
+
+		ImageHandle_t image = std::move( pJob->cached );
+
+		if( !image )
+		{
+			if( pJob->bLoaded && pJob->bTextureFile )
+				image = m_Cache.AddTextureFile( pJob->szFileName.c_str(), pJob->bInvertAlpha, std::move( pJob->textureFile ) );
+			else if( pJob->bLoaded )
+				image = m_Cache.AddImage( pJob->szFileName.c_str(), pJob->bInvertAlpha, pJob->decoder->TakeImage() );
+			else
+				Msg( "Couldn't load image \"%s\"\n", pJob->szFileName.c_str() );
+		}
+
+		pJob->callback( image );
+
+		--m_uiPending;
+
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		auto it = std::find_if( m_Jobs.begin(), m_Jobs.end(), [ = ]( const std::unique_ptr<Job_t>& job ) { return job.get() == pJob; } );
+
+		if( it != m_Jobs.end() )
+			m_Jobs.erase( it );
+	}
+}
+
+bool CAssetLoader::StartRead( Job_t* pJob, const char* pszFileName )
+{
+	//The file is only located here, reading it happens on the I/O workers.
+	const unsigned int uiSize = g_pFileSystem->Size( pszFileName );
+
+	if( uiSize == static_cast<unsigned int>( -1 ) || uiSize == 0 )
+		return false;
+
+	uint8_t* pBuffer;
+
+	//Texture files are kept as they are, so read them straight into the buffer the cache keeps.
+	if( pJob->bTextureFile )
+	{
+		pJob->textureFile.resize( uiSize );
+		pBuffer = pJob->textureFile.data();
+	}
+	else
+	{
+		pJob->data = std::make_unique<uint8_t[]>( uiSize );
+		pBuffer = pJob->data.get();
+
+		pJob->decoder = std::make_unique<CTGAStreamDecoder>( pJob->bInvertAlpha );
+	}
+
+	pJob->uiSize = uiSize;
+
+	const size_t uiChunks = static_cast<size_t>( ( uiSize + READ_CHUNK_SIZE - 1 ) / READ_CHUNK_SIZE );
+
+	//Reads can finish before the rest are submitted.
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		pJob->chunksRead.assign( uiChunks, false );
+		pJob->uiChunksPending = uiChunks;
+	}
+
+	pJob->handles.reserve( uiChunks );
+
+	for( size_t uiChunk = 0; uiChunk < uiChunks; ++uiChunk )
+	{
+		const uint64_t uiOffset = uiChunk * READ_CHUNK_SIZE;
+
+		FileAsyncRequest_t request;
+
+		request.pszFileName = pszFileName;
+		request.pBuffer = pBuffer + uiOffset;
+		request.uiOffset = uiOffset;
+		request.uiLength = std::min( READ_CHUNK_SIZE, uiSize - uiOffset );
+		request.pCallback = &CAssetLoader::OnReadFinished;
+		request.pContext = pJob;
+
+		const FileAsyncHandle_t handle = g_pFileSystem->ReadAsync( request );
+
+		if( handle != FILESYSTEM_INVALID_ASYNC_HANDLE )
+		{
+			pJob->handles.push_back( handle );
+			continue;
+		}
+
+		if( uiChunk == 0 )
+		{
+			pJob->textureFile.clear();
+			pJob->data.reset();
+			pJob->decoder.reset();
+
+			return false;
+		}
+
+		//The chunks that were submitted still have to finish before the job can be handed out.
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		pJob->bReadFailed = true;
+		pJob->uiChunksPending -= uiChunks - uiChunk;
+
+		if( !pJob->bQueued )
+			Schedule( pJob );
+
+		break;
+	}
+
+	return true;
+}
+
+void CAssetLoader::OnReadFinished( const FileAsyncRequest_t& request, FileAsyncStatus status, uint64_t uiBytesRead )
+{
+	auto pJob = reinterpret_cast<Job_t*>( request.pContext );
+	auto pLoader = pJob->pLoader;
+
+	std::lock_guard<std::mutex> lock( pLoader->m_Mutex );
+
+	if( status != FileAsyncStatus::COMPLETE || uiBytesRead != request.uiLength )
+		pJob->bReadFailed = true;
+	else
+		pJob->chunksRead[ static_cast<size_t>( request.uiOffset / READ_CHUNK_SIZE ) ] = true;
+
+	--pJob->uiChunksPending;
+
+	//Chunks can finish out of order, only the start of the file can be decoded.
+	size_t uiChunk = static_cast<size_t>( pJob->uiReadBytes / READ_CHUNK_SIZE );
+
+	while( uiChunk < pJob->chunksRead.size() && pJob->chunksRead[ uiChunk ] )
+	{
+		++uiChunk;
+	}
+
+	pJob->uiReadBytes = std::min( uiChunk * READ_CHUNK_SIZE, pJob->uiSize );
+
+	if( !pJob->bQueued )
+		pLoader->Schedule( pJob );
+}
+
+void CAssetLoader::Schedule( Job_t* pJob )
+{
+	const bool bReadDone = pJob->uiChunksPending == 0;
+
+	bool bCanDecode;
+
+	//Texture files are validated once they're complete, images are decoded as chunks arrive.
+	if( pJob->bTextureFile )
+		bCanDecode = bReadDone && !pJob->bReadFailed && pJob->uiDecodedBytes < pJob->uiReadBytes;
+	else
+		bCanDecode = pJob->decoder->GetStatus() == CTGAStreamDecoder::Status::NEED_MORE_DATA && pJob->uiDecodedBytes < pJob->uiReadBytes;
+
+	if( bCanDecode )
+	{
+		pJob->bQueued = true;
+
+		m_DecodeQueue.push_back( pJob );
+		m_WorkAvailable.notify_one();
+	}
+	//Reads write into the job's buffers, so it can only be handed out once they're all done.
+	else if( bReadDone )
+		Finish( pJob );
+}
+
+void CAssetLoader::StartThreads()
+{
+	//Leave a core for the main thread.
+	const unsigned int uiCores = std::thread::hardware_concurrency();
+
+	const unsigned int uiThreadCount = std::max( 1U, std::min( MAX_THREAD_COUNT, uiCores > 1 ? uiCores - 1 : 1 ) );
+
+	m_Threads.reserve( uiThreadCount );
+
+	for( unsigned int uiThread = 0; uiThread < uiThreadCount; ++uiThread )
+	{
+		m_Threads.emplace_back( &CAssetLoader::WorkerThread, this );
+	}
+}
+
+void CAssetLoader::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( true )
+	{
+		m_WorkAvailable.wait( lock, [ this ] { return m_bShutdown || !m_DecodeQueue.empty(); } );
+
+		if( m_bShutdown )
+			break;
+
+		auto pJob = m_DecodeQueue.front();
+
+		m_DecodeQueue.pop_front();
+
+		const uint64_t uiStart = pJob->uiDecodedBytes;
+		const uint64_t uiEnd = pJob->uiReadBytes;
+
+		lock.unlock();
+
+		Decode( pJob, uiStart, uiEnd );
+
+		lock.lock();
+
+		pJob->uiDecodedBytes = uiEnd;
+		pJob->bQueued = false;
+
+		//More chunks may have been read in the meantime.
+		Schedule( pJob );
+	}
+}
+
+void CAssetLoader::Decode( Job_t* pJob, const uint64_t uiStart, const uint64_t uiEnd )
+{
+	if( pJob->bTextureFile )
+	{
+		texfile::TextureView_t view;
+
+		pJob->bLoaded = texfile::ParseTexture( pJob->textureFile.data(), pJob->textureFile.size(), view );
+
+		return;
+	}
+
+	//Reads may still be writing into the rest of the buffer, so it's freed along with the job.
+	pJob->bLoaded = pJob->decoder->Feed( pJob->data.get() + uiStart, static_cast<size_t>( uiEnd - uiStart ) ) == CTGAStreamDecoder::Status::DONE;
+}
+
+void CAssetLoader::Finish( Job_t* pJob )
+{
+	m_Finished.push_back( pJob );
+}
@@ -0,0 +1,196 @@
+#ifndef ENGINE_CASSETLOADER_H
+#define ENGINE_CASSETLOADER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "FileSystem2.h"
+
+#include "CAssetCache.h"
+
+/**
+*	Loads images in the background. Files are read by the filesystem's I/O workers and decoded on this loader's workers,
+*	so the main thread only has to add the decoded pixels to the asset cache and hand them to whoever asked for them.
+*	Large files are read in chunks that are decoded as they arrive, so decoding overlaps the rest of the read.
+*/
+class CAssetLoader final
+{
+public:
+	/**
+	*	Called on the main thread from Update once an image is loaded.
+	*	@param image The cached image, or null if it couldn't be loaded.
+	*/
+	using ImageCallback_t = std::function<void( const ImageHandle_t& image )>;
+
+	/**
+	*	Most decode workers to start. Fewer are started on machines with fewer cores.
+	*/
+	static const unsigned int MAX_THREAD_COUNT = 4;
+
+	/**
+	*	Images are read in chunks of this size, so decoding can start before the whole file is read.
+	*/
+	static const uint64_t READ_CHUNK_SIZE = 256 * 1024;
+
+public:
+	CAssetLoader( CAssetCache& cache )
+		: m_Cache( cache )
+	{
+	}
+
+	~CAssetLoader();
+
+	/**
+	*	Waits for reads in progress, and stops the workers. Images that weren't handed out yet are dropped without calling their callbacks.
+	*/
+	void Stop();
+
+	/**
+	*	Queues a TGA image to load. Images that are already cached are handed out on the next Update without loading them.
+	*	If the image has a precompiled texture file and the renderer can use it, that's loaded instead.
+	*	Starts the decode workers if needed. Must be called on the main thread.
+	*	@param pszFileName Name of the file, relative to the search paths.
+	*	@param bInvertAlpha Passed to the decoder.
+	*/
+	void LoadImage( const char* pszFileName, const bool bInvertAlpha, ImageCallback_t callback );
+
+	/**
+	*	Calls the callbacks of images that have finished loading. Must be called on the main thread.
+	*/
+	void Update();
+
+	/**
+	*	@return Number of images that were queued and haven't been handed out yet.
+	*/
+	size_t GetPendingCount() const { return m_uiPending; }
+
+private:
+	struct Job_t
+	{
+		CAssetLoader* pLoader;
+
+		std::string szFileName;
+		bool bInvertAlpha;
+
+		ImageCallback_t callback;
+
+		std::unique_ptr<uint8_t[]> data;
+		uint64_t uiSize;
+
+		/**
+		*	Contents of the precompiled texture file, if that's what is being loaded.
+		*/
+		bool bTextureFile = false;
+		std::vector<uint8_t> textureFile;
+
+		/**
+		*	One read per chunk. Only touched on the main thread.
+		*/
+		std::vector<FileAsyncHandle_t> handles;
+
+		/**
+		*	Which chunks have been read. The rest is guarded by the mutex.
+		*/
+		std::vector<bool> chunksRead;
+
+		size_t uiChunksPending = 0;
+
+		/**
+		*	Number of bytes at the start of the file that were read, and that were decoded.
+		*/
+		uint64_t uiReadBytes = 0;
+		uint64_t uiDecodedBytes = 0;
+
+		/**
+		*	Whether a read failed. The job is finished once the reads that were started are done.
+		*/
+		bool bReadFailed = false;
+
+		/**
+		*	Whether the job is queued or being decoded. Only the worker that has it touches the decoder then.
+		*/
+		bool bQueued = false;
+
+		bool bLoaded = false;
+
+		std::unique_ptr<CTGAStreamDecoder> decoder;
+
+		/**
+		*	Set instead of loading if the image was cached.
+		*/
+		ImageHandle_t cached;
+	};
+
+	/**
+	*	Starts reading the job's file in chunks.
+	*	@return Whether any reads were started.
+	*/
+	bool StartRead( Job_t* pJob, const char* pszFileName );
+
+	/**
+	*	Marks a chunk as read, and queues whatever can be decoded. Called on an I/O worker thread.
+	*/
+	static void OnReadFinished( const FileAsyncRequest_t& request, FileAsyncStatus status, uint64_t uiBytesRead );
+
+	/**
+	*	Queues the job for decoding if there's something to decode, or finishes it if nothing more will arrive.
+	*	Must be called with the mutex held, while no worker has the job.
+	*/
+	void Schedule( Job_t* pJob );
+
+	void StartThreads();
+
+	void WorkerThread();
+
+	/**
+	*	Feeds everything that was read so far to the job's decoder, or validates its texture file.
+	*	Called on a worker thread without the mutex held.
+	*/
+	void Decode( Job_t* pJob, const uint64_t uiStart, const uint64_t uiEnd );
+
+	/**
+	*	Hands a job to the main thread. Must be called with the mutex held.
+	*/
+	void Finish( Job_t* pJob );
+
+private:
+	CAssetCache& m_Cache;
+
+	std::mutex m_Mutex;
+
+	std::condition_variable m_WorkAvailable;
+
+	/**
+	*	Jobs whose file was read and that are waiting to be decoded.
+	*/
+	std::deque<Job_t*> m_DecodeQueue;
+
+	/**
+	*	Jobs that are waiting for Update.
+	*/
+	std::vector<Job_t*> m_Finished;
+
+	/**
+	*	All jobs that haven't been handed out yet. Owned here so nothing leaks if the loader is stopped early.
+	*/
+	std::vector<std::unique_ptr<Job_t>> m_Jobs;
+
+	size_t m_uiPending = 0;
+
+	std::vector<std::thread> m_Threads;
+
+	bool m_bShutdown = false;
+
+private:
+	CAssetLoader( const CAssetLoader& ) = delete;
+	CAssetLoader& operator=( const CAssetLoader& ) = delete;
+};
+
+#endif //ENGINE_CASSETLOADER_H
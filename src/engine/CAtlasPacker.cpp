@@ -0,0 +1,58 @@
+#include "CAtlasPacker.h"
+
+CAtlasPacker::CAtlasPacker( const int iWidth, const int iHeight )
+	: m_iWidth( iWidth )
+	, m_iHeight( iHeight )
+{
+}
+
+bool CAtlasPacker::Allocate( const int iWidth, const int iHeight, int& iOutX, int& iOutY )
+{
+	if( iWidth <= 0 || iHeight <= 0 || iWidth > m_iWidth || iHeight > m_iHeight )
+		return false;
+
+	Shelf_t* pBest = nullptr;
+
+	for( auto& shelf : m_Shelves )
+	{
+		if( shelf.iHeight < iHeight || m_iWidth - shelf.iUsedWidth < iWidth )
+			continue;
+
+		if( !pBest || shelf.iHeight < pBest->iHeight )
+			pBest = &shelf;
+	}
+
+	//Only start a new shelf if the best one would waste more than half its height.
+	if( ( !pBest || pBest->iHeight > iHeight * 2 ) && m_iNextShelfY + iHeight <= m_iHeight )
+	{
+		m_Shelves.push_back( { m_iNextShelfY, iHeight, 0 } );
+
+		m_iNextShelfY += iHeight;
+
+		pBest = &m_Shelves.back();
+	}
+
+	if( !pBest )
+		return false;
+
+	iOutX = pBest->iUsedWidth;
+	iOutY = pBest->iY;
+
+	pBest->iUsedWidth += iWidth;
+
+	m_iUsedArea += static_cast<long long>( iWidth ) * iHeight;
+
+	return true;
+}
+
+void CAtlasPacker::Clear()
+{
+	m_Shelves.clear();
+	m_iNextShelfY = 0;
+	m_iUsedArea = 0;
+}
+
+float CAtlasPacker::GetUsage() const
+{
+	return static_cast<float>( static_cast<double>( m_iUsedArea ) / ( static_cast<double>( m_iWidth ) * m_iHeight ) );
+}
@@ -0,0 +1,65 @@
+#ifndef ENGINE_CATLASPACKER_H
+#define ENGINE_CATLASPACKER_H
+
+#include <vector>
+
+/**
+*	Packs rectangles into a fixed size area using shelves: rows as tall as the tallest rectangle placed in them.
+*	Each rectangle goes on the shelf that wastes the least height, or on a new shelf if none fit.
+*	Rectangles can't be freed individually.
+*/
+class CAtlasPacker final
+{
+public:
+	CAtlasPacker( const int iWidth, const int iHeight );
+
+	int GetWidth() const { return m_iWidth; }
+	int GetHeight() const { return m_iHeight; }
+
+	/**
+	*	Finds space for a rectangle.
+	*	@param iWidth Width of the rectangle.
+	*	@param iHeight Height of the rectangle.
+	*	@param[ out ] iOutX X position of the rectangle.
+	*	@param[ out ] iOutY Y position of the rectangle.
+	*	@return Whether there was room.
+	*/
+	bool Allocate( const int iWidth, const int iHeight, int& iOutX, int& iOutY );
+
+	/**
+	*	Frees all rectangles.
+	*/
+	void Clear();
+
+	/**
+	*	@return Fraction of the area that is allocated.
+	*/
+	float GetUsage() const;
+
+private:
+	struct Shelf_t
+	{
+		int iY;
+		int iHeight;
+
+		/**
+		*	Width that is in use, from the left.
+		*/
+		int iUsedWidth;
+	};
+
+private:
+	int m_iWidth;
+	int m_iHeight;
+
+	std::vector<Shelf_t> m_Shelves;
+
+	/**
+	*	Y position of the next shelf.
+	*/
+	int m_iNextShelfY = 0;
+
+	long long m_iUsedArea = 0;
+};
+
+#endif //ENGINE_CATLASPACKER_H
@@ -0,0 +1,516 @@
+#include <cstring>
+
+#include "ByteSwap.h"
+
+#include "CBSPFile.h"
+
+namespace
+{
+/**
+*	How a lump is stored.
+*/
+struct LumpFormat_t
+{
+	size_t uiElementSize;
+	size_t uiAlignment;
+
+	/**
+	*	Fields to byte swap in each element. None for byte data, and for the texture lump, which is swapped separately.
+	*/
+	const SwapField_t* pFields;
+	size_t uiFieldCount;
+};
+
+const SwapField_t INT32_FIELDS[] = { { 0, 4, 1 } };
+const SwapField_t UINT16_FIELDS[] = { { 0, 2, 1 } };
+
+const SwapField_t PLANE_FIELDS[] =
+{
+	SWAP_FIELD( bsp::Plane_t, normal ),
+	SWAP_FIELD( bsp::Plane_t, dist ),
+	SWAP_FIELD( bsp::Plane_t, type )
+};
+
+const SwapField_t VERTEX_FIELDS[] =
+{
+	SWAP_FIELD( bsp::Vertex_t, point )
+};
+
+const SwapField_t NODE_FIELDS[] =
+{
+	SWAP_FIELD( bsp::Node_t, planenum ),
+	SWAP_FIELD( bsp::Node_t, children ),
+	SWAP_FIELD( bsp::Node_t, mins ),
+	SWAP_FIELD( bsp::Node_t, maxs ),
+	SWAP_FIELD( bsp::Node_t, firstface ),
+	SWAP_FIELD( bsp::Node_t, numfaces )
+};
+
+const SwapField_t TEXINFO_FIELDS[] =
+{
+	SWAP_FIELD( bsp::TexInfo_t, vecs ),
+	SWAP_FIELD( bsp::TexInfo_t, miptex ),
+	SWAP_FIELD( bsp::TexInfo_t, flags )
+};
+
+const SwapField_t FACE_FIELDS[] =
+{
+	SWAP_FIELD( bsp::Face_t, planenum ),
+	SWAP_FIELD( bsp::Face_t, side ),
+	SWAP_FIELD( bsp::Face_t, firstedge ),
+	SWAP_FIELD( bsp::Face_t, numedges ),
+	SWAP_FIELD( bsp::Face_t, texinfo ),
+	SWAP_FIELD( bsp::Face_t, lightofs )
+};
+
+const SwapField_t CLIPNODE_FIELDS[] =
+{
+	SWAP_FIELD( bsp::ClipNode_t, planenum ),
+	SWAP_FIELD( bsp::ClipNode_t, children )
+};
+
+const SwapField_t LEAF_FIELDS[] =
+{
+	SWAP_FIELD( bsp::Leaf_t, contents ),
+	SWAP_FIELD( bsp::Leaf_t, visofs ),
+	SWAP_FIELD( bsp::Leaf_t, mins ),
+	SWAP_FIELD( bsp::Leaf_t, maxs ),
+	SWAP_FIELD( bsp::Leaf_t, firstmarksurface ),
+	SWAP_FIELD( bsp::Leaf_t, nummarksurfaces )
+};
+
+const SwapField_t EDGE_FIELDS[] =
+{
+	SWAP_FIELD( bsp::Edge_t, v )
+};
+
+const SwapField_t MODEL_FIELDS[] =
+{
+	SWAP_FIELD( bsp::Model_t, mins ),
+	SWAP_FIELD( bsp::Model_t, maxs ),
+	SWAP_FIELD( bsp::Model_t, origin ),
+	SWAP_FIELD( bsp::Model_t, headnode ),
+	SWAP_FIELD( bsp::Model_t, visleafs ),
+	SWAP_FIELD( bsp::Model_t, firstface ),
+	SWAP_FIELD( bsp::Model_t, numfaces )
+};
+
+const SwapField_t MIPTEX_FIELDS[] =
+{
+	SWAP_FIELD( bsp::MipTex_t, width ),
+	SWAP_FIELD( bsp::MipTex_t, height ),
+	SWAP_FIELD( bsp::MipTex_t, offsets )
+};
+
+#define BYTE_LUMP { 1, 1, nullptr, 0 }
+#define STRUCT_LUMP( type, fields ) { sizeof( type ), alignof( type ), fields, sizeof( fields ) / sizeof( fields[ 0 ] ) }
+
+const LumpFormat_t LUMP_FORMATS[ bsp::NUM_LUMPS ] =
+{
+	BYTE_LUMP,
+	STRUCT_LUMP( bsp::Plane_t, PLANE_FIELDS ),
+	{ 1, alignof( bsp::MipTexLump_t ), nullptr, 0 },
+	STRUCT_LUMP( bsp::Vertex_t, VERTEX_FIELDS ),
+	BYTE_LUMP,
+	STRUCT_LUMP( bsp::Node_t, NODE_FIELDS ),
+	STRUCT_LUMP( bsp::TexInfo_t, TEXINFO_FIELDS ),
+	STRUCT_LUMP( bsp::Face_t, FACE_FIELDS ),
+	BYTE_LUMP,
+	STRUCT_LUMP( bsp::ClipNode_t, CLIPNODE_FIELDS ),
+	STRUCT_LUMP( bsp::Leaf_t, LEAF_FIELDS ),
+	STRUCT_LUMP( uint16_t, UINT16_FIELDS ),
+	STRUCT_LUMP( bsp::Edge_t, EDGE_FIELDS ),
+	STRUCT_LUMP( int32_t, INT32_FIELDS ),
+	STRUCT_LUMP( bsp::Model_t, MODEL_FIELDS )
+};
+
+#undef STRUCT_LUMP
+#undef BYTE_LUMP
+
+/**
+*	Swaps the texture count, offsets and headers of a texture lump, checking that they lie within the lump.
+*/
+bool SwapTextureLump( uint8_t* pData, const size_t uiSize )
+{
+	if( uiSize == 0 )
+		return true;
+
+	if( uiSize < sizeof( bsp::MipTexLump_t ) )
+		return false;
+
+	SwapStructs( pData, sizeof( int32_t ), 1, INT32_FIELDS, 1 );
+
+	int32_t iCount;
+	memcpy( &iCount, pData, sizeof( iCount ) );
+
+	if( iCount < 0 || static_cast<size_t>( iCount ) > ( uiSize - sizeof( bsp::MipTexLump_t ) ) / sizeof( int32_t ) )
+		return false;
+
+	uint8_t* pOffsets = pData + sizeof( bsp::MipTexLump_t );
+
+	SwapStructs( pOffsets, sizeof( int32_t ), static_cast<size_t>( iCount ), INT32_FIELDS, 1 );
+
+	for( int32_t iTexture = 0; iTexture < iCount; ++iTexture )
+	{
+		int32_t iOffset;
+		memcpy( &iOffset, pOffsets + iTexture * sizeof( int32_t ), sizeof( iOffset ) );
+
+		if( iOffset >= 0 && static_cast<size_t>( iOffset ) <= uiSize - sizeof( bsp::MipTex_t ) && uiSize >= sizeof( bsp::MipTex_t ) )
+			SwapStructs( pData + iOffset, sizeof( bsp::MipTex_t ), 1, MIPTEX_FIELDS, sizeof( MIPTEX_FIELDS ) / sizeof( MIPTEX_FIELDS[ 0 ] ) );
+	}
+
+	return true;
+}
+
+/**
+*	@return Whether a range of iCount elements starting at iFirst lies within uiTotal elements.
+*/
+bool IsValidRange( const int64_t iFirst, const int64_t iCount, const size_t uiTotal )
+{
+	return iFirst >= 0 && iCount >= 0 && static_cast<uint64_t>( iFirst + iCount ) <= uiTotal;
+}
+
+bool IsValidIndex( const int64_t iIndex, const size_t uiTotal )
+{
+	return iIndex >= 0 && static_cast<uint64_t>( iIndex ) < uiTotal;
+}
+}
+
+CBSPFile::~CBSPFile()
+{
+	Unload();
+}
+
+bool CBSPFile::Load( IFileSystem2& fileSystem, const char* pszFileName, const char* pszPathID )
+{
+	Unload();
+
+	m_pszError = "";
+
+	m_pFileSystem = &fileSystem;
+
+	m_hFile = fileSystem.Open( pszFileName, "rb", pszPathID );
+
+	if( m_hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Unload();
+		return Fail( "couldn't open file" );
+	}
+
+	int iSize = 0;
+
+	m_pBuffer = static_cast<const uint8_t*>( fileSystem.GetReadBuffer( m_hFile, &iSize, false ) );
+
+	if( !m_pBuffer )
+	{
+		Unload();
+		return Fail( "couldn't read file" );
+	}
+
+	m_uiSize = static_cast<size_t>( iSize );
+
+	if( !LoadLumps() || !ValidateTextures() || !ValidateReferences() )
+	{
+		const auto pszError = m_pszError;
+		Unload();
+		m_pszError = pszError;
+		return false;
+	}
+
+	return true;
+}
+
+void CBSPFile::Unload()
+{
+	for( size_t uiLump = 0; uiLump < bsp::NUM_LUMPS; ++uiLump )
+	{
+		m_Lumps[ uiLump ] = LumpView_t();
+		m_Copies[ uiLump ].reset();
+	}
+
+	m_uiTextureCount = 0;
+	m_uiReferencedBytes = 0;
+	m_uiCopiedBytes = 0;
+
+	if( m_pBuffer )
+	{
+		m_pFileSystem->ReleaseReadBuffer( m_hFile, const_cast<uint8_t*>( m_pBuffer ) );
+
+		m_pBuffer = nullptr;
+		m_uiSize = 0;
+	}
+
+	if( m_hFile != FILESYSTEM_INVALID_HANDLE )
+	{
+		m_pFileSystem->Close( m_hFile );
+		m_hFile = FILESYSTEM_INVALID_HANDLE;
+	}
+
+	m_pFileSystem = nullptr;
+}
+
+bool CBSPFile::GetTexture( const size_t uiIndex, bsp::MipTex_t& texture, size_t& uiOffset ) const
+{
+	if( uiIndex >= m_uiTextureCount )
+		return false;
+
+	const auto pData = m_Lumps[ bsp::LUMP_TEXTURES ].pData;
+
+	int32_t iOffset;
+	memcpy( &iOffset, pData + sizeof( bsp::MipTexLump_t ) + uiIndex * sizeof( int32_t ), sizeof( iOffset ) );
+
+	if( iOffset < 0 )
+		return false;
+
+	uiOffset = static_cast<size_t>( iOffset );
+
+	memcpy( &texture, pData + uiOffset, sizeof( texture ) );
+
+	return true;
+}
+
+bool CBSPFile::LoadLumps()
+{
+	bsp::Header_t header;
+
+	if( m_uiSize < sizeof( header ) )
+		return Fail( "file too small" );
+
+	memcpy( &header, m_pBuffer, sizeof( header ) );
+
+	LittleArray( &header.version, 1 );
+	LittleArray( &header.lumps[ 0 ].fileofs, bsp::NUM_LUMPS * 2 );
+
+	if( header.version != bsp::VERSION )
+		return Fail( "wrong version" );
+
+	for( size_t uiLump = 0; uiLump < bsp::NUM_LUMPS; ++uiLump )
+	{
+		const auto& info = header.lumps[ uiLump ];
+		const auto& format = LUMP_FORMATS[ uiLump ];
+
+		if( info.fileofs < 0 || info.filelen < 0 || static_cast<size_t>( info.fileofs ) > m_uiSize || static_cast<size_t>( info.filelen ) > m_uiSize - info.fileofs )
+			return Fail( "lump out of bounds" );
+
+		const auto uiSize = static_cast<size_t>( info.filelen );
+
+		if( uiSize % format.uiElementSize != 0 )
+			return Fail( "lump size isn't a multiple of its structure size" );
+
+		const uint8_t* pData = m_pBuffer + info.fileofs;
+
+		const bool bSwap = !ByteSwap<>::IsLittleEndian() && ( format.uiFieldCount > 0 || uiLump == bsp::LUMP_TEXTURES );
+		const bool bAligned = reinterpret_cast<uintptr_t>( pData ) % format.uiAlignment == 0;
+
+		if( !bSwap && bAligned )
+		{
+			m_Lumps[ uiLump ] = { pData, uiSize };
+			m_uiReferencedBytes += uiSize;
+			continue;
+		}
+
+		//Allocated memory is aligned for any of the structures.
+		auto& copy = m_Copies[ uiLump ];
+
+		copy.reset( new uint8_t[ uiSize > 0 ? uiSize : 1 ] );
+
+		memcpy( copy.get(), pData, uiSize );
+
+		if( bSwap )
+		{
+			if( uiLump == bsp::LUMP_TEXTURES )
+			{
+				if( !SwapTextureLump( copy.get(), uiSize ) )
+					return Fail( "invalid texture lump" );
+			}
+			else
+			{
+				SwapStructs( copy.get(), format.uiElementSize, uiSize / format.uiElementSize, format.pFields, format.uiFieldCount );
+			}
+		}
+
+		m_Lumps[ uiLump ] = { copy.get(), uiSize };
+		m_uiCopiedBytes += uiSize;
+	}
+
+	return true;
+}
+
+bool CBSPFile::ValidateTextures()
+{
+	const auto& lump = m_Lumps[ bsp::LUMP_TEXTURES ];
+
+	if( lump.uiSize == 0 )
+		return true;
+
+	bsp::MipTexLump_t header;
+
+	if( lump.uiSize < sizeof( header ) )
+		return Fail( "invalid texture lump" );
+
+	memcpy( &header, lump.pData, sizeof( header ) );
+
+	if( header.nummiptex < 0 || static_cast<size_t>( header.nummiptex ) > ( lump.uiSize - sizeof( header ) ) / sizeof( int32_t ) )
+		return Fail( "invalid texture lump" );
+
+	m_uiTextureCount = static_cast<size_t>( header.nummiptex );
+
+	for( size_t uiTexture = 0; uiTexture < m_uiTextureCount; ++uiTexture )
+	{
+		int32_t iOffset;
+		memcpy( &iOffset, lump.pData + sizeof( header ) + uiTexture * sizeof( int32_t ), sizeof( iOffset ) );
+
+		//Stored in a WAD file.
+		if( iOffset < 0 )
+			continue;
+
+		if( lump.uiSize < sizeof( bsp::MipTex_t ) || static_cast<size_t>( iOffset ) > lump.uiSize - sizeof( bsp::MipTex_t ) )
+			return Fail( "texture out of bounds" );
+
+		bsp::MipTex_t texture;
+		memcpy( &texture, lump.pData + iOffset, sizeof( texture ) );
+
+		//Each mip level is a quarter of the previous one.
+		for( size_t uiMip = 0; uiMip < bsp::MIPLEVELS; ++uiMip )
+		{
+			if( texture.offsets[ uiMip ] == 0 )
+				continue;
+
+			const uint64_t uiPixels = static_cast<uint64_t>( texture.width >> uiMip ) * ( texture.height >> uiMip );
+
+			if( static_cast<uint64_t>( iOffset ) + texture.offsets[ uiMip ] + uiPixels > lump.uiSize )
+				return Fail( "texture out of bounds" );
+		}
+	}
+
+	return true;
+}
+
+bool CBSPFile::ValidateReferences()
+{
+	size_t uiCount;
+
+	const size_t uiPlanes = GetCount<bsp::Plane_t>( bsp::LUMP_PLANES );
+	const size_t uiVertexes = GetCount<bsp::Vertex_t>( bsp::LUMP_VERTEXES );
+	const size_t uiNodes = GetCount<bsp::Node_t>( bsp::LUMP_NODES );
+	const size_t uiTexInfos = GetCount<bsp::TexInfo_t>( bsp::LUMP_TEXINFO );
+	const size_t uiFaces = GetCount<bsp::Face_t>( bsp::LUMP_FACES );
+	const size_t uiClipNodes = GetCount<bsp::ClipNode_t>( bsp::LUMP_CLIPNODES );
+	const size_t uiLeafs = GetCount<bsp::Leaf_t>( bsp::LUMP_LEAFS );
+	const size_t uiMarkSurfaces = GetCount<uint16_t>( bsp::LUMP_MARKSURFACES );
+	const size_t uiEdges = GetCount<bsp::Edge_t>( bsp::LUMP_EDGES );
+	const size_t uiSurfEdges = GetCount<int32_t>( bsp::LUMP_SURFEDGES );
+
+	const size_t uiVisibility = m_Lumps[ bsp::LUMP_VISIBILITY ].uiSize;
+	const size_t uiLighting = m_Lumps[ bsp::LUMP_LIGHTING ].uiSize;
+
+	const auto pNodes = GetLump<bsp::Node_t>( bsp::LUMP_NODES, uiCount );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const auto& node = pNodes[ uiIndex ];
+
+		if( !IsValidIndex( node.planenum, uiPlanes ) || !IsValidRange( node.firstface, node.numfaces, uiFaces ) )
+			return Fail( "invalid node" );
+
+		for( const auto child : node.children )
+		{
+			if( child >= 0 ? !IsValidIndex( child, uiNodes ) : !IsValidIndex( -( child + 1 ), uiLeafs ) )
+				return Fail( "invalid node" );
+		}
+	}
+
+	const auto pClipNodes = GetLump<bsp::ClipNode_t>( bsp::LUMP_CLIPNODES, uiCount );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const auto& node = pClipNodes[ uiIndex ];
+
+		if( !IsValidIndex( node.planenum, uiPlanes ) )
+			return Fail( "invalid clip node" );
+
+		//Negative children are contents.
+		for( const auto child : node.children )
+		{
+			if( child >= 0 && !IsValidIndex( child, uiClipNodes ) )
+				return Fail( "invalid clip node" );
+		}
+	}
+
+	const auto pTexInfos = GetLump<bsp::TexInfo_t>( bsp::LUMP_TEXINFO, uiCount );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		if( !IsValidIndex( pTexInfos[ uiIndex ].miptex, m_uiTextureCount ) )
+			return Fail( "invalid texture info" );
+	}
+
+	const auto pFaces = GetLump<bsp::Face_t>( bsp::LUMP_FACES, uiCount );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const auto& face = pFaces[ uiIndex ];
+
+		if( !IsValidIndex( face.planenum, uiPlanes ) ||
+			!IsValidRange( face.firstedge, face.numedges, uiSurfEdges ) ||
+			!IsValidIndex( face.texinfo, uiTexInfos ) ||
+			( face.lightofs != -1 && !IsValidIndex( face.lightofs, uiLighting ) ) )
+			return Fail( "invalid face" );
+	}
+
+	const auto pLeafs = GetLump<bsp::Leaf_t>( bsp::LUMP_LEAFS, uiCount );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const auto& leaf = pLeafs[ uiIndex ];
+
+		if( !IsValidRange( leaf.firstmarksurface, leaf.nummarksurfaces, uiMarkSurfaces ) ||
+			( leaf.visofs != -1 && !IsValidIndex( leaf.visofs, uiVisibility ) ) )
+			return Fail( "invalid leaf" );
+	}
+
+	const auto pMarkSurfaces = GetLump<uint16_t>( bsp::LUMP_MARKSURFACES, uiCount );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		if( !IsValidIndex( pMarkSurfaces[ uiIndex ], uiFaces ) )
+			return Fail( "invalid mark surface" );
+	}
+
+	const auto pEdges = GetLump<bsp::Edge_t>( bsp::LUMP_EDGES, uiCount );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		if( !IsValidIndex( pEdges[ uiIndex ].v[ 0 ], uiVertexes ) || !IsValidIndex( pEdges[ uiIndex ].v[ 1 ], uiVertexes ) )
+			return Fail( "invalid edge" );
+	}
+
+	const auto pSurfEdges = GetLump<int32_t>( bsp::LUMP_SURFEDGES, uiCount );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		//Negative edges are used backwards.
+		const int64_t iEdge = pSurfEdges[ uiIndex ];
+
+		if( !IsValidIndex( iEdge >= 0 ? iEdge : -iEdge, uiEdges ) )
+			return Fail( "invalid surface edge" );
+	}
+
+	const auto pModels = GetLump<bsp::Model_t>( bsp::LUMP_MODELS, uiCount );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const auto& model = pModels[ uiIndex ];
+
+		if( !IsValidRange( model.firstface, model.numfaces, uiFaces ) || ( uiNodes > 0 && !IsValidIndex( model.headnode[ 0 ], uiNodes ) ) )
+			return Fail( "invalid model" );
+
+		for( size_t uiHull = 1; uiHull < bsp::MAX_MAP_HULLS; ++uiHull )
+		{
+			if( model.headnode[ uiHull ] >= 0 && !IsValidIndex( model.headnode[ uiHull ], uiClipNodes ) )
+				return Fail( "invalid model" );
+		}
+	}
+
+	return true;
+}
@@ -0,0 +1,163 @@
+#ifndef ENGINE_CBSPFILE_H
+#define ENGINE_CBSPFILE_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "FileSystem2.h"
+
+#include "BSPFile.h"
+
+/**
+*	A map's lumps, loaded without copying them where possible.
+*	The file is accessed through the filesystem's read buffer, which for mapped pack entries is the pack file's mapping itself,
+*	so lumps that can be used as stored are referenced in place. A lump is only copied if it has to be byte swapped,
+*	or isn't aligned for its structures, and is then swapped in the copy. On little endian systems that is rarely any lump.
+*	Every lump and every index between lumps is validated on load, so users can index lumps without checking.
+*	The file is kept open until the map is unloaded.
+*/
+class CBSPFile final
+{
+public:
+	CBSPFile() = default;
+	~CBSPFile();
+
+	/**
+	*	Loads a map, unloading the current one.
+	*	@return Whether the map was loaded. If not, GetError says why.
+	*/
+	bool Load( IFileSystem2& fileSystem, const char* pszFileName, const char* pszPathID = nullptr );
+
+	void Unload();
+
+	bool IsLoaded() const { return m_pBuffer != nullptr; }
+
+	/**
+	*	@return Why the last Load failed, or an empty string if it didn't.
+	*/
+	const char* GetError() const { return m_pszError; }
+
+	/**
+	*	@return A lump's data, in native byte order. Valid until the map is unloaded.
+	*/
+	const uint8_t* GetLumpData( const bsp::Lump lump, size_t& uiSize ) const
+	{
+		assert( lump >= 0 && lump < bsp::NUM_LUMPS );
+
+		uiSize = m_Lumps[ lump ].uiSize;
+
+		return m_Lumps[ lump ].pData;
+	}
+
+	/**
+	*	@return A lump as an array of its structures.
+	*/
+	template<typename T>
+	const T* GetLump( const bsp::Lump lump, size_t& uiCount ) const
+	{
+		size_t uiSize;
+
+		const auto pData = GetLumpData( lump, uiSize );
+
+		assert( uiSize % sizeof( T ) == 0 );
+
+		uiCount = uiSize / sizeof( T );
+
+		return reinterpret_cast<const T*>( pData );
+	}
+
+	/**
+	*	@return The entity string. Not necessarily null terminated.
+	*/
+	const char* GetEntities( size_t& uiLength ) const
+	{
+		return reinterpret_cast<const char*>( GetLumpData( bsp::LUMP_ENTITIES, uiLength ) );
+	}
+
+	size_t GetTextureCount() const { return m_uiTextureCount; }
+
+	/**
+	*	Gets a texture's header. Its mip levels are at its offset in the texture lump, plus the header's offsets.
+	*	Textures aren't necessarily aligned in the lump, so the header is copied.
+	*	@param uiOffset Offset of the texture in the texture lump.
+	*	@return Whether the texture is stored in the map. False for textures that are stored in WAD files.
+	*/
+	bool GetTexture( const size_t uiIndex, bsp::MipTex_t& texture, size_t& uiOffset ) const;
+
+	/**
+	*	@return Number of bytes of lumps that are used where they are stored.
+	*/
+	size_t GetReferencedBytes() const { return m_uiReferencedBytes; }
+
+	/**
+	*	@return Number of bytes of lumps that had to be copied.
+	*/
+	size_t GetCopiedBytes() const { return m_uiCopiedBytes; }
+
+private:
+	struct LumpView_t
+	{
+		const uint8_t* pData = nullptr;
+		size_t uiSize = 0;
+	};
+
+	/**
+	*	Finds each lump and makes it usable, copying it if needed.
+	*/
+	bool LoadLumps();
+
+	/**
+	*	Checks that the texture lump's offsets and texture headers lie within it.
+	*/
+	bool ValidateTextures();
+
+	/**
+	*	Checks that indices into other lumps are in range.
+	*/
+	bool ValidateReferences();
+
+	template<typename T>
+	size_t GetCount( const bsp::Lump lump ) const
+	{
+		return m_Lumps[ lump ].uiSize / sizeof( T );
+	}
+
+	bool Fail( const char* pszError )
+	{
+		m_pszError = pszError;
+		return false;
+	}
+
+private:
+	IFileSystem2* m_pFileSystem = nullptr;
+
+	FileHandle_t m_hFile = FILESYSTEM_INVALID_HANDLE;
+
+	/**
+	*	The whole file, from GetReadBuffer.
+	*/
+	const uint8_t* m_pBuffer = nullptr;
+	size_t m_uiSize = 0;
+
+	LumpView_t m_Lumps[ bsp::NUM_LUMPS ];
+
+	/**
+	*	Lumps that had to be copied.
+	*/
+	std::unique_ptr<uint8_t[]> m_Copies[ bsp::NUM_LUMPS ];
+
+	size_t m_uiTextureCount = 0;
+
+	size_t m_uiReferencedBytes = 0;
+	size_t m_uiCopiedBytes = 0;
+
+	const char* m_pszError = "";
+
+private:
+	CBSPFile( const CBSPFile& ) = delete;
+	CBSPFile& operator=( const CBSPFile& ) = delete;
+};
+
+#endif //ENGINE_CBSPFILE_H
@@ -0,0 +1,408 @@
+#include <algorithm>
+#include <cstring>
+
+#include "CConsoleScrollback.h"
+
+const size_t CConsoleScrollback::DEFAULT_TEXT_CAPACITY;
+const size_t CConsoleScrollback::DEFAULT_MAX_LINES;
+const size_t CConsoleScrollback::MAX_LINE_LENGTH;
+const size_t CConsoleScrollback::LAYOUT_CACHE_SIZE;
+
+CConsoleScrollback::CConsoleScrollback( const size_t uiTextCapacity, const size_t uiMaxLines )
+	: m_Text( std::max( uiTextCapacity, MAX_LINE_LENGTH ) )
+	, m_Lines( std::max<size_t>( uiMaxLines, 1 ) )
+	, m_Unfinished( MAX_LINE_LENGTH )
+	, m_Layouts( LAYOUT_CACHE_SIZE )
+{
+	static_assert( ( LAYOUT_CACHE_SIZE & ( LAYOUT_CACHE_SIZE - 1 ) ) == 0, "CConsoleScrollback: LAYOUT_CACHE_SIZE must be a power of 2" );
+}
+
+void CConsoleScrollback::Write( const char* pszText, const size_t uiLength )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	size_t uiRemaining = uiLength;
+
+	while( uiRemaining > 0 )
+	{
+		const auto pszEnd = static_cast<const char*>( memchr( pszText, '\n', uiRemaining ) );
+
+		const size_t uiSegment = pszEnd ? static_cast<size_t>( pszEnd - pszText ) : uiRemaining;
+
+		//Whole lines go straight into the ring, the rest waits for the end of its line.
+		if( pszEnd && m_uiUnfinishedLength == 0 && uiSegment <= MAX_LINE_LENGTH )
+		{
+			AddLine( pszText, uiSegment );
+		}
+		else
+		{
+			Append( pszText, uiSegment );
+
+			if( pszEnd )
+				FinishLine();
+		}
+
+		if( !pszEnd )
+			break;
+
+		pszText = pszEnd + 1;
+		uiRemaining -= uiSegment + 1;
+	}
+}
+
+size_t CConsoleScrollback::GetLineCount() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return static_cast<size_t>( m_uiNextLine - m_uiFirstLine ) + ( m_uiUnfinishedLength > 0 ? 1 : 0 );
+}
+
+size_t CConsoleScrollback::GetLayoutCount() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_uiLayoutCount;
+}
+
+void CConsoleScrollback::SetLayout( const int iWidth, const int ( &charWidths )[ 256 ] )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( iWidth == m_iWidth && !memcmp( charWidths, m_CharWidths, sizeof( m_CharWidths ) ) )
+		return;
+
+	m_iWidth = iWidth;
+	memcpy( m_CharWidths, charWidths, sizeof( m_CharWidths ) );
+
+	++m_uiLayoutGeneration;
+}
+
+void CConsoleScrollback::Scroll( int iRows )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( iRows == 0 || !HasLines() )
+		return;
+
+	auto position = GetBottom();
+
+	const uint64_t uiLastLine = GetLastLine();
+
+	if( iRows > 0 )
+	{
+		auto uiRows = static_cast<size_t>( iRows );
+
+		for( ;; )
+		{
+			const size_t uiLineRows = GetLayout( position.uiLine ).rowStarts.size();
+
+			position.uiHiddenRows = std::min( position.uiHiddenRows, uiLineRows - 1 );
+
+			const size_t uiAbove = uiLineRows - 1 - position.uiHiddenRows;
+
+			if( uiRows <= uiAbove )
+			{
+				position.uiHiddenRows += uiRows;
+				break;
+			}
+
+			if( position.uiLine == m_uiFirstLine )
+			{
+				position.uiHiddenRows = uiLineRows - 1;
+				break;
+			}
+
+			uiRows -= uiAbove + 1;
+
+			--position.uiLine;
+			position.uiHiddenRows = 0;
+		}
+	}
+	else
+	{
+		auto uiRows = static_cast<size_t>( -static_cast<int64_t>( iRows ) );
+
+		for( ;; )
+		{
+			if( uiRows <= position.uiHiddenRows )
+			{
+				position.uiHiddenRows -= uiRows;
+				break;
+			}
+
+			if( position.uiLine == uiLastLine )
+			{
+				position.uiHiddenRows = 0;
+				break;
+			}
+
+			uiRows -= position.uiHiddenRows + 1;
+
+			++position.uiLine;
+			position.uiHiddenRows = GetLayout( position.uiLine ).rowStarts.size() - 1;
+		}
+	}
+
+	m_Scroll = position;
+	m_bAtBottom = position.uiLine == uiLastLine && position.uiHiddenRows == 0;
+}
+
+void CConsoleScrollback::ScrollToBottom()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_bAtBottom = true;
+}
+
+bool CConsoleScrollback::IsAtBottom() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_bAtBottom;
+}
+
+void CConsoleScrollback::Append( const char* pszText, size_t uiLength )
+{
+	for( ;; )
+	{
+		const size_t uiCopy = std::min( uiLength, MAX_LINE_LENGTH - m_uiUnfinishedLength );
+
+		memcpy( m_Unfinished.data() + m_uiUnfinishedLength, pszText, uiCopy );
+
+		m_uiUnfinishedLength += uiCopy;
+
+		pszText += uiCopy;
+		uiLength -= uiCopy;
+
+		if( uiLength == 0 )
+			break;
+
+		FinishLine();
+	}
+}
+
+void CConsoleScrollback::FinishLine()
+{
+	AddLine( m_Unfinished.data(), m_uiUnfinishedLength );
+
+	m_uiUnfinishedLength = 0;
+}
+
+void CConsoleScrollback::AddLine( const char* pszText, size_t uiLength )
+{
+	if( uiLength > 0 && pszText[ uiLength - 1 ] == '\r' )
+		--uiLength;
+
+	size_t uiOffset = m_uiWriteOffset;
+
+	//Text is never split, so a line that doesn't fit at the end starts over at the beginning.
+	const bool bWrapped = uiOffset + uiLength > m_Text.size();
+
+	if( bWrapped )
+		uiOffset = 0;
+
+	const size_t uiEnd = uiOffset + uiLength;
+
+	//Lines are in the same order as their text, so the lines being overwritten are always the oldest ones.
+	while( m_uiFirstLine < m_uiNextLine )
+	{
+		const auto& oldest = m_Lines[ m_uiFirstLine % m_Lines.size() ];
+
+		const bool bFull = m_uiNextLine - m_uiFirstLine >= m_Lines.size();
+		const bool bSkipped = bWrapped && oldest.uiOffset >= m_uiWriteOffset;
+		const bool bOverwritten = oldest.uiOffset < uiEnd && ( oldest.uiOffset >= uiOffset || oldest.uiOffset + oldest.uiLength > uiOffset );
+
+		if( !bFull && !bSkipped && !bOverwritten )
+			break;
+
+		++m_uiFirstLine;
+	}
+
+	memcpy( m_Text.data() + uiOffset, pszText, uiLength );
+
+	m_Lines[ m_uiNextLine % m_Lines.size() ] = { uiOffset, uiLength };
+
+	++m_uiNextLine;
+
+	m_uiWriteOffset = uiEnd;
+}
+
+uint64_t CConsoleScrollback::GetLastLine() const
+{
+	return m_uiUnfinishedLength > 0 ? m_uiNextLine : m_uiNextLine - 1;
+}
+
+bool CConsoleScrollback::HasLines() const
+{
+	return m_uiFirstLine < m_uiNextLine || m_uiUnfinishedLength > 0;
+}
+
+const char* CConsoleScrollback::GetLineText( const uint64_t uiLine, size_t& uiLength ) const
+{
+	if( uiLine == m_uiNextLine )
+	{
+		uiLength = m_uiUnfinishedLength;
+		return m_Unfinished.data();
+	}
+
+	const auto& line = m_Lines[ uiLine % m_Lines.size() ];
+
+	uiLength = line.uiLength;
+
+	return m_Text.data() + line.uiOffset;
+}
+
+const CConsoleScrollback::Layout_t& CConsoleScrollback::GetLayout( const uint64_t uiLine )
+{
+	size_t uiLength;
+
+	const char* pszText = GetLineText( uiLine, uiLength );
+
+	auto& layout = m_Layouts[ uiLine & ( LAYOUT_CACHE_SIZE - 1 ) ];
+
+	if( layout.uiLine == uiLine && layout.uiGeneration == m_uiLayoutGeneration && layout.uiLength == uiLength )
+		return layout;
+
+	++m_uiLayoutCount;
+
+	layout.uiLine = uiLine;
+	layout.uiGeneration = m_uiLayoutGeneration;
+	layout.uiLength = uiLength;
+
+	layout.rowStarts.clear();
+	layout.rowStarts.push_back( 0 );
+
+	if( m_iWidth <= 0 )
+		return layout;
+
+	size_t uiRowStart = 0;
+	size_t uiLastSpace = 0;
+	bool bHasSpace = false;
+
+	int iRowWidth = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiLength; ++uiIndex )
+	{
+		const int iCharWidth = m_CharWidths[ static_cast<uint8_t>( pszText[ uiIndex ] ) ];
+
+		if( iRowWidth + iCharWidth > m_iWidth && uiIndex > uiRowStart )
+		{
+			//Break after the last space if there is one, otherwise in the middle of the word.
+			uiRowStart = bHasSpace ? uiLastSpace + 1 : uiIndex;
+			bHasSpace = false;
+
+			layout.rowStarts.push_back( static_cast<uint32_t>( uiRowStart ) );
+
+			iRowWidth = 0;
+
+			for( size_t uiChar = uiRowStart; uiChar < uiIndex; ++uiChar )
+			{
+				iRowWidth += m_CharWidths[ static_cast<uint8_t>( pszText[ uiChar ] ) ];
+			}
+		}
+
+		if( pszText[ uiIndex ] == ' ' )
+		{
+			uiLastSpace = uiIndex;
+			bHasSpace = true;
+		}
+
+		iRowWidth += iCharWidth;
+	}
+
+	return layout;
+}
+
+CConsoleScrollback::Position_t CConsoleScrollback::GetBottom() const
+{
+	if( m_bAtBottom )
+		return { GetLastLine(), 0 };
+
+	//Dropped while scrolled up.
+	if( m_Scroll.uiLine < m_uiFirstLine )
+		return { m_uiFirstLine, 0 };
+
+	return m_Scroll;
+}
+
+size_t CConsoleScrollback::CollectVisibleRows( const size_t uiRows )
+{
+	m_VisibleRows.clear();
+
+	if( uiRows == 0 || !HasLines() )
+		return 0;
+
+	const auto position = GetBottom();
+
+	uint64_t uiLine = position.uiLine;
+	size_t uiHiddenRows = position.uiHiddenRows;
+
+	//Walk up from the bottom, so only lines that are at least partly visible are laid out.
+	for( ;; )
+	{
+		const auto& layout = GetLayout( uiLine );
+
+		size_t uiLength;
+
+		const char* pszText = GetLineText( uiLine, uiLength );
+
+		const size_t uiLineRows = layout.rowStarts.size();
+
+		for( size_t uiRow = uiLineRows - std::min( uiHiddenRows, uiLineRows - 1 ); uiRow > 0 && m_VisibleRows.size() < uiRows; )
+		{
+			--uiRow;
+
+			const size_t uiStart = layout.rowStarts[ uiRow ];
+			const size_t uiEnd = uiRow + 1 < uiLineRows ? layout.rowStarts[ uiRow + 1 ] : uiLength;
+
+			m_VisibleRows.push_back( { pszText + uiStart, uiEnd - uiStart } );
+		}
+
+		if( m_VisibleRows.size() >= uiRows || uiLine == m_uiFirstLine )
+			break;
+
+		--uiLine;
+		uiHiddenRows = 0;
+	}
+
+	std::reverse( m_VisibleRows.begin(), m_VisibleRows.end() );
+
+	//Scrolled up past the oldest line, so fill the console with the rows below it instead, and move the bottom down to match.
+	if( !m_bAtBottom && m_VisibleRows.size() < uiRows )
+	{
+		const uint64_t uiLastLine = GetLastLine();
+
+		uiLine = position.uiLine;
+		uiHiddenRows = std::min( position.uiHiddenRows, GetLayout( uiLine ).rowStarts.size() - 1 );
+
+		while( m_VisibleRows.size() < uiRows )
+		{
+			if( uiHiddenRows == 0 )
+			{
+				if( uiLine == uiLastLine )
+					break;
+
+				++uiLine;
+				uiHiddenRows = GetLayout( uiLine ).rowStarts.size();
+			}
+
+			const auto& layout = GetLayout( uiLine );
+
+			size_t uiLength;
+
+			const char* pszText = GetLineText( uiLine, uiLength );
+
+			const size_t uiRow = layout.rowStarts.size() - uiHiddenRows--;
+
+			const size_t uiStart = layout.rowStarts[ uiRow ];
+			const size_t uiEnd = uiRow + 1 < layout.rowStarts.size() ? layout.rowStarts[ uiRow + 1 ] : uiLength;
+
+			m_VisibleRows.push_back( { pszText + uiStart, uiEnd - uiStart } );
+		}
+
+		m_Scroll = { uiLine, uiHiddenRows };
+		m_bAtBottom = uiLine == uiLastLine && uiHiddenRows == 0;
+	}
+
+	return m_VisibleRows.size();
+}
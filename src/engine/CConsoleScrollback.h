@@ -0,0 +1,239 @@
+#ifndef ENGINE_CCONSOLESCROLLBACK_H
+#define ENGINE_CCONSOLESCROLLBACK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include "ILogSink.h"
+
+/**
+*	Keeps the most recent log lines for the console to show.
+*	Text is copied into a fixed size ring, and old lines are dropped to make room, so logging never allocates and costs one copy per line.
+*	Lines are only wrapped to the console's width when they are shown or scrolled past, so logging while the console is closed
+*	never lays out text. Layouts are kept in a small cache, and recomputed when the width or font changes.
+*	Meant to be added to the logger with Log_AddSink. Everything else is called by the thread that draws the console.
+*/
+class CConsoleScrollback final : public ILogSink
+{
+public:
+	static const size_t DEFAULT_TEXT_CAPACITY = 256 * 1024;
+
+	static const size_t DEFAULT_MAX_LINES = 8192;
+
+	/**
+	*	Longer lines are split.
+	*/
+	static const size_t MAX_LINE_LENGTH = 1024;
+
+	/**
+	*	Number of line layouts that are cached. Must be a power of 2.
+	*/
+	static const size_t LAYOUT_CACHE_SIZE = 256;
+
+public:
+	/**
+	*	@param uiTextCapacity Bytes of text that are kept. At least MAX_LINE_LENGTH.
+	*	@param uiMaxLines Number of lines that are kept.
+	*/
+	CConsoleScrollback( const size_t uiTextCapacity = DEFAULT_TEXT_CAPACITY, const size_t uiMaxLines = DEFAULT_MAX_LINES );
+
+	void Write( const char* pszText, const size_t uiLength ) override;
+
+	void Flush() override {}
+
+	/**
+	*	@return Number of lines that are kept, including an unfinished last line.
+	*/
+	size_t GetLineCount() const;
+
+	/**
+	*	@return Number of times a line was laid out.
+	*/
+	size_t GetLayoutCount() const;
+
+	/**
+	*	Sets how lines are wrapped. Lines are laid out again if this changes.
+	*	@param iWidth Width of a row, in pixels. 0 or less to never wrap.
+	*	@param charWidths Width of each character, in pixels.
+	*/
+	void SetLayout( const int iWidth, const int ( &charWidths )[ 256 ] );
+
+	/**
+	*	Scrolls by a number of rows. Positive values scroll towards older lines.
+	*	Lines that are scrolled past are laid out, but no others.
+	*/
+	void Scroll( int iRows );
+
+	/**
+	*	Shows the newest line at the bottom, and keeps it there as lines are added.
+	*/
+	void ScrollToBottom();
+
+	bool IsAtBottom() const;
+
+	/**
+	*	Calls a function for each visible row, top to bottom: func( const char* pszText, size_t uiLength ).
+	*	The text is not null terminated, and is only valid during the call. Logging is blocked while this runs.
+	*	@param uiRows Number of rows that fit in the console.
+	*	@return Number of rows that were visited. Fewer than uiRows if there aren't enough lines to fill the console.
+	*/
+	template<typename FUNC>
+	size_t VisitVisibleRows( const size_t uiRows, FUNC&& func );
+
+private:
+	struct Line_t
+	{
+		size_t uiOffset;
+		size_t uiLength;
+	};
+
+	struct Layout_t
+	{
+		/**
+		*	Line that this is the layout of, or -1 if none.
+		*/
+		uint64_t uiLine = static_cast<uint64_t>( -1 );
+
+		/**
+		*	Layout settings and line length it was computed with. The unfinished line gets longer without changing its number.
+		*/
+		uint32_t uiGeneration = 0;
+		size_t uiLength = 0;
+
+		/**
+		*	Offset of each row's first character.
+		*/
+		std::vector<uint32_t> rowStarts;
+	};
+
+	struct Row_t
+	{
+		const char* pszText;
+		size_t uiLength;
+	};
+
+	/**
+	*	Where the bottom of the console is.
+	*/
+	struct Position_t
+	{
+		uint64_t uiLine;
+
+		/**
+		*	Number of the line's rows below the bottom of the console.
+		*/
+		size_t uiHiddenRows;
+	};
+
+	/**
+	*	Adds text to the unfinished line. Must be called with the mutex held.
+	*/
+	void Append( const char* pszText, size_t uiLength );
+
+	/**
+	*	Adds the unfinished line as a line. Must be called with the mutex held.
+	*/
+	void FinishLine();
+
+	/**
+	*	Copies a line into the ring, dropping the oldest lines to make room. Must be called with the mutex held.
+	*/
+	void AddLine( const char* pszText, size_t uiLength );
+
+	/**
+	*	@return Number of the newest line, which is the unfinished one if it has text. Only valid if there are lines.
+	*/
+	uint64_t GetLastLine() const;
+
+	/**
+	*	@return Whether there are any lines. Must be called with the mutex held.
+	*/
+	bool HasLines() const;
+
+	/**
+	*	@return Text of a line. Must be called with the mutex held.
+	*/
+	const char* GetLineText( const uint64_t uiLine, size_t& uiLength ) const;
+
+	/**
+	*	Gets a line's layout, laying it out if it isn't cached. Must be called with the mutex held.
+	*/
+	const Layout_t& GetLayout( const uint64_t uiLine );
+
+	/**
+	*	@return Where the bottom of the console is, moved to the oldest line if its line was dropped. Must be called with the mutex held.
+	*/
+	Position_t GetBottom() const;
+
+	/**
+	*	Finds the visible rows and stores them in m_VisibleRows. Must be called with the mutex held.
+	*/
+	size_t CollectVisibleRows( const size_t uiRows );
+
+private:
+	mutable std::mutex m_Mutex;
+
+	std::vector<char> m_Text;
+
+	/**
+	*	Where the next line's text goes.
+	*/
+	size_t m_uiWriteOffset = 0;
+
+	/**
+	*	Ring of lines. Line n is stored at n % size.
+	*/
+	std::vector<Line_t> m_Lines;
+
+	/**
+	*	Number of the oldest line that is kept, and of the next line to be added.
+	*/
+	uint64_t m_uiFirstLine = 0;
+	uint64_t m_uiNextLine = 0;
+
+	/**
+	*	Text of the line being written, which will be line m_uiNextLine.
+	*/
+	std::vector<char> m_Unfinished;
+	size_t m_uiUnfinishedLength = 0;
+
+	int m_iWidth = 0;
+	int m_CharWidths[ 256 ] = {};
+
+	/**
+	*	Incremented whenever the layout settings change, which invalidates all cached layouts.
+	*/
+	uint32_t m_uiLayoutGeneration = 1;
+
+	std::vector<Layout_t> m_Layouts;
+
+	size_t m_uiLayoutCount = 0;
+
+	bool m_bAtBottom = true;
+	Position_t m_Scroll{};
+
+	std::vector<Row_t> m_VisibleRows;
+
+private:
+	CConsoleScrollback( const CConsoleScrollback& ) = delete;
+	CConsoleScrollback& operator=( const CConsoleScrollback& ) = delete;
+};
+
+template<typename FUNC>
+size_t CConsoleScrollback::VisitVisibleRows( const size_t uiRows, FUNC&& func )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	const size_t uiCount = CollectVisibleRows( uiRows );
+
+	for( size_t uiRow = 0; uiRow < uiCount; ++uiRow )
+	{
+		func( m_VisibleRows[ uiRow ].pszText, m_VisibleRows[ uiRow ].uiLength );
+	}
+
+	return uiCount;
+}
+
+#endif //ENGINE_CCONSOLESCROLLBACK_H
@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "CDemoPlayer.h"
+
+bool CDemoPlayer::Open( const char* pszFileName )
+{
+	Close();
+
+	if( !m_File.Open( pszFileName ) )
+		return false;
+
+	demo::Header_t header;
+
+	if( !m_File.IsValidRange( 0, sizeof( header ) ) )
+	{
+		Close();
+		return false;
+	}
+
+	memcpy( &header, m_File.GetData(), sizeof( header ) );
+
+	if( memcmp( header.identifier, demo::IDENTIFIER, sizeof( header.identifier ) ) || header.uiVersion != demo::VERSION )
+	{
+		Close();
+		return false;
+	}
+
+	const uint64_t uiFileSize = m_File.GetSize();
+
+	bool bHasIndex = false;
+
+	if( uiFileSize >= sizeof( demo::Header_t ) + sizeof( demo::Footer_t ) )
+	{
+		demo::Footer_t footer;
+
+		memcpy( &footer, m_File.GetData() + uiFileSize - sizeof( footer ), sizeof( footer ) );
+
+		const uint64_t uiIndexSize = static_cast<uint64_t>( footer.uiIndexEntries ) * sizeof( demo::IndexEntry_t );
+
+		if( !memcmp( footer.identifier, demo::INDEX_IDENTIFIER, sizeof( footer.identifier ) ) &&
+			footer.uiIndexOffset >= sizeof( demo::Header_t ) &&
+			m_File.IsValidRange( footer.uiIndexOffset, uiIndexSize ) &&
+			footer.uiIndexOffset + uiIndexSize == uiFileSize - sizeof( footer ) )
+		{
+			m_Index.resize( footer.uiIndexEntries );
+
+			if( !m_Index.empty() )
+				memcpy( m_Index.data(), m_File.GetData() + footer.uiIndexOffset, uiIndexSize );
+
+			m_uiDataEnd = footer.uiIndexOffset;
+
+			bHasIndex = true;
+		}
+	}
+
+	if( !bHasIndex )
+		RebuildIndex( static_cast<int64_t>( std::max( header.uiSeekIntervalMS, 1u ) ) * 1000 );
+
+	//The last message is at most a seek interval past the last seek point.
+	uint64_t uiOffset = m_Index.empty() ? sizeof( demo::Header_t ) : m_Index.back().uiOffset;
+
+	demo::ChunkHeader_t chunk;
+
+	while( ReadChunkHeader( uiOffset, chunk ) )
+	{
+		uint64_t uiMessage = uiOffset + sizeof( chunk );
+
+		uiOffset = uiMessage + chunk.uiSize;
+
+		demo::MessageHeader_t message;
+
+		while( uiMessage + sizeof( message ) <= uiOffset )
+		{
+			memcpy( &message, m_File.GetData() + uiMessage, sizeof( message ) );
+
+			m_iDurationUS = std::max( m_iDurationUS, chunk.iStartTimeUS + message.uiTimeUS );
+
+			uiMessage += sizeof( message ) + PadNumber<uint64_t>( message.uiSize, 4 );
+		}
+	}
+
+	Seek( 0 );
+
+	return true;
+}
+
+void CDemoPlayer::Close()
+{
+	m_File.Close();
+
+	m_Index.clear();
+
+	m_uiDataEnd = 0;
+	m_iDurationUS = 0;
+	m_iTimeUS = 0;
+	m_uiChunkEnd = 0;
+	m_iChunkStartUS = 0;
+	m_uiOffset = 0;
+}
+
+void CDemoPlayer::Advance( const double flSeconds )
+{
+	m_iTimeUS += std::llround( flSeconds * 1e6 );
+}
+
+void CDemoPlayer::Seek( const double flTime )
+{
+	m_iTimeUS = std::max<int64_t>( std::llround( flTime * 1e6 ), 0 );
+
+	//Start from the last seek point at or before the time.
+	auto it = std::upper_bound( m_Index.begin(), m_Index.end(), m_iTimeUS,
+		[]( const int64_t iTimeUS, const demo::IndexEntry_t& entry )
+		{
+			return iTimeUS < entry.iTimeUS;
+		}
+	);
+
+	if( !EnterChunk( it == m_Index.begin() ? sizeof( demo::Header_t ) : ( it - 1 )->uiOffset ) )
+		return;
+
+	demo::MessageHeader_t header;
+
+	while( FindNextMessage( header ) && m_iChunkStartUS + header.uiTimeUS < m_iTimeUS )
+	{
+		m_uiOffset += sizeof( header ) + PadNumber<uint64_t>( header.uiSize, 4 );
+	}
+}
+
+CNetworkBuffer* CDemoPlayer::ReadMessage()
+{
+	demo::MessageHeader_t header;
+
+	if( !FindNextMessage( header ) || m_iChunkStartUS + header.uiTimeUS > m_iTimeUS )
+		return nullptr;
+
+	//The mapping is read only, which is fine since the buffer is only read from.
+	m_Message.SetBuffer( "demo", const_cast<uint8_t*>( m_File.GetData() + m_uiOffset + sizeof( header ) ), header.uiSize );
+
+	m_uiOffset += sizeof( header ) + PadNumber<uint64_t>( header.uiSize, 4 );
+
+	return &m_Message;
+}
+
+bool CDemoPlayer::ReadChunkHeader( const uint64_t uiOffset, demo::ChunkHeader_t& header ) const
+{
+	if( uiOffset % 4 != 0 || uiOffset > m_uiDataEnd || m_uiDataEnd - uiOffset < sizeof( header ) )
+		return false;
+
+	memcpy( &header, m_File.GetData() + uiOffset, sizeof( header ) );
+
+	return header.uiSize % 4 == 0 && header.uiSize <= m_uiDataEnd - uiOffset - sizeof( header );
+}
+
+bool CDemoPlayer::EnterChunk( const uint64_t uiOffset )
+{
+	demo::ChunkHeader_t header;
+
+	if( !ReadChunkHeader( uiOffset, header ) )
+	{
+		m_uiChunkEnd = m_uiOffset = m_uiDataEnd;
+		return false;
+	}
+
+	m_iChunkStartUS = header.iStartTimeUS;
+	m_uiOffset = uiOffset + sizeof( header );
+	m_uiChunkEnd = m_uiOffset + header.uiSize;
+
+	return true;
+}
+
+bool CDemoPlayer::FindNextMessage( demo::MessageHeader_t& header )
+{
+	while( true )
+	{
+		if( m_uiOffset >= m_uiChunkEnd )
+		{
+			if( m_uiChunkEnd >= m_uiDataEnd || !EnterChunk( m_uiChunkEnd ) )
+				return false;
+
+			continue;
+		}
+
+		if( m_uiChunkEnd - m_uiOffset >= sizeof( header ) )
+		{
+			memcpy( &header, m_File.GetData() + m_uiOffset, sizeof( header ) );
+
+			if( PadNumber<uint64_t>( header.uiSize, 4 ) <= m_uiChunkEnd - m_uiOffset - sizeof( header ) )
+				return true;
+		}
+
+		m_uiOffset = m_uiChunkEnd;
+	}
+}
+
+void CDemoPlayer::RebuildIndex( const int64_t iSeekIntervalUS )
+{
+	m_Index.clear();
+
+	//Chunks that were cut off by the end of the file are ignored.
+	m_uiDataEnd = m_File.GetSize();
+
+	uint64_t uiOffset = sizeof( demo::Header_t );
+	int64_t iNextSeekUS = 0;
+
+	demo::ChunkHeader_t header;
+
+	while( ReadChunkHeader( uiOffset, header ) )
+	{
+		if( header.iStartTimeUS >= iNextSeekUS )
+		{
+			m_Index.push_back( { header.iStartTimeUS, uiOffset } );
+			iNextSeekUS = ( header.iStartTimeUS / iSeekIntervalUS + 1 ) * iSeekIntervalUS;
+		}
+
+		uiOffset += sizeof( header ) + header.uiSize;
+	}
+
+	m_uiDataEnd = uiOffset;
+}
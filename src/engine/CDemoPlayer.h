@@ -0,0 +1,126 @@
+#ifndef ENGINE_CDEMOPLAYER_H
+#define ENGINE_CDEMOPLAYER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "CMappedFile.h"
+#include "CNetworkBuffer.h"
+
+#include "DemoFile.h"
+
+/**
+*	Plays back demos written by CDemoRecorder.
+*	The file is memory mapped, and messages are handed out as buffers that point into the mapping, so nothing is copied.
+*	Seeking uses the demo's seek index to find the closest chunk, then skips the messages before the time without reading them.
+*	Messages skipped by a seek are never handed out, so the client must be able to pick up from any message, as it does with ticks.
+*	@see CDemoRecorder
+*/
+class CDemoPlayer final
+{
+public:
+	CDemoPlayer() = default;
+
+	/**
+	*	Opens a demo, and starts playing it from the start.
+	*	@param pszFileName Full path of the demo.
+	*	@return Whether the demo could be mapped and has a valid header.
+	*/
+	bool Open( const char* pszFileName );
+
+	void Close();
+
+	bool IsOpen() const { return m_File.IsOpen(); }
+
+	/**
+	*	@return Whether every message has been handed out.
+	*/
+	bool IsFinished() const { return m_uiChunkEnd >= m_uiDataEnd && m_uiOffset >= m_uiChunkEnd; }
+
+	/**
+	*	@return Time of the last message, in seconds.
+	*/
+	double GetDuration() const { return m_iDurationUS / 1e6; }
+
+	/**
+	*	@return Playback position, in seconds.
+	*/
+	double GetTime() const { return m_iTimeUS / 1e6; }
+
+	/**
+	*	@return Number of entries in the seek index. Includes entries rebuilt for demos that weren't stopped properly.
+	*/
+	size_t GetSeekPointCount() const { return m_Index.size(); }
+
+	/**
+	*	Moves the playback position forward.
+	*/
+	void Advance( const double flSeconds );
+
+	/**
+	*	Moves the playback position. The next message handed out is the first one recorded at or after the time.
+	*/
+	void Seek( const double flTime );
+
+	/**
+	*	Gets the next message recorded at or before the playback position.
+	*	@return Buffer to read the message from, or null if there are no more messages yet. Valid until the next call, and must not be written to.
+	*/
+	CNetworkBuffer* ReadMessage();
+
+private:
+	/**
+	*	Reads the chunk header at an offset.
+	*	@return Whether the whole chunk lies within the recorded data.
+	*/
+	bool ReadChunkHeader( const uint64_t uiOffset, demo::ChunkHeader_t& header ) const;
+
+	/**
+	*	Moves to the chunk at an offset.
+	*	@return Whether it's a valid chunk. If not, playback is finished.
+	*/
+	bool EnterChunk( const uint64_t uiOffset );
+
+	/**
+	*	Reads the header of the next message, without moving past it. Moves on to the next chunk as needed.
+	*	Messages that don't fit in their chunk end the chunk.
+	*	@return Whether there is a next message.
+	*/
+	bool FindNextMessage( demo::MessageHeader_t& header );
+
+	/**
+	*	Finds the seek points of a demo that has no index, and the end of its last complete chunk.
+	*/
+	void RebuildIndex( const int64_t iSeekIntervalUS );
+
+private:
+	CMappedFile m_File;
+
+	std::vector<demo::IndexEntry_t> m_Index;
+
+	/**
+	*	End of the last chunk.
+	*/
+	uint64_t m_uiDataEnd = 0;
+
+	int64_t m_iDurationUS = 0;
+
+	int64_t m_iTimeUS = 0;
+
+	uint64_t m_uiChunkEnd = 0;
+	int64_t m_iChunkStartUS = 0;
+
+	/**
+	*	Offset of the next message.
+	*/
+	uint64_t m_uiOffset = 0;
+
+	CNetworkBuffer m_Message;
+
+private:
+	CDemoPlayer( const CDemoPlayer& ) = delete;
+	CDemoPlayer& operator=( const CDemoPlayer& ) = delete;
+};
+
+#endif //ENGINE_CDEMOPLAYER_H
@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "CNetworkBuffer.h"
+
+#include "CDemoRecorder.h"
+
+const size_t CDemoRecorder::CHUNK_SIZE;
+const unsigned int CDemoRecorder::DEFAULT_SEEK_INTERVAL_MS;
+
+CDemoRecorder::~CDemoRecorder()
+{
+	Stop();
+}
+
+bool CDemoRecorder::Start( IFileSystem2& fileSystem, const char* pszFileName, const char* pszPathID, const unsigned int uiSeekIntervalMS )
+{
+	Stop();
+
+	m_pFileSystem = &fileSystem;
+
+	m_hFile = m_pFileSystem->Open( pszFileName, "wb", pszPathID );
+
+	if( m_hFile == FILESYSTEM_INVALID_HANDLE )
+		return false;
+
+	m_szFileName = pszFileName;
+	m_iSeekIntervalUS = static_cast<int64_t>( std::max( uiSeekIntervalMS, 1u ) ) * 1000;
+	m_bStarted = false;
+	m_uiFileOffset = 0;
+	m_Chunk.clear();
+	m_Chunk.reserve( CHUNK_SIZE );
+	m_iNextSeekUS = 0;
+	m_Index.clear();
+	m_uiMessages = 0;
+	m_bFailed = false;
+
+	demo::Header_t header{};
+
+	memcpy( header.identifier, demo::IDENTIFIER, sizeof( header.identifier ) );
+	header.uiVersion = demo::VERSION;
+	header.uiSeekIntervalMS = uiSeekIntervalMS;
+
+	Write( &header, sizeof( header ) );
+
+	return true;
+}
+
+bool CDemoRecorder::Stop()
+{
+	if( !IsRecording() )
+		return false;
+
+	WriteChunk();
+
+	demo::Footer_t footer{};
+
+	footer.uiIndexOffset = m_uiFileOffset;
+	footer.uiIndexEntries = static_cast<uint32_t>( m_Index.size() );
+	memcpy( footer.identifier, demo::INDEX_IDENTIFIER, sizeof( footer.identifier ) );
+
+	Write( m_Index.data(), m_Index.size() * sizeof( demo::IndexEntry_t ) );
+	Write( &footer, sizeof( footer ) );
+
+	//Write errors are only known once everything is on disk.
+	m_pFileSystem->Flush( m_hFile );
+
+	const bool bSuccess = !m_bFailed && m_pFileSystem->IsOk( m_hFile );
+
+	CloseFile();
+
+	return bSuccess;
+}
+
+void CDemoRecorder::WriteMessage( const std::chrono::steady_clock::time_point time, const CNetworkBuffer& message )
+{
+	if( !IsRecording() || m_bFailed )
+		return;
+
+	if( !m_bStarted )
+	{
+		m_StartTime = time;
+		m_bStarted = true;
+	}
+
+	const int64_t iTimeUS = std::max<int64_t>( std::chrono::duration_cast<std::chrono::microseconds>( time - m_StartTime ).count(), 0 );
+
+	const size_t uiSize = message.GetMaxBytes();
+	const size_t uiPaddedSize = PadNumber( uiSize, static_cast<size_t>( 4 ) );
+
+	if( !m_Chunk.empty() )
+	{
+		if( iTimeUS >= m_iNextSeekUS ||
+			m_Chunk.size() + sizeof( demo::MessageHeader_t ) + uiPaddedSize > CHUNK_SIZE ||
+			iTimeUS - m_ChunkHeader.iStartTimeUS > std::numeric_limits<uint32_t>::max() )
+		{
+			WriteChunk();
+		}
+	}
+
+	if( m_Chunk.empty() )
+	{
+		if( iTimeUS >= m_iNextSeekUS )
+		{
+			m_Index.push_back( { iTimeUS, m_uiFileOffset } );
+			m_iNextSeekUS = ( iTimeUS / m_iSeekIntervalUS + 1 ) * m_iSeekIntervalUS;
+		}
+
+		m_ChunkHeader = {};
+		m_ChunkHeader.iStartTimeUS = iTimeUS;
+
+		m_Chunk.resize( sizeof( demo::ChunkHeader_t ) );
+	}
+
+	demo::MessageHeader_t header;
+
+	header.uiTimeUS = static_cast<uint32_t>( iTimeUS - m_ChunkHeader.iStartTimeUS );
+	header.uiSize = static_cast<uint32_t>( uiSize );
+
+	const size_t uiOffset = m_Chunk.size();
+
+	//Padding is zeroed by the resize.
+	m_Chunk.resize( uiOffset + sizeof( header ) + uiPaddedSize );
+
+	memcpy( m_Chunk.data() + uiOffset, &header, sizeof( header ) );
+	memcpy( m_Chunk.data() + uiOffset + sizeof( header ), message.GetData(), uiSize );
+
+	++m_ChunkHeader.uiMessageCount;
+	++m_uiMessages;
+}
+
+void CDemoRecorder::WriteChunk()
+{
+	if( m_Chunk.empty() )
+		return;
+
+	m_ChunkHeader.uiSize = static_cast<uint32_t>( m_Chunk.size() - sizeof( demo::ChunkHeader_t ) );
+
+	memcpy( m_Chunk.data(), &m_ChunkHeader, sizeof( m_ChunkHeader ) );
+
+	Write( m_Chunk.data(), m_Chunk.size() );
+
+	m_Chunk.clear();
+}
+
+bool CDemoRecorder::Write( const void* pData, const size_t uiSize )
+{
+	if( m_bFailed )
+		return false;
+
+	if( uiSize == 0 )
+		return true;
+
+	if( m_pFileSystem->Write( pData, static_cast<int>( uiSize ), m_hFile ) != static_cast<int>( uiSize ) )
+	{
+		m_bFailed = true;
+		return false;
+	}
+
+	m_uiFileOffset += uiSize;
+
+	return true;
+}
+
+void CDemoRecorder::CloseFile()
+{
+	if( m_hFile != FILESYSTEM_INVALID_HANDLE )
+	{
+		m_pFileSystem->Close( m_hFile );
+		m_hFile = FILESYSTEM_INVALID_HANDLE;
+	}
+
+	m_szFileName.clear();
+	m_Chunk.clear();
+	m_Index.clear();
+}
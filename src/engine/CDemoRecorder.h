@@ -0,0 +1,142 @@
+#ifndef ENGINE_CDEMORECORDER_H
+#define ENGINE_CDEMORECORDER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FileSystem2.h"
+
+#include "DemoFile.h"
+
+class CNetworkBuffer;
+
+/**
+*	Records the messages the client receives, with the time they were received, to a demo file.
+*	Messages are collected into chunks, and each chunk is written through the filesystem once it's full, or once a seek interval has passed,
+*	so with write-behind enabled the disk is never touched on the calling thread.
+*	@see CDemoPlayer
+*/
+class CDemoRecorder final
+{
+public:
+	/**
+	*	Chunks are written once they hold this much.
+	*/
+	static const size_t CHUNK_SIZE = 64 * 1024;
+
+	static const unsigned int DEFAULT_SEEK_INTERVAL_MS = 5000;
+
+public:
+	CDemoRecorder() = default;
+
+	/**
+	*	Stops recording, if a demo is being recorded.
+	*/
+	~CDemoRecorder();
+
+	bool IsRecording() const { return m_hFile != FILESYSTEM_INVALID_HANDLE; }
+
+	/**
+	*	@return Whether a write failed. Messages recorded after that are discarded.
+	*/
+	bool HasFailed() const { return m_bFailed; }
+
+	/**
+	*	@return Name of the demo being recorded, or an empty string if none is.
+	*/
+	const std::string& GetFileName() const { return m_szFileName; }
+
+	/**
+	*	Starts recording. Stops recording the previous demo first.
+	*	@param fileSystem Filesystem to write through. Must outlive the recording.
+	*	@param pszFileName Name of the demo file.
+	*	@param pszPathID Path ID to write to.
+	*	@param uiSeekIntervalMS Time between seek points, in milliseconds.
+	*	@return Whether the file could be created.
+	*/
+	bool Start( IFileSystem2& fileSystem, const char* pszFileName, const char* pszPathID = nullptr,
+				const unsigned int uiSeekIntervalMS = DEFAULT_SEEK_INTERVAL_MS );
+
+	/**
+	*	Writes the rest of the demo and its seek index, and closes the file.
+	*	@return Whether everything was written.
+	*/
+	bool Stop();
+
+	/**
+	*	Records a message. Recording starts at the time of the first message.
+	*	@param time When the message was received.
+	*	@param message Message to record. All of its bytes are recorded, regardless of its read position.
+	*/
+	void WriteMessage( const std::chrono::steady_clock::time_point time, const CNetworkBuffer& message );
+
+	/**
+	*	@return Number of messages recorded so far.
+	*/
+	uint64_t GetMessageCount() const { return m_uiMessages; }
+
+	/**
+	*	@return Number of bytes recorded so far, including the chunk that hasn't been written yet.
+	*/
+	uint64_t GetSize() const { return m_uiFileOffset + m_Chunk.size(); }
+
+private:
+	/**
+	*	Writes the current chunk, if it has any messages.
+	*/
+	void WriteChunk();
+
+	/**
+	*	Writes data to the file. Once a write fails, nothing else is written.
+	*/
+	bool Write( const void* pData, const size_t uiSize );
+
+	void CloseFile();
+
+private:
+	IFileSystem2* m_pFileSystem = nullptr;
+
+	FileHandle_t m_hFile = FILESYSTEM_INVALID_HANDLE;
+
+	std::string m_szFileName;
+
+	int64_t m_iSeekIntervalUS = 0;
+
+	std::chrono::steady_clock::time_point m_StartTime;
+	bool m_bStarted = false;
+
+	/**
+	*	Offset in the file that the current chunk will be written to.
+	*/
+	uint64_t m_uiFileOffset = 0;
+
+	/**
+	*	Current chunk, including its header.
+	*/
+	std::vector<uint8_t> m_Chunk;
+
+	demo::ChunkHeader_t m_ChunkHeader{};
+
+	/**
+	*	Messages recorded at or after this time start a new chunk with a seek index entry.
+	*/
+	int64_t m_iNextSeekUS = 0;
+
+	std::vector<demo::IndexEntry_t> m_Index;
+
+	uint64_t m_uiMessages = 0;
+
+	/**
+	*	Set if a write failed.
+	*/
+	bool m_bFailed = false;
+
+private:
+	CDemoRecorder( const CDemoRecorder& ) = delete;
+	CDemoRecorder& operator=( const CDemoRecorder& ) = delete;
+};
+
+#endif //ENGINE_CDEMORECORDER_H
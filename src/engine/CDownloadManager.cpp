@@ -0,0 +1,1086 @@
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef WIN32
+#include <ws2tcpip.h>
+#else
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include "Platform.h"
+
+#include "CDownloadManager.h"
+
+const size_t CDownloadManager::MAX_CONNECTIONS;
+const size_t CDownloadManager::PIPELINE_DEPTH;
+const unsigned int CDownloadManager::MAX_ATTEMPTS;
+const uint64_t CDownloadManager::MAX_FILE_SIZE;
+const size_t CDownloadManager::MAX_HEADER_SIZE;
+const int CDownloadManager::POLL_INTERVAL_MS;
+const char CDownloadManager::PART_EXTENSION[] = ".part";
+
+namespace
+{
+const size_t RECEIVE_CHUNK_SIZE = 64 * 1024;
+
+const char HTTP_PREFIX[] = "http://";
+
+#ifdef WIN32
+using PollFD_t = WSAPOLLFD;
+
+const short POLL_READ = POLLRDNORM;
+const short POLL_WRITE = POLLWRNORM;
+
+int Poll( PollFD_t* pFDs, const size_t uiCount, const int iTimeoutMS )
+{
+	return WSAPoll( pFDs, static_cast<ULONG>( uiCount ), iTimeoutMS );
+}
+
+void CloseSocket( const CDownloadManager::Socket_t socket )
+{
+	closesocket( socket );
+}
+
+bool WouldBlock()
+{
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+const int SEND_FLAGS = 0;
+#else
+using PollFD_t = pollfd;
+
+const short POLL_READ = POLLIN;
+const short POLL_WRITE = POLLOUT;
+
+int Poll( PollFD_t* pFDs, const size_t uiCount, const int iTimeoutMS )
+{
+	return poll( pFDs, static_cast<nfds_t>( uiCount ), iTimeoutMS );
+}
+
+void CloseSocket( const CDownloadManager::Socket_t socket )
+{
+	close( socket );
+}
+
+bool WouldBlock()
+{
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+//Closed connections must not raise SIGPIPE.
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#endif
+
+/**
+*	Appends a file name to a URL, escaping everything but unreserved characters and slashes.
+*/
+void AppendEscaped( std::string& szURL, const std::string& szName )
+{
+	static const char HEX_DIGITS[] = "0123456789ABCDEF";
+
+	for( const char character : szName )
+	{
+		const unsigned char uiChar = static_cast<unsigned char>( character );
+
+		if( isalnum( uiChar ) || strchr( "-._~/", character ) )
+		{
+			szURL += character;
+		}
+		else
+		{
+			szURL += '%';
+			szURL += HEX_DIGITS[ uiChar >> 4 ];
+			szURL += HEX_DIGITS[ uiChar & 0xF ];
+		}
+	}
+}
+
+bool EqualsNoCase( const char* pszLHS, const size_t uiLength, const char* pszRHS )
+{
+	return strlen( pszRHS ) == uiLength && !strnicmp( pszLHS, pszRHS, uiLength );
+}
+
+/**
+*	@return Whether a header value contains a token, ignoring case, such as "close" in "Connection: keep-alive, close".
+*/
+bool HasToken( const std::string& szValue, const char* pszToken )
+{
+	size_t uiStart = 0;
+
+	while( uiStart < szValue.size() )
+	{
+		size_t uiEnd = szValue.find( ',', uiStart );
+
+		if( uiEnd == std::string::npos )
+			uiEnd = szValue.size();
+
+		size_t uiFirst = uiStart;
+		size_t uiLast = uiEnd;
+
+		while( uiFirst < uiLast && isspace( static_cast<unsigned char>( szValue[ uiFirst ] ) ) )
+			++uiFirst;
+
+		while( uiLast > uiFirst && isspace( static_cast<unsigned char>( szValue[ uiLast - 1 ] ) ) )
+			--uiLast;
+
+		if( EqualsNoCase( szValue.c_str() + uiFirst, uiLast - uiFirst, pszToken ) )
+			return true;
+
+		uiStart = uiEnd + 1;
+	}
+
+	return false;
+}
+
+/**
+*	@return Whether a file name from the server stays inside the directory it's saved to.
+*/
+bool IsSafeFileName( const std::string& szName )
+{
+	if( szName.empty() || szName.front() == '/' || szName.back() == '/' || szName.find( ':' ) != std::string::npos )
+		return false;
+
+	size_t uiStart = 0;
+
+	while( uiStart <= szName.size() )
+	{
+		size_t uiEnd = szName.find( '/', uiStart );
+
+		if( uiEnd == std::string::npos )
+			uiEnd = szName.size();
+
+		const size_t uiLength = uiEnd - uiStart;
+
+		if( uiLength == 0 || ( uiLength == 1 && szName[ uiStart ] == '.' ) || ( uiLength == 2 && !szName.compare( uiStart, 2, ".." ) ) )
+			return false;
+
+		uiStart = uiEnd + 1;
+	}
+
+	return true;
+}
+}
+
+CDownloadManager::~CDownloadManager()
+{
+	Stop();
+}
+
+bool CDownloadManager::Start( IFileSystem2& fileSystem, const char* pszBaseURL, const char* pszSearchPath, const char* pszPathID, const size_t uiConnections )
+{
+	Stop();
+
+	if( !pszBaseURL || !pszSearchPath || !pszPathID )
+		return false;
+
+	if( strnicmp( pszBaseURL, HTTP_PREFIX, sizeof( HTTP_PREFIX ) - 1 ) )
+		return false;
+
+	//The I/O and finish threads open, write and remove files while the game keeps using the filesystem.
+	if( !( fileSystem.GetOptions() & FileSystemOption::THREAD_SAFE ) )
+		return false;
+
+	//Split into host, port and path.
+	const char* const pszHost = pszBaseURL + sizeof( HTTP_PREFIX ) - 1;
+	const char* pszPath = strchr( pszHost, '/' );
+
+	if( !pszPath )
+		pszPath = pszHost + strlen( pszHost );
+
+	std::string szHostPort( pszHost, pszPath );
+
+	const size_t uiColon = szHostPort.rfind( ':' );
+
+	if( uiColon != std::string::npos && szHostPort.find( ']' ) == std::string::npos )
+	{
+		m_szHost = szHostPort.substr( 0, uiColon );
+		m_szPort = szHostPort.substr( uiColon + 1 );
+	}
+	else
+	{
+		m_szHost = szHostPort;
+		m_szPort = "80";
+	}
+
+	if( m_szHost.empty() || m_szPort.empty() )
+		return false;
+
+	m_szPathPrefix = pszPath;
+
+	if( m_szPathPrefix.empty() || m_szPathPrefix.back() != '/' )
+		m_szPathPrefix += '/';
+
+	m_pFileSystem = &fileSystem;
+	m_szBaseURL = pszBaseURL;
+	m_szSearchPath = pszSearchPath;
+	m_szPathID = pszPathID;
+	m_uiConnections = std::max<size_t>( 1, std::min( uiConnections, MAX_CONNECTIONS ) );
+
+#ifdef WIN32
+	WSADATA data;
+
+	if( WSAStartup( MAKEWORD( 2, 2 ), &data ) != 0 )
+		return false;
+#else
+	if( pipe2( m_WakePipe, O_NONBLOCK | O_CLOEXEC ) != 0 )
+	{
+		m_WakePipe[ 0 ] = m_WakePipe[ 1 ] = -1;
+		return false;
+	}
+#endif
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_FailedFiles.clear();
+	}
+
+	m_uiQueued = 0;
+	m_uiCompleted = 0;
+	m_uiFailed = 0;
+	m_uiBytesReceived = 0;
+	m_uiConnectFailures = 0;
+	m_uiAddressLength = 0;
+
+	m_bStop = false;
+	m_bFinishStop = false;
+
+	m_FinishThread = std::thread( &CDownloadManager::FinishThread, this );
+	m_IOThread = std::thread( &CDownloadManager::IOThread, this );
+
+	return true;
+}
+
+void CDownloadManager::Stop()
+{
+	if( !m_IOThread.joinable() )
+		return;
+
+	m_bStop = true;
+	Wake();
+
+	m_IOThread.join();
+
+	//The I/O thread handed over the files it had open, finish them before stopping.
+	{
+		std::lock_guard<std::mutex> lock( m_FinishMutex );
+
+		m_bFinishStop = true;
+	}
+
+	m_FinishCondition.notify_one();
+
+	m_FinishThread.join();
+
+	CloseSockets();
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Queue.clear();
+	m_QueuedNames.clear();
+}
+
+bool CDownloadManager::Queue( const char* pszFileName )
+{
+	if( !IsRunning() || !pszFileName )
+		return false;
+
+	std::string szName = pszFileName;
+
+	std::replace( szName.begin(), szName.end(), '\\', '/' );
+
+	if( !IsSafeFileName( szName ) )
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( m_QueuedNames.find( szName ) != m_QueuedNames.end() )
+			return false;
+	}
+
+	if( m_pFileSystem->FileExists( szName.c_str() ) )
+		return false;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( !m_QueuedNames.insert( szName ).second )
+			return false;
+
+		m_Queue.push_back( { std::move( szName ), 0 } );
+	}
+
+	++m_uiQueued;
+
+	Wake();
+
+	return true;
+}
+
+CDownloadManager::Progress_t CDownloadManager::GetProgress() const
+{
+	Progress_t progress;
+
+	progress.uiQueued = m_uiQueued;
+	progress.uiCompleted = m_uiCompleted;
+	progress.uiFailed = m_uiFailed;
+	progress.uiBytesReceived = m_uiBytesReceived;
+
+	return progress;
+}
+
+bool CDownloadManager::IsIdle() const
+{
+	return m_uiCompleted + m_uiFailed >= m_uiQueued;
+}
+
+std::vector<std::string> CDownloadManager::GetFailedFiles() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_FailedFiles;
+}
+
+void CDownloadManager::IOThread()
+{
+	std::vector<PollFD_t> fds;
+
+	const bool bResolved = Resolve();
+
+	while( !m_bStop )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			while( !m_Queue.empty() )
+			{
+				m_Pending.push_back( std::move( m_Queue.front() ) );
+				m_Queue.pop_front();
+			}
+		}
+
+		//A server that can't be reached fails everything that is queued, so the client doesn't wait forever.
+		if( !bResolved || m_uiConnectFailures >= MAX_ATTEMPTS )
+		{
+			while( !m_Pending.empty() )
+			{
+				Fail( m_Pending.front().szName );
+				m_Pending.pop_front();
+			}
+		}
+
+		OpenConnections();
+
+		for( auto& connection : m_Connections )
+		{
+			if( !connection.bConnecting && !connection.bClosing )
+				SendRequests( connection );
+		}
+
+		fds.clear();
+
+#ifndef WIN32
+		fds.push_back( { m_WakePipe[ 0 ], POLL_READ, 0 } );
+#endif
+
+		const size_t uiFirstConnection = fds.size();
+
+		for( const auto& connection : m_Connections )
+		{
+			const bool bWrite = connection.bConnecting || connection.uiSent < connection.send.size();
+
+			fds.push_back( { connection.socket, static_cast<short>( POLL_READ | ( bWrite ? POLL_WRITE : 0 ) ), 0 } );
+		}
+
+		if( Poll( fds.data(), fds.size(), POLL_INTERVAL_MS ) < 0 )
+			continue;
+
+#ifndef WIN32
+		if( fds[ 0 ].revents )
+		{
+			char buffer[ 64 ];
+
+			while( read( m_WakePipe[ 0 ], buffer, sizeof( buffer ) ) > 0 )
+			{
+			}
+		}
+#endif
+
+		for( size_t uiIndex = 0; uiIndex < fds.size() - uiFirstConnection; ++uiIndex )
+		{
+			auto& connection = m_Connections[ uiIndex ];
+
+			const short revents = fds[ uiFirstConnection + uiIndex ].revents;
+
+			if( !revents )
+				continue;
+
+			if( connection.bConnecting )
+			{
+				CompleteConnect( connection );
+				continue;
+			}
+
+			if( revents & ~POLL_WRITE )
+				Receive( connection );
+
+			if( !connection.bClosed )
+				Send( connection );
+		}
+
+		for( auto& connection : m_Connections )
+		{
+			if( connection.bClosed )
+				CloseConnection( connection );
+		}
+
+		m_Connections.erase( std::remove_if( m_Connections.begin(), m_Connections.end(),
+			[]( const Connection_t& connection )
+			{
+				return connection.bClosed;
+			}
+		), m_Connections.end() );
+	}
+
+	//Partly received files are removed.
+	for( auto& connection : m_Connections )
+	{
+		if( connection.response.hFile != FILESYSTEM_INVALID_HANDLE )
+			QueueFinished( { connection.response.hFile, connection.requests.front().szName, false } );
+
+		CloseSocket( connection.socket );
+	}
+
+	m_Connections.clear();
+	m_Pending.clear();
+}
+
+void CDownloadManager::FinishThread()
+{
+	std::unique_lock<std::mutex> lock( m_FinishMutex );
+
+	while( true )
+	{
+		m_FinishCondition.wait( lock, [ this ]() { return !m_Finished.empty() || m_bFinishStop; } );
+
+		if( m_Finished.empty() )
+			return;
+
+		auto finished = std::move( m_Finished.front() );
+		m_Finished.pop_front();
+
+		lock.unlock();
+
+		const std::string szPartName = finished.szName + PART_EXTENSION;
+
+		//Waits until write-behind has written everything, which is why this isn't done on the I/O thread.
+		m_pFileSystem->Flush( finished.hFile );
+
+		bool bSucceeded = finished.bComplete && m_pFileSystem->IsOk( finished.hFile );
+
+		m_pFileSystem->Close( finished.hFile );
+
+		if( bSucceeded )
+		{
+			const std::string szPartPath = m_szSearchPath + '/' + szPartName;
+			const std::string szPath = m_szSearchPath + '/' + finished.szName;
+
+			//Windows won't rename over an existing file.
+			remove( szPath.c_str() );
+
+			bSucceeded = rename( szPartPath.c_str(), szPath.c_str() ) == 0;
+		}
+
+		if( bSucceeded )
+		{
+			//One index update for each name instead of a rescan.
+			m_pFileSystem->UpdateOverlayFile( m_szSearchPath.c_str(), szPartName.c_str() );
+			m_pFileSystem->UpdateOverlayFile( m_szSearchPath.c_str(), finished.szName.c_str() );
+
+			++m_uiCompleted;
+		}
+		else
+		{
+			m_pFileSystem->RemoveFile( szPartName.c_str(), m_szPathID.c_str() );
+
+			//Files that were cut off by Stop aren't failures, just not downloaded.
+			if( finished.bComplete || !m_bStop )
+				Fail( finished.szName );
+		}
+
+		lock.lock();
+	}
+}
+
+bool CDownloadManager::Resolve()
+{
+	addrinfo hints;
+
+	memset( &hints, 0, sizeof( hints ) );
+
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_protocol = IPPROTO_TCP;
+
+	std::string szHost = m_szHost;
+
+	//IPv6 addresses are in brackets in URLs.
+	if( szHost.size() >= 2 && szHost.front() == '[' && szHost.back() == ']' )
+		szHost = szHost.substr( 1, szHost.size() - 2 );
+
+	addrinfo* pResult = nullptr;
+
+	if( getaddrinfo( szHost.c_str(), m_szPort.c_str(), &hints, &pResult ) != 0 || !pResult )
+		return false;
+
+	memcpy( &m_Address, pResult->ai_addr, pResult->ai_addrlen );
+	m_uiAddressLength = static_cast<socklen_t>( pResult->ai_addrlen );
+
+	freeaddrinfo( pResult );
+
+	return true;
+}
+
+void CDownloadManager::OpenConnections()
+{
+	if( m_uiAddressLength == 0 )
+		return;
+
+	size_t uiCapacity = 0;
+
+	for( const auto& connection : m_Connections )
+	{
+		if( !connection.bClosing )
+			uiCapacity += PIPELINE_DEPTH - std::min( PIPELINE_DEPTH, connection.requests.size() );
+	}
+
+	while( m_Connections.size() < m_uiConnections && m_Pending.size() > uiCapacity )
+	{
+#ifdef WIN32
+		const Socket_t socket = ::socket( m_Address.ss_family, SOCK_STREAM, IPPROTO_TCP );
+
+		if( socket == INVALID_SOCKET )
+			return;
+
+		u_long uiNonBlocking = 1;
+
+		if( ioctlsocket( socket, FIONBIO, &uiNonBlocking ) != 0 )
+		{
+			CloseSocket( socket );
+			return;
+		}
+
+		const bool bInProgress = connect( socket, reinterpret_cast<const sockaddr*>( &m_Address ), m_uiAddressLength ) != 0 && WSAGetLastError() == WSAEWOULDBLOCK;
+#else
+		const Socket_t socket = ::socket( m_Address.ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP );
+
+		if( socket < 0 )
+			return;
+
+		const bool bInProgress = connect( socket, reinterpret_cast<const sockaddr*>( &m_Address ), m_uiAddressLength ) != 0 && errno == EINPROGRESS;
+#endif
+
+		Connection_t connection;
+
+		connection.socket = socket;
+
+		//Connections to the local machine can complete right away, CompleteConnect checks for errors either way.
+		connection.bConnecting = true;
+
+		if( !bInProgress )
+		{
+			int iError = 0;
+			socklen_t uiLength = sizeof( iError );
+
+			getsockopt( socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>( &iError ), &uiLength );
+
+			if( iError != 0 )
+			{
+				CloseSocket( socket );
+				++m_uiConnectFailures;
+				return;
+			}
+		}
+
+		//Requests are small, and pipelined ones should go out right away.
+		const int iNoDelay = 1;
+
+		setsockopt( socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>( &iNoDelay ), sizeof( iNoDelay ) );
+
+		m_Connections.push_back( std::move( connection ) );
+
+		uiCapacity += PIPELINE_DEPTH;
+	}
+}
+
+void CDownloadManager::SendRequests( Connection_t& connection )
+{
+	const size_t uiFirst = connection.requests.size();
+
+	while( connection.requests.size() < PIPELINE_DEPTH && !m_Pending.empty() )
+	{
+		connection.requests.push_back( std::move( m_Pending.front() ) );
+		m_Pending.pop_front();
+	}
+
+	for( size_t uiIndex = uiFirst; uiIndex < connection.requests.size(); ++uiIndex )
+	{
+		auto& send = connection.send;
+
+		send += "GET ";
+		AppendEscaped( send, m_szPathPrefix + connection.requests[ uiIndex ].szName );
+		send += " HTTP/1.1\r\nHost: ";
+		send += m_szHost;
+
+		if( m_szPort != "80" )
+		{
+			send += ':';
+			send += m_szPort;
+		}
+
+		send += "\r\nUser-Agent: GoldSource2\r\nAccept-Encoding: identity\r\n\r\n";
+	}
+
+	if( uiFirst < connection.requests.size() )
+		Send( connection );
+}
+
+void CDownloadManager::CompleteConnect( Connection_t& connection )
+{
+	int iError = 0;
+	socklen_t uiLength = sizeof( iError );
+
+	if( getsockopt( connection.socket, SOL_SOCKET, SO_ERROR, reinterpret_cast<char*>( &iError ), &uiLength ) != 0 || iError != 0 )
+	{
+		connection.bClosed = true;
+		++m_uiConnectFailures;
+		return;
+	}
+
+	connection.bConnecting = false;
+	m_uiConnectFailures = 0;
+}
+
+void CDownloadManager::Receive( Connection_t& connection )
+{
+	char buffer[ RECEIVE_CHUNK_SIZE ];
+
+	while( !connection.bClosed )
+	{
+		const auto iResult = recv( connection.socket, buffer, sizeof( buffer ), 0 );
+
+		if( iResult <= 0 )
+		{
+			if( iResult == 0 || !WouldBlock() )
+			{
+				//The body of a response without a length ends here.
+				if( iResult == 0 && connection.response.bHeadersDone && connection.response.bodyType == BodyType::UNTIL_CLOSE )
+					EndResponse( connection, true );
+
+				connection.bClosed = true;
+			}
+
+			return;
+		}
+
+		connection.received.append( buffer, static_cast<size_t>( iResult ) );
+
+		if( !ParseResponses( connection ) )
+			connection.bClosed = true;
+	}
+}
+
+void CDownloadManager::Send( Connection_t& connection )
+{
+	while( connection.uiSent < connection.send.size() )
+	{
+		const auto iResult = send( connection.socket, connection.send.data() + connection.uiSent,
+			static_cast<int>( connection.send.size() - connection.uiSent ), SEND_FLAGS );
+
+		if( iResult <= 0 )
+		{
+			if( iResult == 0 || !WouldBlock() )
+				connection.bClosed = true;
+
+			return;
+		}
+
+		connection.uiSent += static_cast<size_t>( iResult );
+	}
+
+	connection.send.clear();
+	connection.uiSent = 0;
+}
+
+bool CDownloadManager::ParseResponses( Connection_t& connection )
+{
+	size_t uiOffset = 0;
+
+	bool bValid = true;
+
+	while( bValid && !connection.requests.empty() && !connection.bClosed )
+	{
+		auto& response = connection.response;
+
+		const char* const pData = connection.received.data() + uiOffset;
+		const size_t uiAvailable = connection.received.size() - uiOffset;
+
+		if( !response.bHeadersDone )
+		{
+			const size_t uiEnd = connection.received.find( "\r\n\r\n", uiOffset );
+
+			if( uiEnd == std::string::npos )
+			{
+				bValid = uiAvailable <= MAX_HEADER_SIZE;
+				break;
+			}
+
+			bValid = ParseHeader( connection, connection.received.substr( uiOffset, uiEnd + 2 - uiOffset ) );
+
+			uiOffset = uiEnd + 4;
+
+			//Empty bodies end right away.
+			if( bValid && response.bodyType == BodyType::CONTENT_LENGTH && response.uiRemaining == 0 )
+				EndResponse( connection, true );
+
+			continue;
+		}
+
+		if( response.bodyType == BodyType::UNTIL_CLOSE )
+		{
+			ReceiveBody( connection, pData, uiAvailable );
+			uiOffset += uiAvailable;
+			break;
+		}
+
+		if( response.bodyType == BodyType::CONTENT_LENGTH || response.chunkState == ChunkState::DATA )
+		{
+			if( uiAvailable == 0 )
+				break;
+
+			const size_t uiSize = static_cast<size_t>( std::min<uint64_t>( uiAvailable, response.uiRemaining ) );
+
+			ReceiveBody( connection, pData, uiSize );
+
+			uiOffset += uiSize;
+			response.uiRemaining -= uiSize;
+
+			if( response.uiRemaining == 0 )
+			{
+				if( response.bodyType == BodyType::CONTENT_LENGTH )
+					EndResponse( connection, true );
+				else
+					response.chunkState = ChunkState::DATA_END;
+			}
+
+			continue;
+		}
+
+		//The chunk framing is made of lines.
+		const size_t uiLineEnd = connection.received.find( "\r\n", uiOffset );
+
+		if( uiLineEnd == std::string::npos )
+		{
+			bValid = uiAvailable <= MAX_HEADER_SIZE;
+			break;
+		}
+
+		const size_t uiLineLength = uiLineEnd - uiOffset;
+
+		switch( response.chunkState )
+		{
+		case ChunkState::SIZE:
+			{
+				char* pEnd;
+
+				const unsigned long long uiSize = strtoull( pData, &pEnd, 16 );
+
+				//Extensions after the size are ignored.
+				if( pEnd == pData || static_cast<size_t>( pEnd - pData ) > uiLineLength )
+				{
+					bValid = false;
+					break;
+				}
+
+				response.uiRemaining = uiSize;
+				response.chunkState = uiSize > 0 ? ChunkState::DATA : ChunkState::TRAILER;
+				break;
+			}
+
+		case ChunkState::DATA_END:
+			bValid = uiLineLength == 0;
+			response.chunkState = ChunkState::SIZE;
+			break;
+
+		default:
+			//Trailer fields are ignored, an empty line ends the response.
+			if( uiLineLength == 0 )
+				EndResponse( connection, true );
+			break;
+		}
+
+		uiOffset = uiLineEnd + 2;
+	}
+
+	connection.received.erase( 0, uiOffset );
+
+	//Data without a request means the server is confused.
+	return bValid && ( !connection.requests.empty() || connection.received.empty() );
+}
+
+bool CDownloadManager::ParseHeader( Connection_t& connection, const std::string& szHeader )
+{
+	auto& response = connection.response;
+
+	int iMajor, iMinor;
+
+	if( sscanf( szHeader.c_str(), "HTTP/%d.%d %d", &iMajor, &iMinor, &response.iStatus ) != 3 )
+		return false;
+
+	response.bHeadersDone = true;
+	response.bodyType = BodyType::UNTIL_CLOSE;
+	response.uiRemaining = 0;
+	response.chunkState = ChunkState::SIZE;
+	response.bClose = iMajor < 1 || ( iMajor == 1 && iMinor == 0 );
+	response.uiBodySize = 0;
+
+	bool bHasLength = false;
+
+	size_t uiLine = szHeader.find( "\r\n" ) + 2;
+
+	while( uiLine < szHeader.size() )
+	{
+		const size_t uiEnd = szHeader.find( "\r\n", uiLine );
+		const size_t uiColon = szHeader.find( ':', uiLine );
+
+		if( uiColon < uiEnd )
+		{
+			const char* const pszName = szHeader.c_str() + uiLine;
+			const size_t uiNameLength = uiColon - uiLine;
+
+			std::string szValue = szHeader.substr( uiColon + 1, uiEnd - uiColon - 1 );
+
+			if( EqualsNoCase( pszName, uiNameLength, "Content-Length" ) )
+			{
+				char* pEnd;
+
+				response.uiRemaining = strtoull( szValue.c_str(), &pEnd, 10 );
+				bHasLength = pEnd != szValue.c_str();
+			}
+			else if( EqualsNoCase( pszName, uiNameLength, "Transfer-Encoding" ) )
+			{
+				if( HasToken( szValue, "chunked" ) )
+					response.bodyType = BodyType::CHUNKED;
+			}
+			else if( EqualsNoCase( pszName, uiNameLength, "Connection" ) )
+			{
+				if( HasToken( szValue, "close" ) )
+					response.bClose = true;
+				else if( HasToken( szValue, "keep-alive" ) )
+					response.bClose = false;
+			}
+		}
+
+		uiLine = uiEnd + 2;
+	}
+
+	//Chunked encoding overrides the length.
+	if( response.bodyType != BodyType::CHUNKED && bHasLength )
+		response.bodyType = BodyType::CONTENT_LENGTH;
+
+	if( response.bodyType == BodyType::UNTIL_CLOSE )
+		response.bClose = true;
+
+	//No more requests go out on a connection that is closing, the ones already sent are requested again elsewhere.
+	if( response.bClose )
+		connection.bClosing = true;
+
+	response.bDiscard = response.iStatus != 200;
+
+	if( response.bodyType == BodyType::CONTENT_LENGTH && response.uiRemaining > MAX_FILE_SIZE )
+		response.bDiscard = true;
+
+	if( !response.bDiscard )
+	{
+		const auto& szName = connection.requests.front().szName;
+
+		const size_t uiSlash = szName.rfind( '/' );
+
+		if( uiSlash != std::string::npos )
+			m_pFileSystem->CreateDirHierarchy( szName.substr( 0, uiSlash ).c_str(), m_szPathID.c_str() );
+
+		response.hFile = m_pFileSystem->Open( ( szName + PART_EXTENSION ).c_str(), "wb", m_szPathID.c_str() );
+
+		response.bDiscard = response.hFile == FILESYSTEM_INVALID_HANDLE;
+	}
+
+	return true;
+}
+
+void CDownloadManager::ReceiveBody( Connection_t& connection, const char* pData, const size_t uiSize )
+{
+	auto& response = connection.response;
+
+	response.uiBodySize += uiSize;
+	m_uiBytesReceived += uiSize;
+
+	if( response.bDiscard )
+		return;
+
+	if( response.uiBodySize > MAX_FILE_SIZE || m_pFileSystem->Write( pData, static_cast<int>( uiSize ), response.hFile ) != static_cast<int>( uiSize ) )
+	{
+		//Keep receiving the body so the responses after it can be read, but the file is lost.
+		response.bDiscard = true;
+		response.bFailed = true;
+
+		QueueFinished( { response.hFile, connection.requests.front().szName, false } );
+
+		response.hFile = FILESYSTEM_INVALID_HANDLE;
+	}
+}
+
+void CDownloadManager::EndResponse( Connection_t& connection, const bool bComplete )
+{
+	auto& response = connection.response;
+
+	auto download = std::move( connection.requests.front() );
+
+	connection.requests.pop_front();
+
+	if( response.hFile != FILESYSTEM_INVALID_HANDLE )
+	{
+		QueueFinished( { response.hFile, std::move( download.szName ), bComplete } );
+	}
+	else if( response.bFailed )
+	{
+		//The finish thread has already counted it.
+	}
+	else if( response.iStatus >= 500 || !bComplete )
+	{
+		//Server errors may be temporary.
+		++download.uiAttempts;
+		Retry( std::move( download ) );
+	}
+	else
+	{
+		Fail( download.szName );
+	}
+
+	const bool bClose = response.bClose;
+
+	response = Response_t();
+
+	++connection.uiResponses;
+
+	if( bClose )
+		connection.bClosed = true;
+}
+
+void CDownloadManager::CloseConnection( Connection_t& connection )
+{
+	CloseSocket( connection.socket );
+
+	auto& response = connection.response;
+
+	if( !connection.requests.empty() )
+	{
+		if( response.bFailed )
+		{
+			//Writing it failed and was counted, so it isn't requested again.
+			connection.requests.pop_front();
+		}
+		else if( response.bHeadersDone || !connection.received.empty() || connection.uiResponses == 0 )
+		{
+			//The response that was cut off counts as an attempt, the requests after it were never answered.
+			//So does the first request on a connection that was closed without an answer, a server that always does that isn't retried forever.
+			if( response.hFile != FILESYSTEM_INVALID_HANDLE )
+			{
+				QueueFinished( { response.hFile, connection.requests.front().szName, false } );
+				response.hFile = FILESYSTEM_INVALID_HANDLE;
+			}
+
+			++connection.requests.front().uiAttempts;
+		}
+
+		while( !connection.requests.empty() )
+		{
+			Retry( std::move( connection.requests.front() ) );
+			connection.requests.pop_front();
+		}
+	}
+}
+
+void CDownloadManager::Retry( Download_t&& download )
+{
+	if( download.uiAttempts >= MAX_ATTEMPTS )
+	{
+		Fail( download.szName );
+		return;
+	}
+
+	m_Pending.push_front( std::move( download ) );
+}
+
+void CDownloadManager::Fail( const std::string& szName )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_FailedFiles.push_back( szName );
+	}
+
+	++m_uiFailed;
+}
+
+void CDownloadManager::QueueFinished( Finished_t&& finished )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_FinishMutex );
+
+		m_Finished.push_back( std::move( finished ) );
+	}
+
+	m_FinishCondition.notify_one();
+}
+
+void CDownloadManager::Wake()
+{
+#ifndef WIN32
+	if( m_WakePipe[ 1 ] != -1 )
+	{
+		const char value = 0;
+
+		if( write( m_WakePipe[ 1 ], &value, 1 ) < 0 )
+		{
+			//The pipe is full, so the thread will wake up anyway.
+		}
+	}
+#endif
+}
+
+void CDownloadManager::CloseSockets()
+{
+#ifdef WIN32
+	WSACleanup();
+#else
+	for( auto& fd : m_WakePipe )
+	{
+		if( fd != -1 )
+		{
+			close( fd );
+			fd = -1;
+		}
+	}
+#endif
+}
@@ -0,0 +1,387 @@
+#ifndef ENGINE_CDOWNLOADMANAGER_H
+#define ENGINE_CDOWNLOADMANAGER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#endif
+
+#include "FileSystem2.h"
+
+/**
+*	Downloads missing resources from a server's fast download URL, a web server that has the server's content directory.
+*	Files are fetched over several persistent connections at once, and requests are pipelined on each connection,
+*	so content-heavy servers don't cost a connection and a round trip per file.
+*	The I/O thread writes responses to "<name>.part" through the filesystem as they arrive, with write-behind if it is enabled, so it never waits for the disk.
+*	A second thread closes finished files, renames them into place and updates the overlay's index for both names,
+*	so files show up in lookups once they're complete, without a rescan.
+*	Only plain http:// URLs are supported.
+*/
+class CDownloadManager final
+{
+public:
+#ifdef WIN32
+	using Socket_t = SOCKET;
+#else
+	using Socket_t = int;
+#endif
+
+	/**
+	*	Most connections that are opened to the server.
+	*/
+	static const size_t MAX_CONNECTIONS = 8;
+
+	/**
+	*	Most requests sent on a connection before their responses arrive.
+	*/
+	static const size_t PIPELINE_DEPTH = 4;
+
+	/**
+	*	How many times a file is requested before it's given up on. Files the server doesn't have aren't requested again.
+	*/
+	static const unsigned int MAX_ATTEMPTS = 3;
+
+	/**
+	*	Largest file that is downloaded, in bytes.
+	*/
+	static const uint64_t MAX_FILE_SIZE = 512 * 1024 * 1024;
+
+	/**
+	*	Largest response header that is accepted, in bytes.
+	*/
+	static const size_t MAX_HEADER_SIZE = 16 * 1024;
+
+	/**
+	*	Longest time the I/O thread waits for the sockets before checking whether it should stop.
+	*/
+	static const int POLL_INTERVAL_MS = 50;
+
+	/**
+	*	Appended to the names of files while they're downloaded.
+	*/
+	static const char PART_EXTENSION[];
+
+	struct Progress_t
+	{
+		/**
+		*	Files that were queued since the manager was started.
+		*/
+		size_t uiQueued = 0;
+
+		size_t uiCompleted = 0;
+		size_t uiFailed = 0;
+
+		/**
+		*	Response bodies received, including those of files that failed.
+		*/
+		uint64_t uiBytesReceived = 0;
+	};
+
+public:
+	CDownloadManager() = default;
+
+	/**
+	*	Stops the manager, if it is running.
+	*/
+	~CDownloadManager();
+
+	bool IsRunning() const { return m_IOThread.joinable(); }
+
+	const std::string& GetBaseURL() const { return m_szBaseURL; }
+
+	/**
+	*	Starts the I/O and finishing threads. Stops the manager first.
+	*	@param fileSystem Filesystem to write through. Must outlive the manager, and be thread safe since the threads use it alongside the game.
+	*	@param pszBaseURL URL that file names are appended to, e.g. http://example.com/cstrike.
+	*	@param pszSearchPath Overlay search path that files are saved to, added with AddOverlaySearchPath.
+	*	@param pszPathID Path ID of the overlay search path. It must be the only writable search path with that ID.
+	*	@param uiConnections Number of connections to open. Clamped to [ 1, MAX_CONNECTIONS ].
+	*	@return Whether the URL is valid, the filesystem is thread safe and the threads were started.
+	*/
+	bool Start( IFileSystem2& fileSystem, const char* pszBaseURL, const char* pszSearchPath, const char* pszPathID, const size_t uiConnections );
+
+	/**
+	*	Drops the files that are queued, closes all connections and stops the threads.
+	*	Files that were partly downloaded are removed.
+	*/
+	void Stop();
+
+	/**
+	*	Queues a file, unless it already exists or was queued before.
+	*	Names that could point outside of the overlay, such as ones with .. in them, are refused; they come from the server.
+	*	@return Whether the file was queued.
+	*/
+	bool Queue( const char* pszFileName );
+
+	Progress_t GetProgress() const;
+
+	/**
+	*	@return Whether every queued file was downloaded or given up on.
+	*/
+	bool IsIdle() const;
+
+	/**
+	*	@return Names of the files that couldn't be downloaded.
+	*/
+	std::vector<std::string> GetFailedFiles() const;
+
+private:
+	struct Download_t
+	{
+		std::string szName;
+
+		unsigned int uiAttempts = 0;
+	};
+
+	enum class BodyType
+	{
+		CONTENT_LENGTH = 0,
+		CHUNKED,
+
+		/**
+		*	Servers that send neither a length nor chunks end the body by closing the connection.
+		*/
+		UNTIL_CLOSE
+	};
+
+	enum class ChunkState
+	{
+		SIZE = 0,
+		DATA,
+		DATA_END,
+		TRAILER
+	};
+
+	/**
+	*	Response that is being received.
+	*/
+	struct Response_t
+	{
+		bool bHeadersDone = false;
+
+		int iStatus = 0;
+
+		BodyType bodyType = BodyType::CONTENT_LENGTH;
+
+		/**
+		*	Bytes left in the body, or in the current chunk.
+		*/
+		uint64_t uiRemaining = 0;
+
+		ChunkState chunkState = ChunkState::SIZE;
+
+		/**
+		*	Whether the server closes the connection after this response.
+		*/
+		bool bClose = false;
+
+		FileHandle_t hFile = FILESYSTEM_INVALID_HANDLE;
+
+		uint64_t uiBodySize = 0;
+
+		/**
+		*	Whether the body is discarded, because the status isn't 200 or the file couldn't be opened.
+		*/
+		bool bDiscard = false;
+
+		/**
+		*	Whether writing the file failed. The file was handed to the finish thread, which counts the failure.
+		*/
+		bool bFailed = false;
+	};
+
+	struct Connection_t
+	{
+		Socket_t socket;
+
+		bool bConnecting = true;
+		bool bClosed = false;
+
+		/**
+		*	Whether the connection closes once the current response has been received.
+		*/
+		bool bClosing = false;
+
+		std::string send;
+		size_t uiSent = 0;
+
+		/**
+		*	Received data that hasn't been parsed yet.
+		*/
+		std::string received;
+
+		/**
+		*	Files that were requested, in the order the responses arrive.
+		*/
+		std::deque<Download_t> requests;
+
+		Response_t response;
+
+		/**
+		*	Number of responses received in full.
+		*/
+		unsigned int uiResponses = 0;
+	};
+
+	/**
+	*	File that the finishing thread closes and renames into place, or removes.
+	*/
+	struct Finished_t
+	{
+		FileHandle_t hFile;
+
+		std::string szName;
+
+		bool bComplete;
+	};
+
+	void IOThread();
+
+	void FinishThread();
+
+	/**
+	*	@return Whether the server's address was resolved.
+	*/
+	bool Resolve();
+
+	/**
+	*	Opens connections while there are more files to request than the open connections can take.
+	*/
+	void OpenConnections();
+
+	/**
+	*	Sends requests for queued files on a connection, up to PIPELINE_DEPTH.
+	*/
+	void SendRequests( Connection_t& connection );
+
+	void CompleteConnect( Connection_t& connection );
+
+	void Receive( Connection_t& connection );
+
+	void Send( Connection_t& connection );
+
+	/**
+	*	Parses as much of the received data as possible.
+	*	@return Whether the data is valid HTTP.
+	*/
+	bool ParseResponses( Connection_t& connection );
+
+	/**
+	*	@return Whether the response header is valid.
+	*/
+	bool ParseHeader( Connection_t& connection, const std::string& szHeader );
+
+	/**
+	*	Writes part of a response body, or discards it.
+	*/
+	void ReceiveBody( Connection_t& connection, const char* pData, const size_t uiSize );
+
+	/**
+	*	Ends the response at the front of the connection and starts the next one.
+	*/
+	void EndResponse( Connection_t& connection, const bool bComplete );
+
+	/**
+	*	Requeues the files requested on a connection that was closed. The one whose response was interrupted counts as an attempt.
+	*/
+	void CloseConnection( Connection_t& connection );
+
+	/**
+	*	Queues a file to request again, or gives up on it.
+	*/
+	void Retry( Download_t&& download );
+
+	void Fail( const std::string& szName );
+
+	void QueueFinished( Finished_t&& finished );
+
+	/**
+	*	Wakes up the I/O thread.
+	*/
+	void Wake();
+
+	void CloseSockets();
+
+private:
+	IFileSystem2* m_pFileSystem = nullptr;
+
+	std::string m_szBaseURL;
+
+	std::string m_szSearchPath;
+	std::string m_szPathID;
+
+	size_t m_uiConnections = 1;
+
+	//Parsed from the URL.
+	std::string m_szHost;
+	std::string m_szPort;
+	std::string m_szPathPrefix;
+
+	std::thread m_IOThread;
+	std::thread m_FinishThread;
+
+	std::atomic<bool> m_bStop{ false };
+
+#ifndef WIN32
+	/**
+	*	Pipe that wakes up the I/O thread when written to.
+	*/
+	int m_WakePipe[ 2 ] = { -1, -1 };
+#endif
+
+	/**
+	*	Guards the queue, the names that were queued and the failed files.
+	*/
+	mutable std::mutex m_Mutex;
+
+	std::deque<Download_t> m_Queue;
+
+	std::unordered_set<std::string> m_QueuedNames;
+
+	std::vector<std::string> m_FailedFiles;
+
+	std::atomic<size_t> m_uiQueued{ 0 };
+	std::atomic<size_t> m_uiCompleted{ 0 };
+	std::atomic<size_t> m_uiFailed{ 0 };
+	std::atomic<uint64_t> m_uiBytesReceived{ 0 };
+
+	std::mutex m_FinishMutex;
+	std::condition_variable m_FinishCondition;
+	std::deque<Finished_t> m_Finished;
+	bool m_bFinishStop = false;
+
+	//Only used by the I/O thread.
+	sockaddr_storage m_Address;
+	socklen_t m_uiAddressLength = 0;
+
+	std::vector<Connection_t> m_Connections;
+
+	/**
+	*	Files to request, taken from the queue.
+	*/
+	std::deque<Download_t> m_Pending;
+
+	/**
+	*	Connection attempts that failed in a row. Everything is given up on once every attempt to reach the server failed.
+	*/
+	unsigned int m_uiConnectFailures = 0;
+
+private:
+	CDownloadManager( const CDownloadManager& ) = delete;
+	CDownloadManager& operator=( const CDownloadManager& ) = delete;
+};
+
+#endif //ENGINE_CDOWNLOADMANAGER_H
@@ -0,0 +1,523 @@
+#include <algorithm>
+#include <cstring>
+
+#include "CProgramCache.h"
+#include "GLUtils.h"
+
+#include "CEffectsRenderer.h"
+
+namespace
+{
+const char EFFECT_VERTEX_SHADER[] =
+	"#version 330 core\n"
+	"uniform mat4 viewProjection;\n"
+	"layout( location = 0 ) in vec3 origin;\n"
+	"layout( location = 1 ) in vec3 right;\n"
+	"layout( location = 2 ) in vec3 up;\n"
+	"layout( location = 3 ) in vec4 texRect;\n"
+	"layout( location = 4 ) in vec4 color;\n"
+	"out vec2 vTexCoord;\n"
+	"out vec4 vColor;\n"
+	"void main()\n"
+	"{\n"
+	//Top left, top right, bottom left, bottom right, as a triangle strip.
+	"	vec2 corner = vec2( gl_VertexID & 1, gl_VertexID >> 1 );\n"
+	"	vec3 position = origin + right * ( corner.x * 2.0 - 1.0 ) + up * ( 1.0 - corner.y * 2.0 );\n"
+	"	gl_Position = viewProjection * vec4( position, 1.0 );\n"
+	"	vTexCoord = mix( texRect.xy, texRect.zw, corner );\n"
+	"	vColor = color;\n"
+	"}\n";
+
+//Same as the fixed function GL_MODULATE texture environment.
+const char EFFECT_FRAGMENT_SHADER[] =
+	"#version 330 core\n"
+	"uniform sampler2D tex;\n"
+	"in vec2 vTexCoord;\n"
+	"in vec4 vColor;\n"
+	"out vec4 fragColor;\n"
+	"void main()\n"
+	"{\n"
+	"	fragColor = texture( tex, vTexCoord ) * vColor;\n"
+	"}\n";
+
+/**
+*	Corners of a quad as two triangles, in the same order as the vertex shader makes them.
+*/
+const float QUAD_CORNERS[ 6 ][ 2 ] =
+{
+	{ 0, 0 }, { 1, 0 }, { 0, 1 },
+	{ 0, 1 }, { 1, 0 }, { 1, 1 }
+};
+
+//Pulls decals towards the view, so they draw over the surface they're on.
+const GLfloat DECAL_OFFSET_FACTOR = -1.0f;
+const GLfloat DECAL_OFFSET_UNITS = -2.0f;
+
+const int TYPE_SHIFT = 40;
+const int BLEND_SHIFT = 32;
+
+/**
+*	Longest time to wait for a fence at a time, in nanoseconds.
+*/
+const GLuint64 FENCE_TIMEOUT_NS = 1000000000;
+}
+
+const size_t CEffectsRenderer::INITIAL_INSTANCES;
+const size_t CEffectsRenderer::NUM_REGIONS;
+
+bool CEffectsRenderer::Initialize( gl::CStateCache& state, CProgramCache& programCache, const bool bCoreProfile )
+{
+	m_pState = &state;
+
+	m_bCoreProfile = bCoreProfile;
+
+	m_Instances.reserve( INITIAL_INSTANCES );
+	m_Keys.reserve( INITIAL_INSTANCES );
+
+	if( !m_bCoreProfile )
+	{
+		//Vertex buffers are core since 1.5. Without them, draw straight from m_Vertices.
+		if( GLEW_VERSION_1_5 )
+			glGenBuffers( 1, &m_Buffer );
+
+		m_Vertices.reserve( INITIAL_INSTANCES * 6 );
+
+		return true;
+	}
+
+	m_Program = programCache.CreateProgram( "effects", EFFECT_VERTEX_SHADER, EFFECT_FRAGMENT_SHADER );
+
+	if( !m_Program )
+		return false;
+
+	m_iViewProjectionLocation = glGetUniformLocation( m_Program, "viewProjection" );
+
+	glUseProgram( m_Program );
+	glUniform1i( glGetUniformLocation( m_Program, "tex" ), 0 );
+	glUseProgram( 0 );
+
+	//Every attribute advances once per instance. The corners come from gl_VertexID, so there are no per vertex attributes.
+	glGenVertexArrays( 1, &m_VertexArray );
+	glBindVertexArray( m_VertexArray );
+
+	for( GLuint uiAttribute = 0; uiAttribute < 5; ++uiAttribute )
+	{
+		glEnableVertexAttribArray( uiAttribute );
+		glVertexAttribDivisor( uiAttribute, 1 );
+	}
+
+	glBindVertexArray( 0 );
+
+	//Core in OpenGL 4.4.
+	if( !( GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage ) || !CreatePersistentBuffer( INITIAL_INSTANCES ) )
+		glGenBuffers( 1, &m_Buffer );
+
+	return true;
+}
+
+void CEffectsRenderer::Shutdown()
+{
+	if( m_bPersistent )
+	{
+		DestroyPersistentBuffer();
+	}
+	else if( m_Buffer )
+	{
+		glDeleteBuffers( 1, &m_Buffer );
+		m_pState->BufferDeleted( m_Buffer );
+		m_Buffer = 0;
+		m_uiBufferCapacity = 0;
+	}
+
+	if( m_VertexArray )
+	{
+		glBindVertexArray( 0 );
+		glDeleteVertexArrays( 1, &m_VertexArray );
+		m_VertexArray = 0;
+	}
+
+	if( m_Program )
+	{
+		glUseProgram( 0 );
+		glDeleteProgram( m_Program );
+		m_Program = 0;
+	}
+
+	m_iViewProjectionLocation = -1;
+
+	m_Instances.clear();
+	m_Keys.clear();
+	m_Groups.clear();
+	m_SortedInstances.clear();
+	m_Vertices.clear();
+}
+
+void CEffectsRenderer::AddEffect( const CRenderCommandList::Effect_t& effect, const GLuint texture,
+								  const float s0, const float t0, const float s1, const float t1 )
+{
+	//Unknown values would end up in another type's or mode's group.
+	if( effect.type >= EffectType::COUNT || effect.blend >= BlendMode::COUNT )
+		return;
+
+	Instance_t instance;
+
+	memcpy( instance.flOrigin, effect.flOrigin, sizeof( instance.flOrigin ) );
+	memcpy( instance.flRight, effect.flRight, sizeof( instance.flRight ) );
+	memcpy( instance.flUp, effect.flUp, sizeof( instance.flUp ) );
+
+	instance.flTexRect[ 0 ] = s0;
+	instance.flTexRect[ 1 ] = t0;
+	instance.flTexRect[ 2 ] = s1;
+	instance.flTexRect[ 3 ] = t1;
+
+	memcpy( instance.ubColor, effect.ubColor, sizeof( instance.ubColor ) );
+
+	const uint64_t uiKey =
+		( static_cast<uint64_t>( effect.type ) << TYPE_SHIFT ) |
+		( static_cast<uint64_t>( effect.blend ) << BLEND_SHIFT ) |
+		texture;
+
+	m_Keys.push_back( { uiKey, static_cast<uint32_t>( m_Instances.size() ) } );
+	m_Instances.push_back( instance );
+}
+
+void CEffectsRenderer::Draw( const int iWidth, const int iHeight, const float* pflViewProjection )
+{
+	if( m_Instances.empty() )
+		return;
+
+	BuildGroups();
+
+	m_pState->Viewport( 0, 0, iWidth, iHeight );
+
+	//Effects are see-through, so they don't hide what's drawn after them.
+	m_pState->SetEnabled( GL_DEPTH_TEST, true );
+	glDepthFunc( GL_LEQUAL );
+	glDepthMask( GL_FALSE );
+
+	//Effects can be seen from both sides.
+	m_pState->SetEnabled( GL_CULL_FACE, false );
+
+	m_pState->SetEnabled( GL_BLEND, true );
+
+	size_t uiFirstInstance = 0;
+
+	if( m_bCoreProfile )
+	{
+		glUseProgram( m_Program );
+		glBindVertexArray( m_VertexArray );
+
+		glUniformMatrix4fv( m_iViewProjectionLocation, 1, GL_FALSE, pflViewProjection );
+
+		uiFirstInstance = WriteInstances();
+	}
+	else
+	{
+		glMatrixMode( GL_PROJECTION );
+		glPushMatrix();
+		glLoadMatrixf( pflViewProjection );
+		glMatrixMode( GL_MODELVIEW );
+
+		WriteVertices();
+	}
+
+	bool bPolygonOffset = false;
+
+	for( const auto& group : m_Groups )
+	{
+		m_pState->BindTexture( group.texture );
+		m_pState->BlendFunc( GL_SRC_ALPHA, group.blend == BlendMode::ADDITIVE ? GL_ONE : GL_ONE_MINUS_SRC_ALPHA );
+
+		const bool bDecal = group.type == EffectType::DECAL;
+
+		if( bDecal != bPolygonOffset )
+		{
+			if( bDecal )
+			{
+				glPolygonOffset( DECAL_OFFSET_FACTOR, DECAL_OFFSET_UNITS );
+				glEnable( GL_POLYGON_OFFSET_FILL );
+			}
+			else
+			{
+				glDisable( GL_POLYGON_OFFSET_FILL );
+			}
+
+			bPolygonOffset = bDecal;
+		}
+
+		if( m_bCoreProfile )
+		{
+			SetInstanceOffset( uiFirstInstance + group.uiFirst );
+
+			glDrawArraysInstanced( GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>( group.uiCount ) );
+		}
+		else
+		{
+			glDrawArrays( GL_TRIANGLES, static_cast<GLint>( group.uiFirst * 6 ), static_cast<GLsizei>( group.uiCount * 6 ) );
+		}
+	}
+
+	if( m_bPersistent )
+	{
+		//The region can be written again once the GPU is done with these draws.
+		m_RegionFences[ m_uiRegion ] = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+
+		m_uiRegion = ( m_uiRegion + 1 ) % NUM_REGIONS;
+	}
+
+	m_Stats.uiEffects += m_Instances.size();
+	m_Stats.uiDrawCalls += m_Groups.size();
+
+	if( bPolygonOffset )
+		glDisable( GL_POLYGON_OFFSET_FILL );
+
+	glDepthMask( GL_TRUE );
+
+	m_pState->SetEnabled( GL_BLEND, false );
+
+	if( m_bCoreProfile )
+	{
+		glBindVertexArray( 0 );
+		glUseProgram( 0 );
+	}
+	else
+	{
+		glMatrixMode( GL_PROJECTION );
+		glPopMatrix();
+		glMatrixMode( GL_MODELVIEW );
+	}
+
+	m_Instances.clear();
+	m_Keys.clear();
+	m_Groups.clear();
+}
+
+void CEffectsRenderer::TakeStats( Stats_t& stats )
+{
+	stats = m_Stats;
+
+	m_Stats = Stats_t();
+}
+
+void CEffectsRenderer::BuildGroups()
+{
+	//Ties are broken by index, so effects in a group keep the order they were added in.
+	std::sort( m_Keys.begin(), m_Keys.end(),
+		[]( const SortKey_t& lhs, const SortKey_t& rhs )
+		{
+			return lhs.uiKey != rhs.uiKey ? lhs.uiKey < rhs.uiKey : lhs.uiIndex < rhs.uiIndex;
+		}
+	);
+
+	m_Groups.clear();
+
+	for( size_t uiIndex = 0; uiIndex < m_Keys.size(); ++uiIndex )
+	{
+		const uint64_t uiKey = m_Keys[ uiIndex ].uiKey;
+
+		if( uiIndex == 0 || uiKey != m_Keys[ uiIndex - 1 ].uiKey )
+		{
+			m_Groups.push_back(
+				{
+					static_cast<EffectType>( uiKey >> TYPE_SHIFT ),
+					static_cast<BlendMode>( ( uiKey >> BLEND_SHIFT ) & 0xFF ),
+					static_cast<GLuint>( uiKey & 0xFFFFFFFF ),
+					static_cast<uint32_t>( uiIndex ),
+					0
+				}
+			);
+		}
+
+		++m_Groups.back().uiCount;
+	}
+}
+
+size_t CEffectsRenderer::WriteInstances()
+{
+	const size_t uiCount = m_Keys.size();
+
+	if( m_bPersistent && uiCount > m_uiRegionInstances )
+	{
+		//Only happens when effects pile up beyond anything seen before, so waiting for the GPU here is fine.
+		const size_t uiInstances = std::max( uiCount, m_uiRegionInstances * 2 );
+
+		DestroyPersistentBuffer();
+
+		if( !CreatePersistentBuffer( uiInstances ) )
+			glGenBuffers( 1, &m_Buffer );
+	}
+
+	if( m_bPersistent )
+	{
+		WaitForRegion( m_uiRegion );
+
+		const size_t uiFirstInstance = m_uiRegion * m_uiRegionInstances;
+
+		auto pDest = reinterpret_cast<Instance_t*>( m_pMapped ) + uiFirstInstance;
+
+		for( const auto& key : m_Keys )
+		{
+			*pDest++ = m_Instances[ key.uiIndex ];
+		}
+
+		m_pState->BindBuffer( GL_ARRAY_BUFFER, m_Buffer );
+
+		return uiFirstInstance;
+	}
+
+	m_SortedInstances.clear();
+
+	for( const auto& key : m_Keys )
+	{
+		m_SortedInstances.push_back( m_Instances[ key.uiIndex ] );
+	}
+
+	const size_t uiSize = uiCount * sizeof( Instance_t );
+
+	m_pState->BindBuffer( GL_ARRAY_BUFFER, m_Buffer );
+
+	//Orphan the previous contents so the driver doesn't have to wait for draws that still use them.
+	if( uiSize > m_uiBufferCapacity )
+		m_uiBufferCapacity = uiSize * 2;
+
+	glBufferData( GL_ARRAY_BUFFER, m_uiBufferCapacity, nullptr, GL_STREAM_DRAW );
+	glBufferSubData( GL_ARRAY_BUFFER, 0, uiSize, m_SortedInstances.data() );
+
+	return 0;
+}
+
+void CEffectsRenderer::WriteVertices()
+{
+	m_Vertices.clear();
+
+	for( const auto& key : m_Keys )
+	{
+		const auto& instance = m_Instances[ key.uiIndex ];
+
+		for( const auto& corner : QUAD_CORNERS )
+		{
+			const float flRight = corner[ 0 ] * 2 - 1;
+			const float flUp = 1 - corner[ 1 ] * 2;
+
+			Vertex_t vertex;
+
+			for( size_t uiAxis = 0; uiAxis < 3; ++uiAxis )
+			{
+				vertex.flPos[ uiAxis ] = instance.flOrigin[ uiAxis ] + instance.flRight[ uiAxis ] * flRight + instance.flUp[ uiAxis ] * flUp;
+			}
+
+			vertex.flTexCoord[ 0 ] = instance.flTexRect[ 0 ] + ( instance.flTexRect[ 2 ] - instance.flTexRect[ 0 ] ) * corner[ 0 ];
+			vertex.flTexCoord[ 1 ] = instance.flTexRect[ 1 ] + ( instance.flTexRect[ 3 ] - instance.flTexRect[ 1 ] ) * corner[ 1 ];
+
+			memcpy( vertex.ubColor, instance.ubColor, sizeof( vertex.ubColor ) );
+
+			m_Vertices.push_back( vertex );
+		}
+	}
+
+	const size_t uiSize = m_Vertices.size() * sizeof( Vertex_t );
+
+	const uint8_t* pBase;
+
+	if( m_Buffer )
+	{
+		m_pState->BindBuffer( GL_ARRAY_BUFFER, m_Buffer );
+
+		if( uiSize > m_uiBufferCapacity )
+			m_uiBufferCapacity = uiSize * 2;
+
+		glBufferData( GL_ARRAY_BUFFER, m_uiBufferCapacity, nullptr, GL_STREAM_DRAW );
+		glBufferSubData( GL_ARRAY_BUFFER, 0, uiSize, m_Vertices.data() );
+
+		pBase = nullptr;
+	}
+	else
+	{
+		pBase = reinterpret_cast<const uint8_t*>( m_Vertices.data() );
+	}
+
+	m_pState->SetEnabled( GL_VERTEX_ARRAY, true );
+	m_pState->SetEnabled( GL_TEXTURE_COORD_ARRAY, true );
+	m_pState->SetEnabled( GL_COLOR_ARRAY, true );
+
+	glVertexPointer( 3, GL_FLOAT, sizeof( Vertex_t ), pBase + offsetof( Vertex_t, flPos ) );
+	glTexCoordPointer( 2, GL_FLOAT, sizeof( Vertex_t ), pBase + offsetof( Vertex_t, flTexCoord ) );
+	glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( Vertex_t ), pBase + offsetof( Vertex_t, ubColor ) );
+}
+
+bool CEffectsRenderer::CreatePersistentBuffer( const size_t uiInstances )
+{
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	const size_t uiSize = uiInstances * NUM_REGIONS * sizeof( Instance_t );
+
+	glGenBuffers( 1, &m_Buffer );
+
+	m_pState->BindBuffer( GL_ARRAY_BUFFER, m_Buffer );
+
+	glBufferStorage( GL_ARRAY_BUFFER, uiSize, nullptr, flags );
+
+	m_pMapped = static_cast<uint8_t*>( glMapBufferRange( GL_ARRAY_BUFFER, 0, uiSize, flags ) );
+
+	if( !m_pMapped )
+	{
+		glDeleteBuffers( 1, &m_Buffer );
+		m_pState->BufferDeleted( m_Buffer );
+		m_Buffer = 0;
+
+		return false;
+	}
+
+	m_bPersistent = true;
+	m_uiRegionInstances = uiInstances;
+	m_uiRegion = 0;
+
+	return true;
+}
+
+void CEffectsRenderer::DestroyPersistentBuffer()
+{
+	for( size_t uiRegion = 0; uiRegion < NUM_REGIONS; ++uiRegion )
+	{
+		WaitForRegion( uiRegion );
+	}
+
+	m_pState->BindBuffer( GL_ARRAY_BUFFER, m_Buffer );
+	glUnmapBuffer( GL_ARRAY_BUFFER );
+
+	glDeleteBuffers( 1, &m_Buffer );
+	m_pState->BufferDeleted( m_Buffer );
+	m_Buffer = 0;
+
+	m_pMapped = nullptr;
+	m_bPersistent = false;
+	m_uiRegionInstances = 0;
+	m_uiRegion = 0;
+}
+
+void CEffectsRenderer::WaitForRegion( const size_t uiRegion )
+{
+	auto& fence = m_RegionFences[ uiRegion ];
+
+	if( !fence )
+		return;
+
+	//Regions are only reused NUM_REGIONS draws later, so this rarely has to wait.
+	while( glClientWaitSync( fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_TIMEOUT_NS ) == GL_TIMEOUT_EXPIRED )
+	{
+	}
+
+	glDeleteSync( fence );
+	fence = nullptr;
+}
+
+void CEffectsRenderer::SetInstanceOffset( const size_t uiFirstInstance )
+{
+	const size_t uiOffset = uiFirstInstance * sizeof( Instance_t );
+
+	glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( Instance_t ), reinterpret_cast<const void*>( uiOffset + offsetof( Instance_t, flOrigin ) ) );
+	glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, sizeof( Instance_t ), reinterpret_cast<const void*>( uiOffset + offsetof( Instance_t, flRight ) ) );
+	glVertexAttribPointer( 2, 3, GL_FLOAT, GL_FALSE, sizeof( Instance_t ), reinterpret_cast<const void*>( uiOffset + offsetof( Instance_t, flUp ) ) );
+	glVertexAttribPointer( 3, 4, GL_FLOAT, GL_FALSE, sizeof( Instance_t ), reinterpret_cast<const void*>( uiOffset + offsetof( Instance_t, flTexRect ) ) );
+	glVertexAttribPointer( 4, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof( Instance_t ), reinterpret_cast<const void*>( uiOffset + offsetof( Instance_t, ubColor ) ) );
+}
@@ -0,0 +1,221 @@
+#ifndef ENGINE_CEFFECTSRENDERER_H
+#define ENGINE_CEFFECTSRENDERER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "MemoryTracking.h"
+
+#include "CRenderCommandList.h"
+
+class CProgramCache;
+
+namespace gl
+{
+class CStateCache;
+}
+
+/**
+*	Draws sprites, particles and decals as instanced quads.
+*	Effects are collected for a frame, then grouped by type, blend mode and texture, keeping the order they were added in within a group.
+*	Effects that share an atlas page share a group, so each group is drawn with one call however many effects are in it.
+*	With a core profile context, each effect is one instance whose corners are made in the vertex shader.
+*	Instances are written straight into a persistently mapped buffer if ARB_buffer_storage is available, split into regions that
+*	are reused once a fence says the GPU is done with them, and streamed through an orphaned buffer otherwise.
+*	The fixed function pipeline can't draw instances, so each effect's corners are written out as vertices instead.
+*	Leaves the quad batch's program and vertex array unbound; call CQuadBatch::Bind afterwards.
+*	Must only be used on the thread that owns the OpenGL context.
+*/
+class CEffectsRenderer final
+{
+public:
+	using EffectType = CRenderCommandList::EffectType;
+	using BlendMode = CRenderCommandList::BlendMode;
+
+	/**
+	*	Instances that the buffer has room for at first. Grows as needed.
+	*/
+	static const size_t INITIAL_INSTANCES = 4096;
+
+	/**
+	*	Number of buffer regions, so the GPU can read the previous frames' instances while this frame's are written.
+	*/
+	static const size_t NUM_REGIONS = 3;
+
+	struct Stats_t
+	{
+		size_t uiEffects = 0;
+		size_t uiDrawCalls = 0;
+	};
+
+public:
+	CEffectsRenderer() = default;
+
+	/**
+	*	@param state State cache that all state changes go through.
+	*	@param programCache Cache that the shaders are created through.
+	*	@param bCoreProfile Whether the context is a core profile context.
+	*	@return Whether the shaders could be created, if they're needed.
+	*	Leaves no program in use, like Draw.
+	*/
+	bool Initialize( gl::CStateCache& state, CProgramCache& programCache, const bool bCoreProfile );
+
+	void Shutdown();
+
+	/**
+	*	Adds an effect to draw.
+	*	@param texture Texture to draw with. Must not be 0.
+	*/
+	void AddEffect( const CRenderCommandList::Effect_t& effect, const GLuint texture,
+					const float s0, const float t0, const float s1, const float t1 );
+
+	/**
+	*	Draws the effects that were added, with depth testing but without writing depth.
+	*	@param pflViewProjection Column major view projection matrix.
+	*/
+	void Draw( const int iWidth, const int iHeight, const float* pflViewProjection );
+
+	/**
+	*	Gets the statistics since they were last reset, and resets them.
+	*/
+	void TakeStats( Stats_t& stats );
+
+private:
+	struct Instance_t
+	{
+		GLfloat flOrigin[ 3 ];
+		GLfloat flRight[ 3 ];
+		GLfloat flUp[ 3 ];
+
+		/**
+		*	s0, t0, s1, t1.
+		*/
+		GLfloat flTexRect[ 4 ];
+
+		GLubyte ubColor[ 4 ];
+	};
+
+	/**
+	*	Vertex of the fixed function pipeline.
+	*/
+	struct Vertex_t
+	{
+		GLfloat flPos[ 3 ];
+		GLfloat flTexCoord[ 2 ];
+		GLubyte ubColor[ 4 ];
+	};
+
+	struct SortKey_t
+	{
+		/**
+		*	Type, blend mode and texture, in that order of importance.
+		*/
+		uint64_t uiKey;
+
+		/**
+		*	Index in m_Instances, which keeps the order effects were added in.
+		*/
+		uint32_t uiIndex;
+	};
+
+	/**
+	*	Effects that share a type, blend mode and texture.
+	*/
+	struct Group_t
+	{
+		EffectType type;
+		BlendMode blend;
+
+		GLuint texture;
+
+		uint32_t uiFirst;
+		uint32_t uiCount;
+	};
+
+	/**
+	*	Sorts the effects, and collects the groups.
+	*/
+	void BuildGroups();
+
+	/**
+	*	Writes the instances in sorted order into the buffer, and binds it. Core profile only.
+	*	@return Index of the first instance in the buffer.
+	*/
+	size_t WriteInstances();
+
+	/**
+	*	Writes each instance's corners as two triangles, and points the vertex arrays at them. Fixed function only.
+	*/
+	void WriteVertices();
+
+	/**
+	*	Creates the persistently mapped buffer, with room for uiInstances per region.
+	*/
+	bool CreatePersistentBuffer( const size_t uiInstances );
+
+	void DestroyPersistentBuffer();
+
+	/**
+	*	Waits until the GPU is done with a region.
+	*/
+	void WaitForRegion( const size_t uiRegion );
+
+	/**
+	*	Points the instance attributes at an instance in the buffer.
+	*/
+	void SetInstanceOffset( const size_t uiFirstInstance );
+
+private:
+	gl::CStateCache* m_pState = nullptr;
+
+	bool m_bCoreProfile = false;
+
+	/**
+	*	Core profile objects.
+	*/
+	GLuint m_Program = 0;
+	GLuint m_VertexArray = 0;
+	GLint m_iViewProjectionLocation = -1;
+
+	GLuint m_Buffer = 0;
+
+	size_t m_uiBufferCapacity = 0;
+
+	/**
+	*	Whether m_Buffer is persistently mapped.
+	*/
+	bool m_bPersistent = false;
+
+	uint8_t* m_pMapped = nullptr;
+
+	/**
+	*	Instances per region.
+	*/
+	size_t m_uiRegionInstances = 0;
+
+	size_t m_uiRegion = 0;
+
+	GLsync m_RegionFences[ NUM_REGIONS ] = {};
+
+	TrackedVector_t<Instance_t, MemoryTag::RENDER> m_Instances;
+	TrackedVector_t<SortKey_t, MemoryTag::RENDER> m_Keys;
+	TrackedVector_t<Group_t, MemoryTag::RENDER> m_Groups;
+
+	/**
+	*	Sorted instances, when the buffer isn't mapped.
+	*/
+	TrackedVector_t<Instance_t, MemoryTag::RENDER> m_SortedInstances;
+
+	TrackedVector_t<Vertex_t, MemoryTag::RENDER> m_Vertices;
+
+	Stats_t m_Stats;
+
+private:
+	CEffectsRenderer( const CEffectsRenderer& ) = delete;
+	CEffectsRenderer& operator=( const CEffectsRenderer& ) = delete;
+};
+
+#endif //ENGINE_CEFFECTSRENDERER_H
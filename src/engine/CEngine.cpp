@@ -1,172 +1,1707 @@
+#include <algorithm>
 #include <cmath>
+#include <csignal>
+#include <cstdlib>
 #include <cstring>
+#include <functional>
 #include <limits>
+#include <string>
+#include <thread>
+#include <vector>
 
-#include <gl/glew.h>
+#include "cvardef.h"
 
 #include <VGUI_App.h>
 #include <VGUI_Panel.h>
 #include <VGUI_BitmapTGA.h>
 #include <VGUI_ImagePanel.h>
 #include <VGUI1/VGUI_RDBitmapTGA.h>
+#include <VGUI1/CCachedPanel.h>
+#include <VGUI1/CFrameGraphPanel.h>
+#include <VGUI1/CHitTestPanel.h>
 
 #include "Platform.h"
 
+#include "ByteSwap.h"
+#include "CCharacterSet.h"
+#include "CFrameArena.h"
+#include "CJobSystem.h"
 #include "CNetworkBuffer.h"
+#include "CPUFeatures.h"
+#include "CRC32C.h"
+#include "CTaskGraph.h"
 #include "Common.h"
 #include "Engine.h"
 #include "FilePaths.h"
 #include "IMetaLoader.h"
 #include "interface.h"
 #include "Logging.h"
+#include "MemoryTracking.h"
+#include "NetworkStats.h"
+#include "Tokenization.h"
+#include "Tracing.h"
+#include "steam/CSteamCallStats.h"
 #include "steam/SteamWrapper.h"
 
 #include "FileSystem2.h"
+#include "CConsoleScrollback.h"
+#include "CFileLogSink.h"
 #include "CFileSystemWrapper.h"
 
+#include "VGUI1/TGADecoder.h"
 #include "VGUI1/vgui_loadtga.h"
 
 #include "CEngine.h"
 
+#ifdef WIN32
+#include <mmsystem.h>
+#endif
+
 EXPOSE_SINGLE_INTERFACE_GLOBALVAR( CEngine, IMetaTool, DEFAULT_IMETATOOL_NAME, g_Engine );
 
-void CEngine::SetMyGameDir( const char* const pszGameDir )
-{
-	strncpy( m_szMyGameDir, pszGameDir, sizeof( m_szMyGameDir ) );
-	m_szMyGameDir[ sizeof( m_szMyGameDir ) - 1 ] = '\0';
-}
+namespace
+{
+/**
+*	Archived cvars are written to this file.
+*/
+const char CONFIG_FILE_NAME[] = "config.cfg";
+
+/**
+*	How long to wait after an archived cvar changes before writing the config, so changes made in quick succession are written once.
+*/
+const std::chrono::seconds ARCHIVE_WRITE_DELAY( 1 );
+
+/**
+*	Log files are written to this path if -logfile isn't given a name.
+*/
+const char DEFAULT_LOG_FILE[] = "logs/engine";
+
+/**
+*	Path ID of the overlay that downloaded resources are saved to, and the suffix of its directory's name after the game directory.
+*/
+const char DOWNLOAD_PATH_ID[] = "GAMEDOWNLOAD";
+const char DOWNLOAD_DIR_SUFFIX[] = "_downloads";
+
+/**
+*	Most job system worker threads to start by default. Can be overridden with -jobthreads.
+*/
+const int MAX_DEFAULT_JOB_THREADS = 4;
+
+/**
+*	Whether to draw the frame time graph.
+*/
+cvar_t r_framegraph = { "r_framegraph", const_cast<char*>( "0" ) };
+
+/**
+*	Whether to keep the composited UI in a framebuffer and only repaint areas that changed.
+*/
+cvar_t vgui_cache = { "vgui_cache", const_cast<char*>( "1" ) };
+
+/**
+*	Memory budgets of the asset cache, in megabytes. Images that are in use are never evicted, so the cache can go over them.
+*/
+cvar_t asset_cache_cpu_mb = { "asset_cache_cpu_mb", const_cast<char*>( "64" ) };
+cvar_t asset_cache_gpu_mb = { "asset_cache_gpu_mb", const_cast<char*>( "128" ) };
+
+/**
+*	Texture memory budget, in megabytes. Idle textures that can be restored are evicted to stay under it.
+*/
+cvar_t r_texture_budget_mb = { "r_texture_budget_mb", const_cast<char*>( "256" ) };
+
+/**
+*	Server content directory that missing resources are downloaded from, and how many connections to download with.
+*/
+cvar_t cl_download_connections = { "cl_download_connections", const_cast<char*>( "4" ) };
+cvar_t cl_downloadurl = { "cl_downloadurl", const_cast<char*>( "" ) };
+
+/**
+*	Password that remote console connections authenticate with. Remote console can't be used while it's empty.
+*/
+cvar_t rcon_password = { "rcon_password", const_cast<char*>( "" ), FCVAR_PROTECTED | FCVAR_UNLOGGED };
+
+/**
+*	How many times per second Steam callbacks are dispatched, and how long dispatching may take per frame on average, in milliseconds.
+*/
+cvar_t steam_callback_budget_ms = { "steam_callback_budget_ms", const_cast<char*>( "0.5" ) };
+cvar_t steam_callback_rate = { "steam_callback_rate", const_cast<char*>( "30" ) };
+
+/**
+*	Whether to record how long Steam API calls take. Shown with steam_call_stats.
+*/
+cvar_t steam_timing = { "steam_timing", const_cast<char*>( "0" ) };
+
+/**
+*	Simulation ticks per second. Independent of the frame rate.
+*/
+cvar_t sys_ticrate = { "sys_ticrate", const_cast<char*>( "100" ) };
+
+/**
+*	Speaker that the local player's voice is played back as. The local player is always the first client.
+*/
+const uint32_t LOCAL_VOICE_SPEAKER = 1;
+
+/**
+*	Whether the local player's voice is played back to them. There's no voice transport yet, so this is the only way it's heard.
+*/
+cvar_t voice_loopback = { "voice_loopback", const_cast<char*>( "0" ) };
+
+/**
+*	Volume of voice chat, 0 to 1.
+*/
+cvar_t voice_scale = { "voice_scale", const_cast<char*>( "1" ), FCVAR_ARCHIVE };
+
+/**
+*	Frame times longer than this are clamped, in seconds. Keeps breakpoints and stalls from being simulated.
+*/
+const double MAX_FRAME_TIME = 0.25;
+
+/**
+*	Height of the frame time graph, in pixels.
+*/
+const int FRAME_GRAPH_TALL = 50 * CFrameGraphPanel::PIXELS_PER_MS;
+
+/**
+*	How many seconds of events trace_dump writes if no time is given.
+*/
+const double DEFAULT_TRACE_DUMP_SECONDS = 10;
+
+/**
+*	How often command profiling is published into the metrics.
+*/
+const std::chrono::seconds COMMAND_METRICS_INTERVAL( 1 );
+
+/**
+*	Most server instances that -instances can start.
+*/
+const int MAX_INSTANCES = 64;
+
+/**
+*	Process IDs of each library's events in trace files.
+*/
+const unsigned int TRACE_ENGINE_PID = 1;
+const unsigned int TRACE_FILESYSTEM_PID = 2;
+
+/**
+*	Set by SIGINT and SIGTERM, so dedicated servers can be stopped cleanly.
+*/
+volatile sig_atomic_t g_bQuitSignaled = 0;
+
+void QuitSignalHandler( int )
+{
+	g_bQuitSignaled = 1;
+}
+
+void Cmd_Quit_f()
+{
+	g_Engine.RequestQuit();
+}
+
+void Cmd_AssetCache_Stats_f()
+{
+	CAssetCache::Stats_t stats;
+
+	g_Engine.GetAssetCache().GetStats( stats );
+
+	Msg( "Cached images: %u, models: %u\n", static_cast<unsigned int>( stats.uiEntries - stats.uiModels ), static_cast<unsigned int>( stats.uiModels ) );
+	Msg( "Memory: %.1f MB loaded, %.1f MB uploaded\n", stats.uiCPUBytes / ( 1024.0 * 1024.0 ), stats.uiGPUBytes / ( 1024.0 * 1024.0 ) );
+	Msg( "Lookups: %u hits, %u misses, %u evictions\n",
+		 static_cast<unsigned int>( stats.uiHits ), static_cast<unsigned int>( stats.uiMisses ), static_cast<unsigned int>( stats.uiEvictions ) );
+}
+
+void Cmd_CPU_Features_f()
+{
+	char szFeatures[ 256 ];
+
+	Plat_GetCPUFeatureString( szFeatures, sizeof( szFeatures ) );
+
+	Msg( "CPU features: %s\n", *szFeatures ? szFeatures : "none" );
+	Msg( "Tokenizer: %s\n", tokenization::IsVectorized() ? "SSE2" : "scalar" );
+	Msg( "Character sets: %s\n", CCharacterSet::IsVectorized() ? "SSSE3" : "scalar" );
+	Msg( "Byte swapping: %s\n", IsSwapArrayVectorized() ? ( Plat_HasCPUFeatures( CPUFeature::AVX2 ) ? "AVX2" : "SSSE3" ) : "scalar" );
+	Msg( "CRC32C: %s\n", crc32c::IsHardwareAccelerated() ? "SSE4.2" : "software" );
+	Msg( "TGA conversion: %s\n", IsTGASwizzleVectorized() ? "SSSE3" : "scalar" );
+}
+
+void Cmd_Frame_Arena_Stats_f()
+{
+	auto& arena = GetFrameArena();
+
+	CFrameArena::Stats_t stats;
+
+	arena.GetStats( stats );
+
+	Msg( "Frame arena: %.1f KB used this frame, %.1f KB peak, %.1f KB reserved\n",
+		 stats.uiUsedBytes / 1024.0, stats.uiPeakBytes / 1024.0, stats.uiCapacityBytes / 1024.0 );
+	Msg( "Heap allocations: %u\n", static_cast<unsigned int>( stats.uiHeapAllocations ) );
+
+	if( arena.IsUsingLargePages() )
+		Msg( "Large pages: %s\n", stats.backing == PageBacking::LARGE ? "yes" : stats.backing == PageBacking::TRANSPARENT ? "transparent" : "unavailable" );
+
+	arena.ResetStats();
+}
+
+/**
+*	Memory counters of the engine and the filesystem when mem_stats was last used, for the allocation rates.
+*/
+MemoryTagStats_t g_LastMemoryStats[ 2 ][ NUM_MEMORY_TAGS ] = {};
+
+std::chrono::steady_clock::time_point g_LastMemoryStatsTime = std::chrono::steady_clock::now();
+
+void PrintMemoryStats( const char* pszModule, const MemoryTagStats_t* pStats, const MemoryTagStats_t* pLastStats, const double flSeconds )
+{
+	Msg( "%s:\n", pszModule );
+
+	for( size_t uiTag = 0; uiTag < NUM_MEMORY_TAGS; ++uiTag )
+	{
+		const auto& stats = pStats[ uiTag ];
+
+		if( stats.uiAllocations == 0 )
+			continue;
+
+		const double flRate = flSeconds > 0 ? ( stats.uiAllocations - pLastStats[ uiTag ].uiAllocations ) / flSeconds : 0;
+
+		//Memory allocated before tracking was enabled can make the live count negative.
+		Msg( "  %-12s %10.1f KB live %10.1f KB peak %10llu allocations %10.1f/s\n", Mem_GetTagName( static_cast<MemoryTag>( uiTag ) ),
+			 std::max<int64_t>( stats.iLiveBytes, 0 ) / 1024.0, stats.iPeakBytes / 1024.0, static_cast<unsigned long long>( stats.uiAllocations ), flRate );
+	}
+}
+
+void Cmd_Mem_Stats_f()
+{
+	if( !Mem_IsTrackingEnabled() )
+	{
+		Msg( "Memory tracking is disabled, start with -memtracking to enable it\n" );
+		return;
+	}
+
+	if( g_CVar.GetArgC() == 2 && !strcmp( g_CVar.GetArgV( 1 ), "reset" ) )
+	{
+		Mem_ResetPeaks();
+		Msg( "Memory peaks reset\n" );
+		return;
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+
+	const double flSeconds = std::chrono::duration<double>( now - g_LastMemoryStatsTime ).count();
+
+	MemoryTagStats_t stats[ NUM_MEMORY_TAGS ];
+
+	Mem_GetStats( stats, NUM_MEMORY_TAGS );
+
+	PrintMemoryStats( "Engine", stats, g_LastMemoryStats[ 0 ], flSeconds );
+
+	std::copy( stats, stats + NUM_MEMORY_TAGS, g_LastMemoryStats[ 0 ] );
+
+	if( g_pFileSystem )
+	{
+		g_pFileSystem->GetMemoryStats( stats, NUM_MEMORY_TAGS );
+
+		PrintMemoryStats( "Filesystem", stats, g_LastMemoryStats[ 1 ], flSeconds );
+
+		std::copy( stats, stats + NUM_MEMORY_TAGS, g_LastMemoryStats[ 1 ] );
+	}
+
+	g_LastMemoryStatsTime = now;
+}
+
+/**
+*	Prints the counters of one client, or of everything, by type with the most bits first.
+*/
+void PrintNetworkStats( const CNetworkStats& stats, const bool bPrintTypes )
+{
+	NetMessageStats_t typeStats[ NUM_NET_MESSAGE_TYPES ];
+
+	stats.GetStats( typeStats, NUM_NET_MESSAGE_TYPES );
+
+	const double flSeconds = stats.GetSeconds();
+
+	uint64_t uiTotalBits = 0;
+	uint64_t uiTotalCount = 0;
+
+	size_t uiTypes[ NUM_NET_MESSAGE_TYPES ];
+	size_t uiNumTypes = 0;
+
+	for( size_t uiType = 0; uiType < NUM_NET_MESSAGE_TYPES; ++uiType )
+	{
+		if( typeStats[ uiType ].uiCount == 0 )
+			continue;
+
+		uiTotalBits += typeStats[ uiType ].uiBits;
+		uiTotalCount += typeStats[ uiType ].uiCount;
+		uiTypes[ uiNumTypes++ ] = uiType;
+	}
+
+	Msg( "%s: %llu messages %10.1f KB %10.1f kbit/s over %.1f seconds\n", stats.GetName(), static_cast<unsigned long long>( uiTotalCount ),
+		 uiTotalBits / 8192.0, flSeconds > 0 ? uiTotalBits / 1000.0 / flSeconds : 0, flSeconds );
+
+	if( !bPrintTypes )
+		return;
+
+	std::sort( uiTypes, uiTypes + uiNumTypes,
+		[ & ]( const size_t lhs, const size_t rhs )
+		{
+			return typeStats[ lhs ].uiBits > typeStats[ rhs ].uiBits;
+		}
+	);
+
+	for( size_t uiIndex = 0; uiIndex < uiNumTypes; ++uiIndex )
+	{
+		const auto uiType = uiTypes[ uiIndex ];
+		const auto& type = typeStats[ uiType ];
+
+		char szName[ 16 ];
+
+		const char* pszName = NetStats_GetTypeName( static_cast<NetMessageType_t>( uiType ) );
+
+		if( !pszName )
+		{
+			snprintf( szName, sizeof( szName ), "type %u", static_cast<unsigned int>( uiType ) );
+			pszName = szName;
+		}
+
+		Msg( "  %-20s %10llu messages %10.1f KB %10.1f kbit/s %8.1f bits avg %8.2f us avg %5.1f%%\n", pszName,
+			 static_cast<unsigned long long>( type.uiCount ), type.uiBits / 8192.0, flSeconds > 0 ? type.uiBits / 1000.0 / flSeconds : 0,
+			 static_cast<double>( type.uiBits ) / type.uiCount, type.uiEncodeNS / 1000.0 / type.uiCount,
+			 uiTotalBits > 0 ? type.uiBits * 100.0 / uiTotalBits : 0 );
+	}
+}
+
+void Cmd_Net_Stats_f()
+{
+	if( !NetStats_IsEnabled() )
+	{
+		Msg( "Network statistics are disabled, start with -netstats to enable them\n" );
+		return;
+	}
+
+	const char* pszClient = g_CVar.GetArgC() >= 2 ? g_CVar.GetArgV( 1 ) : nullptr;
+
+	if( pszClient && !strcmp( pszClient, "reset" ) )
+	{
+		NetStats_ResetAll();
+		Msg( "Network statistics reset\n" );
+		return;
+	}
+
+	if( !pszClient )
+		PrintNetworkStats( NetStats_GetGlobal(), true );
+
+	struct Context_t
+	{
+		const char* pszClient;
+		bool bFound;
+	};
+
+	Context_t context{ pszClient, false };
+
+	//All clients get a line each, a single client gets its types as well.
+	NetStats_ForEachClient(
+		[]( const CNetworkStats& stats, void* pContext )
+		{
+			auto& context = *reinterpret_cast<Context_t*>( pContext );
+
+			if( context.pszClient && strcmp( context.pszClient, stats.GetName() ) )
+				return;
+
+			context.bFound = true;
+
+			PrintNetworkStats( stats, context.pszClient != nullptr );
+		},
+		&context
+	);
+
+	if( pszClient && !context.bFound )
+		Msg( "No client named \"%s\"\n", pszClient );
+}
+
+/**
+*	Appends a library's trace events to a trace.
+*	@param getEvents Gets the events, like Trace_GetEvents.
+*/
+void AppendTraceEvents( std::string& szTrace, const std::function<size_t( char*, size_t )>& getEvents )
+{
+	//Events keep being recorded, so leave room for some more.
+	std::vector<char> events( getEvents( nullptr, 0 ) + 4096 );
+
+	const size_t uiLength = std::min( getEvents( events.data(), events.size() ), events.size() - 1 );
+
+	if( uiLength == 0 )
+		return;
+
+	szTrace += ",\n";
+	szTrace.append( events.data(), uiLength );
+}
+
+void Cmd_Trace_Dump_f()
+{
+	if( !Trace_IsEnabled() )
+	{
+		Msg( "Tracing isn't compiled in, build with ENABLE_TRACING\n" );
+		return;
+	}
+
+	if( g_CVar.GetArgC() < 2 )
+	{
+		Msg( "Usage: trace_dump <file name> [seconds]\n" );
+		return;
+	}
+
+	const char* pszFileName = g_CVar.GetArgV( 1 );
+
+	const double flSeconds = g_CVar.GetArgC() >= 3 ? std::max( 0.0, atof( g_CVar.GetArgV( 2 ) ) ) : DEFAULT_TRACE_DUMP_SECONDS;
+
+	const uint64_t uiNowUS = Trace_GetTimeUS();
+	const uint64_t uiWindowUS = static_cast<uint64_t>( flSeconds * 1000000 );
+	const uint64_t uiSinceUS = uiNowUS > uiWindowUS ? uiNowUS - uiWindowUS : 0;
+
+	std::string szTrace = "{\"traceEvents\":[\n";
+
+	char szMetadata[ 128 ];
+
+	snprintf( szMetadata, sizeof( szMetadata ), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"engine\"}},\n", TRACE_ENGINE_PID );
+	szTrace += szMetadata;
+
+	snprintf( szMetadata, sizeof( szMetadata ), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"filesystem\"}}", TRACE_FILESYSTEM_PID );
+	szTrace += szMetadata;
+
+	AppendTraceEvents( szTrace, [ = ]( char* pszBuffer, size_t uiBufferSize )
+	{
+		return Trace_GetEvents( pszBuffer, uiBufferSize, uiSinceUS, TRACE_ENGINE_PID );
+	} );
+
+	AppendTraceEvents( szTrace, [ = ]( char* pszBuffer, size_t uiBufferSize )
+	{
+		return g_pFileSystem->GetTraceEvents( pszBuffer, uiBufferSize, uiSinceUS, TRACE_FILESYSTEM_PID );
+	} );
+
+	szTrace += "\n]}\n";
+
+	FileHandle_t hFile = g_pFileSystem->Open( pszFileName, "wb" );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Msg( "Couldn't open trace file \"%s\"\n", pszFileName );
+		return;
+	}
+
+	const bool bSuccess = g_pFileSystem->Write( szTrace.data(), static_cast<int>( szTrace.size() ), hFile ) == static_cast<int>( szTrace.size() );
+
+	g_pFileSystem->Close( hFile );
+
+	if( bSuccess )
+		Msg( "Wrote the last %.1f seconds of trace events to \"%s\"\n", flSeconds, pszFileName );
+	else
+		Msg( "Couldn't write trace file \"%s\"\n", pszFileName );
+}
+
+void Cmd_Texture_Stats_f()
+{
+	const char* const pszOwners[ CTextureManager::NUM_OWNERS ] =
+	{
+		"surface",
+		"image",
+		"glyph",
+		"panel cache"
+	};
+
+	const double flMB = 1024.0 * 1024.0;
+
+	CTextureManager::Stats_t stats;
+
+	g_Video.GetTextureManager().GetStats( stats );
+
+	Msg( "Textures: %u\n", static_cast<unsigned int>( stats.uiTextures ) );
+
+	for( size_t uiOwner = 0; uiOwner < CTextureManager::NUM_OWNERS; ++uiOwner )
+	{
+		Msg( "%-12s %6u %8.1f MB\n", pszOwners[ uiOwner ], static_cast<unsigned int>( stats.uiTexturesByOwner[ uiOwner ] ), stats.uiBytesByOwner[ uiOwner ] / flMB );
+	}
+
+	auto& renderer = g_Video.GetRenderer();
+
+	const size_t uiAtlasPages = renderer.GetAtlasPageCount();
+
+	Msg( "Atlas pages: %u, %.1f MB\n", static_cast<unsigned int>( uiAtlasPages ), uiAtlasPages * renderer.GetAtlasPageBytes() / flMB );
+	Msg( "Own textures: %.1f MB resident, %.1f MB evictable, budget %.1f MB\n",
+		 stats.uiResidentBytes / flMB, stats.uiEvictableBytes / flMB, g_Video.GetTextureManager().GetBudget() / flMB );
+	Msg( "Evictions: %u, %.1f MB\n", static_cast<unsigned int>( stats.uiEvictions ), stats.uiEvictedBytes / flMB );
+}
+
+void Cmd_Steam_Callback_Stats_f()
+{
+	auto& callbacks = g_Engine.GetSteamCallbacks();
+
+	if( g_CVar.GetArgC() == 2 && !strcmp( g_CVar.GetArgV( 1 ), "reset" ) )
+	{
+		callbacks.ResetStats();
+		return;
+	}
+
+	if( !callbacks.IsRunning() )
+	{
+		Msg( "Steam callbacks aren't being dispatched\n" );
+		return;
+	}
+
+	CSteamCallbackPump::Stats_t stats;
+
+	callbacks.GetStats( stats );
+
+	Msg( "Steam callbacks: dispatched on %s\n", callbacks.IsThreaded() ? "a worker thread" : "the main thread" );
+	Msg( "Dispatches: %u, %u deferred, %u forced over budget\n",
+		 static_cast<unsigned int>( stats.uiDispatches ), static_cast<unsigned int>( stats.uiDeferred ), static_cast<unsigned int>( stats.uiForced ) );
+	Msg( "Time: %.3f ms avg, %.3f ms max, %.3f ms last\n",
+		 stats.uiDispatches > 0 ? stats.flTotalMS / stats.uiDispatches : 0.0, stats.flMaxMS, stats.flLastMS );
+}
+
+/**
+*	Adds the .dem extension to a demo name that has none.
+*/
+std::string GetDemoFileName( const char* pszName )
+{
+	std::string szFileName = pszName;
+
+	const size_t uiDot = szFileName.find_last_of( '.' );
+
+	if( uiDot == std::string::npos || szFileName.find_first_of( "/\\", uiDot ) != std::string::npos )
+		szFileName += ".dem";
+
+	return szFileName;
+}
+
+void Cmd_Record_f()
+{
+	if( g_CVar.GetArgC() != 2 )
+	{
+		Msg( "Usage: record <demo name>\n" );
+		return;
+	}
+
+	if( !g_Engine.GetServerThread().IsRunning() )
+	{
+		Msg( "Only messages from the server thread are recorded, start with -serverthread to record demos\n" );
+		return;
+	}
+
+	auto& recorder = g_Engine.GetDemoRecorder();
+
+	const std::string szFileName = GetDemoFileName( g_CVar.GetArgV( 1 ) );
+
+	if( !recorder.Start( *g_pFileSystem, szFileName.c_str() ) )
+	{
+		Msg( "Couldn't create demo \"%s\"\n", szFileName.c_str() );
+		return;
+	}
+
+	Msg( "Recording to \"%s\"\n", szFileName.c_str() );
+}
+
+void Cmd_Stop_f()
+{
+	auto& recorder = g_Engine.GetDemoRecorder();
+
+	if( !recorder.IsRecording() )
+	{
+		Msg( "Not recording a demo\n" );
+		return;
+	}
+
+	const std::string szFileName = recorder.GetFileName();
+	const auto uiMessages = recorder.GetMessageCount();
+	const auto uiSize = recorder.GetSize();
+
+	if( recorder.Stop() )
+	{
+		Msg( "Recorded %llu messages, %.1f KB to \"%s\"\n", static_cast<unsigned long long>( uiMessages ), uiSize / 1024.0, szFileName.c_str() );
+	}
+	else
+	{
+		Msg( "Error writing demo \"%s\"\n", szFileName.c_str() );
+	}
+}
+
+void Cmd_PlayDemo_f()
+{
+	if( g_CVar.GetArgC() != 2 )
+	{
+		Msg( "Usage: playdemo <demo name>\n" );
+		return;
+	}
+
+	const std::string szFileName = GetDemoFileName( g_CVar.GetArgV( 1 ) );
+
+	char szFullPath[ MAX_PATH ];
+
+	auto& player = g_Engine.GetDemoPlayer();
+
+	if( !g_pFileSystem->GetLocalPath( szFileName.c_str(), szFullPath, sizeof( szFullPath ) ) || !player.Open( szFullPath ) )
+	{
+		Msg( "Couldn't open demo \"%s\"\n", szFileName.c_str() );
+		return;
+	}
+
+	Msg( "Playing \"%s\", %.1f seconds, %u seek points\n", szFileName.c_str(), player.GetDuration(), static_cast<unsigned int>( player.GetSeekPointCount() ) );
+}
+
+void Cmd_Play_f()
+{
+	if( g_CVar.GetArgC() != 2 )
+	{
+		Msg( "Usage: play <sound name>\n" );
+		return;
+	}
+
+	auto sound = g_Engine.GetSoundCache().Load( g_CVar.GetArgV( 1 ) );
+
+	if( !sound )
+		return;
+
+	if( g_Engine.GetMixer().Play( std::move( sound ) ) == CMixer::INVALID_VOICE )
+		Msg( "No free voices\n" );
+}
+
+void Cmd_Music_f()
+{
+	if( g_CVar.GetArgC() < 2 || g_CVar.GetArgC() > 3 )
+	{
+		Msg( "Usage: music <sound name> [loop]\n" );
+		return;
+	}
+
+	const bool bLoop = g_CVar.GetArgC() == 3 && !strcmp( g_CVar.GetArgV( 2 ), "loop" );
+
+	auto stream = g_Engine.GetSoundStreamer().Open( g_CVar.GetArgV( 1 ), bLoop );
+
+	if( !stream )
+	{
+		Msg( "Sound streaming isn't running\n" );
+		return;
+	}
+
+	//Failing to open the file is found out later, and the voice just ends.
+	if( g_Engine.GetMixer().Play( std::move( stream ) ) == CMixer::INVALID_VOICE )
+		Msg( "No free voices\n" );
+}
+
+void Cmd_StopSound_f()
+{
+	g_Engine.GetMixer().StopAll();
+}
+
+/**
+*	Start and stop recording the local player's voice while the key they're bound to is held.
+*/
+void Cmd_VoiceRecord_Start_f()
+{
+	if( !g_Engine.GetVoiceCapture().IsOpen() )
+	{
+		Msg( "Voice capture isn't available\n" );
+		return;
+	}
+
+	g_Engine.GetVoiceCapture().SetRecording( true );
+}
+
+void Cmd_VoiceRecord_Stop_f()
+{
+	g_Engine.GetVoiceCapture().SetRecording( false );
+}
+
+void Cmd_Demo_Seek_f()
+{
+	if( g_CVar.GetArgC() != 2 )
+	{
+		Msg( "Usage: demo_seek <seconds>\n" );
+		return;
+	}
+
+	auto& player = g_Engine.GetDemoPlayer();
+
+	if( !player.IsOpen() )
+	{
+		Msg( "Not playing a demo\n" );
+		return;
+	}
+
+	player.Seek( atof( g_CVar.GetArgV( 1 ) ) );
+
+	Msg( "Demo at %.1f of %.1f seconds\n", player.GetTime(), player.GetDuration() );
+}
+
+/**
+*	Start and end of a remote console command, queued around it by the remote console server to capture its output.
+*/
+void Cmd_Rcon_Begin_f()
+{
+	if( g_CVar.GetArgC() == 2 )
+		g_Engine.GetRconServer().BeginRequest( static_cast<uint32_t>( strtoul( g_CVar.GetArgV( 1 ), nullptr, 10 ) ) );
+}
+
+void Cmd_Rcon_End_f()
+{
+	if( g_CVar.GetArgC() == 2 )
+		g_Engine.GetRconServer().EndRequest( static_cast<uint32_t>( strtoul( g_CVar.GetArgV( 1 ), nullptr, 10 ) ) );
+}
+
+void Cmd_Download_f()
+{
+	if( g_CVar.GetArgC() < 2 )
+	{
+		Msg( "Usage: download <file name> [file name...]\n" );
+		return;
+	}
+
+	auto& downloads = g_Engine.GetDownloads();
+
+	if( !downloads.IsRunning() || downloads.GetBaseURL() != cl_downloadurl.string )
+	{
+		if( !( *cl_downloadurl.string ) )
+		{
+			Msg( "No download URL set, set cl_downloadurl\n" );
+			return;
+		}
+
+		if( !( g_pFileSystem->GetOptions() & FileSystemOption::THREAD_SAFE ) )
+		{
+			Msg( "Downloading needs a thread safe filesystem, start with -fs_threadsafe\n" );
+			return;
+		}
+
+		if( !g_Engine.StartDownloads( cl_downloadurl.string ) )
+		{
+			Msg( "Couldn't start downloading from \"%s\", only http:// URLs are supported\n", cl_downloadurl.string );
+			return;
+		}
+	}
+
+	int iQueued = 0;
+
+	for( int iArg = 1; iArg < g_CVar.GetArgC(); ++iArg )
+	{
+		if( downloads.Queue( g_CVar.GetArgV( iArg ) ) )
+			++iQueued;
+	}
+
+	Msg( "Downloading %d of %d files\n", iQueued, g_CVar.GetArgC() - 1 );
+}
+
+void Cmd_Download_Status_f()
+{
+	auto& downloads = g_Engine.GetDownloads();
+
+	if( !downloads.IsRunning() )
+	{
+		Msg( "Not downloading\n" );
+		return;
+	}
+
+	const auto progress = downloads.GetProgress();
+
+	Msg( "Downloading from \"%s\": %u of %u files done, %u failed, %.1f KB received\n", downloads.GetBaseURL().c_str(),
+		 static_cast<unsigned int>( progress.uiCompleted ), static_cast<unsigned int>( progress.uiQueued ),
+		 static_cast<unsigned int>( progress.uiFailed ), progress.uiBytesReceived / 1024.0 );
+
+	for( const auto& szFileName : downloads.GetFailedFiles() )
+	{
+		Msg( "  Failed: %s\n", szFileName.c_str() );
+	}
+}
+
+void Cmd_Host_WriteConfig_f()
+{
+	const char* pszFileName = g_CVar.GetArgC() >= 2 ? g_CVar.GetArgV( 1 ) : CONFIG_FILE_NAME;
+
+	if( g_CVar.WriteArchive( *g_pFileSystem, pszFileName, true ) )
+		Msg( "Wrote \"%s\"\n", pszFileName );
+}
+
+void Cmd_Server_Thread_Stats_f()
+{
+	auto& serverThread = g_Engine.GetServerThread();
+
+	if( g_CVar.GetArgC() == 2 && !strcmp( g_CVar.GetArgV( 1 ), "reset" ) )
+	{
+		serverThread.ResetStats();
+		return;
+	}
+
+	if( !serverThread.IsRunning() )
+	{
+		Msg( "The server runs on the main thread, start with -serverthread to run it on its own thread\n" );
+		return;
+	}
+
+	CServerThread::Stats_t stats;
+
+	serverThread.GetStats( stats );
+
+	Msg( "Server thread: %u ticks, %.3f ms avg, %.3f ms max, %.3f s dropped\n",
+		 static_cast<unsigned int>( stats.uiTicks ), stats.uiTicks > 0 ? stats.flTotalMS / stats.uiTicks : 0.0, stats.flMaxMS, stats.flDroppedTime );
+	Msg( "Client has seen %u ticks\n", static_cast<unsigned int>( g_Engine.GetServerTick() ) );
+	Msg( "Loopback: %u messages dropped to the server, %u to the client\n",
+		 static_cast<unsigned int>( serverThread.GetClientToServer().GetDroppedCount() ),
+		 static_cast<unsigned int>( serverThread.GetServerToClient().GetDroppedCount() ) );
+}
+
+/**
+*	Usage: instance <index|all> <command>
+*	Queues a command to execute on a server instance's thread.
+*/
+void Cmd_Instance_f()
+{
+	if( g_CVar.GetArgC() < 3 )
+	{
+		Msg( "instance <index|all> <command> : execute a command on server instances\n" );
+		return;
+	}
+
+	const size_t uiCount = g_Engine.GetInstanceCount();
+
+	const bool bAll = !strcmp( g_CVar.GetArgV( 1 ), "all" );
+
+	const size_t uiIndex = bAll ? 0 : static_cast<size_t>( strtoul( g_CVar.GetArgV( 1 ), nullptr, 10 ) );
+
+	if( !bAll && uiIndex >= uiCount )
+	{
+		Msg( "No server instance %s, there are %u\n", g_CVar.GetArgV( 1 ), static_cast<unsigned int>( uiCount ) );
+		return;
+	}
+
+	//Arguments are quoted again, so they're tokenized the same way on the instance.
+	std::string szCommand;
+
+	for( int iArg = 2; iArg < g_CVar.GetArgC(); ++iArg )
+	{
+		szCommand += '"';
+		szCommand += g_CVar.GetArgV( iArg );
+		szCommand += "\" ";
+	}
+
+	szCommand += '\n';
+
+	for( size_t uiInstance = bAll ? 0 : uiIndex; uiInstance < ( bAll ? uiCount : uiIndex + 1 ); ++uiInstance )
+	{
+		g_Engine.GetInstance( uiInstance ).QueueCommand( szCommand.c_str() );
+	}
+}
+
+void Cmd_Instances_f()
+{
+	const size_t uiCount = g_Engine.GetInstanceCount();
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		CServerThread::Stats_t stats;
+
+		g_Engine.GetInstance( uiIndex ).GetStats( stats );
+
+		Msg( "%u: %llu ticks, %.3f ms avg, %.3f ms max, %.3f s dropped\n", static_cast<unsigned int>( uiIndex ),
+			 static_cast<unsigned long long>( stats.uiTicks ), stats.uiTicks > 0 ? stats.flTotalMS / stats.uiTicks : 0.0, stats.flMaxMS, stats.flDroppedTime );
+	}
+
+	Msg( "%u server instances\n", static_cast<unsigned int>( uiCount ) );
+}
+
+void Cmd_Steam_Call_Stats_f()
+{
+	if( g_CVar.GetArgC() == 2 && !strcmp( g_CVar.GetArgV( 1 ), "reset" ) )
+	{
+		g_SteamCallStats.Reset();
+		return;
+	}
+
+	g_SteamCallStats.PrintReport();
+}
+
+void PrintFrameTimeSummary( const char* pszName, const CFrameTimer::Summary_t& summary )
+{
+	Msg( "%-10s %8.3f %8.3f %8.3f\n", pszName, summary.flMinMS, summary.flAvgMS, summary.flP99MS );
+}
+
+void Cmd_FrameTimes_f()
+{
+	if( g_CVar.GetArgC() == 2 && !strcmp( g_CVar.GetArgV( 1 ), "reset" ) )
+	{
+		g_FrameTimer.Reset();
+		return;
+	}
+
+	CFrameTimer::Summary_t summary;
+
+	g_FrameTimer.GetTotalSummary( summary );
+
+	if( summary.uiFrames == 0 )
+	{
+		Msg( "No frames recorded\n" );
+		return;
+	}
+
+	Msg( "Frame times over the last %u frames, in milliseconds:\n", static_cast<unsigned int>( summary.uiFrames ) );
+	Msg( "%-10s %8s %8s %8s\n", "phase", "min", "avg", "p99" );
+
+	for( size_t uiPhase = 0; uiPhase < CFrameTimer::NUM_PHASES; ++uiPhase )
+	{
+		const auto phase = static_cast<CFrameTimer::Phase>( uiPhase );
+
+		CFrameTimer::Summary_t phaseSummary;
+
+		g_FrameTimer.GetPhaseSummary( phase, phaseSummary );
+
+		PrintFrameTimeSummary( CFrameTimer::GetPhaseName( phase ), phaseSummary );
+	}
+
+	PrintFrameTimeSummary( "total", summary );
+
+	for( size_t uiPass = 0; uiPass < CFrameTimer::NUM_GPU_PASSES; ++uiPass )
+	{
+		const auto pass = static_cast<CFrameTimer::GPUPass>( uiPass );
+
+		CFrameTimer::Summary_t passSummary;
+
+		g_FrameTimer.GetGPUPassSummary( pass, passSummary );
+
+		PrintFrameTimeSummary( CFrameTimer::GetGPUPassName( pass ), passSummary );
+	}
+}
+
+/**
+*	Publishes the filesystem's counters when metrics are exported.
+*/
+void CollectFileSystemMetrics( CMetricsRegistry& registry, void* )
+{
+	FileSystemStats_t stats;
+
+	g_pFileSystem->GetStats( stats );
+
+	registry.AddCounter( "filesystem_opens_total", "Files that were opened." )->Set( stats.uiOpens );
+	registry.AddCounter( "filesystem_misses_total", "Opens that failed because the file couldn't be found or opened." )->Set( stats.uiMisses );
+	registry.AddCounter( "filesystem_reads_total", "Reads from open files." )->Set( stats.uiReads );
+	registry.AddCounter( "filesystem_read_bytes_total", "Bytes read from files." )->Set( stats.uiBytesRead );
+	registry.AddCounter( "filesystem_seeks_total", "Seeks in open files." )->Set( stats.uiSeeks );
+	registry.AddCounter( "filesystem_io_seconds_total", "Time spent opening and reading files.", "", 1e-6 )->Set( stats.uiTime );
+}
+
+/**
+*	Publishes the counters of all network messages when metrics are exported. Only counted while net_stats is enabled.
+*/
+void CollectNetworkMetrics( CMetricsRegistry& registry, void* )
+{
+	NetMessageStats_t stats[ NUM_NET_MESSAGE_TYPES ];
+
+	NetStats_GetGlobal().GetStats( stats, NUM_NET_MESSAGE_TYPES );
+
+	std::string szLabels;
+
+	for( size_t uiType = 0; uiType < NUM_NET_MESSAGE_TYPES; ++uiType )
+	{
+		const auto& type = stats[ uiType ];
+
+		if( type.uiCount == 0 )
+			continue;
+
+		const char* pszName = NetStats_GetTypeName( static_cast<NetMessageType_t>( uiType ) );
+
+		char szNumber[ 8 ];
+
+		if( !pszName )
+		{
+			snprintf( szNumber, sizeof( szNumber ), "%u", static_cast<unsigned int>( uiType ) );
+			pszName = szNumber;
+		}
+
+		szLabels.clear();
+		CMetricsRegistry::FormatLabel( szLabels, "type", pszName );
+
+		registry.AddCounter( "net_messages_total", "Network messages written, by type.", szLabels.c_str() )->Set( type.uiCount );
+		registry.AddCounter( "net_message_bits_total", "Bits of network messages written, by type.", szLabels.c_str() )->Set( type.uiBits );
+		registry.AddCounter( "net_message_encode_seconds_total", "Time spent encoding network messages, by type.", szLabels.c_str(), 1e-9 )->Set( type.uiEncodeNS );
+	}
+}
+
+/**
+*	Publishes the tick counters of each server instance when metrics are exported.
+*/
+void CollectInstanceMetrics( CMetricsRegistry& registry, void* )
+{
+	std::string szLabels;
+
+	char szIndex[ 16 ];
+
+	for( size_t uiIndex = 0; uiIndex < g_Engine.GetInstanceCount(); ++uiIndex )
+	{
+		CServerThread::Stats_t stats;
+
+		g_Engine.GetInstance( uiIndex ).GetStats( stats );
+
+		snprintf( szIndex, sizeof( szIndex ), "%u", static_cast<unsigned int>( uiIndex ) );
+
+		szLabels.clear();
+		CMetricsRegistry::FormatLabel( szLabels, "instance", szIndex );
+
+		registry.AddCounter( "server_instance_ticks_total", "Ticks run by each server instance.", szLabels.c_str() )->Set( stats.uiTicks );
+		registry.AddCounter( "server_instance_tick_seconds_total", "Time spent running ticks by each server instance.", szLabels.c_str(), 1e-6 )
+			->Set( static_cast<uint64_t>( stats.flTotalMS * 1000 ) );
+		registry.AddCounter( "server_instance_dropped_seconds_total", "Simulation time each server instance dropped because it fell behind.", szLabels.c_str(), 1e-6 )
+			->Set( static_cast<uint64_t>( stats.flDroppedTime * 1000000 ) );
+	}
+}
+
+/**
+*	Publishes the voice chat counters when metrics are exported.
+*/
+void CollectVoiceMetrics( CMetricsRegistry& registry, void* )
+{
+	CVoiceChat::Stats_t stats;
+
+	g_Engine.GetVoiceChat().GetStats( stats );
+
+	registry.AddGauge( "voice_speakers", "Speakers that are being played." )->Set( static_cast<double>( stats.uiSpeakers ) );
+	registry.AddCounter( "voice_frames_captured_total", "Voice frames recorded from the capture device." )->Set( stats.uiFramesCaptured );
+	registry.AddCounter( "voice_frames_encoded_total", "Voice frames encoded into packets." )->Set( stats.uiFramesEncoded );
+	registry.AddCounter( "voice_frames_decoded_total", "Voice frames decoded from received packets." )->Set( stats.uiFramesDecoded );
+	registry.AddCounter( "voice_frames_concealed_total", "Voice frames that were missing when they were due, and were concealed." )->Set( stats.uiFramesConcealed );
+	registry.AddCounter( "voice_frames_dropped_total", "Voice frames and packets dropped because a queue, the pool or the speakers were full." )->Set( stats.uiFramesDropped );
+	registry.AddCounter( "voice_packets_late_total", "Voice packets that arrived after their frame was due, or twice." )->Set( stats.uiPacketsLate );
+	registry.AddCounter( "voice_packets_invalid_total", "Voice packets that couldn't be read." )->Set( stats.uiPacketsInvalid );
+}
+
+constexpr cvar::CVarDesc_t ENGINE_CVARS[] =
+{
+	cvar::CVarDesc( asset_cache_cpu_mb, "asset_cache_cpu_mb" ),
+	cvar::CVarDesc( asset_cache_gpu_mb, "asset_cache_gpu_mb" ),
+	cvar::CVarDesc( cl_download_connections, "cl_download_connections" ),
+	cvar::CVarDesc( cl_downloadurl, "cl_downloadurl" ),
+	cvar::CVarDesc( r_framegraph, "r_framegraph" ),
+	cvar::CVarDesc( r_texture_budget_mb, "r_texture_budget_mb" ),
+	cvar::CVarDesc( rcon_password, "rcon_password" ),
+	cvar::CVarDesc( steam_callback_budget_ms, "steam_callback_budget_ms" ),
+	cvar::CVarDesc( steam_callback_rate, "steam_callback_rate" ),
+	cvar::CVarDesc( steam_timing, "steam_timing" ),
+	cvar::CVarDesc( sys_ticrate, "sys_ticrate" ),
+	cvar::CVarDesc( vgui_cache, "vgui_cache" ),
+	cvar::CVarDesc( voice_loopback, "voice_loopback" ),
+	cvar::CVarDesc( voice_scale, "voice_scale" ),
+};
+
+constexpr cvar::CommandDesc_t ENGINE_COMMANDS[] =
+{
+	cvar::CommandDesc( "+voicerecord", &::Cmd_VoiceRecord_Start_f ),
+	cvar::CommandDesc( "-voicerecord", &::Cmd_VoiceRecord_Stop_f ),
+	cvar::CommandDesc( "_rcon_begin", &::Cmd_Rcon_Begin_f ),
+	cvar::CommandDesc( "_rcon_end", &::Cmd_Rcon_End_f ),
+	cvar::CommandDesc( "asset_cache_stats", &::Cmd_AssetCache_Stats_f ),
+	cvar::CommandDesc( "cpu_features", &::Cmd_CPU_Features_f ),
+	cvar::CommandDesc( "demo_seek", &::Cmd_Demo_Seek_f ),
+	cvar::CommandDesc( "download", &::Cmd_Download_f ),
+	cvar::CommandDesc( "download_status", &::Cmd_Download_Status_f ),
+	cvar::CommandDesc( "frame_arena_stats", &::Cmd_Frame_Arena_Stats_f ),
+	cvar::CommandDesc( "frametimes", &::Cmd_FrameTimes_f ),
+	cvar::CommandDesc( "host_writeconfig", &::Cmd_Host_WriteConfig_f ),
+	cvar::CommandDesc( "instance", &::Cmd_Instance_f ),
+	cvar::CommandDesc( "instances", &::Cmd_Instances_f ),
+	cvar::CommandDesc( "mem_stats", &::Cmd_Mem_Stats_f ),
+	cvar::CommandDesc( "music", &::Cmd_Music_f ),
+	cvar::CommandDesc( "net_stats", &::Cmd_Net_Stats_f ),
+	cvar::CommandDesc( "play", &::Cmd_Play_f ),
+	cvar::CommandDesc( "playdemo", &::Cmd_PlayDemo_f ),
+	cvar::CommandDesc( "quit", &::Cmd_Quit_f ),
+	cvar::CommandDesc( "record", &::Cmd_Record_f ),
+	cvar::CommandDesc( "server_thread_stats", &::Cmd_Server_Thread_Stats_f ),
+	cvar::CommandDesc( "steam_call_stats", &::Cmd_Steam_Call_Stats_f ),
+	cvar::CommandDesc( "steam_callback_stats", &::Cmd_Steam_Callback_Stats_f ),
+	cvar::CommandDesc( "stop", &::Cmd_Stop_f ),
+	cvar::CommandDesc( "stopsound", &::Cmd_StopSound_f ),
+	cvar::CommandDesc( "texture_stats", &::Cmd_Texture_Stats_f ),
+	cvar::CommandDesc( "trace_dump", &::Cmd_Trace_Dump_f ),
+};
+}
+
+CEngine::CEngine() = default;
+
+CEngine::~CEngine() = default;
+
+void CEngine::SetMyGameDir( const char* const pszGameDir )
+{
+	strncpy( m_szMyGameDir, pszGameDir, sizeof( m_szMyGameDir ) );
+	m_szMyGameDir[ sizeof( m_szMyGameDir ) - 1 ] = '\0';
+}
+
+bool CEngine::Startup( IMetaLoader& loader, CreateInterfaceFn* pFactories, const size_t uiNumFactories )
+{
+	TRACE_SCOPE( "Engine::Startup" );
+
+	m_pLoader = &loader;
+
+	//Before anything that is tracked is allocated.
+	if( GetCommandLine()->HasKey( "-memtracking" ) )
+		Mem_EnableTracking();
+
+	if( GetCommandLine()->HasKey( "-netstats" ) )
+		NetStats_Enable( true );
+
+	//The filesystem's caches are set up by the loader with the same parameter.
+	if( GetCommandLine()->HasKey( "-largepages" ) )
+		GetFrameArena().SetLargePages( true );
+
+	NetStats_RegisterType( static_cast<NetMessageType_t>( ServerMessage::TICK ), "server_tick" );
+
+	//Added first so the console can show everything that was logged during startup.
+	m_ConsoleScrollback = std::make_unique<CConsoleScrollback>();
+
+	Log_AddSink( m_ConsoleScrollback.get() );
+
+	if( !m_pLoader->GetGameDirectory( m_szMyGameDir, sizeof( m_szMyGameDir ) ) )
+		return false;
+
+	if( !( *m_szMyGameDir ) )
+	{
+		UTIL_ShowMessageBox( "No game directory set", "Error", LogType::ERROR );
+		return false;
+	}
+
+	{
+		//Leave a core for the main thread.
+		const int iCores = static_cast<int>( std::thread::hardware_concurrency() );
+
+		const int iJobThreads = GetCommandLine()->GetInt( "-jobthreads", std::max( 1, std::min( MAX_DEFAULT_JOB_THREADS, iCores - 1 ) ) );
+
+		GetJobSystem().Start( static_cast<size_t>( std::max( 0, iJobThreads ) ) );
+	}
+
+	for( size_t uiIndex = 0; uiIndex < uiNumFactories; ++uiIndex )
+	{
+		m_Interfaces.AddFactory( nullptr, pFactories[ uiIndex ] );
+	}
+
+	g_pFileSystem = static_cast<IFileSystem2*>( m_Interfaces.Find( FILESYSTEM2_INTERFACE_VERSION ) );
+
+	if( !g_pFileSystem )
+	{
+		Msg( "Couldn't instantiate the filesystem\n" );
+		return false;
+	}
+
+	m_SoundCache = std::make_unique<CSoundCache>( *g_pFileSystem );
+	m_SoundStreamer = std::make_unique<CSoundStreamer>( *g_pFileSystem );
+
+	if( !m_SoundStreamer->Start() )
+		Msg( "Couldn't start the sound streamer\n" );
+
+	m_VoiceChat = std::make_unique<CVoiceChat>( GetJobSystem(), m_Mixer );
+
+	if( const char* pszLogFile = GetCommandLine()->GetValue( "-logfile" ) )
+	{
+		if( !( *pszLogFile ) || *pszLogFile == '-' || *pszLogFile == '+' )
+			pszLogFile = DEFAULT_LOG_FILE;
+
+		m_LogSink = std::make_unique<CFileLogSink>( *g_pFileSystem, pszLogFile );
+
+		Log_AddSink( m_LogSink.get() );
+	}
+
+	//Steps that don't depend on each other run at the same time, so startup takes as long as the longest chain of steps instead of all of them.
+	//Window and GL creation and Steam API initialization have to happen on the main thread.
+	CTaskGraph startup;
+
+	const auto loadSteamAPI = startup.AddTask( "LoadSteamAPI", [ & ]()
+	{
+		CScopedStartupPhase phase( loader, "LoadSteamAPI" );
+
+		m_steam_api = Steam_LoadSteamAPI( filepaths::BIN_DIR );
+
+		return true;
+	} );
+
+	const auto initSteamAPI = startup.AddTask( "InitSteamAPI", [ & ]()
+	{
+		CScopedStartupPhase phase( loader, "InitSteamAPI" );
+
+		m_bSteamAPIInitialized = Steam_InitWrappers( m_steam_api, true );
+
+		if( !m_bSteamAPIInitialized )
+		{
+			return false;
+		}
+
+		if( !g_SteamAPIContext.Init() )
+		{
+			UTIL_ShowMessageBox( "Failed to initialize Steam API Context. Exiting...\n", "Fatal Error", LogType::ERROR );
+			return false;
+		}
+
+		//Only safe if everything that registers callbacks can handle them arriving on another thread.
+		m_SteamCallbacks.Start( GetCommandLine()->HasKey( "-steamcallbackthread" ) );
+
+		return true;
+	}, { loadSteamAPI }, true );
+
+	const auto patchFileSystem = startup.AddTask( "PatchFileSystem", [ & ]()
+	{
+		CScopedStartupPhase phase( loader, "PatchFileSystem" );
+
+		return PatchFileSystem();
+	} );
+
+	const auto videoInit = startup.AddTask( "VideoInit", [ & ]()
+	{
+		CScopedStartupPhase phase( loader, "VideoInit" );
+
+		return g_Video.Initialize();
+	}, {}, true );
+
+	//Sound is optional, the game runs without it.
+	startup.AddTask( "AudioInit", [ & ]()
+	{
+		CScopedStartupPhase phase( loader, "AudioInit" );
+
+		if( !GetCommandLine()->HasKey( "-nosound" ) && !m_AudioDevice.Open( m_Mixer ) )
+			Msg( "Continuing without sound\n" );
+
+		if( m_AudioDevice.IsOpen() && !GetCommandLine()->HasKey( "-novoice" ) && !m_VoiceCapture.Open( *m_VoiceChat ) )
+			Msg( "Continuing without voice capture\n" );
+
+		return true;
+	}, {}, true );
+
+	startup.AddTask( "HostInit", [ & ]()
+	{
+		Msg( "HostInit\n" );
+
+		CScopedStartupPhase phase( loader, "HostInit" );
+
+		if( !HostInit() )
+		{
+			UTIL_ShowMessageBox( "Error initializing host", "Fatal Error", LogType::ERROR );
+			return false;
+		}
+
+		return true;
+	}, { initSteamAPI, patchFileSystem, videoInit }, true );
+
+	return startup.Run( GetCommandLine()->HasKey( "-serialstartup" ) ? nullptr : &GetJobSystem() );
+}
+
+bool CEngine::PatchFileSystem()
+{
+	//Load the original filesystem and overwrite its filesystem's vtable with one that points to ours.
+	//Note: if the original engine regains control, it might try to use preexisting handles. Don't let that happen. - Solokiller
+	CLibrary fileSystem;
+
+	//Only its factory is ever called, so don't bind the rest.
+	if( !fileSystem.Load( CLibArgs( "filesystem_stdio" ).DisablePrefixes( true ).Flags( LibLoadFlag::LAZY_BINDING ) ) )
+	{
+		Msg( "Couldn't load filesystem_stdio\n" );
+		return false;
+	}
+
+	auto filesystemFactory = reinterpret_cast<CreateInterfaceFn>( fileSystem.GetFunctionAddress( CREATEINTERFACE_PROCNAME ) );
+
+	if( !filesystemFactory )
+	{
+		Msg( "Couldn't find filesystem_stdio factory\n" );
+		return false;
+	}
+
+	auto pFileSystem = static_cast<IFileSystem*>( filesystemFactory( FILESYSTEM_INTERFACE_VERSION, nullptr ) );
+
+	if( !pFileSystem )
+	{
+		Msg( "Couldn't instantiate the filesystem from filesystem_stdio\n" );
+		return false;
+	}
+
+	CFileSystemWrapper::BindFastPath( *g_pFileSystem );
+
+	CFileSystemWrapper wrapper;
+
+	//Don't try this at home.
+	memcpy( pFileSystem, &wrapper, sizeof( IFileSystem ) );
+
+	return true;
+}
+
+void CEngine::PublishCommandMetrics( const std::chrono::steady_clock::time_point now )
+{
+	//Command counters are only updated on this thread, so they're copied into the metrics every so often.
+	if( !m_MetricsServer.IsRunning() || now - m_CommandMetricsTime < COMMAND_METRICS_INTERVAL )
+		return;
+
+	m_CommandMetricsTime = now;
+
+	std::string szLabels;
+
+	for( auto pCommand = g_CVar.GetFirstCommand(); pCommand; pCommand = pCommand->pNext )
+	{
+		if( pCommand->uiCalls == 0 )
+			continue;
+
+		auto& metrics = m_CommandMetrics[ pCommand ];
+
+		if( !metrics.pCalls )
+		{
+			szLabels.clear();
+			CMetricsRegistry::FormatLabel( szLabels, "command", pCommand->GetName() );
+
+			metrics.pCalls = m_Metrics.AddCounter( "engine_command_calls_total", "Times each console command was executed.", szLabels.c_str() );
+			metrics.pTime = m_Metrics.AddCounter( "engine_command_seconds_total", "Time spent executing each console command.", szLabels.c_str(), 1e-6 );
+		}
+
+		metrics.pCalls->Set( pCommand->uiCalls );
+		metrics.pTime->Set( pCommand->uiTotalTime );
+	}
+}
+
+bool CEngine::Run()
+{
+	const int iRconPort = GetCommandLine()->GetInt( "-rconport", 0 );
+
+	if( iRconPort > 0 && iRconPort <= UINT16_MAX )
+	{
+		m_RconServer.SetPassword( rcon_password.string );
+
+		if( m_RconServer.Start( static_cast<uint16_t>( iRconPort ), g_CommandBuffer ) )
+			Msg( "Remote console listening on port %d\n", iRconPort );
+		else
+			Warning( "Couldn't start remote console on port %d\n", iRconPort );
+	}
+
+	const int iMetricsPort = GetCommandLine()->GetInt( "-metricsport", 0 );
 
-bool CEngine::Startup( IMetaLoader& loader, CreateInterfaceFn* pFactories, const size_t uiNumFactories )
-{
-	m_pLoader = &loader;
+	if( iMetricsPort > 0 && iMetricsPort <= UINT16_MAX )
+	{
+		if( m_MetricsServer.Start( static_cast<uint16_t>( iMetricsPort ), m_Metrics ) )
+		{
+			m_Metrics.AddCollector( &::CollectFileSystemMetrics, nullptr );
+			m_Metrics.AddCollector( &::CollectNetworkMetrics, nullptr );
+			m_Metrics.AddCollector( &::CollectVoiceMetrics, nullptr );
 
-	if( !m_pLoader->GetGameDirectory( m_szMyGameDir, sizeof( m_szMyGameDir ) ) )
-		return false;
+			g_FrameTimer.SetMetrics( &m_Metrics );
 
-	if( !( *m_szMyGameDir ) )
+			Msg( "Metrics listening on port %d\n", iMetricsPort );
+		}
+		else
+			Warning( "Couldn't start metrics server on port %d\n", iMetricsPort );
+	}
+
+	if( !m_pLoader->IsListenServer() )
+		return RunDedicated();
+
+	if( GetCommandLine()->HasKey( "-serverthread" ) )
 	{
-		UTIL_ShowMessageBox( "No game directory set", "Error", LogType::ERROR );
-		return false;
+		m_ServerThread.SetTickRate( sys_ticrate.value );
+		m_ServerThread.Start( [ this ]( const double flTickInterval ) { ServerTick( flTickInterval ); } );
 	}
 
-	m_steam_api = Steam_LoadSteamAPI( filepaths::BIN_DIR );
+	return g_Video.Run( *this );
+}
+
+void CEngine::Shutdown()
+{
+	m_RconServer.Stop();
+
+	//Collectors use the filesystem and the instances.
+	m_MetricsServer.Stop();
+
+	g_FrameTimer.SetMetrics( nullptr );
+
+	//Before the filesystem goes away.
+	m_Instances.clear();
+
+	//Before the filesystem goes away.
+	m_Downloads.Stop();
+
+	g_CVar.WriteArchive( *g_pFileSystem, CONFIG_FILE_NAME );
+
+	m_ServerThread.Stop();
+
+	//Stops the capture thread before the pipeline goes away, and the pipeline's streams before the device does.
+	m_VoiceCapture.Close();
+	m_VoiceChat.reset();
+
+	//Before the filesystem goes away.
+	m_AudioDevice.Close();
+	m_SoundStreamer.reset();
+	m_SoundCache.reset();
 
-	m_bSteamAPIInitialized = Steam_InitWrappers( m_steam_api, true );
+	m_DemoRecorder.Stop();
+	m_DemoPlayer.Close();
 
-	if( !m_bSteamAPIInitialized )
+	m_AssetLoader.Stop();
+	m_Models.resize( 1 );
+	m_AssetCache.Clear();
+
+	//Jobs that are still queued may need GL.
+	GetJobSystem().Stop();
+
+	g_Video.Shutdown();
+
+	m_SteamCallbacks.Stop();
+
+	if( m_steam_api.IsLoaded() )
 	{
-		return false;
+		if( m_bSteamAPIInitialized )
+			SteamAPI_Shutdown();
+
+		m_steam_api.Free();
 	}
 
-	if( !g_SteamAPIContext.Init() )
+	if( m_LogSink )
 	{
-		UTIL_ShowMessageBox( "Failed to initialize Steam API Context. Exiting...\n", "Fatal Error", LogType::ERROR );
-		return false;
+		Log_RemoveSink( m_LogSink.get() );
+		m_LogSink.reset();
 	}
 
-	for( size_t uiIndex = 0; uiIndex < uiNumFactories; ++uiIndex )
+	if( m_ConsoleScrollback )
 	{
-		auto factory = pFactories[ uiIndex ];
-
-		if( !g_pFileSystem )
-		{
-			g_pFileSystem = static_cast<IFileSystem2*>( factory( FILESYSTEM2_INTERFACE_VERSION, nullptr ) );
-		}
+		Log_RemoveSink( m_ConsoleScrollback.get() );
+		m_ConsoleScrollback.reset();
 	}
 
-	if( !g_pFileSystem )
+	m_Interfaces.Clear();
+
+	Log_Shutdown();
+}
+
+void CEngine::RunFrame()
+{
+	TRACE_SCOPE( "Engine::RunFrame" );
+
+	//Return to the loader so it can start the rebuilt engine.
+	if( m_pLoader->ShouldReloadTool() )
+		RequestQuit();
+
 	{
-		Msg( "Couldn't instantiate the filesystem\n" );
-		return false;
+		CFrameTimer::CScopedPhase phase( g_FrameTimer, CFrameTimer::Phase::COMMANDS );
+
+		g_CommandBuffer.Execute();
 	}
 
-	//Load the original filesystem and overwrite its filesystem's vtable with one that points to ours.
-	//Note: if the original engine regains control, it might try to use preexisting handles. Don't let that happen. - Solokiller
-	{
-		CLibrary fileSystem;
+	m_AssetLoader.Update();
+
+	m_Timers.Advance( Plat_GetMicroseconds() );
+
+	m_Mixer.Update();
 
-		if( !fileSystem.Load( CLibArgs( "filesystem_stdio" ).DisablePrefixes( true ) ) )
+	UpdateVoice();
+
+	GetJobSystem().RunMainThreadJobs();
+
+	m_AssetCache.SetBudget( static_cast<size_t>( std::max( 0.0f, asset_cache_cpu_mb.value ) * 1024 * 1024 ),
+							static_cast<size_t>( std::max( 0.0f, asset_cache_gpu_mb.value ) * 1024 * 1024 ) );
+	m_AssetCache.Trim();
+
+	g_SteamCallStats.SetEnabled( steam_timing.value != 0 );
+
+	m_RconServer.SetPassword( rcon_password.string );
+
+	PublishCommandMetrics( std::chrono::steady_clock::now() );
+
+	m_SteamCallbacks.SetRate( steam_callback_rate.value );
+	m_SteamCallbacks.SetBudget( steam_callback_budget_ms.value );
+	m_SteamCallbacks.Update();
+
+	auto& textures = g_Video.GetTextureManager();
+
+	textures.SetBudget( static_cast<size_t>( std::max( 0.0f, r_texture_budget_mb.value ) * 1024 * 1024 ) );
+	textures.Update();
+
+	const auto now = std::chrono::steady_clock::now();
+
+	double flFrameTime = m_bHasLastFrameTime ? std::chrono::duration<double>( now - m_LastFrameTime ).count() : 0;
+
+	m_LastFrameTime = now;
+	m_bHasLastFrameTime = true;
+
+	//Settings menus may set cvars on every change, write them once they've had a moment to settle.
+	if( g_CVar.IsArchiveDirty() )
+	{
+		if( !m_bArchiveChanged )
 		{
-			Msg( "Couldn't load filesystem_stdio\n" );
-			return false;
+			m_bArchiveChanged = true;
+			m_ArchiveChangeTime = now;
+		}
+		else if( now - m_ArchiveChangeTime >= ARCHIVE_WRITE_DELAY )
+		{
+			g_CVar.WriteArchive( *g_pFileSystem, CONFIG_FILE_NAME );
+			m_bArchiveChanged = false;
 		}
+	}
+
+	if( flFrameTime > MAX_FRAME_TIME )
+		flFrameTime = MAX_FRAME_TIME;
 
-		auto filesystemFactory = reinterpret_cast<CreateInterfaceFn>( fileSystem.GetFunctionAddress( CREATEINTERFACE_PROCNAME ) );
+	float flAlpha;
+
+	{
+		CFrameTimer::CScopedPhase phase( g_FrameTimer, CFrameTimer::Phase::SIMULATION );
 
-		if( !filesystemFactory )
+		if( m_ServerThread.IsRunning() )
 		{
-			Msg( "Couldn't find filesystem_stdio factory\n" );
-			return false;
+			m_ServerThread.SetTickRate( sys_ticrate.value );
+
+			flAlpha = ReadServerMessages( now );
 		}
+		else
+		{
+			m_Timestep.SetTickRate( sys_ticrate.value );
 
-		auto pFileSystem = static_cast<IFileSystem*>( filesystemFactory( FILESYSTEM_INTERFACE_VERSION, nullptr ) );
+			const unsigned int uiTicks = m_Timestep.Advance( flFrameTime );
 
-		if( !pFileSystem )
-		{
-			Msg( "Couldn't instantiate the filesystem from filesystem_stdio\n" );
-			return false;
+			for( unsigned int uiTick = 0; uiTick < uiTicks; ++uiTick )
+			{
+				Tick( m_Timestep.GetTickInterval() );
+			}
+
+			flAlpha = m_Timestep.GetAlpha();
 		}
 
-		CFileSystemWrapper wrapper;
+		if( m_DemoPlayer.IsOpen() )
+			flAlpha = PlayDemo( flFrameTime, now );
+	}
+
+	//Dedicated servers don't render.
+	if( m_pFrameGraph )
+		RenderFrame( flAlpha );
+
+	//Nothing allocated from the frame arena two frames ago is used anymore.
+	GetFrameArena().EndFrame();
+}
+
+void CEngine::RenderFrame( const float flAlpha )
+{
+	const bool bShowFrameGraph = r_framegraph.value != 0;
+
+	if( m_pFrameGraph->isVisible() != bShowFrameGraph )
+	{
+		m_pFrameGraph->setVisible( bShowFrameGraph );
 
-		//Don't try this at home.
-		memcpy( pFileSystem, &wrapper, sizeof( IFileSystem ) );
+		//Whatever was under the graph has to be repainted when it's hidden.
+		g_pVGUI1Surface->InvalidateAll();
 	}
 
-	if( !g_Video.Initialize() )
+	if( bShowFrameGraph )
 	{
-		return false;
+		const float flMaxFPS = g_Video.GetFrameLimiter().GetMaxFPS();
+
+		m_pFrameGraph->SetBudget( flMaxFPS > 0 ? 1000 / flMaxFPS : 0 );
 	}
 
-	Msg( "HostInit\n" );
+	m_flRenderAlpha = flAlpha;
+
+	//Sample input as late as possible, so what is drawn is as recent as it can be.
+	g_Video.PumpEvents();
 
-	if( !HostInit() )
 	{
-		UTIL_ShowMessageBox( "Error initializing host", "Fatal Error", LogType::ERROR );
-		return false;
+		CFrameTimer::CScopedPhase phase( g_FrameTimer, CFrameTimer::Phase::RENDER );
+
+		RenderVGUI1();
 	}
 
-	return true;
+	g_pVGUI1Surface->swapBuffers();
 }
 
-bool CEngine::Run()
+bool CEngine::HostInit()
 {
-	return g_Video.Run( *this );
+	CNetworkBuffer::InitMasks();
+
+	if( !g_CVar.Initialize() )
+		return false;
+
+	if( !g_CommandBuffer.Initialize( &g_CVar ) )
+		return false;
+
+	g_CVar.AddCVars( ::ENGINE_CVARS );
+	g_CVar.AddCommands( ::ENGINE_COMMANDS );
+
+	//Downloaded resources are only used if nothing else has them.
+	m_szDownloadPath = std::string( m_szMyGameDir ) + DOWNLOAD_DIR_SUFFIX;
+
+	g_pFileSystem->CreateDirHierarchy( m_szDownloadPath.c_str(), "ROOT" );
+
+	if( !g_pFileSystem->AddOverlaySearchPath( m_szDownloadPath.c_str(), DOWNLOAD_PATH_ID ) )
+		Warning( "Couldn't add download directory \"%s\"\n", m_szDownloadPath.c_str() );
+
+	if( m_pLoader->IsListenServer() )
+		CreateVGUI1();
+
+	return true;
 }
 
-void CEngine::Shutdown()
+void CEngine::UpdateVoice()
 {
-	g_Video.Shutdown();
+	m_VoiceChat->SetVolume( std::min( std::max( voice_scale.value, 0.0f ), 1.0f ) );
+	m_VoiceChat->Update();
 
-	if( m_steam_api.IsLoaded() )
+	//There's no transport for voice yet, so packets are only played back to the local player with voice_loopback, and dropped otherwise.
+	alignas( 4 ) uint8_t packet[ ( CVoiceChat::MAX_PACKET_SIZE + 3 ) & ~3 ];
+
+	CNetworkBuffer buffer( "voice_loopback", packet, sizeof( packet ) );
+
+	while( m_VoiceChat->ReadPacket( buffer ) )
 	{
-		if( m_bSteamAPIInitialized )
-			SteamAPI_Shutdown();
+		if( voice_loopback.value != 0 )
+		{
+			buffer.ResetToStart();
+			m_VoiceChat->ReceivePacket( LOCAL_VOICE_SPEAKER, buffer );
+		}
 
-		m_steam_api.Free();
+		buffer.ResetToStart();
 	}
 }
 
-void CEngine::RunFrame()
+bool CEngine::StartDownloads( const char* pszBaseURL )
 {
-	RenderFrame();
+	return m_Downloads.Start( *g_pFileSystem, pszBaseURL, m_szDownloadPath.c_str(), DOWNLOAD_PATH_ID,
+		static_cast<size_t>( std::max( 1, static_cast<int>( cl_download_connections.value ) ) ) );
 }
 
-bool CEngine::HostInit()
+ModelHandle_t CEngine::LoadModel( const char* pszFileName )
 {
-	CNetworkBuffer::InitMasks();
+	if( auto model = m_AssetCache.FindModel( pszFileName ) )
+		return model;
 
-	if( !g_CVar.Initialize() )
-		return false;
+	auto model = std::make_shared<CModelFile>();
 
-	if( !g_CommandBuffer.Initialize( &g_CVar ) )
-		return false;
+	if( !model->Load( *g_pFileSystem, pszFileName ) )
+	{
+		Msg( "Couldn't load model \"%s\": %s\n", pszFileName, model->GetError() );
+		return nullptr;
+	}
+
+	return m_AssetCache.AddModel( pszFileName, std::move( model ) );
+}
+
+int32_t CEngine::PrecacheModel( const char* pszFileName )
+{
+	auto model = LoadModel( pszFileName );
 
+	if( !model )
+		return 0;
+
+	auto it = std::find( m_Models.begin() + 1, m_Models.end(), model );
+
+	if( it != m_Models.end() )
+		return static_cast<int32_t>( it - m_Models.begin() );
+
+	m_Models.push_back( std::move( model ) );
+
+	return static_cast<int32_t>( m_Models.size() - 1 );
+}
+
+bool CEngine::IsQuitRequested() const
+{
+	return m_bQuitRequested || g_bQuitSignaled;
+}
+
+void CEngine::CreateVGUI1()
+{
 	auto pApp = vgui::App::getInstance();
 
 	pApp->reset();
 
-	m_pRootPanel = new vgui::Panel( 0, 0, g_Video.GetWidth(), g_Video.GetHeight() );
+	//Game UI such as scoreboards and server browsers add many panels here.
+	m_pRootPanel = new CHitTestPanel( 0, 0, g_Video.GetWidth(), g_Video.GetHeight() );
 
 	m_pRootPanel->setPaintBorderEnabled( false );
 	m_pRootPanel->setPaintBackgroundEnabled( false );
@@ -180,14 +1715,94 @@ bool CEngine::HostInit()
 
 	CreateMainMenuBackground();
 
+	//Created last so it's drawn on top.
+	const int iGraphWide = std::min( static_cast<int>( CFrameTimer::NUM_FRAMES ) * CFrameGraphPanel::BAR_WIDTH, static_cast<int>( g_Video.GetWidth() ) );
+	const int iGraphTall = std::min( FRAME_GRAPH_TALL, static_cast<int>( g_Video.GetHeight() ) );
+
+	m_pFrameGraph = new CFrameGraphPanel( g_FrameTimer, 0, g_Video.GetHeight() - iGraphTall, iGraphWide, iGraphTall );
+
+	m_pFrameGraph->setParent( m_pRootPanel );
+	m_pFrameGraph->setVisible( false );
+}
+
+void CEngine::StartInstances()
+{
+	const int iCount = std::min( GetCommandLine()->GetInt( "-instances", 0 ), MAX_INSTANCES );
+
+	if( iCount <= 0 )
+		return;
+
+	//The metaloader turns thread safety on for -instances, this catches other loaders.
+	if( !( g_pFileSystem->GetOptions() & FileSystemOption::THREAD_SAFE ) )
+	{
+		Msg( "Can't host server instances without a thread safe filesystem, start with -fs_threadsafe\n" );
+		return;
+	}
+
+	m_Instances.reserve( iCount );
+
+	for( int iIndex = 0; iIndex < iCount; ++iIndex )
+	{
+		m_Instances.push_back( std::make_unique<CServerInstance>( static_cast<size_t>( iIndex ) ) );
+		m_Instances.back()->Start();
+	}
+
+	if( m_MetricsServer.IsRunning() )
+		m_Metrics.AddCollector( &::CollectInstanceMetrics, nullptr );
+
+	Msg( "Hosting %d server instances\n", iCount );
+}
+
+bool CEngine::RunDedicated()
+{
+	std::signal( SIGINT, &::QuitSignalHandler );
+	std::signal( SIGTERM, &::QuitSignalHandler );
+
+#ifdef WIN32
+	//Sleeps are rounded up to the scheduler tick, which is 15.6 ms by default.
+	timeBeginPeriod( 1 );
+#endif
+
+	StartInstances();
+
+	//One frame per tick. Sleep only, spinning would waste CPU that other server instances need.
+	CFrameLimiter limiter;
+
+	limiter.SetSleepOnly( true );
+
+	while( !IsQuitRequested() )
+	{
+		limiter.SetMaxFPS( m_Timestep.GetTickRate() );
+
+		limiter.WaitForNextFrame();
+
+		g_FrameTimer.BeginFrame();
+
+		RunFrame();
+
+		g_FrameTimer.EndFrame();
+	}
+
+#ifdef WIN32
+	timeEndPeriod( 1 );
+#endif
+
+	std::signal( SIGINT, SIG_DFL );
+	std::signal( SIGTERM, SIG_DFL );
+
 	return true;
 }
 
 void CEngine::CreateMainMenuBackground()
 {
-	auto pBackground = new vgui::Panel();
+	//The images finish loading in the background after startup, this only covers queuing them.
+	CScopedStartupPhase phase( *m_pLoader, "MainMenuBackground" );
+
+	//The background never changes, so draw it from a texture instead of drawing all of its images every time.
+	auto pBackground = new CCachedPanel( 0, 0, 0, 0 );
 
 	pBackground->setParent( m_pRootPanel );
+	pBackground->SetCacheEnabled( true );
 
 	int wide, tall;
 	
@@ -195,6 +1810,9 @@ void CEngine::CreateMainMenuBackground()
 
 	pBackground->setSize( wide, tall );
 
+	//Shown until the images are loaded.
+	pBackground->setBgColor( 0, 0, 0, 0 );
+
 	const float flXScale = g_Video.GetWidth() / 800.0f;
 	const float flYScale = g_Video.GetHeight() / 600.0f;
 	const int iXOffsetScale = static_cast<int>( ceil( 256 * flXScale ) );
@@ -206,53 +1824,202 @@ void CEngine::CreateMainMenuBackground()
 	{
 		snprintf( szFileName, sizeof( szFileName ), "resource/background/800_%u_%c_loading.tga", ( uiIndex / 4 ) + 1, 'a' + ( uiIndex % 4 ) );
 
-		auto pImage = static_cast<vgui::RDBitmapTGA*>( vgui_LoadTGA( szFileName, true, true ) );
+		const int x = iXOffsetScale * ( uiIndex % 4 );
+		const int y = iYOffsetScale * ( uiIndex / 4 );
 
-		//Resize the images so they fit the default resolution better. The resolution scaling will take care of the rest. - Solokiller
-		pImage->SetXScale( 640 / 800.0f );
-		pImage->SetYScale( 480 / 600.0f );
+		m_AssetLoader.LoadImage( szFileName, true,
+			[ = ]( const ImageHandle_t& image )
+			{
+				if( !image )
+					return;
 
-		auto pImagePanel = new vgui::ImagePanel( pImage );
+				auto pImage = static_cast<vgui::RDBitmapTGA*>( vgui_CreateTGA( image, true ) );
 
-		pImagePanel->setParent( pBackground );
+				//Resize the images so they fit the default resolution better. The resolution scaling will take care of the rest. - Solokiller
+				pImage->SetXScale( 640 / 800.0f );
+				pImage->SetYScale( 480 / 600.0f );
 
-		pImagePanel->setPos( iXOffsetScale * ( uiIndex % 4 ), iYOffsetScale * ( uiIndex / 4 ) );
+				auto pImagePanel = new vgui::ImagePanel( pImage );
+
+				pImagePanel->setParent( pBackground );
+
+				pImagePanel->setPos( x, y );
+
+				//Redraws the cached background.
+				pBackground->repaint();
+			}
+		);
 	}
 }
 
-void CEngine::RenderFrame()
+void CEngine::Tick( const double flTickInterval )
 {
-	RenderVGUI1();
+	//Game and server code runs here, stepped by flTickInterval, never by the frame time.
+	m_Entities.Integrate( static_cast<float>( flTickInterval ), &GetJobSystem() );
 }
 
-void CEngine::RenderVGUI1()
+void CEngine::ServerTick( const double flTickInterval )
 {
-	glClearColor( 0, 0, 0, 1 );
+	Tick( flTickInterval );
 
-	glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+	auto& queue = m_ServerThread.GetServerToClient();
 
-	glViewport( 0, 0, g_Video.GetWidth(), g_Video.GetHeight() );
+	//If the client isn't keeping up, it finds out about the next tick instead.
+	if( auto pMessage = queue.BeginWrite() )
+	{
+		{
+			CNetMessageScope scope( *pMessage, static_cast<NetMessageType_t>( ServerMessage::TICK ) );
+
+			pMessage->WriteByte( static_cast<int>( ServerMessage::TICK ) );
+			pMessage->WriteLong( static_cast<int>( ++m_uiServerTicksSent ) );
+			pMessage->WriteFloat( static_cast<float>( flTickInterval ) );
+		}
+
+		queue.EndWrite();
+	}
+}
+
+float CEngine::ReadServerMessages( const std::chrono::steady_clock::time_point now )
+{
+	auto& queue = m_ServerThread.GetServerToClient();
+
+	while( auto pMessage = queue.BeginRead() )
+	{
+		m_DemoRecorder.WriteMessage( now, *pMessage );
+
+		//The demo being played takes the server's place.
+		if( !m_DemoPlayer.IsOpen() )
+			ProcessServerMessage( *pMessage, now );
+
+		queue.EndRead();
+	}
+
+	return GetServerTickAlpha( now );
+}
+
+float CEngine::PlayDemo( const double flFrameTime, const std::chrono::steady_clock::time_point now )
+{
+	m_DemoPlayer.Advance( flFrameTime );
+
+	while( auto pMessage = m_DemoPlayer.ReadMessage() )
+	{
+		ProcessServerMessage( *pMessage, now );
+	}
+
+	if( m_DemoPlayer.IsFinished() )
+	{
+		Msg( "Demo finished\n" );
+		m_DemoPlayer.Close();
+	}
+
+	return GetServerTickAlpha( now );
+}
+
+void CEngine::ProcessServerMessage( CNetworkBuffer& message, const std::chrono::steady_clock::time_point now )
+{
+	const auto type = static_cast<ServerMessage>( message.ReadByte() );
+
+	switch( type )
+	{
+	case ServerMessage::TICK:
+		m_uiServerTick = static_cast<uint32_t>( message.ReadLong() );
+		m_flServerTickInterval = message.ReadFloat();
+		m_ServerTickTime = now;
+		m_bHasServerTick = true;
+		break;
+
+	default:
+		Msg( "Unknown server message %u\n", static_cast<unsigned int>( type ) );
+		break;
+	}
+}
 
-	glMatrixMode( GL_PROJECTION );
-	glLoadIdentity();
+float CEngine::GetServerTickAlpha( const std::chrono::steady_clock::time_point now ) const
+{
+	if( !m_bHasServerTick || m_flServerTickInterval <= 0 )
+		return 0;
+
+	//Ticks are only seen once the frame after they finish starts, so this trails the server by up to a frame.
+	const double flSinceTick = std::chrono::duration<double>( now - m_ServerTickTime ).count();
+
+	return static_cast<float>( std::min( flSinceTick / m_flServerTickInterval, 1.0 ) );
+}
 
-	glOrtho( 0.0f, ( float ) g_Video.GetWidth(), ( float ) g_Video.GetHeight(), 0.0f, 1.0f, -1.0f );
+void CEngine::RenderVGUI1()
+{
+	TRACE_SCOPE( "Engine::RenderVGUI1" );
 
-	glMatrixMode( GL_MODELVIEW );
-	glPushMatrix();
-	glLoadIdentity();
+	auto& list = g_Video.GetCommandList();
 
-	glDisable( GL_CULL_FACE );
-	glDisable( GL_BLEND );
-	glDisable( GL_DEPTH_TEST );
-	glColor4f( 1.0f, 1.0f, 1.0f, 1.0f );
-	glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
+	const unsigned int uiWidth = g_Video.GetWidth();
+	const unsigned int uiHeight = g_Video.GetHeight();
 
 	vgui::App::getInstance()->externalTick();
-	m_pRootPanel->repaintAll();
-	m_pRootPanel->paintTraverse();
 
-	//g_pVGUI1Surface->swapBuffers();
+	//The graph changes every frame.
+	if( m_pFrameGraph->isVisible() )
+		m_pFrameGraph->repaint();
+
+	list.BeginGPUPass( static_cast<int>( CFrameTimer::GPUPass::CLEAR ) );
+	list.ClearScreen();
+	list.EndGPUPass();
+
+	list.BeginGPUPass( static_cast<int>( CFrameTimer::GPUPass::VGUI1 ) );
+
+	if( vgui_cache.value != 0 && g_Video.GetRenderer().IsUICacheSupported() )
+	{
+		if( uiWidth != m_uiUICacheWidth || uiHeight != m_uiUICacheHeight )
+		{
+			g_pVGUI1Surface->InvalidateAll();
+
+			m_uiUICacheWidth = uiWidth;
+			m_uiUICacheHeight = uiHeight;
+		}
+
+		int x0, y0, x1, y1;
+
+		if( g_pVGUI1Surface->TakeDirtyRect( x0, y0, x1, y1 ) )
+		{
+			//VGUI can't paint just the panels that changed, so everything is traversed and only the changed area is kept.
+			list.BeginUICache( uiWidth, uiHeight );
+			list.Begin2D( uiWidth, uiHeight );
+
+			list.SetScissor( x0, y0, x1, y1 );
+			list.ClearScreen();
+
+			g_pVGUI1Surface->SetPainting( true );
+
+			m_pRootPanel->repaintAll();
+			m_pRootPanel->paintTraverse();
+
+			g_pVGUI1Surface->SetPainting( false );
+
+			list.ClearScissor();
+
+			list.End2D();
+			list.EndUICache();
+		}
+
+		list.Begin2D( uiWidth, uiHeight );
+		list.DrawUICache( uiWidth, uiHeight );
+		list.End2D();
+	}
+	else
+	{
+		m_uiUICacheWidth = 0;
+		m_uiUICacheHeight = 0;
+
+		list.Begin2D( uiWidth, uiHeight );
+
+		g_pVGUI1Surface->SetPainting( true );
+
+		m_pRootPanel->repaintAll();
+		m_pRootPanel->paintTraverse();
+
+		g_pVGUI1Surface->SetPainting( false );
+
+		list.End2D();
+	}
 
-	glPopMatrix();
+	list.EndGPUPass();
 }
@@ -1,21 +1,61 @@
 #ifndef ENGINE_CENGINE_H
 #define ENGINE_CENGINE_H
 
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "Clock.h"
+#include "CMetricsRegistry.h"
+#include "CTimerWheel.h"
 #include "Platform.h"
 
+#include "lib/CInterfaceCache.h"
 #include "lib/CLibrary.h"
 
 #include "IMetaTool.h"
 
+#include "CAssetCache.h"
+#include "CAssetLoader.h"
+#include "CDemoPlayer.h"
+#include "CDemoRecorder.h"
+#include "CDownloadManager.h"
+#include "CEntityList.h"
+#include "CFixedTimestep.h"
+#include "CFrameLimiter.h"
+#include "CMetricsServer.h"
+#include "CRconServer.h"
+#include "CServerInstance.h"
+#include "CServerThread.h"
+#include "CSteamCallbackPump.h"
+
+#include "sound/CAudioDevice.h"
+#include "sound/CMixer.h"
+#include "sound/CSoundStreamer.h"
+#include "sound/CVoiceCapture.h"
+#include "sound/CVoiceChat.h"
+
+namespace cvar
+{
+struct ConCommand_t;
+}
+
 namespace vgui
 {
 class Panel;
 }
 
+class CConsoleScrollback;
+class CFileLogSink;
+class CFrameGraphPanel;
+
 class CEngine final : public IMetaTool
 {
 public:
-	CEngine() = default;
+	CEngine();
+	~CEngine();
 
 	/**
 	*	Gets the game directory that the engine mod is in.
@@ -25,6 +65,121 @@ public:
 
 	IMetaLoader* GetLoader() { return m_pLoader; }
 
+	/**
+	*	@return The cache of decoded images. Must only be used on the main thread.
+	*/
+	CAssetCache& GetAssetCache() { return m_AssetCache; }
+
+	/**
+	*	@return Timers run by the frame loop, in microseconds from Plat_GetMicroseconds. Must only be used on the main thread.
+	*/
+	CTimerWheel& GetTimers() { return m_Timers; }
+
+	/**
+	*	@return Interfaces from the factories the engine was started with.
+	*/
+	CInterfaceCache& GetInterfaces() { return m_Interfaces; }
+
+	CSteamCallbackPump& GetSteamCallbacks() { return m_SteamCallbacks; }
+
+	/**
+	*	@return The simulated entities. Only used by the thread that runs ticks.
+	*/
+	CEntityList& GetEntities() { return m_Entities; }
+
+	/**
+	*	Loads a studio model or sprite through the asset cache, so everything that uses it shares one copy.
+	*	@return The model, or null if it couldn't be loaded.
+	*/
+	ModelHandle_t LoadModel( const char* pszFileName );
+
+	/**
+	*	Adds a model to the precache list, loading it if it isn't loaded yet.
+	*	@return Index of the model, used as entities' model index. 0 if it couldn't be loaded.
+	*/
+	int32_t PrecacheModel( const char* pszFileName );
+
+	/**
+	*	@return A precached model, or null if the index doesn't refer to one.
+	*/
+	ModelHandle_t GetModel( const int32_t iIndex ) const
+	{
+		return iIndex > 0 && static_cast<size_t>( iIndex ) < m_Models.size() ? m_Models[ iIndex ] : nullptr;
+	}
+
+	/**
+	*	@return The sound mixer. Voices are started and stopped on the main thread.
+	*/
+	CMixer& GetMixer() { return m_Mixer; }
+
+	/**
+	*	@return The cache of decoded sounds. Must only be used on the main thread.
+	*/
+	CSoundCache& GetSoundCache() { return *m_SoundCache; }
+
+	/**
+	*	@return The streamer that decodes music and other long sounds while they play.
+	*/
+	CSoundStreamer& GetSoundStreamer() { return *m_SoundStreamer; }
+
+	/**
+	*	@return The voice chat pipeline. Must only be used on the main thread, except for its stats.
+	*/
+	CVoiceChat& GetVoiceChat() { return *m_VoiceChat; }
+
+	/**
+	*	@return The device that the local player's voice is recorded from. Not opened with -nosound or -novoice.
+	*/
+	CVoiceCapture& GetVoiceCapture() { return m_VoiceCapture; }
+
+	/**
+	*	@return The listen server's simulation thread. Only running if enabled with -serverthread.
+	*/
+	CServerThread& GetServerThread() { return m_ServerThread; }
+
+	/**
+	*	@return Number of server instances hosted by this process. Only dedicated servers started with -instances host any.
+	*/
+	size_t GetInstanceCount() const { return m_Instances.size(); }
+
+	CServerInstance& GetInstance( const size_t uiIndex ) { return *m_Instances[ uiIndex ]; }
+
+	/**
+	*	@return Records the messages the local client receives from the server thread.
+	*/
+	CDemoRecorder& GetDemoRecorder() { return m_DemoRecorder; }
+
+	/**
+	*	@return Plays a demo in place of the messages from the server thread, while a demo is open.
+	*/
+	CDemoPlayer& GetDemoPlayer() { return m_DemoPlayer; }
+
+	/**
+	*	@return The remote console server. Only running if enabled with -rconport.
+	*/
+	CRconServer& GetRconServer() { return m_RconServer; }
+
+	/**
+	*	@return Metrics that are exported to monitoring. Only served if enabled with -metricsport.
+	*/
+	CMetricsRegistry& GetMetrics() { return m_Metrics; }
+
+	/**
+	*	@return Downloads missing resources into the download overlay. Only running once StartDownloads was called.
+	*/
+	CDownloadManager& GetDownloads() { return m_Downloads; }
+
+	/**
+	*	Starts downloading from a server's content directory, dropping the files that are queued for another.
+	*	@return Whether the URL is valid and downloading started.
+	*/
+	bool StartDownloads( const char* pszBaseURL );
+
+	/**
+	*	@return Number of server thread ticks the local client has heard about.
+	*/
+	uint32_t GetServerTick() const { return m_uiServerTick; }
+
 	void SetMyGameDir( const char* const pszGameDir );
 
 	bool Startup( IMetaLoader& loader, CreateInterfaceFn* pFactories, const size_t uiNumFactories ) override;
@@ -35,26 +190,244 @@ public:
 
 	void RunFrame();
 
+	/**
+	*	@return Whether the main loop should stop.
+	*/
+	bool IsQuitRequested() const;
+
+	/**
+	*	Makes the main loop stop after the current frame.
+	*/
+	void RequestQuit()
+	{
+		m_bQuitRequested = true;
+	}
+
+	/**
+	*	@return The simulation tick scheduler. Not used while the server runs on its own thread.
+	*/
+	const CFixedTimestep& GetTimestep() const { return m_Timestep; }
+
+	/**
+	*	@return Fraction of a tick that the current frame is rendered at, between the last two ticks.
+	*/
+	float GetRenderAlpha() const { return m_flRenderAlpha; }
+
+	/**
+	*	@return Recent log lines, for the console to show. Null before startup.
+	*/
+	CConsoleScrollback* GetConsoleScrollback() { return m_ConsoleScrollback.get(); }
+
 private:
+	/**
+	*	Loads filesystem_stdio and redirects its filesystem to ours. Doesn't touch anything else, so it can run on a worker thread.
+	*/
+	bool PatchFileSystem();
+
 	bool HostInit();
 
+	/**
+	*	Runs the voice pipeline for a frame, and handles the local player's packets.
+	*/
+	void UpdateVoice();
+
+	/**
+	*	Creates the VGUI1 surface and panels. Only used by listen servers.
+	*/
+	void CreateVGUI1();
+
+	/**
+	*	Main loop for dedicated servers. Doesn't use SDL or OpenGL, and sleeps between ticks.
+	*/
+	bool RunDedicated();
+
+	/**
+	*	Starts the number of server instances given with -instances, each on its own thread.
+	*/
+	void StartInstances();
+
+	/**
+	*	Adds the background panel, and queues its images to load. Each image appears once it is loaded.
+	*/
 	void CreateMainMenuBackground();
 
-	void RenderFrame();
+	/**
+	*	Runs one simulation tick.
+	*	@param flTickInterval Length of the tick, in seconds.
+	*/
+	void Tick( const double flTickInterval );
+
+	/**
+	*	Runs a tick on the server thread, and tells the local client about it.
+	*/
+	void ServerTick( const double flTickInterval );
+
+	/**
+	*	Reads the messages the server thread sent to the local client.
+	*	@return Fraction of a tick that the frame should be rendered at, from how long ago the last tick finished.
+	*/
+	float ReadServerMessages( const std::chrono::steady_clock::time_point now );
+
+	/**
+	*	Feeds the messages that are due from the demo being played to the client.
+	*	@param flFrameTime Time since the last frame, in seconds.
+	*	@return Fraction of a tick that the frame should be rendered at.
+	*/
+	float PlayDemo( const double flFrameTime, const std::chrono::steady_clock::time_point now );
+
+	/**
+	*	Handles a message from the server, or from a demo.
+	*/
+	void ProcessServerMessage( CNetworkBuffer& message, const std::chrono::steady_clock::time_point now );
+
+	/**
+	*	@return Fraction of a tick that the frame should be rendered at, from how long ago the last tick was received.
+	*/
+	float GetServerTickAlpha( const std::chrono::steady_clock::time_point now ) const;
+
+	/**
+	*	@param flAlpha Fraction of a tick to interpolate by.
+	*/
+	void RenderFrame( const float flAlpha );
 
 	void RenderVGUI1();
 
+	/**
+	*	Copies the console command profiling counters into the metrics, at most once every COMMAND_METRICS_INTERVAL.
+	*/
+	void PublishCommandMetrics( const std::chrono::steady_clock::time_point now );
+
 private:
 	char m_szMyGameDir[ MAX_PATH ] = {};
 
 	IMetaLoader* m_pLoader = nullptr;
 
+	CInterfaceCache m_Interfaces;
+
 	CLibrary m_steam_api;
 
 	bool m_bSteamAPIInitialized = false;
 
+	CSteamCallbackPump m_SteamCallbacks;
+
 	vgui::Panel* m_pRootPanel = nullptr;
 
+	/**
+	*	Frame time graph, shown with r_framegraph. Owned by the root panel.
+	*/
+	CFrameGraphPanel* m_pFrameGraph = nullptr;
+
+	CAssetCache m_AssetCache;
+
+	CAssetLoader m_AssetLoader{ m_AssetCache };
+
+	/**
+	*	Millisecond resolution, a frame at most 1000 fps is the finest the frame loop can run timers at anyway.
+	*/
+	CTimerWheel m_Timers{ Plat_GetMicroseconds(), 1000 };
+
+	/**
+	*	Precached models, by model index. Index 0 is no model.
+	*/
+	std::vector<ModelHandle_t> m_Models{ nullptr };
+
+	CFixedTimestep m_Timestep;
+
+	CEntityList m_Entities;
+
+	CServerThread m_ServerThread;
+
+	/**
+	*	Server instances hosted by a dedicated server, which share the process' filesystem.
+	*/
+	std::vector<std::unique_ptr<CServerInstance>> m_Instances;
+
+	CMixer m_Mixer;
+
+	/**
+	*	Created once the filesystem is available.
+	*/
+	std::unique_ptr<CSoundCache> m_SoundCache;
+	std::unique_ptr<CSoundStreamer> m_SoundStreamer;
+
+	/**
+	*	Plays the mixer's output. Not opened with -nosound.
+	*/
+	CAudioDevice m_AudioDevice;
+
+	/**
+	*	Encodes and plays voice on the job system. Created with the sound cache.
+	*/
+	std::unique_ptr<CVoiceChat> m_VoiceChat;
+	CVoiceCapture m_VoiceCapture;
+
+	/**
+	*	Last tick the local client heard about from the server thread, and when.
+	*/
+	uint32_t m_uiServerTick = 0;
+	double m_flServerTickInterval = 0;
+	std::chrono::steady_clock::time_point m_ServerTickTime;
+	bool m_bHasServerTick = false;
+
+	CDemoRecorder m_DemoRecorder;
+	CDemoPlayer m_DemoPlayer;
+
+	CRconServer m_RconServer;
+
+	//The server references the registry, so it's declared after it.
+	CMetricsRegistry m_Metrics;
+	CMetricsServer m_MetricsServer;
+
+	struct CommandMetrics_t
+	{
+		CMetricCounter* pCalls = nullptr;
+		CMetricCounter* pTime = nullptr;
+	};
+
+	/**
+	*	Metrics of each command that was called.
+	*/
+	std::unordered_map<const cvar::ConCommand_t*, CommandMetrics_t> m_CommandMetrics;
+	std::chrono::steady_clock::time_point m_CommandMetricsTime;
+
+	/**
+	*	Directory of the overlay that downloads are saved to, relative to the base directory.
+	*/
+	std::string m_szDownloadPath;
+
+	CDownloadManager m_Downloads;
+
+	/**
+	*	Number of ticks the server thread has told the client about. Only used on the server thread.
+	*/
+	uint32_t m_uiServerTicksSent = 0;
+
+	std::chrono::steady_clock::time_point m_LastFrameTime;
+	bool m_bHasLastFrameTime = false;
+
+	/**
+	*	When archived cvars first changed since the config was last written.
+	*/
+	std::chrono::steady_clock::time_point m_ArchiveChangeTime;
+	bool m_bArchiveChanged = false;
+
+	float m_flRenderAlpha = 0;
+
+	/**
+	*	Size of the UI cache that was last drawn to. 0 if the cache isn't in use, so it's fully redrawn once it is.
+	*/
+	unsigned int m_uiUICacheWidth = 0;
+	unsigned int m_uiUICacheHeight = 0;
+
+	bool m_bQuitRequested = false;
+
+	/**
+	*	Writes the log to files, if enabled with -logfile.
+	*/
+	std::unique_ptr<CFileLogSink> m_LogSink;
+
+	std::unique_ptr<CConsoleScrollback> m_ConsoleScrollback;
+
 private:
 	CEngine( const CEngine& ) = delete;
 	CEngine& operator=( const CEngine& ) = delete;
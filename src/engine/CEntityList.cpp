@@ -0,0 +1,504 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#ifdef WIN32
+#include <malloc.h>
+#endif
+
+#include "CJobSystem.h"
+#include "CPUFeatures.h"
+
+#include "CEntityList.h"
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <immintrin.h>
+
+#define ENTITYLIST_SSE2
+#define ENTITYLIST_TARGET_SSE2
+#define ENTITYLIST_TARGET_AVX2
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <immintrin.h>
+
+#define ENTITYLIST_SSE2
+//Only the vector functions are compiled for SSE2 and AVX2, so the rest runs on any CPU.
+#define ENTITYLIST_TARGET_SSE2 __attribute__( ( target( "sse2" ) ) )
+#define ENTITYLIST_TARGET_AVX2 __attribute__( ( target( "avx2" ) ) )
+#endif
+
+namespace
+{
+/**
+*	Adds pVelocity * flInterval to pOrigin, for uiCount values.
+*/
+typedef void ( *IntegrateFunction_t )( float* pOrigin, const float* pVelocity, const size_t uiCount, const float flInterval );
+
+/**
+*	Stores the indices of the entities in [ uiBegin, uiEnd ) that are in front of all planes and don't have NODRAW in pVisible.
+*	Returns the number of indices stored.
+*/
+typedef size_t ( *CullFunction_t )( const CEntityList::Components_t& components, const size_t uiBegin, const size_t uiEnd,
+									 const CullPlane_t* pPlanes, const size_t uiPlaneCount, uint32_t* pVisible );
+
+void IntegrateScalar( float* pOrigin, const float* pVelocity, const size_t uiCount, const float flInterval )
+{
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		pOrigin[ uiIndex ] += pVelocity[ uiIndex ] * flInterval;
+	}
+}
+
+bool IsVisible( const CEntityList::Components_t& components, const size_t uiIndex, const CullPlane_t* pPlanes, const size_t uiPlaneCount )
+{
+	if( components.pFlags[ uiIndex ] & EntityFlag::NODRAW )
+		return false;
+
+	for( size_t uiPlane = 0; uiPlane < uiPlaneCount; ++uiPlane )
+	{
+		const auto& plane = pPlanes[ uiPlane ];
+
+		const float flDistance =
+			plane.normal[ 0 ] * components.pOriginX[ uiIndex ] +
+			plane.normal[ 1 ] * components.pOriginY[ uiIndex ] +
+			plane.normal[ 2 ] * components.pOriginZ[ uiIndex ] - plane.dist;
+
+		if( flDistance + components.pRadius[ uiIndex ] < 0 )
+			return false;
+	}
+
+	return true;
+}
+
+size_t CullScalar( const CEntityList::Components_t& components, const size_t uiBegin, const size_t uiEnd,
+				   const CullPlane_t* pPlanes, const size_t uiPlaneCount, uint32_t* pVisible )
+{
+	size_t uiVisible = 0;
+
+	for( size_t uiIndex = uiBegin; uiIndex < uiEnd; ++uiIndex )
+	{
+		if( IsVisible( components, uiIndex, pPlanes, uiPlaneCount ) )
+			pVisible[ uiVisible++ ] = static_cast<uint32_t>( uiIndex );
+	}
+
+	return uiVisible;
+}
+
+#ifdef ENTITYLIST_SSE2
+/**
+*	Stores the indices of the set bits in a mask of entities starting at uiFirst.
+*/
+size_t StoreVisible( unsigned int uiMask, const size_t uiFirst, uint32_t* pVisible )
+{
+	size_t uiVisible = 0;
+
+	for( size_t uiBit = 0; uiMask; ++uiBit, uiMask >>= 1 )
+	{
+		if( uiMask & 1 )
+			pVisible[ uiVisible++ ] = static_cast<uint32_t>( uiFirst + uiBit );
+	}
+
+	return uiVisible;
+}
+
+ENTITYLIST_TARGET_SSE2 void IntegrateSSE2( float* pOrigin, const float* pVelocity, const size_t uiCount, const float flInterval )
+{
+	const __m128 interval = _mm_set1_ps( flInterval );
+
+	size_t uiIndex = 0;
+
+	//Arrays are aligned, so only the tail is left over.
+	for( ; uiCount - uiIndex >= 4; uiIndex += 4 )
+	{
+		const __m128 origin = _mm_load_ps( pOrigin + uiIndex );
+		const __m128 velocity = _mm_load_ps( pVelocity + uiIndex );
+
+		_mm_store_ps( pOrigin + uiIndex, _mm_add_ps( origin, _mm_mul_ps( velocity, interval ) ) );
+	}
+
+	IntegrateScalar( pOrigin + uiIndex, pVelocity + uiIndex, uiCount - uiIndex, flInterval );
+}
+
+ENTITYLIST_TARGET_AVX2 void IntegrateAVX2( float* pOrigin, const float* pVelocity, const size_t uiCount, const float flInterval )
+{
+	const __m256 interval = _mm256_set1_ps( flInterval );
+
+	size_t uiIndex = 0;
+
+	for( ; uiCount - uiIndex >= 8; uiIndex += 8 )
+	{
+		const __m256 origin = _mm256_load_ps( pOrigin + uiIndex );
+		const __m256 velocity = _mm256_load_ps( pVelocity + uiIndex );
+
+		//No fused multiply-add, so results match the other kernels exactly.
+		_mm256_store_ps( pOrigin + uiIndex, _mm256_add_ps( origin, _mm256_mul_ps( velocity, interval ) ) );
+	}
+
+	_mm256_zeroupper();
+
+	IntegrateSSE2( pOrigin + uiIndex, pVelocity + uiIndex, uiCount - uiIndex, flInterval );
+}
+
+/**
+*	Batches start at multiples of the batch size, so loads from uiBegin are aligned.
+*/
+ENTITYLIST_TARGET_SSE2 size_t CullSSE2( const CEntityList::Components_t& components, const size_t uiBegin, const size_t uiEnd,
+										const CullPlane_t* pPlanes, const size_t uiPlaneCount, uint32_t* pVisible )
+{
+	const __m128i nodraw = _mm_set1_epi32( EntityFlag::NODRAW );
+	const __m128 zero = _mm_setzero_ps();
+
+	size_t uiVisible = 0;
+	size_t uiIndex = uiBegin;
+
+	for( ; uiEnd - uiIndex >= 4; uiIndex += 4 )
+	{
+		const __m128 x = _mm_load_ps( components.pOriginX + uiIndex );
+		const __m128 y = _mm_load_ps( components.pOriginY + uiIndex );
+		const __m128 z = _mm_load_ps( components.pOriginZ + uiIndex );
+		const __m128 radius = _mm_load_ps( components.pRadius + uiIndex );
+
+		const __m128i flags = _mm_load_si128( reinterpret_cast<const __m128i*>( components.pFlags + uiIndex ) );
+
+		__m128 inside = _mm_castsi128_ps( _mm_cmpeq_epi32( _mm_and_si128( flags, nodraw ), _mm_setzero_si128() ) );
+
+		//Same operations in the same order as IsVisible.
+		for( size_t uiPlane = 0; uiPlane < uiPlaneCount; ++uiPlane )
+		{
+			const auto& plane = pPlanes[ uiPlane ];
+
+			__m128 distance = _mm_mul_ps( _mm_set1_ps( plane.normal[ 0 ] ), x );
+			distance = _mm_add_ps( distance, _mm_mul_ps( _mm_set1_ps( plane.normal[ 1 ] ), y ) );
+			distance = _mm_add_ps( distance, _mm_mul_ps( _mm_set1_ps( plane.normal[ 2 ] ), z ) );
+			distance = _mm_sub_ps( distance, _mm_set1_ps( plane.dist ) );
+
+			inside = _mm_and_ps( inside, _mm_cmpge_ps( _mm_add_ps( distance, radius ), zero ) );
+		}
+
+		uiVisible += StoreVisible( static_cast<unsigned int>( _mm_movemask_ps( inside ) ), uiIndex, pVisible + uiVisible );
+	}
+
+	return uiVisible + CullScalar( components, uiIndex, uiEnd, pPlanes, uiPlaneCount, pVisible + uiVisible );
+}
+
+ENTITYLIST_TARGET_AVX2 size_t CullAVX2( const CEntityList::Components_t& components, const size_t uiBegin, const size_t uiEnd,
+										const CullPlane_t* pPlanes, const size_t uiPlaneCount, uint32_t* pVisible )
+{
+	const __m256i nodraw = _mm256_set1_epi32( EntityFlag::NODRAW );
+	const __m256 zero = _mm256_setzero_ps();
+
+	size_t uiVisible = 0;
+	size_t uiIndex = uiBegin;
+
+	for( ; uiEnd - uiIndex >= 8; uiIndex += 8 )
+	{
+		const __m256 x = _mm256_load_ps( components.pOriginX + uiIndex );
+		const __m256 y = _mm256_load_ps( components.pOriginY + uiIndex );
+		const __m256 z = _mm256_load_ps( components.pOriginZ + uiIndex );
+		const __m256 radius = _mm256_load_ps( components.pRadius + uiIndex );
+
+		const __m256i flags = _mm256_load_si256( reinterpret_cast<const __m256i*>( components.pFlags + uiIndex ) );
+
+		__m256 inside = _mm256_castsi256_ps( _mm256_cmpeq_epi32( _mm256_and_si256( flags, nodraw ), _mm256_setzero_si256() ) );
+
+		for( size_t uiPlane = 0; uiPlane < uiPlaneCount; ++uiPlane )
+		{
+			const auto& plane = pPlanes[ uiPlane ];
+
+			__m256 distance = _mm256_mul_ps( _mm256_set1_ps( plane.normal[ 0 ] ), x );
+			distance = _mm256_add_ps( distance, _mm256_mul_ps( _mm256_set1_ps( plane.normal[ 1 ] ), y ) );
+			distance = _mm256_add_ps( distance, _mm256_mul_ps( _mm256_set1_ps( plane.normal[ 2 ] ), z ) );
+			distance = _mm256_sub_ps( distance, _mm256_set1_ps( plane.dist ) );
+
+			inside = _mm256_and_ps( inside, _mm256_cmp_ps( _mm256_add_ps( distance, radius ), zero, _CMP_GE_OQ ) );
+		}
+
+		uiVisible += StoreVisible( static_cast<unsigned int>( _mm256_movemask_ps( inside ) ), uiIndex, pVisible + uiVisible );
+	}
+
+	_mm256_zeroupper();
+
+	return uiVisible + CullSSE2( components, uiIndex, uiEnd, pPlanes, uiPlaneCount, pVisible + uiVisible );
+}
+#endif
+
+IntegrateFunction_t GetIntegrate()
+{
+	static const CPUKernel_t<IntegrateFunction_t> KERNELS[] =
+	{
+#ifdef ENTITYLIST_SSE2
+		{ CPUFeature::AVX2 | CPUFeature::SSE2, &IntegrateAVX2 },
+		{ CPUFeature::SSE2, &IntegrateSSE2 },
+#endif
+		{ CPUFeature::NONE, &IntegrateScalar }
+	};
+
+	static const IntegrateFunction_t pIntegrate = Plat_SelectKernel( KERNELS );
+
+	return pIntegrate;
+}
+
+CullFunction_t GetCull()
+{
+	static const CPUKernel_t<CullFunction_t> KERNELS[] =
+	{
+#ifdef ENTITYLIST_SSE2
+		{ CPUFeature::AVX2 | CPUFeature::SSE2, &CullAVX2 },
+		{ CPUFeature::SSE2, &CullSSE2 },
+#endif
+		{ CPUFeature::NONE, &CullScalar }
+	};
+
+	static const CullFunction_t pCull = Plat_SelectKernel( KERNELS );
+
+	return pCull;
+}
+
+/**
+*	Size of each array, rounded up so the next one stays aligned.
+*/
+size_t GetArraySize( const size_t uiMaxEntities )
+{
+	const size_t uiSize = uiMaxEntities * sizeof( float );
+
+	return ( uiSize + CEntityList::ALIGNMENT - 1 ) & ~( CEntityList::ALIGNMENT - 1 );
+}
+}
+
+const CEntityList::Handle CEntityList::INVALID_HANDLE;
+const size_t CEntityList::DEFAULT_MAX_ENTITIES;
+const size_t CEntityList::MAX_ENTITIES;
+const size_t CEntityList::ALIGNMENT;
+const size_t CEntityList::BATCH_SIZE;
+const size_t CEntityList::GENERATION_SHIFT;
+const CEntityList::Handle CEntityList::SLOT_MASK;
+
+CEntityList::CEntityList( const size_t uiMaxEntities )
+	: m_uiMaxEntities( std::min( uiMaxEntities, MAX_ENTITIES ) )
+{
+	static_assert( sizeof( float ) == sizeof( uint32_t ) && sizeof( float ) == sizeof( int32_t ), "Arrays must have the same element size" );
+	static_assert( BATCH_SIZE % ( ALIGNMENT / sizeof( float ) ) == 0, "Batches must start on aligned elements" );
+
+	//Origin, velocity, radius, flags and model index.
+	const size_t NUM_ARRAYS = 9;
+
+	const size_t uiArraySize = GetArraySize( m_uiMaxEntities );
+
+	//At least one byte, so an empty list still allocates.
+	const size_t uiTotalSize = std::max<size_t>( 1, uiArraySize * NUM_ARRAYS );
+
+#ifdef WIN32
+	m_pMemory = _aligned_malloc( uiTotalSize, ALIGNMENT );
+#else
+	if( posix_memalign( &m_pMemory, ALIGNMENT, uiTotalSize ) != 0 )
+		m_pMemory = nullptr;
+#endif
+
+	if( !m_pMemory )
+		throw std::bad_alloc();
+
+	memset( m_pMemory, 0, uiTotalSize );
+
+	auto pArray = reinterpret_cast<uint8_t*>( m_pMemory );
+
+	auto next = [ & ]()
+	{
+		auto pResult = pArray;
+		pArray += uiArraySize;
+		return pResult;
+	};
+
+	m_Components.pOriginX = reinterpret_cast<float*>( next() );
+	m_Components.pOriginY = reinterpret_cast<float*>( next() );
+	m_Components.pOriginZ = reinterpret_cast<float*>( next() );
+	m_Components.pVelocityX = reinterpret_cast<float*>( next() );
+	m_Components.pVelocityY = reinterpret_cast<float*>( next() );
+	m_Components.pVelocityZ = reinterpret_cast<float*>( next() );
+	m_Components.pRadius = reinterpret_cast<float*>( next() );
+	m_Components.pFlags = reinterpret_cast<uint32_t*>( next() );
+	m_Components.pModelIndex = reinterpret_cast<int32_t*>( next() );
+
+	m_Slots.resize( m_uiMaxEntities, Slot_t{ 0, 1, 0 } );
+	m_IndexToSlot.resize( m_uiMaxEntities );
+	m_FreeSlots.reserve( m_uiMaxEntities );
+
+	Clear();
+}
+
+CEntityList::~CEntityList()
+{
+#ifdef WIN32
+	_aligned_free( m_pMemory );
+#else
+	free( m_pMemory );
+#endif
+}
+
+CEntityList::Handle CEntityList::Create()
+{
+	if( m_FreeSlots.empty() )
+		return INVALID_HANDLE;
+
+	const auto uiSlot = m_FreeSlots.back();
+
+	m_FreeSlots.pop_back();
+
+	auto& slot = m_Slots[ uiSlot ];
+
+	slot.uiGeneration = slot.uiNextGeneration;
+
+	//Generation 0 marks free slots.
+	if( ++slot.uiNextGeneration == 0 )
+		slot.uiNextGeneration = 1;
+
+	const size_t uiIndex = m_uiCount++;
+
+	slot.uiIndex = static_cast<uint16_t>( uiIndex );
+	m_IndexToSlot[ uiIndex ] = uiSlot;
+
+	m_Components.pOriginX[ uiIndex ] = 0;
+	m_Components.pOriginY[ uiIndex ] = 0;
+	m_Components.pOriginZ[ uiIndex ] = 0;
+	m_Components.pVelocityX[ uiIndex ] = 0;
+	m_Components.pVelocityY[ uiIndex ] = 0;
+	m_Components.pVelocityZ[ uiIndex ] = 0;
+	m_Components.pRadius[ uiIndex ] = 0;
+	m_Components.pFlags[ uiIndex ] = EntityFlag::NONE;
+	m_Components.pModelIndex[ uiIndex ] = 0;
+
+	return MakeHandle( uiSlot, slot.uiGeneration );
+}
+
+bool CEntityList::Destroy( const Handle hEntity )
+{
+	if( !IsValid( hEntity ) )
+		return false;
+
+	const auto uiSlot = static_cast<uint16_t>( hEntity & SLOT_MASK );
+
+	auto& slot = m_Slots[ uiSlot ];
+
+	const size_t uiIndex = slot.uiIndex;
+	const size_t uiLast = --m_uiCount;
+
+	//Keep the arrays dense by moving the last entity into the hole.
+	if( uiIndex != uiLast )
+	{
+		m_Components.pOriginX[ uiIndex ] = m_Components.pOriginX[ uiLast ];
+		m_Components.pOriginY[ uiIndex ] = m_Components.pOriginY[ uiLast ];
+		m_Components.pOriginZ[ uiIndex ] = m_Components.pOriginZ[ uiLast ];
+		m_Components.pVelocityX[ uiIndex ] = m_Components.pVelocityX[ uiLast ];
+		m_Components.pVelocityY[ uiIndex ] = m_Components.pVelocityY[ uiLast ];
+		m_Components.pVelocityZ[ uiIndex ] = m_Components.pVelocityZ[ uiLast ];
+		m_Components.pRadius[ uiIndex ] = m_Components.pRadius[ uiLast ];
+		m_Components.pFlags[ uiIndex ] = m_Components.pFlags[ uiLast ];
+		m_Components.pModelIndex[ uiIndex ] = m_Components.pModelIndex[ uiLast ];
+
+		const auto uiMovedSlot = m_IndexToSlot[ uiLast ];
+
+		m_Slots[ uiMovedSlot ].uiIndex = static_cast<uint16_t>( uiIndex );
+		m_IndexToSlot[ uiIndex ] = uiMovedSlot;
+	}
+
+	slot.uiGeneration = 0;
+
+	m_FreeSlots.push_back( uiSlot );
+
+	return true;
+}
+
+void CEntityList::Clear()
+{
+	m_uiCount = 0;
+
+	for( auto& slot : m_Slots )
+	{
+		slot.uiGeneration = 0;
+	}
+
+	m_FreeSlots.clear();
+
+	//Lowest slots are used first.
+	for( size_t uiSlot = m_uiMaxEntities; uiSlot-- > 0; )
+	{
+		m_FreeSlots.push_back( static_cast<uint16_t>( uiSlot ) );
+	}
+}
+
+template<typename FUNC>
+void CEntityList::ForEachBatch( CJobSystem* pJobSystem, const FUNC& func ) const
+{
+	const size_t uiBatches = ( m_uiCount + BATCH_SIZE - 1 ) / BATCH_SIZE;
+
+	if( uiBatches <= 1 || !pJobSystem || pJobSystem->GetWorkerCount() == 0 )
+	{
+		for( size_t uiBatch = 0; uiBatch < uiBatches; ++uiBatch )
+		{
+			func( uiBatch, uiBatch * BATCH_SIZE, std::min( m_uiCount, ( uiBatch + 1 ) * BATCH_SIZE ) );
+		}
+
+		return;
+	}
+
+	CJobSystem::CCounter counter;
+
+	//The calling thread does the first batch itself.
+	for( size_t uiBatch = 1; uiBatch < uiBatches; ++uiBatch )
+	{
+		pJobSystem->Submit( [ &func, uiBatch, this ]()
+			{
+				func( uiBatch, uiBatch * BATCH_SIZE, std::min( m_uiCount, ( uiBatch + 1 ) * BATCH_SIZE ) );
+			}, &counter );
+	}
+
+	func( 0, 0, std::min( m_uiCount, BATCH_SIZE ) );
+
+	pJobSystem->Wait( counter );
+}
+
+void CEntityList::Integrate( const float flInterval, CJobSystem* pJobSystem )
+{
+	const auto pIntegrate = GetIntegrate();
+
+	const auto& components = m_Components;
+
+	ForEachBatch( pJobSystem, [ & ]( size_t, const size_t uiBegin, const size_t uiEnd )
+		{
+			const size_t uiCount = uiEnd - uiBegin;
+
+			pIntegrate( components.pOriginX + uiBegin, components.pVelocityX + uiBegin, uiCount, flInterval );
+			pIntegrate( components.pOriginY + uiBegin, components.pVelocityY + uiBegin, uiCount, flInterval );
+			pIntegrate( components.pOriginZ + uiBegin, components.pVelocityZ + uiBegin, uiCount, flInterval );
+		} );
+}
+
+void CEntityList::Cull( const CullPlane_t* pPlanes, const size_t uiPlaneCount, std::vector<uint32_t>& visible, CJobSystem* pJobSystem ) const
+{
+	assert( pPlanes || uiPlaneCount == 0 );
+
+	const auto pCull = GetCull();
+
+	//Each batch stores its results where its entities start, then they're moved together.
+	visible.resize( m_uiCount );
+
+	m_BatchCounts.resize( ( m_uiCount + BATCH_SIZE - 1 ) / BATCH_SIZE );
+
+	ForEachBatch( pJobSystem, [ & ]( const size_t uiBatch, const size_t uiBegin, const size_t uiEnd )
+		{
+			m_BatchCounts[ uiBatch ] = pCull( m_Components, uiBegin, uiEnd, pPlanes, uiPlaneCount, visible.data() + uiBegin );
+		} );
+
+	size_t uiVisible = 0;
+
+	for( size_t uiBatch = 0; uiBatch < m_BatchCounts.size(); ++uiBatch )
+	{
+		const size_t uiBegin = uiBatch * BATCH_SIZE;
+
+		if( uiVisible != uiBegin )
+			memmove( visible.data() + uiVisible, visible.data() + uiBegin, m_BatchCounts[ uiBatch ] * sizeof( uint32_t ) );
+
+		uiVisible += m_BatchCounts[ uiBatch ];
+	}
+
+	visible.resize( uiVisible );
+}
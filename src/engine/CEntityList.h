@@ -0,0 +1,230 @@
+#ifndef ENGINE_CENTITYLIST_H
+#define ENGINE_CENTITYLIST_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CJobSystem;
+
+namespace EntityFlag
+{
+enum EntityFlag : uint32_t
+{
+	NONE	= 0,
+
+	/**
+	*	Never visible. Skipped by culling.
+	*/
+	NODRAW	= 1 << 0,
+};
+}
+
+/**
+*	Plane that culled entities must be in front of: dot( normal, origin ) - dist >= -radius.
+*/
+struct CullPlane_t
+{
+	float normal[ 3 ];
+	float dist;
+};
+
+/**
+*	The server's entities, stored as a structure of arrays: each component is a separate array, so code that updates one component
+*	only touches that component's memory, and can update several entities at once with vector instructions.
+*	Arrays are dense: entity 0 to GetCount() - 1 are in use, and destroying an entity moves the last one into its place.
+*	Entities are referred to by handles, which stay valid until the entity is destroyed. Handles contain a generation,
+*	so a handle to a destroyed entity is never mistaken for a newer entity in the same slot.
+*	Storage is allocated once, for the maximum number of entities. Not thread safe, except that the updates split their work between jobs.
+*/
+class CEntityList final
+{
+public:
+	using Handle = uint32_t;
+
+	/**
+	*	Handle that never refers to an entity.
+	*/
+	static const Handle INVALID_HANDLE = 0;
+
+	static const size_t DEFAULT_MAX_ENTITIES = 4096;
+
+	/**
+	*	Handles have 16 bits of slot and 16 bits of generation.
+	*/
+	static const size_t MAX_ENTITIES = 0xFFFF;
+
+	/**
+	*	Alignment of each array, enough for any vector instructions and to start each array on its own cache line.
+	*/
+	static const size_t ALIGNMENT = 64;
+
+	/**
+	*	Number of entities each job updates.
+	*/
+	static const size_t BATCH_SIZE = 1024;
+
+	/**
+	*	The component arrays, indexed by entity index.
+	*/
+	struct Components_t
+	{
+		float* pOriginX;
+		float* pOriginY;
+		float* pOriginZ;
+
+		float* pVelocityX;
+		float* pVelocityY;
+		float* pVelocityZ;
+
+		/**
+		*	Radius of a sphere around the origin that contains the entity.
+		*/
+		float* pRadius;
+
+		/**
+		*	EntityFlag values. Bits that aren't used by the engine are free for game code.
+		*/
+		uint32_t* pFlags;
+
+		int32_t* pModelIndex;
+	};
+
+public:
+	/**
+	*	@param uiMaxEntities Most entities that can exist at once. At most MAX_ENTITIES.
+	*/
+	CEntityList( const size_t uiMaxEntities = DEFAULT_MAX_ENTITIES );
+	~CEntityList();
+
+	size_t GetMaxEntities() const { return m_uiMaxEntities; }
+
+	size_t GetCount() const { return m_uiCount; }
+
+	/**
+	*	Creates an entity with all components zeroed.
+	*	@return Handle to the entity, or INVALID_HANDLE if there are too many entities.
+	*/
+	Handle Create();
+
+	/**
+	*	Destroys an entity. The last entity takes its index.
+	*	@return Whether the handle referred to an entity.
+	*/
+	bool Destroy( const Handle hEntity );
+
+	/**
+	*	Destroys all entities. Existing handles become invalid.
+	*/
+	void Clear();
+
+	bool IsValid( const Handle hEntity ) const
+	{
+		const size_t uiSlot = hEntity & SLOT_MASK;
+		const auto uiGeneration = hEntity >> GENERATION_SHIFT;
+
+		//Free slots have generation 0, which no handle has.
+		return uiGeneration != 0 && uiSlot < m_uiMaxEntities && m_Slots[ uiSlot ].uiGeneration == uiGeneration;
+	}
+
+	/**
+	*	@return Index of an entity in the component arrays. Changes when entities are destroyed.
+	*/
+	size_t GetIndex( const Handle hEntity ) const
+	{
+		assert( IsValid( hEntity ) );
+
+		return m_Slots[ hEntity & SLOT_MASK ].uiIndex;
+	}
+
+	/**
+	*	@return Handle of the entity at an index.
+	*/
+	Handle GetHandle( const size_t uiIndex ) const
+	{
+		assert( uiIndex < m_uiCount );
+
+		const auto uiSlot = m_IndexToSlot[ uiIndex ];
+
+		return MakeHandle( uiSlot, m_Slots[ uiSlot ].uiGeneration );
+	}
+
+	const Components_t& GetComponents() const { return m_Components; }
+
+	/**
+	*	Moves each entity by its velocity.
+	*	@param pJobSystem If not null, entities are split between jobs on it.
+	*/
+	void Integrate( const float flInterval, CJobSystem* pJobSystem = nullptr );
+
+	/**
+	*	Finds the entities that are in front of all planes, in index order.
+	*	@param visible Indices of the visible entities.
+	*	@param pJobSystem If not null, entities are split between jobs on it.
+	*/
+	void Cull( const CullPlane_t* pPlanes, const size_t uiPlaneCount, std::vector<uint32_t>& visible, CJobSystem* pJobSystem = nullptr ) const;
+
+private:
+	static const size_t GENERATION_SHIFT = 16;
+	static const Handle SLOT_MASK = ( 1 << GENERATION_SHIFT ) - 1;
+
+	struct Slot_t
+	{
+		/**
+		*	Generation of the entity in the slot, or 0 if the slot is free.
+		*/
+		uint16_t uiGeneration;
+
+		/**
+		*	Generation to use for the next entity in the slot.
+		*/
+		uint16_t uiNextGeneration;
+
+		uint16_t uiIndex;
+	};
+
+	static Handle MakeHandle( const size_t uiSlot, const uint16_t uiGeneration )
+	{
+		return static_cast<Handle>( uiSlot ) | ( static_cast<Handle>( uiGeneration ) << GENERATION_SHIFT );
+	}
+
+	/**
+	*	Calls func( uiBatch, uiBegin, uiEnd ) for each batch of entities, on jobs if a job system with workers is given.
+	*	Returns once all batches are done.
+	*/
+	template<typename FUNC>
+	void ForEachBatch( CJobSystem* pJobSystem, const FUNC& func ) const;
+
+private:
+	const size_t m_uiMaxEntities;
+
+	size_t m_uiCount = 0;
+
+	/**
+	*	One allocation for all arrays.
+	*/
+	void* m_pMemory = nullptr;
+
+	Components_t m_Components{};
+
+	std::vector<Slot_t> m_Slots;
+
+	std::vector<uint16_t> m_IndexToSlot;
+
+	/**
+	*	Slots that aren't in use. Taken from the back.
+	*/
+	std::vector<uint16_t> m_FreeSlots;
+
+	/**
+	*	Number of visible entities each batch found, while culling.
+	*/
+	mutable std::vector<size_t> m_BatchCounts;
+
+private:
+	CEntityList( const CEntityList& ) = delete;
+	CEntityList& operator=( const CEntityList& ) = delete;
+};
+
+#endif //ENGINE_CENTITYLIST_H
@@ -0,0 +1,68 @@
+#include <algorithm>
+#include <cassert>
+
+#include "Logging.h"
+
+#include "CEventPump.h"
+
+const size_t CEventPump::BATCH_SIZE;
+const CEventPump::HandlerID_t CEventPump::INVALID_HANDLER_ID;
+
+CEventPump::HandlerID_t CEventPump::AddHandler( const Uint32 uiFirstType, const Uint32 uiLastType, HandlerFn handler )
+{
+	assert( handler );
+	assert( uiFirstType <= uiLastType );
+
+	const auto id = m_NextID++;
+
+	m_Handlers.push_back( { id, uiFirstType, uiLastType, std::move( handler ) } );
+
+	return id;
+}
+
+void CEventPump::RemoveHandler( const HandlerID_t id )
+{
+	auto it = std::find_if( m_Handlers.begin(), m_Handlers.end(), [ id ]( const Handler_t& handler ) { return handler.id == id; } );
+
+	if( it != m_Handlers.end() )
+		m_Handlers.erase( it );
+}
+
+size_t CEventPump::Pump()
+{
+	SDL_PumpEvents();
+
+	size_t uiTotal = 0;
+
+	while( true )
+	{
+		const int iCount = SDL_PeepEvents( m_Events, BATCH_SIZE, SDL_GETEVENT, SDL_FIRSTEVENT, SDL_LASTEVENT );
+
+		if( iCount < 0 )
+		{
+			Msg( "Couldn't read events: %s\n", SDL_GetError() );
+			break;
+		}
+
+		for( int iEvent = 0; iEvent < iCount; ++iEvent )
+		{
+			const auto& event = m_Events[ iEvent ];
+
+			for( const auto& handler : m_Handlers )
+			{
+				if( event.type >= handler.uiFirstType && event.type <= handler.uiLastType )
+					handler.handler( event );
+			}
+		}
+
+		uiTotal += static_cast<size_t>( iCount );
+
+		//A partial batch means the queue is empty.
+		if( static_cast<size_t>( iCount ) < BATCH_SIZE )
+			break;
+	}
+
+	m_uiEventCount += uiTotal;
+
+	return uiTotal;
+}
@@ -0,0 +1,88 @@
+#ifndef ENGINE_CEVENTPUMP_H
+#define ENGINE_CEVENTPUMP_H
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include <SDL2/SDL.h>
+
+/**
+*	Reads SDL events in batches and dispatches them to registered handlers.
+*	Events keep their SDL timestamps, so handlers can tell when input happened rather than when it was processed.
+*/
+class CEventPump final
+{
+public:
+	/**
+	*	Number of events read from SDL at once.
+	*/
+	static const size_t BATCH_SIZE = 64;
+
+	using HandlerFn = std::function<void( const SDL_Event& event )>;
+
+	/**
+	*	Identifies a handler so it can be removed.
+	*/
+	using HandlerID_t = size_t;
+
+	static const HandlerID_t INVALID_HANDLER_ID = 0;
+
+public:
+	CEventPump() = default;
+
+	/**
+	*	Adds a handler for a range of event types.
+	*	@param uiFirstType First event type to handle.
+	*	@param uiLastType Last event type to handle, inclusive.
+	*	@param handler Handler to call.
+	*	@return Handler ID.
+	*	Handlers must not be added or removed by handlers.
+	*/
+	HandlerID_t AddHandler( const Uint32 uiFirstType, const Uint32 uiLastType, HandlerFn handler );
+
+	/**
+	*	Adds a handler for a single event type.
+	*/
+	HandlerID_t AddHandler( const Uint32 uiType, HandlerFn handler )
+	{
+		return AddHandler( uiType, uiType, std::move( handler ) );
+	}
+
+	void RemoveHandler( const HandlerID_t id );
+
+	/**
+	*	Reads all pending events and dispatches them.
+	*	@return Number of events that were read.
+	*/
+	size_t Pump();
+
+	/**
+	*	@return Total number of events read.
+	*/
+	size_t GetEventCount() const { return m_uiEventCount; }
+
+private:
+	struct Handler_t
+	{
+		HandlerID_t id;
+		Uint32 uiFirstType;
+		Uint32 uiLastType;
+		HandlerFn handler;
+	};
+
+private:
+	SDL_Event m_Events[ BATCH_SIZE ];
+
+	std::vector<Handler_t> m_Handlers;
+
+	HandlerID_t m_NextID = INVALID_HANDLER_ID + 1;
+
+	size_t m_uiEventCount = 0;
+
+private:
+	CEventPump( const CEventPump& ) = delete;
+	CEventPump& operator=( const CEventPump& ) = delete;
+};
+
+#endif //ENGINE_CEVENTPUMP_H
@@ -0,0 +1,186 @@
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "CFileLogSink.h"
+
+const size_t CFileLogSink::BUFFER_SIZE;
+const uint64_t CFileLogSink::DEFAULT_MAX_FILE_SIZE;
+const unsigned int CFileLogSink::DEFAULT_MAX_FILES;
+const unsigned int CFileLogSink::DEFAULT_FLUSH_INTERVAL_MS;
+const unsigned int CFileLogSink::MAX_INDEX;
+
+CFileLogSink::CFileLogSink( IFileSystem2& fileSystem, const char* pszBaseName, const char* pszPathID,
+							const uint64_t uiMaxFileSize, const unsigned int uiMaxFiles, const unsigned int uiFlushIntervalMS )
+	: m_FileSystem( fileSystem )
+	, m_szBaseName( pszBaseName )
+	, m_szPathID( pszPathID ? pszPathID : "" )
+	, m_uiMaxFileSize( uiMaxFileSize )
+	, m_uiMaxFiles( uiMaxFiles > 0 ? uiMaxFiles : 1 )
+	, m_FlushInterval( uiFlushIntervalMS )
+{
+	assert( pszBaseName );
+
+	m_Buffer.reserve( BUFFER_SIZE * 2 );
+}
+
+CFileLogSink::~CFileLogSink()
+{
+	Flush();
+	CloseFile();
+}
+
+void CFileLogSink::Write( const char* pszText, const size_t uiLength )
+{
+	if( m_bFailed || uiLength == 0 )
+		return;
+
+	if( m_Buffer.empty() )
+		m_BufferedSince = std::chrono::steady_clock::now();
+
+	m_Buffer.insert( m_Buffer.end(), pszText, pszText + uiLength );
+
+	if( m_Buffer.size() >= BUFFER_SIZE )
+		WriteBuffer();
+}
+
+void CFileLogSink::Update()
+{
+	if( m_Buffer.empty() )
+		return;
+
+	if( std::chrono::steady_clock::now() - m_BufferedSince >= m_FlushInterval )
+		Flush();
+}
+
+void CFileLogSink::Flush()
+{
+	WriteBuffer();
+
+	if( m_hFile != FILESYSTEM_INVALID_HANDLE )
+		m_FileSystem.Flush( m_hFile );
+}
+
+void CFileLogSink::WriteBuffer()
+{
+	if( m_Buffer.empty() )
+		return;
+
+	if( m_hFile == FILESYSTEM_INVALID_HANDLE || ( m_uiFileSize > 0 && m_uiFileSize + m_Buffer.size() > m_uiMaxFileSize ) )
+	{
+		if( !OpenNextFile() )
+		{
+			m_Buffer.clear();
+			return;
+		}
+	}
+
+	const int iWritten = m_FileSystem.Write( m_Buffer.data(), static_cast<int>( m_Buffer.size() ), m_hFile );
+
+	if( iWritten > 0 )
+		m_uiFileSize += static_cast<uint64_t>( iWritten );
+
+	m_Buffer.clear();
+}
+
+bool CFileLogSink::OpenNextFile()
+{
+	CloseFile();
+
+	if( m_bFailed )
+		return false;
+
+	const char* pszPathID = !m_szPathID.empty() ? m_szPathID.c_str() : nullptr;
+
+	const auto uiSlash = m_szBaseName.find_last_of( "/\\" );
+
+	if( !m_bFoundIndex )
+	{
+		m_bFoundIndex = true;
+
+		if( uiSlash != std::string::npos )
+			m_FileSystem.CreateDirHierarchy( m_szBaseName.substr( 0, uiSlash ).c_str(), pszPathID );
+
+		//Continue after the newest existing file, so earlier logs are kept.
+		const std::string szPrefix = m_szBaseName.substr( uiSlash != std::string::npos ? uiSlash + 1 : 0 ) + '_';
+		const std::string szWildcard = m_szBaseName + "_*.log";
+
+		FileFindHandle_t hFind = FILESYSTEM_INVALID_FIND_HANDLE;
+
+		for( auto pszName = m_FileSystem.FindFirst( szWildcard.c_str(), &hFind, pszPathID ); pszName; pszName = m_FileSystem.FindNext( hFind ) )
+		{
+			if( strncmp( pszName, szPrefix.c_str(), szPrefix.length() ) )
+				continue;
+
+			char* pszEnd;
+
+			const unsigned long uiIndex = strtoul( pszName + szPrefix.length(), &pszEnd, 10 );
+
+			if( pszEnd != pszName + szPrefix.length() && uiIndex < MAX_INDEX && uiIndex >= m_uiIndex )
+				m_uiIndex = static_cast<unsigned int>( uiIndex + 1 );
+		}
+
+		if( hFind != FILESYSTEM_INVALID_FIND_HANDLE )
+			m_FileSystem.FindClose( hFind );
+	}
+
+	RemoveOldFiles( m_uiIndex, m_uiMaxFiles - 1 );
+
+	FormatFileName( m_uiIndex, m_szFileName );
+
+	m_hFile = m_FileSystem.Open( m_szFileName.c_str(), "wb", pszPathID );
+
+	if( m_hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		//Can't log this, it would come back here.
+		fprintf( stderr, "CFileLogSink: Couldn't open log file \"%s\", file logging disabled\n", m_szFileName.c_str() );
+
+		m_szFileName.clear();
+		m_bFailed = true;
+		return false;
+	}
+
+	//Wrap around to the start once the index runs out, the files at the start will have been removed by now.
+	m_uiIndex = ( m_uiIndex + 1 ) % ( MAX_INDEX + 1 );
+
+	m_uiFileSize = 0;
+
+	return true;
+}
+
+void CFileLogSink::CloseFile()
+{
+	if( m_hFile == FILESYSTEM_INVALID_HANDLE )
+		return;
+
+	m_FileSystem.Close( m_hFile );
+	m_hFile = FILESYSTEM_INVALID_HANDLE;
+}
+
+void CFileLogSink::RemoveOldFiles( const unsigned int uiIndex, const unsigned int uiKeep )
+{
+	const char* pszPathID = !m_szPathID.empty() ? m_szPathID.c_str() : nullptr;
+
+	std::string szFileName;
+
+	//Files older than the kept ones were removed in earlier rotations, so stop at the first gap.
+	for( unsigned int uiOld = uiIndex > uiKeep ? uiIndex - uiKeep : 0; uiOld-- > 0; )
+	{
+		FormatFileName( uiOld, szFileName );
+
+		if( !m_FileSystem.FileExists( szFileName.c_str() ) )
+			break;
+
+		m_FileSystem.RemoveFile( szFileName.c_str(), pszPathID );
+	}
+}
+
+void CFileLogSink::FormatFileName( const unsigned int uiIndex, std::string& szFileName ) const
+{
+	char szIndex[ 32 ];
+
+	snprintf( szIndex, sizeof( szIndex ), "_%05u.log", uiIndex );
+
+	szFileName = m_szBaseName + szIndex;
+}
@@ -0,0 +1,128 @@
+#ifndef ENGINE_CFILELOGSINK_H
+#define ENGINE_CFILELOGSINK_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "FileSystem2.h"
+
+#include "ILogSink.h"
+
+/**
+*	Appends log text to files through the filesystem.
+*	Text is collected in a large buffer, and written out when the buffer is full, or when it has been held for too long.
+*	Files are named <base>_<index>.log. Once a file reaches its maximum size, the next index is opened, and the oldest files are removed.
+*	Meant to be added to the logger with Log_AddSink, so all writes happen on the logging thread.
+*/
+class CFileLogSink final : public ILogSink
+{
+public:
+	/**
+	*	Text is written to the file once this much is buffered.
+	*/
+	static const size_t BUFFER_SIZE = 256 * 1024;
+
+	static const uint64_t DEFAULT_MAX_FILE_SIZE = 16 * 1024 * 1024;
+
+	static const unsigned int DEFAULT_MAX_FILES = 8;
+
+	/**
+	*	Buffered text is written out after this long, in milliseconds.
+	*/
+	static const unsigned int DEFAULT_FLUSH_INTERVAL_MS = 5000;
+
+	/**
+	*	Highest log file index that is looked for.
+	*/
+	static const unsigned int MAX_INDEX = 99999;
+
+public:
+	/**
+	*	@param fileSystem Filesystem to write through.
+	*	@param pszBaseName Path and name of the log files, without index or extension. Directories are created as needed.
+	*	@param pszPathID Path ID to write to.
+	*	@param uiMaxFileSize Files are rotated once they reach this size.
+	*	@param uiMaxFiles Number of files to keep, including the current one.
+	*	@param uiFlushIntervalMS How long text can be buffered for, in milliseconds.
+	*/
+	CFileLogSink( IFileSystem2& fileSystem, const char* pszBaseName, const char* pszPathID = nullptr,
+				  const uint64_t uiMaxFileSize = DEFAULT_MAX_FILE_SIZE, const unsigned int uiMaxFiles = DEFAULT_MAX_FILES,
+				  const unsigned int uiFlushIntervalMS = DEFAULT_FLUSH_INTERVAL_MS );
+	~CFileLogSink();
+
+	void Write( const char* pszText, const size_t uiLength ) override;
+
+	void Update() override;
+
+	void Flush() override;
+
+	/**
+	*	@return Name of the file being written, or an empty string if none is open.
+	*/
+	const std::string& GetFileName() const { return m_szFileName; }
+
+private:
+	/**
+	*	Writes out the buffer, rotating files as needed.
+	*/
+	void WriteBuffer();
+
+	/**
+	*	Closes the current file and opens the next one.
+	*	@return Whether a file is open.
+	*/
+	bool OpenNextFile();
+
+	void CloseFile();
+
+	/**
+	*	Removes old files so that at most uiKeep files with indices below uiIndex remain.
+	*/
+	void RemoveOldFiles( const unsigned int uiIndex, const unsigned int uiKeep );
+
+	void FormatFileName( const unsigned int uiIndex, std::string& szFileName ) const;
+
+private:
+	IFileSystem2& m_FileSystem;
+
+	const std::string m_szBaseName;
+	const std::string m_szPathID;
+
+	const uint64_t m_uiMaxFileSize;
+	const unsigned int m_uiMaxFiles;
+	const std::chrono::milliseconds m_FlushInterval;
+
+	std::vector<char> m_Buffer;
+
+	/**
+	*	When the oldest text in the buffer was added.
+	*/
+	std::chrono::steady_clock::time_point m_BufferedSince;
+
+	FileHandle_t m_hFile = FILESYSTEM_INVALID_HANDLE;
+
+	std::string m_szFileName;
+
+	uint64_t m_uiFileSize = 0;
+
+	/**
+	*	Index of the current file, or the next one to open.
+	*/
+	unsigned int m_uiIndex = 0;
+
+	bool m_bFoundIndex = false;
+
+	/**
+	*	Set if a file couldn't be opened. Text is discarded after that.
+	*/
+	bool m_bFailed = false;
+
+private:
+	CFileLogSink( const CFileLogSink& ) = delete;
+	CFileLogSink& operator=( const CFileLogSink& ) = delete;
+};
+
+#endif //ENGINE_CFILELOGSINK_H
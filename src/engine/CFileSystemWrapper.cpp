@@ -5,6 +5,16 @@
 
 #include "CFileSystemWrapper.h"
 
+namespace
+{
+FileSystemFastPath_t g_FastPath;
+}
+
+void CFileSystemWrapper::BindFastPath( IFileSystem2& fileSystem )
+{
+	fileSystem.GetFastPath( g_FastPath );
+}
+
 void CFileSystemWrapper::Mount()
 {
 	g_pFileSystem->Mount();
@@ -42,7 +52,7 @@ void CFileSystemWrapper::CreateDirHierarchy( const char *path, const char *pathI
 
 bool CFileSystemWrapper::FileExists( const char *pFileName )
 {
-	return g_pFileSystem->FileExists( pFileName );
+	return g_FastPath.pfnFileExists( g_FastPath.pContext, pFileName );
 }
 
 bool CFileSystemWrapper::IsDirectory( const char *pFileName )
@@ -52,22 +62,22 @@ bool CFileSystemWrapper::IsDirectory( const char *pFileName )
 
 FileHandle_t CFileSystemWrapper::Open( const char *pFileName, const char *pOptions, const char *pathID )
 {
-	return g_pFileSystem->Open( pFileName, pOptions, pathID );
+	return g_FastPath.pfnOpen( g_FastPath.pContext, pFileName, pOptions, pathID );
 }
 
 void CFileSystemWrapper::Close( FileHandle_t file )
 {
-	g_pFileSystem->Close( file );
+	g_FastPath.pfnClose( g_FastPath.pContext, file );
 }
 
 void CFileSystemWrapper::Seek( FileHandle_t file, int pos, FileSystemSeek_t seekType )
 {
-	g_pFileSystem->Seek( file, pos, seekType );
+	g_FastPath.pfnSeek( g_FastPath.pContext, file, pos, seekType );
 }
 
 unsigned int CFileSystemWrapper::Tell( FileHandle_t file )
 {
-	return g_pFileSystem->Tell( file );
+	return g_FastPath.pfnTell( g_FastPath.pContext, file );
 }
 
 unsigned int CFileSystemWrapper::Size( FileHandle_t file )
@@ -107,7 +117,7 @@ bool CFileSystemWrapper::EndOfFile( FileHandle_t file )
 
 int CFileSystemWrapper::Read( void* pOutput, int size, FileHandle_t file )
 {
-	return g_pFileSystem->Read( pOutput, size, file );
+	return g_FastPath.pfnRead( g_FastPath.pContext, pOutput, size, file );
 }
 
 int CFileSystemWrapper::Write( void const* pInput, int size, FileHandle_t file )
@@ -3,13 +3,21 @@
 
 #include "FileSystem.h"
 
+class IFileSystem2;
+
 /**
 *	Wrapper around g_pFileSystem. Specifically designed to have a vtable that matches that of the engine's filesystem so that it can be overwritten with this one.
 *	This allows us to redirect filesystem calls to us without needing to replace the library.
+*	The hottest calls (Open, Close, Read, Seek, Tell, FileExists) go through the filesystem's fast path instead of its interface.
 */
 class CFileSystemWrapper : public IFileSystem
 {
 public:
+	/**
+	*	Binds the fast path to the given filesystem. Must be called before the wrapper's vtable is installed.
+	*/
+	static void BindFastPath( IFileSystem2& fileSystem );
+
 	void			Mount() override;
 
 	void			Unmount() override;
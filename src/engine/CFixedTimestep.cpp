@@ -0,0 +1,56 @@
+#include "CFixedTimestep.h"
+
+const float CFixedTimestep::DEFAULT_TICK_RATE = 100;
+const float CFixedTimestep::MIN_TICK_RATE = 10;
+const float CFixedTimestep::MAX_TICK_RATE = 1000;
+const unsigned int CFixedTimestep::MAX_TICKS_PER_FRAME;
+
+void CFixedTimestep::SetTickRate( float flTickRate )
+{
+	if( flTickRate < MIN_TICK_RATE )
+		flTickRate = MIN_TICK_RATE;
+	else if( flTickRate > MAX_TICK_RATE )
+		flTickRate = MAX_TICK_RATE;
+
+	if( flTickRate == m_flTickRate )
+		return;
+
+	//Keep the same fraction of a tick, so interpolation doesn't jump.
+	const double flAlpha = m_flAccumulator / m_flTickInterval;
+
+	m_flTickRate = flTickRate;
+	m_flTickInterval = 1.0 / flTickRate;
+
+	m_flAccumulator = flAlpha * m_flTickInterval;
+}
+
+unsigned int CFixedTimestep::Advance( double flFrameTime )
+{
+	if( flFrameTime < 0 )
+		flFrameTime = 0;
+
+	m_flAccumulator += flFrameTime;
+
+	unsigned int uiTicks = 0;
+
+	while( m_flAccumulator >= m_flTickInterval )
+	{
+		if( uiTicks == MAX_TICKS_PER_FRAME )
+		{
+			//Drop whole ticks, keep the fraction so interpolation stays smooth.
+			const double flExcess = m_flAccumulator - m_flTickInterval * static_cast<uint64_t>( m_flAccumulator / m_flTickInterval );
+
+			m_flDroppedTime += m_flAccumulator - flExcess;
+			m_flAccumulator = flExcess;
+			break;
+		}
+
+		m_flAccumulator -= m_flTickInterval;
+		++uiTicks;
+	}
+
+	m_uiTickCount += uiTicks;
+	m_flTime += uiTicks * m_flTickInterval;
+
+	return uiTicks;
+}
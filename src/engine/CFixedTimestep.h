@@ -0,0 +1,90 @@
+#ifndef ENGINE_CFIXEDTIMESTEP_H
+#define ENGINE_CFIXEDTIMESTEP_H
+
+#include <cstdint>
+
+/**
+*	Splits real time into fixed length simulation ticks.
+*	Time left over that doesn't make up a whole tick is carried over to the next frame,
+*	and is given as the fraction of a tick that rendering should interpolate by.
+*/
+class CFixedTimestep final
+{
+public:
+	static const float DEFAULT_TICK_RATE;
+
+	/**
+	*	Tick rates are clamped to this range.
+	*/
+	static const float MIN_TICK_RATE;
+	static const float MAX_TICK_RATE;
+
+	/**
+	*	Most ticks to run in one frame. If the simulation can't keep up, the rest of the time is dropped
+	*	so that slow frames don't cause ever more ticks to be run.
+	*/
+	static const unsigned int MAX_TICKS_PER_FRAME = 8;
+
+public:
+	CFixedTimestep() = default;
+
+	/**
+	*	@return Ticks per second.
+	*/
+	float GetTickRate() const { return m_flTickRate; }
+
+	/**
+	*	Sets the number of ticks per second. Time that has already accumulated is kept.
+	*/
+	void SetTickRate( float flTickRate );
+
+	/**
+	*	@return Length of a tick, in seconds.
+	*/
+	double GetTickInterval() const { return m_flTickInterval; }
+
+	/**
+	*	Adds frame time, and returns how many ticks to run for it.
+	*	@param flFrameTime Real time since the last frame, in seconds.
+	*/
+	unsigned int Advance( double flFrameTime );
+
+	/**
+	*	@return How far the time is into the next tick, in [0, 1). Rendering should interpolate between the last two ticks by this amount.
+	*/
+	float GetAlpha() const { return static_cast<float>( m_flAccumulator / m_flTickInterval ); }
+
+	/**
+	*	@return Number of ticks run in total.
+	*/
+	uint64_t GetTickCount() const { return m_uiTickCount; }
+
+	/**
+	*	@return Simulated time, in seconds.
+	*/
+	double GetTime() const { return m_flTime; }
+
+	/**
+	*	@return Number of seconds that were dropped because too many ticks were needed.
+	*/
+	double GetDroppedTime() const { return m_flDroppedTime; }
+
+private:
+	float m_flTickRate = DEFAULT_TICK_RATE;
+
+	double m_flTickInterval = 1.0 / DEFAULT_TICK_RATE;
+
+	double m_flAccumulator = 0;
+
+	uint64_t m_uiTickCount = 0;
+
+	double m_flTime = 0;
+
+	double m_flDroppedTime = 0;
+
+private:
+	CFixedTimestep( const CFixedTimestep& ) = delete;
+	CFixedTimestep& operator=( const CFixedTimestep& ) = delete;
+};
+
+#endif //ENGINE_CFIXEDTIMESTEP_H
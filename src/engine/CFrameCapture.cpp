@@ -0,0 +1,448 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "FileSystem2.h"
+#include "Logging.h"
+
+#include "CFrameCapture.h"
+
+const size_t CFrameCapture::NUM_BUFFERS;
+const size_t CFrameCapture::MAX_PENDING_FRAMES;
+
+namespace
+{
+/**
+*	Longest time to wait for a frame to be read back when shutting down, in nanoseconds.
+*/
+const GLuint64 SHUTDOWN_TIMEOUT_NS = 1000000000;
+
+/**
+*	Number of pixel buffers kept around for reuse by later frames.
+*/
+const size_t MAX_FREE_PIXELS = 2;
+
+const size_t TGA_HEADER_SIZE = 18;
+
+/**
+*	TGA image type of RLE compressed true color images.
+*/
+const uint8_t TGA_TYPE_RLE_TRUE_COLOR = 10;
+
+/**
+*	Longest run of pixels in one RLE packet.
+*/
+const int TGA_MAX_PACKET_PIXELS = 128;
+
+inline bool IsSameColor( const uint8_t* pLHS, const uint8_t* pRHS )
+{
+	return pLHS[ 0 ] == pRHS[ 0 ] && pLHS[ 1 ] == pRHS[ 1 ] && pLHS[ 2 ] == pRHS[ 2 ];
+}
+
+/**
+*	Writes the color of a BGRA pixel as BGR.
+*/
+inline uint8_t* WriteColor( uint8_t* pDest, const uint8_t* pPixel )
+{
+	pDest[ 0 ] = pPixel[ 0 ];
+	pDest[ 1 ] = pPixel[ 1 ];
+	pDest[ 2 ] = pPixel[ 2 ];
+
+	return pDest + 3;
+}
+}
+
+CFrameCapture::~CFrameCapture()
+{
+	//The pixel buffers belong to the context, they must have been deleted with Shutdown.
+	if( m_Worker.joinable() )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			m_bStop = true;
+		}
+
+		m_WorkAvailable.notify_all();
+		m_Worker.join();
+	}
+}
+
+void CFrameCapture::Initialize( IFileSystem2& fileSystem )
+{
+	Shutdown();
+
+	m_pFileSystem = &fileSystem;
+
+	m_bAsync = ( GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object ) && ( GLEW_VERSION_3_2 || GLEW_ARB_sync );
+
+	if( m_bAsync )
+	{
+		for( auto& readback : m_Readbacks )
+		{
+			glGenBuffers( 1, &readback.buffer );
+		}
+	}
+
+	m_bStop = false;
+	m_Worker = std::thread( &CFrameCapture::WorkerThread, this );
+}
+
+void CFrameCapture::Shutdown()
+{
+	if( !IsInitialized() )
+		return;
+
+	FinishReadbacks( true );
+
+	for( auto& readback : m_Readbacks )
+	{
+		if( readback.buffer )
+		{
+			glDeleteBuffers( 1, &readback.buffer );
+			readback.buffer = 0;
+			readback.uiCapacity = 0;
+		}
+	}
+
+	//The worker writes everything that is queued before it stops.
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bStop = true;
+	}
+
+	m_WorkAvailable.notify_all();
+	m_Worker.join();
+
+	m_FreePixels.clear();
+
+	m_pFileSystem = nullptr;
+}
+
+void CFrameCapture::RequestScreenshot( const char* pszFileName )
+{
+	std::lock_guard<std::mutex> lock( m_RequestMutex );
+
+	m_Screenshots.emplace_back( pszFileName );
+
+	m_bScreenshotRequested.store( true, std::memory_order_relaxed );
+}
+
+void CFrameCapture::StartMovie( const char* pszBaseName )
+{
+	std::lock_guard<std::mutex> lock( m_RequestMutex );
+
+	m_szMovieName = pszBaseName;
+	m_uiMovieFrames = 0;
+	m_uiDroppedFrames = 0;
+
+	m_bMovie.store( true, std::memory_order_relaxed );
+}
+
+void CFrameCapture::StopMovie( unsigned int& uiFrames, unsigned int& uiDropped )
+{
+	std::lock_guard<std::mutex> lock( m_RequestMutex );
+
+	m_bMovie.store( false, std::memory_order_relaxed );
+
+	uiFrames = m_uiMovieFrames;
+	uiDropped = m_uiDroppedFrames.exchange( 0 );
+}
+
+void CFrameCapture::CaptureFrame( const int iWidth, const int iHeight )
+{
+	if( !IsInitialized() )
+		return;
+
+	if( m_uiReadbacks > 0 )
+		FinishReadbacks( false );
+
+	if( !m_bScreenshotRequested.load( std::memory_order_relaxed ) && !m_bMovie.load( std::memory_order_relaxed ) )
+		return;
+
+	if( iWidth <= 0 || iHeight <= 0 )
+		return;
+
+	//Screenshots wait for a free buffer, movie frames can't.
+	if( m_bAsync && m_uiReadbacks == NUM_BUFFERS )
+	{
+		if( m_bMovie.load( std::memory_order_relaxed ) )
+			++m_uiDroppedFrames;
+
+		return;
+	}
+
+	std::string szFileName;
+	bool bMovieFrame;
+
+	if( !TakeRequest( szFileName, bMovieFrame ) )
+		return;
+
+	const size_t uiSize = static_cast<size_t>( iWidth ) * iHeight * 4;
+
+	//4 byte pixels are always aligned, so the default pack alignment works.
+	if( !m_bAsync )
+	{
+		Frame_t frame{ std::move( szFileName ), iWidth, iHeight, bMovieFrame, AllocatePixels( uiSize ) };
+
+		glReadPixels( 0, 0, iWidth, iHeight, GL_BGRA, GL_UNSIGNED_BYTE, frame.pixels.data() );
+
+		QueueFrame( std::move( frame ) );
+		return;
+	}
+
+	auto& readback = m_Readbacks[ ( m_uiFirstReadback + m_uiReadbacks ) % NUM_BUFFERS ];
+
+	//The pack buffer binding isn't tracked by the state cache, so it's never left bound.
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, readback.buffer );
+
+	if( uiSize > readback.uiCapacity )
+	{
+		glBufferData( GL_PIXEL_PACK_BUFFER, uiSize, nullptr, GL_STREAM_READ );
+		readback.uiCapacity = uiSize;
+	}
+
+	glReadPixels( 0, 0, iWidth, iHeight, GL_BGRA, GL_UNSIGNED_BYTE, nullptr );
+
+	glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+
+	readback.fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	readback.iWidth = iWidth;
+	readback.iHeight = iHeight;
+	readback.szFileName = std::move( szFileName );
+	readback.bMovieFrame = bMovieFrame;
+
+	++m_uiReadbacks;
+}
+
+bool CFrameCapture::TakeRequest( std::string& szFileName, bool& bMovieFrame )
+{
+	std::lock_guard<std::mutex> lock( m_RequestMutex );
+
+	if( !m_Screenshots.empty() )
+	{
+		szFileName = std::move( m_Screenshots.front() );
+		bMovieFrame = false;
+
+		m_Screenshots.pop_front();
+
+		m_bScreenshotRequested.store( !m_Screenshots.empty(), std::memory_order_relaxed );
+
+		return true;
+	}
+
+	if( m_bMovie.load( std::memory_order_relaxed ) )
+	{
+		char szNumber[ 32 ];
+
+		snprintf( szNumber, sizeof( szNumber ), "%05u.tga", m_uiMovieFrames++ );
+
+		szFileName = m_szMovieName + szNumber;
+		bMovieFrame = true;
+
+		return true;
+	}
+
+	return false;
+}
+
+void CFrameCapture::FinishReadbacks( const bool bWait )
+{
+	while( m_uiReadbacks > 0 )
+	{
+		auto& readback = m_Readbacks[ m_uiFirstReadback ];
+
+		const GLenum result = glClientWaitSync( readback.fence, bWait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, bWait ? SHUTDOWN_TIMEOUT_NS : 0 );
+
+		//Reads finish in order, so later ones aren't done either.
+		if( result == GL_TIMEOUT_EXPIRED && !bWait )
+			break;
+
+		glDeleteSync( readback.fence );
+		readback.fence = nullptr;
+
+		m_uiFirstReadback = ( m_uiFirstReadback + 1 ) % NUM_BUFFERS;
+		--m_uiReadbacks;
+
+		const size_t uiSize = static_cast<size_t>( readback.iWidth ) * readback.iHeight * 4;
+
+		Frame_t frame{ std::move( readback.szFileName ), readback.iWidth, readback.iHeight, readback.bMovieFrame, AllocatePixels( uiSize ) };
+
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, readback.buffer );
+
+		//The data is already in client memory, so mapping it doesn't wait.
+		if( auto pData = glMapBuffer( GL_PIXEL_PACK_BUFFER, GL_READ_ONLY ) )
+		{
+			memcpy( frame.pixels.data(), pData, uiSize );
+
+			glUnmapBuffer( GL_PIXEL_PACK_BUFFER );
+
+			QueueFrame( std::move( frame ) );
+		}
+		else
+		{
+			Warning( "CFrameCapture: Couldn't read back \"%s\"\n", frame.szFileName.c_str() );
+		}
+
+		glBindBuffer( GL_PIXEL_PACK_BUFFER, 0 );
+	}
+}
+
+bool CFrameCapture::QueueFrame( Frame_t&& frame )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( frame.bMovieFrame && m_Frames.size() >= MAX_PENDING_FRAMES )
+		{
+			++m_uiDroppedFrames;
+
+			if( m_FreePixels.size() < MAX_FREE_PIXELS )
+				m_FreePixels.push_back( std::move( frame.pixels ) );
+
+			return false;
+		}
+
+		m_Frames.push_back( std::move( frame ) );
+	}
+
+	m_WorkAvailable.notify_one();
+
+	return true;
+}
+
+std::vector<uint8_t> CFrameCapture::AllocatePixels( const size_t uiSize )
+{
+	std::vector<uint8_t> pixels;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( !m_FreePixels.empty() )
+		{
+			pixels = std::move( m_FreePixels.back() );
+			m_FreePixels.pop_back();
+		}
+	}
+
+	pixels.resize( uiSize );
+
+	return pixels;
+}
+
+void CFrameCapture::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( true )
+	{
+		m_WorkAvailable.wait( lock, [ this ]() { return m_bStop || !m_Frames.empty(); } );
+
+		if( m_Frames.empty() )
+			break;
+
+		Frame_t frame = std::move( m_Frames.front() );
+		m_Frames.pop_front();
+
+		lock.unlock();
+
+		WriteFrame( frame );
+
+		lock.lock();
+
+		if( m_FreePixels.size() < MAX_FREE_PIXELS )
+			m_FreePixels.push_back( std::move( frame.pixels ) );
+	}
+}
+
+void CFrameCapture::WriteFrame( const Frame_t& frame )
+{
+	const int iWidth = frame.iWidth;
+	const int iHeight = frame.iHeight;
+
+	if( iWidth > UINT16_MAX || iHeight > UINT16_MAX )
+		return;
+
+	//Worst case is a raw packet header for every 128 pixels.
+	const size_t uiRowSize = static_cast<size_t>( iWidth ) * 3 + ( iWidth + TGA_MAX_PACKET_PIXELS - 1 ) / TGA_MAX_PACKET_PIXELS;
+
+	m_Encoded.resize( TGA_HEADER_SIZE + uiRowSize * iHeight );
+
+	uint8_t* pOut = m_Encoded.data();
+
+	memset( pOut, 0, TGA_HEADER_SIZE );
+
+	//Bottom left origin, like the pixels.
+	pOut[ 2 ] = TGA_TYPE_RLE_TRUE_COLOR;
+	pOut[ 12 ] = static_cast<uint8_t>( iWidth );
+	pOut[ 13 ] = static_cast<uint8_t>( iWidth >> 8 );
+	pOut[ 14 ] = static_cast<uint8_t>( iHeight );
+	pOut[ 15 ] = static_cast<uint8_t>( iHeight >> 8 );
+	pOut[ 16 ] = 24;
+
+	pOut += TGA_HEADER_SIZE;
+
+	//Alpha isn't meaningful in the default framebuffer, so it's left out. Packets don't cross rows.
+	for( int iY = 0; iY < iHeight; ++iY )
+	{
+		const uint8_t* const pRow = frame.pixels.data() + static_cast<size_t>( iY ) * iWidth * 4;
+
+		int iX = 0;
+
+		while( iX < iWidth )
+		{
+			const int iMaxLength = std::min( iWidth - iX, TGA_MAX_PACKET_PIXELS );
+
+			const uint8_t* const pPixel = pRow + iX * 4;
+
+			int iRun = 1;
+
+			while( iRun < iMaxLength && IsSameColor( pPixel, pPixel + iRun * 4 ) )
+				++iRun;
+
+			if( iRun > 1 )
+			{
+				*pOut++ = static_cast<uint8_t>( 0x80 | ( iRun - 1 ) );
+				pOut = WriteColor( pOut, pPixel );
+
+				iX += iRun;
+				continue;
+			}
+
+			//Raw pixels up to the next run.
+			int iRaw = 1;
+
+			while( iRaw < iMaxLength && !( iRaw + 1 < iMaxLength && IsSameColor( pPixel + iRaw * 4, pPixel + ( iRaw + 1 ) * 4 ) ) )
+				++iRaw;
+
+			*pOut++ = static_cast<uint8_t>( iRaw - 1 );
+
+			for( int iPixel = 0; iPixel < iRaw; ++iPixel )
+			{
+				pOut = WriteColor( pOut, pPixel + iPixel * 4 );
+			}
+
+			iX += iRaw;
+		}
+	}
+
+	const int iSize = static_cast<int>( pOut - m_Encoded.data() );
+
+	FileHandle_t hFile = m_pFileSystem->Open( frame.szFileName.c_str(), "wb" );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Warning( "Couldn't create \"%s\"\n", frame.szFileName.c_str() );
+		return;
+	}
+
+	const bool bWritten = m_pFileSystem->Write( m_Encoded.data(), iSize, hFile ) == iSize;
+
+	m_pFileSystem->Close( hFile );
+
+	if( !bWritten )
+		Warning( "Couldn't write \"%s\"\n", frame.szFileName.c_str() );
+	else if( !frame.bMovieFrame )
+		Msg( "Wrote \"%s\"\n", frame.szFileName.c_str() );
+}
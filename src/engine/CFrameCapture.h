@@ -0,0 +1,204 @@
+#ifndef ENGINE_CFRAMECAPTURE_H
+#define ENGINE_CFRAMECAPTURE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+class IFileSystem2;
+
+/**
+*	Saves frames as TGA files without stalling the GPU, for screenshots and movies.
+*	Frames are read back into a ring of pixel pack buffers, with a fence after each read. A buffer is only mapped once its fence has signaled,
+*	a frame or two later, so the copy never waits for the GPU. The pixels are handed to a worker thread that encodes them
+*	and writes them through the filesystem, with write-behind if it is enabled, so the frame never waits for the disk either.
+*	Without pixel buffers or sync objects, frames are read back directly, which waits until the GPU has finished the frame.
+*	Requests can be made from any thread. Everything else must be called on the thread that owns the OpenGL context.
+*/
+class CFrameCapture final
+{
+public:
+	/**
+	*	Number of frames that can be read back at the same time.
+	*/
+	static const size_t NUM_BUFFERS = 3;
+
+	/**
+	*	Maximum number of frames waiting to be encoded. Movie frames captured while the worker is this far behind are dropped,
+	*	screenshots are always kept.
+	*/
+	static const size_t MAX_PENDING_FRAMES = 8;
+
+	CFrameCapture() = default;
+	~CFrameCapture();
+
+	bool IsInitialized() const { return m_pFileSystem != nullptr; }
+
+	/**
+	*	Creates the pixel buffers and starts the worker thread.
+	*	@param fileSystem Filesystem that files are written through. Must outlive the capture.
+	*/
+	void Initialize( IFileSystem2& fileSystem );
+
+	/**
+	*	Finishes the frames that are being read back, waits until every frame has been written, and deletes the pixel buffers.
+	*/
+	void Shutdown();
+
+	/**
+	*	Saves the next frame. Can be called from any thread.
+	*	@param pszFileName Name of the TGA file.
+	*/
+	void RequestScreenshot( const char* pszFileName );
+
+	/**
+	*	Saves every frame from now on, as numbered TGA files. Can be called from any thread.
+	*	@param pszBaseName Name of the files, without the frame number and extension.
+	*/
+	void StartMovie( const char* pszBaseName );
+
+	/**
+	*	Stops saving every frame. Can be called from any thread.
+	*	@param uiFrames Receives the number of frames that were captured.
+	*	@param uiDropped Receives the number of frames that were dropped because the GPU or the worker fell behind.
+	*/
+	void StopMovie( unsigned int& uiFrames, unsigned int& uiDropped );
+
+	bool IsRecordingMovie() const { return m_bMovie.load( std::memory_order_relaxed ); }
+
+	/**
+	*	Reads back the frame that was just drawn, if it was requested, and hands frames that finished reading back to the worker.
+	*	Call after the frame is drawn, before it is presented, with the default framebuffer bound.
+	*/
+	void CaptureFrame( const int iWidth, const int iHeight );
+
+private:
+	/**
+	*	Frame being read back into a pixel buffer.
+	*/
+	struct Readback_t
+	{
+		GLuint buffer = 0;
+		size_t uiCapacity = 0;
+
+		GLsync fence = nullptr;
+
+		int iWidth = 0;
+		int iHeight = 0;
+
+		std::string szFileName;
+
+		bool bMovieFrame = false;
+	};
+
+	/**
+	*	Frame waiting to be encoded. Pixels are BGRA, bottom row first, the way both OpenGL and TGA store them.
+	*/
+	struct Frame_t
+	{
+		std::string szFileName;
+
+		int iWidth;
+		int iHeight;
+
+		bool bMovieFrame;
+
+		std::vector<uint8_t> pixels;
+	};
+
+	/**
+	*	Gets the name of the next frame to capture. Screenshots come first.
+	*	@return Whether a frame is wanted.
+	*/
+	bool TakeRequest( std::string& szFileName, bool& bMovieFrame );
+
+	/**
+	*	Maps the pixel buffers whose reads have finished, oldest first, and queues their frames.
+	*	@param bWait Whether to wait for reads that haven't finished.
+	*/
+	void FinishReadbacks( const bool bWait );
+
+	/**
+	*	Queues a frame for the worker. Movie frames are dropped if too many are waiting.
+	*	@return Whether the frame was queued.
+	*/
+	bool QueueFrame( Frame_t&& frame );
+
+	/**
+	*	@return A buffer for a frame's pixels, reusing the memory of frames that were written.
+	*/
+	std::vector<uint8_t> AllocatePixels( const size_t uiSize );
+
+	void WorkerThread();
+
+	/**
+	*	Encodes a frame as an RLE compressed 24 bit TGA file and writes it.
+	*/
+	void WriteFrame( const Frame_t& frame );
+
+private:
+	IFileSystem2* m_pFileSystem = nullptr;
+
+	/**
+	*	Whether frames are read back into pixel buffers with fences.
+	*/
+	bool m_bAsync = false;
+
+	Readback_t m_Readbacks[ NUM_BUFFERS ];
+
+	/**
+	*	Oldest frame being read back, and number of frames being read back.
+	*/
+	size_t m_uiFirstReadback = 0;
+	size_t m_uiReadbacks = 0;
+
+	/**
+	*	Guards requests and the movie state.
+	*/
+	std::mutex m_RequestMutex;
+
+	std::deque<std::string> m_Screenshots;
+
+	/**
+	*	Set when there are screenshot requests, so frames without any don't lock.
+	*/
+	std::atomic<bool> m_bScreenshotRequested{ false };
+
+	std::atomic<bool> m_bMovie{ false };
+	std::string m_szMovieName;
+	unsigned int m_uiMovieFrames = 0;
+	std::atomic<unsigned int> m_uiDroppedFrames{ 0 };
+
+	/**
+	*	Guards the worker's queue and the pixel buffers it hands back.
+	*/
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkAvailable;
+
+	std::deque<Frame_t> m_Frames;
+
+	std::vector<std::vector<uint8_t>> m_FreePixels;
+
+	bool m_bStop = false;
+
+	std::thread m_Worker;
+
+	/**
+	*	TGA data being written. Only used by the worker.
+	*/
+	std::vector<uint8_t> m_Encoded;
+
+private:
+	CFrameCapture( const CFrameCapture& ) = delete;
+	CFrameCapture& operator=( const CFrameCapture& ) = delete;
+};
+
+#endif //ENGINE_CFRAMECAPTURE_H
@@ -0,0 +1,140 @@
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "CFrameLimiter.h"
+
+const int64_t CFrameLimiter::MIN_SPIN_US;
+const int64_t CFrameLimiter::MAX_SPIN_US;
+
+void CFrameLimiter::SetMaxFPS( float flMaxFPS )
+{
+	if( flMaxFPS < 0 )
+		flMaxFPS = 0;
+
+	if( flMaxFPS == m_flMaxFPS )
+		return;
+
+	m_flMaxFPS = flMaxFPS;
+
+	if( flMaxFPS > 0 )
+		m_Interval = std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( 1.0 / flMaxFPS ) );
+	else
+		m_Interval = Clock::duration::zero();
+
+	//Start the new rate from the next frame rather than catching up.
+	m_bHasNextFrame = false;
+}
+
+void CFrameLimiter::WaitForNextFrame()
+{
+	Clock::time_point frameStart;
+
+	if( m_Interval > Clock::duration::zero() )
+	{
+		if( !m_bHasNextFrame )
+		{
+			m_NextFrame = Clock::now();
+			m_bHasNextFrame = true;
+		}
+
+		WaitUntil( m_NextFrame );
+
+		frameStart = Clock::now();
+
+		//Schedule from the deadline rather than the actual start so the rate doesn't drift.
+		//If a frame ran long, start over from now instead of rushing the next few frames.
+		if( frameStart - m_NextFrame > m_Interval )
+			m_NextFrame = frameStart + m_Interval;
+		else
+			m_NextFrame += m_Interval;
+	}
+	else
+	{
+		frameStart = Clock::now();
+	}
+
+	if( m_bHasLastFrame )
+	{
+		const double flFrameMS = std::chrono::duration<double, std::milli>( frameStart - m_LastFrame ).count();
+
+		//Welford's running variance.
+		++m_uiFrames;
+
+		const double flDelta = flFrameMS - m_flMean;
+
+		m_flMean += flDelta / m_uiFrames;
+		m_flM2 += flDelta * ( flFrameMS - m_flMean );
+
+		m_flMax = std::max( m_flMax, flFrameMS );
+	}
+
+	m_LastFrame = frameStart;
+	m_bHasLastFrame = true;
+}
+
+void CFrameLimiter::GetStats( Stats_t& stats ) const
+{
+	stats.uiFrames = m_uiFrames;
+	stats.flMeanMS = m_flMean;
+	stats.flStdDevMS = m_uiFrames > 1 ? sqrt( m_flM2 / ( m_uiFrames - 1 ) ) : 0;
+	stats.flMaxMS = m_flMax;
+	stats.flSpinMS = std::chrono::duration<double, std::milli>( GetSpinTime() ).count();
+}
+
+void CFrameLimiter::ResetStats()
+{
+	m_uiFrames = 0;
+	m_flMean = 0;
+	m_flM2 = 0;
+	m_flMax = 0;
+}
+
+void CFrameLimiter::WaitUntil( const Clock::time_point deadline )
+{
+	auto now = Clock::now();
+
+	if( m_bSleepOnly )
+	{
+		if( now < deadline )
+			std::this_thread::sleep_for( deadline - now );
+
+		return;
+	}
+
+	const auto spinTime = GetSpinTime();
+
+	if( deadline - now > spinTime )
+	{
+		const auto requested = ( deadline - now ) - spinTime;
+
+		std::this_thread::sleep_for( requested );
+
+		const auto woken = Clock::now();
+
+		const auto overshoot = std::max( ( woken - now ) - requested, Clock::duration::zero() );
+
+		//React to late wakeups right away, and forget them slowly.
+		if( overshoot > m_SleepOvershoot )
+			m_SleepOvershoot = ( m_SleepOvershoot + overshoot ) / 2;
+		else
+			m_SleepOvershoot -= ( m_SleepOvershoot - overshoot ) / 16;
+
+		now = woken;
+	}
+
+	while( now < deadline )
+	{
+		std::this_thread::yield();
+
+		now = Clock::now();
+	}
+}
+
+CFrameLimiter::Clock::duration CFrameLimiter::GetSpinTime() const
+{
+	const auto minSpin = std::chrono::duration_cast<Clock::duration>( std::chrono::microseconds( MIN_SPIN_US ) );
+	const auto maxSpin = std::chrono::duration_cast<Clock::duration>( std::chrono::microseconds( MAX_SPIN_US ) );
+
+	return std::min( m_SleepOvershoot + minSpin, maxSpin );
+}
@@ -0,0 +1,119 @@
+#ifndef ENGINE_CFRAMELIMITER_H
+#define ENGINE_CFRAMELIMITER_H
+
+#include <chrono>
+#include <cstdint>
+
+/**
+*	Caps the frame rate by waiting before each frame.
+*	Sleeps for most of the wait, then spins for the rest, so frames start on time even though sleeps overshoot.
+*	How long to spin for is learned from how much recent sleeps overshot.
+*/
+class CFrameLimiter final
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	*	Always spin for at least this long, in microseconds.
+	*/
+	static const int64_t MIN_SPIN_US = 200;
+
+	/**
+	*	Never spin for longer than this, in microseconds. Limits the CPU time spent on spinning if sleeps are very coarse.
+	*/
+	static const int64_t MAX_SPIN_US = 4000;
+
+	struct Stats_t
+	{
+		uint64_t uiFrames = 0;
+
+		/**
+		*	Time between frame starts, in milliseconds.
+		*/
+		double flMeanMS = 0;
+		double flStdDevMS = 0;
+		double flMaxMS = 0;
+
+		/**
+		*	Time that is currently spun for instead of slept, in milliseconds.
+		*/
+		double flSpinMS = 0;
+	};
+
+public:
+	CFrameLimiter() = default;
+
+	/**
+	*	@return The frame rate cap, or 0 if there is none.
+	*/
+	float GetMaxFPS() const { return m_flMaxFPS; }
+
+	/**
+	*	Sets the frame rate cap. 0 or less for no cap.
+	*/
+	void SetMaxFPS( float flMaxFPS );
+
+	/**
+	*	@return Whether waits only sleep.
+	*/
+	bool IsSleepOnly() const { return m_bSleepOnly; }
+
+	/**
+	*	Sets whether waits only sleep. Frames start later by however much the sleep overshoots,
+	*	but no CPU time is spent spinning. Meant for servers, where many processes share the CPU.
+	*/
+	void SetSleepOnly( const bool bSleepOnly )
+	{
+		m_bSleepOnly = bSleepOnly;
+	}
+
+	/**
+	*	Waits until the next frame should start. Call once per frame, before running it.
+	*/
+	void WaitForNextFrame();
+
+	/**
+	*	Gets the frame time statistics since they were last reset.
+	*/
+	void GetStats( Stats_t& stats ) const;
+
+	void ResetStats();
+
+private:
+	/**
+	*	Sleeps, then spins until the given time.
+	*/
+	void WaitUntil( const Clock::time_point deadline );
+
+	Clock::duration GetSpinTime() const;
+
+private:
+	float m_flMaxFPS = 0;
+
+	Clock::duration m_Interval{ 0 };
+
+	Clock::time_point m_NextFrame;
+	Clock::time_point m_LastFrame;
+
+	bool m_bHasNextFrame = false;
+	bool m_bHasLastFrame = false;
+
+	bool m_bSleepOnly = false;
+
+	/**
+	*	Estimate of how much sleeps overshoot by.
+	*/
+	Clock::duration m_SleepOvershoot{ 0 };
+
+	uint64_t m_uiFrames = 0;
+	double m_flMean = 0;
+	double m_flM2 = 0;
+	double m_flMax = 0;
+
+private:
+	CFrameLimiter( const CFrameLimiter& ) = delete;
+	CFrameLimiter& operator=( const CFrameLimiter& ) = delete;
+};
+
+#endif //ENGINE_CFRAMELIMITER_H
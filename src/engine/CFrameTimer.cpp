@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cassert>
+#include <string>
+
+#include "CMetricsRegistry.h"
+
+#include "CFrameTimer.h"
+
+const size_t CFrameTimer::NUM_PHASES;
+const size_t CFrameTimer::NUM_GPU_PASSES;
+const size_t CFrameTimer::NUM_FRAMES;
+
+namespace
+{
+/**
+*	Upper bounds of the frame time buckets, in seconds. Covers tick rates up to 1000 Hz and hitches of a second.
+*/
+const double FRAME_TIME_BOUNDS[] =
+{
+	0.001, 0.002, 0.004, 0.008, 0.0167, 0.033, 0.05, 0.1, 0.25, 0.5, 1
+};
+}
+
+const char* CFrameTimer::GetPhaseName( const Phase phase )
+{
+	switch( phase )
+	{
+	case Phase::EVENTS:		return "events";
+	case Phase::COMMANDS:	return "commands";
+	case Phase::SIMULATION:	return "simulation";
+	case Phase::RENDER:		return "render";
+	case Phase::PRESENT:	return "present";
+
+	default:				return "unknown";
+	}
+}
+
+const char* CFrameTimer::GetGPUPassName( const GPUPass pass )
+{
+	switch( pass )
+	{
+	case GPUPass::CLEAR:	return "gpu clear";
+	case GPUPass::VGUI1:	return "gpu vgui1";
+
+	default:				return "unknown";
+	}
+}
+
+void CFrameTimer::BeginFrame()
+{
+	auto& frame = m_Frames[ m_uiCurrent ];
+
+	for( auto& flTime : frame.flPhaseMS )
+	{
+		flTime = 0;
+	}
+
+	frame.flTotalMS = 0;
+
+	for( auto& flTime : frame.flGPUPassMS )
+	{
+		flTime = 0;
+	}
+
+	m_FrameStart = Clock::now();
+	m_bInFrame = true;
+}
+
+void CFrameTimer::EndFrame()
+{
+	if( !m_bInFrame )
+		return;
+
+	auto& frame = m_Frames[ m_uiCurrent ];
+
+	frame.flTotalMS = std::chrono::duration<float, std::milli>( Clock::now() - m_FrameStart ).count();
+
+	if( m_pTotalHistogram )
+	{
+		m_pTotalHistogram->Observe( frame.flTotalMS / 1000.0 );
+
+		for( size_t uiPhase = 0; uiPhase < NUM_PHASES; ++uiPhase )
+		{
+			m_pPhaseHistograms[ uiPhase ]->Observe( frame.flPhaseMS[ uiPhase ] / 1000.0 );
+		}
+	}
+
+	m_uiCurrent = ( m_uiCurrent + 1 ) % NUM_FRAMES;
+
+	if( m_uiCount < NUM_FRAMES )
+		++m_uiCount;
+
+	m_bInFrame = false;
+}
+
+void CFrameTimer::AddPhaseTime( const Phase phase, const Clock::duration duration )
+{
+	assert( phase < Phase::COUNT );
+
+	if( !m_bInFrame )
+		return;
+
+	m_Frames[ m_uiCurrent ].flPhaseMS[ static_cast<size_t>( phase ) ] += std::chrono::duration<float, std::milli>( duration ).count();
+}
+
+void CFrameTimer::SetGPUPassTime( const GPUPass pass, const float flTimeMS )
+{
+	assert( pass < GPUPass::COUNT );
+
+	if( !m_bInFrame )
+		return;
+
+	m_Frames[ m_uiCurrent ].flGPUPassMS[ static_cast<size_t>( pass ) ] = flTimeMS;
+}
+
+const CFrameTimer::Frame_t& CFrameTimer::GetFrame( const size_t uiAge ) const
+{
+	assert( uiAge < m_uiCount );
+
+	return m_Frames[ ( m_uiCurrent + NUM_FRAMES - 1 - uiAge ) % NUM_FRAMES ];
+}
+
+void CFrameTimer::GetPhaseSummary( const Phase phase, Summary_t& summary ) const
+{
+	assert( phase < Phase::COUNT );
+
+	float flTimes[ NUM_FRAMES ];
+
+	for( size_t uiFrame = 0; uiFrame < m_uiCount; ++uiFrame )
+	{
+		flTimes[ uiFrame ] = GetFrame( uiFrame ).flPhaseMS[ static_cast<size_t>( phase ) ];
+	}
+
+	Summarize( flTimes, m_uiCount, summary );
+}
+
+void CFrameTimer::GetTotalSummary( Summary_t& summary ) const
+{
+	float flTimes[ NUM_FRAMES ];
+
+	for( size_t uiFrame = 0; uiFrame < m_uiCount; ++uiFrame )
+	{
+		flTimes[ uiFrame ] = GetFrame( uiFrame ).flTotalMS;
+	}
+
+	Summarize( flTimes, m_uiCount, summary );
+}
+
+void CFrameTimer::GetGPUPassSummary( const GPUPass pass, Summary_t& summary ) const
+{
+	assert( pass < GPUPass::COUNT );
+
+	float flTimes[ NUM_FRAMES ];
+
+	for( size_t uiFrame = 0; uiFrame < m_uiCount; ++uiFrame )
+	{
+		flTimes[ uiFrame ] = GetFrame( uiFrame ).flGPUPassMS[ static_cast<size_t>( pass ) ];
+	}
+
+	Summarize( flTimes, m_uiCount, summary );
+}
+
+void CFrameTimer::Reset()
+{
+	m_uiCurrent = 0;
+	m_uiCount = 0;
+	m_bInFrame = false;
+}
+
+void CFrameTimer::SetMetrics( CMetricsRegistry* pRegistry )
+{
+	if( !pRegistry )
+	{
+		m_pTotalHistogram = nullptr;
+
+		for( auto& pHistogram : m_pPhaseHistograms )
+		{
+			pHistogram = nullptr;
+		}
+
+		return;
+	}
+
+	const size_t uiBounds = sizeof( FRAME_TIME_BOUNDS ) / sizeof( FRAME_TIME_BOUNDS[ 0 ] );
+
+	m_pTotalHistogram = pRegistry->AddHistogram( "engine_frame_seconds", "Time from the start to the end of a frame, not counting the frame rate cap.",
+		FRAME_TIME_BOUNDS, uiBounds );
+
+	std::string szLabels;
+
+	for( size_t uiPhase = 0; uiPhase < NUM_PHASES; ++uiPhase )
+	{
+		szLabels.clear();
+		CMetricsRegistry::FormatLabel( szLabels, "phase", GetPhaseName( static_cast<Phase>( uiPhase ) ) );
+
+		m_pPhaseHistograms[ uiPhase ] = pRegistry->AddHistogram( "engine_frame_phase_seconds", "Time spent in each phase of a frame.",
+			FRAME_TIME_BOUNDS, uiBounds, szLabels.c_str() );
+	}
+}
+
+void CFrameTimer::Summarize( float* pflTimes, const size_t uiCount, Summary_t& summary )
+{
+	summary = Summary_t();
+
+	summary.uiFrames = uiCount;
+
+	if( uiCount == 0 )
+		return;
+
+	double flTotal = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		flTotal += pflTimes[ uiIndex ];
+	}
+
+	summary.flMinMS = *std::min_element( pflTimes, pflTimes + uiCount );
+	summary.flAvgMS = static_cast<float>( flTotal / uiCount );
+
+	//Nearest rank: the smallest time that at least 99% of frames are at or below.
+	const size_t uiRank = ( uiCount * 99 + 99 ) / 100 - 1;
+
+	std::nth_element( pflTimes, pflTimes + uiRank, pflTimes + uiCount );
+
+	summary.flP99MS = pflTimes[ uiRank ];
+}
@@ -0,0 +1,195 @@
+#ifndef ENGINE_CFRAMETIMER_H
+#define ENGINE_CFRAMETIMER_H
+
+#include <chrono>
+#include <cstddef>
+
+class CMetricHistogram;
+class CMetricsRegistry;
+
+/**
+*	Records how long each phase of a frame took, for the last NUM_FRAMES frames.
+*	Time spent waiting for the frame rate cap isn't included.
+*/
+class CFrameTimer final
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	enum class Phase
+	{
+		EVENTS = 0,
+		COMMANDS,
+		SIMULATION,
+		RENDER,
+		PRESENT,
+
+		COUNT
+	};
+
+	static const size_t NUM_PHASES = static_cast<size_t>( Phase::COUNT );
+
+	/**
+	*	Render passes timed on the GPU.
+	*/
+	enum class GPUPass
+	{
+		CLEAR = 0,
+		VGUI1,
+
+		COUNT
+	};
+
+	static const size_t NUM_GPU_PASSES = static_cast<size_t>( GPUPass::COUNT );
+
+	/**
+	*	Number of frames to keep.
+	*/
+	static const size_t NUM_FRAMES = 256;
+
+	struct Frame_t
+	{
+		/**
+		*	Time spent in each phase, in milliseconds.
+		*/
+		float flPhaseMS[ NUM_PHASES ];
+
+		/**
+		*	Time from the start to the end of the frame, in milliseconds. Includes time not spent in any phase.
+		*/
+		float flTotalMS;
+
+		/**
+		*	Time the GPU spent on each pass, in milliseconds. GPU times arrive a few frames late,
+		*	so these belong to an earlier frame. 0 if GPU timing isn't supported.
+		*/
+		float flGPUPassMS[ NUM_GPU_PASSES ];
+	};
+
+	struct Summary_t
+	{
+		size_t uiFrames = 0;
+
+		float flMinMS = 0;
+		float flAvgMS = 0;
+		float flP99MS = 0;
+	};
+
+	/**
+	*	Times a phase until it goes out of scope.
+	*/
+	class CScopedPhase final
+	{
+	public:
+		CScopedPhase( CFrameTimer& timer, const Phase phase )
+			: m_Timer( timer )
+			, m_Phase( phase )
+			, m_Start( Clock::now() )
+		{
+		}
+
+		~CScopedPhase()
+		{
+			m_Timer.AddPhaseTime( m_Phase, Clock::now() - m_Start );
+		}
+
+	private:
+		CFrameTimer& m_Timer;
+		const Phase m_Phase;
+		const Clock::time_point m_Start;
+
+	private:
+		CScopedPhase( const CScopedPhase& ) = delete;
+		CScopedPhase& operator=( const CScopedPhase& ) = delete;
+	};
+
+public:
+	CFrameTimer() = default;
+
+	static const char* GetPhaseName( const Phase phase );
+
+	static const char* GetGPUPassName( const GPUPass pass );
+
+	void BeginFrame();
+
+	void EndFrame();
+
+	/**
+	*	Adds time to a phase of the current frame.
+	*/
+	void AddPhaseTime( const Phase phase, const Clock::duration duration );
+
+	/**
+	*	Sets the GPU time of a pass for the current frame.
+	*/
+	void SetGPUPassTime( const GPUPass pass, const float flTimeMS );
+
+	/**
+	*	@return Number of recorded frames, up to NUM_FRAMES.
+	*/
+	size_t GetFrameCount() const { return m_uiCount; }
+
+	/**
+	*	Gets a recorded frame.
+	*	@param uiAge How many frames ago the frame ended. 0 is the last frame. Must be less than GetFrameCount.
+	*/
+	const Frame_t& GetFrame( const size_t uiAge ) const;
+
+	/**
+	*	Gets the statistics of a phase over the recorded frames.
+	*/
+	void GetPhaseSummary( const Phase phase, Summary_t& summary ) const;
+
+	/**
+	*	Gets the statistics of the whole frame over the recorded frames.
+	*/
+	void GetTotalSummary( Summary_t& summary ) const;
+
+	/**
+	*	Gets the statistics of a GPU pass over the recorded frames.
+	*/
+	void GetGPUPassSummary( const GPUPass pass, Summary_t& summary ) const;
+
+	/**
+	*	Forgets all recorded frames.
+	*/
+	void Reset();
+
+	/**
+	*	Publishes the time of each frame and phase into frame time histograms, in seconds.
+	*	@param pRegistry Registry to publish into, or null to stop publishing. Must outlive the timer, or publishing must be stopped first.
+	*/
+	void SetMetrics( CMetricsRegistry* pRegistry );
+
+private:
+	/**
+	*	Computes the statistics of the given times. Reorders the times.
+	*/
+	static void Summarize( float* pflTimes, const size_t uiCount, Summary_t& summary );
+
+private:
+	Frame_t m_Frames[ NUM_FRAMES ] = {};
+
+	/**
+	*	Index of the frame being recorded.
+	*/
+	size_t m_uiCurrent = 0;
+
+	size_t m_uiCount = 0;
+
+	Clock::time_point m_FrameStart;
+
+	bool m_bInFrame = false;
+
+	/**
+	*	Histograms that frames are published into, if any.
+	*/
+	CMetricHistogram* m_pTotalHistogram = nullptr;
+	CMetricHistogram* m_pPhaseHistograms[ NUM_PHASES ] = {};
+
+private:
+	CFrameTimer( const CFrameTimer& ) = delete;
+	CFrameTimer& operator=( const CFrameTimer& ) = delete;
+};
+
+#endif //ENGINE_CFRAMETIMER_H
@@ -0,0 +1,195 @@
+#include <algorithm>
+
+#include "CBSPFile.h"
+#include "CEntityList.h"
+#include "CInterestSets.h"
+#include "CVisibilityCache.h"
+
+#include "CMapVisibility.h"
+
+namespace
+{
+/**
+*	Contents of leafs that are inside walls.
+*/
+const int32_t CONTENTS_SOLID = -2;
+
+/**
+*	Most nodes waiting to be visited while finding a sphere's leafs, which is at most the depth of the tree.
+*/
+const size_t MAX_NODE_STACK = 256;
+
+/**
+*	@return Distance of a point in front of a plane.
+*/
+inline float PlaneDistance( const bsp::Plane_t& plane, const float* pOrigin )
+{
+	//Axial planes only need one component.
+	if( plane.type >= 0 && plane.type < 3 )
+		return pOrigin[ plane.type ] - plane.dist;
+
+	return plane.normal[ 0 ] * pOrigin[ 0 ] + plane.normal[ 1 ] * pOrigin[ 1 ] + plane.normal[ 2 ] * pOrigin[ 2 ] - plane.dist;
+}
+}
+
+void CMapVisibility::Reset( const CBSPFile& map, CInterestSets& sets )
+{
+	size_t uiVisSize;
+
+	const auto pVisData = UseMap( map, uiVisSize );
+
+	sets.Reset( m_uiLeafCount );
+
+	for( size_t uiLeaf = 0; uiLeaf < m_uiLeafCount; ++uiLeaf )
+	{
+		const auto iOffset = m_pLeafs[ uiLeaf ].visofs;
+
+		//Leaf 0 has no row, and is treated as seeing everything, as are leafs of maps that weren't run through vis.
+		if( uiLeaf == 0 || iOffset < 0 || static_cast<size_t>( iOffset ) >= uiVisSize )
+		{
+			sets.SetAllVisible( uiLeaf );
+			continue;
+		}
+
+		//Rows start at leaf 1, and end wherever the data says they do.
+		sets.SetCompressedRow( uiLeaf, pVisData + iOffset, uiVisSize - iOffset, 1 );
+	}
+
+	sets.BuildPAS();
+}
+
+void CMapVisibility::Reset( const CBSPFile& map, CVisibilityCache& cache, const size_t uiCapacity )
+{
+	size_t uiVisSize;
+
+	const auto pVisData = UseMap( map, uiVisSize );
+
+	//Rows start at leaf 1. Leafs see everything until their row is set.
+	cache.Reset( m_uiLeafCount, pVisData, uiVisSize, 1, uiCapacity );
+
+	//Leaf 0 has no row, and the cache treats offsets outside the data like leafs of maps that weren't run through vis.
+	for( size_t uiLeaf = 1; uiLeaf < m_uiLeafCount; ++uiLeaf )
+	{
+		const auto iOffset = m_pLeafs[ uiLeaf ].visofs;
+
+		if( iOffset >= 0 )
+			cache.SetRowOffset( uiLeaf, static_cast<size_t>( iOffset ) );
+	}
+}
+
+void CMapVisibility::Clear()
+{
+	m_pNodes = nullptr;
+	m_uiNodeCount = 0;
+	m_pPlanes = nullptr;
+	m_pLeafs = nullptr;
+	m_uiLeafCount = 0;
+	m_iHeadNode = -1;
+}
+
+const uint8_t* CMapVisibility::UseMap( const CBSPFile& map, size_t& uiVisSize )
+{
+	size_t uiCount;
+
+	m_pNodes = map.GetLump<bsp::Node_t>( bsp::LUMP_NODES, m_uiNodeCount );
+	m_pPlanes = map.GetLump<bsp::Plane_t>( bsp::LUMP_PLANES, uiCount );
+	m_pLeafs = map.GetLump<bsp::Leaf_t>( bsp::LUMP_LEAFS, m_uiLeafCount );
+
+	//Model 0 is the world. Its head node was validated when the map was loaded.
+	const auto pModels = map.GetLump<bsp::Model_t>( bsp::LUMP_MODELS, uiCount );
+
+	m_iHeadNode = uiCount > 0 && m_uiNodeCount > 0 ? pModels[ 0 ].headnode[ 0 ] : -1;
+
+	return map.GetLumpData( bsp::LUMP_VISIBILITY, uiVisSize );
+}
+
+uint32_t CMapVisibility::FindLeaf( const float ( &origin )[ 3 ] ) const
+{
+	if( m_iHeadNode < 0 )
+		return 0;
+
+	int32_t iNode = m_iHeadNode;
+
+	//A tree never visits a node twice, so a longer walk means the map has a cycle.
+	for( size_t uiSteps = 0; iNode >= 0 && uiSteps < m_uiNodeCount; ++uiSteps )
+	{
+		const auto& node = m_pNodes[ iNode ];
+
+		iNode = node.children[ PlaneDistance( m_pPlanes[ node.planenum ], origin ) >= 0 ? 0 : 1 ];
+	}
+
+	return iNode < 0 ? static_cast<uint32_t>( -( iNode + 1 ) ) : 0;
+}
+
+size_t CMapVisibility::FindLeafs( const float ( &origin )[ 3 ], const float flRadius, uint32_t* pLeafs, const size_t uiMaxLeafs ) const
+{
+	if( m_iHeadNode < 0 )
+		return 0;
+
+	int32_t stack[ MAX_NODE_STACK ];
+	size_t uiStackSize = 0;
+
+	stack[ uiStackSize++ ] = m_iHeadNode;
+
+	size_t uiFound = 0;
+	size_t uiVisited = 0;
+
+	while( uiStackSize > 0 )
+	{
+		const int32_t iNode = stack[ --uiStackSize ];
+
+		if( iNode < 0 )
+		{
+			const size_t uiLeaf = static_cast<size_t>( -( iNode + 1 ) );
+
+			if( m_pLeafs[ uiLeaf ].contents == CONTENTS_SOLID )
+				continue;
+
+			if( uiFound < uiMaxLeafs )
+				pLeafs[ uiFound ] = static_cast<uint32_t>( uiLeaf );
+
+			++uiFound;
+			continue;
+		}
+
+		//Maps with cycles or very deep trees are reported as touching too many leafs, so the entity is relevant everywhere.
+		if( ++uiVisited > m_uiNodeCount || uiStackSize + 2 > MAX_NODE_STACK )
+			return std::max( uiFound, uiMaxLeafs + 1 );
+
+		const auto& node = m_pNodes[ iNode ];
+
+		const float flDistance = PlaneDistance( m_pPlanes[ node.planenum ], origin );
+
+		if( flDistance > -flRadius )
+			stack[ uiStackSize++ ] = node.children[ 0 ];
+
+		if( flDistance < flRadius )
+			stack[ uiStackSize++ ] = node.children[ 1 ];
+	}
+
+	return uiFound;
+}
+
+void CMapVisibility::LinkEntities( const CEntityList& entities, CInterestSets& sets ) const
+{
+	const size_t uiCount = entities.GetCount();
+
+	sets.BeginFrame( uiCount );
+
+	const auto& components = entities.GetComponents();
+
+	uint32_t leafs[ CInterestSets::MAX_ENTITY_LEAFS ];
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		if( components.pFlags[ uiIndex ] & EntityFlag::NODRAW )
+			continue;
+
+		const float origin[ 3 ] = { components.pOriginX[ uiIndex ], components.pOriginY[ uiIndex ], components.pOriginZ[ uiIndex ] };
+
+		const size_t uiLeafs = FindLeafs( origin, components.pRadius[ uiIndex ], leafs, CInterestSets::MAX_ENTITY_LEAFS );
+
+		//Entities that touch too many leafs, or are entirely in solid leafs, are relevant everywhere.
+		sets.LinkEntity( static_cast<uint32_t>( uiIndex ), leafs, uiLeafs );
+	}
+}
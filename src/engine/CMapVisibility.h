@@ -0,0 +1,90 @@
+#ifndef ENGINE_CMAPVISIBILITY_H
+#define ENGINE_CMAPVISIBILITY_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "BSPFile.h"
+#include "CVisibilityCache.h"
+
+class CBSPFile;
+class CEntityList;
+class CInterestSets;
+
+/**
+*	Connects a map to CInterestSets or CVisibilityCache: loads the map's visibility data into them, and finds the leafs of clients and entities in the BSP tree.
+*	Leafs are numbered as in the map. Leaf 0 is the solid leaf outside the world, from which everything is visible.
+*	The map has to stay loaded while this refers to it.
+*/
+class CMapVisibility final
+{
+public:
+	CMapVisibility() = default;
+	~CMapVisibility() = default;
+
+	/**
+	*	Uses a map, and loads its visibility into a set of interest sets. Leafs without visibility data can see every leaf.
+	*	@param map Loaded map.
+	*/
+	void Reset( const CBSPFile& map, CInterestSets& sets );
+
+	/**
+	*	Uses a map, and points a visibility cache at its visibility data, so rows are only decompressed when they're queried.
+	*	Leafs without visibility data can see every leaf.
+	*	@param map Loaded map. The cache refers to its data, so it has to stay loaded while the cache is used.
+	*	@param uiCapacity Most rows the cache keeps decompressed.
+	*/
+	void Reset( const CBSPFile& map, CVisibilityCache& cache, const size_t uiCapacity = CVisibilityCache::DEFAULT_CAPACITY );
+
+	/**
+	*	Stops using the map.
+	*/
+	void Clear();
+
+	size_t GetLeafCount() const { return m_uiLeafCount; }
+
+	/**
+	*	@return Leaf that contains a point, or 0 if there is no map.
+	*/
+	uint32_t FindLeaf( const float ( &origin )[ 3 ] ) const;
+
+	/**
+	*	Finds the leafs that a sphere touches. Solid leafs are skipped.
+	*	@param pLeafs Leafs that were found, up to uiMaxLeafs.
+	*	@return Number of leafs the sphere touches, which may be more than uiMaxLeafs.
+	*/
+	size_t FindLeafs( const float ( &origin )[ 3 ], const float flRadius, uint32_t* pLeafs, const size_t uiMaxLeafs ) const;
+
+	/**
+	*	Starts a frame in a set of interest sets and links each entity to the leafs its bounding sphere touches.
+	*	Entities with EntityFlag::NODRAW aren't linked, and are never relevant.
+	*/
+	void LinkEntities( const CEntityList& entities, CInterestSets& sets ) const;
+
+private:
+	/**
+	*	Finds the map's tree and leafs.
+	*	@return The map's compressed visibility data.
+	*/
+	const uint8_t* UseMap( const CBSPFile& map, size_t& uiVisSize );
+
+private:
+	const bsp::Node_t* m_pNodes = nullptr;
+	size_t m_uiNodeCount = 0;
+
+	const bsp::Plane_t* m_pPlanes = nullptr;
+
+	const bsp::Leaf_t* m_pLeafs = nullptr;
+	size_t m_uiLeafCount = 0;
+
+	/**
+	*	Root of the world's tree, or -1 if the map has no nodes.
+	*/
+	int32_t m_iHeadNode = -1;
+
+private:
+	CMapVisibility( const CMapVisibility& ) = delete;
+	CMapVisibility& operator=( const CMapVisibility& ) = delete;
+};
+
+#endif //ENGINE_CMAPVISIBILITY_H
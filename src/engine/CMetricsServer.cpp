@@ -0,0 +1,429 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef WIN32
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "CMetricsRegistry.h"
+
+#include "CMetricsServer.h"
+
+const size_t CMetricsServer::MAX_CONNECTIONS;
+const size_t CMetricsServer::MAX_REQUEST_SIZE;
+const int CMetricsServer::TIMEOUT_MS;
+const int CMetricsServer::POLL_INTERVAL_MS;
+
+namespace
+{
+const size_t RECEIVE_CHUNK_SIZE = 2048;
+
+const char METRICS_CONTENT_TYPE[] = "text/plain; version=0.0.4; charset=utf-8";
+const char TEXT_CONTENT_TYPE[] = "text/plain; charset=utf-8";
+
+#ifdef WIN32
+using PollFD_t = WSAPOLLFD;
+
+const short POLL_READ = POLLRDNORM;
+const short POLL_WRITE = POLLWRNORM;
+
+int Poll( PollFD_t* pFDs, const size_t uiCount, const int iTimeoutMS )
+{
+	return WSAPoll( pFDs, static_cast<ULONG>( uiCount ), iTimeoutMS );
+}
+
+void CloseSocket( const CMetricsServer::Socket_t socket )
+{
+	closesocket( socket );
+}
+
+bool SetNonBlocking( const CMetricsServer::Socket_t socket )
+{
+	u_long uiNonBlocking = 1;
+
+	return ioctlsocket( socket, FIONBIO, &uiNonBlocking ) == 0;
+}
+
+bool WouldBlock()
+{
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+const int SEND_FLAGS = 0;
+#else
+using PollFD_t = pollfd;
+
+const short POLL_READ = POLLIN;
+const short POLL_WRITE = POLLOUT;
+
+int Poll( PollFD_t* pFDs, const size_t uiCount, const int iTimeoutMS )
+{
+	return poll( pFDs, static_cast<nfds_t>( uiCount ), iTimeoutMS );
+}
+
+void CloseSocket( const CMetricsServer::Socket_t socket )
+{
+	close( socket );
+}
+
+bool WouldBlock()
+{
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+//Closed connections must not raise SIGPIPE.
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#endif
+}
+
+CMetricsServer::~CMetricsServer()
+{
+	Stop();
+}
+
+bool CMetricsServer::Start( const uint16_t uiPort, CMetricsRegistry& registry )
+{
+	Stop();
+
+	m_pRegistry = &registry;
+
+#ifdef WIN32
+	WSADATA data;
+
+	if( WSAStartup( MAKEWORD( 2, 2 ), &data ) != 0 )
+		return false;
+
+	m_ListenSocket = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+
+	if( m_ListenSocket == INVALID_SOCKET )
+	{
+		WSACleanup();
+		return false;
+	}
+
+	m_bListening = true;
+
+	if( !SetNonBlocking( m_ListenSocket ) )
+	{
+		CloseSockets();
+		return false;
+	}
+#else
+	m_ListenSocket = socket( AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP );
+
+	if( m_ListenSocket < 0 )
+		return false;
+
+	m_bListening = true;
+
+	if( pipe2( m_WakePipe, O_NONBLOCK | O_CLOEXEC ) != 0 )
+	{
+		m_WakePipe[ 0 ] = m_WakePipe[ 1 ] = -1;
+		CloseSockets();
+		return false;
+	}
+#endif
+
+	//Allow restarting right away while old connections are in TIME_WAIT.
+	const int iReuse = 1;
+
+	setsockopt( m_ListenSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>( &iReuse ), sizeof( iReuse ) );
+
+	sockaddr_in address;
+
+	memset( &address, 0, sizeof( address ) );
+
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( INADDR_ANY );
+	address.sin_port = htons( uiPort );
+
+	if( bind( m_ListenSocket, reinterpret_cast<const sockaddr*>( &address ), sizeof( address ) ) != 0 ||
+		listen( m_ListenSocket, static_cast<int>( MAX_CONNECTIONS ) ) != 0 )
+	{
+		CloseSockets();
+		return false;
+	}
+
+	m_bStop = false;
+	m_Thread = std::thread( &CMetricsServer::Run, this );
+
+	return true;
+}
+
+void CMetricsServer::Stop()
+{
+	if( m_Thread.joinable() )
+	{
+		m_bStop = true;
+		Wake();
+
+		m_Thread.join();
+	}
+
+	CloseSockets();
+}
+
+void CMetricsServer::Run()
+{
+	std::vector<PollFD_t> fds;
+
+	while( !m_bStop )
+	{
+		fds.clear();
+
+		fds.push_back( { m_ListenSocket, POLL_READ, 0 } );
+
+#ifndef WIN32
+		fds.push_back( { m_WakePipe[ 0 ], POLL_READ, 0 } );
+#endif
+
+		const size_t uiFirstConnection = fds.size();
+
+		for( const auto& connection : m_Connections )
+		{
+			const short events = connection.bResponded ? POLL_WRITE : POLL_READ;
+
+			fds.push_back( { connection.socket, events, 0 } );
+		}
+
+		if( Poll( fds.data(), fds.size(), POLL_INTERVAL_MS ) < 0 )
+			continue;
+
+#ifndef WIN32
+		if( fds[ 1 ].revents )
+		{
+			char buffer[ 64 ];
+
+			while( read( m_WakePipe[ 0 ], buffer, sizeof( buffer ) ) > 0 )
+			{
+			}
+		}
+#endif
+
+		const auto now = std::chrono::steady_clock::now();
+
+		for( size_t uiIndex = 0; uiIndex < fds.size() - uiFirstConnection; ++uiIndex )
+		{
+			auto& connection = m_Connections[ uiIndex ];
+
+			if( !connection.bResponded && fds[ uiFirstConnection + uiIndex ].revents )
+				Receive( connection );
+
+			if( connection.bResponded )
+				Send( connection );
+
+			if( now - connection.acceptTime > std::chrono::milliseconds( TIMEOUT_MS ) )
+				connection.bClosed = true;
+		}
+
+		m_Connections.erase( std::remove_if( m_Connections.begin(), m_Connections.end(),
+			[]( const Connection_t& connection )
+			{
+				if( connection.bClosed )
+					CloseSocket( connection.socket );
+
+				return connection.bClosed;
+			}
+		), m_Connections.end() );
+
+		if( fds[ 0 ].revents )
+			AcceptConnections();
+	}
+}
+
+void CMetricsServer::AcceptConnections()
+{
+	while( true )
+	{
+#ifdef WIN32
+		const Socket_t socket = accept( m_ListenSocket, nullptr, nullptr );
+
+		if( socket == INVALID_SOCKET )
+			return;
+
+		if( !SetNonBlocking( socket ) )
+		{
+			CloseSocket( socket );
+			continue;
+		}
+#else
+		const Socket_t socket = accept4( m_ListenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC );
+
+		if( socket < 0 )
+			return;
+#endif
+
+		if( m_Connections.size() >= MAX_CONNECTIONS )
+		{
+			CloseSocket( socket );
+			continue;
+		}
+
+		Connection_t connection;
+
+		connection.socket = socket;
+		connection.acceptTime = std::chrono::steady_clock::now();
+
+		m_Connections.push_back( std::move( connection ) );
+	}
+}
+
+void CMetricsServer::Receive( Connection_t& connection )
+{
+	char buffer[ RECEIVE_CHUNK_SIZE ];
+
+	while( !connection.bClosed && !connection.bResponded )
+	{
+		const auto iResult = recv( connection.socket, buffer, sizeof( buffer ), 0 );
+
+		if( iResult <= 0 )
+		{
+			if( iResult == 0 || !WouldBlock() )
+				connection.bClosed = true;
+
+			return;
+		}
+
+		connection.szReceived.append( buffer, iResult );
+
+		//Requests have no body, so everything up to the end of the header is the request.
+		if( connection.szReceived.find( "\r\n\r\n" ) != std::string::npos )
+		{
+			ProcessRequest( connection );
+		}
+		else if( connection.szReceived.size() > MAX_REQUEST_SIZE )
+		{
+			QueueResponse( connection, "431 Request Header Fields Too Large", TEXT_CONTENT_TYPE, "Request too large\n" );
+		}
+	}
+}
+
+void CMetricsServer::Send( Connection_t& connection )
+{
+	while( !connection.bClosed && connection.uiSent < connection.szSend.size() )
+	{
+		const auto iResult = send( connection.socket, connection.szSend.data() + connection.uiSent,
+			static_cast<int>( connection.szSend.size() - connection.uiSent ), SEND_FLAGS );
+
+		if( iResult < 0 )
+		{
+			if( !WouldBlock() )
+				connection.bClosed = true;
+
+			return;
+		}
+
+		connection.uiSent += iResult;
+	}
+
+	connection.bClosed = true;
+}
+
+void CMetricsServer::ProcessRequest( Connection_t& connection )
+{
+	const auto& szRequest = connection.szReceived;
+
+	const size_t uiMethodEnd = szRequest.find( ' ' );
+	const size_t uiLineEnd = szRequest.find( "\r\n" );
+
+	if( uiMethodEnd == std::string::npos || uiMethodEnd > uiLineEnd )
+	{
+		QueueResponse( connection, "400 Bad Request", TEXT_CONTENT_TYPE, "Bad request\n" );
+		return;
+	}
+
+	const size_t uiPathEnd = szRequest.find_first_of( " ?\r", uiMethodEnd + 1 );
+
+	const std::string szMethod = szRequest.substr( 0, uiMethodEnd );
+	const std::string szPath = szRequest.substr( uiMethodEnd + 1, uiPathEnd - ( uiMethodEnd + 1 ) );
+
+	if( szPath != "/metrics" )
+	{
+		QueueResponse( connection, "404 Not Found", TEXT_CONTENT_TYPE, "Not found\n" );
+		return;
+	}
+
+	if( szMethod != "GET" )
+	{
+		QueueResponse( connection, "405 Method Not Allowed", TEXT_CONTENT_TYPE, "Method not allowed\n" );
+		return;
+	}
+
+	m_szBody.clear();
+
+	m_pRegistry->WriteText( m_szBody );
+
+	QueueResponse( connection, "200 OK", METRICS_CONTENT_TYPE, m_szBody );
+}
+
+void CMetricsServer::QueueResponse( Connection_t& connection, const char* pszStatus, const char* pszContentType, const std::string& szBody )
+{
+	char szHeader[ 256 ];
+
+	snprintf( szHeader, sizeof( szHeader ), "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %u\r\nConnection: close\r\n\r\n",
+		pszStatus, pszContentType, static_cast<unsigned int>( szBody.size() ) );
+
+	connection.szSend = szHeader;
+	connection.szSend += szBody;
+	connection.uiSent = 0;
+
+	connection.bResponded = true;
+
+	connection.szReceived.clear();
+	connection.szReceived.shrink_to_fit();
+}
+
+void CMetricsServer::Wake()
+{
+#ifndef WIN32
+	if( m_WakePipe[ 1 ] != -1 )
+	{
+		const char data = 0;
+
+		//If the pipe is full, the thread is already going to wake up.
+		const auto iResult = write( m_WakePipe[ 1 ], &data, sizeof( data ) );
+
+		( void ) iResult;
+	}
+#endif
+}
+
+void CMetricsServer::CloseSockets()
+{
+	for( const auto& connection : m_Connections )
+	{
+		CloseSocket( connection.socket );
+	}
+
+	m_Connections.clear();
+
+	if( m_bListening )
+	{
+		CloseSocket( m_ListenSocket );
+		m_bListening = false;
+
+#ifdef WIN32
+		WSACleanup();
+#endif
+	}
+
+#ifndef WIN32
+	for( auto& fd : m_WakePipe )
+	{
+		if( fd != -1 )
+		{
+			close( fd );
+			fd = -1;
+		}
+	}
+#endif
+}
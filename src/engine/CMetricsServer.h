@@ -0,0 +1,142 @@
+#ifndef ENGINE_CMETRICSSERVER_H
+#define ENGINE_CMETRICSSERVER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WIN32
+#include <winsock2.h>
+#endif
+
+class CMetricsRegistry;
+
+/**
+*	Minimal HTTP server that exports a metrics registry for Prometheus style scrapers.
+*	GET /metrics returns the registry in the text exposition format. Every response closes its connection.
+*	Connections are serviced by an I/O thread with non-blocking sockets, and metrics are formatted on that thread,
+*	so scrapes never block the frame.
+*/
+class CMetricsServer final
+{
+public:
+#ifdef WIN32
+	using Socket_t = SOCKET;
+#else
+	using Socket_t = int;
+#endif
+
+	/**
+	*	Maximum number of open connections. Others are closed right away.
+	*/
+	static const size_t MAX_CONNECTIONS = 8;
+
+	/**
+	*	Largest request header that is accepted.
+	*/
+	static const size_t MAX_REQUEST_SIZE = 8192;
+
+	/**
+	*	Connections that haven't sent a request and received the response within this time are closed.
+	*/
+	static const int TIMEOUT_MS = 10000;
+
+	/**
+	*	Longest time the I/O thread waits for the sockets before checking whether it should stop.
+	*/
+	static const int POLL_INTERVAL_MS = 100;
+
+	CMetricsServer() = default;
+
+	/**
+	*	Stops the server, if it is running.
+	*/
+	~CMetricsServer();
+
+	bool IsRunning() const { return m_Thread.joinable(); }
+
+	/**
+	*	Starts listening on a port, and starts the I/O thread. Stops the server first.
+	*	@param uiPort TCP port to listen on.
+	*	@param registry Metrics to export. Must outlive the server.
+	*/
+	bool Start( const uint16_t uiPort, CMetricsRegistry& registry );
+
+	/**
+	*	Closes all connections, and stops the I/O thread.
+	*/
+	void Stop();
+
+private:
+	struct Connection_t
+	{
+		Socket_t socket;
+
+		std::chrono::steady_clock::time_point acceptTime;
+
+		bool bClosed = false;
+
+		/**
+		*	Whether the request was answered, so the connection closes once the response was sent.
+		*/
+		bool bResponded = false;
+
+		std::string szReceived;
+
+		std::string szSend;
+		size_t uiSent = 0;
+	};
+
+	void Run();
+
+	void AcceptConnections();
+
+	void Receive( Connection_t& connection );
+
+	void Send( Connection_t& connection );
+
+	void ProcessRequest( Connection_t& connection );
+
+	void QueueResponse( Connection_t& connection, const char* pszStatus, const char* pszContentType, const std::string& szBody );
+
+	/**
+	*	Wakes up the I/O thread.
+	*/
+	void Wake();
+
+	void CloseSockets();
+
+private:
+	CMetricsRegistry* m_pRegistry = nullptr;
+
+	std::thread m_Thread;
+	std::atomic<bool> m_bStop{ false };
+
+	Socket_t m_ListenSocket;
+	bool m_bListening = false;
+
+#ifndef WIN32
+	/**
+	*	Pipe that wakes up the I/O thread when written to.
+	*/
+	int m_WakePipe[ 2 ] = { -1, -1 };
+#endif
+
+	//Only used by the I/O thread.
+	std::vector<Connection_t> m_Connections;
+
+	/**
+	*	Response body, kept so its memory is reused between scrapes.
+	*/
+	std::string m_szBody;
+
+private:
+	CMetricsServer( const CMetricsServer& ) = delete;
+	CMetricsServer& operator=( const CMetricsServer& ) = delete;
+};
+
+#endif //ENGINE_CMETRICSSERVER_H
@@ -0,0 +1,501 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "ByteSwap.h"
+
+#include "CModelFile.h"
+
+//The file formats have fixed layouts.
+static_assert( sizeof( studio::Header_t ) == 244, "Studio header doesn't match the file format" );
+static_assert( sizeof( studio::Bone_t ) == 112, "Studio bone doesn't match the file format" );
+static_assert( sizeof( studio::SeqGroup_t ) == 104, "Studio sequence group doesn't match the file format" );
+static_assert( sizeof( studio::SeqDesc_t ) == 176, "Studio sequence doesn't match the file format" );
+static_assert( sizeof( studio::Event_t ) == 76, "Studio event doesn't match the file format" );
+static_assert( sizeof( studio::Attachment_t ) == 88, "Studio attachment doesn't match the file format" );
+static_assert( sizeof( studio::BodyPart_t ) == 76, "Studio body part doesn't match the file format" );
+static_assert( sizeof( studio::Texture_t ) == 80, "Studio texture doesn't match the file format" );
+static_assert( sizeof( studio::Model_t ) == 112, "Studio model doesn't match the file format" );
+static_assert( sizeof( studio::Mesh_t ) == 20, "Studio mesh doesn't match the file format" );
+static_assert( sizeof( sprite::Header_t ) == 40, "Sprite header doesn't match the file format" );
+
+namespace
+{
+/**
+*	Alignment that the file must have to be used in place.
+*/
+const size_t FILE_ALIGNMENT = 4;
+
+/**
+*	Reads a structure from anywhere in the file.
+*/
+template<typename T>
+bool ReadAt( const uint8_t* pData, const size_t uiSize, size_t& uiOffset, T& value )
+{
+	if( uiSize - std::min( uiSize, uiOffset ) < sizeof( T ) )
+		return false;
+
+	memcpy( &value, pData + uiOffset, sizeof( T ) );
+
+	uiOffset += sizeof( T );
+
+	return true;
+}
+}
+
+CModelFile::~CModelFile()
+{
+	Unload();
+}
+
+bool CModelFile::Load( IFileSystem2& fileSystem, const char* pszFileName, const char* pszPathID )
+{
+	Unload();
+
+	m_pszError = "";
+
+#if !IS_LITTLE_ENDIAN
+	return Fail( "models are only supported on little endian systems" );
+#endif
+
+	m_pFileSystem = &fileSystem;
+
+	m_hFile = fileSystem.Open( pszFileName, "rb", pszPathID );
+
+	if( m_hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Unload();
+		return Fail( "couldn't open file" );
+	}
+
+	int iSize = 0;
+
+	m_pBuffer = static_cast<const uint8_t*>( fileSystem.GetReadBuffer( m_hFile, &iSize, false ) );
+
+	if( !m_pBuffer )
+	{
+		Unload();
+		return Fail( "couldn't read file" );
+	}
+
+	m_uiSize = static_cast<size_t>( iSize );
+
+	if( reinterpret_cast<uintptr_t>( m_pBuffer ) % FILE_ALIGNMENT == 0 )
+	{
+		m_pData = m_pBuffer;
+	}
+	else
+	{
+		m_Copy.reset( new uint8_t[ m_uiSize ] );
+		memcpy( m_Copy.get(), m_pBuffer, m_uiSize );
+
+		m_pData = m_Copy.get();
+	}
+
+	uint32_t uiIdent = 0;
+
+	if( m_uiSize >= sizeof( uiIdent ) )
+		memcpy( &uiIdent, m_pData, sizeof( uiIdent ) );
+
+	bool bLoaded;
+
+	if( uiIdent == studio::IDENT )
+	{
+		m_Type = Type::STUDIO;
+		bLoaded = ValidateStudio();
+	}
+	else if( uiIdent == sprite::IDENT )
+	{
+		m_Type = Type::SPRITE;
+		bLoaded = LoadSprite();
+	}
+	else
+	{
+		bLoaded = Fail( "not a studio model or sprite" );
+	}
+
+	if( !bLoaded )
+	{
+		const auto pszError = m_pszError;
+		Unload();
+		m_pszError = pszError;
+		return false;
+	}
+
+	return true;
+}
+
+void CModelFile::Unload()
+{
+	m_Type = Type::NONE;
+
+	m_SpriteHeader = {};
+	m_pPalette = nullptr;
+	m_uiPaletteColors = 0;
+	m_SpriteFrames.clear();
+	m_SpriteGroups.clear();
+
+	m_pData = nullptr;
+	m_Copy.reset();
+
+	if( m_pBuffer )
+	{
+		m_pFileSystem->ReleaseReadBuffer( m_hFile, const_cast<uint8_t*>( m_pBuffer ) );
+
+		m_pBuffer = nullptr;
+		m_uiSize = 0;
+	}
+
+	if( m_hFile != FILESYSTEM_INVALID_HANDLE )
+	{
+		m_pFileSystem->Close( m_hFile );
+		m_hFile = FILESYSTEM_INVALID_HANDLE;
+	}
+
+	m_pFileSystem = nullptr;
+}
+
+const CModelFile::SpriteFrame_t& CModelFile::GetSpriteFrame( const size_t uiFrame, const float flTime ) const
+{
+	const auto& group = m_SpriteGroups[ uiFrame ];
+
+	const SpriteFrame_t* pFrames = &m_SpriteFrames[ group.uiFirstFrame ];
+
+	if( group.uiFrameCount == 1 )
+		return pFrames[ 0 ];
+
+	//Groups loop, so find the time within the group.
+	const float flDuration = pFrames[ group.uiFrameCount - 1 ].flEndTime;
+	const float flGroupTime = std::max( 0.0f, flTime - static_cast<int>( flTime / flDuration ) * flDuration );
+
+	for( size_t uiIndex = 0; uiIndex < group.uiFrameCount - 1; ++uiIndex )
+	{
+		if( pFrames[ uiIndex ].flEndTime > flGroupTime )
+			return pFrames[ uiIndex ];
+	}
+
+	return pFrames[ group.uiFrameCount - 1 ];
+}
+
+bool CModelFile::ValidateStudio()
+{
+	using namespace studio;
+
+	if( m_uiSize < sizeof( Header_t ) )
+		return Fail( "file too small for header" );
+
+	const auto& header = GetStudioHeader();
+
+	if( header.version != VERSION )
+		return Fail( "wrong studio model version" );
+
+	if( header.length < 0 || static_cast<size_t>( header.length ) > m_uiSize )
+		return Fail( "file is truncated" );
+
+	if( !IsValidTable<Bone_t>( header.boneindex, header.numbones ) ||
+		!IsValidTable<BoneController_t>( header.bonecontrollerindex, header.numbonecontrollers ) ||
+		!IsValidTable<HitBox_t>( header.hitboxindex, header.numhitboxes ) ||
+		!IsValidTable<SeqDesc_t>( header.seqindex, header.numseq ) ||
+		!IsValidTable<SeqGroup_t>( header.seqgroupindex, header.numseqgroups ) ||
+		!IsValidTable<Texture_t>( header.textureindex, header.numtextures ) ||
+		!IsValidTable<int16_t>( header.skinindex, static_cast<int64_t>( header.numskinref ) * header.numskinfamilies ) ||
+		!IsValidTable<BodyPart_t>( header.bodypartindex, header.numbodyparts ) ||
+		!IsValidTable<Attachment_t>( header.attachmentindex, header.numattachments ) ||
+		!IsValidTable<uint8_t>( header.transitionindex, static_cast<int64_t>( header.numtransitions ) * header.numtransitions ) )
+	{
+		return Fail( "table out of range" );
+	}
+
+	if( header.numskinref < 0 || header.numskinfamilies < 0 )
+		return Fail( "bad skin table" );
+
+	//Bones are transformed in order, so parents come first.
+	const auto pBones = GetStudioData<Bone_t>( header.boneindex );
+
+	for( int32_t iBone = 0; iBone < header.numbones; ++iBone )
+	{
+		const auto& bone = pBones[ iBone ];
+
+		if( bone.parent < -1 || bone.parent >= iBone )
+			return Fail( "bad bone parent" );
+
+		for( const auto iController : bone.bonecontroller )
+		{
+			if( iController < -1 || iController >= header.numbonecontrollers )
+				return Fail( "bad bone controller" );
+		}
+	}
+
+	const auto pControllers = GetStudioData<BoneController_t>( header.bonecontrollerindex );
+
+	for( int32_t iController = 0; iController < header.numbonecontrollers; ++iController )
+	{
+		const auto& controller = pControllers[ iController ];
+
+		if( controller.bone < 0 || controller.bone >= header.numbones || controller.index < 0 ||
+			controller.index > MOUTH_CONTROLLER )
+			return Fail( "bad bone controller" );
+	}
+
+	const auto pHitBoxes = GetStudioData<HitBox_t>( header.hitboxindex );
+
+	for( int32_t iHitBox = 0; iHitBox < header.numhitboxes; ++iHitBox )
+	{
+		if( pHitBoxes[ iHitBox ].bone < 0 || pHitBoxes[ iHitBox ].bone >= header.numbones )
+			return Fail( "bad hitbox bone" );
+	}
+
+	const auto pSequences = GetStudioData<SeqDesc_t>( header.seqindex );
+
+	for( int32_t iSequence = 0; iSequence < header.numseq; ++iSequence )
+	{
+		const auto& sequence = pSequences[ iSequence ];
+
+		if( sequence.numframes < 1 || sequence.numblends < 1 || sequence.seqgroup < 0 || sequence.seqgroup >= header.numseqgroups )
+			return Fail( "bad sequence" );
+
+		if( !IsValidTable<Event_t>( sequence.eventindex, sequence.numevents ) ||
+			!IsValidTable<Pivot_t>( sequence.pivotindex, sequence.numpivots ) )
+			return Fail( "sequence table out of range" );
+
+		//Animations of other groups are in other files.
+		if( sequence.seqgroup == 0 && !IsValidTable<Anim_t>( sequence.animindex, static_cast<int64_t>( sequence.numblends ) * header.numbones ) )
+			return Fail( "sequence animation out of range" );
+	}
+
+	const auto pTextures = GetStudioData<Texture_t>( header.textureindex );
+
+	for( int32_t iTexture = 0; iTexture < header.numtextures; ++iTexture )
+	{
+		const auto& texture = pTextures[ iTexture ];
+
+		if( texture.width <= 0 || texture.height <= 0 ||
+			!IsValidTable<uint8_t>( texture.index, static_cast<int64_t>( texture.width ) * texture.height + PALETTE_SIZE ) )
+			return Fail( "texture out of range" );
+	}
+
+	//Skins may refer to textures in a separate texture file, which this file doesn't know the count of.
+	if( header.numtextures > 0 )
+	{
+		const auto pSkins = GetStudioData<int16_t>( header.skinindex );
+
+		for( int64_t iSkin = 0; iSkin < static_cast<int64_t>( header.numskinref ) * header.numskinfamilies; ++iSkin )
+		{
+			if( pSkins[ iSkin ] < 0 || pSkins[ iSkin ] >= header.numtextures )
+				return Fail( "bad skin texture" );
+		}
+	}
+
+	const auto pBodyParts = GetStudioData<BodyPart_t>( header.bodypartindex );
+
+	for( int32_t iBodyPart = 0; iBodyPart < header.numbodyparts; ++iBodyPart )
+	{
+		const auto& bodyPart = pBodyParts[ iBodyPart ];
+
+		if( bodyPart.nummodels < 1 || bodyPart.base < 1 || !IsValidTable<Model_t>( bodyPart.modelindex, bodyPart.nummodels ) )
+			return Fail( "body part out of range" );
+
+		const auto pModels = GetStudioData<Model_t>( bodyPart.modelindex );
+
+		for( int32_t iModel = 0; iModel < bodyPart.nummodels; ++iModel )
+		{
+			if( !ValidateStudioModel( pModels[ iModel ] ) )
+				return false;
+		}
+	}
+
+	const auto pAttachments = GetStudioData<Attachment_t>( header.attachmentindex );
+
+	for( int32_t iAttachment = 0; iAttachment < header.numattachments; ++iAttachment )
+	{
+		if( pAttachments[ iAttachment ].bone < 0 || pAttachments[ iAttachment ].bone >= header.numbones )
+			return Fail( "bad attachment bone" );
+	}
+
+	return true;
+}
+
+bool CModelFile::ValidateStudioModel( const studio::Model_t& model )
+{
+	using namespace studio;
+
+	const auto& header = GetStudioHeader();
+
+	if( !IsValidTable<Mesh_t>( model.meshindex, model.nummesh ) ||
+		!IsValidTable<float>( model.vertindex, static_cast<int64_t>( model.numverts ) * 3 ) ||
+		!IsValidTable<uint8_t>( model.vertinfoindex, model.numverts ) ||
+		!IsValidTable<float>( model.normindex, static_cast<int64_t>( model.numnorms ) * 3 ) ||
+		!IsValidTable<uint8_t>( model.norminfoindex, model.numnorms ) )
+		return Fail( "model table out of range" );
+
+	const auto pVertexBones = GetStudioData<uint8_t>( model.vertinfoindex );
+
+	for( int32_t iVertex = 0; iVertex < model.numverts; ++iVertex )
+	{
+		if( pVertexBones[ iVertex ] >= header.numbones )
+			return Fail( "bad vertex bone" );
+	}
+
+	const auto pNormalBones = GetStudioData<uint8_t>( model.norminfoindex );
+
+	for( int32_t iNormal = 0; iNormal < model.numnorms; ++iNormal )
+	{
+		if( pNormalBones[ iNormal ] >= header.numbones )
+			return Fail( "bad normal bone" );
+	}
+
+	const auto pMeshes = GetStudioData<Mesh_t>( model.meshindex );
+
+	for( int32_t iMesh = 0; iMesh < model.nummesh; ++iMesh )
+	{
+		const auto& mesh = pMeshes[ iMesh ];
+
+		if( mesh.skinref < 0 || mesh.skinref >= header.numskinref )
+			return Fail( "bad mesh skin" );
+
+		if( !ValidateTriangles( mesh, model ) )
+			return false;
+	}
+
+	return true;
+}
+
+bool CModelFile::ValidateTriangles( const studio::Mesh_t& mesh, const studio::Model_t& model )
+{
+	if( !IsValidTable<int16_t>( mesh.triindex, 1 ) )
+		return Fail( "mesh triangles out of range" );
+
+	//Each command is a vertex count, negative for fans, and then 4 values per vertex: vertex, normal, s and t.
+	const int16_t* pCommands = GetStudioData<int16_t>( mesh.triindex );
+	const int16_t* pEnd = reinterpret_cast<const int16_t*>( m_pData + m_uiSize - m_uiSize % sizeof( int16_t ) );
+
+	while( true )
+	{
+		if( pCommands >= pEnd )
+			return Fail( "mesh triangles aren't terminated" );
+
+		const int32_t iCount = std::abs( static_cast<int32_t>( *pCommands++ ) );
+
+		if( iCount == 0 )
+			return true;
+
+		if( pEnd - pCommands < iCount * 4 )
+			return Fail( "mesh triangles aren't terminated" );
+
+		for( int32_t iVertex = 0; iVertex < iCount; ++iVertex, pCommands += 4 )
+		{
+			if( pCommands[ 0 ] < 0 || pCommands[ 0 ] >= model.numverts || pCommands[ 1 ] < 0 || pCommands[ 1 ] >= model.numnorms )
+				return Fail( "bad triangle vertex" );
+		}
+	}
+}
+
+bool CModelFile::LoadSprite()
+{
+	using namespace sprite;
+
+	size_t uiOffset = 0;
+
+	if( !ReadAt( m_pData, m_uiSize, uiOffset, m_SpriteHeader ) )
+		return Fail( "file too small for header" );
+
+	if( m_SpriteHeader.version != VERSION )
+		return Fail( "wrong sprite version" );
+
+	if( m_SpriteHeader.numframes < 1 )
+		return Fail( "sprite has no frames" );
+
+	int16_t iColors;
+
+	if( !ReadAt( m_pData, m_uiSize, uiOffset, iColors ) || iColors <= 0 || iColors > 256 ||
+		m_uiSize - uiOffset < static_cast<size_t>( iColors ) * 3 )
+		return Fail( "bad palette" );
+
+	m_pPalette = m_pData + uiOffset;
+	m_uiPaletteColors = static_cast<size_t>( iColors );
+
+	uiOffset += m_uiPaletteColors * 3;
+
+	//Headers are copied since frames aren't aligned, pixels are used in place.
+	auto readFrame = [ & ]( const float flEndTime )
+	{
+		Frame_t frame;
+
+		if( !ReadAt( m_pData, m_uiSize, uiOffset, frame ) || frame.width <= 0 || frame.height <= 0 ||
+			static_cast<uint64_t>( frame.width ) * static_cast<uint64_t>( frame.height ) > m_uiSize - uiOffset )
+			return Fail( "sprite frame out of range" );
+
+		SpriteFrame_t spriteFrame;
+
+		spriteFrame.iOrigin[ 0 ] = frame.origin[ 0 ];
+		spriteFrame.iOrigin[ 1 ] = frame.origin[ 1 ];
+		spriteFrame.uiWidth = static_cast<uint32_t>( frame.width );
+		spriteFrame.uiHeight = static_cast<uint32_t>( frame.height );
+		spriteFrame.pPixels = m_pData + uiOffset;
+		spriteFrame.flEndTime = flEndTime;
+
+		m_SpriteFrames.push_back( spriteFrame );
+
+		uiOffset += spriteFrame.uiWidth * spriteFrame.uiHeight;
+
+		return true;
+	};
+
+	m_SpriteGroups.reserve( static_cast<size_t>( m_SpriteHeader.numframes ) );
+
+	for( int32_t iFrame = 0; iFrame < m_SpriteHeader.numframes; ++iFrame )
+	{
+		int32_t iType;
+
+		if( !ReadAt( m_pData, m_uiSize, uiOffset, iType ) )
+			return Fail( "sprite frame out of range" );
+
+		SpriteGroup_t spriteGroup;
+
+		spriteGroup.uiFirstFrame = m_SpriteFrames.size();
+
+		if( iType == FRAME_SINGLE )
+		{
+			if( !readFrame( 0 ) )
+				return false;
+
+			spriteGroup.uiFrameCount = 1;
+		}
+		else if( iType == FRAME_GROUP )
+		{
+			Group_t group;
+
+			if( !ReadAt( m_pData, m_uiSize, uiOffset, group ) || group.numframes < 1 ||
+				static_cast<uint64_t>( group.numframes ) * sizeof( float ) > m_uiSize - uiOffset )
+				return Fail( "sprite group out of range" );
+
+			size_t uiTimeOffset = uiOffset;
+
+			uiOffset += static_cast<size_t>( group.numframes ) * sizeof( float );
+
+			for( int32_t iGroupFrame = 0; iGroupFrame < group.numframes; ++iGroupFrame )
+			{
+				float flEndTime;
+
+				ReadAt( m_pData, m_uiSize, uiTimeOffset, flEndTime );
+
+				//The group's duration must not be 0.
+				if( !( flEndTime > 0 ) )
+					return Fail( "bad sprite group interval" );
+
+				if( !readFrame( flEndTime ) )
+					return false;
+			}
+
+			spriteGroup.uiFrameCount = static_cast<size_t>( group.numframes );
+		}
+		else
+		{
+			return Fail( "bad sprite frame type" );
+		}
+
+		m_SpriteGroups.push_back( spriteGroup );
+	}
+
+	return true;
+}
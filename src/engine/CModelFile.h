@@ -0,0 +1,226 @@
+#ifndef ENGINE_CMODELFILE_H
+#define ENGINE_CMODELFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "FileSystem2.h"
+
+#include "ModelFile.h"
+
+/**
+*	A studio model or sprite, loaded without copying it where possible.
+*	Like CBSPFile, the file is accessed through the filesystem's read buffer, which for mapped pack entries is the pack file's mapping,
+*	and studio models are used in place. The file is only copied if the buffer isn't aligned for its structures.
+*	Every table and every index between tables is validated on load, so users can index the model without checking.
+*	Sprite frames aren't aligned in the file, so their headers are decoded into an index, but their pixels are used in place.
+*	Models never change once loaded, so one model is shared by everything that uses it. The file is kept open until the model is unloaded.
+*	Only little endian systems are supported.
+*/
+class CModelFile final
+{
+public:
+	enum class Type
+	{
+		NONE = 0,
+		STUDIO,
+		SPRITE
+	};
+
+	struct SpriteFrame_t
+	{
+		int32_t iOrigin[ 2 ];
+		uint32_t uiWidth;
+		uint32_t uiHeight;
+
+		/**
+		*	8 bit pixels, indices into the palette.
+		*/
+		const uint8_t* pPixels;
+
+		/**
+		*	Time within its group at which the frame ends. 0 for frames that aren't in a group.
+		*/
+		float flEndTime;
+	};
+
+public:
+	CModelFile() = default;
+	~CModelFile();
+
+	/**
+	*	Loads a studio model or sprite, unloading the current one. The type is detected from the file's contents.
+	*	@return Whether the model was loaded. If not, GetError says why.
+	*/
+	bool Load( IFileSystem2& fileSystem, const char* pszFileName, const char* pszPathID = nullptr );
+
+	void Unload();
+
+	bool IsLoaded() const { return m_pData != nullptr; }
+
+	/**
+	*	@return Why the last Load failed, or an empty string if it didn't.
+	*/
+	const char* GetError() const { return m_pszError; }
+
+	Type GetType() const { return m_Type; }
+
+	/**
+	*	@return Size of the file.
+	*/
+	size_t GetSize() const { return m_uiSize; }
+
+	/**
+	*	@return Number of bytes of the file that had to be copied. 0 if it's used where it's stored.
+	*/
+	size_t GetCopiedBytes() const { return m_Copy ? m_uiSize : 0; }
+
+	/**
+	*	@return The studio model's header. Tables are at their offsets from it.
+	*/
+	const studio::Header_t& GetStudioHeader() const
+	{
+		return *reinterpret_cast<const studio::Header_t*>( m_pData );
+	}
+
+	/**
+	*	@return A table in the studio model, at an offset from the header.
+	*/
+	template<typename T>
+	const T* GetStudioData( const int32_t iOffset ) const
+	{
+		return reinterpret_cast<const T*>( m_pData + iOffset );
+	}
+
+	const sprite::Header_t& GetSpriteHeader() const { return m_SpriteHeader; }
+
+	/**
+	*	@return The sprite's palette, as RGB bytes.
+	*/
+	const uint8_t* GetSpritePalette( size_t& uiColors ) const
+	{
+		uiColors = m_uiPaletteColors;
+
+		return m_pPalette;
+	}
+
+	/**
+	*	@return Number of frames of the sprite, counting each group as one frame.
+	*/
+	size_t GetSpriteFrameCount() const { return m_SpriteGroups.size(); }
+
+	/**
+	*	Gets a sprite frame. Frames that are groups are animated by time.
+	*	@param uiFrame Frame index, less than GetSpriteFrameCount.
+	*	@param flTime Time used to pick a frame within a group.
+	*/
+	const SpriteFrame_t& GetSpriteFrame( const size_t uiFrame, const float flTime ) const;
+
+private:
+	/**
+	*	Range of m_SpriteFrames that makes up one frame of the sprite.
+	*/
+	struct SpriteGroup_t
+	{
+		size_t uiFirstFrame;
+		size_t uiFrameCount;
+	};
+
+	/**
+	*	@return Whether a table of iCount elements at iOffset lies within the file, and is aligned.
+	*/
+	template<typename T>
+	bool IsValidTable( const int32_t iOffset, const int64_t iCount ) const
+	{
+		return iOffset >= 0 && iCount >= 0 && iOffset % alignof( T ) == 0 &&
+			static_cast<uint64_t>( iOffset ) + static_cast<uint64_t>( iCount ) * sizeof( T ) <= m_uiSize;
+	}
+
+	bool ValidateStudio();
+
+	/**
+	*	Checks that a model's vertices, normals and meshes lie within the file and only reference bones, skins, vertices and normals that exist.
+	*/
+	bool ValidateStudioModel( const studio::Model_t& model );
+
+	/**
+	*	Checks that a mesh's triangle commands end within the file and only reference the model's vertices and normals.
+	*/
+	bool ValidateTriangles( const studio::Mesh_t& mesh, const studio::Model_t& model );
+
+	bool LoadSprite();
+
+	bool Fail( const char* pszError )
+	{
+		m_pszError = pszError;
+		return false;
+	}
+
+private:
+	IFileSystem2* m_pFileSystem = nullptr;
+
+	FileHandle_t m_hFile = FILESYSTEM_INVALID_HANDLE;
+
+	/**
+	*	The whole file, from GetReadBuffer.
+	*/
+	const uint8_t* m_pBuffer = nullptr;
+
+	/**
+	*	The file as it's used. Either m_pBuffer or m_Copy.
+	*/
+	const uint8_t* m_pData = nullptr;
+	size_t m_uiSize = 0;
+
+	/**
+	*	Aligned copy of the file, if the buffer wasn't aligned.
+	*/
+	std::unique_ptr<uint8_t[]> m_Copy;
+
+	Type m_Type = Type::NONE;
+
+	sprite::Header_t m_SpriteHeader = {};
+
+	const uint8_t* m_pPalette = nullptr;
+	size_t m_uiPaletteColors = 0;
+
+	std::vector<SpriteFrame_t> m_SpriteFrames;
+	std::vector<SpriteGroup_t> m_SpriteGroups;
+
+	const char* m_pszError = "";
+
+private:
+	CModelFile( const CModelFile& ) = delete;
+	CModelFile& operator=( const CModelFile& ) = delete;
+};
+
+/**
+*	Reference to a loaded model. Models are immutable, so every entity that uses one shares it.
+*/
+using ModelHandle_t = std::shared_ptr<const CModelFile>;
+
+/**
+*	The state of one use of a model. This is all that is allocated per entity, the model itself is shared.
+*/
+struct ModelInstance_t
+{
+	ModelHandle_t model;
+
+	int32_t iSequence = 0;
+
+	/**
+	*	Frame of the sequence, or of the sprite.
+	*/
+	float flFrame = 0;
+
+	uint8_t controller[ 4 ] = {};
+	uint8_t blending[ studio::MAX_BLENDS ] = {};
+	uint8_t mouth = 0;
+
+	int32_t iBody = 0;
+	int32_t iSkin = 0;
+};
+
+#endif //ENGINE_CMODELFILE_H
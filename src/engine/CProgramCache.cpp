@@ -0,0 +1,216 @@
+#include <cstring>
+
+#include "CRC32C.h"
+#include "FileSystem2.h"
+#include "Logging.h"
+
+#include "GLUtils.h"
+
+#include "CProgramCache.h"
+
+namespace
+{
+/**
+*	"HLPB", little endian.
+*/
+const uint32_t PROGRAM_BINARY_ID = 'H' | ( 'L' << 8 ) | ( 'P' << 16 ) | ( 'B' << 24 );
+
+/**
+*	Increment when the file layout changes.
+*/
+const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+/**
+*	Binaries larger than this are assumed to be corrupt.
+*/
+const uint32_t MAX_BINARY_LENGTH = 16 * 1024 * 1024;
+
+const char* GetGLString( const GLenum name )
+{
+	const char* pszString = reinterpret_cast<const char*>( glGetString( name ) );
+
+	return pszString ? pszString : "";
+}
+}
+
+const char CProgramCache::DIRECTORY[] = "cache/shaders";
+
+bool CProgramCache::Initialize( IFileSystem2* pFileSystem )
+{
+	Shutdown();
+
+	if( !pFileSystem )
+		return false;
+
+	if( !GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary )
+		return false;
+
+	//Drivers are allowed to support the entry points without supporting any formats.
+	GLint iNumFormats = 0;
+
+	glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &iNumFormats );
+
+	if( iNumFormats <= 0 )
+		return false;
+
+	m_szDriver = GetGLString( GL_VENDOR );
+	m_szDriver += '\n';
+	m_szDriver += GetGLString( GL_RENDERER );
+	m_szDriver += '\n';
+	m_szDriver += GetGLString( GL_VERSION );
+
+	pFileSystem->CreateDirHierarchy( DIRECTORY, nullptr );
+
+	m_pFileSystem = pFileSystem;
+
+	return true;
+}
+
+void CProgramCache::Shutdown()
+{
+	m_pFileSystem = nullptr;
+
+	m_szDriver.clear();
+
+	m_Binary.clear();
+	m_Binary.shrink_to_fit();
+}
+
+GLuint CProgramCache::CreateProgram( const char* pszName, const char* pszVertexSource, const char* pszFragmentSource )
+{
+	if( !m_pFileSystem )
+		return gl::CreateProgram( pszName, pszVertexSource, pszFragmentSource );
+
+	const std::string szFileName = std::string( DIRECTORY ) + '/' + pszName + ".bin";
+
+	Header_t header;
+
+	MakeHeader( header, pszVertexSource, pszFragmentSource );
+
+	GLuint program = Load( szFileName, header );
+
+	if( program )
+		return program;
+
+	program = gl::CreateProgram( pszName, pszVertexSource, pszFragmentSource, true );
+
+	if( program )
+		Save( szFileName, header, program );
+
+	return program;
+}
+
+void CProgramCache::MakeHeader( Header_t& header, const char* pszVertexSource, const char* pszFragmentSource ) const
+{
+	memset( &header, 0, sizeof( header ) );
+
+	header.uiID = PROGRAM_BINARY_ID;
+	header.uiVersion = PROGRAM_BINARY_VERSION;
+
+	header.uiVertexLength = static_cast<uint32_t>( strlen( pszVertexSource ) );
+	header.uiVertexCRC = crc32c::Compute( pszVertexSource, header.uiVertexLength );
+	header.uiFragmentLength = static_cast<uint32_t>( strlen( pszFragmentSource ) );
+	header.uiFragmentCRC = crc32c::Compute( pszFragmentSource, header.uiFragmentLength );
+
+	header.uiDriverLength = static_cast<uint32_t>( m_szDriver.length() );
+}
+
+GLuint CProgramCache::Load( const std::string& szFileName, const Header_t& expected )
+{
+	if( !m_pFileSystem->FileExists( szFileName.c_str() ) )
+		return 0;
+
+	FileHandle_t hFile = m_pFileSystem->Open( szFileName.c_str(), "rb" );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+		return 0;
+
+	Header_t header;
+
+	bool bValid = m_pFileSystem->Read( &header, sizeof( header ), hFile ) == static_cast<int>( sizeof( header ) );
+
+	//The format and length are the only fields that aren't known up front.
+	if( bValid )
+	{
+		bValid = header.uiID == expected.uiID && header.uiVersion == expected.uiVersion &&
+			header.uiVertexCRC == expected.uiVertexCRC && header.uiVertexLength == expected.uiVertexLength &&
+			header.uiFragmentCRC == expected.uiFragmentCRC && header.uiFragmentLength == expected.uiFragmentLength &&
+			header.uiDriverLength == expected.uiDriverLength &&
+			header.uiBinaryLength > 0 && header.uiBinaryLength <= MAX_BINARY_LENGTH;
+	}
+
+	if( bValid )
+	{
+		m_Binary.resize( header.uiDriverLength + header.uiBinaryLength );
+
+		const int iSize = static_cast<int>( m_Binary.size() );
+
+		bValid = m_pFileSystem->Read( m_Binary.data(), iSize, hFile ) == iSize &&
+			!memcmp( m_Binary.data(), m_szDriver.data(), header.uiDriverLength );
+	}
+
+	m_pFileSystem->Close( hFile );
+
+	if( !bValid )
+		return 0;
+
+	GLuint program = glCreateProgram();
+
+	glProgramBinary( program, header.uiFormat, m_Binary.data() + header.uiDriverLength, static_cast<GLsizei>( header.uiBinaryLength ) );
+
+	GLint iStatus = GL_FALSE;
+
+	glGetProgramiv( program, GL_LINK_STATUS, &iStatus );
+
+	//Drivers reject binaries for any reason, such as a different GPU in the same family. Not an error, it's just compiled again.
+	if( iStatus != GL_TRUE )
+	{
+		glDeleteProgram( program );
+		program = 0;
+	}
+
+	return program;
+}
+
+void CProgramCache::Save( const std::string& szFileName, Header_t& header, const GLuint program )
+{
+	GLint iLength = 0;
+
+	glGetProgramiv( program, GL_PROGRAM_BINARY_LENGTH, &iLength );
+
+	if( iLength <= 0 || static_cast<uint32_t>( iLength ) > MAX_BINARY_LENGTH )
+		return;
+
+	m_Binary.resize( static_cast<size_t>( iLength ) );
+
+	GLsizei iWritten = 0;
+	GLenum format = 0;
+
+	glGetProgramBinary( program, iLength, &iWritten, &format, m_Binary.data() );
+
+	if( iWritten <= 0 )
+		return;
+
+	header.uiFormat = format;
+	header.uiBinaryLength = static_cast<uint32_t>( iWritten );
+
+	FileHandle_t hFile = m_pFileSystem->Open( szFileName.c_str(), "wb" );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Warning( "CProgramCache: Couldn't create \"%s\"\n", szFileName.c_str() );
+		return;
+	}
+
+	const int iDriverLength = static_cast<int>( m_szDriver.length() );
+
+	const bool bWritten = m_pFileSystem->Write( &header, sizeof( header ), hFile ) == static_cast<int>( sizeof( header ) ) &&
+		m_pFileSystem->Write( m_szDriver.data(), iDriverLength, hFile ) == iDriverLength &&
+		m_pFileSystem->Write( m_Binary.data(), iWritten, hFile ) == iWritten;
+
+	m_pFileSystem->Close( hFile );
+
+	//A partial file is rejected when it's loaded, so there's nothing to clean up.
+	if( !bWritten )
+		Warning( "CProgramCache: Couldn't write \"%s\"\n", szFileName.c_str() );
+}
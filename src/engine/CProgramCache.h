@@ -0,0 +1,96 @@
+#ifndef ENGINE_CPROGRAMCACHE_H
+#define ENGINE_CPROGRAMCACHE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+class IFileSystem2;
+
+/**
+*	Caches linked shader programs on disk, so later launches load their binaries instead of compiling them.
+*	Each program is stored in its own file, along with checksums of its sources and the vendor, renderer and version strings of the driver
+*	that created it. A binary is only loaded if all of them match and the driver accepts it, otherwise the program is compiled and the file replaced.
+*	Needs OpenGL 4.1 or ARB_get_program_binary, and a driver that supports at least one binary format. Without them, programs are always compiled.
+*	Must only be used on the thread that owns the OpenGL context.
+*/
+class CProgramCache final
+{
+public:
+	/**
+	*	Directory that binaries are stored in, relative to the game directory.
+	*/
+	static const char DIRECTORY[];
+
+	CProgramCache() = default;
+
+	/**
+	*	Checks whether binaries are supported, and identifies the driver. Call once the context is current.
+	*	@param pFileSystem Filesystem that binaries are read and written through, or null to always compile programs. Must outlive the cache.
+	*	@return Whether programs are cached.
+	*/
+	bool Initialize( IFileSystem2* pFileSystem );
+
+	void Shutdown();
+
+	bool IsEnabled() const { return m_pFileSystem != nullptr; }
+
+	/**
+	*	Loads a program from the cache, or compiles and links it and adds it to the cache.
+	*	@copydetails gl::CreateProgram
+	*/
+	GLuint CreateProgram( const char* pszName, const char* pszVertexSource, const char* pszFragmentSource );
+
+private:
+	/**
+	*	Stored at the start of each file, followed by the driver string and the binary.
+	*/
+	struct Header_t
+	{
+		uint32_t uiID;
+		uint32_t uiVersion;
+
+		uint32_t uiVertexCRC;
+		uint32_t uiVertexLength;
+		uint32_t uiFragmentCRC;
+		uint32_t uiFragmentLength;
+
+		uint32_t uiDriverLength;
+
+		uint32_t uiFormat;
+		uint32_t uiBinaryLength;
+	};
+
+	/**
+	*	Fills in the parts of a header that identify the sources and the driver.
+	*/
+	void MakeHeader( Header_t& header, const char* pszVertexSource, const char* pszFragmentSource ) const;
+
+	/**
+	*	@return The program stored in a file, or 0 if it doesn't exist, is stale, or the driver rejected it.
+	*/
+	GLuint Load( const std::string& szFileName, const Header_t& expected );
+
+	void Save( const std::string& szFileName, Header_t& header, const GLuint program );
+
+private:
+	IFileSystem2* m_pFileSystem = nullptr;
+
+	/**
+	*	Vendor, renderer and version of the driver. Binaries are only valid for the driver that created them.
+	*/
+	std::string m_szDriver;
+
+	/**
+	*	Binary being read or written.
+	*/
+	std::vector<uint8_t> m_Binary;
+
+private:
+	CProgramCache( const CProgramCache& ) = delete;
+	CProgramCache& operator=( const CProgramCache& ) = delete;
+};
+
+#endif //ENGINE_CPROGRAMCACHE_H
@@ -0,0 +1,284 @@
+#include <cstring>
+
+#include "CProgramCache.h"
+#include "GLUtils.h"
+
+#include "CQuadBatch.h"
+
+namespace
+{
+const char QUAD_VERTEX_SHADER[] =
+	"#version 330 core\n"
+	"layout( std140 ) uniform Projection\n"
+	"{\n"
+	"	vec4 scaleOffset;\n"
+	"};\n"
+	"layout( location = 0 ) in vec2 position;\n"
+	"layout( location = 1 ) in vec2 texCoord;\n"
+	"layout( location = 2 ) in vec4 color;\n"
+	"out vec2 vTexCoord;\n"
+	"out vec4 vColor;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = vec4( position * scaleOffset.xy + scaleOffset.zw, 0.0, 1.0 );\n"
+	"	vTexCoord = texCoord;\n"
+	"	vColor = color;\n"
+	"}\n";
+
+//Same as the fixed function GL_MODULATE texture environment.
+const char QUAD_FRAGMENT_SHADER[] =
+	"#version 330 core\n"
+	"uniform sampler2D tex;\n"
+	"in vec2 vTexCoord;\n"
+	"in vec4 vColor;\n"
+	"out vec4 fragColor;\n"
+	"void main()\n"
+	"{\n"
+	"	fragColor = texture( tex, vTexCoord ) * vColor;\n"
+	"}\n";
+
+const GLuint PROJECTION_BINDING = 0;
+}
+
+bool CQuadBatch::Initialize( gl::CStateCache& state, CProgramCache& programCache, const bool bCoreProfile )
+{
+	m_pState = &state;
+
+	m_bCoreProfile = bCoreProfile;
+
+	m_iProjectionWidth = 0;
+	m_iProjectionHeight = 0;
+
+	const GLubyte ubWhite[ 4 ] = { 255, 255, 255, 255 };
+
+	glGenTextures( 1, &m_WhiteTexture );
+
+	m_pState->BindTexture( m_WhiteTexture );
+
+	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, ubWhite );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+
+	//Vertex buffers are core since 1.5. Without them, draw straight from m_Vertices.
+	if( GLEW_VERSION_1_5 )
+		glGenBuffers( 1, &m_VertexBuffer );
+
+	//Enough for a typical menu, grows as needed.
+	m_Vertices.reserve( 6 * 1024 );
+
+	if( !m_bCoreProfile )
+	{
+		//Translations are applied to vertices, so the modelview matrix is always the identity.
+		glMatrixMode( GL_MODELVIEW );
+		glLoadIdentity();
+
+		return true;
+	}
+
+	m_Program = programCache.CreateProgram( "quad", QUAD_VERTEX_SHADER, QUAD_FRAGMENT_SHADER );
+
+	if( !m_Program )
+		return false;
+
+	glUniformBlockBinding( m_Program, glGetUniformBlockIndex( m_Program, "Projection" ), PROJECTION_BINDING );
+
+	glGenBuffers( 1, &m_ProjectionBuffer );
+
+	glBindBuffer( GL_UNIFORM_BUFFER, m_ProjectionBuffer );
+	glBufferData( GL_UNIFORM_BUFFER, sizeof( GLfloat ) * 4, nullptr, GL_DYNAMIC_DRAW );
+	glBindBufferBase( GL_UNIFORM_BUFFER, PROJECTION_BINDING, m_ProjectionBuffer );
+
+	//Attribute pointers refer to the buffer object, so orphaning its storage doesn't affect them.
+	glGenVertexArrays( 1, &m_VertexArray );
+	glBindVertexArray( m_VertexArray );
+
+	m_pState->BindBuffer( GL_ARRAY_BUFFER, m_VertexBuffer );
+
+	glEnableVertexAttribArray( 0 );
+	glEnableVertexAttribArray( 1 );
+	glEnableVertexAttribArray( 2 );
+
+	glVertexAttribPointer( 0, 2, GL_FLOAT, GL_FALSE, sizeof( Vertex_t ), reinterpret_cast<const void*>( offsetof( Vertex_t, flPos ) ) );
+	glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, sizeof( Vertex_t ), reinterpret_cast<const void*>( offsetof( Vertex_t, flTexCoord ) ) );
+	glVertexAttribPointer( 2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof( Vertex_t ), reinterpret_cast<const void*>( offsetof( Vertex_t, ubColor ) ) );
+
+	//Only the world draws with anything else, and it rebinds these when it's done.
+	glUseProgram( m_Program );
+
+	return true;
+}
+
+void CQuadBatch::Shutdown()
+{
+	m_Vertices.clear();
+	m_Batches.clear();
+
+	if( m_VertexArray )
+	{
+		glBindVertexArray( 0 );
+		glDeleteVertexArrays( 1, &m_VertexArray );
+		m_VertexArray = 0;
+	}
+
+	if( m_ProjectionBuffer )
+	{
+		glDeleteBuffers( 1, &m_ProjectionBuffer );
+		m_ProjectionBuffer = 0;
+	}
+
+	if( m_Program )
+	{
+		glUseProgram( 0 );
+		glDeleteProgram( m_Program );
+		m_Program = 0;
+	}
+
+	if( m_VertexBuffer )
+	{
+		glDeleteBuffers( 1, &m_VertexBuffer );
+		m_pState->BufferDeleted( m_VertexBuffer );
+		m_VertexBuffer = 0;
+		m_uiBufferCapacity = 0;
+	}
+
+	if( m_WhiteTexture )
+	{
+		glDeleteTextures( 1, &m_WhiteTexture );
+		m_pState->TextureDeleted( m_WhiteTexture );
+		m_WhiteTexture = 0;
+	}
+}
+
+void CQuadBatch::SetProjection( const int iWidth, const int iHeight )
+{
+	if( iWidth == m_iProjectionWidth && iHeight == m_iProjectionHeight )
+		return;
+
+	Flush();
+
+	if( m_bCoreProfile )
+	{
+		//Scale and offset to clip space, flipped so Y points down.
+		const GLfloat flScaleOffset[ 4 ] =
+		{
+			2.0f / iWidth, -2.0f / iHeight,
+			-1.0f, 1.0f
+		};
+
+		glBindBuffer( GL_UNIFORM_BUFFER, m_ProjectionBuffer );
+		glBufferSubData( GL_UNIFORM_BUFFER, 0, sizeof( flScaleOffset ), flScaleOffset );
+	}
+	else
+	{
+		glMatrixMode( GL_PROJECTION );
+		glLoadIdentity();
+
+		glOrtho( 0.0f, static_cast<float>( iWidth ), static_cast<float>( iHeight ), 0.0f, 1.0f, -1.0f );
+
+		glMatrixMode( GL_MODELVIEW );
+	}
+
+	m_iProjectionWidth = iWidth;
+	m_iProjectionHeight = iHeight;
+}
+
+void CQuadBatch::AddQuad( GLuint texture,
+						  const float x0, const float y0, const float x1, const float y1,
+						  const float s0, const float t0, const float s1, const float t1,
+						  const GLubyte* pubColor )
+{
+	if( !texture )
+		texture = m_WhiteTexture;
+
+	if( m_Batches.empty() || m_Batches.back().texture != texture )
+		m_Batches.push_back( { texture, static_cast<GLint>( m_Vertices.size() ), 0 } );
+
+	const Vertex_t corners[ 4 ] =
+	{
+		{ { x0, y0 }, { s0, t0 }, { pubColor[ 0 ], pubColor[ 1 ], pubColor[ 2 ], pubColor[ 3 ] } },
+		{ { x1, y0 }, { s1, t0 }, { pubColor[ 0 ], pubColor[ 1 ], pubColor[ 2 ], pubColor[ 3 ] } },
+		{ { x0, y1 }, { s0, t1 }, { pubColor[ 0 ], pubColor[ 1 ], pubColor[ 2 ], pubColor[ 3 ] } },
+		{ { x1, y1 }, { s1, t1 }, { pubColor[ 0 ], pubColor[ 1 ], pubColor[ 2 ], pubColor[ 3 ] } }
+	};
+
+	//Two triangles, so quads don't need to be separate strips.
+	m_Vertices.push_back( corners[ 0 ] );
+	m_Vertices.push_back( corners[ 1 ] );
+	m_Vertices.push_back( corners[ 2 ] );
+	m_Vertices.push_back( corners[ 2 ] );
+	m_Vertices.push_back( corners[ 1 ] );
+	m_Vertices.push_back( corners[ 3 ] );
+
+	m_Batches.back().iVertexCount += 6;
+
+	++m_Stats.uiQuads;
+}
+
+void CQuadBatch::Flush()
+{
+	if( m_Vertices.empty() )
+		return;
+
+	const size_t uiSize = m_Vertices.size() * sizeof( Vertex_t );
+
+	const uint8_t* pBase;
+
+	if( m_VertexBuffer )
+	{
+		m_pState->BindBuffer( GL_ARRAY_BUFFER, m_VertexBuffer );
+
+		//Orphan the previous contents so the driver doesn't have to wait for draws that still use them.
+		if( uiSize > m_uiBufferCapacity )
+			m_uiBufferCapacity = uiSize * 2;
+
+		glBufferData( GL_ARRAY_BUFFER, m_uiBufferCapacity, nullptr, GL_STREAM_DRAW );
+		glBufferSubData( GL_ARRAY_BUFFER, 0, uiSize, m_Vertices.data() );
+
+		pBase = nullptr;
+	}
+	else
+	{
+		pBase = reinterpret_cast<const uint8_t*>( m_Vertices.data() );
+	}
+
+	//The vertex array object has the attribute setup in the core profile.
+	if( !m_bCoreProfile )
+	{
+		//Nothing else draws with vertex arrays, so they're left enabled.
+		m_pState->SetEnabled( GL_VERTEX_ARRAY, true );
+		m_pState->SetEnabled( GL_TEXTURE_COORD_ARRAY, true );
+		m_pState->SetEnabled( GL_COLOR_ARRAY, true );
+
+		glVertexPointer( 2, GL_FLOAT, sizeof( Vertex_t ), pBase + offsetof( Vertex_t, flPos ) );
+		glTexCoordPointer( 2, GL_FLOAT, sizeof( Vertex_t ), pBase + offsetof( Vertex_t, flTexCoord ) );
+		glColorPointer( 4, GL_UNSIGNED_BYTE, sizeof( Vertex_t ), pBase + offsetof( Vertex_t, ubColor ) );
+	}
+
+	for( const auto& batch : m_Batches )
+	{
+		m_pState->BindTexture( batch.texture );
+
+		glDrawArrays( GL_TRIANGLES, batch.iFirstVertex, batch.iVertexCount );
+	}
+
+	m_Stats.uiDrawCalls += m_Batches.size();
+
+	m_Vertices.clear();
+	m_Batches.clear();
+}
+
+void CQuadBatch::TakeStats( Stats_t& stats )
+{
+	stats = m_Stats;
+
+	m_Stats = Stats_t();
+}
+
+void CQuadBatch::Bind()
+{
+	if( !m_bCoreProfile )
+		return;
+
+	glUseProgram( m_Program );
+	glBindVertexArray( m_VertexArray );
+}
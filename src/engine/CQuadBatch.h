@@ -0,0 +1,134 @@
+#ifndef ENGINE_CQUADBATCH_H
+#define ENGINE_CQUADBATCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "MemoryTracking.h"
+
+class CProgramCache;
+
+namespace gl
+{
+class CStateCache;
+}
+
+/**
+*	Collects 2D quads and draws them with as few draw calls as possible.
+*	Untextured quads use a white texture, so all quads can share a batch. Consecutive quads with the same texture
+*	are merged into one draw call. Quads are never reordered, so overlapping quads keep drawing in order.
+*	Vertices are streamed through a vertex buffer if available, vertex arrays otherwise.
+*	With a core profile context, quads are drawn with a shader, a vertex array object, and a uniform buffer for the projection.
+*	Otherwise the fixed function pipeline is used.
+*	Must only be used on the thread that owns the OpenGL context.
+*/
+class CQuadBatch final
+{
+public:
+	struct Vertex_t
+	{
+		GLfloat flPos[ 2 ];
+		GLfloat flTexCoord[ 2 ];
+		GLubyte ubColor[ 4 ];
+	};
+
+	struct Stats_t
+	{
+		size_t uiQuads = 0;
+		size_t uiDrawCalls = 0;
+	};
+
+public:
+	CQuadBatch() = default;
+
+	/**
+	*	@param state State cache that all state changes go through.
+	*	@param programCache Cache that the shaders are created through.
+	*	@param bCoreProfile Whether the context is a core profile context.
+	*	@return Whether the shaders could be created, if they're needed.
+	*/
+	bool Initialize( gl::CStateCache& state, CProgramCache& programCache, const bool bCoreProfile );
+
+	void Shutdown();
+
+	/**
+	*	@return Texture to use for untextured quads.
+	*/
+	GLuint GetWhiteTexture() const { return m_WhiteTexture; }
+
+	/**
+	*	Maps 2D coordinates to the viewport, with the origin at the top left. Flushes if the size changed.
+	*/
+	void SetProjection( const int iWidth, const int iHeight );
+
+	/**
+	*	Adds a quad.
+	*	@param texture Texture to draw with. 0 for the white texture.
+	*/
+	void AddQuad( GLuint texture,
+				  const float x0, const float y0, const float x1, const float y1,
+				  const float s0, const float t0, const float s1, const float t1,
+				  const GLubyte* pubColor );
+
+	/**
+	*	Draws all quads that were added. Must be called before any OpenGL state that affects them changes.
+	*/
+	void Flush();
+
+	/**
+	*	Gets the statistics since they were last reset, and resets them.
+	*/
+	void TakeStats( Stats_t& stats );
+
+	/**
+	*	Puts the quad batch's program and vertex array object back in use, after something else drew with its own.
+	*	Does nothing without a core profile context.
+	*/
+	void Bind();
+
+private:
+	struct Batch_t
+	{
+		GLuint texture;
+		GLint iFirstVertex;
+		GLsizei iVertexCount;
+	};
+
+private:
+	gl::CStateCache* m_pState = nullptr;
+
+	bool m_bCoreProfile = false;
+
+	GLuint m_WhiteTexture = 0;
+
+	/**
+	*	Core profile objects.
+	*/
+	GLuint m_Program = 0;
+	GLuint m_VertexArray = 0;
+	GLuint m_ProjectionBuffer = 0;
+
+	/**
+	*	Size that the projection was set up for.
+	*/
+	int m_iProjectionWidth = 0;
+	int m_iProjectionHeight = 0;
+
+	GLuint m_VertexBuffer = 0;
+
+	size_t m_uiBufferCapacity = 0;
+
+	TrackedVector_t<Vertex_t, MemoryTag::RENDER> m_Vertices;
+	TrackedVector_t<Batch_t, MemoryTag::RENDER> m_Batches;
+
+	Stats_t m_Stats;
+
+private:
+	CQuadBatch( const CQuadBatch& ) = delete;
+	CQuadBatch& operator=( const CQuadBatch& ) = delete;
+};
+
+#endif //ENGINE_CQUADBATCH_H
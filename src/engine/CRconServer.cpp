@@ -0,0 +1,703 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#ifdef WIN32
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "Logging.h"
+
+#include "console/CCommandBuffer.h"
+
+#include "CRconServer.h"
+
+const size_t CRconServer::MAX_CONNECTIONS;
+const size_t CRconServer::MAX_BODY_SIZE;
+const size_t CRconServer::MAX_COMMAND_LENGTH;
+const size_t CRconServer::MAX_OUTPUT_SIZE;
+const size_t CRconServer::MAX_SEND_SIZE;
+const int CRconServer::POLL_INTERVAL_MS;
+
+namespace
+{
+const int32_t SERVERDATA_AUTH = 3;
+const int32_t SERVERDATA_AUTH_RESPONSE = 2;
+const int32_t SERVERDATA_EXECCOMMAND = 2;
+const int32_t SERVERDATA_RESPONSE_VALUE = 0;
+
+/**
+*	Bytes in a packet besides the size and the body: the ID, the type, and the body's null terminator followed by an empty string.
+*/
+const size_t PACKET_OVERHEAD = 10;
+
+/**
+*	Size of the packet size field.
+*/
+const size_t SIZE_FIELD_SIZE = 4;
+
+const size_t RECEIVE_CHUNK_SIZE = 4096;
+
+#ifdef WIN32
+using PollFD_t = WSAPOLLFD;
+
+const short POLL_READ = POLLRDNORM;
+const short POLL_WRITE = POLLWRNORM;
+
+int Poll( PollFD_t* pFDs, const size_t uiCount, const int iTimeoutMS )
+{
+	return WSAPoll( pFDs, static_cast<ULONG>( uiCount ), iTimeoutMS );
+}
+
+void CloseSocket( const CRconServer::Socket_t socket )
+{
+	closesocket( socket );
+}
+
+bool SetNonBlocking( const CRconServer::Socket_t socket )
+{
+	u_long uiNonBlocking = 1;
+
+	return ioctlsocket( socket, FIONBIO, &uiNonBlocking ) == 0;
+}
+
+bool WouldBlock()
+{
+	return WSAGetLastError() == WSAEWOULDBLOCK;
+}
+
+const int SEND_FLAGS = 0;
+#else
+using PollFD_t = pollfd;
+
+const short POLL_READ = POLLIN;
+const short POLL_WRITE = POLLOUT;
+
+int Poll( PollFD_t* pFDs, const size_t uiCount, const int iTimeoutMS )
+{
+	return poll( pFDs, static_cast<nfds_t>( uiCount ), iTimeoutMS );
+}
+
+void CloseSocket( const CRconServer::Socket_t socket )
+{
+	close( socket );
+}
+
+bool WouldBlock()
+{
+	return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+//Closed connections must not raise SIGPIPE.
+const int SEND_FLAGS = MSG_NOSIGNAL;
+#endif
+
+void WriteInt32( uint8_t* pDest, const int32_t iValue )
+{
+	const uint32_t uiValue = static_cast<uint32_t>( iValue );
+
+	pDest[ 0 ] = static_cast<uint8_t>( uiValue );
+	pDest[ 1 ] = static_cast<uint8_t>( uiValue >> 8 );
+	pDest[ 2 ] = static_cast<uint8_t>( uiValue >> 16 );
+	pDest[ 3 ] = static_cast<uint8_t>( uiValue >> 24 );
+}
+
+int32_t ReadInt32( const uint8_t* pSource )
+{
+	return static_cast<int32_t>( pSource[ 0 ] | ( pSource[ 1 ] << 8 ) | ( pSource[ 2 ] << 16 ) | ( static_cast<uint32_t>( pSource[ 3 ] ) << 24 ) );
+}
+}
+
+void CRconServer::CCaptureSink::Write( const char* pszText, const size_t uiLength )
+{
+	m_szText.append( pszText, std::min( uiLength, MAX_OUTPUT_SIZE - std::min( m_szText.size(), MAX_OUTPUT_SIZE ) ) );
+}
+
+CRconServer::~CRconServer()
+{
+	Stop();
+}
+
+bool CRconServer::Start( const uint16_t uiPort, CCommandBuffer& commandBuffer )
+{
+	Stop();
+
+	m_pCommandBuffer = &commandBuffer;
+
+#ifdef WIN32
+	WSADATA data;
+
+	if( WSAStartup( MAKEWORD( 2, 2 ), &data ) != 0 )
+		return false;
+
+	m_ListenSocket = socket( AF_INET, SOCK_STREAM, IPPROTO_TCP );
+
+	if( m_ListenSocket == INVALID_SOCKET )
+	{
+		WSACleanup();
+		return false;
+	}
+
+	m_bListening = true;
+
+	if( !SetNonBlocking( m_ListenSocket ) )
+	{
+		CloseSockets();
+		return false;
+	}
+#else
+	m_ListenSocket = socket( AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP );
+
+	if( m_ListenSocket < 0 )
+		return false;
+
+	m_bListening = true;
+
+	if( pipe2( m_WakePipe, O_NONBLOCK | O_CLOEXEC ) != 0 )
+	{
+		m_WakePipe[ 0 ] = m_WakePipe[ 1 ] = -1;
+		CloseSockets();
+		return false;
+	}
+#endif
+
+	//Allow restarting right away while old connections are in TIME_WAIT.
+	const int iReuse = 1;
+
+	setsockopt( m_ListenSocket, SOL_SOCKET, SO_REUSEADDR, reinterpret_cast<const char*>( &iReuse ), sizeof( iReuse ) );
+
+	sockaddr_in address;
+
+	memset( &address, 0, sizeof( address ) );
+
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( INADDR_ANY );
+	address.sin_port = htons( uiPort );
+
+	if( bind( m_ListenSocket, reinterpret_cast<const sockaddr*>( &address ), sizeof( address ) ) != 0 ||
+		listen( m_ListenSocket, static_cast<int>( MAX_CONNECTIONS ) ) != 0 )
+	{
+		CloseSockets();
+		return false;
+	}
+
+	m_bStop = false;
+	m_Thread = std::thread( &CRconServer::Run, this );
+
+	return true;
+}
+
+void CRconServer::Stop()
+{
+	if( m_Thread.joinable() )
+	{
+		m_bStop = true;
+		Wake();
+
+		m_Thread.join();
+	}
+
+	CloseSockets();
+
+	m_Responses.clear();
+	m_uiNextRequest = 1;
+
+	if( m_uiCaptureRequest != 0 )
+	{
+		Log_EndCapture();
+		m_uiCaptureRequest = 0;
+	}
+}
+
+void CRconServer::SetPassword( const char* pszPassword )
+{
+	if( m_szMainPassword == pszPassword )
+		return;
+
+	m_szMainPassword = pszPassword;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_szPassword = m_szMainPassword;
+}
+
+void CRconServer::BeginRequest( const uint32_t uiRequest )
+{
+	if( !IsRunning() || uiRequest == 0 )
+		return;
+
+	//A request that didn't end, e.g. because its text didn't fit in the buffer, gets what it has so far.
+	if( m_uiCaptureRequest != 0 )
+		EndRequest( m_uiCaptureRequest );
+
+	m_uiCaptureRequest = uiRequest;
+	m_Capture.m_szText.clear();
+
+	Log_BeginCapture( &m_Capture );
+}
+
+void CRconServer::EndRequest( const uint32_t uiRequest )
+{
+	if( uiRequest == 0 || uiRequest != m_uiCaptureRequest )
+		return;
+
+	Log_EndCapture();
+
+	m_uiCaptureRequest = 0;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_Responses.push_back( { uiRequest, std::move( m_Capture.m_szText ) } );
+	}
+
+	m_Capture.m_szText.clear();
+
+	Wake();
+}
+
+void CRconServer::Run()
+{
+	std::vector<PollFD_t> fds;
+
+	while( !m_bStop )
+	{
+		fds.clear();
+
+		fds.push_back( { m_ListenSocket, POLL_READ, 0 } );
+
+#ifndef WIN32
+		fds.push_back( { m_WakePipe[ 0 ], POLL_READ, 0 } );
+#endif
+
+		const size_t uiFirstConnection = fds.size();
+
+		for( const auto& connection : m_Connections )
+		{
+			const short events = POLL_READ | ( connection.uiSent < connection.send.size() ? POLL_WRITE : 0 );
+
+			fds.push_back( { connection.socket, events, 0 } );
+		}
+
+		if( Poll( fds.data(), fds.size(), POLL_INTERVAL_MS ) < 0 )
+			continue;
+
+#ifndef WIN32
+		if( fds[ 1 ].revents )
+		{
+			char buffer[ 64 ];
+
+			while( read( m_WakePipe[ 0 ], buffer, sizeof( buffer ) ) > 0 )
+			{
+			}
+		}
+#endif
+
+		ProcessResponses();
+
+		for( size_t uiIndex = 0; uiIndex < fds.size() - uiFirstConnection; ++uiIndex )
+		{
+			auto& connection = m_Connections[ uiIndex ];
+
+			if( fds[ uiFirstConnection + uiIndex ].revents & ~POLL_WRITE )
+				Receive( connection );
+
+			Send( connection );
+		}
+
+		m_Connections.erase( std::remove_if( m_Connections.begin(), m_Connections.end(),
+			[]( const Connection_t& connection )
+			{
+				if( connection.bClosed )
+					CloseSocket( connection.socket );
+
+				return connection.bClosed;
+			}
+		), m_Connections.end() );
+
+		if( fds[ 0 ].revents )
+			AcceptConnections();
+	}
+}
+
+void CRconServer::AcceptConnections()
+{
+	while( true )
+	{
+		sockaddr_in address;
+		socklen_t uiLength = sizeof( address );
+
+#ifdef WIN32
+		const Socket_t socket = accept( m_ListenSocket, reinterpret_cast<sockaddr*>( &address ), &uiLength );
+
+		if( socket == INVALID_SOCKET )
+			return;
+
+		if( !SetNonBlocking( socket ) )
+		{
+			CloseSocket( socket );
+			continue;
+		}
+#else
+		const Socket_t socket = accept4( m_ListenSocket, reinterpret_cast<sockaddr*>( &address ), &uiLength, SOCK_NONBLOCK | SOCK_CLOEXEC );
+
+		if( socket < 0 )
+			return;
+#endif
+
+		if( m_Connections.size() >= MAX_CONNECTIONS )
+		{
+			CloseSocket( socket );
+			continue;
+		}
+
+		//Responses are small and sent as soon as they're ready.
+		const int iNoDelay = 1;
+
+		setsockopt( socket, IPPROTO_TCP, TCP_NODELAY, reinterpret_cast<const char*>( &iNoDelay ), sizeof( iNoDelay ) );
+
+		Connection_t connection;
+
+		connection.socket = socket;
+
+		char szAddress[ INET_ADDRSTRLEN ] = {};
+
+		inet_ntop( AF_INET, &address.sin_addr, szAddress, sizeof( szAddress ) );
+
+		connection.szAddress = szAddress;
+
+		m_Connections.push_back( std::move( connection ) );
+	}
+}
+
+void CRconServer::Receive( Connection_t& connection )
+{
+	uint8_t buffer[ RECEIVE_CHUNK_SIZE ];
+
+	while( !connection.bClosed && !connection.bCloseWhenSent )
+	{
+		const auto iResult = recv( connection.socket, reinterpret_cast<char*>( buffer ), sizeof( buffer ), 0 );
+
+		if( iResult <= 0 )
+		{
+			if( iResult == 0 || !WouldBlock() )
+				connection.bClosed = true;
+
+			return;
+		}
+
+		connection.received.insert( connection.received.end(), buffer, buffer + iResult );
+
+		size_t uiOffset = 0;
+
+		while( !connection.bClosed && connection.received.size() - uiOffset >= SIZE_FIELD_SIZE )
+		{
+			const uint8_t* pPacket = connection.received.data() + uiOffset;
+
+			const int32_t iSize = ReadInt32( pPacket );
+
+			if( iSize < static_cast<int32_t>( PACKET_OVERHEAD ) || iSize > static_cast<int32_t>( MAX_BODY_SIZE + PACKET_OVERHEAD ) )
+			{
+				connection.bClosed = true;
+				break;
+			}
+
+			if( connection.received.size() - uiOffset < SIZE_FIELD_SIZE + iSize )
+				break;
+
+			//The body ends with a null, the packet with an empty string.
+			const auto pBody = reinterpret_cast<const char*>( pPacket + SIZE_FIELD_SIZE + 8 );
+			const size_t uiBodySize = iSize - PACKET_OVERHEAD;
+
+			if( pBody[ uiBodySize ] != '\0' )
+			{
+				connection.bClosed = true;
+				break;
+			}
+
+			ProcessPacket( connection, ReadInt32( pPacket + 4 ), ReadInt32( pPacket + 8 ), pBody );
+
+			uiOffset += SIZE_FIELD_SIZE + iSize;
+		}
+
+		connection.received.erase( connection.received.begin(), connection.received.begin() + uiOffset );
+	}
+}
+
+void CRconServer::Send( Connection_t& connection )
+{
+	while( !connection.bClosed && connection.uiSent < connection.send.size() )
+	{
+		const auto iResult = send( connection.socket, reinterpret_cast<const char*>( connection.send.data() + connection.uiSent ),
+			static_cast<int>( connection.send.size() - connection.uiSent ), SEND_FLAGS );
+
+		if( iResult < 0 )
+		{
+			if( !WouldBlock() )
+				connection.bClosed = true;
+
+			return;
+		}
+
+		connection.uiSent += iResult;
+	}
+
+	connection.send.clear();
+	connection.uiSent = 0;
+
+	if( connection.bCloseWhenSent )
+		connection.bClosed = true;
+}
+
+void CRconServer::ProcessPacket( Connection_t& connection, const int32_t iID, const int32_t iType, const char* pszBody )
+{
+	if( iType == SERVERDATA_AUTH )
+	{
+		//Reply right away, a failed attempt closes the connection so passwords can't be guessed quickly.
+		connection.bAuthenticated = CheckPassword( pszBody );
+
+		QueuePacket( connection, iID, SERVERDATA_RESPONSE_VALUE, "", 0 );
+		QueuePacket( connection, connection.bAuthenticated ? iID : -1, SERVERDATA_AUTH_RESPONSE, "", 0 );
+
+		if( !connection.bAuthenticated )
+		{
+			connection.bCloseWhenSent = true;
+
+			Msg( "RCON: failed authentication from %s\n", connection.szAddress.c_str() );
+		}
+
+		return;
+	}
+
+	if( !connection.bAuthenticated )
+	{
+		connection.bClosed = true;
+		return;
+	}
+
+	switch( iType )
+	{
+	case SERVERDATA_EXECCOMMAND:
+		{
+			ExecuteCommand( connection, iID, pszBody );
+			break;
+		}
+
+	//Clients send an empty response after a command to find the end of a response that was split into several packets.
+	//It's mirrored once the command's response was sent.
+	case SERVERDATA_RESPONSE_VALUE:
+		{
+			connection.replies.push_back( { 0, iID, true, {} } );
+			SendReplies( connection );
+			break;
+		}
+
+	default:
+		{
+			connection.bClosed = true;
+			break;
+		}
+	}
+}
+
+void CRconServer::ExecuteCommand( Connection_t& connection, const int32_t iID, const char* pszCommand )
+{
+	if( strlen( pszCommand ) > MAX_COMMAND_LENGTH )
+	{
+		connection.replies.push_back( { 0, iID, true, "Command too long\n" } );
+		SendReplies( connection );
+		return;
+	}
+
+	const uint32_t uiRequest = m_uiNextRequest++;
+
+	if( m_uiNextRequest == 0 )
+		m_uiNextRequest = 1;
+
+	connection.replies.push_back( { uiRequest, iID, false, {} } );
+
+	char szBegin[ 64 ];
+	char szEnd[ 64 ];
+
+	snprintf( szBegin, sizeof( szBegin ), "_rcon_begin %u\n", uiRequest );
+	snprintf( szEnd, sizeof( szEnd ), "\n_rcon_end %u\n", uiRequest );
+
+	std::string szText = szBegin;
+
+	szText += pszCommand;
+	szText += szEnd;
+
+	m_pCommandBuffer->QueueText( szText.c_str() );
+}
+
+void CRconServer::ProcessResponses()
+{
+	std::vector<Response_t> responses;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		responses.swap( m_Responses );
+	}
+
+	//Connections may have closed since, in which case the response is dropped.
+	for( auto& response : responses )
+	{
+		for( auto& connection : m_Connections )
+		{
+			//Requests are executed in order, so earlier ones that haven't ended were dropped because the command buffer was full.
+			for( auto& reply : connection.replies )
+			{
+				if( reply.uiRequest != 0 && !reply.bDone && static_cast<int32_t>( reply.uiRequest - response.uiRequest ) < 0 )
+				{
+					reply.bDone = true;
+					reply.szText = "Command buffer full, command dropped\n";
+				}
+			}
+		}
+
+		for( auto& connection : m_Connections )
+		{
+			auto it = std::find_if( connection.replies.begin(), connection.replies.end(),
+				[ & ]( const Reply_t& reply )
+				{
+					return reply.uiRequest == response.uiRequest;
+				}
+			);
+
+			if( it == connection.replies.end() )
+				continue;
+
+			it->bDone = true;
+			it->szText = std::move( response.szText );
+
+			break;
+		}
+	}
+
+	for( auto& connection : m_Connections )
+	{
+		SendReplies( connection );
+	}
+}
+
+void CRconServer::SendReplies( Connection_t& connection )
+{
+	while( !connection.replies.empty() && connection.replies.front().bDone )
+	{
+		const auto& reply = connection.replies.front();
+
+		size_t uiOffset = 0;
+
+		do
+		{
+			const size_t uiLength = std::min( reply.szText.size() - uiOffset, MAX_BODY_SIZE );
+
+			QueuePacket( connection, reply.iPacketID, SERVERDATA_RESPONSE_VALUE, reply.szText.data() + uiOffset, uiLength );
+
+			uiOffset += uiLength;
+		}
+		while( uiOffset < reply.szText.size() );
+
+		connection.replies.pop_front();
+	}
+}
+
+void CRconServer::QueuePacket( Connection_t& connection, const int32_t iID, const int32_t iType, const char* pszBody, const size_t uiLength )
+{
+	if( connection.send.size() - connection.uiSent + SIZE_FIELD_SIZE + PACKET_OVERHEAD + uiLength > MAX_SEND_SIZE )
+	{
+		connection.bClosed = true;
+		return;
+	}
+
+	const size_t uiStart = connection.send.size();
+
+	connection.send.resize( uiStart + SIZE_FIELD_SIZE + PACKET_OVERHEAD + uiLength );
+
+	uint8_t* pPacket = connection.send.data() + uiStart;
+
+	WriteInt32( pPacket, static_cast<int32_t>( PACKET_OVERHEAD + uiLength ) );
+	WriteInt32( pPacket + 4, iID );
+	WriteInt32( pPacket + 8, iType );
+
+	memcpy( pPacket + SIZE_FIELD_SIZE + 8, pszBody, uiLength );
+
+	pPacket[ SIZE_FIELD_SIZE + 8 + uiLength ] = '\0';
+	pPacket[ SIZE_FIELD_SIZE + 9 + uiLength ] = '\0';
+}
+
+bool CRconServer::CheckPassword( const char* pszPassword )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	const size_t uiLength = strlen( pszPassword );
+
+	if( m_szPassword.empty() || uiLength != m_szPassword.size() )
+		return false;
+
+	//Compare every character, so the time taken doesn't tell how much of the password matched.
+	unsigned char uiDifference = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiLength; ++uiIndex )
+	{
+		uiDifference |= static_cast<unsigned char>( pszPassword[ uiIndex ] ^ m_szPassword[ uiIndex ] );
+	}
+
+	return uiDifference == 0;
+}
+
+void CRconServer::Wake()
+{
+#ifndef WIN32
+	if( m_WakePipe[ 1 ] != -1 )
+	{
+		const char data = 0;
+
+		//If the pipe is full, the thread is already going to wake up.
+		const auto iResult = write( m_WakePipe[ 1 ], &data, sizeof( data ) );
+
+		( void ) iResult;
+	}
+#endif
+}
+
+void CRconServer::CloseSockets()
+{
+	for( const auto& connection : m_Connections )
+	{
+		CloseSocket( connection.socket );
+	}
+
+	m_Connections.clear();
+
+	if( m_bListening )
+	{
+		CloseSocket( m_ListenSocket );
+		m_bListening = false;
+
+#ifdef WIN32
+		WSACleanup();
+#endif
+	}
+
+#ifndef WIN32
+	for( auto& fd : m_WakePipe )
+	{
+		if( fd != -1 )
+		{
+			close( fd );
+			fd = -1;
+		}
+	}
+#endif
+}
@@ -0,0 +1,235 @@
+#ifndef ENGINE_CRCONSERVER_H
+#define ENGINE_CRCONSERVER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef WIN32
+#include <winsock2.h>
+#endif
+
+#include "ILogSink.h"
+
+class CCommandBuffer;
+
+/**
+*	Remote console server, using the Source RCON protocol over TCP.
+*	Connections are serviced by an I/O thread with non-blocking sockets, so admin traffic never blocks the frame.
+*	Commands are queued into the command buffer's lock-free queue, wrapped in _rcon_begin and _rcon_end commands.
+*	When the main thread executes them, the output of the command is captured from the log and sent back by the I/O thread.
+*	On Windows, the I/O thread isn't woken up for responses, and picks them up within POLL_INTERVAL_MS.
+*/
+class CRconServer final
+{
+public:
+#ifdef WIN32
+	using Socket_t = SOCKET;
+#else
+	using Socket_t = int;
+#endif
+
+	/**
+	*	Maximum number of open connections. Others are closed right away.
+	*/
+	static const size_t MAX_CONNECTIONS = 16;
+
+	/**
+	*	Largest packet body that is accepted, and sent. Longer responses are split into several packets.
+	*/
+	static const size_t MAX_BODY_SIZE = 4096;
+
+	/**
+	*	Longest command that is accepted. The wrapped command must fit in the command buffer.
+	*/
+	static const size_t MAX_COMMAND_LENGTH = 1024;
+
+	/**
+	*	Maximum amount of output captured for one command, in bytes. The rest is dropped.
+	*/
+	static const size_t MAX_OUTPUT_SIZE = 64 * 1024;
+
+	/**
+	*	Maximum amount of data waiting to be sent to a connection. Connections that don't keep up are closed.
+	*/
+	static const size_t MAX_SEND_SIZE = 1024 * 1024;
+
+	/**
+	*	Longest time the I/O thread waits for the sockets before checking whether it should stop.
+	*/
+	static const int POLL_INTERVAL_MS = 50;
+
+	CRconServer() = default;
+
+	/**
+	*	Stops the server, if it is running.
+	*/
+	~CRconServer();
+
+	bool IsRunning() const { return m_Thread.joinable(); }
+
+	/**
+	*	Starts listening on a port, and starts the I/O thread. Stops the server first.
+	*	@param uiPort TCP port to listen on.
+	*	@param commandBuffer Buffer that commands are queued into. Must outlive the server.
+	*/
+	bool Start( const uint16_t uiPort, CCommandBuffer& commandBuffer );
+
+	/**
+	*	Closes all connections, and stops the I/O thread.
+	*/
+	void Stop();
+
+	/**
+	*	Sets the password that connections must authenticate with. Connections can't authenticate while it's empty.
+	*	Only locks if the password changed, so it can be called every frame. Connections that are already authenticated stay authenticated.
+	*/
+	void SetPassword( const char* pszPassword );
+
+	/**
+	*	Starts capturing the output of a request. Called by _rcon_begin, on the main thread.
+	*/
+	void BeginRequest( const uint32_t uiRequest );
+
+	/**
+	*	Stops capturing the output of a request, and sends it to the connection that made it. Called by _rcon_end, on the main thread.
+	*/
+	void EndRequest( const uint32_t uiRequest );
+
+private:
+	/**
+	*	Collects the output of a command on the main thread.
+	*/
+	class CCaptureSink final : public ILogSink
+	{
+	public:
+		void Write( const char* pszText, const size_t uiLength ) override;
+
+		void Flush() override {}
+
+		std::string m_szText;
+	};
+
+	/**
+	*	Response to a packet, sent once the responses to earlier packets on the same connection were sent.
+	*/
+	struct Reply_t
+	{
+		/**
+		*	Request that executes the command, or 0 for packets that are answered right away.
+		*/
+		uint32_t uiRequest;
+
+		int32_t iPacketID;
+
+		bool bDone;
+
+		std::string szText;
+	};
+
+	struct Connection_t
+	{
+		Socket_t socket;
+
+		std::string szAddress;
+
+		bool bAuthenticated = false;
+		bool bClosed = false;
+
+		/**
+		*	Whether to close the connection once everything queued was sent.
+		*/
+		bool bCloseWhenSent = false;
+
+		std::vector<uint8_t> received;
+
+		std::vector<uint8_t> send;
+		size_t uiSent = 0;
+
+		std::deque<Reply_t> replies;
+	};
+
+	struct Response_t
+	{
+		uint32_t uiRequest;
+		std::string szText;
+	};
+
+	void Run();
+
+	void AcceptConnections();
+
+	void Receive( Connection_t& connection );
+
+	void Send( Connection_t& connection );
+
+	void ProcessPacket( Connection_t& connection, const int32_t iID, const int32_t iType, const char* pszBody );
+
+	void ExecuteCommand( Connection_t& connection, const int32_t iID, const char* pszCommand );
+
+	void ProcessResponses();
+
+	/**
+	*	Sends the replies at the front of the connection's queue that are done.
+	*/
+	void SendReplies( Connection_t& connection );
+
+	void QueuePacket( Connection_t& connection, const int32_t iID, const int32_t iType, const char* pszBody, const size_t uiLength );
+
+	bool CheckPassword( const char* pszPassword );
+
+	/**
+	*	Wakes up the I/O thread.
+	*/
+	void Wake();
+
+	void CloseSockets();
+
+private:
+	CCommandBuffer* m_pCommandBuffer = nullptr;
+
+	std::thread m_Thread;
+	std::atomic<bool> m_bStop{ false };
+
+	Socket_t m_ListenSocket;
+	bool m_bListening = false;
+
+#ifndef WIN32
+	/**
+	*	Pipe that wakes up the I/O thread when written to.
+	*/
+	int m_WakePipe[ 2 ] = { -1, -1 };
+#endif
+
+	/**
+	*	Guards the password and the responses.
+	*/
+	std::mutex m_Mutex;
+
+	std::string m_szPassword;
+
+	/**
+	*	Output of requests that were executed, waiting to be sent by the I/O thread.
+	*/
+	std::vector<Response_t> m_Responses;
+
+	//Only used by the I/O thread.
+	std::vector<Connection_t> m_Connections;
+	uint32_t m_uiNextRequest = 1;
+
+	//Only used by the main thread.
+	std::string m_szMainPassword;
+	CCaptureSink m_Capture;
+	uint32_t m_uiCaptureRequest = 0;
+
+private:
+	CRconServer( const CRconServer& ) = delete;
+	CRconServer& operator=( const CRconServer& ) = delete;
+};
+
+#endif //ENGINE_CRCONSERVER_H
@@ -0,0 +1,289 @@
+#include <cstring>
+#include <utility>
+
+#include "CRenderCommandList.h"
+
+void CRenderCommandList::Clear()
+{
+	m_Commands.clear();
+	m_Data.clear();
+	m_Worlds.clear();
+}
+
+void CRenderCommandList::ClearScreen()
+{
+	AddCommand( CommandType::CLEAR );
+}
+
+void CRenderCommandList::Begin2D( const int iWidth, const int iHeight )
+{
+	auto& command = AddCommand( CommandType::BEGIN_2D );
+
+	command.iArgs[ 0 ] = iWidth;
+	command.iArgs[ 1 ] = iHeight;
+}
+
+void CRenderCommandList::End2D()
+{
+	AddCommand( CommandType::END_2D );
+}
+
+void CRenderCommandList::SetColor( const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t a )
+{
+	auto& command = AddCommand( CommandType::SET_COLOR );
+
+	command.ubColor[ 0 ] = r;
+	command.ubColor[ 1 ] = g;
+	command.ubColor[ 2 ] = b;
+	command.ubColor[ 3 ] = a;
+}
+
+void CRenderCommandList::FilledRect( const int x0, const int y0, const int x1, const int y1 )
+{
+	auto& command = AddCommand( CommandType::FILLED_RECT );
+
+	command.iArgs[ 0 ] = x0;
+	command.iArgs[ 1 ] = y0;
+	command.iArgs[ 2 ] = x1;
+	command.iArgs[ 3 ] = y1;
+}
+
+void CRenderCommandList::OutlinedRect( const int x0, const int y0, const int x1, const int y1 )
+{
+	auto& command = AddCommand( CommandType::OUTLINED_RECT );
+
+	command.iArgs[ 0 ] = x0;
+	command.iArgs[ 1 ] = y0;
+	command.iArgs[ 2 ] = x1;
+	command.iArgs[ 3 ] = y1;
+}
+
+void CRenderCommandList::BindTexture( const int iTexture )
+{
+	auto& command = AddCommand( CommandType::BIND_TEXTURE );
+
+	command.iArgs[ 0 ] = iTexture;
+}
+
+void CRenderCommandList::TexturedRect( const int x0, const int y0, const int x1, const int y1 )
+{
+	auto& command = AddCommand( CommandType::TEXTURED_RECT );
+
+	command.iArgs[ 0 ] = x0;
+	command.iArgs[ 1 ] = y0;
+	command.iArgs[ 2 ] = x1;
+	command.iArgs[ 3 ] = y1;
+}
+
+void CRenderCommandList::UploadTexture( const int iTexture, const void* pRGBA, const int iWidth, const int iHeight )
+{
+	const size_t uiSize = static_cast<size_t>( iWidth ) * iHeight * 4;
+
+	auto& command = AddCommand( CommandType::UPLOAD_TEXTURE );
+
+	command.iArgs[ 0 ] = iTexture;
+	command.iArgs[ 1 ] = iWidth;
+	command.iArgs[ 2 ] = iHeight;
+
+	command.uiDataOffset = static_cast<uint32_t>( m_Data.size() );
+	command.uiDataSize = static_cast<uint32_t>( uiSize );
+
+	m_Data.resize( m_Data.size() + uiSize );
+
+	memcpy( m_Data.data() + command.uiDataOffset, pRGBA, uiSize );
+}
+
+void CRenderCommandList::DeleteTexture( const int iTexture )
+{
+	auto& command = AddCommand( CommandType::DELETE_TEXTURE );
+
+	command.iArgs[ 0 ] = iTexture;
+}
+
+void CRenderCommandList::UploadTextureFile( const int iTexture, const void* pData, const size_t uiSize )
+{
+	auto& command = AddCommand( CommandType::UPLOAD_TEXTURE_FILE );
+
+	command.iArgs[ 0 ] = iTexture;
+
+	command.uiDataOffset = static_cast<uint32_t>( m_Data.size() );
+	command.uiDataSize = static_cast<uint32_t>( uiSize );
+
+	m_Data.resize( m_Data.size() + uiSize );
+
+	memcpy( m_Data.data() + command.uiDataOffset, pData, uiSize );
+}
+
+void CRenderCommandList::Text( const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t a, const Glyph_t* pGlyphs, const size_t uiCount )
+{
+	const size_t uiSize = uiCount * sizeof( Glyph_t );
+
+	auto& command = AddCommand( CommandType::TEXT );
+
+	command.ubColor[ 0 ] = r;
+	command.ubColor[ 1 ] = g;
+	command.ubColor[ 2 ] = b;
+	command.ubColor[ 3 ] = a;
+
+	command.uiDataOffset = static_cast<uint32_t>( m_Data.size() );
+	command.uiDataSize = static_cast<uint32_t>( uiSize );
+
+	m_Data.resize( m_Data.size() + uiSize );
+
+	memcpy( m_Data.data() + command.uiDataOffset, pGlyphs, uiSize );
+}
+
+void CRenderCommandList::PushTranslation( const int x, const int y )
+{
+	auto& command = AddCommand( CommandType::PUSH_TRANSLATION );
+
+	command.iArgs[ 0 ] = x;
+	command.iArgs[ 1 ] = y;
+}
+
+void CRenderCommandList::PopTranslation()
+{
+	AddCommand( CommandType::POP_TRANSLATION );
+}
+
+void CRenderCommandList::SetScissor( const int x0, const int y0, const int x1, const int y1 )
+{
+	auto& command = AddCommand( CommandType::SET_SCISSOR );
+
+	command.iArgs[ 0 ] = x0;
+	command.iArgs[ 1 ] = y0;
+	command.iArgs[ 2 ] = x1;
+	command.iArgs[ 3 ] = y1;
+}
+
+void CRenderCommandList::ClearScissor()
+{
+	AddCommand( CommandType::CLEAR_SCISSOR );
+}
+
+void CRenderCommandList::BeginUICache( const int iWidth, const int iHeight )
+{
+	auto& command = AddCommand( CommandType::BEGIN_UI_CACHE );
+
+	command.iArgs[ 0 ] = iWidth;
+	command.iArgs[ 1 ] = iHeight;
+}
+
+void CRenderCommandList::EndUICache()
+{
+	AddCommand( CommandType::END_UI_CACHE );
+}
+
+void CRenderCommandList::DrawUICache( const int iWidth, const int iHeight )
+{
+	auto& command = AddCommand( CommandType::DRAW_UI_CACHE );
+
+	command.iArgs[ 0 ] = iWidth;
+	command.iArgs[ 1 ] = iHeight;
+}
+
+void CRenderCommandList::BeginPanelCache( const int x0, const int y0, const int x1, const int y1 )
+{
+	auto& command = AddCommand( CommandType::BEGIN_PANEL_CACHE );
+
+	command.iArgs[ 0 ] = x0;
+	command.iArgs[ 1 ] = y0;
+	command.iArgs[ 2 ] = x1;
+	command.iArgs[ 3 ] = y1;
+}
+
+void CRenderCommandList::EndPanelCache()
+{
+	AddCommand( CommandType::END_PANEL_CACHE );
+}
+
+void CRenderCommandList::DrawPanelCache( const int x0, const int y0, const int x1, const int y1 )
+{
+	auto& command = AddCommand( CommandType::DRAW_PANEL_CACHE );
+
+	command.iArgs[ 0 ] = x0;
+	command.iArgs[ 1 ] = y0;
+	command.iArgs[ 2 ] = x1;
+	command.iArgs[ 3 ] = y1;
+}
+
+void CRenderCommandList::BeginGPUPass( const int iPass )
+{
+	auto& command = AddCommand( CommandType::BEGIN_GPU_PASS );
+
+	command.iArgs[ 0 ] = iPass;
+}
+
+void CRenderCommandList::EndGPUPass()
+{
+	AddCommand( CommandType::END_GPU_PASS );
+}
+
+void CRenderCommandList::LoadWorld( std::shared_ptr<const CWorldMesh> world )
+{
+	auto& command = AddCommand( CommandType::LOAD_WORLD );
+
+	command.iArgs[ 0 ] = static_cast<int>( m_Worlds.size() );
+
+	m_Worlds.push_back( std::move( world ) );
+}
+
+void CRenderCommandList::UnloadWorld()
+{
+	AddCommand( CommandType::UNLOAD_WORLD );
+}
+
+void CRenderCommandList::DrawWorld( const int iWidth, const int iHeight, const float* pflViewProjection, const CWorldMesh::DrawRange_t* pRanges, const size_t uiCount )
+{
+	const size_t uiMatrixSize = sizeof( float ) * 16;
+	const size_t uiSize = uiMatrixSize + uiCount * sizeof( CWorldMesh::DrawRange_t );
+
+	auto& command = AddCommand( CommandType::DRAW_WORLD );
+
+	command.iArgs[ 0 ] = iWidth;
+	command.iArgs[ 1 ] = iHeight;
+
+	command.uiDataOffset = static_cast<uint32_t>( m_Data.size() );
+	command.uiDataSize = static_cast<uint32_t>( uiSize );
+
+	m_Data.resize( m_Data.size() + uiSize );
+
+	memcpy( m_Data.data() + command.uiDataOffset, pflViewProjection, uiMatrixSize );
+
+	if( uiCount )
+		memcpy( m_Data.data() + command.uiDataOffset + uiMatrixSize, pRanges, uiSize - uiMatrixSize );
+}
+
+void CRenderCommandList::DrawEffects( const int iWidth, const int iHeight, const float* pflViewProjection, const Effect_t* pEffects, const size_t uiCount )
+{
+	const size_t uiMatrixSize = sizeof( float ) * 16;
+	const size_t uiSize = uiMatrixSize + uiCount * sizeof( Effect_t );
+
+	auto& command = AddCommand( CommandType::DRAW_EFFECTS );
+
+	command.iArgs[ 0 ] = iWidth;
+	command.iArgs[ 1 ] = iHeight;
+
+	command.uiDataOffset = static_cast<uint32_t>( m_Data.size() );
+	command.uiDataSize = static_cast<uint32_t>( uiSize );
+
+	m_Data.resize( m_Data.size() + uiSize );
+
+	memcpy( m_Data.data() + command.uiDataOffset, pflViewProjection, uiMatrixSize );
+
+	if( uiCount )
+		memcpy( m_Data.data() + command.uiDataOffset + uiMatrixSize, pEffects, uiSize - uiMatrixSize );
+}
+
+CRenderCommandList::Command_t& CRenderCommandList::AddCommand( const CommandType type )
+{
+	m_Commands.emplace_back();
+
+	auto& command = m_Commands.back();
+
+	memset( &command, 0, sizeof( command ) );
+
+	command.type = type;
+
+	return command;
+}
@@ -0,0 +1,337 @@
+#ifndef ENGINE_CRENDERCOMMANDLIST_H
+#define ENGINE_CRENDERCOMMANDLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "MemoryTracking.h"
+
+#include "CWorldMesh.h"
+
+/**
+*	A frame's worth of rendering commands. Recording doesn't touch OpenGL, so it can happen on any thread.
+*	CRenderer executes the commands on the thread that owns the OpenGL context.
+*/
+class CRenderCommandList final
+{
+public:
+	enum class CommandType : uint8_t
+	{
+		/**
+		*	Clears the screen.
+		*/
+		CLEAR = 0,
+
+		/**
+		*	Sets up 2D drawing. iArgs: width, height.
+		*/
+		BEGIN_2D,
+
+		/**
+		*	Restores state changed by BEGIN_2D.
+		*/
+		END_2D,
+
+		/**
+		*	ubColor: color.
+		*/
+		SET_COLOR,
+
+		/**
+		*	iArgs: x0, y0, x1, y1.
+		*/
+		FILLED_RECT,
+		OUTLINED_RECT,
+
+		/**
+		*	iArgs[ 0 ]: texture handle.
+		*/
+		BIND_TEXTURE,
+
+		/**
+		*	iArgs: x0, y0, x1, y1. Drawn with the bound texture.
+		*/
+		TEXTURED_RECT,
+
+		/**
+		*	iArgs: texture handle, width, height. Data: RGBA pixels.
+		*/
+		UPLOAD_TEXTURE,
+
+		/**
+		*	Frees a texture handle's texture. Space in an atlas page isn't reused. iArgs: texture handle.
+		*/
+		DELETE_TEXTURE,
+
+		/**
+		*	Creates a texture from a precompiled texture file. iArgs: texture handle. Data: contents of the file.
+		*/
+		UPLOAD_TEXTURE_FILE,
+
+		/**
+		*	Draws glyphs, blended by their alpha. ubColor: color. Data: Glyph_t array.
+		*/
+		TEXT,
+
+		/**
+		*	Replaces the modelview matrix with a translation. iArgs: x, y.
+		*/
+		PUSH_TRANSLATION,
+		POP_TRANSLATION,
+
+		/**
+		*	Limits drawing and clearing to a rectangle. iArgs: x0, y0, x1, y1, in 2D coordinates.
+		*/
+		SET_SCISSOR,
+		CLEAR_SCISSOR,
+
+		/**
+		*	Draws into the UI cache instead of the screen, until END_UI_CACHE. iArgs: width, height.
+		*/
+		BEGIN_UI_CACHE,
+		END_UI_CACHE,
+
+		/**
+		*	Draws the UI cache over the screen. iArgs: width, height.
+		*/
+		DRAW_UI_CACHE,
+
+		/**
+		*	Draws a panel into the cache for the bound texture handle, until END_PANEL_CACHE. Can be nested.
+		*	iArgs: x0, y0, x1, y1 of the panel, in absolute 2D coordinates.
+		*/
+		BEGIN_PANEL_CACHE,
+		END_PANEL_CACHE,
+
+		/**
+		*	Draws the cache for the bound texture handle. Translations don't apply. iArgs: x0, y0, x1, y1.
+		*/
+		DRAW_PANEL_CACHE,
+
+		/**
+		*	Starts timing a pass on the GPU. iArgs[ 0 ]: CFrameTimer::GPUPass.
+		*/
+		BEGIN_GPU_PASS,
+		END_GPU_PASS,
+
+		/**
+		*	Uploads a world, replacing the one that was loaded. See GetWorld.
+		*/
+		LOAD_WORLD,
+		UNLOAD_WORLD,
+
+		/**
+		*	Draws ranges of the loaded world with depth testing. iArgs: width, height.
+		*	Data: column major view projection matrix as 16 floats, followed by a CWorldMesh::DrawRange_t array.
+		*/
+		DRAW_WORLD,
+
+		/**
+		*	Draws sprites, particles and decals with depth testing. iArgs: width, height.
+		*	Data: column major view projection matrix as 16 floats, followed by an Effect_t array.
+		*/
+		DRAW_EFFECTS
+	};
+
+	/**
+	*	Kinds of effects, in the order they're drawn.
+	*/
+	enum class EffectType : uint8_t
+	{
+		/**
+		*	Drawn first, pulled towards the view so they don't fight with the surface they're on.
+		*/
+		DECAL = 0,
+		SPRITE,
+		PARTICLE,
+
+		COUNT
+	};
+
+	enum class BlendMode : uint8_t
+	{
+		/**
+		*	Blended by the texture's and color's alpha.
+		*/
+		ALPHA = 0,
+
+		/**
+		*	Added to what's behind it, scaled by alpha. Order doesn't matter, so these never need sorting by depth.
+		*/
+		ADDITIVE,
+
+		COUNT
+	};
+
+	struct Command_t
+	{
+		CommandType type;
+
+		uint8_t ubColor[ 4 ];
+
+		int iArgs[ 4 ];
+
+		/**
+		*	Range in the data buffer.
+		*/
+		uint32_t uiDataOffset;
+		uint32_t uiDataSize;
+	};
+
+	struct Glyph_t
+	{
+		/**
+		*	Texture handle.
+		*/
+		int iTexture;
+
+		int x0, y0, x1, y1;
+	};
+
+	/**
+	*	A textured quad in the world, centered on its origin.
+	*	Sprites and particles that face the view pass the view's right and up vectors, scaled by half their size.
+	*/
+	struct Effect_t
+	{
+		/**
+		*	Texture handle, 0 for none.
+		*/
+		int iTexture;
+
+		EffectType type;
+		BlendMode blend;
+
+		uint8_t ubColor[ 4 ];
+
+		float flOrigin[ 3 ];
+
+		/**
+		*	Half of the quad's width and height, as vectors.
+		*/
+		float flRight[ 3 ];
+		float flUp[ 3 ];
+	};
+
+public:
+	CRenderCommandList() = default;
+	CRenderCommandList( CRenderCommandList&& other ) = default;
+	CRenderCommandList& operator=( CRenderCommandList&& other ) = default;
+
+	const TrackedVector_t<Command_t, MemoryTag::RENDER>& GetCommands() const { return m_Commands; }
+
+	const uint8_t* GetData( const Command_t& command ) const { return m_Data.data() + command.uiDataOffset; }
+
+	bool IsEmpty() const { return m_Commands.empty(); }
+
+	/**
+	*	Removes all commands. Keeps the memory for the next frame.
+	*/
+	void Clear();
+
+	void ClearScreen();
+
+	void Begin2D( const int iWidth, const int iHeight );
+
+	void End2D();
+
+	void SetColor( const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t a );
+
+	void FilledRect( const int x0, const int y0, const int x1, const int y1 );
+
+	void OutlinedRect( const int x0, const int y0, const int x1, const int y1 );
+
+	/**
+	*	@param iTexture Texture handle, 0 for none.
+	*/
+	void BindTexture( const int iTexture );
+
+	void TexturedRect( const int x0, const int y0, const int x1, const int y1 );
+
+	/**
+	*	Uploads pixels to a texture. The pixels are copied.
+	*/
+	void UploadTexture( const int iTexture, const void* pRGBA, const int iWidth, const int iHeight );
+
+	void DeleteTexture( const int iTexture );
+
+	/**
+	*	Uploads a precompiled texture file to a texture. The file's contents are copied.
+	*/
+	void UploadTextureFile( const int iTexture, const void* pData, const size_t uiSize );
+
+	/**
+	*	Draws a string's glyphs. The glyphs are copied.
+	*/
+	void Text( const uint8_t r, const uint8_t g, const uint8_t b, const uint8_t a, const Glyph_t* pGlyphs, const size_t uiCount );
+
+	void PushTranslation( const int x, const int y );
+
+	void PopTranslation();
+
+	void SetScissor( const int x0, const int y0, const int x1, const int y1 );
+
+	void ClearScissor();
+
+	void BeginUICache( const int iWidth, const int iHeight );
+
+	void EndUICache();
+
+	void DrawUICache( const int iWidth, const int iHeight );
+
+	void BeginPanelCache( const int x0, const int y0, const int x1, const int y1 );
+
+	void EndPanelCache();
+
+	void DrawPanelCache( const int x0, const int y0, const int x1, const int y1 );
+
+	void BeginGPUPass( const int iPass );
+
+	void EndGPUPass();
+
+	/**
+	*	Uploads a world. The list keeps the mesh alive until it's cleared, so it can be executed on another thread.
+	*/
+	void LoadWorld( std::shared_ptr<const CWorldMesh> world );
+
+	void UnloadWorld();
+
+	/**
+	*	Draws ranges of the loaded world. The matrix and ranges are copied.
+	*/
+	void DrawWorld( const int iWidth, const int iHeight, const float* pflViewProjection, const CWorldMesh::DrawRange_t* pRanges, const size_t uiCount );
+
+	/**
+	*	Draws effects. Effects with the same type, blend mode and texture are drawn together. The matrix and effects are copied.
+	*/
+	void DrawEffects( const int iWidth, const int iHeight, const float* pflViewProjection, const Effect_t* pEffects, const size_t uiCount );
+
+	/**
+	*	@return The world of a LOAD_WORLD command.
+	*/
+	const CWorldMesh& GetWorld( const Command_t& command ) const { return *m_Worlds[ command.iArgs[ 0 ] ]; }
+
+private:
+	Command_t& AddCommand( const CommandType type );
+
+private:
+	TrackedVector_t<Command_t, MemoryTag::RENDER> m_Commands;
+
+	/**
+	*	Data that doesn't fit in a command, like texture pixels.
+	*/
+	TrackedVector_t<uint8_t, MemoryTag::RENDER> m_Data;
+
+	/**
+	*	Worlds of LOAD_WORLD commands.
+	*/
+	std::vector<std::shared_ptr<const CWorldMesh>> m_Worlds;
+
+private:
+	CRenderCommandList( const CRenderCommandList& ) = delete;
+	CRenderCommandList& operator=( const CRenderCommandList& ) = delete;
+};
+
+#endif //ENGINE_CRENDERCOMMANDLIST_H
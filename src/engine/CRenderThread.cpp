@@ -0,0 +1,116 @@
+#include <cassert>
+
+#include "Logging.h"
+
+#include "CRenderThread.h"
+
+CRenderThread::~CRenderThread()
+{
+	Stop();
+}
+
+bool CRenderThread::Start( SDL_Window* pWindow, SDL_GLContext hContext, FrameFn frameFn )
+{
+	assert( pWindow );
+	assert( hContext );
+	assert( frameFn );
+
+	if( IsRunning() )
+		return true;
+
+	//A context can only be current on one thread at a time.
+	if( SDL_GL_MakeCurrent( pWindow, nullptr ) != 0 )
+	{
+		Msg( "Couldn't release the OpenGL context for the render thread: %s\n", SDL_GetError() );
+		return false;
+	}
+
+	m_pWindow = pWindow;
+	m_hContext = hContext;
+	m_FrameFn = std::move( frameFn );
+
+	m_uiRecordIndex = 0;
+	m_bFramePending = false;
+	m_bStop = false;
+
+	for( auto& list : m_Lists )
+	{
+		list.Clear();
+	}
+
+	m_Thread = std::thread( &CRenderThread::ThreadFunc, this );
+
+	return true;
+}
+
+void CRenderThread::Stop()
+{
+	if( !IsRunning() )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bStop = true;
+	}
+
+	m_Condition.notify_all();
+
+	m_Thread.join();
+
+	SDL_GL_MakeCurrent( m_pWindow, m_hContext );
+
+	m_FrameFn = nullptr;
+}
+
+void CRenderThread::Submit()
+{
+	assert( IsRunning() );
+
+	{
+		std::unique_lock<std::mutex> lock( m_Mutex );
+
+		m_Condition.wait( lock, [ this ]() { return !m_bFramePending; } );
+
+		m_uiRecordIndex ^= 1;
+
+		m_bFramePending = true;
+	}
+
+	m_Condition.notify_all();
+}
+
+void CRenderThread::ThreadFunc()
+{
+	if( SDL_GL_MakeCurrent( m_pWindow, m_hContext ) != 0 )
+		Msg( "Couldn't make the OpenGL context current on the render thread: %s\n", SDL_GetError() );
+
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( true )
+	{
+		m_Condition.wait( lock, [ this ]() { return m_bFramePending || m_bStop; } );
+
+		//Finish the submitted frame before stopping.
+		if( !m_bFramePending )
+			break;
+
+		auto& list = m_Lists[ m_uiRecordIndex ^ 1 ];
+
+		lock.unlock();
+
+		m_FrameFn( list );
+
+		list.Clear();
+
+		lock.lock();
+
+		m_bFramePending = false;
+
+		m_Condition.notify_all();
+	}
+
+	lock.unlock();
+
+	SDL_GL_MakeCurrent( m_pWindow, nullptr );
+}
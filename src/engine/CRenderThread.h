@@ -0,0 +1,85 @@
+#ifndef ENGINE_CRENDERTHREAD_H
+#define ENGINE_CRENDERTHREAD_H
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <SDL2/SDL.h>
+
+#include "CRenderCommandList.h"
+
+/**
+*	Runs render command lists on a separate thread that owns the OpenGL context.
+*	The main thread records a frame into one list while the render thread executes the previous frame's list.
+*/
+class CRenderThread final
+{
+public:
+	/**
+	*	Executes and presents a frame. Called on the render thread.
+	*/
+	using FrameFn = std::function<void( const CRenderCommandList& list )>;
+
+public:
+	CRenderThread() = default;
+	~CRenderThread();
+
+	bool IsRunning() const { return m_Thread.joinable(); }
+
+	/**
+	*	Starts the thread, and moves the context to it. The context must be current on the calling thread.
+	*/
+	bool Start( SDL_Window* pWindow, SDL_GLContext hContext, FrameFn frameFn );
+
+	/**
+	*	Stops the thread once it has finished its frame, and makes the context current on the calling thread again.
+	*/
+	void Stop();
+
+	/**
+	*	@return The list to record the next frame into.
+	*/
+	CRenderCommandList& GetRecordList() { return m_Lists[ m_uiRecordIndex ]; }
+
+	/**
+	*	Hands the recorded list to the render thread. Waits until the render thread has finished the previous frame,
+	*	so the main thread is never more than one frame ahead.
+	*/
+	void Submit();
+
+private:
+	void ThreadFunc();
+
+private:
+	SDL_Window* m_pWindow = nullptr;
+	SDL_GLContext m_hContext = nullptr;
+
+	FrameFn m_FrameFn;
+
+	CRenderCommandList m_Lists[ 2 ];
+
+	/**
+	*	Index of the list that the main thread records into.
+	*/
+	size_t m_uiRecordIndex = 0;
+
+	std::thread m_Thread;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+
+	/**
+	*	Whether a frame was submitted that the render thread hasn't finished yet.
+	*/
+	bool m_bFramePending = false;
+
+	bool m_bStop = false;
+
+private:
+	CRenderThread( const CRenderThread& ) = delete;
+	CRenderThread& operator=( const CRenderThread& ) = delete;
+};
+
+#endif //ENGINE_CRENDERTHREAD_H
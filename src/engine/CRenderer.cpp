@@ -0,0 +1,881 @@
+#include <cstring>
+#include <memory>
+
+#include "Logging.h"
+
+#include "CFrameTimer.h"
+#include "CRenderCommandList.h"
+
+#include "TextureFile.h"
+
+#include "CRenderer.h"
+
+namespace
+{
+const GLubyte WHITE[ 4 ] = { 255, 255, 255, 255 };
+}
+
+bool CRenderer::Initialize( const bool bCoreProfile, IFileSystem2* pFileSystem )
+{
+	m_State.Reset();
+
+	//Texturing is always on in the fixed function pipeline, and doesn't exist as a capability in the core profile.
+	if( !bCoreProfile )
+		m_State.SetEnabled( GL_TEXTURE_2D, true );
+
+	m_State.SetEnabled( GL_BLEND, false );
+	m_bBlending = false;
+
+	glPolygonMode( GL_FRONT_AND_BACK, GL_FILL );
+
+	GLint iMaxTextureSize = 0;
+
+	glGetIntegerv( GL_MAX_TEXTURE_SIZE, &iMaxTextureSize );
+
+	m_iAtlasPageSize = iMaxTextureSize > 0 && iMaxTextureSize < ATLAS_PAGE_SIZE ? iMaxTextureSize : ATLAS_PAGE_SIZE;
+
+	//Only the core profile uses shaders.
+	if( bCoreProfile && m_ProgramCache.Initialize( pFileSystem ) )
+		Msg( "Caching shader program binaries in %s\n", CProgramCache::DIRECTORY );
+
+	if( !m_QuadBatch.Initialize( m_State, m_ProgramCache, bCoreProfile ) )
+		return false;
+
+	if( !m_WorldRenderer.Initialize( m_State, m_ProgramCache, bCoreProfile ) )
+		return false;
+
+	if( !m_EffectsRenderer.Initialize( m_State, m_ProgramCache, bCoreProfile ) )
+		return false;
+
+	m_QuadBatch.Bind();
+
+	m_TextureUploader.Initialize( m_State );
+
+	//Core in OpenGL 3.0, the ARB extension has the same entry points for older contexts.
+	m_bUICacheSupported.store( GLEW_VERSION_3_0 || GLEW_ARB_framebuffer_object, std::memory_order_relaxed );
+
+	m_bCompressedTextureSupported.store( GLEW_EXT_texture_compression_s3tc != 0, std::memory_order_relaxed );
+
+	m_TimerQueries.Initialize( CFrameTimer::NUM_GPU_PASSES );
+
+	return true;
+}
+
+void CRenderer::Shutdown()
+{
+	m_TimerQueries.Shutdown();
+
+	m_ProgramCache.Shutdown();
+
+	DestroyRenderTarget( m_UICache );
+
+	for( auto& cache : m_PanelCaches )
+	{
+		DestroyRenderTarget( cache.second );
+	}
+
+	m_PanelCaches.clear();
+	m_SavedTargets.clear();
+
+	m_EffectsRenderer.Shutdown();
+
+	m_WorldRenderer.Shutdown();
+
+	m_QuadBatch.Shutdown();
+
+	m_TextureUploader.Shutdown();
+
+	for( auto& texture : m_Textures )
+	{
+		if( texture.texture && texture.iAtlasX == -1 )
+		{
+			glDeleteTextures( 1, &texture.texture );
+			m_State.TextureDeleted( texture.texture );
+		}
+	}
+
+	m_Textures.clear();
+
+	for( auto& page : m_AtlasPages )
+	{
+		glDeleteTextures( 1, &page->texture );
+		m_State.TextureDeleted( page->texture );
+	}
+
+	m_AtlasPages.clear();
+
+	m_uiAtlasPages.store( 0, std::memory_order_relaxed );
+
+	m_iCurrentTexture = 0;
+}
+
+int CRenderer::CreateTextureHandle()
+{
+	return m_iNextTextureHandle.fetch_add( 1, std::memory_order_relaxed );
+}
+
+void CRenderer::Execute( const CRenderCommandList& list )
+{
+	using CommandType = CRenderCommandList::CommandType;
+
+	m_TimerQueries.BeginFrame();
+
+	for( const auto& command : list.GetCommands() )
+	{
+		const int* const pArgs = command.iArgs;
+
+		switch( command.type )
+		{
+		case CommandType::CLEAR:
+			{
+				m_QuadBatch.Flush();
+
+				glClearColor( 0, 0, 0, 1 );
+
+				glClear( GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT );
+				break;
+			}
+
+		case CommandType::BEGIN_2D:
+			{
+				m_QuadBatch.Flush();
+
+				m_State.Viewport( 0, 0, pArgs[ 0 ], pArgs[ 1 ] );
+
+				//Only changes anything if the size changed.
+				m_QuadBatch.SetProjection( pArgs[ 0 ], pArgs[ 1 ] );
+
+				m_State.SetEnabled( GL_CULL_FACE, false );
+				m_State.SetEnabled( GL_DEPTH_TEST, false );
+				SetBlending( false );
+
+				for( auto& ubColor : m_ubTexturedColor )
+				{
+					ubColor = 255;
+				}
+
+				m_iOffsetX = 0;
+				m_iOffsetY = 0;
+				m_Translations.clear();
+
+				m_iViewportWidth = pArgs[ 0 ];
+				m_iViewportHeight = pArgs[ 1 ];
+
+				m_iOriginX = 0;
+				m_iOriginY = 0;
+				break;
+			}
+
+		case CommandType::END_2D:
+			{
+				m_QuadBatch.Flush();
+				break;
+			}
+
+		case CommandType::SET_COLOR:
+			{
+				for( size_t uiIndex = 0; uiIndex < 4; ++uiIndex )
+				{
+					m_ubColor[ uiIndex ] = command.ubColor[ uiIndex ];
+				}
+
+				break;
+			}
+
+		case CommandType::FILLED_RECT:
+			{
+				SetBlending( false );
+
+				AddQuad( nullptr, pArgs[ 0 ], pArgs[ 1 ], pArgs[ 2 ], pArgs[ 3 ], m_ubColor );
+
+				UseColorForTextures();
+				break;
+			}
+
+		case CommandType::OUTLINED_RECT:
+			{
+				SetBlending( false );
+
+				//One pixel wide edges, covering the same pixels as a line strip through the corners.
+				AddQuad( nullptr, pArgs[ 0 ], pArgs[ 1 ], pArgs[ 2 ] + 1, pArgs[ 1 ] + 1, m_ubColor );
+				AddQuad( nullptr, pArgs[ 0 ], pArgs[ 3 ], pArgs[ 2 ] + 1, pArgs[ 3 ] + 1, m_ubColor );
+				AddQuad( nullptr, pArgs[ 0 ], pArgs[ 1 ] + 1, pArgs[ 0 ] + 1, pArgs[ 3 ], m_ubColor );
+				AddQuad( nullptr, pArgs[ 2 ], pArgs[ 1 ] + 1, pArgs[ 2 ] + 1, pArgs[ 3 ], m_ubColor );
+
+				UseColorForTextures();
+				break;
+			}
+
+		case CommandType::BIND_TEXTURE:
+			{
+				m_iCurrentTexture = pArgs[ 0 ];
+				break;
+			}
+
+		case CommandType::TEXTURED_RECT:
+			{
+				if( m_iCurrentTexture == 0 )
+					break;
+
+				SetBlending( false );
+
+				AddQuad( &GetTexture( m_iCurrentTexture ), pArgs[ 0 ], pArgs[ 1 ], pArgs[ 2 ], pArgs[ 3 ], m_ubTexturedColor );
+				break;
+			}
+
+		case CommandType::UPLOAD_TEXTURE:
+			{
+				UploadTexture( pArgs[ 0 ], pArgs[ 1 ], pArgs[ 2 ], list.GetData( command ) );
+				break;
+			}
+
+		case CommandType::UPLOAD_TEXTURE_FILE:
+			{
+				UploadTextureFile( pArgs[ 0 ], list.GetData( command ), command.uiDataSize );
+				break;
+			}
+
+		case CommandType::DELETE_TEXTURE:
+			{
+				DeleteTexture( pArgs[ 0 ] );
+				break;
+			}
+
+		case CommandType::TEXT:
+			{
+				SetBlending( true );
+
+				//Glyph alpha is coverage. Color alpha is ignored, like it is for everything else.
+				const GLubyte ubColor[ 4 ] = { command.ubColor[ 0 ], command.ubColor[ 1 ], command.ubColor[ 2 ], 255 };
+
+				const uint8_t* const pData = list.GetData( command );
+
+				const size_t uiCount = command.uiDataSize / sizeof( CRenderCommandList::Glyph_t );
+
+				for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+				{
+					CRenderCommandList::Glyph_t glyph;
+
+					//The data buffer isn't aligned for glyphs.
+					memcpy( &glyph, pData + uiIndex * sizeof( glyph ), sizeof( glyph ) );
+
+					AddQuad( &GetTexture( glyph.iTexture ), glyph.x0, glyph.y0, glyph.x1, glyph.y1, ubColor );
+				}
+
+				break;
+			}
+
+		case CommandType::PUSH_TRANSLATION:
+			{
+				//Translations replace the previous one, they don't add up.
+				m_Translations.push_back( { m_iOffsetX, m_iOffsetY } );
+
+				m_iOffsetX = pArgs[ 0 ];
+				m_iOffsetY = pArgs[ 1 ];
+				break;
+			}
+
+		case CommandType::POP_TRANSLATION:
+			{
+				if( !m_Translations.empty() )
+				{
+					m_iOffsetX = m_Translations.back().first;
+					m_iOffsetY = m_Translations.back().second;
+
+					m_Translations.pop_back();
+				}
+				else
+				{
+					m_iOffsetX = 0;
+					m_iOffsetY = 0;
+				}
+
+				break;
+			}
+
+		case CommandType::SET_SCISSOR:
+			{
+				m_QuadBatch.Flush();
+
+				m_State.SetEnabled( GL_SCISSOR_TEST, true );
+				m_bScissor = true;
+				glScissor( pArgs[ 0 ] - m_iOriginX, m_iViewportHeight - ( pArgs[ 3 ] - m_iOriginY ), pArgs[ 2 ] - pArgs[ 0 ], pArgs[ 3 ] - pArgs[ 1 ] );
+				break;
+			}
+
+		case CommandType::CLEAR_SCISSOR:
+			{
+				m_QuadBatch.Flush();
+
+				m_State.SetEnabled( GL_SCISSOR_TEST, false );
+				m_bScissor = false;
+				break;
+			}
+
+		case CommandType::BEGIN_UI_CACHE:
+			{
+				m_QuadBatch.Flush();
+
+				//If this fails, the UI is drawn straight to the screen this frame.
+				BindRenderTarget( m_UICache, pArgs[ 0 ], pArgs[ 1 ] );
+				break;
+			}
+
+		case CommandType::END_UI_CACHE:
+			{
+				m_QuadBatch.Flush();
+
+				BindFramebuffer( 0 );
+				break;
+			}
+
+		case CommandType::DRAW_UI_CACHE:
+			{
+				if( !m_UICache.framebuffer )
+					break;
+
+				SetBlending( false );
+
+				//Rows are stored bottom up.
+				m_QuadBatch.AddQuad( m_UICache.texture,
+									 0, 0, static_cast<float>( pArgs[ 0 ] ), static_cast<float>( pArgs[ 1 ] ),
+									 0, 1, 1, 0,
+									 WHITE );
+				break;
+			}
+
+		case CommandType::BEGIN_PANEL_CACHE:
+			{
+				BeginPanelCache( pArgs[ 0 ], pArgs[ 1 ], pArgs[ 2 ], pArgs[ 3 ] );
+				break;
+			}
+
+		case CommandType::END_PANEL_CACHE:
+			{
+				EndPanelCache();
+				break;
+			}
+
+		case CommandType::DRAW_PANEL_CACHE:
+			{
+				auto it = m_PanelCaches.find( m_iCurrentTexture );
+
+				if( it == m_PanelCaches.end() || !it->second.framebuffer )
+					break;
+
+				SetBlending( false );
+
+				//Panel caches are drawn at absolute positions, translations don't apply.
+				m_QuadBatch.AddQuad( it->second.texture,
+									 static_cast<float>( pArgs[ 0 ] - m_iOriginX ), static_cast<float>( pArgs[ 1 ] - m_iOriginY ),
+									 static_cast<float>( pArgs[ 2 ] - m_iOriginX ), static_cast<float>( pArgs[ 3 ] - m_iOriginY ),
+									 0, 1, 1, 0,
+									 WHITE );
+				break;
+			}
+
+		case CommandType::BEGIN_GPU_PASS:
+			{
+				m_QuadBatch.Flush();
+
+				m_TimerQueries.BeginPass( static_cast<size_t>( pArgs[ 0 ] ) );
+				break;
+			}
+
+		case CommandType::END_GPU_PASS:
+			{
+				m_QuadBatch.Flush();
+
+				m_TimerQueries.EndPass();
+				break;
+			}
+
+		case CommandType::LOAD_WORLD:
+			{
+				m_QuadBatch.Flush();
+
+				if( !m_WorldRenderer.Load( list.GetWorld( command ) ) )
+					Warning( "Couldn't upload the world\n" );
+
+				m_QuadBatch.Bind();
+				break;
+			}
+
+		case CommandType::UNLOAD_WORLD:
+			{
+				m_QuadBatch.Flush();
+
+				m_WorldRenderer.Unload();
+				break;
+			}
+
+		case CommandType::DRAW_WORLD:
+			{
+				m_QuadBatch.Flush();
+
+				SetBlending( false );
+
+				const uint8_t* const pData = list.GetData( command );
+
+				const size_t uiMatrixSize = sizeof( float ) * 16;
+
+				//The data buffer isn't aligned for floats or ranges.
+				m_WorldMatrix.resize( 16 );
+				memcpy( m_WorldMatrix.data(), pData, uiMatrixSize );
+
+				m_WorldRanges.resize( ( command.uiDataSize - uiMatrixSize ) / sizeof( CWorldMesh::DrawRange_t ) );
+
+				if( !m_WorldRanges.empty() )
+					memcpy( m_WorldRanges.data(), pData + uiMatrixSize, m_WorldRanges.size() * sizeof( CWorldMesh::DrawRange_t ) );
+
+				m_WorldRenderer.Draw( pArgs[ 0 ], pArgs[ 1 ], m_WorldMatrix.data(), m_WorldRanges.data(), m_WorldRanges.size() );
+
+				m_QuadBatch.Bind();
+				break;
+			}
+
+		case CommandType::DRAW_EFFECTS:
+			{
+				m_QuadBatch.Flush();
+
+				//The effects renderer sets its own blend functions, and turns blending off when it's done.
+				SetBlending( false );
+
+				const uint8_t* const pData = list.GetData( command );
+
+				const size_t uiMatrixSize = sizeof( float ) * 16;
+
+				m_WorldMatrix.resize( 16 );
+				memcpy( m_WorldMatrix.data(), pData, uiMatrixSize );
+
+				const size_t uiCount = ( command.uiDataSize - uiMatrixSize ) / sizeof( CRenderCommandList::Effect_t );
+
+				for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+				{
+					CRenderCommandList::Effect_t effect;
+
+					//The data buffer isn't aligned for effects.
+					memcpy( &effect, pData + uiMatrixSize + uiIndex * sizeof( effect ), sizeof( effect ) );
+
+					//Effects share the atlas with the UI. Untextured effects and textures that weren't uploaded yet use the white texture.
+					const auto& texture = GetTexture( effect.iTexture );
+
+					if( texture.texture )
+					{
+						m_EffectsRenderer.AddEffect( effect, texture.texture, texture.flS0, texture.flT0, texture.flS1, texture.flT1 );
+					}
+					else
+					{
+						m_EffectsRenderer.AddEffect( effect, m_QuadBatch.GetWhiteTexture(), 0, 0, 1, 1 );
+					}
+				}
+
+				m_EffectsRenderer.Draw( pArgs[ 0 ], pArgs[ 1 ], m_WorldMatrix.data() );
+
+				m_QuadBatch.Bind();
+				break;
+			}
+		}
+	}
+
+	m_QuadBatch.Flush();
+
+	m_TimerQueries.EndPass();
+
+	CQuadBatch::Stats_t stats;
+
+	m_QuadBatch.TakeStats( stats );
+
+	gl::CStateCache::Stats_t stateStats;
+
+	m_State.TakeStats( stateStats );
+
+	m_uiStateChanges.store( stateStats.uiIssued, std::memory_order_relaxed );
+	m_uiFilteredStateChanges.store( stateStats.uiFiltered, std::memory_order_relaxed );
+
+	m_uiUploadedBytes.store( m_TextureUploader.TakeUploadedBytes(), std::memory_order_relaxed );
+
+	m_uiQuads.store( stats.uiQuads, std::memory_order_relaxed );
+	m_uiDrawCalls.store( stats.uiDrawCalls, std::memory_order_relaxed );
+
+	CWorldRenderer::Stats_t worldStats;
+
+	m_WorldRenderer.TakeStats( worldStats );
+
+	m_uiWorldTriangles.store( worldStats.uiTriangles, std::memory_order_relaxed );
+	m_uiWorldDrawCalls.store( worldStats.uiDrawCalls, std::memory_order_relaxed );
+
+	CEffectsRenderer::Stats_t effectStats;
+
+	m_EffectsRenderer.TakeStats( effectStats );
+
+	m_uiEffects.store( effectStats.uiEffects, std::memory_order_relaxed );
+	m_uiEffectDrawCalls.store( effectStats.uiDrawCalls, std::memory_order_relaxed );
+}
+
+void CRenderer::AddQuad( const Texture_t* pTexture, const int x0, const int y0, const int x1, const int y1, const GLubyte* pubColor )
+{
+	const int iOffsetX = m_iOffsetX - m_iOriginX;
+	const int iOffsetY = m_iOffsetY - m_iOriginY;
+
+	if( pTexture )
+	{
+		m_QuadBatch.AddQuad( pTexture->texture,
+							 static_cast<float>( x0 + iOffsetX ), static_cast<float>( y0 + iOffsetY ),
+							 static_cast<float>( x1 + iOffsetX ), static_cast<float>( y1 + iOffsetY ),
+							 pTexture->flS0, pTexture->flT0, pTexture->flS1, pTexture->flT1,
+							 pubColor );
+	}
+	else
+	{
+		m_QuadBatch.AddQuad( 0,
+							 static_cast<float>( x0 + iOffsetX ), static_cast<float>( y0 + iOffsetY ),
+							 static_cast<float>( x1 + iOffsetX ), static_cast<float>( y1 + iOffsetY ),
+							 0, 0, 1, 1,
+							 pubColor );
+	}
+}
+
+void CRenderer::UseColorForTextures()
+{
+	for( size_t uiIndex = 0; uiIndex < 4; ++uiIndex )
+	{
+		m_ubTexturedColor[ uiIndex ] = m_ubColor[ uiIndex ];
+	}
+}
+
+bool CRenderer::BindRenderTarget( RenderTarget_t& target, const int iWidth, const int iHeight )
+{
+	if( !m_bUICacheSupported.load( std::memory_order_relaxed ) || iWidth <= 0 || iHeight <= 0 )
+		return false;
+
+	if( target.framebuffer && ( iWidth != target.iWidth || iHeight != target.iHeight ) )
+		DestroyRenderTarget( target );
+
+	if( !target.framebuffer )
+	{
+		target.texture = m_TextureUploader.CreateTexture( iWidth, iHeight );
+
+		glGenFramebuffers( 1, &target.framebuffer );
+
+		BindFramebuffer( target.framebuffer );
+
+		glFramebufferTexture2D( GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0 );
+
+		if( glCheckFramebufferStatus( GL_FRAMEBUFFER ) != GL_FRAMEBUFFER_COMPLETE )
+		{
+			BindFramebuffer( 0 );
+
+			DestroyRenderTarget( target );
+
+			//Don't try again, the engine falls back to drawing the UI every frame.
+			m_bUICacheSupported.store( false, std::memory_order_relaxed );
+
+			return false;
+		}
+
+		target.iWidth = iWidth;
+		target.iHeight = iHeight;
+
+		return true;
+	}
+
+	BindFramebuffer( target.framebuffer );
+
+	return true;
+}
+
+void CRenderer::DestroyRenderTarget( RenderTarget_t& target )
+{
+	if( target.framebuffer )
+	{
+		if( m_CurrentFramebuffer == target.framebuffer )
+			BindFramebuffer( 0 );
+
+		glDeleteFramebuffers( 1, &target.framebuffer );
+	}
+
+	if( target.texture )
+	{
+		glDeleteTextures( 1, &target.texture );
+		m_State.TextureDeleted( target.texture );
+	}
+
+	target = RenderTarget_t();
+}
+
+void CRenderer::BindFramebuffer( const GLuint framebuffer )
+{
+	if( framebuffer == m_CurrentFramebuffer )
+		return;
+
+	glBindFramebuffer( GL_FRAMEBUFFER, framebuffer );
+
+	m_CurrentFramebuffer = framebuffer;
+}
+
+void CRenderer::BeginPanelCache( const int x0, const int y0, const int x1, const int y1 )
+{
+	m_QuadBatch.Flush();
+
+	m_SavedTargets.push_back( { m_CurrentFramebuffer, m_iViewportWidth, m_iViewportHeight, m_iOriginX, m_iOriginY, m_bScissor } );
+
+	//If this fails, the panel is drawn straight to the current target.
+	if( m_iCurrentTexture <= 0 || !BindRenderTarget( m_PanelCaches[ m_iCurrentTexture ], x1 - x0, y1 - y0 ) )
+		return;
+
+	m_iViewportWidth = x1 - x0;
+	m_iViewportHeight = y1 - y0;
+
+	m_State.Viewport( 0, 0, m_iViewportWidth, m_iViewportHeight );
+	m_QuadBatch.SetProjection( m_iViewportWidth, m_iViewportHeight );
+
+	m_iOriginX = x0;
+	m_iOriginY = y0;
+
+	m_State.SetEnabled( GL_SCISSOR_TEST, false );
+	m_bScissor = false;
+
+	glClearColor( 0, 0, 0, 1 );
+	glClear( GL_COLOR_BUFFER_BIT );
+}
+
+void CRenderer::EndPanelCache()
+{
+	if( m_SavedTargets.empty() )
+		return;
+
+	m_QuadBatch.Flush();
+
+	const auto saved = m_SavedTargets.back();
+
+	m_SavedTargets.pop_back();
+
+	BindFramebuffer( saved.framebuffer );
+
+	m_iViewportWidth = saved.iViewportWidth;
+	m_iViewportHeight = saved.iViewportHeight;
+
+	m_State.Viewport( 0, 0, m_iViewportWidth, m_iViewportHeight );
+	m_QuadBatch.SetProjection( m_iViewportWidth, m_iViewportHeight );
+
+	m_iOriginX = saved.iOriginX;
+	m_iOriginY = saved.iOriginY;
+
+	//The scissor rectangle itself was left alone.
+	m_State.SetEnabled( GL_SCISSOR_TEST, saved.bScissor );
+	m_bScissor = saved.bScissor;
+}
+
+void CRenderer::SetBlending( const bool bBlending )
+{
+	if( bBlending == m_bBlending )
+		return;
+
+	m_QuadBatch.Flush();
+
+	m_State.SetEnabled( GL_BLEND, bBlending );
+
+	if( bBlending )
+		m_State.BlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+
+	m_bBlending = bBlending;
+}
+
+CRenderer::Texture_t& CRenderer::GetTexture( const int iHandle )
+{
+	//Handle 0 is never given out, use it for invalid handles.
+	const size_t uiIndex = iHandle > 0 ? static_cast<size_t>( iHandle ) : 0;
+
+	if( uiIndex >= m_Textures.size() )
+		m_Textures.resize( uiIndex + 1 );
+
+	return m_Textures[ uiIndex ];
+}
+
+void CRenderer::UploadTexture( const int iHandle, const int iWidth, const int iHeight, const uint8_t* pRGBA )
+{
+	if( iHandle <= 0 || iWidth <= 0 || iHeight <= 0 )
+		return;
+
+	auto& texture = GetTexture( iHandle );
+
+	//Quads that were added before use the old contents.
+	if( texture.texture )
+		m_QuadBatch.Flush();
+
+	if( texture.iAtlasX != -1 )
+	{
+		//Same size, update it in place. Otherwise the old space is lost until shutdown.
+		if( texture.iWidth == iWidth && texture.iHeight == iHeight )
+		{
+			for( const auto& page : m_AtlasPages )
+			{
+				if( page->texture == texture.texture )
+				{
+					WriteToAtlas( *page, texture.iAtlasX, texture.iAtlasY, iWidth, iHeight, pRGBA );
+					return;
+				}
+			}
+		}
+
+		texture = Texture_t();
+	}
+	else if( texture.texture )
+	{
+		//Same size, update it in place. Storage can't be resized, so other sizes need a new texture.
+		if( texture.iWidth == iWidth && texture.iHeight == iHeight )
+		{
+			m_TextureUploader.Upload( texture.texture, 0, 0, iWidth, iHeight, pRGBA );
+			return;
+		}
+
+		glDeleteTextures( 1, &texture.texture );
+		m_State.TextureDeleted( texture.texture );
+		texture.texture = 0;
+	}
+
+	texture.iWidth = iWidth;
+	texture.iHeight = iHeight;
+
+	if( iWidth <= MAX_ATLAS_IMAGE_SIZE && iHeight <= MAX_ATLAS_IMAGE_SIZE )
+	{
+		int iX, iY;
+
+		if( auto pPage = AllocateInAtlas( iWidth + ATLAS_PADDING * 2, iHeight + ATLAS_PADDING * 2, iX, iY ) )
+		{
+			texture.texture = pPage->texture;
+			texture.iAtlasX = iX + ATLAS_PADDING;
+			texture.iAtlasY = iY + ATLAS_PADDING;
+
+			const float flPageSize = static_cast<float>( m_iAtlasPageSize );
+
+			texture.flS0 = texture.iAtlasX / flPageSize;
+			texture.flT0 = texture.iAtlasY / flPageSize;
+			texture.flS1 = ( texture.iAtlasX + iWidth ) / flPageSize;
+			texture.flT1 = ( texture.iAtlasY + iHeight ) / flPageSize;
+
+			WriteToAtlas( *pPage, texture.iAtlasX, texture.iAtlasY, iWidth, iHeight, pRGBA );
+			return;
+		}
+	}
+
+	texture.texture = m_TextureUploader.CreateTexture( iWidth, iHeight );
+
+	texture.flS0 = texture.flT0 = 0;
+	texture.flS1 = texture.flT1 = 1;
+
+	m_TextureUploader.Upload( texture.texture, 0, 0, iWidth, iHeight, pRGBA );
+}
+
+void CRenderer::DeleteTexture( const int iHandle )
+{
+	if( iHandle <= 0 || static_cast<size_t>( iHandle ) >= m_Textures.size() )
+		return;
+
+	auto& texture = m_Textures[ iHandle ];
+
+	if( texture.texture )
+	{
+		//Quads that were added before still use it.
+		m_QuadBatch.Flush();
+
+		//Atlas pages are shared, the space is lost until shutdown.
+		if( texture.iAtlasX == -1 )
+		{
+			glDeleteTextures( 1, &texture.texture );
+			m_State.TextureDeleted( texture.texture );
+		}
+	}
+
+	texture = Texture_t();
+
+	auto it = m_PanelCaches.find( iHandle );
+
+	if( it != m_PanelCaches.end() )
+	{
+		m_QuadBatch.Flush();
+
+		DestroyRenderTarget( it->second );
+		m_PanelCaches.erase( it );
+	}
+}
+
+void CRenderer::UploadTextureFile( const int iHandle, const uint8_t* pData, const size_t uiSize )
+{
+	texfile::TextureView_t view;
+
+	if( iHandle <= 0 || !texfile::ParseTexture( pData, uiSize, view ) )
+		return;
+
+	const GLuint created = m_TextureUploader.CreateTexture( view );
+
+	if( !created )
+		return;
+
+	DeleteTexture( iHandle );
+
+	auto& texture = GetTexture( iHandle );
+
+	texture.texture = created;
+	texture.iWidth = static_cast<int>( view.uiWidth );
+	texture.iHeight = static_cast<int>( view.uiHeight );
+}
+
+CRenderer::AtlasPage_t* CRenderer::AllocateInAtlas( const int iWidth, const int iHeight, int& iOutX, int& iOutY )
+{
+	if( iWidth > m_iAtlasPageSize || iHeight > m_iAtlasPageSize )
+		return nullptr;
+
+	for( auto& page : m_AtlasPages )
+	{
+		if( page->packer.Allocate( iWidth, iHeight, iOutX, iOutY ) )
+			return page.get();
+	}
+
+	auto page = std::make_unique<AtlasPage_t>( m_iAtlasPageSize );
+
+	page->texture = m_TextureUploader.CreateTexture( m_iAtlasPageSize, m_iAtlasPageSize );
+
+	if( !page->packer.Allocate( iWidth, iHeight, iOutX, iOutY ) )
+	{
+		glDeleteTextures( 1, &page->texture );
+		m_State.TextureDeleted( page->texture );
+		return nullptr;
+	}
+
+	m_AtlasPages.push_back( std::move( page ) );
+
+	m_uiAtlasPages.store( m_AtlasPages.size(), std::memory_order_relaxed );
+
+	return m_AtlasPages.back().get();
+}
+
+void CRenderer::WriteToAtlas( const AtlasPage_t& page, const int iX, const int iY, const int iWidth, const int iHeight, const uint8_t* pRGBA )
+{
+	const int iPaddedWidth = iWidth + ATLAS_PADDING * 2;
+	const int iPaddedHeight = iHeight + ATLAS_PADDING * 2;
+
+	m_PaddedImage.resize( static_cast<size_t>( iPaddedWidth ) * iPaddedHeight * 4 );
+
+	for( int iRow = 0; iRow < iPaddedHeight; ++iRow )
+	{
+		//Clamp to the image, which repeats the edge pixels into the padding.
+		int iSourceRow = iRow - ATLAS_PADDING;
+
+		iSourceRow = iSourceRow < 0 ? 0 : ( iSourceRow >= iHeight ? iHeight - 1 : iSourceRow );
+
+		const uint8_t* pSource = pRGBA + static_cast<size_t>( iSourceRow ) * iWidth * 4;
+		uint8_t* pDest = m_PaddedImage.data() + static_cast<size_t>( iRow ) * iPaddedWidth * 4;
+
+		for( int iPad = 0; iPad < ATLAS_PADDING; ++iPad )
+		{
+			memcpy( pDest + iPad * 4, pSource, 4 );
+			memcpy( pDest + ( ATLAS_PADDING + iWidth + iPad ) * 4, pSource + ( iWidth - 1 ) * 4, 4 );
+		}
+
+		memcpy( pDest + ATLAS_PADDING * 4, pSource, static_cast<size_t>( iWidth ) * 4 );
+	}
+
+	m_TextureUploader.Upload( page.texture, iX - ATLAS_PADDING, iY - ATLAS_PADDING, iPaddedWidth, iPaddedHeight, m_PaddedImage.data() );
+}
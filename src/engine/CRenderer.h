@@ -0,0 +1,356 @@
+#ifndef ENGINE_CRENDERER_H
+#define ENGINE_CRENDERER_H
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "CAtlasPacker.h"
+#include "CEffectsRenderer.h"
+#include "CProgramCache.h"
+#include "CQuadBatch.h"
+#include "CTextureUploader.h"
+#include "CWorldRenderer.h"
+#include "GLUtils.h"
+
+class CRenderCommandList;
+
+/**
+*	Executes render command lists. Must only be used on the thread that owns the OpenGL context,
+*	except for CreateTextureHandle, which can be called from anywhere.
+*/
+class CRenderer final
+{
+public:
+	/**
+	*	Size of atlas pages. Clamped to the largest size the driver supports.
+	*/
+	static const int ATLAS_PAGE_SIZE = 2048;
+
+	/**
+	*	Images larger than this in either dimension get their own texture.
+	*/
+	static const int MAX_ATLAS_IMAGE_SIZE = 512;
+
+	/**
+	*	Each image in an atlas gets a border of this many pixels copied from its edges, so sampling at its edges doesn't
+	*	pick up its neighbors.
+	*/
+	static const int ATLAS_PADDING = 1;
+
+public:
+	CRenderer() = default;
+
+	/**
+	*	Sets up OpenGL state. Call once the context is current.
+	*	@param bCoreProfile Whether the context is a core profile context, which uses shaders instead of the fixed function pipeline.
+	*	@param pFileSystem Filesystem to cache shader program binaries in, or null to always compile shaders.
+	*	@return Whether initialization succeeded.
+	*/
+	bool Initialize( const bool bCoreProfile, IFileSystem2* pFileSystem );
+
+	/**
+	*	Deletes all textures.
+	*/
+	void Shutdown();
+
+	/**
+	*	Reserves a texture handle. The OpenGL texture is created when the handle is first used in a command list.
+	*/
+	int CreateTextureHandle();
+
+	/**
+	*	Executes a frame's commands.
+	*/
+	void Execute( const CRenderCommandList& list );
+
+	/**
+	*	@return Time the GPU spent on a pass, in milliseconds. Lags a few frames behind. Can be called from any thread.
+	*/
+	float GetGPUPassTime( const size_t uiPass ) const { return m_TimerQueries.GetPassTime( uiPass ); }
+
+	/**
+	*	@return Number of quads and draw calls in the last frame. Can be called from any thread.
+	*/
+	size_t GetQuadCount() const { return m_uiQuads.load( std::memory_order_relaxed ); }
+	size_t GetDrawCallCount() const { return m_uiDrawCalls.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return Number of world triangles and draw calls in the last frame. Can be called from any thread.
+	*/
+	size_t GetWorldTriangleCount() const { return m_uiWorldTriangles.load( std::memory_order_relaxed ); }
+	size_t GetWorldDrawCallCount() const { return m_uiWorldDrawCalls.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return Number of effects and draw calls in the last frame. Can be called from any thread.
+	*/
+	size_t GetEffectCount() const { return m_uiEffects.load( std::memory_order_relaxed ); }
+	size_t GetEffectDrawCallCount() const { return m_uiEffectDrawCalls.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return Number of atlas pages. Can be called from any thread.
+	*/
+	size_t GetAtlasPageCount() const { return m_uiAtlasPages.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return Size of an atlas page, in bytes. Only valid after Initialize.
+	*/
+	size_t GetAtlasPageBytes() const { return static_cast<size_t>( m_iAtlasPageSize ) * m_iAtlasPageSize * 4; }
+
+	/**
+	*	@return Number of bytes of texture data uploaded in the last frame. Can be called from any thread.
+	*/
+	size_t GetUploadedBytes() const { return m_uiUploadedBytes.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return Number of state changes issued and filtered by the state cache in the last frame. Can be called from any thread.
+	*/
+	size_t GetStateChangeCount() const { return m_uiStateChanges.load( std::memory_order_relaxed ); }
+	size_t GetFilteredStateChangeCount() const { return m_uiFilteredStateChanges.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return Whether the UI can be drawn into a cache with BEGIN_UI_CACHE. Needs framebuffer objects.
+	*	Can be called from any thread.
+	*/
+	bool IsUICacheSupported() const { return m_bUICacheSupported.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return Whether block compressed texture files can be uploaded. Can be called from any thread.
+	*/
+	bool IsCompressedTextureSupported() const { return m_bCompressedTextureSupported.load( std::memory_order_relaxed ); }
+
+private:
+	/**
+	*	Where a texture handle's image is stored.
+	*/
+	struct Texture_t
+	{
+		/**
+		*	OpenGL texture, either an atlas page or the image's own texture. 0 if nothing was uploaded yet.
+		*/
+		GLuint texture = 0;
+
+		/**
+		*	Texture coordinates of the image.
+		*/
+		float flS0 = 0, flT0 = 0, flS1 = 1, flT1 = 1;
+
+		int iWidth = 0;
+		int iHeight = 0;
+
+		/**
+		*	Position in the atlas page, or -1 if the image has its own texture.
+		*/
+		int iAtlasX = -1;
+		int iAtlasY = -1;
+	};
+
+	/**
+	*	Texture that can be drawn to.
+	*/
+	struct RenderTarget_t
+	{
+		GLuint framebuffer = 0;
+		GLuint texture = 0;
+
+		int iWidth = 0;
+		int iHeight = 0;
+	};
+
+	/**
+	*	Drawing state to go back to when a panel cache is done.
+	*/
+	struct SavedTarget_t
+	{
+		GLuint framebuffer;
+
+		int iViewportWidth;
+		int iViewportHeight;
+
+		int iOriginX;
+		int iOriginY;
+
+		bool bScissor;
+	};
+
+	struct AtlasPage_t
+	{
+		AtlasPage_t( const int iSize )
+			: packer( iSize, iSize )
+		{
+		}
+
+		GLuint texture = 0;
+		CAtlasPacker packer;
+	};
+
+private:
+	/**
+	*	@return The texture for the given handle.
+	*/
+	Texture_t& GetTexture( const int iHandle );
+
+	/**
+	*	Uploads an image for a texture handle. Puts it in an atlas page if it's small enough.
+	*/
+	void UploadTexture( const int iHandle, const int iWidth, const int iHeight, const uint8_t* pRGBA );
+
+	/**
+	*	Frees the texture of a texture handle. The handle can be uploaded to again.
+	*/
+	void DeleteTexture( const int iHandle );
+
+	/**
+	*	Replaces a texture handle's texture with one made from a precompiled texture file. These always get their own texture.
+	*/
+	void UploadTextureFile( const int iHandle, const uint8_t* pData, const size_t uiSize );
+
+	/**
+	*	Finds room in an atlas page. Adds a page if none have room.
+	*	@return The page, or null if the image doesn't fit in a page.
+	*/
+	AtlasPage_t* AllocateInAtlas( const int iWidth, const int iHeight, int& iOutX, int& iOutY );
+
+	/**
+	*	Copies an image into an atlas page, with its edges extended into the padding.
+	*/
+	void WriteToAtlas( const AtlasPage_t& page, const int iX, const int iY, const int iWidth, const int iHeight, const uint8_t* pRGBA );
+
+	/**
+	*	Adds a quad at the current translation.
+	*/
+	void AddQuad( const Texture_t* pTexture, const int x0, const int y0, const int x1, const int y1, const GLubyte* pubColor );
+
+	/**
+	*	Textured quads are drawn with the color of the last untextured quad, like immediate mode drawing did.
+	*/
+	void UseColorForTextures();
+
+	/**
+	*	Enables or disables alpha blending. Quads that were added before are drawn with the old state.
+	*/
+	void SetBlending( const bool bBlending );
+
+	/**
+	*	Binds a render target's framebuffer, creating or resizing it as needed.
+	*	If framebuffers turn out not to work, caching is disabled.
+	*	@return Whether the framebuffer is bound.
+	*/
+	bool BindRenderTarget( RenderTarget_t& target, const int iWidth, const int iHeight );
+
+	void DestroyRenderTarget( RenderTarget_t& target );
+
+	void BindFramebuffer( const GLuint framebuffer );
+
+	/**
+	*	Starts drawing a panel into the cache for the bound texture handle. The panel covers x0, y0 to x1, y1 in absolute 2D coordinates.
+	*/
+	void BeginPanelCache( const int x0, const int y0, const int x1, const int y1 );
+
+	void EndPanelCache();
+
+private:
+	std::atomic<int> m_iNextTextureHandle{ 1 };
+
+	gl::CStateCache m_State;
+
+	std::atomic<size_t> m_uiStateChanges{ 0 };
+	std::atomic<size_t> m_uiFilteredStateChanges{ 0 };
+
+	/**
+	*	Textures, indexed by handle.
+	*/
+	std::vector<Texture_t> m_Textures;
+
+	std::vector<std::unique_ptr<AtlasPage_t>> m_AtlasPages;
+
+	int m_iAtlasPageSize = ATLAS_PAGE_SIZE;
+
+	/**
+	*	Padded copy of an image, for uploading to an atlas page.
+	*/
+	std::vector<uint8_t> m_PaddedImage;
+
+	std::atomic<size_t> m_uiAtlasPages{ 0 };
+
+	GLubyte m_ubColor[ 4 ] = { 255, 255, 255, 255 };
+	GLubyte m_ubTexturedColor[ 4 ] = { 255, 255, 255, 255 };
+
+	int m_iCurrentTexture = 0;
+
+	int m_iOffsetX = 0;
+	int m_iOffsetY = 0;
+
+	std::vector<std::pair<int, int>> m_Translations;
+
+	/**
+	*	Only text is blended, everything else is drawn opaque.
+	*/
+	bool m_bBlending = false;
+
+	/**
+	*	Size of the current 2D viewport. The height is used to flip scissor rectangles to OpenGL's bottom left origin.
+	*/
+	int m_iViewportWidth = 0;
+	int m_iViewportHeight = 0;
+
+	/**
+	*	Position of the current target in 2D coordinates. Non-zero while drawing into a panel cache.
+	*/
+	int m_iOriginX = 0;
+	int m_iOriginY = 0;
+
+	bool m_bScissor = false;
+
+	GLuint m_CurrentFramebuffer = 0;
+
+	std::atomic<bool> m_bUICacheSupported{ false };
+
+	std::atomic<bool> m_bCompressedTextureSupported{ false };
+
+	RenderTarget_t m_UICache;
+
+	/**
+	*	Panel caches, by texture handle.
+	*/
+	std::unordered_map<int, RenderTarget_t> m_PanelCaches;
+
+	std::vector<SavedTarget_t> m_SavedTargets;
+
+	CProgramCache m_ProgramCache;
+
+	CQuadBatch m_QuadBatch;
+
+	CWorldRenderer m_WorldRenderer;
+
+	/**
+	*	Matrix and ranges of a DRAW_WORLD command, copied out of the unaligned command data.
+	*/
+	std::vector<float> m_WorldMatrix;
+	std::vector<CWorldMesh::DrawRange_t> m_WorldRanges;
+
+	CEffectsRenderer m_EffectsRenderer;
+
+	CTextureUploader m_TextureUploader;
+
+	std::atomic<size_t> m_uiUploadedBytes{ 0 };
+
+	std::atomic<size_t> m_uiQuads{ 0 };
+	std::atomic<size_t> m_uiDrawCalls{ 0 };
+
+	std::atomic<size_t> m_uiWorldTriangles{ 0 };
+	std::atomic<size_t> m_uiWorldDrawCalls{ 0 };
+
+	std::atomic<size_t> m_uiEffects{ 0 };
+	std::atomic<size_t> m_uiEffectDrawCalls{ 0 };
+
+	gl::CTimerQueries m_TimerQueries;
+
+private:
+	CRenderer( const CRenderer& ) = delete;
+	CRenderer& operator=( const CRenderer& ) = delete;
+};
+
+#endif //ENGINE_CRENDERER_H
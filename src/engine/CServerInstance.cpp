@@ -0,0 +1,102 @@
+#include <cstdio>
+
+#include "Engine.h"
+#include "Logging.h"
+
+#include "CServerInstance.h"
+
+namespace
+{
+/**
+*	Instance whose commands are executing on this thread.
+*/
+thread_local CServerInstance* g_pCurrentInstance = nullptr;
+}
+
+CServerInstance::CServerInstance( const size_t uiIndex )
+	: m_uiIndex( uiIndex )
+	, m_Hostname{ "hostname", const_cast<char*>( "" ) }
+	, m_TickRate{ "sys_ticrate", const_cast<char*>( "100" ) }
+{
+	m_CVar.Initialize();
+	m_CVar.SetScriptCache( &m_Scripts );
+
+	//The frame budget cvars belong to the main command buffer.
+	m_CommandBuffer.Initialize( &m_CVar, false );
+
+	//The value is copied when the cvar is added.
+	char szHostname[ 64 ];
+
+	snprintf( szHostname, sizeof( szHostname ), "Instance %u", static_cast<unsigned int>( m_uiIndex ) );
+
+	m_Hostname.string = szHostname;
+
+	m_CVar.AddCVar( &m_Hostname );
+	m_CVar.AddCVar( &m_TickRate );
+
+	m_CVar.AddCommand( "status", &CServerInstance::Cmd_Status_f );
+}
+
+CServerInstance::~CServerInstance()
+{
+	Stop();
+
+	//Frees their values.
+	m_CVar.RemoveCVar( m_TickRate.pszName );
+	m_CVar.RemoveCVar( m_Hostname.pszName );
+}
+
+void CServerInstance::Start()
+{
+	char szConfig[ 64 ];
+
+	snprintf( szConfig, sizeof( szConfig ), "instance%u.cfg", static_cast<unsigned int>( m_uiIndex ) );
+
+	if( g_pFileSystem->FileExists( szConfig ) )
+	{
+		char szCommand[ 80 ];
+
+		snprintf( szCommand, sizeof( szCommand ), "exec %s\n", szConfig );
+
+		QueueCommand( szCommand );
+	}
+
+	m_Thread.SetTickRate( m_TickRate.value );
+	m_Thread.Start( [ this ]( const double flTickInterval ) { Tick( flTickInterval ); } );
+}
+
+void CServerInstance::Stop()
+{
+	m_Thread.Stop();
+}
+
+void CServerInstance::Tick( const double flTickInterval )
+{
+	g_pCurrentInstance = this;
+
+	m_CommandBuffer.Execute();
+
+	g_pCurrentInstance = nullptr;
+
+	m_Thread.SetTickRate( m_TickRate.value );
+
+	//Instances already run in parallel, so each one integrates on its own thread instead of sharing the job system.
+	m_Entities.Integrate( static_cast<float>( flTickInterval ) );
+}
+
+void CServerInstance::Cmd_Status_f()
+{
+	auto pInstance = g_pCurrentInstance;
+
+	if( !pInstance )
+		return;
+
+	CServerThread::Stats_t stats;
+
+	pInstance->GetStats( stats );
+
+	Msg( "%u \"%s\": %.0f ticks/s, %u entities, %llu ticks, %.3f ms average, %.3f ms max, %.2f s dropped\n",
+		 static_cast<unsigned int>( pInstance->m_uiIndex ), pInstance->m_Hostname.string, pInstance->m_TickRate.value,
+		 static_cast<unsigned int>( pInstance->m_Entities.GetCount() ), static_cast<unsigned long long>( stats.uiTicks ),
+		 stats.uiTicks > 0 ? stats.flTotalMS / stats.uiTicks : 0.0, stats.flMaxMS, stats.flDroppedTime );
+}
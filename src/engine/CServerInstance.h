@@ -0,0 +1,84 @@
+#ifndef ENGINE_CSERVERINSTANCE_H
+#define ENGINE_CSERVERINSTANCE_H
+
+#include <cstddef>
+
+#include "cvardef.h"
+
+#include "CAlignedNew.h"
+#include "CEntityList.h"
+#include "CServerThread.h"
+
+#include "console/CCommandBuffer.h"
+#include "console/CCommandScript.h"
+#include "console/CCVarSystem.h"
+
+/**
+*	A dedicated server that runs on its own thread, isolated from the other instances hosted by the same process.
+*	Each instance has its own cvars, command buffer, compiled scripts and entities, and ticks at its own sys_ticrate.
+*	The filesystem is process wide, so instances share its search paths, mapped pack files and caches instead of each loading their own.
+*	Commands are queued from any thread, and execute on the instance's thread at the start of its next tick.
+*	Its server thread's loopback queues are cache line aligned, so it allocates through CAlignedNew.
+*/
+class CServerInstance final : public CAlignedNew<CServerInstance>
+{
+public:
+	/**
+	*	@param uiIndex Index of the instance in the host, used in its name and config file name.
+	*/
+	CServerInstance( const size_t uiIndex );
+	~CServerInstance();
+
+	size_t GetIndex() const { return m_uiIndex; }
+
+	bool IsRunning() const { return m_Thread.IsRunning(); }
+
+	/**
+	*	Starts ticking. Executes instance<index>.cfg on the first tick, if it exists.
+	*/
+	void Start();
+
+	/**
+	*	Stops the thread once its current tick has finished. Commands that haven't executed yet are kept.
+	*/
+	void Stop();
+
+	/**
+	*	Queues commands to execute on the instance's thread. Can be called from any thread.
+	*/
+	void QueueCommand( const char* pszText ) { m_CommandBuffer.QueueText( pszText ); }
+
+	void GetStats( CServerThread::Stats_t& stats ) const { m_Thread.GetStats( stats ); }
+
+private:
+	/**
+	*	Runs one tick on the instance's thread.
+	*/
+	void Tick( const double flTickInterval );
+
+	/**
+	*	Prints the instance's name, tick rate, entities and tick statistics.
+	*/
+	static void Cmd_Status_f();
+
+private:
+	const size_t m_uiIndex;
+
+	cvar::CCVarSystem m_CVar;
+	CCommandBuffer m_CommandBuffer;
+	CCommandScriptCache m_Scripts;
+
+	//Registered in m_CVar, so each instance has its own.
+	cvar_t m_Hostname;
+	cvar_t m_TickRate;
+
+	CEntityList m_Entities;
+
+	CServerThread m_Thread;
+
+private:
+	CServerInstance( const CServerInstance& ) = delete;
+	CServerInstance& operator=( const CServerInstance& ) = delete;
+};
+
+#endif //ENGINE_CSERVERINSTANCE_H
@@ -0,0 +1,102 @@
+#include <algorithm>
+
+#include "CFixedTimestep.h"
+#include "CFrameLimiter.h"
+
+#include "CServerThread.h"
+
+CServerThread::CServerThread()
+	: m_flTickRate( CFixedTimestep::DEFAULT_TICK_RATE )
+{
+}
+
+CServerThread::~CServerThread()
+{
+	Stop();
+}
+
+void CServerThread::Start( TickFn tickFn )
+{
+	Stop();
+
+	m_TickFn = std::move( tickFn );
+
+	m_Stats = Stats_t();
+	m_flDroppedTimeBase = 0;
+
+	m_bStop.store( false, std::memory_order_relaxed );
+	m_Thread = std::thread( &CServerThread::ThreadFunc, this );
+}
+
+void CServerThread::Stop()
+{
+	if( !m_Thread.joinable() )
+		return;
+
+	m_bStop.store( true, std::memory_order_relaxed );
+
+	m_Thread.join();
+
+	m_TickFn = nullptr;
+}
+
+void CServerThread::GetStats( Stats_t& stats ) const
+{
+	std::lock_guard<std::mutex> lock( m_StatsMutex );
+
+	stats = m_Stats;
+}
+
+void CServerThread::ResetStats()
+{
+	std::lock_guard<std::mutex> lock( m_StatsMutex );
+
+	m_flDroppedTimeBase += m_Stats.flDroppedTime;
+
+	m_Stats = Stats_t();
+}
+
+void CServerThread::ThreadFunc()
+{
+	CFixedTimestep timestep;
+
+	//The server has the thread to itself, so sleeping is precise enough; ticks that start late are caught up by the timestep.
+	CFrameLimiter limiter;
+
+	limiter.SetSleepOnly( true );
+
+	auto lastTime = Clock::now();
+
+	while( !m_bStop.load( std::memory_order_relaxed ) )
+	{
+		timestep.SetTickRate( m_flTickRate.load( std::memory_order_relaxed ) );
+
+		limiter.SetMaxFPS( timestep.GetTickRate() );
+		limiter.WaitForNextFrame();
+
+		const auto now = Clock::now();
+
+		const unsigned int uiTicks = timestep.Advance( std::chrono::duration<double>( now - lastTime ).count() );
+
+		lastTime = now;
+
+		for( unsigned int uiTick = 0; uiTick < uiTicks; ++uiTick )
+		{
+			const auto start = Clock::now();
+
+			m_TickFn( timestep.GetTickInterval() );
+
+			const double flMS = std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+
+			std::lock_guard<std::mutex> lock( m_StatsMutex );
+
+			++m_Stats.uiTicks;
+			m_Stats.flTotalMS += flMS;
+			m_Stats.flMaxMS = std::max( m_Stats.flMaxMS, flMS );
+		}
+
+		std::lock_guard<std::mutex> lock( m_StatsMutex );
+
+		m_Stats.flDroppedTime = timestep.GetDroppedTime() - m_flDroppedTimeBase;
+	}
+}
@@ -0,0 +1,124 @@
+#ifndef ENGINE_CSERVERTHREAD_H
+#define ENGINE_CSERVERTHREAD_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "CLoopbackQueue.h"
+
+/**
+*	Messages sent from the server thread to the local client.
+*	Each loopback message starts with its type as a byte.
+*/
+enum class ServerMessage : uint8_t
+{
+	/**
+	*	A tick has finished. Contains the tick count as a long and the tick interval as a float.
+	*/
+	TICK = 0,
+};
+
+/**
+*	Runs a listen server's simulation on its own thread, at its own tick rate, so the client's frame rate and the server's ticks don't compete.
+*	The server and the local client only talk through loopback queues, one in each direction.
+*	Ticks are timed the same way as on the main thread: real time is split into fixed ticks, and if the server falls too far behind the rest is dropped.
+*/
+class CServerThread final
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	*	Runs one tick. Called on the server thread.
+	*	@param flTickInterval Length of the tick, in seconds.
+	*/
+	using TickFn = std::function<void( double flTickInterval )>;
+
+	struct Stats_t
+	{
+		uint64_t uiTicks = 0;
+
+		/**
+		*	Time spent running ticks, in milliseconds.
+		*/
+		double flTotalMS = 0;
+		double flMaxMS = 0;
+
+		/**
+		*	Simulation time dropped because the server fell behind, in seconds.
+		*/
+		double flDroppedTime = 0;
+	};
+
+public:
+	CServerThread();
+	~CServerThread();
+
+	bool IsRunning() const { return m_Thread.joinable(); }
+
+	/**
+	*	Starts running ticks.
+	*/
+	void Start( TickFn tickFn );
+
+	/**
+	*	Stops the thread once its current tick has finished.
+	*/
+	void Stop();
+
+	/**
+	*	Sets the number of ticks per second. Can be called from any thread; it takes effect before the next tick.
+	*/
+	void SetTickRate( const float flTickRate )
+	{
+		m_flTickRate.store( flTickRate, std::memory_order_relaxed );
+	}
+
+	/**
+	*	@return Queue of messages from the local client to the server. Written on the main thread, read on the server thread.
+	*/
+	CLoopbackQueue& GetClientToServer() { return m_ClientToServer; }
+
+	/**
+	*	@return Queue of messages from the server to the local client. Written on the server thread, read on the main thread.
+	*/
+	CLoopbackQueue& GetServerToClient() { return m_ServerToClient; }
+
+	void GetStats( Stats_t& stats ) const;
+
+	void ResetStats();
+
+private:
+	void ThreadFunc();
+
+private:
+	TickFn m_TickFn;
+
+	std::atomic<float> m_flTickRate;
+
+	std::atomic<bool> m_bStop{ false };
+
+	std::thread m_Thread;
+
+	CLoopbackQueue m_ClientToServer{ "client to server" };
+	CLoopbackQueue m_ServerToClient{ "server to client" };
+
+	mutable std::mutex m_StatsMutex;
+
+	Stats_t m_Stats;
+
+	/**
+	*	Dropped time at the last stats reset. The timestep's total keeps counting.
+	*/
+	double m_flDroppedTimeBase = 0;
+
+private:
+	CServerThread( const CServerThread& ) = delete;
+	CServerThread& operator=( const CServerThread& ) = delete;
+};
+
+#endif //ENGINE_CSERVERTHREAD_H
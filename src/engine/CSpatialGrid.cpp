@@ -0,0 +1,423 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "BSPFile.h"
+#include "CBSPFile.h"
+#include "CPUFeatures.h"
+
+#include "CSpatialGrid.h"
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <immintrin.h>
+
+#define SPATIALGRID_SSE2
+#define SPATIALGRID_TARGET_SSE2
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <immintrin.h>
+
+#define SPATIALGRID_SSE2
+#define SPATIALGRID_TARGET_SSE2 __attribute__( ( target( "sse2" ) ) )
+#endif
+
+const CSpatialGrid::Proxy CSpatialGrid::INVALID_PROXY;
+constexpr float CSpatialGrid::DEFAULT_CELL_SIZE;
+const size_t CSpatialGrid::MAX_CELLS_PER_AXIS;
+const size_t CSpatialGrid::GROUP_SIZE;
+
+namespace
+{
+/**
+*	Half the width of the largest GoldSource world.
+*/
+const float WORLD_EXTENT = 4096;
+
+/**
+*	Tests the first uiCount boxes in pGroups against a box, and stores the IDs of the ones that touch it.
+*	Returns the number of IDs stored.
+*/
+typedef size_t ( *TestFunction_t )( const CSpatialGrid::Group_t* pGroups, const size_t uiCount, const AABB_t& box, uint32_t* pResults );
+
+size_t TestScalar( const CSpatialGrid::Group_t* pGroups, const size_t uiCount, const AABB_t& box, uint32_t* pResults )
+{
+	size_t uiFound = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const auto& group = pGroups[ uiIndex / CSpatialGrid::GROUP_SIZE ];
+		const size_t uiLane = uiIndex % CSpatialGrid::GROUP_SIZE;
+
+		if( group.minX[ uiLane ] <= box.maxs[ 0 ] && group.maxX[ uiLane ] >= box.mins[ 0 ] &&
+			group.minY[ uiLane ] <= box.maxs[ 1 ] && group.maxY[ uiLane ] >= box.mins[ 1 ] &&
+			group.minZ[ uiLane ] <= box.maxs[ 2 ] && group.maxZ[ uiLane ] >= box.mins[ 2 ] )
+		{
+			pResults[ uiFound++ ] = group.id[ uiLane ];
+		}
+	}
+
+	return uiFound;
+}
+
+#ifdef SPATIALGRID_SSE2
+SPATIALGRID_TARGET_SSE2 size_t TestSSE2( const CSpatialGrid::Group_t* pGroups, const size_t uiCount, const AABB_t& box, uint32_t* pResults )
+{
+	const __m128 boxMinX = _mm_set1_ps( box.mins[ 0 ] );
+	const __m128 boxMinY = _mm_set1_ps( box.mins[ 1 ] );
+	const __m128 boxMinZ = _mm_set1_ps( box.mins[ 2 ] );
+	const __m128 boxMaxX = _mm_set1_ps( box.maxs[ 0 ] );
+	const __m128 boxMaxY = _mm_set1_ps( box.maxs[ 1 ] );
+	const __m128 boxMaxZ = _mm_set1_ps( box.maxs[ 2 ] );
+
+	size_t uiFound = 0;
+
+	for( size_t uiFirst = 0; uiFirst < uiCount; uiFirst += CSpatialGrid::GROUP_SIZE )
+	{
+		const auto& group = pGroups[ uiFirst / CSpatialGrid::GROUP_SIZE ];
+
+		//Vectors are not necessarily aligned in the cell's array.
+		__m128 touch = _mm_cmple_ps( _mm_loadu_ps( group.minX ), boxMaxX );
+		touch = _mm_and_ps( touch, _mm_cmpge_ps( _mm_loadu_ps( group.maxX ), boxMinX ) );
+		touch = _mm_and_ps( touch, _mm_cmple_ps( _mm_loadu_ps( group.minY ), boxMaxY ) );
+		touch = _mm_and_ps( touch, _mm_cmpge_ps( _mm_loadu_ps( group.maxY ), boxMinY ) );
+		touch = _mm_and_ps( touch, _mm_cmple_ps( _mm_loadu_ps( group.minZ ), boxMaxZ ) );
+		touch = _mm_and_ps( touch, _mm_cmpge_ps( _mm_loadu_ps( group.maxZ ), boxMinZ ) );
+
+		unsigned int uiMask = static_cast<unsigned int>( _mm_movemask_ps( touch ) );
+
+		//Unused lanes of the last group have empty bounds, but an infinite query box would still touch them.
+		const size_t uiLanes = std::min( uiCount - uiFirst, CSpatialGrid::GROUP_SIZE );
+
+		uiMask &= ( 1u << uiLanes ) - 1;
+
+		for( size_t uiLane = 0; uiMask; ++uiLane, uiMask >>= 1 )
+		{
+			if( uiMask & 1 )
+				pResults[ uiFound++ ] = group.id[ uiLane ];
+		}
+	}
+
+	return uiFound;
+}
+#endif
+
+TestFunction_t GetTest()
+{
+	static const CPUKernel_t<TestFunction_t> KERNELS[] =
+	{
+#ifdef SPATIALGRID_SSE2
+		{ CPUFeature::SSE2, &TestSSE2 },
+#endif
+		{ CPUFeature::NONE, &TestScalar }
+	};
+
+	static const TestFunction_t pTest = Plat_SelectKernel( KERNELS );
+
+	return pTest;
+}
+}
+
+CSpatialGrid::CSpatialGrid()
+{
+	const float mins[ 3 ] = { -WORLD_EXTENT, -WORLD_EXTENT, -WORLD_EXTENT };
+	const float maxs[ 3 ] = { WORLD_EXTENT, WORLD_EXTENT, WORLD_EXTENT };
+
+	Reset( mins, maxs );
+}
+
+CSpatialGrid::~CSpatialGrid()
+{
+}
+
+void CSpatialGrid::Reset( const float ( &mins )[ 3 ], const float ( &maxs )[ 3 ], const float flCellSize )
+{
+	assert( flCellSize > 0 );
+
+	const float flWidth = std::max( maxs[ 0 ] - mins[ 0 ], 1.0f );
+	const float flDepth = std::max( maxs[ 1 ] - mins[ 1 ], 1.0f );
+
+	m_flCellSize = std::max( { flCellSize, flWidth / MAX_CELLS_PER_AXIS, flDepth / MAX_CELLS_PER_AXIS } );
+	m_flInverseCellSize = 1 / m_flCellSize;
+
+	m_flOrigin[ 0 ] = mins[ 0 ];
+	m_flOrigin[ 1 ] = mins[ 1 ];
+
+	m_uiCellsX = std::min( static_cast<size_t>( std::ceil( flWidth * m_flInverseCellSize ) ), MAX_CELLS_PER_AXIS );
+	m_uiCellsY = std::min( static_cast<size_t>( std::ceil( flDepth * m_flInverseCellSize ) ), MAX_CELLS_PER_AXIS );
+
+	m_uiCellsX = std::max( m_uiCellsX, static_cast<size_t>( 1 ) );
+	m_uiCellsY = std::max( m_uiCellsY, static_cast<size_t>( 1 ) );
+
+	m_Cells.clear();
+	m_Cells.resize( m_uiCellsX * m_uiCellsY + 1 );
+
+	m_Proxies.clear();
+	m_uiFreeProxy = INVALID_PROXY;
+	m_uiCount = 0;
+}
+
+void CSpatialGrid::Reset( const CBSPFile& map, const float flCellSize )
+{
+	size_t uiModels;
+
+	const auto pModels = map.GetLump<bsp::Model_t>( bsp::LUMP_MODELS, uiModels );
+
+	//Model 0 is the world, every brush entity is inside its bounds.
+	if( uiModels > 0 )
+	{
+		Reset( pModels[ 0 ].mins, pModels[ 0 ].maxs, flCellSize );
+	}
+	else
+	{
+		const float mins[ 3 ] = { -WORLD_EXTENT, -WORLD_EXTENT, -WORLD_EXTENT };
+		const float maxs[ 3 ] = { WORLD_EXTENT, WORLD_EXTENT, WORLD_EXTENT };
+
+		Reset( mins, maxs, flCellSize );
+	}
+}
+
+void CSpatialGrid::Clear()
+{
+	for( auto& cell : m_Cells )
+	{
+		cell.groups.clear();
+		cell.uiCount = 0;
+	}
+
+	m_Proxies.clear();
+	m_uiFreeProxy = INVALID_PROXY;
+	m_uiCount = 0;
+}
+
+CSpatialGrid::Proxy CSpatialGrid::Insert( const uint32_t uiID, const AABB_t& bounds )
+{
+	Proxy proxy;
+
+	if( m_uiFreeProxy != INVALID_PROXY )
+	{
+		proxy = m_uiFreeProxy;
+		m_uiFreeProxy = m_Proxies[ proxy ].uiCell;
+	}
+	else
+	{
+		proxy = static_cast<Proxy>( m_Proxies.size() );
+		m_Proxies.push_back( {} );
+	}
+
+	AddToCell( proxy, uiID, GetCell( bounds ), bounds );
+
+	++m_uiCount;
+
+	return proxy;
+}
+
+void CSpatialGrid::Move( const Proxy proxy, const AABB_t& bounds )
+{
+	assert( proxy < m_Proxies.size() );
+
+	auto& info = m_Proxies[ proxy ];
+
+	const uint32_t uiCell = GetCell( bounds );
+
+	auto& cell = m_Cells[ info.uiCell ];
+
+	//Most moves stay within a cell.
+	if( uiCell == info.uiCell )
+	{
+		SetBounds( cell.groups[ info.uiSlot / GROUP_SIZE ], info.uiSlot % GROUP_SIZE, bounds );
+		return;
+	}
+
+	const uint32_t uiID = cell.groups[ info.uiSlot / GROUP_SIZE ].id[ info.uiSlot % GROUP_SIZE ];
+
+	RemoveFromCell( proxy );
+	AddToCell( proxy, uiID, uiCell, bounds );
+}
+
+void CSpatialGrid::Remove( const Proxy proxy )
+{
+	assert( proxy < m_Proxies.size() );
+
+	RemoveFromCell( proxy );
+
+	m_Proxies[ proxy ].uiCell = m_uiFreeProxy;
+	m_uiFreeProxy = proxy;
+
+	--m_uiCount;
+}
+
+size_t CSpatialGrid::Query( const AABB_t& box, std::vector<uint32_t>& results ) const
+{
+	const size_t uiStart = results.size();
+
+	size_t uiMinX, uiMinY, uiMaxX, uiMaxY;
+
+	GetCellRange( box, uiMinX, uiMinY, uiMaxX, uiMaxY );
+
+	for( size_t uiY = uiMinY; uiY <= uiMaxY; ++uiY )
+	{
+		for( size_t uiX = uiMinX; uiX <= uiMaxX; ++uiX )
+		{
+			QueryCell( m_Cells[ uiY * m_uiCellsX + uiX ], box, results );
+		}
+	}
+
+	QueryCell( m_Cells.back(), box, results );
+
+	return results.size() - uiStart;
+}
+
+void CSpatialGrid::Query( const AABB_t* pBoxes, const size_t uiCount, std::vector<uint32_t>& results, std::vector<size_t>& offsets ) const
+{
+	assert( pBoxes || uiCount == 0 );
+
+	offsets.resize( uiCount + 1 );
+
+	for( size_t uiBox = 0; uiBox < uiCount; ++uiBox )
+	{
+		offsets[ uiBox ] = results.size();
+
+		Query( pBoxes[ uiBox ], results );
+	}
+
+	offsets[ uiCount ] = results.size();
+}
+
+uint32_t CSpatialGrid::GetCell( const AABB_t& bounds ) const
+{
+	const uint32_t uiLarge = static_cast<uint32_t>( m_uiCellsX * m_uiCellsY );
+
+	//Larger entities would stick out of the loose cell.
+	if( bounds.maxs[ 0 ] - bounds.mins[ 0 ] > m_flCellSize || bounds.maxs[ 1 ] - bounds.mins[ 1 ] > m_flCellSize )
+		return uiLarge;
+
+	const float flX = ( ( bounds.mins[ 0 ] + bounds.maxs[ 0 ] ) * 0.5f - m_flOrigin[ 0 ] ) * m_flInverseCellSize;
+	const float flY = ( ( bounds.mins[ 1 ] + bounds.maxs[ 1 ] ) * 0.5f - m_flOrigin[ 1 ] ) * m_flInverseCellSize;
+
+	//Queries clamp to the grid, so entities outside it can only go in the large list. Also catches NaN.
+	if( !( flX >= 0 && flX < m_uiCellsX && flY >= 0 && flY < m_uiCellsY ) )
+		return uiLarge;
+
+	return static_cast<uint32_t>( static_cast<size_t>( flY ) * m_uiCellsX + static_cast<size_t>( flX ) );
+}
+
+void CSpatialGrid::GetCellRange( const AABB_t& box, size_t& uiMinX, size_t& uiMinY, size_t& uiMaxX, size_t& uiMaxY ) const
+{
+	const float flHalfCell = m_flCellSize * 0.5f;
+
+	const auto toCell = [ & ]( const float flValue, const float flOrigin, const size_t uiCells ) -> size_t
+	{
+		const float flCell = std::floor( ( flValue - flOrigin ) * m_flInverseCellSize );
+
+		if( !( flCell > 0 ) )
+			return 0;
+
+		if( flCell >= uiCells - 1 )
+			return uiCells - 1;
+
+		return static_cast<size_t>( flCell );
+	};
+
+	uiMinX = toCell( box.mins[ 0 ] - flHalfCell, m_flOrigin[ 0 ], m_uiCellsX );
+	uiMinY = toCell( box.mins[ 1 ] - flHalfCell, m_flOrigin[ 1 ], m_uiCellsY );
+	uiMaxX = toCell( box.maxs[ 0 ] + flHalfCell, m_flOrigin[ 0 ], m_uiCellsX );
+	uiMaxY = toCell( box.maxs[ 1 ] + flHalfCell, m_flOrigin[ 1 ], m_uiCellsY );
+}
+
+void CSpatialGrid::AddToCell( const Proxy proxy, const uint32_t uiID, const uint32_t uiCell, const AABB_t& bounds )
+{
+	auto& cell = m_Cells[ uiCell ];
+
+	const uint32_t uiSlot = cell.uiCount++;
+
+	if( uiSlot / GROUP_SIZE == cell.groups.size() )
+	{
+		Group_t group;
+
+		//Empty bounds, so unused lanes never touch anything.
+		for( size_t uiLane = 0; uiLane < GROUP_SIZE; ++uiLane )
+		{
+			group.minX[ uiLane ] = group.minY[ uiLane ] = group.minZ[ uiLane ] = std::numeric_limits<float>::infinity();
+			group.maxX[ uiLane ] = group.maxY[ uiLane ] = group.maxZ[ uiLane ] = -std::numeric_limits<float>::infinity();
+			group.id[ uiLane ] = 0;
+			group.proxy[ uiLane ] = INVALID_PROXY;
+		}
+
+		cell.groups.push_back( group );
+	}
+
+	auto& group = cell.groups[ uiSlot / GROUP_SIZE ];
+	const size_t uiLane = uiSlot % GROUP_SIZE;
+
+	SetBounds( group, uiLane, bounds );
+	group.id[ uiLane ] = uiID;
+	group.proxy[ uiLane ] = proxy;
+
+	m_Proxies[ proxy ].uiCell = uiCell;
+	m_Proxies[ proxy ].uiSlot = uiSlot;
+}
+
+void CSpatialGrid::RemoveFromCell( const Proxy proxy )
+{
+	const auto& info = m_Proxies[ proxy ];
+
+	auto& cell = m_Cells[ info.uiCell ];
+
+	assert( info.uiSlot < cell.uiCount );
+
+	const uint32_t uiLast = --cell.uiCount;
+
+	auto& group = cell.groups[ info.uiSlot / GROUP_SIZE ];
+	const size_t uiLane = info.uiSlot % GROUP_SIZE;
+
+	auto& lastGroup = cell.groups[ uiLast / GROUP_SIZE ];
+	const size_t uiLastLane = uiLast % GROUP_SIZE;
+
+	//Keep the cell packed by moving its last entity into the slot.
+	if( info.uiSlot != uiLast )
+	{
+		group.minX[ uiLane ] = lastGroup.minX[ uiLastLane ];
+		group.minY[ uiLane ] = lastGroup.minY[ uiLastLane ];
+		group.minZ[ uiLane ] = lastGroup.minZ[ uiLastLane ];
+		group.maxX[ uiLane ] = lastGroup.maxX[ uiLastLane ];
+		group.maxY[ uiLane ] = lastGroup.maxY[ uiLastLane ];
+		group.maxZ[ uiLane ] = lastGroup.maxZ[ uiLastLane ];
+		group.id[ uiLane ] = lastGroup.id[ uiLastLane ];
+		group.proxy[ uiLane ] = lastGroup.proxy[ uiLastLane ];
+
+		m_Proxies[ group.proxy[ uiLane ] ].uiSlot = info.uiSlot;
+	}
+
+	lastGroup.minX[ uiLastLane ] = lastGroup.minY[ uiLastLane ] = lastGroup.minZ[ uiLastLane ] = std::numeric_limits<float>::infinity();
+	lastGroup.maxX[ uiLastLane ] = lastGroup.maxY[ uiLastLane ] = lastGroup.maxZ[ uiLastLane ] = -std::numeric_limits<float>::infinity();
+	lastGroup.proxy[ uiLastLane ] = INVALID_PROXY;
+
+	if( uiLastLane == 0 )
+		cell.groups.pop_back();
+}
+
+void CSpatialGrid::SetBounds( Group_t& group, const size_t uiLane, const AABB_t& bounds )
+{
+	group.minX[ uiLane ] = bounds.mins[ 0 ];
+	group.minY[ uiLane ] = bounds.mins[ 1 ];
+	group.minZ[ uiLane ] = bounds.mins[ 2 ];
+	group.maxX[ uiLane ] = bounds.maxs[ 0 ];
+	group.maxY[ uiLane ] = bounds.maxs[ 1 ];
+	group.maxZ[ uiLane ] = bounds.maxs[ 2 ];
+}
+
+void CSpatialGrid::QueryCell( const Cell_t& cell, const AABB_t& box, std::vector<uint32_t>& results ) const
+{
+	if( cell.uiCount == 0 )
+		return;
+
+	static const TestFunction_t pTest = GetTest();
+
+	const size_t uiStart = results.size();
+
+	results.resize( uiStart + cell.uiCount );
+
+	const size_t uiFound = pTest( cell.groups.data(), cell.uiCount, box, results.data() + uiStart );
+
+	results.resize( uiStart + uiFound );
+}
@@ -0,0 +1,196 @@
+#ifndef ENGINE_CSPATIALGRID_H
+#define ENGINE_CSPATIALGRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class CBSPFile;
+
+/**
+*	Axis aligned bounding box.
+*/
+struct AABB_t
+{
+	float mins[ 3 ];
+	float maxs[ 3 ];
+};
+
+/**
+*	Loose grid of entity bounds, for traces and area queries that would otherwise scan every entity.
+*	The grid covers the world horizontally, like the engine's area nodes: maps are much wider than they are tall.
+*	Each entity is stored in the cell that contains the center of its bounds, and cells are treated as half a cell larger on every side,
+*	so a query only has to visit the cells its box overlaps after growing it by half a cell. Entities larger than a cell are kept
+*	in a separate list that every query tests.
+*	Bounds are stored in groups of 4 as a structure of arrays, so queries test 4 boxes at once with vector instructions.
+*	Moving an entity within its cell updates its bounds in place; moving it to another cell is a constant time removal and insertion.
+*	Not thread safe, but queries don't modify the grid, so any number of threads can query it while it isn't being changed.
+*/
+class CSpatialGrid final
+{
+public:
+	/**
+	*	Identifies an entity in the grid.
+	*/
+	using Proxy = uint32_t;
+
+	static const Proxy INVALID_PROXY = UINT32_MAX;
+
+	/**
+	*	Default size of a cell, in units. About the size of a room, so most entities fit in one.
+	*/
+	static constexpr float DEFAULT_CELL_SIZE = 256;
+
+	/**
+	*	Most cells along each axis.
+	*/
+	static const size_t MAX_CELLS_PER_AXIS = 256;
+
+	/**
+	*	Number of boxes tested at once.
+	*/
+	static const size_t GROUP_SIZE = 4;
+
+	/**
+	*	Bounds of GROUP_SIZE entities, stored so they can be tested at once.
+	*/
+	struct Group_t
+	{
+		float minX[ GROUP_SIZE ];
+		float minY[ GROUP_SIZE ];
+		float minZ[ GROUP_SIZE ];
+		float maxX[ GROUP_SIZE ];
+		float maxY[ GROUP_SIZE ];
+		float maxZ[ GROUP_SIZE ];
+
+		uint32_t id[ GROUP_SIZE ];
+		Proxy proxy[ GROUP_SIZE ];
+	};
+
+public:
+	/**
+	*	Creates a grid covering the largest GoldSource world.
+	*/
+	CSpatialGrid();
+	~CSpatialGrid();
+
+	/**
+	*	Removes all entities, and changes the area the grid covers. Entities outside the area are still found, but are slower to query.
+	*	@param flCellSize Size of a cell, in units. Grown if needed to stay within MAX_CELLS_PER_AXIS.
+	*/
+	void Reset( const float ( &mins )[ 3 ], const float ( &maxs )[ 3 ], const float flCellSize = DEFAULT_CELL_SIZE );
+
+	/**
+	*	Removes all entities, and makes the grid cover a map's world.
+	*	@param map Loaded map.
+	*/
+	void Reset( const CBSPFile& map, const float flCellSize = DEFAULT_CELL_SIZE );
+
+	/**
+	*	Removes all entities, keeping the area.
+	*/
+	void Clear();
+
+	/**
+	*	@return Number of entities in the grid.
+	*/
+	size_t GetCount() const { return m_uiCount; }
+
+	/**
+	*	Adds an entity.
+	*	@param uiID Value that queries return for the entity, such as its handle.
+	*	@return Proxy of the entity, used to move or remove it.
+	*/
+	Proxy Insert( const uint32_t uiID, const AABB_t& bounds );
+
+	/**
+	*	Changes the bounds of an entity.
+	*/
+	void Move( const Proxy proxy, const AABB_t& bounds );
+
+	void Remove( const Proxy proxy );
+
+	/**
+	*	Finds the entities whose bounds touch a box.
+	*	@param results The IDs of the entities are added to this. Each entity is added once, in no particular order.
+	*	@return Number of entities found.
+	*/
+	size_t Query( const AABB_t& box, std::vector<uint32_t>& results ) const;
+
+	/**
+	*	Queries several boxes, such as the moves of all entities in a tick. Faster than separate queries, since results are appended to one array.
+	*	@param results The IDs found by each query, one query after another.
+	*	@param offsets Where the results of each query start in results. Gets uiCount + 1 entries, the last one is the end of the results.
+	*/
+	void Query( const AABB_t* pBoxes, const size_t uiCount, std::vector<uint32_t>& results, std::vector<size_t>& offsets ) const;
+
+private:
+	struct Cell_t
+	{
+		std::vector<Group_t> groups;
+
+		/**
+		*	Number of entities in the cell. They're packed at the start of groups.
+		*/
+		uint32_t uiCount = 0;
+	};
+
+	struct ProxyInfo_t
+	{
+		/**
+		*	Cell the entity is in, or the next free proxy if the proxy isn't in use.
+		*/
+		uint32_t uiCell;
+
+		/**
+		*	Index of the entity in the cell.
+		*/
+		uint32_t uiSlot;
+	};
+
+	/**
+	*	@return Cell that an entity with these bounds goes in. The last cell is the list of large entities.
+	*/
+	uint32_t GetCell( const AABB_t& bounds ) const;
+
+	/**
+	*	Gets the range of cells a query has to visit, clamped to the grid.
+	*/
+	void GetCellRange( const AABB_t& box, size_t& uiMinX, size_t& uiMinY, size_t& uiMaxX, size_t& uiMaxY ) const;
+
+	void AddToCell( const Proxy proxy, const uint32_t uiID, const uint32_t uiCell, const AABB_t& bounds );
+
+	void RemoveFromCell( const Proxy proxy );
+
+	void SetBounds( Group_t& group, const size_t uiLane, const AABB_t& bounds );
+
+	/**
+	*	Tests the entities of a cell against a box and appends the IDs of those that touch it.
+	*/
+	void QueryCell( const Cell_t& cell, const AABB_t& box, std::vector<uint32_t>& results ) const;
+
+private:
+	float m_flOrigin[ 2 ] = {};
+	float m_flCellSize = DEFAULT_CELL_SIZE;
+	float m_flInverseCellSize = 1 / DEFAULT_CELL_SIZE;
+
+	size_t m_uiCellsX = 0;
+	size_t m_uiCellsY = 0;
+
+	/**
+	*	m_uiCellsX by m_uiCellsY cells, and then the list of large entities.
+	*/
+	std::vector<Cell_t> m_Cells;
+
+	std::vector<ProxyInfo_t> m_Proxies;
+
+	uint32_t m_uiFreeProxy = INVALID_PROXY;
+
+	size_t m_uiCount = 0;
+
+private:
+	CSpatialGrid( const CSpatialGrid& ) = delete;
+	CSpatialGrid& operator=( const CSpatialGrid& ) = delete;
+};
+
+#endif //ENGINE_CSPATIALGRID_H
@@ -0,0 +1,169 @@
+#include <algorithm>
+
+#include "steam_api.h"
+
+#include "CSteamCallbackPump.h"
+
+const int64_t CSteamCallbackPump::MAX_DELAY_MS;
+
+CSteamCallbackPump::~CSteamCallbackPump()
+{
+	Stop();
+}
+
+void CSteamCallbackPump::Start( const bool bWorkerThread )
+{
+	Stop();
+
+	m_bRunning = true;
+	m_bDelayed = false;
+	m_flDebtMS = 0;
+	m_NextDispatch = Clock::now();
+
+	if( bWorkerThread )
+	{
+		m_bStop = false;
+		m_Thread = std::thread( &CSteamCallbackPump::WorkerThread, this );
+	}
+}
+
+void CSteamCallbackPump::Stop()
+{
+	if( m_Thread.joinable() )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+			m_bStop = true;
+		}
+
+		m_StopRequested.notify_one();
+
+		m_Thread.join();
+	}
+
+	m_bRunning = false;
+}
+
+void CSteamCallbackPump::SetRate( const float flRate )
+{
+	const auto interval = flRate > 0 ? std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double>( 1.0 / flRate ) ) : Clock::duration::zero();
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Interval = interval;
+}
+
+void CSteamCallbackPump::SetBudget( const float flBudgetMS )
+{
+	m_flBudgetMS = std::max( 0.0f, flBudgetMS );
+}
+
+void CSteamCallbackPump::Update()
+{
+	if( !m_bRunning || IsThreaded() )
+		return;
+
+	//Each frame pays off up to the budget.
+	m_flDebtMS = std::max( 0.0, m_flDebtMS - m_flBudgetMS );
+
+	const auto now = Clock::now();
+
+	if( now < m_NextDispatch )
+		return;
+
+	bool bForced = false;
+
+	if( m_flBudgetMS > 0 && m_flDebtMS > 0 )
+	{
+		if( !m_bDelayed )
+		{
+			m_bDelayed = true;
+			m_DelayedSince = now;
+		}
+
+		if( now - m_DelayedSince < std::chrono::milliseconds( MAX_DELAY_MS ) )
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+			++m_Stats.uiDeferred;
+
+			return;
+		}
+
+		bForced = true;
+	}
+
+	m_bDelayed = false;
+
+	Clock::duration interval;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		interval = m_Interval;
+
+		if( bForced )
+			++m_Stats.uiForced;
+	}
+
+	//Stay on the cadence instead of drifting by however late this frame was, unless it fell behind by more than a dispatch.
+	m_NextDispatch += interval;
+
+	if( m_NextDispatch < now )
+		m_NextDispatch = now + interval;
+
+	if( m_flBudgetMS > 0 )
+		m_flDebtMS += Dispatch();
+	else
+		Dispatch();
+}
+
+void CSteamCallbackPump::GetStats( Stats_t& stats ) const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	stats = m_Stats;
+}
+
+void CSteamCallbackPump::ResetStats()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Stats = Stats_t();
+}
+
+double CSteamCallbackPump::Dispatch()
+{
+	const auto start = Clock::now();
+
+	SteamAPI_RunCallbacks();
+
+	const double flMS = std::chrono::duration<double, std::milli>( Clock::now() - start ).count();
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	++m_Stats.uiDispatches;
+	m_Stats.flTotalMS += flMS;
+	m_Stats.flMaxMS = std::max( m_Stats.flMaxMS, flMS );
+	m_Stats.flLastMS = flMS;
+
+	return flMS;
+}
+
+void CSteamCallbackPump::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( !m_bStop )
+	{
+		//Dispatching every frame doesn't mean anything here, so don't spin.
+		const auto interval = std::max<Clock::duration>( m_Interval, std::chrono::milliseconds( 1 ) );
+
+		lock.unlock();
+
+		Dispatch();
+
+		lock.lock();
+
+		m_StopRequested.wait_for( lock, interval, [ this ]() { return m_bStop; } );
+	}
+}
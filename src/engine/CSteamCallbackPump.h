@@ -0,0 +1,137 @@
+#ifndef ENGINE_CSTEAMCALLBACKPUMP_H
+#define ENGINE_CSTEAMCALLBACKPUMP_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+/**
+*	Dispatches Steam callbacks at a fixed rate instead of every frame, and keeps their cost per frame under a budget.
+*	A single dispatch can't be split up, so a dispatch that goes over the budget delays the next ones until frames have paid for it.
+*	Callbacks are never delayed for longer than MAX_DELAY_MS, so bursts only spread out, and are never lost.
+*	Callbacks can be dispatched on a worker thread instead, if everything that registers callbacks is thread-safe.
+*/
+class CSteamCallbackPump final
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	*	Longest time callbacks are delayed by the budget, in milliseconds.
+	*/
+	static const int64_t MAX_DELAY_MS = 250;
+
+	struct Stats_t
+	{
+		uint64_t uiDispatches = 0;
+
+		/**
+		*	Number of times a dispatch was due, but was delayed because the budget was used up.
+		*/
+		uint64_t uiDeferred = 0;
+
+		/**
+		*	Number of dispatches that went ahead over the budget because callbacks had been delayed for too long.
+		*/
+		uint64_t uiForced = 0;
+
+		/**
+		*	Time spent dispatching, in milliseconds.
+		*/
+		double flTotalMS = 0;
+		double flMaxMS = 0;
+		double flLastMS = 0;
+	};
+
+public:
+	CSteamCallbackPump() = default;
+	~CSteamCallbackPump();
+
+	/**
+	*	Starts dispatching callbacks.
+	*	@param bWorkerThread Whether to dispatch on a worker thread instead of in Update.
+	*/
+	void Start( const bool bWorkerThread );
+
+	/**
+	*	Stops dispatching callbacks. Must be called before the Steam API is shut down.
+	*/
+	void Stop();
+
+	bool IsRunning() const { return m_bRunning; }
+
+	bool IsThreaded() const { return m_Thread.joinable(); }
+
+	/**
+	*	Sets how many times per second callbacks are dispatched. 0 dispatches every frame.
+	*/
+	void SetRate( const float flRate );
+
+	/**
+	*	Sets the time dispatching may take per frame on average, in milliseconds. 0 disables the budget.
+	*	Doesn't apply when dispatching on a worker thread.
+	*/
+	void SetBudget( const float flBudgetMS );
+
+	/**
+	*	Called every frame. Dispatches callbacks if they're due and the budget allows it.
+	*/
+	void Update();
+
+	void GetStats( Stats_t& stats ) const;
+
+	void ResetStats();
+
+private:
+	/**
+	*	Dispatches callbacks and records how long it took.
+	*	@return How long dispatching took, in milliseconds.
+	*/
+	double Dispatch();
+
+	void WorkerThread();
+
+private:
+	bool m_bRunning = false;
+
+	/**
+	*	Time between dispatches.
+	*/
+	Clock::duration m_Interval = Clock::duration::zero();
+
+	double m_flBudgetMS = 0;
+
+	Clock::time_point m_NextDispatch;
+
+	/**
+	*	When the dispatch that is being delayed was first due. Only valid while m_bDelayed is set.
+	*/
+	Clock::time_point m_DelayedSince;
+	bool m_bDelayed = false;
+
+	/**
+	*	Dispatch time that hasn't been paid for by frames yet, in milliseconds.
+	*/
+	double m_flDebtMS = 0;
+
+	/**
+	*	Guards the stats, and the interval and stop request used by the worker thread.
+	*/
+	mutable std::mutex m_Mutex;
+
+	std::condition_variable m_StopRequested;
+
+	bool m_bStop = false;
+
+	std::thread m_Thread;
+
+	Stats_t m_Stats;
+
+private:
+	CSteamCallbackPump( const CSteamCallbackPump& ) = delete;
+	CSteamCallbackPump& operator=( const CSteamCallbackPump& ) = delete;
+};
+
+#endif //ENGINE_CSTEAMCALLBACKPUMP_H
@@ -0,0 +1,157 @@
+#include <algorithm>
+#include <vector>
+
+#include "CFrameArena.h"
+#include "Engine.h"
+
+#include "CRenderCommandList.h"
+#include "CRenderer.h"
+
+#include "CTextureManager.h"
+
+const uint64_t CTextureManager::MIN_IDLE_FRAMES;
+const size_t CTextureManager::NUM_OWNERS;
+
+int CTextureManager::CreateTexture( const TextureOwner owner, EvictCallback_t callback )
+{
+	const int iTexture = g_Video.GetRenderer().CreateTextureHandle();
+
+	auto& texture = m_Textures[ iTexture ];
+
+	texture.owner = owner;
+	texture.callback = std::move( callback );
+	texture.uiLastUsedFrame = m_uiFrame;
+
+	return iTexture;
+}
+
+void CTextureManager::ReleaseTexture( const int iTexture )
+{
+	auto it = m_Textures.find( iTexture );
+
+	if( it == m_Textures.end() )
+		return;
+
+	if( it->second.bOwnTexture )
+		m_uiResidentBytes -= it->second.uiBytes;
+
+	m_Textures.erase( it );
+
+	g_Video.GetCommandList().DeleteTexture( iTexture );
+}
+
+void CTextureManager::SetImageUploaded( const int iTexture, const int iWidth, const int iHeight )
+{
+	auto pTexture = Find( iTexture );
+
+	if( !pTexture )
+		return;
+
+	if( pTexture->bOwnTexture )
+		m_uiResidentBytes -= pTexture->uiBytes;
+
+	pTexture->uiBytes = static_cast<size_t>( iWidth ) * iHeight * 4;
+	pTexture->bOwnTexture = iWidth > CRenderer::MAX_ATLAS_IMAGE_SIZE || iHeight > CRenderer::MAX_ATLAS_IMAGE_SIZE;
+	pTexture->uiLastUsedFrame = m_uiFrame;
+
+	if( pTexture->bOwnTexture )
+		m_uiResidentBytes += pTexture->uiBytes;
+}
+
+void CTextureManager::SetUploaded( const int iTexture, const size_t uiBytes )
+{
+	auto pTexture = Find( iTexture );
+
+	if( !pTexture )
+		return;
+
+	if( pTexture->bOwnTexture )
+		m_uiResidentBytes -= pTexture->uiBytes;
+
+	pTexture->uiBytes = uiBytes;
+	pTexture->bOwnTexture = true;
+	pTexture->uiLastUsedFrame = m_uiFrame;
+
+	m_uiResidentBytes += uiBytes;
+}
+
+void CTextureManager::MarkUsed( const int iTexture )
+{
+	if( auto pTexture = Find( iTexture ) )
+		pTexture->uiLastUsedFrame = m_uiFrame;
+}
+
+void CTextureManager::Update()
+{
+	++m_uiFrame;
+
+	if( m_uiResidentBytes <= m_uiBudget )
+		return;
+
+	FrameVector_t<std::pair<uint64_t, int>> candidates;
+
+	for( const auto& entry : m_Textures )
+	{
+		const auto& texture = entry.second;
+
+		if( texture.callback && texture.bOwnTexture && texture.uiBytes > 0 && m_uiFrame - texture.uiLastUsedFrame >= MIN_IDLE_FRAMES )
+			candidates.emplace_back( texture.uiLastUsedFrame, entry.first );
+	}
+
+	//Least recently used first.
+	std::sort( candidates.begin(), candidates.end() );
+
+	auto& list = g_Video.GetCommandList();
+
+	for( const auto& candidate : candidates )
+	{
+		if( m_uiResidentBytes <= m_uiBudget )
+			break;
+
+		auto& texture = m_Textures[ candidate.second ];
+
+		m_uiResidentBytes -= texture.uiBytes;
+
+		++m_uiEvictions;
+		m_uiEvictedBytes += texture.uiBytes;
+
+		texture.uiBytes = 0;
+		texture.bOwnTexture = false;
+
+		//The handle stays valid, it's uploaded to again when it's next drawn.
+		list.DeleteTexture( candidate.second );
+
+		texture.callback();
+	}
+}
+
+void CTextureManager::GetStats( Stats_t& stats ) const
+{
+	stats = Stats_t();
+
+	stats.uiTextures = m_Textures.size();
+	stats.uiResidentBytes = m_uiResidentBytes;
+
+	for( const auto& entry : m_Textures )
+	{
+		const auto& texture = entry.second;
+
+		const size_t uiOwner = static_cast<size_t>( texture.owner );
+
+		++stats.uiTexturesByOwner[ uiOwner ];
+		stats.uiBytesByOwner[ uiOwner ] += texture.uiBytes;
+
+		if( texture.callback && texture.bOwnTexture )
+			stats.uiEvictableBytes += texture.uiBytes;
+	}
+
+	stats.uiEvictions = m_uiEvictions;
+	stats.uiEvictedBytes = m_uiEvictedBytes;
+}
+
+CTextureManager::Texture_t* CTextureManager::Find( const int iTexture )
+{
+	auto it = m_Textures.find( iTexture );
+
+	return it != m_Textures.end() ? &it->second : nullptr;
+}
@@ -0,0 +1,162 @@
+#ifndef ENGINE_CTEXTUREMANAGER_H
+#define ENGINE_CTEXTUREMANAGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+/**
+*	What a texture is used for.
+*/
+enum class TextureOwner
+{
+	/**
+	*	Created through the VGUI surface. The pixels are owned by VGUI, so these can't be restored.
+	*/
+	SURFACE = 0,
+
+	/**
+	*	Cached image, restored from the asset cache.
+	*/
+	IMAGE,
+
+	GLYPH,
+
+	/**
+	*	Panel cache, restored by redrawing the panel.
+	*/
+	PANEL_CACHE,
+
+	COUNT
+};
+
+/**
+*	Tracks every texture handle's size, owner and when it was last used, and keeps texture memory under a budget.
+*	Textures that can be restored are evicted least recently used first once they've been idle for a while; their owner
+*	is told so it uploads them again the next time they're drawn. Textures in atlas pages don't free anything, so they're never evicted.
+*	Must only be used on the main thread. Textures are freed through the command list, so the renderer sees evictions in order.
+*/
+class CTextureManager final
+{
+public:
+	/**
+	*	Called when a texture is evicted. The owner has to upload it again before drawing it.
+	*/
+	using EvictCallback_t = std::function<void()>;
+
+	/**
+	*	Textures have to be idle for this many frames before they can be evicted, so textures that are only drawn some of the time
+	*	aren't uploaded over and over.
+	*/
+	static const uint64_t MIN_IDLE_FRAMES = 120;
+
+	static const size_t NUM_OWNERS = static_cast<size_t>( TextureOwner::COUNT );
+
+	struct Stats_t
+	{
+		size_t uiTextures = 0;
+		size_t uiResidentBytes = 0;
+
+		/**
+		*	Bytes in textures that can be evicted.
+		*/
+		size_t uiEvictableBytes = 0;
+
+		size_t uiTexturesByOwner[ NUM_OWNERS ] = {};
+		size_t uiBytesByOwner[ NUM_OWNERS ] = {};
+
+		size_t uiEvictions = 0;
+		size_t uiEvictedBytes = 0;
+	};
+
+public:
+	CTextureManager() = default;
+
+	/**
+	*	Creates a texture handle.
+	*	@param callback Called when the texture is evicted. Textures without one are never evicted.
+	*/
+	int CreateTexture( const TextureOwner owner, EvictCallback_t callback = nullptr );
+
+	/**
+	*	Frees a texture and its handle.
+	*/
+	void ReleaseTexture( const int iTexture );
+
+	/**
+	*	Records an RGBA upload. Whether it gets its own texture or goes in an atlas page is worked out the same way the renderer does.
+	*/
+	void SetImageUploaded( const int iTexture, const int iWidth, const int iHeight );
+
+	/**
+	*	Records that a texture has its own storage of the given size.
+	*/
+	void SetUploaded( const int iTexture, const size_t uiBytes );
+
+	/**
+	*	Marks a texture as drawn this frame.
+	*/
+	void MarkUsed( const int iTexture );
+
+	/**
+	*	Sets the texture memory budget, in bytes.
+	*/
+	void SetBudget( const size_t uiBytes ) { m_uiBudget = uiBytes; }
+
+	size_t GetBudget() const { return m_uiBudget; }
+
+	/**
+	*	Starts a new frame, and evicts idle textures until the resident textures are within the budget.
+	*/
+	void Update();
+
+	void GetStats( Stats_t& stats ) const;
+
+private:
+	struct Texture_t
+	{
+		TextureOwner owner;
+
+		EvictCallback_t callback;
+
+		/**
+		*	Size of the uploaded texture. 0 if nothing is uploaded.
+		*/
+		size_t uiBytes = 0;
+
+		/**
+		*	Whether the texture has its own storage, as opposed to a spot in an atlas page.
+		*/
+		bool bOwnTexture = false;
+
+		uint64_t uiLastUsedFrame = 0;
+	};
+
+private:
+	/**
+	*	@return The texture, or null if the handle isn't tracked.
+	*/
+	Texture_t* Find( const int iTexture );
+
+private:
+	std::unordered_map<int, Texture_t> m_Textures;
+
+	uint64_t m_uiFrame = 0;
+
+	size_t m_uiBudget = 0;
+
+	/**
+	*	Bytes in textures that have their own storage.
+	*/
+	size_t m_uiResidentBytes = 0;
+
+	size_t m_uiEvictions = 0;
+	size_t m_uiEvictedBytes = 0;
+
+private:
+	CTextureManager( const CTextureManager& ) = delete;
+	CTextureManager& operator=( const CTextureManager& ) = delete;
+};
+
+#endif //ENGINE_CTEXTUREMANAGER_H
@@ -0,0 +1,147 @@
+#include "GLUtils.h"
+#include "TextureFile.h"
+
+#include "CTextureUploader.h"
+
+void CTextureUploader::Initialize( gl::CStateCache& state )
+{
+	m_pState = &state;
+
+	m_bTextureStorage = GLEW_VERSION_4_2 || GLEW_ARB_texture_storage;
+
+	//Pixel buffers are core since 2.1.
+	if( GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object )
+		glGenBuffers( 1, &m_PixelBuffer );
+}
+
+void CTextureUploader::Shutdown()
+{
+	if( m_PixelBuffer )
+	{
+		glDeleteBuffers( 1, &m_PixelBuffer );
+		m_pState->BufferDeleted( m_PixelBuffer );
+		m_PixelBuffer = 0;
+		m_uiBufferCapacity = 0;
+	}
+}
+
+GLuint CTextureUploader::CreateTexture( const int iWidth, const int iHeight )
+{
+	GLuint texture;
+
+	glGenTextures( 1, &texture );
+
+	m_pState->BindTexture( texture );
+
+	if( m_bTextureStorage )
+		glTexStorage2D( GL_TEXTURE_2D, 1, GL_RGBA8, iWidth, iHeight );
+	else
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA8, iWidth, iHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr );
+
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+	return texture;
+}
+
+GLuint CTextureUploader::CreateTexture( const texfile::TextureView_t& view )
+{
+	GLenum internalFormat;
+
+	switch( view.format )
+	{
+	case texfile::Format::RGBA8:	internalFormat = GL_RGBA8; break;
+	case texfile::Format::BC1:		internalFormat = GL_COMPRESSED_RGB_S3TC_DXT1_EXT; break;
+	case texfile::Format::BC3:		internalFormat = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+
+	default: return 0;
+	}
+
+	if( texfile::IsCompressed( view.format ) && !GLEW_EXT_texture_compression_s3tc )
+		return 0;
+
+	GLuint texture;
+
+	glGenTextures( 1, &texture );
+
+	m_pState->BindTexture( texture );
+
+	//Levels are read straight from the file's data.
+	m_pState->BindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+	for( uint32_t uiLevel = 0; uiLevel < view.uiLevelCount; ++uiLevel )
+	{
+		const auto& level = view.levels[ uiLevel ];
+
+		const uint8_t* const pLevelData = view.pData + level.offset;
+
+		if( texfile::IsCompressed( view.format ) )
+			glCompressedTexImage2D( GL_TEXTURE_2D, uiLevel, internalFormat, level.width, level.height, 0, level.size, pLevelData );
+		else
+			glTexImage2D( GL_TEXTURE_2D, uiLevel, internalFormat, level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pLevelData );
+
+		m_uiUploadedBytes += level.size;
+	}
+
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, view.uiLevelCount - 1 );
+
+	//Scaled down images use the smaller levels instead of skipping pixels.
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, view.uiLevelCount > 1 ? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+
+	return texture;
+}
+
+void CTextureUploader::Upload( GLuint texture, const int iX, const int iY, const int iWidth, const int iHeight, const void* pRGBA )
+{
+	if( iWidth <= 0 || iHeight <= 0 )
+		return;
+
+	const size_t uiSize = static_cast<size_t>( iWidth ) * iHeight * 4;
+
+	m_pState->BindTexture( texture );
+
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+	if( m_PixelBuffer )
+	{
+		m_pState->BindBuffer( GL_PIXEL_UNPACK_BUFFER, m_PixelBuffer );
+
+		if( uiSize > m_uiBufferCapacity )
+			m_uiBufferCapacity = uiSize;
+
+		//Orphan the previous contents so a pending copy from them doesn't block this one.
+		glBufferData( GL_PIXEL_UNPACK_BUFFER, m_uiBufferCapacity, nullptr, GL_STREAM_DRAW );
+		glBufferSubData( GL_PIXEL_UNPACK_BUFFER, 0, uiSize, pRGBA );
+
+		glTexSubImage2D( GL_TEXTURE_2D, 0, iX, iY, iWidth, iHeight, GL_RGBA, GL_UNSIGNED_BYTE, nullptr );
+
+		//Unbind so other pixel transfers read from client memory.
+		m_pState->BindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+	}
+	else
+	{
+		glTexSubImage2D( GL_TEXTURE_2D, 0, iX, iY, iWidth, iHeight, GL_RGBA, GL_UNSIGNED_BYTE, pRGBA );
+	}
+
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 4 );
+
+	m_uiUploadedBytes += uiSize;
+}
+
+size_t CTextureUploader::TakeUploadedBytes()
+{
+	const size_t uiBytes = m_uiUploadedBytes;
+
+	m_uiUploadedBytes = 0;
+
+	return uiBytes;
+}
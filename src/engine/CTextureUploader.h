@@ -0,0 +1,75 @@
+#ifndef ENGINE_CTEXTUREUPLOADER_H
+#define ENGINE_CTEXTUREUPLOADER_H
+
+#include <cstddef>
+
+#include <GL/glew.h>
+
+namespace gl
+{
+class CStateCache;
+}
+
+namespace texfile
+{
+struct TextureView_t;
+}
+
+/**
+*	Allocates texture storage and streams pixels into it.
+*	Storage is immutable if ARB_texture_storage is available, so it's allocated once and only ever updated.
+*	Pixels are copied through a pixel unpack buffer that is orphaned for every upload, so the copy into the texture
+*	is done by the driver when the GPU gets to it instead of stalling until draws using the old contents finish.
+*	Falls back to plain glTexImage2D and glTexSubImage2D from client memory.
+*	Must only be used on the thread that owns the OpenGL context.
+*/
+class CTextureUploader final
+{
+public:
+	CTextureUploader() = default;
+
+	/**
+	*	@param state State cache that all state changes go through.
+	*/
+	void Initialize( gl::CStateCache& state );
+
+	void Shutdown();
+
+	/**
+	*	Creates a texture with RGBA storage of the given size. The contents are undefined.
+	*/
+	GLuint CreateTexture( const int iWidth, const int iHeight );
+
+	/**
+	*	Creates a texture from a precompiled texture file, with all of its levels. Compressed formats need EXT_texture_compression_s3tc.
+	*	@return The texture, or 0 if the format isn't supported.
+	*/
+	GLuint CreateTexture( const texfile::TextureView_t& view );
+
+	/**
+	*	Updates part of a texture with tightly packed RGBA pixels.
+	*/
+	void Upload( GLuint texture, const int iX, const int iY, const int iWidth, const int iHeight, const void* pRGBA );
+
+	/**
+	*	@return Number of bytes uploaded since the last call.
+	*/
+	size_t TakeUploadedBytes();
+
+private:
+	gl::CStateCache* m_pState = nullptr;
+
+	bool m_bTextureStorage = false;
+
+	GLuint m_PixelBuffer = 0;
+
+	size_t m_uiBufferCapacity = 0;
+
+	size_t m_uiUploadedBytes = 0;
+
+private:
+	CTextureUploader( const CTextureUploader& ) = delete;
+	CTextureUploader& operator=( const CTextureUploader& ) = delete;
+};
+
+#endif //ENGINE_CTEXTUREUPLOADER_H
@@ -0,0 +1,545 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#ifndef WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/udp.h>
+#include <poll.h>
+#include <unistd.h>
+
+//Older headers don't have the offload options yet, kernels that don't support them reject them.
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+#endif
+
+#include "CUDPSocket.h"
+
+const size_t CUDPSocket::MAX_BATCH;
+const size_t CUDPSocket::MAX_QUEUED;
+const size_t CUDPSocket::MAX_PACKET_SIZE;
+const size_t CUDPSocket::MAX_OFFLOAD_SEGMENTS;
+const size_t CUDPSocket::MAX_OFFLOAD_SIZE;
+const int CUDPSocket::SOCKET_BUFFER_SIZE;
+
+namespace
+{
+/**
+*	Size of each message's control data, in 64 bit words. Enough for one integer option.
+*/
+const size_t CONTROL_WORDS = 4;
+
+/**
+*	CNetworkBuffer reads whole dwords, and may touch the ones after the packet.
+*/
+const size_t READ_SLACK = sizeof( uint64_t );
+
+const char* const RECEIVE_BUFFER_NAME = "CUDPSocket";
+
+bool IsSameAddress( const NetAddress_t& lhs, const NetAddress_t& rhs )
+{
+	return lhs.address.sin_addr.s_addr == rhs.address.sin_addr.s_addr && lhs.address.sin_port == rhs.address.sin_port;
+}
+}
+
+static_assert( CUDPSocket::MAX_OFFLOAD_SEGMENTS * CPacketBuilder::MAX_SEGMENTS <= 1024, "Segmentation offload messages must not exceed the system's buffer limit" );
+static_assert( CUDPSocket::MAX_OFFLOAD_SEGMENTS * CUDPSocket::MAX_PACKET_SIZE >= CUDPSocket::MAX_OFFLOAD_SIZE, "Offload messages must be limited by their size" );
+
+CUDPSocket::~CUDPSocket()
+{
+	Close();
+}
+
+bool CUDPSocket::Open( const uint16_t uiPort, const uint32_t uiFlags )
+{
+	Close();
+
+#ifdef WIN32
+	WSADATA data;
+
+	if( WSAStartup( MAKEWORD( 2, 2 ), &data ) != 0 )
+		return false;
+
+	m_Socket = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP );
+
+	u_long uiNonBlocking = 1;
+
+	if( m_Socket == INVALID_SOCKET || ioctlsocket( m_Socket, FIONBIO, &uiNonBlocking ) != 0 )
+	{
+		if( m_Socket != INVALID_SOCKET )
+			closesocket( m_Socket );
+
+		WSACleanup();
+		return false;
+	}
+#else
+	m_Socket = socket( AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP );
+
+	if( m_Socket < 0 )
+		return false;
+#endif
+
+	m_bOpen = true;
+
+	//Not fatal, the system may cap the size.
+	const int iBufferSize = SOCKET_BUFFER_SIZE;
+
+	setsockopt( m_Socket, SOL_SOCKET, SO_RCVBUF, reinterpret_cast<const char*>( &iBufferSize ), sizeof( iBufferSize ) );
+	setsockopt( m_Socket, SOL_SOCKET, SO_SNDBUF, reinterpret_cast<const char*>( &iBufferSize ), sizeof( iBufferSize ) );
+
+	sockaddr_in address;
+
+	memset( &address, 0, sizeof( address ) );
+
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl( INADDR_ANY );
+	address.sin_port = htons( uiPort );
+
+	if( bind( m_Socket, reinterpret_cast<const sockaddr*>( &address ), sizeof( address ) ) != 0 )
+	{
+		Close();
+		return false;
+	}
+
+#ifndef WIN32
+	if( uiFlags & FLAG_GRO )
+	{
+		const int iEnable = 1;
+
+		m_bGRO = setsockopt( m_Socket, IPPROTO_UDP, UDP_GRO, &iEnable, sizeof( iEnable ) ) == 0;
+	}
+
+	if( uiFlags & FLAG_GSO )
+	{
+		int iSegmentSize = 0;
+		socklen_t uiLength = sizeof( iSegmentSize );
+
+		m_bGSO = getsockopt( m_Socket, IPPROTO_UDP, UDP_SEGMENT, &iSegmentSize, &uiLength ) == 0;
+	}
+#endif
+
+	//Coalesced packets are moved apart to align them, so leave room for that.
+	const size_t uiReceiveSize = m_bGRO ? MAX_OFFLOAD_SIZE : MAX_PACKET_SIZE;
+	const size_t uiAlignSlack = m_bGRO ? ( sizeof( uint32_t ) - 1 ) * MAX_OFFLOAD_SEGMENTS : 0;
+	const size_t uiBufferWords = ( uiReceiveSize + uiAlignSlack + READ_SLACK + sizeof( uint32_t ) - 1 ) / sizeof( uint32_t );
+
+	m_uiReceiveBufferSize = uiBufferWords * sizeof( uint32_t );
+	m_ReceiveStorage.reset( new uint32_t[ uiBufferWords * MAX_BATCH ] );
+	m_ReceiveAddresses.reset( new sockaddr_in[ MAX_BATCH ] );
+
+	m_uiMaxReceived = m_bGRO ? MAX_BATCH * MAX_OFFLOAD_SEGMENTS : MAX_BATCH;
+	m_Received.reset( new Packet_t[ m_uiMaxReceived ] );
+
+	m_Queue.reset( new QueuedPacket_t[ MAX_QUEUED ] );
+	m_SendVecs.reset( new IOVec_t[ MAX_QUEUED * CPacketBuilder::MAX_SEGMENTS ] );
+
+#ifndef WIN32
+	m_ReceiveMessages.reset( new mmsghdr[ MAX_BATCH ] );
+	m_ReceiveVecs.reset( new IOVec_t[ MAX_BATCH ] );
+	m_ReceiveControl.reset( new uint64_t[ MAX_BATCH * CONTROL_WORDS ] );
+
+	m_SendMessages.reset( new mmsghdr[ MAX_BATCH ] );
+	m_SendControl.reset( new uint64_t[ MAX_BATCH * CONTROL_WORDS ] );
+
+	memset( m_ReceiveMessages.get(), 0, sizeof( mmsghdr ) * MAX_BATCH );
+	memset( m_SendMessages.get(), 0, sizeof( mmsghdr ) * MAX_BATCH );
+
+	auto pStorage = reinterpret_cast<uint8_t*>( m_ReceiveStorage.get() );
+
+	for( size_t uiIndex = 0; uiIndex < MAX_BATCH; ++uiIndex )
+	{
+		auto& vec = m_ReceiveVecs[ uiIndex ];
+
+		vec.iov_base = pStorage + uiIndex * m_uiReceiveBufferSize;
+		vec.iov_len = uiReceiveSize;
+
+		auto& message = m_ReceiveMessages[ uiIndex ].msg_hdr;
+
+		message.msg_name = &m_ReceiveAddresses[ uiIndex ];
+		message.msg_iov = &vec;
+		message.msg_iovlen = 1;
+
+		if( m_bGRO )
+			message.msg_control = &m_ReceiveControl[ uiIndex * CONTROL_WORDS ];
+	}
+#endif
+
+	return true;
+}
+
+void CUDPSocket::Close()
+{
+	if( !m_bOpen )
+		return;
+
+#ifdef WIN32
+	closesocket( m_Socket );
+	WSACleanup();
+#else
+	close( m_Socket );
+#endif
+
+	m_bOpen = false;
+	m_bGSO = false;
+	m_bGRO = false;
+
+	m_uiReceivedCount = 0;
+	m_uiQueuedCount = 0;
+	m_uiQueuedVecs = 0;
+}
+
+bool CUDPSocket::IsOpen() const
+{
+	return m_bOpen;
+}
+
+uint16_t CUDPSocket::GetPort() const
+{
+	if( !m_bOpen )
+		return 0;
+
+	sockaddr_in address;
+	socklen_t uiLength = sizeof( address );
+
+	if( getsockname( m_Socket, reinterpret_cast<sockaddr*>( &address ), &uiLength ) != 0 )
+		return 0;
+
+	return ntohs( address.sin_port );
+}
+
+bool CUDPSocket::Wait( const uint32_t uiTimeoutMS )
+{
+	if( !m_bOpen )
+		return false;
+
+#ifdef WIN32
+	WSAPOLLFD fd = { m_Socket, POLLRDNORM, 0 };
+
+	return WSAPoll( &fd, 1, static_cast<INT>( uiTimeoutMS ) ) > 0;
+#else
+	pollfd fd = { m_Socket, POLLIN, 0 };
+
+	return poll( &fd, 1, static_cast<int>( uiTimeoutMS ) ) > 0;
+#endif
+}
+
+size_t CUDPSocket::Receive()
+{
+	m_uiReceivedCount = 0;
+
+	if( !m_bOpen )
+		return 0;
+
+#ifdef WIN32
+	auto pStorage = reinterpret_cast<uint8_t*>( m_ReceiveStorage.get() );
+
+	for( size_t uiIndex = 0; uiIndex < MAX_BATCH; ++uiIndex )
+	{
+		uint8_t* pData = pStorage + uiIndex * m_uiReceiveBufferSize;
+
+		WSABUF buffer;
+
+		buffer.buf = reinterpret_cast<CHAR*>( pData );
+		buffer.len = static_cast<ULONG>( MAX_PACKET_SIZE );
+
+		DWORD uiBytes = 0;
+		DWORD uiFlags = 0;
+		int iAddressLength = sizeof( sockaddr_in );
+
+		++m_Stats.uiReceiveCalls;
+
+		if( WSARecvFrom( m_Socket, &buffer, 1, &uiBytes, &uiFlags,
+			reinterpret_cast<sockaddr*>( &m_ReceiveAddresses[ uiIndex ] ), &iAddressLength, nullptr, nullptr ) != 0 )
+		{
+			const int iError = WSAGetLastError();
+
+			//A packet that was too large, or an ICMP error from an earlier send. Either way, there may be more packets.
+			if( iError == WSAEMSGSIZE )
+			{
+				++m_Stats.uiDropped;
+				continue;
+			}
+
+			if( iError == WSAECONNRESET )
+				continue;
+
+			break;
+		}
+
+		AddReceived( m_ReceiveAddresses[ uiIndex ], pData, uiBytes, uiBytes );
+	}
+#else
+	for( size_t uiIndex = 0; uiIndex < MAX_BATCH; ++uiIndex )
+	{
+		auto& message = m_ReceiveMessages[ uiIndex ].msg_hdr;
+
+		message.msg_namelen = sizeof( sockaddr_in );
+		message.msg_controllen = m_bGRO ? CONTROL_WORDS * sizeof( uint64_t ) : 0;
+		message.msg_flags = 0;
+	}
+
+	++m_Stats.uiReceiveCalls;
+
+	const int iResult = recvmmsg( m_Socket, m_ReceiveMessages.get(), MAX_BATCH, MSG_DONTWAIT, nullptr );
+
+	for( int iIndex = 0; iIndex < iResult; ++iIndex )
+	{
+		auto& message = m_ReceiveMessages[ iIndex ];
+
+		if( message.msg_hdr.msg_flags & MSG_TRUNC )
+		{
+			++m_Stats.uiDropped;
+			continue;
+		}
+
+		size_t uiSegmentSize = message.msg_len;
+
+		if( m_bGRO )
+		{
+			for( cmsghdr* pControl = CMSG_FIRSTHDR( &message.msg_hdr ); pControl; pControl = CMSG_NXTHDR( &message.msg_hdr, pControl ) )
+			{
+				if( pControl->cmsg_level == IPPROTO_UDP && pControl->cmsg_type == UDP_GRO )
+				{
+					int iSegmentSize = 0;
+
+					memcpy( &iSegmentSize, CMSG_DATA( pControl ), sizeof( iSegmentSize ) );
+
+					if( iSegmentSize > 0 )
+						uiSegmentSize = static_cast<size_t>( iSegmentSize );
+				}
+			}
+		}
+
+		AddReceived( m_ReceiveAddresses[ iIndex ], reinterpret_cast<uint8_t*>( m_ReceiveVecs[ iIndex ].iov_base ), message.msg_len, uiSegmentSize );
+	}
+#endif
+
+	return m_uiReceivedCount;
+}
+
+bool CUDPSocket::Queue( const NetAddress_t& to, const CPacketBuilder& packet )
+{
+	if( !m_bOpen || packet.GetSize() == 0 || packet.GetSize() > MAX_PACKET_SIZE )
+		return false;
+
+	if( m_uiQueuedCount == MAX_QUEUED )
+		Flush();
+
+	auto& queued = m_Queue[ m_uiQueuedCount++ ];
+
+	queued.to = to;
+	queued.uiFirstVec = m_uiQueuedVecs;
+	queued.uiVecCount = packet.GetIOVecs( &m_SendVecs[ m_uiQueuedVecs ] );
+	queued.uiSize = packet.GetSize();
+
+	m_uiQueuedVecs += queued.uiVecCount;
+
+	return true;
+}
+
+size_t CUDPSocket::Flush()
+{
+	size_t uiSent = 0;
+
+#ifdef WIN32
+	for( size_t uiPacket = 0; uiPacket < m_uiQueuedCount; ++uiPacket )
+	{
+		const auto& queued = m_Queue[ uiPacket ];
+
+		DWORD uiBytes = 0;
+
+		++m_Stats.uiSendCalls;
+
+		if( WSASendTo( m_Socket, &m_SendVecs[ queued.uiFirstVec ], static_cast<DWORD>( queued.uiVecCount ), &uiBytes, 0,
+			reinterpret_cast<const sockaddr*>( &queued.to.address ), sizeof( queued.to.address ), nullptr, nullptr ) != 0 )
+		{
+			//The send buffer is full, so the rest would fail too.
+			if( WSAGetLastError() == WSAEWOULDBLOCK )
+			{
+				m_Stats.uiDropped += m_uiQueuedCount - uiPacket;
+				break;
+			}
+
+			++m_Stats.uiDropped;
+			continue;
+		}
+
+		++uiSent;
+	}
+#else
+	size_t uiFirst = 0;
+
+	while( uiFirst < m_uiQueuedCount )
+	{
+		size_t uiMessages = 0;
+
+		for( size_t uiPacket = uiFirst; uiPacket < m_uiQueuedCount && uiMessages < MAX_BATCH; ++uiMessages )
+		{
+			const auto& queued = m_Queue[ uiPacket ];
+
+			const size_t uiCount = m_bGSO ? GetOffloadRun( uiPacket ) : 1;
+
+			auto& message = m_SendMessages[ uiMessages ].msg_hdr;
+
+			message.msg_name = const_cast<sockaddr_in*>( &queued.to.address );
+			message.msg_namelen = sizeof( sockaddr_in );
+
+			//Consecutive packets' segments are consecutive, so one vector covers the run.
+			message.msg_iov = &m_SendVecs[ queued.uiFirstVec ];
+			message.msg_iovlen = m_Queue[ uiPacket + uiCount - 1 ].uiFirstVec + m_Queue[ uiPacket + uiCount - 1 ].uiVecCount - queued.uiFirstVec;
+
+			if( uiCount > 1 )
+			{
+				message.msg_control = &m_SendControl[ uiMessages * CONTROL_WORDS ];
+				message.msg_controllen = CMSG_SPACE( sizeof( uint16_t ) );
+
+				cmsghdr* pControl = CMSG_FIRSTHDR( &message );
+
+				pControl->cmsg_level = IPPROTO_UDP;
+				pControl->cmsg_type = UDP_SEGMENT;
+				pControl->cmsg_len = CMSG_LEN( sizeof( uint16_t ) );
+
+				const uint16_t uiSegmentSize = static_cast<uint16_t>( queued.uiSize );
+
+				memcpy( CMSG_DATA( pControl ), &uiSegmentSize, sizeof( uiSegmentSize ) );
+			}
+			else
+			{
+				message.msg_control = nullptr;
+				message.msg_controllen = 0;
+			}
+
+			m_uiMessagePackets[ uiMessages ] = uiCount;
+
+			uiPacket += uiCount;
+		}
+
+		++m_Stats.uiSendCalls;
+
+		const int iResult = sendmmsg( m_Socket, m_SendMessages.get(), static_cast<unsigned int>( uiMessages ), 0 );
+
+		if( iResult < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+
+			//The device can't segment packets after all, send them one by one from now on.
+			if( errno == EIO && m_uiMessagePackets[ 0 ] > 1 )
+			{
+				m_bGSO = false;
+				continue;
+			}
+
+			//The send buffer is full, so the rest would fail too.
+			if( errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS )
+			{
+				m_Stats.uiDropped += m_uiQueuedCount - uiFirst;
+				break;
+			}
+
+			//Only the first message failed, like one to an unreachable address.
+			m_Stats.uiDropped += m_uiMessagePackets[ 0 ];
+			uiFirst += m_uiMessagePackets[ 0 ];
+			continue;
+		}
+
+		for( int iMessage = 0; iMessage < iResult; ++iMessage )
+		{
+			const size_t uiCount = m_uiMessagePackets[ iMessage ];
+
+			if( uiCount > 1 )
+				m_Stats.uiOffloadSent += uiCount;
+
+			uiSent += uiCount;
+			uiFirst += uiCount;
+		}
+	}
+#endif
+
+	m_Stats.uiSent += uiSent;
+
+	m_uiQueuedCount = 0;
+	m_uiQueuedVecs = 0;
+
+	return uiSent;
+}
+
+bool CUDPSocket::ParseAddress( const char* pszAddress, const uint16_t uiPort, NetAddress_t& address )
+{
+	memset( &address, 0, sizeof( address ) );
+
+	address.address.sin_family = AF_INET;
+	address.address.sin_port = htons( uiPort );
+
+	return inet_pton( AF_INET, pszAddress, &address.address.sin_addr ) == 1;
+}
+
+size_t CUDPSocket::GetOffloadRun( const size_t uiFirst ) const
+{
+	const auto& first = m_Queue[ uiFirst ];
+
+	size_t uiCount = 1;
+	size_t uiTotalSize = first.uiSize;
+
+	//Every segment but the last must be the same size.
+	while( uiCount < MAX_OFFLOAD_SEGMENTS && uiFirst + uiCount < m_uiQueuedCount )
+	{
+		const auto& next = m_Queue[ uiFirst + uiCount ];
+
+		if( next.uiSize > first.uiSize || uiTotalSize + next.uiSize > MAX_OFFLOAD_SIZE || !IsSameAddress( next.to, first.to ) )
+			break;
+
+		++uiCount;
+		uiTotalSize += next.uiSize;
+
+		if( next.uiSize < first.uiSize )
+			break;
+	}
+
+	return uiCount;
+}
+
+void CUDPSocket::AddReceived( const sockaddr_in& from, uint8_t* pData, const size_t uiSize, const size_t uiSegmentSize )
+{
+	if( uiSize == 0 || uiSegmentSize == 0 )
+		return;
+
+	size_t uiSegments = ( uiSize + uiSegmentSize - 1 ) / uiSegmentSize;
+
+	if( uiSegments > MAX_OFFLOAD_SEGMENTS )
+	{
+		m_Stats.uiDropped += uiSegments - MAX_OFFLOAD_SEGMENTS;
+		uiSegments = MAX_OFFLOAD_SEGMENTS;
+	}
+
+	uiSegments = std::min( uiSegments, m_uiMaxReceived - m_uiReceivedCount );
+
+	//Packets are read a dword at a time, so each must start at an aligned offset.
+	//Moving them from last to first, none is overwritten before it's moved.
+	const size_t uiStride = ( uiSegmentSize + sizeof( uint32_t ) - 1 ) & ~( sizeof( uint32_t ) - 1 );
+
+	for( size_t uiSegment = uiSegments; uiSegment-- > 0; )
+	{
+		const size_t uiOffset = uiSegment * uiSegmentSize;
+		const size_t uiPacketSize = std::min( uiSegmentSize, uiSize - uiOffset );
+
+		uint8_t* pPacket = pData + uiSegment * uiStride;
+
+		if( uiStride != uiSegmentSize && uiSegment > 0 )
+			memmove( pPacket, pData + uiOffset, uiPacketSize );
+
+		auto& packet = m_Received[ m_uiReceivedCount + uiSegment ];
+
+		packet.from.address = from;
+		packet.buffer.SetBuffer( RECEIVE_BUFFER_NAME, pPacket, uiPacketSize );
+	}
+
+	m_uiReceivedCount += uiSegments;
+	m_Stats.uiReceived += uiSegments;
+}
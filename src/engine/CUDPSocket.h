@@ -0,0 +1,276 @@
+#ifndef ENGINE_CUDPSOCKET_H
+#define ENGINE_CUDPSOCKET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#ifdef WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <netinet/in.h>
+#include <sys/socket.h>
+#endif
+
+#include "CNetworkBuffer.h"
+#include "CPacketBuilder.h"
+
+/**
+*	IPv4 address and port, stored the way the socket calls take it.
+*/
+struct NetAddress_t
+{
+	sockaddr_in address;
+};
+
+/**
+*	Non-blocking UDP socket that sends and receives packets in batches, so a server with many players makes a few system calls per frame instead of one per packet.
+*	On Linux, packets are received with recvmmsg and sent with sendmmsg. Consecutive packets of the same size to the same address are sent as one
+*	segmentation offload (GSO) message, and the kernel may coalesce received packets with receive offload (GRO); both are used if the kernel supports them.
+*	On Windows, each packet is received and sent with its own call.
+*	Received packets are read from buffers allocated when the socket is opened, and sent packets are gathered from their segments without copying.
+*/
+class CUDPSocket final
+{
+public:
+#ifdef WIN32
+	using Socket_t = SOCKET;
+#else
+	using Socket_t = int;
+#endif
+
+	/**
+	*	Maximum number of messages passed to each receive and send call.
+	*/
+	static const size_t MAX_BATCH = 64;
+
+	/**
+	*	Maximum number of packets queued to be sent. Queueing more sends the queue first.
+	*/
+	static const size_t MAX_QUEUED = 256;
+
+	/**
+	*	Largest packet that can be received, in bytes. Larger packets are dropped.
+	*/
+	static const size_t MAX_PACKET_SIZE = 4096;
+
+	/**
+	*	Maximum number of packets the kernel coalesces into one receive, and that are sent as one segmentation offload message.
+	*/
+	static const size_t MAX_OFFLOAD_SEGMENTS = 64;
+
+	/**
+	*	Largest coalesced receive and segmentation offload message, in bytes: the largest UDP payload over IPv4.
+	*/
+	static const size_t MAX_OFFLOAD_SIZE = 65507;
+
+	/**
+	*	Size requested for the kernel's send and receive buffers, in bytes, so bursts between batches aren't dropped.
+	*/
+	static const int SOCKET_BUFFER_SIZE = 4 * 1024 * 1024;
+
+	enum Flag : uint32_t
+	{
+		FLAG_NONE	= 0,
+
+		/**
+		*	Send packets with segmentation offload, if supported.
+		*/
+		FLAG_GSO	= 1 << 0,
+
+		/**
+		*	Receive packets with receive offload, if supported. Receive buffers are large enough for coalesced packets.
+		*/
+		FLAG_GRO	= 1 << 1,
+	};
+
+	/**
+	*	A received packet.
+	*/
+	struct Packet_t
+	{
+		NetAddress_t from;
+
+		/**
+		*	Buffer to read the packet from.
+		*/
+		CNetworkBuffer buffer;
+	};
+
+	struct Stats_t
+	{
+		uint64_t uiReceived = 0;
+		uint64_t uiReceiveCalls = 0;
+
+		uint64_t uiSent = 0;
+		uint64_t uiSendCalls = 0;
+
+		/**
+		*	Number of packets sent as part of a segmentation offload message.
+		*/
+		uint64_t uiOffloadSent = 0;
+
+		/**
+		*	Number of packets dropped because they were too large, or the send failed.
+		*/
+		uint64_t uiDropped = 0;
+	};
+
+public:
+	CUDPSocket() = default;
+	~CUDPSocket();
+
+	/**
+	*	Opens the socket on all interfaces.
+	*	@param uiPort Port to bind to, or 0 to let the system pick one.
+	*	@param uiFlags Flags from Flag.
+	*	@return Whether the socket was opened.
+	*/
+	bool Open( const uint16_t uiPort, const uint32_t uiFlags = FLAG_NONE );
+
+	void Close();
+
+	bool IsOpen() const;
+
+	/**
+	*	@return Port the socket is bound to, or 0 if it isn't open.
+	*/
+	uint16_t GetPort() const;
+
+	bool IsGSOEnabled() const { return m_bGSO; }
+	bool IsGROEnabled() const { return m_bGRO; }
+
+	/**
+	*	Waits until packets can be received.
+	*	@param uiTimeoutMS Maximum time to wait, in milliseconds.
+	*	@return Whether packets can be received.
+	*/
+	bool Wait( const uint32_t uiTimeoutMS );
+
+	/**
+	*	Receives the packets that arrived, up to MAX_BATCH receives. Doesn't block.
+	*	Packets from the previous call are no longer valid.
+	*	@return Number of packets received.
+	*/
+	size_t Receive();
+
+	size_t GetReceivedCount() const { return m_uiReceivedCount; }
+
+	/**
+	*	@return A packet received by the last call to Receive.
+	*/
+	Packet_t& GetReceived( const size_t uiIndex ) { return m_Received[ uiIndex ]; }
+
+	/**
+	*	Queues a packet to be sent by Flush. The packet's segments are referenced, so they must stay valid until then.
+	*	@return Whether the packet can be sent. If not, it's larger than MAX_PACKET_SIZE, empty, or the socket isn't open.
+	*/
+	bool Queue( const NetAddress_t& to, const CPacketBuilder& packet );
+
+	size_t GetQueuedCount() const { return m_uiQueuedCount; }
+
+	/**
+	*	Sends all queued packets. Packets the system can't take right now are dropped, like they would be on the network.
+	*	@return Number of packets sent.
+	*/
+	size_t Flush();
+
+	const Stats_t& GetStats() const { return m_Stats; }
+
+	/**
+	*	Parses a dotted IPv4 address.
+	*	@return Whether the address is valid.
+	*/
+	static bool ParseAddress( const char* pszAddress, const uint16_t uiPort, NetAddress_t& address );
+
+private:
+	struct QueuedPacket_t
+	{
+		NetAddress_t to;
+
+		/**
+		*	Range of the packet's segments in m_SendVecs.
+		*/
+		size_t uiFirstVec;
+		size_t uiVecCount;
+
+		size_t uiSize;
+	};
+
+	/**
+	*	@return Number of queued packets, starting at uiFirst, that can be sent as one segmentation offload message.
+	*/
+	size_t GetOffloadRun( const size_t uiFirst ) const;
+
+	/**
+	*	Adds the packets of a coalesced receive to the received packets.
+	*	@param pData Start of the receive's buffer.
+	*	@param uiSize Number of bytes received.
+	*	@param uiSegmentSize Size of each packet but the last.
+	*/
+	void AddReceived( const sockaddr_in& from, uint8_t* pData, const size_t uiSize, const size_t uiSegmentSize );
+
+private:
+	Socket_t m_Socket;
+
+	bool m_bOpen = false;
+
+	bool m_bGSO = false;
+	bool m_bGRO = false;
+
+	/**
+	*	Size of each receive buffer, in bytes.
+	*/
+	size_t m_uiReceiveBufferSize = 0;
+
+	/**
+	*	Backing memory of the receive buffers.
+	*/
+	std::unique_ptr<uint32_t[]> m_ReceiveStorage;
+
+	std::unique_ptr<sockaddr_in[]> m_ReceiveAddresses;
+
+#ifndef WIN32
+	std::unique_ptr<mmsghdr[]> m_ReceiveMessages;
+	std::unique_ptr<IOVec_t[]> m_ReceiveVecs;
+
+	/**
+	*	Control data of each receive, for the coalesced packet size.
+	*/
+	std::unique_ptr<uint64_t[]> m_ReceiveControl;
+
+	std::unique_ptr<mmsghdr[]> m_SendMessages;
+
+	/**
+	*	Control data of each send, for the segment size.
+	*/
+	std::unique_ptr<uint64_t[]> m_SendControl;
+
+	/**
+	*	Number of queued packets in each send message.
+	*/
+	size_t m_uiMessagePackets[ MAX_BATCH ];
+#endif
+
+	std::unique_ptr<Packet_t[]> m_Received;
+
+	size_t m_uiMaxReceived = 0;
+
+	size_t m_uiReceivedCount = 0;
+
+	std::unique_ptr<QueuedPacket_t[]> m_Queue;
+
+	std::unique_ptr<IOVec_t[]> m_SendVecs;
+
+	size_t m_uiQueuedCount = 0;
+	size_t m_uiQueuedVecs = 0;
+
+	Stats_t m_Stats;
+
+private:
+	CUDPSocket( const CUDPSocket& ) = delete;
+	CUDPSocket& operator=( const CUDPSocket& ) = delete;
+};
+
+#endif //ENGINE_CUDPSOCKET_H
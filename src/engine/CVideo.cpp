@@ -1,3 +1,9 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "cvardef.h"
+
 #include "Common.h"
 #include "Engine.h"
 #include "Logging.h"
@@ -7,6 +13,142 @@
 
 #include "CVideo.h"
 
+namespace
+{
+/**
+*	Maximum frames per second. 0 for no limit.
+*/
+cvar_t fps_max = { "fps_max", const_cast<char*>( "100" ) };
+
+/**
+*	Maximum frames per second while the window is unfocused or minimized. 0 to use fps_max.
+*/
+cvar_t fps_max_inactive = { "fps_max_inactive", const_cast<char*>( "20" ) };
+
+/**
+*	Swap interval. 1 to wait for vertical sync, 0 to present immediately, -1 for adaptive vsync, which doesn't wait if the frame is late.
+*/
+cvar_t gl_vsync = { "gl_vsync", const_cast<char*>( "1" ) };
+
+/**
+*	Time over which the present rate is measured, in seconds.
+*/
+const double PRESENT_RATE_PERIOD = 1;
+
+/**
+*	OpenGL 2.0 or newer. Shader support. - Solokiller
+*/
+const int LEGACY_GL_MAJOR = 2;
+const int LEGACY_GL_MINOR = 0;
+
+/**
+*	Context version requested with -glcore. The first core profile version with layout qualifiers on shader inputs.
+*/
+const int CORE_GL_MAJOR = 3;
+const int CORE_GL_MINOR = 3;
+
+/**
+*	Most numbered screenshots that are looked for when no name is given.
+*/
+const unsigned int MAX_SCREENSHOTS = 10000;
+
+void Cmd_Vid_Stats_f()
+{
+	g_Video.PrintStats();
+}
+
+void Cmd_Screenshot_f()
+{
+	std::string szFileName;
+
+	if( g_CVar.GetArgC() >= 2 )
+	{
+		szFileName = g_CVar.GetArgV( 1 );
+
+		const size_t uiDot = szFileName.find_last_of( '.' );
+
+		if( uiDot == std::string::npos || szFileName.find_first_of( "/\\", uiDot ) != std::string::npos )
+			szFileName += ".tga";
+	}
+	else
+	{
+		char szName[ 32 ];
+
+		for( unsigned int uiIndex = 0; uiIndex < MAX_SCREENSHOTS; ++uiIndex )
+		{
+			snprintf( szName, sizeof( szName ), "hl%04u.tga", uiIndex );
+
+			if( !g_pFileSystem->FileExists( szName ) )
+			{
+				szFileName = szName;
+				break;
+			}
+		}
+
+		if( szFileName.empty() )
+		{
+			Msg( "Couldn't find a free screenshot name, remove some screenshots first\n" );
+			return;
+		}
+	}
+
+	g_Video.GetFrameCapture().RequestScreenshot( szFileName.c_str() );
+}
+
+void Cmd_StartMovie_f()
+{
+	if( g_CVar.GetArgC() != 2 )
+	{
+		Msg( "Usage: startmovie <base name>\n" );
+		return;
+	}
+
+	auto& capture = g_Video.GetFrameCapture();
+
+	if( capture.IsRecordingMovie() )
+	{
+		Msg( "Already recording a movie, use endmovie to stop\n" );
+		return;
+	}
+
+	capture.StartMovie( g_CVar.GetArgV( 1 ) );
+
+	Msg( "Recording frames to %s#####.tga\n", g_CVar.GetArgV( 1 ) );
+}
+
+void Cmd_EndMovie_f()
+{
+	auto& capture = g_Video.GetFrameCapture();
+
+	if( !capture.IsRecordingMovie() )
+	{
+		Msg( "Not recording a movie\n" );
+		return;
+	}
+
+	unsigned int uiFrames, uiDropped;
+
+	capture.StopMovie( uiFrames, uiDropped );
+
+	Msg( "Stopped recording, %u frames captured, %u dropped\n", uiFrames, uiDropped );
+}
+
+constexpr cvar::CVarDesc_t VIDEO_CVARS[] =
+{
+	cvar::CVarDesc( fps_max, "fps_max" ),
+	cvar::CVarDesc( fps_max_inactive, "fps_max_inactive" ),
+	cvar::CVarDesc( gl_vsync, "gl_vsync" ),
+};
+
+constexpr cvar::CommandDesc_t VIDEO_COMMANDS[] =
+{
+	cvar::CommandDesc( "endmovie", &::Cmd_EndMovie_f ),
+	cvar::CommandDesc( "screenshot", &::Cmd_Screenshot_f ),
+	cvar::CommandDesc( "startmovie", &::Cmd_StartMovie_f ),
+	cvar::CommandDesc( "vid_stats", &::Cmd_Vid_Stats_f ),
+};
+}
+
 bool CVideo::Initialize()
 {
 	if( g_Engine.GetLoader()->IsListenServer() )
@@ -22,14 +164,21 @@ void CVideo::Shutdown()
 {
 	if( g_Engine.GetLoader()->IsListenServer() )
 	{
+		m_RenderThread.Stop();
+
 		if( m_hGLContext )
 		{
+			m_FrameCapture.Shutdown();
+			m_Renderer.Shutdown();
+
 			SDL_GL_DeleteContext( m_hGLContext );
 			m_hGLContext = nullptr;
 		}
 
 		if( m_pWindow )
 		{
+			g_Engine.GetLoader()->SetEngineWindow( nullptr );
+
 			SDL_DestroyWindow( m_pWindow );
 			m_pWindow = nullptr;
 		}
@@ -40,62 +189,232 @@ void CVideo::Shutdown()
 
 bool CVideo::Run( CEngine& engine )
 {
-	glEnable( GL_TEXTURE_2D );
+	AddCVars();
 
-	bool bQuit = false;
+	if( GetCommandLine()->HasKey( "-renderthread" ) )
+	{
+		if( m_RenderThread.Start( m_pWindow, m_hGLContext, [ this ]( const CRenderCommandList& list ) { RenderFrame( list ); } ) )
+			Msg( "Rendering on a separate thread\n" );
+	}
 
-	SDL_Event event;
+	m_bCloseRequested = false;
 
-	while( !bQuit )
+	const auto closeHandler = m_EventPump.AddHandler( SDL_WINDOWEVENT,
+		[ this ]( const SDL_Event& event )
+		{
+			//Close if the main window receives a close request.
+			if( event.window.event == SDL_WINDOWEVENT_CLOSE && SDL_GetWindowID( m_pWindow ) == event.window.windowID )
+				m_bCloseRequested = true;
+		}
+	);
+
+	while( !m_bCloseRequested && !engine.IsQuitRequested() )
 	{
-		while( SDL_PollEvent( &event ) )
+		const Uint32 windowFlags = SDL_GetWindowFlags( m_pWindow );
+
+		const bool bInactive = !( windowFlags & SDL_WINDOW_INPUT_FOCUS ) || ( windowFlags & SDL_WINDOW_MINIMIZED );
+
+		m_FrameLimiter.SetMaxFPS( bInactive && fps_max_inactive.value > 0 ? fps_max_inactive.value : fps_max.value );
+
+		m_FrameLimiter.WaitForNextFrame();
+
 		{
-			if( event.type == SDL_WINDOWEVENT )
-			{
-				//Close if the main window receives a close request.
-				if( event.window.event == SDL_WINDOWEVENT_CLOSE )
-				{
-					if( SDL_GetWindowID( m_pWindow ) == event.window.windowID )
-					{
-						bQuit = true;
-					}
-				}
-			}
+			const int iInterval = static_cast<int>( gl_vsync.value );
+
+			m_iWantedSwapInterval.store( iInterval < -1 ? -1 : ( iInterval > 1 ? 1 : iInterval ), std::memory_order_relaxed );
 		}
 
+		g_FrameTimer.BeginFrame();
+
+		PumpEvents();
+
 		engine.RunFrame();
+
+		g_FrameTimer.EndFrame();
 	}
 
+	m_EventPump.RemoveHandler( closeHandler );
+
+	m_RenderThread.Stop();
+
 	return true;
 }
 
-bool CVideo::CreateGameWindow()
+void CVideo::PumpEvents()
 {
-	Uint32 windowFlags = /*SDL_WINDOW_HIDDEN |*/ SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL;
+	CFrameTimer::CScopedPhase phase( g_FrameTimer, CFrameTimer::Phase::EVENTS );
 
-	if( GetCommandLine()->GetValue( "-noborder" ) )
-		windowFlags |= SDL_WINDOW_BORDERLESS;
+	m_EventPump.Pump();
+}
 
-	//OpenGL 2.0 or newer. Shader support. - Solokiller
-	const int iGLMajor = 2;
-	const int iGLMinor = 0;
+void CVideo::SubmitFrame()
+{
+	//Results from a few frames ago, the GPU is never waited on.
+	for( size_t uiPass = 0; uiPass < CFrameTimer::NUM_GPU_PASSES; ++uiPass )
+	{
+		g_FrameTimer.SetGPUPassTime( static_cast<CFrameTimer::GPUPass>( uiPass ), m_Renderer.GetGPUPassTime( uiPass ) );
+	}
 
-	Msg( "Requested OpenGL version: %d.%d\n", iGLMajor, iGLMinor );
+	if( m_RenderThread.IsRunning() )
+	{
+		CFrameTimer::CScopedPhase phase( g_FrameTimer, CFrameTimer::Phase::PRESENT );
 
-	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, iGLMajor );
-	SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, iGLMinor );
+		m_RenderThread.Submit();
+	}
+	else
+	{
+		{
+			CFrameTimer::CScopedPhase phase( g_FrameTimer, CFrameTimer::Phase::RENDER );
+
+			UpdateSwapInterval();
+
+			m_Renderer.Execute( m_CommandList );
+		}
+
+		{
+			CFrameTimer::CScopedPhase phase( g_FrameTimer, CFrameTimer::Phase::PRESENT );
+
+			Present();
+		}
+
+		m_CommandList.Clear();
+	}
+}
+
+void CVideo::RenderFrame( const CRenderCommandList& list )
+{
+	UpdateSwapInterval();
+
+	m_Renderer.Execute( list );
+
+	Present();
+}
+
+void CVideo::Present()
+{
+	{
+		int iWidth, iHeight;
+
+		SDL_GetWindowSize( m_pWindow, &iWidth, &iHeight );
+
+		m_FrameCapture.CaptureFrame( iWidth, iHeight );
+	}
+
+	SDL_GL_SwapWindow( m_pWindow );
+
+	++m_uiPresents;
+
+	const auto now = std::chrono::steady_clock::now();
+
+	const double flElapsed = std::chrono::duration<double>( now - m_PresentRateStart ).count();
+
+	if( flElapsed >= PRESENT_RATE_PERIOD )
+	{
+		m_flPresentRate.store( m_uiPresents / flElapsed, std::memory_order_relaxed );
+
+		m_uiPresents = 0;
+		m_PresentRateStart = now;
+	}
+}
+
+void CVideo::PrintStats() const
+{
+	CFrameLimiter::Stats_t stats;
+
+	m_FrameLimiter.GetStats( stats );
+
+	Msg( "Swap interval: %d (requested %d)\n", GetSwapInterval(), m_iRequestedSwapInterval.load( std::memory_order_relaxed ) );
+	Msg( "Present rate: %.1f/s\n", GetPresentRate() );
+	Msg( "Render thread: %s\n", IsRenderThreadEnabled() ? "on" : "off" );
+	Msg( "Pipeline: %s\n", m_bCoreProfile ? "core profile shaders" : "fixed function" );
+	Msg( "2D: %u quads in %u draw calls\n",
+		 static_cast<unsigned int>( m_Renderer.GetQuadCount() ), static_cast<unsigned int>( m_Renderer.GetDrawCallCount() ) );
+	Msg( "World: %u triangles in %u draw calls\n",
+		 static_cast<unsigned int>( m_Renderer.GetWorldTriangleCount() ), static_cast<unsigned int>( m_Renderer.GetWorldDrawCallCount() ) );
+	Msg( "Effects: %u in %u draw calls\n",
+		 static_cast<unsigned int>( m_Renderer.GetEffectCount() ), static_cast<unsigned int>( m_Renderer.GetEffectDrawCallCount() ) );
+	Msg( "Texture atlas pages: %u\n", static_cast<unsigned int>( m_Renderer.GetAtlasPageCount() ) );
+	Msg( "Texture uploads: %u bytes last frame\n", static_cast<unsigned int>( m_Renderer.GetUploadedBytes() ) );
+	Msg( "GL state changes: %u issued, %u filtered\n",
+		 static_cast<unsigned int>( m_Renderer.GetStateChangeCount() ), static_cast<unsigned int>( m_Renderer.GetFilteredStateChangeCount() ) );
+	Msg( "Frame cap: %.1f FPS\n", m_FrameLimiter.GetMaxFPS() );
+	Msg( "Frame time: %.3f ms mean, %.3f ms stddev, %.3f ms max over %llu frames\n",
+		 stats.flMeanMS, stats.flStdDevMS, stats.flMaxMS, static_cast<unsigned long long>( stats.uiFrames ) );
+}
+
+void CVideo::AddCVars()
+{
+	g_CVar.AddCVars( ::VIDEO_CVARS );
+	g_CVar.AddCommands( ::VIDEO_COMMANDS );
+}
+
+void CVideo::UpdateSwapInterval()
+{
+	const int iInterval = m_iWantedSwapInterval.load( std::memory_order_relaxed );
+
+	if( iInterval == m_iRequestedSwapInterval.load( std::memory_order_relaxed ) )
+		return;
+
+	m_iRequestedSwapInterval.store( iInterval, std::memory_order_relaxed );
+
+	if( SDL_GL_SetSwapInterval( iInterval ) != 0 )
+	{
+		//Adaptive vsync needs EXT_swap_control_tear, fall back to regular vsync.
+		if( iInterval == -1 && SDL_GL_SetSwapInterval( 1 ) == 0 )
+			Msg( "Adaptive vsync is not supported, using vsync\n" );
+		else
+			Msg( "Couldn't set swap interval %d: %s\n", iInterval, SDL_GetError() );
+	}
+
+	m_iSwapInterval.store( SDL_GL_GetSwapInterval(), std::memory_order_relaxed );
+}
+
+bool CVideo::CreateGameWindow()
+{
+	Uint32 windowFlags = /*SDL_WINDOW_HIDDEN |*/ SDL_WINDOW_RESIZABLE | SDL_WINDOW_OPENGL;
+
+	if( GetCommandLine()->HasKey( "-noborder" ) )
+		windowFlags |= SDL_WINDOW_BORDERLESS;
 
 	m_pWindow = SDL_CreateWindow( "Half-Life", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, m_iWidth, m_iHeight, windowFlags );
 
 	if( !m_pWindow )
 		return false;
 
+	g_Engine.GetLoader()->SetEngineWindow( m_pWindow );
+
 	m_flXScale = m_iWidth / 640.0f;
 	m_flYScale = m_iHeight / 480.0f;
 
 	SDL_RaiseWindow( m_pWindow );
 
-	m_hGLContext = SDL_GL_CreateContext( m_pWindow );
+	//The core profile drops the fixed function pipeline, which drivers tend to emulate slowly.
+	if( GetCommandLine()->HasKey( "-glcore" ) )
+	{
+		Msg( "Requested OpenGL version: %d.%d core\n", CORE_GL_MAJOR, CORE_GL_MINOR );
+
+		SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE );
+		SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, CORE_GL_MAJOR );
+		SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, CORE_GL_MINOR );
+
+		m_hGLContext = SDL_GL_CreateContext( m_pWindow );
+
+		if( m_hGLContext )
+			m_bCoreProfile = true;
+		else
+			Msg( "Couldn't create core profile context: %s\n", SDL_GetError() );
+	}
+
+	if( !m_hGLContext )
+	{
+		Msg( "Requested OpenGL version: %d.%d\n", LEGACY_GL_MAJOR, LEGACY_GL_MINOR );
+
+		SDL_GL_SetAttribute( SDL_GL_CONTEXT_PROFILE_MASK, 0 );
+		SDL_GL_SetAttribute( SDL_GL_CONTEXT_MAJOR_VERSION, LEGACY_GL_MAJOR );
+		SDL_GL_SetAttribute( SDL_GL_CONTEXT_MINOR_VERSION, LEGACY_GL_MINOR );
+
+		m_hGLContext = SDL_GL_CreateContext( m_pWindow );
+	}
 
 	if( !m_hGLContext )
 	{
@@ -110,5 +429,35 @@ bool CVideo::CreateGameWindow()
 
 	Msg( "OpenGL context version: %u.%u\n", uiMajor, uiMinor );
 
+	//GLEW looks up extensions with glGetString( GL_EXTENSIONS ), which core profiles don't support.
+	//This makes it load all entry points regardless.
+	glewExperimental = GL_TRUE;
+
+	const GLenum glewResult = glewInit();
+
+	//Only extensions need GLEW, so keep going without it. The core profile needs it for everything past 1.1.
+	if( glewResult != GLEW_OK )
+	{
+		Msg( "Couldn't initialize GLEW: %s\n", reinterpret_cast<const char*>( glewGetErrorString( glewResult ) ) );
+
+		if( m_bCoreProfile )
+			return false;
+	}
+
+	//glewInit causes GL_INVALID_ENUM in core profiles, don't leave it for someone else to find.
+	while( glGetError() != GL_NO_ERROR )
+	{
+	}
+
+	if( !m_Renderer.Initialize( m_bCoreProfile, !GetCommandLine()->HasKey( "-noshadercache" ) ? g_pFileSystem : nullptr ) )
+	{
+		Msg( "Couldn't initialize renderer\n" );
+		return false;
+	}
+
+	m_FrameCapture.Initialize( *g_pFileSystem );
+
+	m_PresentRateStart = std::chrono::steady_clock::now();
+
 	return true;
 }
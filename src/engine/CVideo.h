@@ -1,8 +1,19 @@
 #ifndef ENGINE_CVIDEO_H
 #define ENGINE_CVIDEO_H
 
+#include <atomic>
+#include <chrono>
+
 #include <SDL2/SDL.h>
 
+#include "CEventPump.h"
+#include "CFrameCapture.h"
+#include "CFrameLimiter.h"
+#include "CRenderCommandList.h"
+#include "CRenderer.h"
+#include "CRenderThread.h"
+#include "CTextureManager.h"
+
 class CEngine;
 
 /**
@@ -51,13 +62,86 @@ public:
 
 	/**
 	*	Runs the main loop. Calls engine.RunFrame every frame.
+	*	The frame rate is capped by fps_max, or by fps_max_inactive while the window is unfocused or minimized.
 	*	@return Whether the loop completed successfully.
 	*/
 	bool Run( CEngine& engine );
 
+	const CFrameLimiter& GetFrameLimiter() const { return m_FrameLimiter; }
+
+	CEventPump& GetEventPump() { return m_EventPump; }
+
+	/**
+	*	Dispatches pending events. Called at the start of each frame, and again right before rendering
+	*	so the frame reflects the latest input.
+	*/
+	void PumpEvents();
+
+	CRenderer& GetRenderer() { return m_Renderer; }
+
+	CTextureManager& GetTextureManager() { return m_TextureManager; }
+
+	CFrameCapture& GetFrameCapture() { return m_FrameCapture; }
+
+	/**
+	*	@return Whether the context is a core profile context. Requested with -glcore, falls back to a compatibility context.
+	*/
+	bool IsCoreProfile() const { return m_bCoreProfile; }
+
+	/**
+	*	@return Whether OpenGL work is done on a render thread. Enabled with -renderthread.
+	*/
+	bool IsRenderThreadEnabled() const { return m_RenderThread.IsRunning(); }
+
+	/**
+	*	@return The list to record this frame's rendering commands into.
+	*/
+	CRenderCommandList& GetCommandList()
+	{
+		return m_RenderThread.IsRunning() ? m_RenderThread.GetRecordList() : m_CommandList;
+	}
+
+	/**
+	*	Renders and presents the recorded frame. With a render thread, this hands the frame off instead,
+	*	and only waits if the render thread hasn't finished the previous frame yet.
+	*/
+	void SubmitFrame();
+
+	/**
+	*	@return The swap interval in use. 1 for vsync, 0 for none, -1 for adaptive vsync.
+	*/
+	int GetSwapInterval() const { return m_iSwapInterval.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return Number of frames presented per second, measured over the last second.
+	*/
+	double GetPresentRate() const { return m_flPresentRate.load( std::memory_order_relaxed ); }
+
+	/**
+	*	Prints the swap interval, present rate and frame time statistics.
+	*/
+	void PrintStats() const;
+
 private:
 	bool CreateGameWindow();
 
+	void AddCVars();
+
+	/**
+	*	Applies the swap interval from gl_vsync if it changed. Called on the thread that owns the context.
+	*/
+	void UpdateSwapInterval();
+
+	/**
+	*	Executes and presents a frame. Called on the thread that owns the context.
+	*/
+	void RenderFrame( const CRenderCommandList& list );
+
+	/**
+	*	Captures the frame that was drawn to the main window if it was requested, and presents it. Waits for vertical sync depending on gl_vsync.
+	*/
+	void Present();
+
 private:
 	unsigned int m_iWidth = 640;
 	unsigned int m_iHeight = 480;
@@ -69,6 +153,46 @@ private:
 
 	SDL_GLContext m_hGLContext = nullptr;
 
+	bool m_bCoreProfile = false;
+
+	CFrameLimiter m_FrameLimiter;
+
+	CEventPump m_EventPump;
+
+	/**
+	*	Set when the main window is closed.
+	*/
+	bool m_bCloseRequested = false;
+
+	CRenderer m_Renderer;
+
+	/**
+	*	Commands for this frame, when not using a render thread.
+	*/
+	CRenderCommandList m_CommandList;
+
+	CRenderThread m_RenderThread;
+
+	CTextureManager m_TextureManager;
+
+	CFrameCapture m_FrameCapture;
+
+	/**
+	*	Swap interval from gl_vsync, set by the main thread.
+	*/
+	std::atomic<int> m_iWantedSwapInterval{ 1 };
+
+	/**
+	*	Swap interval that was last applied, and the one that the driver is using.
+	*	Starts out invalid so the first update always applies gl_vsync.
+	*/
+	std::atomic<int> m_iRequestedSwapInterval{ 2 };
+	std::atomic<int> m_iSwapInterval{ 0 };
+
+	unsigned int m_uiPresents = 0;
+	std::chrono::steady_clock::time_point m_PresentRateStart;
+	std::atomic<double> m_flPresentRate{ 0 };
+
 private:
 	CVideo( const CVideo& ) = delete;
 	CVideo& operator=( const CVideo& ) = delete;
@@ -0,0 +1,639 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <tuple>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#include "CInterestSets.h"
+#include "CVisibilityCache.h"
+#include "Platform.h"
+
+#include "CAtlasPacker.h"
+#include "CBSPFile.h"
+
+#include "CWorldMesh.h"
+
+namespace
+{
+/**
+*	Texture info flag of sky and liquid faces, which have no lightmap.
+*/
+const int32_t TEX_SPECIAL = 1;
+
+const uint32_t NO_FACE = UINT32_MAX;
+
+/**
+*	Fullbright faces use a white block at the start of the first lightmap page. Its center is sampled, so filtering stays inside it.
+*/
+const int FULLBRIGHT_BLOCK_SIZE = 2;
+
+/**
+*	A world face while the mesh is being built.
+*/
+struct BakeFace_t
+{
+	uint32_t uiFace;
+	uint32_t uiTexture;
+
+	/**
+	*	First leaf that contains the face, to keep faces that are visible together close to each other.
+	*/
+	uint32_t uiFirstLeaf;
+
+	uint32_t uiLightmapPage;
+
+	/**
+	*	Position and size of the lightmap in its page, in luxels.
+	*/
+	int iLightX;
+	int iLightY;
+	int iLightWidth;
+	int iLightHeight;
+
+	/**
+	*	Texture coordinates of the lightmap's first luxel.
+	*/
+	float flTextureMins[ 2 ];
+
+	bool bLightmap;
+};
+
+inline unsigned int FindLowestBit( const uint64_t uiMask )
+{
+#ifdef _MSC_VER
+	unsigned long uiIndex;
+
+	//Not _BitScanForward64, which 32 bit builds don't have.
+	if( _BitScanForward( &uiIndex, static_cast<unsigned long>( uiMask ) ) )
+		return static_cast<unsigned int>( uiIndex );
+
+	_BitScanForward( &uiIndex, static_cast<unsigned long>( uiMask >> 32 ) );
+
+	return static_cast<unsigned int>( uiIndex ) + 32;
+#else
+	return static_cast<unsigned int>( __builtin_ctzll( uiMask ) );
+#endif
+}
+
+inline float TextureCoordinate( const bsp::TexInfo_t& texInfo, const size_t uiAxis, const float* pPoint )
+{
+	const float* const pVec = texInfo.vecs[ uiAxis ];
+
+	return pPoint[ 0 ] * pVec[ 0 ] + pPoint[ 1 ] * pVec[ 1 ] + pPoint[ 2 ] * pVec[ 2 ] + pVec[ 3 ];
+}
+
+/**
+*	Gets the planes of the view frustum from a column major view projection matrix, pointing inwards.
+*/
+void GetFrustumPlanes( const float* m, float ( &planes )[ 6 ][ 4 ] )
+{
+	for( size_t uiAxis = 0; uiAxis < 3; ++uiAxis )
+	{
+		for( size_t uiComponent = 0; uiComponent < 4; ++uiComponent )
+		{
+			const float flW = m[ uiComponent * 4 + 3 ];
+			const float flAxis = m[ uiComponent * 4 + uiAxis ];
+
+			planes[ uiAxis * 2 ][ uiComponent ] = flW + flAxis;
+			planes[ uiAxis * 2 + 1 ][ uiComponent ] = flW - flAxis;
+		}
+	}
+}
+
+/**
+*	@return Whether a box is at least partially inside all planes.
+*/
+bool IsBoxInside( const float ( &planes )[ 6 ][ 4 ], const float* mins, const float* maxs )
+{
+	for( const auto& plane : planes )
+	{
+		//The corner furthest along the plane's normal.
+		const float flDistance =
+			plane[ 0 ] * ( plane[ 0 ] >= 0 ? maxs[ 0 ] : mins[ 0 ] ) +
+			plane[ 1 ] * ( plane[ 1 ] >= 0 ? maxs[ 1 ] : mins[ 1 ] ) +
+			plane[ 2 ] * ( plane[ 2 ] >= 0 ? maxs[ 2 ] : mins[ 2 ] ) +
+			plane[ 3 ];
+
+		if( flDistance < 0 )
+			return false;
+	}
+
+	return true;
+}
+}
+
+const int CWorldMesh::LIGHTMAP_PAGE_SIZE;
+const int CWorldMesh::LIGHTMAP_SCALE;
+const int CWorldMesh::MAX_LIGHTMAP_SIZE;
+const uint32_t CWorldMesh::PLACEHOLDER_SIZE;
+const size_t CWorldMesh::WORD_BITS;
+
+bool CWorldMesh::Build( const CBSPFile& map )
+{
+	Clear();
+
+	size_t uiModels, uiFaces, uiTexInfos, uiSurfEdges, uiEdges, uiVertexes, uiLeafs, uiMarkSurfaces, uiLighting;
+
+	const auto pModels = map.GetLump<bsp::Model_t>( bsp::LUMP_MODELS, uiModels );
+	const auto pFaces = map.GetLump<bsp::Face_t>( bsp::LUMP_FACES, uiFaces );
+	const auto pTexInfos = map.GetLump<bsp::TexInfo_t>( bsp::LUMP_TEXINFO, uiTexInfos );
+	const auto pSurfEdges = map.GetLump<int32_t>( bsp::LUMP_SURFEDGES, uiSurfEdges );
+	const auto pEdges = map.GetLump<bsp::Edge_t>( bsp::LUMP_EDGES, uiEdges );
+	const auto pVertexes = map.GetLump<bsp::Vertex_t>( bsp::LUMP_VERTEXES, uiVertexes );
+	const auto pLeafs = map.GetLump<bsp::Leaf_t>( bsp::LUMP_LEAFS, uiLeafs );
+	const auto pMarkSurfaces = map.GetLump<uint16_t>( bsp::LUMP_MARKSURFACES, uiMarkSurfaces );
+	const auto pLighting = map.GetLumpData( bsp::LUMP_LIGHTING, uiLighting );
+
+	if( uiModels == 0 )
+		return false;
+
+	m_Textures.resize( map.GetTextureCount() );
+
+	for( size_t uiTexture = 0; uiTexture < m_Textures.size(); ++uiTexture )
+	{
+		LoadTexture( map, uiTexture, m_Textures[ uiTexture ] );
+
+		if( m_Textures[ uiTexture ].bPlaceholder )
+			++m_Stats.uiMissingTextures;
+	}
+
+	std::vector<uint32_t> firstLeafs( uiFaces, UINT32_MAX );
+
+	for( size_t uiLeaf = 0; uiLeaf < uiLeafs; ++uiLeaf )
+	{
+		const auto& leaf = pLeafs[ uiLeaf ];
+
+		for( size_t uiMark = 0; uiMark < leaf.nummarksurfaces; ++uiMark )
+		{
+			auto& uiFirstLeaf = firstLeafs[ pMarkSurfaces[ leaf.firstmarksurface + uiMark ] ];
+
+			uiFirstLeaf = std::min( uiFirstLeaf, static_cast<uint32_t>( uiLeaf ) );
+		}
+	}
+
+	const auto& world = pModels[ 0 ];
+
+	std::vector<BakeFace_t> faces;
+
+	faces.reserve( world.numfaces );
+
+	for( size_t uiFace = world.firstface; uiFace < static_cast<size_t>( world.firstface ) + world.numfaces; ++uiFace )
+	{
+		const auto& face = pFaces[ uiFace ];
+		const auto& texInfo = pTexInfos[ face.texinfo ];
+
+		if( face.numedges < 3 )
+			continue;
+
+		//The sky is drawn separately, if at all.
+		if( !strnicmp( m_Textures[ texInfo.miptex ].szName, "sky", 3 ) )
+		{
+			++m_Stats.uiSkippedFaces;
+			continue;
+		}
+
+		BakeFace_t bake{};
+
+		bake.uiFace = static_cast<uint32_t>( uiFace );
+		bake.uiTexture = static_cast<uint32_t>( texInfo.miptex );
+		bake.uiFirstLeaf = firstLeafs[ uiFace ];
+
+		//The lightmap covers the face's texture coordinates, in steps of LIGHTMAP_SCALE.
+		double flMins[ 2 ] = { 1e30, 1e30 };
+		double flMaxs[ 2 ] = { -1e30, -1e30 };
+
+		for( int iEdge = 0; iEdge < face.numedges; ++iEdge )
+		{
+			const int32_t iSurfEdge = pSurfEdges[ face.firstedge + iEdge ];
+
+			const auto& point = pVertexes[ iSurfEdge >= 0 ? pEdges[ iSurfEdge ].v[ 0 ] : pEdges[ -iSurfEdge ].v[ 1 ] ].point;
+
+			for( size_t uiAxis = 0; uiAxis < 2; ++uiAxis )
+			{
+				const double flValue = TextureCoordinate( texInfo, uiAxis, point );
+
+				flMins[ uiAxis ] = std::min( flMins[ uiAxis ], flValue );
+				flMaxs[ uiAxis ] = std::max( flMaxs[ uiAxis ], flValue );
+			}
+		}
+
+		for( size_t uiAxis = 0; uiAxis < 2; ++uiAxis )
+		{
+			const double flMin = std::floor( flMins[ uiAxis ] / LIGHTMAP_SCALE );
+			const double flMax = std::ceil( flMaxs[ uiAxis ] / LIGHTMAP_SCALE );
+
+			bake.flTextureMins[ uiAxis ] = static_cast<float>( flMin * LIGHTMAP_SCALE );
+
+			const double flSize = flMax - flMin + 1;
+
+			( uiAxis == 0 ? bake.iLightWidth : bake.iLightHeight ) = flSize <= MAX_LIGHTMAP_SIZE ? static_cast<int>( flSize ) : MAX_LIGHTMAP_SIZE + 1;
+		}
+
+		const size_t uiLuxelBytes = static_cast<size_t>( bake.iLightWidth ) * bake.iLightHeight * 3;
+
+		bake.bLightmap = !( texInfo.flags & TEX_SPECIAL ) &&
+			face.styles[ 0 ] != 255 && face.lightofs >= 0 &&
+			bake.iLightWidth <= MAX_LIGHTMAP_SIZE && bake.iLightHeight <= MAX_LIGHTMAP_SIZE &&
+			uiLuxelBytes <= uiLighting - face.lightofs;
+
+		if( !bake.bLightmap )
+			++m_Stats.uiFullbrightFaces;
+
+		faces.push_back( bake );
+	}
+
+	//Tallest lightmaps first, so the shelves waste as little as possible.
+	std::vector<BakeFace_t*> packOrder;
+
+	packOrder.reserve( faces.size() );
+
+	for( auto& face : faces )
+	{
+		if( face.bLightmap )
+			packOrder.push_back( &face );
+	}
+
+	std::stable_sort( packOrder.begin(), packOrder.end(),
+		[]( const BakeFace_t* pLHS, const BakeFace_t* pRHS )
+		{
+			return pLHS->iLightHeight > pRHS->iLightHeight;
+		}
+	);
+
+	std::vector<CAtlasPacker> packers;
+
+	const size_t uiPageBytes = static_cast<size_t>( LIGHTMAP_PAGE_SIZE ) * LIGHTMAP_PAGE_SIZE * 4;
+
+	//The first page always exists, for the fullbright block.
+	packers.emplace_back( LIGHTMAP_PAGE_SIZE, LIGHTMAP_PAGE_SIZE );
+	m_LightmapPages.emplace_back( uiPageBytes, 0 );
+
+	{
+		int iX, iY;
+
+		packers[ 0 ].Allocate( FULLBRIGHT_BLOCK_SIZE, FULLBRIGHT_BLOCK_SIZE, iX, iY );
+
+		for( int iRow = 0; iRow < FULLBRIGHT_BLOCK_SIZE; ++iRow )
+		{
+			memset( m_LightmapPages[ 0 ].data() + ( ( iY + iRow ) * LIGHTMAP_PAGE_SIZE + iX ) * 4, 255, FULLBRIGHT_BLOCK_SIZE * 4 );
+		}
+	}
+
+	for( auto pFace : packOrder )
+	{
+		size_t uiPage = 0;
+
+		for( ; uiPage < packers.size(); ++uiPage )
+		{
+			if( packers[ uiPage ].Allocate( pFace->iLightWidth, pFace->iLightHeight, pFace->iLightX, pFace->iLightY ) )
+				break;
+		}
+
+		if( uiPage == packers.size() )
+		{
+			packers.emplace_back( LIGHTMAP_PAGE_SIZE, LIGHTMAP_PAGE_SIZE );
+			m_LightmapPages.emplace_back( uiPageBytes, 0 );
+
+			packers.back().Allocate( pFace->iLightWidth, pFace->iLightHeight, pFace->iLightX, pFace->iLightY );
+		}
+
+		pFace->uiLightmapPage = static_cast<uint32_t>( uiPage );
+
+		//Only the first style is baked. Animated light styles would need their lightmaps rebuilt as they change.
+		const uint8_t* pLuxels = pLighting + pFaces[ pFace->uiFace ].lightofs;
+
+		auto& page = m_LightmapPages[ uiPage ];
+
+		for( int iRow = 0; iRow < pFace->iLightHeight; ++iRow )
+		{
+			uint8_t* pDest = page.data() + ( static_cast<size_t>( pFace->iLightY + iRow ) * LIGHTMAP_PAGE_SIZE + pFace->iLightX ) * 4;
+
+			for( int iColumn = 0; iColumn < pFace->iLightWidth; ++iColumn, pLuxels += 3, pDest += 4 )
+			{
+				pDest[ 0 ] = pLuxels[ 0 ];
+				pDest[ 1 ] = pLuxels[ 1 ];
+				pDest[ 2 ] = pLuxels[ 2 ];
+				pDest[ 3 ] = 255;
+			}
+		}
+	}
+
+	std::sort( faces.begin(), faces.end(),
+		[]( const BakeFace_t& lhs, const BakeFace_t& rhs )
+		{
+			return std::tie( lhs.uiTexture, lhs.uiLightmapPage, lhs.uiFirstLeaf, lhs.uiFace ) <
+				std::tie( rhs.uiTexture, rhs.uiLightmapPage, rhs.uiFirstLeaf, rhs.uiFace );
+		}
+	);
+
+	std::vector<uint32_t> meshFaces( uiFaces, NO_FACE );
+
+	m_Faces.reserve( faces.size() );
+
+	const float flPageScale = 1.0f / LIGHTMAP_PAGE_SIZE;
+
+	for( const auto& bake : faces )
+	{
+		const auto& face = pFaces[ bake.uiFace ];
+		const auto& texInfo = pTexInfos[ face.texinfo ];
+		const auto& texture = m_Textures[ bake.uiTexture ];
+
+		if( m_Batches.empty() || m_Batches.back().uiTexture != bake.uiTexture || m_Batches.back().uiLightmapPage != bake.uiLightmapPage )
+			m_Batches.push_back( { bake.uiTexture, bake.uiLightmapPage, static_cast<uint32_t>( m_Indices.size() ), 0 } );
+
+		const auto uiFirstVertex = static_cast<uint32_t>( m_Vertices.size() );
+
+		for( int iEdge = 0; iEdge < face.numedges; ++iEdge )
+		{
+			const int32_t iSurfEdge = pSurfEdges[ face.firstedge + iEdge ];
+
+			const auto& point = pVertexes[ iSurfEdge >= 0 ? pEdges[ iSurfEdge ].v[ 0 ] : pEdges[ -iSurfEdge ].v[ 1 ] ].point;
+
+			Vertex_t vertex;
+
+			memcpy( vertex.flPos, point, sizeof( vertex.flPos ) );
+
+			const float flS = TextureCoordinate( texInfo, 0, point );
+			const float flT = TextureCoordinate( texInfo, 1, point );
+
+			vertex.flTexCoord[ 0 ] = flS / texture.uiWidth;
+			vertex.flTexCoord[ 1 ] = flT / texture.uiHeight;
+
+			if( bake.bLightmap )
+			{
+				//Luxel centers are half a luxel in.
+				vertex.flLightCoord[ 0 ] = ( ( flS - bake.flTextureMins[ 0 ] ) / LIGHTMAP_SCALE + 0.5f + bake.iLightX ) * flPageScale;
+				vertex.flLightCoord[ 1 ] = ( ( flT - bake.flTextureMins[ 1 ] ) / LIGHTMAP_SCALE + 0.5f + bake.iLightY ) * flPageScale;
+			}
+			else
+			{
+				vertex.flLightCoord[ 0 ] = vertex.flLightCoord[ 1 ] = ( FULLBRIGHT_BLOCK_SIZE / 2 ) * flPageScale;
+			}
+
+			m_Vertices.push_back( vertex );
+		}
+
+		Face_t meshFace;
+
+		meshFace.uiBatch = static_cast<uint32_t>( m_Batches.size() - 1 );
+		meshFace.uiFirstIndex = static_cast<uint32_t>( m_Indices.size() );
+
+		//Faces are convex, so they're triangulated as fans.
+		for( int iVertex = 1; iVertex + 1 < face.numedges; ++iVertex )
+		{
+			m_Indices.push_back( uiFirstVertex );
+			m_Indices.push_back( uiFirstVertex + iVertex );
+			m_Indices.push_back( uiFirstVertex + iVertex + 1 );
+		}
+
+		meshFace.uiIndexCount = static_cast<uint32_t>( m_Indices.size() ) - meshFace.uiFirstIndex;
+
+		m_Batches.back().uiIndexCount += meshFace.uiIndexCount;
+
+		meshFaces[ bake.uiFace ] = static_cast<uint32_t>( m_Faces.size() );
+
+		m_Faces.push_back( meshFace );
+	}
+
+	m_Leafs.resize( uiLeafs );
+
+	for( size_t uiLeaf = 0; uiLeaf < uiLeafs; ++uiLeaf )
+	{
+		const auto& leaf = pLeafs[ uiLeaf ];
+
+		auto& meshLeaf = m_Leafs[ uiLeaf ];
+
+		for( size_t uiAxis = 0; uiAxis < 3; ++uiAxis )
+		{
+			meshLeaf.mins[ uiAxis ] = leaf.mins[ uiAxis ];
+			meshLeaf.maxs[ uiAxis ] = leaf.maxs[ uiAxis ];
+		}
+
+		meshLeaf.uiFirstFace = static_cast<uint32_t>( m_LeafFaces.size() );
+
+		for( size_t uiMark = 0; uiMark < leaf.nummarksurfaces; ++uiMark )
+		{
+			const uint32_t uiFace = meshFaces[ pMarkSurfaces[ leaf.firstmarksurface + uiMark ] ];
+
+			if( uiFace != NO_FACE )
+				m_LeafFaces.push_back( uiFace );
+		}
+
+		std::sort( m_LeafFaces.begin() + meshLeaf.uiFirstFace, m_LeafFaces.end() );
+
+		m_LeafFaces.erase( std::unique( m_LeafFaces.begin() + meshLeaf.uiFirstFace, m_LeafFaces.end() ), m_LeafFaces.end() );
+
+		meshLeaf.uiFaceCount = static_cast<uint32_t>( m_LeafFaces.size() ) - meshLeaf.uiFirstFace;
+	}
+
+	m_Stats.uiFaces = m_Faces.size();
+	m_Stats.uiTriangles = m_Indices.size() / 3;
+
+	return true;
+}
+
+void CWorldMesh::Clear()
+{
+	m_Vertices.clear();
+	m_Indices.clear();
+	m_Textures.clear();
+	m_Batches.clear();
+	m_LightmapPages.clear();
+	m_Faces.clear();
+	m_Leafs.clear();
+	m_LeafFaces.clear();
+	m_VisibleFaces.clear();
+
+	m_Stats = Stats_t();
+	m_DrawStats = DrawStats_t();
+}
+
+void CWorldMesh::BuildDrawList( const CInterestSets& sets, const size_t uiViewLeaf, const float* pflViewProjection, std::vector<DrawRange_t>& ranges )
+{
+	//Views outside the map see everything, like clients outside the map do.
+	const Word_t* const pRow = uiViewLeaf < sets.GetLeafCount() ? sets.GetLeafRow( uiViewLeaf ) : nullptr;
+
+	BuildDrawList( pRow, sets.GetLeafCount(), pflViewProjection, ranges );
+}
+
+void CWorldMesh::BuildDrawList( CVisibilityCache& cache, const size_t uiViewLeaf, const float* pflViewProjection, std::vector<DrawRange_t>& ranges )
+{
+	const Word_t* const pRow = uiViewLeaf < cache.GetLeafCount() ? cache.GetRow( uiViewLeaf ) : nullptr;
+
+	BuildDrawList( pRow, cache.GetLeafCount(), pflViewProjection, ranges );
+}
+
+void CWorldMesh::BuildDrawList( const Word_t* pVisibleLeafs, const size_t uiVisLeafCount, const float* pflViewProjection, std::vector<DrawRange_t>& ranges )
+{
+	ranges.clear();
+
+	m_DrawStats = DrawStats_t();
+
+	m_VisibleFaces.assign( ( m_Faces.size() + WORD_BITS - 1 ) / WORD_BITS, 0 );
+
+	float planes[ 6 ][ 4 ];
+
+	if( pflViewProjection )
+		GetFrustumPlanes( pflViewProjection, planes );
+
+	const size_t uiLeafCount = std::min( m_Leafs.size(), uiVisLeafCount );
+
+	for( size_t uiWord = 0; uiWord * WORD_BITS < uiLeafCount; ++uiWord )
+	{
+		Word_t uiBits = pVisibleLeafs ? pVisibleLeafs[ uiWord ] : ~Word_t( 0 );
+
+		const size_t uiRemaining = uiLeafCount - uiWord * WORD_BITS;
+
+		if( uiRemaining < WORD_BITS )
+			uiBits &= ( Word_t( 1 ) << uiRemaining ) - 1;
+
+		for( ; uiBits; uiBits &= uiBits - 1 )
+		{
+			const auto& leaf = m_Leafs[ uiWord * WORD_BITS + FindLowestBit( uiBits ) ];
+
+			if( leaf.uiFaceCount == 0 || ( pflViewProjection && !IsBoxInside( planes, leaf.mins, leaf.maxs ) ) )
+				continue;
+
+			++m_DrawStats.uiVisibleLeafs;
+
+			for( size_t uiIndex = 0; uiIndex < leaf.uiFaceCount; ++uiIndex )
+			{
+				const uint32_t uiFace = m_LeafFaces[ leaf.uiFirstFace + uiIndex ];
+
+				m_VisibleFaces[ uiFace / WORD_BITS ] |= Word_t( 1 ) << ( uiFace % WORD_BITS );
+			}
+		}
+	}
+
+	//Faces are numbered in index order, so scanning the bits yields sorted ranges, and faces next to each other in a batch merge.
+	for( size_t uiWord = 0; uiWord < m_VisibleFaces.size(); ++uiWord )
+	{
+		for( Word_t uiBits = m_VisibleFaces[ uiWord ]; uiBits; uiBits &= uiBits - 1 )
+		{
+			const auto& face = m_Faces[ uiWord * WORD_BITS + FindLowestBit( uiBits ) ];
+
+			++m_DrawStats.uiVisibleFaces;
+
+			if( !ranges.empty() && ranges.back().uiBatch == face.uiBatch && ranges.back().uiFirstIndex + ranges.back().uiIndexCount == face.uiFirstIndex )
+			{
+				ranges.back().uiIndexCount += face.uiIndexCount;
+				continue;
+			}
+
+			ranges.push_back( { face.uiBatch, face.uiFirstIndex, face.uiIndexCount } );
+		}
+	}
+
+	m_DrawStats.uiRanges = ranges.size();
+}
+
+void CWorldMesh::LoadTexture( const CBSPFile& map, const size_t uiIndex, Texture_t& texture )
+{
+	bsp::MipTex_t header;
+	size_t uiOffset;
+
+	const bool bStored = map.GetTexture( uiIndex, header, uiOffset );
+
+	if( bStored )
+	{
+		memcpy( texture.szName, header.name, sizeof( texture.szName ) );
+		texture.szName[ sizeof( texture.szName ) - 1 ] = '\0';
+	}
+	else
+	{
+		texture.szName[ 0 ] = '\0';
+	}
+
+	size_t uiLumpSize;
+
+	const uint8_t* const pLump = map.GetLumpData( bsp::LUMP_TEXTURES, uiLumpSize );
+
+	//The palette follows the last mip level: a count, then RGB colors.
+	const uint64_t uiPalette = bStored
+		? static_cast<uint64_t>( uiOffset ) + header.offsets[ bsp::MIPLEVELS - 1 ] + static_cast<uint64_t>( header.width >> 3 ) * ( header.height >> 3 ) + sizeof( uint16_t )
+		: 0;
+
+	bool bEmbedded = bStored && header.width > 0 && header.height > 0 && header.width <= 4096 && header.height <= 4096 &&
+		uiPalette + 256 * 3 <= uiLumpSize;
+
+	for( size_t uiMip = 0; bEmbedded && uiMip < bsp::MIPLEVELS; ++uiMip )
+	{
+		//Mip levels that are in the map were checked to be inside the lump when it was loaded.
+		bEmbedded = header.offsets[ uiMip ] != 0;
+	}
+
+	if( !bEmbedded )
+	{
+		//Textures in WAD files get a checkerboard, stretched over the size the map says they have.
+		texture.uiWidth = bStored && header.width > 0 ? header.width : PLACEHOLDER_SIZE;
+		texture.uiHeight = bStored && header.height > 0 ? header.height : PLACEHOLDER_SIZE;
+		texture.uiMipLevels = 1;
+		texture.bPlaceholder = true;
+
+		texture.pixels.resize( PLACEHOLDER_SIZE * PLACEHOLDER_SIZE * 4 );
+
+		for( uint32_t uiY = 0; uiY < PLACEHOLDER_SIZE; ++uiY )
+		{
+			for( uint32_t uiX = 0; uiX < PLACEHOLDER_SIZE; ++uiX )
+			{
+				const uint8_t ubValue = ( ( uiX / ( PLACEHOLDER_SIZE / 2 ) ) ^ ( uiY / ( PLACEHOLDER_SIZE / 2 ) ) ) ? 160 : 96;
+
+				uint8_t* pPixel = texture.pixels.data() + ( uiY * PLACEHOLDER_SIZE + uiX ) * 4;
+
+				pPixel[ 0 ] = pPixel[ 1 ] = pPixel[ 2 ] = ubValue;
+				pPixel[ 3 ] = 255;
+			}
+		}
+
+		return;
+	}
+
+	texture.uiWidth = header.width;
+	texture.uiHeight = header.height;
+	texture.uiMipLevels = bsp::MIPLEVELS;
+	texture.bAlphaTest = texture.szName[ 0 ] == '{';
+
+	const uint8_t* const pPalette = pLump + uiPalette;
+
+	size_t uiPixels = 0;
+
+	for( size_t uiMip = 0; uiMip < bsp::MIPLEVELS; ++uiMip )
+	{
+		uiPixels += static_cast<size_t>( std::max( 1u, header.width >> uiMip ) ) * std::max( 1u, header.height >> uiMip );
+	}
+
+	texture.pixels.resize( uiPixels * 4 );
+
+	uint8_t* pDest = texture.pixels.data();
+
+	for( size_t uiMip = 0; uiMip < bsp::MIPLEVELS; ++uiMip )
+	{
+		const size_t uiMipPixels = static_cast<size_t>( std::max( 1u, header.width >> uiMip ) ) * std::max( 1u, header.height >> uiMip );
+
+		const uint8_t* pSource = pLump + uiOffset + header.offsets[ uiMip ];
+
+		//Sizes that aren't a multiple of 8 have fewer stored pixels than the rounded up levels; the rest stay black.
+		const size_t uiStored = static_cast<size_t>( header.width >> uiMip ) * ( header.height >> uiMip );
+
+		for( size_t uiPixel = 0; uiPixel < uiStored; ++uiPixel, pDest += 4 )
+		{
+			const uint8_t ubIndex = pSource[ uiPixel ];
+
+			if( texture.bAlphaTest && ubIndex == 255 )
+			{
+				pDest[ 0 ] = pDest[ 1 ] = pDest[ 2 ] = pDest[ 3 ] = 0;
+				continue;
+			}
+
+			pDest[ 0 ] = pPalette[ ubIndex * 3 ];
+			pDest[ 1 ] = pPalette[ ubIndex * 3 + 1 ];
+			pDest[ 2 ] = pPalette[ ubIndex * 3 + 2 ];
+			pDest[ 3 ] = 255;
+		}
+
+		pDest += ( uiMipPixels - uiStored ) * 4;
+	}
+}
@@ -0,0 +1,269 @@
+#ifndef ENGINE_CWORLDMESH_H
+#define ENGINE_CWORLDMESH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "MemoryTracking.h"
+
+#include "BSPFile.h"
+
+class CBSPFile;
+class CInterestSets;
+class CVisibilityCache;
+
+/**
+*	A map's world geometry, baked once when the map loads so it can be drawn from static buffers.
+*	Every face of the world model is triangulated into one vertex and index buffer. Faces are ordered by texture and lightmap page,
+*	then by the first leaf that contains them, so the faces of a batch that are visible together tend to be next to each other.
+*	Lightmaps are packed into atlas pages, so faces with different lightmaps can be drawn in one call.
+*	Each frame, the faces of the visible leafs are collected into index ranges per batch, merging ranges that are next to each other,
+*	so the world is drawn with a handful of multi-draw calls instead of one per polygon.
+*	Building doesn't touch OpenGL, so it can happen on any thread. CWorldRenderer uploads the result.
+*/
+class CWorldMesh final
+{
+public:
+	/**
+	*	Size of lightmap atlas pages, in luxels.
+	*/
+	static const int LIGHTMAP_PAGE_SIZE = 1024;
+
+	/**
+	*	Texels per luxel.
+	*/
+	static const int LIGHTMAP_SCALE = 16;
+
+	/**
+	*	Faces with lightmaps larger than this along either axis are drawn fullbright. GoldSource's limit is 17 luxels.
+	*/
+	static const int MAX_LIGHTMAP_SIZE = 64;
+
+	/**
+	*	Size of the placeholder for textures that are stored in WAD files.
+	*/
+	static const uint32_t PLACEHOLDER_SIZE = 16;
+
+	struct Vertex_t
+	{
+		float flPos[ 3 ];
+
+		/**
+		*	Texture coordinates, in texture widths.
+		*/
+		float flTexCoord[ 2 ];
+
+		/**
+		*	Coordinates in the batch's lightmap page.
+		*/
+		float flLightCoord[ 2 ];
+	};
+
+	struct Texture_t
+	{
+		char szName[ bsp::MAX_TEXTURE_NAME ];
+
+		/**
+		*	Size that texture coordinates are relative to.
+		*/
+		uint32_t uiWidth = 0;
+		uint32_t uiHeight = 0;
+
+		/**
+		*	RGBA pixels of each mip level, one after another. Mip level 0 is uiWidth by uiHeight, except for placeholders,
+		*	which are PLACEHOLDER_SIZE square.
+		*/
+		TrackedVector_t<uint8_t, MemoryTag::RENDER> pixels;
+
+		uint32_t uiMipLevels = 0;
+
+		/**
+		*	Whether palette index 255 is transparent, for textures whose names start with '{'.
+		*/
+		bool bAlphaTest = false;
+
+		/**
+		*	Whether the pixels are a placeholder, because the texture isn't stored in the map.
+		*/
+		bool bPlaceholder = false;
+	};
+
+	/**
+	*	Faces that share a texture and a lightmap page. Its faces' indices are contiguous.
+	*/
+	struct Batch_t
+	{
+		uint32_t uiTexture;
+		uint32_t uiLightmapPage;
+
+		uint32_t uiFirstIndex;
+		uint32_t uiIndexCount;
+	};
+
+	/**
+	*	Indices to draw with a batch.
+	*/
+	struct DrawRange_t
+	{
+		uint32_t uiBatch;
+
+		uint32_t uiFirstIndex;
+		uint32_t uiIndexCount;
+	};
+
+	struct Stats_t
+	{
+		size_t uiFaces = 0;
+		size_t uiTriangles = 0;
+
+		/**
+		*	Sky faces, which aren't drawn.
+		*/
+		size_t uiSkippedFaces = 0;
+
+		/**
+		*	Faces without a usable lightmap, which are drawn fullbright.
+		*/
+		size_t uiFullbrightFaces = 0;
+
+		/**
+		*	Textures that aren't stored in the map, and were replaced with a placeholder.
+		*/
+		size_t uiMissingTextures = 0;
+	};
+
+	struct DrawStats_t
+	{
+		size_t uiVisibleLeafs = 0;
+		size_t uiVisibleFaces = 0;
+
+		/**
+		*	Index ranges after merging. Without merging there is one per face.
+		*/
+		size_t uiRanges = 0;
+	};
+
+public:
+	CWorldMesh() = default;
+	~CWorldMesh() = default;
+
+	/**
+	*	Bakes a map's world model. The map isn't referenced afterwards.
+	*	@return Whether the map has a world model.
+	*/
+	bool Build( const CBSPFile& map );
+
+	void Clear();
+
+	bool IsEmpty() const { return m_Indices.empty(); }
+
+	const TrackedVector_t<Vertex_t, MemoryTag::RENDER>& GetVertices() const { return m_Vertices; }
+	const TrackedVector_t<uint32_t, MemoryTag::RENDER>& GetIndices() const { return m_Indices; }
+
+	const std::vector<Texture_t>& GetTextures() const { return m_Textures; }
+	const std::vector<Batch_t>& GetBatches() const { return m_Batches; }
+
+	/**
+	*	@return RGBA luxels of each lightmap page, LIGHTMAP_PAGE_SIZE squared.
+	*/
+	const std::vector<TrackedVector_t<uint8_t, MemoryTag::RENDER>>& GetLightmapPages() const { return m_LightmapPages; }
+
+	size_t GetLeafCount() const { return m_Leafs.size(); }
+
+	const Stats_t& GetStats() const { return m_Stats; }
+
+	/**
+	*	Collects the index ranges of the faces in the leafs that are visible from a leaf and inside the view frustum.
+	*	Ranges are ordered by batch, and by index within a batch.
+	*	@param sets Visibility of the same map, as loaded by CMapVisibility.
+	*	@param uiViewLeaf Leaf the view is in. Leaf 0 and leafs outside the map see every leaf.
+	*	@param pflViewProjection Column major view projection matrix, or null to skip frustum culling.
+	*	@param[ out ] ranges Ranges to draw.
+	*/
+	void BuildDrawList( const CInterestSets& sets, const size_t uiViewLeaf, const float* pflViewProjection, std::vector<DrawRange_t>& ranges );
+
+	/**
+	*	@copydoc BuildDrawList( const CInterestSets&, const size_t, const float*, std::vector<DrawRange_t>& )
+	*	Only the view leaf's row is decompressed, and only if the cache doesn't have it already.
+	*	@param cache Visibility of the same map, as loaded by CMapVisibility.
+	*/
+	void BuildDrawList( CVisibilityCache& cache, const size_t uiViewLeaf, const float* pflViewProjection, std::vector<DrawRange_t>& ranges );
+
+	/**
+	*	@return Statistics of the last draw list.
+	*/
+	const DrawStats_t& GetDrawStats() const { return m_DrawStats; }
+
+private:
+	using Word_t = uint64_t;
+
+	static const size_t WORD_BITS = 64;
+
+	/**
+	*	Builds a draw list from the leafs visible from the view.
+	*	@param pVisibleLeafs Row of uiVisLeafCount leaf bits, or null if every leaf is visible.
+	*/
+	void BuildDrawList( const Word_t* pVisibleLeafs, const size_t uiVisLeafCount, const float* pflViewProjection, std::vector<DrawRange_t>& ranges );
+
+	struct Face_t
+	{
+		uint32_t uiBatch;
+
+		uint32_t uiFirstIndex;
+		uint32_t uiIndexCount;
+	};
+
+	struct Leaf_t
+	{
+		float mins[ 3 ];
+		float maxs[ 3 ];
+
+		/**
+		*	Range of the leaf's faces in m_LeafFaces.
+		*/
+		uint32_t uiFirstFace;
+		uint32_t uiFaceCount;
+	};
+
+	/**
+	*	Decodes a texture stored in the map, or creates a placeholder for it.
+	*/
+	void LoadTexture( const CBSPFile& map, const size_t uiIndex, Texture_t& texture );
+
+private:
+	TrackedVector_t<Vertex_t, MemoryTag::RENDER> m_Vertices;
+	TrackedVector_t<uint32_t, MemoryTag::RENDER> m_Indices;
+
+	std::vector<Texture_t> m_Textures;
+	std::vector<Batch_t> m_Batches;
+
+	std::vector<TrackedVector_t<uint8_t, MemoryTag::RENDER>> m_LightmapPages;
+
+	/**
+	*	Faces in the order their indices are stored.
+	*/
+	std::vector<Face_t> m_Faces;
+
+	std::vector<Leaf_t> m_Leafs;
+
+	/**
+	*	Faces of each leaf, in increasing order.
+	*/
+	std::vector<uint32_t> m_LeafFaces;
+
+	Stats_t m_Stats;
+
+	/**
+	*	Faces that are visible, as bits. Scanned in order, so the ranges come out sorted.
+	*/
+	std::vector<Word_t> m_VisibleFaces;
+
+	DrawStats_t m_DrawStats;
+
+private:
+	CWorldMesh( const CWorldMesh& ) = delete;
+	CWorldMesh& operator=( const CWorldMesh& ) = delete;
+};
+
+#endif //ENGINE_CWORLDMESH_H
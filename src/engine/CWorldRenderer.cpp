@@ -0,0 +1,464 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Logging.h"
+
+#include "CProgramCache.h"
+#include "GLUtils.h"
+
+#include "CWorldRenderer.h"
+
+namespace
+{
+const char WORLD_VERTEX_SHADER[] =
+	"#version 330 core\n"
+	"uniform mat4 viewProjection;\n"
+	"layout( location = 0 ) in vec3 position;\n"
+	"layout( location = 1 ) in vec2 texCoord;\n"
+	"layout( location = 2 ) in vec2 lightCoord;\n"
+	"out vec2 vTexCoord;\n"
+	"out vec2 vLightCoord;\n"
+	"void main()\n"
+	"{\n"
+	"	gl_Position = viewProjection * vec4( position, 1.0 );\n"
+	"	vTexCoord = texCoord;\n"
+	"	vLightCoord = lightCoord;\n"
+	"}\n";
+
+//Same as modulating the texture with the lightmap on the second texture unit, with the alpha test for '{' textures.
+const char WORLD_FRAGMENT_SHADER[] =
+	"#version 330 core\n"
+	"uniform sampler2D tex;\n"
+	"uniform sampler2D lightmap;\n"
+	"uniform bool alphaTest;\n"
+	"in vec2 vTexCoord;\n"
+	"in vec2 vLightCoord;\n"
+	"out vec4 fragColor;\n"
+	"void main()\n"
+	"{\n"
+	"	vec4 color = texture( tex, vTexCoord );\n"
+	"	if( alphaTest && color.a < 0.5 )\n"
+	"		discard;\n"
+	"	fragColor = vec4( color.rgb * texture( lightmap, vLightCoord ).rgb, 1.0 );\n"
+	"}\n";
+
+const GLint TEXTURE_UNIT = 0;
+const GLint LIGHTMAP_UNIT = 1;
+
+const GLfloat ALPHA_TEST_REFERENCE = 0.5f;
+}
+
+bool CWorldRenderer::Initialize( gl::CStateCache& state, CProgramCache& programCache, const bool bCoreProfile )
+{
+	m_pState = &state;
+
+	m_bCoreProfile = bCoreProfile;
+
+	//Core in OpenGL 4.3. Without it, ranges are passed to glMultiDrawElements from client memory.
+	m_bMultiDrawIndirect = GLEW_VERSION_4_3 || GLEW_ARB_multi_draw_indirect;
+
+	if( !m_bCoreProfile )
+		return true;
+
+	m_Program = programCache.CreateProgram( "world", WORLD_VERTEX_SHADER, WORLD_FRAGMENT_SHADER );
+
+	if( !m_Program )
+		return false;
+
+	m_iViewProjectionLocation = glGetUniformLocation( m_Program, "viewProjection" );
+	m_iAlphaTestLocation = glGetUniformLocation( m_Program, "alphaTest" );
+
+	glUseProgram( m_Program );
+
+	glUniform1i( glGetUniformLocation( m_Program, "tex" ), TEXTURE_UNIT );
+	glUniform1i( glGetUniformLocation( m_Program, "lightmap" ), LIGHTMAP_UNIT );
+	glUniform1i( m_iAlphaTestLocation, 0 );
+
+	m_bAlphaTest = false;
+
+	glUseProgram( 0 );
+
+	return true;
+}
+
+void CWorldRenderer::Shutdown()
+{
+	Unload();
+
+	if( m_IndirectBuffer )
+	{
+		glDeleteBuffers( 1, &m_IndirectBuffer );
+		m_IndirectBuffer = 0;
+		m_uiIndirectCapacity = 0;
+	}
+
+	if( m_Program )
+	{
+		glUseProgram( 0 );
+		glDeleteProgram( m_Program );
+		m_Program = 0;
+	}
+
+	m_iViewProjectionLocation = -1;
+	m_iAlphaTestLocation = -1;
+
+	m_Commands.clear();
+	m_Counts.clear();
+	m_Offsets.clear();
+}
+
+bool CWorldRenderer::Load( const CWorldMesh& mesh )
+{
+	Unload();
+
+	//Vertex buffers are core since 1.5, multitexturing since 1.3.
+	if( !GLEW_VERSION_1_5 )
+	{
+		Warning( "CWorldRenderer: Drawing the world requires OpenGL 1.5\n" );
+		return false;
+	}
+
+	if( mesh.IsEmpty() )
+		return false;
+
+	const auto& vertices = mesh.GetVertices();
+	const auto& indices = mesh.GetIndices();
+
+	glGenBuffers( 1, &m_VertexBuffer );
+	glGenBuffers( 1, &m_IndexBuffer );
+
+	m_pState->BindBuffer( GL_ARRAY_BUFFER, m_VertexBuffer );
+	glBufferData( GL_ARRAY_BUFFER, vertices.size() * sizeof( CWorldMesh::Vertex_t ), vertices.data(), GL_STATIC_DRAW );
+
+	if( m_bCoreProfile )
+	{
+		//The index buffer binding is part of the vertex array object.
+		glGenVertexArrays( 1, &m_VertexArray );
+		glBindVertexArray( m_VertexArray );
+
+		glEnableVertexAttribArray( 0 );
+		glEnableVertexAttribArray( 1 );
+		glEnableVertexAttribArray( 2 );
+
+		glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, sizeof( CWorldMesh::Vertex_t ), reinterpret_cast<const void*>( offsetof( CWorldMesh::Vertex_t, flPos ) ) );
+		glVertexAttribPointer( 1, 2, GL_FLOAT, GL_FALSE, sizeof( CWorldMesh::Vertex_t ), reinterpret_cast<const void*>( offsetof( CWorldMesh::Vertex_t, flTexCoord ) ) );
+		glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, sizeof( CWorldMesh::Vertex_t ), reinterpret_cast<const void*>( offsetof( CWorldMesh::Vertex_t, flLightCoord ) ) );
+	}
+
+	glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_IndexBuffer );
+	glBufferData( GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof( uint32_t ), indices.data(), GL_STATIC_DRAW );
+
+	if( m_bCoreProfile )
+		glBindVertexArray( 0 );
+	else
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+	//Textures are uploaded from client memory.
+	if( GLEW_VERSION_2_1 || GLEW_ARB_pixel_buffer_object )
+		m_pState->BindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+
+	glPixelStorei( GL_UNPACK_ALIGNMENT, 1 );
+
+	const auto& textures = mesh.GetTextures();
+
+	m_Textures.resize( textures.size() );
+
+	glGenTextures( static_cast<GLsizei>( m_Textures.size() ), m_Textures.data() );
+
+	for( size_t uiIndex = 0; uiIndex < textures.size(); ++uiIndex )
+	{
+		const auto& texture = textures[ uiIndex ];
+
+		m_pState->BindTexture( m_Textures[ uiIndex ] );
+
+		GLsizei iWidth = static_cast<GLsizei>( texture.bPlaceholder ? CWorldMesh::PLACEHOLDER_SIZE : texture.uiWidth );
+		GLsizei iHeight = static_cast<GLsizei>( texture.bPlaceholder ? CWorldMesh::PLACEHOLDER_SIZE : texture.uiHeight );
+
+		const uint8_t* pPixels = texture.pixels.data();
+
+		for( uint32_t uiLevel = 0; uiLevel < texture.uiMipLevels; ++uiLevel )
+		{
+			glTexImage2D( GL_TEXTURE_2D, static_cast<GLint>( uiLevel ), GL_RGBA, iWidth, iHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, pPixels );
+
+			pPixels += iWidth * iHeight * 4;
+
+			iWidth = std::max( iWidth / 2, 1 );
+			iHeight = std::max( iHeight / 2, 1 );
+		}
+
+		//The map only stores a few mip levels, so the rest don't need to exist for the texture to be complete.
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>( texture.uiMipLevels - 1 ) );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, texture.uiMipLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT );
+	}
+
+	const auto& pages = mesh.GetLightmapPages();
+
+	m_Lightmaps.resize( pages.size() );
+
+	glGenTextures( static_cast<GLsizei>( m_Lightmaps.size() ), m_Lightmaps.data() );
+
+	for( size_t uiIndex = 0; uiIndex < pages.size(); ++uiIndex )
+	{
+		m_pState->BindTexture( m_Lightmaps[ uiIndex ] );
+
+		glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, CWorldMesh::LIGHTMAP_PAGE_SIZE, CWorldMesh::LIGHTMAP_PAGE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE, pages[ uiIndex ].data() );
+
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+		glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
+	}
+
+	m_Batches.reserve( mesh.GetBatches().size() );
+
+	for( const auto& batch : mesh.GetBatches() )
+	{
+		m_Batches.push_back( { m_Textures[ batch.uiTexture ], m_Lightmaps[ batch.uiLightmapPage ], textures[ batch.uiTexture ].bAlphaTest } );
+	}
+
+	if( m_bMultiDrawIndirect && !m_IndirectBuffer )
+		glGenBuffers( 1, &m_IndirectBuffer );
+
+	return true;
+}
+
+void CWorldRenderer::Unload()
+{
+	m_Batches.clear();
+
+	for( auto texture : m_Textures )
+	{
+		m_pState->TextureDeleted( texture );
+	}
+
+	for( auto texture : m_Lightmaps )
+	{
+		m_pState->TextureDeleted( texture );
+	}
+
+	if( !m_Textures.empty() )
+		glDeleteTextures( static_cast<GLsizei>( m_Textures.size() ), m_Textures.data() );
+
+	if( !m_Lightmaps.empty() )
+		glDeleteTextures( static_cast<GLsizei>( m_Lightmaps.size() ), m_Lightmaps.data() );
+
+	m_Textures.clear();
+	m_Lightmaps.clear();
+
+	m_BoundLightmap = 0;
+
+	if( m_VertexArray )
+	{
+		glBindVertexArray( 0 );
+		glDeleteVertexArrays( 1, &m_VertexArray );
+		m_VertexArray = 0;
+	}
+
+	if( m_IndexBuffer )
+	{
+		glDeleteBuffers( 1, &m_IndexBuffer );
+		m_IndexBuffer = 0;
+	}
+
+	if( m_VertexBuffer )
+	{
+		glDeleteBuffers( 1, &m_VertexBuffer );
+		m_pState->BufferDeleted( m_VertexBuffer );
+		m_VertexBuffer = 0;
+	}
+}
+
+void CWorldRenderer::Draw( const int iWidth, const int iHeight, const float* pflViewProjection, const CWorldMesh::DrawRange_t* pRanges, const size_t uiCount )
+{
+	if( !IsLoaded() || !uiCount )
+		return;
+
+	m_pState->Viewport( 0, 0, iWidth, iHeight );
+
+	m_pState->SetEnabled( GL_DEPTH_TEST, true );
+	glDepthFunc( GL_LEQUAL );
+	glDepthMask( GL_TRUE );
+
+	//Map polygons are wound clockwise when seen from the front.
+	m_pState->SetEnabled( GL_CULL_FACE, true );
+	glFrontFace( GL_CW );
+	glCullFace( GL_BACK );
+
+	if( m_bCoreProfile )
+	{
+		glUseProgram( m_Program );
+		glBindVertexArray( m_VertexArray );
+
+		glUniformMatrix4fv( m_iViewProjectionLocation, 1, GL_FALSE, pflViewProjection );
+	}
+	else
+	{
+		glMatrixMode( GL_PROJECTION );
+		glPushMatrix();
+		glLoadMatrixf( pflViewProjection );
+		glMatrixMode( GL_MODELVIEW );
+
+		m_pState->BindBuffer( GL_ARRAY_BUFFER, m_VertexBuffer );
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, m_IndexBuffer );
+
+		//Lighting comes from the lightmap, not vertex colors.
+		m_pState->SetEnabled( GL_COLOR_ARRAY, false );
+		glColor4ub( 255, 255, 255, 255 );
+
+		m_pState->SetEnabled( GL_VERTEX_ARRAY, true );
+		m_pState->SetEnabled( GL_TEXTURE_COORD_ARRAY, true );
+
+		glVertexPointer( 3, GL_FLOAT, sizeof( CWorldMesh::Vertex_t ), reinterpret_cast<const void*>( offsetof( CWorldMesh::Vertex_t, flPos ) ) );
+		glTexCoordPointer( 2, GL_FLOAT, sizeof( CWorldMesh::Vertex_t ), reinterpret_cast<const void*>( offsetof( CWorldMesh::Vertex_t, flTexCoord ) ) );
+
+		//The state cache only tracks the first texture unit, so the lightmap unit is set up directly, and turned off again afterwards.
+		glClientActiveTexture( GL_TEXTURE0 + LIGHTMAP_UNIT );
+		glEnableClientState( GL_TEXTURE_COORD_ARRAY );
+		glTexCoordPointer( 2, GL_FLOAT, sizeof( CWorldMesh::Vertex_t ), reinterpret_cast<const void*>( offsetof( CWorldMesh::Vertex_t, flLightCoord ) ) );
+		glClientActiveTexture( GL_TEXTURE0 );
+
+		glActiveTexture( GL_TEXTURE0 + LIGHTMAP_UNIT );
+		glEnable( GL_TEXTURE_2D );
+		glTexEnvi( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
+		glActiveTexture( GL_TEXTURE0 );
+
+		glAlphaFunc( GL_GEQUAL, ALPHA_TEST_REFERENCE );
+	}
+
+	if( m_bMultiDrawIndirect )
+	{
+		m_Commands.clear();
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			m_Commands.push_back( { pRanges[ uiIndex ].uiIndexCount, 1, pRanges[ uiIndex ].uiFirstIndex, 0, 0 } );
+		}
+
+		const size_t uiSize = m_Commands.size() * sizeof( DrawCommand_t );
+
+		glBindBuffer( GL_DRAW_INDIRECT_BUFFER, m_IndirectBuffer );
+
+		//Orphan the previous contents so the driver doesn't have to wait for draws that still use them.
+		if( uiSize > m_uiIndirectCapacity )
+			m_uiIndirectCapacity = uiSize * 2;
+
+		glBufferData( GL_DRAW_INDIRECT_BUFFER, m_uiIndirectCapacity, nullptr, GL_STREAM_DRAW );
+		glBufferSubData( GL_DRAW_INDIRECT_BUFFER, 0, uiSize, m_Commands.data() );
+	}
+
+	//Ranges are ordered by batch, so each batch is drawn once.
+	for( size_t uiFirst = 0; uiFirst < uiCount; )
+	{
+		size_t uiEnd = uiFirst + 1;
+
+		while( uiEnd < uiCount && pRanges[ uiEnd ].uiBatch == pRanges[ uiFirst ].uiBatch )
+			++uiEnd;
+
+		DrawBatch( pRanges, uiFirst, uiEnd );
+
+		uiFirst = uiEnd;
+	}
+
+	if( m_bMultiDrawIndirect )
+		glBindBuffer( GL_DRAW_INDIRECT_BUFFER, 0 );
+
+	SetAlphaTest( false );
+
+	if( m_bCoreProfile )
+	{
+		glBindVertexArray( 0 );
+		glUseProgram( 0 );
+	}
+	else
+	{
+		glActiveTexture( GL_TEXTURE0 + LIGHTMAP_UNIT );
+		glDisable( GL_TEXTURE_2D );
+		glActiveTexture( GL_TEXTURE0 );
+
+		glClientActiveTexture( GL_TEXTURE0 + LIGHTMAP_UNIT );
+		glDisableClientState( GL_TEXTURE_COORD_ARRAY );
+		glClientActiveTexture( GL_TEXTURE0 );
+
+		glBindBuffer( GL_ELEMENT_ARRAY_BUFFER, 0 );
+
+		glMatrixMode( GL_PROJECTION );
+		glPopMatrix();
+		glMatrixMode( GL_MODELVIEW );
+	}
+}
+
+void CWorldRenderer::TakeStats( Stats_t& stats )
+{
+	stats = m_Stats;
+
+	m_Stats = Stats_t();
+}
+
+void CWorldRenderer::DrawBatch( const CWorldMesh::DrawRange_t* pRanges, const size_t uiFirst, const size_t uiEnd )
+{
+	const auto& batch = m_Batches[ pRanges[ uiFirst ].uiBatch ];
+
+	m_pState->BindTexture( batch.texture );
+
+	if( batch.lightmap != m_BoundLightmap )
+	{
+		glActiveTexture( GL_TEXTURE0 + LIGHTMAP_UNIT );
+		glBindTexture( GL_TEXTURE_2D, batch.lightmap );
+		glActiveTexture( GL_TEXTURE0 );
+
+		m_BoundLightmap = batch.lightmap;
+	}
+
+	SetAlphaTest( batch.bAlphaTest );
+
+	const size_t uiDrawCount = uiEnd - uiFirst;
+
+	for( size_t uiIndex = uiFirst; uiIndex < uiEnd; ++uiIndex )
+	{
+		m_Stats.uiTriangles += pRanges[ uiIndex ].uiIndexCount / 3;
+	}
+
+	if( m_bMultiDrawIndirect )
+	{
+		glMultiDrawElementsIndirect( GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<const void*>( uiFirst * sizeof( DrawCommand_t ) ), static_cast<GLsizei>( uiDrawCount ), 0 );
+	}
+	else
+	{
+		m_Counts.clear();
+		m_Offsets.clear();
+
+		for( size_t uiIndex = uiFirst; uiIndex < uiEnd; ++uiIndex )
+		{
+			m_Counts.push_back( static_cast<GLsizei>( pRanges[ uiIndex ].uiIndexCount ) );
+			m_Offsets.push_back( reinterpret_cast<const void*>( static_cast<size_t>( pRanges[ uiIndex ].uiFirstIndex ) * sizeof( uint32_t ) ) );
+		}
+
+		glMultiDrawElements( GL_TRIANGLES, m_Counts.data(), GL_UNSIGNED_INT, m_Offsets.data(), static_cast<GLsizei>( uiDrawCount ) );
+	}
+
+	++m_Stats.uiDrawCalls;
+}
+
+void CWorldRenderer::SetAlphaTest( const bool bAlphaTest )
+{
+	if( bAlphaTest == m_bAlphaTest )
+		return;
+
+	if( m_bCoreProfile )
+	{
+		glUniform1i( m_iAlphaTestLocation, bAlphaTest ? 1 : 0 );
+	}
+	else if( bAlphaTest )
+	{
+		glEnable( GL_ALPHA_TEST );
+	}
+	else
+	{
+		glDisable( GL_ALPHA_TEST );
+	}
+
+	m_bAlphaTest = bAlphaTest;
+}
@@ -0,0 +1,146 @@
+#ifndef ENGINE_CWORLDRENDERER_H
+#define ENGINE_CWORLDRENDERER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "MemoryTracking.h"
+
+#include "CWorldMesh.h"
+
+class CProgramCache;
+
+namespace gl
+{
+class CStateCache;
+}
+
+/**
+*	Draws a CWorldMesh from static vertex and index buffers, with a texture and a lightmap page per batch.
+*	Each batch's ranges are drawn with one glMultiDrawElementsIndirect call if ARB_multi_draw_indirect is available,
+*	with one glMultiDrawElements call otherwise, so the number of draw calls depends on the number of visible batches, not faces.
+*	With a core profile context the world is drawn with a shader and its own vertex array object.
+*	Otherwise the fixed function pipeline is used, with the lightmap modulating the texture on the second texture unit.
+*	Leaves the quad batch's program and vertex array unbound; call CQuadBatch::Bind afterwards.
+*	Must only be used on the thread that owns the OpenGL context.
+*/
+class CWorldRenderer final
+{
+public:
+	struct Stats_t
+	{
+		size_t uiTriangles = 0;
+		size_t uiDrawCalls = 0;
+	};
+
+public:
+	CWorldRenderer() = default;
+
+	/**
+	*	@param state State cache that all state changes go through.
+	*	@param programCache Cache that the shaders are created through.
+	*	@param bCoreProfile Whether the context is a core profile context.
+	*	@return Whether the shaders could be created, if they're needed.
+	*	Leaves no program in use, like Draw.
+	*/
+	bool Initialize( gl::CStateCache& state, CProgramCache& programCache, const bool bCoreProfile );
+
+	void Shutdown();
+
+	bool IsLoaded() const { return m_VertexBuffer != 0; }
+
+	/**
+	*	Uploads a world, replacing the current one. The mesh isn't referenced afterwards.
+	*	@return Whether the world can be drawn. Needs vertex buffers and multitexturing.
+	*/
+	bool Load( const CWorldMesh& mesh );
+
+	void Unload();
+
+	/**
+	*	Draws ranges of the world with depth testing and back face culling.
+	*	@param pflViewProjection Column major view projection matrix.
+	*	@param pRanges Ranges from CWorldMesh::BuildDrawList, ordered by batch.
+	*/
+	void Draw( const int iWidth, const int iHeight, const float* pflViewProjection, const CWorldMesh::DrawRange_t* pRanges, const size_t uiCount );
+
+	/**
+	*	Gets the statistics since they were last reset, and resets them.
+	*/
+	void TakeStats( Stats_t& stats );
+
+private:
+	/**
+	*	Layout of the commands read by glMultiDrawElementsIndirect.
+	*/
+	struct DrawCommand_t
+	{
+		GLuint count;
+		GLuint instanceCount;
+		GLuint firstIndex;
+		GLint baseVertex;
+		GLuint baseInstance;
+	};
+
+	struct Batch_t
+	{
+		GLuint texture;
+		GLuint lightmap;
+
+		bool bAlphaTest;
+	};
+
+	/**
+	*	Draws the ranges [ uiFirst, uiEnd ), which all use the same batch.
+	*/
+	void DrawBatch( const CWorldMesh::DrawRange_t* pRanges, const size_t uiFirst, const size_t uiEnd );
+
+	void SetAlphaTest( const bool bAlphaTest );
+
+private:
+	gl::CStateCache* m_pState = nullptr;
+
+	bool m_bCoreProfile = false;
+
+	bool m_bMultiDrawIndirect = false;
+
+	/**
+	*	Core profile objects.
+	*/
+	GLuint m_Program = 0;
+	GLuint m_VertexArray = 0;
+	GLint m_iViewProjectionLocation = -1;
+	GLint m_iAlphaTestLocation = -1;
+
+	GLuint m_VertexBuffer = 0;
+	GLuint m_IndexBuffer = 0;
+
+	std::vector<GLuint> m_Textures;
+	std::vector<GLuint> m_Lightmaps;
+
+	std::vector<Batch_t> m_Batches;
+
+	GLuint m_IndirectBuffer = 0;
+	size_t m_uiIndirectCapacity = 0;
+
+	TrackedVector_t<DrawCommand_t, MemoryTag::RENDER> m_Commands;
+
+	//Arguments of glMultiDrawElements, when there are no indirect draws.
+	TrackedVector_t<GLsizei, MemoryTag::RENDER> m_Counts;
+	TrackedVector_t<const void*, MemoryTag::RENDER> m_Offsets;
+
+	GLuint m_BoundLightmap = 0;
+
+	bool m_bAlphaTest = false;
+
+	Stats_t m_Stats;
+
+private:
+	CWorldRenderer( const CWorldRenderer& ) = delete;
+	CWorldRenderer& operator=( const CWorldRenderer& ) = delete;
+};
+
+#endif //ENGINE_CWORLDRENDERER_H
@@ -0,0 +1,101 @@
+#ifndef ENGINE_DEMOFILE_H
+#define ENGINE_DEMOFILE_H
+
+#include <cstdint>
+
+/**
+*	@file
+*	Demo file structures and constants.
+*	A demo is a header, followed by chunks of recorded messages, followed by a seek index and a footer.
+*	Everything is stored in native byte order, and is a multiple of 4 bytes in size, so messages stay dword aligned in a mapped file.
+*	Demos that weren't stopped properly have no index; players rebuild it from the chunks that were written in full.
+*/
+
+namespace demo
+{
+const char IDENTIFIER[ 4 ] = { 'H', 'L', 'D', 'M' };
+
+const char INDEX_IDENTIFIER[ 4 ] = { 'D', 'I', 'D', 'X' };
+
+const uint32_t VERSION = 1;
+
+struct Header_t
+{
+	char identifier[ 4 ];
+	uint32_t uiVersion;
+
+	/**
+	*	Time between seek index entries, in milliseconds.
+	*/
+	uint32_t uiSeekIntervalMS;
+
+	uint32_t uiReserved;
+};
+
+/**
+*	Header of a chunk. Followed by its messages.
+*/
+struct ChunkHeader_t
+{
+	/**
+	*	Size of the messages in the chunk, in bytes, not including this header.
+	*/
+	uint32_t uiSize;
+
+	uint32_t uiMessageCount;
+
+	/**
+	*	Time of the chunk's first message, in microseconds since recording started.
+	*/
+	int64_t iStartTimeUS;
+};
+
+/**
+*	Header of a message. Followed by its data, padded to a multiple of 4 bytes.
+*/
+struct MessageHeader_t
+{
+	/**
+	*	Time the message was received, in microseconds since the start of its chunk.
+	*/
+	uint32_t uiTimeUS;
+
+	/**
+	*	Size of the message, in bytes, not including padding.
+	*/
+	uint32_t uiSize;
+};
+
+/**
+*	Seek index entry. Each points to the first chunk recorded after a multiple of the seek interval.
+*/
+struct IndexEntry_t
+{
+	int64_t iTimeUS;
+
+	/**
+	*	Offset of the chunk in the file.
+	*/
+	uint64_t uiOffset;
+};
+
+/**
+*	Last thing in a demo that was stopped properly.
+*/
+struct Footer_t
+{
+	/**
+	*	Offset of the seek index in the file. Chunks end here.
+	*/
+	uint64_t uiIndexOffset;
+
+	uint32_t uiIndexEntries;
+
+	char identifier[ 4 ];
+};
+
+static_assert( sizeof( Header_t ) % 4 == 0 && sizeof( ChunkHeader_t ) % 4 == 0 && sizeof( MessageHeader_t ) % 4 == 0 &&
+			   sizeof( IndexEntry_t ) % 4 == 0 && sizeof( Footer_t ) % 4 == 0, "Demo structures must keep messages dword aligned" );
+}
+
+#endif //ENGINE_DEMOFILE_H
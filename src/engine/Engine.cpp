@@ -6,10 +6,14 @@ CCommandBuffer g_CommandBuffer;
 
 cvar::CCVarSystem g_CVar;
 
+CCommandScriptCache g_CommandScripts;
+
 CEngine g_Engine;
 
 CVideo g_Video;
 
+CFrameTimer g_FrameTimer;
+
 //Constructor self registers itself for retrieval with vgui::App::getInstance.
 static CVGUI1App g_VGUI1App;
 
@@ -4,9 +4,11 @@
 #include "steam_api.h"
 
 #include "CEngine.h"
+#include "CFrameTimer.h"
 #include "CVideo.h"
 
 #include "console/CCommandBuffer.h"
+#include "console/CCommandScript.h"
 #include "console/CCVarSystem.h"
 
 #include "VGUI1/CVGUI1Surface.h"
@@ -19,10 +21,20 @@ class IFileSystem2;
 extern CCommandBuffer g_CommandBuffer;
 extern cvar::CCVarSystem g_CVar;
 
+/**
+*	Compiled scripts, for exec.
+*/
+extern CCommandScriptCache g_CommandScripts;
+
 extern CEngine g_Engine;
 
 extern CVideo g_Video;
 
+/**
+*	Times the phases of each frame.
+*/
+extern CFrameTimer g_FrameTimer;
+
 extern CVGUI1Surface* g_pVGUI1Surface;
 
 extern IFileSystem2* g_pFileSystem;
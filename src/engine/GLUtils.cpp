@@ -53,4 +53,381 @@ bool GetContextVersion( uint32_t& uiOutMajor, uint32_t& uiOutMinor )
 
 	return true;
 }
-}
\ No newline at end of file
+
+namespace
+{
+GLuint CompileShader( const char* pszName, const GLenum type, const char* pszSource )
+{
+	const GLuint shader = glCreateShader( type );
+
+	glShaderSource( shader, 1, &pszSource, nullptr );
+	glCompileShader( shader );
+
+	GLint iStatus = GL_FALSE;
+
+	glGetShaderiv( shader, GL_COMPILE_STATUS, &iStatus );
+
+	if( iStatus != GL_TRUE )
+	{
+		char szLog[ 1024 ] = {};
+
+		glGetShaderInfoLog( shader, sizeof( szLog ), nullptr, szLog );
+
+		Msg( "gl::CreateProgram: Couldn't compile %s shader for \"%s\":\n%s\n", type == GL_VERTEX_SHADER ? "vertex" : "fragment", pszName, szLog );
+
+		glDeleteShader( shader );
+
+		return 0;
+	}
+
+	return shader;
+}
+}
+
+GLuint CreateProgram( const char* pszName, const char* pszVertexSource, const char* pszFragmentSource, const bool bRetrievable )
+{
+	const GLuint vertexShader = CompileShader( pszName, GL_VERTEX_SHADER, pszVertexSource );
+
+	if( !vertexShader )
+		return 0;
+
+	const GLuint fragmentShader = CompileShader( pszName, GL_FRAGMENT_SHADER, pszFragmentSource );
+
+	if( !fragmentShader )
+	{
+		glDeleteShader( vertexShader );
+		return 0;
+	}
+
+	GLuint program = glCreateProgram();
+
+	glAttachShader( program, vertexShader );
+	glAttachShader( program, fragmentShader );
+
+	//Must be set before linking.
+	if( bRetrievable )
+		glProgramParameteri( program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+
+	glLinkProgram( program );
+
+	//The program keeps what it needs.
+	glDeleteShader( vertexShader );
+	glDeleteShader( fragmentShader );
+
+	GLint iStatus = GL_FALSE;
+
+	glGetProgramiv( program, GL_LINK_STATUS, &iStatus );
+
+	if( iStatus != GL_TRUE )
+	{
+		char szLog[ 1024 ] = {};
+
+		glGetProgramInfoLog( program, sizeof( szLog ), nullptr, szLog );
+
+		Msg( "gl::CreateProgram: Couldn't link \"%s\":\n%s\n", pszName, szLog );
+
+		glDeleteProgram( program );
+		program = 0;
+	}
+
+	return program;
+}
+
+void CStateCache::Reset()
+{
+	m_bTextureKnown = false;
+	m_bArrayBufferKnown = false;
+	m_bPixelUnpackBufferKnown = false;
+
+	for( auto& cap : m_Caps )
+	{
+		cap.state = CapState::UNKNOWN;
+	}
+
+	m_bBlendFuncKnown = false;
+	m_bViewportKnown = false;
+}
+
+void CStateCache::BindTexture( const GLuint texture )
+{
+	if( !Count( !m_bTextureKnown || m_Texture != texture ) )
+		return;
+
+	glBindTexture( GL_TEXTURE_2D, texture );
+
+	m_Texture = texture;
+	m_bTextureKnown = true;
+}
+
+void CStateCache::TextureDeleted( const GLuint texture )
+{
+	if( m_bTextureKnown && m_Texture == texture )
+		m_Texture = 0;
+}
+
+void CStateCache::BindBuffer( const GLenum target, const GLuint buffer )
+{
+	GLuint* pBuffer;
+	bool* pbKnown;
+
+	switch( target )
+	{
+	case GL_ARRAY_BUFFER:
+		pBuffer = &m_ArrayBuffer;
+		pbKnown = &m_bArrayBufferKnown;
+		break;
+
+	case GL_PIXEL_UNPACK_BUFFER:
+		pBuffer = &m_PixelUnpackBuffer;
+		pbKnown = &m_bPixelUnpackBufferKnown;
+		break;
+
+	default:
+		Count( true );
+		glBindBuffer( target, buffer );
+		return;
+	}
+
+	if( !Count( !*pbKnown || *pBuffer != buffer ) )
+		return;
+
+	glBindBuffer( target, buffer );
+
+	*pBuffer = buffer;
+	*pbKnown = true;
+}
+
+void CStateCache::BufferDeleted( const GLuint buffer )
+{
+	if( m_bArrayBufferKnown && m_ArrayBuffer == buffer )
+		m_ArrayBuffer = 0;
+
+	if( m_bPixelUnpackBufferKnown && m_PixelUnpackBuffer == buffer )
+		m_PixelUnpackBuffer = 0;
+}
+
+void CStateCache::SetEnabled( const GLenum cap, const bool bEnabled )
+{
+	const CapState state = bEnabled ? CapState::ENABLED : CapState::DISABLED;
+
+	for( auto& tracked : m_Caps )
+	{
+		if( tracked.cap != cap )
+			continue;
+
+		if( !Count( tracked.state != state ) )
+			return;
+
+		if( tracked.bClientState )
+		{
+			if( bEnabled )
+				glEnableClientState( cap );
+			else
+				glDisableClientState( cap );
+		}
+		else
+		{
+			if( bEnabled )
+				glEnable( cap );
+			else
+				glDisable( cap );
+		}
+
+		tracked.state = state;
+		return;
+	}
+
+	Count( true );
+
+	if( bEnabled )
+		glEnable( cap );
+	else
+		glDisable( cap );
+}
+
+void CStateCache::BlendFunc( const GLenum sfactor, const GLenum dfactor )
+{
+	if( !Count( !m_bBlendFuncKnown || m_BlendFunc[ 0 ] != sfactor || m_BlendFunc[ 1 ] != dfactor ) )
+		return;
+
+	glBlendFunc( sfactor, dfactor );
+
+	m_BlendFunc[ 0 ] = sfactor;
+	m_BlendFunc[ 1 ] = dfactor;
+	m_bBlendFuncKnown = true;
+}
+
+void CStateCache::Viewport( const GLint x, const GLint y, const GLsizei width, const GLsizei height )
+{
+	if( !Count( !m_bViewportKnown ||
+				m_Viewport[ 0 ] != x || m_Viewport[ 1 ] != y || m_Viewport[ 2 ] != width || m_Viewport[ 3 ] != height ) )
+		return;
+
+	glViewport( x, y, width, height );
+
+	m_Viewport[ 0 ] = x;
+	m_Viewport[ 1 ] = y;
+	m_Viewport[ 2 ] = width;
+	m_Viewport[ 3 ] = height;
+	m_bViewportKnown = true;
+}
+
+void CStateCache::TakeStats( Stats_t& stats )
+{
+	stats = m_Stats;
+
+	m_Stats = Stats_t();
+}
+
+bool CStateCache::Count( const bool bChanged )
+{
+	if( bChanged )
+		++m_Stats.uiIssued;
+	else
+		++m_Stats.uiFiltered;
+
+	return bChanged;
+}
+
+const size_t CTimerQueries::MAX_PASSES;
+const size_t CTimerQueries::NUM_FRAMES;
+const size_t CTimerQueries::NO_PASS;
+
+bool CTimerQueries::Initialize( const size_t uiNumPasses )
+{
+	Shutdown();
+
+	if( !GLEW_VERSION_3_3 && !GLEW_ARB_timer_query )
+	{
+		Msg( "GPU timer queries are not supported\n" );
+		return false;
+	}
+
+	m_uiNumPasses = uiNumPasses < MAX_PASSES ? uiNumPasses : MAX_PASSES;
+
+	for( auto& frame : m_Frames )
+	{
+		glGenQueries( static_cast<GLsizei>( m_uiNumPasses ), frame.queries );
+
+		frame.bPending = false;
+	}
+
+	m_uiCurrentFrame = 0;
+	m_uiCurrentPass = NO_PASS;
+	m_bInitialized = true;
+
+	return true;
+}
+
+void CTimerQueries::Shutdown()
+{
+	if( !m_bInitialized )
+		return;
+
+	EndPass();
+
+	for( auto& frame : m_Frames )
+	{
+		glDeleteQueries( static_cast<GLsizei>( m_uiNumPasses ), frame.queries );
+	}
+
+	m_bInitialized = false;
+}
+
+void CTimerQueries::BeginFrame()
+{
+	if( !m_bInitialized )
+		return;
+
+	EndPass();
+
+	//Read the oldest frames first, so the newest results win.
+	for( size_t uiAge = NUM_FRAMES - 1; uiAge > 0; --uiAge )
+	{
+		auto& frame = m_Frames[ ( m_uiCurrentFrame + NUM_FRAMES - uiAge ) % NUM_FRAMES ];
+
+		if( frame.bPending )
+			ReadFrame( frame );
+	}
+
+	m_uiCurrentFrame = ( m_uiCurrentFrame + 1 ) % NUM_FRAMES;
+
+	auto& frame = m_Frames[ m_uiCurrentFrame ];
+
+	//Still not done after NUM_FRAMES frames. Don't wait for it, the queries can be restarted while their results are pending.
+	if( frame.bPending && !ReadFrame( frame ) )
+		++m_uiDroppedFrames;
+
+	for( size_t uiPass = 0; uiPass < m_uiNumPasses; ++uiPass )
+	{
+		frame.bIssued[ uiPass ] = false;
+	}
+
+	frame.bPending = true;
+}
+
+void CTimerQueries::BeginPass( const size_t uiPass )
+{
+	if( !m_bInitialized || uiPass >= m_uiNumPasses )
+		return;
+
+	EndPass();
+
+	auto& frame = m_Frames[ m_uiCurrentFrame ];
+
+	//Only one query per pass per frame.
+	if( frame.bIssued[ uiPass ] )
+		return;
+
+	glBeginQuery( GL_TIME_ELAPSED, frame.queries[ uiPass ] );
+
+	frame.bIssued[ uiPass ] = true;
+	m_uiCurrentPass = uiPass;
+}
+
+void CTimerQueries::EndPass()
+{
+	if( m_uiCurrentPass == NO_PASS )
+		return;
+
+	glEndQuery( GL_TIME_ELAPSED );
+
+	m_uiCurrentPass = NO_PASS;
+}
+
+bool CTimerQueries::ReadFrame( Frame_t& frame )
+{
+	for( size_t uiPass = 0; uiPass < m_uiNumPasses; ++uiPass )
+	{
+		if( !frame.bIssued[ uiPass ] )
+			continue;
+
+		GLint iAvailable = GL_FALSE;
+
+		glGetQueryObjectiv( frame.queries[ uiPass ], GL_QUERY_RESULT_AVAILABLE, &iAvailable );
+
+		if( !iAvailable )
+			return false;
+	}
+
+	for( size_t uiPass = 0; uiPass < m_uiNumPasses; ++uiPass )
+	{
+		float flTime = 0;
+
+		if( frame.bIssued[ uiPass ] )
+		{
+			GLuint64 uiElapsed = 0;
+
+			glGetQueryObjectui64v( frame.queries[ uiPass ], GL_QUERY_RESULT, &uiElapsed );
+
+			flTime = static_cast<float>( uiElapsed / 1000000.0 );
+		}
+
+		m_flPassTimes[ uiPass ].store( flTime, std::memory_order_relaxed );
+	}
+
+	frame.bPending = false;
+
+	return true;
+}
+}
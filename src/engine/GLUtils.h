@@ -1,14 +1,240 @@
 #ifndef COMMON_GLUTILS_H
 #define COMMON_GLUTILS_H
 
+#include <atomic>
+#include <cstddef>
 #include <cstdint>
 
+#include <GL/glew.h>
+
 namespace gl
 {
 /**
 *	Gets the major and minor version of the current OpenGL context.
 */
 bool GetContextVersion( uint32_t& uiOutMajor, uint32_t& uiOutMinor );
+
+/**
+*	Compiles and links a program from vertex and fragment shader sources. Errors are logged.
+*	@param pszName Name to use in log messages.
+*	@param bRetrievable Whether the program's binary will be retrieved with glGetProgramBinary.
+*	@return The program, or 0 if it couldn't be created.
+*/
+GLuint CreateProgram( const char* pszName, const char* pszVertexSource, const char* pszFragmentSource, const bool bRetrievable = false );
+
+/**
+*	Tracks OpenGL state to drop calls that wouldn't change it. Only state that the renderer changes often is tracked.
+*	State starts out unknown, so the first change of each is always issued.
+*	Must be used on the thread that owns the context.
+*/
+class CStateCache final
+{
+public:
+	struct Stats_t
+	{
+		/**
+		*	Calls that were passed on to OpenGL.
+		*/
+		size_t uiIssued = 0;
+
+		/**
+		*	Calls that were dropped because they wouldn't change anything.
+		*/
+		size_t uiFiltered = 0;
+	};
+
+public:
+	CStateCache() = default;
+
+	/**
+	*	Forgets all state, so the next change of each is issued. Call if OpenGL state was changed without the cache.
+	*/
+	void Reset();
+
+	/**
+	*	Binds a 2D texture to the active texture unit.
+	*/
+	void BindTexture( const GLuint texture );
+
+	/**
+	*	Must be called when a texture is deleted. Deleting a bound texture binds texture 0.
+	*/
+	void TextureDeleted( const GLuint texture );
+
+	/**
+	*	Binds a buffer. Supports GL_ARRAY_BUFFER and GL_PIXEL_UNPACK_BUFFER, other targets are always passed on.
+	*/
+	void BindBuffer( const GLenum target, const GLuint buffer );
+
+	/**
+	*	Must be called when a buffer is deleted. Deleting a bound buffer binds buffer 0.
+	*/
+	void BufferDeleted( const GLuint buffer );
+
+	/**
+	*	Enables or disables a capability, with glEnable, or glEnableClientState for vertex arrays.
+	*	Capabilities that aren't tracked are always passed on.
+	*/
+	void SetEnabled( const GLenum cap, const bool bEnabled );
+
+	void BlendFunc( const GLenum sfactor, const GLenum dfactor );
+
+	void Viewport( const GLint x, const GLint y, const GLsizei width, const GLsizei height );
+
+	/**
+	*	Gets the statistics since they were last reset, and resets them.
+	*/
+	void TakeStats( Stats_t& stats );
+
+private:
+	enum class CapState : uint8_t
+	{
+		UNKNOWN = 0,
+		DISABLED,
+		ENABLED
+	};
+
+	struct TrackedCap_t
+	{
+		GLenum cap;
+		bool bClientState;
+		CapState state;
+	};
+
+	/**
+	*	Counts a call.
+	*	@return Whether the call changes anything.
+	*/
+	bool Count( const bool bChanged );
+
+private:
+	GLuint m_Texture = 0;
+	bool m_bTextureKnown = false;
+
+	GLuint m_ArrayBuffer = 0;
+	bool m_bArrayBufferKnown = false;
+
+	GLuint m_PixelUnpackBuffer = 0;
+	bool m_bPixelUnpackBufferKnown = false;
+
+	TrackedCap_t m_Caps[ 8 ] =
+	{
+		{ GL_BLEND, false, CapState::UNKNOWN },
+		{ GL_CULL_FACE, false, CapState::UNKNOWN },
+		{ GL_DEPTH_TEST, false, CapState::UNKNOWN },
+		{ GL_SCISSOR_TEST, false, CapState::UNKNOWN },
+		{ GL_TEXTURE_2D, false, CapState::UNKNOWN },
+		{ GL_VERTEX_ARRAY, true, CapState::UNKNOWN },
+		{ GL_TEXTURE_COORD_ARRAY, true, CapState::UNKNOWN },
+		{ GL_COLOR_ARRAY, true, CapState::UNKNOWN }
+	};
+
+	GLenum m_BlendFunc[ 2 ] = {};
+	bool m_bBlendFuncKnown = false;
+
+	GLint m_Viewport[ 4 ] = {};
+	bool m_bViewportKnown = false;
+
+	Stats_t m_Stats;
+
+private:
+	CStateCache( const CStateCache& ) = delete;
+	CStateCache& operator=( const CStateCache& ) = delete;
+};
+
+/**
+*	Measures how long the GPU spends on render passes, using GL_TIME_ELAPSED queries.
+*	Results are read back a few frames later without waiting for the GPU; frames whose results still aren't
+*	available once their queries are needed again are dropped.
+*	Must be used on the thread that owns the context, except for GetPassTime.
+*/
+class CTimerQueries final
+{
+public:
+	static const size_t MAX_PASSES = 8;
+
+	/**
+	*	Number of frames that can be waiting for results.
+	*/
+	static const size_t NUM_FRAMES = 4;
+
+public:
+	CTimerQueries() = default;
+
+	/**
+	*	Creates the queries.
+	*	@return Whether timer queries are supported.
+	*/
+	bool Initialize( const size_t uiNumPasses );
+
+	void Shutdown();
+
+	bool IsInitialized() const { return m_bInitialized; }
+
+	/**
+	*	Starts a new frame. Reads back the results of earlier frames that have finished.
+	*/
+	void BeginFrame();
+
+	/**
+	*	Starts timing a pass. Passes can't be nested, the current pass is ended first.
+	*/
+	void BeginPass( const size_t uiPass );
+
+	void EndPass();
+
+	/**
+	*	@return Time that the GPU spent on a pass in the most recent frame with results, in milliseconds.
+	*/
+	float GetPassTime( const size_t uiPass ) const
+	{
+		return uiPass < m_uiNumPasses ? m_flPassTimes[ uiPass ].load( std::memory_order_relaxed ) : 0;
+	}
+
+	/**
+	*	@return Number of frames whose results were dropped.
+	*/
+	size_t GetDroppedFrames() const { return m_uiDroppedFrames; }
+
+private:
+	static const size_t NO_PASS = static_cast<size_t>( -1 );
+
+	struct Frame_t
+	{
+		GLuint queries[ MAX_PASSES ];
+
+		/**
+		*	Whether each pass was timed in this frame.
+		*/
+		bool bIssued[ MAX_PASSES ];
+
+		bool bPending;
+	};
+
+	/**
+	*	Reads back a frame's results if they're available.
+	*/
+	bool ReadFrame( Frame_t& frame );
+
+private:
+	bool m_bInitialized = false;
+
+	size_t m_uiNumPasses = 0;
+
+	Frame_t m_Frames[ NUM_FRAMES ] = {};
+
+	size_t m_uiCurrentFrame = 0;
+
+	size_t m_uiCurrentPass = NO_PASS;
+
+	std::atomic<float> m_flPassTimes[ MAX_PASSES ] = {};
+
+	size_t m_uiDroppedFrames = 0;
+
+private:
+	CTimerQueries( const CTimerQueries& ) = delete;
+	CTimerQueries& operator=( const CTimerQueries& ) = delete;
+};
 }
 
 #endif //COMMON_GLUTILS_H
\ No newline at end of file
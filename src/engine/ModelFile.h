@@ -0,0 +1,344 @@
+#ifndef ENGINE_MODELFILE_H
+#define ENGINE_MODELFILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+*	@file
+*	GoldSource studio model (MDL) and sprite (SPR) file structures and constants. Everything is little endian.
+*	A studio model is a header with the count and offset of each table, followed by the tables. Offsets are from the start of the file.
+*	A sprite is a header and a palette, followed by its frames. Frames have variable sizes and aren't aligned.
+*/
+
+namespace studio
+{
+/**
+*	"IDST"
+*/
+const uint32_t IDENT = ( 'T' << 24 ) | ( 'S' << 16 ) | ( 'D' << 8 ) | 'I';
+
+const int32_t VERSION = 10;
+
+const size_t MAX_BONE_CONTROLLERS = 6;
+
+/**
+*	Bone controller index of the mouth.
+*/
+const int32_t MOUTH_CONTROLLER = 4;
+
+const size_t MAX_BLENDS = 2;
+
+const size_t PALETTE_SIZE = 256 * 3;
+
+struct Header_t
+{
+	uint32_t id;
+	int32_t version;
+
+	char name[ 64 ];
+	int32_t length;
+
+	float eyeposition[ 3 ];
+	float min[ 3 ];
+	float max[ 3 ];
+	float bbmin[ 3 ];
+	float bbmax[ 3 ];
+
+	int32_t flags;
+
+	int32_t numbones;
+	int32_t boneindex;
+
+	int32_t numbonecontrollers;
+	int32_t bonecontrollerindex;
+
+	int32_t numhitboxes;
+	int32_t hitboxindex;
+
+	int32_t numseq;
+	int32_t seqindex;
+
+	/**
+	*	Group 0 is this file. Other groups are stored in separate files.
+	*/
+	int32_t numseqgroups;
+	int32_t seqgroupindex;
+
+	/**
+	*	No textures if they're stored in a separate file.
+	*/
+	int32_t numtextures;
+	int32_t textureindex;
+	int32_t texturedataindex;
+
+	/**
+	*	Table of numskinfamilies by numskinref texture indices.
+	*/
+	int32_t numskinref;
+	int32_t numskinfamilies;
+	int32_t skinindex;
+
+	int32_t numbodyparts;
+	int32_t bodypartindex;
+
+	int32_t numattachments;
+	int32_t attachmentindex;
+
+	int32_t soundtable;
+	int32_t soundindex;
+	int32_t soundgroups;
+	int32_t soundgroupindex;
+
+	int32_t numtransitions;
+	int32_t transitionindex;
+};
+
+struct Bone_t
+{
+	char name[ 32 ];
+
+	/**
+	*	-1 for root bones.
+	*/
+	int32_t parent;
+
+	int32_t flags;
+
+	/**
+	*	Bone controller of each degree of freedom, or -1 for none.
+	*/
+	int32_t bonecontroller[ MAX_BONE_CONTROLLERS ];
+
+	float value[ MAX_BONE_CONTROLLERS ];
+	float scale[ MAX_BONE_CONTROLLERS ];
+};
+
+struct BoneController_t
+{
+	int32_t bone;
+	int32_t type;
+	float start;
+	float end;
+	int32_t rest;
+
+	/**
+	*	Which controller of an entity drives it.
+	*/
+	int32_t index;
+};
+
+struct HitBox_t
+{
+	int32_t bone;
+	int32_t group;
+	float bbmin[ 3 ];
+	float bbmax[ 3 ];
+};
+
+struct SeqGroup_t
+{
+	char label[ 32 ];
+	char name[ 64 ];
+
+	int32_t unused1;
+	int32_t unused2;
+};
+
+struct SeqDesc_t
+{
+	char label[ 32 ];
+
+	float fps;
+	int32_t flags;
+
+	int32_t activity;
+	int32_t actweight;
+
+	int32_t numevents;
+	int32_t eventindex;
+
+	int32_t numframes;
+
+	int32_t numpivots;
+	int32_t pivotindex;
+
+	int32_t motiontype;
+	int32_t motionbone;
+	float linearmovement[ 3 ];
+	int32_t automoveposindex;
+	int32_t automoveangleindex;
+
+	float bbmin[ 3 ];
+	float bbmax[ 3 ];
+
+	/**
+	*	Number of blended animations, each with an Anim_t per bone. Offset is into the sequence group's file.
+	*/
+	int32_t numblends;
+	int32_t animindex;
+
+	int32_t blendtype[ MAX_BLENDS ];
+	float blendstart[ MAX_BLENDS ];
+	float blendend[ MAX_BLENDS ];
+	int32_t blendparent;
+
+	int32_t seqgroup;
+
+	int32_t entrynode;
+	int32_t exitnode;
+	int32_t nodeflags;
+
+	int32_t nextseq;
+};
+
+struct Event_t
+{
+	int32_t frame;
+	int32_t event;
+	int32_t type;
+	char options[ 64 ];
+};
+
+struct Pivot_t
+{
+	float org[ 3 ];
+	int32_t start;
+	int32_t end;
+};
+
+/**
+*	Offsets of the compressed values of each degree of freedom of a bone, from the start of this structure. 0 if the value doesn't change.
+*/
+struct Anim_t
+{
+	uint16_t offset[ MAX_BONE_CONTROLLERS ];
+};
+
+struct Attachment_t
+{
+	char name[ 32 ];
+	int32_t type;
+	int32_t bone;
+	float org[ 3 ];
+	float vectors[ 3 ][ 3 ];
+};
+
+struct BodyPart_t
+{
+	char name[ 64 ];
+	int32_t nummodels;
+	int32_t base;
+	int32_t modelindex;
+};
+
+struct Texture_t
+{
+	char name[ 64 ];
+	int32_t flags;
+	int32_t width;
+	int32_t height;
+
+	/**
+	*	Offset of the 8 bit pixels, which are followed by a PALETTE_SIZE palette.
+	*/
+	int32_t index;
+};
+
+struct Model_t
+{
+	char name[ 64 ];
+
+	int32_t type;
+
+	float boundingradius;
+
+	int32_t nummesh;
+	int32_t meshindex;
+
+	/**
+	*	Vertices, and the bone of each vertex.
+	*/
+	int32_t numverts;
+	int32_t vertinfoindex;
+	int32_t vertindex;
+
+	/**
+	*	Normals, and the bone of each normal.
+	*/
+	int32_t numnorms;
+	int32_t norminfoindex;
+	int32_t normindex;
+
+	int32_t numgroups;
+	int32_t groupindex;
+};
+
+struct Mesh_t
+{
+	/**
+	*	Triangle strip and fan commands, ended by a 0 command.
+	*/
+	int32_t numtris;
+	int32_t triindex;
+
+	int32_t skinref;
+
+	int32_t numnorms;
+	int32_t normindex;
+};
+}
+
+namespace sprite
+{
+/**
+*	"IDSP"
+*/
+const uint32_t IDENT = ( 'P' << 24 ) | ( 'S' << 16 ) | ( 'D' << 8 ) | 'I';
+
+const int32_t VERSION = 2;
+
+enum FrameType : int32_t
+{
+	FRAME_SINGLE = 0,
+	FRAME_GROUP
+};
+
+/**
+*	Followed by the palette's color count as an int16_t, and then the colors as RGB bytes.
+*/
+struct Header_t
+{
+	uint32_t ident;
+	int32_t version;
+	int32_t type;
+	int32_t texFormat;
+	float boundingradius;
+	int32_t width;
+	int32_t height;
+	int32_t numframes;
+	float beamlength;
+	int32_t synctype;
+};
+
+/**
+*	Each frame of the sprite starts with its FrameType.
+*	A single frame is followed by width by height 8 bit pixels.
+*/
+struct Frame_t
+{
+	int32_t origin[ 2 ];
+	int32_t width;
+	int32_t height;
+};
+
+/**
+*	Followed by the time at which each frame ends as a float, and then the frames.
+*/
+struct Group_t
+{
+	int32_t numframes;
+};
+}
+
+#endif //ENGINE_MODELFILE_H
@@ -0,0 +1,73 @@
+#include "Engine.h"
+
+#include "CRenderCommandList.h"
+
+#include "CCachedPanel.h"
+
+CCachedPanel::CCachedPanel( int x, int y, int wide, int tall )
+	: vgui::Panel( x, y, wide, tall )
+{
+}
+
+CCachedPanel::~CCachedPanel()
+{
+	if( m_iCacheTexture )
+		g_Video.GetTextureManager().ReleaseTexture( m_iCacheTexture );
+}
+
+void CCachedPanel::SetCacheEnabled( const bool bEnabled )
+{
+	m_bCacheEnabled = bEnabled;
+	m_bCacheDirty = true;
+}
+
+void CCachedPanel::paintTraverse( bool repaint )
+{
+	auto& renderer = g_Video.GetRenderer();
+
+	if( !isVisible() || !m_bCacheEnabled || !renderer.IsUICacheSupported() )
+	{
+		vgui::Panel::paintTraverse( repaint );
+		return;
+	}
+
+	int x0, y0, x1, y1;
+
+	getAbsExtents( x0, y0, x1, y1 );
+
+	if( x0 >= x1 || y0 >= y1 )
+		return;
+
+	auto& textures = g_Video.GetTextureManager();
+
+	//An evicted cache is drawn again.
+	if( !m_iCacheTexture )
+		m_iCacheTexture = textures.CreateTexture( TextureOwner::PANEL_CACHE, [ this ] { m_bCacheDirty = true; } );
+
+	textures.MarkUsed( m_iCacheTexture );
+
+	auto& list = g_Video.GetCommandList();
+
+	list.BindTexture( m_iCacheTexture );
+
+	if( m_bCacheDirty || ( x1 - x0 ) != m_iCacheWidth || ( y1 - y0 ) != m_iCacheHeight )
+	{
+		list.BeginPanelCache( x0, y0, x1, y1 );
+
+		//Everything has to be drawn, the cache was cleared.
+		vgui::Panel::paintTraverse( true );
+
+		list.EndPanelCache();
+
+		//Children may have bound other textures.
+		list.BindTexture( m_iCacheTexture );
+
+		m_iCacheWidth = x1 - x0;
+		m_iCacheHeight = y1 - y0;
+		m_bCacheDirty = false;
+
+		textures.SetUploaded( m_iCacheTexture, static_cast<size_t>( m_iCacheWidth ) * m_iCacheHeight * 4 );
+	}
+
+	list.DrawPanelCache( x0, y0, x1, y1 );
+}
@@ -0,0 +1,48 @@
+#ifndef ENGINE_VGUI1_CCACHEDPANEL_H
+#define ENGINE_VGUI1_CCACHEDPANEL_H
+
+#include <VGUI_Panel.h>
+
+/**
+*	Panel that keeps a copy of itself and its children in a texture, and draws that until something in it is invalidated.
+*	The copy is drawn opaque, so only use this for panels that fill their area and rarely change.
+*/
+class CCachedPanel : public vgui::Panel
+{
+public:
+	CCachedPanel( int x, int y, int wide, int tall );
+	~CCachedPanel();
+
+	bool IsCacheEnabled() const { return m_bCacheEnabled; }
+
+	void SetCacheEnabled( const bool bEnabled );
+
+	/**
+	*	Redraws the cache the next time the panel is painted. Called by the surface when the panel or one of its children is invalidated.
+	*/
+	void MarkCacheDirty()
+	{
+		m_bCacheDirty = true;
+	}
+
+protected:
+	void paintTraverse( bool repaint ) override;
+
+private:
+	bool m_bCacheEnabled = false;
+	bool m_bCacheDirty = true;
+
+	/**
+	*	Texture handle the renderer keeps the cache under. 0 until the panel is first cached.
+	*/
+	int m_iCacheTexture = 0;
+
+	int m_iCacheWidth = 0;
+	int m_iCacheHeight = 0;
+
+private:
+	CCachedPanel( const CCachedPanel& ) = delete;
+	CCachedPanel& operator=( const CCachedPanel& ) = delete;
+};
+
+#endif //ENGINE_VGUI1_CCACHEDPANEL_H
@@ -0,0 +1,116 @@
+#include "CFrameTimer.h"
+
+#include "CFrameGraphPanel.h"
+
+namespace
+{
+/**
+*	Bar colors for each phase, in CFrameTimer::Phase order. Time not spent in any phase is drawn in gray.
+*/
+const int PHASE_COLORS[ CFrameTimer::NUM_PHASES ][ 3 ] =
+{
+	{ 255, 200, 0 },
+	{ 0, 200, 255 },
+	{ 255, 96, 0 },
+	{ 0, 255, 0 },
+	{ 255, 0, 255 }
+};
+}
+
+const int CFrameGraphPanel::PIXELS_PER_MS;
+const int CFrameGraphPanel::BAR_WIDTH;
+
+CFrameGraphPanel::CFrameGraphPanel( const CFrameTimer& timer, int x, int y, int wide, int tall )
+	: vgui::Panel( x, y, wide, tall )
+	, m_Timer( timer )
+{
+	setPaintBorderEnabled( false );
+	setPaintBackgroundEnabled( false );
+}
+
+void CFrameGraphPanel::paint()
+{
+	int wide, tall;
+
+	getSize( wide, tall );
+
+	drawSetColor( 0, 0, 0, 255 );
+	drawFilledRect( 0, 0, wide, tall );
+
+	const size_t uiMaxBars = static_cast<size_t>( wide / BAR_WIDTH );
+
+	const size_t uiBars = m_Timer.GetFrameCount() < uiMaxBars ? m_Timer.GetFrameCount() : uiMaxBars;
+
+	for( size_t uiAge = 0; uiAge < uiBars; ++uiAge )
+	{
+		const auto& frame = m_Timer.GetFrame( uiAge );
+
+		const int x1 = wide - static_cast<int>( uiAge ) * BAR_WIDTH;
+		const int x0 = x1 - BAR_WIDTH;
+
+		float flBottomMS = 0;
+
+		for( size_t uiPhase = 0; uiPhase < CFrameTimer::NUM_PHASES; ++uiPhase )
+		{
+			const float flTopMS = flBottomMS + frame.flPhaseMS[ uiPhase ];
+
+			const int y1 = tall - static_cast<int>( flBottomMS * PIXELS_PER_MS );
+			const int y0 = tall - static_cast<int>( flTopMS * PIXELS_PER_MS );
+
+			if( y0 < y1 )
+			{
+				drawSetColor( PHASE_COLORS[ uiPhase ][ 0 ], PHASE_COLORS[ uiPhase ][ 1 ], PHASE_COLORS[ uiPhase ][ 2 ], 255 );
+				drawFilledRect( x0, y0 > 0 ? y0 : 0, x1, y1 );
+			}
+
+			flBottomMS = flTopMS;
+		}
+
+		if( frame.flTotalMS > flBottomMS )
+		{
+			const int y1 = tall - static_cast<int>( flBottomMS * PIXELS_PER_MS );
+			const int y0 = tall - static_cast<int>( frame.flTotalMS * PIXELS_PER_MS );
+
+			if( y0 < y1 )
+			{
+				drawSetColor( 128, 128, 128, 255 );
+				drawFilledRect( x0, y0 > 0 ? y0 : 0, x1, y1 );
+			}
+		}
+	}
+
+	//Mark the GPU time of each frame, so GPU bound frames stand out.
+	drawSetColor( 255, 255, 255, 255 );
+
+	for( size_t uiAge = 0; uiAge < uiBars; ++uiAge )
+	{
+		const auto& frame = m_Timer.GetFrame( uiAge );
+
+		float flGPUMS = 0;
+
+		for( auto flPassMS : frame.flGPUPassMS )
+		{
+			flGPUMS += flPassMS;
+		}
+
+		if( flGPUMS <= 0 )
+			continue;
+
+		const int x1 = wide - static_cast<int>( uiAge ) * BAR_WIDTH;
+		const int y = tall - static_cast<int>( flGPUMS * PIXELS_PER_MS );
+
+		if( y >= 0 )
+			drawFilledRect( x1 - BAR_WIDTH, y, x1, y + 1 );
+	}
+
+	if( m_flBudgetMS > 0 )
+	{
+		const int y = tall - static_cast<int>( m_flBudgetMS * PIXELS_PER_MS );
+
+		if( y >= 0 )
+		{
+			drawSetColor( 255, 0, 0, 255 );
+			drawFilledRect( 0, y, wide, y + 1 );
+		}
+	}
+}
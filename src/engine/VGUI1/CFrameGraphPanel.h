@@ -0,0 +1,48 @@
+#ifndef ENGINE_VGUI1_CFRAMEGRAPHPANEL_H
+#define ENGINE_VGUI1_CFRAMEGRAPHPANEL_H
+
+#include <VGUI_Panel.h>
+
+class CFrameTimer;
+
+/**
+*	Draws the recorded frame times as a bar graph, newest frame on the right.
+*	Each bar is split into the frame's phases, with a white mark at the GPU time. A line marks the frame time that the frame rate cap allows.
+*/
+class CFrameGraphPanel : public vgui::Panel
+{
+public:
+	/**
+	*	Vertical scale of the graph.
+	*/
+	static const int PIXELS_PER_MS = 4;
+
+	/**
+	*	Width of each bar.
+	*/
+	static const int BAR_WIDTH = 2;
+
+	CFrameGraphPanel( const CFrameTimer& timer, int x, int y, int wide, int tall );
+
+	/**
+	*	Sets the frame time to mark, in milliseconds. 0 for none.
+	*/
+	void SetBudget( const float flBudgetMS )
+	{
+		m_flBudgetMS = flBudgetMS;
+	}
+
+protected:
+	void paint() override;
+
+private:
+	const CFrameTimer& m_Timer;
+
+	float m_flBudgetMS = 0;
+
+private:
+	CFrameGraphPanel( const CFrameGraphPanel& ) = delete;
+	CFrameGraphPanel& operator=( const CFrameGraphPanel& ) = delete;
+};
+
+#endif //ENGINE_VGUI1_CFRAMEGRAPHPANEL_H
@@ -0,0 +1,44 @@
+#include <VGUI_Font.h>
+
+#include "Engine.h"
+
+#include "CRenderCommandList.h"
+
+#include "CGlyphCache.h"
+
+const CGlyphCache::Glyph_t& CGlyphCache::GetGlyph( vgui::Font& font, const uint8_t ch, CRenderCommandList& list )
+{
+	auto& glyphs = m_Fonts[ font.getId() ];
+
+	if( !glyphs )
+		glyphs = std::make_unique<FontGlyphs_t>();
+
+	auto& glyph = ( *glyphs )[ ch ];
+
+	if( glyph.bRasterized )
+		return glyph;
+
+	glyph.bRasterized = true;
+
+	font.getCharABCwide( ch, glyph.iA, glyph.iB, glyph.iC );
+
+	glyph.iTall = font.getTall();
+
+	if( glyph.iB > 0 && glyph.iTall > 0 )
+	{
+		m_Pixels.assign( static_cast<size_t>( glyph.iB ) * glyph.iTall * 4, 0 );
+
+		font.getCharRGBA( ch, 0, 0, glyph.iB, glyph.iTall, m_Pixels.data() );
+
+		auto& textures = g_Video.GetTextureManager();
+
+		glyph.iTexture = textures.CreateTexture( TextureOwner::GLYPH );
+
+		list.UploadTexture( glyph.iTexture, m_Pixels.data(), glyph.iB, glyph.iTall );
+		textures.SetImageUploaded( glyph.iTexture, glyph.iB, glyph.iTall );
+
+		++m_uiGlyphs;
+	}
+
+	return glyph;
+}
@@ -0,0 +1,75 @@
+#ifndef ENGINE_VGUI1_CGLYPHCACHE_H
+#define ENGINE_VGUI1_CGLYPHCACHE_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace vgui
+{
+class Font;
+}
+
+class CRenderCommandList;
+
+/**
+*	Rasterizes font characters once and keeps them in textures. Glyphs are small enough to be packed into the renderer's
+*	atlas pages, so a string is drawn with one texture bind per page instead of one per character.
+*	Fonts are immutable in VGUI1, so glyphs are cached by font ID and never invalidated.
+*/
+class CGlyphCache final
+{
+public:
+	struct Glyph_t
+	{
+		/**
+		*	Texture handle. 0 if the character has no pixels, like a space.
+		*/
+		int iTexture = 0;
+
+		/**
+		*	Space before the glyph, glyph width and space after it.
+		*/
+		int iA = 0;
+		int iB = 0;
+		int iC = 0;
+
+		int iTall = 0;
+
+		bool bRasterized = false;
+	};
+
+public:
+	CGlyphCache() = default;
+
+	/**
+	*	Gets a character's glyph. If it wasn't used before, it's rasterized and uploaded through the given list.
+	*/
+	const Glyph_t& GetGlyph( vgui::Font& font, const uint8_t ch, CRenderCommandList& list );
+
+	/**
+	*	@return Number of glyphs that were rasterized.
+	*/
+	size_t GetGlyphCount() const { return m_uiGlyphs; }
+
+private:
+	using FontGlyphs_t = std::array<Glyph_t, 256>;
+
+private:
+	std::unordered_map<int, std::unique_ptr<FontGlyphs_t>> m_Fonts;
+
+	/**
+	*	Buffer for rasterizing glyphs.
+	*/
+	std::vector<uint8_t> m_Pixels;
+
+	size_t m_uiGlyphs = 0;
+
+private:
+	CGlyphCache( const CGlyphCache& ) = delete;
+	CGlyphCache& operator=( const CGlyphCache& ) = delete;
+};
+
+#endif //ENGINE_VGUI1_CGLYPHCACHE_H
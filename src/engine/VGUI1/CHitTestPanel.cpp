@@ -0,0 +1,159 @@
+#include <algorithm>
+
+#include "CHitTestPanel.h"
+
+const int CHitTestPanel::BAND_TALL;
+
+CHitTestPanel::CHitTestPanel( int x, int y, int wide, int tall )
+	: vgui::Panel( x, y, wide, tall )
+{
+}
+
+CHitTestPanel::~CHitTestPanel()
+{
+}
+
+void CHitTestPanel::setSize( int wide, int tall )
+{
+	vgui::Panel::setSize( wide, tall );
+	m_bBoundsDirty = true;
+}
+
+void CHitTestPanel::setBounds( int x, int y, int wide, int tall )
+{
+	vgui::Panel::setBounds( x, y, wide, tall );
+	m_bBoundsDirty = true;
+}
+
+void CHitTestPanel::addChild( vgui::Panel* child )
+{
+	vgui::Panel::addChild( child );
+	m_bBoundsDirty = true;
+}
+
+void CHitTestPanel::insertChildAt( vgui::Panel* child, int index )
+{
+	vgui::Panel::insertChildAt( child, index );
+	m_bBoundsDirty = true;
+}
+
+void CHitTestPanel::removeChild( vgui::Panel* child )
+{
+	vgui::Panel::removeChild( child );
+	m_bBoundsDirty = true;
+}
+
+void CHitTestPanel::removeAllChildren()
+{
+	vgui::Panel::removeAllChildren();
+	m_bBoundsDirty = true;
+}
+
+vgui::Panel* CHitTestPanel::isWithinTraverse( int x, int y )
+{
+	if( !isVisible() || !isWithin( x, y ) )
+		return nullptr;
+
+	if( m_bBoundsDirty )
+		RebuildBands();
+
+	int iLocalX = x;
+	int iLocalY = y;
+
+	screenToLocal( iLocalX, iLocalY );
+
+	if( iLocalY >= 0 && iLocalY / BAND_TALL < static_cast<int>( m_Bands.size() ) )
+	{
+		const auto& band = m_Bands[ iLocalY / BAND_TALL ];
+
+		//Later children are drawn on top, so they're asked first, like VGUI does.
+		for( auto it = band.rbegin(); it != band.rend(); ++it )
+		{
+			const auto& bounds = m_Bounds[ *it ];
+
+			if( iLocalX < bounds.x || iLocalX >= bounds.x + bounds.wide || iLocalY < bounds.y || iLocalY >= bounds.y + bounds.tall )
+				continue;
+
+			if( auto pPanel = bounds.pPanel->isWithinTraverse( x, y ) )
+				return pPanel;
+		}
+	}
+
+	return this;
+}
+
+void CHitTestPanel::solveTraverse()
+{
+	vgui::Panel::solveTraverse();
+
+	//Layouts and game code move children without telling the parent, catch that once per frame rather than on every mouse move.
+	if( !m_bBoundsDirty && HaveBoundsChanged() )
+		m_bBoundsDirty = true;
+}
+
+bool CHitTestPanel::HaveBoundsChanged()
+{
+	const int iCount = getChildCount();
+
+	if( iCount != static_cast<int>( m_Bounds.size() ) )
+		return true;
+
+	for( int iChild = 0; iChild < iCount; ++iChild )
+	{
+		const auto& bounds = m_Bounds[ iChild ];
+
+		auto pChild = getChild( iChild );
+
+		int x, y, wide, tall;
+
+		pChild->getBounds( x, y, wide, tall );
+
+		if( pChild != bounds.pPanel || x != bounds.x || y != bounds.y || wide != bounds.wide || tall != bounds.tall )
+			return true;
+	}
+
+	return false;
+}
+
+void CHitTestPanel::RebuildBands()
+{
+	m_bBoundsDirty = false;
+
+	int wide, tall;
+
+	getSize( wide, tall );
+
+	const size_t uiBandCount = static_cast<size_t>( std::max( 0, ( tall + BAND_TALL - 1 ) / BAND_TALL ) );
+
+	//Keep the band vectors' storage, they're rebuilt whenever a child moves.
+	m_Bands.resize( uiBandCount );
+
+	for( auto& band : m_Bands )
+	{
+		band.clear();
+	}
+
+	const int iCount = getChildCount();
+
+	m_Bounds.resize( static_cast<size_t>( iCount ) );
+
+	for( int iChild = 0; iChild < iCount; ++iChild )
+	{
+		auto& bounds = m_Bounds[ iChild ];
+
+		bounds.pPanel = getChild( iChild );
+		bounds.pPanel->getBounds( bounds.x, bounds.y, bounds.wide, bounds.tall );
+
+		//Children outside the panel are clipped, so they can't be under the cursor there.
+		if( bounds.wide <= 0 || bounds.tall <= 0 || bounds.y + bounds.tall <= 0 || bounds.y >= tall )
+			continue;
+
+		const int iFirstBand = std::max( 0, bounds.y / BAND_TALL );
+		const int iLastBand = std::min( static_cast<int>( uiBandCount ) - 1, ( bounds.y + bounds.tall - 1 ) / BAND_TALL );
+
+		for( int iBand = iFirstBand; iBand <= iLastBand; ++iBand )
+		{
+			m_Bands[ iBand ].push_back( iChild );
+		}
+	}
+}
@@ -0,0 +1,77 @@
+#ifndef ENGINE_VGUI1_CHITTESTPANEL_H
+#define ENGINE_VGUI1_CHITTESTPANEL_H
+
+#include <vector>
+
+#include <VGUI_Panel.h>
+
+/**
+*	Panel that finds the child under the cursor without asking every child.
+*	VGUI asks each child in turn whether the cursor is within it, which means walking up the tree for each child's screen extents, on every mouse move.
+*	This panel keeps its children's bounds in horizontal bands, so only the few children in the cursor's band are asked.
+*	The bounds are relative to the panel, so moving it keeps them. They're rebuilt when the panel is resized, children are added or removed,
+*	or a child has moved by the time the panel's layout is solved.
+*	Children that are within points outside of their bounds aren't found outside of them.
+*/
+class CHitTestPanel : public vgui::Panel
+{
+public:
+	/**
+	*	Height of each band, in pixels. About the height of a list row, so most children are in one or two bands.
+	*/
+	static const int BAND_TALL = 32;
+
+	CHitTestPanel( int x, int y, int wide, int tall );
+	~CHitTestPanel();
+
+	void setSize( int wide, int tall ) override;
+	void setBounds( int x, int y, int wide, int tall ) override;
+
+	void addChild( vgui::Panel* child ) override;
+	void insertChildAt( vgui::Panel* child, int index ) override;
+	void removeChild( vgui::Panel* child ) override;
+	void removeAllChildren() override;
+
+	vgui::Panel* isWithinTraverse( int x, int y ) override;
+
+	void solveTraverse() override;
+
+	void InvalidateBounds()
+	{
+		m_bBoundsDirty = true;
+	}
+
+private:
+	struct ChildBounds_t
+	{
+		vgui::Panel* pPanel;
+		int x, y;
+		int wide, tall;
+	};
+
+	/**
+	*	@return Whether a child has been added, removed or moved since the bands were built.
+	*/
+	bool HaveBoundsChanged();
+
+	void RebuildBands();
+
+private:
+	bool m_bBoundsDirty = true;
+
+	/**
+	*	Bounds of each child, in child order.
+	*/
+	std::vector<ChildBounds_t> m_Bounds;
+
+	/**
+	*	Indices of the children that overlap each band, in child order.
+	*/
+	std::vector<std::vector<int>> m_Bands;
+
+private:
+	CHitTestPanel( const CHitTestPanel& ) = delete;
+	CHitTestPanel& operator=( const CHitTestPanel& ) = delete;
+};
+
+#endif //ENGINE_VGUI1_CHITTESTPANEL_H
@@ -1,11 +1,44 @@
+#include <algorithm>
+
 #include <SDL2/SDL.h>
 
+#include <VGUI_Font.h>
 #include <VGUI_Panel.h>
 
 #include "Engine.h"
 
+#include "CCachedPanel.h"
 #include "CVGUI1Surface.h"
 
+bool CVGUI1Surface::TakeDirtyRect( int& x0, int& y0, int& x1, int& y1 )
+{
+	if( !m_bDirty )
+		return false;
+
+	x0 = m_iDirtyX0;
+	y0 = m_iDirtyY0;
+	x1 = m_iDirtyX1;
+	y1 = m_iDirtyY1;
+
+	m_bDirty = false;
+
+	return true;
+}
+
+void CVGUI1Surface::InvalidateAll()
+{
+	int wide, tall;
+
+	getPanel()->getSize( wide, tall );
+
+	m_iDirtyX0 = 0;
+	m_iDirtyY0 = 0;
+	m_iDirtyX1 = wide;
+	m_iDirtyY1 = tall;
+
+	m_bDirty = true;
+}
+
 void CVGUI1Surface::setTitle( const char* title )
 {
 	//Nothing
@@ -49,11 +82,7 @@ bool CVGUI1Surface::isWithin( int x, int y )
 
 int CVGUI1Surface::createNewTextureID()
 {
-	GLuint texture;
-
-	glGenTextures( 1, &texture );
-
-	return texture;
+	return g_Video.GetTextureManager().CreateTexture( TextureOwner::SURFACE );
 }
 
 void CVGUI1Surface::GetMousePos( int &x, int &y )
@@ -65,113 +94,118 @@ void CVGUI1Surface::GetMousePos( int &x, int &y )
 
 void CVGUI1Surface::drawSetColor( int r, int g, int b, int a )
 {
-	m_DrawColor[ 0 ] = r;
-	m_DrawColor[ 1 ] = g;
-	m_DrawColor[ 2 ] = b;
-	m_DrawColor[ 3 ] = a;
+	g_Video.GetCommandList().SetColor( r, g, b, a );
 }
 
 void CVGUI1Surface::drawFilledRect( int x0, int y0, int x1, int y1 )
 {
-	glDisable( GL_TEXTURE_2D );
-
-	glColor4ubv( m_DrawColor );
-
-	glBegin( GL_TRIANGLE_STRIP );
-
-		glVertex2f( static_cast<GLfloat>( x0 ), static_cast<GLfloat>( y0 ) );
-		glVertex2f( static_cast<GLfloat>( x1 ), static_cast<GLfloat>( y0 ) );
-		glVertex2f( static_cast<GLfloat>( x0 ), static_cast<GLfloat>( y1 ) );
-		glVertex2f( static_cast<GLfloat>( x1 ), static_cast<GLfloat>( y1 ) );
-
-	glEnd();
-
-	glEnable( GL_TEXTURE_2D );
+	g_Video.GetCommandList().FilledRect( x0, y0, x1, y1 );
 }
 
 void CVGUI1Surface::drawOutlinedRect( int x0, int y0, int x1, int y1 )
 {
-	glDisable( GL_TEXTURE_2D );
-
-	glColor4ubv( m_DrawColor );
-
-	glLineWidth( 1 );
-
-	glBegin( GL_LINE_STRIP );
-
-		glVertex2f( static_cast<GLfloat>( x0 ), static_cast<GLfloat>( y0 ) );
-		glVertex2f( static_cast<GLfloat>( x1 ), static_cast<GLfloat>( y0 ) );
-		glVertex2f( static_cast<GLfloat>( x1 ), static_cast<GLfloat>( y1 ) );
-		glVertex2f( static_cast<GLfloat>( x0 ), static_cast<GLfloat>( y1 ) );
-		glVertex2f( static_cast<GLfloat>( x0 ), static_cast<GLfloat>( y0 ) );
-
-	glEnd();
-
-	glEnable( GL_TEXTURE_2D );
+	g_Video.GetCommandList().OutlinedRect( x0, y0, x1, y1 );
 }
 
 void CVGUI1Surface::drawSetTextFont( vgui::Font* font )
 {
-	//TODO
+	m_pTextFont = font;
 }
 
 void CVGUI1Surface::drawSetTextColor( int r, int g, int b, int a )
 {
-	//TODO
+	m_ubTextColor[ 0 ] = static_cast<uint8_t>( r );
+	m_ubTextColor[ 1 ] = static_cast<uint8_t>( g );
+	m_ubTextColor[ 2 ] = static_cast<uint8_t>( b );
+	m_ubTextColor[ 3 ] = static_cast<uint8_t>( a );
 }
 
 void CVGUI1Surface::drawSetTextPos( int x, int y )
 {
-	//TODO
+	m_iTextX = x;
+	m_iTextY = y;
 }
 
 void CVGUI1Surface::drawPrintText( const char* text, int textLen )
 {
-	//TODO
+	if( !m_pTextFont || !text )
+		return;
+
+	auto& list = g_Video.GetCommandList();
+
+	m_TextGlyphs.clear();
+
+	for( int iIndex = 0; iIndex < textLen && text[ iIndex ]; ++iIndex )
+	{
+		const auto& glyph = m_GlyphCache.GetGlyph( *m_pTextFont, static_cast<uint8_t>( text[ iIndex ] ), list );
+
+		if( glyph.iTexture )
+		{
+			const int x = m_iTextX + glyph.iA;
+
+			m_TextGlyphs.push_back( { glyph.iTexture, x, m_iTextY, x + glyph.iB, m_iTextY + glyph.iTall } );
+		}
+
+		m_iTextX += glyph.iA + glyph.iB + glyph.iC;
+	}
+
+	//The whole string is one command, the renderer batches its quads by atlas page.
+	if( !m_TextGlyphs.empty() )
+		list.Text( m_ubTextColor[ 0 ], m_ubTextColor[ 1 ], m_ubTextColor[ 2 ], m_ubTextColor[ 3 ], m_TextGlyphs.data(), m_TextGlyphs.size() );
 }
 
 void CVGUI1Surface::drawSetTextureRGBA( int id, const char* rgba, int wide, int tall )
 {
-	glBindTexture( GL_TEXTURE_2D, id );
-
-	glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, wide, tall, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba );
-	glTexEnvf( GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_MODULATE );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST );
-	glTexParameteri( GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST );
+	g_Video.GetCommandList().UploadTexture( id, rgba, wide, tall );
+	g_Video.GetTextureManager().SetImageUploaded( id, wide, tall );
 }
 
 void CVGUI1Surface::drawSetTexture( int id )
 {
-	m_CurrentTexture = id;
-
-	glBindTexture( GL_TEXTURE_2D, id );
+	g_Video.GetCommandList().BindTexture( id );
+	g_Video.GetTextureManager().MarkUsed( id );
 }
 
 void CVGUI1Surface::drawTexturedRect( int x0, int y0, int x1, int y1 )
 {
-	if( m_CurrentTexture == 0 )
-		return;
+	g_Video.GetCommandList().TexturedRect( x0, y0, x1, y1 );
+}
 
-	glBegin( GL_TRIANGLE_STRIP );
+void CVGUI1Surface::invalidate( vgui::Panel *panel )
+{
+	if( m_bPainting || !panel )
+		return;
 
-		glTexCoord2f( 0, 0 );
-		glVertex2i( x0, y0 );
+	//Cached panels have to redraw if anything inside them changes.
+	for( auto pParent = panel; pParent; pParent = pParent->getParent() )
+	{
+		if( auto pCached = dynamic_cast<CCachedPanel*>( pParent ) )
+			pCached->MarkCacheDirty();
+	}
 
-		glTexCoord2f( 1, 0 );
-		glVertex2i( x1, y0 );
+	int x0, y0, x1, y1;
 
-		glTexCoord2f( 0, 1 );
-		glVertex2i( x0, y1 );
+	panel->getAbsExtents( x0, y0, x1, y1 );
 
-		glTexCoord2f( 1, 1 );
-		glVertex2i( x1, y1 );
+	if( x0 >= x1 || y0 >= y1 )
+		return;
 
-	glEnd();
-}
+	if( m_bDirty )
+	{
+		m_iDirtyX0 = std::min( m_iDirtyX0, x0 );
+		m_iDirtyY0 = std::min( m_iDirtyY0, y0 );
+		m_iDirtyX1 = std::max( m_iDirtyX1, x1 );
+		m_iDirtyY1 = std::max( m_iDirtyY1, y1 );
+	}
+	else
+	{
+		m_iDirtyX0 = x0;
+		m_iDirtyY0 = y0;
+		m_iDirtyX1 = x1;
+		m_iDirtyY1 = y1;
 
-void CVGUI1Surface::invalidate( vgui::Panel *panel )
-{
-	//Nothing
+		m_bDirty = true;
+	}
 }
 
 void CVGUI1Surface::enableMouseCapture( bool state )
@@ -186,19 +220,12 @@ void CVGUI1Surface::setCursor( vgui::Cursor* cursor )
 
 void CVGUI1Surface::swapBuffers()
 {
-	glFinish();
-
-	SDL_GL_SwapWindow( g_Video.GetWindow() );
+	//No glFinish here, the swap synchronizes as needed. Waiting for the GPU would only add latency.
+	g_Video.SubmitFrame();
 }
 
 void CVGUI1Surface::pushMakeCurrent( vgui::Panel* panel, bool useInsets )
 {
-	glMatrixMode( GL_MODELVIEW );
-
-	glPushMatrix();
-
-	glLoadIdentity();
-
 	int x, y;
 
 	panel->getPos( x, y );
@@ -216,17 +243,12 @@ void CVGUI1Surface::pushMakeCurrent( vgui::Panel* panel, bool useInsets )
 		iYOffset += iYInset;
 	}
 
-	glTranslatef( 
-		static_cast<float>( iXOffset ), 
-		static_cast<float>( iYOffset ), 
-		0 );
+	g_Video.GetCommandList().PushTranslation( iXOffset, iYOffset );
 }
 
 void CVGUI1Surface::popMakeCurrent( vgui::Panel* panel )
 {
-	glMatrixMode( GL_MODELVIEW );
-
-	glPopMatrix();
+	g_Video.GetCommandList().PopTranslation();
 }
 
 void CVGUI1Surface::applyChanges()
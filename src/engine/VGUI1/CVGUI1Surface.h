@@ -1,15 +1,40 @@
 #ifndef ENGINE_VGUI1_CVGUI1SURFACE_H
 #define ENGINE_VGUI1_CVGUI1SURFACE_H
 
-#include <GL/glew.h>
+#include <cstdint>
+#include <vector>
 
 #include <VGUI_SurfaceBase.h>
 
+#include "CRenderCommandList.h"
+
+#include "CGlyphCache.h"
+
 class CVGUI1Surface : public vgui::SurfaceBase
 {
 public:
 	using SurfaceBase::SurfaceBase;
 
+	/**
+	*	Gets the area covered by panels that were invalidated since the last call, and forgets it.
+	*	@return Whether anything was invalidated.
+	*/
+	bool TakeDirtyRect( int& x0, int& y0, int& x1, int& y1 );
+
+	/**
+	*	Marks the whole screen as needing a repaint.
+	*/
+	void InvalidateAll();
+
+	/**
+	*	Sets whether the surface is painting. Panels invalidated while painting are ignored,
+	*	since they are painted in that same pass.
+	*/
+	void SetPainting( const bool bPainting )
+	{
+		m_bPainting = bPainting;
+	}
+
 	void setTitle( const char* title ) override;
 	bool setFullscreenMode( int wide, int tall, int bpp ) override;
 	void setWindowedMode() override;
@@ -39,9 +64,28 @@ public:
 	void applyChanges() override;
 
 private:
-	GLuint m_CurrentTexture = 0;
+	bool m_bDirty = false;
+
+	int m_iDirtyX0 = 0;
+	int m_iDirtyY0 = 0;
+	int m_iDirtyX1 = 0;
+	int m_iDirtyY1 = 0;
+
+	bool m_bPainting = false;
+
+	CGlyphCache m_GlyphCache;
+
+	vgui::Font* m_pTextFont = nullptr;
+
+	uint8_t m_ubTextColor[ 4 ] = { 255, 255, 255, 255 };
+
+	int m_iTextX = 0;
+	int m_iTextY = 0;
 
-	uchar m_DrawColor[ 4 ];
+	/**
+	*	Glyphs of the string being drawn.
+	*/
+	std::vector<CRenderCommandList::Glyph_t> m_TextGlyphs;
 };
 
 #endif //ENGINE_VGUI1_CVGUI1SURFACE_H
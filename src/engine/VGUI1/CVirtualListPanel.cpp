@@ -0,0 +1,173 @@
+#include <algorithm>
+
+#include <VGUI_ScrollBar.h>
+
+#include "CVirtualListPanel.h"
+
+const int CVirtualListPanel::SCROLLBAR_WIDE;
+const int CVirtualListPanel::WHEEL_ROWS;
+
+void CVirtualListPanel::CScrollHandler::intChanged( int value, vgui::Panel* )
+{
+	m_List.SetScroll( value );
+}
+
+void CVirtualListPanel::CScrollHandler::mouseWheeled( int delta, vgui::Panel* )
+{
+	m_List.SetScroll( m_List.GetScroll() - delta * WHEEL_ROWS * m_List.GetRowTall() );
+}
+
+CVirtualListPanel::CVirtualListPanel( int x, int y, int wide, int tall, int iRowTall )
+	: vgui::Panel( x, y, wide, tall )
+	, m_iRowTall( std::max( 1, iRowTall ) )
+{
+	m_pClient = new vgui::Panel( 0, 0, std::max( 0, wide - SCROLLBAR_WIDE ), tall );
+
+	m_pClient->setParent( this );
+	m_pClient->setPaintBorderEnabled( false );
+	m_pClient->setPaintBackgroundEnabled( false );
+	m_pClient->setPaintEnabled( false );
+	m_pClient->addInputSignal( &m_ScrollHandler );
+
+	m_pScrollBar = new vgui::ScrollBar( std::max( 0, wide - SCROLLBAR_WIDE ), 0, SCROLLBAR_WIDE, tall, true );
+
+	m_pScrollBar->setParent( this );
+	m_pScrollBar->setRangeWindowEnabled( true );
+	m_pScrollBar->addIntChangeSignal( &m_ScrollHandler );
+}
+
+CVirtualListPanel::~CVirtualListPanel()
+{
+	//The panels can outlive the list, they mustn't call back into it.
+	m_pClient->removeInputSignal( &m_ScrollHandler );
+
+	for( auto& row : m_Rows )
+	{
+		row.pPanel->removeInputSignal( &m_ScrollHandler );
+	}
+}
+
+void CVirtualListPanel::SetRowCount( const int iCount )
+{
+	m_iRowCount = std::max( 0, iCount );
+
+	invalidateLayout( false );
+}
+
+void CVirtualListPanel::InvalidateRows()
+{
+	m_bRowsDirty = true;
+
+	invalidateLayout( false );
+}
+
+void CVirtualListPanel::SetScroll( const int iScroll )
+{
+	//The scroll bar reports back the value the layout gives it.
+	if( iScroll == m_iScroll )
+		return;
+
+	m_iScroll = iScroll;
+
+	invalidateLayout( false );
+}
+
+void CVirtualListPanel::ScrollToRow( const int iRow )
+{
+	int wide, tall;
+
+	m_pClient->getSize( wide, tall );
+
+	const int iTop = iRow * m_iRowTall;
+
+	if( iTop < m_iScroll )
+		SetScroll( iTop );
+	else if( iTop + m_iRowTall > m_iScroll + tall )
+		SetScroll( iTop + m_iRowTall - tall );
+}
+
+int CVirtualListPanel::GetRowOfPanel( vgui::Panel* pPanel ) const
+{
+	for( const auto& row : m_Rows )
+	{
+		if( row.pPanel == pPanel )
+			return row.iRow;
+	}
+
+	return -1;
+}
+
+void CVirtualListPanel::performLayout()
+{
+	int wide, tall;
+
+	getPaintSize( wide, tall );
+
+	const int iClientWide = std::max( 0, wide - SCROLLBAR_WIDE );
+
+	m_pClient->setBounds( 0, 0, iClientWide, tall );
+	m_pScrollBar->setBounds( iClientWide, 0, SCROLLBAR_WIDE, tall );
+
+	const int iMaxScroll = std::max( 0, m_iRowCount * m_iRowTall - tall );
+
+	m_iScroll = std::min( std::max( m_iScroll, 0 ), iMaxScroll );
+
+	m_pScrollBar->setRange( 0, iMaxScroll );
+	m_pScrollBar->setRangeWindow( tall );
+	m_pScrollBar->setValue( m_iScroll );
+
+	//A row more than fits, for the partial rows at the top and bottom.
+	const size_t uiPoolSize = static_cast<size_t>( std::min( m_iRowCount, std::max( 0, tall ) / m_iRowTall + 2 ) );
+
+	if( m_Rows.size() < uiPoolSize )
+	{
+		while( m_Rows.size() < uiPoolSize )
+		{
+			auto pPanel = CreateRow();
+
+			pPanel->setParent( m_pClient );
+			pPanel->addInputSignal( &m_ScrollHandler );
+
+			m_Rows.push_back( { pPanel, -1 } );
+		}
+
+		//Rows map to other panels now.
+		m_bRowsDirty = true;
+	}
+
+	const int iFirstRow = m_iScroll / m_iRowTall;
+	const int iEndRow = std::min( m_iRowCount, iFirstRow + static_cast<int>( uiPoolSize ) );
+
+	std::vector<bool> used( m_Rows.size(), false );
+
+	for( int iRow = iFirstRow; iRow < iEndRow; ++iRow )
+	{
+		const size_t uiIndex = static_cast<size_t>( iRow ) % m_Rows.size();
+
+		auto& row = m_Rows[ uiIndex ];
+
+		used[ uiIndex ] = true;
+
+		row.pPanel->setBounds( 0, iRow * m_iRowTall - m_iScroll, iClientWide, m_iRowTall );
+		row.pPanel->setVisible( true );
+
+		if( m_bRowsDirty || row.iRow != iRow )
+		{
+			row.iRow = iRow;
+			UpdateRow( row.pPanel, iRow );
+		}
+	}
+
+	for( size_t uiIndex = 0; uiIndex < m_Rows.size(); ++uiIndex )
+	{
+		if( !used[ uiIndex ] )
+		{
+			m_Rows[ uiIndex ].pPanel->setVisible( false );
+			m_Rows[ uiIndex ].iRow = -1;
+		}
+	}
+
+	m_bRowsDirty = false;
+
+	repaint();
+}
@@ -0,0 +1,145 @@
+#ifndef ENGINE_VGUI1_CVIRTUALLISTPANEL_H
+#define ENGINE_VGUI1_CVIRTUALLISTPANEL_H
+
+#include <vector>
+
+#include <VGUI_InputSignal.h>
+#include <VGUI_IntChangeSignal.h>
+#include <VGUI_Panel.h>
+
+namespace vgui
+{
+class ScrollBar;
+}
+
+/**
+*	Scrolling list of fixed height rows that only has panels for the rows that are visible.
+*	vgui::ListPanel creates a panel for every item and lays all of them out and asks all of them for hit testing,
+*	which gets slow with thousands of rows such as server browsers and large scoreboards.
+*	This keeps a pool of as many row panels as fit in the list, and fills them with the rows scrolled into view.
+*	A row keeps its panel while it stays in view, so scrolling by a row only fills one panel.
+*/
+class CVirtualListPanel : public vgui::Panel
+{
+public:
+	static const int SCROLLBAR_WIDE = 16;
+
+	/**
+	*	Number of rows the mouse wheel scrolls by.
+	*/
+	static const int WHEEL_ROWS = 3;
+
+	CVirtualListPanel( int x, int y, int wide, int tall, int iRowTall );
+	~CVirtualListPanel();
+
+	int GetRowTall() const { return m_iRowTall; }
+
+	int GetRowCount() const { return m_iRowCount; }
+
+	void SetRowCount( const int iCount );
+
+	/**
+	*	Fills the visible rows again, for when the rows' contents changed.
+	*/
+	void InvalidateRows();
+
+	/**
+	*	@return Scroll position in pixels.
+	*/
+	int GetScroll() const { return m_iScroll; }
+
+	void SetScroll( const int iScroll );
+
+	/**
+	*	Scrolls as little as possible to make a row visible.
+	*/
+	void ScrollToRow( const int iRow );
+
+	/**
+	*	@return Row that a row panel is showing, or -1 if the panel isn't one of the list's rows or is unused.
+	*/
+	int GetRowOfPanel( vgui::Panel* pPanel ) const;
+
+protected:
+	/**
+	*	Creates a panel for a row. Called when the list grows tall enough to show more rows than it has panels for.
+	*/
+	virtual vgui::Panel* CreateRow() = 0;
+
+	/**
+	*	Fills a row panel with a row's contents.
+	*/
+	virtual void UpdateRow( vgui::Panel* pPanel, const int iRow ) = 0;
+
+	void performLayout() override;
+
+private:
+	/**
+	*	Scrolls the list from its scroll bar, and from the mouse wheel over any of its rows.
+	*/
+	class CScrollHandler final : public vgui::IntChangeSignal, public vgui::InputSignal
+	{
+	public:
+		CScrollHandler( CVirtualListPanel& list )
+			: m_List( list )
+		{
+		}
+
+		void intChanged( int value, vgui::Panel* ) override;
+
+		void mouseWheeled( int delta, vgui::Panel* ) override;
+
+		void cursorMoved( int, int, vgui::Panel* ) override {}
+		void cursorEntered( vgui::Panel* ) override {}
+		void cursorExited( vgui::Panel* ) override {}
+		void mousePressed( vgui::MouseCode, vgui::Panel* ) override {}
+		void mouseDoublePressed( vgui::MouseCode, vgui::Panel* ) override {}
+		void mouseReleased( vgui::MouseCode, vgui::Panel* ) override {}
+		void keyPressed( vgui::KeyCode, vgui::Panel* ) override {}
+		void keyTyped( vgui::KeyCode, vgui::Panel* ) override {}
+		void keyReleased( vgui::KeyCode, vgui::Panel* ) override {}
+		void keyFocusTicked( vgui::Panel* ) override {}
+
+	private:
+		CVirtualListPanel& m_List;
+	};
+
+	struct Row_t
+	{
+		vgui::Panel* pPanel;
+
+		/**
+		*	Row the panel was last filled with, or -1.
+		*/
+		int iRow;
+	};
+
+private:
+	const int m_iRowTall;
+
+	int m_iRowCount = 0;
+
+	int m_iScroll = 0;
+
+	bool m_bRowsDirty = false;
+
+	CScrollHandler m_ScrollHandler{ *this };
+
+	/**
+	*	Clips the rows to the area next to the scroll bar.
+	*/
+	vgui::Panel* m_pClient;
+
+	vgui::ScrollBar* m_pScrollBar;
+
+	/**
+	*	Row panels. Row i is shown in panel i % m_Rows.size(), so the pool needs no bookkeeping when scrolling.
+	*/
+	std::vector<Row_t> m_Rows;
+
+private:
+	CVirtualListPanel( const CVirtualListPanel& ) = delete;
+	CVirtualListPanel& operator=( const CVirtualListPanel& ) = delete;
+};
+
+#endif //ENGINE_VGUI1_CVIRTUALLISTPANEL_H
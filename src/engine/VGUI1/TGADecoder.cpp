@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <utility>
+
+#include "CPUFeatures.h"
+
+#include "TGADecoder.h"
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <intrin.h>
+#include <tmmintrin.h>
+
+#define TGA_SSSE3
+#define TGA_TARGET_SSSE3
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <tmmintrin.h>
+
+#define TGA_SSSE3
+//Only the swizzle is compiled for SSSE3, so the rest runs on any CPU.
+#define TGA_TARGET_SSSE3 __attribute__( ( target( "ssse3" ) ) )
+#endif
+
+namespace
+{
+const size_t HEADER_SIZE = 18;
+
+/**
+*	Image types.
+*/
+const uint8_t TYPE_TRUE_COLOR = 2;
+const uint8_t TYPE_RLE_TRUE_COLOR = 10;
+
+/**
+*	Set in the image descriptor if rows are stored top down.
+*/
+const uint8_t DESCRIPTOR_TOP_DOWN = 1 << 5;
+
+/**
+*	Converts BGR or BGRA pixels to RGBA one at a time.
+*/
+template<size_t BYTES_PER_PIXEL>
+void SwizzleScalar( const uint8_t* pSrc, uint8_t* pDest, const size_t uiPixels, const uint8_t ubAlphaXor )
+{
+	for( size_t uiPixel = 0; uiPixel < uiPixels; ++uiPixel, pSrc += BYTES_PER_PIXEL, pDest += 4 )
+	{
+		pDest[ 0 ] = pSrc[ 2 ];
+		pDest[ 1 ] = pSrc[ 1 ];
+		pDest[ 2 ] = pSrc[ 0 ];
+		pDest[ 3 ] = ( BYTES_PER_PIXEL == 4 ? pSrc[ 3 ] : 255 ) ^ ubAlphaXor;
+	}
+}
+
+#ifdef TGA_SSSE3
+/**
+*	Converts 4 pixels per shuffle. Returns the number of pixels converted.
+*/
+template<size_t BYTES_PER_PIXEL>
+TGA_TARGET_SSSE3 size_t SwizzleSSSE3( const uint8_t* pSrc, uint8_t* pDest, const size_t uiPixels, const uint8_t ubAlphaXor )
+{
+	//Picks the blue, green and red bytes of each pixel in reverse order. 24 bit pixels get a zero alpha, which the OR fills in.
+	const __m128i mask = BYTES_PER_PIXEL == 4
+		? _mm_setr_epi8( 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15 )
+		: _mm_setr_epi8( 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1 );
+
+	const __m128i alphaOr = _mm_set1_epi32( BYTES_PER_PIXEL == 4 ? 0 : static_cast<int>( 0xFF000000u ) );
+	const __m128i alphaXor = _mm_set1_epi32( static_cast<int>( static_cast<uint32_t>( ubAlphaXor ) << 24 ) );
+
+	//Loads are 16 bytes, so 24 bit pixels need 4 bytes past the last pixel converted.
+	const size_t uiLoadPixels = ( 16 + BYTES_PER_PIXEL - 1 ) / BYTES_PER_PIXEL;
+
+	size_t uiPixel = 0;
+
+	for( ; uiPixels - uiPixel >= uiLoadPixels && uiPixels - uiPixel >= 4; uiPixel += 4 )
+	{
+		__m128i block = _mm_loadu_si128( reinterpret_cast<const __m128i*>( pSrc + uiPixel * BYTES_PER_PIXEL ) );
+
+		block = _mm_shuffle_epi8( block, mask );
+		block = _mm_xor_si128( _mm_or_si128( block, alphaOr ), alphaXor );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pDest + uiPixel * 4 ), block );
+	}
+
+	return uiPixel;
+}
+#endif
+
+template<size_t BYTES_PER_PIXEL>
+void Swizzle( const uint8_t* pSrc, uint8_t* pDest, const size_t uiPixels, const uint8_t ubAlphaXor )
+{
+	size_t uiConverted = 0;
+
+#ifdef TGA_SSSE3
+	if( IsTGASwizzleVectorized() )
+		uiConverted = SwizzleSSSE3<BYTES_PER_PIXEL>( pSrc, pDest, uiPixels, ubAlphaXor );
+#endif
+
+	//The rest, or everything if there's no shuffle.
+	SwizzleScalar<BYTES_PER_PIXEL>( pSrc + uiConverted * BYTES_PER_PIXEL, pDest + uiConverted * 4, uiPixels - uiConverted, ubAlphaXor );
+}
+}
+
+CTGAStreamDecoder::CTGAStreamDecoder( const bool bInvertAlpha )
+	: m_ubAlphaXor( bInvertAlpha ? 0xFF : 0 )
+{
+}
+
+CTGAStreamDecoder::Status CTGAStreamDecoder::Feed( const uint8_t* pData, const size_t uiSize )
+{
+	assert( pData || uiSize == 0 );
+
+	const uint8_t* const pEnd = pData + uiSize;
+
+	if( m_Status == Status::NEED_MORE_DATA && !m_bHasHeader )
+		ReadHeader( pData, pEnd );
+
+	if( m_Status == Status::NEED_MORE_DATA && m_bHasHeader )
+	{
+		if( m_bRLE )
+			ReadRLE( pData, pEnd );
+		else
+			ReadUncompressed( pData, pEnd );
+	}
+
+	return m_Status;
+}
+
+TGAImage_t CTGAStreamDecoder::TakeImage()
+{
+	assert( m_Status == Status::DONE );
+
+	return std::move( m_Image );
+}
+
+void CTGAStreamDecoder::GetDecodedRows( int& iFirstRow, int& iRowCount ) const
+{
+	iRowCount = m_iRowsDone;
+	iFirstRow = m_bTopDown ? 0 : m_Image.iHeight - m_iRowsDone;
+}
+
+void CTGAStreamDecoder::ReadHeader( const uint8_t*& pData, const uint8_t* pEnd )
+{
+	if( m_uiHeaderBytes < HEADER_SIZE )
+	{
+		const size_t uiCopy = std::min( HEADER_SIZE - m_uiHeaderBytes, static_cast<size_t>( pEnd - pData ) );
+
+		memcpy( m_ubHeader + m_uiHeaderBytes, pData, uiCopy );
+
+		m_uiHeaderBytes += uiCopy;
+		pData += uiCopy;
+
+		if( m_uiHeaderBytes < HEADER_SIZE )
+			return;
+
+		const uint8_t ubIDLength = m_ubHeader[ 0 ];
+		const uint8_t ubColorMapType = m_ubHeader[ 1 ];
+		const uint8_t ubImageType = m_ubHeader[ 2 ];
+
+		const int iWidth = m_ubHeader[ 12 ] | ( m_ubHeader[ 13 ] << 8 );
+		const int iHeight = m_ubHeader[ 14 ] | ( m_ubHeader[ 15 ] << 8 );
+
+		const uint8_t ubBitsPerPixel = m_ubHeader[ 16 ];
+		const uint8_t ubDescriptor = m_ubHeader[ 17 ];
+
+		if( ubColorMapType != 0 || ( ubImageType != TYPE_TRUE_COLOR && ubImageType != TYPE_RLE_TRUE_COLOR )
+			|| ( ubBitsPerPixel != 24 && ubBitsPerPixel != 32 ) )
+		{
+			m_Status = Status::UNSUPPORTED;
+			return;
+		}
+
+		if( iWidth <= 0 || iHeight <= 0 )
+		{
+			m_Status = Status::FAILED;
+			return;
+		}
+
+		m_bRLE = ubImageType == TYPE_RLE_TRUE_COLOR;
+		m_bTopDown = ( ubDescriptor & DESCRIPTOR_TOP_DOWN ) != 0;
+		m_uiBytesPerPixel = ubBitsPerPixel / 8;
+
+		m_uiSkipBytes = ubIDLength;
+
+		m_Image.iWidth = iWidth;
+		m_Image.iHeight = iHeight;
+	}
+
+	const size_t uiSkip = std::min( m_uiSkipBytes, static_cast<size_t>( pEnd - pData ) );
+
+	pData += uiSkip;
+	m_uiSkipBytes -= uiSkip;
+
+	if( m_uiSkipBytes > 0 )
+		return;
+
+	const size_t uiPixels = static_cast<size_t>( m_Image.iWidth ) * m_Image.iHeight;
+
+	m_Image.rgba.resize( uiPixels * 4 );
+	m_Row.resize( static_cast<size_t>( m_Image.iWidth ) * m_uiBytesPerPixel );
+
+	m_uiPixelsLeft = uiPixels;
+
+	m_bHasHeader = true;
+}
+
+void CTGAStreamDecoder::ReadUncompressed( const uint8_t*& pData, const uint8_t* pEnd )
+{
+	const size_t uiRowSize = m_Row.size();
+
+	while( m_Status == Status::NEED_MORE_DATA && pData != pEnd )
+	{
+		//Whole rows are converted straight from the data.
+		if( m_uiRowBytes == 0 && static_cast<size_t>( pEnd - pData ) >= uiRowSize )
+		{
+			FinishRow( pData );
+			pData += uiRowSize;
+			continue;
+		}
+
+		const size_t uiCopy = std::min( uiRowSize - m_uiRowBytes, static_cast<size_t>( pEnd - pData ) );
+
+		memcpy( m_Row.data() + m_uiRowBytes, pData, uiCopy );
+
+		m_uiRowBytes += uiCopy;
+		pData += uiCopy;
+
+		if( m_uiRowBytes == uiRowSize )
+		{
+			m_uiRowBytes = 0;
+			FinishRow( m_Row.data() );
+		}
+	}
+}
+
+void CTGAStreamDecoder::ReadRLE( const uint8_t*& pData, const uint8_t* pEnd )
+{
+	const size_t uiRowSize = m_Row.size();
+
+	while( m_Status == Status::NEED_MORE_DATA )
+	{
+		if( m_uiPacketRemaining == 0 )
+		{
+			if( pData == pEnd )
+				return;
+
+			const uint8_t ubPacket = *pData++;
+
+			//Packets can cross rows, but not the end of the image.
+			const size_t uiCount = ( ubPacket & 0x7F ) + 1u;
+
+			if( uiCount > m_uiPixelsLeft )
+			{
+				m_Status = Status::FAILED;
+				return;
+			}
+
+			m_uiPixelsLeft -= uiCount;
+
+			m_bRepeatPacket = ( ubPacket & 0x80 ) != 0;
+			m_uiPacketRemaining = m_bRepeatPacket ? uiCount : uiCount * m_uiBytesPerPixel;
+			m_uiRepeatBytes = 0;
+		}
+
+		if( m_bRepeatPacket )
+		{
+			//The repeated pixel can be split between pieces.
+			if( m_uiRepeatBytes < m_uiBytesPerPixel )
+			{
+				const size_t uiCopy = std::min( m_uiBytesPerPixel - m_uiRepeatBytes, static_cast<size_t>( pEnd - pData ) );
+
+				memcpy( m_ubRepeatPixel + m_uiRepeatBytes, pData, uiCopy );
+
+				m_uiRepeatBytes += uiCopy;
+				pData += uiCopy;
+
+				if( m_uiRepeatBytes < m_uiBytesPerPixel )
+					return;
+			}
+
+			const size_t uiCount = std::min( m_uiPacketRemaining, ( uiRowSize - m_uiRowBytes ) / m_uiBytesPerPixel );
+
+			for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex, m_uiRowBytes += m_uiBytesPerPixel )
+			{
+				memcpy( m_Row.data() + m_uiRowBytes, m_ubRepeatPixel, m_uiBytesPerPixel );
+			}
+
+			m_uiPacketRemaining -= uiCount;
+		}
+		else
+		{
+			if( pData == pEnd )
+				return;
+
+			const size_t uiCopy = std::min( { m_uiPacketRemaining, uiRowSize - m_uiRowBytes, static_cast<size_t>( pEnd - pData ) } );
+
+			memcpy( m_Row.data() + m_uiRowBytes, pData, uiCopy );
+
+			m_uiRowBytes += uiCopy;
+			m_uiPacketRemaining -= uiCopy;
+			pData += uiCopy;
+		}
+
+		if( m_uiRowBytes == uiRowSize )
+		{
+			m_uiRowBytes = 0;
+			FinishRow( m_Row.data() );
+		}
+	}
+}
+
+void CTGAStreamDecoder::FinishRow( const uint8_t* pSrc )
+{
+	const int iHeight = m_Image.iHeight;
+	const size_t uiDestRowSize = static_cast<size_t>( m_Image.iWidth ) * 4;
+
+	uint8_t* const pDest = m_Image.rgba.data() + ( m_bTopDown ? m_iRowsDone : iHeight - 1 - m_iRowsDone ) * uiDestRowSize;
+
+	if( m_uiBytesPerPixel == 4 )
+		Swizzle<4>( pSrc, pDest, m_Image.iWidth, m_ubAlphaXor );
+	else
+		Swizzle<3>( pSrc, pDest, m_Image.iWidth, m_ubAlphaXor );
+
+	if( ++m_iRowsDone == iHeight )
+		m_Status = Status::DONE;
+}
+
+bool DecodeTGA( const uint8_t* pData, const size_t uiSize, const bool bInvertAlpha, TGAImage_t& image )
+{
+	CTGAStreamDecoder decoder( bInvertAlpha );
+
+	if( decoder.Feed( pData, uiSize ) != CTGAStreamDecoder::Status::DONE )
+		return false;
+
+	image = decoder.TakeImage();
+
+	return true;
+}
+
+bool IsTGASwizzleVectorized()
+{
+#ifdef TGA_SSSE3
+	return Plat_HasCPUFeatures( CPUFeature::SSSE3 );
+#else
+	return false;
+#endif
+}
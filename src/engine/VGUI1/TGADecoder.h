@@ -0,0 +1,163 @@
+#ifndef ENGINE_VGUI1_TGADECODER_H
+#define ENGINE_VGUI1_TGADECODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+*	@file
+*	Decodes TGA images straight from memory, instead of through VGUI's per byte input stream.
+*	Data can be decoded in place, from a mapped pack file entry for instance, or streamed in as it's read.
+*/
+
+/**
+*	Decoded image. Rows are stored top down.
+*/
+struct TGAImage_t
+{
+	int iWidth = 0;
+	int iHeight = 0;
+
+	std::vector<uint8_t> rgba;
+};
+
+/**
+*	Decodes a TGA image from data that arrives in pieces. Each piece is consumed as it's fed, so nothing has to be buffered
+*	besides a partial row and the image itself. Rows can be used as soon as they're decoded.
+*	Supports the same images as DecodeTGA.
+*/
+class CTGAStreamDecoder final
+{
+public:
+	enum class Status
+	{
+		/**
+		*	The image isn't complete yet.
+		*/
+		NEED_MORE_DATA,
+
+		DONE,
+
+		/**
+		*	The image type isn't supported. The data can be given to another loader.
+		*/
+		UNSUPPORTED,
+
+		/**
+		*	The data is corrupt.
+		*/
+		FAILED
+	};
+
+public:
+	/**
+	*	@param bInvertAlpha Whether to store 255 - alpha, like vgui::BitmapTGA does.
+	*/
+	CTGAStreamDecoder( const bool bInvertAlpha );
+
+	/**
+	*	Decodes the next piece of the file. Pieces must be fed in order. Data past the end of the image is ignored.
+	*	@return The status after decoding the piece.
+	*/
+	Status Feed( const uint8_t* pData, const size_t uiSize );
+
+	Status GetStatus() const { return m_Status; }
+
+	/**
+	*	@return Whether the header was read. The image's size is known and its pixels are allocated from then on.
+	*/
+	bool HasHeader() const { return m_bHasHeader; }
+
+	/**
+	*	Image being decoded. Only rows reported by GetDecodedRows are valid until the image is done.
+	*/
+	const TGAImage_t& GetImage() const { return m_Image; }
+
+	/**
+	*	Moves the image out of the decoder. Only valid once the image is done.
+	*/
+	TGAImage_t TakeImage();
+
+	/**
+	*	Gets the rows that have been decoded, in top down order. Bottom up images are filled from the bottom.
+	*/
+	void GetDecodedRows( int& iFirstRow, int& iRowCount ) const;
+
+private:
+	/**
+	*	Collects and parses the header, and skips the image ID.
+	*/
+	void ReadHeader( const uint8_t*& pData, const uint8_t* pEnd );
+
+	void ReadUncompressed( const uint8_t*& pData, const uint8_t* pEnd );
+
+	void ReadRLE( const uint8_t*& pData, const uint8_t* pEnd );
+
+	/**
+	*	Converts a row of source pixels into the image.
+	*/
+	void FinishRow( const uint8_t* pSrc );
+
+private:
+	const uint8_t m_ubAlphaXor;
+
+	Status m_Status = Status::NEED_MORE_DATA;
+
+	bool m_bHasHeader = false;
+
+	uint8_t m_ubHeader[ 18 ];
+	size_t m_uiHeaderBytes = 0;
+
+	/**
+	*	Bytes of the image ID left to skip.
+	*/
+	size_t m_uiSkipBytes = 0;
+
+	bool m_bRLE = false;
+	bool m_bTopDown = false;
+
+	size_t m_uiBytesPerPixel = 0;
+
+	/**
+	*	Source pixels of the row being decoded, for rows that span pieces or are run length encoded.
+	*/
+	std::vector<uint8_t> m_Row;
+	size_t m_uiRowBytes = 0;
+
+	int m_iRowsDone = 0;
+
+	/**
+	*	State of the current run length packet. Repeated pixels are counted in pixels, raw ones in bytes.
+	*/
+	size_t m_uiPacketRemaining = 0;
+	bool m_bRepeatPacket = false;
+
+	uint8_t m_ubRepeatPixel[ 4 ];
+	size_t m_uiRepeatBytes = 0;
+
+	/**
+	*	Pixels left in the image that packets can still cover.
+	*/
+	size_t m_uiPixelsLeft = 0;
+
+	TGAImage_t m_Image;
+
+private:
+	CTGAStreamDecoder( const CTGAStreamDecoder& ) = delete;
+	CTGAStreamDecoder& operator=( const CTGAStreamDecoder& ) = delete;
+};
+
+/**
+*	Decodes a 24 or 32 bit true color TGA image, uncompressed or run length encoded.
+*	@param bInvertAlpha Whether to store 255 - alpha, like vgui::BitmapTGA does. 24 bit images have an alpha of 255 before inverting.
+*	@return Whether the image was decoded. Fails for other image types and for truncated data.
+*/
+bool DecodeTGA( const uint8_t* pData, const size_t uiSize, const bool bInvertAlpha, TGAImage_t& image );
+
+/**
+*	@return Whether pixels are converted with SSSE3 shuffles.
+*/
+bool IsTGASwizzleVectorized();
+
+#endif //ENGINE_VGUI1_TGADECODER_H
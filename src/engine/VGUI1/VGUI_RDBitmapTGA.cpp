@@ -1,11 +1,18 @@
+#include <cmath>
+
 #include "Engine.h"
 
 #include "VGUI_RDBitmapTGA.h"
 
 namespace vgui
 {
+const int RDBitmapTGA::SCALE_SHIFT;
+const int64_t RDBitmapTGA::ROUNDING_TOLERANCE;
+
 void RDBitmapTGA::drawFilledRect( int x0, int y0, int x1, int y1 )
 {
+	UpdateScale();
+
 	BitmapTGA::drawFilledRect( 
 		ScaleX( x0 ),
 		ScaleY( y0 ),
@@ -15,6 +22,8 @@ void RDBitmapTGA::drawFilledRect( int x0, int y0, int x1, int y1 )
 
 void RDBitmapTGA::drawOutlinedRect( int x0, int y0, int x1, int y1 )
 {
+	UpdateScale();
+
 	BitmapTGA::drawOutlinedRect(
 		ScaleX( x0 ),
 		ScaleY( y0 ),
@@ -24,6 +33,8 @@ void RDBitmapTGA::drawOutlinedRect( int x0, int y0, int x1, int y1 )
 
 void RDBitmapTGA::drawSetTextPos( int x, int y )
 {
+	UpdateScale();
+
 	BitmapTGA::drawSetTextPos(
 		ScaleX( x ),
 		ScaleY( y ) );
@@ -31,6 +42,8 @@ void RDBitmapTGA::drawSetTextPos( int x, int y )
 
 void RDBitmapTGA::drawPrintText( int x, int y, const char* str, int strlen )
 {
+	UpdateScale();
+
 	BitmapTGA::drawPrintText(
 		ScaleX( x ),
 		ScaleY( y ),
@@ -40,6 +53,8 @@ void RDBitmapTGA::drawPrintText( int x, int y, const char* str, int strlen )
 
 void RDBitmapTGA::drawPrintChar( int x, int y, char ch )
 {
+	UpdateScale();
+
 	BitmapTGA::drawPrintChar(
 		ScaleX( x ),
 		ScaleY( y ),
@@ -48,6 +63,8 @@ void RDBitmapTGA::drawPrintChar( int x, int y, char ch )
 
 void RDBitmapTGA::drawTexturedRect( int x0, int y0, int x1, int y1 )
 {
+	UpdateScale();
+
 	BitmapTGA::drawTexturedRect( 
 		ScaleX( x0 ),
 		ScaleY( y0 ),
@@ -55,13 +72,20 @@ void RDBitmapTGA::drawTexturedRect( int x0, int y0, int x1, int y1 )
 		ScaleY( y1 ) );
 }
 
-int RDBitmapTGA::ScaleX( int iX ) const
+void RDBitmapTGA::UpdateScale()
 {
-	return static_cast<int>( ceil( iX * g_Video.GetXScale() * m_flXScale ) );
-}
+	const float flVideoXScale = g_Video.GetXScale();
+	const float flVideoYScale = g_Video.GetYScale();
 
-int RDBitmapTGA::ScaleY( int iY ) const
-{
-	return static_cast<int>( ceil( iY * g_Video.GetYScale() * m_flYScale ) );
+	if( !m_bScaleDirty && flVideoXScale == m_flVideoXScale && flVideoYScale == m_flVideoYScale )
+		return;
+
+	m_flVideoXScale = flVideoXScale;
+	m_flVideoYScale = flVideoYScale;
+
+	m_iXScale = llround( static_cast<double>( flVideoXScale ) * m_flXScale * ( int64_t( 1 ) << SCALE_SHIFT ) );
+	m_iYScale = llround( static_cast<double>( flVideoYScale ) * m_flYScale * ( int64_t( 1 ) << SCALE_SHIFT ) );
+
+	m_bScaleDirty = false;
 }
 }
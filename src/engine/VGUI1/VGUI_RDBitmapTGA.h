@@ -1,6 +1,8 @@
 #ifndef ENGINE_VGUI1_VGUI_RDBITMAPTGA_H
 #define ENGINE_VGUI1_VGUI_RDBITMAPTGA_H
 
+#include <cstdint>
+
 #include <VGUI_BitmapTGA.h>
 
 namespace vgui
@@ -18,6 +20,7 @@ public:
 	void SetXScale( float flX )
 	{
 		m_flXScale = flX;
+		m_bScaleDirty = true;
 	}
 
 	float GetYScale() const { return m_flYScale; }
@@ -25,6 +28,7 @@ public:
 	void SetYScale( float flY )
 	{
 		m_flYScale = flY;
+		m_bScaleDirty = true;
 	}
 
 protected:
@@ -35,12 +39,52 @@ protected:
 	void drawPrintChar( int x, int y, char ch ) override;
 	void drawTexturedRect( int x0, int y0, int x1, int y1 ) override;
 
-	int ScaleX( int iX ) const;
-	int ScaleY( int iY ) const;
+	/**
+	*	Recomputes the combined scales if this bitmap's scale or the resolution changed. Called once per draw call.
+	*/
+	void UpdateScale();
+
+	int ScaleX( int iX ) const { return Scale( iX, m_iXScale ); }
+	int ScaleY( int iY ) const { return Scale( iY, m_iYScale ); }
+
+private:
+	/**
+	*	Number of fractional bits in the combined scales.
+	*/
+	static const int SCALE_SHIFT = 32;
+
+	/**
+	*	Results this close above a whole number are rounded down to it. Scales like 0.8 can't be represented exactly,
+	*	and shouldn't make exact results round up.
+	*/
+	static const int64_t ROUNDING_TOLERANCE = int64_t( 1 ) << ( SCALE_SHIFT - 12 );
+
+	/**
+	*	Scales a coordinate and rounds it up.
+	*/
+	static int Scale( int iValue, int64_t iScale )
+	{
+		//Adding just under one before shifting rounds up, for negative values too.
+		return static_cast<int>( ( iValue * iScale + ( ( int64_t( 1 ) << SCALE_SHIFT ) - 1 - ROUNDING_TOLERANCE ) ) >> SCALE_SHIFT );
+	}
 
 private:
 	float m_flXScale = 1;
 	float m_flYScale = 1;
+
+	/**
+	*	Resolution scale times this bitmap's scale, in fixed point.
+	*/
+	int64_t m_iXScale = int64_t( 1 ) << SCALE_SHIFT;
+	int64_t m_iYScale = int64_t( 1 ) << SCALE_SHIFT;
+
+	/**
+	*	Resolution scale that the combined scales were computed with.
+	*/
+	float m_flVideoXScale = 1;
+	float m_flVideoYScale = 1;
+
+	bool m_bScaleDirty = true;
 };
 }
 
@@ -5,8 +5,11 @@
 // $NoKeywords: $
 //=============================================================================
 
+#include <climits>
 #include <cstdio>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #include "VGUI.h"
 #include "vgui_loadtga.h"
@@ -16,9 +19,9 @@
 #include "FileSystem2.h"
 
 #include "Engine.h"
+#include "TextureFile.h"
 
-#include "CFile.h"
-
+#include "VGUI1/TGADecoder.h"
 #include "VGUI1/VGUI_RDBitmapTGA.h"
 
 
@@ -72,32 +75,168 @@ public:
 	int			m_ReadPos;
 };
 
+/**
+*	Bitmap that draws a cached image. The pixels and the texture are shared with every other bitmap of the same image.
+*/
+template<typename BASE>
+class CDecodedBitmapTGA : public BASE
+{
+public:
+	CDecodedBitmapTGA( const ImageHandle_t& image )
+		: BASE( GetEmptyStream(), false )
+		, m_Image( image )
+	{
+		//Bitmap::setSize would allocate a copy of the pixels.
+		this->vgui::Image::setSize( image->image.iWidth, image->image.iHeight );
+
+		//Only read when the image is uploaded. Images loaded from texture files have no pixels here, but it has to be non-null to draw.
+		if( !image->textureFile.empty() )
+			this->_rgba = const_cast<uchar*>( image->textureFile.data() );
+		else
+			this->_rgba = const_cast<uchar*>( image->image.rgba.data() );
+	}
+
+protected:
+	//Draw with the image's texture instead of this bitmap's own.
+	void drawSetTextureRGBA( int, const char*, int, int ) override
+	{
+		Upload();
+	}
+
+	void drawSetTexture( int ) override
+	{
+		//Uploaded again if the texture manager evicted it.
+		Upload();
+
+		BASE::drawSetTexture( m_Image->iTexture );
+	}
+
+private:
+	/**
+	*	The base class loads from a stream, give it one with nothing in it.
+	*/
+	static vgui::InputStream* GetEmptyStream()
+	{
+		static MemoryInputStream stream;
+
+		return &stream;
+	}
+
+	void Upload()
+	{
+		auto& textures = g_Video.GetTextureManager();
+
+		if( !m_Image->iTexture )
+		{
+			auto pImage = m_Image.get();
+
+			//The image frees the texture when it's destroyed, so it outlives the callback.
+			m_Image->iTexture = textures.CreateTexture( TextureOwner::IMAGE, [ pImage ] { pImage->bUploaded = false; } );
+		}
+
+		if( m_Image->bUploaded )
+			return;
+
+		if( !m_Image->textureFile.empty() )
+		{
+			g_Video.GetCommandList().UploadTextureFile( m_Image->iTexture, m_Image->textureFile.data(), m_Image->textureFile.size() );
+			textures.SetUploaded( m_Image->iTexture, m_Image->textureFile.size() );
+		}
+		else
+		{
+			BASE::drawSetTextureRGBA( m_Image->iTexture, reinterpret_cast<const char*>( m_Image->image.rgba.data() ), m_Image->image.iWidth, m_Image->image.iHeight );
+		}
+
+		m_Image->bUploaded = true;
+	}
+
+private:
+	ImageHandle_t m_Image;
+};
+
 vgui::BitmapTGA* vgui_LoadTGA( char const *pFilename, const bool bInvertAlpha, const bool bResolutionDependent )
 {
-	CFile file( pFilename, "rb" );
+	auto& cache = g_Engine.GetAssetCache();
 
-	if( !file )
+	if( auto cached = cache.FindImage( pFilename, bInvertAlpha ) )
+		return vgui_CreateTGA( cached, bResolutionDependent );
+
+	uint64_t uiSize;
+
+	if( g_Video.GetRenderer().IsCompressedTextureSupported() )
+	{
+		std::vector<uint8_t> textureFile;
+
+		auto pfnAllocateVector = []( uint64_t uiSize, void* pContext ) -> void*
+		{
+			if( uiSize > static_cast<uint64_t>( INT_MAX ) )
+				return nullptr;
+
+			auto& textureFile = *reinterpret_cast<std::vector<uint8_t>*>( pContext );
+
+			textureFile.resize( static_cast<size_t>( uiSize ) );
+
+			return textureFile.data();
+		};
+
+		const auto szTextureFileName = texfile::GetTextureFileName( pFilename );
+
+		if( g_pFileSystem->LoadFile( szTextureFileName.c_str(), nullptr, pfnAllocateVector, &textureFile, &uiSize ) )
+		{
+			if( auto cached = cache.AddTextureFile( pFilename, bInvertAlpha, std::move( textureFile ) ) )
+				return vgui_CreateTGA( cached, bResolutionDependent );
+		}
+	}
+
+	FileHandle_t hFile = g_pFileSystem->Open( pFilename, "rb" );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
 		return nullptr;
 
-	const auto size = file.Size();
+	//Mapped pack file entries are decoded in place, anything else is read into a buffer owned by the filesystem.
+	int iSize;
 
-	auto data = std::make_unique<uchar[]>( size );
+	auto pData = reinterpret_cast<uchar*>( g_pFileSystem->GetReadBuffer( hFile, &iSize, false ) );
 
-	if( file.Read( data.get(), size ) != size )
+	if( !pData )
+	{
+		g_pFileSystem->Close( hFile );
 		return nullptr;
+	}
 
-	MemoryInputStream stream;
-	
-	stream.m_pData = data.get();
-	stream.m_ReadPos = 0;
-	stream.m_DataLen = size;
+	vgui::BitmapTGA *pRet = nullptr;
 
-	vgui::BitmapTGA *pRet;
-	
-	if( bResolutionDependent )
-		pRet = new vgui::RDBitmapTGA( &stream, bInvertAlpha );
+	CTGAStreamDecoder decoder( bInvertAlpha );
+
+	const auto status = decoder.Feed( pData, static_cast<size_t>( iSize ) );
+
+	if( status == CTGAStreamDecoder::Status::DONE )
+		pRet = vgui_CreateTGA( cache.AddImage( pFilename, bInvertAlpha, decoder.TakeImage() ), bResolutionDependent );
 	else
-		pRet = new vgui::BitmapTGA( &stream, bInvertAlpha );
-	
+	{
+		//Color mapped and grayscale images are left to VGUI.
+		MemoryInputStream stream;
+
+		stream.m_pData = pData;
+		stream.m_ReadPos = 0;
+		stream.m_DataLen = iSize;
+
+		if( bResolutionDependent )
+			pRet = new vgui::RDBitmapTGA( &stream, bInvertAlpha );
+		else
+			pRet = new vgui::BitmapTGA( &stream, bInvertAlpha );
+	}
+
+	g_pFileSystem->ReleaseReadBuffer( hFile, pData );
+	g_pFileSystem->Close( hFile );
+
 	return pRet;
 }
+
+vgui::BitmapTGA* vgui_CreateTGA( const ImageHandle_t& image, const bool bResolutionDependent )
+{
+	if( bResolutionDependent )
+		return new CDecodedBitmapTGA<vgui::RDBitmapTGA>( image );
+	else
+		return new CDecodedBitmapTGA<vgui::BitmapTGA>( image );
+}
@@ -14,6 +14,8 @@
 
 #include "VGUI_BitmapTGA.h"
 
+#include "CAssetCache.h"
+
 /**
 *	@file
 *	Modified to load TGA files without using the engine API. - Solokiller
@@ -21,5 +23,10 @@
 
 vgui::BitmapTGA* vgui_LoadTGA( char const *pFilename, const bool bInvertAlpha = true, const bool bResolutionDependent = false );
 
+/**
+*	Creates a bitmap that draws a cached image, like the ones CAssetLoader loads. The bitmap keeps the image referenced.
+*/
+vgui::BitmapTGA* vgui_CreateTGA( const ImageHandle_t& image, const bool bResolutionDependent = false );
+
 
 #endif // VGUI_LOADTGA_H
@@ -0,0 +1,425 @@
+/**
+*	@file
+*	BSP loading microbenchmarks. Writes a synthetic map into a pack file, and compares loading it with CBSPFile
+*	against reading the whole file into memory and copying each lump out of it.
+*	Usage: bench_bsp [-dir <scratch directory>] [-scale <iteration multiplier>] [-mmap] [-keep] [-json <results file>]
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <experimental/filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "interface.h"
+
+#include "FileSystem2.h"
+
+#include "PackFile.h"
+
+#include "CBSPFile.h"
+
+#include "bench/CBenchResults.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace
+{
+struct Options_t : public BenchOptions_t
+{
+	std::string szDirectory = "bspbench";
+
+	FileSystemOptions_t options = FileSystemOption::NONE;
+
+	/**
+	*	Whether to keep the scratch directory afterwards.
+	*/
+	bool bKeep = false;
+};
+
+/**
+*	Number of elements in each lump of the synthetic map, or bytes for byte lumps. About the size of a large official map.
+*/
+const size_t LUMP_SIZES[ bsp::NUM_LUMPS ] =
+{
+	64 * 1024,			//Entities
+	20000,				//Planes
+	0,					//Textures, written separately
+	30000,				//Vertexes
+	1024 * 1024,		//Visibility
+	20000,				//Nodes
+	4000,				//Texinfo
+	30000,				//Faces
+	4 * 1024 * 1024,	//Lighting
+	50000,				//Clipnodes
+	15000,				//Leafs
+	40000,				//Marksurfaces
+	60000,				//Edges
+	120000,				//Surfedges
+	200					//Models
+};
+
+/**
+*	Number of edges of each face.
+*/
+const size_t FACE_EDGES = 4;
+
+const char* const MAP_NAME = "maps/bench.bsp";
+
+CBenchResults g_Results( "bsp" );
+
+void Report( const char* pszName, const uint64_t uiOperations, const double flSeconds, const uint64_t uiBytes = 0 )
+{
+	g_Results.Report( pszName, uiOperations, flSeconds, uiBytes );
+}
+
+template<typename T>
+void AddLump( std::vector<uint8_t>& data, bsp::Header_t& header, const bsp::Lump lump, const std::vector<T>& elements )
+{
+	//Keep lumps aligned, like the map compiler does.
+	data.resize( ( data.size() + 3 ) & ~static_cast<size_t>( 3 ) );
+
+	header.lumps[ lump ].fileofs = static_cast<int32_t>( data.size() );
+	header.lumps[ lump ].filelen = static_cast<int32_t>( elements.size() * sizeof( T ) );
+
+	const auto pBytes = reinterpret_cast<const uint8_t*>( elements.data() );
+
+	data.insert( data.end(), pBytes, pBytes + elements.size() * sizeof( T ) );
+}
+
+/**
+*	Creates a map whose lumps reference each other validly. Geometry is meaningless.
+*/
+std::vector<uint8_t> CreateMap()
+{
+	std::vector<uint8_t> data( sizeof( bsp::Header_t ) );
+
+	bsp::Header_t header{};
+
+	header.version = bsp::VERSION;
+
+	const size_t uiFaces = LUMP_SIZES[ bsp::LUMP_FACES ];
+	const size_t uiEdges = LUMP_SIZES[ bsp::LUMP_EDGES ];
+	const size_t uiSurfEdges = LUMP_SIZES[ bsp::LUMP_SURFEDGES ];
+
+	AddLump( data, header, bsp::LUMP_ENTITIES, std::vector<char>( LUMP_SIZES[ bsp::LUMP_ENTITIES ], ' ' ) );
+
+	std::vector<bsp::Plane_t> planes( LUMP_SIZES[ bsp::LUMP_PLANES ] );
+
+	for( size_t uiIndex = 0; uiIndex < planes.size(); ++uiIndex )
+	{
+		planes[ uiIndex ].normal[ uiIndex % 3 ] = 1;
+		planes[ uiIndex ].dist = static_cast<float>( uiIndex );
+		planes[ uiIndex ].type = static_cast<int32_t>( uiIndex % 3 );
+	}
+
+	AddLump( data, header, bsp::LUMP_PLANES, planes );
+
+	//One texture, stored in a WAD file.
+	AddLump( data, header, bsp::LUMP_TEXTURES, std::vector<int32_t>{ 1, -1 } );
+
+	AddLump( data, header, bsp::LUMP_VERTEXES, std::vector<bsp::Vertex_t>( LUMP_SIZES[ bsp::LUMP_VERTEXES ] ) );
+
+	AddLump( data, header, bsp::LUMP_VISIBILITY, std::vector<uint8_t>( LUMP_SIZES[ bsp::LUMP_VISIBILITY ], 0xFF ) );
+
+	std::vector<bsp::Node_t> nodes( LUMP_SIZES[ bsp::LUMP_NODES ] );
+
+	for( size_t uiIndex = 0; uiIndex < nodes.size(); ++uiIndex )
+	{
+		auto& node = nodes[ uiIndex ];
+
+		node.planenum = static_cast<int32_t>( uiIndex % planes.size() );
+		node.children[ 0 ] = uiIndex * 2 + 1 < nodes.size() ? static_cast<int16_t>( uiIndex * 2 + 1 ) : -1;
+		node.children[ 1 ] = uiIndex * 2 + 2 < nodes.size() ? static_cast<int16_t>( uiIndex * 2 + 2 ) : -2;
+		node.firstface = static_cast<uint16_t>( uiIndex % uiFaces );
+		node.numfaces = 1;
+	}
+
+	AddLump( data, header, bsp::LUMP_NODES, nodes );
+
+	AddLump( data, header, bsp::LUMP_TEXINFO, std::vector<bsp::TexInfo_t>( LUMP_SIZES[ bsp::LUMP_TEXINFO ] ) );
+
+	std::vector<bsp::Face_t> faces( uiFaces );
+
+	for( size_t uiIndex = 0; uiIndex < faces.size(); ++uiIndex )
+	{
+		auto& face = faces[ uiIndex ];
+
+		face.planenum = static_cast<int16_t>( uiIndex % planes.size() );
+		face.firstedge = static_cast<int32_t>( ( uiIndex * FACE_EDGES ) % ( uiSurfEdges - FACE_EDGES ) );
+		face.numedges = FACE_EDGES;
+		face.texinfo = static_cast<int16_t>( uiIndex % LUMP_SIZES[ bsp::LUMP_TEXINFO ] );
+		face.lightofs = static_cast<int32_t>( ( uiIndex * 64 ) % LUMP_SIZES[ bsp::LUMP_LIGHTING ] );
+	}
+
+	AddLump( data, header, bsp::LUMP_FACES, faces );
+
+	AddLump( data, header, bsp::LUMP_LIGHTING, std::vector<uint8_t>( LUMP_SIZES[ bsp::LUMP_LIGHTING ], 0x80 ) );
+
+	std::vector<bsp::ClipNode_t> clipNodes( LUMP_SIZES[ bsp::LUMP_CLIPNODES ] );
+
+	for( size_t uiIndex = 0; uiIndex < clipNodes.size(); ++uiIndex )
+	{
+		clipNodes[ uiIndex ].planenum = static_cast<int32_t>( uiIndex % planes.size() );
+		clipNodes[ uiIndex ].children[ 0 ] = -1;
+		clipNodes[ uiIndex ].children[ 1 ] = -2;
+	}
+
+	AddLump( data, header, bsp::LUMP_CLIPNODES, clipNodes );
+
+	std::vector<bsp::Leaf_t> leafs( LUMP_SIZES[ bsp::LUMP_LEAFS ] );
+
+	for( size_t uiIndex = 0; uiIndex < leafs.size(); ++uiIndex )
+	{
+		auto& leaf = leafs[ uiIndex ];
+
+		leaf.visofs = uiIndex > 0 ? static_cast<int32_t>( uiIndex % LUMP_SIZES[ bsp::LUMP_VISIBILITY ] ) : -1;
+		leaf.firstmarksurface = static_cast<uint16_t>( uiIndex % ( LUMP_SIZES[ bsp::LUMP_MARKSURFACES ] - 2 ) );
+		leaf.nummarksurfaces = 2;
+	}
+
+	AddLump( data, header, bsp::LUMP_LEAFS, leafs );
+
+	std::vector<uint16_t> markSurfaces( LUMP_SIZES[ bsp::LUMP_MARKSURFACES ] );
+
+	for( size_t uiIndex = 0; uiIndex < markSurfaces.size(); ++uiIndex )
+	{
+		markSurfaces[ uiIndex ] = static_cast<uint16_t>( uiIndex % uiFaces );
+	}
+
+	AddLump( data, header, bsp::LUMP_MARKSURFACES, markSurfaces );
+
+	std::vector<bsp::Edge_t> edges( uiEdges );
+
+	for( size_t uiIndex = 0; uiIndex < edges.size(); ++uiIndex )
+	{
+		edges[ uiIndex ].v[ 0 ] = static_cast<uint16_t>( uiIndex % LUMP_SIZES[ bsp::LUMP_VERTEXES ] );
+		edges[ uiIndex ].v[ 1 ] = static_cast<uint16_t>( ( uiIndex + 1 ) % LUMP_SIZES[ bsp::LUMP_VERTEXES ] );
+	}
+
+	AddLump( data, header, bsp::LUMP_EDGES, edges );
+
+	std::vector<int32_t> surfEdges( uiSurfEdges );
+
+	for( size_t uiIndex = 0; uiIndex < surfEdges.size(); ++uiIndex )
+	{
+		const auto iEdge = static_cast<int32_t>( uiIndex % uiEdges );
+
+		surfEdges[ uiIndex ] = uiIndex % 2 ? -iEdge : iEdge;
+	}
+
+	AddLump( data, header, bsp::LUMP_SURFEDGES, surfEdges );
+
+	std::vector<bsp::Model_t> models( LUMP_SIZES[ bsp::LUMP_MODELS ] );
+
+	for( size_t uiIndex = 0; uiIndex < models.size(); ++uiIndex )
+	{
+		auto& model = models[ uiIndex ];
+
+		model.headnode[ 1 ] = model.headnode[ 2 ] = model.headnode[ 3 ] = static_cast<int32_t>( uiIndex % clipNodes.size() );
+		model.firstface = static_cast<int32_t>( uiIndex );
+		model.numfaces = 1;
+	}
+
+	AddLump( data, header, bsp::LUMP_MODELS, models );
+
+	memcpy( data.data(), &header, sizeof( header ) );
+
+	return data;
+}
+
+/**
+*	Writes a 32 bit pack file holding the map.
+*/
+bool WritePackFile( const fs::path& path, const std::vector<uint8_t>& map )
+{
+	typedef pack::Pack32_t PackType;
+
+	std::error_code error;
+
+	fs::create_directories( path.parent_path(), error );
+
+	FILE* pFile = fopen( path.u8string().c_str(), "wb" );
+
+	if( !pFile )
+		return false;
+
+	PackType::Header_t header{};
+	PackType::Entry_t entry{};
+
+	strncpy( entry.szFileName, MAP_NAME, sizeof( entry.szFileName ) );
+	entry.filepos = sizeof( header );
+	entry.filelen = static_cast<int32_t>( map.size() );
+
+	memcpy( header.identifier, PackType::Info_t::IDENTIFIER, sizeof( header.identifier ) );
+	header.dirofs = entry.filepos + entry.filelen;
+	header.dirlen = sizeof( entry );
+
+	const bool bSuccess = fwrite( &header, sizeof( header ), 1, pFile ) == 1 &&
+		fwrite( map.data(), map.size(), 1, pFile ) == 1 &&
+		fwrite( &entry, sizeof( entry ), 1, pFile ) == 1;
+
+	return fclose( pFile ) == 0 && bSuccess;
+}
+
+/**
+*	Loads the map the way the engine historically did: the whole file is read into memory, and each lump is copied out of it.
+*	@return Bytes of memory the loaded map holds.
+*/
+size_t LoadIntoHeap( IFileSystem2& fileSystem, std::vector<std::unique_ptr<uint8_t[]>>& lumps )
+{
+	auto hFile = fileSystem.Open( MAP_NAME, "rb" );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+		return 0;
+
+	const size_t uiSize = fileSystem.Size( hFile );
+
+	std::unique_ptr<uint8_t[]> file( new uint8_t[ uiSize ] );
+
+	const bool bRead = fileSystem.Read( file.get(), static_cast<int>( uiSize ), hFile ) == static_cast<int>( uiSize );
+
+	fileSystem.Close( hFile );
+
+	if( !bRead )
+		return 0;
+
+	bsp::Header_t header;
+	memcpy( &header, file.get(), sizeof( header ) );
+
+	size_t uiBytes = uiSize;
+
+	lumps.resize( bsp::NUM_LUMPS );
+
+	for( size_t uiLump = 0; uiLump < bsp::NUM_LUMPS; ++uiLump )
+	{
+		const auto& info = header.lumps[ uiLump ];
+
+		lumps[ uiLump ].reset( new uint8_t[ info.filelen ] );
+		memcpy( lumps[ uiLump ].get(), file.get() + info.fileofs, info.filelen );
+
+		uiBytes += info.filelen;
+	}
+
+	return uiBytes;
+}
+
+void BenchLoad( IFileSystem2& fileSystem, const Options_t& options, const size_t uiMapSize )
+{
+	const size_t uiCount = options.Scale( 200 );
+
+	{
+		size_t uiHeldBytes = 0;
+
+		CBenchTimer timer;
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			std::vector<std::unique_ptr<uint8_t[]>> lumps;
+
+			uiHeldBytes = LoadIntoHeap( fileSystem, lumps );
+		}
+
+		Report( "Load into heap", uiCount, timer.GetSeconds(), static_cast<uint64_t>( uiCount ) * uiMapSize );
+
+		printf( "Load into heap holds %u bytes\n", static_cast<unsigned int>( uiHeldBytes ) );
+	}
+
+	{
+		CBSPFile map;
+
+		CBenchTimer timer;
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			if( !map.Load( fileSystem, MAP_NAME ) )
+			{
+				printf( "Couldn't load %s: %s\n", MAP_NAME, map.GetError() );
+				return;
+			}
+		}
+
+		Report( "CBSPFile load", uiCount, timer.GetSeconds(), static_cast<uint64_t>( uiCount ) * uiMapSize );
+
+		printf( "CBSPFile references %u bytes and copied %u bytes\n",
+			static_cast<unsigned int>( map.GetReferencedBytes() ), static_cast<unsigned int>( map.GetCopiedBytes() ) );
+	}
+}
+}
+
+int main( int iArgc, char* pszArgV[] )
+{
+	Options_t options;
+
+	for( int iArg = 1; iArg < iArgc; ++iArg )
+	{
+		if( options.ParseArg( iArgc, pszArgV, iArg ) )
+			continue;
+
+		const char* pszArg = pszArgV[ iArg ];
+		const char* pszValue = iArg + 1 < iArgc ? pszArgV[ iArg + 1 ] : nullptr;
+
+		if( !strcmp( pszArg, "-dir" ) && pszValue )
+		{
+			options.szDirectory = pszValue;
+			++iArg;
+		}
+		else if( !strcmp( pszArg, "-mmap" ) )
+		{
+			options.options |= FileSystemOption::MAP_PACK_FILES;
+		}
+		else if( !strcmp( pszArg, "-keep" ) )
+		{
+			options.bKeep = true;
+		}
+		else
+		{
+			printf( "Usage: bench_bsp [-dir <scratch directory>] [-scale <iteration multiplier>] [-mmap] [-keep] [-json <results file>]\n" );
+			return EXIT_FAILURE;
+		}
+	}
+
+	auto pFileSystem = static_cast<IFileSystem2*>( CreateInterface( FILESYSTEM2_INTERFACE_VERSION, nullptr ) );
+
+	if( !pFileSystem )
+	{
+		printf( "Couldn't get the filesystem interface\n" );
+		return EXIT_FAILURE;
+	}
+
+	const auto map = CreateMap();
+
+	const fs::path packPath = fs::path( options.szDirectory ) / "bench.pak";
+
+	printf( "Creating benchmark files in \"%s\"\n", options.szDirectory.c_str() );
+
+	if( !WritePackFile( packPath, map ) )
+	{
+		printf( "Couldn't create benchmark files\n" );
+		return EXIT_FAILURE;
+	}
+
+	pFileSystem->SetOptions( options.options );
+
+	pFileSystem->AddPackFile( packPath.u8string().c_str(), "GAME" );
+
+	BenchLoad( *pFileSystem, options, map.size() );
+
+	pFileSystem->RemoveAllSearchPaths();
+
+	if( !options.bKeep )
+	{
+		std::error_code error;
+
+		fs::remove_all( options.szDirectory, error );
+	}
+
+	if( !g_Results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
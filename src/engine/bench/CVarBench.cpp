@@ -0,0 +1,372 @@
+/**
+*	@file
+*	Console microbenchmarks. Measures registering cvars and commands, name lookups, autocompletion and executing commands
+*	through the cvar system and the command buffer.
+*	Usage: bench_cvars [-count <cvar count>] [-scale <iteration multiplier>] [-json <results file>]
+*/
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Logging.h"
+#include "StringUtils.h"
+
+#include "cvardef.h"
+
+#include "console/CCommandBuffer.h"
+#include "console/CCommandScript.h"
+#include "console/CCVarSystem.h"
+
+#include "bench/CBenchResults.h"
+
+class IFileSystem2;
+
+//The console code refers to the engine's instances. The benchmark provides its own, without a filesystem.
+CCommandBuffer g_CommandBuffer;
+cvar::CCVarSystem g_CVar;
+CCommandScriptCache g_CommandScripts;
+IFileSystem2* g_pFileSystem = nullptr;
+
+//Console output would dominate the timings, so it's discarded.
+void Msg( const char* const, ... )
+{
+}
+
+void Warning( const char* const pszFormat, ... )
+{
+	va_list list;
+
+	va_start( list, pszFormat );
+	vfprintf( stderr, pszFormat, list );
+	va_end( list );
+}
+
+namespace
+{
+struct Options_t : public BenchOptions_t
+{
+	/**
+	*	Number of cvars that are registered, on top of the engine's commands.
+	*/
+	size_t uiCVars = 1000;
+};
+
+/**
+*	Number of operations that each benchmark performs, before scaling.
+*/
+const size_t OPERATIONS = 1000000;
+
+/**
+*	Number of times all cvars are registered and removed, before scaling.
+*/
+const size_t REGISTRATION_PASSES = 50;
+
+/**
+*	Commands per script that is executed through the command buffer.
+*/
+const size_t SCRIPT_COMMANDS = 64;
+
+/**
+*	Keeps results from being optimized away.
+*/
+volatile size_t g_uiSink = 0;
+
+CBenchResults g_Results( "cvars" );
+
+void Cmd_Bench_f()
+{
+	g_uiSink += g_CVar.GetArgC();
+}
+
+/**
+*	Cvars named like the engine's, with a subsystem prefix.
+*/
+class CCVarSet final
+{
+public:
+	CCVarSet( const size_t uiCount )
+		: m_CVars( uiCount )
+	{
+		static const char* const PREFIXES[] = { "cl_", "sv_", "r_", "gl_", "snd_", "net_", "fs_", "vgui_" };
+
+		m_Names.reserve( uiCount );
+
+		char szName[ 64 ];
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			snprintf( szName, sizeof( szName ), "%sbench_setting%u", PREFIXES[ uiIndex % ( sizeof( PREFIXES ) / sizeof( *PREFIXES ) ) ], static_cast<unsigned int>( uiIndex ) );
+
+			m_Names.emplace_back( szName );
+		}
+
+		Reset();
+
+		//Like a table of the engine's cvars, whose hashes are computed at compile time.
+		m_Descs.reserve( uiCount );
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			m_Descs.push_back( cvar::CVarDesc_t{ &m_CVars[ uiIndex ], StringHash( m_Names[ uiIndex ].c_str() ) } );
+		}
+	}
+
+	size_t GetCount() const { return m_CVars.size(); }
+
+	const char* GetName( const size_t uiIndex ) const { return m_Names[ uiIndex ].c_str(); }
+
+	/**
+	*	Restores the cvars to their unregistered state. Removing a cvar frees its value.
+	*/
+	void Reset()
+	{
+		for( size_t uiIndex = 0; uiIndex < m_CVars.size(); ++uiIndex )
+		{
+			m_CVars[ uiIndex ] = cvar_t{ m_Names[ uiIndex ].c_str(), const_cast<char*>( "0" ) };
+		}
+	}
+
+	void Register()
+	{
+		for( auto& cvar : m_CVars )
+		{
+			g_CVar.AddCVar( &cvar );
+		}
+	}
+
+	void RegisterTable()
+	{
+		g_CVar.AddCVars( m_Descs.data(), m_Descs.size() );
+	}
+
+	void Remove()
+	{
+		for( const auto& szName : m_Names )
+		{
+			g_CVar.RemoveCVar( szName.c_str() );
+		}
+
+		Reset();
+	}
+
+private:
+	std::vector<std::string> m_Names;
+	std::vector<cvar_t> m_CVars;
+	std::vector<cvar::CVarDesc_t> m_Descs;
+};
+
+void BenchRegistration( CCVarSet& cvars, const Options_t& options )
+{
+	const size_t uiPasses = options.Scale( REGISTRATION_PASSES );
+
+	double flAddSeconds = 0;
+	double flAddTableSeconds = 0;
+	double flRemoveSeconds = 0;
+
+	for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+	{
+		{
+			CBenchTimer timer;
+			cvars.Register();
+			flAddSeconds += timer.GetSeconds();
+		}
+
+		{
+			CBenchTimer timer;
+			cvars.Remove();
+			flRemoveSeconds += timer.GetSeconds();
+		}
+
+		{
+			CBenchTimer timer;
+			cvars.RegisterTable();
+			flAddTableSeconds += timer.GetSeconds();
+		}
+
+		cvars.Remove();
+	}
+
+	g_Results.Report( "AddCVar", uiPasses * cvars.GetCount(), flAddSeconds );
+	g_Results.Report( "AddCVars", uiPasses * cvars.GetCount(), flAddTableSeconds );
+	g_Results.Report( "RemoveCVar", uiPasses * cvars.GetCount(), flRemoveSeconds );
+}
+
+void BenchLookup( const CCVarSet& cvars, const Options_t& options )
+{
+	const size_t uiOperations = options.Scale( OPERATIONS );
+
+	{
+		CBenchTimer timer;
+
+		for( size_t uiIndex = 0; uiIndex < uiOperations; ++uiIndex )
+		{
+			g_uiSink += g_CVar.FindCVar( cvars.GetName( uiIndex % cvars.GetCount() ) ) != nullptr;
+		}
+
+		g_Results.Report( "FindCVar hit", uiOperations, timer.GetSeconds() );
+	}
+
+	{
+		//Same names with a different ending, so the misses aren't rejected on the first character.
+		std::vector<std::string> missing;
+
+		for( size_t uiIndex = 0; uiIndex < cvars.GetCount(); ++uiIndex )
+		{
+			missing.emplace_back( std::string( cvars.GetName( uiIndex ) ) + "_x" );
+		}
+
+		CBenchTimer timer;
+
+		for( size_t uiIndex = 0; uiIndex < uiOperations; ++uiIndex )
+		{
+			g_uiSink += g_CVar.FindCVar( missing[ uiIndex % missing.size() ].c_str() ) != nullptr;
+		}
+
+		g_Results.Report( "FindCVar miss", uiOperations, timer.GetSeconds() );
+	}
+
+	{
+		static const char* const PREFIXES[] = { "c", "sv_", "r_bench_setting1", "vgui_bench_setting9", "x" };
+
+		const char* szNames[ 16 ];
+
+		const size_t uiCompletions = options.Scale( OPERATIONS / 10 );
+
+		CBenchTimer timer;
+
+		for( size_t uiIndex = 0; uiIndex < uiCompletions; ++uiIndex )
+		{
+			g_uiSink += g_CVar.FindNamesWithPrefix( PREFIXES[ uiIndex % ( sizeof( PREFIXES ) / sizeof( *PREFIXES ) ) ], szNames, sizeof( szNames ) / sizeof( *szNames ) );
+		}
+
+		g_Results.Report( "FindNamesWithPrefix", uiCompletions, timer.GetSeconds() );
+	}
+}
+
+void BenchExecute( const CCVarSet& cvars, const Options_t& options )
+{
+	const size_t uiOperations = options.Scale( OPERATIONS / 4 );
+
+	std::vector<std::string> sets;
+
+	for( size_t uiIndex = 0; uiIndex < cvars.GetCount(); ++uiIndex )
+	{
+		sets.emplace_back( std::string( cvars.GetName( uiIndex ) ) + ' ' + std::to_string( uiIndex ) );
+	}
+
+	{
+		CBenchTimer timer;
+
+		for( size_t uiIndex = 0; uiIndex < uiOperations; ++uiIndex )
+		{
+			g_CVar.ExecuteString( sets[ uiIndex % sets.size() ].c_str(), cvar::Source::COMMAND );
+		}
+
+		g_Results.Report( "ExecuteString set cvar", uiOperations, timer.GetSeconds() );
+	}
+
+	{
+		CBenchTimer timer;
+
+		for( size_t uiIndex = 0; uiIndex < uiOperations; ++uiIndex )
+		{
+			g_CVar.ExecuteString( "bench_command \"first argument\" second", cvar::Source::COMMAND );
+		}
+
+		g_Results.Report( "ExecuteString command", uiOperations, timer.GetSeconds() );
+	}
+
+	{
+		const char* const pszArgs[] = { "bench_command", "first argument", "second" };
+
+		cvar::CCVarSystem::CachedName_t name{};
+
+		CBenchTimer timer;
+
+		for( size_t uiIndex = 0; uiIndex < uiOperations; ++uiIndex )
+		{
+			g_CVar.ExecuteArgs( 3, pszArgs, name, cvar::Source::COMMAND );
+		}
+
+		g_Results.Report( "ExecuteArgs cached command", uiOperations, timer.GetSeconds() );
+	}
+
+	{
+		std::string szScript;
+
+		for( size_t uiIndex = 0; uiIndex < SCRIPT_COMMANDS; ++uiIndex )
+		{
+			szScript += sets[ uiIndex % sets.size() ];
+			szScript += uiIndex % 2 ? '\n' : ';';
+		}
+
+		const size_t uiScripts = std::max<size_t>( 1, uiOperations / SCRIPT_COMMANDS );
+
+		CBenchTimer timer;
+
+		for( size_t uiIndex = 0; uiIndex < uiScripts; ++uiIndex )
+		{
+			g_CommandBuffer.AddText( szScript.c_str() );
+			g_CommandBuffer.Execute();
+		}
+
+		g_Results.Report( "CCommandBuffer::Execute", uiScripts * SCRIPT_COMMANDS, timer.GetSeconds(), uiScripts * szScript.size() );
+	}
+}
+}
+
+int main( int argc, char* argv[] )
+{
+	Options_t options;
+
+	for( int iArg = 1; iArg < argc; ++iArg )
+	{
+		if( options.ParseArg( argc, argv, iArg ) )
+			continue;
+
+		const char* pszArg = argv[ iArg ];
+		const char* pszValue = iArg + 1 < argc ? argv[ iArg + 1 ] : nullptr;
+
+		if( !strcmp( pszArg, "-count" ) && pszValue )
+		{
+			options.uiCVars = std::max<size_t>( 1, strtoul( pszValue, nullptr, 10 ) );
+			++iArg;
+		}
+		else
+		{
+			printf( "Usage: bench_cvars [-count <cvar count>] [-scale <iteration multiplier>] [-json <results file>]\n" );
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( !g_CVar.Initialize() || !g_CommandBuffer.Initialize( &g_CVar ) )
+	{
+		printf( "Couldn't initialize the console\n" );
+		return EXIT_FAILURE;
+	}
+
+	g_CVar.AddCommand( "bench_command", &Cmd_Bench_f );
+
+	CCVarSet cvars( options.uiCVars );
+
+	BenchRegistration( cvars, options );
+
+	cvars.Register();
+
+	BenchLookup( cvars, options );
+	BenchExecute( cvars, options );
+
+	cvars.Remove();
+
+	if( !g_Results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,285 @@
+/**
+*	@file
+*	Entity update microbenchmarks. Moves and culls entities stored as an array of edict sized structs, and stored in CEntityList,
+*	on one thread and split between jobs. Set HL_DISABLE_CPU_FEATURES to compare CEntityList's kernels.
+*	Usage: bench_entities [-scale <iteration multiplier>] [-jobs <worker threads>] [-json <results file>]
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "CJobSystem.h"
+#include "CPUFeatures.h"
+
+#include "CEntityList.h"
+
+#include "bench/CBenchResults.h"
+
+namespace
+{
+struct Options_t : public BenchOptions_t
+{
+	/**
+	*	Number of job system workers.
+	*/
+	size_t uiJobs = std::max( 1u, std::thread::hardware_concurrency() ) - 1;
+};
+
+/**
+*	Entity counts that are measured.
+*/
+const size_t ENTITY_COUNTS[] = { 1000, 4000, 16000 };
+
+/**
+*	Entity updates done by each benchmark, before scaling. Fewer entities are updated more times.
+*/
+const size_t UPDATES = 64 * 1024 * 1024;
+
+/**
+*	An entity stored with all of its fields together, about the size of an edict with its entity variables.
+*	Only a few fields are used by the updates, but the rest come along into the cache.
+*/
+struct AoSEntity_t
+{
+	float origin[ 3 ];
+	float velocity[ 3 ];
+	float radius;
+	uint32_t flags;
+	int32_t modelindex;
+
+	uint8_t other[ 700 ];
+};
+
+/**
+*	View frustum planes used for culling, roughly a quarter of the world.
+*/
+const CullPlane_t PLANES[] =
+{
+	{ { 1, 0, 0 }, -512 },
+	{ { -1, 0, 0 }, -2048 },
+	{ { 0, 1, 0 }, -512 },
+	{ { 0, -1, 0 }, -2048 },
+	{ { 0, 0, 1 }, -4096 },
+	{ { 0, 0, -1 }, -4096 }
+};
+
+const size_t NUM_PLANES = sizeof( PLANES ) / sizeof( PLANES[ 0 ] );
+
+const float TICK_INTERVAL = 1 / 100.0f;
+
+/**
+*	Keeps results from being optimized away.
+*/
+volatile size_t g_uiSink = 0;
+
+CBenchResults g_Results( "entities" );
+
+void Randomize( std::mt19937& random, float& flOrigin, float& flVelocity )
+{
+	std::uniform_real_distribution<float> origins( -4096, 4096 );
+	std::uniform_real_distribution<float> velocities( -320, 320 );
+
+	flOrigin = origins( random );
+	flVelocity = velocities( random );
+}
+
+void BenchAoS( const Options_t& options, const size_t uiCount )
+{
+	std::vector<AoSEntity_t> entities( uiCount );
+
+	std::mt19937 random( 1 );
+
+	for( auto& entity : entities )
+	{
+		for( size_t uiAxis = 0; uiAxis < 3; ++uiAxis )
+		{
+			Randomize( random, entity.origin[ uiAxis ], entity.velocity[ uiAxis ] );
+		}
+
+		entity.radius = 32;
+		entity.flags = random() % 8 == 0 ? EntityFlag::NODRAW : EntityFlag::NONE;
+	}
+
+	const size_t uiTicks = options.Scale( UPDATES / uiCount );
+
+	std::vector<uint32_t> visible;
+
+	visible.reserve( uiCount );
+
+	char szName[ 64 ];
+
+	{
+		CBenchTimer timer;
+
+		for( size_t uiTick = 0; uiTick < uiTicks; ++uiTick )
+		{
+			for( auto& entity : entities )
+			{
+				for( size_t uiAxis = 0; uiAxis < 3; ++uiAxis )
+				{
+					entity.origin[ uiAxis ] += entity.velocity[ uiAxis ] * TICK_INTERVAL;
+				}
+			}
+		}
+
+		snprintf( szName, sizeof( szName ), "AoS integrate %u entities", static_cast<unsigned int>( uiCount ) );
+
+		g_Results.Report( szName, uiTicks * uiCount, timer.GetSeconds() );
+	}
+
+	{
+		CBenchTimer timer;
+
+		for( size_t uiTick = 0; uiTick < uiTicks; ++uiTick )
+		{
+			visible.clear();
+
+			for( size_t uiIndex = 0; uiIndex < entities.size(); ++uiIndex )
+			{
+				const auto& entity = entities[ uiIndex ];
+
+				if( entity.flags & EntityFlag::NODRAW )
+					continue;
+
+				bool bVisible = true;
+
+				for( const auto& plane : PLANES )
+				{
+					const float flDistance = plane.normal[ 0 ] * entity.origin[ 0 ] + plane.normal[ 1 ] * entity.origin[ 1 ] +
+						plane.normal[ 2 ] * entity.origin[ 2 ] - plane.dist;
+
+					if( flDistance + entity.radius < 0 )
+					{
+						bVisible = false;
+						break;
+					}
+				}
+
+				if( bVisible )
+					visible.push_back( static_cast<uint32_t>( uiIndex ) );
+			}
+
+			g_uiSink += visible.size();
+		}
+
+		snprintf( szName, sizeof( szName ), "AoS cull %u entities", static_cast<unsigned int>( uiCount ) );
+
+		g_Results.Report( szName, uiTicks * uiCount, timer.GetSeconds() );
+	}
+}
+
+void BenchSoA( const Options_t& options, const size_t uiCount, CJobSystem* pJobSystem )
+{
+	CEntityList entities( uiCount );
+
+	std::mt19937 random( 1 );
+
+	const auto& components = entities.GetComponents();
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		entities.Create();
+
+		Randomize( random, components.pOriginX[ uiIndex ], components.pVelocityX[ uiIndex ] );
+		Randomize( random, components.pOriginY[ uiIndex ], components.pVelocityY[ uiIndex ] );
+		Randomize( random, components.pOriginZ[ uiIndex ], components.pVelocityZ[ uiIndex ] );
+
+		components.pRadius[ uiIndex ] = 32;
+		components.pFlags[ uiIndex ] = random() % 8 == 0 ? EntityFlag::NODRAW : EntityFlag::NONE;
+	}
+
+	const size_t uiTicks = options.Scale( UPDATES / uiCount );
+
+	const char* const pszThreads = pJobSystem ? "jobs" : "serial";
+
+	std::vector<uint32_t> visible;
+
+	char szName[ 64 ];
+
+	{
+		CBenchTimer timer;
+
+		for( size_t uiTick = 0; uiTick < uiTicks; ++uiTick )
+		{
+			entities.Integrate( TICK_INTERVAL, pJobSystem );
+		}
+
+		snprintf( szName, sizeof( szName ), "CEntityList integrate %u entities %s", static_cast<unsigned int>( uiCount ), pszThreads );
+
+		g_Results.Report( szName, uiTicks * uiCount, timer.GetSeconds() );
+	}
+
+	{
+		CBenchTimer timer;
+
+		for( size_t uiTick = 0; uiTick < uiTicks; ++uiTick )
+		{
+			entities.Cull( PLANES, NUM_PLANES, visible, pJobSystem );
+
+			g_uiSink += visible.size();
+		}
+
+		snprintf( szName, sizeof( szName ), "CEntityList cull %u entities %s", static_cast<unsigned int>( uiCount ), pszThreads );
+
+		g_Results.Report( szName, uiTicks * uiCount, timer.GetSeconds() );
+	}
+}
+}
+
+int main( int argc, char* argv[] )
+{
+	Options_t options;
+
+	for( int iArg = 1; iArg < argc; ++iArg )
+	{
+		if( options.ParseArg( argc, argv, iArg ) )
+			continue;
+
+		const char* pszArg = argv[ iArg ];
+		const char* pszValue = iArg + 1 < argc ? argv[ iArg + 1 ] : nullptr;
+
+		if( !strcmp( pszArg, "-jobs" ) && pszValue )
+		{
+			options.uiJobs = std::min<size_t>( CJobSystem::MAX_WORKERS, strtoul( pszValue, nullptr, 10 ) );
+			++iArg;
+		}
+		else
+		{
+			printf( "Usage: bench_entities [-scale <iteration multiplier>] [-jobs <worker threads>] [-json <results file>]\n" );
+			return EXIT_FAILURE;
+		}
+	}
+
+	char szFeatures[ 128 ];
+
+	Plat_GetCPUFeatureString( szFeatures, sizeof( szFeatures ) );
+
+	printf( "CPU features: %s\n", szFeatures );
+
+	CJobSystem jobSystem;
+
+	jobSystem.Start( options.uiJobs );
+
+	for( const auto uiCount : ENTITY_COUNTS )
+	{
+		BenchAoS( options, uiCount );
+		BenchSoA( options, uiCount, nullptr );
+
+		if( jobSystem.GetWorkerCount() > 0 )
+			BenchSoA( options, uiCount, &jobSystem );
+	}
+
+	jobSystem.Stop();
+
+	if( !g_Results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,109 @@
+/**
+*	@file
+*	Frame pacing benchmark. Runs a simulated frame loop capped with a plain sleep and with CFrameLimiter, and compares the jitter between frame starts.
+*	Usage: bench_framepacing [-fps <cap>] [-frames <frame count>]
+*/
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+#include "CFrameLimiter.h"
+
+namespace
+{
+using Clock = CFrameLimiter::Clock;
+
+/**
+*	Simulates the work done in a frame by spinning for a random amount of time.
+*/
+void SimulateFrame( std::mt19937& random, const double flMaxWorkMS )
+{
+	std::uniform_real_distribution<double> distribution( 0, flMaxWorkMS );
+
+	const auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double, std::milli>( distribution( random ) ) );
+
+	while( Clock::now() < end )
+	{
+	}
+}
+
+void PrintStats( const char* pszName, const CFrameLimiter::Stats_t& stats )
+{
+	printf( "%-12s %8.3f ms mean %8.3f ms stddev %8.3f ms max %6.3f ms spin\n", pszName, stats.flMeanMS, stats.flStdDevMS, stats.flMaxMS, stats.flSpinMS );
+}
+}
+
+int main( int iArgc, char* pszArgv[] )
+{
+	double flFPS = 100;
+	unsigned int uiFrames = 500;
+
+	for( int iArg = 1; iArg < iArgc; ++iArg )
+	{
+		if( !strcmp( pszArgv[ iArg ], "-fps" ) && iArg + 1 < iArgc )
+			flFPS = atof( pszArgv[ ++iArg ] );
+		else if( !strcmp( pszArgv[ iArg ], "-frames" ) && iArg + 1 < iArgc )
+			uiFrames = static_cast<unsigned int>( atoi( pszArgv[ ++iArg ] ) );
+	}
+
+	const double flIntervalMS = 1000.0 / flFPS;
+
+	//Keep the work well under the frame time, so only the waiting differs.
+	const double flMaxWorkMS = flIntervalMS / 2;
+
+	printf( "%u frames at %.1f FPS (%.3f ms), up to %.3f ms of work per frame\n", uiFrames, flFPS, flIntervalMS, flMaxWorkMS );
+
+	std::mt19937 random( 1234 );
+
+	{
+		//Plain sleep for whatever is left of the frame, with the stats gathered by an uncapped limiter.
+		CFrameLimiter stats;
+
+		const auto interval = std::chrono::duration_cast<Clock::duration>( std::chrono::duration<double, std::milli>( flIntervalMS ) );
+
+		auto frameStart = Clock::now();
+
+		for( unsigned int uiFrame = 0; uiFrame < uiFrames; ++uiFrame )
+		{
+			const auto elapsed = Clock::now() - frameStart;
+
+			if( elapsed < interval )
+				std::this_thread::sleep_for( interval - elapsed );
+
+			frameStart = Clock::now();
+
+			stats.WaitForNextFrame();
+
+			SimulateFrame( random, flMaxWorkMS );
+		}
+
+		CFrameLimiter::Stats_t result;
+		stats.GetStats( result );
+
+		PrintStats( "sleep", result );
+	}
+
+	{
+		CFrameLimiter limiter;
+
+		limiter.SetMaxFPS( static_cast<float>( flFPS ) );
+
+		for( unsigned int uiFrame = 0; uiFrame < uiFrames; ++uiFrame )
+		{
+			limiter.WaitForNextFrame();
+
+			SimulateFrame( random, flMaxWorkMS );
+		}
+
+		CFrameLimiter::Stats_t result;
+		limiter.GetStats( result );
+
+		PrintStats( "limiter", result );
+	}
+
+	return EXIT_SUCCESS;
+}
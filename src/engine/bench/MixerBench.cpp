@@ -0,0 +1,130 @@
+/**
+*	@file
+*	Sound mixer microbenchmarks. Mixes growing numbers of looping voices, resampled and at the output rate, to show the cost per voice.
+*	Set HL_DISABLE_CPU_FEATURES to compare CMixer's kernels.
+*	Usage: bench_mixer [-scale <iteration multiplier>] [-json <results file>]
+*/
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <vector>
+
+#include "CPUFeatures.h"
+
+#include "sound/CMixer.h"
+
+#include "bench/CBenchResults.h"
+
+namespace
+{
+/**
+*	Voice counts that are measured.
+*/
+const size_t VOICE_COUNTS[] = { 1, 8, 32, 64, 128 };
+
+/**
+*	Voice frames mixed by each benchmark, before scaling. Fewer voices are mixed for longer.
+*/
+const size_t VOICE_FRAMES = 64 * 1024 * 1024;
+
+/**
+*	Frames mixed per call, like a device buffer.
+*/
+const size_t BUFFER_FRAMES = 1024;
+
+/**
+*	Keeps results from being optimized away.
+*/
+volatile int g_iSink = 0;
+
+CBenchResults g_Results( "mixer" );
+
+/**
+*	A second of a sine wave.
+*/
+CSoundCache::SoundPtr MakeSound( const uint32_t uiChannels, const uint32_t uiSampleRate )
+{
+	auto sound = std::make_shared<Sound_t>();
+
+	sound->uiFrames = uiSampleRate;
+	sound->uiChannels = uiChannels;
+	sound->uiSampleRate = uiSampleRate;
+	sound->samples.resize( sound->uiFrames * uiChannels );
+
+	for( size_t uiSample = 0; uiSample < sound->samples.size(); ++uiSample )
+	{
+		sound->samples[ uiSample ] = static_cast<int16_t>( 8000 * std::sin( ( uiSample / uiChannels ) * 0.05 ) );
+	}
+
+	return sound;
+}
+
+void BenchMix( const BenchOptions_t& options, const char* pszName, const CSoundCache::SoundPtr& sound, const float flPitch, const size_t uiVoices )
+{
+	CMixer mixer;
+
+	for( size_t uiVoice = 0; uiVoice < uiVoices; ++uiVoice )
+	{
+		//Spread across the stereo field so every voice takes the panned path.
+		mixer.Play( sound, 0.5f, ( uiVoice % 3 ) - 1.0f, flPitch, true );
+	}
+
+	std::vector<int16_t> output( BUFFER_FRAMES * 2 );
+
+	//Starts the voices.
+	mixer.Mix( output.data(), BUFFER_FRAMES );
+
+	const size_t uiBuffers = options.Scale( VOICE_FRAMES / ( uiVoices * BUFFER_FRAMES ) );
+
+	CBenchTimer timer;
+
+	for( size_t uiBuffer = 0; uiBuffer < uiBuffers; ++uiBuffer )
+	{
+		mixer.Mix( output.data(), BUFFER_FRAMES );
+
+		g_iSink += output[ uiBuffer % output.size() ];
+	}
+
+	const double flSeconds = timer.GetSeconds();
+
+	char szName[ 64 ];
+
+	snprintf( szName, sizeof( szName ), "%s %u voices", pszName, static_cast<unsigned int>( uiVoices ) );
+
+	//Voice frames, so flat cost per voice shows as a flat rate.
+	g_Results.Report( szName, uiBuffers * BUFFER_FRAMES * uiVoices, flSeconds );
+}
+}
+
+int main( int argc, char* argv[] )
+{
+	BenchOptions_t options;
+
+	if( !options.ParseCommandLine( argc, argv, "bench_mixer" ) )
+		return EXIT_FAILURE;
+
+	char szFeatures[ 128 ];
+
+	Plat_GetCPUFeatureString( szFeatures, sizeof( szFeatures ) );
+
+	printf( "CPU features: %s\n", szFeatures );
+
+	const auto mono = MakeSound( 1, 22050 );
+	const auto stereo = MakeSound( 2, CMixer::DEFAULT_OUTPUT_RATE );
+
+	for( const auto uiVoices : VOICE_COUNTS )
+	{
+		BenchMix( options, "Mono 22050 Hz", mono, 1, uiVoices );
+		BenchMix( options, "Stereo 44100 Hz", stereo, 1, uiVoices );
+		BenchMix( options, "Stereo pitched", stereo, 1.1f, uiVoices );
+	}
+
+	if( !g_Results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,269 @@
+/**
+*	@file
+*	Spatial query microbenchmarks. Each tick, every entity moves and then finds the entities near it,
+*	by testing every entity and by querying CSpatialGrid one box at a time and in a batch. Grid timings include updating the grid.
+*	Set HL_DISABLE_CPU_FEATURES to compare CSpatialGrid's kernels.
+*	Usage: bench_spatial [-scale <iteration multiplier>] [-json <results file>]
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "CPUFeatures.h"
+
+#include "CSpatialGrid.h"
+
+#include "bench/CBenchResults.h"
+
+namespace
+{
+/**
+*	Entity counts that are measured.
+*/
+const size_t ENTITY_COUNTS[] = { 100, 500, 2000 };
+
+/**
+*	Queries done by each benchmark, before scaling. Fewer entities are updated more times.
+*/
+const size_t QUERIES = 1024 * 1024;
+
+/**
+*	How far around an entity its query reaches, about what a monster looks at when it moves.
+*/
+const float QUERY_RANGE = 128;
+
+const float TICK_INTERVAL = 1 / 100.0f;
+
+/**
+*	Keeps results from being optimized away.
+*/
+volatile size_t g_uiSink = 0;
+
+CBenchResults g_Results( "spatial" );
+
+struct Entity_t
+{
+	float origin[ 3 ];
+	float velocity[ 3 ];
+	float halfSize[ 3 ];
+};
+
+/**
+*	Entities spread over the largest world. A few are large, like brush entities.
+*/
+std::vector<Entity_t> CreateEntities( const size_t uiCount )
+{
+	std::mt19937 random( 1 );
+
+	std::uniform_real_distribution<float> origins( -4000, 4000 );
+	std::uniform_real_distribution<float> velocities( -320, 320 );
+	std::uniform_real_distribution<float> sizes( 8, 36 );
+
+	std::vector<Entity_t> entities( uiCount );
+
+	for( auto& entity : entities )
+	{
+		const float flScale = random() % 32 == 0 ? 16.0f : 1.0f;
+
+		for( size_t uiAxis = 0; uiAxis < 3; ++uiAxis )
+		{
+			entity.origin[ uiAxis ] = origins( random );
+			entity.velocity[ uiAxis ] = velocities( random );
+			entity.halfSize[ uiAxis ] = sizes( random ) * flScale;
+		}
+	}
+
+	return entities;
+}
+
+/**
+*	Moves entities and bounces them off the edges of the world.
+*/
+void Move( std::vector<Entity_t>& entities )
+{
+	for( auto& entity : entities )
+	{
+		for( size_t uiAxis = 0; uiAxis < 3; ++uiAxis )
+		{
+			entity.origin[ uiAxis ] += entity.velocity[ uiAxis ] * TICK_INTERVAL;
+
+			if( entity.origin[ uiAxis ] < -4000 || entity.origin[ uiAxis ] > 4000 )
+				entity.velocity[ uiAxis ] = -entity.velocity[ uiAxis ];
+		}
+	}
+}
+
+void GetBounds( const Entity_t& entity, AABB_t& bounds )
+{
+	for( size_t uiAxis = 0; uiAxis < 3; ++uiAxis )
+	{
+		bounds.mins[ uiAxis ] = entity.origin[ uiAxis ] - entity.halfSize[ uiAxis ];
+		bounds.maxs[ uiAxis ] = entity.origin[ uiAxis ] + entity.halfSize[ uiAxis ];
+	}
+}
+
+void GetQuery( const Entity_t& entity, AABB_t& box )
+{
+	for( size_t uiAxis = 0; uiAxis < 3; ++uiAxis )
+	{
+		box.mins[ uiAxis ] = entity.origin[ uiAxis ] - entity.halfSize[ uiAxis ] - QUERY_RANGE;
+		box.maxs[ uiAxis ] = entity.origin[ uiAxis ] + entity.halfSize[ uiAxis ] + QUERY_RANGE;
+	}
+}
+
+void BenchBruteForce( const BenchOptions_t& options, const size_t uiCount )
+{
+	auto entities = CreateEntities( uiCount );
+
+	std::vector<AABB_t> bounds( uiCount );
+
+	std::vector<uint32_t> results;
+
+	const size_t uiTicks = options.Scale( QUERIES / uiCount );
+
+	CBenchTimer timer;
+
+	for( size_t uiTick = 0; uiTick < uiTicks; ++uiTick )
+	{
+		Move( entities );
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			GetBounds( entities[ uiIndex ], bounds[ uiIndex ] );
+		}
+
+		for( const auto& entity : entities )
+		{
+			AABB_t box;
+
+			GetQuery( entity, box );
+
+			results.clear();
+
+			for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+			{
+				const auto& other = bounds[ uiIndex ];
+
+				if( other.mins[ 0 ] <= box.maxs[ 0 ] && other.maxs[ 0 ] >= box.mins[ 0 ] &&
+					other.mins[ 1 ] <= box.maxs[ 1 ] && other.maxs[ 1 ] >= box.mins[ 1 ] &&
+					other.mins[ 2 ] <= box.maxs[ 2 ] && other.maxs[ 2 ] >= box.mins[ 2 ] )
+				{
+					results.push_back( static_cast<uint32_t>( uiIndex ) );
+				}
+			}
+
+			g_uiSink += results.size();
+		}
+	}
+
+	char szName[ 64 ];
+
+	snprintf( szName, sizeof( szName ), "Brute force %u entities", static_cast<unsigned int>( uiCount ) );
+
+	g_Results.Report( szName, uiTicks * uiCount, timer.GetSeconds() );
+}
+
+void BenchGrid( const BenchOptions_t& options, const size_t uiCount, const bool bBatched )
+{
+	auto entities = CreateEntities( uiCount );
+
+	CSpatialGrid grid;
+
+	std::vector<CSpatialGrid::Proxy> proxies( uiCount );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		AABB_t bounds;
+
+		GetBounds( entities[ uiIndex ], bounds );
+
+		proxies[ uiIndex ] = grid.Insert( static_cast<uint32_t>( uiIndex ), bounds );
+	}
+
+	std::vector<AABB_t> boxes( uiCount );
+
+	std::vector<uint32_t> results;
+	std::vector<size_t> offsets;
+
+	const size_t uiTicks = options.Scale( QUERIES / uiCount );
+
+	CBenchTimer timer;
+
+	for( size_t uiTick = 0; uiTick < uiTicks; ++uiTick )
+	{
+		Move( entities );
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			AABB_t bounds;
+
+			GetBounds( entities[ uiIndex ], bounds );
+
+			grid.Move( proxies[ uiIndex ], bounds );
+		}
+
+		if( bBatched )
+		{
+			for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+			{
+				GetQuery( entities[ uiIndex ], boxes[ uiIndex ] );
+			}
+
+			results.clear();
+
+			grid.Query( boxes.data(), uiCount, results, offsets );
+
+			g_uiSink += results.size();
+		}
+		else
+		{
+			for( const auto& entity : entities )
+			{
+				AABB_t box;
+
+				GetQuery( entity, box );
+
+				results.clear();
+
+				g_uiSink += grid.Query( box, results );
+			}
+		}
+	}
+
+	char szName[ 64 ];
+
+	snprintf( szName, sizeof( szName ), "CSpatialGrid %s %u entities", bBatched ? "batched" : "single", static_cast<unsigned int>( uiCount ) );
+
+	g_Results.Report( szName, uiTicks * uiCount, timer.GetSeconds() );
+}
+}
+
+int main( int argc, char* argv[] )
+{
+	BenchOptions_t options;
+
+	if( !options.ParseCommandLine( argc, argv, "bench_spatial" ) )
+		return EXIT_FAILURE;
+
+	char szFeatures[ 128 ];
+
+	Plat_GetCPUFeatureString( szFeatures, sizeof( szFeatures ) );
+
+	printf( "CPU features: %s\n", szFeatures );
+
+	for( const auto uiCount : ENTITY_COUNTS )
+	{
+		BenchBruteForce( options, uiCount );
+		BenchGrid( options, uiCount, false );
+		BenchGrid( options, uiCount, true );
+	}
+
+	if( !g_Results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
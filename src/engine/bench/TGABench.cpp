@@ -0,0 +1,191 @@
+/**
+*	@file
+*	TGA decoder microbenchmarks. Generates uncompressed and run length encoded images in memory, and decodes them in one piece
+*	and streamed in blocks, the way the asset loader feeds them.
+*	Usage: bench_tga [-scale <iteration multiplier>] [-json <results file>]
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "VGUI1/TGADecoder.h"
+
+#include "bench/CBenchResults.h"
+
+namespace
+{
+/**
+*	Pixels decoded by each benchmark, before scaling. Smaller images are decoded more times.
+*/
+const size_t PIXELS = 64 * 1024 * 1024;
+
+/**
+*	Image sizes. Square, so this is the width and height.
+*/
+const int IMAGE_SIZES[] = { 64, 256, 1024 };
+
+/**
+*	Size of the blocks that streamed images are fed in.
+*/
+const size_t STREAM_BLOCK_SIZE = 16 * 1024;
+
+/**
+*	Pixels in each run length packet of generated images. Packets alternate between repeated and raw.
+*/
+const size_t RLE_PACKET_PIXELS = 16;
+
+/**
+*	Keeps results from being optimized away.
+*/
+volatile size_t g_uiSink = 0;
+
+CBenchResults g_Results( "tga" );
+
+/**
+*	Creates a bottom up TGA image with a gradient, which is what most game images look like on disk.
+*/
+std::vector<uint8_t> CreateTGA( const int iSize, const size_t uiBytesPerPixel, const bool bRLE )
+{
+	std::vector<uint8_t> data( 18, 0 );
+
+	data[ 2 ] = bRLE ? 10 : 2;
+	data[ 12 ] = static_cast<uint8_t>( iSize & 0xFF );
+	data[ 13 ] = static_cast<uint8_t>( iSize >> 8 );
+	data[ 14 ] = static_cast<uint8_t>( iSize & 0xFF );
+	data[ 15 ] = static_cast<uint8_t>( iSize >> 8 );
+	data[ 16 ] = static_cast<uint8_t>( uiBytesPerPixel * 8 );
+	data[ 17 ] = uiBytesPerPixel == 4 ? 8 : 0;
+
+	const size_t uiPixels = static_cast<size_t>( iSize ) * iSize;
+
+	auto appendPixel = [ & ]( const size_t uiPixel )
+	{
+		const uint8_t ubColor[ 4 ] =
+		{
+			static_cast<uint8_t>( uiPixel ),
+			static_cast<uint8_t>( uiPixel / iSize ),
+			static_cast<uint8_t>( uiPixel * 7 ),
+			static_cast<uint8_t>( 255 - ( uiPixel & 0x3F ) )
+		};
+
+		data.insert( data.end(), ubColor, ubColor + uiBytesPerPixel );
+	};
+
+	if( !bRLE )
+	{
+		for( size_t uiPixel = 0; uiPixel < uiPixels; ++uiPixel )
+		{
+			appendPixel( uiPixel );
+		}
+
+		return data;
+	}
+
+	bool bRepeat = true;
+
+	for( size_t uiPixel = 0; uiPixel < uiPixels; bRepeat = !bRepeat )
+	{
+		//Packets can't cross rows.
+		const size_t uiCount = std::min( RLE_PACKET_PIXELS, iSize - uiPixel % iSize );
+
+		data.push_back( static_cast<uint8_t>( ( bRepeat ? 0x80 : 0 ) | ( uiCount - 1 ) ) );
+
+		if( bRepeat )
+		{
+			appendPixel( uiPixel );
+			uiPixel += uiCount;
+		}
+		else
+		{
+			for( const size_t uiEnd = uiPixel + uiCount; uiPixel < uiEnd; ++uiPixel )
+			{
+				appendPixel( uiPixel );
+			}
+		}
+	}
+
+	return data;
+}
+
+void BenchDecode( const BenchOptions_t& options, const size_t uiBytesPerPixel, const bool bRLE )
+{
+	for( const auto iSize : IMAGE_SIZES )
+	{
+		const auto data = CreateTGA( iSize, uiBytesPerPixel, bRLE );
+
+		const size_t uiPixels = static_cast<size_t>( iSize ) * iSize;
+		const size_t uiImages = options.Scale( PIXELS / uiPixels );
+
+		char szName[ 64 ];
+
+		{
+			TGAImage_t image;
+
+			CBenchTimer timer;
+
+			for( size_t uiImage = 0; uiImage < uiImages; ++uiImage )
+			{
+				if( !DecodeTGA( data.data(), data.size(), true, image ) )
+				{
+					printf( "Couldn't decode a generated image\n" );
+					exit( EXIT_FAILURE );
+				}
+
+				g_uiSink += image.rgba[ 0 ];
+			}
+
+			snprintf( szName, sizeof( szName ), "DecodeTGA %u bit%s %dx%d", static_cast<unsigned int>( uiBytesPerPixel * 8 ), bRLE ? " RLE" : "", iSize, iSize );
+
+			g_Results.Report( szName, uiImages, timer.GetSeconds(), uiImages * uiPixels * 4 );
+		}
+
+		{
+			CBenchTimer timer;
+
+			for( size_t uiImage = 0; uiImage < uiImages; ++uiImage )
+			{
+				CTGAStreamDecoder decoder( true );
+
+				for( size_t uiOffset = 0; uiOffset < data.size() && decoder.GetStatus() == CTGAStreamDecoder::Status::NEED_MORE_DATA; uiOffset += STREAM_BLOCK_SIZE )
+				{
+					decoder.Feed( data.data() + uiOffset, std::min( STREAM_BLOCK_SIZE, data.size() - uiOffset ) );
+				}
+
+				if( decoder.GetStatus() != CTGAStreamDecoder::Status::DONE )
+				{
+					printf( "Couldn't stream a generated image\n" );
+					exit( EXIT_FAILURE );
+				}
+
+				g_uiSink += decoder.GetImage().rgba[ 0 ];
+			}
+
+			snprintf( szName, sizeof( szName ), "CTGAStreamDecoder %u bit%s %dx%d", static_cast<unsigned int>( uiBytesPerPixel * 8 ), bRLE ? " RLE" : "", iSize, iSize );
+
+			g_Results.Report( szName, uiImages, timer.GetSeconds(), uiImages * uiPixels * 4 );
+		}
+	}
+}
+}
+
+int main( int argc, char* argv[] )
+{
+	BenchOptions_t options;
+
+	if( !options.ParseCommandLine( argc, argv, "bench_tga" ) )
+		return EXIT_FAILURE;
+
+	printf( "Pixel conversion is %s\n", IsTGASwizzleVectorized() ? "vectorized" : "scalar" );
+
+	BenchDecode( options, 3, false );
+	BenchDecode( options, 4, false );
+	BenchDecode( options, 4, true );
+
+	if( !g_Results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,31 @@
+#ifndef ENGINE_CONSOLE_ALIAS_T_H
+#define ENGINE_CONSOLE_ALIAS_T_H
+
+#include <memory>
+#include <string>
+
+class CCommandScript;
+
+namespace cvar
+{
+/**
+*	A named sequence of commands. The value is compiled when the alias is set, so executing it doesn't parse it again.
+*/
+struct Alias_t
+{
+	Alias_t* pNext;
+
+	/**
+	*	Interned in the string pool.
+	*/
+	const char* pszName;
+
+	std::string szValue;
+
+	std::shared_ptr<const CCommandScript> script;
+
+	inline const char* GetName() const { return pszName; }
+};
+}
+
+#endif //ENGINE_CONSOLE_ALIAS_T_H
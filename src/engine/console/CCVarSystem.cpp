@@ -1,10 +1,21 @@
+#include <algorithm>
 #include <cassert>
 #include <cctype>
 #include <cstdlib>
 #include <cstring>
-
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "CFrameArena.h"
+#include "Clock.h"
+#include "CStringPool.h"
+#include "FileSystem2.h"
 #include "Logging.h"
 #include "Platform.h"
+#include "StringUtils.h"
 
 #include "ConCommand_t.h"
 #include "cvardef.h"
@@ -15,11 +26,28 @@
 
 namespace
 {
+/**
+*	Initial size of the name table. Enough for the engine's own commands and cvars, game libraries make it grow a couple of times.
+*/
+const size_t MIN_NAME_TABLE_SIZE = 256;
+
+/**
+*	System whose command is executing on this thread, so the built-in commands act on the system that executes them.
+*/
+thread_local cvar::CCVarSystem* g_pExecutingCVars = nullptr;
+
+bool CompareNames( const char* pszLHS, const char* pszRHS )
+{
+	return strcmp( pszLHS, pszRHS ) < 0;
+}
+
 static void Cmd_Echo_f()
 {
-	for( int iArg = 1; iArg < g_CVar.GetArgC(); ++iArg )
+	auto& cvars = cvar::CCVarSystem::GetExecuting();
+
+	for( int iArg = 1; iArg < cvars.GetArgC(); ++iArg )
 	{
-		Msg( "%s ", g_CVar.GetArgV( iArg ) );
+		Msg( "%s ", cvars.GetArgV( iArg ) );
 	}
 
 	Msg( "\n" );
@@ -27,8 +55,303 @@ static void Cmd_Echo_f()
 
 static void Cmd_Wait_f()
 {
-	g_CommandBuffer.SetWait( true );
+	cvar::CCVarSystem::GetExecuting().GetCommandBuffer().SetWait( true );
+}
+
+static void Cmd_Exec_f()
+{
+	auto& cvars = cvar::CCVarSystem::GetExecuting();
+
+	if( cvars.GetArgC() != 2 )
+	{
+		Msg( "exec <filename> : execute a script file\n" );
+		return;
+	}
+
+	auto script = cvars.GetScriptCache().Load( cvars.GetArgV( 1 ) );
+
+	if( !script )
+	{
+		Msg( "couldn't exec %s\n", cvars.GetArgV( 1 ) );
+		return;
+	}
+
+	cvars.GetCommandBuffer().InsertScript( std::move( script ) );
+}
+
+static void Cmd_Alias_f()
+{
+	auto& cvars = cvar::CCVarSystem::GetExecuting();
+
+	if( cvars.GetArgC() == 1 )
+	{
+		Msg( "Current alias commands:\n" );
+
+		for( auto pAlias = cvars.GetFirstAlias(); pAlias; pAlias = pAlias->pNext )
+		{
+			Msg( "%s : %s\n", pAlias->GetName(), pAlias->szValue.c_str() );
+		}
+
+		return;
+	}
+
+	if( cvars.GetArgC() == 2 )
+	{
+		if( auto pAlias = cvars.FindAlias( cvars.GetArgV( 1 ) ) )
+			Msg( "%s : %s\n", pAlias->GetName(), pAlias->szValue.c_str() );
+		else
+			Msg( "Alias \"%s\" not found\n", cvars.GetArgV( 1 ) );
+
+		return;
+	}
+
+	std::string szValue = cvars.GetArgV( 2 );
+
+	for( int iArg = 3; iArg < cvars.GetArgC(); ++iArg )
+	{
+		szValue += ' ';
+		szValue += cvars.GetArgV( iArg );
+	}
+
+	cvars.SetAlias( cvars.GetArgV( 1 ), szValue.c_str() );
+}
+
+static void Cmd_Unalias_f()
+{
+	auto& cvars = cvar::CCVarSystem::GetExecuting();
+
+	if( cvars.GetArgC() != 2 )
+	{
+		Msg( "unalias <name> : remove an alias\n" );
+		return;
+	}
+
+	if( !cvars.FindAlias( cvars.GetArgV( 1 ) ) )
+	{
+		Msg( "Alias \"%s\" not found\n", cvars.GetArgV( 1 ) );
+		return;
+	}
+
+	cvars.RemoveAlias( cvars.GetArgV( 1 ) );
+}
+
+/**
+*	Lists the commands or cvars whose name starts with the first argument.
+*/
+static void ListNames( const bool bCVars )
+{
+	auto& cvars = cvar::CCVarSystem::GetExecuting();
+
+	const char* pszPrefix = cvars.GetArgC() >= 2 ? cvars.GetArgV( 1 ) : "";
+
+	std::vector<const char*> names( cvars.FindNamesWithPrefix( pszPrefix, nullptr, 0 ) );
+
+	names.resize( std::min( names.size(), cvars.FindNamesWithPrefix( pszPrefix, names.data(), names.size() ) ) );
+
+	size_t uiCount = 0;
+
+	for( auto pszName : names )
+	{
+		if( bCVars )
+		{
+			if( auto pCVar = cvars.FindCVar( pszName ) )
+			{
+				Msg( "%-32s : %s\n", pszName, pCVar->string );
+				++uiCount;
+			}
+		}
+		else if( cvars.FindCommand( pszName ) )
+		{
+			Msg( "%s\n", pszName );
+			++uiCount;
+		}
+	}
+
+	Msg( "%u %s\n", static_cast<unsigned int>( uiCount ), bCVars ? "cvars" : "commands" );
+}
+
+static void Cmd_CmdList_f()
+{
+	ListNames( false );
+}
+
+static void Cmd_CVarList_f()
+{
+	ListNames( true );
+}
+
+static void Cmd_Cmd_Stats_f()
+{
+	auto& cvars = cvar::CCVarSystem::GetExecuting();
+
+	if( cvars.GetArgC() >= 2 && !strcmp( cvars.GetArgV( 1 ), "reset" ) )
+	{
+		cvars.ResetCommandStats();
+		Msg( "Command statistics reset\n" );
+		return;
+	}
+
+	std::vector<const cvar::ConCommand_t*> commands;
+
+	for( auto pCommand = cvars.GetFirstCommand(); pCommand; pCommand = pCommand->pNext )
+	{
+		if( pCommand->uiCalls > 0 )
+			commands.push_back( pCommand );
+	}
+
+	//Slowest first.
+	std::sort( commands.begin(), commands.end(),
+		[]( const cvar::ConCommand_t* pLHS, const cvar::ConCommand_t* pRHS )
+		{
+			return pLHS->uiTotalTime > pRHS->uiTotalTime;
+		}
+	);
+
+	for( auto pCommand : commands )
+	{
+		Msg( "%s: %llu calls, %.2f ms total, %.2f ms max\n", pCommand->GetName(),
+			 static_cast<unsigned long long>( pCommand->uiCalls ), pCommand->uiTotalTime / 1000.0, pCommand->uiMaxTime / 1000.0 );
+	}
+
+	Msg( "%u commands called\n", static_cast<unsigned int>( commands.size() ) );
+}
+
+static void PrintFileSystemCounters( const char* pszName, uint64_t uiOpens, uint64_t uiReads, uint64_t uiBytesRead, uint64_t uiSeeks, uint64_t uiTime )
+{
+	Msg( "%s: %llu opens, %llu reads, %llu bytes, %llu seeks, %.2f ms\n", pszName,
+		 static_cast<unsigned long long>( uiOpens ), static_cast<unsigned long long>( uiReads ),
+		 static_cast<unsigned long long>( uiBytesRead ), static_cast<unsigned long long>( uiSeeks ), uiTime / 1000.0 );
+}
+
+static void Cmd_FS_Stats_f()
+{
+	auto& cvars = cvar::CCVarSystem::GetExecuting();
+
+	if( !g_pFileSystem )
+		return;
+
+	if( cvars.GetArgC() >= 2 && !strcmp( cvars.GetArgV( 1 ), "reset" ) )
+	{
+		g_pFileSystem->ResetStats();
+		Msg( "Filesystem statistics reset\n" );
+		return;
+	}
+
+	FileSystemStats_t stats;
+
+	g_pFileSystem->GetStats( stats );
+
+	PrintFileSystemCounters( "Total", stats.uiOpens, stats.uiReads, stats.uiBytesRead, stats.uiSeeks, stats.uiTime );
+
+	Msg( "%llu failed opens\n", static_cast<unsigned long long>( stats.uiMisses ) );
+
+	std::vector<FileSystemPathStats_t> paths( g_pFileSystem->GetSearchPathStats( nullptr, 0 ) );
+
+	paths.resize( std::min( paths.size(), g_pFileSystem->GetSearchPathStats( paths.data(), paths.size() ) ) );
+
+	Msg( "\nSearch paths:\n" );
+
+	std::map<std::string, FileSystemPathStats_t> pathIDs;
+
+	for( const auto& path : paths )
+	{
+		std::string szName = path.szPath;
+
+		if( *path.szPathID )
+			szName = szName + " (" + path.szPathID + ')';
+
+		PrintFileSystemCounters( szName.c_str(), path.uiOpens, path.uiReads, path.uiBytesRead, path.uiSeeks, path.uiTime );
+
+		auto result = pathIDs.emplace( path.szPathID, path );
+
+		if( !result.second )
+		{
+			auto& total = result.first->second;
+
+			total.uiOpens += path.uiOpens;
+			total.uiReads += path.uiReads;
+			total.uiBytesRead += path.uiBytesRead;
+			total.uiSeeks += path.uiSeeks;
+			total.uiTime += path.uiTime;
+		}
+	}
+
+	Msg( "\nPath IDs:\n" );
+
+	for( const auto& pathID : pathIDs )
+	{
+		const auto& total = pathID.second;
+
+		PrintFileSystemCounters( !pathID.first.empty() ? pathID.first.c_str() : "<none>", total.uiOpens, total.uiReads, total.uiBytesRead, total.uiSeeks, total.uiTime );
+	}
+
+	//Paths are MAX_PATH sized, so keep these off the stack.
+	std::vector<FileSystemFileStats_t> files( 10 );
+
+	const auto uiFileCount = g_pFileSystem->GetSlowestFiles( files.data(), files.size() );
+
+	Msg( "\nSlowest files:\n" );
+
+	for( size_t uiIndex = 0; uiIndex < uiFileCount; ++uiIndex )
+	{
+		Msg( "%s: %.2f ms, %llu bytes\n", files[ uiIndex ].szFileName, files[ uiIndex ].uiTime / 1000.0, static_cast<unsigned long long>( files[ uiIndex ].uiBytesRead ) );
+	}
+}
+
+/**
+*	Usage: fs_audit [number of files]
+*	Lists the most accessed files. Use fs_stats reset to start over.
+*/
+static void Cmd_FS_Audit_f()
+{
+	auto& cvars = cvar::CCVarSystem::GetExecuting();
+
+	if( !g_pFileSystem )
+		return;
+
+	if( !( g_pFileSystem->GetOptions() & FileSystemOption::AUDIT_ACCESSES ) )
+	{
+		Msg( "The filesystem access audit is not enabled\n" );
+		return;
+	}
+
+	size_t uiMaxCount = 20;
+
+	if( cvars.GetArgC() >= 2 )
+		uiMaxCount = static_cast<size_t>( std::max( 1, atoi( cvars.GetArgV( 1 ) ) ) );
+
+	std::vector<FileSystemAccessStats_t> files( uiMaxCount );
+
+	const auto uiTotal = g_pFileSystem->GetAccessAudit( files.data(), files.size() );
+
+	for( size_t uiIndex = 0; uiIndex < std::min( uiTotal, files.size() ); ++uiIndex )
+	{
+		const auto& file = files[ uiIndex ];
+
+		Msg( "%s: %llu accesses, %llu bytes, %.2f ms\n", file.szFileName,
+			 static_cast<unsigned long long>( file.uiAccesses ), static_cast<unsigned long long>( file.uiBytesRead ), file.uiTime / 1000.0 );
+	}
+
+	FileSystemStats_t stats;
+
+	g_pFileSystem->GetStats( stats );
+
+	Msg( "%u files accessed, %llu accesses dropped\n", static_cast<unsigned int>( uiTotal ), static_cast<unsigned long long>( stats.uiAuditDropped ) );
 }
+
+constexpr cvar::CommandDesc_t BUILTIN_COMMANDS[] =
+{
+	cvar::CommandDesc( "echo", &::Cmd_Echo_f ),
+	cvar::CommandDesc( "wait", &::Cmd_Wait_f ),
+	cvar::CommandDesc( "exec", &::Cmd_Exec_f ),
+	cvar::CommandDesc( "alias", &::Cmd_Alias_f ),
+	cvar::CommandDesc( "unalias", &::Cmd_Unalias_f ),
+	cvar::CommandDesc( "fs_stats", &::Cmd_FS_Stats_f ),
+	cvar::CommandDesc( "fs_audit", &::Cmd_FS_Audit_f ),
+	cvar::CommandDesc( "cmd_stats", &::Cmd_Cmd_Stats_f ),
+	cvar::CommandDesc( "cmdlist", &::Cmd_CmdList_f ),
+	cvar::CommandDesc( "cvarlist", &::Cmd_CVarList_f ),
+};
 }
 
 namespace cvar
@@ -39,12 +362,34 @@ CCVarSystem::CCVarSystem()
 
 CCVarSystem::~CCVarSystem()
 {
+	while( m_pAliases )
+	{
+		Alias_t* pNext = m_pAliases->pNext;
+
+		delete m_pAliases;
+
+		m_pAliases = pNext;
+	}
+}
+
+CCVarSystem& CCVarSystem::GetExecuting()
+{
+	return g_pExecutingCVars ? *g_pExecutingCVars : g_CVar;
+}
+
+CCommandBuffer& CCVarSystem::GetCommandBuffer()
+{
+	return m_pCommandBuffer ? *m_pCommandBuffer : g_CommandBuffer;
+}
+
+CCommandScriptCache& CCVarSystem::GetScriptCache()
+{
+	return m_pScripts ? *m_pScripts : g_CommandScripts;
 }
 
 bool CCVarSystem::Initialize()
 {
-	AddCommand( "echo", &::Cmd_Echo_f );
-	AddCommand( "wait", &::Cmd_Wait_f );
+	AddCommands( ::BUILTIN_COMMANDS );
 
 	//TODO: add Cmd_Init functions. - Solokiller
 
@@ -56,35 +401,94 @@ bool CCVarSystem::AddCommand( const char* const pszName, xcommand_t pFunction, c
 	assert( pszName );
 	assert( pFunction );
 
-	if( strpbrk( pszName, " \t\"\';" ) )
-	{
-		Warning( "CCVarSystem::AddCommand: Attempted to add command with invalid characters in its name \"%s\"!\n", pszName );
+	const size_t uiLength = strlen( pszName );
+
+	if( !CanAddCommand( pszName, uiLength, StringHash( pszName, uiLength ) ) )
 		return false;
+
+	AddName( CreateCommand( pszName, pFunction, flags ), nullptr, nullptr );
+
+	return true;
+}
+
+bool CCVarSystem::AddCommands( const CommandDesc_t* pCommands, const size_t uiCount )
+{
+	assert( pCommands || uiCount == 0 );
+
+	ReserveNames( uiCount );
+
+	const size_t uiFirstName = m_SortedNames.size();
+
+	bool bAddedAll = true;
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const auto& desc = pCommands[ uiIndex ];
+
+		assert( desc.pszName );
+		assert( desc.pFunction );
+		assert( desc.uiHash == StringHash( desc.pszName ) );
+
+		if( !CanAddCommand( desc.pszName, strlen( desc.pszName ), desc.uiHash ) )
+		{
+			bAddedAll = false;
+			continue;
+		}
+
+		NameEntry_t entry{};
+
+		entry.uiHash = desc.uiHash;
+		entry.pCommand = CreateCommand( desc.pszName, desc.pFunction, desc.flags );
+
+		AddNameUnsorted( entry );
 	}
 
-	if( FindCVar( pszName ) )
+	SortNames( uiFirstName );
+
+	++m_uiNameGeneration;
+
+	return bAddedAll;
+}
+
+bool CCVarSystem::CanAddCommand( const char* const pszName, const size_t uiLength, const size_t uiHash ) const
+{
+	if( strpbrk( pszName, " \t\"\';" ) )
 	{
-		Warning( "CCVarSystem::AddCommand: \"%s\" already defined as a cvar\n", pszName );
+		Warning( "CCVarSystem::AddCommand: Attempted to add command with invalid characters in its name \"%s\"!\n", pszName );
 		return false;
 	}
 
-	if( FindCommand( pszName ) )
+	if( const NameEntry_t* pEntry = FindName( pszName, uiLength, uiHash ) )
 	{
-		Warning( "CCVarSystem::AddCommand: Command \"%s\" already defined\n", pszName );
+		if( pEntry->pCVar )
+			Warning( "CCVarSystem::AddCommand: \"%s\" already defined as a cvar\n", pszName );
+		else if( pEntry->pAlias )
+			Warning( "CCVarSystem::AddCommand: \"%s\" already defined as an alias\n", pszName );
+		else
+			Warning( "CCVarSystem::AddCommand: Command \"%s\" already defined\n", pszName );
+
 		return false;
 	}
 
+	return true;
+}
+
+ConCommand_t* CCVarSystem::CreateCommand( const char* const pszName, xcommand_t pFunction, const uint32_t flags )
+{
 	ConCommand_t* pCommand = new ConCommand_t;
 
-	pCommand->pszName = pszName;
+	pCommand->pszName = GetStringPool().Intern( pszName );
 	pCommand->pFunction = pFunction;
 	pCommand->flags = flags;
+	pCommand->uiCalls = 0;
+	pCommand->uiTotalTime = 0;
+	pCommand->uiMaxTime = 0;
 
 	pCommand->pNext = m_pCommands;
 
 	m_pCommands = pCommand;
 
-	return true;
+	return pCommand;
 }
 
 void CCVarSystem::RemoveCommand( const char* const pszName )
@@ -96,18 +500,26 @@ void CCVarSystem::RemoveCommand( const char* const pszName )
 		return;
 	}
 
+	//Command names are interned, so a name that was never interned isn't a command.
+	const char* const pszInternedName = GetStringPool().Find( pszName );
+
+	if( !pszInternedName )
+		return;
+
 	ConCommand_t* pPrev = nullptr;
 	ConCommand_t* pCommand = m_pCommands;
 
 	while( pCommand )
 	{
-		if( strcmp( pszName, pCommand->GetName() ) == 0 )
+		if( pCommand->GetName() == pszInternedName )
 		{
 			if( pPrev )
 				pPrev->pNext = pCommand->pNext;
 			else
 				m_pCommands = pCommand->pNext;
 
+			RemoveName( pCommand->GetName() );
+
 			delete pCommand;
 			return;
 		}
@@ -117,6 +529,16 @@ void CCVarSystem::RemoveCommand( const char* const pszName )
 	}
 }
 
+void CCVarSystem::ResetCommandStats()
+{
+	for( auto pCommand = m_pCommands; pCommand; pCommand = pCommand->pNext )
+	{
+		pCommand->uiCalls = 0;
+		pCommand->uiTotalTime = 0;
+		pCommand->uiMaxTime = 0;
+	}
+}
+
 const ConCommand_t* CCVarSystem::FindCommand( const char* const pszName ) const
 {
 	assert( pszName );
@@ -124,35 +546,88 @@ const ConCommand_t* CCVarSystem::FindCommand( const char* const pszName ) const
 	if( !( *pszName ) )
 		return nullptr;
 
-	ConCommand_t* pCommand = m_pCommands;
-
-	while( pCommand )
-	{
-		if( strcmp( pszName, pCommand->GetName() ) == 0 )
-			return pCommand;
-
-		pCommand = pCommand->pNext;
-	}
+	const NameEntry_t* pEntry = FindName( pszName );
 
-	return nullptr;
+	return pEntry ? pEntry->pCommand : nullptr;
 }
 
 bool CCVarSystem::AddCVar( cvar_t* pCVar )
 {
 	assert( pCVar );
 
-	if( FindCVar( pCVar->pszName ) )
-	{
-		Warning( "CCVarSystem::AddCVar: Can't register variable \"%s\", already defined\n", pCVar->pszName );
+	const size_t uiLength = strlen( pCVar->pszName );
+
+	if( !CanAddCVar( pCVar->pszName, uiLength, StringHash( pCVar->pszName, uiLength ) ) )
 		return false;
+
+	LinkCVar( pCVar );
+
+	AddName( nullptr, nullptr, pCVar );
+
+	return true;
+}
+
+bool CCVarSystem::AddCVars( const CVarDesc_t* pCVars, const size_t uiCount )
+{
+	assert( pCVars || uiCount == 0 );
+
+	ReserveNames( uiCount );
+
+	const size_t uiFirstName = m_SortedNames.size();
+
+	bool bAddedAll = true;
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const auto& desc = pCVars[ uiIndex ];
+
+		assert( desc.pCVar );
+
+		//The table's name has to match the cvar's, or lookups won't find it.
+		assert( desc.uiHash == StringHash( desc.pCVar->pszName ) );
+
+		if( !CanAddCVar( desc.pCVar->pszName, strlen( desc.pCVar->pszName ), desc.uiHash ) )
+		{
+			bAddedAll = false;
+			continue;
+		}
+
+		LinkCVar( desc.pCVar );
+
+		NameEntry_t entry{};
+
+		entry.uiHash = desc.uiHash;
+		entry.pCVar = desc.pCVar;
+
+		AddNameUnsorted( entry );
 	}
 
-	if( FindCommand( pCVar->pszName ) )
+	SortNames( uiFirstName );
+
+	++m_uiNameGeneration;
+
+	return bAddedAll;
+}
+
+bool CCVarSystem::CanAddCVar( const char* const pszName, const size_t uiLength, const size_t uiHash ) const
+{
+	if( const NameEntry_t* pEntry = FindName( pszName, uiLength, uiHash ) )
 	{
-		Warning( "CCVarSystem::AddCVar: \"%s\" is a command\n", pCVar->pszName );
+		if( pEntry->pCVar )
+			Warning( "CCVarSystem::AddCVar: Can't register variable \"%s\", already defined\n", pszName );
+		else if( pEntry->pAlias )
+			Warning( "CCVarSystem::AddCVar: \"%s\" is an alias\n", pszName );
+		else
+			Warning( "CCVarSystem::AddCVar: \"%s\" is a command\n", pszName );
+
 		return false;
 	}
 
+	return true;
+}
+
+void CCVarSystem::LinkCVar( cvar_t* pCVar )
+{
 	//Copy the value off, because it will be delete[]'d later on.
 	const char* pszString = pCVar->string;
 	pCVar->string = new char[ strlen( pszString ) + 1 ];
@@ -162,7 +637,9 @@ bool CCVarSystem::AddCVar( cvar_t* pCVar )
 	pCVar->next = m_pCVars;
 	m_pCVars = pCVar;
 
-	return true;
+	//Its line is formatted when the archive is next written. Adding it doesn't make the archive dirty, so the config isn't written until something changes.
+	if( pCVar->flags & FCVAR_ARCHIVE )
+		m_ArchivedCVars.push_back( ArchivedCVar_t{ pCVar, m_Archive.size(), 0, true } );
 }
 
 void CCVarSystem::RemoveCVar( const char* const pszName )
@@ -179,6 +656,36 @@ void CCVarSystem::RemoveCVar( const char* const pszName )
 			else
 				m_pCVars = pCVar->next;
 
+			RemoveName( pCVar->pszName );
+
+			m_ChangeCallbacks.erase( std::remove_if( m_ChangeCallbacks.begin(), m_ChangeCallbacks.end(),
+				[ = ]( const ChangeCallback_t& callback )
+				{
+					return callback.pCVar == pCVar;
+				}
+			), m_ChangeCallbacks.end() );
+
+			auto archived = std::find_if( m_ArchivedCVars.begin(), m_ArchivedCVars.end(),
+				[ = ]( const ArchivedCVar_t& entry )
+				{
+					return entry.pCVar == pCVar;
+				}
+			);
+
+			if( archived != m_ArchivedCVars.end() )
+			{
+				const size_t uiLength = archived->uiLength;
+
+				m_Archive.erase( m_Archive.begin() + archived->uiOffset, m_Archive.begin() + archived->uiOffset + uiLength );
+
+				for( auto it = m_ArchivedCVars.erase( archived ); it != m_ArchivedCVars.end(); ++it )
+				{
+					it->uiOffset -= uiLength;
+				}
+
+				m_bArchiveDirty = true;
+			}
+
 			delete[] pCVar->string;
 			return;
 		}
@@ -190,22 +697,307 @@ void CCVarSystem::RemoveCVar( const char* const pszName )
 
 const cvar_t* CCVarSystem::FindCVar( const char* const pszName ) const
 {
-	cvar_t* pCVar = m_pCVars;
+	const NameEntry_t* pEntry = FindName( pszName );
 
-	while( pCVar )
+	return pEntry ? pEntry->pCVar : nullptr;
+}
+
+cvar_t* CCVarSystem::FindCVar( const char* const pszName )
+{
+	return const_cast<cvar_t*>( const_cast<const CCVarSystem* const>( this )->FindCVar( pszName ) );
+}
+
+bool CCVarSystem::AddChangeCallback( const char* const pszCVar, CVarChangeFunc_t pCallback, void* pContext )
+{
+	assert( pszCVar );
+	assert( pCallback );
+
+	const cvar_t* pCVar = GetCVarWarn( pszCVar );
+
+	if( !pCVar )
+		return false;
+
+	m_ChangeCallbacks.push_back( ChangeCallback_t{ pCVar, pCallback, pContext } );
+
+	return true;
+}
+
+void CCVarSystem::RemoveChangeCallback( const char* const pszCVar, CVarChangeFunc_t pCallback, void* pContext )
+{
+	assert( pszCVar );
+
+	const cvar_t* pCVar = FindCVar( pszCVar );
+
+	for( auto it = m_ChangeCallbacks.begin(); it != m_ChangeCallbacks.end(); ++it )
 	{
-		if( strcmp( pszName, pCVar->pszName ) == 0 )
-			return pCVar;
+		if( it->pCVar == pCVar && it->pCallback == pCallback && it->pContext == pContext )
+		{
+			m_ChangeCallbacks.erase( it );
+			return;
+		}
+	}
+}
 
-		pCVar = pCVar->next;
+bool CCVarSystem::SetAlias( const char* const pszName, const char* const pszValue )
+{
+	assert( pszName );
+	assert( pszValue );
+
+	if( !( *pszName ) || strpbrk( pszName, " \t\"\';" ) )
+	{
+		Warning( "CCVarSystem::SetAlias: Invalid alias name \"%s\"\n", pszName );
+		return false;
+	}
+
+	Alias_t* pAlias = nullptr;
+
+	if( const NameEntry_t* pEntry = FindName( pszName ) )
+	{
+		if( !pEntry->pAlias )
+		{
+			Warning( "CCVarSystem::SetAlias: \"%s\" is already defined as a %s\n", pszName, pEntry->pCVar ? "cvar" : "command" );
+			return false;
+		}
+
+		pAlias = pEntry->pAlias;
+	}
+
+	auto script = std::make_shared<CCommandScript>();
+
+	script->Compile( pszValue, strlen( pszValue ) );
+
+	if( !pAlias )
+	{
+		pAlias = new Alias_t;
+
+		pAlias->pszName = GetStringPool().Intern( pszName );
+
+		pAlias->pNext = m_pAliases;
+
+		m_pAliases = pAlias;
+
+		AddName( nullptr, pAlias, nullptr );
+	}
+
+	//Scripts that are executing the old value keep it alive until they're done with it.
+	pAlias->szValue = pszValue;
+	pAlias->script = std::move( script );
+
+	return true;
+}
+
+void CCVarSystem::RemoveAlias( const char* const pszName )
+{
+	assert( pszName );
+
+	//Alias names are interned, so a name that was never interned isn't an alias.
+	const char* const pszInternedName = GetStringPool().Find( pszName );
+
+	if( !pszInternedName )
+		return;
+
+	Alias_t* pPrev = nullptr;
+	Alias_t* pAlias = m_pAliases;
+
+	while( pAlias )
+	{
+		if( pAlias->GetName() == pszInternedName )
+		{
+			if( pPrev )
+				pPrev->pNext = pAlias->pNext;
+			else
+				m_pAliases = pAlias->pNext;
+
+			RemoveName( pAlias->GetName() );
+
+			delete pAlias;
+			return;
+		}
+
+		pPrev = pAlias;
+		pAlias = pAlias->pNext;
+	}
+}
+
+const Alias_t* CCVarSystem::FindAlias( const char* const pszName ) const
+{
+	assert( pszName );
+
+	const NameEntry_t* pEntry = FindName( pszName );
+
+	return pEntry ? pEntry->pAlias : nullptr;
+}
+
+size_t CCVarSystem::FindNamesWithPrefix( const char* const pszPrefix, const char** ppszNames, const size_t uiMaxNames ) const
+{
+	assert( pszPrefix );
+
+	const size_t uiLength = strlen( pszPrefix );
+
+	size_t uiCount = 0;
+
+	//All names with the prefix sort after the prefix itself, and before any other name that sorts after it.
+	for( auto it = std::lower_bound( m_SortedNames.begin(), m_SortedNames.end(), pszPrefix, &CompareNames );
+		 it != m_SortedNames.end() && strncmp( *it, pszPrefix, uiLength ) == 0;
+		 ++it, ++uiCount )
+	{
+		if( ppszNames && uiCount < uiMaxNames )
+			ppszNames[ uiCount ] = *it;
+	}
+
+	return uiCount;
+}
+
+const char* CCVarSystem::NameEntry_t::GetName() const
+{
+	if( pCommand )
+		return pCommand->GetName();
+
+	if( pAlias )
+		return pAlias->GetName();
+
+	return pCVar->pszName;
+}
+
+const CCVarSystem::NameEntry_t* CCVarSystem::FindName( const char* const pszName ) const
+{
+	return FindName( pszName, strlen( pszName ) );
+}
+
+const CCVarSystem::NameEntry_t* CCVarSystem::FindName( const char* const pszName, const size_t uiLength ) const
+{
+	return FindName( pszName, uiLength, StringHash( pszName, uiLength ) );
+}
+
+const CCVarSystem::NameEntry_t* CCVarSystem::FindName( const char* const pszName, const size_t uiLength, const size_t uiHash ) const
+{
+	if( m_NameTable.empty() )
+		return nullptr;
+
+	const size_t uiMask = m_NameTable.size() - 1;
+
+	for( size_t uiSlot = uiHash & uiMask; !m_NameTable[ uiSlot ].IsEmpty(); uiSlot = ( uiSlot + 1 ) & uiMask )
+	{
+		const auto& entry = m_NameTable[ uiSlot ];
+
+		if( entry.uiHash != uiHash )
+			continue;
+
+		const char* const pszEntryName = entry.GetName();
+
+		if( strncmp( pszEntryName, pszName, uiLength ) == 0 && pszEntryName[ uiLength ] == '\0' )
+			return &entry;
 	}
 
 	return nullptr;
 }
 
-cvar_t* CCVarSystem::FindCVar( const char* const pszName )
+void CCVarSystem::AddName( ConCommand_t* pCommand, Alias_t* pAlias, cvar_t* pCVar )
 {
-	return const_cast<cvar_t*>( const_cast<const CCVarSystem* const>( this )->FindCVar( pszName ) );
+	ReserveNames( 1 );
+
+	NameEntry_t entry{};
+
+	entry.pCommand = pCommand;
+	entry.pAlias = pAlias;
+	entry.pCVar = pCVar;
+	entry.uiHash = StringHash( entry.GetName() );
+
+	InsertName( entry );
+
+	const char* pszName = entry.GetName();
+
+	m_SortedNames.insert( std::lower_bound( m_SortedNames.begin(), m_SortedNames.end(), pszName, &CompareNames ), pszName );
+
+	++m_uiNameCount;
+	++m_uiNameGeneration;
+}
+
+void CCVarSystem::ReserveNames( const size_t uiCount )
+{
+	//Keep the table at most half full.
+	if( ( m_uiNameCount + uiCount ) * 2 <= m_NameTable.size() )
+		return;
+
+	size_t uiSize = std::max( MIN_NAME_TABLE_SIZE, m_NameTable.size() * 2 );
+
+	while( ( m_uiNameCount + uiCount ) * 2 > uiSize )
+		uiSize *= 2;
+
+	TrackedVector_t<NameEntry_t, MemoryTag::CONSOLE> oldTable( uiSize, NameEntry_t{} );
+
+	oldTable.swap( m_NameTable );
+
+	for( const auto& entry : oldTable )
+	{
+		if( !entry.IsEmpty() )
+			InsertName( entry );
+	}
+}
+
+void CCVarSystem::AddNameUnsorted( const NameEntry_t& entry )
+{
+	InsertName( entry );
+
+	m_SortedNames.push_back( entry.GetName() );
+
+	++m_uiNameCount;
+}
+
+void CCVarSystem::SortNames( const size_t uiFirst )
+{
+	const auto first = m_SortedNames.begin() + uiFirst;
+
+	std::sort( first, m_SortedNames.end(), &CompareNames );
+	std::inplace_merge( m_SortedNames.begin(), first, m_SortedNames.end(), &CompareNames );
+}
+
+void CCVarSystem::InsertName( const NameEntry_t& entry )
+{
+	const size_t uiMask = m_NameTable.size() - 1;
+
+	size_t uiSlot = entry.uiHash & uiMask;
+
+	while( !m_NameTable[ uiSlot ].IsEmpty() )
+		uiSlot = ( uiSlot + 1 ) & uiMask;
+
+	m_NameTable[ uiSlot ] = entry;
+}
+
+void CCVarSystem::RemoveName( const char* const pszName )
+{
+	const NameEntry_t* pEntry = FindName( pszName );
+
+	if( !pEntry )
+		return;
+
+	{
+		auto it = std::lower_bound( m_SortedNames.begin(), m_SortedNames.end(), pszName, &CompareNames );
+
+		m_SortedNames.erase( it );
+	}
+
+	const size_t uiMask = m_NameTable.size() - 1;
+
+	size_t uiSlot = pEntry - m_NameTable.data();
+
+	//Shift later entries of the probe sequence back into the hole, so lookups don't need tombstones.
+	for( size_t uiNext = ( uiSlot + 1 ) & uiMask; !m_NameTable[ uiNext ].IsEmpty(); uiNext = ( uiNext + 1 ) & uiMask )
+	{
+		const size_t uiHome = m_NameTable[ uiNext ].uiHash & uiMask;
+
+		//Distance from the entry's home slot to its current slot, and to the hole. Move it if the hole is on its probe path.
+		if( ( ( uiNext - uiHome ) & uiMask ) >= ( ( uiNext - uiSlot ) & uiMask ) )
+		{
+			m_NameTable[ uiSlot ] = m_NameTable[ uiNext ];
+			uiSlot = uiNext;
+		}
+	}
+
+	m_NameTable[ uiSlot ] = NameEntry_t{};
+
+	--m_uiNameCount;
+	++m_uiNameGeneration;
 }
 
 const cvar_t* CCVarSystem::GetCVarWarn( const char* const pszCVar ) const
@@ -275,13 +1067,116 @@ void CCVarSystem::SetCVarDirect( cvar_t* pCVar, const char* const pszValue )
 	if( !pCVar )
 		return;
 
-	delete[] pCVar->string;
+	//Kept until the callbacks have seen it.
+	std::unique_ptr<char[]> oldString( pCVar->string );
 
 	pCVar->string = new char[ strlen( pszValue ) + 1 ];
 	strcpy( pCVar->string, pszValue );
 	pCVar->value = static_cast<float>( atof( pCVar->string ) );
 
 	Msg( "\"%s\" changed to \"%s\"\n", pCVar->pszName, pCVar->string );
+
+	//Only mark the cvar, its line is formatted when the archive is written. Sliders set cvars many times before that.
+	if( ( pCVar->flags & FCVAR_ARCHIVE ) && strcmp( oldString.get(), pCVar->string ) )
+	{
+		for( auto& archived : m_ArchivedCVars )
+		{
+			if( archived.pCVar == pCVar )
+			{
+				archived.bChanged = true;
+				m_bArchiveDirty = true;
+				break;
+			}
+		}
+	}
+
+	//Callbacks can add or remove callbacks, so call them from a copy.
+	FrameVector_t<ChangeCallback_t> callbacks;
+
+	for( const auto& callback : m_ChangeCallbacks )
+	{
+		if( callback.pCVar == pCVar )
+			callbacks.push_back( callback );
+	}
+
+	for( const auto& callback : callbacks )
+	{
+		callback.pCallback( pCVar, oldString.get(), callback.pContext );
+	}
+}
+
+bool CCVarSystem::WriteArchive( IFileSystem2& fileSystem, const char* const pszFileName, const bool bForce )
+{
+	assert( pszFileName );
+
+	if( !m_bArchiveDirty && !bForce )
+		return true;
+
+	UpdateArchive();
+
+	FileHandle_t hFile = fileSystem.Open( pszFileName, "wb" );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Warning( "CCVarSystem::WriteArchive: Couldn't open \"%s\" for writing\n", pszFileName );
+		return false;
+	}
+
+	const int iSize = static_cast<int>( m_Archive.size() );
+
+	bool bSuccess = fileSystem.Write( m_Archive.data(), iSize, hFile ) == iSize;
+
+	fileSystem.Flush( hFile );
+
+	bSuccess = bSuccess && fileSystem.IsOk( hFile );
+
+	fileSystem.Close( hFile );
+
+	if( !bSuccess )
+	{
+		Warning( "CCVarSystem::WriteArchive: Couldn't write \"%s\"\n", pszFileName );
+		return false;
+	}
+
+	m_bArchiveDirty = false;
+
+	return true;
+}
+
+void CCVarSystem::UpdateArchive()
+{
+	std::string szLine;
+
+	//Lines after one that changed length move by the difference, so one pass updates everything.
+	ptrdiff_t iShift = 0;
+
+	for( auto& archived : m_ArchivedCVars )
+	{
+		archived.uiOffset = static_cast<size_t>( static_cast<ptrdiff_t>( archived.uiOffset ) + iShift );
+
+		if( !archived.bChanged )
+			continue;
+
+		archived.bChanged = false;
+
+		szLine = archived.pCVar->pszName;
+		szLine += " \"";
+		szLine += archived.pCVar->string;
+		szLine += "\"\n";
+
+		const auto itLine = m_Archive.begin() + archived.uiOffset;
+
+		if( szLine.size() > archived.uiLength )
+			m_Archive.insert( itLine + archived.uiLength, szLine.size() - archived.uiLength, '\0' );
+		else
+			m_Archive.erase( itLine + szLine.size(), itLine + archived.uiLength );
+
+		memcpy( m_Archive.data() + archived.uiOffset, szLine.data(), szLine.size() );
+
+		iShift += static_cast<ptrdiff_t>( szLine.size() ) - static_cast<ptrdiff_t>( archived.uiLength );
+
+		archived.uiLength = szLine.size();
+	}
 }
 
 void CCVarSystem::ExecuteString( const char* const pszString, const Source source )
@@ -295,15 +1190,74 @@ void CCVarSystem::ExecuteString( const char* const pszString, const Source sourc
 		return;
 	}
 
-	if( const ConCommand_t* pCommand = FindCommand( m_Command.Arg( 0 ) ) )
+	//Commands, aliases and cvars share the name table, so a single lookup finds any of them.
+	const auto& name = m_Command.GetToken( 0 );
+
+	const NameEntry_t* pEntry = FindName( name.pszData, name.uiLength );
+
+	if( pEntry )
+		ExecuteCommand( pEntry->pCommand, pEntry->pAlias, pEntry->pCVar );
+	else
+		ExecuteCommand( nullptr, nullptr, nullptr );
+}
+
+void CCVarSystem::ExecuteArgs( const int iArgC, const char* const* ppArgV, CachedName_t& name, const Source source )
+{
+	assert( iArgC > 0 );
+
+	if( !m_Command.Initialize( iArgC, ppArgV ) )
+		return;
+
+	if( name.uiGeneration != m_uiNameGeneration )
 	{
+		const NameEntry_t* pEntry = FindName( m_Command.Arg( 0 ) );
+
+		name.pCommand = pEntry ? pEntry->pCommand : nullptr;
+		name.pAlias = pEntry ? pEntry->pAlias : nullptr;
+		name.pCVar = pEntry ? pEntry->pCVar : nullptr;
+		name.uiGeneration = m_uiNameGeneration;
+	}
+
+	ExecuteCommand( name.pCommand, name.pAlias, name.pCVar );
+}
+
+void CCVarSystem::ExecuteCommand( ConCommand_t* pCommand, Alias_t* pAlias, cvar_t* pCVar )
+{
+	if( pCommand )
+	{
+		const unsigned int uiGeneration = m_uiNameGeneration;
+
+		const uint64_t uiStartTime = Plat_GetMicroseconds();
+
+		auto pPrevious = g_pExecutingCVars;
+
+		g_pExecutingCVars = this;
+
 		pCommand->pFunction();
+
+		g_pExecutingCVars = pPrevious;
+
+		//The command may have removed itself, only count it if nothing was removed.
+		if( uiGeneration == m_uiNameGeneration )
+		{
+			const uint64_t uiTime = Plat_GetMicroseconds() - uiStartTime;
+
+			++pCommand->uiCalls;
+			pCommand->uiTotalTime += uiTime;
+			pCommand->uiMaxTime = std::max( pCommand->uiMaxTime, uiTime );
+		}
+
 		return;
 	}
 
-	//TODO: alias - Solokiller
+	//The alias' commands execute before the rest of the buffer, no text is inserted.
+	if( pAlias )
+	{
+		GetCommandBuffer().InsertScript( pAlias->script );
+		return;
+	}
 
-	if( cvar_t* pCVar = FindCVar( m_Command.Arg( 0 ) ) )
+	if( pCVar )
 	{
 		if( m_Command.ArgC() == 1 )
 		{
@@ -1,9 +1,19 @@
 #ifndef ENGINE_CONSOLE_CCVARSYSTEM_H
 #define ENGINE_CONSOLE_CCVARSYSTEM_H
 
-#include "CCommand.h"
+#include <cstddef>
+#include <vector>
 
+#include "CCommandView.h"
+#include "FileSystem2.h"
+#include "MemoryTracking.h"
+
+#include "Alias_t.h"
 #include "ConCommand_t.h"
+#include "RegistrationTable.h"
+
+class CCommandBuffer;
+class CCommandScriptCache;
 
 namespace cvar
 {
@@ -15,35 +25,267 @@ enum class Source
 
 typedef struct cvar_s cvar_t;
 
+/**
+*	Called after a cvar's value has been set.
+*	@param pCVar The cvar. Its string and value have already been updated.
+*	@param pszOldValue Previous value.
+*	@param pContext Context pointer passed when the callback was added.
+*/
+using CVarChangeFunc_t = void ( * )( cvar_t* pCVar, const char* pszOldValue, void* pContext );
+
 class CCVarSystem final
 {
+public:
+	/**
+	*	Command or cvar that a name resolved to, for callers that execute the same commands repeatedly.
+	*	Stays valid until a command or cvar is added or removed. Zero initialized names are resolved on first use.
+	*/
+	struct CachedName_t
+	{
+		ConCommand_t* pCommand;
+		Alias_t* pAlias;
+		cvar_t* pCVar;
+		unsigned int uiGeneration;
+	};
+
 public:
 	CCVarSystem();
 	~CCVarSystem();
 
+	/**
+	*	@return The system whose command is executing on this thread, or g_CVar if no command is executing.
+	*	Commands that can be added to more than one system use this instead of g_CVar.
+	*/
+	static CCVarSystem& GetExecuting();
+
 	bool Initialize();
 
+	/**
+	*	@return Buffer that wait, exec and aliases insert into. Set by CCommandBuffer::Initialize, g_CommandBuffer until then.
+	*/
+	CCommandBuffer& GetCommandBuffer();
+
+	void SetCommandBuffer( CCommandBuffer* pBuffer ) { m_pCommandBuffer = pBuffer; }
+
+	/**
+	*	@return Cache that exec loads scripts through, g_CommandScripts by default.
+	*/
+	CCommandScriptCache& GetScriptCache();
+
+	/**
+	*	Sets the cache that exec loads scripts through. Compiled scripts cache their lookups in the system that executes them,
+	*	so each system needs its own cache.
+	*/
+	void SetScriptCache( CCommandScriptCache* pScripts ) { m_pScripts = pScripts; }
+
 	//Commands
 
 	bool AddCommand( const char* const pszName, xcommand_t pFunction, const uint32_t flags = CmdFlag::NONE );
 
+	/**
+	*	Adds a table of commands at once. The name table grows at most once and the sorted names are merged once,
+	*	and the names aren't hashed again, so this is much cheaper than adding them one by one.
+	*	@return Whether all commands were added. Commands whose names are invalid or taken are skipped with a warning, like AddCommand does.
+	*/
+	bool AddCommands( const CommandDesc_t* pCommands, const size_t uiCount );
+
+	template<size_t COUNT>
+	bool AddCommands( const CommandDesc_t ( &commands )[ COUNT ] )
+	{
+		return AddCommands( commands, COUNT );
+	}
+
 	void RemoveCommand( const char* const pszName );
 
 	const ConCommand_t* FindCommand( const char* const pszName ) const;
 
+	/**
+	*	@return The first command, in reverse order of registration.
+	*/
+	const ConCommand_t* GetFirstCommand() const { return m_pCommands; }
+
+	/**
+	*	Resets the profiling counters of all commands.
+	*/
+	void ResetCommandStats();
+
 	//Cvars
 
 	bool AddCVar( cvar_t* pCVar );
 
+	/**
+	*	Adds a table of cvars at once.
+	*	@return Whether all cvars were added. Cvars whose names are taken are skipped with a warning, like AddCVar does.
+	*	@see AddCommands
+	*/
+	bool AddCVars( const CVarDesc_t* pCVars, const size_t uiCount );
+
+	template<size_t COUNT>
+	bool AddCVars( const CVarDesc_t ( &cvars )[ COUNT ] )
+	{
+		return AddCVars( cvars, COUNT );
+	}
+
 	void RemoveCVar( const char* const pszName );
 
 	const cvar_t* FindCVar( const char* const pszName ) const;
 
 	cvar_t* FindCVar( const char* const pszName );
 
+	/**
+	*	Adds a callback that is called whenever the given cvar is set.
+	*	Callbacks are removed when the cvar is removed.
+	*	@return Whether the callback was added.
+	*/
+	bool AddChangeCallback( const char* const pszCVar, CVarChangeFunc_t pCallback, void* pContext = nullptr );
+
+	void RemoveChangeCallback( const char* const pszCVar, CVarChangeFunc_t pCallback, void* pContext = nullptr );
+
+	/**
+	*	@return Counter that changes whenever a command, alias or cvar is added or removed. Used to tell when cached lookups are out of date.
+	*/
+	unsigned int GetNameGeneration() const { return m_uiNameGeneration; }
+
+	/**
+	*	Finds the names of all commands, aliases and cvars that start with the given prefix, in sorted order.
+	*	Costs a binary search plus the matching names, so it can be used for autocompletion on every keypress.
+	*	@param pszPrefix Prefix to match. An empty prefix matches all names.
+	*	@param ppszNames Receives up to uiMaxNames names. Can be null to only count them.
+	*	@param uiMaxNames Maximum number of names to store in ppszNames.
+	*	@return Number of matching names. Can be larger than uiMaxNames.
+	*/
+	size_t FindNamesWithPrefix( const char* const pszPrefix, const char** ppszNames, const size_t uiMaxNames ) const;
+
+	//Archive
+
+	/**
+	*	@return Whether a cvar flagged with FCVAR_ARCHIVE was changed or removed since the archive was last written.
+	*/
+	bool IsArchiveDirty() const { return m_bArchiveDirty; }
+
+	/**
+	*	Writes all cvars flagged with FCVAR_ARCHIVE to a config file.
+	*	The file is written from an image of it that is kept as it was last written, so only the lines of cvars that changed since are formatted again.
+	*	With write-behind enabled, the file is written to disk by the filesystem's writer thread.
+	*	@param fileSystem Filesystem to write through.
+	*	@param pszFileName Name of the config file.
+	*	@param bForce Whether to write the file if nothing changed since the last write.
+	*	@return Whether the file was written, or didn't need to be.
+	*/
+	bool WriteArchive( IFileSystem2& fileSystem, const char* const pszFileName, const bool bForce = false );
+
+	//Aliases
+
+	/**
+	*	Sets an alias, adding it if it doesn't exist yet.
+	*	@param pszName Name of the alias. Can't be the name of a command or cvar.
+	*	@param pszValue Commands to execute.
+	*	@return Whether the alias was set.
+	*/
+	bool SetAlias( const char* const pszName, const char* const pszValue );
+
+	void RemoveAlias( const char* const pszName );
+
+	const Alias_t* FindAlias( const char* const pszName ) const;
+
+	/**
+	*	@return The first alias, in reverse order of creation.
+	*/
+	const Alias_t* GetFirstAlias() const { return m_pAliases; }
+
 private:
 	const cvar_t* GetCVarWarn( const char* const pszCVar ) const;
 
+	/**
+	*	@return Whether a command can be added with the given name. Warns about why if it can't.
+	*/
+	bool CanAddCommand( const char* const pszName, const size_t uiLength, const size_t uiHash ) const;
+
+	/**
+	*	@return Whether a cvar can be added with the given name. Warns about why if it can't.
+	*/
+	bool CanAddCVar( const char* const pszName, const size_t uiLength, const size_t uiHash ) const;
+
+	/**
+	*	Creates a command and links it into the command list. Its name is not added.
+	*/
+	ConCommand_t* CreateCommand( const char* const pszName, xcommand_t pFunction, const uint32_t flags );
+
+	/**
+	*	Takes ownership of a cvar's value and links it into the cvar list. Its name is not added.
+	*/
+	void LinkCVar( cvar_t* pCVar );
+
+	/**
+	*	Slot in the name table. Commands, aliases and cvars share a namespace, so each name has one slot that refers to one of them.
+	*/
+	struct NameEntry_t
+	{
+		size_t uiHash;
+		ConCommand_t* pCommand;
+		Alias_t* pAlias;
+		cvar_t* pCVar;
+
+		bool IsEmpty() const { return !pCommand && !pAlias && !pCVar; }
+
+		const char* GetName() const;
+	};
+
+	/**
+	*	@return The slot for the given name, or null if it isn't registered.
+	*/
+	const NameEntry_t* FindName( const char* const pszName ) const;
+
+	/**
+	*	@copydoc FindName( const char* const pszName ) const
+	*	@param uiLength Length of the name. pszName doesn't have to be null terminated.
+	*/
+	const NameEntry_t* FindName( const char* const pszName, const size_t uiLength ) const;
+
+	/**
+	*	@copydoc FindName( const char* const pszName, const size_t uiLength ) const
+	*	@param uiHash StringHash of the name.
+	*/
+	const NameEntry_t* FindName( const char* const pszName, const size_t uiLength, const size_t uiHash ) const;
+
+	/**
+	*	Adds a slot for a name that isn't registered.
+	*/
+	void AddName( ConCommand_t* pCommand, Alias_t* pAlias, cvar_t* pCVar );
+
+	/**
+	*	Grows the name table so that the given number of names can be added without growing it again.
+	*/
+	void ReserveNames( const size_t uiCount );
+
+	/**
+	*	Adds a slot for a name that isn't registered, without keeping the sorted names sorted or invalidating cached names.
+	*	Bulk adds call SortNames and bump the generation once they're done.
+	*/
+	void AddNameUnsorted( const NameEntry_t& entry );
+
+	/**
+	*	Sorts the names that were appended to the sorted names, starting at uiFirst, into the rest.
+	*/
+	void SortNames( const size_t uiFirst );
+
+	/**
+	*	Inserts a slot without growing the table. There must be room for it.
+	*/
+	void InsertName( const NameEntry_t& entry );
+
+	void RemoveName( const char* const pszName );
+
+	/**
+	*	Formats the lines of archived cvars that changed into the archive image.
+	*/
+	void UpdateArchive();
+
+	/**
+	*	Executes m_Command using the command or cvar that its name resolved to.
+	*/
+	void ExecuteCommand( ConCommand_t* pCommand, Alias_t* pAlias, cvar_t* pCVar );
+
 public:
 	const char* GetCVarString( const char* const pszCVar ) const;
 
@@ -59,6 +301,14 @@ public:
 
 	void ExecuteString( const char* const pszString, const Source source );
 
+	/**
+	*	Executes an already tokenized command. The name is only looked up if name's cached lookup is out of date.
+	*	@param iArgC Argument count. Must be at least 1.
+	*	@param ppArgV Argument vector.
+	*	@param name Cached lookup of ppArgV[ 0 ]. Updated if needed.
+	*/
+	void ExecuteArgs( const int iArgC, const char* const* ppArgV, CachedName_t& name, const Source source );
+
 	const char* GetArgs() const;
 
 	int GetArgC() const;
@@ -66,11 +316,72 @@ public:
 	const char* GetArgV( const int iArg ) const;
 
 private:
+	//Registration order lists, for enumeration. Lookups go through m_NameTable.
 	ConCommand_t* m_pCommands = nullptr;
+	Alias_t* m_pAliases = nullptr;
 	cvar_t* m_pCVars = nullptr;
 
-	//The current command.
-	CCommand m_Command;
+	/**
+	*	Open addressing table of all commands, aliases and cvars, keyed on StringHash of the name. Size is a power of 2.
+	*/
+	TrackedVector_t<NameEntry_t, MemoryTag::CONSOLE> m_NameTable;
+
+	size_t m_uiNameCount = 0;
+
+	/**
+	*	Incremented whenever a name is added or removed, which invalidates all CachedName_t instances.
+	*/
+	unsigned int m_uiNameGeneration = 1;
+
+	/**
+	*	All names in m_NameTable, sorted with strcmp.
+	*/
+	TrackedVector_t<const char*, MemoryTag::CONSOLE> m_SortedNames;
+
+	struct ChangeCallback_t
+	{
+		const cvar_t* pCVar;
+		CVarChangeFunc_t pCallback;
+		void* pContext;
+	};
+
+	/**
+	*	Change callbacks of all cvars. Cvars are rarely set, so this is searched linearly.
+	*/
+	TrackedVector_t<ChangeCallback_t, MemoryTag::CONSOLE> m_ChangeCallbacks;
+
+	/**
+	*	A cvar flagged with FCVAR_ARCHIVE, and where its line is in the archive image.
+	*/
+	struct ArchivedCVar_t
+	{
+		cvar_t* pCVar;
+		size_t uiOffset;
+		size_t uiLength;
+
+		/**
+		*	Whether the cvar changed since its line was formatted.
+		*/
+		bool bChanged;
+	};
+
+	/**
+	*	Archived cvars, in registration order, which is the order they're written in.
+	*/
+	TrackedVector_t<ArchivedCVar_t, MemoryTag::CONSOLE> m_ArchivedCVars;
+
+	/**
+	*	Contents of the config file, one line per archived cvar. Lines of cvars that changed are updated before it's written.
+	*/
+	TrackedVector_t<char, MemoryTag::CONSOLE> m_Archive;
+
+	bool m_bArchiveDirty = false;
+
+	CCommandBuffer* m_pCommandBuffer = nullptr;
+	CCommandScriptCache* m_pScripts = nullptr;
+
+	//The current command. Refers to the text or arguments that are being executed, arguments are only copied if the command asks for them.
+	CCommandView m_Command;
 
 private:
 	CCVarSystem( const CCVarSystem& ) = delete;
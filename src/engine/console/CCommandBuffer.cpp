@@ -1,16 +1,52 @@
+#include <algorithm>
 #include <cstring>
 
+#include "Clock.h"
 #include "Logging.h"
+#include "Tracing.h"
 
+#include "cvardef.h"
+
+#include "console/CCommandScript.h"
 #include "console/CCVarSystem.h"
 
 #include "CCommandBuffer.h"
 
-bool CCommandBuffer::Initialize( cvar::CCVarSystem* pCVar )
+namespace
 {
-	m_Buffer.SetBuffer( "CommandBuffer", m_Data, sizeof( m_Data ) );
+/**
+*	Maximum number of commands to execute per frame. 0 for no limit.
+*/
+cvar_t cmd_maxcommands = { "cmd_maxcommands", const_cast<char*>( "0" ) };
+
+/**
+*	Maximum time in milliseconds to spend executing commands per frame. 0 for no limit.
+*/
+cvar_t cmd_maxtime = { "cmd_maxtime", const_cast<char*>( "0" ) };
+
+constexpr cvar::CVarDesc_t COMMAND_BUFFER_CVARS[] =
+{
+	cvar::CVarDesc( cmd_maxcommands, "cmd_maxcommands" ),
+	cvar::CVarDesc( cmd_maxtime, "cmd_maxtime" ),
+};
+}
+
+const size_t CCommandBuffer::BUFFER_SIZE;
+const size_t CCommandBuffer::MAX_SCRIPTS;
+
+bool CCommandBuffer::Initialize( cvar::CCVarSystem* pCVar, const bool bFrameBudget )
+{
+	m_uiStart = m_uiEnd = 0;
+
+	m_Scripts.clear();
 
 	m_pCVar = pCVar;
+	m_bFrameBudget = bFrameBudget;
+
+	m_pCVar->SetCommandBuffer( this );
+
+	if( m_bFrameBudget )
+		m_pCVar->AddCVars( ::COMMAND_BUFFER_CVARS );
 
 	return true;
 }
@@ -19,52 +55,89 @@ bool CCommandBuffer::AddText( const char* const pszText )
 {
 	const size_t uiLength = strlen( pszText );
 
-	if( m_Buffer.GetBytesInBuffer() + 1 >= m_Buffer.GetMaxBytes() )
+	if( GetTextLength() + uiLength >= BUFFER_SIZE )
 	{
 		Msg( "CCommandBuffer::AddText: Overflow\n" );
 		return false;
 	}
 
-	m_Buffer.WriteBytes( pszText, uiLength );
+	//Move the text down if there is no room after it, leaving half of the space that remains in front of it.
+	if( m_uiEnd + uiLength > BUFFER_SIZE )
+		MoveText( ( BUFFER_SIZE - ( GetTextLength() + uiLength ) ) / 2 );
+
+	memcpy( m_Data + m_uiEnd, pszText, uiLength );
+
+	m_uiEnd += uiLength;
 
 	return true;
 }
 
 bool CCommandBuffer::InsertText( const char* const pszText )
 {
-	//Copy off any commands still remaining in the exec buffer.
-	const size_t uiTempLen = m_Buffer.GetBytesInBuffer();
-
-	char* pszTemp;
+	const size_t uiLength = strlen( pszText );
 
-	if( uiTempLen )
+	if( GetTextLength() + uiLength >= BUFFER_SIZE )
 	{
-		pszTemp = new char[ uiTempLen ];
+		Msg( "CCommandBuffer::InsertText: Overflow\n" );
+		return false;
+	}
 
-		memcpy( pszTemp, m_Buffer.GetData(), uiTempLen );
+	//Move the remaining commands up if there is no room before them, leaving half of the space that remains after them.
+	if( uiLength > m_uiStart )
+		MoveText( uiLength + ( BUFFER_SIZE - ( GetTextLength() + uiLength ) ) / 2 );
 
-		m_Buffer.ResetToStart();
-	}
-	else
-	{
-		pszTemp = nullptr; //Shut up compiler.
-	}
+	m_uiStart -= uiLength;
+
+	memcpy( m_Data + m_uiStart, pszText, uiLength );
 
-	//Add the entire text of the file.
-	AddText( pszText );
+	for( auto& cursor : m_Scripts )
+		cursor.uiTextAhead += uiLength;
 
-	//Add the copied off data.
-	if( uiTempLen )
+	return true;
+}
+
+bool CCommandBuffer::InsertScript( std::shared_ptr<const CCommandScript> script )
+{
+	if( m_Scripts.size() >= MAX_SCRIPTS )
 	{
-		m_Buffer.WriteBytes( pszTemp, uiTempLen );
-		delete[] pszTemp;
+		Msg( "CCommandBuffer::InsertScript: Overflow\n" );
+		return false;
 	}
 
+	if( script->GetCommandCount() > 0 )
+		m_Scripts.push_back( ScriptCursor_t{ std::move( script ), 0, 0 } );
+
 	return true;
 }
 
+void CCommandBuffer::MoveText( const size_t uiStart )
+{
+	const size_t uiTextLength = GetTextLength();
+
+	memmove( m_Data + uiStart, m_Data + m_uiStart, uiTextLength );
+
+	m_uiStart = uiStart;
+	m_uiEnd = uiStart + uiTextLength;
+}
+
+bool CCommandBuffer::IsBudgetExhausted( const unsigned int uiCommands, const uint64_t uiStartTime ) const
+{
+	if( !m_bFrameBudget )
+		return false;
+
+	if( cmd_maxcommands.value > 0 && uiCommands >= cmd_maxcommands.value )
+		return true;
+
+	if( cmd_maxtime.value > 0 && ( Plat_GetMicroseconds() - uiStartTime ) >= cmd_maxtime.value * 1000 )
+		return true;
+
+	return false;
+}
+
 bool CCommandBuffer::Execute()
 {
+	TRACE_SCOPE( "CommandBuffer::Execute" );
+
 	char szLine[ 1024 ];
 
 	const char* pszText;
@@ -73,13 +146,57 @@ bool CCommandBuffer::Execute()
 
 	bool bQuotes;
 
-	while( m_Buffer.GetBytesInBuffer() )
+	//Only query the time if there is a time budget.
+	const uint64_t uiStartTime = m_bFrameBudget && cmd_maxtime.value > 0 ? Plat_GetMicroseconds() : 0;
+
+	unsigned int uiCommands = 0;
+
+	if( !m_Queue.IsEmpty() )
 	{
-		pszText = reinterpret_cast<const char*>( m_Buffer.GetData() );
+		m_Queue.Drain(
+			[ this ]( const char* pszText )
+			{
+				AddText( pszText );
+			}
+		);
+	}
+
+	while( GetTextLength() || !m_Scripts.empty() )
+	{
+		if( !m_Scripts.empty() && m_Scripts.back().uiTextAhead == 0 )
+		{
+			auto& cursor = m_Scripts.back();
+
+			//Keep the script alive and advance the cursor first, the command can insert more scripts.
+			const auto script = cursor.script;
+
+			const size_t uiCommand = cursor.uiCommand++;
+
+			if( cursor.uiCommand == script->GetCommandCount() )
+				m_Scripts.pop_back();
+
+			script->ExecuteCommand( uiCommand, *m_pCVar );
+
+			if( m_bWait )
+			{
+				m_bWait = false;
+				break;
+			}
+
+			if( IsBudgetExhausted( ++uiCommands, uiStartTime ) )
+				break;
+
+			continue;
+		}
+
+		pszText = m_Data + m_uiStart;
+
+		//Only the text in front of the next script can be executed before it.
+		const size_t uiTextLength = m_Scripts.empty() ? GetTextLength() : m_Scripts.back().uiTextAhead;
 
 		bQuotes = false;
 
-		for( uiIndex = 0; uiIndex < m_Buffer.GetBytesInBuffer(); ++uiIndex )
+		for( uiIndex = 0; uiIndex < uiTextLength; ++uiIndex )
 		{
 			if( pszText[ uiIndex ] == '\"' )
 			{
@@ -94,22 +211,26 @@ bool CCommandBuffer::Execute()
 				break;
 		}
 
-		//TODO: bounds checking. - Solokiller
-		memcpy( szLine, pszText, uiIndex );
+		//Lines that don't fit are truncated.
+		const size_t uiLineLength = std::min( uiIndex, sizeof( szLine ) - 1 );
+
+		memcpy( szLine, pszText, uiLineLength );
 
-		szLine[ uiIndex ] = '\0';
+		szLine[ uiLineLength ] = '\0';
 
-		//Delete the text from the command buffer and move remaining commands down.
+		//Remove the text from the command buffer before executing it.
 		//This is necessary because commands (exec, alias) can insert data at the 
 		//beginning of the text buffer.
 
-		if( uiIndex == m_Buffer.GetBytesInBuffer() )
-			m_Buffer.ResetToStart();
+		const size_t uiConsumed = uiIndex < uiTextLength ? uiIndex + 1 : uiIndex;
+
+		if( uiConsumed == GetTextLength() )
+			m_uiStart = m_uiEnd = 0;
 		else
-		{
-			++uiIndex;
-			m_Buffer.EraseBytes( 0, uiIndex );
-		}
+			m_uiStart += uiConsumed;
+
+		for( auto& cursor : m_Scripts )
+			cursor.uiTextAhead -= uiConsumed;
 
 		//Execute the command line.
 		m_pCVar->ExecuteString( szLine, cvar::Source::COMMAND );
@@ -121,6 +242,10 @@ bool CCommandBuffer::Execute()
 			m_bWait = false;
 			break;
 		}
+
+		//Leave the remaining commands for the next frame.
+		if( IsBudgetExhausted( ++uiCommands, uiStartTime ) )
+			break;
 	}
 
 	return true;
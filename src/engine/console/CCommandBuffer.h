@@ -1,9 +1,14 @@
 #ifndef ENGINE_CONSOLE_CCOMMANDBUFFER_H
 #define ENGINE_CONSOLE_CCOMMANDBUFFER_H
 
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <vector>
 
-#include "CNetworkBuffer.h"
+#include "CCommandQueue.h"
+
+class CCommandScript;
 
 namespace cvar
 {
@@ -12,21 +17,31 @@ class CCVarSystem;
 
 /**
 *	Represents the command buffer. Commands entered in the console, as well as key presses are all processed by this.
+*	The text is a window in a fixed buffer, with free space on both sides. Executing a command moves the start of the window past it,
+*	and inserted text goes in front of the window, so neither moves the remaining text unless one side runs out of room.
+*	Nothing is allocated, and when the text does move, the free space is split between both sides so nested execs and appends stay in place.
+*	Compiled scripts are not copied into the buffer. They are kept on a stack of cursors, each of which knows how much text was inserted in front of it.
 */
 class CCommandBuffer final
 {
 private:
 	static const size_t BUFFER_SIZE = 8192;
 
+	/**
+	*	Maximum number of scripts that can be executing at once. Scripts that exec themselves stop here.
+	*/
+	static const size_t MAX_SCRIPTS = 64;
+
 public:
 	CCommandBuffer() = default;
 
 	/**
 	*	Initializes the buffer.
-	*	@param pCVar CVar system to use.
+	*	@param pCVar CVar system to use. Its wait, exec and aliases insert into this buffer.
+	*	@param bFrameBudget Whether to add and obey cmd_maxcommands and cmd_maxtime. Cvars can only be in one system, so only one buffer can.
 	*	@return Whether the buffer initialized successfully.
 	*/
-	bool Initialize( cvar::CCVarSystem* pCVar );
+	bool Initialize( cvar::CCVarSystem* pCVar, const bool bFrameBudget = true );
 
 	/**
 	*	Adds text to the command buffer.
@@ -35,16 +50,32 @@ public:
 	*/
 	bool AddText( const char* const pszText );
 
+	/**
+	*	Adds text to the command buffer from any thread. The text is added to the buffer when it next executes, in the order it was queued.
+	*	@param pszText Text to add.
+	*/
+	void QueueText( const char* const pszText )
+	{
+		m_Queue.Push( pszText );
+	}
+
 	/**
 	*	Inserts text immediately after the current command.
-	*	Adds an \n to the text.
 	*	@param pszText Text to insert.
 	*	@return Whether the text was successfully inserted.
 	*/
 	bool InsertText( const char* const pszText );
 
+	/**
+	*	Inserts a compiled script immediately after the current command.
+	*	@param script Script to insert.
+	*	@return Whether the script was successfully inserted.
+	*/
+	bool InsertScript( std::shared_ptr<const CCommandScript> script );
+
 	/**
 	*	Executes the commands that are currently in the buffer.
+	*	Stops early if a command waits, or if the frame's budget set by cmd_maxcommands and cmd_maxtime is used up.
 	*	@return Whether execution completed succesfully.
 	*/
 	bool Execute();
@@ -62,12 +93,60 @@ public:
 		m_bWait = bWait;
 	}
 
+	/**
+	*	@return Number of bytes of text in the buffer.
+	*/
+	size_t GetTextLength() const { return m_uiEnd - m_uiStart; }
+
 private:
-	CNetworkBuffer m_Buffer;
-	uint8_t m_Data[ BUFFER_SIZE ];
+	/**
+	*	Moves the text so it starts at the given offset.
+	*/
+	void MoveText( const size_t uiStart );
+
+	/**
+	*	@return Whether the cmd_maxcommands or cmd_maxtime budget for this frame has been used up.
+	*/
+	bool IsBudgetExhausted( const unsigned int uiCommands, const uint64_t uiStartTime ) const;
+
+private:
+	char m_Data[ BUFFER_SIZE ];
+
+	/**
+	*	Text in the buffer is [ m_uiStart, m_uiEnd [.
+	*/
+	size_t m_uiStart = 0;
+	size_t m_uiEnd = 0;
+
+	struct ScriptCursor_t
+	{
+		std::shared_ptr<const CCommandScript> script;
+
+		/**
+		*	Next command to execute.
+		*/
+		size_t uiCommand;
+
+		/**
+		*	Number of bytes of text in front of the script.
+		*/
+		size_t uiTextAhead;
+	};
+
+	/**
+	*	Scripts that are executing. The last script is the first to execute, and never has more text in front of it than the others.
+	*/
+	std::vector<ScriptCursor_t> m_Scripts;
+
+	/**
+	*	Text queued by other threads.
+	*/
+	CCommandQueue m_Queue;
 
 	bool m_bWait = false;
 
+	bool m_bFrameBudget = false;
+
 	cvar::CCVarSystem* m_pCVar = nullptr;
 
 private:
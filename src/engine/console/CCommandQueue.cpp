@@ -0,0 +1,27 @@
+#include "CCommandQueue.h"
+
+CCommandQueue::~CCommandQueue()
+{
+	Node_t* pNode = m_pHead.exchange( nullptr, std::memory_order_acquire );
+
+	while( pNode )
+	{
+		Node_t* pNext = pNode->pNext;
+
+		delete pNode;
+
+		pNode = pNext;
+	}
+}
+
+void CCommandQueue::Push( const char* const pszText )
+{
+	Node_t* pNode = new Node_t{ nullptr, pszText };
+
+	pNode->pNext = m_pHead.load( std::memory_order_relaxed );
+
+	//Release so the consumer sees the text once it sees the node.
+	while( !m_pHead.compare_exchange_weak( pNode->pNext, pNode, std::memory_order_release, std::memory_order_relaxed ) )
+	{
+	}
+}
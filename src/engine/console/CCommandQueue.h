@@ -0,0 +1,82 @@
+#ifndef ENGINE_CONSOLE_CCOMMANDQUEUE_H
+#define ENGINE_CONSOLE_CCOMMANDQUEUE_H
+
+#include <atomic>
+#include <string>
+
+/**
+*	Queue of command text that any thread can add to. Only one thread, the main thread, takes text out of it.
+*	Adding text is lock free: it is pushed onto a list with a single compare and swap.
+*	The consumer takes the entire list at once and reverses it, so text comes out in the order it was added.
+*/
+class CCommandQueue final
+{
+public:
+	CCommandQueue() = default;
+	~CCommandQueue();
+
+	/**
+	*	Adds text to the queue. Can be called from any thread.
+	*/
+	void Push( const char* const pszText );
+
+	/**
+	*	@return Whether the queue is empty. Only a hint when other threads are adding text.
+	*/
+	bool IsEmpty() const { return m_pHead.load( std::memory_order_relaxed ) == nullptr; }
+
+	/**
+	*	Removes all text from the queue, in the order it was added. Must only be called by the consumer thread.
+	*	@param callback Called with each text.
+	*/
+	template<typename CALLBACK>
+	void Drain( CALLBACK callback );
+
+private:
+	struct Node_t
+	{
+		Node_t* pNext;
+		std::string szText;
+	};
+
+	/**
+	*	Most recently added text first.
+	*/
+	std::atomic<Node_t*> m_pHead{ nullptr };
+
+private:
+	CCommandQueue( const CCommandQueue& ) = delete;
+	CCommandQueue& operator=( const CCommandQueue& ) = delete;
+};
+
+template<typename CALLBACK>
+void CCommandQueue::Drain( CALLBACK callback )
+{
+	Node_t* pNode = m_pHead.exchange( nullptr, std::memory_order_acquire );
+
+	//Reverse the list to get the oldest text first.
+	Node_t* pFirst = nullptr;
+
+	while( pNode )
+	{
+		Node_t* pNext = pNode->pNext;
+
+		pNode->pNext = pFirst;
+		pFirst = pNode;
+
+		pNode = pNext;
+	}
+
+	while( pFirst )
+	{
+		Node_t* pNext = pFirst->pNext;
+
+		callback( pFirst->szText.c_str() );
+
+		delete pFirst;
+
+		pFirst = pNext;
+	}
+}
+
+#endif //ENGINE_CONSOLE_CCOMMANDQUEUE_H
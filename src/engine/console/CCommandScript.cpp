@@ -0,0 +1,153 @@
+#include <algorithm>
+#include <climits>
+#include <cstring>
+
+#include "CCommandView.h"
+#include "FileSystem2.h"
+
+#include "Engine.h"
+
+#include "CCommandScript.h"
+
+void CCommandScript::Compile( const char* pszText, const size_t uiLength )
+{
+	std::vector<char> text( uiLength + 1 );
+
+	memcpy( text.data(), pszText, uiLength );
+
+	CompileInPlace( text.data(), uiLength );
+}
+
+void CCommandScript::CompileInPlace( char* pszText, const size_t uiLength )
+{
+	m_Commands.clear();
+	m_ArgV.clear();
+	m_Strings.clear();
+
+	//Offsets into m_Strings, converted once it's done growing.
+	std::vector<size_t> argOffsets;
+
+	//Same limit as the command buffer's line buffer.
+	const size_t MAX_LINE_LENGTH = 1023;
+
+	CCommandView command;
+
+	size_t uiIndex;
+
+	bool bQuotes;
+
+	for( size_t uiOffset = 0; uiOffset < uiLength; uiOffset += uiIndex + 1 )
+	{
+		char* pszLine = pszText + uiOffset;
+
+		const size_t uiTextLength = uiLength - uiOffset;
+
+		bQuotes = false;
+
+		//Same rules as CCommandBuffer::Execute.
+		for( uiIndex = 0; uiIndex < uiTextLength; ++uiIndex )
+		{
+			if( pszLine[ uiIndex ] == '\"' )
+			{
+				bQuotes = !bQuotes;
+			}
+
+			//Don't break if inside a quoted string.
+			if( !bQuotes && pszLine[ uiIndex ] == ';' )
+				break;
+
+			if( pszLine[ uiIndex ] == '\n' )
+				break;
+		}
+
+		//Overwrites the separator, or the character after the text. The next line starts after the separator, so this doesn't affect it.
+		pszLine[ std::min( uiIndex, MAX_LINE_LENGTH ) ] = '\0';
+
+		//Lines without tokens are never executed.
+		if( !( *pszLine ) || !command.Initialize( pszLine ) )
+			continue;
+
+		Command_t entry{};
+
+		entry.uiFirstArg = argOffsets.size();
+		entry.iArgC = command.ArgC();
+
+		m_Commands.push_back( entry );
+
+		for( int iArg = 0; iArg < command.ArgC(); ++iArg )
+		{
+			const auto& token = command.GetToken( iArg );
+
+			argOffsets.push_back( m_Strings.size() );
+
+			m_Strings.insert( m_Strings.end(), token.pszData, token.pszData + token.uiLength );
+			m_Strings.push_back( '\0' );
+		}
+	}
+
+	m_ArgV.reserve( argOffsets.size() );
+
+	for( auto uiArgOffset : argOffsets )
+		m_ArgV.push_back( m_Strings.data() + uiArgOffset );
+}
+
+void CCommandScript::ExecuteCommand( const size_t uiIndex, cvar::CCVarSystem& cvar ) const
+{
+	const auto& command = m_Commands[ uiIndex ];
+
+	cvar.ExecuteArgs( command.iArgC, m_ArgV.data() + command.uiFirstArg, command.name, cvar::Source::COMMAND );
+}
+
+std::shared_ptr<const CCommandScript> CCommandScriptCache::Load( const char* const pszFileName )
+{
+	if( !g_pFileSystem )
+		return nullptr;
+
+	const int64_t iModifiedTime = g_pFileSystem->GetFileTimeEx( pszFileName );
+
+	auto it = m_Scripts.find( pszFileName );
+
+	if( it != m_Scripts.end() && iModifiedTime != 0 && it->second.iModifiedTime == iModifiedTime )
+		return it->second.script;
+
+	std::unique_ptr<char[]> data;
+
+	uint64_t uiSize;
+
+	//The file is read once, and compiled in the buffer it was read into. Leave room for the null terminator.
+	auto pfnAllocate = []( uint64_t uiSize, void* pContext ) -> void*
+	{
+		if( uiSize >= static_cast<uint64_t>( INT_MAX ) )
+			return nullptr;
+
+		auto& data = *reinterpret_cast<std::unique_ptr<char[]>*>( pContext );
+
+		data = std::make_unique<char[]>( static_cast<size_t>( uiSize ) + 1 );
+
+		return data.get();
+	};
+
+	if( !g_pFileSystem->LoadFile( pszFileName, nullptr, pfnAllocate, &data, &uiSize ) )
+	{
+		if( it != m_Scripts.end() )
+			m_Scripts.erase( it );
+
+		return nullptr;
+	}
+
+	auto script = std::make_shared<CCommandScript>();
+
+	script->CompileInPlace( data.get(), static_cast<size_t>( uiSize ) );
+
+	auto& entry = m_Scripts[ pszFileName ];
+
+	entry.iModifiedTime = iModifiedTime;
+	entry.script = std::move( script );
+
+	return entry.script;
+}
+
+void CCommandScriptCache::Clear()
+{
+	m_Scripts.clear();
+}
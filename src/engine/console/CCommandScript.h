@@ -0,0 +1,106 @@
+#ifndef ENGINE_CONSOLE_CCOMMANDSCRIPT_H
+#define ENGINE_CONSOLE_CCOMMANDSCRIPT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CCVarSystem.h"
+
+/**
+*	A script that has been split into commands and tokenized once, so running it again doesn't go through the command buffer's text scanner and the tokenizer.
+*	Each command caches the command or cvar that its name resolved to.
+*/
+class CCommandScript final
+{
+public:
+	CCommandScript() = default;
+
+	/**
+	*	Compiles the given text. Commands are split up the same way the command buffer splits them.
+	*	@param pszText Text to compile. Doesn't have to be null terminated.
+	*	@param uiLength Length of the text.
+	*/
+	void Compile( const char* pszText, const size_t uiLength );
+
+	/**
+	*	Compiles the given text without copying it. Each command is null terminated in place before it is tokenized.
+	*	@param pszText Text to compile. Must have room for a null terminator after the text. Its contents are undefined afterwards.
+	*	@param uiLength Length of the text.
+	*/
+	void CompileInPlace( char* pszText, const size_t uiLength );
+
+	/**
+	*	@return Number of commands in the script.
+	*/
+	size_t GetCommandCount() const { return m_Commands.size(); }
+
+	/**
+	*	Executes the given command.
+	*/
+	void ExecuteCommand( const size_t uiIndex, cvar::CCVarSystem& cvar ) const;
+
+private:
+	struct Command_t
+	{
+		size_t uiFirstArg;
+		int iArgC;
+
+		//Each cache belongs to one cvar system, so its scripts are only ever executed on one thread.
+		mutable cvar::CCVarSystem::CachedName_t name;
+	};
+
+	std::vector<Command_t> m_Commands;
+
+	/**
+	*	Argument vectors of all commands, pointing into m_Strings.
+	*/
+	std::vector<const char*> m_ArgV;
+
+	/**
+	*	Null terminated arguments of all commands.
+	*/
+	std::vector<char> m_Strings;
+
+private:
+	CCommandScript( const CCommandScript& ) = delete;
+	CCommandScript& operator=( const CCommandScript& ) = delete;
+};
+
+/**
+*	Cache of compiled script files. A file is compiled again if its modification time has changed since it was last loaded.
+*/
+class CCommandScriptCache final
+{
+public:
+	CCommandScriptCache() = default;
+
+	/**
+	*	Loads a script file and compiles it if it isn't cached or was modified.
+	*	@return The script, or null if the file couldn't be loaded.
+	*/
+	std::shared_ptr<const CCommandScript> Load( const char* const pszFileName );
+
+	/**
+	*	Removes all scripts from the cache. Scripts that are still executing remain valid.
+	*/
+	void Clear();
+
+private:
+	struct Entry_t
+	{
+		int64_t iModifiedTime;
+		std::shared_ptr<const CCommandScript> script;
+	};
+
+	std::unordered_map<std::string, Entry_t> m_Scripts;
+
+private:
+	CCommandScriptCache( const CCommandScriptCache& ) = delete;
+	CCommandScriptCache& operator=( const CCommandScriptCache& ) = delete;
+};
+
+#endif //ENGINE_CONSOLE_CCOMMANDSCRIPT_H
@@ -0,0 +1,76 @@
+#ifndef ENGINE_CONSOLE_CVARREF_H
+#define ENGINE_CONSOLE_CVARREF_H
+
+#include "cvardef.h"
+
+#include "CCVarSystem.h"
+
+namespace cvar
+{
+/**
+*	Handle to a cvar that is looked up by name once. Reads use the cvar directly.
+*	The cvar is looked up again if commands or cvars were added or removed since the last lookup, so the handle can be created before the cvar is registered.
+*/
+class CVarRef final
+{
+public:
+	/**
+	*	@param cvars CVar system that the cvar is registered with.
+	*	@param pszName Name of the cvar. Must remain valid for the lifetime of the handle.
+	*/
+	CVarRef( CCVarSystem& cvars, const char* const pszName )
+		: m_CVars( cvars )
+		, m_pszName( pszName )
+	{
+	}
+
+	const char* GetName() const { return m_pszName; }
+
+	/**
+	*	@return The cvar, or null if it isn't registered.
+	*/
+	cvar_t* Get() const
+	{
+		if( m_uiGeneration != m_CVars.GetNameGeneration() )
+		{
+			m_pCVar = m_CVars.FindCVar( m_pszName );
+			m_uiGeneration = m_CVars.GetNameGeneration();
+		}
+
+		return m_pCVar;
+	}
+
+	bool IsValid() const { return Get() != nullptr; }
+
+	float GetFloat() const
+	{
+		const cvar_t* pCVar = Get();
+
+		return pCVar ? pCVar->value : 0;
+	}
+
+	bool GetBool() const { return GetFloat() != 0; }
+
+	const char* GetString() const
+	{
+		const cvar_t* pCVar = Get();
+
+		return pCVar ? pCVar->string : "";
+	}
+
+	void SetString( const char* const pszValue )
+	{
+		if( cvar_t* pCVar = Get() )
+			m_CVars.SetCVarDirect( pCVar, pszValue );
+	}
+
+private:
+	CCVarSystem& m_CVars;
+	const char* const m_pszName;
+
+	mutable cvar_t* m_pCVar = nullptr;
+	mutable unsigned int m_uiGeneration = 0;
+};
+}
+
+#endif //ENGINE_CONSOLE_CVARREF_H
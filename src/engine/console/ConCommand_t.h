@@ -30,11 +30,22 @@ enum CmdFlag
 struct ConCommand_t
 {
 	ConCommand_t* pNext;
+
+	/**
+	*	Interned in the string pool.
+	*/
 	const char* pszName;
 	xcommand_t pFunction;
 
 	uint32_t flags;
 
+	/**
+	*	Profiling counters. Times are in microseconds.
+	*/
+	uint64_t uiCalls;
+	uint64_t uiTotalTime;
+	uint64_t uiMaxTime;
+
 	inline const char* GetName() const { return pszName; }
 
 	inline bool IsClient() const { return ( flags & CmdFlag::CLIENT ) != 0; }
@@ -0,0 +1,62 @@
+#ifndef ENGINE_CONSOLE_REGISTRATIONTABLE_H
+#define ENGINE_CONSOLE_REGISTRATIONTABLE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "StringUtils.h"
+
+#include "ConCommand_t.h"
+
+typedef struct cvar_s cvar_t;
+
+/**
+*	@file
+*	Tables of commands and cvars that are registered all at once with CCVarSystem::AddCommands and CCVarSystem::AddCVars.
+*	Tables are built at compile time, with the hashes of the names already computed:
+*	constexpr cvar::CommandDesc_t COMMANDS[] = { cvar::CommandDesc( "quit", &Cmd_Quit_f ), ... };
+*/
+
+namespace cvar
+{
+struct CommandDesc_t
+{
+	const char* pszName;
+
+	/**
+	*	StringHash of the name.
+	*/
+	size_t uiHash;
+
+	xcommand_t pFunction;
+
+	uint32_t flags;
+};
+
+struct CVarDesc_t
+{
+	cvar_t* pCVar;
+
+	/**
+	*	StringHash of the cvar's name.
+	*/
+	size_t uiHash;
+};
+
+template<size_t SIZE>
+constexpr CommandDesc_t CommandDesc( const char ( &szName )[ SIZE ], xcommand_t pFunction, const uint32_t flags = CmdFlag::NONE )
+{
+	return { szName, StringHash( szName, SIZE - 1 ), pFunction, flags };
+}
+
+/**
+*	@param szName Name of the cvar. Must be the name it was defined with, which is checked when it's registered.
+*/
+template<size_t SIZE>
+constexpr CVarDesc_t CVarDesc( cvar_t& cvar, const char ( &szName )[ SIZE ] )
+{
+	return { &cvar, StringHash( szName, SIZE - 1 ) };
+}
+}
+
+#endif //ENGINE_CONSOLE_REGISTRATIONTABLE_H
@@ -0,0 +1,75 @@
+#include <algorithm>
+#include <cstdint>
+
+#include "Logging.h"
+
+#include "CMixer.h"
+
+#include "CAudioDevice.h"
+
+const size_t CAudioDevice::DEFAULT_BUFFER_FRAMES;
+
+CAudioDevice::~CAudioDevice()
+{
+	Close();
+}
+
+bool CAudioDevice::Open( CMixer& mixer, const size_t uiBufferFrames )
+{
+	Close();
+
+	if( SDL_InitSubSystem( SDL_INIT_AUDIO ) < 0 )
+	{
+		Msg( "Couldn't initialize audio: %s\n", SDL_GetError() );
+		return false;
+	}
+
+	SDL_AudioSpec desired;
+
+	SDL_zero( desired );
+
+	desired.freq = static_cast<int>( mixer.GetOutputRate() );
+	desired.format = AUDIO_S16SYS;
+	desired.channels = 2;
+	desired.samples = static_cast<Uint16>( std::min<size_t>( std::max<size_t>( uiBufferFrames, 64 ), UINT16_MAX ) );
+	desired.callback = &CAudioDevice::AudioCallback;
+	desired.userdata = &mixer;
+
+	SDL_AudioSpec obtained;
+
+	//No changes are allowed, so the callback always gets the mixer's format.
+	m_Device = SDL_OpenAudioDevice( nullptr, 0, &desired, &obtained, 0 );
+
+	if( m_Device == 0 )
+	{
+		Msg( "Couldn't open audio device: %s\n", SDL_GetError() );
+		SDL_QuitSubSystem( SDL_INIT_AUDIO );
+		return false;
+	}
+
+	Msg( "Audio: %d Hz, %u frame buffer\n", obtained.freq, static_cast<unsigned int>( obtained.samples ) );
+
+	SDL_PauseAudioDevice( m_Device, 0 );
+
+	return true;
+}
+
+void CAudioDevice::Close()
+{
+	if( m_Device == 0 )
+		return;
+
+	//Waits for the callback to return.
+	SDL_CloseAudioDevice( m_Device );
+	m_Device = 0;
+
+	SDL_QuitSubSystem( SDL_INIT_AUDIO );
+}
+
+void SDLCALL CAudioDevice::AudioCallback( void* pUserData, Uint8* pStream, int iLength )
+{
+	auto& mixer = *reinterpret_cast<CMixer*>( pUserData );
+
+	//Stereo 16 bit frames.
+	mixer.Mix( reinterpret_cast<int16_t*>( pStream ), static_cast<size_t>( iLength ) / ( sizeof( int16_t ) * 2 ) );
+}
@@ -0,0 +1,52 @@
+#ifndef ENGINE_SOUND_CAUDIODEVICE_H
+#define ENGINE_SOUND_CAUDIODEVICE_H
+
+#include <cstddef>
+
+#include <SDL2/SDL.h>
+
+class CMixer;
+
+/**
+*	The SDL audio device. Its callback runs on SDL's audio thread and has the mixer fill each buffer.
+*/
+class CAudioDevice final
+{
+public:
+	/**
+	*	Default number of frames in the device's buffer. About 23 milliseconds at 44100 Hz.
+	*/
+	static const size_t DEFAULT_BUFFER_FRAMES = 1024;
+
+public:
+	CAudioDevice() = default;
+	~CAudioDevice();
+
+	bool IsOpen() const { return m_Device != 0; }
+
+	/**
+	*	Opens the default output device and starts playing. The device is asked for 16 bit stereo at the mixer's rate,
+	*	and SDL converts it if the device can't play that.
+	*	@param mixer Mixer that fills the buffers. Must outlive the device.
+	*	@param uiBufferFrames Number of frames in the device's buffer. Smaller buffers have less latency, but are filled more often.
+	*	@return Whether the device was opened.
+	*/
+	bool Open( CMixer& mixer, const size_t uiBufferFrames = DEFAULT_BUFFER_FRAMES );
+
+	/**
+	*	Stops the callback and closes the device.
+	*/
+	void Close();
+
+private:
+	static void SDLCALL AudioCallback( void* pUserData, Uint8* pStream, int iLength );
+
+private:
+	SDL_AudioDeviceID m_Device = 0;
+
+private:
+	CAudioDevice( const CAudioDevice& ) = delete;
+	CAudioDevice& operator=( const CAudioDevice& ) = delete;
+};
+
+#endif //ENGINE_SOUND_CAUDIODEVICE_H
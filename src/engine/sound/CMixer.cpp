@@ -0,0 +1,733 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#include "CPUFeatures.h"
+
+#include "CMixer.h"
+
+#if defined( _MSC_VER ) && ( defined( _M_IX86 ) || defined( _M_X64 ) )
+#include <immintrin.h>
+
+#define MIXER_SSE2
+#define MIXER_TARGET_SSE2
+#elif defined( __GNUC__ ) && ( defined( __i386__ ) || defined( __x86_64__ ) )
+#include <immintrin.h>
+
+#define MIXER_SSE2
+//Only the vector functions are compiled for SSE2, so the rest runs on any CPU.
+#define MIXER_TARGET_SSE2 __attribute__( ( target( "sse2" ) ) )
+#endif
+
+namespace
+{
+/**
+*	Adds uiFrames frames of pInput to the interleaved stereo pOutput. The gain of each channel starts at pflGain and changes by pflStep each frame.
+*	Gains are computed from the frame number rather than accumulated, so every kernel produces the same result.
+*/
+typedef void ( *MixFunction_t )( float* pOutput, const float* pInput, const size_t uiFrames, const float* pflGain, const float* pflStep );
+
+/**
+*	Converts interleaved float samples to 16 bit, clamping them.
+*/
+typedef void ( *ConvertFunction_t )( int16_t* pOutput, const float* pInput, const size_t uiSamples );
+
+void MixMonoScalar( float* pOutput, const float* pInput, const size_t uiFrames, const float* pflGain, const float* pflStep )
+{
+	for( size_t uiFrame = 0; uiFrame < uiFrames; ++uiFrame )
+	{
+		const float flFrame = static_cast<float>( uiFrame );
+
+		pOutput[ uiFrame * 2 ] += pInput[ uiFrame ] * ( pflGain[ 0 ] + pflStep[ 0 ] * flFrame );
+		pOutput[ uiFrame * 2 + 1 ] += pInput[ uiFrame ] * ( pflGain[ 1 ] + pflStep[ 1 ] * flFrame );
+	}
+}
+
+void MixStereoScalar( float* pOutput, const float* pInput, const size_t uiFrames, const float* pflGain, const float* pflStep )
+{
+	for( size_t uiFrame = 0; uiFrame < uiFrames; ++uiFrame )
+	{
+		const float flFrame = static_cast<float>( uiFrame );
+
+		pOutput[ uiFrame * 2 ] += pInput[ uiFrame * 2 ] * ( pflGain[ 0 ] + pflStep[ 0 ] * flFrame );
+		pOutput[ uiFrame * 2 + 1 ] += pInput[ uiFrame * 2 + 1 ] * ( pflGain[ 1 ] + pflStep[ 1 ] * flFrame );
+	}
+}
+
+void ConvertScalar( int16_t* pOutput, const float* pInput, const size_t uiSamples )
+{
+	for( size_t uiSample = 0; uiSample < uiSamples; ++uiSample )
+	{
+		const float flValue = std::min( 32767.0f, std::max( -32768.0f, pInput[ uiSample ] * 32767.0f ) );
+
+		pOutput[ uiSample ] = static_cast<int16_t>( std::lrint( flValue ) );
+	}
+}
+
+#ifdef MIXER_SSE2
+/**
+*	Two frames at a time: the input is duplicated into left and right, and multiplied by the gains of both frames.
+*/
+MIXER_TARGET_SSE2 void MixMonoSSE2( float* pOutput, const float* pInput, const size_t uiFrames, const float* pflGain, const float* pflStep )
+{
+	const __m128 gain = _mm_setr_ps( pflGain[ 0 ], pflGain[ 1 ], pflGain[ 0 ], pflGain[ 1 ] );
+	const __m128 step = _mm_setr_ps( pflStep[ 0 ], pflStep[ 1 ], pflStep[ 0 ], pflStep[ 1 ] );
+
+	__m128 frames = _mm_setr_ps( 0, 0, 1, 1 );
+	const __m128 advance = _mm_set1_ps( 2 );
+
+	size_t uiFrame = 0;
+
+	for( ; uiFrames - uiFrame >= 2; uiFrame += 2 )
+	{
+		const __m128 input = _mm_setr_ps( pInput[ uiFrame ], pInput[ uiFrame ], pInput[ uiFrame + 1 ], pInput[ uiFrame + 1 ] );
+
+		const __m128 gains = _mm_add_ps( gain, _mm_mul_ps( step, frames ) );
+
+		_mm_storeu_ps( pOutput + uiFrame * 2, _mm_add_ps( _mm_loadu_ps( pOutput + uiFrame * 2 ), _mm_mul_ps( input, gains ) ) );
+
+		frames = _mm_add_ps( frames, advance );
+	}
+
+	if( uiFrame < uiFrames )
+	{
+		//The last frame's gain continues from the frames before it.
+		const float flFrame = static_cast<float>( uiFrame );
+
+		pOutput[ uiFrame * 2 ] += pInput[ uiFrame ] * ( pflGain[ 0 ] + pflStep[ 0 ] * flFrame );
+		pOutput[ uiFrame * 2 + 1 ] += pInput[ uiFrame ] * ( pflGain[ 1 ] + pflStep[ 1 ] * flFrame );
+	}
+}
+
+MIXER_TARGET_SSE2 void MixStereoSSE2( float* pOutput, const float* pInput, const size_t uiFrames, const float* pflGain, const float* pflStep )
+{
+	const __m128 gain = _mm_setr_ps( pflGain[ 0 ], pflGain[ 1 ], pflGain[ 0 ], pflGain[ 1 ] );
+	const __m128 step = _mm_setr_ps( pflStep[ 0 ], pflStep[ 1 ], pflStep[ 0 ], pflStep[ 1 ] );
+
+	__m128 frames = _mm_setr_ps( 0, 0, 1, 1 );
+	const __m128 advance = _mm_set1_ps( 2 );
+
+	size_t uiFrame = 0;
+
+	for( ; uiFrames - uiFrame >= 2; uiFrame += 2 )
+	{
+		const __m128 gains = _mm_add_ps( gain, _mm_mul_ps( step, frames ) );
+
+		const __m128 input = _mm_loadu_ps( pInput + uiFrame * 2 );
+
+		_mm_storeu_ps( pOutput + uiFrame * 2, _mm_add_ps( _mm_loadu_ps( pOutput + uiFrame * 2 ), _mm_mul_ps( input, gains ) ) );
+
+		frames = _mm_add_ps( frames, advance );
+	}
+
+	if( uiFrame < uiFrames )
+	{
+		const float flFrame = static_cast<float>( uiFrame );
+
+		pOutput[ uiFrame * 2 ] += pInput[ uiFrame * 2 ] * ( pflGain[ 0 ] + pflStep[ 0 ] * flFrame );
+		pOutput[ uiFrame * 2 + 1 ] += pInput[ uiFrame * 2 + 1 ] * ( pflGain[ 1 ] + pflStep[ 1 ] * flFrame );
+	}
+}
+
+/**
+*	Clamps before converting, since out of range values convert to INT32_MIN. Conversion rounds to nearest, like lrint.
+*/
+MIXER_TARGET_SSE2 void ConvertSSE2( int16_t* pOutput, const float* pInput, const size_t uiSamples )
+{
+	const __m128 scale = _mm_set1_ps( 32767.0f );
+	const __m128 minimum = _mm_set1_ps( -32768.0f );
+	const __m128 maximum = _mm_set1_ps( 32767.0f );
+
+	size_t uiSample = 0;
+
+	for( ; uiSamples - uiSample >= 8; uiSample += 8 )
+	{
+		const __m128 first = _mm_min_ps( maximum, _mm_max_ps( minimum, _mm_mul_ps( _mm_loadu_ps( pInput + uiSample ), scale ) ) );
+		const __m128 second = _mm_min_ps( maximum, _mm_max_ps( minimum, _mm_mul_ps( _mm_loadu_ps( pInput + uiSample + 4 ), scale ) ) );
+
+		_mm_storeu_si128( reinterpret_cast<__m128i*>( pOutput + uiSample ), _mm_packs_epi32( _mm_cvtps_epi32( first ), _mm_cvtps_epi32( second ) ) );
+	}
+
+	ConvertScalar( pOutput + uiSample, pInput + uiSample, uiSamples - uiSample );
+}
+#endif
+
+MixFunction_t GetMixMono()
+{
+	static const CPUKernel_t<MixFunction_t> KERNELS[] =
+	{
+#ifdef MIXER_SSE2
+		{ CPUFeature::SSE2, &MixMonoSSE2 },
+#endif
+		{ CPUFeature::NONE, &MixMonoScalar }
+	};
+
+	static const MixFunction_t pMix = Plat_SelectKernel( KERNELS );
+
+	return pMix;
+}
+
+MixFunction_t GetMixStereo()
+{
+	static const CPUKernel_t<MixFunction_t> KERNELS[] =
+	{
+#ifdef MIXER_SSE2
+		{ CPUFeature::SSE2, &MixStereoSSE2 },
+#endif
+		{ CPUFeature::NONE, &MixStereoScalar }
+	};
+
+	static const MixFunction_t pMix = Plat_SelectKernel( KERNELS );
+
+	return pMix;
+}
+
+ConvertFunction_t GetConvert()
+{
+	static const CPUKernel_t<ConvertFunction_t> KERNELS[] =
+	{
+#ifdef MIXER_SSE2
+		{ CPUFeature::SSE2, &ConvertSSE2 },
+#endif
+		{ CPUFeature::NONE, &ConvertScalar }
+	};
+
+	static const ConvertFunction_t pConvert = Plat_SelectKernel( KERNELS );
+
+	return pConvert;
+}
+
+/**
+*	Gains of the left and right channels for a volume and balance.
+*/
+void GetGains( const float flVolume, const float flPan, float ( &flGain )[ 2 ] )
+{
+	const float flClampedVolume = std::min( 1.0f, std::max( 0.0f, flVolume ) );
+	const float flClampedPan = std::min( 1.0f, std::max( -1.0f, flPan ) );
+
+	flGain[ 0 ] = flClampedVolume * std::min( 1.0f, 1 - flClampedPan );
+	flGain[ 1 ] = flClampedVolume * std::min( 1.0f, 1 + flClampedPan );
+}
+
+const float SAMPLE_SCALE = 1 / 32768.0f;
+
+const float FRACTION_SCALE = 1 / 4294967296.0f;
+}
+
+const CMixer::VoiceHandle CMixer::INVALID_VOICE;
+const uint32_t CMixer::DEFAULT_OUTPUT_RATE;
+const size_t CMixer::MAX_VOICES;
+const size_t CMixer::BLOCK_FRAMES;
+const size_t CMixer::RAMP_FRAMES;
+const size_t CMixer::COMMAND_QUEUE_SIZE;
+constexpr float CMixer::MAX_PITCH;
+const size_t CMixer::GENERATION_SHIFT;
+const CMixer::VoiceHandle CMixer::VOICE_MASK;
+
+CMixer::CMixer( const uint32_t uiOutputRate )
+	: m_uiOutputRate( std::max( 1u, uiOutputRate ) )
+{
+	//Lowest voices are used first.
+	for( size_t uiVoice = MAX_VOICES; uiVoice-- > 0; )
+	{
+		m_FreeVoices[ m_uiFreeVoiceCount++ ] = static_cast<uint16_t>( uiVoice );
+	}
+}
+
+CMixer::~CMixer()
+{
+}
+
+CMixer::VoiceHandle CMixer::Play( CSoundCache::SoundPtr sound, const float flVolume, const float flPan, const float flPitch, const bool bLoop )
+{
+	if( !sound || m_uiFreeVoiceCount == 0 )
+		return INVALID_VOICE;
+
+	const uint16_t uiVoice = m_FreeVoices[ m_uiFreeVoiceCount - 1 ];
+
+	Command_t command;
+
+	command.type = CommandType::PLAY;
+	command.uiVoice = uiVoice;
+	command.bLoop = bLoop;
+	command.sound = std::move( sound );
+	command.flVolume = flVolume;
+	command.flPan = flPan;
+	command.flPitch = flPitch;
+
+	if( !SendCommand( std::move( command ) ) )
+		return INVALID_VOICE;
+
+	--m_uiFreeVoiceCount;
+
+	auto& slot = m_Slots[ uiVoice ];
+
+	slot.uiGeneration = slot.uiNextGeneration;
+
+	//Generation 0 marks free slots.
+	if( ++slot.uiNextGeneration == 0 )
+		slot.uiNextGeneration = 1;
+
+	return uiVoice | ( static_cast<VoiceHandle>( slot.uiGeneration ) << GENERATION_SHIFT );
+}
+
+CMixer::VoiceHandle CMixer::Play( std::shared_ptr<CSoundStream> stream, const float flVolume, const float flPan, const float flPitch )
+{
+	if( !stream || m_uiFreeVoiceCount == 0 )
+		return INVALID_VOICE;
+
+	const uint16_t uiVoice = m_FreeVoices[ m_uiFreeVoiceCount - 1 ];
+
+	Command_t command;
+
+	command.type = CommandType::PLAY;
+	command.uiVoice = uiVoice;
+	command.stream = std::move( stream );
+	command.flVolume = flVolume;
+	command.flPan = flPan;
+	command.flPitch = flPitch;
+
+	if( !SendCommand( std::move( command ) ) )
+		return INVALID_VOICE;
+
+	--m_uiFreeVoiceCount;
+
+	auto& slot = m_Slots[ uiVoice ];
+
+	slot.uiGeneration = slot.uiNextGeneration;
+
+	if( ++slot.uiNextGeneration == 0 )
+		slot.uiNextGeneration = 1;
+
+	return uiVoice | ( static_cast<VoiceHandle>( slot.uiGeneration ) << GENERATION_SHIFT );
+}
+
+bool CMixer::SetVolume( const VoiceHandle hVoice, const float flVolume, const float flPan )
+{
+	if( !GetSlot( hVoice ) )
+		return false;
+
+	Command_t command;
+
+	command.type = CommandType::SET_VOLUME;
+	command.uiVoice = static_cast<uint16_t>( hVoice & VOICE_MASK );
+	command.flVolume = flVolume;
+	command.flPan = flPan;
+
+	//A dropped volume change is less bad than blocking the game.
+	SendCommand( std::move( command ) );
+
+	return true;
+}
+
+bool CMixer::Stop( const VoiceHandle hVoice )
+{
+	if( !GetSlot( hVoice ) )
+		return false;
+
+	Command_t command;
+
+	command.type = CommandType::STOP;
+	command.uiVoice = static_cast<uint16_t>( hVoice & VOICE_MASK );
+
+	SendCommand( std::move( command ) );
+
+	return true;
+}
+
+void CMixer::StopAll()
+{
+	for( size_t uiVoice = 0; uiVoice < MAX_VOICES; ++uiVoice )
+	{
+		if( m_Slots[ uiVoice ].uiGeneration != 0 )
+			Stop( static_cast<VoiceHandle>( uiVoice ) | ( static_cast<VoiceHandle>( m_Slots[ uiVoice ].uiGeneration ) << GENERATION_SHIFT ) );
+	}
+}
+
+void CMixer::Update()
+{
+	Release_t release;
+
+	while( m_Releases.TryPop( release ) )
+	{
+		assert( m_Slots[ release.uiVoice ].uiGeneration != 0 );
+
+		m_Slots[ release.uiVoice ].uiGeneration = 0;
+		m_FreeVoices[ m_uiFreeVoiceCount++ ] = release.uiVoice;
+
+		//Frees the sound if nothing else uses it. Streams that nothing uses are closed by the streamer.
+		release.sound.reset();
+		release.stream.reset();
+	}
+}
+
+bool CMixer::IsPlaying( const VoiceHandle hVoice ) const
+{
+	return GetSlot( hVoice ) != nullptr;
+}
+
+bool CMixer::SendCommand( Command_t&& command )
+{
+	return m_Commands.TryPush( std::move( command ) );
+}
+
+const CMixer::VoiceSlot_t* CMixer::GetSlot( const VoiceHandle hVoice ) const
+{
+	const size_t uiVoice = hVoice & VOICE_MASK;
+	const auto uiGeneration = hVoice >> GENERATION_SHIFT;
+
+	if( uiGeneration == 0 || uiVoice >= MAX_VOICES || m_Slots[ uiVoice ].uiGeneration != uiGeneration )
+		return nullptr;
+
+	return &m_Slots[ uiVoice ];
+}
+
+void CMixer::Mix( int16_t* pOutput, const size_t uiFrames )
+{
+	ProcessCommands();
+
+	const auto pConvert = GetConvert();
+
+	for( size_t uiDone = 0; uiDone < uiFrames; )
+	{
+		const size_t uiBlockFrames = std::min( BLOCK_FRAMES, uiFrames - uiDone );
+
+		memset( m_MixBuffer, 0, uiBlockFrames * 2 * sizeof( float ) );
+
+		for( size_t uiIndex = 0; uiIndex < m_uiActiveVoiceCount; )
+		{
+			const auto uiVoice = m_ActiveVoices[ uiIndex ];
+
+			if( !m_Voices[ uiVoice ].bReleasePending )
+				MixVoice( uiVoice, uiBlockFrames );
+
+			//Finished voices leave the list once they're sent back.
+			if( m_Voices[ uiVoice ].bReleasePending && ReleaseVoice( uiIndex ) )
+				continue;
+
+			++uiIndex;
+		}
+
+		pConvert( pOutput + uiDone * 2, m_MixBuffer, uiBlockFrames * 2 );
+
+		uiDone += uiBlockFrames;
+	}
+}
+
+void CMixer::ProcessCommands()
+{
+	Command_t command;
+
+	while( m_Commands.TryPop( command ) )
+	{
+		auto& voice = m_Voices[ command.uiVoice ];
+
+		switch( command.type )
+		{
+		case CommandType::PLAY:
+			{
+				assert( !voice.sound && !voice.stream );
+
+				voice = Voice_t();
+
+				voice.flPitch = std::min( MAX_PITCH, std::max( 1 / MAX_PITCH, command.flPitch ) );
+
+				if( command.sound )
+				{
+					voice.sound = std::move( command.sound );
+					voice.uiChannels = voice.sound->uiChannels;
+					voice.uiStep = GetStep( voice.sound->uiSampleRate, voice.flPitch );
+					voice.bLoop = command.bLoop;
+				}
+				else
+				{
+					//The format is picked up once the streamer has opened the file.
+					voice.stream = std::move( command.stream );
+				}
+
+				//New voices start at full volume so the start of the sound isn't softened.
+				GetGains( command.flVolume, command.flPan, voice.flGain );
+				GetGains( command.flVolume, command.flPan, voice.flTargetGain );
+
+				m_ActiveVoices[ m_uiActiveVoiceCount++ ] = command.uiVoice;
+				break;
+			}
+
+		case CommandType::SET_VOLUME:
+			{
+				//The voice may have ended before the game thread found out.
+				if( ( !voice.sound && !voice.stream ) || voice.bReleasePending || voice.bStopping )
+					break;
+
+				GetGains( command.flVolume, command.flPan, voice.flTargetGain );
+				voice.uiRampFrames = RAMP_FRAMES;
+				break;
+			}
+
+		case CommandType::STOP:
+			{
+				if( ( !voice.sound && !voice.stream ) || voice.bReleasePending || voice.bStopping )
+					break;
+
+				voice.flTargetGain[ 0 ] = voice.flTargetGain[ 1 ] = 0;
+				voice.uiRampFrames = RAMP_FRAMES;
+				voice.bStopping = true;
+				break;
+			}
+		}
+	}
+}
+
+bool CMixer::ReleaseVoice( const size_t uiIndex )
+{
+	const auto uiVoice = m_ActiveVoices[ uiIndex ];
+
+	auto& voice = m_Voices[ uiVoice ];
+
+	Release_t release;
+
+	release.uiVoice = uiVoice;
+	release.sound = std::move( voice.sound );
+	release.stream = std::move( voice.stream );
+
+	//The game thread frees the sound, the audio thread must never free memory.
+	if( !m_Releases.TryPush( std::move( release ) ) )
+	{
+		voice.sound = std::move( release.sound );
+		voice.stream = std::move( release.stream );
+		return false;
+	}
+
+	voice = Voice_t();
+
+	m_ActiveVoices[ uiIndex ] = m_ActiveVoices[ --m_uiActiveVoiceCount ];
+
+	return true;
+}
+
+void CMixer::MixVoice( const size_t uiVoice, const size_t uiFrames )
+{
+	auto& voice = m_Voices[ uiVoice ];
+
+	if( voice.uiChannels == 0 )
+	{
+		const auto state = voice.stream->GetState();
+
+		if( state == CSoundStream::State::OPENING )
+		{
+			//Nothing to fade out yet.
+			if( voice.bStopping )
+				voice.bReleasePending = true;
+
+			return;
+		}
+
+		//Failed to open.
+		if( voice.stream->GetChannels() == 0 )
+		{
+			voice.bReleasePending = true;
+			return;
+		}
+
+		voice.uiChannels = voice.stream->GetChannels();
+		voice.uiStep = GetStep( voice.stream->GetSampleRate(), voice.flPitch );
+	}
+
+	const size_t uiProduced = voice.stream ? ResampleStream( voice, uiFrames ) : Resample( voice, uiFrames );
+
+	const auto pMix = voice.uiChannels == 2 ? GetMixStereo() : GetMixMono();
+
+	size_t uiMixed = 0;
+
+	if( voice.uiRampFrames > 0 )
+	{
+		const size_t uiRampFrames = std::min( uiProduced, voice.uiRampFrames );
+
+		const float flStep[ 2 ] =
+		{
+			( voice.flTargetGain[ 0 ] - voice.flGain[ 0 ] ) / voice.uiRampFrames,
+			( voice.flTargetGain[ 1 ] - voice.flGain[ 1 ] ) / voice.uiRampFrames
+		};
+
+		pMix( m_MixBuffer, m_ResampleBuffer, uiRampFrames, voice.flGain, flStep );
+
+		voice.uiRampFrames -= uiRampFrames;
+
+		if( voice.uiRampFrames == 0 )
+		{
+			voice.flGain[ 0 ] = voice.flTargetGain[ 0 ];
+			voice.flGain[ 1 ] = voice.flTargetGain[ 1 ];
+		}
+		else
+		{
+			voice.flGain[ 0 ] += flStep[ 0 ] * uiRampFrames;
+			voice.flGain[ 1 ] += flStep[ 1 ] * uiRampFrames;
+		}
+
+		uiMixed = uiRampFrames;
+	}
+
+	if( uiMixed < uiProduced && !( voice.bStopping && voice.uiRampFrames == 0 ) )
+	{
+		const float flStep[ 2 ] = {};
+
+		pMix( m_MixBuffer + uiMixed * 2, m_ResampleBuffer + uiMixed * voice.uiChannels, uiProduced - uiMixed, voice.flGain, flStep );
+	}
+
+	if( uiProduced < uiFrames || ( voice.bStopping && voice.uiRampFrames == 0 ) )
+		voice.bReleasePending = true;
+}
+
+size_t CMixer::Resample( Voice_t& voice, const size_t uiFrames )
+{
+	const Sound_t& sound = *voice.sound;
+
+	const size_t uiChannels = sound.uiChannels;
+	const int16_t* pSamples = sound.samples.data();
+
+	const uint64_t uiEnd = static_cast<uint64_t>( sound.uiFrames ) << 32;
+	const uint64_t uiLoopStart = static_cast<uint64_t>( sound.uiLoopStart ) << 32;
+
+	const uint64_t ONE = static_cast<uint64_t>( 1 ) << 32;
+	const uint64_t FRACTION_MASK = ONE - 1;
+
+	float* pOutput = m_ResampleBuffer;
+
+	size_t uiProduced = 0;
+
+	while( uiProduced < uiFrames )
+	{
+		if( voice.uiPosition >= uiEnd )
+		{
+			if( !voice.bLoop )
+				break;
+
+			voice.uiPosition = uiLoopStart + ( voice.uiPosition - uiEnd ) % ( uiEnd - uiLoopStart );
+		}
+
+		const size_t uiFrame = static_cast<size_t>( voice.uiPosition >> 32 );
+
+		if( voice.uiStep == ONE && ( voice.uiPosition & FRACTION_MASK ) == 0 )
+		{
+			//Same rate as the output, so frames are copied.
+			const size_t uiCount = std::min<size_t>( uiFrames - uiProduced, sound.uiFrames - uiFrame );
+
+			const int16_t* pInput = pSamples + uiFrame * uiChannels;
+
+			for( size_t uiSample = 0; uiSample < uiCount * uiChannels; ++uiSample )
+			{
+				pOutput[ uiSample ] = pInput[ uiSample ] * SAMPLE_SCALE;
+			}
+
+			pOutput += uiCount * uiChannels;
+			uiProduced += uiCount;
+			voice.uiPosition += static_cast<uint64_t>( uiCount ) << 32;
+			continue;
+		}
+
+		//Frames that can be produced before the end of the sound.
+		const size_t uiCount = static_cast<size_t>( std::min<uint64_t>( uiFrames - uiProduced, ( uiEnd - voice.uiPosition + voice.uiStep - 1 ) / voice.uiStep ) );
+
+		for( size_t uiOutput = 0; uiOutput < uiCount; ++uiOutput )
+		{
+			const size_t uiFirst = static_cast<size_t>( voice.uiPosition >> 32 );
+
+			//The last frame is interpolated towards the loop start, or held.
+			size_t uiSecond = uiFirst + 1;
+
+			if( uiSecond >= sound.uiFrames )
+				uiSecond = voice.bLoop ? sound.uiLoopStart : uiFirst;
+
+			const float flFraction = ( voice.uiPosition & FRACTION_MASK ) * FRACTION_SCALE;
+
+			for( size_t uiChannel = 0; uiChannel < uiChannels; ++uiChannel )
+			{
+				const float flFirst = pSamples[ uiFirst * uiChannels + uiChannel ];
+				const float flSecond = pSamples[ uiSecond * uiChannels + uiChannel ];
+
+				pOutput[ uiChannel ] = ( flFirst + ( flSecond - flFirst ) * flFraction ) * SAMPLE_SCALE;
+			}
+
+			pOutput += uiChannels;
+			voice.uiPosition += voice.uiStep;
+		}
+
+		uiProduced += uiCount;
+	}
+
+	return uiProduced;
+}
+
+size_t CMixer::ResampleStream( Voice_t& voice, const size_t uiFrames )
+{
+	CSoundStream& stream = *voice.stream;
+
+	//The state is read first, so a finished stream's last frames are seen as available.
+	const auto state = stream.GetState();
+	const bool bEnded = state == CSoundStream::State::FINISHED || state == CSoundStream::State::FAILED;
+
+	const size_t uiAvailable = stream.GetAvailableFrames();
+
+	const size_t uiChannels = voice.uiChannels;
+
+	const uint64_t FRACTION_MASK = ( static_cast<uint64_t>( 1 ) << 32 ) - 1;
+
+	float* pOutput = m_ResampleBuffer;
+
+	size_t uiProduced = 0;
+
+	for( ; uiProduced < uiFrames; ++uiProduced )
+	{
+		const size_t uiFirst = static_cast<size_t>( voice.uiPosition >> 32 );
+
+		//Interpolating needs the next frame too, except for the last frame of the sound, which is held.
+		size_t uiSecond = uiFirst + 1;
+
+		if( uiSecond >= uiAvailable )
+		{
+			if( !bEnded || uiFirst >= uiAvailable )
+				break;
+
+			uiSecond = uiFirst;
+		}
+
+		const float flFraction = ( voice.uiPosition & FRACTION_MASK ) * FRACTION_SCALE;
+
+		for( size_t uiChannel = 0; uiChannel < uiChannels; ++uiChannel )
+		{
+			const float flFirst = stream.GetSample( uiFirst, uiChannel );
+			const float flSecond = stream.GetSample( uiSecond, uiChannel );
+
+			pOutput[ uiChannel ] = ( flFirst + ( flSecond - flFirst ) * flFraction ) * SAMPLE_SCALE;
+		}
+
+		pOutput += uiChannels;
+		voice.uiPosition += voice.uiStep;
+	}
+
+	//Frames that were moved past are given back to the streamer.
+	const size_t uiConsumed = std::min( static_cast<size_t>( voice.uiPosition >> 32 ), uiAvailable );
+
+	stream.Consume( uiConsumed );
+	voice.uiPosition -= static_cast<uint64_t>( uiConsumed ) << 32;
+
+	if( uiProduced < uiFrames && !bEnded )
+	{
+		//The streamer fell behind. Silence is played rather than ending the voice, and it picks up where it left off.
+		memset( pOutput, 0, ( uiFrames - uiProduced ) * uiChannels * sizeof( float ) );
+
+		stream.AddUnderrun();
+
+		return uiFrames;
+	}
+
+	return uiProduced;
+}
+
+uint64_t CMixer::GetStep( const uint32_t uiSampleRate, const float flPitch ) const
+{
+	const uint64_t uiStep = static_cast<uint64_t>( static_cast<double>( uiSampleRate ) * flPitch / m_uiOutputRate * 4294967296.0 );
+
+	return std::max<uint64_t>( uiStep, 1 );
+}
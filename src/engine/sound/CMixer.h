@@ -0,0 +1,291 @@
+#ifndef ENGINE_SOUND_CMIXER_H
+#define ENGINE_SOUND_CMIXER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "CSPSCQueue.h"
+
+#include "CSoundCache.h"
+#include "CSoundStream.h"
+
+/**
+*	Software mixer. The game thread starts and stops voices, and the audio device's thread mixes them into 16 bit stereo.
+*	The game thread sends commands to the mixer through a lock-free queue, and the mixer sends finished voices back through another,
+*	so the audio thread never locks, allocates, or frees a sound.
+*	Voices are resampled to the output rate with linear interpolation, and volume changes are ramped so they don't click.
+*	Mixing is done in floating point, with vector kernels for the volume and conversion passes.
+*	Voices either play a decoded sound, or a stream that CSoundStreamer decodes while it plays. A stream that runs dry plays silence until it catches up.
+*/
+class CMixer final
+{
+public:
+	using VoiceHandle = uint32_t;
+
+	/**
+	*	Handle that never refers to a voice.
+	*/
+	static const VoiceHandle INVALID_VOICE = 0;
+
+	static const uint32_t DEFAULT_OUTPUT_RATE = 44100;
+
+	static const size_t MAX_VOICES = 128;
+
+	/**
+	*	Number of frames mixed at a time.
+	*/
+	static const size_t BLOCK_FRAMES = 256;
+
+	/**
+	*	Number of frames that volume changes are spread over.
+	*/
+	static const size_t RAMP_FRAMES = 128;
+
+	/**
+	*	Number of commands that can be waiting for the audio thread.
+	*/
+	static const size_t COMMAND_QUEUE_SIZE = 1024;
+
+	/**
+	*	Highest pitch a voice can play at.
+	*/
+	static constexpr float MAX_PITCH = 8;
+
+public:
+	/**
+	*	@param uiOutputRate Sample rate that is mixed to.
+	*/
+	CMixer( const uint32_t uiOutputRate = DEFAULT_OUTPUT_RATE );
+	~CMixer();
+
+	uint32_t GetOutputRate() const { return m_uiOutputRate; }
+
+	/**
+	*	Starts playing a sound. Called by the game thread.
+	*	@param flVolume Volume, 0 to 1.
+	*	@param flPan Balance, from -1 for left only to 1 for right only.
+	*	@param flPitch Playback speed. 1 plays the sound at its own sample rate.
+	*	@param bLoop Whether to loop the sound from its loop start until it's stopped.
+	*	@return Handle to the voice, or INVALID_VOICE if all voices are in use.
+	*/
+	VoiceHandle Play( CSoundCache::SoundPtr sound, const float flVolume = 1, const float flPan = 0, const float flPitch = 1, const bool bLoop = false );
+
+	/**
+	*	Starts playing a stream. Called by the game thread. The voice stays silent until the stream's file is open, and ends with the stream.
+	*	Looping is up to the stream.
+	*	@see Play( CSoundCache::SoundPtr, const float, const float, const float, const bool )
+	*/
+	VoiceHandle Play( std::shared_ptr<CSoundStream> stream, const float flVolume = 1, const float flPan = 0, const float flPitch = 1 );
+
+	/**
+	*	Changes a voice's volume and balance. Called by the game thread.
+	*	@return Whether the voice is still playing, as far as the game thread knows.
+	*/
+	bool SetVolume( const VoiceHandle hVoice, const float flVolume, const float flPan = 0 );
+
+	/**
+	*	Fades out a voice and stops it. Called by the game thread.
+	*	@return Whether the voice is still playing, as far as the game thread knows.
+	*/
+	bool Stop( const VoiceHandle hVoice );
+
+	/**
+	*	Stops all voices. Called by the game thread.
+	*/
+	void StopAll();
+
+	/**
+	*	Frees the voices that have finished, and the sounds they played. Called by the game thread once a frame.
+	*/
+	void Update();
+
+	/**
+	*	@return Whether a voice is playing, as far as the game thread knows.
+	*/
+	bool IsPlaying( const VoiceHandle hVoice ) const;
+
+	/**
+	*	@return Number of voices the game thread started that haven't been freed yet.
+	*/
+	size_t GetVoiceCount() const { return MAX_VOICES - m_uiFreeVoiceCount; }
+
+	/**
+	*	Mixes the playing voices. Called by the audio thread.
+	*	@param pOutput Interleaved 16 bit stereo samples.
+	*/
+	void Mix( int16_t* pOutput, const size_t uiFrames );
+
+private:
+	static const size_t GENERATION_SHIFT = 16;
+	static const VoiceHandle VOICE_MASK = ( 1 << GENERATION_SHIFT ) - 1;
+
+	enum class CommandType : uint8_t
+	{
+		PLAY = 0,
+		SET_VOLUME,
+		STOP
+	};
+
+	struct Command_t
+	{
+		CommandType type = CommandType::STOP;
+		uint16_t uiVoice = 0;
+		bool bLoop = false;
+
+		CSoundCache::SoundPtr sound;
+		std::shared_ptr<CSoundStream> stream;
+
+		float flVolume = 0;
+		float flPan = 0;
+		float flPitch = 0;
+	};
+
+	/**
+	*	A voice that finished, and the sound it played, so the game thread can free them.
+	*/
+	struct Release_t
+	{
+		uint16_t uiVoice = 0;
+		CSoundCache::SoundPtr sound;
+		std::shared_ptr<CSoundStream> stream;
+	};
+
+	/**
+	*	The game thread's record of a voice.
+	*/
+	struct VoiceSlot_t
+	{
+		/**
+		*	Generation of the voice in the slot, or 0 if the slot is free.
+		*/
+		uint16_t uiGeneration = 0;
+
+		uint16_t uiNextGeneration = 1;
+	};
+
+	/**
+	*	The audio thread's state of a voice.
+	*/
+	struct Voice_t
+	{
+		/**
+		*	Sound that is played, or null if a stream is.
+		*/
+		CSoundCache::SoundPtr sound;
+		std::shared_ptr<CSoundStream> stream;
+
+		/**
+		*	Channels of the sound or stream. 0 until a stream's format is known.
+		*/
+		uint32_t uiChannels = 0;
+
+		/**
+		*	Pitch of a stream, applied once its sample rate is known.
+		*/
+		float flPitch = 1;
+
+		/**
+		*	Position in the sound, in frames, as 32.32 fixed point. For streams, relative to the first frame that wasn't consumed.
+		*/
+		uint64_t uiPosition = 0;
+
+		/**
+		*	Frames advanced per output frame, as 32.32 fixed point.
+		*/
+		uint64_t uiStep = 0;
+
+		/**
+		*	Current and target gains of the left and right channels. Ramped over uiRampFrames.
+		*/
+		float flGain[ 2 ] = {};
+		float flTargetGain[ 2 ] = {};
+		size_t uiRampFrames = 0;
+
+		bool bLoop = false;
+
+		/**
+		*	Whether the voice is fading out, and is done once the ramp ends.
+		*/
+		bool bStopping = false;
+
+		/**
+		*	Whether the voice finished, and is waiting to be sent back.
+		*/
+		bool bReleasePending = false;
+	};
+
+	bool SendCommand( Command_t&& command );
+
+	/**
+	*	@return The slot of a voice, or null if the handle doesn't refer to a voice.
+	*/
+	const VoiceSlot_t* GetSlot( const VoiceHandle hVoice ) const;
+
+	void ProcessCommands();
+
+	/**
+	*	Sends a finished voice back to the game thread, and removes it from the active voices.
+	*	@param uiIndex Index of the voice in m_ActiveVoices.
+	*	@return Whether it was sent. If the queue is full, it's tried again on the next block.
+	*/
+	bool ReleaseVoice( const size_t uiIndex );
+
+	/**
+	*	Adds uiFrames frames of a voice to m_MixBuffer.
+	*/
+	void MixVoice( const size_t uiVoice, const size_t uiFrames );
+
+	/**
+	*	Resamples a voice into m_ResampleBuffer and advances it.
+	*	@return Number of frames produced. Fewer than asked for if the sound ended.
+	*/
+	size_t Resample( Voice_t& voice, const size_t uiFrames );
+
+	/**
+	*	Resamples a stream voice into m_ResampleBuffer, and consumes the frames it moved past.
+	*	@return Number of frames produced. Fewer than asked for if the stream ended; if it ran dry the rest is silence.
+	*/
+	size_t ResampleStream( Voice_t& voice, const size_t uiFrames );
+
+	/**
+	*	@return Sample increment per output frame, as 32.32 fixed point.
+	*/
+	uint64_t GetStep( const uint32_t uiSampleRate, const float flPitch ) const;
+
+private:
+	const uint32_t m_uiOutputRate;
+
+	CSPSCQueue<Command_t> m_Commands{ COMMAND_QUEUE_SIZE };
+	CSPSCQueue<Release_t> m_Releases{ COMMAND_QUEUE_SIZE };
+
+	//Game thread.
+	VoiceSlot_t m_Slots[ MAX_VOICES ];
+	uint16_t m_FreeVoices[ MAX_VOICES ];
+	size_t m_uiFreeVoiceCount = 0;
+
+	//Audio thread.
+	Voice_t m_Voices[ MAX_VOICES ];
+
+	/**
+	*	Indices of the voices that are playing, so the mixer only visits those.
+	*/
+	uint16_t m_ActiveVoices[ MAX_VOICES ];
+	size_t m_uiActiveVoiceCount = 0;
+
+	/**
+	*	Interleaved stereo.
+	*/
+	alignas( 16 ) float m_MixBuffer[ BLOCK_FRAMES * 2 ];
+
+	/**
+	*	Resampled frames of the voice being mixed, with the sound's channels.
+	*/
+	alignas( 16 ) float m_ResampleBuffer[ BLOCK_FRAMES * 2 ];
+
+private:
+	CMixer( const CMixer& ) = delete;
+	CMixer& operator=( const CMixer& ) = delete;
+};
+
+#endif //ENGINE_SOUND_CMIXER_H
@@ -0,0 +1,194 @@
+#include <algorithm>
+#include <cstring>
+
+#include "ByteSwap.h"
+#include "FileSystem2.h"
+#include "Logging.h"
+
+#include "CSoundCache.h"
+
+namespace
+{
+const size_t CHUNK_HEADER_SIZE = 8;
+
+uint16_t ReadShort( const uint8_t* pData )
+{
+	uint16_t uiValue;
+	memcpy( &uiValue, pData, sizeof( uiValue ) );
+	return LittleValue( uiValue );
+}
+
+uint32_t ReadLong( const uint8_t* pData )
+{
+	uint32_t uiValue;
+	memcpy( &uiValue, pData, sizeof( uiValue ) );
+	return LittleValue( uiValue );
+}
+
+/**
+*	Finds a chunk in a RIFF file's list of chunks.
+*	@return The chunk's data, or null if there is no such chunk.
+*/
+const uint8_t* FindChunk( const uint8_t* pData, const size_t uiSize, const char* pszID, size_t& uiChunkSize )
+{
+	for( size_t uiOffset = 0; uiSize - uiOffset >= CHUNK_HEADER_SIZE; )
+	{
+		const uint8_t* pChunk = pData + uiOffset;
+
+		//Truncated chunks are cut off at the end of the file.
+		const size_t uiLength = std::min<size_t>( ReadLong( pChunk + 4 ), uiSize - uiOffset - CHUNK_HEADER_SIZE );
+
+		if( !memcmp( pChunk, pszID, 4 ) )
+		{
+			uiChunkSize = uiLength;
+			return pChunk + CHUNK_HEADER_SIZE;
+		}
+
+		//Chunks are padded to an even size.
+		uiOffset += CHUNK_HEADER_SIZE + uiLength + ( uiLength & 1 );
+	}
+
+	return nullptr;
+}
+}
+
+const char CSoundCache::SOUND_DIRECTORY[] = "sound";
+
+CSoundCache::CSoundCache( IFileSystem2& fileSystem )
+	: m_FileSystem( fileSystem )
+{
+}
+
+CSoundCache::SoundPtr CSoundCache::Load( const char* pszName )
+{
+	std::string szName( pszName );
+
+	std::replace( szName.begin(), szName.end(), '\\', '/' );
+
+	auto it = m_Sounds.find( szName );
+
+	if( it != m_Sounds.end() )
+		return it->second;
+
+	const std::string szFileName = std::string( SOUND_DIRECTORY ) + '/' + szName;
+
+	SoundPtr sound;
+
+	auto hFile = m_FileSystem.Open( szFileName.c_str(), "rb" );
+
+	if( hFile != FILESYSTEM_INVALID_HANDLE )
+	{
+		int iSize = 0;
+
+		if( auto pBuffer = m_FileSystem.GetReadBuffer( hFile, &iSize, false ) )
+		{
+			auto decoded = std::make_shared<Sound_t>();
+
+			if( DecodeWAV( reinterpret_cast<const uint8_t*>( pBuffer ), static_cast<size_t>( iSize ), *decoded ) )
+			{
+				m_uiMemoryUsage += decoded->samples.size() * sizeof( int16_t );
+				sound = std::move( decoded );
+			}
+
+			m_FileSystem.ReleaseReadBuffer( hFile, pBuffer );
+		}
+
+		m_FileSystem.Close( hFile );
+	}
+
+	if( !sound )
+		Msg( "Couldn't load sound \"%s\"\n", szFileName.c_str() );
+
+	m_Sounds.emplace( std::move( szName ), sound );
+
+	return sound;
+}
+
+void CSoundCache::Clear()
+{
+	m_Sounds.clear();
+	m_uiMemoryUsage = 0;
+}
+
+bool CSoundCache::DecodeWAV( const uint8_t* pData, const size_t uiSize, Sound_t& sound )
+{
+	const size_t RIFF_HEADER_SIZE = 12;
+
+	if( uiSize < RIFF_HEADER_SIZE || memcmp( pData, "RIFF", 4 ) || memcmp( pData + 8, "WAVE", 4 ) )
+		return false;
+
+	const uint8_t* pChunks = pData + RIFF_HEADER_SIZE;
+	const size_t uiChunksSize = uiSize - RIFF_HEADER_SIZE;
+
+	size_t uiFormatSize;
+	const uint8_t* pFormat = FindChunk( pChunks, uiChunksSize, "fmt ", uiFormatSize );
+
+	const size_t FORMAT_SIZE = 16;
+
+	if( !pFormat || uiFormatSize < FORMAT_SIZE )
+		return false;
+
+	//Uncompressed samples only.
+	const uint16_t WAVE_FORMAT_PCM = 1;
+
+	const uint16_t uiFormatTag = ReadShort( pFormat );
+	const uint16_t uiChannels = ReadShort( pFormat + 2 );
+	const uint32_t uiSampleRate = ReadLong( pFormat + 4 );
+	const uint16_t uiBitsPerSample = ReadShort( pFormat + 14 );
+
+	if( uiFormatTag != WAVE_FORMAT_PCM || ( uiChannels != 1 && uiChannels != 2 ) || ( uiBitsPerSample != 8 && uiBitsPerSample != 16 ) || uiSampleRate == 0 )
+		return false;
+
+	size_t uiDataSize;
+	const uint8_t* pSamples = FindChunk( pChunks, uiChunksSize, "data", uiDataSize );
+
+	if( !pSamples )
+		return false;
+
+	const size_t uiBytesPerFrame = uiChannels * ( uiBitsPerSample / 8 );
+	const size_t uiFrames = uiDataSize / uiBytesPerFrame;
+
+	if( uiFrames == 0 || uiFrames > UINT32_MAX )
+		return false;
+
+	sound.samples.resize( uiFrames * uiChannels );
+
+	if( uiBitsPerSample == 16 )
+	{
+		memcpy( sound.samples.data(), pSamples, sound.samples.size() * sizeof( int16_t ) );
+		LittleArray( sound.samples.data(), sound.samples.size() );
+	}
+	else
+	{
+		//8 bit samples are unsigned.
+		for( size_t uiSample = 0; uiSample < sound.samples.size(); ++uiSample )
+		{
+			sound.samples[ uiSample ] = static_cast<int16_t>( ( pSamples[ uiSample ] - 128 ) << 8 );
+		}
+	}
+
+	sound.uiFrames = static_cast<uint32_t>( uiFrames );
+	sound.uiChannels = uiChannels;
+	sound.uiSampleRate = uiSampleRate;
+	sound.uiLoopStart = 0;
+
+	//The first cue point's sample offset is where looping sounds loop back to.
+	const size_t CUE_POINT_OFFSET = 4;
+	const size_t CUE_POINT_SIZE = 24;
+	const size_t CUE_SAMPLE_OFFSET = 20;
+
+	size_t uiCueSize;
+
+	if( auto pCue = FindChunk( pChunks, uiChunksSize, "cue ", uiCueSize ) )
+	{
+		if( uiCueSize >= CUE_POINT_OFFSET + CUE_POINT_SIZE && ReadLong( pCue ) > 0 )
+		{
+			const uint32_t uiLoopStart = ReadLong( pCue + CUE_POINT_OFFSET + CUE_SAMPLE_OFFSET );
+
+			if( uiLoopStart < sound.uiFrames )
+				sound.uiLoopStart = uiLoopStart;
+		}
+	}
+
+	return true;
+}
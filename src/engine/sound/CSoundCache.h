@@ -0,0 +1,93 @@
+#ifndef ENGINE_SOUND_CSOUNDCACHE_H
+#define ENGINE_SOUND_CSOUNDCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class IFileSystem2;
+
+/**
+*	A decoded sound, ready to be mixed.
+*/
+struct Sound_t
+{
+	/**
+	*	16 bit samples, with the channels of each frame interleaved.
+	*/
+	std::vector<int16_t> samples;
+
+	uint32_t uiFrames = 0;
+
+	/**
+	*	1 or 2.
+	*/
+	uint32_t uiChannels = 0;
+
+	uint32_t uiSampleRate = 0;
+
+	/**
+	*	Frame that looping sounds go back to once they reach the end. From the file's cue point, or 0 if it has none.
+	*/
+	uint32_t uiLoopStart = 0;
+};
+
+/**
+*	Decoded sounds, loaded through the filesystem the first time they're asked for.
+*	Sounds are shared with the mixer, so a sound that is removed from the cache stays alive until the voices playing it have finished.
+*	Only used by the game thread.
+*/
+class CSoundCache final
+{
+public:
+	using SoundPtr = std::shared_ptr<const Sound_t>;
+
+	/**
+	*	Directory that sound names are relative to.
+	*/
+	static const char SOUND_DIRECTORY[];
+
+public:
+	explicit CSoundCache( IFileSystem2& fileSystem );
+
+	/**
+	*	Gets a sound, loading it if it isn't cached. Sounds that fail to load are remembered, and not loaded again.
+	*	@param pszName Name of the sound, relative to SOUND_DIRECTORY.
+	*	@return The sound, or null if it couldn't be loaded.
+	*/
+	SoundPtr Load( const char* pszName );
+
+	/**
+	*	Removes all sounds from the cache.
+	*/
+	void Clear();
+
+	size_t GetCount() const { return m_Sounds.size(); }
+
+	/**
+	*	@return Number of bytes of samples in the cache.
+	*/
+	size_t GetMemoryUsage() const { return m_uiMemoryUsage; }
+
+	/**
+	*	Decodes an uncompressed 8 or 16 bit, mono or stereo WAV file.
+	*	@return Whether the file could be decoded.
+	*/
+	static bool DecodeWAV( const uint8_t* pData, const size_t uiSize, Sound_t& sound );
+
+private:
+	IFileSystem2& m_FileSystem;
+
+	std::unordered_map<std::string, SoundPtr> m_Sounds;
+
+	size_t m_uiMemoryUsage = 0;
+
+private:
+	CSoundCache( const CSoundCache& ) = delete;
+	CSoundCache& operator=( const CSoundCache& ) = delete;
+};
+
+#endif //ENGINE_SOUND_CSOUNDCACHE_H
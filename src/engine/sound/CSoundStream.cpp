@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <cstring>
+
+#include "CSoundStream.h"
+
+const size_t CSoundStream::RING_FRAMES;
+
+CSoundStream::CSoundStream( std::string&& szName, const bool bLoop )
+	: m_szName( std::move( szName ) )
+	, m_bLoop( bLoop )
+{
+}
+
+void CSoundStream::Start( const uint32_t uiChannels, const uint32_t uiSampleRate )
+{
+	assert( GetState() == State::OPENING );
+
+	m_uiChannels = uiChannels;
+	m_uiSampleRate = uiSampleRate;
+
+	m_Samples.reset( new int16_t[ RING_FRAMES * uiChannels ] );
+
+	//Publishes the format and the buffer to the audio thread.
+	m_State.store( State::STREAMING, std::memory_order_release );
+}
+
+void CSoundStream::Write( const int16_t* pSamples, const size_t uiFrames )
+{
+	assert( uiFrames <= GetFreeFrames() );
+
+	const uint64_t uiWritten = m_uiWritten.load( std::memory_order_relaxed );
+
+	const size_t uiStart = static_cast<size_t>( uiWritten & ( RING_FRAMES - 1 ) );
+
+	//The write may wrap around to the start of the ring.
+	const size_t uiFirstFrames = std::min( uiFrames, RING_FRAMES - uiStart );
+
+	memcpy( m_Samples.get() + uiStart * m_uiChannels, pSamples, uiFirstFrames * m_uiChannels * sizeof( int16_t ) );
+	memcpy( m_Samples.get(), pSamples + uiFirstFrames * m_uiChannels, ( uiFrames - uiFirstFrames ) * m_uiChannels * sizeof( int16_t ) );
+
+	m_uiWritten.store( uiWritten + uiFrames, std::memory_order_release );
+}
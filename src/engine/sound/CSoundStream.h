@@ -0,0 +1,171 @@
+#ifndef ENGINE_SOUND_CSOUNDSTREAM_H
+#define ENGINE_SOUND_CSOUNDSTREAM_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+/**
+*	A sound that is decoded while it plays, for music and other long sounds that would take a lot of memory decoded in full.
+*	CSoundStreamer's thread decodes the file into a ring buffer of fixed size, and the mixer reads it on the audio thread.
+*	The ring is lock-free: each side only moves its own position, so neither side waits for the other.
+*	Looping streams are looped by the streamer, so the mixer never sees their end.
+*/
+class CSoundStream final
+{
+public:
+	/**
+	*	Frames in the ring buffer. About 1.5 seconds at 44100 Hz.
+	*/
+	static const size_t RING_FRAMES = 1 << 16;
+
+	enum class State : uint8_t
+	{
+		/**
+		*	The file is being opened, and the format isn't known yet.
+		*/
+		OPENING = 0,
+
+		/**
+		*	Frames are being decoded.
+		*/
+		STREAMING,
+
+		/**
+		*	Every frame was decoded. Frames may still be waiting in the ring.
+		*/
+		FINISHED,
+
+		/**
+		*	The file couldn't be opened or read.
+		*/
+		FAILED
+	};
+
+public:
+	/**
+	*	@param szName Name of the sound, relative to CSoundCache::SOUND_DIRECTORY.
+	*/
+	CSoundStream( std::string&& szName, const bool bLoop );
+	~CSoundStream() = default;
+
+	const std::string& GetName() const { return m_szName; }
+
+	bool IsLooping() const { return m_bLoop; }
+
+	State GetState() const { return m_State.load( std::memory_order_acquire ); }
+
+	/**
+	*	Only valid once the state is no longer OPENING.
+	*/
+	uint32_t GetChannels() const { return m_uiChannels; }
+	uint32_t GetSampleRate() const { return m_uiSampleRate; }
+
+	/**
+	*	@return Number of times the mixer ran out of frames and played silence.
+	*/
+	uint32_t GetUnderruns() const { return m_uiUnderruns.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@return Bytes allocated for the ring buffer.
+	*/
+	size_t GetMemoryUsage() const { return m_Samples ? RING_FRAMES * m_uiChannels * sizeof( int16_t ) : 0; }
+
+	//Called by the audio thread.
+
+	/**
+	*	@return Number of decoded frames that can be read.
+	*/
+	size_t GetAvailableFrames() const
+	{
+		return static_cast<size_t>( m_uiWritten.load( std::memory_order_acquire ) - m_uiRead.load( std::memory_order_relaxed ) );
+	}
+
+	/**
+	*	@param uiFrame Frame, counted from the first frame that hasn't been consumed. Must be less than GetAvailableFrames.
+	*/
+	int16_t GetSample( const size_t uiFrame, const size_t uiChannel ) const
+	{
+		const size_t uiIndex = static_cast<size_t>( ( m_uiRead.load( std::memory_order_relaxed ) + uiFrame ) & ( RING_FRAMES - 1 ) );
+
+		return m_Samples[ uiIndex * m_uiChannels + uiChannel ];
+	}
+
+	/**
+	*	Frees frames for the streamer to decode into.
+	*/
+	void Consume( const size_t uiFrames )
+	{
+		assert( uiFrames <= GetAvailableFrames() );
+
+		m_uiRead.store( m_uiRead.load( std::memory_order_relaxed ) + uiFrames, std::memory_order_release );
+	}
+
+	void AddUnderrun()
+	{
+		m_uiUnderruns.fetch_add( 1, std::memory_order_relaxed );
+	}
+
+	//Called by the streamer's thread.
+
+	/**
+	*	Allocates the ring buffer and starts streaming.
+	*/
+	void Start( const uint32_t uiChannels, const uint32_t uiSampleRate );
+
+	/**
+	*	@return Number of frames that can be written.
+	*/
+	size_t GetFreeFrames() const
+	{
+		return RING_FRAMES - static_cast<size_t>( m_uiWritten.load( std::memory_order_relaxed ) - m_uiRead.load( std::memory_order_acquire ) );
+	}
+
+	/**
+	*	Adds decoded frames. There must be room for them.
+	*	@param pSamples Samples with the stream's channels interleaved.
+	*/
+	void Write( const int16_t* pSamples, const size_t uiFrames );
+
+	/**
+	*	Marks the end of the sound, after its last frame was written.
+	*/
+	void Finish()
+	{
+		m_State.store( State::FINISHED, std::memory_order_release );
+	}
+
+	void Fail()
+	{
+		m_State.store( State::FAILED, std::memory_order_release );
+	}
+
+private:
+	const std::string m_szName;
+
+	const bool m_bLoop;
+
+	std::atomic<State> m_State{ State::OPENING };
+
+	uint32_t m_uiChannels = 0;
+	uint32_t m_uiSampleRate = 0;
+
+	std::unique_ptr<int16_t[]> m_Samples;
+
+	/**
+	*	Frames written and read since the stream started. Their difference is the number of frames in the ring.
+	*/
+	std::atomic<uint64_t> m_uiWritten{ 0 };
+	std::atomic<uint64_t> m_uiRead{ 0 };
+
+	std::atomic<uint32_t> m_uiUnderruns{ 0 };
+
+private:
+	CSoundStream( const CSoundStream& ) = delete;
+	CSoundStream& operator=( const CSoundStream& ) = delete;
+};
+
+#endif //ENGINE_SOUND_CSOUNDSTREAM_H
@@ -0,0 +1,470 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string>
+
+#include "ByteSwap.h"
+#include "Logging.h"
+
+#include "CSoundCache.h"
+
+#include "CSoundStreamer.h"
+
+const size_t CSoundStreamer::READ_SIZE;
+const size_t CSoundStreamer::MAX_READS;
+const int CSoundStreamer::POLL_INTERVAL_MS;
+
+namespace
+{
+const size_t RIFF_HEADER_SIZE = 12;
+const size_t CHUNK_HEADER_SIZE = 8;
+const size_t FORMAT_SIZE = 16;
+
+//The first cue point's sample offset is where looping sounds loop back to.
+const size_t CUE_POINT_OFFSET = 4;
+const size_t CUE_POINT_SIZE = 24;
+const size_t CUE_SAMPLE_OFFSET = 20;
+
+/**
+*	Most chunks looked at before giving up on finding the format and the samples.
+*/
+const size_t MAX_CHUNKS = 64;
+
+uint16_t ReadShort( const uint8_t* pData )
+{
+	uint16_t uiValue;
+	memcpy( &uiValue, pData, sizeof( uiValue ) );
+	return LittleValue( uiValue );
+}
+
+uint32_t ReadLong( const uint8_t* pData )
+{
+	uint32_t uiValue;
+	memcpy( &uiValue, pData, sizeof( uiValue ) );
+	return LittleValue( uiValue );
+}
+}
+
+CSoundStreamer::CSoundStreamer( IFileSystem2& fileSystem )
+	: m_FileSystem( fileSystem )
+{
+}
+
+CSoundStreamer::~CSoundStreamer()
+{
+	Stop();
+}
+
+bool CSoundStreamer::Start()
+{
+	Stop();
+
+	//8 bit samples decode to twice their size.
+	if( !m_DecodeBuffer )
+		m_DecodeBuffer.reset( new int16_t[ READ_SIZE ] );
+
+	m_bStop = false;
+	m_bWake = false;
+
+	m_Thread = std::thread( &CSoundStreamer::Run, this );
+
+	return true;
+}
+
+void CSoundStreamer::Stop()
+{
+	if( !m_Thread.joinable() )
+		return;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bStop = true;
+	}
+
+	m_Condition.notify_one();
+
+	m_Thread.join();
+}
+
+CSoundStreamer::StreamPtr CSoundStreamer::Open( const char* pszName, const bool bLoop )
+{
+	if( !IsRunning() )
+		return nullptr;
+
+	std::string szName( pszName );
+
+	std::replace( szName.begin(), szName.end(), '\\', '/' );
+
+	auto job = std::make_unique<Job_t>();
+
+	job->stream = std::make_shared<CSoundStream>( std::move( szName ), bLoop );
+
+	auto stream = job->stream;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_NewJobs.emplace_back( std::move( job ) );
+		m_bWake = true;
+	}
+
+	m_Condition.notify_one();
+
+	return stream;
+}
+
+size_t CSoundStreamer::GetStreamCount() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_uiStreamCount;
+}
+
+void CSoundStreamer::Run()
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( !m_bStop )
+	{
+		//Woken up by new streams and finished reads. The mixer doesn't wake the thread when it makes room, so check regularly.
+		m_Condition.wait_for( lock, std::chrono::milliseconds( POLL_INTERVAL_MS ), [ this ]() { return m_bStop || m_bWake; } );
+
+		if( m_bStop )
+			break;
+
+		m_bWake = false;
+
+		auto newJobs = std::move( m_NewJobs );
+
+		m_NewJobs.clear();
+
+		lock.unlock();
+
+		for( auto& job : newJobs )
+		{
+			if( OpenJob( *job ) )
+			{
+				m_Jobs.emplace_back( std::move( job ) );
+			}
+			else
+			{
+				Msg( "Couldn't stream sound \"%s\"\n", job->stream->GetName().c_str() );
+
+				CloseJob( *job );
+				job->stream->Fail();
+			}
+		}
+
+		for( size_t uiIndex = 0; uiIndex < m_Jobs.size(); )
+		{
+			if( UpdateJob( *m_Jobs[ uiIndex ] ) )
+			{
+				++uiIndex;
+				continue;
+			}
+
+			CloseJob( *m_Jobs[ uiIndex ] );
+
+			m_Jobs[ uiIndex ] = std::move( m_Jobs.back() );
+			m_Jobs.pop_back();
+		}
+
+		lock.lock();
+
+		m_uiStreamCount = m_Jobs.size();
+	}
+
+	auto newJobs = std::move( m_NewJobs );
+
+	m_NewJobs.clear();
+	m_uiStreamCount = 0;
+
+	lock.unlock();
+
+	for( auto& job : newJobs )
+		job->stream->Fail();
+
+	//Streams end with what was decoded so far.
+	for( auto& job : m_Jobs )
+	{
+		CloseJob( *job );
+		job->stream->Finish();
+	}
+
+	m_Jobs.clear();
+}
+
+bool CSoundStreamer::OpenJob( Job_t& job )
+{
+	const std::string szFileName = std::string( CSoundCache::SOUND_DIRECTORY ) + '/' + job.stream->GetName();
+
+	job.hFile = m_FileSystem.Open( szFileName.c_str(), "rb" );
+
+	if( job.hFile == FILESYSTEM_INVALID_HANDLE )
+		return false;
+
+	const uint64_t uiFileSize = m_FileSystem.Size64( job.hFile );
+
+	uint8_t header[ RIFF_HEADER_SIZE ];
+
+	if( uiFileSize < RIFF_HEADER_SIZE || !ReadNow( job.hFile, 0, header, sizeof( header ) ) || memcmp( header, "RIFF", 4 ) || memcmp( header + 8, "WAVE", 4 ) )
+		return false;
+
+	uint32_t uiChannels = 0;
+	uint32_t uiSampleRate = 0;
+
+	bool bHaveData = false;
+
+	uint64_t uiLoopFrame = 0;
+
+	//Only the chunk headers and the small chunks are read. Cue points usually come after the samples.
+	uint64_t uiOffset = RIFF_HEADER_SIZE;
+
+	for( size_t uiChunk = 0; uiChunk < MAX_CHUNKS && uiFileSize - uiOffset >= CHUNK_HEADER_SIZE; ++uiChunk )
+	{
+		uint8_t chunkHeader[ CHUNK_HEADER_SIZE ];
+
+		if( !ReadNow( job.hFile, uiOffset, chunkHeader, sizeof( chunkHeader ) ) )
+			return false;
+
+		const uint64_t uiStart = uiOffset + CHUNK_HEADER_SIZE;
+
+		//Truncated chunks are cut off at the end of the file.
+		const uint64_t uiLength = std::min<uint64_t>( ReadLong( chunkHeader + 4 ), uiFileSize - uiStart );
+
+		if( !memcmp( chunkHeader, "fmt ", 4 ) )
+		{
+			uint8_t format[ FORMAT_SIZE ];
+
+			if( uiLength < FORMAT_SIZE || !ReadNow( job.hFile, uiStart, format, sizeof( format ) ) )
+				return false;
+
+			//Uncompressed samples only.
+			const uint16_t WAVE_FORMAT_PCM = 1;
+
+			uiChannels = ReadShort( format + 2 );
+			uiSampleRate = ReadLong( format + 4 );
+			job.uiBitsPerSample = ReadShort( format + 14 );
+
+			if( ReadShort( format ) != WAVE_FORMAT_PCM || ( uiChannels != 1 && uiChannels != 2 ) ||
+				( job.uiBitsPerSample != 8 && job.uiBitsPerSample != 16 ) || uiSampleRate == 0 )
+				return false;
+		}
+		else if( !memcmp( chunkHeader, "data", 4 ) )
+		{
+			job.uiDataStart = uiStart;
+			job.uiDataEnd = uiStart + uiLength;
+			bHaveData = true;
+		}
+		else if( !memcmp( chunkHeader, "cue ", 4 ) && uiLength >= CUE_POINT_OFFSET + CUE_POINT_SIZE )
+		{
+			uint8_t cue[ CUE_POINT_OFFSET + CUE_POINT_SIZE ];
+
+			if( ReadNow( job.hFile, uiStart, cue, sizeof( cue ) ) && ReadLong( cue ) > 0 )
+				uiLoopFrame = ReadLong( cue + CUE_POINT_OFFSET + CUE_SAMPLE_OFFSET );
+		}
+
+		//Chunks are padded to an even size.
+		uiOffset = uiStart + uiLength + ( uiLength & 1 );
+
+		if( uiOffset > uiFileSize )
+			break;
+	}
+
+	if( uiChannels == 0 || !bHaveData )
+		return false;
+
+	job.uiFrameSize = uiChannels * ( job.uiBitsPerSample / 8 );
+
+	const uint64_t uiFrames = ( job.uiDataEnd - job.uiDataStart ) / job.uiFrameSize;
+
+	if( uiFrames == 0 )
+		return false;
+
+	job.uiDataEnd = job.uiDataStart + uiFrames * job.uiFrameSize;
+	job.uiLoopStart = job.uiDataStart + ( uiLoopFrame < uiFrames ? uiLoopFrame : 0 ) * job.uiFrameSize;
+	job.uiNextOffset = job.uiDataStart;
+
+	job.stream->Start( uiChannels, uiSampleRate );
+
+	return true;
+}
+
+bool CSoundStreamer::UpdateJob( Job_t& job )
+{
+	auto& stream = *job.stream;
+
+	//Nothing else refers to the stream, so it will never be played.
+	if( job.stream.use_count() == 1 )
+		return false;
+
+	const size_t uiChannels = stream.GetChannels();
+
+	//Reads finish in any order, but are decoded in the order they were issued.
+	while( job.uiReadCount > 0 )
+	{
+		auto& read = job.reads[ job.uiFirstRead ];
+
+		uint64_t uiBytesRead = 0;
+
+		const auto status = m_FileSystem.GetAsyncStatus( read.handle, &uiBytesRead );
+
+		if( status == FileAsyncStatus::PENDING )
+			break;
+
+		m_FileSystem.ReleaseAsync( read.handle );
+		read.handle = FILESYSTEM_INVALID_ASYNC_HANDLE;
+
+		const uint64_t uiSize = job.readSizes[ job.uiFirstRead ];
+		const size_t uiFrames = static_cast<size_t>( uiSize / job.uiFrameSize );
+
+		job.uiFirstRead = ( job.uiFirstRead + 1 ) % MAX_READS;
+		--job.uiReadCount;
+		job.uiFramesInFlight -= uiFrames;
+
+		//The mixer plays what was decoded, then ends the stream.
+		if( status != FileAsyncStatus::COMPLETE || uiBytesRead < uiSize )
+		{
+			stream.Fail();
+			return false;
+		}
+
+		const size_t uiSamples = uiFrames * uiChannels;
+
+		if( job.uiBitsPerSample == 16 )
+		{
+			memcpy( m_DecodeBuffer.get(), read.data, uiSamples * sizeof( int16_t ) );
+			LittleArray( m_DecodeBuffer.get(), uiSamples );
+		}
+		else
+		{
+			//8 bit samples are unsigned.
+			for( size_t uiSample = 0; uiSample < uiSamples; ++uiSample )
+			{
+				m_DecodeBuffer[ uiSample ] = static_cast<int16_t>( ( read.data[ uiSample ] - 128 ) << 8 );
+			}
+		}
+
+		stream.Write( m_DecodeBuffer.get(), uiFrames );
+	}
+
+	//Each read is a whole number of frames.
+	const uint64_t uiReadSize = READ_SIZE / job.uiFrameSize * job.uiFrameSize;
+
+	while( !job.bReadsDone && job.uiReadCount < MAX_READS )
+	{
+		const uint64_t uiSize = std::min( uiReadSize, job.uiDataEnd - job.uiNextOffset );
+		const size_t uiFrames = static_cast<size_t>( uiSize / job.uiFrameSize );
+
+		//Only read what the ring has room for, so finished reads can always be decoded.
+		if( job.uiFramesInFlight + uiFrames > stream.GetFreeFrames() )
+			break;
+
+		const size_t uiSlot = ( job.uiFirstRead + job.uiReadCount ) % MAX_READS;
+
+		FileAsyncRequest_t request;
+
+		request.hFile = job.hFile;
+		request.pBuffer = job.reads[ uiSlot ].data;
+		request.uiOffset = job.uiNextOffset;
+		request.uiLength = uiSize;
+		request.pCallback = &CSoundStreamer::OnReadFinished;
+		request.pContext = this;
+
+		const FileAsyncHandle_t handle = m_FileSystem.ReadAsync( request );
+
+		if( handle == FILESYSTEM_INVALID_ASYNC_HANDLE )
+		{
+			stream.Fail();
+			return false;
+		}
+
+		job.reads[ uiSlot ].handle = handle;
+		job.readSizes[ uiSlot ] = uiSize;
+		++job.uiReadCount;
+		job.uiFramesInFlight += uiFrames;
+
+		job.uiNextOffset += uiSize;
+
+		if( job.uiNextOffset >= job.uiDataEnd )
+		{
+			if( stream.IsLooping() )
+				job.uiNextOffset = job.uiLoopStart;
+			else
+				job.bReadsDone = true;
+		}
+	}
+
+	if( job.bReadsDone && job.uiReadCount == 0 )
+	{
+		stream.Finish();
+		return false;
+	}
+
+	return true;
+}
+
+void CSoundStreamer::CloseJob( Job_t& job )
+{
+	//Reads write into the job, so they have to finish before it goes away.
+	for( ; job.uiReadCount > 0; --job.uiReadCount )
+	{
+		auto& read = job.reads[ job.uiFirstRead ];
+
+		if( !m_FileSystem.CancelAsync( read.handle ) )
+			m_FileSystem.WaitForAsync( read.handle );
+
+		m_FileSystem.ReleaseAsync( read.handle );
+		read.handle = FILESYSTEM_INVALID_ASYNC_HANDLE;
+
+		job.uiFirstRead = ( job.uiFirstRead + 1 ) % MAX_READS;
+	}
+
+	job.uiFramesInFlight = 0;
+
+	if( job.hFile != FILESYSTEM_INVALID_HANDLE )
+	{
+		m_FileSystem.Close( job.hFile );
+		job.hFile = FILESYSTEM_INVALID_HANDLE;
+	}
+}
+
+bool CSoundStreamer::ReadNow( const FileHandle_t hFile, const uint64_t uiOffset, void* pBuffer, const size_t uiLength )
+{
+	FileAsyncRequest_t request;
+
+	request.hFile = hFile;
+	request.pBuffer = pBuffer;
+	request.uiOffset = uiOffset;
+	request.uiLength = uiLength;
+
+	const FileAsyncHandle_t handle = m_FileSystem.ReadAsync( request );
+
+	if( handle == FILESYSTEM_INVALID_ASYNC_HANDLE )
+		return false;
+
+	uint64_t uiBytesRead = 0;
+
+	const auto status = m_FileSystem.WaitForAsync( handle, &uiBytesRead );
+
+	m_FileSystem.ReleaseAsync( handle );
+
+	return status == FileAsyncStatus::COMPLETE && uiBytesRead == uiLength;
+}
+
+void CSoundStreamer::OnReadFinished( const FileAsyncRequest_t& request, FileAsyncStatus, uint64_t )
+{
+	reinterpret_cast<CSoundStreamer*>( request.pContext )->Wake();
+}
+
+void CSoundStreamer::Wake()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bWake = true;
+	}
+
+	m_Condition.notify_one();
+}
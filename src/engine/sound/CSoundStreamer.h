@@ -0,0 +1,186 @@
+#ifndef ENGINE_SOUND_CSOUNDSTREAMER_H
+#define ENGINE_SOUND_CSOUNDSTREAMER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "FileSystem2.h"
+
+#include "CSoundStream.h"
+
+/**
+*	Decodes streamed sounds on a thread of its own.
+*	Each stream's file is read with the filesystem's asynchronous reads, a few fixed size reads ahead of the mixer,
+*	so memory per stream stays the same however long the sound is, and starting one doesn't wait for the disk.
+*	Reads are only issued when the ring has room for everything being read, so decoding never has to wait for the mixer.
+*	Streams that nothing else refers to anymore are stopped and their files closed.
+*	Uncompressed 8 or 16 bit, mono or stereo WAV files are supported, like CSoundCache.
+*/
+class CSoundStreamer final
+{
+public:
+	using StreamPtr = std::shared_ptr<CSoundStream>;
+
+	/**
+	*	Bytes read at a time.
+	*/
+	static const size_t READ_SIZE = 32 * 1024;
+
+	/**
+	*	Reads that each stream can have in flight.
+	*/
+	static const size_t MAX_READS = 2;
+
+	/**
+	*	Longest time the thread sleeps before checking whether the mixer has made room.
+	*/
+	static const int POLL_INTERVAL_MS = 10;
+
+public:
+	/**
+	*	@param fileSystem Filesystem to read through. Must outlive the streamer.
+	*/
+	explicit CSoundStreamer( IFileSystem2& fileSystem );
+
+	/**
+	*	Stops the thread.
+	*/
+	~CSoundStreamer();
+
+	bool IsRunning() const { return m_Thread.joinable(); }
+
+	bool Start();
+
+	/**
+	*	Stops the thread and closes all files. Streams end with the frames that were already decoded.
+	*/
+	void Stop();
+
+	/**
+	*	Starts streaming a sound. Returns right away; the file is opened on the streamer's thread.
+	*	@param pszName Name of the sound, relative to CSoundCache::SOUND_DIRECTORY.
+	*	@param bLoop Whether to loop the sound from its loop start until it's stopped.
+	*	@return The stream, to give to CMixer::Play. Null if the streamer isn't running.
+	*/
+	StreamPtr Open( const char* pszName, const bool bLoop );
+
+	/**
+	*	@return Number of streams that are open.
+	*/
+	size_t GetStreamCount() const;
+
+private:
+	struct Read_t
+	{
+		FileAsyncHandle_t handle = FILESYSTEM_INVALID_ASYNC_HANDLE;
+
+		uint8_t data[ READ_SIZE ];
+	};
+
+	struct Job_t
+	{
+		StreamPtr stream;
+
+		FileHandle_t hFile = FILESYSTEM_INVALID_HANDLE;
+
+		uint32_t uiBitsPerSample = 0;
+		uint32_t uiFrameSize = 0;
+
+		//Offsets in the file of the samples, and of the frame that looping streams go back to.
+		uint64_t uiDataStart = 0;
+		uint64_t uiDataEnd = 0;
+		uint64_t uiLoopStart = 0;
+
+		/**
+		*	Where the next read starts.
+		*/
+		uint64_t uiNextOffset = 0;
+
+		/**
+		*	Whether every read that is needed was issued.
+		*/
+		bool bReadsDone = false;
+
+		/**
+		*	Reads in flight, decoded in the order they were issued: reads[ ( uiFirstRead + i ) % MAX_READS ].
+		*/
+		Read_t reads[ MAX_READS ];
+		uint64_t readSizes[ MAX_READS ] = {};
+		size_t uiFirstRead = 0;
+		size_t uiReadCount = 0;
+
+		/**
+		*	Frames in the reads that are in flight, which the ring has room for.
+		*/
+		size_t uiFramesInFlight = 0;
+	};
+
+	void Run();
+
+	/**
+	*	Opens a job's file and reads its header.
+	*	@return Whether the file is a WAV file that can be streamed.
+	*/
+	bool OpenJob( Job_t& job );
+
+	/**
+	*	Decodes the reads that finished and issues new ones.
+	*	@return Whether the job should keep running.
+	*/
+	bool UpdateJob( Job_t& job );
+
+	/**
+	*	Waits for a job's reads and closes its file.
+	*/
+	void CloseJob( Job_t& job );
+
+	/**
+	*	Reads part of a file and waits for it. Only used for headers, on the streamer's thread.
+	*/
+	bool ReadNow( const FileHandle_t hFile, const uint64_t uiOffset, void* pBuffer, const size_t uiLength );
+
+	static void OnReadFinished( const FileAsyncRequest_t& request, FileAsyncStatus status, uint64_t uiBytesRead );
+
+	void Wake();
+
+private:
+	IFileSystem2& m_FileSystem;
+
+	std::thread m_Thread;
+
+	/**
+	*	Guards the new jobs and the stop flag.
+	*/
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+
+	bool m_bStop = false;
+
+	/**
+	*	Set when something happened that the thread should look at.
+	*/
+	bool m_bWake = false;
+
+	std::vector<std::unique_ptr<Job_t>> m_NewJobs;
+
+	size_t m_uiStreamCount = 0;
+
+	//Only used by the streamer's thread.
+	std::vector<std::unique_ptr<Job_t>> m_Jobs;
+
+	/**
+	*	Decoded samples of a read.
+	*/
+	std::unique_ptr<int16_t[]> m_DecodeBuffer;
+
+private:
+	CSoundStreamer( const CSoundStreamer& ) = delete;
+	CSoundStreamer& operator=( const CSoundStreamer& ) = delete;
+};
+
+#endif //ENGINE_SOUND_CSOUNDSTREAMER_H
@@ -0,0 +1,95 @@
+#include <cstdint>
+
+#include "Logging.h"
+
+#include "CVoiceChat.h"
+#include "VoiceCodec.h"
+
+#include "CVoiceCapture.h"
+
+CVoiceCapture::~CVoiceCapture()
+{
+	Close();
+}
+
+bool CVoiceCapture::Open( CVoiceChat& voice )
+{
+	Close();
+
+	if( SDL_InitSubSystem( SDL_INIT_AUDIO ) < 0 )
+	{
+		Msg( "Couldn't initialize audio: %s\n", SDL_GetError() );
+		return false;
+	}
+
+	SDL_AudioSpec desired;
+
+	SDL_zero( desired );
+
+	desired.freq = static_cast<int>( voice::SAMPLE_RATE );
+	desired.format = AUDIO_S16SYS;
+	desired.channels = 1;
+	desired.samples = static_cast<Uint16>( voice::FRAME_SAMPLES );
+	desired.callback = &CVoiceCapture::CaptureCallback;
+	desired.userdata = &voice;
+
+	SDL_AudioSpec obtained;
+
+	//No changes are allowed, so the callback always gets the codec's format.
+	m_Device = SDL_OpenAudioDevice( nullptr, 1, &desired, &obtained, 0 );
+
+	if( m_Device == 0 )
+	{
+		Msg( "Couldn't open voice capture device: %s\n", SDL_GetError() );
+		SDL_QuitSubSystem( SDL_INIT_AUDIO );
+		return false;
+	}
+
+	m_pVoice = &voice;
+	m_bRecording = false;
+
+	return true;
+}
+
+void CVoiceCapture::Close()
+{
+	if( m_Device == 0 )
+		return;
+
+	//Waits for the callback to return.
+	SDL_CloseAudioDevice( m_Device );
+	m_Device = 0;
+
+	m_pVoice = nullptr;
+	m_bRecording = false;
+
+	SDL_QuitSubSystem( SDL_INIT_AUDIO );
+}
+
+void CVoiceCapture::SetRecording( const bool bRecording )
+{
+	if( m_Device == 0 || bRecording == m_bRecording )
+		return;
+
+	m_bRecording = bRecording;
+
+	if( bRecording )
+	{
+		SDL_PauseAudioDevice( m_Device, 0 );
+		return;
+	}
+
+	SDL_PauseAudioDevice( m_Device, 1 );
+
+	//The device's lock keeps the callback from running while the partly recorded frame is dropped.
+	SDL_LockAudioDevice( m_Device );
+	m_pVoice->ResetCapture();
+	SDL_UnlockAudioDevice( m_Device );
+}
+
+void SDLCALL CVoiceCapture::CaptureCallback( void* pUserData, Uint8* pStream, int iLength )
+{
+	auto& voice = *reinterpret_cast<CVoiceChat*>( pUserData );
+
+	voice.SubmitCapture( reinterpret_cast<const int16_t*>( pStream ), static_cast<size_t>( iLength ) / sizeof( int16_t ) );
+}
@@ -0,0 +1,55 @@
+#ifndef ENGINE_SOUND_CVOICECAPTURE_H
+#define ENGINE_SOUND_CVOICECAPTURE_H
+
+#include <SDL2/SDL.h>
+
+class CVoiceChat;
+
+/**
+*	The SDL capture device that voice is recorded from. Its callback runs on SDL's audio thread and hands the samples to the voice pipeline.
+*	SDL converts whatever the device records to 16 bit mono at the codec's sample rate.
+*	The device is opened once, and paused while the player isn't talking.
+*/
+class CVoiceCapture final
+{
+public:
+	CVoiceCapture() = default;
+	~CVoiceCapture();
+
+	bool IsOpen() const { return m_Device != 0; }
+
+	bool IsRecording() const { return m_bRecording; }
+
+	/**
+	*	Opens the default capture device, paused.
+	*	@param voice Pipeline that receives the samples. Must outlive the device.
+	*	@return Whether the device was opened.
+	*/
+	bool Open( CVoiceChat& voice );
+
+	/**
+	*	Stops the callback and closes the device.
+	*/
+	void Close();
+
+	/**
+	*	Starts or stops recording. Stopping drops the frame that was being recorded.
+	*/
+	void SetRecording( const bool bRecording );
+
+private:
+	static void SDLCALL CaptureCallback( void* pUserData, Uint8* pStream, int iLength );
+
+private:
+	SDL_AudioDeviceID m_Device = 0;
+
+	CVoiceChat* m_pVoice = nullptr;
+
+	bool m_bRecording = false;
+
+private:
+	CVoiceCapture( const CVoiceCapture& ) = delete;
+	CVoiceCapture& operator=( const CVoiceCapture& ) = delete;
+};
+
+#endif //ENGINE_SOUND_CVOICECAPTURE_H
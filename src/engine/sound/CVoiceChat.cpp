@@ -0,0 +1,489 @@
+#include <algorithm>
+#include <cstring>
+
+#include "CNetworkBuffer.h"
+
+#include "CVoiceChat.h"
+
+const size_t CVoiceChat::MAX_SPEAKERS;
+const size_t CVoiceChat::JITTER_SLOTS;
+const size_t CVoiceChat::JITTER_DEPTH;
+const size_t CVoiceChat::PLAYOUT_FRAMES;
+const size_t CVoiceChat::MAX_CONCEALED_FRAMES;
+const int CVoiceChat::SPEAKER_TIMEOUT_MS;
+const size_t CVoiceChat::QUEUE_SIZE;
+const size_t CVoiceChat::MAX_PACKET_SIZE;
+
+namespace
+{
+static_assert( ( CVoiceChat::JITTER_SLOTS & ( CVoiceChat::JITTER_SLOTS - 1 ) ) == 0, "JITTER_SLOTS must be a power of 2" );
+static_assert( voice::FRAME_SAMPLES * sizeof( int16_t ) <= CNetworkChunkPool::CHUNK_SIZE, "Captured frames must fit in a chunk" );
+static_assert( CVoiceChat::MAX_PACKET_SIZE <= CNetworkChunkPool::CHUNK_SIZE, "Packets must fit in a chunk" );
+static_assert( voice::ENCODED_FRAME_SIZE <= UINT8_MAX, "Payload sizes are sent as a byte" );
+
+/**
+*	@return How far a sequence number is ahead of another, or negative if it's behind. Handles wrapping around.
+*/
+inline int SequenceDifference( const uint16_t uiSequence, const uint16_t uiReference )
+{
+	return static_cast<int16_t>( static_cast<uint16_t>( uiSequence - uiReference ) );
+}
+
+/**
+*	Decoded samples of the frame being decoded, per thread.
+*/
+thread_local int16_t g_DecodeBuffer[ voice::FRAME_SAMPLES ];
+}
+
+CVoiceChat::CVoiceChat( CJobSystem& jobs, CMixer& mixer )
+	: m_Jobs( jobs )
+	, m_Mixer( mixer )
+{
+	m_Speakers.reserve( MAX_SPEAKERS );
+}
+
+CVoiceChat::~CVoiceChat()
+{
+	m_Jobs.Wait( m_JobCounter );
+
+	StopSpeakers();
+
+	Frame_t frame;
+
+	while( m_Captured.TryPop( frame ) )
+	{
+		FreeChunk( frame.uiChunk );
+	}
+
+	for( const auto& batchFrame : m_EncodeBatch )
+	{
+		FreeChunk( batchFrame.uiChunk );
+	}
+
+	Packet_t packet;
+
+	while( m_Encoded.TryPop( packet ) )
+	{
+		FreeChunk( packet.uiChunk );
+	}
+}
+
+void CVoiceChat::SubmitCapture( const int16_t* pSamples, const size_t uiCount )
+{
+	size_t uiOffset = 0;
+
+	while( uiOffset < uiCount )
+	{
+		const size_t uiSamples = std::min( uiCount - uiOffset, voice::FRAME_SAMPLES - m_uiCaptureSamples );
+
+		memcpy( m_CaptureFrame + m_uiCaptureSamples, pSamples + uiOffset, uiSamples * sizeof( int16_t ) );
+
+		m_uiCaptureSamples += uiSamples;
+		uiOffset += uiSamples;
+
+		if( m_uiCaptureSamples < voice::FRAME_SAMPLES )
+			break;
+
+		m_uiCaptureSamples = 0;
+
+		m_uiFramesCaptured.fetch_add( 1, std::memory_order_relaxed );
+
+		//The sequence advances for dropped frames too, so receivers conceal them.
+		const uint16_t uiSequence = m_uiCaptureSequence++;
+
+		const uint32_t uiChunk = m_Pool.Allocate();
+
+		if( uiChunk == CNetworkChunkPool::INVALID_CHUNK )
+		{
+			m_uiFramesDropped.fetch_add( 1, std::memory_order_relaxed );
+			continue;
+		}
+
+		memcpy( m_Pool.GetData( uiChunk ), m_CaptureFrame, sizeof( m_CaptureFrame ) );
+
+		if( !m_Captured.TryPush( Frame_t{ uiChunk, uiSequence } ) )
+		{
+			FreeChunk( uiChunk );
+			m_uiFramesDropped.fetch_add( 1, std::memory_order_relaxed );
+		}
+	}
+}
+
+void CVoiceChat::Update()
+{
+	if( !m_bEncoding.load( std::memory_order_acquire ) )
+	{
+		m_EncodeBatch.clear();
+
+		Frame_t frame;
+
+		while( m_Captured.TryPop( frame ) )
+		{
+			m_EncodeBatch.push_back( frame );
+		}
+
+		if( !m_EncodeBatch.empty() )
+		{
+			m_bEncoding.store( true, std::memory_order_relaxed );
+
+			m_Jobs.Submit( [ this ]() { EncodeFrames(); }, &m_JobCounter );
+		}
+	}
+
+	const auto now = std::chrono::steady_clock::now();
+
+	for( auto& speaker : m_Speakers )
+	{
+		if( !speaker->bDecoding.load( std::memory_order_acquire ) )
+			ScheduleDecode( *speaker, now );
+	}
+
+	//Speakers that went quiet end once the mixer has played what was decoded.
+	m_Speakers.erase( std::remove_if( m_Speakers.begin(), m_Speakers.end(),
+		[ & ]( const std::unique_ptr<Speaker_t>& speaker )
+		{
+			if( speaker->bDecoding.load( std::memory_order_acquire ) || speaker->uiWaiting > 0 ||
+				now - speaker->lastReceived < std::chrono::milliseconds( SPEAKER_TIMEOUT_MS ) )
+			{
+				return false;
+			}
+
+			speaker->stream->Finish();
+
+			return true;
+		}
+	), m_Speakers.end() );
+
+	m_uiSpeakerCount.store( m_Speakers.size(), std::memory_order_relaxed );
+}
+
+bool CVoiceChat::ReadPacket( CNetworkBuffer& buffer )
+{
+	Packet_t packet;
+
+	if( !m_Encoded.TryPop( packet ) )
+		return false;
+
+	const bool bFits = packet.uiSize <= buffer.GetBytesLeft();
+
+	if( bFits )
+		buffer.WriteBytes( m_Pool.GetData( packet.uiChunk ), packet.uiSize );
+	else
+		m_uiFramesDropped.fetch_add( 1, std::memory_order_relaxed );
+
+	FreeChunk( packet.uiChunk );
+
+	return bFits;
+}
+
+void CVoiceChat::ReceivePacket( const uint32_t uiSpeaker, CNetworkBuffer& buffer )
+{
+	const uint16_t uiSequence = buffer.ReadWord();
+	const uint8_t uiSize = buffer.ReadByte();
+
+	if( buffer.HasOverflowed() || uiSize == 0 || uiSize > voice::ENCODED_FRAME_SIZE || uiSize > buffer.GetBytesLeft() )
+	{
+		m_uiPacketsInvalid.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	auto pSpeaker = FindSpeaker( uiSpeaker );
+
+	if( !pSpeaker )
+		pSpeaker = AddSpeaker( uiSpeaker );
+
+	const uint32_t uiChunk = pSpeaker ? m_Pool.Allocate() : CNetworkChunkPool::INVALID_CHUNK;
+
+	if( uiChunk == CNetworkChunkPool::INVALID_CHUNK )
+	{
+		//Skip the payload, so the rest of the buffer can still be read.
+		uint8_t discard[ voice::ENCODED_FRAME_SIZE ];
+
+		buffer.ReadBytes( discard, uiSize );
+
+		m_uiFramesDropped.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	buffer.ReadBytes( m_Pool.GetData( uiChunk ), uiSize );
+
+	auto& speaker = *pSpeaker;
+
+	speaker.lastReceived = std::chrono::steady_clock::now();
+
+	//The first packet of a speaker, or of a new talk spurt, starts the sequence.
+	if( !speaker.bPlaying && speaker.uiWaiting == 0 )
+		speaker.uiNextSequence = uiSequence;
+
+	const int iAhead = SequenceDifference( uiSequence, speaker.uiNextSequence );
+
+	if( iAhead >= static_cast<int>( JITTER_SLOTS ) )
+	{
+		//Too far ahead to wait for the frames in between; the sender restarted or a long stretch was lost.
+		ClearJitter( speaker );
+
+		speaker.uiNextSequence = uiSequence;
+		speaker.bPlaying = false;
+	}
+
+	auto& slot = speaker.jitter[ uiSequence & ( JITTER_SLOTS - 1 ) ];
+
+	if( iAhead < 0 || slot.uiChunk != CNetworkChunkPool::INVALID_CHUNK )
+	{
+		FreeChunk( uiChunk );
+		m_uiPacketsLate.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	slot.uiChunk = uiChunk;
+	slot.uiSequence = uiSequence;
+	slot.uiSize = uiSize;
+
+	++speaker.uiWaiting;
+}
+
+void CVoiceChat::StopSpeakers()
+{
+	for( auto& speaker : m_Speakers )
+	{
+		//The job frees its packets and writes to the stream.
+		while( speaker->bDecoding.load( std::memory_order_acquire ) )
+		{
+			m_Jobs.Wait( m_JobCounter );
+		}
+
+		ClearJitter( *speaker );
+
+		speaker->stream->Finish();
+	}
+
+	m_Speakers.clear();
+
+	m_uiSpeakerCount.store( 0, std::memory_order_relaxed );
+}
+
+bool CVoiceChat::IsSpeaking( const uint32_t uiSpeaker ) const
+{
+	const auto pSpeaker = FindSpeaker( uiSpeaker );
+
+	return pSpeaker && pSpeaker->bPlaying;
+}
+
+void CVoiceChat::GetStats( Stats_t& stats ) const
+{
+	stats.uiSpeakers = m_uiSpeakerCount.load( std::memory_order_relaxed );
+
+	stats.uiFramesCaptured = m_uiFramesCaptured.load( std::memory_order_relaxed );
+	stats.uiFramesEncoded = m_uiFramesEncoded.load( std::memory_order_relaxed );
+	stats.uiFramesDecoded = m_uiFramesDecoded.load( std::memory_order_relaxed );
+	stats.uiFramesConcealed = m_uiFramesConcealed.load( std::memory_order_relaxed );
+	stats.uiFramesDropped = m_uiFramesDropped.load( std::memory_order_relaxed );
+
+	stats.uiPacketsLate = m_uiPacketsLate.load( std::memory_order_relaxed );
+	stats.uiPacketsInvalid = m_uiPacketsInvalid.load( std::memory_order_relaxed );
+}
+
+CVoiceChat::Speaker_t* CVoiceChat::FindSpeaker( const uint32_t uiSpeaker ) const
+{
+	for( const auto& speaker : m_Speakers )
+	{
+		if( speaker->uiID == uiSpeaker )
+			return speaker.get();
+	}
+
+	return nullptr;
+}
+
+CVoiceChat::Speaker_t* CVoiceChat::AddSpeaker( const uint32_t uiSpeaker )
+{
+	if( m_Speakers.size() >= MAX_SPEAKERS )
+		return nullptr;
+
+	auto speaker = std::make_unique<Speaker_t>();
+
+	speaker->uiID = uiSpeaker;
+
+	//Decode jobs write to the stream, so it's started here instead of by the streamer.
+	speaker->stream = std::make_shared<CSoundStream>( "voice", false );
+	speaker->stream->Start( 1, voice::SAMPLE_RATE );
+
+	if( m_Mixer.Play( speaker->stream, m_flVolume ) == CMixer::INVALID_VOICE )
+		return nullptr;
+
+	m_Speakers.push_back( std::move( speaker ) );
+
+	m_uiSpeakerCount.store( m_Speakers.size(), std::memory_order_relaxed );
+
+	return m_Speakers.back().get();
+}
+
+void CVoiceChat::ScheduleDecode( Speaker_t& speaker, const std::chrono::steady_clock::time_point now )
+{
+	if( !speaker.bPlaying )
+	{
+		//The end of a talk spurt may leave fewer packets than that, which play once no more have arrived for as long.
+		const auto waitTime = std::chrono::milliseconds( JITTER_DEPTH * voice::FRAME_SAMPLES * 1000 / voice::SAMPLE_RATE );
+
+		if( speaker.uiWaiting == 0 || ( speaker.uiWaiting < JITTER_DEPTH && now - speaker.lastReceived < waitTime ) )
+			return;
+
+		speaker.bPlaying = true;
+	}
+
+	//The mixer may consume frames while this runs, which only means a little more is decoded next time.
+	const size_t uiAvailable = speaker.stream->GetAvailableFrames();
+	const size_t uiTarget = PLAYOUT_FRAMES * voice::FRAME_SAMPLES;
+
+	if( uiAvailable >= uiTarget )
+		return;
+
+	auto& batch = speaker.decodeBatch;
+
+	batch.clear();
+
+	for( size_t uiFrames = ( uiTarget - uiAvailable + voice::FRAME_SAMPLES - 1 ) / voice::FRAME_SAMPLES; uiFrames > 0; --uiFrames )
+	{
+		auto& slot = speaker.jitter[ speaker.uiNextSequence & ( JITTER_SLOTS - 1 ) ];
+
+		if( slot.uiChunk != CNetworkChunkPool::INVALID_CHUNK && slot.uiSequence == speaker.uiNextSequence )
+		{
+			batch.push_back( slot );
+
+			slot = Packet_t();
+			--speaker.uiWaiting;
+		}
+		else if( speaker.uiWaiting > 0 )
+		{
+			//A later packet arrived, so this one is taken to be lost.
+			Packet_t missing;
+
+			missing.uiSequence = speaker.uiNextSequence;
+
+			batch.push_back( missing );
+		}
+		else
+		{
+			//Ran dry: wait for the jitter buffer to fill up again.
+			speaker.bPlaying = false;
+			break;
+		}
+
+		++speaker.uiNextSequence;
+	}
+
+	if( batch.empty() )
+		return;
+
+	speaker.bDecoding.store( true, std::memory_order_relaxed );
+
+	Speaker_t* const pSpeaker = &speaker;
+
+	m_Jobs.Submit( [ this, pSpeaker ]() { DecodeFrames( *pSpeaker ); }, &m_JobCounter );
+}
+
+void CVoiceChat::ClearJitter( Speaker_t& speaker )
+{
+	for( auto& slot : speaker.jitter )
+	{
+		if( slot.uiChunk != CNetworkChunkPool::INVALID_CHUNK )
+			FreeChunk( slot.uiChunk );
+
+		slot = Packet_t();
+	}
+
+	speaker.uiWaiting = 0;
+}
+
+void CVoiceChat::FreeChunk( const uint32_t uiChunk )
+{
+	m_Pool.Free( uiChunk );
+}
+
+void CVoiceChat::EncodeFrames()
+{
+	uint8_t encoded[ voice::ENCODED_FRAME_SIZE ];
+
+	for( const auto& frame : m_EncodeBatch )
+	{
+		voice::EncodeFrame( m_Encoder, reinterpret_cast<const int16_t*>( m_Pool.GetData( frame.uiChunk ) ), encoded );
+
+		//The captured frame's chunk is reused for the packet.
+		CNetworkBuffer buffer( "voice", m_Pool.GetData( frame.uiChunk ), CNetworkChunkPool::CHUNK_SIZE );
+
+		buffer.WriteWord( frame.uiSequence );
+		buffer.WriteByte( static_cast<int>( voice::ENCODED_FRAME_SIZE ) );
+		buffer.WriteBytes( encoded, sizeof( encoded ) );
+
+		Packet_t packet;
+
+		packet.uiChunk = frame.uiChunk;
+		packet.uiSequence = frame.uiSequence;
+		packet.uiSize = static_cast<uint16_t>( buffer.GetBytesInBuffer() );
+
+		m_uiFramesEncoded.fetch_add( 1, std::memory_order_relaxed );
+
+		if( !m_Encoded.TryPush( packet ) )
+		{
+			FreeChunk( frame.uiChunk );
+			m_uiFramesDropped.fetch_add( 1, std::memory_order_relaxed );
+		}
+	}
+
+	m_EncodeBatch.clear();
+
+	m_bEncoding.store( false, std::memory_order_release );
+}
+
+void CVoiceChat::DecodeFrames( Speaker_t& speaker )
+{
+	auto& stream = *speaker.stream;
+
+	for( const auto& packet : speaker.decodeBatch )
+	{
+		bool bDecoded = false;
+
+		if( packet.uiChunk != CNetworkChunkPool::INVALID_CHUNK )
+		{
+			bDecoded = voice::DecodeFrame( m_Pool.GetData( packet.uiChunk ), packet.uiSize, g_DecodeBuffer );
+
+			FreeChunk( packet.uiChunk );
+		}
+
+		if( bDecoded )
+		{
+			memcpy( speaker.lastFrame, g_DecodeBuffer, sizeof( g_DecodeBuffer ) );
+			speaker.uiConcealed = 0;
+
+			m_uiFramesDecoded.fetch_add( 1, std::memory_order_relaxed );
+		}
+		else
+		{
+			//Repeat the last frame at half the volume each time, so a short loss sounds like a dip instead of a click.
+			if( speaker.uiConcealed < MAX_CONCEALED_FRAMES )
+			{
+				const int iShift = static_cast<int>( speaker.uiConcealed ) + 1;
+
+				for( size_t uiIndex = 0; uiIndex < voice::FRAME_SAMPLES; ++uiIndex )
+				{
+					g_DecodeBuffer[ uiIndex ] = static_cast<int16_t>( speaker.lastFrame[ uiIndex ] >> iShift );
+				}
+			}
+			else
+			{
+				std::fill_n( g_DecodeBuffer, voice::FRAME_SAMPLES, 0 );
+			}
+
+			++speaker.uiConcealed;
+
+			m_uiFramesConcealed.fetch_add( 1, std::memory_order_relaxed );
+		}
+
+		//The ring holds far more than PLAYOUT_FRAMES, so this only happens if the mixer stopped reading.
+		if( stream.GetFreeFrames() >= voice::FRAME_SAMPLES )
+			stream.Write( g_DecodeBuffer, voice::FRAME_SAMPLES );
+	}
+
+	speaker.decodeBatch.clear();
+
+	speaker.bDecoding.store( false, std::memory_order_release );
+}
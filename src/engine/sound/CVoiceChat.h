@@ -0,0 +1,308 @@
+#ifndef ENGINE_SOUND_CVOICECHAT_H
+#define ENGINE_SOUND_CVOICECHAT_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "CAlignedNew.h"
+#include "CJobSystem.h"
+#include "CMPSCQueue.h"
+#include "CNetworkChunkPool.h"
+#include "CSPSCQueue.h"
+
+#include "CMixer.h"
+#include "CSoundStream.h"
+#include "VoiceCodec.h"
+
+class CNetworkBuffer;
+
+/**
+*	Voice chat pipeline. Encoding and decoding run as jobs on the job system, so talking players don't cost the game thread any codec work.
+*	Captured frames and packets are kept in chunks from a CNetworkChunkPool, so once the pool has warmed up nothing is allocated per frame.
+*
+*	Outgoing: the capture thread cuts samples into frames and queues them. Each update, the game thread hands the queued frames
+*	to an encode job, which writes a packet per frame into another chunk. The game thread reads the packets with ReadPacket.
+*
+*	Incoming: the game thread files each speaker's packets in a jitter buffer by sequence number. Playback starts once JITTER_DEPTH packets
+*	are waiting, and then each update hands the packets that are due to a decode job, which decodes them into a CSoundStream that the mixer plays,
+*	so mixing is done by the mixer's vector kernels like any other stream. Lost packets are concealed by fading out the last frame.
+*	Each speaker has at most one decode job in flight, so its frames are written in order.
+*	The queues are cache line aligned, so it allocates through CAlignedNew.
+*/
+class CVoiceChat final : public CAlignedNew<CVoiceChat>
+{
+public:
+	/**
+	*	Most speakers that are played at once. Packets of other speakers are dropped.
+	*/
+	static const size_t MAX_SPEAKERS = 32;
+
+	/**
+	*	Packets a speaker can have waiting. Packets further ahead of playback than this restart the speaker's playback at them.
+	*/
+	static const size_t JITTER_SLOTS = 16;
+
+	/**
+	*	Packets that are waited for before a speaker starts playing, or resumes after running dry.
+	*	Fewer are played if no more arrive within as many frames.
+	*/
+	static const size_t JITTER_DEPTH = 3;
+
+	/**
+	*	Frames kept decoded ahead of the mixer, which covers the time between updates.
+	*/
+	static const size_t PLAYOUT_FRAMES = 2;
+
+	/**
+	*	Missing frames in a row that are concealed by repeating the last frame at decreasing volume. Later ones are silent.
+	*/
+	static const size_t MAX_CONCEALED_FRAMES = 3;
+
+	/**
+	*	Speakers that haven't sent a packet in this long are stopped once their frames have played.
+	*/
+	static const int SPEAKER_TIMEOUT_MS = 500;
+
+	/**
+	*	Captured frames and encoded packets that can be waiting for the game thread.
+	*/
+	static const size_t QUEUE_SIZE = 64;
+
+	/**
+	*	Largest packet written by ReadPacket: the sequence number and payload size, then the payload.
+	*/
+	static const size_t MAX_PACKET_SIZE = 3 + voice::ENCODED_FRAME_SIZE;
+
+	struct Stats_t
+	{
+		size_t uiSpeakers = 0;
+
+		uint64_t uiFramesCaptured = 0;
+		uint64_t uiFramesEncoded = 0;
+		uint64_t uiFramesDecoded = 0;
+
+		/**
+		*	Frames that were missing when they were due, and were concealed.
+		*/
+		uint64_t uiFramesConcealed = 0;
+
+		/**
+		*	Captured frames and packets that were dropped because a queue, the pool or the speakers were full.
+		*/
+		uint64_t uiFramesDropped = 0;
+
+		/**
+		*	Packets that arrived after their frame was due, or twice.
+		*/
+		uint64_t uiPacketsLate = 0;
+
+		/**
+		*	Packets that couldn't be read.
+		*/
+		uint64_t uiPacketsInvalid = 0;
+	};
+
+public:
+	/**
+	*	@param jobs Job system that runs the codec. Must outlive the pipeline.
+	*	@param mixer Mixer that plays the speakers. Must outlive the pipeline.
+	*/
+	CVoiceChat( CJobSystem& jobs, CMixer& mixer );
+
+	/**
+	*	Waits for the codec jobs, and stops all speakers. Must be called on the main thread.
+	*/
+	~CVoiceChat();
+
+	/**
+	*	Adds captured samples. Called by the capture thread.
+	*	@param pSamples voice::SAMPLE_RATE mono samples.
+	*/
+	void SubmitCapture( const int16_t* pSamples, const size_t uiCount );
+
+	/**
+	*	Drops the samples of a frame that was partly captured, so the next capture doesn't continue it. Called by the capture thread.
+	*/
+	void ResetCapture() { m_uiCaptureSamples = 0; }
+
+	/**
+	*	Starts encoding the captured frames, decodes the packets that are due, and stops speakers that went quiet. Called by the game thread once a frame.
+	*/
+	void Update();
+
+	/**
+	*	Writes the next encoded packet to a buffer, and frees it. Called by the game thread.
+	*	@return Whether there was a packet, and it fit in the buffer.
+	*/
+	bool ReadPacket( CNetworkBuffer& buffer );
+
+	/**
+	*	Reads a packet written by ReadPacket, and files it in a speaker's jitter buffer. Called by the game thread.
+	*	@param uiSpeaker Identifies the speaker, like the player's entity index.
+	*/
+	void ReceivePacket( const uint32_t uiSpeaker, CNetworkBuffer& buffer );
+
+	/**
+	*	Stops all speakers and drops their packets. Called by the game thread.
+	*/
+	void StopSpeakers();
+
+	/**
+	*	Sets the volume that speakers play at, 0 to 1. Applies to speakers that start afterwards.
+	*/
+	void SetVolume( const float flVolume ) { m_flVolume = flVolume; }
+
+	/**
+	*	@return Whether a speaker is playing.
+	*/
+	bool IsSpeaking( const uint32_t uiSpeaker ) const;
+
+	/**
+	*	Gets the counters. Can be called from any thread.
+	*/
+	void GetStats( Stats_t& stats ) const;
+
+private:
+	/**
+	*	A captured frame, in a chunk.
+	*/
+	struct Frame_t
+	{
+		uint32_t uiChunk;
+		uint16_t uiSequence;
+	};
+
+	/**
+	*	An encoded packet, in a chunk.
+	*/
+	struct Packet_t
+	{
+		uint32_t uiChunk = CNetworkChunkPool::INVALID_CHUNK;
+		uint16_t uiSequence = 0;
+		uint16_t uiSize = 0;
+	};
+
+	struct Speaker_t
+	{
+		uint32_t uiID = 0;
+
+		std::shared_ptr<CSoundStream> stream;
+
+		Packet_t jitter[ JITTER_SLOTS ];
+
+		/**
+		*	Packets in jitter.
+		*/
+		size_t uiWaiting = 0;
+
+		/**
+		*	Sequence of the next frame that is due.
+		*/
+		uint16_t uiNextSequence = 0;
+
+		/**
+		*	Whether frames are being handed to the decoder, as opposed to waiting for JITTER_DEPTH packets.
+		*/
+		bool bPlaying = false;
+
+		std::chrono::steady_clock::time_point lastReceived;
+
+		/**
+		*	Set while a decode job is in flight. The job owns decodeBatch, concealment and the stream's writing side until it clears this.
+		*/
+		std::atomic<bool> bDecoding{ false };
+
+		/**
+		*	Packets for the decode job, in order. Missing frames have no chunk.
+		*/
+		std::vector<Packet_t> decodeBatch;
+
+		//Only used by decode jobs.
+		int16_t lastFrame[ voice::FRAME_SAMPLES ] = {};
+		size_t uiConcealed = 0;
+	};
+
+	Speaker_t* FindSpeaker( const uint32_t uiSpeaker ) const;
+
+	Speaker_t* AddSpeaker( const uint32_t uiSpeaker );
+
+	/**
+	*	Hands the packets that are due to a decode job.
+	*/
+	void ScheduleDecode( Speaker_t& speaker, const std::chrono::steady_clock::time_point now );
+
+	/**
+	*	Frees the packets in a speaker's jitter buffer.
+	*/
+	void ClearJitter( Speaker_t& speaker );
+
+	void FreeChunk( const uint32_t uiChunk );
+
+	//Run by jobs.
+	void EncodeFrames();
+
+	void DecodeFrames( Speaker_t& speaker );
+
+private:
+	CJobSystem& m_Jobs;
+	CMixer& m_Mixer;
+
+	CNetworkChunkPool m_Pool;
+
+	/**
+	*	Counts the jobs in flight, so the destructor can wait for them.
+	*/
+	CJobSystem::CCounter m_JobCounter;
+
+	std::atomic<uint64_t> m_uiFramesCaptured{ 0 };
+	std::atomic<uint64_t> m_uiFramesEncoded{ 0 };
+	std::atomic<uint64_t> m_uiFramesDecoded{ 0 };
+	std::atomic<uint64_t> m_uiFramesConcealed{ 0 };
+	std::atomic<uint64_t> m_uiFramesDropped{ 0 };
+	std::atomic<uint64_t> m_uiPacketsLate{ 0 };
+	std::atomic<uint64_t> m_uiPacketsInvalid{ 0 };
+
+	/**
+	*	Number of speakers, for other threads.
+	*/
+	std::atomic<size_t> m_uiSpeakerCount{ 0 };
+
+	//Capture thread.
+	int16_t m_CaptureFrame[ voice::FRAME_SAMPLES ];
+	size_t m_uiCaptureSamples = 0;
+	uint16_t m_uiCaptureSequence = 0;
+
+	/**
+	*	Captured frames, from the capture thread to the game thread.
+	*/
+	CSPSCQueue<Frame_t> m_Captured{ QUEUE_SIZE };
+
+	/**
+	*	Encoded packets, from encode jobs to the game thread. Jobs can run on any worker, so there can be more than one producer over time.
+	*/
+	CMPSCQueue<Packet_t> m_Encoded{ QUEUE_SIZE };
+
+	//Game thread.
+	float m_flVolume = 1;
+
+	std::vector<std::unique_ptr<Speaker_t>> m_Speakers;
+
+	/**
+	*	Set while an encode job is in flight. The job owns m_EncodeBatch and m_Encoder until it clears this.
+	*/
+	std::atomic<bool> m_bEncoding{ false };
+
+	std::vector<Frame_t> m_EncodeBatch;
+
+	voice::Encoder_t m_Encoder;
+
+private:
+	CVoiceChat( const CVoiceChat& ) = delete;
+	CVoiceChat& operator=( const CVoiceChat& ) = delete;
+};
+
+#endif //ENGINE_SOUND_CVOICECHAT_H
@@ -0,0 +1,128 @@
+#include <algorithm>
+
+#include "VoiceCodec.h"
+
+namespace voice
+{
+namespace
+{
+const int16_t STEP_SIZES[] =
+{
+	7, 8, 9, 10, 11, 12, 13, 14, 16, 17,
+	19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+	50, 55, 60, 66, 73, 80, 88, 97, 107, 118,
+	130, 143, 157, 173, 190, 209, 230, 253, 279, 307,
+	337, 371, 408, 449, 494, 544, 598, 658, 724, 796,
+	876, 963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066,
+	2272, 2499, 2749, 3024, 3327, 3660, 4026, 4428, 4871, 5358,
+	5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487, 12635, 13899,
+	15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+const int MAX_STEP_INDEX = static_cast<int>( sizeof( STEP_SIZES ) / sizeof( STEP_SIZES[ 0 ] ) ) - 1;
+
+const int INDEX_ADJUST[ 8 ] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+/**
+*	Applies a code to the predictor and the step index. Shared by the encoder and decoder, so they track the same prediction.
+*/
+inline void ApplyCode( const uint8_t uiCode, int& iPredictor, int& iStepIndex )
+{
+	const int iStep = STEP_SIZES[ iStepIndex ];
+
+	int iDelta = iStep >> 3;
+
+	if( uiCode & 4 )
+		iDelta += iStep;
+
+	if( uiCode & 2 )
+		iDelta += iStep >> 1;
+
+	if( uiCode & 1 )
+		iDelta += iStep >> 2;
+
+	iPredictor += ( uiCode & 8 ) ? -iDelta : iDelta;
+	iPredictor = std::min( std::max( iPredictor, static_cast<int>( INT16_MIN ) ), static_cast<int>( INT16_MAX ) );
+
+	iStepIndex = std::min( std::max( iStepIndex + INDEX_ADJUST[ uiCode & 7 ], 0 ), MAX_STEP_INDEX );
+}
+}
+
+void EncodeFrame( Encoder_t& encoder, const int16_t* pSamples, uint8_t* pDest )
+{
+	int iPredictor = pSamples[ 0 ];
+	int iStepIndex = std::min( std::max( encoder.iStepIndex, 0 ), MAX_STEP_INDEX );
+
+	pDest[ 0 ] = static_cast<uint8_t>( static_cast<uint16_t>( iPredictor ) & 0xFF );
+	pDest[ 1 ] = static_cast<uint8_t>( static_cast<uint16_t>( iPredictor ) >> 8 );
+	pDest[ 2 ] = static_cast<uint8_t>( iStepIndex );
+	pDest[ 3 ] = 0;
+
+	uint8_t* pCodes = pDest + 4;
+
+	std::fill_n( pCodes, FRAME_SAMPLES / 2, 0 );
+
+	for( size_t uiIndex = 1; uiIndex < FRAME_SAMPLES; ++uiIndex )
+	{
+		int iDifference = pSamples[ uiIndex ] - iPredictor;
+
+		uint8_t uiCode = 0;
+
+		if( iDifference < 0 )
+		{
+			uiCode = 8;
+			iDifference = -iDifference;
+		}
+
+		const int iStep = STEP_SIZES[ iStepIndex ];
+
+		if( iDifference >= iStep )
+		{
+			uiCode |= 4;
+			iDifference -= iStep;
+		}
+
+		if( iDifference >= iStep >> 1 )
+		{
+			uiCode |= 2;
+			iDifference -= iStep >> 1;
+		}
+
+		if( iDifference >= iStep >> 2 )
+			uiCode |= 1;
+
+		ApplyCode( uiCode, iPredictor, iStepIndex );
+
+		//Low nibble first.
+		const size_t uiNibble = uiIndex - 1;
+
+		pCodes[ uiNibble / 2 ] |= uiCode << ( ( uiNibble % 2 ) * 4 );
+	}
+
+	encoder.iStepIndex = iStepIndex;
+}
+
+bool DecodeFrame( const uint8_t* pData, const size_t uiSize, int16_t* pSamples )
+{
+	if( uiSize != ENCODED_FRAME_SIZE || pData[ 2 ] > MAX_STEP_INDEX )
+		return false;
+
+	int iPredictor = static_cast<int16_t>( pData[ 0 ] | ( pData[ 1 ] << 8 ) );
+	int iStepIndex = pData[ 2 ];
+
+	const uint8_t* pCodes = pData + 4;
+
+	pSamples[ 0 ] = static_cast<int16_t>( iPredictor );
+
+	for( size_t uiIndex = 1; uiIndex < FRAME_SAMPLES; ++uiIndex )
+	{
+		const size_t uiNibble = uiIndex - 1;
+
+		ApplyCode( ( pCodes[ uiNibble / 2 ] >> ( ( uiNibble % 2 ) * 4 ) ) & 0xF, iPredictor, iStepIndex );
+
+		pSamples[ uiIndex ] = static_cast<int16_t>( iPredictor );
+	}
+
+	return true;
+}
+}
@@ -0,0 +1,51 @@
+#ifndef ENGINE_SOUND_VOICECODEC_H
+#define ENGINE_SOUND_VOICECODEC_H
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+*	@file
+*	Voice codec: 16 kHz mono IMA ADPCM, in frames of 20 milliseconds.
+*	Each frame starts with its first sample and the step index the rest are coded with, so frames decode on their own,
+*	and a lost packet only loses its own frame. The other samples take 4 bits each.
+*/
+
+namespace voice
+{
+const uint32_t SAMPLE_RATE = 16000;
+
+/**
+*	Samples in a frame.
+*/
+const size_t FRAME_SAMPLES = 320;
+
+/**
+*	Size of an encoded frame: the first sample, the step index and a reserved byte, then a nibble per remaining sample.
+*/
+const size_t ENCODED_FRAME_SIZE = 4 + FRAME_SAMPLES / 2;
+
+/**
+*	State carried from one frame to the next, so the step size doesn't have to adapt again at the start of every frame.
+*/
+struct Encoder_t
+{
+	int iStepIndex = 0;
+};
+
+/**
+*	Encodes a frame.
+*	@param pSamples FRAME_SAMPLES samples.
+*	@param pDest ENCODED_FRAME_SIZE bytes.
+*/
+void EncodeFrame( Encoder_t& encoder, const int16_t* pSamples, uint8_t* pDest );
+
+/**
+*	Decodes a frame. Malformed frames are detected; it never reads or writes out of bounds.
+*	@param pSamples Receives FRAME_SAMPLES samples.
+*	@return Whether the frame was valid. If not, pSamples is left as it was.
+*/
+bool DecodeFrame( const uint8_t* pData, const size_t uiSize, int16_t* pSamples );
+}
+
+#endif //ENGINE_SOUND_VOICECODEC_H
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "XXHash.h"
+
+#include "CAccessAudit.h"
+
+const size_t CAccessAudit::RECORD_CAPACITY;
+const size_t CAccessAudit::NAME_CAPACITY;
+
+namespace
+{
+std::atomic<uint64_t> g_uiNextInstance{ 1 };
+
+/**
+*	Ring of the audit the calling thread last recorded into. Only trusted if the instance matches.
+*/
+thread_local uint64_t t_uiInstance = 0;
+thread_local void* t_pRing = nullptr;
+}
+
+CAccessAudit::CAccessAudit()
+	: m_uiInstance( g_uiNextInstance.fetch_add( 1, std::memory_order_relaxed ) )
+{
+}
+
+CAccessAudit::~CAccessAudit()
+{
+}
+
+void CAccessAudit::Record( const char* pszFileName, const uint64_t uiBytes, const uint64_t uiTime )
+{
+	auto& ring = GetThreadRing();
+
+	const size_t uiLength = strlen( pszFileName );
+
+	const uint64_t uiFileID = xxhash::Hash64( pszFileName, uiLength );
+
+	if( ring.announced.find( uiFileID ) == ring.announced.end() )
+	{
+		//Without its name the access can't be reported, so drop it and send the name next time.
+		if( !ring.names.TryPush( Name_t{ uiFileID, std::string( pszFileName, uiLength ) } ) )
+		{
+			m_uiDropped.fetch_add( 1, std::memory_order_relaxed );
+			return;
+		}
+
+		ring.announced.insert( uiFileID );
+	}
+
+	const auto uiClampedTime = static_cast<uint32_t>( std::min<uint64_t>( uiTime, std::numeric_limits<uint32_t>::max() ) );
+
+	if( !ring.records.TryPush( Record_t{ uiFileID, uiBytes, uiClampedTime } ) )
+	{
+		m_uiDropped.fetch_add( 1, std::memory_order_relaxed );
+		return;
+	}
+
+	if( ring.records.GetSize() >= RECORD_CAPACITY / 2 )
+	{
+		std::unique_lock<std::mutex> lock( m_Mutex, std::try_to_lock );
+
+		if( lock.owns_lock() )
+			Drain();
+	}
+}
+
+size_t CAccessAudit::GetSummary( FileSystemAccessStats_t* pFiles, size_t uiMaxCount )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	Drain();
+
+	if( pFiles && uiMaxCount > 0 )
+	{
+		std::vector<std::pair<uint64_t, const Totals_t*>> files;
+
+		files.reserve( m_Files.size() );
+
+		for( const auto& file : m_Files )
+		{
+			files.emplace_back( file.first, &file.second );
+		}
+
+		const auto uiCount = std::min( uiMaxCount, files.size() );
+
+		//Hottest first.
+		std::partial_sort( files.begin(), files.begin() + uiCount, files.end(), []( const std::pair<uint64_t, const Totals_t*>& lhs, const std::pair<uint64_t, const Totals_t*>& rhs )
+		{
+			if( lhs.second->uiAccesses != rhs.second->uiAccesses )
+				return lhs.second->uiAccesses > rhs.second->uiAccesses;
+
+			return lhs.second->uiBytes > rhs.second->uiBytes;
+		} );
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			const auto& totals = *files[ uiIndex ].second;
+			auto& stats = pFiles[ uiIndex ];
+
+			auto it = m_Names.find( files[ uiIndex ].first );
+
+			strncpy( stats.szFileName, it != m_Names.end() ? it->second.c_str() : "", sizeof( stats.szFileName ) );
+			stats.szFileName[ sizeof( stats.szFileName ) - 1 ] = '\0';
+
+			stats.uiAccesses = totals.uiAccesses;
+			stats.uiBytesRead = totals.uiBytes;
+			stats.uiTime = totals.uiTime;
+		}
+	}
+
+	return m_Files.size();
+}
+
+void CAccessAudit::Reset()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	Drain();
+
+	//Names are kept, since threads don't send them again.
+	m_Files.clear();
+
+	m_uiDropped.store( 0, std::memory_order_relaxed );
+}
+
+CAccessAudit::ThreadRing_t& CAccessAudit::GetThreadRing()
+{
+	if( t_uiInstance == m_uiInstance )
+		return *static_cast<ThreadRing_t*>( t_pRing );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Rings.emplace_back( new ThreadRing_t );
+
+	t_uiInstance = m_uiInstance;
+	t_pRing = m_Rings.back().get();
+
+	return *m_Rings.back();
+}
+
+void CAccessAudit::Drain()
+{
+	for( auto& ring : m_Rings )
+	{
+		//Names first, so records pushed after their name always find it.
+		Name_t name;
+
+		while( ring->names.TryPop( name ) )
+		{
+			m_Names.emplace( name.uiFileID, std::move( name.szFileName ) );
+		}
+
+		Record_t record;
+
+		while( ring->records.TryPop( record ) )
+		{
+			auto& totals = m_Files[ record.uiFileID ];
+
+			++totals.uiAccesses;
+			totals.uiBytes += record.uiBytes;
+			totals.uiTime += record.uiTime;
+		}
+	}
+}
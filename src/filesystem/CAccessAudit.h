@@ -0,0 +1,145 @@
+#ifndef FILESYSTEM_CACCESSAUDIT_H
+#define FILESYSTEM_CACCESSAUDIT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "CAlignedNew.h"
+#include "CSPSCQueue.h"
+
+#include "FileSystem2.h"
+
+/**
+*	Records which files are accessed, how often and how much is read from them, cheaply enough to leave on in production.
+*	Each thread records into its own lock-free ring, so recording never locks or formats anything. Files are identified by a hash of their name;
+*	a thread sends a file's name once, through a second ring, the first time it records the file.
+*	Rings are drained into per file totals when the summary is requested, and by a recording thread when its ring fills up halfway, if no other thread is draining.
+*	If a ring is full, the access is dropped and counted instead.
+*	@see FileSystemOption::AUDIT_ACCESSES
+*/
+class CAccessAudit
+{
+public:
+	/**
+	*	Number of accesses each thread's ring holds.
+	*/
+	static const size_t RECORD_CAPACITY = 4096;
+
+	/**
+	*	Number of file names each thread's ring holds.
+	*/
+	static const size_t NAME_CAPACITY = 256;
+
+public:
+	CAccessAudit();
+	~CAccessAudit();
+
+	/**
+	*	Records an access to a file. Can be called from any thread.
+	*	@param uiBytes Number of bytes read.
+	*	@param uiTime Time spent opening and reading the file, in microseconds.
+	*/
+	void Record( const char* pszFileName, const uint64_t uiBytes, const uint64_t uiTime );
+
+	/**
+	*	@return Number of accesses that were dropped because a ring was full.
+	*/
+	uint64_t GetDropped() const { return m_uiDropped.load( std::memory_order_relaxed ); }
+
+	/**
+	*	@see IFileSystem2::GetAccessAudit
+	*/
+	size_t GetSummary( FileSystemAccessStats_t* pFiles, size_t uiMaxCount );
+
+	/**
+	*	Discards all recorded accesses.
+	*/
+	void Reset();
+
+private:
+	struct Record_t
+	{
+		uint64_t uiFileID;
+		uint64_t uiBytes;
+		uint32_t uiTime;
+	};
+
+	struct Name_t
+	{
+		uint64_t uiFileID;
+		std::string szFileName;
+	};
+
+	/**
+	*	Rings of one thread. The thread is the only producer; whoever holds m_Mutex is the consumer.
+	*	Heap allocated, so it needs CAlignedNew for the queues' cache line alignment.
+	*/
+	struct ThreadRing_t : public CAlignedNew<ThreadRing_t>
+	{
+		ThreadRing_t()
+			: records( RECORD_CAPACITY )
+			, names( NAME_CAPACITY )
+		{
+		}
+
+		CSPSCQueue<Record_t> records;
+		CSPSCQueue<Name_t> names;
+
+		/**
+		*	Files whose names the thread has sent. Only used by the thread.
+		*/
+		std::unordered_set<uint64_t> announced;
+	};
+
+	struct Totals_t
+	{
+		uint64_t uiAccesses = 0;
+		uint64_t uiBytes = 0;
+		uint64_t uiTime = 0;
+	};
+
+private:
+	/**
+	*	@return The calling thread's rings, created on first use.
+	*/
+	ThreadRing_t& GetThreadRing();
+
+	/**
+	*	Moves everything in the rings into the totals. m_Mutex must be held.
+	*/
+	void Drain();
+
+private:
+	/**
+	*	Identifies this audit to the threads that cache their ring, in case another audit is later created at the same address.
+	*/
+	const uint64_t m_uiInstance;
+
+	std::atomic<uint64_t> m_uiDropped{ 0 };
+
+	/**
+	*	Guards the list of rings and the totals, and makes its holder the consumer of every ring.
+	*/
+	std::mutex m_Mutex;
+
+	/**
+	*	Rings of every thread that recorded an access. Kept after the thread exits so its accesses are still counted.
+	*/
+	std::vector<std::unique_ptr<ThreadRing_t>> m_Rings;
+
+	std::unordered_map<uint64_t, std::string> m_Names;
+	std::unordered_map<uint64_t, Totals_t> m_Files;
+
+private:
+	CAccessAudit( const CAccessAudit& ) = delete;
+	CAccessAudit& operator=( const CAccessAudit& ) = delete;
+};
+
+#endif //FILESYSTEM_CACCESSAUDIT_H
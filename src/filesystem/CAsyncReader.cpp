@@ -0,0 +1,333 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Platform.h"
+
+#include "CBlockCache.h"
+#include "CFileHandle.h"
+#include "CStreamingPack.h"
+
+#include "CAsyncReader.h"
+
+CAsyncReader::~CAsyncReader()
+{
+	Shutdown();
+}
+
+FileAsyncHandle_t CAsyncReader::Submit( Source_t&& source, const FileAsyncRequest_t& request )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_Threads.empty() )
+	{
+		m_bShutdown = false;
+
+		for( size_t uiIndex = 0; uiIndex < DEFAULT_THREAD_COUNT; ++uiIndex )
+		{
+			m_Threads.emplace_back( &CAsyncReader::WorkerThread, this );
+		}
+	}
+
+	auto handle = m_NextHandle++;
+
+	if( m_NextHandle == FILESYSTEM_INVALID_ASYNC_HANDLE )
+		++m_NextHandle;
+
+	m_States[ handle ] = State_t();
+
+	m_Queue.push_back( { handle, std::move( source ), request } );
+
+	m_WorkAvailable.notify_one();
+
+	return handle;
+}
+
+FileAsyncStatus CAsyncReader::GetStatus( FileAsyncHandle_t handle, uint64_t* puiBytesRead )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_States.find( handle );
+
+	if( it == m_States.end() )
+		return FileAsyncStatus::FAILED;
+
+	if( puiBytesRead )
+		*puiBytesRead = it->second.uiBytesRead;
+
+	return it->second.status;
+}
+
+FileAsyncStatus CAsyncReader::Wait( FileAsyncHandle_t handle, uint64_t* puiBytesRead )
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	//Looked up again after every wakeup: Submit can rehash the map while the lock is released, and Release can remove the handle.
+	auto it = m_States.find( handle );
+
+	while( it != m_States.end() && it->second.status == FileAsyncStatus::PENDING )
+	{
+		m_WorkFinished.wait( lock );
+
+		it = m_States.find( handle );
+	}
+
+	if( it == m_States.end() )
+		return FileAsyncStatus::FAILED;
+
+	if( puiBytesRead )
+		*puiBytesRead = it->second.uiBytesRead;
+
+	return it->second.status;
+}
+
+bool CAsyncReader::Cancel( FileAsyncHandle_t handle )
+{
+	FileAsyncRequest_t request;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		auto it = std::find_if( m_Queue.begin(), m_Queue.end(), [ = ]( const Job_t& job )
+		{
+			return job.handle == handle;
+		} );
+
+		if( it == m_Queue.end() )
+			return false;
+
+		request = it->request;
+
+		m_Queue.erase( it );
+
+		Finish( handle, FileAsyncStatus::CANCELED, 0 );
+	}
+
+	if( request.pCallback )
+		request.pCallback( request, FileAsyncStatus::CANCELED, 0 );
+
+	return true;
+}
+
+void CAsyncReader::Release( FileAsyncHandle_t handle )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_States.find( handle );
+
+	if( it == m_States.end() )
+		return;
+
+	//Pending reads clean up after themselves.
+	if( it->second.status == FileAsyncStatus::PENDING )
+		it->second.bReleased = true;
+	else
+		m_States.erase( it );
+}
+
+void CAsyncReader::Shutdown()
+{
+	std::deque<Job_t> canceled;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bShutdown = true;
+
+		canceled.swap( m_Queue );
+
+		for( const auto& job : canceled )
+		{
+			Finish( job.handle, FileAsyncStatus::CANCELED, 0 );
+		}
+	}
+
+	m_WorkAvailable.notify_all();
+
+	for( auto& thread : m_Threads )
+	{
+		thread.join();
+	}
+
+	m_Threads.clear();
+
+	for( const auto& job : canceled )
+	{
+		if( job.request.pCallback )
+			job.request.pCallback( job.request, FileAsyncStatus::CANCELED, 0 );
+	}
+}
+
+void CAsyncReader::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( true )
+	{
+		m_WorkAvailable.wait( lock, [ this ]()
+		{
+			return m_bShutdown || !m_Queue.empty();
+		} );
+
+		if( m_bShutdown )
+			break;
+
+		auto job = std::move( m_Queue.front() );
+
+		m_Queue.pop_front();
+
+		lock.unlock();
+
+		uint64_t uiBytesRead = 0;
+
+		const auto status = Execute( job, uiBytesRead ) ? FileAsyncStatus::COMPLETE : FileAsyncStatus::FAILED;
+
+		//Call back before the status changes so waiting threads see the callback's side effects.
+		if( job.request.pCallback )
+			job.request.pCallback( job.request, status, uiBytesRead );
+
+		lock.lock();
+
+		Finish( job.handle, status, uiBytesRead );
+	}
+}
+
+bool CAsyncReader::Execute( const Job_t& job, uint64_t& uiBytesRead )
+{
+	auto& source = job.source;
+	auto& request = job.request;
+
+	uiBytesRead = 0;
+
+	if( !request.pBuffer )
+		return false;
+
+	FILE* pFile;
+	uint64_t uiSourceLength;
+
+	if( !OpenSource( source, pFile, uiSourceLength ) )
+		return false;
+
+	bool bSuccess = request.uiOffset <= uiSourceLength;
+
+	if( bSuccess )
+	{
+		uint64_t uiLength = uiSourceLength - request.uiOffset;
+
+		if( request.uiLength != 0 )
+			uiLength = std::min( uiLength, request.uiLength );
+
+		bSuccess = ReadSource( source, pFile, uiSourceLength, request.pBuffer, request.uiOffset, uiLength, uiBytesRead );
+	}
+
+	if( pFile && pFile != source.pFile )
+		fclose( pFile );
+
+	return bSuccess;
+}
+
+void* CAsyncReader::ReadAll( const Source_t& source, FileAllocateFunc_t pfnAllocate, void* pContext, uint64_t& uiBytesRead )
+{
+	uiBytesRead = 0;
+
+	if( !pfnAllocate )
+		return nullptr;
+
+	FILE* pFile;
+	uint64_t uiSourceLength;
+
+	if( !OpenSource( source, pFile, uiSourceLength ) )
+		return nullptr;
+
+	void* pBuffer = pfnAllocate( uiSourceLength, pContext );
+
+	if( pBuffer && !ReadSource( source, pFile, uiSourceLength, pBuffer, 0, uiSourceLength, uiBytesRead ) )
+		pBuffer = nullptr;
+
+	if( pFile && pFile != source.pFile )
+		fclose( pFile );
+
+	return pBuffer;
+}
+
+bool CAsyncReader::OpenSource( const Source_t& source, FILE*& pFile, uint64_t& uiLength )
+{
+	pFile = source.pFile;
+
+	uiLength = source.uiLength;
+
+	if( source.streaming && !source.streaming->Fetch( source.uiStartOffset, source.codec != pack::Codec::NONE ? source.uiStoredLength : source.uiLength ) )
+		return false;
+
+	if( !source.pData && !pFile )
+	{
+		pFile = fopen64( source.szFileName.c_str(), "rb" );
+
+		if( !pFile )
+			return false;
+
+		if( uiLength == UNKNOWN_LENGTH )
+		{
+			fseek64( pFile, 0, SEEK_END );
+			uiLength = static_cast<uint64_t>( ftell64( pFile ) );
+		}
+	}
+
+	return true;
+}
+
+bool CAsyncReader::ReadSource( const Source_t& source, FILE* pFile, const uint64_t uiSourceLength, 
+							   void* pBuffer, const uint64_t uiOffset, const uint64_t uiLength, uint64_t& uiBytesRead )
+{
+	uiBytesRead = 0;
+
+	if( uiLength > std::numeric_limits<size_t>::max() )
+		return false;
+
+	if( source.codec != pack::Codec::NONE )
+	{
+		CCompressedEntry entry;
+
+		entry.SetBlockCache( pFile == source.pFile ? source.pBlockCache : nullptr );
+
+		if( !entry.Open( pFile, source.pData, source.uiStartOffset, source.uiStoredLength, uiSourceLength, source.codec, source.uiBlockSize ) )
+			return false;
+
+		uiBytesRead = entry.Read( pBuffer, static_cast<size_t>( uiLength ), uiOffset );
+
+		return uiBytesRead == uiLength;
+	}
+
+	if( source.pData )
+	{
+		memcpy( pBuffer, source.pData + source.uiStartOffset + uiOffset, static_cast<size_t>( uiLength ) );
+
+		uiBytesRead = uiLength;
+
+		return true;
+	}
+
+	//Loose files are opened for the read, only pack files go through the block cache.
+	uiBytesRead = CBlockCache::Read( pFile == source.pFile ? source.pBlockCache : nullptr, pFile, pBuffer, static_cast<size_t>( uiLength ), source.uiStartOffset + uiOffset );
+
+	return uiBytesRead == uiLength;
+}
+
+void CAsyncReader::Finish( FileAsyncHandle_t handle, FileAsyncStatus status, uint64_t uiBytesRead )
+{
+	auto it = m_States.find( handle );
+
+	if( it != m_States.end() )
+	{
+		if( it->second.bReleased )
+		{
+			m_States.erase( it );
+		}
+		else
+		{
+			it->second.status = status;
+			it->second.uiBytesRead = uiBytesRead;
+		}
+	}
+
+	m_WorkFinished.notify_all();
+}
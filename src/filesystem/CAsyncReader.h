@@ -0,0 +1,207 @@
+#ifndef FILESYSTEM_CASYNCREADER_H
+#define FILESYSTEM_CASYNCREADER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "FileSystem2.h"
+
+#include "PackFile.h"
+
+#include "CContentCache.h"
+
+class CBlockCache;
+class CSearchPathSnapshot;
+class CStreamingPack;
+
+/**
+*	Services asynchronous reads on a pool of I/O worker threads.
+*	Files are located by the filesystem when a read is submitted, so workers only perform positional reads and never touch filesystem state.
+*/
+class CAsyncReader
+{
+public:
+	/**
+	*	Number of worker threads started on first use.
+	*/
+	static const size_t DEFAULT_THREAD_COUNT = 2;
+
+	/**
+	*	Used as the source length when it isn't known until the file is opened.
+	*/
+	static const uint64_t UNKNOWN_LENGTH = std::numeric_limits<uint64_t>::max();
+
+	/**
+	*	Where to read the data from. Exactly one of pData, pFile and szFileName is used, in that order.
+	*/
+	struct Source_t
+	{
+		/**
+		*	Memory mapped data, or the contents of a memory file.
+		*/
+		const uint8_t* pData = nullptr;
+
+		/**
+		*	If the data is a memory file's contents, keeps them alive until the read is done.
+		*/
+		CContentCache::BufferPtr_t contents;
+
+		/**
+		*	If the file was found through a search path snapshot, keeps the search paths it references alive until the read is done.
+		*/
+		std::shared_ptr<const CSearchPathSnapshot> snapshot;
+
+		/**
+		*	Shared file that is read with positional reads.
+		*/
+		FILE* pFile = nullptr;
+
+		/**
+		*	If reads from pFile go through the block cache, the cache.
+		*/
+		CBlockCache* pBlockCache = nullptr;
+
+		/**
+		*	Full path of a file to open on the worker thread.
+		*/
+		std::string szFileName;
+
+		/**
+		*	Offset of the file's data in the source.
+		*/
+		uint64_t uiStartOffset = 0;
+
+		/**
+		*	Uncompressed length of the file.
+		*/
+		uint64_t uiLength = UNKNOWN_LENGTH;
+
+		/**
+		*	If the file is a compressed pack file entry, how it is stored. Compressed data is always read from pData or pFile.
+		*/
+		pack::Codec codec = pack::Codec::NONE;
+		uint64_t uiStoredLength = 0;
+		uint32_t uiBlockSize = 0;
+
+		/**
+		*	If the file is in a pack file that is installed while it's in use, the pack. The data is fetched before it's read.
+		*/
+		std::shared_ptr<CStreamingPack> streaming;
+	};
+
+public:
+	CAsyncReader() = default;
+	~CAsyncReader();
+
+	/**
+	*	Queues a read. Starts the worker threads if needed.
+	*	@return Handle to the read.
+	*/
+	FileAsyncHandle_t Submit( Source_t&& source, const FileAsyncRequest_t& request );
+
+	FileAsyncStatus GetStatus( FileAsyncHandle_t handle, uint64_t* puiBytesRead );
+
+	/**
+	*	Blocks until a read has finished.
+	*	@return Status of the read, or FAILED if the handle doesn't exist or is released while waiting.
+	*/
+	FileAsyncStatus Wait( FileAsyncHandle_t handle, uint64_t* puiBytesRead );
+
+	bool Cancel( FileAsyncHandle_t handle );
+
+	void Release( FileAsyncHandle_t handle );
+
+	/**
+	*	Cancels all queued reads and stops the worker threads. Reads in progress are finished first.
+	*	The workers are restarted if another read is submitted.
+	*/
+	void Shutdown();
+
+	/**
+	*	Reads all of a source on the calling thread.
+	*	@param source Source to read.
+	*	@param pfnAllocate Called once the source's length is known to get the buffer to read into.
+	*	@param pContext Passed to pfnAllocate.
+	*	@param[ out ] uiBytesRead Number of bytes that were read.
+	*	@return The buffer returned by pfnAllocate, or null if the source couldn't be read or the allocation was canceled.
+	*		The buffer is still owned by the caller if reading failed after allocating.
+	*/
+	static void* ReadAll( const Source_t& source, FileAllocateFunc_t pfnAllocate, void* pContext, uint64_t& uiBytesRead );
+
+private:
+	struct Job_t
+	{
+		FileAsyncHandle_t handle;
+		Source_t source;
+		FileAsyncRequest_t request;
+	};
+
+	struct State_t
+	{
+		FileAsyncStatus status = FileAsyncStatus::PENDING;
+		uint64_t uiBytesRead = 0;
+		bool bReleased = false;
+	};
+
+	void WorkerThread();
+
+	/**
+	*	Performs the read.
+	*	@return Whether the read succeeded.
+	*/
+	static bool Execute( const Job_t& job, uint64_t& uiBytesRead );
+
+	/**
+	*	Opens a source if it has to be opened by name, and determines its length.
+	*	@param[ out ] pFile File to read from. If it isn't the source's own file, it must be closed by the caller.
+	*	@param[ out ] uiLength Length of the source.
+	*	@return Whether the source can be read.
+	*/
+	static bool OpenSource( const Source_t& source, FILE*& pFile, uint64_t& uiLength );
+
+	/**
+	*	Reads from an opened source.
+	*	@param pFile File returned by OpenSource.
+	*	@param uiSourceLength Length returned by OpenSource.
+	*	@return Whether all of the requested data was read.
+	*/
+	static bool ReadSource( const Source_t& source, FILE* pFile, const uint64_t uiSourceLength, 
+							void* pBuffer, const uint64_t uiOffset, const uint64_t uiLength, uint64_t& uiBytesRead );
+
+	/**
+	*	Records the result of a read. Must be called with the mutex held.
+	*/
+	void Finish( FileAsyncHandle_t handle, FileAsyncStatus status, uint64_t uiBytesRead );
+
+private:
+	std::mutex m_Mutex;
+
+	std::condition_variable m_WorkAvailable;
+	std::condition_variable m_WorkFinished;
+
+	std::deque<Job_t> m_Queue;
+
+	std::unordered_map<FileAsyncHandle_t, State_t> m_States;
+
+	std::vector<std::thread> m_Threads;
+
+	bool m_bShutdown = false;
+
+	FileAsyncHandle_t m_NextHandle = FILESYSTEM_INVALID_ASYNC_HANDLE + 1;
+
+private:
+	CAsyncReader( const CAsyncReader& ) = delete;
+	CAsyncReader& operator=( const CAsyncReader& ) = delete;
+};
+
+#endif //FILESYSTEM_CASYNCREADER_H
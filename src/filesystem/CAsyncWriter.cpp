@@ -0,0 +1,153 @@
+#include <cassert>
+
+#include "CAsyncWriter.h"
+
+const size_t CAsyncWriter::MAX_PENDING_SIZE;
+
+CAsyncWriter::~CAsyncWriter()
+{
+	Shutdown();
+}
+
+void CAsyncWriter::Write( FILE* pFile, const void* pData, const size_t uiSize )
+{
+	assert( pFile );
+
+	if( !pData || uiSize == 0 )
+		return;
+
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	if( !m_Thread.joinable() )
+	{
+		m_bShutdown = false;
+
+		m_Thread = std::thread( &CAsyncWriter::WorkerThread, this );
+	}
+
+	auto& stream = m_Streams[ pFile ];
+
+	if( !stream )
+	{
+		stream = std::make_unique<Stream_t>();
+
+		stream->pFile = pFile;
+	}
+
+	//Data that is still pending will be written, so wait for it instead of growing without bounds.
+	m_WorkFinished.wait( lock, [ &stream, uiSize ]()
+	{
+		return stream->pending.empty() || stream->pending.size() + uiSize <= MAX_PENDING_SIZE;
+	} );
+
+	auto pBytes = reinterpret_cast<const uint8_t*>( pData );
+
+	stream->pending.insert( stream->pending.end(), pBytes, pBytes + uiSize );
+
+	//Streams that are being written are queued again by the worker once it's done.
+	if( stream->IsIdle() )
+	{
+		stream->bQueued = true;
+
+		m_Queue.push_back( stream.get() );
+
+		m_WorkAvailable.notify_one();
+	}
+}
+
+void CAsyncWriter::Flush( FILE* pFile )
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	auto it = m_Streams.find( pFile );
+
+	if( it != m_Streams.end() )
+		WaitForStream( lock, *it->second );
+}
+
+void CAsyncWriter::Remove( FILE* pFile )
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	auto it = m_Streams.find( pFile );
+
+	if( it == m_Streams.end() )
+		return;
+
+	WaitForStream( lock, *it->second );
+
+	m_Streams.erase( it );
+}
+
+void CAsyncWriter::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bShutdown = true;
+	}
+
+	m_WorkAvailable.notify_all();
+
+	//The worker writes everything that is queued before it stops.
+	if( m_Thread.joinable() )
+		m_Thread.join();
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Streams.clear();
+}
+
+void CAsyncWriter::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( true )
+	{
+		m_WorkAvailable.wait( lock, [ this ]()
+		{
+			return m_bShutdown || !m_Queue.empty();
+		} );
+
+		if( m_Queue.empty() )
+			break;
+
+		auto& stream = *m_Queue.front();
+
+		m_Queue.pop_front();
+
+		stream.bQueued = false;
+		stream.bWriting = true;
+
+		stream.writing.swap( stream.pending );
+
+		lock.unlock();
+
+		//Errors are left on the file, so callers see them once the stream is flushed.
+		fwrite( stream.writing.data(), 1, stream.writing.size(), stream.pFile );
+		fflush( stream.pFile );
+
+		stream.writing.clear();
+
+		lock.lock();
+
+		stream.bWriting = false;
+
+		if( !stream.pending.empty() )
+		{
+			stream.bQueued = true;
+
+			m_Queue.push_back( &stream );
+		}
+
+		m_WorkFinished.notify_all();
+	}
+}
+
+void CAsyncWriter::WaitForStream( std::unique_lock<std::mutex>& lock, const Stream_t& stream )
+{
+	m_WorkFinished.wait( lock, [ &stream ]()
+	{
+		return stream.IsIdle();
+	} );
+}
@@ -0,0 +1,113 @@
+#ifndef FILESYSTEM_CASYNCWRITER_H
+#define FILESYSTEM_CASYNCWRITER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/**
+*	Buffers writes to files in memory and writes them out on a background thread, so callers never block on the disk.
+*	Each file's data is written in the order it was submitted. Files are only touched by the worker while they have data pending,
+*	so callers must wait for a file to be flushed before using it directly.
+*/
+class CAsyncWriter
+{
+public:
+	/**
+	*	Writes block once this much data is pending for a file, until the worker catches up.
+	*/
+	static const size_t MAX_PENDING_SIZE = 1024 * 1024;
+
+public:
+	CAsyncWriter() = default;
+	~CAsyncWriter();
+
+	/**
+	*	Queues data to be written to a file. Starts the worker thread if needed.
+	*/
+	void Write( FILE* pFile, const void* pData, const size_t uiSize );
+
+	/**
+	*	Waits until all data queued for a file has been written to it.
+	*/
+	void Flush( FILE* pFile );
+
+	/**
+	*	Waits until all data queued for a file has been written to it, and forgets the file. Must be called before the file is closed.
+	*/
+	void Remove( FILE* pFile );
+
+	/**
+	*	Writes all queued data and stops the worker thread.
+	*	The worker is restarted if more data is written.
+	*/
+	void Shutdown();
+
+private:
+	struct Stream_t
+	{
+		FILE* pFile;
+
+		/**
+		*	Data that has been queued but not yet picked up by the worker.
+		*/
+		std::vector<uint8_t> pending;
+
+		/**
+		*	Data that the worker is writing. Kept around so its memory can be reused.
+		*/
+		std::vector<uint8_t> writing;
+
+		/**
+		*	Whether the stream is in the queue.
+		*/
+		bool bQueued = false;
+
+		/**
+		*	Whether the worker is writing the stream's data.
+		*/
+		bool bWriting = false;
+
+		/**
+		*	@return Whether all queued data has been written.
+		*/
+		bool IsIdle() const { return !bQueued && !bWriting; }
+	};
+
+	void WorkerThread();
+
+	/**
+	*	Waits until a stream has been written. Must be called with the mutex held.
+	*/
+	void WaitForStream( std::unique_lock<std::mutex>& lock, const Stream_t& stream );
+
+private:
+	std::mutex m_Mutex;
+
+	std::condition_variable m_WorkAvailable;
+	std::condition_variable m_WorkFinished;
+
+	/**
+	*	Streams with pending data, in the order they were queued.
+	*/
+	std::deque<Stream_t*> m_Queue;
+
+	std::unordered_map<FILE*, std::unique_ptr<Stream_t>> m_Streams;
+
+	std::thread m_Thread;
+
+	bool m_bShutdown = false;
+
+private:
+	CAsyncWriter( const CAsyncWriter& ) = delete;
+	CAsyncWriter& operator=( const CAsyncWriter& ) = delete;
+};
+
+#endif //FILESYSTEM_CASYNCWRITER_H
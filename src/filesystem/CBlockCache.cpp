@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <cstring>
+
+#include "CFileHandle.h"
+
+#include "CBlockCache.h"
+
+const size_t CBlockCache::BLOCK_SIZE;
+const size_t CBlockCache::MAX_RUN_BLOCKS;
+const size_t CBlockCache::BYPASS_FRACTION;
+
+void CBlockCache::SetCapacity( const size_t uiBytes, const bool bLargePages )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	size_t uiBlocks = uiBytes / BLOCK_SIZE;
+
+	m_Index.clear();
+
+	m_Slots.clear();
+	m_Slots.shrink_to_fit();
+
+	m_Storage.Free();
+
+	m_bLargePages = bLargePages;
+
+	//Disabled if the memory can't be had.
+	if( uiBlocks > 0 && !m_Storage.Allocate( uiBlocks * BLOCK_SIZE, bLargePages ) )
+		uiBlocks = 0;
+
+	m_Slots.resize( uiBlocks );
+
+	for( size_t uiSlot = 0; uiSlot < uiBlocks; ++uiSlot )
+	{
+		m_Slots[ uiSlot ].pData = m_Storage.GetData() + uiSlot * BLOCK_SIZE;
+	}
+
+	m_uiHand = 0;
+	++m_uiGeneration;
+
+	m_uiCapacityBlocks.store( uiBlocks, std::memory_order_relaxed );
+}
+
+void CBlockCache::SetLargePages( const bool bLargePages )
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( bLargePages == m_bLargePages )
+			return;
+
+		m_bLargePages = bLargePages;
+
+		if( m_Slots.empty() )
+			return;
+	}
+
+	SetCapacity( GetCapacity(), bLargePages );
+}
+
+size_t CBlockCache::Read( CBlockCache* pCache, FILE* pFile, void* pBuffer, size_t uiSize, uint64_t uiOffset )
+{
+	if( pCache )
+		return pCache->Read( pFile, pBuffer, uiSize, uiOffset );
+
+	return CFileHandle::ReadAt( pFile, pBuffer, uiSize, uiOffset );
+}
+
+size_t CBlockCache::Read( FILE* pFile, void* pBuffer, size_t uiSize, uint64_t uiOffset )
+{
+	const size_t uiCapacityBlocks = m_uiCapacityBlocks.load( std::memory_order_relaxed );
+
+	if( !pFile || uiCapacityBlocks == 0 )
+		return CFileHandle::ReadAt( pFile, pBuffer, uiSize, uiOffset );
+
+	if( uiSize > uiCapacityBlocks * BLOCK_SIZE / BYPASS_FRACTION )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			++m_Stats.uiBypasses;
+		}
+
+		return CFileHandle::ReadAt( pFile, pBuffer, uiSize, uiOffset );
+	}
+
+	auto pOutput = reinterpret_cast<uint8_t*>( pBuffer );
+
+	size_t uiRead = 0;
+
+	std::vector<uint8_t> staging;
+
+	while( uiRead < uiSize )
+	{
+		const uint64_t uiPosition = uiOffset + uiRead;
+		const uint64_t uiBlock = uiPosition / BLOCK_SIZE;
+		const size_t uiBlockOffset = static_cast<size_t>( uiPosition % BLOCK_SIZE );
+
+		uint64_t uiRunEnd;
+		uint64_t uiGeneration;
+
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			auto it = m_Index.find( { pFile, uiBlock } );
+
+			if( it != m_Index.end() )
+			{
+				auto& slot = m_Slots[ it->second ];
+
+				slot.bReferenced = true;
+
+				++m_Stats.uiHits;
+
+				if( uiBlockOffset >= slot.uiSize )
+					break;
+
+				const size_t uiCount = std::min( uiSize - uiRead, slot.uiSize - uiBlockOffset );
+
+				memcpy( pOutput + uiRead, slot.pData + uiBlockOffset, uiCount );
+
+				uiRead += uiCount;
+
+				//A partial block is the end of the file.
+				if( slot.uiSize < BLOCK_SIZE )
+					break;
+
+				continue;
+			}
+
+			//Read all consecutive missing blocks that the read needs at once.
+			const uint64_t uiLastBlock = ( uiOffset + uiSize - 1 ) / BLOCK_SIZE;
+
+			uiRunEnd = uiBlock + 1;
+
+			while( uiRunEnd <= uiLastBlock && uiRunEnd - uiBlock < MAX_RUN_BLOCKS && m_Index.find( { pFile, uiRunEnd } ) == m_Index.end() )
+				++uiRunEnd;
+
+			m_Stats.uiMisses += uiRunEnd - uiBlock;
+
+			uiGeneration = m_uiGeneration;
+		}
+
+		const size_t uiRunSize = static_cast<size_t>( uiRunEnd - uiBlock ) * BLOCK_SIZE;
+
+		staging.resize( uiRunSize );
+
+		const size_t uiRunRead = CFileHandle::ReadAt( pFile, staging.data(), uiRunSize, uiBlock * BLOCK_SIZE );
+
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			m_Stats.uiBytesRead += uiRunRead;
+
+			//Blocks read while the cache was cleared may belong to a pack file that was closed since.
+			if( uiGeneration == m_uiGeneration )
+			{
+				for( size_t uiStart = 0; uiStart < uiRunRead; uiStart += BLOCK_SIZE )
+				{
+					Insert( { pFile, uiBlock + uiStart / BLOCK_SIZE }, staging.data() + uiStart, std::min( BLOCK_SIZE, uiRunRead - uiStart ) );
+				}
+			}
+		}
+
+		if( uiRunRead <= uiBlockOffset )
+			break;
+
+		const size_t uiCount = std::min( uiSize - uiRead, uiRunRead - uiBlockOffset );
+
+		memcpy( pOutput + uiRead, staging.data() + uiBlockOffset, uiCount );
+
+		uiRead += uiCount;
+
+		if( uiRunRead < uiRunSize )
+			break;
+	}
+
+	return uiRead;
+}
+
+void CBlockCache::InvalidateAll()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Index.clear();
+
+	for( auto& slot : m_Slots )
+	{
+		slot.bUsed = false;
+		slot.bReferenced = false;
+		slot.uiSize = 0;
+	}
+
+	m_uiHand = 0;
+	++m_uiGeneration;
+}
+
+void CBlockCache::GetStats( Stats_t& stats ) const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	stats = m_Stats;
+
+	stats.uiBlocks = m_Index.size();
+	stats.uiCapacity = m_Slots.size() * BLOCK_SIZE;
+	stats.backing = m_Storage.GetBacking();
+}
+
+void CBlockCache::ResetStats()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Stats = Stats_t();
+}
+
+void CBlockCache::Insert( const Key_t& key, const uint8_t* pData, const size_t uiSize )
+{
+	if( m_Slots.empty() )
+		return;
+
+	//Another thread may have read the same block in the meantime.
+	auto it = m_Index.find( key );
+
+	const size_t uiSlot = it != m_Index.end() ? it->second : FindFreeSlot();
+
+	auto& slot = m_Slots[ uiSlot ];
+
+	memcpy( slot.pData, pData, uiSize );
+
+	slot.key = key;
+	slot.uiSize = uiSize;
+	slot.bUsed = true;
+	slot.bReferenced = true;
+
+	m_Index[ key ] = uiSlot;
+}
+
+size_t CBlockCache::FindFreeSlot()
+{
+	//Every pass clears reference bits, so this finds a slot within two passes.
+	while( true )
+	{
+		const size_t uiSlot = m_uiHand;
+
+		m_uiHand = ( m_uiHand + 1 ) % m_Slots.size();
+
+		auto& slot = m_Slots[ uiSlot ];
+
+		if( !slot.bUsed )
+			return uiSlot;
+
+		if( slot.bReferenced )
+		{
+			slot.bReferenced = false;
+			continue;
+		}
+
+		m_Index.erase( slot.key );
+
+		slot.bUsed = false;
+
+		++m_Stats.uiEvictions;
+
+		return uiSlot;
+	}
+}
@@ -0,0 +1,187 @@
+#ifndef FILESYSTEM_CBLOCKCACHE_H
+#define FILESYSTEM_CBLOCKCACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "CLargePageBuffer.h"
+
+/**
+*	Cache of fixed size blocks of pack files, shared by everything that reads pack files that aren't memory mapped:
+*	pack entry handles, compressed entries, asynchronous and batched loads, and the prefetcher.
+*	Neighbouring entries and repeated reads are served from memory instead of the disk.
+*	Blocks are keyed on the pack file and the block's index in it, and evicted with the CLOCK algorithm.
+*	Reads that are large compared to the capacity bypass the cache, so loading a big file doesn't flush everything else.
+*	All blocks live in one buffer that can be backed by large pages, so a big cache doesn't cost a TLB miss on most hits.
+*	The cache is disabled until a capacity is set. It is synchronized.
+*/
+class CBlockCache final
+{
+public:
+	static const size_t BLOCK_SIZE = 64 * 1024;
+
+	/**
+	*	Most blocks that are read from disk at once when consecutive blocks are missing.
+	*/
+	static const size_t MAX_RUN_BLOCKS = 16;
+
+	/**
+	*	Reads of more than the capacity divided by this bypass the cache.
+	*/
+	static const size_t BYPASS_FRACTION = 4;
+
+	struct Stats_t
+	{
+		uint64_t uiHits = 0;
+		uint64_t uiMisses = 0;
+		uint64_t uiEvictions = 0;
+
+		/**
+		*	Number of reads that were too large to cache.
+		*/
+		uint64_t uiBypasses = 0;
+
+		/**
+		*	Bytes read from disk to fill blocks.
+		*/
+		uint64_t uiBytesRead = 0;
+
+		size_t uiBlocks = 0;
+		size_t uiCapacity = 0;
+
+		PageBacking backing = PageBacking::NORMAL;
+	};
+
+public:
+	CBlockCache() = default;
+
+	/**
+	*	@return Capacity, in bytes. 0 if the cache is disabled.
+	*/
+	size_t GetCapacity() const { return m_uiCapacityBlocks.load( std::memory_order_relaxed ) * BLOCK_SIZE; }
+
+	bool IsEnabled() const { return m_uiCapacityBlocks.load( std::memory_order_relaxed ) > 0; }
+
+	/**
+	*	Sets the capacity, rounded down to whole blocks. All cached blocks are discarded. 0 disables the cache.
+	*	@param bLargePages Whether to back the blocks with large pages. Falls back to regular pages if they can't be had.
+	*/
+	void SetCapacity( const size_t uiBytes, const bool bLargePages = false );
+
+	/**
+	*	Switches the blocks to or from large pages, keeping the capacity. All cached blocks are discarded if it changes anything.
+	*/
+	void SetLargePages( const bool bLargePages );
+
+	/**
+	*	Reads from a pack file through the cache. Reads directly if the cache is disabled.
+	*	@return Number of bytes read.
+	*	@see CFileHandle::ReadAt
+	*/
+	size_t Read( FILE* pFile, void* pBuffer, size_t uiSize, uint64_t uiOffset );
+
+	/**
+	*	Reads from a pack file through the given cache, or directly if there is none.
+	*/
+	static size_t Read( CBlockCache* pCache, FILE* pFile, void* pBuffer, size_t uiSize, uint64_t uiOffset );
+
+	/**
+	*	Discards all blocks. Must be called before pack files are closed, since blocks are keyed on the file.
+	*/
+	void InvalidateAll();
+
+	void GetStats( Stats_t& stats ) const;
+
+	void ResetStats();
+
+private:
+	struct Key_t
+	{
+		FILE* pFile;
+		uint64_t uiBlock;
+
+		bool operator==( const Key_t& other ) const
+		{
+			return pFile == other.pFile && uiBlock == other.uiBlock;
+		}
+	};
+
+	struct KeyHash
+	{
+		size_t operator()( const Key_t& key ) const
+		{
+			return std::hash<const void*>()( key.pFile ) ^ std::hash<uint64_t>()( key.uiBlock * 0x9E3779B97F4A7C15ULL );
+		}
+	};
+
+	struct Slot_t
+	{
+		Key_t key;
+
+		/**
+		*	The slot's block in the storage.
+		*/
+		uint8_t* pData = nullptr;
+
+		/**
+		*	Number of valid bytes. Less than a block at the end of the file.
+		*/
+		size_t uiSize = 0;
+
+		bool bUsed = false;
+
+		/**
+		*	Set when the block is used, cleared when the clock hand passes it.
+		*/
+		bool bReferenced = false;
+	};
+
+private:
+	/**
+	*	Stores a block that was read from disk. Must be called with the mutex held.
+	*/
+	void Insert( const Key_t& key, const uint8_t* pData, const size_t uiSize );
+
+	/**
+	*	Finds a slot to store a block in, evicting one if needed. Must be called with the mutex held.
+	*/
+	size_t FindFreeSlot();
+
+private:
+	mutable std::mutex m_Mutex;
+
+	std::atomic<size_t> m_uiCapacityBlocks{ 0 };
+
+	std::vector<Slot_t> m_Slots;
+
+	/**
+	*	Memory of all blocks. Pages are only backed once blocks are stored in them, unless they're explicit large pages.
+	*/
+	CLargePageBuffer m_Storage;
+
+	bool m_bLargePages = false;
+
+	std::unordered_map<Key_t, size_t, KeyHash> m_Index;
+
+	size_t m_uiHand = 0;
+
+	/**
+	*	Incremented when blocks are discarded, so blocks that were being read at the time aren't stored.
+	*/
+	uint64_t m_uiGeneration = 0;
+
+	Stats_t m_Stats;
+
+private:
+	CBlockCache( const CBlockCache& ) = delete;
+	CBlockCache& operator=( const CBlockCache& ) = delete;
+};
+
+#endif //FILESYSTEM_CBLOCKCACHE_H
@@ -0,0 +1,184 @@
+#include <algorithm>
+#include <cstring>
+
+#include "ByteSwap.h"
+#include "Deflate.h"
+#include "LZ4.h"
+
+#include "CBlockCache.h"
+#include "CFileHandle.h"
+
+#include "CCompressedEntry.h"
+
+bool CCompressedEntry::Open( FILE* pFile, const uint8_t* pData, uint64_t uiStartOffset, uint64_t uiStoredLength, uint64_t uiLength,
+							 pack::Codec codec, uint32_t uiBlockSize )
+{
+	m_Offsets.clear();
+	m_Block.reset();
+	m_uiCachedBlock = INVALID_BLOCK;
+
+	if( !pFile && !pData )
+		return false;
+
+	if( codec == pack::Codec::DEFLATE )
+	{
+		if( uiLength > pack::Zip::MAX_DEFLATE_LENGTH || ( uiLength > 0 && uiStoredLength == 0 ) )
+			return false;
+
+		//The whole entry is a single block.
+		uiBlockSize = static_cast<uint32_t>( std::max<uint64_t>( uiLength, 1 ) );
+	}
+	else if( codec != pack::Codec::LZ4 || uiBlockSize == 0 || uiBlockSize > pack::CompressedPack::MAX_BLOCK_SIZE )
+	{
+		return false;
+	}
+
+	m_pFile = pFile;
+	m_pData = pData;
+	m_uiStartOffset = uiStartOffset;
+	m_uiStoredLength = uiStoredLength;
+	m_uiLength = uiLength;
+	m_Codec = codec;
+	m_uiBlockSize = uiBlockSize;
+
+	if( codec == pack::Codec::DEFLATE )
+	{
+		m_Offsets = { 0, uiStoredLength };
+		return true;
+	}
+
+	const uint64_t uiBlockCount = pack::CompressedPack::GetBlockCount( uiLength, uiBlockSize );
+
+	//The seek table has to fit in the stored data, which also rejects absurd lengths before allocating it.
+	if( uiBlockCount + 1 > uiStoredLength / sizeof( uint64_t ) )
+		return false;
+
+	m_Offsets.resize( static_cast<size_t>( uiBlockCount + 1 ) );
+
+	if( !ReadStored( m_Offsets.data(), m_Offsets.size() * sizeof( uint64_t ), 0 ) )
+	{
+		m_Offsets.clear();
+		return false;
+	}
+
+	LittleArray( m_Offsets.data(), m_Offsets.size() );
+
+	bool bValid = m_Offsets.front() == m_Offsets.size() * sizeof( uint64_t ) && m_Offsets.back() == uiStoredLength;
+
+	for( uint64_t uiBlock = 0; bValid && uiBlock < uiBlockCount; ++uiBlock )
+	{
+		const auto uiBegin = m_Offsets[ uiBlock ];
+		const auto uiEnd = m_Offsets[ uiBlock + 1 ];
+
+		bValid = uiBegin < uiEnd && uiEnd - uiBegin <= GetBlockLength( uiBlock );
+	}
+
+	if( !bValid )
+	{
+		m_Offsets.clear();
+		return false;
+	}
+
+	return true;
+}
+
+size_t CCompressedEntry::Read( void* pBuffer, size_t uiSize, uint64_t uiPosition )
+{
+	if( m_Offsets.empty() || uiPosition >= m_uiLength )
+		return 0;
+
+	uiSize = static_cast<size_t>( std::min<uint64_t>( uiSize, m_uiLength - uiPosition ) );
+
+	auto pOutput = reinterpret_cast<uint8_t*>( pBuffer );
+
+	size_t uiRead = 0;
+
+	while( uiRead < uiSize )
+	{
+		const uint64_t uiBlock = uiPosition / m_uiBlockSize;
+		const size_t uiBlockOffset = static_cast<size_t>( uiPosition % m_uiBlockSize );
+		const size_t uiBlockLength = GetBlockLength( uiBlock );
+
+		const size_t uiCount = std::min( uiSize - uiRead, uiBlockLength - uiBlockOffset );
+
+		if( uiBlock != m_uiCachedBlock && uiBlockOffset == 0 && uiCount == uiBlockLength )
+		{
+			//The whole block is wanted, decompress it straight into the output.
+			if( !DecompressBlock( uiBlock, pOutput + uiRead ) )
+				break;
+		}
+		else
+		{
+			if( uiBlock != m_uiCachedBlock )
+			{
+				if( !m_Block )
+					m_Block = std::make_unique<uint8_t[]>( m_uiBlockSize );
+
+				if( !DecompressBlock( uiBlock, m_Block.get() ) )
+				{
+					m_uiCachedBlock = INVALID_BLOCK;
+					break;
+				}
+
+				m_uiCachedBlock = uiBlock;
+			}
+
+			memcpy( pOutput + uiRead, m_Block.get() + uiBlockOffset, uiCount );
+		}
+
+		uiRead += uiCount;
+		uiPosition += uiCount;
+	}
+
+	return uiRead;
+}
+
+bool CCompressedEntry::ReadStored( void* pBuffer, size_t uiSize, uint64_t uiOffset ) const
+{
+	if( m_pData )
+	{
+		memcpy( pBuffer, m_pData + m_uiStartOffset + uiOffset, uiSize );
+		return true;
+	}
+
+	return CBlockCache::Read( m_pBlockCache, m_pFile, pBuffer, uiSize, m_uiStartOffset + uiOffset ) == uiSize;
+}
+
+bool CCompressedEntry::DecompressBlock( uint64_t uiBlock, uint8_t* pDest )
+{
+	const auto uiOffset = m_Offsets[ uiBlock ];
+	const auto uiStoredSize = static_cast<size_t>( m_Offsets[ uiBlock + 1 ] - uiOffset );
+	const auto uiBlockLength = GetBlockLength( uiBlock );
+
+	//Blocks that didn't compress are stored as is.
+	if( m_Codec == pack::Codec::LZ4 && uiStoredSize == uiBlockLength )
+		return ReadStored( pDest, uiBlockLength, uiOffset );
+
+	const uint8_t* pSource;
+
+	if( m_pData )
+	{
+		pSource = m_pData + m_uiStartOffset + uiOffset;
+	}
+	else
+	{
+		m_StoredBlock.resize( uiStoredSize );
+
+		if( !ReadStored( m_StoredBlock.data(), uiStoredSize, uiOffset ) )
+			return false;
+
+		pSource = m_StoredBlock.data();
+	}
+
+	if( m_Codec == pack::Codec::DEFLATE )
+	{
+		const bool bSuccess = deflate::Decompress( pSource, uiStoredSize, pDest, uiBlockLength );
+
+		//Deflated entries are a single block, so the stored data won't be needed again.
+		std::vector<uint8_t>().swap( m_StoredBlock );
+
+		return bSuccess;
+	}
+
+	return lz4::Decompress( pSource, uiStoredSize, pDest, uiBlockLength );
+}
@@ -0,0 +1,121 @@
+#ifndef FILESYSTEM_CCOMPRESSEDENTRY_H
+#define FILESYSTEM_CCOMPRESSEDENTRY_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <memory>
+#include <vector>
+
+#include "PackFile.h"
+
+class CBlockCache;
+
+/**
+*	Reads the contents of a compressed pack file entry.
+*	Only the blocks that overlap a read are decompressed. The last decompressed block is kept
+*	so small sequential reads don't decompress the same block more than once.
+*	Deflated entries can't be split up, so they're treated as a single block as large as the entry.
+*	@see pack::CompressedPack
+*/
+class CCompressedEntry final
+{
+public:
+	CCompressedEntry() = default;
+
+	/**
+	*	Opens an entry and loads its seek table.
+	*	@param pFile Pack file to read from if pData is null.
+	*	@param pData If the pack file is memory mapped, the start of the mapping. Otherwise, null.
+	*	@param uiStartOffset Offset of the entry's data in the pack file.
+	*	@param uiStoredLength Length of the entry's data in the pack file.
+	*	@param uiLength Uncompressed length of the entry.
+	*	@param codec Codec the entry is stored with.
+	*	@param uiBlockSize Uncompressed size of the entry's blocks. Ignored for deflated entries.
+	*	@return Whether the entry is valid.
+	*/
+	bool Open( FILE* pFile, const uint8_t* pData, uint64_t uiStartOffset, uint64_t uiStoredLength, uint64_t uiLength,
+			   pack::Codec codec, uint32_t uiBlockSize );
+
+	inline FILE* GetFile() const { return m_pFile; }
+
+	inline const uint8_t* GetData() const { return m_pData; }
+
+	inline uint64_t GetStartOffset() const { return m_uiStartOffset; }
+
+	inline uint64_t GetStoredLength() const { return m_uiStoredLength; }
+
+	inline uint64_t GetLength() const { return m_uiLength; }
+
+	inline pack::Codec GetCodec() const { return m_Codec; }
+
+	inline uint32_t GetBlockSize() const { return m_uiBlockSize; }
+
+	/**
+	*	Sets the cache that stored data is read through, if it's read from the pack file. Null to read directly.
+	*	Must be set before Open, which reads the seek table.
+	*/
+	inline void SetBlockCache( CBlockCache* pBlockCache ) { m_pBlockCache = pBlockCache; }
+
+	/**
+	*	Reads uncompressed data.
+	*	@param pBuffer Buffer to read into.
+	*	@param uiSize Number of bytes to read.
+	*	@param uiPosition Position in the uncompressed data to read from.
+	*	@return Number of bytes read. Less than requested if the end of the entry was reached or the data is corrupt.
+	*/
+	size_t Read( void* pBuffer, size_t uiSize, uint64_t uiPosition );
+
+private:
+	static const uint64_t INVALID_BLOCK = std::numeric_limits<uint64_t>::max();
+
+	/**
+	*	Reads stored data at the given offset relative to the start of the entry.
+	*/
+	bool ReadStored( void* pBuffer, size_t uiSize, uint64_t uiOffset ) const;
+
+	/**
+	*	Decompresses a block.
+	*	@param pDest Buffer that receives the block. Must be large enough to hold the block's uncompressed size.
+	*/
+	bool DecompressBlock( uint64_t uiBlock, uint8_t* pDest );
+
+	size_t GetBlockLength( uint64_t uiBlock ) const
+	{
+		return static_cast<size_t>( std::min<uint64_t>( m_uiBlockSize, m_uiLength - uiBlock * m_uiBlockSize ) );
+	}
+
+private:
+	FILE* m_pFile = nullptr;
+	const uint8_t* m_pData = nullptr;
+
+	CBlockCache* m_pBlockCache = nullptr;
+
+	uint64_t m_uiStartOffset = 0;
+	uint64_t m_uiStoredLength = 0;
+	uint64_t m_uiLength = 0;
+
+	pack::Codec m_Codec = pack::Codec::NONE;
+	uint32_t m_uiBlockSize = 0;
+
+	/**
+	*	Offset of each block relative to the start of the entry, followed by the end of the last block.
+	*/
+	std::vector<uint64_t> m_Offsets;
+
+	/**
+	*	Compressed data of the block being decompressed, when not reading from a mapping.
+	*/
+	std::vector<uint8_t> m_StoredBlock;
+
+	std::unique_ptr<uint8_t[]> m_Block;
+	uint64_t m_uiCachedBlock = INVALID_BLOCK;
+
+private:
+	CCompressedEntry( const CCompressedEntry& ) = delete;
+	CCompressedEntry& operator=( const CCompressedEntry& ) = delete;
+};
+
+#endif //FILESYSTEM_CCOMPRESSEDENTRY_H
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <cstring>
+
+#include "XXHash.h"
+
+#include "CContentCache.h"
+
+const size_t CContentCache::MIN_PRUNE_COUNT;
+
+CContentCache::BufferPtr_t CContentCache::Find( const void* pSource )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_Sources.find( pSource );
+
+	if( it == m_Sources.end() )
+		return nullptr;
+
+	auto buffer = it->second.lock();
+
+	if( !buffer )
+		m_Sources.erase( it );
+
+	return buffer;
+}
+
+CContentCache::BufferPtr_t CContentCache::Add( const void* pSource, std::unique_ptr<uint8_t[]>& data, const size_t uiSize )
+{
+	//Hash before locking, this is the expensive part.
+	const auto uiHash = xxhash::Hash64( data.get(), uiSize );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	BufferPtr_t buffer;
+
+	for( auto range = m_Contents.equal_range( uiHash ); range.first != range.second; ++range.first )
+	{
+		auto candidate = range.first->second.lock();
+
+		if( candidate && candidate->uiSize == uiSize && memcmp( candidate->data.get(), data.get(), uiSize ) == 0 )
+		{
+			buffer = std::move( candidate );
+			break;
+		}
+	}
+
+	if( !buffer )
+	{
+		auto newBuffer = std::make_shared<Buffer_t>();
+
+		newBuffer->data = std::move( data );
+		newBuffer->uiSize = uiSize;
+		newBuffer->uiHash = uiHash;
+
+		buffer = std::move( newBuffer );
+
+		m_Contents.emplace( uiHash, buffer );
+	}
+
+	if( pSource )
+		m_Sources[ pSource ] = buffer;
+
+	Prune();
+
+	return buffer;
+}
+
+void CContentCache::ForgetSources()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Sources.clear();
+}
+
+void CContentCache::Prune()
+{
+	if( m_Contents.size() + m_Sources.size() < m_uiPruneCount )
+		return;
+
+	for( auto it = m_Contents.begin(); it != m_Contents.end(); )
+	{
+		if( it->second.expired() )
+			it = m_Contents.erase( it );
+		else
+			++it;
+	}
+
+	for( auto it = m_Sources.begin(); it != m_Sources.end(); )
+	{
+		if( it->second.expired() )
+			it = m_Sources.erase( it );
+		else
+			++it;
+	}
+
+	//Prune again once the number of entries has doubled, so the cost is amortized.
+	m_uiPruneCount = std::max( MIN_PRUNE_COUNT, ( m_Contents.size() + m_Sources.size() ) * 2 );
+}
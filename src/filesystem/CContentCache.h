@@ -0,0 +1,81 @@
+#ifndef FILESYSTEM_CCONTENTCACHE_H
+#define FILESYSTEM_CCONTENTCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+/**
+*	Shares read buffers with identical contents, so files that are shipped in several search paths are only kept in memory once.
+*	Contents are identified by their length and 64 bit hash, and compared in full before they are shared.
+*	Immutable sources such as pack file entries remember their contents, so loading one that is already in memory needs no I/O.
+*	Buffers are only shared while they are in use; the cache doesn't keep them alive. The cache is synchronized.
+*/
+class CContentCache
+{
+public:
+	struct Buffer_t
+	{
+		std::unique_ptr<uint8_t[]> data;
+		size_t uiSize;
+		uint64_t uiHash;
+	};
+
+	typedef std::shared_ptr<const Buffer_t> BufferPtr_t;
+
+public:
+	CContentCache() = default;
+
+	/**
+	*	@return The contents that were last added for the given source, if they are still in use. Otherwise, null.
+	*/
+	BufferPtr_t Find( const void* pSource );
+
+	/**
+	*	Adds contents that were loaded. If identical contents are in use, those are returned instead.
+	*	@param pSource Immutable source the contents were loaded from, or null if the source can change.
+	*	@param data Contents. Ownership is taken only if no identical contents are in use.
+	*	@param uiSize Size of the contents, in bytes.
+	*	@return The shared contents.
+	*/
+	BufferPtr_t Add( const void* pSource, std::unique_ptr<uint8_t[]>& data, const size_t uiSize );
+
+	/**
+	*	Forgets all sources. Must be called before sources are destroyed, since their addresses can be reused.
+	*/
+	void ForgetSources();
+
+private:
+	/**
+	*	Smallest number of entries at which contents that are no longer in use are removed.
+	*/
+	static const size_t MIN_PRUNE_COUNT = 64;
+
+	/**
+	*	Removes contents that are no longer in use once enough have accumulated. Must be called with the mutex held.
+	*/
+	void Prune();
+
+private:
+	std::mutex m_Mutex;
+
+	/**
+	*	Contents by hash.
+	*/
+	std::unordered_multimap<uint64_t, std::weak_ptr<const Buffer_t>> m_Contents;
+
+	std::unordered_map<const void*, std::weak_ptr<const Buffer_t>> m_Sources;
+
+	/**
+	*	Number of entries at which to prune next.
+	*/
+	size_t m_uiPruneCount = MIN_PRUNE_COUNT;
+
+private:
+	CContentCache( const CContentCache& ) = delete;
+	CContentCache& operator=( const CContentCache& ) = delete;
+};
+
+#endif //FILESYSTEM_CCONTENTCACHE_H
@@ -0,0 +1,176 @@
+#include <iterator>
+
+#include <sys/stat.h>
+
+#include "Platform.h"
+
+#include "CDescriptorCache.h"
+
+const size_t CDescriptorCache::DEFAULT_MAX_ENTRIES;
+
+CDescriptorCache::~CDescriptorCache()
+{
+	InvalidateAll();
+}
+
+void CDescriptorCache::SetMaxEntries( const size_t uiMaxEntries )
+{
+	Entries_t evicted;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_uiMaxEntries = uiMaxEntries;
+
+		Evict( evicted );
+	}
+
+	for( auto& entry : evicted )
+	{
+		fclose( entry.pFile );
+	}
+}
+
+FILE* CDescriptorCache::Acquire( const std::string& szFileName, uint64_t& uiLength )
+{
+	Entries_t acquired;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		auto it = m_EntriesByName.find( szFileName );
+
+		if( it == m_EntriesByName.end() )
+			return nullptr;
+
+		acquired.splice( acquired.end(), m_Entries, it->second );
+
+		m_EntriesByName.erase( it );
+	}
+
+	auto& entry = acquired.front();
+
+	int64_t iModifiedTime;
+
+	//Files that were replaced or deleted have no links left, and files that were written to have a new modification time.
+	if( !GetFileInfo( entry.pFile, uiLength, iModifiedTime ) || uiLength != entry.uiLength || iModifiedTime != entry.iModifiedTime ||
+		fseek64( entry.pFile, 0, SEEK_SET ) != 0 )
+	{
+		fclose( entry.pFile );
+		return nullptr;
+	}
+
+	clearerr( entry.pFile );
+
+	return entry.pFile;
+}
+
+void CDescriptorCache::Release( std::string&& szFileName, FILE* pFile )
+{
+	if( !pFile )
+		return;
+
+	Entries_t entries;
+
+	entries.emplace_back();
+
+	auto& entry = entries.front();
+
+	entry.pFile = pFile;
+
+	if( !GetFileInfo( pFile, entry.uiLength, entry.iModifiedTime ) )
+	{
+		fclose( pFile );
+		return;
+	}
+
+	entry.szFileName = std::move( szFileName );
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		//Another handle may have opened the file while this one had it, keep the one that was cached first.
+		if( m_uiMaxEntries > 0 && m_EntriesByName.find( entry.szFileName ) == m_EntriesByName.end() )
+		{
+			m_Entries.splice( m_Entries.begin(), entries );
+
+			m_EntriesByName.emplace( m_Entries.front().szFileName, m_Entries.begin() );
+
+			Evict( entries );
+		}
+	}
+
+	for( auto& evicted : entries )
+	{
+		fclose( evicted.pFile );
+	}
+}
+
+void CDescriptorCache::Invalidate( const std::string& szFileName )
+{
+	Entries_t invalidated;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		auto it = m_EntriesByName.find( szFileName );
+
+		if( it == m_EntriesByName.end() )
+			return;
+
+		invalidated.splice( invalidated.end(), m_Entries, it->second );
+
+		m_EntriesByName.erase( it );
+	}
+
+	fclose( invalidated.front().pFile );
+}
+
+void CDescriptorCache::InvalidateAll()
+{
+	Entries_t invalidated;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		invalidated.swap( m_Entries );
+
+		m_EntriesByName.clear();
+	}
+
+	for( auto& entry : invalidated )
+	{
+		fclose( entry.pFile );
+	}
+}
+
+bool CDescriptorCache::GetFileInfo( FILE* pFile, uint64_t& uiLength, int64_t& iModifiedTime )
+{
+	struct stat buffer{};
+
+	if( fstat( fileno( pFile ), &buffer ) == -1 || buffer.st_nlink == 0 )
+		return false;
+
+	uiLength = static_cast<uint64_t>( buffer.st_size );
+
+#ifdef WIN32
+	iModifiedTime = static_cast<int64_t>( buffer.st_mtime );
+#elif defined( OSX )
+	iModifiedTime = static_cast<int64_t>( buffer.st_mtimespec.tv_sec ) * 1000000000 + buffer.st_mtimespec.tv_nsec;
+#else
+	//Seconds aren't precise enough to notice files that are saved several times in a row.
+	iModifiedTime = static_cast<int64_t>( buffer.st_mtim.tv_sec ) * 1000000000 + buffer.st_mtim.tv_nsec;
+#endif
+
+	return true;
+}
+
+void CDescriptorCache::Evict( Entries_t& evicted )
+{
+	while( m_Entries.size() > m_uiMaxEntries )
+	{
+		m_EntriesByName.erase( m_Entries.back().szFileName );
+
+		evicted.splice( evicted.end(), m_Entries, std::prev( m_Entries.end() ) );
+	}
+}
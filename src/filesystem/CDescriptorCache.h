@@ -0,0 +1,117 @@
+#ifndef FILESYSTEM_CDESCRIPTORCACHE_H
+#define FILESYSTEM_CDESCRIPTORCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+*	Bounded cache of loose files that were opened for reading and then closed, keyed on full path.
+*	Closed files are kept open, so reopening them skips the path walk and the open and stat calls.
+*	A cached file is only handed out again if its modification time and size haven't changed, and it hasn't been deleted.
+*	Each file is handed out to one handle at a time. The cache is synchronized.
+*/
+class CDescriptorCache
+{
+public:
+	/**
+	*	Default maximum number of files to keep open.
+	*/
+	static const size_t DEFAULT_MAX_ENTRIES = 32;
+
+public:
+	CDescriptorCache() = default;
+	~CDescriptorCache();
+
+	size_t GetMaxEntries() const
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		return m_uiMaxEntries;
+	}
+
+	/**
+	*	Sets the maximum number of files to keep open. Closes the least recently used files if needed.
+	*/
+	void SetMaxEntries( const size_t uiMaxEntries );
+
+	/**
+	*	@return Number of files in the cache.
+	*/
+	size_t GetEntryCount() const
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		return m_Entries.size();
+	}
+
+	/**
+	*	Takes a file out of the cache. The file is positioned at its start.
+	*	@param szFileName Full path of the file.
+	*	@param[ out ] uiLength If the file was cached, its length.
+	*	@return The file, or null if it isn't cached or has changed. The caller owns the file.
+	*/
+	FILE* Acquire( const std::string& szFileName, uint64_t& uiLength );
+
+	/**
+	*	Puts a file that was opened for binary reading in the cache. Takes ownership of the file.
+	*	@param szFileName Full path of the file.
+	*/
+	void Release( std::string&& szFileName, FILE* pFile );
+
+	/**
+	*	Closes the given file if it's cached. Used when the file is written to or removed.
+	*/
+	void Invalidate( const std::string& szFileName );
+
+	/**
+	*	Closes all cached files.
+	*/
+	void InvalidateAll();
+
+private:
+	struct Entry_t
+	{
+		std::string szFileName;
+		FILE* pFile;
+
+		uint64_t uiLength;
+		int64_t iModifiedTime;
+	};
+
+	typedef std::list<Entry_t> Entries_t;
+
+	/**
+	*	Gets the length and modification time of an opened file.
+	*	@return Whether the file still exists.
+	*/
+	static bool GetFileInfo( FILE* pFile, uint64_t& uiLength, int64_t& iModifiedTime );
+
+	/**
+	*	Removes the least recently used files until there are no more than the maximum. Must be called with the mutex held.
+	*	@param[ out ] evicted Files that were removed. Closed by the caller once the mutex is released.
+	*/
+	void Evict( Entries_t& evicted );
+
+private:
+	mutable std::mutex m_Mutex;
+
+	/**
+	*	Cached files, most recently used first.
+	*/
+	Entries_t m_Entries;
+
+	std::unordered_map<std::string, Entries_t::iterator> m_EntriesByName;
+
+	size_t m_uiMaxEntries = DEFAULT_MAX_ENTRIES;
+
+private:
+	CDescriptorCache( const CDescriptorCache& ) = delete;
+	CDescriptorCache& operator=( const CDescriptorCache& ) = delete;
+};
+
+#endif //FILESYSTEM_CDESCRIPTORCACHE_H
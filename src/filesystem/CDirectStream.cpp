@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#ifndef WIN32
+#include <fcntl.h>
+#endif
+
+#include "CDirectStream.h"
+
+CDirectStream::CDirectStream( CDirectStreamer& streamer )
+	: m_Streamer( streamer )
+{
+}
+
+CDirectStream::~CDirectStream()
+{
+	Close();
+}
+
+bool CDirectStream::Open( const char* pszPackFileName, uint64_t uiStartOffset, uint64_t uiLength )
+{
+	Close();
+
+	if( !pszPackFileName )
+		return false;
+
+#ifdef WIN32
+	m_hFile = CreateFileA( pszPackFileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_NO_BUFFERING | FILE_FLAG_SEQUENTIAL_SCAN, nullptr );
+
+	if( m_hFile == INVALID_HANDLE_VALUE )
+		return false;
+#elif defined( OSX )
+	m_iFD = open( pszPackFileName, O_RDONLY | O_CLOEXEC );
+
+	if( m_iFD == -1 )
+		return false;
+
+	//There's no O_DIRECT, but caching can be turned off for the descriptor.
+	fcntl( m_iFD, F_NOCACHE, 1 );
+#else
+	m_iFD = open( pszPackFileName, O_RDONLY | O_DIRECT | O_CLOEXEC );
+
+	if( m_iFD == -1 )
+		return false;
+#endif
+
+	m_uiStartOffset = uiStartOffset;
+	m_uiLength = uiLength;
+
+	m_Current.data = m_Streamer.AcquireBuffer();
+	m_Next.data = m_Streamer.AcquireBuffer();
+
+	if( !m_Current.data || !m_Next.data )
+	{
+		Close();
+		return false;
+	}
+
+	//Some filesystems accept unbuffered opens but fail the reads, so read the first block now to find out.
+	if( uiLength > 0 && !Seek( uiStartOffset ) )
+	{
+		Close();
+		return false;
+	}
+
+	return true;
+}
+
+size_t CDirectStream::Read( void* pBuffer, size_t uiSize, uint64_t uiPosition )
+{
+	if( uiPosition >= m_uiLength )
+		return 0;
+
+	uiSize = static_cast<size_t>( std::min<uint64_t>( uiSize, m_uiLength - uiPosition ) );
+
+	auto pOutput = reinterpret_cast<uint8_t*>( pBuffer );
+
+	size_t uiRead = 0;
+
+	while( uiRead < uiSize )
+	{
+		const uint64_t uiFileOffset = m_uiStartOffset + uiPosition + uiRead;
+
+		if( !Seek( uiFileOffset ) )
+			break;
+
+		const auto uiCount = static_cast<size_t>( std::min<uint64_t>( uiSize - uiRead, m_Current.uiOffset + m_Current.uiSize - uiFileOffset ) );
+
+		memcpy( pOutput + uiRead, m_Current.data.get() + ( uiFileOffset - m_Current.uiOffset ), uiCount );
+
+		uiRead += uiCount;
+	}
+
+	return uiRead;
+}
+
+bool CDirectStream::Seek( uint64_t uiFileOffset )
+{
+	if( m_Current.Contains( uiFileOffset ) )
+		return true;
+
+	//The next block can't be used or replaced until its read-ahead is done.
+	m_Streamer.Wait( *this, false );
+
+	if( m_Next.Contains( uiFileOffset ) )
+	{
+		std::swap( m_Current, m_Next );
+	}
+	else
+	{
+		ReadBlock( m_Current, uiFileOffset - uiFileOffset % CDirectStreamer::BUFFER_SIZE );
+
+		if( !m_Current.Contains( uiFileOffset ) )
+			return false;
+	}
+
+	const uint64_t uiNextOffset = m_Current.uiOffset + CDirectStreamer::BUFFER_SIZE;
+
+	//Short blocks are at the end of the pack file.
+	if( m_Current.uiSize == CDirectStreamer::BUFFER_SIZE && uiNextOffset < m_uiStartOffset + m_uiLength && !m_Next.Contains( uiNextOffset ) )
+	{
+		m_Next.bValid = false;
+		m_uiReadAheadOffset = uiNextOffset;
+
+		m_Streamer.Queue( *this );
+	}
+
+	return true;
+}
+
+void CDirectStream::ReadBlock( Block_t& block, uint64_t uiOffset )
+{
+	block.uiOffset = uiOffset;
+	block.uiSize = 0;
+	block.bValid = false;
+
+	uint8_t* pData = block.data.get();
+
+	size_t uiRead = 0;
+
+	//A short read leaves the rest unaligned, so the next read fails and the block ends there.
+#ifdef WIN32
+	while( uiRead < CDirectStreamer::BUFFER_SIZE )
+	{
+		OVERLAPPED overlapped{};
+
+		const uint64_t uiPosition = uiOffset + uiRead;
+
+		overlapped.Offset = static_cast<DWORD>( uiPosition & 0xFFFFFFFF );
+		overlapped.OffsetHigh = static_cast<DWORD>( uiPosition >> 32 );
+
+		DWORD uiResult = 0;
+
+		if( !ReadFile( m_hFile, pData + uiRead, static_cast<DWORD>( CDirectStreamer::BUFFER_SIZE - uiRead ), &uiResult, &overlapped ) || uiResult == 0 )
+			break;
+
+		uiRead += uiResult;
+	}
+#else
+	while( uiRead < CDirectStreamer::BUFFER_SIZE )
+	{
+		const auto result = pread64( m_iFD, pData + uiRead, CDirectStreamer::BUFFER_SIZE - uiRead, static_cast<off64_t>( uiOffset + uiRead ) );
+
+		if( result < 0 && errno == EINTR )
+			continue;
+
+		if( result <= 0 )
+			break;
+
+		uiRead += static_cast<size_t>( result );
+	}
+#endif
+
+	block.uiSize = uiRead;
+	block.bValid = uiRead > 0;
+}
+
+void CDirectStream::Close()
+{
+	m_Streamer.Wait( *this, true );
+
+#ifdef WIN32
+	if( m_hFile != INVALID_HANDLE_VALUE )
+	{
+		CloseHandle( m_hFile );
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+#else
+	if( m_iFD != -1 )
+	{
+		close( m_iFD );
+		m_iFD = -1;
+	}
+#endif
+
+	m_Streamer.ReleaseBuffer( std::move( m_Current.data ) );
+	m_Streamer.ReleaseBuffer( std::move( m_Next.data ) );
+
+	m_Current = Block_t();
+	m_Next = Block_t();
+
+	m_uiStartOffset = m_uiLength = 0;
+}
@@ -0,0 +1,115 @@
+#ifndef FILESYSTEM_CDIRECTSTREAM_H
+#define FILESYSTEM_CDIRECTSTREAM_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Platform.h"
+
+#include "CDirectStreamer.h"
+
+/**
+*	Streams an uncompressed pack file entry with unbuffered I/O (O_DIRECT, FILE_FLAG_NO_BUFFERING), so it doesn't pollute the OS page cache.
+*	The pack file is opened again for this. Data is read in aligned blocks into two buffers: while one is being read from,
+*	the streamer reads the block after it into the other, so sequential reads don't wait on the disk.
+*	Reads behave like reads from the pack file, but like the handle's position, a stream must only be used by one thread at a time.
+*/
+class CDirectStream
+{
+public:
+	CDirectStream( CDirectStreamer& streamer );
+	~CDirectStream();
+
+	/**
+	*	Opens the pack file for unbuffered reading.
+	*	@param pszPackFileName Name of the pack file.
+	*	@param uiStartOffset Offset of the entry in the pack file.
+	*	@param uiLength Length of the entry.
+	*	@return Whether the pack file could be opened. Not all filesystems support unbuffered I/O.
+	*/
+	bool Open( const char* pszPackFileName, uint64_t uiStartOffset, uint64_t uiLength );
+
+	/**
+	*	Reads from the entry.
+	*	@param pBuffer Buffer to read into.
+	*	@param uiSize Number of bytes to read. Reads are clamped to the entry.
+	*	@param uiPosition Position relative to the start of the entry to read from.
+	*	@return Number of bytes read.
+	*/
+	size_t Read( void* pBuffer, size_t uiSize, uint64_t uiPosition );
+
+private:
+	friend class CDirectStreamer;
+
+	/**
+	*	An aligned block of the pack file.
+	*/
+	struct Block_t
+	{
+		CDirectStreamer::BufferPtr_t data;
+
+		/**
+		*	Offset of the block in the pack file.
+		*/
+		uint64_t uiOffset = 0;
+
+		/**
+		*	Number of bytes read. Less than the buffer size at the end of the pack file.
+		*/
+		size_t uiSize = 0;
+
+		bool bValid = false;
+
+		bool Contains( uint64_t uiFileOffset ) const
+		{
+			return bValid && uiFileOffset >= uiOffset && uiFileOffset - uiOffset < uiSize;
+		}
+	};
+
+	/**
+	*	Makes the block containing the given offset in the pack file the current block, and starts reading ahead the block after it.
+	*	@return Whether the offset could be read.
+	*/
+	bool Seek( uint64_t uiFileOffset );
+
+	/**
+	*	Reads the block at the given offset. Called by the streamer's worker for read-aheads.
+	*/
+	void ReadBlock( Block_t& block, uint64_t uiOffset );
+
+	void Close();
+
+private:
+	CDirectStreamer& m_Streamer;
+
+#ifdef WIN32
+	HANDLE m_hFile = INVALID_HANDLE_VALUE;
+#else
+	int m_iFD = -1;
+#endif
+
+	uint64_t m_uiStartOffset = 0;
+	uint64_t m_uiLength = 0;
+
+	/**
+	*	The block reads are served from, and the block that is read ahead into.
+	*/
+	Block_t m_Current;
+	Block_t m_Next;
+
+	/**
+	*	Offset of the block to read ahead. Only used by the streamer.
+	*/
+	uint64_t m_uiReadAheadOffset = 0;
+
+	/**
+	*	Whether a read-ahead into m_Next is queued or in progress. Guarded by the streamer's mutex.
+	*/
+	bool m_bReadAheadPending = false;
+
+private:
+	CDirectStream( const CDirectStream& ) = delete;
+	CDirectStream& operator=( const CDirectStream& ) = delete;
+};
+
+#endif //FILESYSTEM_CDIRECTSTREAM_H
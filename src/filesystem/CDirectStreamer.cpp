@@ -0,0 +1,160 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+
+#ifdef WIN32
+#include <malloc.h>
+#endif
+
+#include "CDirectStream.h"
+
+#include "CDirectStreamer.h"
+
+const size_t CDirectStreamer::ALIGNMENT;
+const size_t CDirectStreamer::BUFFER_SIZE;
+const size_t CDirectStreamer::MAX_RETAINED_BUFFERS;
+
+void CDirectStreamer::FreeAligned_t::operator()( uint8_t* pData ) const
+{
+#ifdef WIN32
+	_aligned_free( pData );
+#else
+	free( pData );
+#endif
+}
+
+CDirectStreamer::~CDirectStreamer()
+{
+	Shutdown();
+}
+
+CDirectStreamer::BufferPtr_t CDirectStreamer::AcquireBuffer()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( !m_FreeBuffers.empty() )
+		{
+			auto buffer = std::move( m_FreeBuffers.back() );
+
+			m_FreeBuffers.pop_back();
+
+			return buffer;
+		}
+	}
+
+#ifdef WIN32
+	void* pData = _aligned_malloc( BUFFER_SIZE, ALIGNMENT );
+#else
+	void* pData = nullptr;
+
+	if( posix_memalign( &pData, ALIGNMENT, BUFFER_SIZE ) != 0 )
+		pData = nullptr;
+#endif
+
+	return BufferPtr_t( reinterpret_cast<uint8_t*>( pData ) );
+}
+
+void CDirectStreamer::ReleaseBuffer( BufferPtr_t&& buffer )
+{
+	if( !buffer )
+		return;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_FreeBuffers.size() < MAX_RETAINED_BUFFERS )
+		m_FreeBuffers.emplace_back( std::move( buffer ) );
+}
+
+void CDirectStreamer::Queue( CDirectStream& stream )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	assert( !stream.m_bReadAheadPending );
+
+	if( !m_Thread.joinable() )
+	{
+		m_bShutdown = false;
+
+		m_Thread = std::thread( &CDirectStreamer::WorkerThread, this );
+	}
+
+	stream.m_bReadAheadPending = true;
+
+	m_Queue.push_back( &stream );
+
+	m_WorkAvailable.notify_one();
+}
+
+void CDirectStreamer::Wait( CDirectStream& stream, bool bCancel )
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	if( bCancel && stream.m_bReadAheadPending && m_pReading != &stream )
+	{
+		m_Queue.erase( std::find( m_Queue.begin(), m_Queue.end(), &stream ) );
+
+		stream.m_bReadAheadPending = false;
+
+		return;
+	}
+
+	m_WorkFinished.wait( lock, [ &stream ]()
+	{
+		return !stream.m_bReadAheadPending;
+	} );
+}
+
+void CDirectStreamer::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bShutdown = true;
+	}
+
+	m_WorkAvailable.notify_all();
+
+	//The worker finishes everything that is queued before it stops.
+	if( m_Thread.joinable() )
+		m_Thread.join();
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_FreeBuffers.clear();
+}
+
+void CDirectStreamer::WorkerThread()
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( true )
+	{
+		m_WorkAvailable.wait( lock, [ this ]()
+		{
+			return m_bShutdown || !m_Queue.empty();
+		} );
+
+		if( m_Queue.empty() )
+			break;
+
+		auto& stream = *m_Queue.front();
+
+		m_Queue.pop_front();
+
+		m_pReading = &stream;
+
+		lock.unlock();
+
+		//The stream doesn't touch its next block while the read-ahead is pending.
+		stream.ReadBlock( stream.m_Next, stream.m_uiReadAheadOffset );
+
+		lock.lock();
+
+		m_pReading = nullptr;
+
+		stream.m_bReadAheadPending = false;
+
+		m_WorkFinished.notify_all();
+	}
+}
@@ -0,0 +1,103 @@
+#ifndef FILESYSTEM_CDIRECTSTREAMER_H
+#define FILESYSTEM_CDIRECTSTREAMER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CDirectStream;
+
+/**
+*	Reads ahead for direct streams on a background thread, and pools the aligned buffers they read into.
+*	Direct streams bypass the OS page cache, so large pack entries that are streamed once don't evict everything else from it.
+*	The streamer must outlive every stream that uses it. The streamer is synchronized, so streams can be used from any thread.
+*/
+class CDirectStreamer
+{
+public:
+	/**
+	*	Alignment of buffers, file offsets and read sizes. Covers the logical block size of the devices unbuffered I/O is done on.
+	*/
+	static const size_t ALIGNMENT = 4096;
+
+	/**
+	*	Size of each of a stream's buffers. Streams read this much at a time.
+	*/
+	static const size_t BUFFER_SIZE = 1024 * 1024;
+
+	/**
+	*	Maximum number of free buffers that are kept. Released buffers beyond this are freed.
+	*/
+	static const size_t MAX_RETAINED_BUFFERS = 8;
+
+	static_assert( BUFFER_SIZE % ALIGNMENT == 0, "Buffers must hold a whole number of aligned blocks" );
+
+	struct FreeAligned_t
+	{
+		void operator()( uint8_t* pData ) const;
+	};
+
+	typedef std::unique_ptr<uint8_t, FreeAligned_t> BufferPtr_t;
+
+public:
+	CDirectStreamer() = default;
+	~CDirectStreamer();
+
+	/**
+	*	@return A buffer of BUFFER_SIZE bytes, aligned to ALIGNMENT. Null if it couldn't be allocated.
+	*/
+	BufferPtr_t AcquireBuffer();
+
+	void ReleaseBuffer( BufferPtr_t&& buffer );
+
+	/**
+	*	Queues a read-ahead for a stream. Starts the worker thread if needed.
+	*	The stream must not have a read-ahead queued or in progress.
+	*/
+	void Queue( CDirectStream& stream );
+
+	/**
+	*	Waits until a stream has no read-ahead queued or in progress.
+	*	@param bCancel Whether to drop a read-ahead that hasn't started yet instead of waiting for it.
+	*/
+	void Wait( CDirectStream& stream, bool bCancel );
+
+	/**
+	*	Finishes all queued read-aheads, frees the pooled buffers and stops the worker thread.
+	*	The worker is restarted if more read-aheads are queued.
+	*/
+	void Shutdown();
+
+private:
+	void WorkerThread();
+
+private:
+	std::mutex m_Mutex;
+
+	std::condition_variable m_WorkAvailable;
+	std::condition_variable m_WorkFinished;
+
+	std::deque<CDirectStream*> m_Queue;
+
+	/**
+	*	Stream whose read-ahead the worker is doing.
+	*/
+	CDirectStream* m_pReading = nullptr;
+
+	std::vector<BufferPtr_t> m_FreeBuffers;
+
+	std::thread m_Thread;
+
+	bool m_bShutdown = false;
+
+private:
+	CDirectStreamer( const CDirectStreamer& ) = delete;
+	CDirectStreamer& operator=( const CDirectStreamer& ) = delete;
+};
+
+#endif //FILESYSTEM_CDIRECTSTREAMER_H
@@ -0,0 +1,159 @@
+#include <cstring>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "CPathBuffer.h"
+
+#include "CDirectoryHandle.h"
+
+#ifndef WIN32
+namespace
+{
+/**
+*	Converts a relative name to the platform's separators and strips leading separators, so it can't be taken as an absolute path.
+*	An empty name refers to the directory itself.
+*/
+bool MakeRelativeName( const char* pszFileName, CPathBuffer& path, const char*& pszRelativeName )
+{
+	if( !path.Set( pszFileName ) )
+		return false;
+
+	pszRelativeName = path.Get();
+
+	while( *pszRelativeName == '/' )
+		++pszRelativeName;
+
+	if( !*pszRelativeName )
+		pszRelativeName = ".";
+
+	return true;
+}
+
+/**
+*	Converts an fopen mode to open flags.
+*	@return Whether the mode is valid.
+*/
+bool GetOpenFlags( const char* pszMode, int& iFlags )
+{
+	const bool bUpdate = strchr( pszMode, '+' ) != nullptr;
+
+	switch( *pszMode )
+	{
+	case 'r':	iFlags = bUpdate ? O_RDWR : O_RDONLY; break;
+	case 'w':	iFlags = ( bUpdate ? O_RDWR : O_WRONLY ) | O_CREAT | O_TRUNC; break;
+	case 'a':	iFlags = ( bUpdate ? O_RDWR : O_WRONLY ) | O_CREAT | O_APPEND; break;
+
+	default: return false;
+	}
+
+	iFlags |= O_CLOEXEC;
+
+	return true;
+}
+}
+#endif
+
+bool CDirectoryHandle::Open( const char* pszPath )
+{
+	Close();
+
+#ifdef WIN32
+	return false;
+#else
+	m_iFD = open( pszPath, O_RDONLY | O_DIRECTORY | O_CLOEXEC );
+
+	return m_iFD != -1;
+#endif
+}
+
+void CDirectoryHandle::Close()
+{
+#ifndef WIN32
+	if( m_iFD != -1 )
+	{
+		close( m_iFD );
+		m_iFD = -1;
+	}
+#endif
+}
+
+bool CDirectoryHandle::IsOpen() const
+{
+#ifdef WIN32
+	return false;
+#else
+	return m_iFD != -1;
+#endif
+}
+
+FILE* CDirectoryHandle::OpenFile( const char* pszFileName, const char* pszMode, uint64_t& uiLength ) const
+{
+	uiLength = 0;
+
+#ifdef WIN32
+	return nullptr;
+#else
+	CPathBuffer path;
+	const char* pszRelativeName;
+	int iFlags;
+
+	if( !IsOpen() || !MakeRelativeName( pszFileName, path, pszRelativeName ) || !GetOpenFlags( pszMode, iFlags ) )
+		return nullptr;
+
+	//Created files get the same permissions fopen gives them.
+	const int fd = openat( m_iFD, pszRelativeName, iFlags, 0666 );
+
+	if( fd == -1 )
+		return nullptr;
+
+	struct stat64 buffer{};
+
+	if( fstat64( fd, &buffer ) == -1 )
+	{
+		close( fd );
+		return nullptr;
+	}
+
+	FILE* pFile = fdopen( fd, pszMode );
+
+	if( !pFile )
+	{
+		close( fd );
+		return nullptr;
+	}
+
+	uiLength = static_cast<uint64_t>( buffer.st_size );
+
+	return pFile;
+#endif
+}
+
+bool CDirectoryHandle::GetStatus( const char* pszFileName, Status_t& status ) const
+{
+	status = Status_t();
+
+#ifdef WIN32
+	return false;
+#else
+	CPathBuffer path;
+	const char* pszRelativeName;
+
+	if( !IsOpen() || !MakeRelativeName( pszFileName, path, pszRelativeName ) )
+		return false;
+
+	struct stat64 buffer{};
+
+	if( fstatat64( m_iFD, pszRelativeName, &buffer, 0 ) == -1 )
+		return false;
+
+	status.bIsDirectory = S_ISDIR( buffer.st_mode );
+	status.uiSize = static_cast<uint64_t>( buffer.st_size );
+	status.iModifiedTime = static_cast<int64_t>( buffer.st_mtime );
+
+	return true;
+#endif
+}
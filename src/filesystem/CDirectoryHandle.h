@@ -0,0 +1,76 @@
+#ifndef FILESYSTEM_CDIRECTORYHANDLE_H
+#define FILESYSTEM_CDIRECTORYHANDLE_H
+
+#include <cstdint>
+#include <cstdio>
+
+#include "Platform.h"
+
+/**
+*	An open directory that files are opened and probed relative to, so the kernel resolves only the part of the path below it.
+*	Loose search paths keep one open. Only supported on POSIX platforms; Open always fails on Windows, and callers use full paths instead.
+*	All operations are safe to use from multiple threads.
+*/
+class CDirectoryHandle
+{
+public:
+	/**
+	*	Status of a file relative to the directory.
+	*/
+	struct Status_t
+	{
+		bool bIsDirectory = false;
+
+		uint64_t uiSize = 0;
+
+		/**
+		*	Modification time, in seconds.
+		*/
+		int64_t iModifiedTime = 0;
+	};
+
+public:
+	CDirectoryHandle() = default;
+
+	~CDirectoryHandle()
+	{
+		Close();
+	}
+
+	/**
+	*	Opens the given directory. Any previously opened directory is closed first.
+	*	@return Whether the directory was opened.
+	*/
+	bool Open( const char* pszPath );
+
+	void Close();
+
+	bool IsOpen() const;
+
+	/**
+	*	Opens a file relative to the directory, with a single open and fstat.
+	*	@param pszFileName Name of the file relative to the directory. Leading separators are ignored.
+	*	@param pszMode Mode, as given to fopen.
+	*	@param[ out ] uiLength Length of the file.
+	*	@return The file, or null if it couldn't be opened.
+	*/
+	FILE* OpenFile( const char* pszFileName, const char* pszMode, uint64_t& uiLength ) const;
+
+	/**
+	*	Gets the status of a file relative to the directory, with a single fstatat.
+	*	@param pszFileName Name of the file relative to the directory. Leading separators are ignored.
+	*	@return Whether the file exists.
+	*/
+	bool GetStatus( const char* pszFileName, Status_t& status ) const;
+
+private:
+#ifndef WIN32
+	int m_iFD = -1;
+#endif
+
+private:
+	CDirectoryHandle( const CDirectoryHandle& ) = delete;
+	CDirectoryHandle& operator=( const CDirectoryHandle& ) = delete;
+};
+
+#endif //FILESYSTEM_CDIRECTORYHANDLE_H
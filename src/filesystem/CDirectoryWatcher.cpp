@@ -0,0 +1,704 @@
+#include <algorithm>
+#include <cstring>
+#include <experimental/filesystem>
+
+#if !defined( WIN32 ) && defined( __linux__ )
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#endif
+
+#include "CPathBuffer.h"
+#include "CSearchPath.h"
+
+#include "CDirectoryWatcher.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace
+{
+/**
+*	Joins a directory relative to a search path and a name in it.
+*/
+std::string MakeRelativeName( const std::string& szDirectory, const char* pszName )
+{
+	if( szDirectory.empty() )
+		return pszName;
+
+	return szDirectory + '/' + pszName;
+}
+}
+
+CDirectoryWatcher::~CDirectoryWatcher()
+{
+	Shutdown();
+}
+
+void CDirectoryWatcher::GetChanges( std::vector<Change_t>& changes )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	changes = std::move( m_Changes );
+
+	m_Changes.clear();
+
+	m_bHasChanges.store( false, std::memory_order_release );
+}
+
+void CDirectoryWatcher::StartWorker()
+{
+	if( m_Thread.joinable() )
+		return;
+
+	m_bShutdown = false;
+
+	m_Thread = std::thread( &CDirectoryWatcher::WorkerThread, this );
+}
+
+void CDirectoryWatcher::AddChange( CSearchPath* pSearchPath, ChangeType type, std::string&& szFileName, bool bIsDirectory )
+{
+	m_Changes.push_back( { pSearchPath, type, std::move( szFileName ), bIsDirectory } );
+
+	m_bHasChanges.store( true, std::memory_order_release );
+}
+
+#ifdef WIN32
+bool CDirectoryWatcher::AddPath( CSearchPath& searchPath )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	//The worker waits on every watch plus the wake event.
+	if( m_Watches.size() + 1 >= MAXIMUM_WAIT_OBJECTS )
+		return false;
+
+	if( !m_hWakeEvent )
+	{
+		m_hWakeEvent = CreateEventA( nullptr, FALSE, FALSE, nullptr );
+
+		if( !m_hWakeEvent )
+			return false;
+	}
+
+	auto watch = std::make_unique<Watch_t>();
+
+	watch->pSearchPath = &searchPath;
+
+	watch->hDirectory = CreateFileA( searchPath.szPath, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+									 nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr );
+
+	if( watch->hDirectory == INVALID_HANDLE_VALUE )
+		return false;
+
+	memset( &watch->overlapped, 0, sizeof( watch->overlapped ) );
+
+	watch->overlapped.hEvent = CreateEventA( nullptr, TRUE, FALSE, nullptr );
+
+	if( !watch->overlapped.hEvent || !ReadChanges( *watch ) )
+	{
+		CloseWatch( *watch );
+		return false;
+	}
+
+	m_Watches.emplace_back( std::move( watch ) );
+
+	StartWorker();
+
+	SetEvent( m_hWakeEvent );
+
+	return true;
+}
+
+void CDirectoryWatcher::RemovePath( const CSearchPath& searchPath )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	RemoveWatches( searchPath, nullptr );
+
+	m_Changes.erase( std::remove_if( m_Changes.begin(), m_Changes.end(),
+		[ & ]( const Change_t& change )
+		{
+			return change.pSearchPath == &searchPath;
+		}
+	), m_Changes.end() );
+
+	m_bHasChanges.store( !m_Changes.empty(), std::memory_order_release );
+}
+
+void CDirectoryWatcher::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bShutdown = true;
+
+		if( m_hWakeEvent )
+			SetEvent( m_hWakeEvent );
+	}
+
+	if( m_Thread.joinable() )
+		m_Thread.join();
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	for( auto& watch : m_Watches )
+	{
+		CancelIoEx( watch->hDirectory, &watch->overlapped );
+		CloseWatch( *watch );
+	}
+
+	for( auto& watch : m_RemovedWatches )
+	{
+		CloseWatch( *watch );
+	}
+
+	m_Watches.clear();
+	m_RemovedWatches.clear();
+
+	if( m_hWakeEvent )
+	{
+		CloseHandle( m_hWakeEvent );
+		m_hWakeEvent = nullptr;
+	}
+
+	m_Changes.clear();
+
+	m_bHasChanges.store( false, std::memory_order_release );
+}
+
+void CDirectoryWatcher::WorkerThread()
+{
+	std::vector<HANDLE> handles;
+	std::vector<Watch_t*> watches;
+
+	while( true )
+	{
+		{
+			std::lock_guard<std::mutex> lock( m_Mutex );
+
+			if( m_bShutdown )
+				break;
+
+			//Nothing waits on removed watches anymore, so they can be closed now.
+			for( auto& watch : m_RemovedWatches )
+			{
+				CloseWatch( *watch );
+			}
+
+			m_RemovedWatches.clear();
+
+			handles.assign( 1, m_hWakeEvent );
+			watches.clear();
+
+			for( auto& watch : m_Watches )
+			{
+				handles.push_back( watch->overlapped.hEvent );
+				watches.push_back( watch.get() );
+			}
+		}
+
+		const DWORD uiResult = WaitForMultipleObjects( static_cast<DWORD>( handles.size() ), handles.data(), FALSE, INFINITE );
+
+		//Watches were added or removed, or shutting down.
+		if( uiResult == WAIT_OBJECT_0 )
+			continue;
+
+		if( uiResult >= WAIT_OBJECT_0 + handles.size() )
+			break;
+
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		auto pWatch = watches[ uiResult - WAIT_OBJECT_0 - 1 ];
+
+		//Removed while waiting.
+		if( std::find_if( m_Watches.begin(), m_Watches.end(),
+				[ & ]( const std::unique_ptr<Watch_t>& watch )
+				{
+					return watch.get() == pWatch;
+				}
+		) == m_Watches.end() )
+			continue;
+
+		DWORD uiBytes = 0;
+
+		const bool bSuccess = GetOverlappedResult( pWatch->hDirectory, &pWatch->overlapped, &uiBytes, FALSE ) != FALSE;
+
+		pWatch->bPending = false;
+
+		if( !bSuccess )
+		{
+			AddChange( pWatch->pSearchPath, ChangeType::LOST, std::string(), true );
+			RemoveWatches( *pWatch->pSearchPath, nullptr );
+			continue;
+		}
+
+		//The buffer overflowed, so the changes are lost.
+		if( uiBytes == 0 )
+			AddChange( pWatch->pSearchPath, ChangeType::RESCAN, std::string(), true );
+		else
+			ProcessChanges( *pWatch, uiBytes );
+
+		ResetEvent( pWatch->overlapped.hEvent );
+
+		if( !ReadChanges( *pWatch ) )
+		{
+			AddChange( pWatch->pSearchPath, ChangeType::LOST, std::string(), true );
+			RemoveWatches( *pWatch->pSearchPath, nullptr );
+		}
+	}
+}
+
+bool CDirectoryWatcher::AddDirectory( CSearchPath& searchPath, const std::string& szDirectory, const bool bReportContents )
+{
+	//The watch covers the whole tree, so only the contents have to be reported.
+	if( !bReportContents )
+		return true;
+
+	CPathBuffer path;
+
+	if( !path.Set( searchPath.szPath, szDirectory.c_str() ) )
+		return false;
+
+	std::error_code error;
+
+	const auto root = fs::u8path( path.Get() );
+
+	const size_t uiRootLength = root.u8string().length();
+
+	fs::recursive_directory_iterator it( root, error );
+
+	if( error )
+		return true;
+
+	for( fs::recursive_directory_iterator end; it != end; it.increment( error ) )
+	{
+		if( error )
+			break;
+
+		const auto szName = it->path().u8string();
+
+		//Skip the separator that follows the directory.
+		if( szName.length() <= uiRootLength + 1 )
+			continue;
+
+		AddChange( &searchPath, ChangeType::ADDED, MakeRelativeName( szDirectory, szName.c_str() + uiRootLength + 1 ), fs::is_directory( it->status() ) );
+	}
+
+	return true;
+}
+
+void CDirectoryWatcher::RemoveWatches( const CSearchPath& searchPath, const char* pszDirectory )
+{
+	//Each watch covers a whole search path.
+	if( pszDirectory )
+		return;
+
+	auto it = std::find_if( m_Watches.begin(), m_Watches.end(),
+		[ & ]( const std::unique_ptr<Watch_t>& watch )
+		{
+			return watch->pSearchPath == &searchPath;
+		}
+	);
+
+	if( it == m_Watches.end() )
+		return;
+
+	CancelIoEx( ( *it )->hDirectory, &( *it )->overlapped );
+
+	m_RemovedWatches.emplace_back( std::move( *it ) );
+
+	m_Watches.erase( it );
+
+	SetEvent( m_hWakeEvent );
+}
+
+bool CDirectoryWatcher::ReadChanges( Watch_t& watch )
+{
+	watch.bPending = ReadDirectoryChangesW( watch.hDirectory, watch.buffer, sizeof( watch.buffer ), TRUE,
+											FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_DIR_NAME | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_LAST_WRITE,
+											nullptr, &watch.overlapped, nullptr ) != FALSE;
+
+	return watch.bPending;
+}
+
+void CDirectoryWatcher::ProcessChanges( Watch_t& watch, const DWORD uiBytes )
+{
+	auto& searchPath = *watch.pSearchPath;
+
+	char szName[ MAX_PATH ];
+
+	CPathBuffer path;
+
+	std::error_code error;
+
+	for( DWORD uiOffset = 0; uiOffset < uiBytes; )
+	{
+		auto pInfo = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>( reinterpret_cast<const uint8_t*>( watch.buffer ) + uiOffset );
+
+		const int iLength = WideCharToMultiByte( CP_UTF8, 0, pInfo->FileName, static_cast<int>( pInfo->FileNameLength / sizeof( WCHAR ) ),
+												 szName, sizeof( szName ) - 1, nullptr, nullptr );
+
+		if( iLength > 0 )
+		{
+			szName[ iLength ] = '\0';
+
+			switch( pInfo->Action )
+			{
+			case FILE_ACTION_ADDED:
+			case FILE_ACTION_RENAMED_NEW_NAME:
+				{
+					const bool bIsDirectory = path.Set( searchPath.szPath, szName ) && fs::is_directory( fs::u8path( path.Get() ), error );
+
+					AddChange( &searchPath, ChangeType::ADDED, szName, bIsDirectory );
+
+					//Directories that are moved in are reported without their contents.
+					if( bIsDirectory )
+						AddDirectory( searchPath, szName, true );
+
+					break;
+				}
+
+			case FILE_ACTION_REMOVED:
+			case FILE_ACTION_RENAMED_OLD_NAME:
+				{
+					AddChange( &searchPath, ChangeType::REMOVED, szName, false );
+					break;
+				}
+
+			case FILE_ACTION_MODIFIED:
+				{
+					AddChange( &searchPath, ChangeType::MODIFIED, szName, false );
+					break;
+				}
+
+			default: break;
+			}
+		}
+
+		if( pInfo->NextEntryOffset == 0 )
+			break;
+
+		uiOffset += pInfo->NextEntryOffset;
+	}
+}
+
+void CDirectoryWatcher::CloseWatch( Watch_t& watch )
+{
+	if( watch.hDirectory != INVALID_HANDLE_VALUE )
+	{
+		//Wait for cancelled reads to finish before the buffer goes away.
+		if( watch.bPending )
+		{
+			DWORD uiBytes;
+			GetOverlappedResult( watch.hDirectory, &watch.overlapped, &uiBytes, TRUE );
+
+			watch.bPending = false;
+		}
+
+		CloseHandle( watch.hDirectory );
+		watch.hDirectory = INVALID_HANDLE_VALUE;
+	}
+
+	if( watch.overlapped.hEvent )
+	{
+		CloseHandle( watch.overlapped.hEvent );
+		watch.overlapped.hEvent = nullptr;
+	}
+}
+#elif defined( __linux__ )
+namespace
+{
+//Writes are only reported once the file is closed, so files that are being written don't flood the queue.
+const uint32_t WATCH_MASK = IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ATTRIB | IN_ONLYDIR;
+}
+
+bool CDirectoryWatcher::AddPath( CSearchPath& searchPath )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_iNotifyFD == -1 )
+	{
+		m_iNotifyFD = inotify_init1( IN_NONBLOCK | IN_CLOEXEC );
+
+		if( m_iNotifyFD == -1 )
+			return false;
+
+		if( pipe2( m_WakePipe, O_CLOEXEC ) != 0 )
+		{
+			close( m_iNotifyFD );
+			m_iNotifyFD = -1;
+			return false;
+		}
+	}
+
+	if( !AddDirectory( searchPath, std::string(), false ) )
+	{
+		//Partially watched paths would miss changes, so don't watch it at all.
+		RemoveWatches( searchPath, nullptr );
+		return false;
+	}
+
+	StartWorker();
+
+	return true;
+}
+
+void CDirectoryWatcher::RemovePath( const CSearchPath& searchPath )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	RemoveWatches( searchPath, nullptr );
+
+	m_Changes.erase( std::remove_if( m_Changes.begin(), m_Changes.end(),
+		[ & ]( const Change_t& change )
+		{
+			return change.pSearchPath == &searchPath;
+		}
+	), m_Changes.end() );
+
+	m_bHasChanges.store( !m_Changes.empty(), std::memory_order_release );
+}
+
+void CDirectoryWatcher::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bShutdown = true;
+	}
+
+	if( m_Thread.joinable() )
+	{
+		const char wake = 0;
+
+		while( write( m_WakePipe[ 1 ], &wake, sizeof( wake ) ) < 0 && errno == EINTR )
+		{
+		}
+
+		m_Thread.join();
+	}
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	//Closing the descriptor removes all watches.
+	if( m_iNotifyFD != -1 )
+	{
+		close( m_iNotifyFD );
+		m_iNotifyFD = -1;
+
+		close( m_WakePipe[ 0 ] );
+		close( m_WakePipe[ 1 ] );
+
+		m_WakePipe[ 0 ] = m_WakePipe[ 1 ] = -1;
+	}
+
+	m_Watches.clear();
+
+	m_Changes.clear();
+
+	m_bHasChanges.store( false, std::memory_order_release );
+}
+
+void CDirectoryWatcher::WorkerThread()
+{
+	alignas( struct inotify_event ) char buffer[ 64 * 1024 ];
+
+	pollfd fds[ 2 ] =
+	{
+		{ m_iNotifyFD, POLLIN, 0 },
+		{ m_WakePipe[ 0 ], POLLIN, 0 }
+	};
+
+	while( true )
+	{
+		if( poll( fds, 2, -1 ) < 0 )
+		{
+			if( errno == EINTR )
+				continue;
+
+			break;
+		}
+
+		if( fds[ 1 ].revents )
+			break;
+
+		const auto iBytes = read( m_iNotifyFD, buffer, sizeof( buffer ) );
+
+		if( iBytes <= 0 )
+			continue;
+
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( m_bShutdown )
+			break;
+
+		for( ssize_t iOffset = 0; iOffset < iBytes; )
+		{
+			const auto& event = *reinterpret_cast<const struct inotify_event*>( buffer + iOffset );
+
+			ProcessEvent( event );
+
+			iOffset += sizeof( struct inotify_event ) + event.len;
+		}
+	}
+}
+
+void CDirectoryWatcher::ProcessEvent( const struct inotify_event& event )
+{
+	if( event.mask & IN_Q_OVERFLOW )
+	{
+		std::vector<CSearchPath*> searchPaths;
+
+		for( const auto& watch : m_Watches )
+		{
+			if( std::find( searchPaths.begin(), searchPaths.end(), watch.second.pSearchPath ) == searchPaths.end() )
+				searchPaths.push_back( watch.second.pSearchPath );
+		}
+
+		for( auto pSearchPath : searchPaths )
+		{
+			AddChange( pSearchPath, ChangeType::RESCAN, std::string(), true );
+		}
+
+		return;
+	}
+
+	auto it = m_Watches.find( event.wd );
+
+	//Events can still arrive for watches that were just removed.
+	if( it == m_Watches.end() )
+		return;
+
+	//The directory was removed, or its watch was.
+	if( event.mask & IN_IGNORED )
+	{
+		m_Watches.erase( it );
+		return;
+	}
+
+	if( event.len == 0 || !*event.name )
+		return;
+
+	auto& searchPath = *it->second.pSearchPath;
+
+	auto szFileName = MakeRelativeName( it->second.szDirectory, event.name );
+
+	const bool bIsDirectory = ( event.mask & IN_ISDIR ) != 0;
+
+	if( event.mask & ( IN_CREATE | IN_MOVED_TO ) )
+	{
+		AddChange( &searchPath, ChangeType::ADDED, std::string( szFileName ), bIsDirectory );
+
+		//Directories that are moved in are reported without their contents, and files can be created before the watch exists.
+		if( bIsDirectory && !AddDirectory( searchPath, szFileName, true ) )
+		{
+			RemoveWatches( searchPath, nullptr );
+			AddChange( &searchPath, ChangeType::LOST, std::string(), true );
+		}
+	}
+	else if( event.mask & ( IN_DELETE | IN_MOVED_FROM ) )
+	{
+		//Watches below a directory that was moved out would keep reporting changes under the old name.
+		if( bIsDirectory && ( event.mask & IN_MOVED_FROM ) )
+			RemoveWatches( searchPath, szFileName.c_str() );
+
+		AddChange( &searchPath, ChangeType::REMOVED, std::move( szFileName ), bIsDirectory );
+	}
+	else if( ( event.mask & ( IN_CLOSE_WRITE | IN_ATTRIB ) ) && !bIsDirectory )
+	{
+		AddChange( &searchPath, ChangeType::MODIFIED, std::move( szFileName ), false );
+	}
+}
+
+bool CDirectoryWatcher::AddDirectory( CSearchPath& searchPath, const std::string& szDirectory, const bool bReportContents )
+{
+	CPathBuffer path;
+
+	if( !path.Set( searchPath.szPath, szDirectory.c_str() ) )
+		return false;
+
+	const int iWatch = inotify_add_watch( m_iNotifyFD, path.Get(), WATCH_MASK );
+
+	if( iWatch == -1 )
+	{
+		//Removed before it could be watched, so there is nothing to miss.
+		return errno == ENOENT || errno == ENOTDIR;
+	}
+
+	m_Watches[ iWatch ] = { &searchPath, szDirectory };
+
+	std::error_code error;
+
+	fs::directory_iterator it( path.Get(), error );
+
+	if( error )
+		return true;
+
+	for( fs::directory_iterator end; it != end; it.increment( error ) )
+	{
+		if( error )
+			break;
+
+		const auto szName = it->path().filename().u8string();
+
+		auto szFileName = MakeRelativeName( szDirectory, szName.c_str() );
+
+		if( bReportContents )
+			AddChange( &searchPath, ChangeType::ADDED, std::string( szFileName ), fs::is_directory( it->status( error ) ) );
+
+		//Symbolic links aren't followed, just like when search paths are indexed.
+		if( fs::is_directory( it->symlink_status( error ) ) && !AddDirectory( searchPath, szFileName, bReportContents ) )
+			return false;
+	}
+
+	return true;
+}
+
+void CDirectoryWatcher::RemoveWatches( const CSearchPath& searchPath, const char* pszDirectory )
+{
+	const size_t uiLength = pszDirectory ? strlen( pszDirectory ) : 0;
+
+	for( auto it = m_Watches.begin(); it != m_Watches.end(); )
+	{
+		const auto& watch = it->second;
+
+		const bool bMatches = watch.pSearchPath == &searchPath &&
+			( !pszDirectory ||
+			( !strncmp( watch.szDirectory.c_str(), pszDirectory, uiLength ) &&
+			( watch.szDirectory[ uiLength ] == '\0' || watch.szDirectory[ uiLength ] == '/' ) ) );
+
+		if( bMatches )
+		{
+			inotify_rm_watch( m_iNotifyFD, it->first );
+			it = m_Watches.erase( it );
+		}
+		else
+			++it;
+	}
+}
+#else
+bool CDirectoryWatcher::AddPath( CSearchPath& searchPath )
+{
+	return false;
+}
+
+void CDirectoryWatcher::RemovePath( const CSearchPath& searchPath )
+{
+}
+
+void CDirectoryWatcher::Shutdown()
+{
+}
+
+void CDirectoryWatcher::WorkerThread()
+{
+}
+
+bool CDirectoryWatcher::AddDirectory( CSearchPath& searchPath, const std::string& szDirectory, const bool bReportContents )
+{
+	return false;
+}
+
+void CDirectoryWatcher::RemoveWatches( const CSearchPath& searchPath, const char* pszDirectory )
+{
+}
+#endif
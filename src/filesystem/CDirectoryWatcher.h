@@ -0,0 +1,218 @@
+#ifndef FILESYSTEM_CDIRECTORYWATCHER_H
+#define FILESYSTEM_CDIRECTORYWATCHER_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "Platform.h"
+
+struct CSearchPath;
+
+/**
+*	Watches loose search paths for files that are created, removed, renamed or modified outside of the filesystem.
+*	Changes are collected on a background thread and applied to the path index by the filesystem,
+*	so lookups that miss the index don't have to probe the disk.
+*	Uses inotify on Linux and ReadDirectoryChangesW on Windows. Paths can't be watched on other platforms.
+*/
+class CDirectoryWatcher
+{
+public:
+	enum class ChangeType
+	{
+		/**
+		*	A file or directory was created or moved into the search path.
+		*/
+		ADDED,
+
+		/**
+		*	A file or directory was removed or moved out of the search path. Anything below a directory is gone as well.
+		*/
+		REMOVED,
+
+		/**
+		*	A file's contents or attributes changed. Reported once the file is closed after writing, or its time is changed.
+		*/
+		MODIFIED,
+
+		/**
+		*	Changes were lost, so the search path has to be scanned again.
+		*/
+		RESCAN,
+
+		/**
+		*	The search path can no longer be watched.
+		*/
+		LOST
+	};
+
+	struct Change_t
+	{
+		CSearchPath* pSearchPath;
+
+		ChangeType type;
+
+		/**
+		*	Name of the file or directory, relative to the search path. Empty if the change affects the whole search path.
+		*/
+		std::string szFileName;
+
+		bool bIsDirectory;
+	};
+
+public:
+	CDirectoryWatcher() = default;
+	~CDirectoryWatcher();
+
+	/**
+	*	Starts watching a loose search path, including all of its subdirectories.
+	*	Should be called before the search path is indexed, so nothing created in between is missed.
+	*	@return Whether the search path is being watched.
+	*/
+	bool AddPath( CSearchPath& searchPath );
+
+	/**
+	*	Stops watching a search path. Changes to it that haven't been retrieved yet are discarded.
+	*/
+	void RemovePath( const CSearchPath& searchPath );
+
+	/**
+	*	Stops watching all search paths and stops the worker thread.
+	*	The thread is restarted if a path is added.
+	*/
+	void Shutdown();
+
+	/**
+	*	@return Whether there are changes to retrieve. Cheap enough to check on every lookup.
+	*/
+	bool HasChanges() const { return m_bHasChanges.load( std::memory_order_acquire ); }
+
+	/**
+	*	Retrieves all changes, in the order they happened.
+	*/
+	void GetChanges( std::vector<Change_t>& changes );
+
+private:
+	struct Watch_t
+	{
+		CSearchPath* pSearchPath;
+
+		/**
+		*	Watched directory, relative to the search path. Empty for the search path itself.
+		*/
+		std::string szDirectory;
+
+#ifdef WIN32
+		HANDLE hDirectory = INVALID_HANDLE_VALUE;
+
+		OVERLAPPED overlapped;
+
+		/**
+		*	Whether a read of changes is in progress.
+		*/
+		bool bPending = false;
+
+		/**
+		*	Receives change records. ReadDirectoryChangesW requires DWORD alignment.
+		*/
+		DWORD buffer[ 16 * 1024 ];
+#endif
+	};
+
+private:
+	/**
+	*	Starts the worker if needed. Must be called with the mutex held.
+	*/
+	void StartWorker();
+
+	void WorkerThread();
+
+	/**
+	*	Queues a change. Must be called with the mutex held.
+	*/
+	void AddChange( CSearchPath* pSearchPath, ChangeType type, std::string&& szFileName, bool bIsDirectory );
+
+	/**
+	*	Starts watching a directory of a search path. Must be called with the mutex held.
+	*	@param szDirectory Directory relative to the search path.
+	*	@param bReportContents Whether to queue everything in the directory as added. Used for directories that were moved in.
+	*	@return Whether the directory and all of its subdirectories are being watched.
+	*/
+	bool AddDirectory( CSearchPath& searchPath, const std::string& szDirectory, const bool bReportContents );
+
+	/**
+	*	Stops watching a search path, or one of its directories and everything below it. Must be called with the mutex held.
+	*	@param pszDirectory Directory relative to the search path, or null to stop watching the whole search path.
+	*/
+	void RemoveWatches( const CSearchPath& searchPath, const char* pszDirectory );
+
+#ifdef WIN32
+	/**
+	*	Starts the next read of changes. Must be called with the mutex held.
+	*/
+	static bool ReadChanges( Watch_t& watch );
+
+	/**
+	*	Queues the changes read for a watch. Must be called with the mutex held.
+	*/
+	void ProcessChanges( Watch_t& watch, const DWORD uiBytes );
+
+	static void CloseWatch( Watch_t& watch );
+#elif defined( __linux__ )
+	/**
+	*	Queues the change described by an inotify event. Must be called with the mutex held.
+	*/
+	void ProcessEvent( const struct inotify_event& event );
+#endif
+
+private:
+	std::mutex m_Mutex;
+
+	std::vector<Change_t> m_Changes;
+
+	std::atomic<bool> m_bHasChanges{ false };
+
+	std::thread m_Thread;
+
+	bool m_bShutdown = false;
+
+#ifdef WIN32
+	/**
+	*	One watch per search path; each watches its whole tree.
+	*/
+	std::vector<std::unique_ptr<Watch_t>> m_Watches;
+
+	/**
+	*	Watches that were removed while the worker may still be waiting on them. The worker closes them.
+	*/
+	std::vector<std::unique_ptr<Watch_t>> m_RemovedWatches;
+
+	/**
+	*	Wakes the worker when watches are added or removed, or when shutting down.
+	*/
+	HANDLE m_hWakeEvent = nullptr;
+#elif defined( __linux__ )
+	/**
+	*	One watch per directory, by watch descriptor.
+	*/
+	std::unordered_map<int, Watch_t> m_Watches;
+
+	int m_iNotifyFD = -1;
+
+	/**
+	*	Written to when shutting down to wake the worker.
+	*/
+	int m_WakePipe[ 2 ] = { -1, -1 };
+#endif
+
+private:
+	CDirectoryWatcher( const CDirectoryWatcher& ) = delete;
+	CDirectoryWatcher& operator=( const CDirectoryWatcher& ) = delete;
+};
+
+#endif //FILESYSTEM_CDIRECTORYWATCHER_H
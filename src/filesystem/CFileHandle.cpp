@@ -1,9 +1,18 @@
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 
+#ifdef WIN32
+#include <io.h>
+#endif
+
+#include "CBlockCache.h"
 #include "CFileSystem.h"
 
 #include "CFileHandle.h"
 
+const size_t CFileHandle::READ_AHEAD_SIZE;
+
 CFileHandle::CFileHandle( CFileSystem& fileSystem, const char* pszFileName, const char* pszMode, const bool bIsPackFile )
 {
 	assert( pszFileName );
@@ -29,6 +38,24 @@ CFileHandle::CFileHandle( CFileSystem& fileSystem, const char* pszFileName, cons
 	}
 }
 
+CFileHandle::CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, FILE* pFile, uint64_t uiLength )
+{
+	assert( pFile );
+
+	m_pFile = pFile;
+
+	if( m_pFile )
+	{
+		m_szFileName = std::move( szFileName );
+
+		m_uiLength = uiLength;
+	}
+	else
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "CFileHandle::CFileHandle: Null FILE* for file \"%s\"!\n", szFileName.c_str() );
+	}
+}
+
 CFileHandle::CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, FILE* pFile, uint64_t uiStartOffset, uint64_t uiLength )
 {
 	assert( pFile );
@@ -43,9 +70,6 @@ CFileHandle::CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, FIL
 		m_uiLength = uiLength;
 
 		m_Flags |= FileHandleFlag::IS_PACK_ENTRY;
-
-		//TODO: use 64 bit seek - Solokiller
-		fseek( m_pFile, static_cast<long>( m_uiStartOffset ), SEEK_SET );
 	}
 	else
 	{
@@ -53,6 +77,75 @@ CFileHandle::CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, FIL
 	}
 }
 
+CFileHandle::CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, FILE* pFile, const uint8_t* pData, uint64_t uiStartOffset, uint64_t uiLength )
+{
+	assert( pFile );
+	assert( pData );
+
+	if( pFile && pData )
+	{
+		m_pFile = pFile;
+
+		m_szFileName = std::move( szFileName );
+
+		m_uiStartOffset = uiStartOffset;
+		m_uiLength = uiLength;
+
+		m_pData = pData;
+
+		m_Flags |= FileHandleFlag::IS_PACK_ENTRY | FileHandleFlag::IS_MAPPED;
+	}
+	else
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "CFileHandle::CFileHandle: Null mapping for pack file entry \"%s\"!\n", szFileName.c_str() );
+	}
+}
+
+CFileHandle::CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, std::unique_ptr<CCompressedEntry>&& entry )
+{
+	assert( entry );
+
+	if( entry && entry->GetFile() )
+	{
+		m_pFile = entry->GetFile();
+
+		m_szFileName = std::move( szFileName );
+
+		m_uiStartOffset = entry->GetStartOffset();
+		m_uiLength = entry->GetLength();
+
+		m_Compressed = std::move( entry );
+
+		m_Flags |= FileHandleFlag::IS_PACK_ENTRY | FileHandleFlag::IS_COMPRESSED;
+	}
+	else
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "CFileHandle::CFileHandle: Null FILE* for compressed pack file entry \"%s\"!\n", szFileName.c_str() );
+	}
+}
+
+CFileHandle::CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, CContentCache::BufferPtr_t contents )
+{
+	assert( contents );
+
+	if( contents )
+	{
+		m_szFileName = std::move( szFileName );
+
+		m_uiLength = contents->uiSize;
+
+		m_pData = contents->data.get();
+
+		m_Contents = std::move( contents );
+
+		m_Flags |= FileHandleFlag::IS_PACK_ENTRY | FileHandleFlag::IS_MAPPED | FileHandleFlag::IS_MEMORY;
+	}
+	else
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "CFileHandle::CFileHandle: Null contents for memory file \"%s\"!\n", szFileName.c_str() );
+	}
+}
+
 CFileHandle::CFileHandle( CFileHandle&& other )
 	: CFileHandle()
 {
@@ -80,13 +173,18 @@ void CFileHandle::Close()
 			fclose( m_pFile );
 		}
 
-		m_pFile = nullptr;
-		m_szFileName.clear();
+		Reset();
+	}
+}
 
-		m_uiStartOffset = m_uiLength = 0;
+FILE* CFileHandle::Detach()
+{
+	FILE* pFile = IsPackEntry() ? nullptr : m_pFile;
 
-		m_Flags = FileHandleFlag::NONE;
-	}
+	if( IsOpen() )
+		Reset();
+
+	return pFile;
 }
 
 void CFileHandle::swap( CFileHandle& other )
@@ -97,6 +195,268 @@ void CFileHandle::swap( CFileHandle& other )
 		std::swap( m_szFileName, other.m_szFileName );
 		std::swap( m_uiStartOffset, other.m_uiStartOffset );
 		std::swap( m_uiLength, other.m_uiLength );
+		std::swap( m_pData, other.m_pData );
+		std::swap( m_uiPosition, other.m_uiPosition );
+		std::swap( m_pEntry, other.m_pEntry );
+		std::swap( m_pBlockCache, other.m_pBlockCache );
+		std::swap( m_Compressed, other.m_Compressed );
+		std::swap( m_Direct, other.m_Direct );
+		std::swap( m_Contents, other.m_Contents );
+		std::swap( m_ReadBuffer, other.m_ReadBuffer );
+		std::swap( m_ReadAhead, other.m_ReadAhead );
+		std::swap( m_uiReadAheadCapacity, other.m_uiReadAheadCapacity );
+		std::swap( m_uiReadAheadOffset, other.m_uiReadAheadOffset );
+		std::swap( m_uiReadAheadSize, other.m_uiReadAheadSize );
+		std::swap( m_pStats, other.m_pStats );
+		std::swap( m_uiTime, other.m_uiTime );
+		std::swap( m_uiBytesRead, other.m_uiBytesRead );
 		std::swap( m_Flags, other.m_Flags );
 	}
 }
+
+void CFileHandle::SetPosition( uint64_t uiPosition )
+{
+	const uint64_t uiBufferStart = m_uiPosition - m_uiReadAheadOffset;
+
+	if( uiPosition >= uiBufferStart && uiPosition - uiBufferStart <= m_uiReadAheadSize )
+	{
+		m_uiReadAheadOffset = static_cast<size_t>( uiPosition - uiBufferStart );
+		m_uiPosition = uiPosition;
+		return;
+	}
+
+	m_uiReadAheadOffset = m_uiReadAheadSize = 0;
+	m_uiPosition = uiPosition;
+
+	//Loose files read from the file's position, so it has to be moved as well.
+	if( IsReadAhead() && !IsPackEntry() )
+		fseek64( m_pFile, uiPosition, SEEK_SET );
+}
+
+void CFileHandle::DiscardReadAhead()
+{
+	if( HasReadAheadData() && !IsPackEntry() )
+		fseek64( m_pFile, m_uiPosition, SEEK_SET );
+
+	m_uiReadAheadOffset = m_uiReadAheadSize = 0;
+}
+
+size_t CFileHandle::ReadBuffered( void* pBuffer, size_t uiSize )
+{
+	auto pOutput = reinterpret_cast<uint8_t*>( pBuffer );
+
+	size_t uiRead = 0;
+
+	while( uiRead < uiSize )
+	{
+		if( HasReadAheadData() )
+		{
+			const auto uiCount = std::min( uiSize - uiRead, m_uiReadAheadSize - m_uiReadAheadOffset );
+
+			memcpy( pOutput + uiRead, m_ReadAhead.get() + m_uiReadAheadOffset, uiCount );
+
+			m_uiReadAheadOffset += uiCount;
+			m_uiPosition += uiCount;
+			uiRead += uiCount;
+			continue;
+		}
+
+		//Large reads don't benefit from buffering.
+		if( uiSize - uiRead >= READ_AHEAD_SIZE )
+		{
+			uiRead += ReadUnbuffered( pOutput + uiRead, uiSize - uiRead );
+			break;
+		}
+
+		if( !FillReadAhead() )
+			break;
+	}
+
+	return uiRead;
+}
+
+size_t CFileHandle::ReadLineBuffered( char* pszBuffer, size_t uiMaxCount )
+{
+	size_t uiRead = 0;
+
+	while( uiRead < uiMaxCount )
+	{
+		if( !HasReadAheadData() && !FillReadAhead() )
+			break;
+
+		const auto pszStart = reinterpret_cast<const char*>( m_ReadAhead.get() + m_uiReadAheadOffset );
+
+		auto uiCount = std::min( uiMaxCount - uiRead, m_uiReadAheadSize - m_uiReadAheadOffset );
+
+		auto pszNewline = reinterpret_cast<const char*>( memchr( pszStart, '\n', uiCount ) );
+
+		if( pszNewline )
+			uiCount = static_cast<size_t>( pszNewline - pszStart ) + 1;
+
+		memcpy( pszBuffer + uiRead, pszStart, uiCount );
+
+		m_uiReadAheadOffset += uiCount;
+		m_uiPosition += uiCount;
+		uiRead += uiCount;
+
+		if( pszNewline )
+			break;
+	}
+
+	return uiRead;
+}
+
+bool CFileHandle::FillReadAhead()
+{
+	assert( !HasReadAheadData() );
+
+	m_uiReadAheadOffset = m_uiReadAheadSize = 0;
+
+	size_t uiCount = READ_AHEAD_SIZE;
+
+	if( IsPackEntry() )
+	{
+		if( m_uiPosition >= m_uiLength )
+			return false;
+
+		uiCount = static_cast<size_t>( std::min<uint64_t>( uiCount, m_uiLength - m_uiPosition ) );
+	}
+
+	//Small files don't need the whole buffer.
+	if( !m_ReadAhead )
+	{
+		m_uiReadAheadCapacity = static_cast<size_t>( std::min<uint64_t>( READ_AHEAD_SIZE, std::max<uint64_t>( m_uiLength, 1 ) ) );
+		m_ReadAhead.reset( new uint8_t[ m_uiReadAheadCapacity ] );
+	}
+
+	uiCount = std::min( uiCount, m_uiReadAheadCapacity );
+
+	if( IsPackEntry() )
+		m_uiReadAheadSize = ReadEntry( m_ReadAhead.get(), uiCount, m_uiPosition );
+	else
+		m_uiReadAheadSize = fread( m_ReadAhead.get(), 1, uiCount, m_pFile );
+
+	return m_uiReadAheadSize > 0;
+}
+
+size_t CFileHandle::ReadUnbuffered( void* pBuffer, size_t uiSize )
+{
+	assert( !HasReadAheadData() );
+
+	size_t uiRead;
+
+	if( IsPackEntry() )
+	{
+		if( m_uiPosition >= m_uiLength )
+			return 0;
+
+		uiRead = ReadEntry( pBuffer, static_cast<size_t>( std::min<uint64_t>( uiSize, m_uiLength - m_uiPosition ) ), m_uiPosition );
+	}
+	else
+	{
+		uiRead = fread( pBuffer, 1, uiSize, m_pFile );
+	}
+
+	//The buffer is empty, so it starts at the new position.
+	m_uiReadAheadOffset = m_uiReadAheadSize = 0;
+	m_uiPosition += uiRead;
+
+	return uiRead;
+}
+
+void CFileHandle::Reset()
+{
+	m_pFile = nullptr;
+	m_szFileName.clear();
+
+	m_uiStartOffset = m_uiLength = 0;
+
+	m_pData = nullptr;
+	m_uiPosition = 0;
+
+	m_pEntry = nullptr;
+
+	m_pBlockCache = nullptr;
+
+	m_Compressed.reset();
+
+	m_Direct.reset();
+
+	m_Contents.reset();
+
+	m_ReadBuffer = ReadBuffer_t();
+
+	m_ReadAhead.reset();
+	m_uiReadAheadCapacity = m_uiReadAheadOffset = m_uiReadAheadSize = 0;
+
+	m_pStats = nullptr;
+	m_uiTime = m_uiBytesRead = 0;
+
+	m_Flags = FileHandleFlag::NONE;
+}
+
+size_t CFileHandle::ReadEntry( void* pBuffer, size_t uiSize, uint64_t uiPosition )
+{
+	if( m_Compressed )
+		return m_Compressed->Read( pBuffer, uiSize, uiPosition );
+
+	if( m_pData )
+	{
+		memcpy( pBuffer, m_pData + uiPosition, uiSize );
+
+		return uiSize;
+	}
+
+	if( m_Direct )
+		return m_Direct->Read( pBuffer, uiSize, uiPosition );
+
+	return CBlockCache::Read( m_pBlockCache, m_pFile, pBuffer, uiSize, m_uiStartOffset + uiPosition );
+}
+
+size_t CFileHandle::ReadAt( FILE* pFile, void* pBuffer, size_t uiSize, uint64_t uiOffset )
+{
+	if( !pFile )
+		return 0;
+
+	size_t uiRead = 0;
+
+#ifdef WIN32
+	auto hFile = reinterpret_cast<HANDLE>( _get_osfhandle( _fileno( pFile ) ) );
+
+	while( uiRead < uiSize )
+	{
+		OVERLAPPED overlapped{};
+
+		const uint64_t uiPosition = uiOffset + uiRead;
+
+		overlapped.Offset = static_cast<DWORD>( uiPosition & 0xFFFFFFFF );
+		overlapped.OffsetHigh = static_cast<DWORD>( uiPosition >> 32 );
+
+		const auto uiToRead = static_cast<DWORD>( std::min<size_t>( uiSize - uiRead, 0x7FFFFFFF ) );
+
+		DWORD uiResult = 0;
+
+		if( !ReadFile( hFile, reinterpret_cast<uint8_t*>( pBuffer ) + uiRead, uiToRead, &uiResult, &overlapped ) || uiResult == 0 )
+			break;
+
+		uiRead += uiResult;
+	}
+#else
+	const int fd = fileno( pFile );
+
+	while( uiRead < uiSize )
+	{
+		const auto result = pread64( fd, reinterpret_cast<uint8_t*>( pBuffer ) + uiRead, uiSize - uiRead, static_cast<off64_t>( uiOffset + uiRead ) );
+
+		if( result < 0 && errno == EINTR )
+			continue;
+
+		if( result <= 0 )
+			break;
+
+		uiRead += static_cast<size_t>( result );
+	}
+#endif
+
+	return uiRead;
+}
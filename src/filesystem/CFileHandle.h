@@ -3,9 +3,17 @@
 
 #include <cstdio>
 #include <cstdint>
+#include <memory>
 #include <string>
 
+#include "CCompressedEntry.h"
+#include "CContentCache.h"
+#include "CDirectStream.h"
+#include "CFileSystemStats.h"
+
+class CBlockCache;
 class CFileSystem;
+class CPackFileEntry;
 
 typedef uint32_t FileHandleFlags_t;
 
@@ -23,6 +31,40 @@ enum : FileHandleFlags_t
 	*	This is a file in a pack file.
 	*/
 	IS_PACK_ENTRY	= 1 << 1,
+
+	/**
+	*	This is a file in a memory mapped pack file. Reads are served from the mapping.
+	*/
+	IS_MAPPED		= 1 << 2,
+
+	/**
+	*	This is a compressed file in a pack file. Reads decompress the data.
+	*/
+	IS_COMPRESSED	= 1 << 3,
+
+	/**
+	*	Reads go through a read-ahead buffer, and the handle keeps the position.
+	*	Used for pack entries that aren't mapped or compressed, and loose files opened for reading only.
+	*/
+	READ_AHEAD		= 1 << 4,
+
+	/**
+	*	Writes are buffered and written out on a background thread. The file must be flushed before it's used directly.
+	*	Used for loose files opened for writing only, if write-behind is enabled.
+	*/
+	WRITE_BEHIND	= 1 << 5,
+
+	/**
+	*	The file is kept open in the descriptor cache when the handle is closed.
+	*	Used for loose files opened for binary reading only, if loose file caching is enabled.
+	*/
+	CACHE_DESCRIPTOR	= 1 << 6,
+
+	/**
+	*	This is a file in a memory search path. Also flagged as a mapped pack entry, since reads are served from its contents the same way.
+	*	There is no file, so the handle keeps the contents alive instead.
+	*/
+	IS_MEMORY			= 1 << 7,
 };
 }
 
@@ -31,6 +73,27 @@ enum : FileHandleFlags_t
 */
 class CFileHandle
 {
+public:
+	/**
+	*	Buffer handed out by GetReadBuffer. Mapped pack entries hand out their mapping instead, and only use the reference count.
+	*	If read buffers are shared, the contents are in shared instead of data.
+	*/
+	struct ReadBuffer_t
+	{
+		std::unique_ptr<uint8_t[]> data;
+		size_t uiCapacity = 0;
+		uint32_t uiRefCount = 0;
+
+		CContentCache::BufferPtr_t shared;
+
+		const uint8_t* Get() const { return shared ? shared->data.get() : data.get(); }
+	};
+
+	/**
+	*	Largest amount of data that is read ahead at once.
+	*/
+	static const size_t READ_AHEAD_SIZE = 64 * 1024;
+
 public:
 	/**
 	*	Constructs a handle that points to no file.
@@ -42,11 +105,34 @@ public:
 	*/
 	CFileHandle( CFileSystem& fileSystem, const char* pszFileName, const char* pszMode, const bool bIsPackFile = false );
 
+	/**
+	*	Constructs a handle that points to a loose file with the given name, which is already open. Takes ownership of the file.
+	*/
+	CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, FILE* pFile, uint64_t uiLength );
+
 	/**
 	*	Constructs a handle that points to a file with the given name within the given file. The given offset and length are used.
 	*/
 	CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, FILE* pFile, uint64_t uiStartOffset, uint64_t uiLength );
 
+	/**
+	*	Constructs a handle that points to a file with the given name within the given file, which is mapped into memory.
+	*	@param pData Pointer to the start of the file's data in the mapping.
+	*/
+	CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, FILE* pFile, const uint8_t* pData, uint64_t uiStartOffset, uint64_t uiLength );
+
+	/**
+	*	Constructs a handle that points to a compressed file with the given name within a pack file.
+	*	@param entry Opened entry. The handle's length is the uncompressed length.
+	*/
+	CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, std::unique_ptr<CCompressedEntry>&& entry );
+
+	/**
+	*	Constructs a handle that points to a file with the given name in a memory search path.
+	*	@param contents Contents of the file. The handle holds on to them, so they stay valid if the file is replaced or removed.
+	*/
+	CFileHandle( CFileSystem& fileSystem, std::string&& szFileName, CContentCache::BufferPtr_t contents );
+
 	CFileHandle( CFileHandle&& other );
 	CFileHandle& operator=( CFileHandle&& other );
 
@@ -63,6 +149,86 @@ public:
 
 	inline uint64_t GetLength() const { return m_uiLength; }
 
+	/**
+	*	@return If this is a mapped pack entry or a memory file, the file's data. Otherwise, null.
+	*/
+	inline const uint8_t* GetData() const { return m_pData; }
+
+	/**
+	*	@return If this is a memory file, its contents. Otherwise, null.
+	*/
+	inline const CContentCache::BufferPtr_t& GetMemoryContents() const { return m_Contents; }
+
+	/**
+	*	@return If this is a pack entry, the entry it was opened from. Otherwise, null.
+	*/
+	inline const CPackFileEntry* GetPackEntry() const { return m_pEntry; }
+
+	inline void SetPackEntry( const CPackFileEntry* pEntry ) { m_pEntry = pEntry; }
+
+	/**
+	*	Sets the cache that reads of an unmapped, uncompressed pack entry go through. Null to read directly.
+	*/
+	inline void SetBlockCache( CBlockCache* pBlockCache ) { m_pBlockCache = pBlockCache; }
+
+	/**
+	*	Sets the stream that reads of an unmapped, uncompressed pack entry go through. Null to read from the pack file.
+	*/
+	inline void SetDirectStream( std::unique_ptr<CDirectStream>&& stream ) { m_Direct = std::move( stream ); }
+
+	/**
+	*	@return If this is a compressed pack entry, the entry. Otherwise, null.
+	*/
+	inline const CCompressedEntry* GetCompressedEntry() const { return m_Compressed.get(); }
+
+	/**
+	*	@return If this is a pack entry, the position relative to the start of the entry.
+	*	Pack entries keep their own position so entries from the same pack file don't affect each other.
+	*	Loose files that read ahead keep the position as well, since the file's position is past the buffered data.
+	*/
+	inline uint64_t GetPosition() const { return m_uiPosition; }
+
+	/**
+	*	Sets the position. Buffered data is kept if the position is in it.
+	*/
+	void SetPosition( uint64_t uiPosition );
+
+	/**
+	*	Discards buffered data. Loose files are moved back to the position.
+	*/
+	void DiscardReadAhead();
+
+	inline ReadBuffer_t& GetReadBuffer() { return m_ReadBuffer; }
+
+	/**
+	*	@return Counters of the search path that provides this file, or null if it isn't tracked.
+	*/
+	inline CFileSystemStats::PathCounters_t* GetStats() const { return m_pStats; }
+
+	inline void SetStats( CFileSystemStats::PathCounters_t* pStats ) { m_pStats = pStats; }
+
+	/**
+	*	@return Time spent opening and reading this file, in microseconds.
+	*/
+	inline uint64_t GetTime() const { return m_uiTime; }
+
+	inline uint64_t GetBytesRead() const { return m_uiBytesRead; }
+
+	/**
+	*	Adds the cost of an operation to this file and its search path.
+	*/
+	inline void AddTime( uint64_t uiTime, uint64_t uiBytesRead = 0 )
+	{
+		m_uiTime += uiTime;
+		m_uiBytesRead += uiBytesRead;
+
+		if( m_pStats )
+		{
+			m_pStats->uiTime.fetch_add( uiTime, std::memory_order_relaxed );
+			m_pStats->uiBytesRead.fetch_add( uiBytesRead, std::memory_order_relaxed );
+		}
+	}
+
 	inline FileHandleFlags_t GetFlags() const { return m_Flags; }
 
 	void SetFlags( const FileHandleFlags_t flags );
@@ -73,16 +239,103 @@ public:
 
 	inline bool IsPackEntry() const { return ( m_Flags & FileHandleFlag::IS_PACK_ENTRY ) != 0; }
 
+	inline bool IsMapped() const { return ( m_Flags & FileHandleFlag::IS_MAPPED ) != 0; }
+
+	inline bool IsCompressed() const { return ( m_Flags & FileHandleFlag::IS_COMPRESSED ) != 0; }
+
+	inline bool IsReadAhead() const { return ( m_Flags & FileHandleFlag::READ_AHEAD ) != 0; }
+
+	inline bool IsWriteBehind() const { return ( m_Flags & FileHandleFlag::WRITE_BEHIND ) != 0; }
+
+	inline bool IsDescriptorCached() const { return ( m_Flags & FileHandleFlag::CACHE_DESCRIPTOR ) != 0; }
+
+	inline bool IsMemory() const { return ( m_Flags & FileHandleFlag::IS_MEMORY ) != 0; }
+
+	/**
+	*	@return Whether there is buffered data left to read.
+	*/
+	inline bool HasReadAheadData() const { return m_uiReadAheadOffset < m_uiReadAheadSize; }
+
 	bool IsOpen() const;
 
 	void Close();
 
+	/**
+	*	Closes the handle without closing the file.
+	*	@return The file, which the caller now owns. Null if this is a pack entry, since those don't own their file.
+	*/
+	FILE* Detach();
+
 	bool operator==( const CFileHandle& other ) const;
 
 	bool operator!=( const CFileHandle& other ) const { return !( *this == other ); }
 
 	void swap( CFileHandle& other );
 
+	/**
+	*	Reads from the file at the given absolute offset without using or changing the file position.
+	*	Safe to use on the same file from multiple threads.
+	*	@param pBuffer Buffer to read into.
+	*	@param uiSize Number of bytes to read.
+	*	@param uiOffset Offset in the file to read from.
+	*	@return Number of bytes read.
+	*/
+	size_t ReadAt( void* pBuffer, size_t uiSize, uint64_t uiOffset ) const
+	{
+		return ReadAt( m_pFile, pBuffer, uiSize, uiOffset );
+	}
+
+	/**
+	*	@copydoc ReadAt( void* pBuffer, size_t uiSize, uint64_t uiOffset ) const
+	*	@param pFile File to read from.
+	*/
+	static size_t ReadAt( FILE* pFile, void* pBuffer, size_t uiSize, uint64_t uiOffset );
+
+	/**
+	*	Reads from a pack entry without using or changing the entry's position.
+	*	Mapped entries are copied from the mapping, and compressed entries are decompressed.
+	*	@param pBuffer Buffer to read into.
+	*	@param uiSize Number of bytes to read.
+	*	@param uiPosition Position relative to the start of the entry to read from.
+	*	@return Number of bytes read.
+	*/
+	size_t ReadEntry( void* pBuffer, size_t uiSize, uint64_t uiPosition );
+
+	/**
+	*	Reads from the position through the read-ahead buffer, and advances the position.
+	*	Pack entry reads are clamped to the entry.
+	*	@param pBuffer Buffer to read into.
+	*	@param uiSize Number of bytes to read.
+	*	@return Number of bytes read.
+	*/
+	size_t ReadBuffered( void* pBuffer, size_t uiSize );
+
+	/**
+	*	Reads a line from the position through the read-ahead buffer, and advances the position.
+	*	Reads up to and including the newline. The line is not null terminated.
+	*	@param pszBuffer Buffer to read into.
+	*	@param uiMaxCount Maximum number of characters to read.
+	*	@return Number of characters read.
+	*/
+	size_t ReadLineBuffered( char* pszBuffer, size_t uiMaxCount );
+
+private:
+	/**
+	*	Reads the data at the position into the read-ahead buffer. The buffer must be empty.
+	*	@return Whether any data was read.
+	*/
+	bool FillReadAhead();
+
+	/**
+	*	Reads from the position without buffering, and advances the position. The buffer must be empty.
+	*/
+	size_t ReadUnbuffered( void* pBuffer, size_t uiSize );
+
+	/**
+	*	Resets the handle to point to no file, without closing the file.
+	*/
+	void Reset();
+
 private:
 	FILE* m_pFile = nullptr;
 
@@ -91,6 +344,35 @@ private:
 	uint64_t m_uiStartOffset = 0;
 	uint64_t m_uiLength = 0;
 
+	const uint8_t* m_pData = nullptr;
+	uint64_t m_uiPosition = 0;
+
+	const CPackFileEntry* m_pEntry = nullptr;
+
+	CBlockCache* m_pBlockCache = nullptr;
+
+	std::unique_ptr<CCompressedEntry> m_Compressed;
+
+	std::unique_ptr<CDirectStream> m_Direct;
+
+	CContentCache::BufferPtr_t m_Contents;
+
+	ReadBuffer_t m_ReadBuffer;
+
+	std::unique_ptr<uint8_t[]> m_ReadAhead;
+	size_t m_uiReadAheadCapacity = 0;
+
+	/**
+	*	Offset of the position in the buffered data, and the amount of data buffered.
+	*	The buffered data starts at the position minus the offset.
+	*/
+	size_t m_uiReadAheadOffset = 0;
+	size_t m_uiReadAheadSize = 0;
+
+	CFileSystemStats::PathCounters_t* m_pStats = nullptr;
+	uint64_t m_uiTime = 0;
+	uint64_t m_uiBytesRead = 0;
+
 	FileHandleFlags_t m_Flags = FileHandleFlag::NONE;
 
 private:
@@ -110,7 +392,7 @@ inline void CFileHandle::ClearFlags( const FileHandleFlags_t flags )
 
 inline bool CFileHandle::IsOpen() const
 {
-	return m_pFile != nullptr;
+	return m_pFile != nullptr || IsMemory();
 }
 
 inline bool CFileHandle::operator==( const CFileHandle& other ) const
@@ -0,0 +1,91 @@
+#include "CFileHandleTable.h"
+
+FileHandle_t CFileHandleTable::Add( CFileHandle&& file )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_FreeSlots.empty() )
+	{
+		const size_t uiBlockCount = m_uiBlockCount.load( std::memory_order_relaxed );
+
+		const size_t uiFirstIndex = uiBlockCount * BLOCK_SIZE;
+
+		if( uiFirstIndex >= MAX_HANDLES )
+			return FILESYSTEM_INVALID_HANDLE;
+
+		m_Blocks[ uiBlockCount ] = std::make_unique<Slot_t[]>( BLOCK_SIZE );
+
+		m_uiBlockCount.store( uiBlockCount + 1, std::memory_order_release );
+
+		//Push in reverse so the lowest index is used first.
+		for( size_t uiIndex = BLOCK_SIZE; uiIndex-- > 0; )
+		{
+			if( uiFirstIndex + uiIndex < MAX_HANDLES )
+				m_FreeSlots.push_back( static_cast<uint32_t>( uiFirstIndex + uiIndex ) );
+		}
+	}
+
+	const uint32_t uiIndex = m_FreeSlots.back();
+
+	m_FreeSlots.pop_back();
+
+	auto& slot = GetSlot( uiIndex );
+
+	slot.file = std::move( file );
+
+	//Publishes the file to Get.
+	slot.bInUse.store( true, std::memory_order_release );
+
+	++m_uiCount;
+
+	//Index is stored plus one so no valid handle is ever FILESYSTEM_INVALID_HANDLE.
+	const uintptr_t value = ( static_cast<uintptr_t>( slot.uiGeneration.load( std::memory_order_relaxed ) ) << GENERATION_SHIFT ) | ( uiIndex + 1 );
+
+	return reinterpret_cast<FileHandle_t>( value );
+}
+
+CFileHandle* CFileHandleTable::Get( FileHandle_t handle ) const
+{
+	const auto value = reinterpret_cast<uintptr_t>( handle );
+
+	const uint32_t uiIndex = static_cast<uint32_t>( value & INDEX_MASK );
+
+	if( uiIndex == 0 || ( value >> GENERATION_SHIFT ) > 0xFFFF )
+		return nullptr;
+
+	if( ( uiIndex - 1 ) >= m_uiBlockCount.load( std::memory_order_acquire ) * BLOCK_SIZE )
+		return nullptr;
+
+	auto& slot = GetSlot( uiIndex - 1 );
+
+	if( !slot.bInUse.load( std::memory_order_acquire ) || slot.uiGeneration.load( std::memory_order_acquire ) != static_cast<uint16_t>( value >> GENERATION_SHIFT ) )
+		return nullptr;
+
+	return &slot.file;
+}
+
+bool CFileHandleTable::Remove( FileHandle_t handle )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto pFile = Get( handle );
+
+	if( !pFile )
+		return false;
+
+	const uint32_t uiIndex = static_cast<uint32_t>( reinterpret_cast<uintptr_t>( handle ) & INDEX_MASK ) - 1;
+
+	auto& slot = GetSlot( uiIndex );
+
+	//Invalidates any copies of the handle before the file goes away.
+	slot.uiGeneration.fetch_add( 1, std::memory_order_release );
+	slot.bInUse.store( false, std::memory_order_release );
+
+	slot.file.Close();
+
+	m_FreeSlots.push_back( uiIndex );
+
+	--m_uiCount;
+
+	return true;
+}
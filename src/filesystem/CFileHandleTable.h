@@ -0,0 +1,128 @@
+#ifndef FILESYSTEM_CFILEHANDLETABLE_H
+#define FILESYSTEM_CFILEHANDLETABLE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "FileSystem.h"
+
+#include "CFileHandle.h"
+
+/**
+*	Table of open file handles.
+*	Handles are stored in fixed size blocks that are never freed, so opening and closing files doesn't allocate once the table has grown.
+*	The FileHandle_t given out encodes the slot index and a generation counter, so stale handles are detected.
+*	Adding and removing files is synchronized. Get doesn't lock, since blocks never move once they are published
+*	and each slot's generation and in use flag are atomic.
+*/
+class CFileHandleTable
+{
+public:
+	/**
+	*	Number of handles allocated at once.
+	*/
+	static const size_t BLOCK_SIZE = 256;
+
+	/**
+	*	Maximum number of handles that can be open at the same time.
+	*/
+	static const size_t MAX_HANDLES = 0xFFFF;
+
+public:
+	CFileHandleTable() = default;
+
+	/**
+	*	Adds a file to the table.
+	*	@param file File to add.
+	*	@return Handle to the file, or FILESYSTEM_INVALID_HANDLE if the table is full.
+	*/
+	FileHandle_t Add( CFileHandle&& file );
+
+	/**
+	*	@return The file for the given handle, or null if the handle is invalid or was already closed.
+	*/
+	CFileHandle* Get( FileHandle_t handle ) const;
+
+	/**
+	*	Removes a file from the table. The file is closed.
+	*	@return Whether the handle was valid.
+	*/
+	bool Remove( FileHandle_t handle );
+
+	/**
+	*	@return Number of open handles.
+	*/
+	size_t GetCount() const
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		return m_uiCount;
+	}
+
+	/**
+	*	Calls the given function for every open file.
+	*/
+	template<typename FUNC>
+	void ForEach( FUNC func ) const;
+
+private:
+	struct Slot_t
+	{
+		CFileHandle file;
+
+		//Only changed with the mutex held, but read by Get without it.
+		std::atomic<uint16_t> uiGeneration{ 0 };
+		std::atomic<bool> bInUse{ false };
+	};
+
+	static const uint32_t INDEX_MASK = 0xFFFF;
+	static const uint32_t GENERATION_SHIFT = 16;
+
+	static const size_t MAX_BLOCKS = ( MAX_HANDLES + BLOCK_SIZE - 1 ) / BLOCK_SIZE;
+
+	Slot_t& GetSlot( const size_t uiIndex ) const
+	{
+		return m_Blocks[ uiIndex / BLOCK_SIZE ][ uiIndex % BLOCK_SIZE ];
+	}
+
+private:
+	mutable std::mutex m_Mutex;
+
+	std::unique_ptr<Slot_t[]> m_Blocks[ MAX_BLOCKS ];
+
+	/**
+	*	Number of blocks that have been allocated. Written after the block is so lock free readers never see a null block.
+	*/
+	std::atomic<size_t> m_uiBlockCount{ 0 };
+
+	std::vector<uint32_t> m_FreeSlots;
+
+	size_t m_uiCount = 0;
+
+private:
+	CFileHandleTable( const CFileHandleTable& ) = delete;
+	CFileHandleTable& operator=( const CFileHandleTable& ) = delete;
+};
+
+template<typename FUNC>
+void CFileHandleTable::ForEach( FUNC func ) const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	for( size_t uiBlock = 0, uiCount = m_uiBlockCount; uiBlock < uiCount; ++uiBlock )
+	{
+		const auto& block = m_Blocks[ uiBlock ];
+
+		for( size_t uiIndex = 0; uiIndex < BLOCK_SIZE; ++uiIndex )
+		{
+			if( block[ uiIndex ].bInUse.load( std::memory_order_relaxed ) )
+				func( block[ uiIndex ].file );
+		}
+	}
+}
+
+#endif //FILESYSTEM_CFILEHANDLETABLE_H
@@ -1,23 +1,93 @@
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdarg>
+#include <ctime>
+#include <iterator>
+#include <limits>
+#include <thread>
+#include <tuple>
 
 #include "interface.h"
 
 #include "ByteSwap.h"
 #include "CCharacterSet.h"
+#include "CRC32C.h"
+#include "CStringPool.h"
+#include "Logging.h"
 #include "PackFile.h"
 #include "StringUtils.h"
+#include "Tokenization.h"
+#include "Tracing.h"
+
+#include "CPathBuffer.h"
+#include "CStreamingPack.h"
 
 #include "CFileSystem.h"
 
 namespace fs = std::experimental::filesystem;
 
+const size_t CFileSystem::MAX_PACK_LOAD_THREADS;
+const size_t CFileSystem::MAX_FIND_THREADS;
+const uint64_t CFileSystem::MAX_BATCH_GAP;
+const uint64_t CFileSystem::MAX_BATCH_READ;
+const size_t CFileSystem::MAX_FIND_HANDLES;
+const uint32_t CFileSystem::FIND_INDEX_MASK;
+const uint32_t CFileSystem::FIND_GENERATION_SHIFT;
+
 namespace
 {
+/**
+*	Directory that load traces are written to.
+*/
+const char LOAD_TRACE_DIR[] = "loadtraces";
+
+const char LOAD_TRACE_EXTENSION[] = ".fstrace";
+
+/**
+*	Directory that compiled resource lists are written to.
+*/
+const char RESOURCE_MANIFEST_DIR[] = "resourcemanifests";
+
+const char RESOURCE_MANIFEST_EXTENSION[] = ".fsmanifest";
+
 static CCharacterSet g_BreakSet( "{}()'" );
-static CCharacterSet g_BreakSetIncludingColons( "{}()':" );
+static const char BREAK_CHARS_INCLUDING_COLONS[] = "{}()':";
+
+static CCharacterSet g_BreakSetIncludingColons( BREAK_CHARS_INCLUDING_COLONS );
 
 static CFileSystem g_FileSystem;
+
+//Fast path entry points. The qualified calls aren't virtual, so each one is a direct call into the implementation.
+FileHandle_t FastPath_Open( void* pContext, const char *pFileName, const char *pOptions, const char *pathID )
+{
+	return static_cast<CFileSystem*>( pContext )->CFileSystem::Open( pFileName, pOptions, pathID );
+}
+
+void FastPath_Close( void* pContext, FileHandle_t file )
+{
+	static_cast<CFileSystem*>( pContext )->CFileSystem::Close( file );
+}
+
+int FastPath_Read( void* pContext, void* pOutput, int size, FileHandle_t file )
+{
+	return static_cast<CFileSystem*>( pContext )->CFileSystem::Read( pOutput, size, file );
+}
+
+void FastPath_Seek( void* pContext, FileHandle_t file, int pos, FileSystemSeek_t seekType )
+{
+	static_cast<CFileSystem*>( pContext )->CFileSystem::Seek( file, pos, seekType );
+}
+
+unsigned int FastPath_Tell( void* pContext, FileHandle_t file )
+{
+	return static_cast<CFileSystem*>( pContext )->CFileSystem::Tell( file );
+}
+
+bool FastPath_FileExists( void* pContext, const char *pFileName )
+{
+	return static_cast<CFileSystem*>( pContext )->CFileSystem::FileExists( pFileName );
+}
 }
 
 /*
@@ -28,12 +98,41 @@ EXPOSE_SINGLE_INTERFACE_GLOBALVAR( CFileSystem, IFileSystem2, FILESYSTEM2_INTERF
 
 void CFileSystem::RemoveAllSearchPaths()
 {
+	auto lock = LockExclusive();
+
+	//Prefetch jobs reference pack files, so they have to be stopped first.
+	m_Prefetcher.Clear();
+
+	m_DirectoryWatcher.Shutdown();
+
+	SaveMountIndex();
+
+	m_PathIndex.Clear();
+	m_NegativeCache.InvalidateAll();
+	m_DescriptorCache.InvalidateAll();
+	m_MetadataCache.InvalidateAll();
+
+	//Pack file entries are about to be destroyed.
+	m_ContentCache.ForgetSources();
+
+	m_BlockCache.InvalidateAll();
+
+	for( auto& searchPath : m_SearchPaths )
+	{
+		RetireSearchPath( std::move( searchPath ) );
+	}
+
 	m_SearchPaths.clear();
+
+	++m_uiSearchPathGeneration;
+
+	m_PathIDs.Clear();
+	RebuildSearchPathBuckets();
 }
 
 void CFileSystem::AddSearchPath( const char *pPath, const char *pathID )
 {
-	AddSearchPath( pPath, pathID, false );
+	AddSearchPath( pPath, pathID, SearchPathFlag::NONE );
 }
 
 bool CFileSystem::RemoveSearchPath( const char *pPath )
@@ -41,19 +140,40 @@ bool CFileSystem::RemoveSearchPath( const char *pPath )
 	if( !pPath )
 		return false;
 
+	auto lock = LockExclusive();
+
 	auto it = FindSearchPath( pPath );
 
 	if( it == m_SearchPaths.end() )
 		return false;
 
+	m_Prefetcher.Clear();
+
+	m_ContentCache.ForgetSources();
+
+	m_BlockCache.InvalidateAll();
+
 	do
 	{
+		m_DirectoryWatcher.RemovePath( **it );
+
+		RetireSearchPath( std::move( m_SearchPaths[ it - m_SearchPaths.cbegin() ] ) );
+
 		m_SearchPaths.erase( it );
 
 		it = FindSearchPath( pPath );
 	}
 	while( it != m_SearchPaths.end() );
 
+	++m_uiSearchPathGeneration;
+
+	RebuildSearchPathBuckets();
+
+	m_MetadataCache.InvalidateAll();
+
+	//Search path positions have changed, so the index has to be rebuilt.
+	m_PathIndex.Rebuild( m_SearchPaths );
+
 	return true;
 }
 
@@ -62,22 +182,35 @@ void CFileSystem::RemoveFile( const char *pRelativePath, const char *pathID )
 	if( !pRelativePath )
 		return;
 
+	auto lock = LockExclusive();
+
 	fs::path path;
 
 	std::error_code error;
 
-	for( const auto& searchPath : m_SearchPaths )
+	for( auto searchPath : GetSearchPaths( m_PathIDs.Find( pathID ) ) )
 	{
 		if( searchPath->flags & SearchPathFlag::READ_ONLY )
 			continue;
 
-		if( pathID && ( !searchPath->pszPathID || strcmp( pathID, searchPath->pszPathID ) != 0 ) )
-			continue;
-
 		path = fs::path( searchPath->szPath ) / pRelativePath;
 
+		//Cached files can't be removed on some platforms.
+		{
+			CPathBuffer cachedPath;
+
+			if( cachedPath.Set( searchPath->szPath, pRelativePath ) )
+			{
+				m_DescriptorCache.Invalidate( cachedPath.Get() );
+				m_MetadataCache.Invalidate( cachedPath.Get() );
+			}
+		}
+
 		if( fs::remove( path, error ) )
+		{
+			m_PathIndex.RemoveFile( *searchPath, pRelativePath );
 			break;
+		}
 	}
 }
 
@@ -86,20 +219,28 @@ void CFileSystem::CreateDirHierarchy( const char *path, const char *pathID )
 	if( !path )
 		return;
 
-	for( const auto& searchPath : m_SearchPaths )
+	auto lock = LockExclusive();
+
+	for( auto searchPath : GetSearchPaths( m_PathIDs.Find( pathID ) ) )
 	{
 		if( searchPath->flags & SearchPathFlag::READ_ONLY )
 			continue;
 
-		if( pathID && ( !searchPath->pszPathID || strcmp( pathID, searchPath->pszPathID ) != 0 ) )
-			continue;
-
 		std::error_code error;
 
 		fs::path directories = fs::path( searchPath->szPath ) / path;
 
 		fs::create_directories( directories, error );
 
+		if( !error )
+		{
+			if( searchPath->IsOverlay() )
+				IndexParentDirectories( *searchPath, path );
+
+			m_PathIndex.AddFile( *searchPath, searchPath->uiOrder, path, true );
+			m_NegativeCache.Invalidate( m_PathIndex.MakeKey( path ) );
+		}
+
 		return;
 	}
 
@@ -117,6 +258,12 @@ void CFileSystem::CreateDirHierarchy( const char *path, const char *pathID )
 
 			fs::create_directories( directories, error );
 
+			if( !error )
+			{
+				m_PathIndex.AddFile( *searchPath, searchPath->uiOrder, path, true );
+				m_NegativeCache.Invalidate( m_PathIndex.MakeKey( path ) );
+			}
+
 			return;
 		}
 	}
@@ -127,21 +274,11 @@ bool CFileSystem::FileExists( const char *pFileName )
 	if( !pFileName )
 		return false;
 
-	fs::path path;
-
-	std::error_code error;
-
-	for( const auto& searchPath : m_SearchPaths )
-	{
-		path = fs::path( searchPath->szPath ) / pFileName;
+	ProcessDirectoryChanges();
 
-		if( fs::exists( path, error ) )
-		{
-			return true;
-		}
-	}
+	auto lock = LockShared();
 
-	return false;
+	return ResolveFile( pFileName, nullptr ) != nullptr;
 }
 
 bool CFileSystem::IsDirectory( const char *pFileName )
@@ -149,54 +286,78 @@ bool CFileSystem::IsDirectory( const char *pFileName )
 	if( !pFileName )
 		return false;
 
-	fs::path path;
-
-	std::error_code error;
+	bool bIsDirectory = false;
 
-	for( const auto& searchPath : m_SearchPaths )
-	{
-		path = fs::path( searchPath->szPath ) / pFileName;
+	ProcessDirectoryChanges();
 
-		if( fs::is_directory( path, error ) )
-			return true;
-	}
+	auto lock = LockShared();
 
-	return false;
+	return ResolveFile( pFileName, nullptr, nullptr, &bIsDirectory ) && bIsDirectory;
 }
 
 FileHandle_t CFileSystem::Open( const char *pFileName, const char *pOptions, const char *pathID )
 {
+	TRACE_SCOPE( "FileSystem::Open" );
+
 	if( !pFileName || !pOptions )
 		return FILESYSTEM_INVALID_HANDLE;
 
+	const auto uiStartTime = CFileSystemStats::GetTime();
+
+	auto hFile = OpenFile( pFileName, pOptions, pathID );
+
+	auto pFile = m_OpenedFiles.Get( hFile );
+
+	if( !pFile )
+	{
+		m_Stats.AddMiss();
+
+		return FILESYSTEM_INVALID_HANDLE;
+	}
+
+	if( auto pStats = pFile->GetStats() )
+		pStats->uiOpens.fetch_add( 1, std::memory_order_relaxed );
+
+	pFile->AddTime( CFileSystemStats::GetTime() - uiStartTime );
+
+	return hFile;
+}
+
+FileHandle_t CFileSystem::OpenFile( const char *pFileName, const char *pOptions, const char *pathID )
+{
 	if( !strchr( pOptions, 'r' ) || strchr( pOptions, '+' ) )
 	{
 		//Find the first write path that matches the path ID.
 		//Don't need to worry about pack files here since they're always read only.
+		auto lock = LockExclusive();
 
-		auto it = m_SearchPaths.begin();
-
-		for( auto end = m_SearchPaths.end(); it != end; ++it )
+		for( auto searchPath : GetSearchPaths( m_PathIDs.Find( pathID ) ) )
 		{
-			auto& searchPath = *it;
-
 			if( searchPath->flags & SearchPathFlag::READ_ONLY )
 				continue;
 
-			if( pathID && ( !searchPath->pszPathID || strcmp( pathID, searchPath->pszPathID ) != 0 ) )
-				continue;
+			CPathBuffer path;
 
-			auto path = fs::path( searchPath->szPath ) / pFileName;
+			if( !path.Set( searchPath->szPath, pFileName ) )
+				break;
 
-			path.make_preferred();
+			m_DescriptorCache.Invalidate( path.Get() );
+			m_MetadataCache.Invalidate( path.Get() );
 
-			CFileHandle file( *this, path.u8string().c_str(), pOptions );
+			CFileHandle file( *this, path.Get(), pOptions );
 
 			if( file.IsOpen() )
 			{
-				m_OpenedFiles.emplace_back( std::make_unique<CFileHandle>( std::move( file ) ) );
+				file.SetStats( searchPath->pStats );
+
+				//Files that are also read from use the file directly.
+				if( ( m_Options & FileSystemOption::WRITE_BEHIND ) && !strchr( pOptions, '+' ) )
+					file.SetFlags( FileHandleFlag::WRITE_BEHIND );
+
+				m_PathIndex.AddFile( *searchPath, searchPath->uiOrder, pFileName );
+				m_NegativeCache.Invalidate( m_PathIndex.MakeKey( pFileName ) );
 
-				return reinterpret_cast<FileHandle_t>( m_OpenedFiles.back().get() );
+				return m_OpenedFiles.Add( std::move( file ) );
 			}
 
 			break;
@@ -205,16 +366,50 @@ FileHandle_t CFileSystem::Open( const char *pFileName, const char *pOptions, con
 		return FILESYSTEM_INVALID_HANDLE;
 	}
 
-	//Reading from a file, consider all paths.
-	for( const auto& searchPath : m_SearchPaths )
+	ProcessDirectoryChanges();
+
+	auto lock = LockShared();
+
+	const auto id = m_PathIDs.Find( pathID );
+
+	CPathIndex::Locations_t merged;
+
+	//Reading from a file, consider all paths that are known to have it.
+	if( auto pLocations = m_PathIndex.Find( pFileName, &merged ) )
+	{
+		for( const auto& location : *pLocations )
+		{
+			if( location.bIsDirectory || !location.pSearchPath->MatchesPathID( id ) )
+				continue;
+
+			if( auto hFile = FindFile( *location.pSearchPath, location.GetFileName( pFileName ), pOptions, location.pEntry ) )
+				return hFile;
+		}
+	}
+
+	//Files created outside of the filesystem aren't indexed, so check loose search paths.
+	const auto szKey = m_PathIndex.MakeKey( pFileName );
+
+	if( m_NegativeCache.Contains( szKey, pathID ) )
+		return FILESYSTEM_INVALID_HANDLE;
+
+	for( auto searchPath : GetSearchPaths( id ) )
 	{
-		if( pathID && ( !searchPath->pszPathID || strcmp( pathID, searchPath->pszPathID ) != 0 ) )
+		if( searchPath->IsFullyIndexed() )
 			continue;
 
-		if( auto pFileHandle = FindFile( *searchPath, pFileName, pOptions ) )
-			return reinterpret_cast<FileHandle_t>( pFileHandle );
+		if( auto hFile = FindFile( *searchPath, pFileName, pOptions ) )
+		{
+			//The index can't be changed while holding a shared lock.
+			if( !IsThreadSafe() )
+				m_PathIndex.AddFile( *searchPath, searchPath->uiOrder, pFileName );
+
+			return hFile;
+		}
 	}
 
+	m_NegativeCache.Insert( szKey, pathID );
+
 	return FILESYSTEM_INVALID_HANDLE;
 }
 
@@ -223,30 +418,55 @@ void CFileSystem::Close( FileHandle_t file )
 	if( file == FILESYSTEM_INVALID_HANDLE )
 		return;
 
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
-
-	auto position = m_OpenedFiles.begin();
+	auto pFile = m_OpenedFiles.Get( file );
 
-	for( auto end = m_OpenedFiles.end(); position != end; ++position )
+	if( !pFile )
 	{
-		if( position->get() == pFile )
-			break;
-	}
-
-	if( position == m_OpenedFiles.end() )
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Close: Attempted to close invalid or stale file handle!\n" );
 		return;
+	}
 
 	if( pFile->IsOpen() )
 	{
-		Warning( FILESYSTEM_WARNING_REPORTALLACCESSES, "CFileSystem::Close: Closing file \"%s\"\n", pFile->GetFileName().c_str() );
-		pFile->Close();
+		if( ShouldLogBinary( FILESYSTEM_WARNING_REPORTALLACCESSES ) )
+			LOG_BINARY( "CFileSystem::Close: Closing file \"%s\"\n", pFile->GetFileName().c_str() );
+		else
+			Warning( FILESYSTEM_WARNING_REPORTALLACCESSES, "CFileSystem::Close: Closing file \"%s\"\n", pFile->GetFileName().c_str() );
+
+		if( pFile->GetReadBuffer().uiRefCount > 0 )
+		{
+			Warning( FILESYSTEM_WARNING_REPORTUNCLOSED, "CFileSystem::Close: File \"%s\" closed with %u read buffer references outstanding\n", 
+					 pFile->GetFileName().c_str(), pFile->GetReadBuffer().uiRefCount );
+		}
+
+		FreeReadBuffer( *pFile );
+
+		if( pFile->IsWriteBehind() )
+			m_AsyncWriter.Remove( pFile->GetFile() );
+
+		InvalidateMetadata( *pFile );
 	}
 	else
 	{
 		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Close: Closing file that was already closed, or not opened!\n" );
 	}
 
-	m_OpenedFiles.erase( position );
+	if( m_LoadTrace.IsRecording() )
+		m_LoadTrace.RecordClose( file );
+
+	m_Stats.AddFile( pFile->GetFileName(), pFile->GetTime(), pFile->GetBytesRead() );
+
+	if( m_Options & FileSystemOption::AUDIT_ACCESSES )
+		m_AccessAudit.Record( pFile->GetFileName().c_str(), pFile->GetBytesRead(), pFile->GetTime() );
+
+	if( pFile->IsDescriptorCached() )
+	{
+		std::string szFileName = pFile->GetFileName();
+
+		m_DescriptorCache.Release( std::move( szFileName ), pFile->Detach() );
+	}
+
+	m_OpenedFiles.Remove( file );
 }
 
 void CFileSystem::Seek( FileHandle_t file, int pos, FileSystemSeek_t seekType )
@@ -281,7 +501,7 @@ void CFileSystem::FileTimeToString( char* pStrip, int maxCharsIncludingTerminato
 
 bool CFileSystem::IsOk( FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -295,12 +515,19 @@ bool CFileSystem::IsOk( FileHandle_t file )
 		return 0;
 	}
 
+	//Memory files have no file that can fail.
+	if( pFile->IsMemory() )
+		return true;
+
+	if( pFile->IsWriteBehind() )
+		m_AsyncWriter.Flush( pFile->GetFile() );
+
 	return ferror( pFile->GetFile() ) == 0;
 }
 
 void CFileSystem::Flush( FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -314,12 +541,21 @@ void CFileSystem::Flush( FileHandle_t file )
 		return;
 	}
 
+	//Memory files have nothing to flush, and flushing a null file flushes all files.
+	if( pFile->IsMemory() )
+		return;
+
+	if( pFile->IsWriteBehind() )
+		m_AsyncWriter.Flush( pFile->GetFile() );
+
 	fflush( pFile->GetFile() );
+
+	InvalidateMetadata( *pFile );
 }
 
 bool CFileSystem::EndOfFile( FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -335,17 +571,20 @@ bool CFileSystem::EndOfFile( FileHandle_t file )
 
 	if( pFile->IsPackEntry() )
 	{
-		const auto position = ftell64( pFile->GetFile() );
-
-		return static_cast<uint64_t>( position ) >= pFile->GetStartOffset() + pFile->GetLength();
+		return pFile->GetPosition() >= pFile->GetLength();
 	}
 
+	if( pFile->HasReadAheadData() )
+		return false;
+
 	return !!feof( pFile->GetFile() );
 }
 
 int CFileSystem::Read( void* pOutput, int size, FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	TRACE_SCOPE( "FileSystem::Read" );
+
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -359,37 +598,55 @@ int CFileSystem::Read( void* pOutput, int size, FileHandle_t file )
 		return 0;
 	}
 
-	if( pFile->IsPackEntry() )
+	const auto uiStartTime = CFileSystemStats::GetTime();
+
+	uint64_t uiOffset;
+	size_t uiRead;
+
+	if( pFile->IsReadAhead() )
 	{
-		if( pFile->GetLength() == 0 )
+		if( size <= 0 )
 			return 0;
 
-		const auto position = ftell64( pFile->GetFile() );
+		uiOffset = pFile->GetPosition();
 
-		const auto relativePos = position - pFile->GetStartOffset();
-
-		if( relativePos >= pFile->GetLength() )
+		uiRead = pFile->ReadBuffered( pOutput, static_cast<size_t>( size ) );
+	}
+	else if( pFile->IsPackEntry() )
+	{
+		if( size <= 0 || pFile->GetPosition() >= pFile->GetLength() )
 			return 0;
 
-		auto result = fread( pOutput, 1, size, pFile->GetFile() );
+		//Adjust the amount to read to match the file's contents.
+		const auto uiCount = static_cast<size_t>( std::min<uint64_t>( size, pFile->GetLength() - pFile->GetPosition() ) );
 
-		if( relativePos + size >= pFile->GetLength() + 1 )
-		{
-			//Adjust the amount that was read to match the file's contents.
-			const auto maxRead = static_cast<size_t>( ( pFile->GetLength() + 1 ) - relativePos );
+		uiOffset = pFile->GetPosition();
 
-			result = std::min( result, maxRead );
-		}
+		uiRead = pFile->ReadEntry( pOutput, uiCount, uiOffset );
 
-		return result;
+		pFile->SetPosition( uiOffset + uiRead );
+	}
+	else
+	{
+		uiOffset = m_LoadTrace.IsRecording() ? static_cast<uint64_t>( ftell64( pFile->GetFile() ) ) : 0;
+
+		uiRead = fread( pOutput, 1, size, pFile->GetFile() );
 	}
 
-	return fread( pOutput, 1, size, pFile->GetFile() );
+	if( auto pStats = pFile->GetStats() )
+		pStats->uiReads.fetch_add( 1, std::memory_order_relaxed );
+
+	pFile->AddTime( CFileSystemStats::GetTime() - uiStartTime, uiRead );
+
+	if( m_LoadTrace.IsRecording() )
+		m_LoadTrace.RecordRead( file, uiOffset, uiRead );
+
+	return static_cast<int>( uiRead );
 }
 
 int CFileSystem::Write( void const* pInput, int size, FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -403,12 +660,26 @@ int CFileSystem::Write( void const* pInput, int size, FileHandle_t file )
 		return 0;
 	}
 
+	//Memory files are read only.
+	if( pFile->IsMemory() )
+		return 0;
+
+	if( pFile->IsWriteBehind() )
+	{
+		if( !pInput || size <= 0 )
+			return 0;
+
+		m_AsyncWriter.Write( pFile->GetFile(), pInput, static_cast<size_t>( size ) );
+
+		return size;
+	}
+
 	return fwrite( pInput, 1, size, pFile->GetFile() );
 }
 
 char *CFileSystem::ReadLine( char *pOutput, int maxChars, FileHandle_t file )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto pFile = m_OpenedFiles.Get( file );
 
 	if( !pFile )
 	{
@@ -422,23 +693,56 @@ char *CFileSystem::ReadLine( char *pOutput, int maxChars, FileHandle_t file )
 		return nullptr;
 	}
 
-	if( pFile->IsPackEntry() )
+	//Same semantics as fgets: read up to and including the newline, leave room for the null terminator.
+	if( pFile->IsReadAhead() )
 	{
-		if( pFile->GetLength() == 0 )
+		if( maxChars <= 0 )
+			return nullptr;
+
+		const auto uiCount = pFile->ReadLineBuffered( pOutput, static_cast<size_t>( maxChars - 1 ) );
+
+		if( uiCount == 0 && maxChars > 1 )
 			return nullptr;
 
-		const auto position = ftell64( pFile->GetFile() );
+		pOutput[ uiCount ] = '\0';
 
-		const auto relativePos = position - pFile->GetStartOffset();
+		return pOutput;
+	}
 
-		if( relativePos >= pFile->GetLength() )
+	if( pFile->IsPackEntry() )
+	{
+		if( maxChars <= 0 || pFile->GetPosition() >= pFile->GetLength() )
 			return nullptr;
 
-		//The length is the number of bytes in the file, so allow that much to be read.
-		if( relativePos + maxChars >= pFile->GetLength() + 1 )
+		auto uiCount = static_cast<size_t>( std::min<uint64_t>( maxChars - 1, pFile->GetLength() - pFile->GetPosition() ) );
+
+		const char* pszStart;
+
+		if( pFile->IsMapped() )
+		{
+			pszStart = reinterpret_cast<const char*>( pFile->GetData() + pFile->GetPosition() );
+		}
+		else
 		{
-			maxChars = static_cast<int>( ( pFile->GetLength() + 1 ) - relativePos );
+			uiCount = pFile->ReadEntry( pOutput, uiCount, pFile->GetPosition() );
+
+			if( uiCount == 0 && maxChars > 1 )
+				return nullptr;
+
+			pszStart = pOutput;
 		}
+
+		if( auto pszNewline = reinterpret_cast<const char*>( memchr( pszStart, '\n', uiCount ) ) )
+			uiCount = static_cast<size_t>( pszNewline - pszStart ) + 1;
+
+		if( pszStart != pOutput )
+			memcpy( pOutput, pszStart, uiCount );
+
+		pOutput[ uiCount ] = '\0';
+
+		pFile->SetPosition( pFile->GetPosition() + uiCount );
+
+		return pOutput;
 	}
 
 	return fgets( pOutput, maxChars, pFile->GetFile() );
@@ -457,93 +761,266 @@ int CFileSystem::FPrintf( FileHandle_t file, const char *pFormat, ... )
 	return result;
 }
 
-const char *CFileSystem::FindFirst( const char *pWildCard, FileFindHandle_t *pHandle, const char *pathID )
+void *CFileSystem::GetReadBuffer( FileHandle_t file, int *outBufferSize, bool failIfNotInCache )
 {
-	return FindFirstEx( pWildCard, pHandle, FileSystemFindFlag::NONE, pathID );
-}
+	if( outBufferSize )
+		*outBufferSize = 0;
 
-const char *CFileSystem::FindNext( FileFindHandle_t handle )
-{
-	if( static_cast<size_t>( handle ) >= m_FindFiles.size() )
-		return nullptr;
+	auto pFile = m_OpenedFiles.Get( file );
 
-	auto& data = *m_FindFiles[ handle ];
+	if( !pFile || !outBufferSize )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::GetReadBuffer: Attempted to get read buffer with null file handle or size!\n" );
+		return nullptr;
+	}
 
-	if( data.flags & FindFileFlag::END_OF_DATA )
+	if( !pFile->IsOpen() )
 	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::GetReadBuffer: Attempted to get read buffer from handle with null file pointer!\n" );
 		return nullptr;
 	}
 
-	do
+	//The int return type limits what can be handed out.
+	if( pFile->GetLength() > static_cast<uint64_t>( std::numeric_limits<int>::max() ) )
+		return nullptr;
+
+	auto& buffer = pFile->GetReadBuffer();
+
+	//Mapped pack entries can be accessed in place.
+	if( pFile->IsMapped() )
 	{
-		//Reached the end of the current path ID.
-		if( data.EndOfPath() )
-		{
-			auto path = data.currentPath != m_SearchPaths.end() ? data.currentPath + 1 : m_SearchPaths.begin();
+		++buffer.uiRefCount;
 
-			bool bSetNext = false;
+		*outBufferSize = static_cast<int>( pFile->GetLength() );
 
-			for( auto end = m_SearchPaths.end(); path != end; ++path )
-			{
-				auto& searchPath = *path;
+		return const_cast<uint8_t*>( pFile->GetData() );
+	}
 
-				if( *data.szPathID && ( !searchPath->pszPathID || strcmp( data.szPathID, searchPath->pszPathID ) != 0 ) )
-					continue;
+	//Another handle to the same pack file entry may have the contents in memory already.
+	if( !buffer.data && !buffer.shared && ( m_Options & FileSystemOption::SHARE_READ_BUFFERS ) && pFile->GetPackEntry() )
+	{
+		buffer.shared = m_ContentCache.Find( pFile->GetPackEntry() );
 
-				if( data.flags & FindFileFlag::SKIP_IDENTICAL_PATHS )
-				{
-					if( std::find_if( data.searchedPaths.begin(), data.searchedPaths.end(), 
-							[ & ]( const char* pszPath )
-							{
-								return strcmp( pszPath, searchPath->szPath ) == 0;
-							}
-					) != data.searchedPaths.end() )
-						continue;
+		if( buffer.shared )
+			m_Stats.AddSharedBytes( buffer.shared->uiSize );
+	}
 
-					data.searchedPaths.emplace_back( searchPath->szPath );
-				}
+	if( !buffer.data && !buffer.shared )
+	{
+		//Loading the file requires I/O.
+		if( failIfNotInCache )
+			return nullptr;
 
-				data.currentPath = path;
+		const auto uiLength = static_cast<size_t>( pFile->GetLength() );
 
-				if( searchPath->IsPackFile() )
-				{
-					data.pack_iterator = searchPath->packEntries.begin();
-					data.flags |= FindFileFlag::IS_PACK_FILE;
-				}
-				else
-				{
-					data.iterator = fs::recursive_directory_iterator( searchPath->szPath );
-					data.flags &= ~FindFileFlag::IS_PACK_FILE;
-				}
+		buffer.data = m_ReadBufferPool.Acquire( uiLength, buffer.uiCapacity );
 
-				bSetNext = true;
+		//Read the entire file without disturbing the file position.
+		const auto uiPosition = Tell64( file );
+
+		Seek64( file, 0, FILESYSTEM_SEEK_HEAD );
 
+		size_t uiRead = 0;
+
+		while( uiRead < uiLength )
+		{
+			const auto result = Read( buffer.data.get() + uiRead, static_cast<int>( uiLength - uiRead ), file );
+
+			if( result <= 0 )
 				break;
-			}
 
-			if( !bSetNext )
-			{
-				data.flags |= FindFileFlag::END_OF_DATA;
-			}
+			uiRead += static_cast<size_t>( result );
 		}
 
-		if( data.flags & FindFileFlag::END_OF_DATA )
+		Seek64( file, static_cast<int64_t>( uiPosition ), FILESYSTEM_SEEK_HEAD );
+
+		if( uiRead != uiLength )
 		{
+			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::GetReadBuffer: Couldn't read file \"%s\"\n", pFile->GetFileName().c_str() );
+			FreeReadBuffer( *pFile );
 			return nullptr;
 		}
 
-		auto searchPath = ( *data.currentPath ).get();
-
-		if( searchPath->IsPackFile() )
+		if( m_Options & FileSystemOption::SHARE_READ_BUFFERS )
 		{
-			for( auto end = searchPath->packEntries.end(); data.pack_iterator != end; )
+			buffer.shared = m_ContentCache.Add( pFile->GetPackEntry(), buffer.data, uiLength );
+
+			//Identical contents were in use, so this copy isn't needed.
+			if( buffer.data )
+			{
+				m_Stats.AddSharedBytes( uiLength );
+				m_ReadBufferPool.Release( std::move( buffer.data ), buffer.uiCapacity );
+			}
+
+			buffer.uiCapacity = 0;
+		}
+	}
+
+	++buffer.uiRefCount;
+
+	*outBufferSize = static_cast<int>( pFile->GetLength() );
+
+	return const_cast<uint8_t*>( buffer.Get() );
+}
+
+void CFileSystem::ReleaseReadBuffer( FileHandle_t file, void *readBuffer )
+{
+	auto pFile = m_OpenedFiles.Get( file );
+
+	if( !pFile || !readBuffer )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::ReleaseReadBuffer: Attempted to release read buffer with null file handle or buffer!\n" );
+		return;
+	}
+
+	auto& buffer = pFile->GetReadBuffer();
+
+	const void* pExpected = pFile->IsMapped() ? pFile->GetData() : buffer.Get();
+
+	if( readBuffer != pExpected || buffer.uiRefCount == 0 )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::ReleaseReadBuffer: Buffer was not handed out for file \"%s\"!\n", pFile->GetFileName().c_str() );
+		return;
+	}
+
+	if( --buffer.uiRefCount == 0 )
+	{
+		FreeReadBuffer( *pFile );
+	}
+}
+
+const char *CFileSystem::FindFirst( const char *pWildCard, FileFindHandle_t *pHandle, const char *pathID )
+{
+	return FindFirstEx( pWildCard, pHandle, FileSystemFindFlag::NONE, pathID );
+}
+
+const char *CFileSystem::FindNext( FileFindHandle_t handle )
+{
+	auto pData = GetFindFileData( handle );
+
+	if( !pData )
+		return nullptr;
+
+	auto& data = *pData;
+
+	if( data.flags & FindFileFlag::END_OF_DATA )
+	{
+		return nullptr;
+	}
+
+	auto lock = LockShared();
+
+	//The search may point into search paths that were removed since it started, so it ends here.
+	if( data.uiSearchPathGeneration != m_uiSearchPathGeneration )
+	{
+		data.flags |= FindFileFlag::END_OF_DATA;
+		return nullptr;
+	}
+
+	//Path IDs can be added between calls, so look it up each time.
+	const auto id = *data.szPathID ? m_PathIDs.Find( data.szPathID ) : PathID::ANY;
+
+	do
+	{
+		//Reached the end of the current path ID.
+		if( data.EndOfPath() )
+		{
+			bool bSetNext = false;
+
+			for( size_t uiPath = data.uiNextPath; uiPath < m_SearchPaths.size(); ++uiPath )
+			{
+				auto& searchPath = m_SearchPaths[ uiPath ];
+
+				if( !searchPath->MatchesPathID( id ) )
+					continue;
+
+				if( ( data.flags & FindFileFlag::SKIP_IDENTICAL_PATHS ) && !data.searchedPaths.insert( searchPath->szPath ).second )
+					continue;
+
+				data.uiNextPath = uiPath + 1;
+
+				if( searchPath->IsPackFile() )
+				{
+					std::tie( data.pack_iterator, data.pack_end ) = searchPath->packEntries.FindPrefix( data.szPrefix.c_str() );
+					data.flags |= FindFileFlag::IS_PACK_FILE;
+					data.flags &= ~FindFileFlag::IS_MEMORY;
+				}
+				else if( searchPath->IsMemory() )
+				{
+					data.memoryFiles.clear();
+					data.uiMemoryFile = 0;
+
+					for( auto it = searchPath->memoryFiles.lower_bound( data.szPrefix ), end = searchPath->memoryFiles.end();
+						 it != end && it->first.compare( 0, data.szPrefix.length(), data.szPrefix ) == 0; ++it )
+					{
+						data.memoryFiles.emplace_back( it->first );
+					}
+
+					//Memory search paths have no directories.
+					data.entry = fs::directory_entry();
+
+					data.flags &= ~FindFileFlag::IS_PACK_FILE;
+					data.flags |= FindFileFlag::IS_MEMORY;
+				}
+				else
+				{
+					CPathBuffer directory;
+
+					std::error_code error;
+
+					//Directories that don't exist produce no entries.
+					if( directory.Set( searchPath->szPath, data.szPrefixDirectory.c_str() ) )
+						data.iterator = fs::recursive_directory_iterator( directory.Get(), error );
+					else
+						data.iterator = fs::recursive_directory_iterator();
+
+					data.flags &= ~( FindFileFlag::IS_PACK_FILE | FindFileFlag::IS_MEMORY );
+				}
+
+				bSetNext = true;
+
+				break;
+			}
+
+			if( !bSetNext )
+			{
+				data.flags |= FindFileFlag::END_OF_DATA;
+			}
+		}
+
+		if( data.flags & FindFileFlag::END_OF_DATA )
+		{
+			return nullptr;
+		}
+
+		auto searchPath = m_SearchPaths[ data.uiNextPath - 1 ].get();
+
+		if( searchPath->IsPackFile() )
+		{
+			while( data.pack_iterator != data.pack_end )
 			{
-				data.szFileName = data.pack_iterator->second->GetFileName();
+				const char* const pszFileName = data.pack_iterator->GetFileName();
 
 				++data.pack_iterator;
 
+				//Matches the wildcard. Only copied if it does.
+				if( data.filter.Matches( pszFileName ) )
+				{
+					data.szFileName = pszFileName;
+					return data.szFileName.c_str();
+				}
+			}
+		}
+		else if( searchPath->IsMemory() )
+		{
+			while( data.uiMemoryFile < data.memoryFiles.size() )
+			{
+				data.szFileName = std::move( data.memoryFiles[ data.uiMemoryFile ] );
+
+				++data.uiMemoryFile;
+
 				//Matches the wildcard.
-				if( UTIL_TokenMatches( data.szFileName.c_str(), data.szFilter.c_str() ) )
+				if( data.filter.Matches( data.szFileName.c_str(), data.szFileName.length() ) )
 					return data.szFileName.c_str();
 			}
 		}
@@ -563,7 +1040,7 @@ const char *CFileSystem::FindNext( FileFindHandle_t handle )
 				++data.iterator;
 
 				//Matches the wildcard.
-				if( UTIL_TokenMatches( data.szFileName.c_str(), data.szFilter.c_str() ) )
+				if( data.filter.Matches( data.szFileName.c_str(), data.szFileName.length() ) )
 					return data.szFileName.c_str();
 			}
 		}
@@ -576,12 +1053,178 @@ const char *CFileSystem::FindNext( FileFindHandle_t handle )
 	return nullptr;
 }
 
+size_t CFileSystem::FindAll( const char* pWildCard, FileSystemFindFlags_t flags, const char* pathID, FileSystemFindResult_t* pResults, size_t uiMaxCount )
+{
+	if( !pWildCard )
+		return 0;
+
+	CPathBuffer wildcard;
+
+	if( !wildcard.Set( pWildCard ) )
+		return 0;
+
+	const CWildcardPattern filter( wildcard.Get() );
+
+	const std::string& szPrefix = filter.GetPrefix();
+
+	const auto uiSeparator = szPrefix.find_last_of( "/\\" );
+
+	const std::string szPrefixDirectory = uiSeparator != std::string::npos ? szPrefix.substr( 0, uiSeparator ) : std::string();
+
+	std::vector<FindMatch_t> results;
+
+	{
+		auto lock = LockShared();
+
+		const auto id = pathID && *pathID ? m_PathIDs.Find( pathID ) : PathID::ANY;
+
+		std::vector<const CSearchPath*> searchPaths;
+
+		std::unordered_set<const char*, Hash_C_String<const char*>, EqualTo_C_String<const char*>> searchedPaths;
+
+		for( const auto& searchPath : m_SearchPaths )
+		{
+			if( !searchPath->MatchesPathID( id ) )
+				continue;
+
+			if( ( flags & FileSystemFindFlag::SKIP_IDENTICAL_PATHS ) && !searchedPaths.insert( searchPath->szPath ).second )
+				continue;
+
+			searchPaths.emplace_back( searchPath.get() );
+		}
+
+		std::vector<std::vector<FindMatch_t>> matches( searchPaths.size() );
+
+		const size_t uiThreadCount = std::min( searchPaths.size(), MAX_FIND_THREADS );
+
+		//Searching only reads the search paths, so each worker takes the next search path until all are searched.
+		std::atomic<size_t> uiNextIndex{ 0 };
+
+		auto findMatches = [ & ]()
+		{
+			for( size_t uiIndex; ( uiIndex = uiNextIndex.fetch_add( 1, std::memory_order_relaxed ) ) < searchPaths.size(); )
+			{
+				FindMatches( *searchPaths[ uiIndex ], filter, szPrefix, szPrefixDirectory, matches[ uiIndex ] );
+			}
+		};
+
+		std::vector<std::thread> threads;
+
+		if( uiThreadCount > 1 )
+			threads.reserve( uiThreadCount - 1 );
+
+		for( size_t uiThread = 1; uiThread < uiThreadCount; ++uiThread )
+		{
+			threads.emplace_back( findMatches );
+		}
+
+		findMatches();
+
+		for( auto& thread : threads )
+		{
+			thread.join();
+		}
+
+		size_t uiTotal = 0;
+
+		for( const auto& pathMatches : matches )
+		{
+			uiTotal += pathMatches.size();
+		}
+
+		results.reserve( uiTotal );
+
+		for( auto& pathMatches : matches )
+		{
+			std::move( pathMatches.begin(), pathMatches.end(), std::back_inserter( results ) );
+		}
+	}
+
+	//Stable, so a name provided by several search paths keeps the first search path's result.
+	std::stable_sort( results.begin(), results.end(), []( const FindMatch_t& lhs, const FindMatch_t& rhs )
+	{
+		return lhs.szFileName < rhs.szFileName;
+	} );
+
+	results.erase( std::unique( results.begin(), results.end(), []( const FindMatch_t& lhs, const FindMatch_t& rhs )
+	{
+		return lhs.szFileName == rhs.szFileName;
+	} ), results.end() );
+
+	if( pResults )
+	{
+		const auto uiCount = std::min( uiMaxCount, results.size() );
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			auto& result = pResults[ uiIndex ];
+
+			strncpy( result.szFileName, results[ uiIndex ].szFileName.c_str(), sizeof( result.szFileName ) );
+			result.szFileName[ sizeof( result.szFileName ) - 1 ] = '\0';
+
+			result.bIsDirectory = results[ uiIndex ].bIsDirectory;
+		}
+	}
+
+	return results.size();
+}
+
+void CFileSystem::FindMatches( const CSearchPath& searchPath, const CWildcardPattern& filter, const std::string& szPrefix, const std::string& szPrefixDirectory,
+							   std::vector<FindMatch_t>& matches )
+{
+	if( searchPath.IsPackFile() )
+	{
+		const auto range = searchPath.packEntries.FindPrefix( szPrefix.c_str() );
+
+		for( auto it = range.first; it != range.second; ++it )
+		{
+			const char* const pszFileName = it->GetFileName();
+
+			//Pack search paths have no directory entries.
+			if( filter.Matches( pszFileName ) )
+				matches.push_back( { pszFileName, false } );
+		}
+	}
+	else if( searchPath.IsMemory() )
+	{
+		for( auto it = searchPath.memoryFiles.lower_bound( szPrefix ), end = searchPath.memoryFiles.end();
+			 it != end && it->first.compare( 0, szPrefix.length(), szPrefix ) == 0; ++it )
+		{
+			if( filter.Matches( it->first.c_str(), it->first.length() ) )
+				matches.push_back( { it->first, false } );
+		}
+	}
+	else
+	{
+		CPathBuffer directory;
+
+		//Directories that don't exist produce no entries.
+		if( !directory.Set( searchPath.szPath, szPrefixDirectory.c_str() ) )
+			return;
+
+		std::error_code error;
+
+		const size_t uiPathLength = *searchPath.szPath ? strlen( searchPath.szPath ) + 1 : 0;
+
+		for( fs::recursive_directory_iterator it( directory.Get(), error ), end; !error && it != end; it.increment( error ) )
+		{
+			//Trim the search path so it returns uniform paths for use in I/O.
+			auto szFileName = it->path().u8string().substr( uiPathLength );
+
+			if( filter.Matches( szFileName.c_str(), szFileName.length() ) )
+				matches.push_back( { std::move( szFileName ), fs::is_directory( it->status() ) } );
+		}
+	}
+}
+
 bool CFileSystem::FindIsDirectory( FileFindHandle_t handle )
 {
-	if( static_cast<size_t>( handle ) >= m_FindFiles.size() )
+	auto pData = GetFindFileData( handle );
+
+	if( !pData )
 		return false;
 
-	auto& data = *m_FindFiles[ handle ];
+	auto& data = *pData;
 
 	if( data.flags & FindFileFlag::END_OF_DATA )
 	{
@@ -593,32 +1236,20 @@ bool CFileSystem::FindIsDirectory( FileFindHandle_t handle )
 
 void CFileSystem::FindClose( FileFindHandle_t handle )
 {
-	if( static_cast<size_t>( handle ) >= m_FindFiles.size() )
+	auto pData = GetFindFileData( handle );
+
+	if( !pData )
 		return;
 
-	auto& data = *m_FindFiles[ handle ];
+	auto& data = *pData;
 
-	//Already flagged, another close operation will take care of this.
-	if( !( data.flags & FindFileFlag::VALID ) )
-		return;
+	data.flags = FindFileFlag::NONE;
+	++data.uiGeneration;
 
-	//It's the last one, so clear it now.
-	if( handle == m_FindFiles.size() - 1 )
-	{
-		//Close all invalid find handles between the end and last valid handle.
-		for( auto it = m_FindFiles.rbegin(); it != m_FindFiles.rend(); )
-		{
-			if( data.flags & FindFileFlag::VALID )
-				break;
+	//Release the directory handles now, the rest is kept for the next search.
+	data.iterator = fs::recursive_directory_iterator();
 
-			it = decltype( it )( m_FindFiles.erase( it.base() ) );
-		}
-	}
-	else
-	{
-		//Flag for removal.
-		data.flags &= ~FindFileFlag::VALID;
-	}
+	GetFindFiles().freeSlots.push_back( static_cast<uint32_t>( handle ) & FIND_INDEX_MASK );
 }
 
 const char *CFileSystem::GetLocalPath( const char *pFileName, char *pLocalPath, int localPathBufferSize )
@@ -626,25 +1257,56 @@ const char *CFileSystem::GetLocalPath( const char *pFileName, char *pLocalPath,
 	if( !pLocalPath || localPathBufferSize <= 0 )
 		return nullptr;
 
-	fs::path path;
+	if( !pFileName )
+		return nullptr;
+
+	CPathBuffer path;
+
+	ProcessDirectoryChanges();
+
+	auto lock = LockShared();
+
+	//Pack file entries and memory files have no local path, so use the first loose search path that provides it.
+	if( auto pLocations = m_PathIndex.Find( pFileName ) )
+	{
+		for( const auto& location : *pLocations )
+		{
+			if( !location.pSearchPath->IsLoose() || !path.Set( location.pSearchPath->szPath, location.GetFileName( pFileName ) ) )
+				continue;
+
+			strncpy( pLocalPath, path.Get(), localPathBufferSize );
+			pLocalPath[ localPathBufferSize - 1 ] = '\0';
+
+			return pLocalPath;
+		}
+	}
+
+	//Files created outside of the filesystem aren't indexed, so check loose search paths.
+	const auto szKey = m_PathIndex.MakeKey( pFileName );
+
+	if( m_NegativeCache.Contains( szKey, nullptr ) )
+		return nullptr;
 
 	std::error_code error;
 
 	for( const auto& searchPath : m_SearchPaths )
 	{
-		path = fs::path( searchPath->szPath ) / pFileName;
+		if( searchPath->IsFullyIndexed() || !path.Set( searchPath->szPath, pFileName ) )
+			continue;
 
-		if( fs::exists( path, error ) )
-		{
-			path.make_preferred();
+		CDirectoryHandle::Status_t status;
 
-			strncpy( pLocalPath, path.u8string().c_str(), localPathBufferSize );
+		if( searchPath->directory ? searchPath->directory->GetStatus( pFileName, status ) : fs::exists( path.Get(), error ) )
+		{
+			strncpy( pLocalPath, path.Get(), localPathBufferSize );
 			pLocalPath[ localPathBufferSize - 1 ] = '\0';
 
 			return pLocalPath;
 		}
 	}
 
+	m_NegativeCache.Insert( szKey, nullptr );
+
 	return nullptr;
 }
 
@@ -654,14 +1316,10 @@ char* COM_SkipWhitespace( char* pszData )
 	if( !pszData )
 		return nullptr;
 
-	char c;
+	pszData = const_cast<char*>( tokenization::SkipWhitespace( pszData ) );
 
-	while( ( c = *pszData ) <= ' ' )
-	{
-		if( c == '\0' )
-			return nullptr;                    // end of file;
-		++pszData;
-	}
+	if( !( *pszData ) )
+		return nullptr;                    // end of file;
 
 	return pszData;
 }
@@ -679,8 +1337,7 @@ char* COM_SkipComments( char* pszData, bool& bWasComment )
 	// skip // comments
 	if( c == '/' && pszData[ 1 ] == '/' )
 	{
-		while( *pszData && *pszData != '\n' )
-			++pszData;
+		pszData = const_cast<char*>( tokenization::FindLineEnd( pszData ) );
 		bWasComment = true;
 	}
 	else
@@ -734,14 +1391,15 @@ char *CFileSystem::ParseFile( char* pFileBytes, char* pToken, bool* pWasQuoted )
 		}
 		else
 		{
-			size_t uiIndex;
+			char* pszEnd = const_cast<char*>( tokenization::FindWordEnd( result, BREAK_CHARS_INCLUDING_COLONS ) );
 
-			for( uiIndex = 0; *result && *result > ' ' && !g_BreakSetIncludingColons.InSet( *result ); ++uiIndex, ++result )
-			{
-				pToken[ uiIndex ] = *result;
-			}
+			const size_t uiLength = pszEnd - result;
 
-			pToken[ uiIndex ] = '\0';
+			memcpy( pToken, result, uiLength );
+
+			pToken[ uiLength ] = '\0';
+
+			result = pszEnd;
 		}
 
 		return result;
@@ -754,17 +1412,16 @@ char *CFileSystem::ParseFile( char* pFileBytes, char* pToken, bool* pWasQuoted )
 
 	if( *result != '"' )
 	{
-		size_t uiIndex;
+		char* pszEnd = const_cast<char*>( tokenization::FindQuote( result ) );
 
-		for( uiIndex = 0; *result && *result != '"'; ++uiIndex, ++result )
-		{
-			pToken[ uiIndex ] = *result;
-		}
+		const size_t uiLength = pszEnd - result;
 
-		//Skip closing quote.
-		++result;
+		memcpy( pToken, result, uiLength );
+
+		pToken[ uiLength ] = '\0';
 
-		pToken[ uiIndex ] = '\0';
+		//Skip closing quote.
+		result = pszEnd + 1;
 	}
 	else
 	{
@@ -808,12 +1465,12 @@ bool CFileSystem::GetCurrentDirectory( char* pDirectory, int maxlen )
 	 
 void CFileSystem::PrintOpenedFiles()
 {
-	for( const auto& file : m_OpenedFiles )
+	m_OpenedFiles.ForEach( [ this ]( const CFileHandle& file )
 	{
-		const char* const pszName = !file->GetFileName().empty() ? file->GetFileName().c_str() : "???";
+		const char* const pszName = !file.GetFileName().empty() ? file.GetFileName().c_str() : "???";
 
 		Warning( FILESYSTEM_WARNING_REPORTUNCLOSED, "File %s was never closed\n", pszName );
-	}
+	} );
 }
 	 
 void CFileSystem::SetWarningFunc( FileSystemWarningFunc pfnWarning )
@@ -828,7 +1485,7 @@ void CFileSystem::SetWarningLevel( FileWarningLevel_t level )
 
 int CFileSystem::SetVBuf( FileHandle_t stream, char *buffer, int mode, long size )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( stream );
+	auto pFile = m_OpenedFiles.Get( stream );
 
 	if( !pFile )
 	{
@@ -842,6 +1499,10 @@ int CFileSystem::SetVBuf( FileHandle_t stream, char *buffer, int mode, long size
 		return 0;
 	}
 
+	//Memory files aren't buffered.
+	if( pFile->IsMemory() )
+		return 0;
+
 	return setvbuf( pFile->GetFile(), buffer, mode, size );
 }
 
@@ -855,591 +1516,3453 @@ void CFileSystem::GetInterfaceVersion( char *p, int maxlen )
 }
 
 template<typename PackType>
-bool ProcessPackFile( CFileSystem& fileSystem, const char* pszFileName, FILE* pFile, CSearchPath::Entries_t& entries )
+void LoadPackDirectory( CPackDirectory& entries, const uint8_t* pData, const size_t uiCount )
 {
-	assert( pFile );
+	auto packEntries = reinterpret_cast<const typename PackType::Entry_t*>( pData );
 
-	typename PackType::Header_t header;
+	size_t uiNameBytes = 0;
 
-	if( fread( &header, sizeof( header ), 1, pFile ) != 1 )
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
 	{
-		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read pack file \"%s\" header!n", PackType::Info_t::NAME, pszFileName );
-		return false;
+		uiNameBytes += strnlen( packEntries[ uiIndex ].szFileName, PackType::ENTRY_NAME_MAX_LENGTH ) + 1;
 	}
 
-	header.dirofs = LittleValue( header.dirofs );
-	header.dirlen = LittleValue( header.dirlen );
+	entries.Reserve( uiCount, uiNameBytes );
 
-	if( ( header.dirlen % sizeof( typename PackType::Entry_t ) ) != 0 )
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
 	{
-		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Invalid directory length for \"%s\"\n", PackType::Info_t::NAME, pszFileName );
-		return false;
+		auto& packEntry = packEntries[ uiIndex ];
+
+		entries.AddEntry( packEntry.szFileName, PackType::ENTRY_NAME_MAX_LENGTH, LittleValue( packEntry.filepos ), LittleValue( packEntry.filelen ) );
 	}
 
-	const size_t numFiles = static_cast<size_t>( header.dirlen / sizeof( typename PackType::Entry_t ) );
+	entries.Finish();
+}
 
-	if( numFiles > PackType::MAX_FILES )
-	{
-		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Too many files in pack file \"%s\" (Max %u, got %u)\n", 
-							PackType::Info_t::NAME, pszFileName, PackType::MAX_FILES, numFiles );
-		return false;
-	}
+void LoadCompressedPackDirectory( CPackDirectory& entries, const uint8_t* pData, const size_t uiCount )
+{
+	typedef pack::CompressedPack PackType;
 
-	fseek64( pFile, header.dirofs, SEEK_SET );
+	auto packEntries = reinterpret_cast<const PackType::Entry_t*>( pData );
 
-	auto packEntries = std::make_unique<typename PackType::Entry_t[]>( numFiles );
+	size_t uiNameBytes = 0;
 
-	if( fread( packEntries.get(), sizeof( typename PackType::Entry_t ), numFiles, pFile ) != numFiles )
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
 	{
-		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read directory entries from \"%s\"\n", PackType::Info_t::NAME, pszFileName );
-		return false;
+		uiNameBytes += strnlen( packEntries[ uiIndex ].szFileName, PackType::ENTRY_NAME_MAX_LENGTH ) + 1;
 	}
 
-	for( size_t uiIndex = 0; uiIndex < numFiles; ++uiIndex )
+	entries.Reserve( uiCount, uiNameBytes );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
 	{
 		auto& packEntry = packEntries[ uiIndex ];
 
-		auto entry = std::make_unique<CPackFileEntry>( std::move( fs::path( packEntry.szFileName ).make_preferred().u8string() ), packEntry.filepos, packEntry.filelen );
+		const auto codec = static_cast<pack::Codec>( LittleValue( packEntry.codec ) );
 
-		entries.emplace( std::make_pair( entry->GetFileName().c_str(), std::move( entry ) ) );
+		const auto filelen = LittleValue( packEntry.filelen );
+		const auto storedlen = LittleValue( packEntry.storedlen );
+
+		//Uncompressed entries are stored as is.
+		entries.AddEntry( packEntry.szFileName, PackType::ENTRY_NAME_MAX_LENGTH, LittleValue( packEntry.filepos ), filelen, 
+						  codec == pack::Codec::NONE ? filelen : storedlen, codec );
 	}
 
-	return true;
+	entries.Finish();
 }
 
-bool CFileSystem::AddPackFile( const char *fullpath, const char *pathID )
+void LoadWadDirectory( CPackDirectory& entries, const uint8_t* pData, const size_t uiCount )
 {
-	return AddPackFile( fullpath, pathID, true );
-}
+	typedef pack::Wad PackType;
 
-FileHandle_t CFileSystem::OpenFromCacheForRead( const char *pFileName, const char *pOptions, const char *pathID )
-{
-	if( !pFileName || !pOptions )
-		return FILESYSTEM_INVALID_HANDLE;
+	auto lumps = reinterpret_cast<const PackType::Lump_t*>( pData );
 
-	if( strchr( pOptions, 'w' ) || strchr( pOptions, '+' ) )
+	size_t uiNameBytes = 0;
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
 	{
-		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::OpenFromCacheForRead: Tried to open file \"%s\" with write option!\n", pFileName );
-		return FILESYSTEM_INVALID_HANDLE;
+		uiNameBytes += strnlen( lumps[ uiIndex ].szName, PackType::LUMP_NAME_MAX_LENGTH ) + 1;
 	}
 
-	for( const auto& searchPath : m_SearchPaths )
+	entries.Reserve( uiCount, uiNameBytes );
+
+	char szName[ PackType::LUMP_NAME_MAX_LENGTH ];
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
 	{
-		if( !( searchPath->flags & SearchPathFlag::IS_PACK_FILE ) )
-			continue;
+		auto& lump = lumps[ uiIndex ];
+
+		const auto filepos = LittleValue( lump.filepos );
+		const auto disksize = LittleValue( lump.disksize );
 
-		if( pathID && ( !searchPath->pszPathID || strcmp( pathID, searchPath->pszPathID ) != 0 ) )
+		//Compressed lumps can't be read, and were rejected when the file was added.
+		if( filepos < 0 || disksize < 0 || lump.compression != PackType::COMPRESSION_NONE )
 			continue;
 
-		if( auto pFileHandle = FindFile( *searchPath, pFileName, pOptions ) )
-			return reinterpret_cast<FileHandle_t>( pFileHandle );
+		for( size_t uiChar = 0; uiChar < sizeof( szName ); ++uiChar )
+		{
+			szName[ uiChar ] = static_cast<char>( tolower( static_cast<unsigned char>( lump.szName[ uiChar ] ) ) );
+		}
+
+		entries.AddEntry( szName, sizeof( szName ), static_cast<uint64_t>( filepos ), static_cast<uint64_t>( disksize ) );
 	}
 
-	return FILESYSTEM_INVALID_HANDLE;
+	entries.Finish();
 }
 
-void CFileSystem::AddSearchPathNoWrite( const char *pPath, const char *pathID )
+/**
+*	Entry of a ZIP file's directory, as kept until the directory is loaded. The entries are followed by the names.
+*/
+struct ZipEntry_t
 {
-	AddSearchPath( pPath, pathID, true );
-}
-
-void CFileSystem::Seek64( FileHandle_t file, int64_t pos, FileSystemSeek_t seekType )
+	uint64_t uiStartOffset;
+	uint64_t uiLength;
+	uint64_t uiStoredLength;
+	pack::Codec codec;
+	uint32_t uiNameOffset;
+	uint32_t uiNameLength;
+	uint32_t uiReserved;
+};
+
+void LoadZipDirectory( CPackDirectory& entries, const uint8_t* pData, const size_t uiCount )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	auto zipEntries = reinterpret_cast<const ZipEntry_t*>( pData );
+	auto pszNames = reinterpret_cast<const char*>( pData + uiCount * sizeof( ZipEntry_t ) );
 
-	if( !pFile )
-	{
-		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Seek: Attempted to seek null file handle!\n" );
-		return;
-	}
+	size_t uiNameBytes = 0;
 
-	if( !pFile->IsOpen() )
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
 	{
-		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Seek: Attempted to seek handle with null file pointer!\n" );
-		return;
+		uiNameBytes += zipEntries[ uiIndex ].uiNameLength + 1;
 	}
 
-	int64_t position = pos;
+	entries.Reserve( uiCount, uiNameBytes );
 
-	if( pFile->IsPackEntry() )
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
 	{
-		switch( seekType )
-		{
-		case FILESYSTEM_SEEK_HEAD:
-			{
-				position += pFile->GetStartOffset();
-				break;
-			}
-
-		case FILESYSTEM_SEEK_TAIL:
-			{
-				//Adjust end position to the file's end
-				position += pFile->GetStartOffset() + pFile->GetLength();
-				seekType = FILESYSTEM_SEEK_HEAD;
-				break;
-			}
-		}
-	}
-
-	int origin;
+		auto& zipEntry = zipEntries[ uiIndex ];
 
-	switch( seekType )
-	{
-	case FILESYSTEM_SEEK_HEAD:		origin = SEEK_SET; break;
-	case FILESYSTEM_SEEK_CURRENT:	origin = SEEK_CUR; break;
-	case FILESYSTEM_SEEK_TAIL:		origin = SEEK_END; break;
-	default:
-		{
-			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Seek: invalid seek type '%d'\n", seekType );
-			return;
-		}
+		entries.AddEntry( pszNames + zipEntry.uiNameOffset, zipEntry.uiNameLength, zipEntry.uiStartOffset, zipEntry.uiLength,
+						  zipEntry.uiStoredLength, zipEntry.codec );
 	}
 
-	fseek64( pFile->GetFile(), position, origin );
+	entries.Finish();
 }
 
-uint64_t CFileSystem::Tell64( FileHandle_t file )
+template<typename PackType>
+bool ProcessPackFile( CFileSystem& fileSystem, const char* pszFileName, FILE* pFile, CSearchPath::Entries_t& entries )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	assert( pFile );
 
-	if( !pFile )
+	typename PackType::Header_t header;
+
+	if( fread( &header, sizeof( header ), 1, pFile ) != 1 )
 	{
-		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Tell: Attempted to tell null file handle!\n" );
-		return 0;
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read pack file \"%s\" header!n", PackType::Info_t::NAME, pszFileName );
+		return false;
 	}
 
-	if( !pFile->IsOpen() )
+	header.dirofs = LittleValue( header.dirofs );
+	header.dirlen = LittleValue( header.dirlen );
+
+	if( ( header.dirlen % sizeof( typename PackType::Entry_t ) ) != 0 )
 	{
-		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Tell: Attempted to tell handle with null file pointer!\n" );
-		return 0;
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Invalid directory length for \"%s\"\n", PackType::Info_t::NAME, pszFileName );
+		return false;
 	}
 
-	if( pFile->IsPackEntry() )
+	const size_t numFiles = static_cast<size_t>( header.dirlen / sizeof( typename PackType::Entry_t ) );
+
+	if( numFiles > PackType::MAX_FILES )
 	{
-		const auto position = ftell64( pFile->GetFile() );
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Too many files in pack file \"%s\" (Max %u, got %u)\n", 
+							PackType::Info_t::NAME, pszFileName, PackType::MAX_FILES, numFiles );
+		return false;
+	}
+
+	fseek64( pFile, header.dirofs, SEEK_SET );
 
-		return position - pFile->GetStartOffset();
+	//Keep the raw directory; entries are added when the directory is first used.
+	std::unique_ptr<uint8_t[]> packEntries( new uint8_t[ numFiles * sizeof( typename PackType::Entry_t ) ] );
+
+	if( fread( packEntries.get(), sizeof( typename PackType::Entry_t ), numFiles, pFile ) != numFiles )
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read directory entries from \"%s\"\n", PackType::Info_t::NAME, pszFileName );
+		return false;
 	}
 
-	return ftell64( pFile->GetFile() );
+	entries.SetPending( std::move( packEntries ), numFiles, &LoadPackDirectory<PackType> );
+
+	return true;
 }
 
-uint64_t CFileSystem::Size64( FileHandle_t file )
+bool ProcessCompressedPackFile( CFileSystem& fileSystem, const char* pszFileName, FILE* pFile, CSearchPath::Entries_t& entries, uint32_t& uiBlockSize )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	assert( pFile );
 
-	if( !pFile )
+	typedef pack::CompressedPack PackType;
+
+	PackType::Header_t header;
+
+	if( fread( &header, sizeof( header ), 1, pFile ) != 1 )
 	{
-		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Size: Attempted to size null file handle!\n" );
-		return 0;
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read pack file \"%s\" header!\n", PackType::NAME, pszFileName );
+		return false;
 	}
 
-	if( !pFile->IsOpen() )
+	header.blocksize = LittleValue( header.blocksize );
+	header.dirofs = LittleValue( header.dirofs );
+	header.dirlen = LittleValue( header.dirlen );
+
+	if( header.blocksize == 0 || header.blocksize > PackType::MAX_BLOCK_SIZE )
 	{
-		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Size: Attempted to size handle with null file pointer!\n" );
-		return 0;
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Invalid block size %u for \"%s\"\n", PackType::NAME, header.blocksize, pszFileName );
+		return false;
 	}
 
-	return pFile->GetLength();
-}
+	if( header.dirlen < 0 || ( header.dirlen % sizeof( PackType::Entry_t ) ) != 0 )
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Invalid directory length for \"%s\"\n", PackType::NAME, pszFileName );
+		return false;
+	}
 
-uint64_t CFileSystem::Size64( const char *pFileName )
-{
-	if( !pFileName )
-		return -1;
+	const size_t numFiles = static_cast<size_t>( header.dirlen / sizeof( PackType::Entry_t ) );
 
-	std::error_code error;
+	if( numFiles > PackType::MAX_FILES )
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Too many files in pack file \"%s\" (Max %u, got %u)\n", 
+							PackType::NAME, pszFileName, PackType::MAX_FILES, numFiles );
+		return false;
+	}
 
-	return fs::file_size( pFileName, error );
-}
+	fseek64( pFile, header.dirofs, SEEK_SET );
 
-int64_t CFileSystem::GetFileTimeEx( const char *pFileName )
-{
-	fs::path path;
+	//Keep the raw directory; entries are added when the directory is first used.
+	std::unique_ptr<uint8_t[]> packEntries( new uint8_t[ numFiles * sizeof( PackType::Entry_t ) ] );
 
-	std::error_code error;
+	if( fread( packEntries.get(), sizeof( PackType::Entry_t ), numFiles, pFile ) != numFiles )
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read directory entries from \"%s\"\n", PackType::NAME, pszFileName );
+		return false;
+	}
 
-	for( const auto& searchPath : m_SearchPaths )
+	//Codecs are still checked up front so a pack file that can't be read is rejected when it's added.
+	auto pPackEntries = reinterpret_cast<const PackType::Entry_t*>( packEntries.get() );
+
+	for( size_t uiIndex = 0; uiIndex < numFiles; ++uiIndex )
 	{
-		if( searchPath->IsPackFile() )
-		{
-			auto it = searchPath->packEntries.find( pFileName );
+		const auto codec = static_cast<pack::Codec>( LittleValue( pPackEntries[ uiIndex ].codec ) );
 
-			if( it != searchPath->packEntries.end() )
-			{
-				//Use the pack file's file time. - Solokiller
-				return std::chrono::duration_cast<std::chrono::seconds>( fs::last_write_time( searchPath->szPath, error ).time_since_epoch() ).count();
-			}
-		}
-		else
+		if( codec != pack::Codec::NONE && codec != pack::Codec::LZ4 )
 		{
-			path = fs::path( searchPath->szPath ) / pFileName;
-
-			if( fs::exists( path, error ) )
-			{
-				//Don't cast to int64_t here so we get a warning if it's incompatible. - Solokiller
-				//Cast to seconds since the write time is returned in different format. - Solokiller
-				return std::chrono::duration_cast<std::chrono::seconds>( fs::last_write_time( path, error ).time_since_epoch() ).count();
-			}
+			fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Entry %u in \"%s\" uses unknown codec %u\n", 
+								PackType::NAME, static_cast<unsigned int>( uiIndex ), pszFileName, static_cast<unsigned int>( codec ) );
+			return false;
 		}
 	}
 
-	return 0;
-}
+	entries.SetPending( std::move( packEntries ), numFiles, &LoadCompressedPackDirectory );
 
-void CFileSystem::FileTimeToStringEx( char* pStrip, int maxCharsIncludingTerminator, int64_t fileTime )
-{
-	time_t time = fileTime;
-	auto pszResult = ctime( &time );
+	uiBlockSize = header.blocksize;
 
-	strncpy( pStrip, pszResult, maxCharsIncludingTerminator );
-	pStrip[ maxCharsIncludingTerminator - 1 ] = '\0';
+	return true;
 }
 
-int CFileSystem::VFPrintf( FileHandle_t file, const char *pFormat, va_list list )
+bool ProcessHashedPackFile( CFileSystem& fileSystem, const char* pszFileName, FILE* pFile, CSearchPath::Entries_t& entries, uint32_t& uiBlockSize )
 {
-	auto pFile = reinterpret_cast<CFileHandle*>( file );
+	assert( pFile );
 
-	if( !pFile )
+	typedef pack::HashedPack PackType;
+
+	PackType::Header_t header;
+
+	if( fread( &header, sizeof( header ), 1, pFile ) != 1 )
 	{
-		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::FPrint: Attempted to format print to null file handle!\n" );
-		return 0;
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read pack file \"%s\" header!\n", PackType::NAME, pszFileName );
+		return false;
 	}
 
-	if( !pFile->IsOpen() )
+	header.blocksize = LittleValue( header.blocksize );
+	header.bucketcount = LittleValue( header.bucketcount );
+	header.entrycount = LittleValue( header.entrycount );
+	header.dirofs = LittleValue( header.dirofs );
+	header.dirlen = LittleValue( header.dirlen );
+
+	if( header.blocksize == 0 || header.blocksize > pack::CompressedPack::MAX_BLOCK_SIZE )
 	{
-		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::FPrintf: Attempted to format print to handle with null file pointer!\n" );
-		return 0;
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Invalid block size %u for \"%s\"\n", PackType::NAME, header.blocksize, pszFileName );
+		return false;
 	}
 
-	const auto result = vfprintf( pFile->GetFile(), pFormat, list );
+	if( header.entrycount > PackType::MAX_FILES )
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Too many files in pack file \"%s\" (Max %u, got %u)\n", 
+							PackType::NAME, pszFileName, static_cast<unsigned int>( PackType::MAX_FILES ), header.entrycount );
+		return false;
+	}
 
-	return result;
-}
+	//Entries, buckets, slots and at most MAX_NAME_BYTES of names.
+	const uint64_t uiMaxDirLength = static_cast<uint64_t>( header.entrycount ) * ( sizeof( PackType::Entry_t ) + sizeof( uint32_t ) ) + 
+		( static_cast<uint64_t>( PackType::MAX_BUCKETS ) + 1 ) * sizeof( uint32_t ) + PackType::MAX_NAME_BYTES;
 
-const char *CFileSystem::FindFirstEx( const char *pWildCard, FileFindHandle_t *pHandle, FileSystemFindFlags_t flags, const char *pathID )
-{
-	if( !pWildCard || !pHandle )
-		return nullptr;
+	if( header.dirlen < 0 || static_cast<uint64_t>( header.dirlen ) > uiMaxDirLength )
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Invalid directory length for \"%s\"\n", PackType::NAME, pszFileName );
+		return false;
+	}
 
-	FindFileData data;
+	fseek64( pFile, header.dirofs, SEEK_SET );
 
-	//Note: Not the same constant! - Solokiller
-	if( flags & FileSystemFindFlag::SKIP_IDENTICAL_PATHS )
-		data.flags |= FindFileFlag::SKIP_IDENTICAL_PATHS;
+	const size_t uiDirLength = static_cast<size_t>( header.dirlen );
 
-	data.szFilter = std::move( fs::path( pWildCard ).make_preferred().u8string() );
+	std::unique_ptr<uint8_t[]> directory( new uint8_t[ uiDirLength ] );
 
-	if( pathID )
+	if( uiDirLength > 0 && fread( directory.get(), uiDirLength, 1, pFile ) != 1 )
 	{
-		strncpy( data.szPathID, pathID, sizeof( data.szPathID ) );
-		data.szPathID[ sizeof( data.szPathID ) - 1 ] = '\0';
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read directory from \"%s\"\n", PackType::NAME, pszFileName );
+		return false;
 	}
-	else
+
+	//The directory is used as is, so it's checked in full here instead of when it's first used.
+	if( !entries.SetHashed( directory.get(), uiDirLength, header.bucketcount, header.entrycount ) )
 	{
-		data.szPathID[ 0 ] = '\0';
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Invalid directory in \"%s\"\n", PackType::NAME, pszFileName );
+		return false;
 	}
 
-	data.currentPath = m_SearchPaths.end();
+	uiBlockSize = header.blocksize;
 
-	m_FindFiles.emplace_back( std::make_unique<FindFileData>( std::move( data ) ) );
+	return true;
+}
 
-	*pHandle = m_FindFiles.size() - 1;
+bool ProcessWadFile( CFileSystem& fileSystem, const char* pszFileName, FILE* pFile, CSearchPath::Entries_t& entries )
+{
+	assert( pFile );
 
-	if( auto pszFileName = FindNext( *pHandle ) )
-		return pszFileName;
+	typedef pack::Wad PackType;
 
-	//Nothing found.
-	FindClose( *pHandle );
+	PackType::Header_t header;
 
-	*pHandle = FILESYSTEM_INVALID_FIND_HANDLE;
+	if( fread( &header, sizeof( header ), 1, pFile ) != 1 )
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read WAD file \"%s\" header!\n", PackType::NAME, pszFileName );
+		return false;
+	}
 
-	return nullptr;
-}
+	header.numlumps = LittleValue( header.numlumps );
+	header.infotableofs = LittleValue( header.infotableofs );
 
-bool CFileSystem::FullPathToRelativePathEx( const char *pFullpath, char *pRelative, size_t uiSizeInChars )
-{
-	if( !pRelative || uiSizeInChars <= 0 )
+	if( header.numlumps < 0 || header.infotableofs < 0 )
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Invalid lump directory for \"%s\"\n", PackType::NAME, pszFileName );
 		return false;
+	}
 
-	if( !pFullpath || !( *pFullpath ) )
+	const size_t numFiles = static_cast<size_t>( header.numlumps );
+
+	if( numFiles > PackType::MAX_FILES )
 	{
-		*pRelative = '\0';
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Too many lumps in WAD file \"%s\" (Max %u, got %u)\n", 
+							PackType::NAME, pszFileName, static_cast<unsigned int>( PackType::MAX_FILES ), static_cast<unsigned int>( numFiles ) );
 		return false;
 	}
 
-	std::string szFullpath = fs::path( pFullpath ).make_preferred().u8string();
+	fseek64( pFile, header.infotableofs, SEEK_SET );
 
-	for( auto it = m_SearchPaths.begin(), end = m_SearchPaths.end(); it != end; ++it )
+	//Keep the raw directory; entries are added when the directory is first used.
+	std::unique_ptr<uint8_t[]> lumps( new uint8_t[ numFiles * sizeof( PackType::Lump_t ) ] );
+
+	if( fread( lumps.get(), sizeof( PackType::Lump_t ), numFiles, pFile ) != numFiles )
 	{
-		const char* const pszPath = it->get()->szPath;
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read lump directory from \"%s\"\n", PackType::NAME, pszFileName );
+		return false;
+	}
 
-		const auto uiLength = strlen( pszPath );
+	auto pLumps = reinterpret_cast<const PackType::Lump_t*>( lumps.get() );
 
-		if( strnicmp( szFullpath.c_str(), pszPath, uiLength ) == 0 )
+	for( size_t uiIndex = 0; uiIndex < numFiles; ++uiIndex )
+	{
+		if( pLumps[ uiIndex ].compression != PackType::COMPRESSION_NONE )
 		{
-			//If the input path is identical to the search path, this can happen.
-			//This should only be used to get relative paths to files and perhaps directories, so it's rather useless to return empty paths.
-			if( szFullpath.length() > uiLength )
-			{
-				//Skip the slash that separates the search path from the relative path.
-				strncpy( pRelative, &szFullpath[ uiLength + 1 ], uiSizeInChars );
-				pRelative[ uiSizeInChars - 1 ] = '\0';
-				return true;
-			}
+			fileSystem.Warning( FILESYSTEM_WARNING_REPORTUSAGE, "ProcessPackFile(%s): Lump \"%.*s\" in \"%s\" is compressed and will be skipped\n", 
+								PackType::NAME, static_cast<int>( PackType::LUMP_NAME_MAX_LENGTH ), pLumps[ uiIndex ].szName, pszFileName );
 		}
 	}
 
-	return false;
+	entries.SetPending( std::move( lumps ), numFiles, &LoadWadDirectory );
+
+	return true;
 }
 
-void CFileSystem::Warning( FileWarningLevel_t level, const char* pszFormat, ... )
+/**
+*	Reads a little endian value from a ZIP record.
+*/
+template<typename T>
+T ReadZipValue( const uint8_t* pData )
 {
-	char szBuffer[ 4096 ];
+	T value;
 
-	if( level <= m_WarningLevel )
-	{
-		va_list list;
+	memcpy( &value, pData, sizeof( value ) );
 
-		va_start( list, pszFormat );
+	return LittleValue( value );
+}
 
-		vsnprintf( szBuffer, sizeof( szBuffer ), pszFormat, list );
+bool ProcessZipFile( CFileSystem& fileSystem, const char* pszFileName, FILE* pFile, CSearchPath::Entries_t& entries )
+{
+	assert( pFile );
 
-		if( m_WarningFunc )
-			m_WarningFunc( "%s", szBuffer );
-		else
-			fprintf( stderr, "%s", szBuffer );
+	typedef pack::Zip PackType;
 
-		va_end( list );
-	}
-}
+	fseek64( pFile, 0, SEEK_END );
 
-CFileSystem::SearchPaths_t::const_iterator CFileSystem::FindSearchPath( const char* pszPath, const bool bCheckPathID, const char* pszPathID ) const
-{
-	fs::path path( pszPath );
+	const uint64_t uiFileSize = static_cast<uint64_t>( std::max<int64_t>( ftell64( pFile ), 0 ) );
 
-	std::error_code error;
+	//The end of central directory record is followed by a comment, so it has to be searched for.
+	//The ZIP64 locator comes right before it, so it's read as well.
+	std::vector<uint8_t> tail( static_cast<size_t>( std::min<uint64_t>( uiFileSize, PackType::END64_LOCATOR_SIZE + PackType::END_SIZE + PackType::MAX_COMMENT_LENGTH ) ) );
 
-	path = fs::canonical( path, error );
+	fseek64( pFile, uiFileSize - tail.size(), SEEK_SET );
 
-	if( error )
-		return m_SearchPaths.end();
+	if( tail.size() < PackType::END_SIZE || fread( tail.data(), tail.size(), 1, pFile ) != 1 )
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read ZIP file \"%s\" end of central directory!\n", PackType::NAME, pszFileName );
+		return false;
+	}
 
-	const auto szPath = path.u8string();
+	const uint8_t* pEnd = nullptr;
 
-	for( auto it = m_SearchPaths.begin(), end = m_SearchPaths.end(); it != end; ++it )
+	for( size_t uiPos = tail.size() - PackType::END_SIZE + 1; uiPos-- > 0; )
 	{
-		if( stricmp( szPath.c_str(), ( *it )->szPath ) == 0 )
+		if( ReadZipValue<uint32_t>( &tail[ uiPos ] ) == PackType::END_SIGNATURE &&
+			uiPos + PackType::END_SIZE + ReadZipValue<uint16_t>( &tail[ uiPos + 20 ] ) <= tail.size() )
 		{
-			if( !bCheckPathID ||
-				( ( pszPathID == nullptr && ( *it )->pszPathID == nullptr ) ||
-				( ( pszPathID != nullptr && ( *it )->pszPathID != nullptr ) && strcmp( pszPathID, ( *it )->pszPathID ) == 0 ) ) )
-				return it;
+			pEnd = &tail[ uiPos ];
+			break;
 		}
 	}
 
-	return m_SearchPaths.end();
-}
-
-bool CFileSystem::AddSearchPath( const char *pPath, const char *pathID, const bool bReadOnly )
-{
-	if( !pPath )
+	if( !pEnd )
 	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't find ZIP file \"%s\" end of central directory!\n", PackType::NAME, pszFileName );
 		return false;
 	}
 
-	//Despite the documentation stating that bsp files are supported, the filesystem doesn't actually support it. Sorry. - Solokiller
-	if( strstr( pPath, ".bsp" ) )
+	if( ReadZipValue<uint16_t>( pEnd + 4 ) != 0 || ReadZipValue<uint16_t>( pEnd + 6 ) != 0 )
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Spanned ZIP file \"%s\" is not supported\n", PackType::NAME, pszFileName );
 		return false;
+	}
 
-	if( FindSearchPath( pPath, true, pathID ) != m_SearchPaths.end() )
+	uint64_t uiEntryCount = ReadZipValue<uint16_t>( pEnd + 10 );
+	uint64_t uiDirectorySize = ReadZipValue<uint32_t>( pEnd + 12 );
+	uint64_t uiDirectoryOffset = ReadZipValue<uint32_t>( pEnd + 16 );
+
+	if( pEnd - tail.data() >= static_cast<ptrdiff_t>( PackType::END64_LOCATOR_SIZE ) &&
+		ReadZipValue<uint32_t>( pEnd - PackType::END64_LOCATOR_SIZE ) == PackType::END64_LOCATOR_SIGNATURE )
+	{
+		uint8_t end64[ PackType::END64_SIZE ];
+
+		fseek64( pFile, ReadZipValue<uint64_t>( pEnd - PackType::END64_LOCATOR_SIZE + 8 ), SEEK_SET );
+
+		if( fread( end64, sizeof( end64 ), 1, pFile ) != 1 || ReadZipValue<uint32_t>( end64 ) != PackType::END64_SIGNATURE )
+		{
+			fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read ZIP64 end of central directory from \"%s\"\n", PackType::NAME, pszFileName );
+			return false;
+		}
+
+		uiEntryCount = ReadZipValue<uint64_t>( end64 + 32 );
+		uiDirectorySize = ReadZipValue<uint64_t>( end64 + 40 );
+		uiDirectoryOffset = ReadZipValue<uint64_t>( end64 + 48 );
+	}
+
+	if( uiEntryCount > PackType::MAX_FILES )
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Too many files in ZIP file \"%s\" (Max %u, got %u)\n", 
+							PackType::NAME, pszFileName, static_cast<unsigned int>( PackType::MAX_FILES ), static_cast<unsigned int>( uiEntryCount ) );
 		return false;
+	}
 
-	fs::path osPath( pPath );
+	if( uiDirectorySize > PackType::MAX_DIRECTORY_SIZE || uiDirectorySize < uiEntryCount * PackType::CENTRAL_HEADER_SIZE ||
+		uiDirectoryOffset > uiFileSize || uiFileSize - uiDirectoryOffset < uiDirectorySize )
+	{
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Invalid central directory for \"%s\"\n", PackType::NAME, pszFileName );
+		return false;
+	}
 
-	//Convert all search paths to the absolute representation, fully resolved.
-	std::error_code error;
+	std::vector<uint8_t> directory( static_cast<size_t>( uiDirectorySize ) );
 
-	osPath = fs::canonical( osPath, error );
+	fseek64( pFile, uiDirectoryOffset, SEEK_SET );
 
-	//Don't want to add empty paths when non-existent search paths are added.
-	if( error || osPath.empty() )
+	if( !directory.empty() && fread( directory.data(), directory.size(), 1, pFile ) != 1 )
 	{
-		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddSearchPath: Couldn't convert path \"%s\" to its canonial representation\n", pPath );
+		fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Couldn't read central directory from \"%s\"\n", PackType::NAME, pszFileName );
 		return false;
 	}
 
-	osPath.make_preferred();
+	std::vector<ZipEntry_t> zipEntries;
+	std::vector<char> names;
 
-	auto path = std::make_unique<CSearchPath>();
+	zipEntries.reserve( static_cast<size_t>( uiEntryCount ) );
 
-	strncpy( path->szPath, osPath.u8string().c_str(), sizeof( path->szPath ) );
-	path->szPath[ sizeof( path->szPath ) - 1 ] = '\0';
+	size_t uiPos = 0;
 
-	path->pszPathID = pathID;
+	for( uint64_t uiIndex = 0; uiIndex < uiEntryCount; ++uiIndex )
+	{
+		const uint8_t* pHeader = directory.data() + uiPos;
 
-	path->flags = SearchPathFlag::NONE;
+		if( directory.size() - uiPos < PackType::CENTRAL_HEADER_SIZE || ReadZipValue<uint32_t>( pHeader ) != PackType::CENTRAL_HEADER_SIGNATURE )
+		{
+			fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Invalid central directory for \"%s\"\n", PackType::NAME, pszFileName );
+			return false;
+		}
 
-	if( bReadOnly )
-		path->flags |= SearchPathFlag::READ_ONLY;
+		const uint16_t flags = ReadZipValue<uint16_t>( pHeader + 8 );
+		const uint16_t method = ReadZipValue<uint16_t>( pHeader + 10 );
+		const size_t uiNameLength = ReadZipValue<uint16_t>( pHeader + 28 );
+		const size_t uiExtraLength = ReadZipValue<uint16_t>( pHeader + 30 );
+		const size_t uiCommentLength = ReadZipValue<uint16_t>( pHeader + 32 );
 
-	m_SearchPaths.emplace_back( std::move( path ) );
+		const size_t uiRecordSize = PackType::CENTRAL_HEADER_SIZE + uiNameLength + uiExtraLength + uiCommentLength;
 
-	//Add any game pack files present in the path.
-	AddPackFiles( m_SearchPaths.back()->szPath );
+		if( directory.size() - uiPos < uiRecordSize )
+		{
+			fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): Invalid central directory for \"%s\"\n", PackType::NAME, pszFileName );
+			return false;
+		}
 
-	return true;
-}
+		uiPos += uiRecordSize;
 
-bool CFileSystem::PreparePackFile( const char* pszFullPath, const char* pszPathID, CFileHandle& file, int64_t offset )
-{
-	fseek64( file.GetFile(), file.GetStartOffset() + offset, SEEK_SET );
+		const auto pszName = reinterpret_cast<const char*>( pHeader + PackType::CENTRAL_HEADER_SIZE );
 
-	pack::PackType type;
+		//Directories are implied by file names.
+		if( uiNameLength == 0 || pszName[ uiNameLength - 1 ] == '/' )
+			continue;
 
-	{
-		pack::Header_t header;
+		uint64_t uiStoredLength = ReadZipValue<uint32_t>( pHeader + 20 );
+		uint64_t uiLength = ReadZipValue<uint32_t>( pHeader + 24 );
+		uint64_t uiLocalOffset = ReadZipValue<uint32_t>( pHeader + 42 );
 
-		if( fread( &header, sizeof( header ), 1, file.GetFile() ) != 1 )
+		//Values that don't fit are in the ZIP64 extra field, in this order.
+		uint64_t* const zip64Values[] = { &uiLength, &uiStoredLength, &uiLocalOffset };
+
+		bool bValid = true;
+
+		for( const uint8_t* pExtra = pHeader + PackType::CENTRAL_HEADER_SIZE + uiNameLength, *pExtraEnd = pExtra + uiExtraLength; pExtraEnd - pExtra >= 4; )
 		{
-			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddPackFile: Couldn't read pack file \"%s\" identifier\n", pszFullPath );
-			return false;
+			const uint16_t id = ReadZipValue<uint16_t>( pExtra );
+			const size_t uiSize = ReadZipValue<uint16_t>( pExtra + 2 );
+
+			pExtra += 4;
+
+			if( static_cast<size_t>( pExtraEnd - pExtra ) < uiSize )
+				break;
+
+			if( id == PackType::EXTRA_ZIP64 )
+			{
+				const uint8_t* pValue = pExtra;
+
+				for( auto pValueOut : zip64Values )
+				{
+					if( *pValueOut != PackType::ZIP64_VALUE )
+						continue;
+
+					if( pValue + sizeof( uint64_t ) > pExtra + uiSize )
+						break;
+
+					*pValueOut = ReadZipValue<uint64_t>( pValue );
+					pValue += sizeof( uint64_t );
+				}
+			}
+
+			pExtra += uiSize;
 		}
 
-		type = pack::IdentifyPackType( header );
-	}
+		for( auto pValue : zip64Values )
+		{
+			if( *pValue == PackType::ZIP64_VALUE )
+				bValid = false;
+		}
 
-	if( type == pack::PackType::NOT_A_PACK )
-	{
-		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddPackFile: \"%s\" is not a pack file\n", pszFullPath );
-		return false;
-	}
+		pack::Codec codec = pack::Codec::NONE;
 
-	fseek64( file.GetFile(), file.GetStartOffset() + offset, SEEK_SET );
+		if( flags & PackType::FLAG_ENCRYPTED )
+		{
+			fileSystem.Warning( FILESYSTEM_WARNING_REPORTUSAGE, "ProcessPackFile(%s): File \"%.*s\" in \"%s\" is encrypted and will be skipped\n", 
+								PackType::NAME, static_cast<int>( uiNameLength ), pszName, pszFileName );
+			continue;
+		}
+		else if( method == PackType::METHOD_STORED )
+		{
+			bValid = bValid && uiStoredLength == uiLength;
+		}
+		else if( method == PackType::METHOD_DEFLATE )
+		{
+			if( uiLength > PackType::MAX_DEFLATE_LENGTH )
+			{
+				fileSystem.Warning( FILESYSTEM_WARNING_REPORTUSAGE, "ProcessPackFile(%s): Deflated file \"%.*s\" in \"%s\" is too large and will be skipped\n", 
+									PackType::NAME, static_cast<int>( uiNameLength ), pszName, pszFileName );
+				continue;
+			}
 
-	CSearchPath::Entries_t entries;
+			codec = pack::Codec::DEFLATE;
+		}
+		else
+		{
+			fileSystem.Warning( FILESYSTEM_WARNING_REPORTUSAGE, "ProcessPackFile(%s): File \"%.*s\" in \"%s\" uses unsupported method %u and will be skipped\n", 
+								PackType::NAME, static_cast<int>( uiNameLength ), pszName, pszFileName, static_cast<unsigned int>( method ) );
+			continue;
+		}
 
-	bool bSuccess = false;
+		//The data follows the local header, whose name and extra field can differ from the central directory's.
+		uint8_t localHeader[ PackType::LOCAL_HEADER_SIZE ];
 
-	switch( type )
-	{
-	case pack::PackType::PACK_32BIT:	bSuccess = ProcessPackFile<pack::Pack32_t>( *this, pszFullPath, file.GetFile(), entries ); break;
-	case pack::PackType::PACK_64BIT:	bSuccess = ProcessPackFile<pack::Pack64_t>( *this, pszFullPath, file.GetFile(), entries ); break;
-	}
+		if( bValid )
+		{
+			fseek64( pFile, uiLocalOffset, SEEK_SET );
 
-	if( !bSuccess )
-	{
-		return false;
-	}
+			bValid = uiLocalOffset < uiFileSize && fread( localHeader, sizeof( localHeader ), 1, pFile ) == 1 &&
+				ReadZipValue<uint32_t>( localHeader ) == PackType::LOCAL_HEADER_SIGNATURE;
+		}
 
-	auto path = std::make_unique<CSearchPath>();
+		const uint64_t uiStartOffset = bValid ? 
+			uiLocalOffset + PackType::LOCAL_HEADER_SIZE + ReadZipValue<uint16_t>( localHeader + 26 ) + ReadZipValue<uint16_t>( localHeader + 28 ) : 0;
 
-	fs::path osPath( pszFullPath );
+		if( !bValid || uiStartOffset > uiFileSize || uiFileSize - uiStartOffset < uiStoredLength )
+		{
+			fileSystem.Warning( FILESYSTEM_WARNING_CRITICAL, "ProcessPackFile(%s): File \"%.*s\" in \"%s\" is invalid and will be skipped\n", 
+								PackType::NAME, static_cast<int>( uiNameLength ), pszName, pszFileName );
+			continue;
+		}
 
-	osPath.make_preferred();
+		ZipEntry_t zipEntry;
 
-	strncpy( path->szPath, osPath.u8string().c_str(), sizeof( path->szPath ) );
-	path->szPath[ sizeof( path->szPath ) - 1 ] = '\0';
+		zipEntry.uiStartOffset = uiStartOffset;
+		zipEntry.uiLength = uiLength;
+		zipEntry.uiStoredLength = uiStoredLength;
+		zipEntry.codec = codec;
+		zipEntry.uiNameOffset = static_cast<uint32_t>( names.size() );
+		zipEntry.uiNameLength = static_cast<uint32_t>( uiNameLength );
+		zipEntry.uiReserved = 0;
 
-	path->pszPathID = pszPathID;
+		zipEntries.push_back( zipEntry );
+		names.insert( names.end(), pszName, pszName + uiNameLength );
+	}
 
-	path->flags = SearchPathFlag::READ_ONLY | SearchPathFlag::IS_PACK_FILE;
+	//Keep the parsed directory; entries are added when the directory is first used.
+	const size_t uiEntriesSize = zipEntries.size() * sizeof( ZipEntry_t );
 
-	path->packFile = std::make_unique<CFileHandle>( std::move( file ) );
+	std::unique_ptr<uint8_t[]> data( new uint8_t[ uiEntriesSize + names.size() ] );
 
-	path->packEntries = std::move( entries );
+	if( !zipEntries.empty() )
+	{
+		memcpy( data.get(), zipEntries.data(), uiEntriesSize );
+		memcpy( data.get() + uiEntriesSize, names.data(), names.size() );
+	}
 
-	m_SearchPaths.emplace_back( std::move( path ) );
+	entries.SetPending( std::move( data ), zipEntries.size(), &LoadZipDirectory );
 
 	return true;
 }
 
-bool CFileSystem::AddPackFile( const char* pszFullPath, const char* pszPathID, const bool bCheckForAppendPack )
+bool CFileSystem::AddPackFile( const char *fullpath, const char *pathID )
 {
-	if( !pszFullPath )
-		return false;
-
-	CFileHandle file( *this, pszFullPath, "rb", true );
+	auto lock = LockExclusive();
 
-	if( !file.IsOpen() )
-		return false;
+	return AddPackFile( fullpath, pathID, true );
+}
 
-	int64_t iOffset = 0;
+FileHandle_t CFileSystem::OpenFromCacheForRead( const char *pFileName, const char *pOptions, const char *pathID )
+{
+	if( !pFileName || !pOptions )
+		return FILESYSTEM_INVALID_HANDLE;
 
-	if( bCheckForAppendPack )
+	if( strchr( pOptions, 'w' ) || strchr( pOptions, '+' ) )
 	{
-		pack::PackAppend_t header;
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::OpenFromCacheForRead: Tried to open file \"%s\" with write option!\n", pFileName );
+		return FILESYSTEM_INVALID_HANDLE;
+	}
 
-		fseek64( file.GetFile(), -static_cast<int64_t>( sizeof( header ) ), SEEK_END );
+	auto lock = LockShared();
 
-		if( fread( &header, sizeof( header ), 1, file.GetFile() ) != 1 )
-		{
-			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddPackFile: Failed to read pack append header for pack file \"%s\"!\n", pszFullPath );
-			return false;
-		}
+	const auto id = m_PathIDs.Find( pathID );
 
-		if( pack::IsAppendPack( header ) )
+	CPathIndex::Locations_t merged;
+
+	//Pack files are always either indexed or searched by the index.
+	if( auto pLocations = m_PathIndex.Find( pFileName, &merged ) )
+	{
+		for( const auto& location : *pLocations )
 		{
-			iOffset = header.packheaderpos;
+			if( !location.pEntry || !location.pSearchPath->MatchesPathID( id ) )
+				continue;
+
+			if( auto hFile = FindFile( *location.pSearchPath, location.GetFileName( pFileName ), pOptions, location.pEntry ) )
+				return hFile;
 		}
 	}
 
-	return PreparePackFile( pszFullPath, pszPathID, file, iOffset );
+	return FILESYSTEM_INVALID_HANDLE;
 }
 
-void CFileSystem::AddPackFiles( const char* pszPath )
+void CFileSystem::AddSearchPathNoWrite( const char *pPath, const char *pathID )
+{
+	AddSearchPath( pPath, pathID, SearchPathFlag::READ_ONLY );
+}
+
+void CFileSystem::Seek64( FileHandle_t file, int64_t pos, FileSystemSeek_t seekType )
 {
-	char szPath[ MAX_PATH ];
+	auto pFile = m_OpenedFiles.Get( file );
 
-	std::error_code error;
+	if( !pFile )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Seek: Attempted to seek null file handle!\n" );
+		return;
+	}
+
+	if( !pFile->IsOpen() )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Seek: Attempted to seek handle with null file pointer!\n" );
+		return;
+	}
+
+	if( auto pStats = pFile->GetStats() )
+		pStats->uiSeeks.fetch_add( 1, std::memory_order_relaxed );
 
-	for( size_t uiPakIndex = 0; ; ++uiPakIndex )
+	if( pFile->IsPackEntry() )
 	{
-		snprintf( szPath, sizeof( szPath ), "%s/pak%u.pak", pszPath, uiPakIndex );
+		int64_t base;
 
-		if( !fs::exists( szPath, error ) )
-			break;
+		switch( seekType )
+		{
+		case FILESYSTEM_SEEK_HEAD:		base = 0; break;
+		case FILESYSTEM_SEEK_CURRENT:	base = static_cast<int64_t>( pFile->GetPosition() ); break;
+		case FILESYSTEM_SEEK_TAIL:		base = static_cast<int64_t>( pFile->GetLength() ); break;
+		default:
+			{
+				Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Seek: invalid seek type '%d'\n", seekType );
+				return;
+			}
+		}
+
+		const int64_t position = base + pos;
 
-		AddPackFile( szPath, "", false );
+		if( position < 0 )
+			return;
+
+		//Reads are clamped to the entry, so don't let the position go past the end.
+		pFile->SetPosition( std::min( static_cast<uint64_t>( position ), pFile->GetLength() ) );
+
+		return;
 	}
-}
 
-CFileHandle* CFileSystem::FindFile( CSearchPath& searchPath, const char* pszFileName, const char* pszOptions )
-{
-	std::unique_ptr<CFileHandle> file;
-	
-	if( searchPath.IsPackFile() )
+	int origin;
+
+	switch( seekType )
 	{
-		auto path = fs::path( pszFileName );
+	case FILESYSTEM_SEEK_HEAD:		origin = SEEK_SET; break;
+	case FILESYSTEM_SEEK_CURRENT:	origin = SEEK_CUR; break;
+	case FILESYSTEM_SEEK_TAIL:		origin = SEEK_END; break;
+	default:
+		{
+			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Seek: invalid seek type '%d'\n", seekType );
+			return;
+		}
+	}
 
-		path.make_preferred();
+	if( pFile->IsWriteBehind() )
+		m_AsyncWriter.Flush( pFile->GetFile() );
 
-		auto szFileName = path.u8string();
+	if( pFile->IsReadAhead() )
+	{
+		//Seeks that stay in the buffered data don't need to touch the file.
+		if( origin != SEEK_END )
+		{
+			const int64_t position = ( origin == SEEK_CUR ? static_cast<int64_t>( pFile->GetPosition() ) : 0 ) + pos;
 
-		auto it = searchPath.packEntries.find( szFileName.c_str() );
+			if( position >= 0 )
+				pFile->SetPosition( static_cast<uint64_t>( position ) );
 
-		if( it == searchPath.packEntries.end() )
-			return nullptr;
+			return;
+		}
+
+		pFile->DiscardReadAhead();
 
-		auto& entry = *( it->second );
+		if( fseek64( pFile->GetFile(), pos, origin ) == 0 )
+			pFile->SetPosition( static_cast<uint64_t>( ftell64( pFile->GetFile() ) ) );
 
-		file = std::make_unique<CFileHandle>( *this, std::move( path.u8string() ), searchPath.packFile->GetFile(), entry.GetStartOffset(), entry.GetLength() );
+		return;
 	}
-	else
-	{
-		auto path = fs::path( searchPath.szPath ) / pszFileName;
 
-		path.make_preferred();
+	fseek64( pFile->GetFile(), pos, origin );
+}
+
+uint64_t CFileSystem::Tell64( FileHandle_t file )
+{
+	auto pFile = m_OpenedFiles.Get( file );
 
-		file = std::make_unique<CFileHandle>( *this, path.u8string().c_str(), pszOptions );
+	if( !pFile )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Tell: Attempted to tell null file handle!\n" );
+		return 0;
 	}
 
-	if( file->IsOpen() )
+	if( !pFile->IsOpen() )
 	{
-		m_OpenedFiles.emplace_back( std::move( file ) );
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Tell: Attempted to tell handle with null file pointer!\n" );
+		return 0;
+	}
 
-		return m_OpenedFiles.back().get();
+	if( pFile->IsPackEntry() || pFile->IsReadAhead() )
+	{
+		return pFile->GetPosition();
 	}
 
-	return nullptr;
+	if( pFile->IsWriteBehind() )
+		m_AsyncWriter.Flush( pFile->GetFile() );
+
+	return ftell64( pFile->GetFile() );
+}
+
+uint64_t CFileSystem::Size64( FileHandle_t file )
+{
+	auto pFile = m_OpenedFiles.Get( file );
+
+	if( !pFile )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Size: Attempted to size null file handle!\n" );
+		return 0;
+	}
+
+	if( !pFile->IsOpen() )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::Size: Attempted to size handle with null file pointer!\n" );
+		return 0;
+	}
+
+	return pFile->GetLength();
+}
+
+uint64_t CFileSystem::Size64( const char *pFileName )
+{
+	if( !pFileName )
+		return -1;
+
+	std::error_code error;
+
+	const CPackFileEntry* pEntry;
+	const char* pszActualName;
+
+	ProcessDirectoryChanges();
+
+	auto lock = LockShared();
+
+	if( auto pSearchPath = ResolveFile( pFileName, nullptr, &pEntry, nullptr, &pszActualName ) )
+	{
+		if( pEntry )
+			return pEntry->GetLength();
+
+		CMetadataCache::Metadata_t metadata;
+
+		if( GetFileMetadata( *pSearchPath, pszActualName, metadata ) )
+			return metadata.uiSize;
+
+		return static_cast<uint64_t>( -1 );
+	}
+
+	//Not in any search path, treat it as an OS path.
+	return fs::file_size( pFileName, error );
+}
+
+int64_t CFileSystem::GetFileTimeEx( const char *pFileName )
+{
+	if( !pFileName )
+		return 0;
+
+	const CPackFileEntry* pEntry;
+	const char* pszActualName;
+
+	ProcessDirectoryChanges();
+
+	auto lock = LockShared();
+
+	if( auto pSearchPath = ResolveFile( pFileName, nullptr, &pEntry, nullptr, &pszActualName ) )
+	{
+		//Use the pack file's file time. - Solokiller
+		if( pEntry )
+			return pSearchPath->iPackFileTime;
+
+		CMetadataCache::Metadata_t metadata;
+
+		if( GetFileMetadata( *pSearchPath, pszActualName, metadata ) )
+			return metadata.iModifiedTime;
+	}
+
+	return 0;
+}
+
+void CFileSystem::FileTimeToStringEx( char* pStrip, int maxCharsIncludingTerminator, int64_t fileTime )
+{
+	time_t time = fileTime;
+	auto pszResult = ctime( &time );
+
+	strncpy( pStrip, pszResult, maxCharsIncludingTerminator );
+	pStrip[ maxCharsIncludingTerminator - 1 ] = '\0';
+}
+
+int CFileSystem::VFPrintf( FileHandle_t file, const char *pFormat, va_list list )
+{
+	auto pFile = m_OpenedFiles.Get( file );
+
+	if( !pFile )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::FPrint: Attempted to format print to null file handle!\n" );
+		return 0;
+	}
+
+	if( !pFile->IsOpen() )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::FPrintf: Attempted to format print to handle with null file pointer!\n" );
+		return 0;
+	}
+
+	//Memory files are read only.
+	if( pFile->IsMemory() )
+		return 0;
+
+	if( pFile->IsWriteBehind() )
+	{
+		char szBuffer[ 1024 ];
+
+		va_list copy;
+
+		va_copy( copy, list );
+
+		const auto result = vsnprintf( szBuffer, sizeof( szBuffer ), pFormat, copy );
+
+		va_end( copy );
+
+		if( result <= 0 )
+			return result;
+
+		if( static_cast<size_t>( result ) < sizeof( szBuffer ) )
+		{
+			m_AsyncWriter.Write( pFile->GetFile(), szBuffer, static_cast<size_t>( result ) );
+		}
+		else
+		{
+			std::vector<char> buffer( static_cast<size_t>( result ) + 1 );
+
+			vsnprintf( buffer.data(), buffer.size(), pFormat, list );
+
+			m_AsyncWriter.Write( pFile->GetFile(), buffer.data(), static_cast<size_t>( result ) );
+		}
+
+		return result;
+	}
+
+	const auto result = vfprintf( pFile->GetFile(), pFormat, list );
+
+	return result;
+}
+
+const char *CFileSystem::FindFirstEx( const char *pWildCard, FileFindHandle_t *pHandle, FileSystemFindFlags_t flags, const char *pathID )
+{
+	if( !pWildCard || !pHandle )
+		return nullptr;
+
+	*pHandle = FILESYSTEM_INVALID_FIND_HANDLE;
+
+	CPathBuffer wildcard;
+
+	if( !wildcard.Set( pWildCard ) )
+		return nullptr;
+
+	auto& findFiles = GetFindFiles();
+
+	uint32_t uiIndex;
+
+	if( !findFiles.freeSlots.empty() )
+	{
+		uiIndex = findFiles.freeSlots.back();
+		findFiles.freeSlots.pop_back();
+	}
+	else
+	{
+		if( findFiles.data.size() >= MAX_FIND_HANDLES )
+		{
+			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::FindFirstEx: Too many open find handles!\n" );
+			return nullptr;
+		}
+
+		uiIndex = static_cast<uint32_t>( findFiles.data.size() );
+
+		findFiles.data.emplace_back( std::make_unique<FindFileData>() );
+	}
+
+	//Reused searches keep the memory of their strings and vectors.
+	auto& data = *findFiles.data[ uiIndex ];
+
+	data.flags = FindFileFlag::VALID;
+
+	//Note: Not the same constant! - Solokiller
+	if( flags & FileSystemFindFlag::SKIP_IDENTICAL_PATHS )
+		data.flags |= FindFileFlag::SKIP_IDENTICAL_PATHS;
+
+	data.filter.Compile( wildcard.Get() );
+
+	data.szPrefix = data.filter.GetPrefix();
+
+	const auto uiSeparator = data.szPrefix.find_last_of( "/\\" );
+
+	if( uiSeparator != std::string::npos )
+		data.szPrefixDirectory.assign( data.szPrefix, 0, uiSeparator );
+	else
+		data.szPrefixDirectory.clear();
+
+	if( pathID )
+	{
+		strncpy( data.szPathID, pathID, sizeof( data.szPathID ) );
+		data.szPathID[ sizeof( data.szPathID ) - 1 ] = '\0';
+	}
+	else
+	{
+		data.szPathID[ 0 ] = '\0';
+	}
+
+	data.memoryFiles.clear();
+	data.uiMemoryFile = 0;
+	data.searchedPaths.clear();
+
+	//Pack search paths have no directory entries, so their names aren't directories.
+	data.entry = fs::directory_entry();
+
+	{
+		auto lock = LockShared();
+
+		data.uiNextPath = 0;
+		data.uiSearchPathGeneration = m_uiSearchPathGeneration;
+	}
+
+	*pHandle = static_cast<FileFindHandle_t>( uiIndex | ( static_cast<uint32_t>( data.uiGeneration ) << FIND_GENERATION_SHIFT ) );
+
+	if( auto pszFileName = FindNext( *pHandle ) )
+		return pszFileName;
+
+	//Nothing found.
+	FindClose( *pHandle );
+
+	*pHandle = FILESYSTEM_INVALID_FIND_HANDLE;
+
+	return nullptr;
+}
+
+bool CFileSystem::FullPathToRelativePathEx( const char *pFullpath, char *pRelative, size_t uiSizeInChars )
+{
+	if( !pRelative || uiSizeInChars <= 0 )
+		return false;
+
+	if( !pFullpath || !( *pFullpath ) )
+	{
+		*pRelative = '\0';
+		return false;
+	}
+
+	CPathBuffer fullPath;
+
+	if( !fullPath.Set( pFullpath ) )
+	{
+		*pRelative = '\0';
+		return false;
+	}
+
+	auto lock = LockShared();
+
+	size_t uiRelativeOffset;
+
+	if( !m_PathPrefixes.Find( fullPath.Get(), uiRelativeOffset ) )
+		return false;
+
+	strncpy( pRelative, fullPath.Get() + uiRelativeOffset, uiSizeInChars );
+	pRelative[ uiSizeInChars - 1 ] = '\0';
+
+	return true;
+}
+
+FileAsyncHandle_t CFileSystem::ReadAsync( const FileAsyncRequest_t& request )
+{
+	if( !request.pBuffer )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::ReadAsync: Attempted to read into null buffer!\n" );
+		return FILESYSTEM_INVALID_ASYNC_HANDLE;
+	}
+
+	//Locate the data now so the worker threads don't need access to filesystem state.
+	CAsyncReader::Source_t source;
+
+	if( request.hFile != FILESYSTEM_INVALID_HANDLE )
+	{
+		auto pFile = m_OpenedFiles.Get( request.hFile );
+
+		if( !pFile || !pFile->IsOpen() )
+		{
+			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::ReadAsync: Attempted to read from invalid file handle!\n" );
+			return FILESYSTEM_INVALID_ASYNC_HANDLE;
+		}
+
+		if( auto pEntry = pFile->GetCompressedEntry() )
+		{
+			source.pData = pEntry->GetData();
+			source.pFile = pEntry->GetFile();
+			source.uiStartOffset = pEntry->GetStartOffset();
+			source.codec = pEntry->GetCodec();
+			source.uiStoredLength = pEntry->GetStoredLength();
+			source.uiBlockSize = pEntry->GetBlockSize();
+		}
+		else if( pFile->IsMapped() )
+		{
+			source.pData = pFile->GetData();
+			source.contents = pFile->GetMemoryContents();
+		}
+		else if( pFile->IsPackEntry() )
+		{
+			source.pFile = pFile->GetFile();
+			source.uiStartOffset = pFile->GetStartOffset();
+		}
+		else
+		{
+			//Open the file separately so the handle's file position isn't affected.
+			source.szFileName = pFile->GetFileName();
+		}
+
+		source.uiLength = pFile->GetLength();
+	}
+	else
+	{
+		if( !request.pszFileName )
+		{
+			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::ReadAsync: No file handle or file name given!\n" );
+			return FILESYSTEM_INVALID_ASYNC_HANDLE;
+		}
+
+		if( !LocateFileData( request.pszFileName, request.pszPathID, source ) )
+			return FILESYSTEM_INVALID_ASYNC_HANDLE;
+	}
+
+	return m_AsyncReader.Submit( std::move( source ), request );
+}
+
+FileAsyncStatus CFileSystem::GetAsyncStatus( FileAsyncHandle_t handle, uint64_t* puiBytesRead )
+{
+	return m_AsyncReader.GetStatus( handle, puiBytesRead );
+}
+
+FileAsyncStatus CFileSystem::WaitForAsync( FileAsyncHandle_t handle, uint64_t* puiBytesRead )
+{
+	return m_AsyncReader.Wait( handle, puiBytesRead );
+}
+
+bool CFileSystem::CancelAsync( FileAsyncHandle_t handle )
+{
+	return m_AsyncReader.Cancel( handle );
+}
+
+void* CFileSystem::LoadFile( const char* pFileName, const char* pathID, FileAllocateFunc_t pfnAllocate, void* pContext, uint64_t* puiSize )
+{
+	if( puiSize )
+		*puiSize = 0;
+
+	if( !pFileName || !pfnAllocate )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::LoadFile: No file name or allocator given!\n" );
+		return nullptr;
+	}
+
+	const auto uiStartTime = CFileSystemStats::GetTime();
+
+	CAsyncReader::Source_t source;
+	CFileSystemStats::PathCounters_t* pStats = nullptr;
+
+	if( !LocateFileData( pFileName, pathID, source, &pStats ) )
+	{
+		m_Stats.AddMiss();
+
+		return nullptr;
+	}
+
+	uint64_t uiBytesRead;
+
+	void* pBuffer = CAsyncReader::ReadAll( source, pfnAllocate, pContext, uiBytesRead );
+
+	const auto uiTime = CFileSystemStats::GetTime() - uiStartTime;
+
+	if( pStats )
+	{
+		pStats->uiOpens.fetch_add( 1, std::memory_order_relaxed );
+		pStats->uiReads.fetch_add( 1, std::memory_order_relaxed );
+		pStats->uiBytesRead.fetch_add( uiBytesRead, std::memory_order_relaxed );
+		pStats->uiTime.fetch_add( uiTime, std::memory_order_relaxed );
+	}
+
+	m_Stats.AddFile( pFileName, uiTime, uiBytesRead );
+
+	if( m_Options & FileSystemOption::AUDIT_ACCESSES )
+		m_AccessAudit.Record( pFileName, uiBytesRead, uiTime );
+
+	if( m_LoadTrace.IsRecording() )
+		m_LoadTrace.RecordLoad( pFileName, uiBytesRead );
+
+	if( puiSize )
+		*puiSize = uiBytesRead;
+
+	return pBuffer;
+}
+
+size_t CFileSystem::LoadFiles( FileBatchRequest_t* pRequests, size_t uiCount, const char* pathID, FileAllocateFunc_t pfnAllocate )
+{
+	if( uiCount == 0 )
+		return 0;
+
+	if( !pRequests || !pfnAllocate )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::LoadFiles: No requests or allocator given!\n" );
+		return 0;
+	}
+
+	struct BatchEntry_t
+	{
+		FileBatchRequest_t* pRequest;
+		CAsyncReader::Source_t source;
+		CFileSystemStats::PathCounters_t* pStats;
+	};
+
+	size_t uiLoaded = 0;
+
+	auto finish = [ & ]( FileBatchRequest_t& request, CFileSystemStats::PathCounters_t* pStats, const uint64_t uiTime, const uint64_t uiReads )
+	{
+		if( pStats )
+		{
+			pStats->uiOpens.fetch_add( 1, std::memory_order_relaxed );
+			pStats->uiReads.fetch_add( uiReads, std::memory_order_relaxed );
+			pStats->uiBytesRead.fetch_add( request.uiSize, std::memory_order_relaxed );
+			pStats->uiTime.fetch_add( uiTime, std::memory_order_relaxed );
+		}
+
+		m_Stats.AddFile( request.pFileName, uiTime, request.uiSize );
+
+		if( m_Options & FileSystemOption::AUDIT_ACCESSES )
+			m_AccessAudit.Record( request.pFileName, request.uiSize, uiTime );
+
+		if( m_LoadTrace.IsRecording() )
+			m_LoadTrace.RecordLoad( request.pFileName, request.uiSize );
+
+		if( request.bLoaded )
+			++uiLoaded;
+	};
+
+	std::vector<BatchEntry_t> entries;
+
+	entries.reserve( uiCount );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		auto& request = pRequests[ uiIndex ];
+
+		request.pBuffer = nullptr;
+		request.uiSize = 0;
+		request.bLoaded = false;
+
+		if( !request.pFileName )
+			continue;
+
+		BatchEntry_t entry;
+
+		entry.pRequest = &request;
+		entry.pStats = nullptr;
+
+		if( !LocateFileData( request.pFileName, pathID, entry.source, &entry.pStats ) )
+		{
+			m_Stats.AddMiss();
+			continue;
+		}
+
+		//Only uncompressed pack file entries can be coalesced, everything else is loaded on its own.
+		if( entry.source.pData || !entry.source.pFile || entry.source.codec != pack::Codec::NONE ||
+			entry.source.uiLength == CAsyncReader::UNKNOWN_LENGTH || entry.source.streaming )
+		{
+			const auto uiStartTime = CFileSystemStats::GetTime();
+
+			request.pBuffer = CAsyncReader::ReadAll( entry.source, pfnAllocate, request.pContext, request.uiSize );
+			request.bLoaded = request.pBuffer != nullptr;
+
+			finish( request, entry.pStats, CFileSystemStats::GetTime() - uiStartTime, 1 );
+			continue;
+		}
+
+		entries.emplace_back( std::move( entry ) );
+	}
+
+	std::sort( entries.begin(), entries.end(), []( const BatchEntry_t& lhs, const BatchEntry_t& rhs )
+	{
+		return std::tie( lhs.source.pFile, lhs.source.uiStartOffset ) < std::tie( rhs.source.pFile, rhs.source.uiStartOffset );
+	} );
+
+	//Reused for every run so a batch of small files doesn't allocate once per read.
+	std::vector<uint8_t> staging;
+
+	for( size_t uiFirst = 0; uiFirst < entries.size(); )
+	{
+		const auto& first = entries[ uiFirst ].source;
+
+		const uint64_t uiRunStart = first.uiStartOffset;
+		uint64_t uiRunEnd = uiRunStart + first.uiLength;
+
+		size_t uiEnd = uiFirst + 1;
+
+		//Extend the run while the next file is close enough to read through the gap.
+		for( ; uiEnd < entries.size(); ++uiEnd )
+		{
+			const auto& next = entries[ uiEnd ].source;
+
+			const uint64_t uiNextEnd = std::max( uiRunEnd, next.uiStartOffset + next.uiLength );
+
+			if( next.pFile != first.pFile || next.uiStartOffset > uiRunEnd + MAX_BATCH_GAP || uiNextEnd - uiRunStart > MAX_BATCH_READ )
+				break;
+
+			uiRunEnd = uiNextEnd;
+		}
+
+		const auto uiStartTime = CFileSystemStats::GetTime();
+
+		size_t uiAllocated = 0;
+
+		for( size_t uiIndex = uiFirst; uiIndex < uiEnd; ++uiIndex )
+		{
+			auto& entry = entries[ uiIndex ];
+
+			entry.pRequest->pBuffer = pfnAllocate( entry.source.uiLength, entry.pRequest->pContext );
+
+			if( entry.pRequest->pBuffer )
+				++uiAllocated;
+		}
+
+		if( uiEnd - uiFirst == 1 )
+		{
+			//A lone file is read straight into its buffer.
+			auto& request = *entries[ uiFirst ].pRequest;
+
+			if( request.pBuffer )
+			{
+				request.uiSize = CBlockCache::Read( first.pBlockCache, first.pFile, request.pBuffer, static_cast<size_t>( first.uiLength ), first.uiStartOffset );
+				request.bLoaded = request.uiSize == first.uiLength;
+			}
+		}
+		else if( uiAllocated > 0 )
+		{
+			staging.resize( static_cast<size_t>( uiRunEnd - uiRunStart ) );
+
+			const uint64_t uiRead = CBlockCache::Read( first.pBlockCache, first.pFile, staging.data(), staging.size(), uiRunStart );
+
+			for( size_t uiIndex = uiFirst; uiIndex < uiEnd; ++uiIndex )
+			{
+				auto& entry = entries[ uiIndex ];
+				auto& request = *entry.pRequest;
+
+				if( !request.pBuffer )
+					continue;
+
+				const uint64_t uiOffset = entry.source.uiStartOffset - uiRunStart;
+
+				//A short read still delivers the files that fit in it.
+				if( uiOffset < uiRead )
+					request.uiSize = std::min( entry.source.uiLength, uiRead - uiOffset );
+
+				if( request.uiSize > 0 )
+					memcpy( request.pBuffer, staging.data() + uiOffset, static_cast<size_t>( request.uiSize ) );
+
+				request.bLoaded = request.uiSize == entry.source.uiLength;
+			}
+		}
+
+		//The run's time is split evenly between its files. It only counts as one read.
+		const auto uiTime = ( CFileSystemStats::GetTime() - uiStartTime ) / ( uiEnd - uiFirst );
+
+		for( size_t uiIndex = uiFirst; uiIndex < uiEnd; ++uiIndex )
+		{
+			auto& entry = entries[ uiIndex ];
+
+			finish( *entry.pRequest, entry.pStats, uiTime, uiIndex == uiFirst && uiAllocated > 0 ? 1 : 0 );
+		}
+
+		uiFirst = uiEnd;
+	}
+
+	return uiLoaded;
+}
+
+void CFileSystem::ReleaseAsync( FileAsyncHandle_t handle )
+{
+	m_AsyncReader.Release( handle );
+}
+
+bool CFileSystem::AddMemorySearchPath( const char* pName, const char* pathID )
+{
+	if( !pName || !( *pName ) )
+		return false;
+
+	auto lock = LockExclusive();
+
+	if( FindSearchPath( pName, true, pathID ) != m_SearchPaths.end() )
+		return false;
+
+	if( strlen( pName ) >= MAX_PATH )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddMemorySearchPath: Name \"%s\" is too long\n", pName );
+		return false;
+	}
+
+	auto path = std::make_unique<CSearchPath>();
+
+	strncpy( path->szPath, pName, sizeof( path->szPath ) );
+	path->szPath[ sizeof( path->szPath ) - 1 ] = '\0';
+
+	path->pszPathID = GetStringPool().Intern( pathID );
+
+	//Memory files can only be changed through the memory file functions.
+	path->flags = SearchPathFlag::READ_ONLY | SearchPathFlag::IS_MEMORY;
+
+	path->pStats = &m_Stats.GetPathCounters( path->szPath, pathID );
+
+	//Empty, so there is nothing to index yet.
+	AppendSearchPath( std::move( path ) );
+
+	return true;
+}
+
+bool CFileSystem::AddMemoryFile( const char* pSearchPath, const char* pFileName, const void* pData, uint64_t uiSize )
+{
+	if( !pSearchPath || !pFileName || ( !pData && uiSize > 0 ) )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddMemoryFile: No search path, file name or data given!\n" );
+		return false;
+	}
+
+	if( uiSize > std::numeric_limits<size_t>::max() )
+		return false;
+
+	std::unique_ptr<uint8_t[]> data( new uint8_t[ static_cast<size_t>( uiSize ) ] );
+
+	if( uiSize > 0 )
+		memcpy( data.get(), pData, static_cast<size_t>( uiSize ) );
+
+	return AddMemoryFile( pSearchPath, pFileName, std::move( data ), static_cast<size_t>( uiSize ) );
+}
+
+bool CFileSystem::PinFile( const char* pSearchPath, const char* pFileName, const char* pathID )
+{
+	if( !pSearchPath || !pFileName )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::PinFile: No search path or file name given!\n" );
+		return false;
+	}
+
+	struct Allocation_t
+	{
+		std::unique_ptr<uint8_t[]> data;
+		uint64_t uiSize = 0;
+	};
+
+	Allocation_t allocation;
+
+	auto pfnAllocate = []( uint64_t uiSize, void* pContext ) -> void*
+	{
+		if( uiSize > std::numeric_limits<size_t>::max() )
+			return nullptr;
+
+		auto& allocation = *reinterpret_cast<Allocation_t*>( pContext );
+
+		allocation.data.reset( new uint8_t[ static_cast<size_t>( uiSize ) ] );
+		allocation.uiSize = uiSize;
+
+		return allocation.data.get();
+	};
+
+	uint64_t uiBytesRead;
+
+	if( !LoadFile( pFileName, pathID, pfnAllocate, &allocation, &uiBytesRead ) || uiBytesRead != allocation.uiSize )
+	{
+		Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::PinFile: Couldn't load \"%s\"\n", pFileName );
+		return false;
+	}
+
+	return AddMemoryFile( pSearchPath, pFileName, std::move( allocation.data ), static_cast<size_t>( allocation.uiSize ) );
+}
+
+bool CFileSystem::RemoveMemoryFile( const char* pSearchPath, const char* pFileName )
+{
+	if( !pSearchPath || !pFileName )
+		return false;
+
+	auto lock = LockExclusive();
+
+	auto pPath = FindMemorySearchPath( pSearchPath );
+
+	if( !pPath )
+		return false;
+
+	const auto szKey = CPathIndex::NormalizeKey( pFileName );
+
+	if( pPath->memoryFiles.erase( szKey ) == 0 )
+		return false;
+
+	m_PathIndex.RemoveFile( *pPath, szKey.c_str() );
+
+	return true;
+}
+
+bool CFileSystem::AddOverlaySearchPath( const char* pPath, const char* pathID )
+{
+	return AddSearchPath( pPath, pathID, SearchPathFlag::IS_OVERLAY );
+}
+
+bool CFileSystem::UpdateOverlayFile( const char* pSearchPath, const char* pFileName )
+{
+	if( !pSearchPath || !pFileName )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::UpdateOverlayFile: No search path or file name given!\n" );
+		return false;
+	}
+
+	auto lock = LockExclusive();
+
+	auto it = FindSearchPath( pSearchPath );
+
+	if( it == m_SearchPaths.end() || !( *it )->IsOverlay() )
+		return false;
+
+	auto& searchPath = *m_SearchPaths[ it - m_SearchPaths.cbegin() ];
+
+	CPathBuffer path;
+
+	if( !path.Set( searchPath.szPath, pFileName ) )
+		return false;
+
+	//Whatever was there before may have been replaced, so drop the old one and index what's there now.
+	//Only directories need the whole index to be searched for their contents.
+	bool bWasDirectory = false;
+
+	if( auto pLocations = m_PathIndex.Find( pFileName ) )
+	{
+		for( const auto& location : *pLocations )
+		{
+			if( location.pSearchPath == &searchPath && location.bIsDirectory )
+				bWasDirectory = true;
+		}
+	}
+
+	if( bWasDirectory )
+		m_PathIndex.RemoveTree( searchPath, pFileName );
+	else
+		m_PathIndex.RemoveFile( searchPath, pFileName );
+
+	std::error_code error;
+
+	const auto status = fs::status( path.Get(), error );
+
+	if( fs::is_directory( status ) )
+	{
+		m_DescriptorCache.InvalidateAll();
+		m_MetadataCache.InvalidateAll();
+	}
+	else
+	{
+		m_DescriptorCache.Invalidate( path.Get() );
+		m_MetadataCache.Invalidate( path.Get() );
+	}
+
+	if( !fs::exists( status ) )
+		return true;
+
+	IndexParentDirectories( searchPath, pFileName );
+
+	m_PathIndex.AddFile( searchPath, searchPath.uiOrder, pFileName, fs::is_directory( status ) );
+
+	if( fs::is_directory( status ) )
+	{
+		const size_t uiPathLength = strlen( searchPath.szPath );
+
+		fs::recursive_directory_iterator file( path.Get(), error );
+
+		for( fs::recursive_directory_iterator end; !error && file != end; file.increment( error ) )
+		{
+			const auto szFileName = file->path().u8string();
+
+			//Skip the slash that separates the search path from the relative path.
+			if( szFileName.length() > uiPathLength + 1 )
+				m_PathIndex.AddFile( searchPath, searchPath.uiOrder, szFileName.c_str() + uiPathLength + 1, fs::is_directory( file->status() ) );
+		}
+
+		//Files anywhere below the directory may have been missing before.
+		m_NegativeCache.InvalidateAll();
+	}
+	else
+	{
+		m_NegativeCache.Invalidate( m_PathIndex.MakeKey( pFileName ) );
+	}
+
+	return true;
+}
+
+void CFileSystem::SetContentSource( const FileContentSource_t& source )
+{
+	auto lock = LockExclusive();
+
+	m_ContentSource = source;
+}
+
+bool CFileSystem::AddStreamingPackFile( const char* pFullPath, const char* pRemoteName, const char* pathID )
+{
+	if( !pFullPath || !pRemoteName )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddStreamingPackFile: No path or remote name given!\n" );
+		return false;
+	}
+
+	FileContentSource_t source;
+
+	{
+		auto lock = LockShared();
+
+		source = m_ContentSource;
+	}
+
+	if( !source.pfnGetSize || !source.pfnRead )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddStreamingPackFile: No content source to install \"%s\" from!\n", pFullPath );
+		return false;
+	}
+
+	auto pack = std::make_shared<CStreamingPack>();
+
+	if( !pack->Open( pFullPath, pRemoteName, source ) )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddStreamingPackFile: Couldn't open \"%s\" for \"%s\"\n", pFullPath, pRemoteName );
+		return false;
+	}
+
+	//Only the header and directory are needed to add it, everything else is fetched when it's used.
+	uint8_t header[ pack::MAX_HEADER_SIZE ] = {};
+
+	const size_t uiHeaderSize = static_cast<size_t>( std::min<uint64_t>( sizeof( header ), pack->GetSize() ) );
+
+	if( !pack->Fetch( 0, uiHeaderSize ) )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddStreamingPackFile: Couldn't fetch the header of \"%s\"\n", pRemoteName );
+		return false;
+	}
+
+	CFileHandle file( *this, pFullPath, "rb", true );
+
+	if( !file.IsOpen() || CFileHandle::ReadAt( file.GetFile(), header, uiHeaderSize, 0 ) != uiHeaderSize )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddStreamingPackFile: Couldn't read the header of \"%s\"\n", pFullPath );
+		return false;
+	}
+
+	uint64_t uiDirectoryOffset;
+	uint64_t uiDirectoryLength;
+
+	//ZIP files are located from the end and have headers throughout, so they can't be added before they're fully installed.
+	if( !pack::GetDirectoryRange( header, uiDirectoryOffset, uiDirectoryLength ) )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddStreamingPackFile: \"%s\" isn't a pack file that can be streamed\n", pRemoteName );
+		return false;
+	}
+
+	if( !pack->Fetch( uiDirectoryOffset, uiDirectoryLength ) )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddStreamingPackFile: Couldn't fetch the directory of \"%s\"\n", pRemoteName );
+		return false;
+	}
+
+	auto lock = LockExclusive();
+
+	auto path = PreparePackFile( pFullPath, pathID, file, 0, pack );
+
+	if( !path )
+		return false;
+
+	AddPackSearchPath( std::move( path ) );
+
+	m_StreamingInstaller.Add( std::move( pack ) );
+
+	return true;
+}
+
+void CFileSystem::GetInstallProgress( uint64_t* puiAvailableBytes, uint64_t* puiTotalBytes )
+{
+	uint64_t uiAvailableBytes;
+	uint64_t uiTotalBytes;
+
+	m_StreamingInstaller.GetProgress( uiAvailableBytes, uiTotalBytes );
+
+	if( puiAvailableBytes )
+		*puiAvailableBytes = uiAvailableBytes;
+
+	if( puiTotalBytes )
+		*puiTotalBytes = uiTotalBytes;
+}
+
+bool CFileSystem::IsFileImmediatelyAvailable( const char *pFileName )
+{
+	if( !pFileName )
+		return false;
+
+	const CPackFileEntry* pEntry;
+
+	ProcessDirectoryChanges();
+
+	auto lock = LockShared();
+
+	auto pSearchPath = ResolveFile( pFileName, nullptr, &pEntry );
+
+	if( !pSearchPath )
+		return false;
+
+	//Everything but entries of streaming packs is on disk.
+	if( pEntry && pSearchPath->streaming )
+		return pSearchPath->streaming->IsAvailable( pEntry->GetStartOffset(), pEntry->GetStoredLength() );
+
+	return true;
+}
+
+bool CFileSystem::IsAppReadyForOfflinePlay( int appID )
+{
+	return m_StreamingInstaller.IsComplete();
+}
+
+void CFileSystem::IndexParentDirectories( CSearchPath& searchPath, const char* pszFileName )
+{
+	std::string szDirectory( pszFileName );
+
+	//Leading separators don't end a directory name.
+	for( size_t uiIndex = 1; uiIndex < szDirectory.length(); ++uiIndex )
+	{
+		if( szDirectory[ uiIndex ] == '/' || szDirectory[ uiIndex ] == '\\' )
+			m_PathIndex.AddFile( searchPath, searchPath.uiOrder, szDirectory.substr( 0, uiIndex ).c_str(), true );
+	}
+}
+
+void CFileSystem::LogLevelLoadStarted( const char *name )
+{
+	if( !name || !( *name ) )
+		return;
+
+	if( m_hReplayGroup != CPrefetcher::INVALID_GROUP )
+	{
+		m_Prefetcher.CancelGroup( m_hReplayGroup );
+		m_hReplayGroup = CPrefetcher::INVALID_GROUP;
+	}
+
+	//Replay first so reading the trace file isn't traced.
+	ReplayLoadTrace( name );
+
+	m_LoadTrace.Start();
+}
+
+void CFileSystem::LogLevelLoadFinished( const char *name )
+{
+	if( !m_LoadTrace.IsRecording() )
+		return;
+
+	m_LoadTrace.Stop();
+
+	//Anything that wasn't prefetched yet is no longer needed.
+	if( m_hReplayGroup != CPrefetcher::INVALID_GROUP )
+	{
+		m_Prefetcher.CancelGroup( m_hReplayGroup );
+		m_hReplayGroup = CPrefetcher::INVALID_GROUP;
+	}
+
+	if( !name || !( *name ) )
+		return;
+
+	std::vector<uint8_t> data;
+
+	m_LoadTrace.Serialize( data );
+
+	CreateDirHierarchy( LOAD_TRACE_DIR, nullptr );
+
+	const auto szPath = GetLoadTracePath( name );
+
+	auto hFile = Open( szPath.c_str(), "wb", nullptr );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::LogLevelLoadFinished: Couldn't open \"%s\" for writing\n", szPath.c_str() );
+		return;
+	}
+
+	Write( data.data(), static_cast<int>( data.size() ), hFile );
+
+	Close( hFile );
+
+	Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::LogLevelLoadFinished: Wrote %u events to \"%s\"\n", 
+			 static_cast<unsigned int>( m_LoadTrace.GetEventCount() ), szPath.c_str() );
+}
+
+int CFileSystem::HintResourceNeed( const char *hintlist, int forgetEverything )
+{
+	std::vector<CAsyncReader::Source_t> sources;
+
+	if( hintlist )
+		ParseResourceList( hintlist, sources );
+
+	const auto uiCount = sources.size();
+
+	m_Prefetcher.AddHints( std::move( sources ), forgetEverything != 0 );
+
+	return static_cast<int>( uiCount );
+}
+
+int CFileSystem::PauseResourcePreloading()
+{
+	return m_Prefetcher.SetPaused( true ) ? 1 : 0;
+}
+
+int CFileSystem::ResumeResourcePreloading()
+{
+	return m_Prefetcher.SetPaused( false ) ? 1 : 0;
+}
+
+WaitForResourcesHandle_t CFileSystem::WaitForResources( const char *resourcelist )
+{
+	if( !resourcelist )
+		return CPrefetcher::INVALID_GROUP;
+
+	std::vector<CAsyncReader::Source_t> sources;
+
+	ParseResourceList( resourcelist, sources );
+
+	return m_Prefetcher.AddGroup( std::move( sources ) );
+}
+
+bool CFileSystem::GetWaitForResourcesProgress( WaitForResourcesHandle_t handle, float *progress /* out */, bool *complete /* out */ )
+{
+	float flProgress;
+	bool bComplete;
+
+	const bool bResult = m_Prefetcher.GetProgress( handle, flProgress, bComplete );
+
+	if( progress )
+		*progress = flProgress;
+
+	if( complete )
+		*complete = bComplete;
+
+	return bResult;
+}
+
+void CFileSystem::CancelWaitForResources( WaitForResourcesHandle_t handle )
+{
+	m_Prefetcher.CancelGroup( handle );
+}
+
+bool CFileSystem::CompileResourceManifest( const char* pResourceList )
+{
+	if( !pResourceList )
+		return false;
+
+	CResourceManifest manifest;
+
+	if( !LoadResourceManifest( pResourceList, true, manifest ) )
+	{
+		Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::CompileResourceManifest: Couldn't read resource list \"%s\"\n", pResourceList );
+		return false;
+	}
+
+	return true;
+}
+
+void CFileSystem::Warning( FileWarningLevel_t level, const char* pszFormat, ... )
+{
+	char szBuffer[ 4096 ];
+
+	if( level <= m_WarningLevel )
+	{
+		va_list list;
+
+		va_start( list, pszFormat );
+
+		vsnprintf( szBuffer, sizeof( szBuffer ), pszFormat, list );
+
+		if( m_WarningFunc )
+			m_WarningFunc( "%s", szBuffer );
+		else
+			Msg( "%s", szBuffer );
+
+		va_end( list );
+	}
+}
+
+CFileSystem::SearchPaths_t::const_iterator CFileSystem::FindSearchPath( const char* pszPath, const bool bCheckPathID, const char* pszPathID ) const
+{
+	fs::path path( pszPath );
+
+	std::error_code error;
+
+	path = fs::canonical( path, error );
+
+	//Paths that don't exist can still name a memory search path.
+	const auto szPath = error ? std::string() : path.u8string();
+
+	//Search path IDs are interned, so they're compared by pointer. A path ID that was never interned matches no search path.
+	const char* const pszInternedPathID = GetStringPool().Find( pszPathID );
+
+	if( bCheckPathID && pszPathID && !pszInternedPathID )
+		return m_SearchPaths.end();
+
+	for( auto it = m_SearchPaths.begin(), end = m_SearchPaths.end(); it != end; ++it )
+	{
+		//Memory search paths aren't on disk, so their names are compared as given.
+		const char* const pszName = ( *it )->IsMemory() ? pszPath : szPath.c_str();
+
+		if( *pszName && stricmp( pszName, ( *it )->szPath ) == 0 )
+		{
+			if( !bCheckPathID || pszInternedPathID == ( *it )->pszPathID )
+				return it;
+		}
+	}
+
+	return m_SearchPaths.end();
+}
+
+bool CFileSystem::AddSearchPath( const char *pPath, const char *pathID, const SearchPathFlags_t flags )
+{
+	if( !pPath )
+	{
+		return false;
+	}
+
+	//Despite the documentation stating that bsp files are supported, the filesystem doesn't actually support it. Sorry. - Solokiller
+	if( strstr( pPath, ".bsp" ) )
+		return false;
+
+	auto lock = LockExclusive();
+
+	if( FindSearchPath( pPath, true, pathID ) != m_SearchPaths.end() )
+		return false;
+
+	fs::path osPath( pPath );
+
+	//Convert all search paths to the absolute representation, fully resolved.
+	std::error_code error;
+
+	osPath = fs::canonical( osPath, error );
+
+	//Don't want to add empty paths when non-existent search paths are added.
+	if( error || osPath.empty() )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddSearchPath: Couldn't convert path \"%s\" to its canonial representation\n", pPath );
+		return false;
+	}
+
+	osPath.make_preferred();
+
+	auto path = std::make_unique<CSearchPath>();
+
+	strncpy( path->szPath, osPath.u8string().c_str(), sizeof( path->szPath ) );
+	path->szPath[ sizeof( path->szPath ) - 1 ] = '\0';
+
+	path->pszPathID = GetStringPool().Intern( pathID );
+
+	path->flags = flags;
+
+	path->pStats = &m_Stats.GetPathCounters( path->szPath, pathID );
+
+	{
+		auto directory = std::make_unique<CDirectoryHandle>();
+
+		if( directory->Open( path->szPath ) )
+			path->directory = std::move( directory );
+	}
+
+	//Watch before indexing so files that are created while the search path is scanned aren't missed.
+	//Overlays are told about their changes, so they don't need to be watched.
+	if( ( m_Options & FileSystemOption::WATCH_LOOSE_PATHS ) && !path->IsOverlay() )
+		path->bIsWatched = m_DirectoryWatcher.AddPath( *path );
+
+	AppendSearchPath( std::move( path ) );
+
+	m_PathIndex.AddSearchPath( *m_SearchPaths.back(), m_SearchPaths.size() - 1 );
+
+	//Files that were missing may be in the new search path.
+	m_NegativeCache.InvalidateAll();
+
+	//Add any game pack files present in the path.
+	AddPackFiles( m_SearchPaths.back()->szPath );
+
+	return true;
+}
+
+CSearchPath* CFileSystem::FindMemorySearchPath( const char* pszName ) const
+{
+	for( const auto& searchPath : m_SearchPaths )
+	{
+		if( searchPath->IsMemory() && stricmp( pszName, searchPath->szPath ) == 0 )
+			return searchPath.get();
+	}
+
+	return nullptr;
+}
+
+bool CFileSystem::AddMemoryFile( const char* pszSearchPath, const char* pszFileName, std::unique_ptr<uint8_t[]>&& data, const size_t uiSize )
+{
+	auto szKey = CPathIndex::NormalizeKey( pszFileName );
+
+	if( szKey.empty() )
+		return false;
+
+	//Hash before locking. Contents that are already in use, such as pinned files that are still open, are shared.
+	auto contents = m_ContentCache.Add( nullptr, data, uiSize );
+
+	auto lock = LockExclusive();
+
+	auto pPath = FindMemorySearchPath( pszSearchPath );
+
+	if( !pPath )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddMemoryFile: \"%s\" is not a memory search path\n", pszSearchPath );
+		return false;
+	}
+
+	auto& file = pPath->memoryFiles[ szKey ];
+
+	file.contents = std::move( contents );
+	file.iModifiedTime = static_cast<int64_t>( time( nullptr ) );
+
+	m_PathIndex.AddFile( *pPath, pPath->uiOrder, szKey.c_str() );
+	m_NegativeCache.Invalidate( m_PathIndex.MakeKey( szKey.c_str() ) );
+
+	return true;
+}
+
+std::unique_ptr<CSearchPath> CFileSystem::PreparePackFile( const char* pszFullPath, const char* pszPathID, CFileHandle& file, int64_t offset,
+															std::shared_ptr<CStreamingPack> streaming )
+{
+	fs::path osPath( pszFullPath );
+
+	osPath.make_preferred();
+
+	const auto szPath = osPath.u8string();
+
+	//The directory is built in the arena, which then moves into the search path along with it.
+	std::unique_ptr<CMonotonicResource> resource;
+
+	if( m_Options & FileSystemOption::PACK_DIRECTORY_ARENAS )
+		resource = std::make_unique<CMonotonicResource>( MemoryTag::FILESYSTEM );
+
+	CSearchPath::Entries_t entries( resource.get() );
+
+	uint32_t uiBlockSize = 0;
+
+	CMountIndexCache::Key_t packKey;
+
+	//Streaming packs are recreated if the remote pack file changes, so their directories are always read.
+	if( ( m_Options & FileSystemOption::CACHE_MOUNT_INDEX ) && !streaming )
+		CMountIndexCache::GetKey( pszFullPath, offset, packKey );
+
+	//Pack files that haven't changed since the mount index was saved don't need their directories read.
+	if( !m_MountIndexCache.Find( szPath.c_str(), packKey, entries, uiBlockSize ) &&
+		!ReadPackDirectory( pszFullPath, file, offset, entries, uiBlockSize ) )
+	{
+		return nullptr;
+	}
+
+	//Hashed directories are used as stored, so there's nothing for the mount index to save.
+	if( entries.IsHashed() )
+		packKey.bValid = false;
+
+	auto path = std::make_unique<CSearchPath>();
+
+	strncpy( path->szPath, szPath.c_str(), sizeof( path->szPath ) );
+	path->szPath[ sizeof( path->szPath ) - 1 ] = '\0';
+
+	path->pszPathID = GetStringPool().Intern( pszPathID );
+
+	path->flags = SearchPathFlag::READ_ONLY | SearchPathFlag::IS_PACK_FILE;
+
+	path->pStats = &m_Stats.GetPathCounters( path->szPath, pszPathID );
+
+	path->packFile = std::make_unique<CFileHandle>( std::move( file ) );
+
+	//Mapped reads can't be intercepted to fetch missing data first.
+	if( ( m_Options & FileSystemOption::MAP_PACK_FILES ) && !streaming )
+	{
+		auto mapping = std::make_unique<CMappedFile>();
+
+		//Not fatal, reads will go through the pack file handle instead.
+		if( mapping->Open( pszFullPath, ( m_Options & FileSystemOption::LARGE_PAGES ) != 0 ) )
+		{
+			path->packMapping = std::move( mapping );
+		}
+		else
+		{
+			Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::AddPackFile: Couldn't map pack file \"%s\", using file I/O\n", pszFullPath );
+		}
+	}
+
+	path->packResource = std::move( resource );
+	path->packEntries = std::move( entries );
+
+	path->uiPackBlockSize = uiBlockSize;
+
+	path->packKey = packKey;
+
+	{
+		std::error_code error;
+
+		//Cast to seconds since the write time is returned in different format. - Solokiller
+		path->iPackFileTime = std::chrono::duration_cast<std::chrono::seconds>( fs::last_write_time( pszFullPath, error ).time_since_epoch() ).count();
+
+		if( error )
+			path->iPackFileTime = 0;
+	}
+
+	//Verifying would download the whole pack file up front.
+	if( ( m_Options & FileSystemOption::VERIFY_PACK_FILES ) && !streaming && !VerifyPackFile( *path ) )
+		return nullptr;
+
+	path->streaming = std::move( streaming );
+
+	return path;
+}
+
+bool CFileSystem::ReadPackDirectory( const char* pszFullPath, CFileHandle& file, int64_t offset, CSearchPath::Entries_t& entries, uint32_t& uiBlockSize )
+{
+	fseek64( file.GetFile(), file.GetStartOffset() + offset, SEEK_SET );
+
+	pack::PackType type;
+
+	{
+		pack::Header_t header;
+
+		if( fread( &header, sizeof( header ), 1, file.GetFile() ) != 1 )
+		{
+			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddPackFile: Couldn't read pack file \"%s\" identifier\n", pszFullPath );
+			return false;
+		}
+
+		type = pack::IdentifyPackType( header );
+	}
+
+	if( type == pack::PackType::NOT_A_PACK )
+	{
+		Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddPackFile: \"%s\" is not a pack file\n", pszFullPath );
+		return false;
+	}
+
+	fseek64( file.GetFile(), file.GetStartOffset() + offset, SEEK_SET );
+
+	bool bSuccess = false;
+
+	switch( type )
+	{
+	case pack::PackType::PACK_32BIT:		bSuccess = ProcessPackFile<pack::Pack32_t>( *this, pszFullPath, file.GetFile(), entries ); break;
+	case pack::PackType::PACK_64BIT:		bSuccess = ProcessPackFile<pack::Pack64_t>( *this, pszFullPath, file.GetFile(), entries ); break;
+	case pack::PackType::PACK_COMPRESSED:	bSuccess = ProcessCompressedPackFile( *this, pszFullPath, file.GetFile(), entries, uiBlockSize ); break;
+	case pack::PackType::PACK_HASHED:		bSuccess = ProcessHashedPackFile( *this, pszFullPath, file.GetFile(), entries, uiBlockSize ); break;
+	case pack::PackType::WAD:				bSuccess = ProcessWadFile( *this, pszFullPath, file.GetFile(), entries ); break;
+	case pack::PackType::ZIP:				bSuccess = ProcessZipFile( *this, pszFullPath, file.GetFile(), entries ); break;
+
+	//Rejected above.
+	case pack::PackType::NOT_A_PACK:		break;
+	}
+
+	return bSuccess;
+}
+
+void CFileSystem::SaveMountIndex()
+{
+	if( !( m_Options & FileSystemOption::CACHE_MOUNT_INDEX ) )
+		return;
+
+	std::vector<const CSearchPath*> packFiles;
+
+	for( const auto& searchPath : m_SearchPaths )
+	{
+		if( searchPath->IsPackFile() )
+			packFiles.push_back( searchPath.get() );
+	}
+
+	if( packFiles.empty() )
+		return;
+
+	Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::SaveMountIndex: %u pack files restored from the mount index, %u read\n",
+			 static_cast<unsigned int>( m_MountIndexCache.GetHitCount() ), static_cast<unsigned int>( m_MountIndexCache.GetMissCount() ) );
+
+	m_MountIndexCache.Save( packFiles );
+}
+
+bool CFileSystem::VerifyPackFile( const CSearchPath& searchPath )
+{
+	CPackVerifier::Report_t report;
+
+	m_PackVerifier.Verify( searchPath.szPath, searchPath.packFile->GetFile(), searchPath.packMapping ? searchPath.packMapping->GetData() : nullptr, report );
+
+	switch( report.result )
+	{
+	case CPackVerifier::Result::VERIFIED:
+		{
+			const double flMegabytes = report.uiBytes / ( 1024.0 * 1024.0 );
+			const double flSeconds = report.uiTime / 1000000.0;
+
+			Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::VerifyPackFile: Verified \"%s\": %.1f MiB in %.3f seconds (%.1f MiB/s, %s CRC)\n", 
+					 searchPath.szPath, flMegabytes, flSeconds, flSeconds > 0 ? flMegabytes / flSeconds : 0.0, crc32c::IsHardwareAccelerated() ? "hardware" : "software" );
+			return true;
+		}
+
+	case CPackVerifier::Result::UNCHANGED:
+		{
+			Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::VerifyPackFile: \"%s\" hasn't changed since it was verified\n", searchPath.szPath );
+			return true;
+		}
+
+	case CPackVerifier::Result::NO_CHECKSUMS:
+		{
+			Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::VerifyPackFile: \"%s\" has no checksums, not verifying\n", searchPath.szPath );
+			return true;
+		}
+
+	case CPackVerifier::Result::INVALID_CHECKSUMS:
+		{
+			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::VerifyPackFile: Checksums of \"%s\" are invalid, not adding it\n", searchPath.szPath );
+			return false;
+		}
+
+	default: break;
+	}
+
+	//Report the files that are affected, so it's clear what has to be replaced.
+	size_t uiCorruptEntries = 0;
+
+	for( const auto& entry : searchPath.packEntries )
+	{
+		const auto uiStart = entry.GetStartOffset();
+		const auto uiEnd = uiStart + entry.GetStoredLength();
+
+		const bool bCorrupt = std::any_of( report.corruptRanges.begin(), report.corruptRanges.end(), [ = ]( const std::pair<uint64_t, uint64_t>& range )
+		{
+			return range.first < uiEnd && uiStart < range.first + range.second;
+		} );
+
+		if( bCorrupt )
+		{
+			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::VerifyPackFile: \"%s\" in \"%s\" is corrupt\n", entry.GetFileName(), searchPath.szPath );
+			++uiCorruptEntries;
+		}
+	}
+
+	Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::VerifyPackFile: \"%s\" is corrupt (%u files, %u damaged ranges), not adding it\n", 
+			 searchPath.szPath, static_cast<unsigned int>( uiCorruptEntries ), static_cast<unsigned int>( report.corruptRanges.size() ) );
+
+	return false;
+}
+
+void CFileSystem::AppendSearchPath( std::unique_ptr<CSearchPath>&& path )
+{
+	path->pathID = m_PathIDs.Intern( path->pszPathID );
+	path->uiOrder = m_SearchPaths.size();
+
+	if( path->pathID >= m_SearchPathBuckets.size() )
+		m_SearchPathBuckets.resize( path->pathID + 1 );
+
+	m_SearchPathBuckets[ path->pathID ].push_back( path.get() );
+	m_AllSearchPaths.push_back( path.get() );
+
+	m_PathPrefixes.Add( *path );
+
+	m_SearchPaths.emplace_back( std::move( path ) );
+
+	PublishSnapshot();
+}
+
+void CFileSystem::RebuildSearchPathBuckets()
+{
+	m_AllSearchPaths.clear();
+	m_SearchPathBuckets.clear();
+
+	m_SearchPathBuckets.resize( m_PathIDs.GetCount() + 1 );
+
+	for( size_t uiIndex = 0; uiIndex < m_SearchPaths.size(); ++uiIndex )
+	{
+		auto& searchPath = *m_SearchPaths[ uiIndex ];
+
+		searchPath.uiOrder = uiIndex;
+
+		m_SearchPathBuckets[ searchPath.pathID ].push_back( &searchPath );
+		m_AllSearchPaths.push_back( &searchPath );
+	}
+
+	m_PathPrefixes.Rebuild( m_SearchPaths );
+
+	PublishSnapshot();
+}
+
+void CFileSystem::PublishSnapshot()
+{
+	std::shared_ptr<CSearchPathSnapshot> snapshot;
+
+	//Folded names can't be looked up in pack directories or on case sensitive filesystems without the index.
+	if( IsThreadSafe() && ( m_Options & FileSystemOption::LOCK_FREE_LOOKUPS ) && !m_PathIndex.IsFoldingCase() )
+		snapshot = std::make_shared<CSearchPathSnapshot>( m_SearchPaths, &m_BlockCache );
+
+	std::atomic_store( &m_Snapshot, std::move( snapshot ) );
+}
+
+void CFileSystem::RetireSearchPath( std::unique_ptr<CSearchPath>&& path )
+{
+	//Only this thread replaces the snapshot, so it can be read directly.
+	if( m_Snapshot )
+		m_Snapshot->Retire( std::move( path ) );
+	else
+		path.reset();
+}
+
+const CFileSystem::SearchPathList_t& CFileSystem::GetSearchPaths( const PathID_t pathID ) const
+{
+	static const SearchPathList_t EMPTY_LIST;
+
+	if( pathID == PathID::ANY )
+		return m_AllSearchPaths;
+
+	//Path IDs that no search path has match nothing.
+	if( pathID >= m_SearchPathBuckets.size() )
+		return EMPTY_LIST;
+
+	return m_SearchPathBuckets[ pathID ];
+}
+
+void CFileSystem::AddPackSearchPath( std::unique_ptr<CSearchPath>&& path )
+{
+	AppendSearchPath( std::move( path ) );
+
+	m_PathIndex.AddSearchPath( *m_SearchPaths.back(), m_SearchPaths.size() - 1 );
+
+	m_NegativeCache.InvalidateAll();
+}
+
+bool CFileSystem::AddPackFile( const char* pszFullPath, const char* pszPathID, const bool bCheckForAppendPack )
+{
+	auto path = LoadPackFile( pszFullPath, pszPathID, bCheckForAppendPack );
+
+	if( !path )
+		return false;
+
+	AddPackSearchPath( std::move( path ) );
+
+	return true;
+}
+
+std::unique_ptr<CSearchPath> CFileSystem::LoadPackFile( const char* pszFullPath, const char* pszPathID, const bool bCheckForAppendPack )
+{
+	if( !pszFullPath )
+		return nullptr;
+
+	CFileHandle file( *this, pszFullPath, "rb", true );
+
+	if( !file.IsOpen() )
+		return nullptr;
+
+	int64_t iOffset = 0;
+
+	if( bCheckForAppendPack )
+	{
+		pack::PackAppend_t header;
+
+		fseek64( file.GetFile(), -static_cast<int64_t>( sizeof( header ) ), SEEK_END );
+
+		if( fread( &header, sizeof( header ), 1, file.GetFile() ) != 1 )
+		{
+			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::AddPackFile: Failed to read pack append header for pack file \"%s\"!\n", pszFullPath );
+			return nullptr;
+		}
+
+		if( pack::IsAppendPack( header ) )
+		{
+			iOffset = header.packheaderpos;
+		}
+	}
+
+	return PreparePackFile( pszFullPath, pszPathID, file, iOffset );
+}
+
+void CFileSystem::AddPackFiles( const char* pszPath )
+{
+	std::vector<std::string> fileNames;
+
+	{
+		char szPath[ MAX_PATH ];
+
+		std::error_code error;
+
+		for( size_t uiPakIndex = 0; ; ++uiPakIndex )
+		{
+			snprintf( szPath, sizeof( szPath ), "%s/pak%u.pak", pszPath, static_cast<unsigned int>( uiPakIndex ) );
+
+			if( !fs::exists( szPath, error ) )
+				break;
+
+			fileNames.emplace_back( szPath );
+		}
+	}
+
+	if( fileNames.empty() )
+		return;
+
+	std::vector<std::unique_ptr<CSearchPath>> paths( fileNames.size() );
+
+	const size_t uiThreadCount = std::min( fileNames.size(), MAX_PACK_LOAD_THREADS );
+
+	//Loading only reads the pack files, so each worker takes the next pack file until all are loaded.
+	std::atomic<size_t> uiNextIndex{ 0 };
+
+	auto loadPackFiles = [ & ]()
+	{
+		for( size_t uiIndex; ( uiIndex = uiNextIndex.fetch_add( 1, std::memory_order_relaxed ) ) < fileNames.size(); )
+		{
+			paths[ uiIndex ] = LoadPackFile( fileNames[ uiIndex ].c_str(), "", false );
+		}
+	};
+
+	std::vector<std::thread> threads;
+
+	threads.reserve( uiThreadCount - 1 );
+
+	for( size_t uiThread = 1; uiThread < uiThreadCount; ++uiThread )
+	{
+		threads.emplace_back( loadPackFiles );
+	}
+
+	loadPackFiles();
+
+	for( auto& thread : threads )
+	{
+		thread.join();
+	}
+
+	//Add them in pack file order so the search path order doesn't depend on how loading was scheduled.
+	for( auto& path : paths )
+	{
+		if( path )
+			AddPackSearchPath( std::move( path ) );
+	}
+}
+
+FileHandle_t CFileSystem::FindFile( CSearchPath& searchPath, const char* pszFileName, const char* pszOptions, const CPackFileEntry* pEntry )
+{
+	CFileHandle file;
+	
+	if( searchPath.IsMemory() )
+	{
+		auto szKey = CPathIndex::NormalizeKey( pszFileName );
+
+		auto it = searchPath.memoryFiles.find( szKey );
+
+		if( it == searchPath.memoryFiles.end() )
+			return FILESYSTEM_INVALID_HANDLE;
+
+		file = CFileHandle( *this, std::move( szKey ), it->second.contents );
+	}
+	else if( searchPath.IsPackFile() )
+	{
+		CPathBuffer path;
+
+		if( !path.Set( pszFileName ) )
+			return FILESYSTEM_INVALID_HANDLE;
+
+		if( !pEntry )
+			pEntry = searchPath.packEntries.Find( path.Get() );
+
+		if( !pEntry )
+			return FILESYSTEM_INVALID_HANDLE;
+
+		auto& entry = *pEntry;
+
+		if( searchPath.packMapping && !searchPath.packMapping->IsValidRange( entry.GetStartOffset(), entry.GetStoredLength() ) )
+		{
+			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::FindFile: Pack file entry \"%s\" in \"%s\" lies outside the pack file!\n", entry.GetFileName(), searchPath.szPath );
+			return FILESYSTEM_INVALID_HANDLE;
+		}
+
+		if( searchPath.streaming && !searchPath.streaming->Fetch( entry.GetStartOffset(), entry.GetStoredLength() ) )
+		{
+			Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::FindFile: Couldn't fetch pack file entry \"%s\" in \"%s\"!\n", entry.GetFileName(), searchPath.szPath );
+			return FILESYSTEM_INVALID_HANDLE;
+		}
+
+		if( entry.IsCompressed() )
+		{
+			auto compressed = std::make_unique<CCompressedEntry>();
+
+			if( !searchPath.packMapping && m_BlockCache.IsEnabled() )
+				compressed->SetBlockCache( &m_BlockCache );
+
+			if( !compressed->Open( searchPath.packFile->GetFile(), searchPath.packMapping ? searchPath.packMapping->GetData() : nullptr,
+								   entry.GetStartOffset(), entry.GetStoredLength(), entry.GetLength(), entry.GetCodec(), searchPath.uiPackBlockSize ) )
+			{
+				Warning( FILESYSTEM_WARNING_CRITICAL, "CFileSystem::FindFile: Compressed pack file entry \"%s\" in \"%s\" is corrupt!\n", entry.GetFileName(), searchPath.szPath );
+				return FILESYSTEM_INVALID_HANDLE;
+			}
+
+			file = CFileHandle( *this, std::string( path.Get(), path.GetLength() ), std::move( compressed ) );
+		}
+		else if( searchPath.packMapping )
+		{
+			file = CFileHandle( *this, std::string( path.Get(), path.GetLength() ), searchPath.packFile->GetFile(), 
+								searchPath.packMapping->GetData() + entry.GetStartOffset(), entry.GetStartOffset(), entry.GetLength() );
+		}
+		else
+		{
+			file = CFileHandle( *this, std::string( path.Get(), path.GetLength() ), searchPath.packFile->GetFile(), entry.GetStartOffset(), entry.GetLength() );
+
+			std::unique_ptr<CDirectStream> direct;
+
+			//Direct streams read whole blocks past the entry, which may not have been fetched.
+			if( m_uiDirectStreamingThreshold > 0 && entry.GetLength() >= m_uiDirectStreamingThreshold && !searchPath.streaming )
+			{
+				direct = std::make_unique<CDirectStream>( m_DirectStreamer );
+
+				if( !direct->Open( searchPath.szPath, entry.GetStartOffset(), entry.GetLength() ) )
+					direct.reset();
+			}
+
+			//Direct streams do their own buffering, and stay out of the block cache so they don't evict it either.
+			if( direct )
+			{
+				file.SetDirectStream( std::move( direct ) );
+			}
+			else
+			{
+				file.SetFlags( FileHandleFlag::READ_AHEAD );
+
+				if( m_BlockCache.IsEnabled() )
+					file.SetBlockCache( &m_BlockCache );
+			}
+		}
+	}
+	else
+	{
+		CPathBuffer path;
+
+		if( !path.Set( searchPath.szPath, pszFileName ) )
+			return FILESYSTEM_INVALID_HANDLE;
+
+		//Files that are written to use the file's position directly.
+		const bool bReadOnly = !strpbrk( pszOptions, "wa+" );
+
+		//Only binary files are cached, so files don't have to be reopened in a different mode.
+		const bool bCache = bReadOnly && ( m_Options & FileSystemOption::CACHE_LOOSE_FILES ) && strchr( pszOptions, 'b' );
+
+		uint64_t uiLength;
+
+		if( FILE* pFile = bCache ? m_DescriptorCache.Acquire( path.Get(), uiLength ) : nullptr )
+			file = CFileHandle( *this, std::string( path.Get(), path.GetLength() ), pFile, uiLength );
+		else if( searchPath.directory )
+		{
+			if( FILE* pFile = searchPath.directory->OpenFile( pszFileName, pszOptions, uiLength ) )
+				file = CFileHandle( *this, std::string( path.Get(), path.GetLength() ), pFile, uiLength );
+		}
+		else
+			file = CFileHandle( *this, path.Get(), pszOptions );
+
+		if( bReadOnly )
+			file.SetFlags( FileHandleFlag::READ_AHEAD );
+
+		if( bCache )
+			file.SetFlags( FileHandleFlag::CACHE_DESCRIPTOR );
+	}
+
+	if( !file.IsOpen() )
+		return FILESYSTEM_INVALID_HANDLE;
+
+	file.SetStats( searchPath.pStats );
+
+	file.SetPackEntry( pEntry );
+
+	auto hFile = m_OpenedFiles.Add( std::move( file ) );
+
+	if( hFile != FILESYSTEM_INVALID_HANDLE && m_LoadTrace.IsRecording() )
+		m_LoadTrace.RecordOpen( hFile, pszFileName );
+
+	return hFile;
+}
+
+CSearchPath* CFileSystem::ResolveFile( const char* pszFileName, const char* pszPathID, const CPackFileEntry** ppEntry, bool* pbIsDirectory,
+									   const char** ppszFileName )
+{
+	if( ppEntry )
+		*ppEntry = nullptr;
+
+	if( pbIsDirectory )
+		*pbIsDirectory = false;
+
+	if( ppszFileName )
+		*ppszFileName = pszFileName;
+
+	const auto id = m_PathIDs.Find( pszPathID );
+
+	CPathIndex::Locations_t merged;
+
+	if( auto pLocations = m_PathIndex.Find( pszFileName, &merged ) )
+	{
+		for( const auto& location : *pLocations )
+		{
+			if( !location.pSearchPath->MatchesPathID( id ) )
+				continue;
+
+			if( ppEntry )
+				*ppEntry = location.pEntry;
+
+			if( pbIsDirectory )
+				*pbIsDirectory = location.bIsDirectory;
+
+			if( ppszFileName )
+				*ppszFileName = location.GetFileName( pszFileName );
+
+			return location.pSearchPath;
+		}
+	}
+
+	//Files created outside of the filesystem aren't indexed, so check loose search paths.
+	const auto szKey = m_PathIndex.MakeKey( pszFileName );
+
+	if( m_NegativeCache.Contains( szKey, pszPathID ) )
+		return nullptr;
+
+	std::error_code error;
+
+	CPathBuffer path;
+
+	for( auto searchPath : GetSearchPaths( id ) )
+	{
+		if( searchPath->IsFullyIndexed() )
+			continue;
+
+		bool bIsDirectory;
+
+		if( searchPath->directory )
+		{
+			CDirectoryHandle::Status_t status;
+
+			if( !searchPath->directory->GetStatus( pszFileName, status ) )
+				continue;
+
+			bIsDirectory = status.bIsDirectory;
+		}
+		else
+		{
+			if( !path.Set( searchPath->szPath, pszFileName ) )
+				continue;
+
+			const auto status = fs::status( path.Get(), error );
+
+			if( !fs::exists( status ) )
+				continue;
+
+			bIsDirectory = fs::is_directory( status );
+		}
+
+		//The index can't be changed while holding a shared lock, so the file will be probed for again next time.
+		if( !IsThreadSafe() )
+			m_PathIndex.AddFile( *searchPath, searchPath->uiOrder, pszFileName, bIsDirectory );
+
+		if( pbIsDirectory )
+			*pbIsDirectory = bIsDirectory;
+
+		return searchPath;
+	}
+
+	m_NegativeCache.Insert( szKey, pszPathID );
+
+	return nullptr;
+}
+
+bool CFileSystem::LocateFileData( const char* pszFileName, const char* pszPathID, CAsyncReader::Source_t& source, CFileSystemStats::PathCounters_t** ppStats )
+{
+	bool bFound;
+
+	if( LocateFileDataInSnapshot( pszFileName, pszPathID, source, ppStats, bFound ) )
+		return bFound;
+
+	const CPackFileEntry* pEntry;
+	bool bIsDirectory;
+	const char* pszActualName;
+
+	ProcessDirectoryChanges();
+
+	auto lock = LockShared();
+
+	auto pSearchPath = ResolveFile( pszFileName, pszPathID, &pEntry, &bIsDirectory, &pszActualName );
+
+	if( !pSearchPath || bIsDirectory )
+		return false;
+
+	source = CAsyncReader::Source_t();
+
+	if( pEntry )
+	{
+		SetPackSource( *pSearchPath, *pEntry, source );
+	}
+	else if( pSearchPath->IsMemory() )
+	{
+		auto it = pSearchPath->memoryFiles.find( CPathIndex::NormalizeKey( pszActualName ) );
+
+		if( it == pSearchPath->memoryFiles.end() )
+			return false;
+
+		source.contents = it->second.contents;
+		source.pData = source.contents->data.get();
+		source.uiLength = source.contents->uiSize;
+	}
+	else
+	{
+		source.szFileName = ( fs::path( pSearchPath->szPath ) / pszActualName ).make_preferred().u8string();
+	}
+
+	if( ppStats )
+		*ppStats = pSearchPath->pStats;
+
+	return true;
+}
+
+bool CFileSystem::LocateFileDataInSnapshot( const char* pszFileName, const char* pszPathID, CAsyncReader::Source_t& source, 
+											CFileSystemStats::PathCounters_t** ppStats, bool& bFound )
+{
+	auto snapshot = std::atomic_load( &m_Snapshot );
+
+	if( !snapshot )
+		return false;
+
+	const CSearchPath* pSearchPath;
+	const CPackFileEntry* pEntry;
+
+	char szName[ MAX_PATH ];
+
+	const auto result = snapshot->Find( pszFileName, pszPathID, &pSearchPath, &pEntry, szName, sizeof( szName ) );
+
+	if( result == CSearchPathSnapshot::Result::UNKNOWN )
+		return false;
+
+	bFound = result == CSearchPathSnapshot::Result::FOUND;
+
+	if( !bFound )
+		return true;
+
+	source = CAsyncReader::Source_t();
+
+	if( pEntry )
+		SetPackSource( *pSearchPath, *pEntry, source );
+	else
+		source.szFileName = ( fs::path( pSearchPath->szPath ) / szName ).make_preferred().u8string();
+
+	source.snapshot = std::move( snapshot );
+
+	if( ppStats )
+		*ppStats = pSearchPath->pStats;
+
+	return true;
+}
+
+void CFileSystem::SetPackSource( const CSearchPath& searchPath, const CPackFileEntry& entry, CAsyncReader::Source_t& source )
+{
+	if( searchPath.packMapping && searchPath.packMapping->IsValidRange( entry.GetStartOffset(), entry.GetStoredLength() ) )
+	{
+		source.pData = searchPath.packMapping->GetData();
+	}
+
+	source.pFile = searchPath.packFile->GetFile();
+	source.uiStartOffset = entry.GetStartOffset();
+	source.uiLength = entry.GetLength();
+
+	if( m_BlockCache.IsEnabled() )
+		source.pBlockCache = &m_BlockCache;
+
+	if( entry.IsCompressed() )
+	{
+		source.codec = entry.GetCodec();
+		source.uiStoredLength = entry.GetStoredLength();
+		source.uiBlockSize = searchPath.uiPackBlockSize;
+	}
+
+	source.streaming = searchPath.streaming;
+}
+
+void CFileSystem::ParseResourceList( const char* pszList, std::vector<CAsyncReader::Source_t>& sources )
+{
+	static const char* const RESOURCE_LIST_SEPARATORS = ";,\r\n";
+	static const char* const RESOURCE_LIST_EXTENSION = ".lst";
+
+	std::string szName;
+
+	const char* pszNext = pszList;
+
+	while( *pszNext )
+	{
+		const size_t uiLength = strcspn( pszNext, RESOURCE_LIST_SEPARATORS );
+
+		szName.assign( pszNext, uiLength );
+
+		pszNext += uiLength;
+
+		if( *pszNext )
+			++pszNext;
+
+		const auto uiFirst = szName.find_first_not_of( " \t\"" );
+
+		if( uiFirst == std::string::npos )
+			continue;
+
+		szName = szName.substr( uiFirst, szName.find_last_not_of( " \t\"" ) - uiFirst + 1 );
+
+		CAsyncReader::Source_t source;
+
+		if( !LocateFileData( szName.c_str(), nullptr, source ) )
+		{
+			Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::ParseResourceList: Couldn't find resource \"%s\"\n", szName.c_str() );
+			continue;
+		}
+
+		const size_t uiExtLength = strlen( RESOURCE_LIST_EXTENSION );
+
+		//Resource list files contain the names of the resources to load, one per line. They're resolved ahead of time into a manifest.
+		if( szName.length() > uiExtLength && !stricmp( szName.c_str() + szName.length() - uiExtLength, RESOURCE_LIST_EXTENSION ) )
+		{
+			CResourceManifest manifest;
+
+			if( LoadResourceManifest( szName.c_str(), false, manifest ) )
+				AddManifestSources( manifest, sources );
+
+			continue;
+		}
+
+		sources.emplace_back( std::move( source ) );
+	}
+}
+
+bool CFileSystem::LoadResourceManifest( const char* pszListName, const bool bCompile, CResourceManifest& manifest )
+{
+	std::vector<uint8_t> list;
+
+	if( !ReadWholeFile( pszListName, list ) )
+		return false;
+
+	const std::string szList( list.begin(), list.end() );
+
+	const uint32_t uiHash = GetResourceListHash( szList );
+
+	const auto szPath = GetResourceManifestPath( pszListName );
+
+	std::vector<uint8_t> data;
+
+	if( !bCompile && ReadWholeFile( szPath.c_str(), data ) && manifest.Deserialize( data.data(), data.size() ) &&
+		manifest.GetSourceHash() == uiHash && manifest.IsCurrent() )
+	{
+		return true;
+	}
+
+	CompileResourceManifest( szList, manifest );
+
+	manifest.SetSourceHash( uiHash );
+
+	manifest.Serialize( data );
+
+	CreateDirHierarchy( RESOURCE_MANIFEST_DIR, nullptr );
+
+	auto hFile = Open( szPath.c_str(), "wb", nullptr );
+
+	//Still usable, it just has to be compiled again next time.
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::LoadResourceManifest: Couldn't open \"%s\" for writing\n", szPath.c_str() );
+		return true;
+	}
+
+	Write( data.data(), static_cast<int>( data.size() ), hFile );
+
+	Close( hFile );
+
+	return true;
+}
+
+void CFileSystem::CompileResourceManifest( const std::string& szList, CResourceManifest& manifest )
+{
+	manifest.Clear();
+
+	ProcessDirectoryChanges();
+
+	auto lock = LockShared();
+
+	std::string szName;
+
+	for( size_t uiStart = 0; uiStart < szList.length(); )
+	{
+		const size_t uiLength = std::min( szList.find_first_of( "\r\n", uiStart ), szList.length() ) - uiStart;
+
+		szName.assign( szList, uiStart, uiLength );
+
+		uiStart += uiLength + 1;
+
+		if( szName.empty() )
+			continue;
+
+		const CPackFileEntry* pEntry;
+		bool bIsDirectory;
+		const char* pszActualName;
+
+		auto pSearchPath = ResolveFile( szName.c_str(), nullptr, &pEntry, &bIsDirectory, &pszActualName );
+
+		if( !pSearchPath || bIsDirectory )
+		{
+			Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::CompileResourceManifest: Couldn't find resource \"%s\"\n", szName.c_str() );
+			continue;
+		}
+
+		if( pEntry )
+		{
+			//Compressed entries are prefetched as stored.
+			manifest.AddPackResource( pSearchPath->szPath, pEntry->GetStartOffset(), pEntry->GetStoredLength() );
+		}
+		else if( pSearchPath->IsLoose() )
+		{
+			const auto szPath = ( fs::path( pSearchPath->szPath ) / pszActualName ).make_preferred().u8string();
+
+			std::error_code error;
+
+			const auto uiSize = static_cast<uint64_t>( fs::file_size( szPath, error ) );
+
+			if( !error )
+				manifest.AddLooseFile( szPath.c_str(), uiSize );
+		}
+
+		//Memory files are already in memory.
+	}
+
+	manifest.Finish( MAX_BATCH_GAP, MAX_BATCH_READ );
+}
+
+uint32_t CFileSystem::GetResourceListHash( const std::string& szList )
+{
+	uint32_t uiHash = crc32c::Compute( szList.data(), szList.length() );
+
+	//Case folding changes which files names resolve to.
+	const uint32_t uiFoldCase = ( m_Options & FileSystemOption::CASE_INSENSITIVE ) ? 1 : 0;
+
+	uiHash = crc32c::Update( uiHash, &uiFoldCase, sizeof( uiFoldCase ) );
+
+	auto lock = LockShared();
+
+	for( const auto& path : m_SearchPaths )
+	{
+		//Include the terminators so paths can't run into each other.
+		uiHash = crc32c::Update( uiHash, path->szPath, strlen( path->szPath ) + 1 );
+
+		if( path->pszPathID )
+			uiHash = crc32c::Update( uiHash, path->pszPathID, strlen( path->pszPathID ) + 1 );
+	}
+
+	return uiHash;
+}
+
+void CFileSystem::AddManifestSources( const CResourceManifest& manifest, std::vector<CAsyncReader::Source_t>& sources )
+{
+	auto lock = LockShared();
+
+	const auto& packs = manifest.GetPacks();
+
+	std::vector<const CSearchPath*> packPaths( packs.size(), nullptr );
+
+	for( const auto& path : m_SearchPaths )
+	{
+		if( !path->IsPackFile() )
+			continue;
+
+		for( size_t uiPack = 0; uiPack < packs.size(); ++uiPack )
+		{
+			if( !packPaths[ uiPack ] && packs[ uiPack ].szPath == path->szPath )
+				packPaths[ uiPack ] = path.get();
+		}
+	}
+
+	sources.reserve( sources.size() + manifest.GetRanges().size() + manifest.GetLooseFiles().size() );
+
+	for( const auto& range : manifest.GetRanges() )
+	{
+		const auto pSearchPath = packPaths[ range.uiPack ];
+
+		if( !pSearchPath )
+			continue;
+
+		CAsyncReader::Source_t source;
+
+		if( pSearchPath->packMapping && pSearchPath->packMapping->IsValidRange( range.uiOffset, range.uiLength ) )
+			source.pData = pSearchPath->packMapping->GetData();
+
+		//Ranges are read as stored, so they're prefetched like uncompressed entries.
+		source.pFile = pSearchPath->packFile->GetFile();
+		source.uiStartOffset = range.uiOffset;
+		source.uiLength = range.uiLength;
+
+		if( m_BlockCache.IsEnabled() )
+			source.pBlockCache = &m_BlockCache;
+
+		source.streaming = pSearchPath->streaming;
+
+		sources.emplace_back( std::move( source ) );
+	}
+
+	for( const auto& file : manifest.GetLooseFiles() )
+	{
+		CAsyncReader::Source_t source;
+
+		source.szFileName = file.szPath;
+		source.uiLength = file.uiSize;
+
+		sources.emplace_back( std::move( source ) );
+	}
+}
+
+std::string CFileSystem::GetResourceManifestPath( const char* pszListName )
+{
+	//Lists in different directories can share a name, so the whole path is used.
+	std::string szName = fs::path( pszListName ).replace_extension().generic_u8string();
+
+	std::replace( szName.begin(), szName.end(), '/', '_' );
+	std::replace( szName.begin(), szName.end(), ':', '_' );
+
+	return std::string( RESOURCE_MANIFEST_DIR ) + '/' + szName + RESOURCE_MANIFEST_EXTENSION;
+}
+
+bool CFileSystem::ReadWholeFile( const char* pszFileName, std::vector<uint8_t>& data )
+{
+	auto hFile = Open( pszFileName, "rb", nullptr );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+		return false;
+
+	data.resize( static_cast<size_t>( Size64( hFile ) ) );
+
+	const bool bRead = data.empty() || Read( data.data(), static_cast<int>( data.size() ), hFile ) == static_cast<int>( data.size() );
+
+	Close( hFile );
+
+	return bRead;
+}
+
+std::string CFileSystem::GetLoadTracePath( const char* pszLevelName )
+{
+	//Only the level's base name is used, so "maps/c1a0.bsp" and "c1a0" share a trace.
+	return std::string( LOAD_TRACE_DIR ) + '/' + fs::path( pszLevelName ).stem().u8string() + LOAD_TRACE_EXTENSION;
+}
+
+void CFileSystem::ReplayLoadTrace( const char* pszLevelName )
+{
+	const auto szPath = GetLoadTracePath( pszLevelName );
+
+	std::vector<uint8_t> data;
+
+	if( !ReadWholeFile( szPath.c_str(), data ) )
+		return;
+
+	if( !m_LoadTrace.Deserialize( data.data(), data.size() ) )
+	{
+		Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::ReplayLoadTrace: Load trace \"%s\" is invalid\n", szPath.c_str() );
+		return;
+	}
+
+	std::vector<CLoadTrace::ScheduleEntry_t> schedule;
+
+	m_LoadTrace.GetSchedule( schedule );
+
+	std::vector<CAsyncReader::Source_t> sources;
+
+	sources.reserve( schedule.size() );
+
+	for( const auto& entry : schedule )
+	{
+		CAsyncReader::Source_t source;
+
+		if( !LocateFileData( entry.szFileName.c_str(), nullptr, source ) )
+			continue;
+
+		//Pack file entries only need the parts that were read. Loose files are read in full.
+		//Compressed entries are read in full as well, since offsets in the trace are uncompressed.
+		if( ( source.pData || source.pFile ) && source.codec == pack::Codec::NONE && entry.uiOffset < source.uiLength )
+		{
+			source.uiStartOffset += entry.uiOffset;
+			source.uiLength = std::min( entry.uiLength, source.uiLength - entry.uiOffset );
+		}
+
+		sources.emplace_back( std::move( source ) );
+	}
+
+	m_hReplayGroup = m_Prefetcher.AddGroup( std::move( sources ) );
+}
+
+void CFileSystem::SetOptions( FileSystemOptions_t options )
+{
+	auto lock = LockExclusive();
+
+	const bool bFoldCase = ( options & FileSystemOption::CASE_INSENSITIVE ) != 0;
+
+	const bool bWatch = ( options & FileSystemOption::WATCH_LOOSE_PATHS ) != 0;
+	const bool bWasWatching = ( m_Options & FileSystemOption::WATCH_LOOSE_PATHS ) != 0;
+
+	//Tracking can't be turned off, the counts would be wrong if it were turned on again.
+	if( options & FileSystemOption::TRACK_MEMORY )
+		Mem_EnableTracking();
+	else if( Mem_IsTrackingEnabled() )
+		options |= FileSystemOption::TRACK_MEMORY;
+
+	m_Options = options;
+
+	if( bFoldCase != m_PathIndex.IsFoldingCase() )
+	{
+		//All keys change, so rebuild the index from scratch.
+		m_PathIndex.SetFoldCase( bFoldCase );
+		m_PathIndex.Rebuild( m_SearchPaths );
+		m_NegativeCache.InvalidateAll();
+	}
+
+	if( bWatch != bWasWatching )
+		SetWatchingSearchPaths( bWatch );
+
+	if( !( options & FileSystemOption::CACHE_LOOSE_FILES ) )
+		m_DescriptorCache.InvalidateAll();
+
+	//Discards the cached blocks if it changes.
+	m_BlockCache.SetLargePages( ( options & FileSystemOption::LARGE_PAGES ) != 0 );
+
+	PublishSnapshot();
+}
+
+void CFileSystem::ProcessDirectoryChanges()
+{
+	if( !m_DirectoryWatcher.HasChanges() )
+		return;
+
+	auto lock = LockExclusive();
+
+	std::vector<CDirectoryWatcher::Change_t> changes;
+
+	m_DirectoryWatcher.GetChanges( changes );
+
+	bool bRescan = false;
+
+	for( const auto& change : changes )
+	{
+		auto& searchPath = *change.pSearchPath;
+
+		switch( change.type )
+		{
+		case CDirectoryWatcher::ChangeType::ADDED:
+			{
+				m_PathIndex.AddFile( searchPath, searchPath.uiOrder, change.szFileName.c_str(), change.bIsDirectory );
+				m_NegativeCache.Invalidate( m_PathIndex.MakeKey( change.szFileName.c_str() ) );
+
+				//Files can be replaced by moving another file over them.
+				CPathBuffer path;
+
+				if( path.Set( searchPath.szPath, change.szFileName.c_str() ) )
+					m_MetadataCache.Invalidate( path.Get() );
+				break;
+			}
+
+		case CDirectoryWatcher::ChangeType::REMOVED:
+			{
+				m_PathIndex.RemoveTree( searchPath, change.szFileName.c_str() );
+
+				CPathBuffer path;
+
+				if( change.bIsDirectory )
+				{
+					m_DescriptorCache.InvalidateAll();
+					m_MetadataCache.InvalidateAll();
+				}
+				else if( path.Set( searchPath.szPath, change.szFileName.c_str() ) )
+				{
+					m_DescriptorCache.Invalidate( path.Get() );
+					m_MetadataCache.Invalidate( path.Get() );
+				}
+				break;
+			}
+
+		case CDirectoryWatcher::ChangeType::MODIFIED:
+			{
+				CPathBuffer path;
+
+				if( path.Set( searchPath.szPath, change.szFileName.c_str() ) )
+					m_MetadataCache.Invalidate( path.Get() );
+				break;
+			}
+
+		case CDirectoryWatcher::ChangeType::RESCAN:
+			{
+				bRescan = true;
+				break;
+			}
+
+		case CDirectoryWatcher::ChangeType::LOST:
+			{
+				//Probe the disk again for files that aren't indexed.
+				searchPath.bIsWatched = false;
+				m_NegativeCache.InvalidateAll();
+				m_MetadataCache.InvalidateAll();
+
+				Warning( FILESYSTEM_WARNING_REPORTUSAGE, "CFileSystem::ProcessDirectoryChanges: Stopped watching search path \"%s\"\n", searchPath.szPath );
+				break;
+			}
+		}
+	}
+
+	if( bRescan )
+	{
+		m_PathIndex.Rebuild( m_SearchPaths );
+		m_NegativeCache.InvalidateAll();
+		m_DescriptorCache.InvalidateAll();
+		m_MetadataCache.InvalidateAll();
+	}
+}
+
+void CFileSystem::SetWatchingSearchPaths( const bool bWatch )
+{
+	//Changes made while search paths weren't watched weren't seen.
+	m_MetadataCache.InvalidateAll();
+
+	if( !bWatch )
+	{
+		m_DirectoryWatcher.Shutdown();
+
+		for( auto& searchPath : m_SearchPaths )
+		{
+			searchPath->bIsWatched = false;
+		}
+
+		return;
+	}
+
+	for( auto& searchPath : m_SearchPaths )
+	{
+		if( searchPath->IsLoose() && !searchPath->IsOverlay() && !searchPath->bIsWatched )
+			searchPath->bIsWatched = m_DirectoryWatcher.AddPath( *searchPath );
+	}
+
+	//Files may have been created outside of the filesystem since the search paths were indexed.
+	m_PathIndex.Rebuild( m_SearchPaths );
+	m_NegativeCache.InvalidateAll();
+}
+
+void CFileSystem::GetNegativeCacheStats( FileSystemNegativeCacheStats_t& stats )
+{
+	stats.uiLookups = m_NegativeCache.GetLookupCount();
+	stats.uiHits = m_NegativeCache.GetHitCount();
+	stats.uiInvalidations = m_NegativeCache.GetInvalidationCount();
+	stats.uiEntries = m_NegativeCache.GetEntryCount();
+}
+
+void CFileSystem::SetBlockCacheSize( size_t uiBytes )
+{
+	m_BlockCache.SetCapacity( uiBytes, ( m_Options & FileSystemOption::LARGE_PAGES ) != 0 );
+}
+
+void CFileSystem::GetBlockCacheStats( FileSystemBlockCacheStats_t& stats )
+{
+	CBlockCache::Stats_t cacheStats;
+
+	m_BlockCache.GetStats( cacheStats );
+
+	stats.uiHits = cacheStats.uiHits;
+	stats.uiMisses = cacheStats.uiMisses;
+	stats.uiEvictions = cacheStats.uiEvictions;
+	stats.uiBypasses = cacheStats.uiBypasses;
+	stats.bLargePages = cacheStats.backing != PageBacking::NORMAL;
+	stats.uiBytesRead = cacheStats.uiBytesRead;
+	stats.uiBlocks = cacheStats.uiBlocks;
+	stats.uiCapacity = cacheStats.uiCapacity;
+}
+
+void CFileSystem::SetDirectStreamingThreshold( uint64_t uiBytes )
+{
+	//Files that are open keep reading the way they were opened.
+	m_uiDirectStreamingThreshold = uiBytes;
+}
+
+void CFileSystem::GetStats( FileSystemStats_t& stats )
+{
+	m_Stats.GetStats( stats );
+
+	stats.uiAuditDropped = m_AccessAudit.GetDropped();
+}
+
+size_t CFileSystem::GetSearchPathStats( FileSystemPathStats_t* pStats, size_t uiMaxCount )
+{
+	return m_Stats.GetSearchPathStats( pStats, uiMaxCount );
+}
+
+size_t CFileSystem::GetSlowestFiles( FileSystemFileStats_t* pFiles, size_t uiMaxCount )
+{
+	return m_Stats.GetSlowestFiles( pFiles, uiMaxCount );
+}
+
+void CFileSystem::ResetStats()
+{
+	m_Stats.Reset();
+	m_BlockCache.ResetStats();
+	m_AccessAudit.Reset();
+}
+
+size_t CFileSystem::GetAccessAudit( FileSystemAccessStats_t* pFiles, size_t uiMaxCount )
+{
+	return m_AccessAudit.GetSummary( pFiles, uiMaxCount );
+}
+
+size_t CFileSystem::GetMemoryStats( MemoryTagStats_t* pStats, size_t uiMaxCount )
+{
+	return Mem_GetStats( pStats, uiMaxCount );
+}
+
+size_t CFileSystem::GetTraceEvents( char* pszBuffer, size_t uiBufferSize, uint64_t uiSinceUS, unsigned int uiProcessID )
+{
+	return Trace_GetEvents( pszBuffer, uiBufferSize, uiSinceUS, uiProcessID );
+}
+
+void CFileSystem::GetFastPath( FileSystemFastPath_t& fastPath )
+{
+	fastPath.pContext = this;
+
+	fastPath.pfnOpen = &FastPath_Open;
+	fastPath.pfnClose = &FastPath_Close;
+	fastPath.pfnRead = &FastPath_Read;
+	fastPath.pfnSeek = &FastPath_Seek;
+	fastPath.pfnTell = &FastPath_Tell;
+	fastPath.pfnFileExists = &FastPath_FileExists;
+}
+
+CFileSystem::FindFiles_t& CFileSystem::GetFindFiles()
+{
+	static thread_local FindFiles_t findFiles;
+
+	return findFiles;
+}
+
+CFileSystem::FindFileData* CFileSystem::GetFindFileData( FileFindHandle_t handle )
+{
+	if( handle == FILESYSTEM_INVALID_FIND_HANDLE )
+		return nullptr;
+
+	const uint32_t uiHandle = static_cast<uint32_t>( handle );
+	const uint32_t uiIndex = uiHandle & FIND_INDEX_MASK;
+
+	auto& findFiles = GetFindFiles();
+
+	if( uiIndex >= findFiles.data.size() )
+		return nullptr;
+
+	auto& data = *findFiles.data[ uiIndex ];
+
+	if( !( data.flags & FindFileFlag::VALID ) || data.uiGeneration != static_cast<uint16_t>( uiHandle >> FIND_GENERATION_SHIFT ) )
+		return nullptr;
+
+	return &data;
+}
+
+CFileSystem::SharedLock_t CFileSystem::LockShared() const
+{
+	if( IsThreadSafe() )
+		return SharedLock_t( m_SearchPathMutex );
+
+	return SharedLock_t( m_SearchPathMutex, std::defer_lock );
+}
+
+CFileSystem::ExclusiveLock_t CFileSystem::LockExclusive() const
+{
+	if( IsThreadSafe() )
+		return ExclusiveLock_t( m_SearchPathMutex );
+
+	return ExclusiveLock_t( m_SearchPathMutex, std::defer_lock );
+}
+
+bool CFileSystem::GetFileMetadata( const CSearchPath& searchPath, const char* pszFileName, CMetadataCache::Metadata_t& metadata )
+{
+	if( searchPath.IsMemory() )
+	{
+		auto it = searchPath.memoryFiles.find( CPathIndex::NormalizeKey( pszFileName ) );
+
+		if( it == searchPath.memoryFiles.end() )
+			return false;
+
+		metadata.uiSize = it->second.contents->uiSize;
+		metadata.iModifiedTime = it->second.iModifiedTime;
+
+		return true;
+	}
+
+	CPathBuffer path;
+
+	if( !path.Set( searchPath.szPath, pszFileName ) )
+		return false;
+
+	//Only watched search paths find out about changes made outside of the filesystem.
+	if( searchPath.bIsWatched && m_MetadataCache.Find( path.Get(), metadata ) )
+		return true;
+
+	if( searchPath.directory )
+	{
+		CDirectoryHandle::Status_t status;
+
+		if( !searchPath.directory->GetStatus( pszFileName, status ) || status.bIsDirectory )
+			return false;
+
+		metadata.uiSize = status.uiSize;
+		metadata.iModifiedTime = status.iModifiedTime;
+
+		if( searchPath.bIsWatched )
+			m_MetadataCache.Insert( path.Get(), metadata );
+
+		return true;
+	}
+
+	std::error_code error;
+
+	metadata.uiSize = static_cast<uint64_t>( fs::file_size( path.Get(), error ) );
+
+	if( error )
+		return false;
+
+	//Cast to seconds since the write time is returned in different format. - Solokiller
+	metadata.iModifiedTime = std::chrono::duration_cast<std::chrono::seconds>( fs::last_write_time( path.Get(), error ).time_since_epoch() ).count();
+
+	if( error )
+		return false;
+
+	if( searchPath.bIsWatched )
+		m_MetadataCache.Insert( path.Get(), metadata );
+
+	return true;
+}
+
+void CFileSystem::InvalidateMetadata( const CFileHandle& file )
+{
+	//Loose files that don't read ahead were opened for writing. Their names are full paths.
+	if( !file.IsPackEntry() && !file.IsReadAhead() )
+		m_MetadataCache.Invalidate( file.GetFileName() );
+}
+
+void CFileSystem::FreeReadBuffer( CFileHandle& file )
+{
+	auto& buffer = file.GetReadBuffer();
+
+	//Shared buffers are freed when the last file using them releases them.
+	m_ReadBufferPool.Release( std::move( buffer.data ), buffer.uiCapacity );
+
+	buffer = CFileHandle::ReadBuffer_t();
 }
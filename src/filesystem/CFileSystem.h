@@ -5,13 +5,40 @@
 #include <cstdio>
 #include <experimental/filesystem>
 #include <memory>
+#include <mutex>
+#include <shared_mutex>
 #include <string>
+#include <unordered_set>
 #include <vector>
 
+#include "CWildcardPattern.h"
 #include "Platform.h"
-
+#include "StringUtils.h"
+
+#include "CAccessAudit.h"
+#include "CAsyncReader.h"
+#include "CAsyncWriter.h"
+#include "CBlockCache.h"
+#include "CContentCache.h"
+#include "CDescriptorCache.h"
+#include "CDirectoryWatcher.h"
+#include "CDirectStreamer.h"
 #include "CFileHandle.h"
+#include "CFileHandleTable.h"
+#include "CLoadTrace.h"
+#include "CMetadataCache.h"
+#include "CMountIndexCache.h"
+#include "CNegativeLookupCache.h"
+#include "CPackVerifier.h"
+#include "CPathIDTable.h"
+#include "CPathIndex.h"
+#include "CPathPrefixTable.h"
+#include "CPrefetcher.h"
+#include "CReadBufferPool.h"
+#include "CResourceManifest.h"
 #include "CSearchPath.h"
+#include "CSearchPathSnapshot.h"
+#include "CStreamingInstaller.h"
 
 #include "FileSystem2.h"
 
@@ -22,6 +49,11 @@ class CFileSystem : public IFileSystem2
 private:
 	typedef std::vector<std::unique_ptr<CSearchPath>> SearchPaths_t;
 
+	/**
+	*	Search paths in search path order, without ownership.
+	*/
+	typedef std::vector<CSearchPath*> SearchPathList_t;
+
 	typedef uint32_t FindFileFlags_t;
 
 	struct FindFileFlag
@@ -33,6 +65,7 @@ private:
 			VALID					= 1 << 1,
 			IS_PACK_FILE			= 1 << 2,
 			SKIP_IDENTICAL_PATHS	= 1 << 3,
+			IS_MEMORY				= 1 << 4,
 		};
 	};
 
@@ -42,7 +75,11 @@ private:
 		{
 			if( flags & FindFileFlag::IS_PACK_FILE )
 			{
-				return pack_iterator == currentPath->get()->packEntries.end();
+				return pack_iterator == pack_end;
+			}
+			else if( flags & FindFileFlag::IS_MEMORY )
+			{
+				return uiMemoryFile >= memoryFiles.size();
 			}
 			else
 			{
@@ -51,24 +88,86 @@ private:
 		}
 
 		std::experimental::filesystem::recursive_directory_iterator iterator;
-		//For pack search paths: the index of the current pack file entry.
+		//For pack search paths: the index of the current pack file entry, and the end of the entries that can match.
 		CSearchPath::Entries_t::const_iterator pack_iterator;
+		CSearchPath::Entries_t::const_iterator pack_end;
+
+		//For memory search paths: the names that can match, and the index of the current one.
+		//The names are copied since files can be removed between calls.
+		std::vector<std::string> memoryFiles;
+		size_t uiMemoryFile = 0;
 
 		std::experimental::filesystem::directory_entry entry;
 		std::string szFileName;
-		std::string szFilter;
+
+		//Compiled once, names are matched against it as they're enumerated.
+		CWildcardPattern filter;
+
+		//Part of the filter before the first wildcard. Only names that start with it can match.
+		std::string szPrefix;
+
+		//Directory part of the prefix. Loose search paths are only enumerated from this directory down.
+		std::string szPrefixDirectory;
 
 		char szPathID[ MAX_PATH ];
 
-		SearchPaths_t::const_iterator currentPath;
+		//Index of the search path after the one being enumerated. An index rather than an iterator, since search paths can be added between calls.
+		size_t uiNextPath = 0;
+
+		//Search path generation when the search started. Removing search paths can destroy the pack entries and paths the search points into.
+		uint32_t uiSearchPathGeneration = 0;
 
 		FindFileFlags_t flags = FindFileFlag::VALID;
 
-		std::vector<const char*> searchedPaths;
+		std::unordered_set<const char*, Hash_C_String<const char*>, EqualTo_C_String<const char*>> searchedPaths;
+
+		//Incremented when the search is closed, so handles to earlier searches in the same slot are detected.
+		uint16_t uiGeneration = 0;
+	};
+
+	/**
+	*	A thread's searches. Closed searches are kept and reused for later ones, along with the memory of their strings and vectors,
+	*	so searching doesn't allocate once a thread has done a few searches.
+	*	Handles encode the slot index and a generation counter, like file handles.
+	*/
+	struct FindFiles_t
+	{
+		std::vector<std::unique_ptr<FindFileData>> data;
+
+		std::vector<uint32_t> freeSlots;
 	};
 
-	typedef std::vector<std::unique_ptr<CFileHandle>> OpenedFiles_t;
-	typedef std::vector<std::unique_ptr<FindFileData>> FindFiles_t;
+	/**
+	*	Maximum number of searches that can be open at the same time, per thread.
+	*	The last index is never used, so a handle can't be FILESYSTEM_INVALID_FIND_HANDLE.
+	*/
+	static const size_t MAX_FIND_HANDLES = 0xFFFF;
+
+	static const uint32_t FIND_INDEX_MASK = 0xFFFF;
+	static const uint32_t FIND_GENERATION_SHIFT = 16;
+
+	typedef std::shared_lock<std::shared_timed_mutex> SharedLock_t;
+	typedef std::unique_lock<std::shared_timed_mutex> ExclusiveLock_t;
+
+	/**
+	*	Maximum number of threads used to load the pack files in a search path.
+	*/
+	static const size_t MAX_PACK_LOAD_THREADS = 4;
+
+	/**
+	*	Maximum number of threads used to search the search paths in FindAll.
+	*/
+	static const size_t MAX_FIND_THREADS = 4;
+
+	/**
+	*	Largest gap between two files in a batched load that is read through rather than split into two reads.
+	*/
+	static const uint64_t MAX_BATCH_GAP = 64 * 1024;
+
+	/**
+	*	Largest single read in a batched load. Files larger than this are read on their own.
+	*/
+	static const uint64_t MAX_BATCH_READ = 4 * 1024 * 1024;
 
 public:
 	CFileSystem() = default;
@@ -202,33 +301,439 @@ public:
 
 	bool			FullPathToRelativePathEx( const char *pFullpath, char *pRelative, size_t uiSizeInChars ) override;
 
+	FileSystemOptions_t GetOptions() const override { return m_Options; }
+
+	void			SetOptions( FileSystemOptions_t options ) override;
+
+	void			GetNegativeCacheStats( FileSystemNegativeCacheStats_t& stats ) override;
+
+	void			GetStats( FileSystemStats_t& stats ) override;
+
+	size_t			GetSearchPathStats( FileSystemPathStats_t* pStats, size_t uiMaxCount ) override;
+
+	size_t			GetSlowestFiles( FileSystemFileStats_t* pFiles, size_t uiMaxCount ) override;
+
+	void			ResetStats() override;
+
+	size_t			GetMemoryStats( MemoryTagStats_t* pStats, size_t uiMaxCount ) override;
+
+	size_t			GetTraceEvents( char* pszBuffer, size_t uiBufferSize, uint64_t uiSinceUS, unsigned int uiProcessID ) override;
+
+	FileAsyncHandle_t ReadAsync( const FileAsyncRequest_t& request ) override;
+
+	FileAsyncStatus	GetAsyncStatus( FileAsyncHandle_t handle, uint64_t* puiBytesRead = nullptr ) override;
+
+	FileAsyncStatus	WaitForAsync( FileAsyncHandle_t handle, uint64_t* puiBytesRead = nullptr ) override;
+
+	bool			CancelAsync( FileAsyncHandle_t handle ) override;
+
+	void			ReleaseAsync( FileAsyncHandle_t handle ) override;
+
+	void*			LoadFile( const char* pFileName, const char* pathID, FileAllocateFunc_t pfnAllocate, void* pContext, uint64_t* puiSize = nullptr ) override;
+
+	size_t			LoadFiles( FileBatchRequest_t* pRequests, size_t uiCount, const char* pathID, FileAllocateFunc_t pfnAllocate ) override;
+
+	bool			AddMemorySearchPath( const char* pName, const char* pathID ) override;
+
+	bool			AddMemoryFile( const char* pSearchPath, const char* pFileName, const void* pData, uint64_t uiSize ) override;
+
+	bool			PinFile( const char* pSearchPath, const char* pFileName, const char* pathID = nullptr ) override;
+
+	bool			RemoveMemoryFile( const char* pSearchPath, const char* pFileName ) override;
+
+	void			GetFastPath( FileSystemFastPath_t& fastPath ) override;
+
+	void			SetBlockCacheSize( size_t uiBytes ) override;
+
+	void			GetBlockCacheStats( FileSystemBlockCacheStats_t& stats ) override;
+
+	void			SetDirectStreamingThreshold( uint64_t uiBytes ) override;
+
+	bool			AddOverlaySearchPath( const char* pPath, const char* pathID ) override;
+
+	bool			UpdateOverlayFile( const char* pSearchPath, const char* pFileName ) override;
+
+	void			SetContentSource( const FileContentSource_t& source ) override;
+
+	bool			AddStreamingPackFile( const char* pFullPath, const char* pRemoteName, const char* pathID ) override;
+
+	void			GetInstallProgress( uint64_t* puiAvailableBytes, uint64_t* puiTotalBytes ) override;
+
+	bool			CompileResourceManifest( const char* pResourceList ) override;
+
+	size_t			GetAccessAudit( FileSystemAccessStats_t* pFiles, size_t uiMaxCount ) override;
+
+	size_t			FindAll( const char* pWildCard, FileSystemFindFlags_t flags, const char* pathID, FileSystemFindResult_t* pResults, size_t uiMaxCount ) override;
+
 	//CFileSystem
 
 	void Warning( FileWarningLevel_t level, const char* pszFormat, ... );
 
+	/**
+	*	@return Whether warnings of the given level should be logged with LOG_BINARY instead of Warning.
+	*	Only if they would be logged, and no warning function is set, since it expects formatted text.
+	*/
+	bool ShouldLogBinary( FileWarningLevel_t level ) const { return level <= m_WarningLevel && !m_WarningFunc; }
+
 private:
 
 	SearchPaths_t::const_iterator FindSearchPath( const char* pszPath, const bool bCheckPathID = false, const char* pszPathID = nullptr ) const;
 
-	bool AddSearchPath( const char *pPath, const char *pathID, const bool bReadOnly );
+	/**
+	*	Adds a loose search path.
+	*	@param flags Search path flags, such as SearchPathFlag::READ_ONLY.
+	*/
+	bool AddSearchPath( const char *pPath, const char *pathID, const SearchPathFlags_t flags );
+
+	/**
+	*	Indexes the directories that a file in a fully indexed search path is in, since lookups don't fall back to the disk for them.
+	*/
+	void IndexParentDirectories( CSearchPath& searchPath, const char* pszFileName );
+
+	struct FindMatch_t
+	{
+		std::string szFileName;
+		bool bIsDirectory;
+	};
 
-	bool PreparePackFile( const char* pszFullPath, const char* pszPathID, CFileHandle& file, int64_t offset );
+	/**
+	*	Finds the files and directories in a search path that match a wildcard, for FindAll. Doesn't modify anything, so search paths can be searched concurrently.
+	*	@param szPrefixDirectory Directory part of the wildcard's prefix. Loose search paths are only enumerated from this directory down.
+	*/
+	static void FindMatches( const CSearchPath& searchPath, const CWildcardPattern& filter, const std::string& szPrefix, const std::string& szPrefixDirectory,
+							 std::vector<FindMatch_t>& matches );
+
+	/**
+	*	Opens a pack file and reads its directory. Doesn't modify the filesystem, so pack files can be loaded concurrently.
+	*	@return Search path for the pack file, or null if it couldn't be loaded.
+	*/
+	std::unique_ptr<CSearchPath> LoadPackFile( const char* pszFullPath, const char* pszPathID, const bool bCheckForAppendPack );
+
+	/**
+	*	Creates the search path for an opened pack file.
+	*	@param streaming If the pack file is installed while it's in use, the pack. Its header and directory must have been fetched.
+	*/
+	std::unique_ptr<CSearchPath> PreparePackFile( const char* pszFullPath, const char* pszPathID, CFileHandle& file, int64_t offset,
+												  std::shared_ptr<CStreamingPack> streaming = nullptr );
+
+	/**
+	*	Identifies a pack file and reads its directory.
+	*	@param[ out ] entries Receives the directory.
+	*	@param[ out ] uiBlockSize If the pack file is compressed, receives its block size.
+	*	@return Whether the directory was read.
+	*/
+	bool ReadPackDirectory( const char* pszFullPath, CFileHandle& file, int64_t offset, CSearchPath::Entries_t& entries, uint32_t& uiBlockSize );
+
+	/**
+	*	Saves the directories of the pack files that are added to the mount index, if it's used. Must be called with the exclusive lock held.
+	*/
+	void SaveMountIndex();
+
+	/**
+	*	Verifies a loaded pack file against its checksum file, and reports the result. Can be called from multiple threads at once.
+	*	@return Whether the pack file can be added.
+	*/
+	bool VerifyPackFile( const CSearchPath& searchPath );
+
+	/**
+	*	Adds a search path to the end of the search paths and to the bucket of its path ID. Must be called with the exclusive lock held.
+	*/
+	void AppendSearchPath( std::unique_ptr<CSearchPath>&& path );
+
+	/**
+	*	Reassigns search path positions and rebuilds the path ID buckets after search paths were removed.
+	*/
+	void RebuildSearchPathBuckets();
+
+	/**
+	*	Publishes a snapshot of the current search paths, or clears it if lock free lookups can't be used.
+	*	Must be called with the exclusive lock held whenever the search paths or the options change.
+	*/
+	void PublishSnapshot();
+
+	/**
+	*	Destroys a search path that was removed, or hands it to the current snapshot if there is one, since lookups may still be using it.
+	*/
+	void RetireSearchPath( std::unique_ptr<CSearchPath>&& path );
+
+	/**
+	*	@param pathID Interned path ID of a query.
+	*	@return The search paths that match the path ID, in search path order.
+	*/
+	const SearchPathList_t& GetSearchPaths( const PathID_t pathID ) const;
+
+	/**
+	*	Adds a loaded pack file to the end of the search paths.
+	*/
+	void AddPackSearchPath( std::unique_ptr<CSearchPath>&& path );
 
 	bool AddPackFile( const char* pszFullPath, const char* pszPathID, const bool bCheckForAppendPack );
 
+	/**
+	*	Adds the numbered pack files in the given directory, in order. Pack files are loaded concurrently.
+	*/
 	void AddPackFiles( const char* pszPath );
 
-	CFileHandle* FindFile( CSearchPath& searchPath, const char* pszFileName, const char* pszOptions );
+	/**
+	*	Finds a memory search path by name. Must be called with the search path lock held.
+	*	@return The search path, or null if there is no memory search path with that name.
+	*/
+	CSearchPath* FindMemorySearchPath( const char* pszName ) const;
+
+	/**
+	*	Adds a file to a memory search path, taking ownership of its contents.
+	*	@see AddMemoryFile( const char* pSearchPath, const char* pFileName, const void* pData, uint64_t uiSize )
+	*/
+	bool AddMemoryFile( const char* pszSearchPath, const char* pszFileName, std::unique_ptr<uint8_t[]>&& data, const size_t uiSize );
+
+	/**
+	*	Opens a file. Open wraps this to measure it.
+	*	@see Open
+	*/
+	FileHandle_t OpenFile( const char *pFileName, const char *pOptions, const char *pathID );
+
+	/**
+	*	Opens a file from the given search path.
+	*	@param pEntry Optional. If the search path is a pack file, the entry to open. Otherwise, the entry is looked up by name.
+	*/
+	FileHandle_t FindFile( CSearchPath& searchPath, const char* pszFileName, const char* pszOptions, const CPackFileEntry* pEntry = nullptr );
+
+	/**
+	*	Finds the highest priority search path that provides the given file or directory.
+	*	Consults the path index first, then probes loose search paths for files that were created outside of the filesystem.
+	*	@param pszFileName Relative name of the file or directory.
+	*	@param pszPathID Optional. ID of the search paths to consider.
+	*	@param[ out ] ppEntry Optional. If the file is provided by a pack file, receives the entry. Otherwise, receives null.
+	*	@param[ out ] pbIsDirectory Optional. Receives whether the name refers to a directory.
+	*	@param[ out ] ppszFileName Optional. Receives the name of the file relative to the search path, which differs from pszFileName if case is folded.
+	*	@return The search path, or null if no search path provides it.
+	*/
+	CSearchPath* ResolveFile( const char* pszFileName, const char* pszPathID, const CPackFileEntry** ppEntry = nullptr, bool* pbIsDirectory = nullptr,
+							  const char** ppszFileName = nullptr );
+
+	/**
+	*	Gets the size and modification time of a loose or memory file. Loose files are served from the metadata cache for watched search paths.
+	*	@param pszFileName Name of the file relative to the search path.
+	*	@return Whether the file exists.
+	*/
+	bool GetFileMetadata( const CSearchPath& searchPath, const char* pszFileName, CMetadataCache::Metadata_t& metadata );
+
+	/**
+	*	Forgets the cached metadata of a loose file that may have been written to.
+	*/
+	void InvalidateMetadata( const CFileHandle& file );
+
+	/**
+	*	Returns the file's read buffer to the pool, if it has one.
+	*/
+	void FreeReadBuffer( CFileHandle& file );
+
+	bool IsThreadSafe() const { return ( m_Options & FileSystemOption::THREAD_SAFE ) != 0; }
+
+	/**
+	*	@return The calling thread's find handles.
+	*/
+	static FindFiles_t& GetFindFiles();
+
+	/**
+	*	@return The calling thread's search for the given handle, or null if the handle is invalid or was already closed.
+	*/
+	static FindFileData* GetFindFileData( FileFindHandle_t handle );
+
+	/**
+	*	Locks the search paths for lookups. Only locks if the filesystem is in thread safe mode.
+	*/
+	SharedLock_t LockShared() const;
+
+	/**
+	*	Locks the search paths for modification. Only locks if the filesystem is in thread safe mode.
+	*/
+	ExclusiveLock_t LockExclusive() const;
+
+	/**
+	*	Applies changes that were made to watched search paths outside of the filesystem to the path index.
+	*	Cheap if nothing changed. Must be called without holding the search path lock.
+	*/
+	void ProcessDirectoryChanges();
+
+	/**
+	*	Starts or stops watching all loose search paths. Must be called with the exclusive lock held.
+	*/
+	void SetWatchingSearchPaths( const bool bWatch );
+
+	/**
+	*	Finds where the data for the given file is stored, for reading off the main thread.
+	*	@param[ out ] ppStats Optional. Receives the counters of the search path the file was found in.
+	*	@return Whether the file exists.
+	*/
+	bool LocateFileData( const char* pszFileName, const char* pszPathID, CAsyncReader::Source_t& source, CFileSystemStats::PathCounters_t** ppStats = nullptr );
+
+	/**
+	*	Finds where the data for the given file is stored using the current snapshot, without taking the search path lock.
+	*	@param[ out ] bFound Whether the file exists.
+	*	@return Whether the snapshot could tell. If not, the file has to be looked up with the lock held.
+	*/
+	bool LocateFileDataInSnapshot( const char* pszFileName, const char* pszPathID, CAsyncReader::Source_t& source, 
+								   CFileSystemStats::PathCounters_t** ppStats, bool& bFound );
+
+	/**
+	*	Points a source at a pack file entry's data.
+	*/
+	void SetPackSource( const CSearchPath& searchPath, const CPackFileEntry& entry, CAsyncReader::Source_t& source );
+
+	/**
+	*	Parses a list of resources to prefetch. Names are separated by semicolons, commas or newlines.
+	*	Names of resource list files (.lst) are replaced with the resources in their manifests.
+	*	@param pszList List to parse.
+	*	@param sources Receives the files that were found.
+	*/
+	void ParseResourceList( const char* pszList, std::vector<CAsyncReader::Source_t>& sources );
+
+	/**
+	*	Gets the resources of a resource list file from its manifest, compiling the manifest if it's missing or out of date.
+	*	@param bCompile Whether to compile the manifest even if it's up to date.
+	*	@param[ out ] manifest Receives the manifest.
+	*	@return Whether the resource list was found.
+	*/
+	bool LoadResourceManifest( const char* pszListName, const bool bCompile, CResourceManifest& manifest );
+
+	/**
+	*	Resolves the resources named in a resource list file's contents, one per line, against the search paths.
+	*/
+	void CompileResourceManifest( const std::string& szList, CResourceManifest& manifest );
+
+	/**
+	*	@return Hash of a resource list file's contents and the search paths it would be resolved against.
+	*/
+	uint32_t GetResourceListHash( const std::string& szList );
+
+	/**
+	*	Points sources at the data of a manifest's resources. Pack files that are no longer mounted are skipped.
+	*/
+	void AddManifestSources( const CResourceManifest& manifest, std::vector<CAsyncReader::Source_t>& sources );
+
+	/**
+	*	@return Relative path of the manifest file for the given resource list.
+	*/
+	static std::string GetResourceManifestPath( const char* pszListName );
+
+	/**
+	*	Reads a whole file from the search paths.
+	*	@return Whether the file was read.
+	*/
+	bool ReadWholeFile( const char* pszFileName, std::vector<uint8_t>& data );
+
+	/**
+	*	@return Relative path of the load trace file for the given level.
+	*/
+	static std::string GetLoadTracePath( const char* pszLevelName );
+
+	/**
+	*	Prefetches the data read by a previous load of the given level, if it was traced.
+	*/
+	void ReplayLoadTrace( const char* pszLevelName );
 
 private:
 	SearchPaths_t m_SearchPaths;
-	OpenedFiles_t m_OpenedFiles;
-	FindFiles_t m_FindFiles;
+
+	/**
+	*	Incremented whenever search paths are removed, so searches that were going through them can tell.
+	*/
+	uint32_t m_uiSearchPathGeneration = 0;
+
+	/**
+	*	Interned path IDs of the search paths.
+	*/
+	CPathIDTable m_PathIDs;
+
+	/**
+	*	All search paths, and the search paths of each interned path ID, indexed by ID.
+	*	Queries with a path ID only walk the search paths in its bucket.
+	*/
+	SearchPathList_t m_AllSearchPaths;
+	std::vector<SearchPathList_t> m_SearchPathBuckets;
+
+	/**
+	*	Paths of the search paths, for converting full paths to relative paths.
+	*/
+	CPathPrefixTable m_PathPrefixes;
+
+	/**
+	*	Reads ahead for pack entries that are streamed directly. Destroyed after the opened files, since their streams use it.
+	*/
+	CDirectStreamer m_DirectStreamer;
+
+	CFileHandleTable m_OpenedFiles;
+
+	CReadBufferPool m_ReadBufferPool;
+
+	CContentCache m_ContentCache;
+
+	CBlockCache m_BlockCache;
+
+	CPathIndex m_PathIndex;
+
+	CNegativeLookupCache m_NegativeCache;
+
+	CDescriptorCache m_DescriptorCache;
+
+	CMetadataCache m_MetadataCache;
+
+	CFileSystemStats m_Stats;
+
+	CAccessAudit m_AccessAudit;
+
+	CAsyncReader m_AsyncReader;
+
+	/**
+	*	Writes the data of files that use write-behind. Destroyed before the opened files, so everything is written before they're closed.
+	*/
+	CAsyncWriter m_AsyncWriter;
+
+	CPrefetcher m_Prefetcher;
+
+	/**
+	*	Where streaming pack files are installed from.
+	*/
+	FileContentSource_t m_ContentSource;
+
+	CStreamingInstaller m_StreamingInstaller;
+
+	CDirectoryWatcher m_DirectoryWatcher;
+
+	CLoadTrace m_LoadTrace;
+
+	CPackVerifier m_PackVerifier;
+
+	CMountIndexCache m_MountIndexCache;
+
+	/**
+	*	Snapshot of the search paths for lock free lookups, or null if they're not used.
+	*	Only replaced with std::atomic_store while holding the exclusive lock; lookups read it with std::atomic_load.
+	*/
+	std::shared_ptr<CSearchPathSnapshot> m_Snapshot;
+
+	/**
+	*	Prefetch group for the load trace that is being replayed.
+	*/
+	CPrefetcher::GroupHandle_t m_hReplayGroup = CPrefetcher::INVALID_GROUP;
 
 	FileSystemWarningFunc m_WarningFunc = nullptr;
 
 	FileWarningLevel_t m_WarningLevel = FileWarningLevel_t::FILESYSTEM_WARNING_REPORTUNCLOSED;
 
+	FileSystemOptions_t m_Options = FileSystemOption::NONE;
+
+	/**
+	*	Pack entries at least this large are streamed directly. 0 if direct streaming is disabled.
+	*/
+	uint64_t m_uiDirectStreamingThreshold = 0;
+
+	/**
+	*	Guards the search paths and the path index in thread safe mode.
+	*/
+	mutable std::shared_timed_mutex m_SearchPathMutex;
+
 private:
 	CFileSystem( const CFileSystem& ) = delete;
 	CFileSystem& operator=( const CFileSystem& ) = delete;
@@ -3,6 +3,8 @@
 *	Method definitions for obsolete API features.
 */
 
+#include "Logging.h"
+
 #include "CFileSystem.h"
 
 void CFileSystem::Mount()
@@ -12,81 +14,23 @@ void CFileSystem::Mount()
 
 void CFileSystem::Unmount()
 {
-	//Nothing
-}
-
-void *CFileSystem::GetReadBuffer( FileHandle_t file, int *outBufferSize, bool failIfNotInCache )
-{
-	*outBufferSize = 0;
-
-	return nullptr;
-}
-
-void CFileSystem::ReleaseReadBuffer( FileHandle_t file, void *readBuffer )
-{
-	//Nothing
-}
-
-void CFileSystem::GetLocalCopy( const char *pFileName )
-{
-	//Nothing
-}
-
-void CFileSystem::LogLevelLoadStarted( const char *name )
-{
-	//Nothing
-}
-
-void CFileSystem::LogLevelLoadFinished( const char *name )
-{
-	//Nothing
-}
-
-int CFileSystem::HintResourceNeed( const char *hintlist, int forgetEverything )
-{
-	//Nothing
-	return 0;
-}
+	//Stop worker threads now, before the library is unloaded.
+	m_Prefetcher.Shutdown();
+	m_AsyncReader.Shutdown();
+	m_StreamingInstaller.Shutdown();
 
-int CFileSystem::PauseResourcePreloading()
-{
-	//Nothing
-	return 0;
-}
+	{
+		auto lock = LockExclusive();
 
-int CFileSystem::ResumeResourcePreloading()
-{
-	//Nothing
-	return 0;
-}
+		SetWatchingSearchPaths( false );
 
-bool CFileSystem::IsFileImmediatelyAvailable( const char *pFileName )
-{
-	return true;
-}
+		SaveMountIndex();
+	}
 
-WaitForResourcesHandle_t CFileSystem::WaitForResources( const char *resourcelist )
-{
-	return 0;
+	Log_Shutdown();
 }
 
-bool CFileSystem::GetWaitForResourcesProgress( WaitForResourcesHandle_t handle, float *progress /* out */, bool *complete /* out */ )
-{
-	if( progress )
-		*progress = 0;
-
-	if( complete )
-		*complete = true;
-
-	return false;
-}
-
-void CFileSystem::CancelWaitForResources( WaitForResourcesHandle_t handle )
+void CFileSystem::GetLocalCopy( const char *pFileName )
 {
 	//Nothing
 }
-
-bool CFileSystem::IsAppReadyForOfflinePlay( int appID )
-{
-	return true;
-}
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cstring>
+
+#include "Clock.h"
+
+#include "CFileSystemStats.h"
+
+uint64_t CFileSystemStats::GetTime()
+{
+	return Plat_GetMicroseconds();
+}
+
+CFileSystemStats::PathCounters_t& CFileSystemStats::GetPathCounters( const char* pszPath, const char* pszPathID )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	const char* const pszID = pszPathID ? pszPathID : "";
+
+	for( auto& counters : m_Paths )
+	{
+		if( counters.szPath == pszPath && counters.szPathID == pszID )
+			return counters;
+	}
+
+	m_Paths.emplace_back( pszPath, pszPathID );
+
+	return m_Paths.back();
+}
+
+void CFileSystemStats::AddFile( const std::string& szFileName, uint64_t uiTime, uint64_t uiBytesRead )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_SlowFiles.size() >= MAX_SLOW_FILES && m_SlowFiles.back().uiTime >= uiTime )
+		return;
+
+	auto it = std::upper_bound( m_SlowFiles.begin(), m_SlowFiles.end(), uiTime, []( uint64_t uiTime, const SlowFile_t& file )
+	{
+		return uiTime > file.uiTime;
+	} );
+
+	m_SlowFiles.insert( it, { szFileName, uiTime, uiBytesRead } );
+
+	if( m_SlowFiles.size() > MAX_SLOW_FILES )
+		m_SlowFiles.pop_back();
+}
+
+void CFileSystemStats::GetStats( FileSystemStats_t& stats ) const
+{
+	memset( &stats, 0, sizeof( stats ) );
+
+	stats.uiMisses = m_uiMisses.load( std::memory_order_relaxed );
+	stats.uiSharedBytes = m_uiSharedBytes.load( std::memory_order_relaxed );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	for( const auto& counters : m_Paths )
+	{
+		stats.uiOpens += counters.uiOpens.load( std::memory_order_relaxed );
+		stats.uiReads += counters.uiReads.load( std::memory_order_relaxed );
+		stats.uiBytesRead += counters.uiBytesRead.load( std::memory_order_relaxed );
+		stats.uiSeeks += counters.uiSeeks.load( std::memory_order_relaxed );
+		stats.uiTime += counters.uiTime.load( std::memory_order_relaxed );
+	}
+}
+
+size_t CFileSystemStats::GetSearchPathStats( FileSystemPathStats_t* pStats, size_t uiMaxCount ) const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( pStats )
+	{
+		const auto uiCount = std::min( uiMaxCount, m_Paths.size() );
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			const auto& counters = m_Paths[ uiIndex ];
+			auto& stats = pStats[ uiIndex ];
+
+			strncpy( stats.szPath, counters.szPath.c_str(), sizeof( stats.szPath ) );
+			stats.szPath[ sizeof( stats.szPath ) - 1 ] = '\0';
+
+			strncpy( stats.szPathID, counters.szPathID.c_str(), sizeof( stats.szPathID ) );
+			stats.szPathID[ sizeof( stats.szPathID ) - 1 ] = '\0';
+
+			stats.uiOpens = counters.uiOpens.load( std::memory_order_relaxed );
+			stats.uiReads = counters.uiReads.load( std::memory_order_relaxed );
+			stats.uiBytesRead = counters.uiBytesRead.load( std::memory_order_relaxed );
+			stats.uiSeeks = counters.uiSeeks.load( std::memory_order_relaxed );
+			stats.uiTime = counters.uiTime.load( std::memory_order_relaxed );
+		}
+	}
+
+	return m_Paths.size();
+}
+
+size_t CFileSystemStats::GetSlowestFiles( FileSystemFileStats_t* pFiles, size_t uiMaxCount ) const
+{
+	if( !pFiles )
+		return 0;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	const auto uiCount = std::min( uiMaxCount, m_SlowFiles.size() );
+
+	for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+	{
+		const auto& file = m_SlowFiles[ uiIndex ];
+		auto& stats = pFiles[ uiIndex ];
+
+		strncpy( stats.szFileName, file.szFileName.c_str(), sizeof( stats.szFileName ) );
+		stats.szFileName[ sizeof( stats.szFileName ) - 1 ] = '\0';
+
+		stats.uiTime = file.uiTime;
+		stats.uiBytesRead = file.uiBytesRead;
+	}
+
+	return uiCount;
+}
+
+void CFileSystemStats::Reset()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	//Search paths still reference their counters, so only zero them.
+	for( auto& counters : m_Paths )
+	{
+		counters.uiOpens = 0;
+		counters.uiReads = 0;
+		counters.uiBytesRead = 0;
+		counters.uiSeeks = 0;
+		counters.uiTime = 0;
+	}
+
+	m_uiMisses = 0;
+	m_uiSharedBytes = 0;
+
+	m_SlowFiles.clear();
+}
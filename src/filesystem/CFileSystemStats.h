@@ -0,0 +1,117 @@
+#ifndef FILESYSTEM_CFILESYSTEMSTATS_H
+#define FILESYSTEM_CFILESYSTEMSTATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "FileSystem2.h"
+
+/**
+*	I/O counters for the filesystem.
+*	Counters are kept per search path; totals and per path ID counters are computed from them when queried.
+*/
+class CFileSystemStats
+{
+public:
+	/**
+	*	Number of slowest files to keep track of.
+	*/
+	static const size_t MAX_SLOW_FILES = 16;
+
+	/**
+	*	Counters for one search path. Updated without locking.
+	*/
+	struct PathCounters_t
+	{
+		PathCounters_t( const char* pszPath, const char* pszPathID )
+			: szPath( pszPath )
+			, szPathID( pszPathID ? pszPathID : "" )
+		{
+		}
+
+		const std::string szPath;
+		const std::string szPathID;
+
+		std::atomic<uint64_t> uiOpens{ 0 };
+		std::atomic<uint64_t> uiReads{ 0 };
+		std::atomic<uint64_t> uiBytesRead{ 0 };
+		std::atomic<uint64_t> uiSeeks{ 0 };
+		std::atomic<uint64_t> uiTime{ 0 };
+	};
+
+public:
+	CFileSystemStats() = default;
+
+	/**
+	*	@return Current time in microseconds, for measuring durations.
+	*/
+	static uint64_t GetTime();
+
+	/**
+	*	Gets the counters for a search path, creating them if needed.
+	*	The counters exist for as long as this object does; search paths that are added again reuse their counters.
+	*/
+	PathCounters_t& GetPathCounters( const char* pszPath, const char* pszPathID );
+
+	void AddMiss() { m_uiMisses.fetch_add( 1, std::memory_order_relaxed ); }
+
+	void AddSharedBytes( uint64_t uiBytes ) { m_uiSharedBytes.fetch_add( uiBytes, std::memory_order_relaxed ); }
+
+	/**
+	*	Records the cost of a file that was closed.
+	*/
+	void AddFile( const std::string& szFileName, uint64_t uiTime, uint64_t uiBytesRead );
+
+	void GetStats( FileSystemStats_t& stats ) const;
+
+	/**
+	*	@see IFileSystem2::GetSearchPathStats
+	*/
+	size_t GetSearchPathStats( FileSystemPathStats_t* pStats, size_t uiMaxCount ) const;
+
+	/**
+	*	@see IFileSystem2::GetSlowestFiles
+	*/
+	size_t GetSlowestFiles( FileSystemFileStats_t* pFiles, size_t uiMaxCount ) const;
+
+	/**
+	*	Resets all counters.
+	*/
+	void Reset();
+
+private:
+	struct SlowFile_t
+	{
+		std::string szFileName;
+		uint64_t uiTime;
+		uint64_t uiBytesRead;
+	};
+
+private:
+	mutable std::mutex m_Mutex;
+
+	/**
+	*	Deque so counters never move once they're handed out.
+	*/
+	std::deque<PathCounters_t> m_Paths;
+
+	std::atomic<uint64_t> m_uiMisses{ 0 };
+
+	std::atomic<uint64_t> m_uiSharedBytes{ 0 };
+
+	/**
+	*	Slowest files, slowest first.
+	*/
+	std::vector<SlowFile_t> m_SlowFiles;
+
+private:
+	CFileSystemStats( const CFileSystemStats& ) = delete;
+	CFileSystemStats& operator=( const CFileSystemStats& ) = delete;
+};
+
+#endif //FILESYSTEM_CFILESYSTEMSTATS_H
@@ -0,0 +1,336 @@
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "ByteSwap.h"
+
+#include "CPathIndex.h"
+
+#include "CLoadTrace.h"
+
+namespace
+{
+template<typename T>
+void WriteValue( std::vector<uint8_t>& data, T value )
+{
+	value = LittleValue( value );
+
+	const auto pBytes = reinterpret_cast<const uint8_t*>( &value );
+
+	data.insert( data.end(), pBytes, pBytes + sizeof( T ) );
+}
+
+/**
+*	Reads values from a trace file, checking that there is enough data left.
+*/
+class CTraceReader final
+{
+public:
+	CTraceReader( const uint8_t* pData, size_t uiSize )
+		: m_pData( pData )
+		, m_uiSize( uiSize )
+	{
+	}
+
+	template<typename T>
+	bool Read( T& value )
+	{
+		if( m_uiSize - m_uiOffset < sizeof( T ) )
+			return false;
+
+		memcpy( &value, m_pData + m_uiOffset, sizeof( T ) );
+
+		m_uiOffset += sizeof( T );
+
+		value = LittleValue( value );
+
+		return true;
+	}
+
+	bool ReadString( std::string& szString, size_t uiLength )
+	{
+		if( m_uiSize - m_uiOffset < uiLength )
+			return false;
+
+		szString.assign( reinterpret_cast<const char*>( m_pData + m_uiOffset ), uiLength );
+
+		m_uiOffset += uiLength;
+
+		return true;
+	}
+
+private:
+	const uint8_t* const m_pData;
+	const size_t m_uiSize;
+
+	size_t m_uiOffset = 0;
+};
+}
+
+void CLoadTrace::Start()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	Clear();
+
+	m_StartTime = std::chrono::steady_clock::now();
+
+	m_bRecording = true;
+}
+
+void CLoadTrace::Stop()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_bRecording = false;
+
+	m_OpenFiles.clear();
+}
+
+size_t CLoadTrace::GetEventCount() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_Events.size();
+}
+
+void CLoadTrace::RecordOpen( FileHandle_t hFile, const char* pszFileName )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( !m_bRecording )
+		return;
+
+	const auto uiFile = GetFileIndex( pszFileName );
+
+	m_OpenFiles[ hFile ] = uiFile;
+
+	AddEvent( EventType::OPEN, uiFile, 0, 0 );
+}
+
+void CLoadTrace::RecordRead( FileHandle_t hFile, uint64_t uiOffset, uint64_t uiLength )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( !m_bRecording )
+		return;
+
+	auto it = m_OpenFiles.find( hFile );
+
+	//Opened before the trace started.
+	if( it == m_OpenFiles.end() )
+		return;
+
+	AddEvent( EventType::READ, it->second, uiOffset, uiLength );
+}
+
+void CLoadTrace::RecordClose( FileHandle_t hFile )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_OpenFiles.find( hFile );
+
+	if( it == m_OpenFiles.end() )
+		return;
+
+	if( m_bRecording )
+		AddEvent( EventType::CLOSE, it->second, 0, 0 );
+
+	m_OpenFiles.erase( it );
+}
+
+void CLoadTrace::RecordLoad( const char* pszFileName, uint64_t uiLength )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( !m_bRecording )
+		return;
+
+	const auto uiFile = GetFileIndex( pszFileName );
+
+	AddEvent( EventType::OPEN, uiFile, 0, 0 );
+	AddEvent( EventType::READ, uiFile, 0, uiLength );
+	AddEvent( EventType::CLOSE, uiFile, 0, 0 );
+}
+
+void CLoadTrace::Serialize( std::vector<uint8_t>& data ) const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	data.clear();
+
+	WriteValue( data, FILE_ID );
+	WriteValue( data, FILE_VERSION );
+
+	WriteValue( data, static_cast<uint32_t>( m_FileNames.size() ) );
+
+	for( const auto& szFileName : m_FileNames )
+	{
+		WriteValue( data, static_cast<uint16_t>( szFileName.length() ) );
+
+		data.insert( data.end(), szFileName.begin(), szFileName.end() );
+	}
+
+	WriteValue( data, static_cast<uint32_t>( m_Events.size() ) );
+
+	for( const auto& event : m_Events )
+	{
+		WriteValue( data, static_cast<uint8_t>( event.type ) );
+		WriteValue( data, event.uiThread );
+		WriteValue( data, event.uiFile );
+		WriteValue( data, event.uiTime );
+		WriteValue( data, event.uiOffset );
+		WriteValue( data, event.uiLength );
+	}
+}
+
+bool CLoadTrace::Deserialize( const uint8_t* pData, size_t uiSize )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_bRecording = false;
+
+	Clear();
+
+	if( !pData )
+		return false;
+
+	CTraceReader reader( pData, uiSize );
+
+	uint32_t uiID, uiVersion, uiFileCount;
+
+	if( !reader.Read( uiID ) || uiID != FILE_ID ||
+		!reader.Read( uiVersion ) || uiVersion < MIN_FILE_VERSION || uiVersion > FILE_VERSION ||
+		!reader.Read( uiFileCount ) )
+		return false;
+
+	m_FileNames.resize( uiFileCount );
+
+	for( auto& szFileName : m_FileNames )
+	{
+		uint16_t uiLength;
+
+		if( !reader.Read( uiLength ) || !reader.ReadString( szFileName, uiLength ) )
+		{
+			Clear();
+			return false;
+		}
+	}
+
+	uint32_t uiEventCount;
+
+	if( !reader.Read( uiEventCount ) )
+	{
+		Clear();
+		return false;
+	}
+
+	m_Events.reserve( uiEventCount );
+
+	for( uint32_t uiIndex = 0; uiIndex < uiEventCount; ++uiIndex )
+	{
+		uint8_t uiType;
+		Event_t event;
+
+		if( !reader.Read( uiType ) ||
+			!reader.Read( event.uiThread ) ||
+			!reader.Read( event.uiFile ) ||
+			!reader.Read( event.uiTime ) ||
+			!reader.Read( event.uiOffset ) ||
+			!reader.Read( event.uiLength ) ||
+			uiType > static_cast<uint8_t>( EventType::CLOSE ) ||
+			event.uiFile >= uiFileCount )
+		{
+			Clear();
+			return false;
+		}
+
+		event.type = static_cast<EventType>( uiType );
+
+		m_Events.emplace_back( event );
+	}
+
+	return true;
+}
+
+void CLoadTrace::GetSchedule( std::vector<ScheduleEntry_t>& schedule ) const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	schedule.clear();
+
+	//Index into the schedule for each file, or -1 if it hasn't been read yet.
+	std::vector<size_t> entries( m_FileNames.size(), static_cast<size_t>( -1 ) );
+
+	for( const auto& event : m_Events )
+	{
+		if( event.type != EventType::READ || event.uiLength == 0 )
+			continue;
+
+		auto& uiEntry = entries[ event.uiFile ];
+
+		if( uiEntry == static_cast<size_t>( -1 ) )
+		{
+			uiEntry = schedule.size();
+
+			schedule.push_back( { m_FileNames[ event.uiFile ], event.uiOffset, event.uiLength } );
+
+			continue;
+		}
+
+		auto& entry = schedule[ uiEntry ];
+
+		const auto uiEnd = std::max( entry.uiOffset + entry.uiLength, event.uiOffset + event.uiLength );
+
+		entry.uiOffset = std::min( entry.uiOffset, event.uiOffset );
+		entry.uiLength = uiEnd - entry.uiOffset;
+	}
+}
+
+void CLoadTrace::GetEvents( std::vector<Event_t>& events, std::vector<std::string>& fileNames ) const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	events = m_Events;
+	fileNames = m_FileNames;
+}
+
+void CLoadTrace::AddEvent( EventType type, uint32_t uiFile, uint64_t uiOffset, uint64_t uiLength )
+{
+	const auto threadID = std::this_thread::get_id();
+
+	auto it = std::find( m_Threads.begin(), m_Threads.end(), threadID );
+
+	if( it == m_Threads.end() )
+		it = m_Threads.insert( m_Threads.end(), threadID );
+
+	Event_t event;
+
+	event.type = type;
+	event.uiThread = static_cast<uint16_t>( it - m_Threads.begin() );
+	event.uiFile = uiFile;
+	event.uiTime = static_cast<uint64_t>( std::chrono::duration_cast<std::chrono::microseconds>( std::chrono::steady_clock::now() - m_StartTime ).count() );
+	event.uiOffset = uiOffset;
+	event.uiLength = static_cast<uint32_t>( std::min<uint64_t>( uiLength, std::numeric_limits<uint32_t>::max() ) );
+
+	m_Events.emplace_back( event );
+}
+
+uint32_t CLoadTrace::GetFileIndex( const char* pszFileName )
+{
+	auto result = m_FileIndices.emplace( CPathIndex::NormalizeKey( pszFileName ), static_cast<uint32_t>( m_FileNames.size() ) );
+
+	if( result.second )
+		m_FileNames.emplace_back( result.first->first );
+
+	return result.first->second;
+}
+
+void CLoadTrace::Clear()
+{
+	m_FileNames.clear();
+	m_FileIndices.clear();
+	m_OpenFiles.clear();
+	m_Threads.clear();
+	m_Events.clear();
+}
@@ -0,0 +1,172 @@
+#ifndef FILESYSTEM_CLOADTRACE_H
+#define FILESYSTEM_CLOADTRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "FileSystem.h"
+
+/**
+*	Records the files that are opened and read during a level load.
+*	The trace is saved per level and used to prefetch the same data the next time the level is loaded.
+*/
+class CLoadTrace
+{
+public:
+	/**
+	*	Identifies trace files. Stored as the first 4 bytes.
+	*/
+	static const uint32_t FILE_ID = ( 'T' << 24 ) | ( 'L' << 16 ) | ( 'S' << 8 ) | 'F';
+
+	static const uint32_t FILE_VERSION = 2;
+
+	/**
+	*	Oldest version that can still be read. Version 1 traces have no close events.
+	*/
+	static const uint32_t MIN_FILE_VERSION = 1;
+
+	enum class EventType : uint8_t
+	{
+		OPEN = 0,
+		READ,
+		CLOSE
+	};
+
+	struct Event_t
+	{
+		EventType type;
+
+		/**
+		*	Index of the thread that caused the event, in order of first appearance.
+		*/
+		uint16_t uiThread;
+
+		/**
+		*	Index of the file name.
+		*/
+		uint32_t uiFile;
+
+		/**
+		*	Time since the trace was started, in microseconds.
+		*/
+		uint64_t uiTime;
+
+		uint64_t uiOffset;
+		uint32_t uiLength;
+	};
+
+	/**
+	*	A part of a file that should be prefetched.
+	*/
+	struct ScheduleEntry_t
+	{
+		std::string szFileName;
+		uint64_t uiOffset;
+		uint64_t uiLength;
+	};
+
+public:
+	CLoadTrace() = default;
+
+	bool IsRecording() const { return m_bRecording.load( std::memory_order_relaxed ); }
+
+	/**
+	*	Discards the current trace and starts recording a new one.
+	*/
+	void Start();
+
+	/**
+	*	Stops recording. The trace is kept until the next call to Start or Deserialize.
+	*/
+	void Stop();
+
+	size_t GetEventCount() const;
+
+	/**
+	*	Records that a file was opened for reading.
+	*/
+	void RecordOpen( FileHandle_t hFile, const char* pszFileName );
+
+	/**
+	*	Records a read from an opened file.
+	*/
+	void RecordRead( FileHandle_t hFile, uint64_t uiOffset, uint64_t uiLength );
+
+	/**
+	*	Records that a file was closed, if it was opened while recording. Later reads using the same handle are ignored.
+	*/
+	void RecordClose( FileHandle_t hFile );
+
+	/**
+	*	Records that a whole file was read without opening a handle to it, as an open, a read and a close.
+	*/
+	void RecordLoad( const char* pszFileName, uint64_t uiLength );
+
+	/**
+	*	Writes the trace in its file format.
+	*/
+	void Serialize( std::vector<uint8_t>& data ) const;
+
+	/**
+	*	Replaces the trace with one read from a trace file.
+	*	@return Whether the data was a valid trace.
+	*/
+	bool Deserialize( const uint8_t* pData, size_t uiSize );
+
+	/**
+	*	Gets the files that were read, in the order they were first read.
+	*	Each entry covers all reads from its file.
+	*/
+	void GetSchedule( std::vector<ScheduleEntry_t>& schedule ) const;
+
+	/**
+	*	Gets a copy of the recorded events, in the order they happened, and the file names they refer to.
+	*/
+	void GetEvents( std::vector<Event_t>& events, std::vector<std::string>& fileNames ) const;
+
+private:
+	/**
+	*	Must be called with the mutex held.
+	*/
+	void AddEvent( EventType type, uint32_t uiFile, uint64_t uiOffset, uint64_t uiLength );
+
+	/**
+	*	Gets the index of a file's name, adding it if needed. Must be called with the mutex held.
+	*/
+	uint32_t GetFileIndex( const char* pszFileName );
+
+	void Clear();
+
+private:
+	mutable std::mutex m_Mutex;
+
+	std::atomic<bool> m_bRecording{ false };
+
+	std::chrono::steady_clock::time_point m_StartTime;
+
+	std::vector<std::string> m_FileNames;
+
+	std::unordered_map<std::string, uint32_t> m_FileIndices;
+
+	/**
+	*	Maps open handles to file name indices.
+	*/
+	std::unordered_map<FileHandle_t, uint32_t> m_OpenFiles;
+
+	std::vector<std::thread::id> m_Threads;
+
+	std::vector<Event_t> m_Events;
+
+private:
+	CLoadTrace( const CLoadTrace& ) = delete;
+	CLoadTrace& operator=( const CLoadTrace& ) = delete;
+};
+
+#endif //FILESYSTEM_CLOADTRACE_H
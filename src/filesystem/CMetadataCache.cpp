@@ -0,0 +1,84 @@
+#include <algorithm>
+
+#include "CMetadataCache.h"
+
+const size_t CMetadataCache::DEFAULT_MAX_ENTRIES;
+
+void CMetadataCache::SetMaxEntries( const size_t uiMaxEntries )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_uiMaxEntries = uiMaxEntries;
+
+	Evict();
+}
+
+bool CMetadataCache::Find( const std::string& szFileName, Metadata_t& metadata ) const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_Entries.find( szFileName );
+
+	if( it == m_Entries.end() )
+		return false;
+
+	metadata = it->second;
+
+	return true;
+}
+
+void CMetadataCache::Insert( const std::string& szFileName, const Metadata_t& metadata )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_uiMaxEntries == 0 )
+		return;
+
+	auto result = m_Entries.emplace( szFileName, metadata );
+
+	if( result.second )
+	{
+		m_InsertionOrder.emplace_back( szFileName );
+
+		Evict();
+	}
+	else
+	{
+		result.first->second = metadata;
+	}
+}
+
+void CMetadataCache::Invalidate( const std::string& szFileName )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Entries.erase( szFileName );
+}
+
+void CMetadataCache::InvalidateAll()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Entries.clear();
+	m_InsertionOrder.clear();
+}
+
+void CMetadataCache::Evict()
+{
+	while( m_Entries.size() > m_uiMaxEntries && !m_InsertionOrder.empty() )
+	{
+		m_Entries.erase( m_InsertionOrder.front() );
+		m_InsertionOrder.pop_front();
+	}
+
+	//Drop names that were invalidated so the queue doesn't grow without bound.
+	if( m_InsertionOrder.size() > m_uiMaxEntries * 2 )
+	{
+		m_InsertionOrder.erase( std::remove_if( m_InsertionOrder.begin(), m_InsertionOrder.end(), 
+			[ this ]( const std::string& szFileName )
+			{
+				return m_Entries.find( szFileName ) == m_Entries.end();
+			}
+		), m_InsertionOrder.end() );
+	}
+}
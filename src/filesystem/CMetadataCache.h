@@ -0,0 +1,105 @@
+#ifndef FILESYSTEM_CMETADATACACHE_H
+#define FILESYSTEM_CMETADATACACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+*	Bounded cache of the size and modification time of loose files, keyed on full path.
+*	Lets repeated size and time queries skip the stat calls.
+*	Only used for watched search paths, since changes made outside of the filesystem have to invalidate it. The cache is synchronized.
+*/
+class CMetadataCache
+{
+public:
+	/**
+	*	Default maximum number of files to cache.
+	*/
+	static const size_t DEFAULT_MAX_ENTRIES = 8192;
+
+	struct Metadata_t
+	{
+		uint64_t uiSize;
+
+		/**
+		*	Modification time, in seconds.
+		*/
+		int64_t iModifiedTime;
+	};
+
+public:
+	CMetadataCache() = default;
+
+	size_t GetMaxEntries() const
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		return m_uiMaxEntries;
+	}
+
+	/**
+	*	Sets the maximum number of files to cache. Evicts the oldest files if needed.
+	*/
+	void SetMaxEntries( const size_t uiMaxEntries );
+
+	/**
+	*	@return Number of files in the cache.
+	*/
+	size_t GetEntryCount() const
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		return m_Entries.size();
+	}
+
+	/**
+	*	@param szFileName Full path of the file.
+	*	@param[ out ] metadata If the file is cached, its metadata.
+	*	@return Whether the file is cached.
+	*/
+	bool Find( const std::string& szFileName, Metadata_t& metadata ) const;
+
+	/**
+	*	Caches the metadata of a file.
+	*	@param szFileName Full path of the file.
+	*/
+	void Insert( const std::string& szFileName, const Metadata_t& metadata );
+
+	/**
+	*	Forgets the given file. Used when the file may have changed.
+	*/
+	void Invalidate( const std::string& szFileName );
+
+	/**
+	*	Forgets all files. Used when search paths are removed, or changes may have been missed.
+	*/
+	void InvalidateAll();
+
+private:
+	/**
+	*	Must be called with the mutex held.
+	*/
+	void Evict();
+
+private:
+	mutable std::mutex m_Mutex;
+
+	std::unordered_map<std::string, Metadata_t> m_Entries;
+
+	/**
+	*	File names in insertion order, used for eviction. May contain names that were already invalidated.
+	*/
+	std::deque<std::string> m_InsertionOrder;
+
+	size_t m_uiMaxEntries = DEFAULT_MAX_ENTRIES;
+
+private:
+	CMetadataCache( const CMetadataCache& ) = delete;
+	CMetadataCache& operator=( const CMetadataCache& ) = delete;
+};
+
+#endif //FILESYSTEM_CMETADATACACHE_H
@@ -0,0 +1,249 @@
+#include <cstring>
+#include <experimental/filesystem>
+#include <unordered_set>
+
+#include "Platform.h"
+
+#include "CPackDirectory.h"
+#include "CSearchPath.h"
+
+#include "CMountIndexCache.h"
+
+namespace fs = std::experimental::filesystem;
+
+const char* const CMountIndexCache::CACHE_FILE_NAME = "mountindex.cache";
+
+const uint32_t CMountIndexCache::VERSION;
+
+namespace
+{
+const char MOUNT_INDEX_IDENTIFIER[ 4 ] = { 'G', 'S', 'M', 'I' };
+}
+
+bool CMountIndexCache::GetKey( const char* pszFileName, const int64_t iOffset, Key_t& key )
+{
+	key = Key_t();
+
+	std::error_code error;
+
+	key.uiSize = static_cast<uint64_t>( fs::file_size( pszFileName, error ) );
+
+	if( error )
+		return false;
+
+	key.iModifiedTime = static_cast<int64_t>( fs::last_write_time( pszFileName, error ).time_since_epoch().count() );
+
+	if( error )
+		return false;
+
+	key.iOffset = iOffset;
+	key.bValid = true;
+
+	return true;
+}
+
+bool CMountIndexCache::Find( const char* pszFileName, const Key_t& key, CPackDirectory& directory, uint32_t& uiBlockSize )
+{
+	if( !key.bValid )
+		return false;
+
+	Record_t record;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		Load();
+
+		auto it = m_Records.find( pszFileName );
+
+		if( it == m_Records.end() || !( it->second.key == key ) )
+		{
+			++m_uiMisses;
+			m_bChanged = true;
+			return false;
+		}
+
+		record = it->second;
+	}
+
+	//The mapping stays open until the cache is saved, which doesn't happen while pack files are being added.
+	if( !directory.Restore( record.pDirectory, record.uiDirectorySize ) )
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		++m_uiMisses;
+		m_bChanged = true;
+		return false;
+	}
+
+	uiBlockSize = record.uiBlockSize;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	++m_uiHits;
+
+	return true;
+}
+
+void CMountIndexCache::Save( const std::vector<const CSearchPath*>& packFiles )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	Load();
+
+	if( !m_bChanged )
+		return;
+
+	std::vector<uint8_t> data( sizeof( Header_t ) );
+
+	uint32_t uiRecords = 0;
+
+	std::unordered_set<std::string> savedFiles;
+
+	std::vector<uint8_t> directory;
+
+	for( auto pPackFile : packFiles )
+	{
+		if( !pPackFile->packKey.bValid || !savedFiles.insert( pPackFile->szPath ).second )
+			continue;
+
+		directory.clear();
+
+		pPackFile->packEntries.Save( directory );
+
+		AppendRecord( data, pPackFile->szPath, pPackFile->packKey, pPackFile->uiPackBlockSize, directory.data(), directory.size() );
+
+		++uiRecords;
+	}
+
+	//Keep pack files that aren't mounted right now, as long as they haven't changed.
+	for( const auto& record : m_Records )
+	{
+		if( savedFiles.find( record.first ) != savedFiles.end() )
+			continue;
+
+		Key_t key;
+
+		if( !GetKey( record.first.c_str(), record.second.key.iOffset, key ) || !( key == record.second.key ) )
+			continue;
+
+		AppendRecord( data, record.first, record.second.key, record.second.uiBlockSize, record.second.pDirectory, record.second.uiDirectorySize );
+
+		++uiRecords;
+	}
+
+	Header_t header;
+
+	memcpy( header.identifier, MOUNT_INDEX_IDENTIFIER, sizeof( header.identifier ) );
+	header.uiVersion = VERSION;
+	header.uiRecords = uiRecords;
+	header.uiPointerSize = static_cast<uint32_t>( sizeof( void* ) );
+
+	memcpy( data.data(), &header, sizeof( header ) );
+
+	//Everything was copied out of the mapping, and the file can't be replaced while it's mapped on some platforms.
+	m_Records.clear();
+	m_File.Close();
+
+	//The new file is mapped the next time a pack file is added.
+	m_bLoaded = false;
+	m_bChanged = false;
+
+	FILE* pFile = fopen64( CACHE_FILE_NAME, "wb" );
+
+	if( !pFile )
+		return;
+
+	const bool bSuccess = fwrite( data.data(), data.size(), 1, pFile ) == 1;
+
+	fclose( pFile );
+
+	//A partial file would fail to parse anyway, but don't leave it around.
+	if( !bSuccess )
+		remove( CACHE_FILE_NAME );
+}
+
+void CMountIndexCache::Load()
+{
+	if( m_bLoaded )
+		return;
+
+	m_bLoaded = true;
+
+	if( !m_File.Open( CACHE_FILE_NAME ) )
+		return;
+
+	const uint8_t* pData = m_File.GetData();
+
+	Header_t header;
+
+	if( !m_File.IsValidRange( 0, sizeof( header ) ) )
+	{
+		m_File.Close();
+		return;
+	}
+
+	memcpy( &header, pData, sizeof( header ) );
+
+	if( memcmp( header.identifier, MOUNT_INDEX_IDENTIFIER, sizeof( header.identifier ) ) != 0 || header.uiVersion != VERSION ||
+		header.uiPointerSize != sizeof( void* ) )
+	{
+		m_File.Close();
+		return;
+	}
+
+	uint64_t uiOffset = sizeof( header );
+
+	for( uint32_t uiIndex = 0; uiIndex < header.uiRecords; ++uiIndex )
+	{
+		RecordHeader_t recordHeader;
+
+		if( !m_File.IsValidRange( uiOffset, sizeof( recordHeader ) ) )
+			break;
+
+		memcpy( &recordHeader, pData + uiOffset, sizeof( recordHeader ) );
+
+		uiOffset += sizeof( recordHeader );
+
+		if( !m_File.IsValidRange( uiOffset, recordHeader.uiPathLength ) ||
+			!m_File.IsValidRange( uiOffset + recordHeader.uiPathLength, recordHeader.uiDirectorySize ) )
+			break;
+
+		std::string szFileName( reinterpret_cast<const char*>( pData + uiOffset ), recordHeader.uiPathLength );
+
+		uiOffset += recordHeader.uiPathLength;
+
+		Record_t record;
+
+		record.key.uiSize = recordHeader.uiSize;
+		record.key.iModifiedTime = recordHeader.iModifiedTime;
+		record.key.iOffset = recordHeader.iOffset;
+		record.key.bValid = true;
+		record.uiBlockSize = recordHeader.uiBlockSize;
+		record.pDirectory = pData + uiOffset;
+		record.uiDirectorySize = static_cast<size_t>( recordHeader.uiDirectorySize );
+
+		uiOffset += recordHeader.uiDirectorySize;
+
+		m_Records[ szFileName ] = record;
+	}
+}
+
+void CMountIndexCache::AppendRecord( std::vector<uint8_t>& data, const std::string& szFileName, const Key_t& key, const uint32_t uiBlockSize,
+									 const uint8_t* pDirectory, const size_t uiDirectorySize )
+{
+	RecordHeader_t header;
+
+	header.uiSize = key.uiSize;
+	header.iModifiedTime = key.iModifiedTime;
+	header.iOffset = key.iOffset;
+	header.uiDirectorySize = uiDirectorySize;
+	header.uiPathLength = static_cast<uint32_t>( szFileName.size() );
+	header.uiBlockSize = uiBlockSize;
+
+	auto pHeader = reinterpret_cast<const uint8_t*>( &header );
+
+	data.insert( data.end(), pHeader, pHeader + sizeof( header ) );
+	data.insert( data.end(), szFileName.begin(), szFileName.end() );
+	data.insert( data.end(), pDirectory, pDirectory + uiDirectorySize );
+}
@@ -0,0 +1,164 @@
+#ifndef FILESYSTEM_CMOUNTINDEXCACHE_H
+#define FILESYSTEM_CMOUNTINDEXCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "CMappedFile.h"
+
+class CPackDirectory;
+struct CSearchPath;
+
+/**
+*	Persists the finished directories of pack files between runs, so mounting a pack file that hasn't changed
+*	needs no header or directory reads, and no sorting or hashing of its entries.
+*	Pack files are identified by full path, size, modification time and the offset of the pack in the file.
+*	The cache file is memory mapped when it's first used, and directories are restored straight from the mapping.
+*	Pack files that changed are read as usual, and the cache is written again when it's saved.
+*	Loose search paths aren't cached; they can change without their directory's time changing, so they're always scanned.
+*/
+class CMountIndexCache
+{
+public:
+	/**
+	*	Name of the cache file, relative to the working directory.
+	*/
+	static const char* const CACHE_FILE_NAME;
+
+	static const uint32_t VERSION = 1;
+
+	/**
+	*	Identifies the contents of a pack file.
+	*/
+	struct Key_t
+	{
+		uint64_t uiSize = 0;
+		int64_t iModifiedTime = 0;
+
+		/**
+		*	Offset of the pack in the file. Non-zero for packs appended to other files.
+		*/
+		int64_t iOffset = 0;
+
+		bool bValid = false;
+
+		bool operator==( const Key_t& other ) const
+		{
+			return bValid && other.bValid && uiSize == other.uiSize && iModifiedTime == other.iModifiedTime && iOffset == other.iOffset;
+		}
+	};
+
+public:
+	CMountIndexCache() = default;
+
+	/**
+	*	Gets the key of a pack file as it is on disk.
+	*	@return Whether the pack file's size and time could be read.
+	*/
+	static bool GetKey( const char* pszFileName, const int64_t iOffset, Key_t& key );
+
+	/**
+	*	Restores the directory of a pack file if it's cached and hasn't changed. Can be called from multiple threads at once.
+	*	@param pszFileName Full path of the pack file.
+	*	@param key Key of the pack file as it is on disk.
+	*	@param[ out ] directory Empty directory to restore into.
+	*	@param[ out ] uiBlockSize Block size of a compressed pack file.
+	*	@return Whether the directory was restored.
+	*/
+	bool Find( const char* pszFileName, const Key_t& key, CPackDirectory& directory, uint32_t& uiBlockSize );
+
+	/**
+	*	Writes the cache file if any pack file was missing from it or had changed.
+	*	The given pack files are stored, along with previously cached pack files that are still unchanged on disk.
+	*	Loads the directories of the given pack files if they're still pending.
+	*/
+	void Save( const std::vector<const CSearchPath*>& packFiles );
+
+	size_t GetHitCount() const
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		return m_uiHits;
+	}
+
+	size_t GetMissCount() const
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		return m_uiMisses;
+	}
+
+private:
+	/**
+	*	Header of each cached pack file. Followed by the full path, and the saved directory. Records are read with copies, so they aren't aligned.
+	*/
+	struct RecordHeader_t
+	{
+		uint64_t uiSize;
+		int64_t iModifiedTime;
+		int64_t iOffset;
+		uint64_t uiDirectorySize;
+		uint32_t uiPathLength;
+		uint32_t uiBlockSize;
+	};
+
+	struct Header_t
+	{
+		char identifier[ 4 ];
+		uint32_t uiVersion;
+		uint32_t uiRecords;
+
+		/**
+		*	Size of a pointer, since saved directories use native types.
+		*/
+		uint32_t uiPointerSize;
+	};
+
+	struct Record_t
+	{
+		Key_t key;
+		uint32_t uiBlockSize;
+
+		const uint8_t* pDirectory;
+		size_t uiDirectorySize;
+	};
+
+private:
+	/**
+	*	Maps and parses the cache file if that hasn't been done yet. Must be called with the mutex held.
+	*/
+	void Load();
+
+	static void AppendRecord( std::vector<uint8_t>& data, const std::string& szFileName, const Key_t& key, const uint32_t uiBlockSize,
+							  const uint8_t* pDirectory, const size_t uiDirectorySize );
+
+private:
+	mutable std::mutex m_Mutex;
+
+	bool m_bLoaded = false;
+
+	/**
+	*	Whether a pack file was missing from the cache or had changed since it was cached.
+	*/
+	bool m_bChanged = false;
+
+	CMappedFile m_File;
+
+	/**
+	*	Cached pack files by full path. Directories point into the mapping.
+	*/
+	std::unordered_map<std::string, Record_t> m_Records;
+
+	size_t m_uiHits = 0;
+	size_t m_uiMisses = 0;
+
+private:
+	CMountIndexCache( const CMountIndexCache& ) = delete;
+	CMountIndexCache& operator=( const CMountIndexCache& ) = delete;
+};
+
+#endif //FILESYSTEM_CMOUNTINDEXCACHE_H
@@ -0,0 +1,109 @@
+#include <algorithm>
+
+#include "CNegativeLookupCache.h"
+
+void CNegativeLookupCache::SetMaxEntries( const size_t uiMaxEntries )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_uiMaxEntries = uiMaxEntries;
+
+	Evict();
+}
+
+bool CNegativeLookupCache::Contains( const std::string& szFileName, const char* pszPathID )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	++m_uiLookups;
+
+	auto it = m_Entries.find( szFileName );
+
+	if( it == m_Entries.end() )
+		return false;
+
+	//A miss for all search paths is also a miss for any one path ID.
+	for( const auto& szPathID : it->second.pathIDs )
+	{
+		if( szPathID.empty() || ( pszPathID && szPathID == pszPathID ) )
+		{
+			++m_uiHits;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void CNegativeLookupCache::Insert( const std::string& szFileName, const char* pszPathID )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_uiMaxEntries == 0 )
+		return;
+
+	auto result = m_Entries.emplace( szFileName, Entry_t{ PathIDs_t(), m_uiNextGeneration } );
+
+	auto& pathIDs = result.first->second.pathIDs;
+
+	const char* const pszID = pszPathID ? pszPathID : "";
+
+	if( std::find( pathIDs.begin(), pathIDs.end(), pszID ) == pathIDs.end() )
+		pathIDs.emplace_back( pszID );
+
+	if( result.second )
+	{
+		m_InsertionOrder.push_back( { szFileName, m_uiNextGeneration++ } );
+
+		Evict();
+	}
+}
+
+void CNegativeLookupCache::Invalidate( const std::string& szFileName )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( m_Entries.erase( szFileName ) )
+		++m_uiInvalidations;
+}
+
+void CNegativeLookupCache::InvalidateAll()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( !m_Entries.empty() )
+		++m_uiInvalidations;
+
+	m_Entries.clear();
+	m_InsertionOrder.clear();
+}
+
+bool CNegativeLookupCache::IsLive( const InsertedName_t& name ) const
+{
+	auto it = m_Entries.find( name.szFileName );
+
+	return it != m_Entries.end() && it->second.uiGeneration == name.uiGeneration;
+}
+
+void CNegativeLookupCache::Evict()
+{
+	while( m_Entries.size() > m_uiMaxEntries && !m_InsertionOrder.empty() )
+	{
+		//Names that were invalidated and inserted again are evicted by their newer record.
+		if( IsLive( m_InsertionOrder.front() ) )
+			m_Entries.erase( m_InsertionOrder.front().szFileName );
+
+		m_InsertionOrder.pop_front();
+	}
+
+	//Drop names that were invalidated so the queue doesn't grow without bound.
+	if( m_InsertionOrder.size() > m_uiMaxEntries * 2 )
+	{
+		m_InsertionOrder.erase( std::remove_if( m_InsertionOrder.begin(), m_InsertionOrder.end(), 
+			[ this ]( const InsertedName_t& name )
+			{
+				return !IsLive( name );
+			}
+		), m_InsertionOrder.end() );
+	}
+}
@@ -0,0 +1,151 @@
+#ifndef FILESYSTEM_CNEGATIVELOOKUPCACHE_H
+#define FILESYSTEM_CNEGATIVELOOKUPCACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+*	Bounded cache of file names that are known not to exist, keyed on file name and path ID.
+*	Lets repeated probes for missing files skip the search path walk.
+*	The cache is synchronized; it is only consulted after the path index misses, so this doesn't affect lookups of existing files.
+*/
+class CNegativeLookupCache
+{
+public:
+	/**
+	*	Default maximum number of file names to cache.
+	*/
+	static const size_t DEFAULT_MAX_ENTRIES = 4096;
+
+public:
+	CNegativeLookupCache() = default;
+
+	size_t GetMaxEntries() const
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		return m_uiMaxEntries;
+	}
+
+	/**
+	*	Sets the maximum number of file names to cache. Evicts the oldest names if needed.
+	*/
+	void SetMaxEntries( const size_t uiMaxEntries );
+
+	/**
+	*	@return Number of file names in the cache.
+	*/
+	size_t GetEntryCount() const
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		return m_Entries.size();
+	}
+
+	uint64_t GetLookupCount() const
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		return m_uiLookups;
+	}
+
+	uint64_t GetHitCount() const
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		return m_uiHits;
+	}
+
+	uint64_t GetInvalidationCount() const
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		return m_uiInvalidations;
+	}
+
+	/**
+	*	@param pszFileName Normalized file name.
+	*	@param pszPathID Path ID, or null if all search paths were checked.
+	*	@return Whether the file is known not to exist for the given path ID.
+	*/
+	bool Contains( const std::string& szFileName, const char* pszPathID );
+
+	/**
+	*	Records that a file doesn't exist for the given path ID.
+	*	@param pszFileName Normalized file name.
+	*	@param pszPathID Path ID, or null if all search paths were checked.
+	*/
+	void Insert( const std::string& szFileName, const char* pszPathID );
+
+	/**
+	*	Forgets the given file for all path IDs. Used when the file may have been created.
+	*/
+	void Invalidate( const std::string& szFileName );
+
+	/**
+	*	Forgets all files. Used when search paths are added.
+	*/
+	void InvalidateAll();
+
+private:
+	/**
+	*	Path IDs for which the file is missing. An empty string means all search paths.
+	*/
+	typedef std::vector<std::string> PathIDs_t;
+
+	struct Entry_t
+	{
+		PathIDs_t pathIDs;
+
+		/**
+		*	Distinguishes this entry from earlier entries for the same name that were invalidated.
+		*/
+		uint64_t uiGeneration;
+	};
+
+	struct InsertedName_t
+	{
+		std::string szFileName;
+		uint64_t uiGeneration;
+	};
+
+	/**
+	*	@return Whether the name's entry is still the one that was inserted.
+	*/
+	bool IsLive( const InsertedName_t& name ) const;
+
+	/**
+	*	Must be called with the mutex held.
+	*/
+	void Evict();
+
+private:
+	mutable std::mutex m_Mutex;
+
+	std::unordered_map<std::string, Entry_t> m_Entries;
+
+	/**
+	*	File names in insertion order, used for eviction. May contain names that were already invalidated,
+	*	including ones that were inserted again since; those have an older generation than their entry.
+	*/
+	std::deque<InsertedName_t> m_InsertionOrder;
+
+	uint64_t m_uiNextGeneration = 0;
+
+	size_t m_uiMaxEntries = DEFAULT_MAX_ENTRIES;
+
+	uint64_t m_uiLookups = 0;
+	uint64_t m_uiHits = 0;
+	uint64_t m_uiInvalidations = 0;
+
+private:
+	CNegativeLookupCache( const CNegativeLookupCache& ) = delete;
+	CNegativeLookupCache& operator=( const CNegativeLookupCache& ) = delete;
+};
+
+#endif //FILESYSTEM_CNEGATIVELOOKUPCACHE_H
@@ -0,0 +1,471 @@
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <numeric>
+
+#include "ByteSwap.h"
+
+#include "CPackDirectory.h"
+
+namespace
+{
+/**
+*	Compares file names, treating both separators as the same.
+*/
+bool PackNamesEqual( const char* pszLHS, const char* pszRHS )
+{
+	for( ; *pszLHS && *pszRHS; ++pszLHS, ++pszRHS )
+	{
+		const char lhs = *pszLHS == '\\' ? '/' : *pszLHS;
+		const char rhs = *pszRHS == '\\' ? '/' : *pszRHS;
+
+		if( lhs != rhs )
+			return false;
+	}
+
+	return *pszLHS == *pszRHS;
+}
+}
+
+void CPackDirectory::Reserve( const size_t uiEntries, const size_t uiNameBytes )
+{
+	m_Entries.reserve( uiEntries );
+	m_Names.reserve( uiNameBytes );
+}
+
+void CPackDirectory::AddEntry( const char* pszFileName, const size_t uiMaxLength, uint64_t uiStartOffset, uint64_t uiLength,
+							   uint64_t uiStoredLength, pack::Codec codec )
+{
+	const size_t uiNameLength = strnlen( pszFileName, uiMaxLength );
+
+	const size_t uiOffset = m_Names.size();
+
+	m_Names.insert( m_Names.end(), pszFileName, pszFileName + uiNameLength );
+	m_Names.push_back( '\0' );
+
+#ifdef WIN32
+	std::replace( m_Names.begin() + uiOffset, m_Names.end(), '/', '\\' );
+#else
+	std::replace( m_Names.begin() + uiOffset, m_Names.end(), '\\', '/' );
+#endif
+
+	//The name buffer can still grow, so store the offset until Finish is called.
+	m_Entries.emplace_back( nullptr, uiStartOffset, uiLength, uiStoredLength, codec );
+	m_NameOffsets.push_back( uiOffset );
+}
+
+void CPackDirectory::Finish()
+{
+	//Resolve name offsets now that the buffer won't be reallocated.
+	for( size_t uiIndex = 0; uiIndex < m_Entries.size(); ++uiIndex )
+	{
+		m_Entries[ uiIndex ].m_pszFileName = m_Names.data() + m_NameOffsets[ uiIndex ];
+	}
+
+	m_NameOffsets.clear();
+	m_NameOffsets.shrink_to_fit();
+
+	//Stable so the first of any duplicate names is kept.
+	std::stable_sort( m_Entries.begin(), m_Entries.end(), PackLess() );
+
+	m_Entries.erase( std::unique( m_Entries.begin(), m_Entries.end(), 
+		[]( const CPackFileEntry& lhs, const CPackFileEntry& rhs )
+		{
+			return strcmp( lhs.GetFileName(), rhs.GetFileName() ) == 0;
+		}
+	), m_Entries.end() );
+
+	m_Entries.shrink_to_fit();
+
+	m_Hashes.resize( m_Entries.size() );
+
+	//Keep the load factor at or below 50%.
+	size_t uiTableSize = 16;
+
+	while( uiTableSize < m_Entries.size() * 2 )
+		uiTableSize <<= 1;
+
+	m_Table.assign( uiTableSize, 0 );
+
+	const size_t uiMask = uiTableSize - 1;
+
+	for( size_t uiIndex = 0; uiIndex < m_Entries.size(); ++uiIndex )
+	{
+		const auto uiHash = HashName( m_Entries[ uiIndex ].GetFileName() );
+
+		m_Hashes[ uiIndex ] = uiHash;
+
+		size_t uiSlot = uiHash & uiMask;
+
+		while( m_Table[ uiSlot ] != 0 )
+			uiSlot = ( uiSlot + 1 ) & uiMask;
+
+		m_Table[ uiSlot ] = static_cast<uint32_t>( uiIndex + 1 );
+	}
+}
+
+void CPackDirectory::SetPending( std::unique_ptr<uint8_t[]>&& data, const size_t uiCount, LoadFunction_t pLoadFunction )
+{
+	assert( m_Entries.empty() && !m_Pending );
+	assert( pLoadFunction );
+
+	m_Pending = std::make_unique<Pending_t>();
+
+	m_Pending->data = std::move( data );
+	m_Pending->uiCount = uiCount;
+	m_Pending->pLoadFunction = pLoadFunction;
+}
+
+bool CPackDirectory::SetHashed( const uint8_t* pData, const size_t uiSize, const size_t uiBucketCount, const size_t uiEntryCount )
+{
+	assert( m_Entries.empty() && !m_Pending );
+
+	typedef pack::HashedPack PackType;
+
+	if( uiBucketCount == 0 || ( uiBucketCount & ( uiBucketCount - 1 ) ) != 0 || 
+		uiBucketCount > PackType::MAX_BUCKETS || uiEntryCount > PackType::MAX_FILES )
+	{
+		return false;
+	}
+
+	const size_t uiEntriesSize = uiEntryCount * sizeof( PackType::Entry_t );
+	const size_t uiBucketsSize = ( uiBucketCount + 1 ) * sizeof( uint32_t );
+	const size_t uiSlotsSize = uiEntryCount * sizeof( uint32_t );
+
+	if( uiSize < uiEntriesSize + uiBucketsSize + uiSlotsSize )
+		return false;
+
+	const uint8_t* pEntries = pData;
+	const uint8_t* pBuckets = pEntries + uiEntriesSize;
+	const uint8_t* pSlots = pBuckets + uiBucketsSize;
+	const uint8_t* pNames = pSlots + uiSlotsSize;
+
+	const size_t uiNameBytes = uiSize - ( uiEntriesSize + uiBucketsSize + uiSlotsSize );
+
+	//Every name has to end inside the blob.
+	if( uiNameBytes > PackType::MAX_NAME_BYTES || ( uiEntryCount > 0 && ( uiNameBytes == 0 || pNames[ uiNameBytes - 1 ] != '\0' ) ) )
+		return false;
+
+	m_Names.assign( pNames, pNames + uiNameBytes );
+
+#ifdef WIN32
+	std::replace( m_Names.begin(), m_Names.end(), '/', '\\' );
+#endif
+
+	m_Buckets.resize( uiBucketCount + 1 );
+	m_Table.resize( uiEntryCount );
+
+	memcpy( m_Buckets.data(), pBuckets, uiBucketsSize );
+
+	if( uiEntryCount > 0 )
+		memcpy( m_Table.data(), pSlots, uiSlotsSize );
+
+	bool bValid = true;
+
+	//Buckets have to cover the slots in order, and slots have to refer to entries.
+	for( size_t uiBucket = 0; uiBucket < m_Buckets.size(); ++uiBucket )
+	{
+		m_Buckets[ uiBucket ] = LittleValue( m_Buckets[ uiBucket ] );
+
+		if( uiBucket > 0 && m_Buckets[ uiBucket ] < m_Buckets[ uiBucket - 1 ] )
+			bValid = false;
+	}
+
+	bValid = bValid && m_Buckets.front() == 0 && m_Buckets.back() == uiEntryCount;
+
+	for( auto& uiSlot : m_Table )
+	{
+		uiSlot = LittleValue( uiSlot );
+
+		if( uiSlot >= uiEntryCount )
+			bValid = false;
+	}
+
+	m_Entries.reserve( uiEntryCount );
+	m_Hashes.reserve( uiEntryCount );
+
+	for( size_t uiIndex = 0; bValid && uiIndex < uiEntryCount; ++uiIndex )
+	{
+		PackType::Entry_t entry;
+
+		memcpy( &entry, pEntries + uiIndex * sizeof( entry ), sizeof( entry ) );
+
+		const auto uiNameOffset = LittleValue( entry.nameofs );
+		const auto codec = static_cast<pack::Codec>( LittleValue( entry.codec ) );
+
+		if( uiNameOffset >= uiNameBytes || ( codec != pack::Codec::NONE && codec != pack::Codec::LZ4 ) )
+		{
+			bValid = false;
+			break;
+		}
+
+		const auto uiLength = static_cast<uint64_t>( LittleValue( entry.filelen ) );
+
+		//Uncompressed entries are stored as is.
+		m_Entries.emplace_back( m_Names.data() + uiNameOffset, static_cast<uint64_t>( LittleValue( entry.filepos ) ), uiLength,
+								codec == pack::Codec::NONE ? uiLength : static_cast<uint64_t>( LittleValue( entry.storedlen ) ), codec );
+		m_Hashes.push_back( LittleValue( entry.namehash ) );
+	}
+
+	if( !bValid )
+	{
+		*this = CPackDirectory( GetResource() );
+		return false;
+	}
+
+	//Writers sort by name, but converting separators can change the order, and lookups by prefix depend on it.
+	if( !std::is_sorted( m_Entries.begin(), m_Entries.end(), PackLess() ) )
+		SortHashed();
+
+	return true;
+}
+
+void CPackDirectory::SortHashed()
+{
+	std::vector<uint32_t> order( m_Entries.size() );
+
+	std::iota( order.begin(), order.end(), 0 );
+
+	std::stable_sort( order.begin(), order.end(), 
+		[ this ]( const uint32_t lhs, const uint32_t rhs )
+		{
+			return strcmp( m_Entries[ lhs ].GetFileName(), m_Entries[ rhs ].GetFileName() ) < 0;
+		}
+	);
+
+	Entries_t entries;
+	TrackedVector_t<uint32_t, MemoryTag::FILESYSTEM> hashes;
+
+	entries.reserve( m_Entries.size() );
+	hashes.reserve( m_Hashes.size() );
+
+	//New index of each entry, by old index.
+	std::vector<uint32_t> indices( m_Entries.size() );
+
+	for( size_t uiIndex = 0; uiIndex < order.size(); ++uiIndex )
+	{
+		entries.push_back( m_Entries[ order[ uiIndex ] ] );
+		hashes.push_back( m_Hashes[ order[ uiIndex ] ] );
+
+		indices[ order[ uiIndex ] ] = static_cast<uint32_t>( uiIndex );
+	}
+
+	for( auto& uiSlot : m_Table )
+	{
+		uiSlot = indices[ uiSlot ];
+	}
+
+	m_Entries = std::move( entries );
+	m_Hashes = std::move( hashes );
+}
+
+void CPackDirectory::LoadPending() const
+{
+	std::lock_guard<std::mutex> lock( m_Pending->mutex );
+
+	//Another thread may have loaded it while this one was waiting.
+	if( m_Pending->bLoaded.load( std::memory_order_relaxed ) )
+		return;
+
+	//Loading doesn't change what the directory contains, only when it's built.
+	auto& directory = const_cast<CPackDirectory&>( *this );
+
+	m_Pending->pLoadFunction( directory, m_Pending->data.get(), m_Pending->uiCount );
+
+	m_Pending->data.reset();
+
+	m_Pending->bLoaded.store( true, std::memory_order_release );
+}
+
+void CPackDirectory::Save( std::vector<uint8_t>& data ) const
+{
+	assert( !IsHashed() );
+
+	Load();
+
+	SavedHeader_t header;
+
+	header.uiEntries = static_cast<uint32_t>( m_Entries.size() );
+	header.uiNameBytes = static_cast<uint32_t>( m_Names.size() );
+	header.uiTableSize = static_cast<uint32_t>( m_Table.size() );
+	header.uiReserved = 0;
+
+	auto append = [ & ]( const void* pData, const size_t uiSize )
+	{
+		auto pBytes = reinterpret_cast<const uint8_t*>( pData );
+
+		data.insert( data.end(), pBytes, pBytes + uiSize );
+	};
+
+	append( &header, sizeof( header ) );
+
+	for( const auto& entry : m_Entries )
+	{
+		SavedEntry_t saved;
+
+		saved.uiStartOffset = entry.GetStartOffset();
+		saved.uiLength = entry.GetLength();
+		saved.uiStoredLength = entry.GetStoredLength();
+		saved.uiNameOffset = static_cast<uint32_t>( entry.GetFileName() - m_Names.data() );
+		saved.uiCodec = static_cast<uint32_t>( entry.GetCodec() );
+
+		append( &saved, sizeof( saved ) );
+	}
+
+	append( m_Names.data(), m_Names.size() );
+	append( m_Hashes.data(), m_Hashes.size() * sizeof( uint32_t ) );
+	append( m_Table.data(), m_Table.size() * sizeof( uint32_t ) );
+}
+
+bool CPackDirectory::Restore( const uint8_t* pData, const size_t uiSize )
+{
+	assert( m_Entries.empty() && !m_Pending );
+
+	SavedHeader_t header;
+
+	if( uiSize < sizeof( header ) )
+		return false;
+
+	memcpy( &header, pData, sizeof( header ) );
+
+	const size_t uiEntriesSize = static_cast<size_t>( header.uiEntries ) * sizeof( SavedEntry_t );
+	const size_t uiHashesSize = static_cast<size_t>( header.uiEntries ) * sizeof( uint32_t );
+	const size_t uiTableSize = static_cast<size_t>( header.uiTableSize ) * sizeof( uint32_t );
+
+	//Same rules as Finish: a power of 2 that keeps the load factor at or below 50%.
+	const bool bValidTable = header.uiTableSize >= 16 && ( header.uiTableSize & ( header.uiTableSize - 1 ) ) == 0 &&
+		header.uiTableSize >= static_cast<size_t>( header.uiEntries ) * 2;
+
+	if( !bValidTable || uiSize != sizeof( header ) + uiEntriesSize + header.uiNameBytes + uiHashesSize + uiTableSize )
+		return false;
+
+	const uint8_t* pEntries = pData + sizeof( header );
+	const uint8_t* pNames = pEntries + uiEntriesSize;
+	const uint8_t* pHashes = pNames + header.uiNameBytes;
+	const uint8_t* pTable = pHashes + uiHashesSize;
+
+	//Every name has to end inside the buffer.
+	if( header.uiEntries > 0 && ( header.uiNameBytes == 0 || pNames[ header.uiNameBytes - 1 ] != '\0' ) )
+		return false;
+
+	m_Names.assign( pNames, pNames + header.uiNameBytes );
+
+	m_Entries.reserve( header.uiEntries );
+
+	for( size_t uiIndex = 0; uiIndex < header.uiEntries; ++uiIndex )
+	{
+		SavedEntry_t saved;
+
+		memcpy( &saved, pEntries + uiIndex * sizeof( saved ), sizeof( saved ) );
+
+		const auto codec = static_cast<pack::Codec>( saved.uiCodec );
+
+		if( saved.uiNameOffset >= header.uiNameBytes ||
+			( codec != pack::Codec::NONE && codec != pack::Codec::LZ4 && codec != pack::Codec::DEFLATE ) )
+		{
+			*this = CPackDirectory( GetResource() );
+			return false;
+		}
+
+		m_Entries.emplace_back( m_Names.data() + saved.uiNameOffset, saved.uiStartOffset, saved.uiLength, saved.uiStoredLength, codec );
+	}
+
+	m_Hashes.resize( header.uiEntries );
+	m_Table.resize( header.uiTableSize );
+
+	if( !m_Hashes.empty() )
+		memcpy( m_Hashes.data(), pHashes, uiHashesSize );
+
+	memcpy( m_Table.data(), pTable, uiTableSize );
+
+	//Lookups index entries through the table, so it can't point past them.
+	for( const auto uiSlot : m_Table )
+	{
+		if( uiSlot > header.uiEntries )
+		{
+			*this = CPackDirectory( GetResource() );
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const CPackFileEntry* CPackDirectory::Find( const char* pszFileName ) const
+{
+	if( IsHashed() )
+		return FindHashed( pszFileName );
+
+	Load();
+
+	if( m_Table.empty() )
+		return nullptr;
+
+	const auto uiHash = HashName( pszFileName );
+
+	const size_t uiMask = m_Table.size() - 1;
+
+	for( size_t uiSlot = uiHash & uiMask; m_Table[ uiSlot ] != 0; uiSlot = ( uiSlot + 1 ) & uiMask )
+	{
+		const size_t uiIndex = m_Table[ uiSlot ] - 1;
+
+		if( m_Hashes[ uiIndex ] == uiHash && strcmp( m_Entries[ uiIndex ].GetFileName(), pszFileName ) == 0 )
+			return &m_Entries[ uiIndex ];
+	}
+
+	return nullptr;
+}
+
+const CPackFileEntry* CPackDirectory::FindHashed( const char* pszFileName ) const
+{
+	const auto uiHash = pack::HashedPack::HashName( pszFileName );
+
+	const size_t uiBucket = uiHash & ( m_Buckets.size() - 2 );
+
+	for( size_t uiSlot = m_Buckets[ uiBucket ]; uiSlot < m_Buckets[ uiBucket + 1 ]; ++uiSlot )
+	{
+		const size_t uiIndex = m_Table[ uiSlot ];
+
+		if( m_Hashes[ uiIndex ] == uiHash && PackNamesEqual( m_Entries[ uiIndex ].GetFileName(), pszFileName ) )
+			return &m_Entries[ uiIndex ];
+	}
+
+	return nullptr;
+}
+
+std::pair<CPackDirectory::const_iterator, CPackDirectory::const_iterator> CPackDirectory::FindPrefix( const char* pszPrefix ) const
+{
+	Load();
+
+	const size_t uiLength = strlen( pszPrefix );
+
+	auto first = std::lower_bound( m_Entries.begin(), m_Entries.end(), pszPrefix, 
+		[]( const CPackFileEntry& entry, const char* pszPrefix )
+		{
+			return strcmp( entry.GetFileName(), pszPrefix ) < 0;
+		}
+	);
+
+	auto last = std::partition_point( first, m_Entries.end(), 
+		[ & ]( const CPackFileEntry& entry )
+		{
+			return strncmp( entry.GetFileName(), pszPrefix, uiLength ) == 0;
+		}
+	);
+
+	return std::make_pair( first, last );
+}
+
+uint32_t CPackDirectory::HashName( const char* pszFileName )
+{
+	//32 bit FNV-1a.
+	uint32_t uiHash = 2166136261U;
+
+	for( ; *pszFileName; ++pszFileName )
+	{
+		uiHash ^= static_cast<uint8_t>( *pszFileName );
+		uiHash *= 16777619U;
+	}
+
+	return uiHash;
+}
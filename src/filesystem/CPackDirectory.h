@@ -0,0 +1,252 @@
+#ifndef FILESYSTEM_CPACKDIRECTORY_H
+#define FILESYSTEM_CPACKDIRECTORY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "CPackFileEntry.h"
+#include "MemoryTracking.h"
+
+/**
+*	Directory of the files in a pack file.
+*	All file names are stored in a single buffer, entries are stored contiguously and sorted by name,
+*	and lookups use an open addressing hash table of entry indices.
+*	The directory can be loaded lazily: the raw directory read from the pack file is kept,
+*	and entries are added the first time the directory is used.
+*	Directories of hashed pack files are used as stored instead: they're already sorted, and lookups use the pack file's own buckets.
+*/
+class CPackDirectory
+{
+public:
+	typedef TrackedVector_t<CPackFileEntry, MemoryTag::FILESYSTEM> Entries_t;
+	typedef Entries_t::const_iterator const_iterator;
+
+	/**
+	*	Adds the entries of a raw directory and calls Finish.
+	*	@param directory Directory to add the entries to.
+	*	@param pData Raw directory, as read from the pack file.
+	*	@param uiCount Number of entries in the raw directory.
+	*/
+	typedef void ( *LoadFunction_t )( CPackDirectory& directory, const uint8_t* pData, const size_t uiCount );
+
+public:
+	CPackDirectory() = default;
+
+	/**
+	*	@param pResource Resource that the entries, names and tables are allocated from, or null to use the heap. Must outlive the directory.
+	*	Moving the directory moves the resource along with it.
+	*/
+	explicit CPackDirectory( IMemoryResource* pResource )
+		: m_Names( TrackedVector_t<char, MemoryTag::FILESYSTEM>::allocator_type( pResource ) )
+		, m_Entries( Entries_t::allocator_type( pResource ) )
+		, m_NameOffsets( TrackedVector_t<size_t, MemoryTag::FILESYSTEM>::allocator_type( pResource ) )
+		, m_Hashes( TrackedVector_t<uint32_t, MemoryTag::FILESYSTEM>::allocator_type( pResource ) )
+		, m_Table( TrackedVector_t<uint32_t, MemoryTag::FILESYSTEM>::allocator_type( pResource ) )
+		, m_Buckets( TrackedVector_t<uint32_t, MemoryTag::FILESYSTEM>::allocator_type( pResource ) )
+	{
+	}
+
+	CPackDirectory( CPackDirectory&& other ) = default;
+	CPackDirectory& operator=( CPackDirectory&& other ) = default;
+
+	/**
+	*	Reserves memory for the given number of entries and total name length.
+	*/
+	void Reserve( const size_t uiEntries, const size_t uiNameBytes );
+
+	/**
+	*	Adds an entry. The name is copied, and separators are converted to the platform's preferred separator.
+	*	Finish must be called after all entries have been added.
+	*	@param pszFileName Name of the file. Need not be null terminated if it is uiMaxLength characters long.
+	*	@param uiMaxLength Maximum length of the file name.
+	*	@param uiStartOffset Offset of the file's data in the pack file.
+	*	@param uiLength Uncompressed length of the file.
+	*	@param uiStoredLength Length of the file's data in the pack file.
+	*	@param codec Codec the file is stored with.
+	*/
+	void AddEntry( const char* pszFileName, const size_t uiMaxLength, uint64_t uiStartOffset, uint64_t uiLength,
+				   uint64_t uiStoredLength, pack::Codec codec = pack::Codec::NONE );
+
+	void AddEntry( const char* pszFileName, const size_t uiMaxLength, uint64_t uiStartOffset, uint64_t uiLength )
+	{
+		AddEntry( pszFileName, uiMaxLength, uiStartOffset, uiLength, uiLength );
+	}
+
+	/**
+	*	Sorts the entries and builds the lookup table. If a name occurs more than once, the first entry is kept.
+	*/
+	void Finish();
+
+	/**
+	*	Defers adding entries until the directory is first used. Must be called on an empty directory.
+	*	Safe to use from multiple threads once set; the first access loads the directory.
+	*	@param data Raw directory, as read from the pack file.
+	*	@param uiCount Number of entries in the raw directory.
+	*	@param pLoadFunction Function that adds the entries.
+	*/
+	void SetPending( std::unique_ptr<uint8_t[]>&& data, const size_t uiCount, LoadFunction_t pLoadFunction );
+
+	/**
+	*	Loads the directory of a hashed pack file. Must be called on an empty directory.
+	*	Nothing is sorted or hashed, the entries are only checked and converted, so this is cheap even for millions of entries.
+	*	@param pData Raw directory, as read from the pack file.
+	*	@param uiSize Size of the raw directory.
+	*	@param uiBucketCount Number of buckets in the raw directory.
+	*	@param uiEntryCount Number of entries in the raw directory.
+	*	@return Whether the directory was valid. If not, the directory is left empty.
+	*	@see pack::HashedPack
+	*/
+	bool SetHashed( const uint8_t* pData, const size_t uiSize, const size_t uiBucketCount, const size_t uiEntryCount );
+
+	/**
+	*	@return Whether this is the directory of a hashed pack file.
+	*/
+	bool IsHashed() const { return !m_Buckets.empty(); }
+
+	/**
+	*	@return Resource that the directory is allocated from, or null if it uses the heap.
+	*/
+	IMemoryResource* GetResource() const { return m_Entries.get_allocator().GetResource(); }
+
+	/**
+	*	@return Whether the entries have yet to be added.
+	*/
+	bool IsPending() const { return m_Pending && !m_Pending->bLoaded.load( std::memory_order_acquire ); }
+
+	/**
+	*	Appends the finished directory to a buffer, in a form that Restore can load without sorting or hashing anything.
+	*	The data is in native byte order, so it's only meant to be read on the same machine. Loads a pending directory first.
+	*	Hashed directories can't be saved, they're cheap enough to load as is.
+	*/
+	void Save( std::vector<uint8_t>& data ) const;
+
+	/**
+	*	Loads a directory that was saved with Save. Must be called on an empty directory.
+	*	@return Whether the data was valid. If not, the directory is left empty.
+	*/
+	bool Restore( const uint8_t* pData, const size_t uiSize );
+
+	/**
+	*	Finds an entry by name.
+	*	@param pszFileName Name of the file, using the platform's preferred separator. Hashed directories accept either separator.
+	*	@return The entry, or null if there is no such file.
+	*/
+	const CPackFileEntry* Find( const char* pszFileName ) const;
+
+	/**
+	*	Finds all entries whose names start with the given prefix. Entries are sorted by name, so these are contiguous.
+	*	@param pszPrefix Prefix, using the platform's preferred separator.
+	*	@return Range of matching entries.
+	*/
+	std::pair<const_iterator, const_iterator> FindPrefix( const char* pszPrefix ) const;
+
+	size_t size() const { Load(); return m_Entries.size(); }
+
+	bool empty() const { Load(); return m_Entries.empty(); }
+
+	const_iterator begin() const { Load(); return m_Entries.begin(); }
+
+	const_iterator end() const { Load(); return m_Entries.end(); }
+
+private:
+	struct Pending_t
+	{
+		std::mutex mutex;
+
+		std::atomic<bool> bLoaded{ false };
+
+		std::unique_ptr<uint8_t[]> data;
+		size_t uiCount = 0;
+
+		LoadFunction_t pLoadFunction = nullptr;
+	};
+
+private:
+	/**
+	*	Adds the entries if the directory is pending.
+	*/
+	void Load() const
+	{
+		if( IsPending() )
+			LoadPending();
+	}
+
+	void LoadPending() const;
+
+	/**
+	*	Saved form of an entry. The name is an offset in the name buffer.
+	*/
+	struct SavedEntry_t
+	{
+		uint64_t uiStartOffset;
+		uint64_t uiLength;
+		uint64_t uiStoredLength;
+		uint32_t uiNameOffset;
+		uint32_t uiCodec;
+	};
+
+	/**
+	*	Header of a saved directory. Followed by the entries, the names, the hashes and the table.
+	*/
+	struct SavedHeader_t
+	{
+		uint32_t uiEntries;
+		uint32_t uiNameBytes;
+		uint32_t uiTableSize;
+		uint32_t uiReserved;
+	};
+
+	static uint32_t HashName( const char* pszFileName );
+
+	const CPackFileEntry* FindHashed( const char* pszFileName ) const;
+
+	/**
+	*	Sorts the entries of a hashed directory by name, and updates the slots to match.
+	*/
+	void SortHashed();
+
+private:
+	/**
+	*	Raw directory, if the entries are added lazily.
+	*/
+	std::unique_ptr<Pending_t> m_Pending;
+
+	/**
+	*	All file names, null terminated.
+	*/
+	TrackedVector_t<char, MemoryTag::FILESYSTEM> m_Names;
+
+	Entries_t m_Entries;
+
+	/**
+	*	Offsets of entry names in m_Names while entries are being added.
+	*/
+	TrackedVector_t<size_t, MemoryTag::FILESYSTEM> m_NameOffsets;
+
+	/**
+	*	Hash of each entry's name, in entry order.
+	*/
+	TrackedVector_t<uint32_t, MemoryTag::FILESYSTEM> m_Hashes;
+
+	/**
+	*	Open addressing table of entry indices plus one. 0 marks an empty slot. Size is a power of 2.
+	*	In a hashed directory, the entry indices of each bucket's slots instead.
+	*/
+	TrackedVector_t<uint32_t, MemoryTag::FILESYSTEM> m_Table;
+
+	/**
+	*	In a hashed directory, the bucket offsets into m_Table. Otherwise, empty.
+	*/
+	TrackedVector_t<uint32_t, MemoryTag::FILESYSTEM> m_Buckets;
+
+private:
+	CPackDirectory( const CPackDirectory& ) = delete;
+	CPackDirectory& operator=( const CPackDirectory& ) = delete;
+};
+
+#endif //FILESYSTEM_CPACKDIRECTORY_H
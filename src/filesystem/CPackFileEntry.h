@@ -2,54 +2,66 @@
 #define FILESYSTEM_CPACKFILEENTRY_H
 
 #include <cstdint>
-#include <string>
+#include <cstring>
+
+#include "PackFile.h"
 
 /**
 *	Contains information about a file inside a pack file.
+*	The file name is owned by the pack directory that contains the entry.
 */
 class CPackFileEntry
 {
 public:
-	CPackFileEntry( const char* pszFileName, uint64_t uiStartOffset, uint64_t uiLength );
+	/**
+	*	@param uiLength Uncompressed length of the file.
+	*	@param uiStoredLength Length of the file's data in the pack file. Equal to uiLength if the file isn't compressed.
+	*	@param codec Codec the file is stored with.
+	*/
+	CPackFileEntry( const char* pszFileName, uint64_t uiStartOffset, uint64_t uiLength, uint64_t uiStoredLength, pack::Codec codec = pack::Codec::NONE );
 
-	CPackFileEntry( std::string&& szFileName, uint64_t uiStartOffset, uint64_t uiLength );
+	CPackFileEntry( const char* pszFileName, uint64_t uiStartOffset, uint64_t uiLength )
+		: CPackFileEntry( pszFileName, uiStartOffset, uiLength, uiLength )
+	{
+	}
 
-	CPackFileEntry( CPackFileEntry&& other ) = default;
-	CPackFileEntry& operator=( CPackFileEntry&& other ) = default;
+	CPackFileEntry( const CPackFileEntry& other ) = default;
+	CPackFileEntry& operator=( const CPackFileEntry& other ) = default;
 
-	inline const std::string& GetFileName() const { return m_szFileName; }
+	inline const char* GetFileName() const { return m_pszFileName; }
 
 	inline uint64_t GetStartOffset() const { return m_uiStartOffset; }
 
 	inline uint64_t GetLength() const { return m_uiLength; }
 
+	inline uint64_t GetStoredLength() const { return m_uiStoredLength; }
+
+	inline pack::Codec GetCodec() const { return m_Codec; }
+
+	inline bool IsCompressed() const { return m_Codec != pack::Codec::NONE; }
+
 private:
-	std::string m_szFileName;
+	friend class CPackDirectory;
+
+	const char* m_pszFileName;
 	uint64_t m_uiStartOffset;
 	uint64_t m_uiLength;
-
-private:
-	CPackFileEntry( const CPackFileEntry& ) = delete;
-	CPackFileEntry& operator=( const CPackFileEntry& ) = delete;
+	uint64_t m_uiStoredLength;
+	pack::Codec m_Codec;
 };
 
-inline CPackFileEntry::CPackFileEntry( const char* pszFileName, uint64_t uiStartOffset, uint64_t uiLength )
-	: m_szFileName( pszFileName )
-	, m_uiStartOffset( uiStartOffset )
-	, m_uiLength( uiLength )
-{
-}
-
-inline CPackFileEntry::CPackFileEntry( std::string&& szFileName, uint64_t uiStartOffset, uint64_t uiLength )
-	: m_szFileName( std::move( szFileName ) )
+inline CPackFileEntry::CPackFileEntry( const char* pszFileName, uint64_t uiStartOffset, uint64_t uiLength, uint64_t uiStoredLength, pack::Codec codec )
+	: m_pszFileName( pszFileName )
 	, m_uiStartOffset( uiStartOffset )
 	, m_uiLength( uiLength )
+	, m_uiStoredLength( uiStoredLength )
+	, m_Codec( codec )
 {
 }
 
 inline static bool PackFileEntryLessFunc( const CPackFileEntry& lhs, const CPackFileEntry& rhs )
 {
-	return lhs.GetFileName() < rhs.GetFileName();
+	return strcmp( lhs.GetFileName(), rhs.GetFileName() ) < 0;
 }
 
 inline static bool operator<( const CPackFileEntry& lhs, const CPackFileEntry& rhs )
@@ -0,0 +1,270 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <experimental/filesystem>
+#include <thread>
+
+#include "Platform.h"
+
+#include "ByteSwap.h"
+#include "CRC32C.h"
+#include "PackFile.h"
+
+#include "CFileHandle.h"
+#include "CFileSystemStats.h"
+
+#include "CPackVerifier.h"
+
+namespace fs = std::experimental::filesystem;
+
+const size_t CPackVerifier::MAX_THREADS;
+
+const char* const CPackVerifier::CACHE_FILE_NAME = "packverify.cache";
+
+void CPackVerifier::Verify( const char* pszFileName, FILE* pFile, const uint8_t* pData, Report_t& report )
+{
+	report = Report_t();
+
+	const auto uiStartTime = CFileSystemStats::GetTime();
+
+	std::error_code error;
+
+	const auto uiFileSize = static_cast<uint64_t>( fs::file_size( pszFileName, error ) );
+
+	if( error )
+	{
+		report.result = Result::CORRUPT;
+		return;
+	}
+
+	const auto iModifiedTime = static_cast<int64_t>( fs::last_write_time( pszFileName, error ).time_since_epoch().count() );
+
+	if( !error )
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		LoadCache();
+
+		auto it = m_Cache.find( pszFileName );
+
+		if( it != m_Cache.end() && it->second.uiSize == uiFileSize && it->second.iModifiedTime == iModifiedTime )
+		{
+			report.result = Result::UNCHANGED;
+			return;
+		}
+	}
+
+	const std::string szChecksumFileName = std::string( pszFileName ) + pack::PackChecksums::EXTENSION;
+
+	FILE* pChecksumFile = fopen64( szChecksumFileName.c_str(), "rb" );
+
+	if( !pChecksumFile )
+	{
+		report.result = Result::NO_CHECKSUMS;
+		return;
+	}
+
+	pack::PackChecksums::Header_t header;
+
+	std::vector<uint32_t> checksums;
+
+	bool bValid = fread( &header, sizeof( header ), 1, pChecksumFile ) == 1 &&
+		memcmp( header.identifier, pack::PackChecksums::IDENTIFIER, sizeof( header.identifier ) ) == 0 &&
+		LittleValue( header.version ) == pack::PackChecksums::VERSION;
+
+	const uint32_t uiBlockSize = LittleValue( header.blocksize );
+	const int64_t iExpectedSize = LittleValue( header.filesize );
+
+	bValid = bValid && uiBlockSize > 0 && uiBlockSize <= pack::PackChecksums::MAX_BLOCK_SIZE && iExpectedSize >= 0;
+
+	if( bValid )
+	{
+		checksums.resize( static_cast<size_t>( pack::PackChecksums::GetBlockCount( static_cast<uint64_t>( iExpectedSize ), uiBlockSize ) ) );
+
+		bValid = checksums.empty() || fread( checksums.data(), checksums.size() * sizeof( uint32_t ), 1, pChecksumFile ) == 1;
+	}
+
+	fclose( pChecksumFile );
+
+	if( !bValid )
+	{
+		report.result = Result::INVALID_CHECKSUMS;
+		return;
+	}
+
+	LittleArray( checksums.data(), checksums.size() );
+
+	const auto uiExpectedSize = static_cast<uint64_t>( iExpectedSize );
+
+	if( uiFileSize != uiExpectedSize )
+	{
+		//Usually an incomplete download. None of the blocks past the end can be right.
+		const auto uiValidSize = std::min( uiFileSize, uiExpectedSize );
+
+		report.corruptRanges.emplace_back( uiValidSize, std::max( uiFileSize, uiExpectedSize ) - uiValidSize );
+	}
+
+	std::vector<uint64_t> corruptBlocks;
+
+	VerifyBlocks( pFile, pData, std::min( uiFileSize, uiExpectedSize ), uiBlockSize, checksums, corruptBlocks );
+
+	report.uiBytes = std::min( uiFileSize, uiExpectedSize );
+
+	//Merge adjacent blocks into ranges.
+	std::vector<std::pair<uint64_t, uint64_t>> ranges;
+
+	for( const auto uiBlock : corruptBlocks )
+	{
+		const uint64_t uiOffset = uiBlock * uiBlockSize;
+		const uint64_t uiLength = std::min<uint64_t>( uiBlockSize, report.uiBytes - uiOffset );
+
+		if( !ranges.empty() && ranges.back().first + ranges.back().second == uiOffset )
+			ranges.back().second += uiLength;
+		else
+			ranges.emplace_back( uiOffset, uiLength );
+	}
+
+	report.corruptRanges.insert( report.corruptRanges.begin(), ranges.begin(), ranges.end() );
+
+	report.result = report.corruptRanges.empty() ? Result::VERIFIED : Result::CORRUPT;
+
+	report.uiTime = CFileSystemStats::GetTime() - uiStartTime;
+
+	if( error )
+		return;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	if( report.result == Result::VERIFIED )
+	{
+		m_Cache[ pszFileName ] = { uiFileSize, iModifiedTime };
+
+		SaveCache();
+	}
+	else if( m_Cache.erase( pszFileName ) > 0 )
+	{
+		SaveCache();
+	}
+}
+
+void CPackVerifier::LoadCache()
+{
+	if( m_bCacheLoaded )
+		return;
+
+	m_bCacheLoaded = true;
+
+	FILE* pFile = fopen64( CACHE_FILE_NAME, "rb" );
+
+	if( !pFile )
+		return;
+
+	//Each line is the size, the modification time and the full path of a pack file.
+	char szLine[ MAX_PATH + 64 ];
+
+	while( fgets( szLine, sizeof( szLine ), pFile ) )
+	{
+		szLine[ strcspn( szLine, "\r\n" ) ] = '\0';
+
+		char* pszNext;
+
+		CacheEntry_t entry;
+
+		entry.uiSize = strtoull( szLine, &pszNext, 10 );
+
+		if( *pszNext != ' ' )
+			continue;
+
+		entry.iModifiedTime = strtoll( pszNext + 1, &pszNext, 10 );
+
+		if( *pszNext != ' ' || !pszNext[ 1 ] )
+			continue;
+
+		m_Cache[ pszNext + 1 ] = entry;
+	}
+
+	fclose( pFile );
+}
+
+void CPackVerifier::SaveCache() const
+{
+	FILE* pFile = fopen64( CACHE_FILE_NAME, "wb" );
+
+	if( !pFile )
+		return;
+
+	for( const auto& entry : m_Cache )
+	{
+		fprintf( pFile, "%llu %lld %s\n",
+				 static_cast<unsigned long long>( entry.second.uiSize ), static_cast<long long>( entry.second.iModifiedTime ), entry.first.c_str() );
+	}
+
+	fclose( pFile );
+}
+
+void CPackVerifier::VerifyBlocks( FILE* pFile, const uint8_t* pData, const uint64_t uiFileSize, const uint32_t uiBlockSize,
+								  const std::vector<uint32_t>& checksums, std::vector<uint64_t>& corruptBlocks )
+{
+	const auto uiBlockCount = std::min<uint64_t>( pack::PackChecksums::GetBlockCount( uiFileSize, uiBlockSize ), checksums.size() );
+
+	std::atomic<uint64_t> uiNextBlock{ 0 };
+
+	std::mutex mutex;
+
+	auto verifyBlocks = [ & ]()
+	{
+		std::vector<uint8_t> buffer;
+
+		if( !pData )
+			buffer.resize( uiBlockSize );
+
+		for( uint64_t uiBlock; ( uiBlock = uiNextBlock.fetch_add( 1, std::memory_order_relaxed ) ) < uiBlockCount; )
+		{
+			const uint64_t uiOffset = uiBlock * uiBlockSize;
+			const auto uiLength = static_cast<size_t>( std::min<uint64_t>( uiBlockSize, uiFileSize - uiOffset ) );
+
+			bool bValid;
+
+			if( pData )
+			{
+				bValid = crc32c::Compute( pData + uiOffset, uiLength ) == checksums[ static_cast<size_t>( uiBlock ) ];
+			}
+			else
+			{
+				bValid = CFileHandle::ReadAt( pFile, buffer.data(), uiLength, uiOffset ) == uiLength &&
+					crc32c::Compute( buffer.data(), uiLength ) == checksums[ static_cast<size_t>( uiBlock ) ];
+			}
+
+			if( !bValid )
+			{
+				std::lock_guard<std::mutex> lock( mutex );
+
+				corruptBlocks.push_back( uiBlock );
+			}
+		}
+	};
+
+	//The calling thread is one of the workers.
+	const auto uiThreadCount = static_cast<size_t>( std::min<uint64_t>(
+		std::min<size_t>( MAX_THREADS, std::max( 1U, std::thread::hardware_concurrency() ) ), std::max<uint64_t>( uiBlockCount, 1 ) ) );
+
+	std::vector<std::thread> threads;
+
+	threads.reserve( uiThreadCount - 1 );
+
+	for( size_t uiThread = 1; uiThread < uiThreadCount; ++uiThread )
+	{
+		threads.emplace_back( verifyBlocks );
+	}
+
+	verifyBlocks();
+
+	for( auto& thread : threads )
+	{
+		thread.join();
+	}
+
+	std::sort( corruptBlocks.begin(), corruptBlocks.end() );
+}
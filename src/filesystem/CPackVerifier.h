@@ -0,0 +1,135 @@
+#ifndef FILESYSTEM_CPACKVERIFIER_H
+#define FILESYSTEM_CPACKVERIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+*	Verifies pack files against the checksum files written by the pack builder.
+*	Blocks are checksummed on several threads. Pack files that were verified are remembered by size and modification time,
+*	in a cache file that persists between runs, so they aren't checked again until they change.
+*	@see pack::PackChecksums
+*/
+class CPackVerifier
+{
+public:
+	/**
+	*	Maximum number of threads that checksum a single pack file.
+	*/
+	static const size_t MAX_THREADS = 4;
+
+	/**
+	*	Name of the file that verified pack files are remembered in, relative to the working directory.
+	*/
+	static const char* const CACHE_FILE_NAME;
+
+	enum class Result
+	{
+		/**
+		*	All blocks match their checksums.
+		*/
+		VERIFIED,
+
+		/**
+		*	The pack file was verified before, and hasn't changed since.
+		*/
+		UNCHANGED,
+
+		/**
+		*	The pack file has no checksum file.
+		*/
+		NO_CHECKSUMS,
+
+		/**
+		*	The checksum file is not valid.
+		*/
+		INVALID_CHECKSUMS,
+
+		/**
+		*	The pack file doesn't match its checksums.
+		*/
+		CORRUPT
+	};
+
+	struct Report_t
+	{
+		Result result = Result::NO_CHECKSUMS;
+
+		/**
+		*	Number of bytes that were checksummed.
+		*/
+		uint64_t uiBytes = 0;
+
+		/**
+		*	Time spent verifying, in microseconds.
+		*/
+		uint64_t uiTime = 0;
+
+		/**
+		*	If the pack file is corrupt, the ranges of bytes that don't match their checksums, as offset and length, in file order.
+		*/
+		std::vector<std::pair<uint64_t, uint64_t>> corruptRanges;
+	};
+
+public:
+	CPackVerifier() = default;
+
+	/**
+	*	Verifies a pack file. Can be called from multiple threads at once.
+	*	@param pszFileName Name of the pack file.
+	*	@param pFile Opened pack file, read with positional reads.
+	*	@param pData Optional. Memory mapping of the whole pack file, read instead of pFile.
+	*	@param[ out ] report Result of the verification.
+	*/
+	void Verify( const char* pszFileName, FILE* pFile, const uint8_t* pData, Report_t& report );
+
+private:
+	/**
+	*	Identifies the contents of a pack file that was verified.
+	*/
+	struct CacheEntry_t
+	{
+		uint64_t uiSize;
+		int64_t iModifiedTime;
+	};
+
+	/**
+	*	Loads the cache file if it hasn't been loaded yet. Must be called with the mutex held.
+	*/
+	void LoadCache();
+
+	/**
+	*	Writes the cache file. Must be called with the mutex held.
+	*/
+	void SaveCache() const;
+
+	/**
+	*	Checksums all blocks of a pack file.
+	*	@param checksums Expected checksum of each block.
+	*	@param[ out ] corruptBlocks Indices of the blocks that don't match, in ascending order.
+	*/
+	static void VerifyBlocks( FILE* pFile, const uint8_t* pData, const uint64_t uiFileSize, const uint32_t uiBlockSize,
+							  const std::vector<uint32_t>& checksums, std::vector<uint64_t>& corruptBlocks );
+
+private:
+	std::mutex m_Mutex;
+
+	bool m_bCacheLoaded = false;
+
+	/**
+	*	Pack files that were verified, by full path.
+	*/
+	std::unordered_map<std::string, CacheEntry_t> m_Cache;
+
+private:
+	CPackVerifier( const CPackVerifier& ) = delete;
+	CPackVerifier& operator=( const CPackVerifier& ) = delete;
+};
+
+#endif //FILESYSTEM_CPACKVERIFIER_H
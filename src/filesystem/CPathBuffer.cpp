@@ -0,0 +1,74 @@
+#include "CPathBuffer.h"
+
+namespace
+{
+#ifdef WIN32
+const char PREFERRED_SEPARATOR = '\\';
+#else
+const char PREFERRED_SEPARATOR = '/';
+#endif
+
+inline bool IsSeparator( const char c )
+{
+	return c == '/' || c == '\\';
+}
+}
+
+bool CPathBuffer::Set( const char* pszFileName )
+{
+	Clear();
+
+	if( !Append( pszFileName ) )
+	{
+		Clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool CPathBuffer::Set( const char* pszBasePath, const char* pszFileName )
+{
+	if( !Set( pszBasePath ) )
+		return false;
+
+	//Don't add a separator if either side already provides one, or if there is nothing to separate.
+	if( m_uiLength > 0 && *pszFileName && !IsSeparator( m_szPath[ m_uiLength - 1 ] ) && !IsSeparator( *pszFileName ) )
+	{
+		if( !Append( "/" ) )
+		{
+			Clear();
+			return false;
+		}
+	}
+
+	if( !Append( pszFileName ) )
+	{
+		Clear();
+		return false;
+	}
+
+	return true;
+}
+
+bool CPathBuffer::Append( const char* pszString )
+{
+	for( ; *pszString; ++pszString )
+	{
+		//Leave room for the terminator.
+		if( m_uiLength + 1 >= sizeof( m_szPath ) )
+			return false;
+
+		m_szPath[ m_uiLength++ ] = IsSeparator( *pszString ) ? PREFERRED_SEPARATOR : *pszString;
+	}
+
+	m_szPath[ m_uiLength ] = '\0';
+
+	return true;
+}
+
+void CPathBuffer::Clear()
+{
+	m_szPath[ 0 ] = '\0';
+	m_uiLength = 0;
+}
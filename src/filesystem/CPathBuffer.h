@@ -0,0 +1,51 @@
+#ifndef FILESYSTEM_CPATHBUFFER_H
+#define FILESYSTEM_CPATHBUFFER_H
+
+#include <cstddef>
+
+#include "Platform.h"
+
+/**
+*	Fixed size buffer for building file names without allocating. Intended to live on the stack.
+*	Separators are converted to the platform's preferred separator, like fs::path::make_preferred,
+*	except that backslashes are also converted on platforms that use forward slashes.
+*/
+class CPathBuffer final
+{
+public:
+	CPathBuffer() = default;
+
+	/**
+	*	Sets the buffer to the given file name.
+	*	@return Whether the name fit in the buffer. If not, the buffer is empty.
+	*/
+	bool Set( const char* pszFileName );
+
+	/**
+	*	Sets the buffer to the given base path and relative name, separated by a single separator.
+	*	@return Whether the path fit in the buffer. If not, the buffer is empty.
+	*/
+	bool Set( const char* pszBasePath, const char* pszFileName );
+
+	const char* Get() const { return m_szPath; }
+
+	size_t GetLength() const { return m_uiLength; }
+
+	bool IsEmpty() const { return m_uiLength == 0; }
+
+private:
+	bool Append( const char* pszString );
+
+	void Clear();
+
+private:
+	char m_szPath[ MAX_PATH ] = {};
+
+	size_t m_uiLength = 0;
+
+private:
+	CPathBuffer( const CPathBuffer& ) = delete;
+	CPathBuffer& operator=( const CPathBuffer& ) = delete;
+};
+
+#endif //FILESYSTEM_CPATHBUFFER_H
@@ -0,0 +1,35 @@
+#include "CStringPool.h"
+
+#include "CPathIDTable.h"
+
+PathID_t CPathIDTable::Intern( const char* pszPathID )
+{
+	if( !pszPathID )
+		return PathID::NONE;
+
+	auto it = m_IDs.find( pszPathID );
+
+	if( it != m_IDs.end() )
+		return it->second;
+
+	const auto id = static_cast<PathID_t>( m_IDs.size() + 1 );
+
+	m_IDs.emplace( GetStringPool().Intern( pszPathID ), id );
+
+	return id;
+}
+
+PathID_t CPathIDTable::Find( const char* pszPathID ) const
+{
+	if( !pszPathID )
+		return PathID::ANY;
+
+	auto it = m_IDs.find( pszPathID );
+
+	return it != m_IDs.end() ? it->second : PathID::UNKNOWN;
+}
+
+void CPathIDTable::Clear()
+{
+	m_IDs.clear();
+}
@@ -0,0 +1,77 @@
+#ifndef FILESYSTEM_CPATHIDTABLE_H
+#define FILESYSTEM_CPATHIDTABLE_H
+
+#include <cstdint>
+#include <unordered_map>
+
+#include "StringUtils.h"
+
+/**
+*	Interned path ID. Search paths store one so queries can match them by comparing integers.
+*/
+typedef uint32_t PathID_t;
+
+namespace PathID
+{
+enum : PathID_t
+{
+	/**
+	*	The search path has no path ID.
+	*/
+	NONE	= 0,
+
+	/**
+	*	Used by queries that didn't give a path ID. Matches all search paths.
+	*/
+	ANY		= UINT32_MAX,
+
+	/**
+	*	Used by queries that gave a path ID that no search path has. Matches no search paths.
+	*/
+	UNKNOWN	= UINT32_MAX - 1,
+};
+}
+
+/**
+*	Interns path IDs into small integers, starting at 1. IDs are never reused until the table is cleared.
+*	Not synchronized; the filesystem only modifies it while holding the exclusive search path lock.
+*/
+class CPathIDTable
+{
+public:
+	CPathIDTable() = default;
+
+	/**
+	*	@return Number of path IDs that were interned.
+	*/
+	size_t GetCount() const { return m_IDs.size(); }
+
+	/**
+	*	Interns a path ID for a search path that is being added.
+	*	@return The path ID's integer, or PathID::NONE if the path ID is null.
+	*/
+	PathID_t Intern( const char* pszPathID );
+
+	/**
+	*	Looks up a path ID given to a query.
+	*	@return The path ID's integer, PathID::ANY if the path ID is null, or PathID::UNKNOWN if it was never interned.
+	*/
+	PathID_t Find( const char* pszPathID ) const;
+
+	/**
+	*	Removes all path IDs.
+	*/
+	void Clear();
+
+private:
+	/**
+	*	Keyed on names interned in the string pool, which remain valid after the table is cleared.
+	*/
+	std::unordered_map<const char*, PathID_t, Hash_C_String<const char*>, EqualTo_C_String<const char*>> m_IDs;
+
+private:
+	CPathIDTable( const CPathIDTable& ) = delete;
+	CPathIDTable& operator=( const CPathIDTable& ) = delete;
+};
+
+#endif //FILESYSTEM_CPATHIDTABLE_H
@@ -0,0 +1,316 @@
+#include <algorithm>
+#include <cstring>
+#include <experimental/filesystem>
+
+#include "Platform.h"
+
+#include "CSearchPath.h"
+
+#include "CPathIndex.h"
+
+namespace fs = std::experimental::filesystem;
+
+void CPathIndex::Clear()
+{
+	m_Entries.clear();
+
+	m_PendingPacks.clear();
+	m_bHasPendingPacks = false;
+
+	m_HashedPacks.clear();
+}
+
+void CPathIndex::Rebuild( const std::vector<std::unique_ptr<CSearchPath>>& searchPaths )
+{
+	Clear();
+
+	for( size_t uiIndex = 0; uiIndex < searchPaths.size(); ++uiIndex )
+	{
+		AddSearchPath( *searchPaths[ uiIndex ], uiIndex );
+	}
+}
+
+void CPathIndex::AddSearchPath( CSearchPath& searchPath, const size_t uiOrder )
+{
+	if( searchPath.IsPackFile() && searchPath.packEntries.IsHashed() && !m_bFoldCase )
+	{
+		auto it = std::upper_bound( m_HashedPacks.begin(), m_HashedPacks.end(), uiOrder, 
+			[]( const size_t uiOrder, const PackSearchPath_t& other )
+			{
+				return uiOrder < other.uiOrder;
+			}
+		);
+
+		m_HashedPacks.insert( it, { &searchPath, uiOrder } );
+
+		return;
+	}
+
+	if( searchPath.IsPackFile() )
+	{
+		m_PendingPacks.push_back( { &searchPath, uiOrder } );
+		m_bHasPendingPacks = true;
+
+		return;
+	}
+
+	if( searchPath.IsMemory() )
+	{
+		for( const auto& file : searchPath.memoryFiles )
+		{
+			AddLocation( MakeKey( file.first.c_str() ), { &searchPath, nullptr, uiOrder, false, m_bFoldCase ? file.first : "" } );
+		}
+
+		return;
+	}
+
+	std::error_code error;
+
+	fs::recursive_directory_iterator it( searchPath.szPath, error );
+
+	if( error )
+		return;
+
+	const size_t uiPathLength = strlen( searchPath.szPath );
+
+	for( fs::recursive_directory_iterator end; it != end; it.increment( error ) )
+	{
+		if( error )
+			break;
+
+		const auto szFileName = it->path().u8string();
+
+		//Skip the slash that separates the search path from the relative path.
+		if( szFileName.length() <= uiPathLength + 1 )
+			continue;
+
+		const char* pszRelativeName = szFileName.c_str() + uiPathLength + 1;
+
+		AddLocation( MakeKey( pszRelativeName ), 
+					 { &searchPath, nullptr, uiOrder, fs::is_directory( it->status() ), m_bFoldCase ? pszRelativeName : "" } );
+	}
+}
+
+void CPathIndex::AddFile( CSearchPath& searchPath, const size_t uiOrder, const char* pszFileName, const bool bIsDirectory )
+{
+	auto szKey = MakeKey( pszFileName );
+
+	auto it = m_Entries.find( szKey.c_str() );
+
+	if( it != m_Entries.end() )
+	{
+		for( const auto& location : it->second->locations )
+		{
+			if( location.pSearchPath == &searchPath )
+				return;
+		}
+	}
+
+	AddLocation( std::move( szKey ), { &searchPath, nullptr, uiOrder, bIsDirectory, m_bFoldCase ? pszFileName : "" } );
+}
+
+void CPathIndex::RemoveFile( const CSearchPath& searchPath, const char* pszFileName )
+{
+	auto it = FindEntry( pszFileName );
+
+	if( it == m_Entries.end() )
+		return;
+
+	auto& locations = it->second->locations;
+
+	locations.erase( std::remove_if( locations.begin(), locations.end(), 
+		[ & ]( const Location_t& location )
+		{
+			return location.pSearchPath == &searchPath;
+		}
+	), locations.end() );
+
+	if( locations.empty() )
+		m_Entries.erase( it );
+}
+
+void CPathIndex::RemoveTree( const CSearchPath& searchPath, const char* pszFileName )
+{
+	const auto szKey = MakeKey( pszFileName );
+
+	for( auto it = m_Entries.begin(); it != m_Entries.end(); )
+	{
+		const auto& szEntryKey = it->second->szKey;
+
+		if( szEntryKey.compare( 0, szKey.length(), szKey ) != 0 ||
+			( szEntryKey.length() > szKey.length() && szEntryKey[ szKey.length() ] != '/' ) )
+		{
+			++it;
+			continue;
+		}
+
+		auto& locations = it->second->locations;
+
+		locations.erase( std::remove_if( locations.begin(), locations.end(), 
+			[ & ]( const Location_t& location )
+			{
+				return location.pSearchPath == &searchPath;
+			}
+		), locations.end() );
+
+		if( locations.empty() )
+			it = m_Entries.erase( it );
+		else
+			++it;
+	}
+}
+
+const CPathIndex::Locations_t* CPathIndex::Find( const char* pszFileName, Locations_t* pMerged )
+{
+	IndexPendingPacks();
+
+	char szKey[ MAX_PATH ];
+
+	//Names that are too long can't be in the index.
+	if( !NormalizeKey( pszFileName, m_bFoldCase, szKey, sizeof( szKey ) ) )
+		return nullptr;
+
+	auto it = m_Entries.find( szKey );
+
+	const Locations_t* pLocations = it != m_Entries.end() ? &it->second->locations : nullptr;
+
+	if( !pMerged || m_HashedPacks.empty() )
+		return pLocations;
+
+	pMerged->clear();
+
+	for( const auto& pack : m_HashedPacks )
+	{
+		if( auto pEntry = pack.pSearchPath->packEntries.Find( szKey ) )
+			pMerged->push_back( { pack.pSearchPath, pEntry, pack.uiOrder, false } );
+	}
+
+	if( pMerged->empty() )
+		return pLocations;
+
+	if( pLocations )
+	{
+		const auto middle = pMerged->insert( pMerged->end(), pLocations->begin(), pLocations->end() );
+
+		std::inplace_merge( pMerged->begin(), middle, pMerged->end(), 
+			[]( const Location_t& lhs, const Location_t& rhs )
+			{
+				return lhs.uiOrder < rhs.uiOrder;
+			}
+		);
+	}
+
+	return pMerged;
+}
+
+std::string CPathIndex::NormalizeKey( const char* pszFileName, const bool bFoldCase )
+{
+	std::string szKey( strlen( pszFileName ) + 1, '\0' );
+
+	NormalizeKey( pszFileName, bFoldCase, &szKey[ 0 ], szKey.size() );
+
+	szKey.resize( strlen( szKey.c_str() ) );
+
+	return szKey;
+}
+
+bool CPathIndex::NormalizeKey( const char* pszFileName, const bool bFoldCase, char* pszKey, const size_t uiKeySize )
+{
+	if( uiKeySize == 0 )
+		return false;
+
+	while( pszFileName[ 0 ] == '.' && ( pszFileName[ 1 ] == '/' || pszFileName[ 1 ] == '\\' ) )
+		pszFileName += 2;
+
+	size_t uiLength = 0;
+
+	for( auto pszChar = pszFileName; *pszChar; ++pszChar )
+	{
+		char c = *pszChar == '\\' ? '/' : *pszChar;
+
+		if( c == '/' && ( uiLength == 0 || pszKey[ uiLength - 1 ] == '/' ) )
+			continue;
+
+		//Only ASCII is folded, so the result doesn't depend on the locale.
+		if( bFoldCase && c >= 'A' && c <= 'Z' )
+			c += 'a' - 'A';
+
+		//Leave room for the terminator.
+		if( uiLength + 1 >= uiKeySize )
+		{
+			pszKey[ uiLength ] = '\0';
+			return false;
+		}
+
+		pszKey[ uiLength++ ] = c;
+	}
+
+	pszKey[ uiLength ] = '\0';
+
+	return true;
+}
+
+void CPathIndex::AddLocation( std::string&& szKey, Location_t&& location )
+{
+	auto itEntry = m_Entries.find( szKey.c_str() );
+
+	if( itEntry == m_Entries.end() )
+	{
+		auto entry = std::make_unique<Entry_t>();
+
+		entry->szKey = std::move( szKey );
+
+		const char* const pszKey = entry->szKey.c_str();
+
+		itEntry = m_Entries.emplace( pszKey, std::move( entry ) ).first;
+	}
+
+	auto& locations = itEntry->second->locations;
+
+	//Keep the locations in search path order so the first match is the highest priority.
+	auto it = std::upper_bound( locations.begin(), locations.end(), location.uiOrder, 
+		[]( const size_t uiOrder, const Location_t& other )
+		{
+			return uiOrder < other.uiOrder;
+		}
+	);
+
+	locations.insert( it, std::move( location ) );
+}
+
+void CPathIndex::AddPackEntries( CSearchPath& searchPath, const size_t uiOrder )
+{
+	for( const auto& entry : searchPath.packEntries )
+	{
+		AddLocation( MakeKey( entry.GetFileName() ), { &searchPath, &entry, uiOrder, false } );
+	}
+}
+
+void CPathIndex::IndexPendingPacksLocked()
+{
+	std::lock_guard<std::mutex> lock( m_PendingMutex );
+
+	//Another thread may have indexed them while this one was waiting.
+	if( !m_bHasPendingPacks.load( std::memory_order_relaxed ) )
+		return;
+
+	for( const auto& pending : m_PendingPacks )
+	{
+		AddPackEntries( *pending.pSearchPath, pending.uiOrder );
+	}
+
+	m_PendingPacks.clear();
+
+	m_bHasPendingPacks.store( false, std::memory_order_release );
+}
+
+CPathIndex::Entries_t::const_iterator CPathIndex::FindEntry( const char* pszFileName ) const
+{
+	char szKey[ MAX_PATH ];
+
+	//Names that are too long can't be in the index.
+	if( !NormalizeKey( pszFileName, m_bFoldCase, szKey, sizeof( szKey ) ) )
+		return m_Entries.end();
+
+	return m_Entries.find( szKey );
+}
@@ -0,0 +1,195 @@
+#ifndef FILESYSTEM_CPATHINDEX_H
+#define FILESYSTEM_CPATHINDEX_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "StringUtils.h"
+
+class CPackFileEntry;
+struct CSearchPath;
+
+/**
+*	Maps normalized relative file names to the search paths that provide them, in search path order.
+*	Pack files are immutable, so their entries are always accurate.
+*	Pack files are indexed by the first lookup after they are added, so adding them doesn't have to load their directories.
+*	Hashed pack files aren't indexed at all: lookups search their directories directly, so mounting one costs nothing per file.
+*	Loose search paths are scanned when they are added; files created by the filesystem are added afterwards,
+*	but changes made outside of the filesystem aren't seen until the search path is re-added.
+*	Memory search paths are indexed when they are added, and when files are added to or removed from them.
+*/
+class CPathIndex
+{
+public:
+	struct Location_t
+	{
+		CSearchPath* pSearchPath;
+
+		/**
+		*	If the search path is a pack file, the entry. Otherwise, null.
+		*/
+		const CPackFileEntry* pEntry;
+
+		/**
+		*	Position of the search path in the search path list. Used to keep locations ordered.
+		*/
+		size_t uiOrder;
+
+		bool bIsDirectory;
+
+		/**
+		*	If case is folded, the name of the loose or memory file, relative to the search path. Otherwise, empty.
+		*/
+		std::string szFileName;
+
+		/**
+		*	@return Name to open the file with, relative to the search path.
+		*/
+		const char* GetFileName( const char* pszQueryName ) const
+		{
+			return szFileName.empty() ? pszQueryName : szFileName.c_str();
+		}
+	};
+
+	typedef std::vector<Location_t> Locations_t;
+
+public:
+	CPathIndex() = default;
+
+	bool IsFoldingCase() const { return m_bFoldCase; }
+
+	/**
+	*	Sets whether keys are case folded. The index must be rebuilt afterwards.
+	*/
+	void SetFoldCase( const bool bFoldCase ) { m_bFoldCase = bFoldCase; }
+
+	/**
+	*	Removes all entries.
+	*/
+	void Clear();
+
+	/**
+	*	Clears the index and indexes all of the given search paths.
+	*/
+	void Rebuild( const std::vector<std::unique_ptr<CSearchPath>>& searchPaths );
+
+	/**
+	*	Indexes all files in the given search path. Pack files are queued and indexed by the next lookup.
+	*	Hashed pack files are searched directly unless case is folded, since their directories can't be searched case insensitively.
+	*	@param searchPath Search path to index.
+	*	@param uiOrder Position of the search path in the search path list.
+	*/
+	void AddSearchPath( CSearchPath& searchPath, const size_t uiOrder );
+
+	/**
+	*	Adds a single file or directory provided by a loose or memory search path.
+	*/
+	void AddFile( CSearchPath& searchPath, const size_t uiOrder, const char* pszFileName, const bool bIsDirectory = false );
+
+	/**
+	*	Removes a single file provided by a loose or memory search path.
+	*/
+	void RemoveFile( const CSearchPath& searchPath, const char* pszFileName );
+
+	/**
+	*	Removes a file or directory provided by a loose search path, and everything below it.
+	*	Visits every entry, so this is only meant for changes made outside of the filesystem.
+	*/
+	void RemoveTree( const CSearchPath& searchPath, const char* pszFileName );
+
+	/**
+	*	Finds all locations that provide the given file or directory.
+	*	Indexes queued pack files first. Safe to use from multiple threads, as long as nothing modifies the index.
+	*	@param pMerged If not null, hashed pack files are searched as well, and if any of them provide the file,
+	*		this receives the indexed locations merged with theirs. Callers that only want loose files can leave it out.
+	*	@return List of locations in search path order, or null if no search path is known to provide it.
+	*/
+	const Locations_t* Find( const char* pszFileName, Locations_t* pMerged = nullptr );
+
+	/**
+	*	Converts a relative file name to the form used as an index key.
+	*	Separators are converted to forward slashes, and leading "./" and duplicate separators are removed.
+	*	@param bFoldCase Whether to convert ASCII letters to lowercase.
+	*/
+	static std::string NormalizeKey( const char* pszFileName, const bool bFoldCase = false );
+
+	/**
+	*	Converts a relative file name to the form used as an index key, without allocating.
+	*	@param pszKey Buffer that receives the key. Keys are never longer than the file name.
+	*	@param uiKeySize Size of the buffer, in characters.
+	*	@return Whether the key fit in the buffer.
+	*/
+	static bool NormalizeKey( const char* pszFileName, const bool bFoldCase, char* pszKey, const size_t uiKeySize );
+
+	/**
+	*	Converts a relative file name to this index's key.
+	*/
+	std::string MakeKey( const char* pszFileName ) const { return NormalizeKey( pszFileName, m_bFoldCase ); }
+
+private:
+	struct Entry_t
+	{
+		std::string szKey;
+		Locations_t locations;
+	};
+
+	/**
+	*	Keyed on the entry's own key so lookups can use a key built on the stack.
+	*/
+	typedef std::unordered_map<const char*, std::unique_ptr<Entry_t>, Hash_C_String<const char*>, EqualTo_C_String<const char*>> Entries_t;
+
+	struct PackSearchPath_t
+	{
+		CSearchPath* pSearchPath;
+		size_t uiOrder;
+	};
+
+private:
+	void AddLocation( std::string&& szKey, Location_t&& location );
+
+	void AddPackEntries( CSearchPath& searchPath, const size_t uiOrder );
+
+	/**
+	*	Indexes all queued pack files.
+	*/
+	void IndexPendingPacks()
+	{
+		if( m_bHasPendingPacks.load( std::memory_order_acquire ) )
+			IndexPendingPacksLocked();
+	}
+
+	void IndexPendingPacksLocked();
+
+	/**
+	*	Finds the entry for the given file name.
+	*/
+	Entries_t::const_iterator FindEntry( const char* pszFileName ) const;
+
+private:
+	Entries_t m_Entries;
+
+	bool m_bFoldCase = false;
+
+	/**
+	*	Pack files that were added but not indexed yet. Lookups can happen on multiple threads, so indexing them is guarded.
+	*/
+	std::mutex m_PendingMutex;
+	std::vector<PackSearchPath_t> m_PendingPacks;
+	std::atomic<bool> m_bHasPendingPacks{ false };
+
+	/**
+	*	Hashed pack files, in search path order.
+	*/
+	std::vector<PackSearchPath_t> m_HashedPacks;
+
+private:
+	CPathIndex( const CPathIndex& ) = delete;
+	CPathIndex& operator=( const CPathIndex& ) = delete;
+};
+
+#endif //FILESYSTEM_CPATHINDEX_H
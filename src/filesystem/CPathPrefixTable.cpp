@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+#include "CSearchPath.h"
+
+#include "CPathPrefixTable.h"
+
+namespace
+{
+inline bool IsSeparator( const char c )
+{
+	return c == '/' || c == '\\';
+}
+}
+
+void CPathPrefixTable::Add( const CSearchPath& searchPath )
+{
+	//Memory search paths have no full path.
+	if( searchPath.IsMemory() )
+		return;
+
+	const Entry_t entry{ &searchPath, strlen( searchPath.szPath ) };
+
+	m_Entries.insert( std::upper_bound( m_Entries.begin(), m_Entries.end(), entry, &CPathPrefixTable::Less ), entry );
+}
+
+void CPathPrefixTable::Rebuild( const std::vector<std::unique_ptr<CSearchPath>>& searchPaths )
+{
+	m_Entries.clear();
+
+	for( const auto& searchPath : searchPaths )
+	{
+		if( !searchPath->IsMemory() )
+			m_Entries.push_back( { searchPath.get(), strlen( searchPath->szPath ) } );
+	}
+
+	std::sort( m_Entries.begin(), m_Entries.end(), &CPathPrefixTable::Less );
+}
+
+const CSearchPath* CPathPrefixTable::Find( const char* pszFullPath, size_t& uiRelativeOffset ) const
+{
+	uiRelativeOffset = 0;
+
+	if( m_Entries.empty() )
+		return nullptr;
+
+	const CSearchPath* pResult = nullptr;
+
+	//Every directory the path is in could be a search path. Roots keep their trailing separator, so try the prefix with and without it.
+	for( size_t uiIndex = 0; pszFullPath[ uiIndex ]; ++uiIndex )
+	{
+		//This should only be used to get relative paths to files and perhaps directories, so empty relative paths aren't returned.
+		if( !IsSeparator( pszFullPath[ uiIndex ] ) || !pszFullPath[ uiIndex + 1 ] )
+			continue;
+
+		for( size_t uiLength = uiIndex; uiLength <= uiIndex + 1; ++uiLength )
+		{
+			auto pSearchPath = uiLength > 0 ? FindExact( pszFullPath, uiLength ) : nullptr;
+
+			if( pSearchPath && ( !pResult || pSearchPath->uiOrder < pResult->uiOrder ) )
+			{
+				pResult = pSearchPath;
+				uiRelativeOffset = uiIndex + 1;
+			}
+		}
+	}
+
+	return pResult;
+}
+
+int CPathPrefixTable::Compare( const char* pszLHS, size_t uiLHSLength, const char* pszRHS, size_t uiRHSLength )
+{
+	const size_t uiLength = std::min( uiLHSLength, uiRHSLength );
+
+	for( size_t uiIndex = 0; uiIndex < uiLength; ++uiIndex )
+	{
+		const int iLHS = tolower( static_cast<unsigned char>( pszLHS[ uiIndex ] ) );
+		const int iRHS = tolower( static_cast<unsigned char>( pszRHS[ uiIndex ] ) );
+
+		if( iLHS != iRHS )
+			return iLHS < iRHS ? -1 : 1;
+	}
+
+	if( uiLHSLength != uiRHSLength )
+		return uiLHSLength < uiRHSLength ? -1 : 1;
+
+	return 0;
+}
+
+bool CPathPrefixTable::Less( const Entry_t& lhs, const Entry_t& rhs )
+{
+	const int iResult = Compare( lhs.pSearchPath->szPath, lhs.uiLength, rhs.pSearchPath->szPath, rhs.uiLength );
+
+	if( iResult != 0 )
+		return iResult < 0;
+
+	return lhs.pSearchPath->uiOrder < rhs.pSearchPath->uiOrder;
+}
+
+const CSearchPath* CPathPrefixTable::FindExact( const char* pszPath, size_t uiLength ) const
+{
+	auto it = std::lower_bound( m_Entries.begin(), m_Entries.end(), uiLength, 
+		[ pszPath ]( const Entry_t& entry, const size_t uiLength )
+		{
+			return Compare( entry.pSearchPath->szPath, entry.uiLength, pszPath, uiLength ) < 0;
+		}
+	);
+
+	if( it == m_Entries.end() || Compare( it->pSearchPath->szPath, it->uiLength, pszPath, uiLength ) != 0 )
+		return nullptr;
+
+	return it->pSearchPath;
+}
@@ -0,0 +1,68 @@
+#ifndef FILESYSTEM_CPATHPREFIXTABLE_H
+#define FILESYSTEM_CPATHPREFIXTABLE_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+struct CSearchPath;
+
+/**
+*	Paths of the search paths sorted case insensitively, for converting full paths to relative paths.
+*	A full path is looked up by binary searching for each of its leading directories, so lookups don't depend on the number of search paths.
+*	Not synchronized; the filesystem only modifies it while holding the exclusive search path lock.
+*/
+class CPathPrefixTable
+{
+public:
+	CPathPrefixTable() = default;
+
+	/**
+	*	Adds a search path that was appended to the search paths. Its order must have been assigned.
+	*/
+	void Add( const CSearchPath& searchPath );
+
+	/**
+	*	Replaces the table with the given search paths. Their orders must have been assigned.
+	*/
+	void Rebuild( const std::vector<std::unique_ptr<CSearchPath>>& searchPaths );
+
+	/**
+	*	Finds the first search path, in search path order, whose path contains the given full path.
+	*	@param pszFullPath Full path, with the platform's separators.
+	*	@param[ out ] uiRelativeOffset Offset of the path relative to the search path in pszFullPath.
+	*	@return The search path, or null if no search path contains the full path, or it names a search path itself.
+	*/
+	const CSearchPath* Find( const char* pszFullPath, size_t& uiRelativeOffset ) const;
+
+private:
+	struct Entry_t
+	{
+		const CSearchPath* pSearchPath;
+		size_t uiLength;
+	};
+
+	/**
+	*	Compares paths case insensitively, the same way search paths are compared everywhere else.
+	*/
+	static int Compare( const char* pszLHS, size_t uiLHSLength, const char* pszRHS, size_t uiRHSLength );
+
+	/**
+	*	Orders entries by path, and then by search path order so the first of several identical paths comes first.
+	*/
+	static bool Less( const Entry_t& lhs, const Entry_t& rhs );
+
+	/**
+	*	@return The first search path with the given path, or null if there is none.
+	*/
+	const CSearchPath* FindExact( const char* pszPath, size_t uiLength ) const;
+
+private:
+	std::vector<Entry_t> m_Entries;
+
+private:
+	CPathPrefixTable( const CPathPrefixTable& ) = delete;
+	CPathPrefixTable& operator=( const CPathPrefixTable& ) = delete;
+};
+
+#endif //FILESYSTEM_CPATHPREFIXTABLE_H
@@ -0,0 +1,304 @@
+#include <algorithm>
+#include <limits>
+
+#include "Platform.h"
+
+#include "CBlockCache.h"
+#include "CFileHandle.h"
+#include "CStreamingPack.h"
+
+#include "CPrefetcher.h"
+
+const CPrefetcher::GroupHandle_t CPrefetcher::INVALID_GROUP;
+const CPrefetcher::GroupHandle_t CPrefetcher::HINT_GROUP;
+const size_t CPrefetcher::READ_BUFFER_SIZE;
+const size_t CPrefetcher::PAGE_SIZE;
+
+CPrefetcher::~CPrefetcher()
+{
+	Shutdown();
+}
+
+CPrefetcher::GroupHandle_t CPrefetcher::AddGroup( std::vector<CAsyncReader::Source_t>&& sources )
+{
+	if( sources.empty() )
+		return INVALID_GROUP;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	const auto handle = m_NextGroup;
+
+	m_NextGroup = handle == std::numeric_limits<GroupHandle_t>::max() ? HINT_GROUP + 1 : handle + 1;
+
+	auto& group = m_Groups[ handle ];
+
+	group = Group_t();
+
+	AddToGroup( group, sources );
+
+	for( auto& source : sources )
+	{
+		m_Queue.push_back( { handle, std::move( source ) } );
+	}
+
+	StartWorker();
+
+	m_WorkAvailable.notify_one();
+
+	return handle;
+}
+
+void CPrefetcher::AddHints( std::vector<CAsyncReader::Source_t>&& sources, bool bForgetEverything )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto& group = m_Groups[ HINT_GROUP ];
+
+	if( bForgetEverything )
+	{
+		RemoveJobs( HINT_GROUP );
+		group = Group_t();
+	}
+
+	if( sources.empty() )
+		return;
+
+	AddToGroup( group, sources );
+
+	//Hints are less important than files that are being waited on, so they go to the back of the queue.
+	for( auto& source : sources )
+	{
+		m_Queue.push_back( { HINT_GROUP, std::move( source ) } );
+	}
+
+	StartWorker();
+
+	m_WorkAvailable.notify_one();
+}
+
+bool CPrefetcher::GetProgress( GroupHandle_t handle, float& flProgress, bool& bComplete )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto it = m_Groups.find( handle );
+
+	if( it == m_Groups.end() )
+	{
+		flProgress = 0;
+		bComplete = true;
+		return false;
+	}
+
+	const auto& group = it->second;
+
+	bComplete = group.uiCompleted >= group.uiTotal;
+
+	//Files can be any size, so counting them makes progress jump around.
+	if( bComplete )
+		flProgress = 1;
+	else if( group.bSized && group.uiTotalBytes > 0 )
+		flProgress = static_cast<float>( static_cast<double>( group.uiCompletedBytes ) / group.uiTotalBytes );
+	else
+		flProgress = static_cast<float>( group.uiCompleted ) / group.uiTotal;
+
+	return true;
+}
+
+void CPrefetcher::CancelGroup( GroupHandle_t handle )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	RemoveJobs( handle );
+
+	m_Groups.erase( handle );
+}
+
+bool CPrefetcher::SetPaused( bool bPaused )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	const bool bWasPaused = m_bPaused;
+
+	m_bPaused = bPaused;
+
+	if( !bPaused )
+		m_WorkAvailable.notify_one();
+
+	return bWasPaused;
+}
+
+void CPrefetcher::Clear()
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	m_Queue.clear();
+	m_Groups.clear();
+
+	m_WorkFinished.wait( lock, [ this ]()
+	{
+		return !m_bBusy;
+	} );
+}
+
+void CPrefetcher::Shutdown()
+{
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bShutdown = true;
+
+		m_Queue.clear();
+		m_Groups.clear();
+	}
+
+	m_WorkAvailable.notify_one();
+
+	if( m_Thread.joinable() )
+		m_Thread.join();
+}
+
+void CPrefetcher::StartWorker()
+{
+	if( m_Thread.joinable() )
+		return;
+
+	m_bShutdown = false;
+
+	m_Thread = std::thread( &CPrefetcher::WorkerThread, this );
+}
+
+void CPrefetcher::WorkerThread()
+{
+	std::unique_ptr<uint8_t[]> buffer( new uint8_t[ READ_BUFFER_SIZE ] );
+
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( true )
+	{
+		m_WorkAvailable.wait( lock, [ this ]()
+		{
+			return m_bShutdown || ( !m_bPaused && !m_Queue.empty() );
+		} );
+
+		if( m_bShutdown )
+			break;
+
+		auto job = std::move( m_Queue.front() );
+
+		m_Queue.pop_front();
+
+		m_bBusy = true;
+
+		lock.unlock();
+
+		Prefetch( job.source, buffer.get() );
+
+		lock.lock();
+
+		m_bBusy = false;
+
+		auto it = m_Groups.find( job.group );
+
+		if( it != m_Groups.end() )
+		{
+			auto& group = it->second;
+
+			++group.uiCompleted;
+
+			const auto uiLength = GetPrefetchLength( job.source );
+
+			if( uiLength != CAsyncReader::UNKNOWN_LENGTH )
+				group.uiCompletedBytes += uiLength;
+
+			//Groups that are gone report being complete, so finished ones don't need to be kept around.
+			if( group.uiCompleted >= group.uiTotal )
+				m_Groups.erase( it );
+		}
+
+		m_WorkFinished.notify_all();
+	}
+}
+
+void CPrefetcher::AddToGroup( Group_t& group, const std::vector<CAsyncReader::Source_t>& sources )
+{
+	group.uiTotal += sources.size();
+
+	for( const auto& source : sources )
+	{
+		const auto uiLength = GetPrefetchLength( source );
+
+		if( uiLength != CAsyncReader::UNKNOWN_LENGTH )
+			group.uiTotalBytes += uiLength;
+		else
+			group.bSized = false;
+	}
+}
+
+uint64_t CPrefetcher::GetPrefetchLength( const CAsyncReader::Source_t& source )
+{
+	//Compressed entries are prefetched as stored, decompression happens when the data is read.
+	return source.codec != pack::Codec::NONE ? source.uiStoredLength : source.uiLength;
+}
+
+void CPrefetcher::Prefetch( const CAsyncReader::Source_t& source, uint8_t* pBuffer )
+{
+	const uint64_t uiLength = GetPrefetchLength( source );
+
+	//Streaming packs are fetched first, reading blocks that aren't present would put garbage in the block cache.
+	if( source.streaming && !source.streaming->Fetch( source.uiStartOffset, uiLength ) )
+		return;
+
+	if( source.pData )
+	{
+		//Touch every page so it gets faulted in.
+		const volatile uint8_t* pData = source.pData + source.uiStartOffset;
+
+		uint8_t uiSum = 0;
+
+		for( uint64_t uiOffset = 0; uiOffset < uiLength; uiOffset += PAGE_SIZE )
+		{
+			uiSum += pData[ uiOffset ];
+		}
+
+		( void ) uiSum;
+
+		return;
+	}
+
+	if( source.pFile )
+	{
+		for( uint64_t uiOffset = 0; uiOffset < uiLength; )
+		{
+			const auto uiSize = static_cast<size_t>( std::min<uint64_t>( READ_BUFFER_SIZE, uiLength - uiOffset ) );
+
+			//Pack files that use the block cache are prefetched into it.
+			const auto uiRead = CBlockCache::Read( source.pBlockCache, source.pFile, pBuffer, uiSize, source.uiStartOffset + uiOffset );
+
+			if( uiRead == 0 )
+				break;
+
+			uiOffset += uiRead;
+		}
+
+		return;
+	}
+
+	FILE* pFile = fopen64( source.szFileName.c_str(), "rb" );
+
+	if( !pFile )
+		return;
+
+	while( fread( pBuffer, 1, READ_BUFFER_SIZE, pFile ) == READ_BUFFER_SIZE )
+	{
+	}
+
+	fclose( pFile );
+}
+
+void CPrefetcher::RemoveJobs( GroupHandle_t handle )
+{
+	m_Queue.erase( std::remove_if( m_Queue.begin(), m_Queue.end(), [ = ]( const Job_t& job )
+	{
+		return job.group == handle;
+	} ), m_Queue.end() );
+}
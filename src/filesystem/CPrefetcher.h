@@ -0,0 +1,166 @@
+#ifndef FILESYSTEM_CPREFETCHER_H
+#define FILESYSTEM_CPREFETCHER_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "CAsyncReader.h"
+
+/**
+*	Reads files ahead of time on a background thread so the OS page cache, and the block cache for pack files, is warm when they are actually loaded.
+*	Files are grouped; each group tracks its own progress so loading screens can report it.
+*/
+class CPrefetcher
+{
+public:
+	typedef int GroupHandle_t;
+
+	/**
+	*	Group handle returned when there is nothing to prefetch.
+	*/
+	static const GroupHandle_t INVALID_GROUP = 0;
+
+	/**
+	*	Group used by hints. Hints are not waited on, so they share one group.
+	*/
+	static const GroupHandle_t HINT_GROUP = 1;
+
+	/**
+	*	Size of the buffer used to read files that aren't memory mapped.
+	*/
+	static const size_t READ_BUFFER_SIZE = 64 * 1024;
+
+	/**
+	*	Page size assumed when touching mapped data.
+	*/
+	static const size_t PAGE_SIZE = 4096;
+
+public:
+	CPrefetcher() = default;
+	~CPrefetcher();
+
+	/**
+	*	Creates a new group.
+	*	@param sources Files to prefetch. Must not be empty.
+	*	@return Handle to the group.
+	*/
+	GroupHandle_t AddGroup( std::vector<CAsyncReader::Source_t>&& sources );
+
+	/**
+	*	Adds files to the hint group.
+	*	@param sources Files to prefetch.
+	*	@param bForgetEverything Whether to discard hints that haven't been prefetched yet.
+	*/
+	void AddHints( std::vector<CAsyncReader::Source_t>&& sources, bool bForgetEverything );
+
+	/**
+	*	Gets the progress of a group.
+	*	@param handle Group handle.
+	*	@param flProgress Fraction of bytes that have been prefetched, or of files if the size of any file isn't known.
+	*	@param bComplete Whether all files have been prefetched.
+	*	@return Whether the group exists. Groups are removed once all of their files have been prefetched, after which they report being complete.
+	*/
+	bool GetProgress( GroupHandle_t handle, float& flProgress, bool& bComplete );
+
+	/**
+	*	Cancels a group. Files that haven't been prefetched yet are discarded.
+	*/
+	void CancelGroup( GroupHandle_t handle );
+
+	/**
+	*	Pauses or resumes prefetching. The file in progress is finished first.
+	*	@return Whether prefetching was paused before this call.
+	*/
+	bool SetPaused( bool bPaused );
+
+	/**
+	*	Discards all groups and waits for the file in progress to finish.
+	*	Must be called before any file referenced by a source is closed.
+	*/
+	void Clear();
+
+	/**
+	*	Clears all groups and stops the worker thread.
+	*	The thread is restarted if new files are added.
+	*/
+	void Shutdown();
+
+private:
+	struct Job_t
+	{
+		GroupHandle_t group;
+		CAsyncReader::Source_t source;
+	};
+
+	struct Group_t
+	{
+		size_t uiTotal = 0;
+		size_t uiCompleted = 0;
+
+		uint64_t uiTotalBytes = 0;
+		uint64_t uiCompletedBytes = 0;
+
+		/**
+		*	Whether the size of every file is known, so progress can be reported in bytes.
+		*/
+		bool bSized = true;
+	};
+
+	/**
+	*	Starts the worker if needed. Must be called with the mutex held.
+	*/
+	void StartWorker();
+
+	void WorkerThread();
+
+	/**
+	*	Adds files to a group's totals. Must be called with the mutex held.
+	*/
+	static void AddToGroup( Group_t& group, const std::vector<CAsyncReader::Source_t>& sources );
+
+	/**
+	*	@return Number of bytes read to prefetch a source, or CAsyncReader::UNKNOWN_LENGTH.
+	*/
+	static uint64_t GetPrefetchLength( const CAsyncReader::Source_t& source );
+
+	/**
+	*	Reads the given source.
+	*/
+	static void Prefetch( const CAsyncReader::Source_t& source, uint8_t* pBuffer );
+
+	/**
+	*	Removes all queued jobs for a group. Must be called with the mutex held.
+	*/
+	void RemoveJobs( GroupHandle_t handle );
+
+private:
+	std::mutex m_Mutex;
+
+	std::condition_variable m_WorkAvailable;
+	std::condition_variable m_WorkFinished;
+
+	std::deque<Job_t> m_Queue;
+
+	std::unordered_map<GroupHandle_t, Group_t> m_Groups;
+
+	std::thread m_Thread;
+
+	bool m_bShutdown = false;
+	bool m_bPaused = false;
+	bool m_bBusy = false;
+
+	GroupHandle_t m_NextGroup = HINT_GROUP + 1;
+
+private:
+	CPrefetcher( const CPrefetcher& ) = delete;
+	CPrefetcher& operator=( const CPrefetcher& ) = delete;
+};
+
+#endif //FILESYSTEM_CPREFETCHER_H
@@ -0,0 +1,86 @@
+#include "CReadBufferPool.h"
+
+std::unique_ptr<uint8_t[]> CReadBufferPool::Acquire( size_t uiSize, size_t& uiOutCapacity )
+{
+	const auto uiClass = GetSizeClass( uiSize );
+
+	if( uiClass == NUM_SIZE_CLASSES )
+	{
+		uiOutCapacity = uiSize;
+		return std::make_unique<uint8_t[]>( uiSize );
+	}
+
+	uiOutCapacity = MIN_BUFFER_SIZE << uiClass;
+
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	auto& freeBuffers = m_FreeBuffers[ uiClass ];
+
+	if( !freeBuffers.empty() )
+	{
+		auto buffer = std::move( freeBuffers.back() );
+
+		freeBuffers.pop_back();
+
+		m_uiRetainedBytes -= uiOutCapacity;
+
+		return buffer;
+	}
+
+	lock.unlock();
+
+	return std::unique_ptr<uint8_t[]>( new uint8_t[ uiOutCapacity ] );
+}
+
+void CReadBufferPool::Release( std::unique_ptr<uint8_t[]>&& buffer, size_t uiCapacity )
+{
+	if( !buffer )
+		return;
+
+	//Only buffers that came from a size class can be reused.
+	const auto uiClass = GetSizeClass( uiCapacity );
+
+	if( uiClass == NUM_SIZE_CLASSES || ( MIN_BUFFER_SIZE << uiClass ) != uiCapacity )
+	{
+		buffer.reset();
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	if( m_uiRetainedBytes + uiCapacity > MAX_RETAINED_BYTES )
+	{
+		lock.unlock();
+		buffer.reset();
+		return;
+	}
+
+	m_FreeBuffers[ uiClass ].emplace_back( std::move( buffer ) );
+
+	m_uiRetainedBytes += uiCapacity;
+}
+
+void CReadBufferPool::Clear()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	for( auto& freeBuffers : m_FreeBuffers )
+	{
+		freeBuffers.clear();
+	}
+
+	m_uiRetainedBytes = 0;
+}
+
+size_t CReadBufferPool::GetSizeClass( size_t uiSize )
+{
+	size_t uiClass = 0;
+
+	for( size_t uiClassSize = MIN_BUFFER_SIZE; uiClassSize < uiSize; uiClassSize <<= 1 )
+	{
+		if( ++uiClass == NUM_SIZE_CLASSES )
+			break;
+	}
+
+	return uiClass;
+}
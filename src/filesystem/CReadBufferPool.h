@@ -0,0 +1,78 @@
+#ifndef FILESYSTEM_CREADBUFFERPOOL_H
+#define FILESYSTEM_CREADBUFFERPOOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/**
+*	Pool of buffers handed out by GetReadBuffer for files that can't be accessed in place.
+*	Buffers are grouped into power of 2 size classes so they can be reused for files of similar size.
+*	The pool is synchronized, so buffers can be acquired and released from any thread.
+*/
+class CReadBufferPool
+{
+public:
+	/**
+	*	Smallest buffer size that is handed out.
+	*/
+	static const size_t MIN_BUFFER_SIZE = 4 * 1024;
+
+	/**
+	*	Buffers larger than this are allocated and freed directly instead of being pooled.
+	*/
+	static const size_t MAX_POOLED_BUFFER_SIZE = 16 * 1024 * 1024;
+
+	/**
+	*	Maximum number of bytes kept in free buffers. Released buffers beyond this are freed.
+	*/
+	static const size_t MAX_RETAINED_BYTES = 32 * 1024 * 1024;
+
+public:
+	CReadBufferPool() = default;
+
+	/**
+	*	Gets a buffer that is at least uiSize bytes large.
+	*	@param uiSize Minimum size of the buffer.
+	*	@param[ out ] uiOutCapacity Actual size of the buffer. Must be passed to Release.
+	*	@return The buffer.
+	*/
+	std::unique_ptr<uint8_t[]> Acquire( size_t uiSize, size_t& uiOutCapacity );
+
+	/**
+	*	Returns a buffer to the pool.
+	*	@param buffer Buffer to return.
+	*	@param uiCapacity Capacity returned by Acquire.
+	*/
+	void Release( std::unique_ptr<uint8_t[]>&& buffer, size_t uiCapacity );
+
+	/**
+	*	Frees all pooled buffers.
+	*/
+	void Clear();
+
+private:
+	static const size_t NUM_SIZE_CLASSES = 13;
+
+	static_assert( ( MIN_BUFFER_SIZE << ( NUM_SIZE_CLASSES - 1 ) ) == MAX_POOLED_BUFFER_SIZE, "Size classes must cover all pooled buffer sizes" );
+
+	/**
+	*	@return The size class for the given size, or NUM_SIZE_CLASSES if it doesn't fit in a pooled buffer.
+	*/
+	static size_t GetSizeClass( size_t uiSize );
+
+private:
+	std::mutex m_Mutex;
+
+	std::vector<std::unique_ptr<uint8_t[]>> m_FreeBuffers[ NUM_SIZE_CLASSES ];
+
+	size_t m_uiRetainedBytes = 0;
+
+private:
+	CReadBufferPool( const CReadBufferPool& ) = delete;
+	CReadBufferPool& operator=( const CReadBufferPool& ) = delete;
+};
+
+#endif //FILESYSTEM_CREADBUFFERPOOL_H
@@ -0,0 +1,305 @@
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+
+#include "ByteSwap.h"
+
+#include "CResourceManifest.h"
+
+const uint32_t CResourceManifest::FILE_ID;
+const uint32_t CResourceManifest::FILE_VERSION;
+
+namespace
+{
+template<typename T>
+void WriteValue( std::vector<uint8_t>& data, T value )
+{
+	value = LittleValue( value );
+
+	const auto pBytes = reinterpret_cast<const uint8_t*>( &value );
+
+	data.insert( data.end(), pBytes, pBytes + sizeof( T ) );
+}
+
+void WriteString( std::vector<uint8_t>& data, const std::string& szString )
+{
+	WriteValue( data, static_cast<uint16_t>( szString.length() ) );
+
+	data.insert( data.end(), szString.begin(), szString.end() );
+}
+
+/**
+*	Reads values from a manifest file, checking that there is enough data left.
+*/
+class CManifestReader final
+{
+public:
+	CManifestReader( const uint8_t* pData, size_t uiSize )
+		: m_pData( pData )
+		, m_uiSize( uiSize )
+	{
+	}
+
+	template<typename T>
+	bool Read( T& value )
+	{
+		if( m_uiSize - m_uiOffset < sizeof( T ) )
+			return false;
+
+		memcpy( &value, m_pData + m_uiOffset, sizeof( T ) );
+
+		m_uiOffset += sizeof( T );
+
+		value = LittleValue( value );
+
+		return true;
+	}
+
+	bool ReadString( std::string& szString )
+	{
+		uint16_t uiLength;
+
+		if( !Read( uiLength ) || m_uiSize - m_uiOffset < uiLength )
+			return false;
+
+		szString.assign( reinterpret_cast<const char*>( m_pData + m_uiOffset ), uiLength );
+
+		m_uiOffset += uiLength;
+
+		return true;
+	}
+
+private:
+	const uint8_t* const m_pData;
+	const size_t m_uiSize;
+
+	size_t m_uiOffset = 0;
+};
+}
+
+void CResourceManifest::Clear()
+{
+	m_uiSourceHash = 0;
+
+	m_Packs.clear();
+	m_Ranges.clear();
+	m_LooseFiles.clear();
+}
+
+uint64_t CResourceManifest::GetTotalBytes() const
+{
+	uint64_t uiBytes = 0;
+
+	for( const auto& range : m_Ranges )
+	{
+		uiBytes += range.uiLength;
+	}
+
+	for( const auto& file : m_LooseFiles )
+	{
+		uiBytes += file.uiSize;
+	}
+
+	return uiBytes;
+}
+
+void CResourceManifest::AddPackResource( const char* pszPackPath, const uint64_t uiOffset, const uint64_t uiLength )
+{
+	//Lists reference a handful of pack files at most.
+	auto it = std::find_if( m_Packs.begin(), m_Packs.end(), [ = ]( const Pack_t& pack )
+	{
+		return pack.szPath == pszPackPath;
+	} );
+
+	if( it == m_Packs.end() )
+	{
+		Pack_t pack;
+
+		pack.szPath = pszPackPath;
+
+		CMountIndexCache::GetKey( pszPackPath, 0, pack.key );
+
+		m_Packs.emplace_back( std::move( pack ) );
+
+		it = m_Packs.end() - 1;
+	}
+
+	m_Ranges.push_back( { static_cast<uint32_t>( it - m_Packs.begin() ), uiOffset, uiLength } );
+}
+
+void CResourceManifest::AddLooseFile( const char* pszPath, const uint64_t uiSize )
+{
+	m_LooseFiles.push_back( { pszPath, uiSize } );
+}
+
+void CResourceManifest::Finish( const uint64_t uiMaxGap, const uint64_t uiMaxRead )
+{
+	std::sort( m_Ranges.begin(), m_Ranges.end(), []( const Range_t& lhs, const Range_t& rhs )
+	{
+		return std::tie( lhs.uiPack, lhs.uiOffset ) < std::tie( rhs.uiPack, rhs.uiOffset );
+	} );
+
+	size_t uiMerged = 0;
+
+	for( size_t uiIndex = 0; uiIndex < m_Ranges.size(); ++uiIndex )
+	{
+		const auto& next = m_Ranges[ uiIndex ];
+
+		if( uiMerged > 0 )
+		{
+			auto& last = m_Ranges[ uiMerged - 1 ];
+
+			const uint64_t uiLastEnd = last.uiOffset + last.uiLength;
+			const uint64_t uiEnd = std::max( uiLastEnd, next.uiOffset + next.uiLength );
+
+			//Resources listed twice overlap themselves, and are merged regardless of size.
+			if( next.uiPack == last.uiPack && next.uiOffset <= uiLastEnd + uiMaxGap &&
+				( uiEnd - last.uiOffset <= uiMaxRead || next.uiOffset + next.uiLength <= uiLastEnd ) )
+			{
+				last.uiLength = uiEnd - last.uiOffset;
+				continue;
+			}
+		}
+
+		m_Ranges[ uiMerged++ ] = next;
+	}
+
+	m_Ranges.resize( uiMerged );
+}
+
+bool CResourceManifest::IsCurrent() const
+{
+	for( const auto& pack : m_Packs )
+	{
+		CMountIndexCache::Key_t key;
+
+		if( !CMountIndexCache::GetKey( pack.szPath.c_str(), 0, key ) || !( key == pack.key ) )
+			return false;
+	}
+
+	return true;
+}
+
+void CResourceManifest::Serialize( std::vector<uint8_t>& data ) const
+{
+	data.clear();
+
+	WriteValue( data, FILE_ID );
+	WriteValue( data, FILE_VERSION );
+	WriteValue( data, m_uiSourceHash );
+
+	WriteValue( data, static_cast<uint32_t>( m_Packs.size() ) );
+
+	for( const auto& pack : m_Packs )
+	{
+		WriteString( data, pack.szPath );
+		WriteValue( data, pack.key.uiSize );
+		WriteValue( data, pack.key.iModifiedTime );
+		WriteValue( data, static_cast<uint8_t>( pack.key.bValid ? 1 : 0 ) );
+	}
+
+	WriteValue( data, static_cast<uint32_t>( m_Ranges.size() ) );
+
+	for( const auto& range : m_Ranges )
+	{
+		WriteValue( data, range.uiPack );
+		WriteValue( data, range.uiOffset );
+		WriteValue( data, range.uiLength );
+	}
+
+	WriteValue( data, static_cast<uint32_t>( m_LooseFiles.size() ) );
+
+	for( const auto& file : m_LooseFiles )
+	{
+		WriteString( data, file.szPath );
+		WriteValue( data, file.uiSize );
+	}
+}
+
+bool CResourceManifest::Deserialize( const uint8_t* pData, size_t uiSize )
+{
+	Clear();
+
+	if( !pData )
+		return false;
+
+	CManifestReader reader( pData, uiSize );
+
+	uint32_t uiID, uiVersion, uiPackCount;
+
+	if( !reader.Read( uiID ) || uiID != FILE_ID ||
+		!reader.Read( uiVersion ) || uiVersion != FILE_VERSION ||
+		!reader.Read( m_uiSourceHash ) ||
+		!reader.Read( uiPackCount ) )
+	{
+		Clear();
+		return false;
+	}
+
+	for( uint32_t uiIndex = 0; uiIndex < uiPackCount; ++uiIndex )
+	{
+		Pack_t pack;
+		uint8_t uiValid;
+
+		if( !reader.ReadString( pack.szPath ) ||
+			!reader.Read( pack.key.uiSize ) ||
+			!reader.Read( pack.key.iModifiedTime ) ||
+			!reader.Read( uiValid ) )
+		{
+			Clear();
+			return false;
+		}
+
+		pack.key.bValid = uiValid != 0;
+
+		m_Packs.emplace_back( std::move( pack ) );
+	}
+
+	uint32_t uiRangeCount;
+
+	if( !reader.Read( uiRangeCount ) )
+	{
+		Clear();
+		return false;
+	}
+
+	for( uint32_t uiIndex = 0; uiIndex < uiRangeCount; ++uiIndex )
+	{
+		Range_t range;
+
+		if( !reader.Read( range.uiPack ) ||
+			!reader.Read( range.uiOffset ) ||
+			!reader.Read( range.uiLength ) ||
+			range.uiPack >= uiPackCount ||
+			range.uiOffset + range.uiLength < range.uiOffset )
+		{
+			Clear();
+			return false;
+		}
+
+		m_Ranges.emplace_back( range );
+	}
+
+	uint32_t uiLooseCount;
+
+	if( !reader.Read( uiLooseCount ) )
+	{
+		Clear();
+		return false;
+	}
+
+	for( uint32_t uiIndex = 0; uiIndex < uiLooseCount; ++uiIndex )
+	{
+		LooseFile_t file;
+
+		if( !reader.ReadString( file.szPath ) || !reader.Read( file.uiSize ) )
+		{
+			Clear();
+			return false;
+		}
+
+		m_LooseFiles.emplace_back( std::move( file ) );
+	}
+
+	return true;
+}
@@ -0,0 +1,127 @@
+#ifndef FILESYSTEM_CRESOURCEMANIFEST_H
+#define FILESYSTEM_CRESOURCEMANIFEST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "CMountIndexCache.h"
+
+/**
+*	A resource list (.lst) compiled against the search paths, so waiting for its resources needs no lookups.
+*	Resources in pack files are stored as ranges of the pack files, sorted and merged so they're read front to back in a few large reads.
+*	Loose files are stored by full path. Files in memory search paths are left out, since they're already in memory.
+*	A manifest is only valid for the search paths and resource list it was compiled from; the source hash identifies both.
+*	Pack files are identified like the mount index does, so a manifest is recompiled if a pack file it references changes.
+*/
+class CResourceManifest
+{
+public:
+	/**
+	*	Identifies manifest files. Stored as the first 4 bytes.
+	*/
+	static const uint32_t FILE_ID = ( 'M' << 24 ) | ( 'R' << 16 ) | ( 'S' << 8 ) | 'F';
+
+	static const uint32_t FILE_VERSION = 1;
+
+	struct Pack_t
+	{
+		/**
+		*	Full path of the pack file.
+		*/
+		std::string szPath;
+
+		CMountIndexCache::Key_t key;
+	};
+
+	/**
+	*	Part of a pack file to read. May cover several resources, and the gaps between them.
+	*/
+	struct Range_t
+	{
+		uint32_t uiPack;
+		uint64_t uiOffset;
+		uint64_t uiLength;
+	};
+
+	struct LooseFile_t
+	{
+		/**
+		*	Full path of the file.
+		*/
+		std::string szPath;
+		uint64_t uiSize;
+	};
+
+public:
+	CResourceManifest() = default;
+
+	void Clear();
+
+	/**
+	*	@return Hash of the resource list and search paths the manifest was compiled from.
+	*/
+	uint32_t GetSourceHash() const { return m_uiSourceHash; }
+
+	void SetSourceHash( const uint32_t uiHash ) { m_uiSourceHash = uiHash; }
+
+	const std::vector<Pack_t>& GetPacks() const { return m_Packs; }
+
+	/**
+	*	@return Ranges to read, sorted by pack file and offset.
+	*/
+	const std::vector<Range_t>& GetRanges() const { return m_Ranges; }
+
+	const std::vector<LooseFile_t>& GetLooseFiles() const { return m_LooseFiles; }
+
+	/**
+	*	@return Number of bytes read when prefetching the manifest.
+	*/
+	uint64_t GetTotalBytes() const;
+
+	/**
+	*	Adds a resource stored in a pack file.
+	*	@param uiOffset Offset of the resource's data in the pack file.
+	*	@param uiLength Length of the data as stored.
+	*/
+	void AddPackResource( const char* pszPackPath, const uint64_t uiOffset, const uint64_t uiLength );
+
+	void AddLooseFile( const char* pszPath, const uint64_t uiSize );
+
+	/**
+	*	Sorts the ranges and merges those that are close together. Must be called after all resources are added.
+	*	@param uiMaxGap Largest gap between two resources that is read through rather than split into two reads.
+	*	@param uiMaxRead Largest range that resources are merged into.
+	*/
+	void Finish( const uint64_t uiMaxGap, const uint64_t uiMaxRead );
+
+	/**
+	*	@return Whether all pack files the manifest references are unchanged on disk.
+	*/
+	bool IsCurrent() const;
+
+	/**
+	*	Writes the manifest in its file format.
+	*/
+	void Serialize( std::vector<uint8_t>& data ) const;
+
+	/**
+	*	Replaces the manifest with one read from a manifest file.
+	*	@return Whether the data was a valid manifest.
+	*/
+	bool Deserialize( const uint8_t* pData, size_t uiSize );
+
+private:
+	uint32_t m_uiSourceHash = 0;
+
+	std::vector<Pack_t> m_Packs;
+	std::vector<Range_t> m_Ranges;
+	std::vector<LooseFile_t> m_LooseFiles;
+
+private:
+	CResourceManifest( const CResourceManifest& ) = delete;
+	CResourceManifest& operator=( const CResourceManifest& ) = delete;
+};
+
+#endif //FILESYSTEM_CRESOURCEMANIFEST_H
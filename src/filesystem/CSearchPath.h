@@ -4,14 +4,21 @@
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <string>
 
 #include "Platform.h"
 
-#include "CPackFileEntry.h"
-
-#include "StringUtils.h"
+#include "CContentCache.h"
+#include "CDirectoryHandle.h"
+#include "CFileSystemStats.h"
+#include "CMappedFile.h"
+#include "CMountIndexCache.h"
+#include "MemoryResource.h"
+#include "CPackDirectory.h"
+#include "CPathIDTable.h"
 
 class CFileHandle;
+class CStreamingPack;
 
 typedef uint32_t SearchPathFlags_t;
 
@@ -22,12 +29,32 @@ namespace SearchPathFlag
 		NONE			= 0,
 		READ_ONLY		= 1 << 0,
 		IS_PACK_FILE	= 1 << 1,
+		IS_MEMORY		= 1 << 2,
+		IS_OVERLAY		= 1 << 3,
 	};
 };
 
 struct CSearchPath
 {
-	typedef std::map<const char*, std::unique_ptr<CPackFileEntry>, Less_C_String<const char*>> Entries_t;
+	typedef CPackDirectory Entries_t;
+
+	/**
+	*	A file in a memory search path.
+	*/
+	struct MemoryFile_t
+	{
+		CContentCache::BufferPtr_t contents;
+
+		/**
+		*	Time the file was added, in seconds.
+		*/
+		int64_t iModifiedTime;
+	};
+
+	/**
+	*	Files in a memory search path, keyed on normalized name. Sorted so they can be enumerated by prefix.
+	*/
+	typedef std::map<std::string, MemoryFile_t> MemoryFiles_t;
 
 	CSearchPath() = default;
 	CSearchPath( CSearchPath&& other ) = default;
@@ -35,16 +62,110 @@ struct CSearchPath
 
 	bool IsPackFile() const { return ( flags & SearchPathFlag::IS_PACK_FILE ) != 0; }
 
+	bool IsMemory() const { return ( flags & SearchPathFlag::IS_MEMORY ) != 0; }
+
+	/**
+	*	@return Whether this search path is a directory on disk.
+	*/
+	bool IsLoose() const { return ( flags & ( SearchPathFlag::IS_PACK_FILE | SearchPathFlag::IS_MEMORY ) ) == 0; }
+
+	/**
+	*	@return Whether this is a loose search path that is only changed through the filesystem, or whose changes are reported to it.
+	*/
+	bool IsOverlay() const { return ( flags & SearchPathFlag::IS_OVERLAY ) != 0; }
+
+	/**
+	*	@return Whether the path index always knows about every file in this search path, so lookups that miss it don't have to probe the disk.
+	*	Pack files and memory search paths are indexed when they're added. Loose search paths only if they're watched or an overlay.
+	*/
+	bool IsFullyIndexed() const { return !IsLoose() || bIsWatched || IsOverlay(); }
+
+	/**
+	*	@return Whether this search path should be considered for a query with the given interned path ID. PathID::ANY matches all search paths.
+	*/
+	bool MatchesPathID( const PathID_t id ) const
+	{
+		return id == PathID::ANY || id == pathID;
+	}
+
+	/**
+	*	Full path of the directory or pack file. Memory search paths use the name they were added with.
+	*/
 	char szPath[ MAX_PATH ];
 
+	/**
+	*	Path ID, interned in the string pool. Null if the search path has no path ID.
+	*/
 	const char* pszPathID;
 
+	/**
+	*	Interned pszPathID, assigned when the search path is added.
+	*/
+	PathID_t pathID = PathID::NONE;
+
+	/**
+	*	Position of this search path in the search path list, assigned when the search path is added.
+	*/
+	size_t uiOrder = 0;
+
 	SearchPathFlags_t flags;
 
 	std::unique_ptr<CFileHandle> packFile;
 
+	/**
+	*	If the pack file is memory mapped, this is the mapping. Entries are read from it instead of packFile.
+	*/
+	std::unique_ptr<CMappedFile> packMapping;
+
+	/**
+	*	If this is a pack file and PACK_DIRECTORY_ARENAS is set, the arena that packEntries is allocated from. Declared first so it's destroyed last.
+	*/
+	std::unique_ptr<CMonotonicResource> packResource;
+
 	Entries_t packEntries;
 
+	/**
+	*	If this is a compressed pack file, the size of the blocks that its entries are compressed in.
+	*/
+	uint32_t uiPackBlockSize = 0;
+
+	/**
+	*	If this is a pack file, its modification time in seconds when it was added. Used as the time of its entries.
+	*/
+	int64_t iPackFileTime = 0;
+
+	/**
+	*	If this is a pack file and the mount index is used, identifies the pack file's contents when it was added.
+	*/
+	CMountIndexCache::Key_t packKey;
+
+	/**
+	*	If this is a pack file that is installed while it's in use, the local copy's state. Entries must be fetched before they're read.
+	*/
+	std::shared_ptr<CStreamingPack> streaming;
+
+	/**
+	*	If this is a memory search path, its files. Reads are served from their contents and never touch the disk.
+	*/
+	MemoryFiles_t memoryFiles;
+
+	/**
+	*	If this is a loose search path, its directory. Files are opened and probed relative to it.
+	*	Null if the directory couldn't be opened or the platform doesn't support it; full paths are used instead.
+	*/
+	std::unique_ptr<CDirectoryHandle> directory;
+
+	/**
+	*	Whether changes made outside of the filesystem to this loose search path are tracked.
+	*	If so, the path index is always up to date, so lookups that miss it don't probe the disk.
+	*/
+	bool bIsWatched = false;
+
+	/**
+	*	I/O counters for this search path.
+	*/
+	CFileSystemStats::PathCounters_t* pStats = nullptr;
+
 private:
 	CSearchPath( const CSearchPath& ) = delete;
 	CSearchPath& operator=( const CSearchPath& ) = delete;
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <cstring>
+#include <experimental/filesystem>
+
+#include "CBlockCache.h"
+#include "CFileHandle.h"
+#include "CPathBuffer.h"
+#include "CPathIndex.h"
+#include "CSearchPath.h"
+
+#include "CSearchPathSnapshot.h"
+
+namespace fs = std::experimental::filesystem;
+
+CSearchPathSnapshot::CSearchPathSnapshot( const std::vector<std::unique_ptr<CSearchPath>>& searchPaths, CBlockCache* pBlockCache )
+	: m_pBlockCache( pBlockCache )
+{
+	m_SearchPaths.reserve( searchPaths.size() );
+
+	for( const auto& searchPath : searchPaths )
+	{
+		m_SearchPaths.push_back( searchPath.get() );
+
+		if( !searchPath->pszPathID )
+			continue;
+
+		const bool bKnown = std::any_of( m_PathIDs.begin(), m_PathIDs.end(), 
+			[ & ]( const std::pair<const char*, PathID_t>& pathID )
+			{
+				return pathID.second == searchPath->pathID;
+			}
+		);
+
+		if( !bKnown )
+			m_PathIDs.emplace_back( searchPath->pszPathID, searchPath->pathID );
+	}
+}
+
+CSearchPathSnapshot::~CSearchPathSnapshot()
+{
+	//Nothing reads through this snapshot anymore, so no blocks of the retired pack files can be added after this.
+	if( !m_Retired.empty() && m_pBlockCache )
+		m_pBlockCache->InvalidateAll();
+
+	m_Retired.clear();
+}
+
+CSearchPathSnapshot::Result CSearchPathSnapshot::Find( const char* pszFileName, const char* pszPathID, 
+													   const CSearchPath** ppSearchPath, const CPackFileEntry** ppEntry,
+													   char* pszName, const size_t uiNameSize ) const
+{
+	*ppSearchPath = nullptr;
+	*ppEntry = nullptr;
+
+	//Names that are too long can't be in any search path.
+	if( !CPathIndex::NormalizeKey( pszFileName, false, pszName, uiNameSize ) )
+		return Result::NOT_FOUND;
+
+#ifdef WIN32
+	std::replace( pszName, pszName + strlen( pszName ), '/', '\\' );
+#endif
+
+	PathID_t id = PathID::ANY;
+
+	if( pszPathID )
+	{
+		id = PathID::UNKNOWN;
+
+		for( const auto& pathID : m_PathIDs )
+		{
+			if( strcmp( pathID.first, pszPathID ) == 0 )
+			{
+				id = pathID.second;
+				break;
+			}
+		}
+
+		//Path IDs that no search path has match nothing.
+		if( id == PathID::UNKNOWN )
+			return Result::NOT_FOUND;
+	}
+
+	std::error_code error;
+
+	CPathBuffer path;
+
+	for( auto pSearchPath : m_SearchPaths )
+	{
+		if( !pSearchPath->MatchesPathID( id ) )
+			continue;
+
+		if( pSearchPath->IsPackFile() )
+		{
+			if( auto pEntry = pSearchPath->packEntries.Find( pszName ) )
+			{
+				*ppSearchPath = pSearchPath;
+				*ppEntry = pEntry;
+
+				return Result::FOUND;
+			}
+
+			continue;
+		}
+
+		if( pSearchPath->IsMemory() )
+			return Result::UNKNOWN;
+
+		bool bIsDirectory;
+
+		if( pSearchPath->directory )
+		{
+			CDirectoryHandle::Status_t status;
+
+			if( !pSearchPath->directory->GetStatus( pszName, status ) )
+				continue;
+
+			bIsDirectory = status.bIsDirectory;
+		}
+		else
+		{
+			if( !path.Set( pSearchPath->szPath, pszName ) )
+				continue;
+
+			const auto status = fs::status( path.Get(), error );
+
+			if( !fs::exists( status ) )
+				continue;
+
+			bIsDirectory = fs::is_directory( status );
+		}
+
+		//Directories shadow files further down, same as they do in the path index.
+		if( bIsDirectory )
+			return Result::NOT_FOUND;
+
+		*ppSearchPath = pSearchPath;
+
+		return Result::FOUND;
+	}
+
+	return Result::NOT_FOUND;
+}
+
+void CSearchPathSnapshot::Retire( std::unique_ptr<CSearchPath>&& searchPath )
+{
+	m_Retired.emplace_back( std::move( searchPath ) );
+}
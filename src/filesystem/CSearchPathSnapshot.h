@@ -0,0 +1,79 @@
+#ifndef FILESYSTEM_CSEARCHPATHSNAPSHOT_H
+#define FILESYSTEM_CSEARCHPATHSNAPSHOT_H
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "CPathIDTable.h"
+
+class CBlockCache;
+class CPackFileEntry;
+struct CSearchPath;
+
+/**
+*	Immutable view of the search paths, published by the filesystem whenever they change, so worker threads can look files up
+*	without taking the search path lock.
+*	Pack files are looked up in their directories, and loose search paths are probed on disk instead of through the path index,
+*	since the index changes whenever a file is written. Memory search paths change as well, so lookups that reach one can't be answered.
+*	Search paths that are removed while a snapshot references them are handed to it, and destroyed along with its last reference,
+*	so readers that still hold it can finish their reads.
+*/
+class CSearchPathSnapshot final
+{
+public:
+	enum class Result
+	{
+		FOUND = 0,
+		NOT_FOUND,
+
+		/**
+		*	A memory search path would have to be checked. The caller has to look the file up with the search path lock held.
+		*/
+		UNKNOWN
+	};
+
+public:
+	/**
+	*	@param searchPaths Search paths in search path order.
+	*	@param pBlockCache If not null, the block cache to invalidate when retired search paths are destroyed, since their file pointers can be reused.
+	*/
+	CSearchPathSnapshot( const std::vector<std::unique_ptr<CSearchPath>>& searchPaths, CBlockCache* pBlockCache );
+	~CSearchPathSnapshot();
+
+	/**
+	*	Finds the search path that provides the given file. Safe to use from any thread.
+	*	@param pszPathID Path ID to restrict the search to, or null to search all search paths.
+	*	@param[ out ] ppSearchPath Search path that provides the file.
+	*	@param[ out ] ppEntry If the search path is a pack file, the entry. Otherwise, null.
+	*	@param pszName Buffer that receives the normalized name, relative to the search path.
+	*	@param uiNameSize Size of the buffer, in characters.
+	*/
+	Result Find( const char* pszFileName, const char* pszPathID, const CSearchPath** ppSearchPath, const CPackFileEntry** ppEntry,
+				 char* pszName, const size_t uiNameSize ) const;
+
+	/**
+	*	Keeps a search path that is being removed alive until this snapshot is destroyed.
+	*	Must only be called by the filesystem, with the exclusive search path lock held.
+	*/
+	void Retire( std::unique_ptr<CSearchPath>&& searchPath );
+
+private:
+	std::vector<const CSearchPath*> m_SearchPaths;
+
+	/**
+	*	Interned path ID of each search path that has one, and its integer.
+	*/
+	std::vector<std::pair<const char*, PathID_t>> m_PathIDs;
+
+	CBlockCache* const m_pBlockCache;
+
+	std::vector<std::unique_ptr<CSearchPath>> m_Retired;
+
+private:
+	CSearchPathSnapshot( const CSearchPathSnapshot& ) = delete;
+	CSearchPathSnapshot& operator=( const CSearchPathSnapshot& ) = delete;
+};
+
+#endif //FILESYSTEM_CSEARCHPATHSNAPSHOT_H
@@ -0,0 +1,126 @@
+#include <chrono>
+
+#include "CStreamingPack.h"
+
+#include "CStreamingInstaller.h"
+
+const int CStreamingInstaller::RETRY_DELAY_SECONDS;
+const unsigned int CStreamingInstaller::SAVE_INTERVAL;
+
+CStreamingInstaller::~CStreamingInstaller()
+{
+	Shutdown();
+}
+
+void CStreamingInstaller::Add( std::shared_ptr<CStreamingPack> pack )
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Packs.emplace_back( std::move( pack ) );
+
+	if( !m_Thread.joinable() )
+	{
+		m_bShutdown = false;
+
+		m_Thread = std::thread( &CStreamingInstaller::WorkerThread, this );
+	}
+
+	m_Wake.notify_all();
+}
+
+bool CStreamingInstaller::IsComplete() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return !FindIncompletePack();
+}
+
+void CStreamingInstaller::GetProgress( uint64_t& uiAvailableBytes, uint64_t& uiTotalBytes ) const
+{
+	uiAvailableBytes = 0;
+	uiTotalBytes = 0;
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	for( const auto& pack : m_Packs )
+	{
+		uiAvailableBytes += pack->GetAvailableBytes();
+		uiTotalBytes += pack->GetSize();
+	}
+}
+
+void CStreamingInstaller::Shutdown()
+{
+	std::vector<std::shared_ptr<CStreamingPack>> packs;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bShutdown = true;
+
+		packs = m_Packs;
+	}
+
+	m_Wake.notify_all();
+
+	//The worker may be waiting for on-demand fetches to finish.
+	for( const auto& pack : packs )
+		pack->Wake();
+
+	if( m_Thread.joinable() )
+		m_Thread.join();
+
+	for( const auto& pack : packs )
+		pack->SaveState();
+}
+
+void CStreamingInstaller::WorkerThread()
+{
+	unsigned int uiFetches = 0;
+
+	while( true )
+	{
+		std::shared_ptr<CStreamingPack> pack;
+
+		{
+			std::unique_lock<std::mutex> lock( m_Mutex );
+
+			m_Wake.wait( lock, [ this, &pack ]()
+			{
+				pack = FindIncompletePack();
+
+				return m_bShutdown || pack;
+			} );
+
+			if( m_bShutdown )
+				break;
+		}
+
+		if( pack->FetchNext( m_bShutdown ) )
+		{
+			if( pack->IsComplete() || ++uiFetches % SAVE_INTERVAL == 0 )
+				pack->SaveState();
+
+			continue;
+		}
+
+		//The content source is unreachable, don't hammer it.
+		std::unique_lock<std::mutex> lock( m_Mutex );
+
+		m_Wake.wait_for( lock, std::chrono::seconds( RETRY_DELAY_SECONDS ), [ this ]()
+		{
+			return m_bShutdown.load();
+		} );
+	}
+}
+
+std::shared_ptr<CStreamingPack> CStreamingInstaller::FindIncompletePack() const
+{
+	for( const auto& pack : m_Packs )
+	{
+		if( !pack->IsComplete() )
+			return pack;
+	}
+
+	return nullptr;
+}
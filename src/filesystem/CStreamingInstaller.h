@@ -0,0 +1,80 @@
+#ifndef FILESYSTEM_CSTREAMINGINSTALLER_H
+#define FILESYSTEM_CSTREAMINGINSTALLER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class CStreamingPack;
+
+/**
+*	Downloads the rest of streaming pack files on a background thread, one pack file at a time in the order they were added.
+*	The worker yields to on-demand fetches, so files that are being loaded are never stuck behind the background download.
+*/
+class CStreamingInstaller
+{
+public:
+	/**
+	*	How long to wait before trying again after a fetch failed, in seconds.
+	*/
+	static const int RETRY_DELAY_SECONDS = 5;
+
+	/**
+	*	Number of background fetches between saving a pack file's state.
+	*/
+	static const unsigned int SAVE_INTERVAL = 64;
+
+public:
+	CStreamingInstaller() = default;
+	~CStreamingInstaller();
+
+	/**
+	*	Adds a pack file to install. Starts the worker thread if needed.
+	*/
+	void Add( std::shared_ptr<CStreamingPack> pack );
+
+	/**
+	*	@return Whether all pack files are complete.
+	*/
+	bool IsComplete() const;
+
+	void GetProgress( uint64_t& uiAvailableBytes, uint64_t& uiTotalBytes ) const;
+
+	/**
+	*	Stops the worker thread and saves the state of all pack files.
+	*	The pack files are kept, the worker is restarted if another one is added.
+	*/
+	void Shutdown();
+
+private:
+	void WorkerThread();
+
+	/**
+	*	@return The first pack file that isn't complete, if any. Must be called with the mutex held.
+	*/
+	std::shared_ptr<CStreamingPack> FindIncompletePack() const;
+
+private:
+	mutable std::mutex m_Mutex;
+
+	/**
+	*	Signalled when pack files are added, and on shutdown.
+	*/
+	std::condition_variable m_Wake;
+
+	std::vector<std::shared_ptr<CStreamingPack>> m_Packs;
+
+	std::thread m_Thread;
+
+	std::atomic<bool> m_bShutdown{ false };
+
+private:
+	CStreamingInstaller( const CStreamingInstaller& ) = delete;
+	CStreamingInstaller& operator=( const CStreamingInstaller& ) = delete;
+};
+
+#endif //FILESYSTEM_CSTREAMINGINSTALLER_H
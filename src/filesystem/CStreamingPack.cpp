@@ -0,0 +1,394 @@
+#include <algorithm>
+#include <cstring>
+#include <experimental/filesystem>
+
+#include "Platform.h"
+
+#include "CStreamingPack.h"
+
+namespace fs = std::experimental::filesystem;
+
+const uint32_t CStreamingPack::BLOCK_SIZE;
+const size_t CStreamingPack::MAX_FETCH_BLOCKS;
+const char* const CStreamingPack::STATE_EXTENSION = ".part";
+
+namespace
+{
+const char STREAMING_STATE_IDENTIFIER[ 4 ] = { 'G', 'S', 'S', 'P' };
+}
+
+CStreamingPack::~CStreamingPack()
+{
+	Close();
+}
+
+bool CStreamingPack::Open( const char* pszFileName, const char* pszRemoteName, const FileContentSource_t& source )
+{
+	Close();
+
+	if( !source.pfnGetSize || !source.pfnRead )
+		return false;
+
+	uint64_t uiSize = 0;
+
+	if( !source.pfnGetSize( source.pContext, pszRemoteName, &uiSize ) )
+		return false;
+
+	m_szFileName = pszFileName;
+	m_szRemoteName = pszRemoteName;
+	m_Source = source;
+	m_uiSize = uiSize;
+
+	const size_t uiBlocks = static_cast<size_t>( ( uiSize + BLOCK_SIZE - 1 ) / BLOCK_SIZE );
+
+	m_uiNextBlock = 0;
+	m_bStateChanged = false;
+
+	std::error_code error;
+
+	const uint64_t uiLocalSize = static_cast<uint64_t>( fs::file_size( pszFileName, error ) );
+
+	if( !error && uiLocalSize == uiSize )
+	{
+		const std::string szStateFileName = m_szFileName + STATE_EXTENSION;
+
+		//No state file means the previous install finished.
+		if( !fs::exists( szStateFileName, error ) && !error )
+		{
+			m_Blocks.assign( uiBlocks, BlockState::PRESENT );
+			m_uiMissingBlocks = 0;
+			m_uiAvailableBytes = uiSize;
+
+			m_pFile = fopen64( pszFileName, "r+b" );
+
+			return m_pFile != nullptr;
+		}
+
+		if( LoadState() )
+		{
+			m_pFile = fopen64( pszFileName, "r+b" );
+
+			return m_pFile != nullptr;
+		}
+	}
+
+	m_Blocks.assign( uiBlocks, BlockState::MISSING );
+	m_uiMissingBlocks = uiBlocks;
+	m_uiAvailableBytes = 0;
+
+	//Save the state before creating the copy, otherwise a full size copy without a state file would be taken as complete.
+	m_bStateChanged = true;
+
+	if( !SaveState() )
+		return false;
+
+	m_pFile = fopen64( pszFileName, "w+b" );
+
+	if( !m_pFile )
+		return false;
+
+	//Extend the copy to its full size so every range can be read, even before it's fetched.
+	if( uiSize > 0 && ( fseek64( m_pFile, uiSize - 1, SEEK_SET ) != 0 || fputc( 0, m_pFile ) == EOF || fflush( m_pFile ) != 0 ) )
+	{
+		fclose( m_pFile );
+		m_pFile = nullptr;
+
+		return false;
+	}
+
+	return true;
+}
+
+void CStreamingPack::Close()
+{
+	if( !m_pFile )
+		return;
+
+	SaveState();
+
+	fclose( m_pFile );
+	m_pFile = nullptr;
+}
+
+uint64_t CStreamingPack::GetAvailableBytes() const
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	return m_uiAvailableBytes;
+}
+
+bool CStreamingPack::IsAvailable( const uint64_t uiOffset, const uint64_t uiLength ) const
+{
+	if( IsComplete() || uiLength == 0 )
+		return true;
+
+	if( uiOffset >= m_uiSize || uiLength > m_uiSize - uiOffset )
+		return false;
+
+	const size_t uiLastBlock = static_cast<size_t>( ( uiOffset + uiLength - 1 ) / BLOCK_SIZE );
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	for( size_t uiBlock = static_cast<size_t>( uiOffset / BLOCK_SIZE ); uiBlock <= uiLastBlock; ++uiBlock )
+	{
+		if( m_Blocks[ uiBlock ] != BlockState::PRESENT )
+			return false;
+	}
+
+	return true;
+}
+
+bool CStreamingPack::Fetch( const uint64_t uiOffset, const uint64_t uiLength )
+{
+	if( IsComplete() || uiLength == 0 )
+		return true;
+
+	if( uiOffset >= m_uiSize || uiLength > m_uiSize - uiOffset )
+		return false;
+
+	const size_t uiLastBlock = static_cast<size_t>( ( uiOffset + uiLength - 1 ) / BLOCK_SIZE );
+
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	++m_uiDemandFetches;
+
+	bool bSuccess = true;
+
+	size_t uiBlock = static_cast<size_t>( uiOffset / BLOCK_SIZE );
+
+	while( uiBlock <= uiLastBlock )
+	{
+		if( m_Blocks[ uiBlock ] == BlockState::PRESENT )
+		{
+			++uiBlock;
+			continue;
+		}
+
+		//Another thread is fetching it, check again once it's done. If that fetch failed, this one retries it.
+		if( m_Blocks[ uiBlock ] == BlockState::FETCHING )
+		{
+			m_StateChanged.wait( lock );
+			continue;
+		}
+
+		size_t uiCount = 1;
+
+		while( uiCount < MAX_FETCH_BLOCKS && uiBlock + uiCount <= uiLastBlock && m_Blocks[ uiBlock + uiCount ] == BlockState::MISSING )
+			++uiCount;
+
+		if( !FetchBlocks( lock, uiBlock, uiCount ) )
+		{
+			bSuccess = false;
+			break;
+		}
+
+		uiBlock += uiCount;
+	}
+
+	if( --m_uiDemandFetches == 0 )
+		m_StateChanged.notify_all();
+
+	return bSuccess;
+}
+
+bool CStreamingPack::FetchNext( const std::atomic<bool>& bStop )
+{
+	std::unique_lock<std::mutex> lock( m_Mutex );
+
+	while( true )
+	{
+		//Whatever is needed right now comes first.
+		m_StateChanged.wait( lock, [ this, &bStop ]()
+		{
+			return bStop || m_uiDemandFetches == 0;
+		} );
+
+		if( bStop )
+			return false;
+
+		if( IsComplete() )
+			return true;
+
+		auto it = std::find( m_Blocks.begin() + std::min( m_uiNextBlock, m_Blocks.size() ), m_Blocks.end(), BlockState::MISSING );
+
+		if( it == m_Blocks.end() )
+			it = std::find( m_Blocks.begin(), m_Blocks.end(), BlockState::MISSING );
+
+		//The remaining blocks are being fetched on demand, wait for those to finish.
+		if( it == m_Blocks.end() )
+		{
+			m_StateChanged.wait( lock );
+			continue;
+		}
+
+		const size_t uiFirstBlock = static_cast<size_t>( it - m_Blocks.begin() );
+
+		size_t uiCount = 1;
+
+		while( uiCount < MAX_FETCH_BLOCKS && uiFirstBlock + uiCount < m_Blocks.size() && m_Blocks[ uiFirstBlock + uiCount ] == BlockState::MISSING )
+			++uiCount;
+
+		m_uiNextBlock = uiFirstBlock + uiCount;
+
+		return FetchBlocks( lock, uiFirstBlock, uiCount );
+	}
+}
+
+void CStreamingPack::Wake()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_StateChanged.notify_all();
+}
+
+bool CStreamingPack::SaveState()
+{
+	const std::string szStateFileName = m_szFileName + STATE_EXTENSION;
+
+	std::vector<uint8_t> data;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		if( !m_bStateChanged )
+			return true;
+
+		m_bStateChanged = false;
+
+		if( !IsComplete() )
+		{
+			StateHeader_t header;
+
+			memcpy( header.identifier, STREAMING_STATE_IDENTIFIER, sizeof( header.identifier ) );
+			header.uiBlockSize = BLOCK_SIZE;
+			header.uiSize = m_uiSize;
+
+			data.resize( sizeof( header ) + m_Blocks.size() );
+
+			memcpy( data.data(), &header, sizeof( header ) );
+
+			for( size_t uiBlock = 0; uiBlock < m_Blocks.size(); ++uiBlock )
+				data[ sizeof( header ) + uiBlock ] = m_Blocks[ uiBlock ] == BlockState::PRESENT ? 1 : 0;
+		}
+	}
+
+	if( data.empty() )
+	{
+		std::error_code error;
+
+		fs::remove( szStateFileName, error );
+
+		return !error;
+	}
+
+	FILE* pFile = fopen64( szStateFileName.c_str(), "wb" );
+
+	bool bSuccess = false;
+
+	if( pFile )
+	{
+		bSuccess = fwrite( data.data(), data.size(), 1, pFile ) == 1;
+
+		bSuccess = fclose( pFile ) == 0 && bSuccess;
+	}
+
+	if( !bSuccess )
+	{
+		//Try again next time.
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		m_bStateChanged = true;
+	}
+
+	return bSuccess;
+}
+
+uint64_t CStreamingPack::GetBlockSize( const size_t uiBlock ) const
+{
+	return std::min<uint64_t>( BLOCK_SIZE, m_uiSize - static_cast<uint64_t>( uiBlock ) * BLOCK_SIZE );
+}
+
+bool CStreamingPack::LoadState()
+{
+	const std::string szStateFileName = m_szFileName + STATE_EXTENSION;
+
+	FILE* pFile = fopen64( szStateFileName.c_str(), "rb" );
+
+	if( !pFile )
+		return false;
+
+	const size_t uiBlocks = static_cast<size_t>( ( m_uiSize + BLOCK_SIZE - 1 ) / BLOCK_SIZE );
+
+	StateHeader_t header;
+
+	std::vector<uint8_t> present( uiBlocks );
+
+	//Anything left over means it's not the state of this copy.
+	const bool bSuccess = fread( &header, sizeof( header ), 1, pFile ) == 1 &&
+		( uiBlocks == 0 || fread( present.data(), uiBlocks, 1, pFile ) == 1 ) &&
+		fgetc( pFile ) == EOF;
+
+	fclose( pFile );
+
+	if( !bSuccess || memcmp( header.identifier, STREAMING_STATE_IDENTIFIER, sizeof( header.identifier ) ) != 0 ||
+		header.uiBlockSize != BLOCK_SIZE || header.uiSize != m_uiSize )
+		return false;
+
+	m_Blocks.assign( uiBlocks, BlockState::MISSING );
+	m_uiMissingBlocks = uiBlocks;
+	m_uiAvailableBytes = 0;
+
+	for( size_t uiBlock = 0; uiBlock < uiBlocks; ++uiBlock )
+	{
+		if( present[ uiBlock ] )
+		{
+			m_Blocks[ uiBlock ] = BlockState::PRESENT;
+			--m_uiMissingBlocks;
+			m_uiAvailableBytes += GetBlockSize( uiBlock );
+		}
+	}
+
+	//A complete copy still has its state file, so remove that on the next save.
+	m_bStateChanged = m_uiMissingBlocks == 0;
+
+	return true;
+}
+
+bool CStreamingPack::FetchBlocks( std::unique_lock<std::mutex>& lock, const size_t uiFirstBlock, const size_t uiCount )
+{
+	for( size_t uiBlock = uiFirstBlock; uiBlock < uiFirstBlock + uiCount; ++uiBlock )
+		m_Blocks[ uiBlock ] = BlockState::FETCHING;
+
+	lock.unlock();
+
+	const uint64_t uiOffset = static_cast<uint64_t>( uiFirstBlock ) * BLOCK_SIZE;
+	const uint64_t uiSize = std::min<uint64_t>( static_cast<uint64_t>( uiCount ) * BLOCK_SIZE, m_uiSize - uiOffset );
+
+	std::vector<uint8_t> buffer( static_cast<size_t>( uiSize ) );
+
+	bool bSuccess = m_Source.pfnRead( m_Source.pContext, m_szRemoteName.c_str(), uiOffset, buffer.data(), uiSize );
+
+	if( bSuccess )
+	{
+		std::lock_guard<std::mutex> fileLock( m_FileMutex );
+
+		//Flushed so that the pack file's own handle sees the data.
+		bSuccess = fseek64( m_pFile, uiOffset, SEEK_SET ) == 0 && fwrite( buffer.data(), buffer.size(), 1, m_pFile ) == 1 && fflush( m_pFile ) == 0;
+	}
+
+	lock.lock();
+
+	for( size_t uiBlock = uiFirstBlock; uiBlock < uiFirstBlock + uiCount; ++uiBlock )
+		m_Blocks[ uiBlock ] = bSuccess ? BlockState::PRESENT : BlockState::MISSING;
+
+	if( bSuccess )
+	{
+		m_uiMissingBlocks -= uiCount;
+		m_uiAvailableBytes += uiSize;
+		m_bStateChanged = true;
+	}
+
+	m_StateChanged.notify_all();
+
+	return bSuccess;
+}
@@ -0,0 +1,164 @@
+#ifndef FILESYSTEM_CSTREAMINGPACK_H
+#define FILESYSTEM_CSTREAMINGPACK_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "FileSystem2.h"
+
+/**
+*	Local copy of a pack file that is installed from a content source while it's in use.
+*	The copy is created at its full size up front, so the pack file can be opened and read like any other;
+*	ranges have to be fetched before they're read. Which blocks are present is saved in a state file next to the copy.
+*/
+class CStreamingPack
+{
+public:
+	/**
+	*	Size of the blocks that are tracked and fetched, in bytes.
+	*/
+	static const uint32_t BLOCK_SIZE = 256 * 1024;
+
+	/**
+	*	Maximum number of consecutive blocks fetched in one request.
+	*/
+	static const size_t MAX_FETCH_BLOCKS = 16;
+
+	/**
+	*	Appended to the local copy's path to get the state file's path. The state file is removed once the copy is complete.
+	*/
+	static const char* const STATE_EXTENSION;
+
+public:
+	CStreamingPack() = default;
+	~CStreamingPack();
+
+	/**
+	*	Opens the local copy, creating it if it doesn't exist or has a different size than the remote pack file.
+	*	@param pszFileName Path of the local copy.
+	*	@param pszRemoteName Name the content source knows the pack file by.
+	*	@param source Content source. Must stay valid until the pack is closed.
+	*/
+	bool Open( const char* pszFileName, const char* pszRemoteName, const FileContentSource_t& source );
+
+	/**
+	*	Saves the state and closes the local copy.
+	*/
+	void Close();
+
+	const std::string& GetFileName() const { return m_szFileName; }
+
+	uint64_t GetSize() const { return m_uiSize; }
+
+	uint64_t GetAvailableBytes() const;
+
+	/**
+	*	@return Whether a range can be read from the local copy without fetching it.
+	*/
+	bool IsAvailable( const uint64_t uiOffset, const uint64_t uiLength ) const;
+
+	bool IsComplete() const { return m_uiMissingBlocks == 0; }
+
+	/**
+	*	Fetches a range if it isn't present yet. Blocks until the range is present.
+	*	Background fetches yield to this until all pending calls have returned.
+	*	@return Whether the range is present.
+	*/
+	bool Fetch( const uint64_t uiOffset, const uint64_t uiLength );
+
+	/**
+	*	Fetches the next missing blocks, in file order. Waits until no ranges are being fetched on demand.
+	*	@param bStop Returns early once this is set. Wake must be called after setting it.
+	*	@return Whether blocks were fetched, or the copy is complete.
+	*/
+	bool FetchNext( const std::atomic<bool>& bStop );
+
+	/**
+	*	Wakes up threads waiting in FetchNext.
+	*/
+	void Wake();
+
+	/**
+	*	Saves which blocks are present, if that changed since the last save.
+	*/
+	bool SaveState();
+
+private:
+	enum class BlockState : uint8_t
+	{
+		MISSING,
+		FETCHING,
+		PRESENT
+	};
+
+	struct StateHeader_t
+	{
+		char identifier[ 4 ];
+		uint32_t uiBlockSize;
+		uint64_t uiSize;
+	};
+
+	uint64_t GetBlockSize( const size_t uiBlock ) const;
+
+	bool LoadState();
+
+	/**
+	*	Fetches a run of missing blocks and writes them to the local copy. Must be called with the mutex held; it's released while fetching.
+	*/
+	bool FetchBlocks( std::unique_lock<std::mutex>& lock, const size_t uiFirstBlock, const size_t uiCount );
+
+private:
+	std::string m_szFileName;
+	std::string m_szRemoteName;
+
+	FileContentSource_t m_Source;
+
+	uint64_t m_uiSize = 0;
+
+	mutable std::mutex m_Mutex;
+
+	/**
+	*	Signalled whenever blocks finish fetching, and when the last on-demand fetch returns.
+	*/
+	std::condition_variable m_StateChanged;
+
+	std::vector<BlockState> m_Blocks;
+
+	std::atomic<size_t> m_uiMissingBlocks{ 0 };
+
+	uint64_t m_uiAvailableBytes = 0;
+
+	/**
+	*	Number of Fetch calls in progress.
+	*/
+	size_t m_uiDemandFetches = 0;
+
+	/**
+	*	Where FetchNext continues looking for missing blocks.
+	*/
+	size_t m_uiNextBlock = 0;
+
+	/**
+	*	Whether the state changed since it was last saved.
+	*/
+	bool m_bStateChanged = false;
+
+	/**
+	*	Serializes writes to the local copy.
+	*/
+	std::mutex m_FileMutex;
+
+	FILE* m_pFile = nullptr;
+
+private:
+	CStreamingPack( const CStreamingPack& ) = delete;
+	CStreamingPack& operator=( const CStreamingPack& ) = delete;
+};
+
+#endif //FILESYSTEM_CSTREAMINGPACK_H
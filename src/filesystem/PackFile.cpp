@@ -0,0 +1,156 @@
+#include "ByteSwap.h"
+
+#include "PackFile.h"
+
+namespace pack
+{
+namespace
+{
+template<typename HEADER>
+HEADER ReadHeader( const uint8_t* pData )
+{
+	static_assert( sizeof( HEADER ) <= MAX_HEADER_SIZE, "Pack file header is larger than MAX_HEADER_SIZE" );
+
+	HEADER header;
+
+	memcpy( &header, pData, sizeof( header ) );
+
+	return header;
+}
+}
+
+const char* const PackInfoForSize<int32_t>::NAME = "32 bit Pack File";
+
+const char PackInfoForSize<int32_t>::IDENTIFIER[ 4 ] = { 'P', 'A', 'C', 'K' };
+
+const char* const PackInfoForSize<int64_t>::NAME = "64 bit Pack File";
+
+const char PackInfoForSize<int64_t>::IDENTIFIER[ 4 ] = { 'P', 'K', '6', '4' };
+
+const char* const CompressedPack::NAME = "Compressed Pack File";
+
+const char CompressedPack::IDENTIFIER[ 4 ] = { 'P', 'K', 'Z', '1' };
+
+const char* const HashedPack::NAME = "Hashed Pack File";
+
+const char HashedPack::IDENTIFIER[ 4 ] = { 'P', 'K', 'H', '1' };
+
+const size_t HashedPack::MAX_FILES;
+
+const size_t HashedPack::MAX_BUCKETS;
+
+const uint64_t HashedPack::MAX_NAME_BYTES;
+
+const char* const Wad::NAME = "WAD File";
+
+const char Wad::IDENTIFIER_WAD2[ 4 ] = { 'W', 'A', 'D', '2' };
+
+const char Wad::IDENTIFIER_WAD3[ 4 ] = { 'W', 'A', 'D', '3' };
+
+const size_t Wad::LUMP_NAME_MAX_LENGTH;
+
+const size_t Wad::MAX_FILES;
+
+const char* const Zip::NAME = "ZIP File";
+
+const char Zip::IDENTIFIER_LOCAL[ 4 ] = { 'P', 'K', 3, 4 };
+
+const char Zip::IDENTIFIER_EMPTY[ 4 ] = { 'P', 'K', 5, 6 };
+
+const uint32_t Zip::LOCAL_HEADER_SIGNATURE;
+const uint32_t Zip::CENTRAL_HEADER_SIGNATURE;
+const uint32_t Zip::END_SIGNATURE;
+const uint32_t Zip::END64_LOCATOR_SIGNATURE;
+const uint32_t Zip::END64_SIGNATURE;
+
+const size_t Zip::LOCAL_HEADER_SIZE;
+const size_t Zip::CENTRAL_HEADER_SIZE;
+const size_t Zip::END_SIZE;
+const size_t Zip::END64_LOCATOR_SIZE;
+const size_t Zip::END64_SIZE;
+
+const size_t Zip::MAX_COMMENT_LENGTH;
+
+const uint32_t Zip::ZIP64_VALUE;
+
+const uint16_t Zip::EXTRA_ZIP64;
+
+const uint16_t Zip::FLAG_ENCRYPTED;
+
+const uint16_t Zip::METHOD_STORED;
+const uint16_t Zip::METHOD_DEFLATE;
+
+const size_t Zip::MAX_FILES;
+
+const uint64_t Zip::MAX_DIRECTORY_SIZE;
+
+const uint64_t Zip::MAX_DEFLATE_LENGTH;
+
+const char PackChecksums::IDENTIFIER[ 4 ] = { 'P', 'C', 'R', 'C' };
+
+const char* const PackChecksums::EXTENSION = ".crc";
+
+bool GetDirectoryRange( const uint8_t* pHeader, uint64_t& uiOffset, uint64_t& uiLength )
+{
+	int64_t iOffset;
+	int64_t iLength;
+
+	switch( IdentifyPackType( ReadHeader<Header_t>( pHeader ) ) )
+	{
+	case PackType::PACK_32BIT:
+		{
+			const auto header = ReadHeader<Pack32_t::Header_t>( pHeader );
+
+			iOffset = LittleValue( header.dirofs );
+			iLength = LittleValue( header.dirlen );
+			break;
+		}
+
+	case PackType::PACK_64BIT:
+		{
+			const auto header = ReadHeader<Pack64_t::Header_t>( pHeader );
+
+			iOffset = LittleValue( header.dirofs );
+			iLength = LittleValue( header.dirlen );
+			break;
+		}
+
+	case PackType::PACK_COMPRESSED:
+		{
+			const auto header = ReadHeader<CompressedPack::Header_t>( pHeader );
+
+			iOffset = LittleValue( header.dirofs );
+			iLength = LittleValue( header.dirlen );
+			break;
+		}
+
+	case PackType::PACK_HASHED:
+		{
+			const auto header = ReadHeader<HashedPack::Header_t>( pHeader );
+
+			iOffset = LittleValue( header.dirofs );
+			iLength = LittleValue( header.dirlen );
+			break;
+		}
+
+	case PackType::WAD:
+		{
+			const auto header = ReadHeader<Wad::Header_t>( pHeader );
+
+			iOffset = LittleValue( header.infotableofs );
+			iLength = static_cast<int64_t>( LittleValue( header.numlumps ) ) * sizeof( Wad::Lump_t );
+			break;
+		}
+
+	default: return false;
+	}
+
+	if( iOffset < 0 || iLength < 0 )
+		return false;
+
+	uiOffset = static_cast<uint64_t>( iOffset );
+	uiLength = static_cast<uint64_t>( iLength );
+
+	return true;
+}
+}
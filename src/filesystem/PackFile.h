@@ -1,7 +1,9 @@
 #ifndef FILESYSTEM_PACKFILE_H
 #define FILESYSTEM_PACKFILE_H
 
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
 
 /**
 *	@file
@@ -22,28 +24,26 @@ enum class PackType
 {
 	NOT_A_PACK = 0,
 	PACK_32BIT,
-	PACK_64BIT
+	PACK_64BIT,
+	PACK_COMPRESSED,
+	PACK_HASHED,
+	WAD,
+	ZIP
 };
 
 /**
-*	Identifies the type of pack file.
+*	Codec used to store a file in a compressed pack file.
 */
-inline PackType IdentifyPackType( const Header_t& header )
+enum class Codec : uint32_t
 {
-	if( header.identifier[ 0 ] == 'P' &&
-		header.identifier[ 1 ] == 'A' &&
-		header.identifier[ 2 ] == 'C' &&
-		header.identifier[ 3 ] == 'K' )
-		return PackType::PACK_32BIT;
-	else if( 
-		header.identifier[ 0 ] == 'P' &&
-		header.identifier[ 1 ] == 'K' &&
-		header.identifier[ 2 ] == '6' &&
-		header.identifier[ 3 ] == '4' )
-		return PackType::PACK_64BIT;
+	NONE	= 0,
+	LZ4		= 1,
 
-	return PackType::NOT_A_PACK;
-}
+	/**
+	*	The whole file is a single raw DEFLATE stream, without a seek table. Only used by ZIP files.
+	*/
+	DEFLATE	= 2
+};
 
 template<typename SIZE>
 struct PackInfoForSize
@@ -56,9 +56,9 @@ struct PackInfoForSize<int32_t>
 	static const PackType TYPE = PackType::PACK_32BIT;
 
 	static const char* const NAME;
-};
 
-const char* const PackInfoForSize<int32_t>::NAME = "32 bit Pack File";
+	static const char IDENTIFIER[ 4 ];
+};
 
 template<>
 struct PackInfoForSize<int64_t>
@@ -66,9 +66,9 @@ struct PackInfoForSize<int64_t>
 	static const PackType TYPE = PackType::PACK_64BIT;
 
 	static const char* const NAME;
-};
 
-const char* const PackInfoForSize<int64_t>::NAME = "64 bit Pack File";
+	static const char IDENTIFIER[ 4 ];
+};
 
 /**
 *	Template class that defines constants and data structures for pack files.
@@ -120,6 +120,406 @@ private:
 typedef Pack<int32_t> Pack32_t;
 typedef Pack<int64_t> Pack64_t;
 
+/**
+*	Pack file whose entries can be compressed.
+*	Compressed entries are split into blocks of blocksize bytes that are compressed separately.
+*	The stored data of a compressed entry starts with a seek table of blockcount + 1 offsets, relative to the start of the entry,
+*	followed by the blocks. Blocks that didn't get smaller are stored as is; a block's stored size tells which it is.
+*	All values are little endian.
+*/
+struct CompressedPack final
+{
+	static const PackType TYPE = PackType::PACK_COMPRESSED;
+
+	static const char* const NAME;
+
+	static const char IDENTIFIER[ 4 ];
+
+	struct Header_t
+	{
+		char identifier[ 4 ];
+
+		/**
+		*	Uncompressed size of each block, except for the last block of each entry.
+		*/
+		uint32_t blocksize;
+
+		int64_t dirofs;
+		int64_t dirlen;
+	};
+
+	static const size_t ENTRY_NAME_MAX_LENGTH = 112;
+
+	struct Entry_t
+	{
+		char szFileName[ ENTRY_NAME_MAX_LENGTH ];
+		int64_t filepos;
+
+		/**
+		*	Uncompressed length.
+		*/
+		int64_t filelen;
+
+		/**
+		*	Length of the data in the pack file, including the seek table.
+		*/
+		int64_t storedlen;
+
+		/**
+		*	Codec.
+		*/
+		uint32_t codec;
+		uint32_t reserved;
+	};
+
+	/**
+	*	Maximum number of files in a single pack file.
+	*/
+	static const size_t MAX_FILES = 32768;
+
+	static const uint32_t DEFAULT_BLOCK_SIZE = 64 * 1024;
+
+	static const uint32_t MAX_BLOCK_SIZE = 16 * 1024 * 1024;
+
+	/**
+	*	@return Number of blocks that an entry of the given length is split into.
+	*/
+	static uint64_t GetBlockCount( const uint64_t uiLength, const uint32_t uiBlockSize )
+	{
+		return ( uiLength + uiBlockSize - 1 ) / uiBlockSize;
+	}
+
+private:
+	CompressedPack() = delete;
+	CompressedPack( const CompressedPack& ) = delete;
+	CompressedPack& operator=( const CompressedPack& ) = delete;
+};
+
+/**
+*	Pack file with a hashed directory, for pack files with more files than the other formats allow.
+*	Entries are stored the same way as in a compressed pack file, but names are stored in a single blob instead of fixed size fields,
+*	and the directory contains a hash table, so it can be used as is instead of being sorted and hashed when it's loaded.
+*	The directory consists of:
+*	entrycount entries, sorted by name;
+*	bucketcount + 1 bucket offsets: bucket i consists of the slots in [ buckets[ i ], buckets[ i + 1 ] );
+*	entrycount slots: entry indices, grouped by bucket;
+*	the names, null terminated.
+*	Names use forward slashes. An entry is in the bucket given by the low bits of the hash of its name.
+*	All values are little endian.
+*/
+struct HashedPack final
+{
+	static const PackType TYPE = PackType::PACK_HASHED;
+
+	static const char* const NAME;
+
+	static const char IDENTIFIER[ 4 ];
+
+	struct Header_t
+	{
+		char identifier[ 4 ];
+
+		/**
+		*	Uncompressed size of each block, except for the last block of each entry.
+		*/
+		uint32_t blocksize;
+
+		/**
+		*	Number of buckets. Must be a power of 2.
+		*/
+		uint32_t bucketcount;
+
+		uint32_t entrycount;
+
+		int64_t dirofs;
+		int64_t dirlen;
+	};
+
+	struct Entry_t
+	{
+		int64_t filepos;
+
+		/**
+		*	Uncompressed length.
+		*/
+		int64_t filelen;
+
+		/**
+		*	Length of the data in the pack file, including the seek table.
+		*/
+		int64_t storedlen;
+
+		/**
+		*	Offset of the name in the name blob.
+		*/
+		uint32_t nameofs;
+
+		/**
+		*	Hash of the name.
+		*	@see HashName
+		*/
+		uint32_t namehash;
+
+		/**
+		*	Codec.
+		*/
+		uint32_t codec;
+		uint32_t reserved;
+	};
+
+	/**
+	*	Maximum number of files in a single pack file.
+	*/
+	static const size_t MAX_FILES = 16 * 1024 * 1024;
+
+	/**
+	*	Maximum number of buckets. Writers use at most one bucket per entry.
+	*/
+	static const size_t MAX_BUCKETS = MAX_FILES;
+
+	/**
+	*	Maximum size of the name blob. Name offsets are 32 bit.
+	*/
+	static const uint64_t MAX_NAME_BYTES = UINT32_MAX;
+
+	/**
+	*	@return Hash of a file name. 32 bit FNV-1a, with backslashes hashed as forward slashes so names hash the same on every platform.
+	*/
+	static uint32_t HashName( const char* pszFileName )
+	{
+		uint32_t uiHash = 2166136261U;
+
+		for( ; *pszFileName; ++pszFileName )
+		{
+			uiHash ^= static_cast<uint8_t>( *pszFileName == '\\' ? '/' : *pszFileName );
+			uiHash *= 16777619U;
+		}
+
+		return uiHash;
+	}
+
+private:
+	HashedPack() = delete;
+	HashedPack( const HashedPack& ) = delete;
+	HashedPack& operator=( const HashedPack& ) = delete;
+};
+
+/**
+*	GoldSource texture archive: WAD2 (Quake) and WAD3 (Half-Life).
+*	Lumps are presented as files named after the lump. Lump names are matched case insensitively by the engine,
+*	so they're converted to lowercase, and must be looked up in lowercase unless case is folded.
+*	All values are little endian.
+*/
+struct Wad final
+{
+	static const PackType TYPE = PackType::WAD;
+
+	static const char* const NAME;
+
+	static const char IDENTIFIER_WAD2[ 4 ];
+	static const char IDENTIFIER_WAD3[ 4 ];
+
+	struct Header_t
+	{
+		char identifier[ 4 ];
+
+		int32_t numlumps;
+		int32_t infotableofs;
+	};
+
+	static const size_t LUMP_NAME_MAX_LENGTH = 16;
+
+	struct Lump_t
+	{
+		int32_t filepos;
+
+		/**
+		*	Length of the data in the file.
+		*/
+		int32_t disksize;
+
+		/**
+		*	Uncompressed length.
+		*/
+		int32_t size;
+
+		char type;
+
+		/**
+		*	COMPRESSION_NONE, or a compression scheme that was never used by the tools.
+		*/
+		char compression;
+
+		char pad1, pad2;
+
+		char szName[ LUMP_NAME_MAX_LENGTH ];
+	};
+
+	static const char COMPRESSION_NONE = 0;
+
+	/**
+	*	Maximum number of lumps in a single WAD file.
+	*/
+	static const size_t MAX_FILES = 1024 * 1024;
+
+private:
+	Wad() = delete;
+	Wad( const Wad& ) = delete;
+	Wad& operator=( const Wad& ) = delete;
+};
+
+/**
+*	ZIP file (PKWARE APPNOTE), including ZIP64. Only stored and deflated files are supported; encrypted files and other methods are skipped.
+*	The central directory is parsed when the file is added, so the file must end with the end of central directory record.
+*	Records aren't aligned, so they're parsed field by field at the offsets given here rather than through structures.
+*	Directory entries are skipped; directories are implied by file names, as with the other pack files.
+*	All values are little endian.
+*/
+struct Zip final
+{
+	static const PackType TYPE = PackType::ZIP;
+
+	static const char* const NAME;
+
+	/**
+	*	Start of a ZIP file that has files, and one that's empty.
+	*/
+	static const char IDENTIFIER_LOCAL[ 4 ];
+	static const char IDENTIFIER_EMPTY[ 4 ];
+
+	static const uint32_t LOCAL_HEADER_SIGNATURE = 0x04034B50;
+	static const uint32_t CENTRAL_HEADER_SIGNATURE = 0x02014B50;
+	static const uint32_t END_SIGNATURE = 0x06054B50;
+	static const uint32_t END64_LOCATOR_SIGNATURE = 0x07064B50;
+	static const uint32_t END64_SIGNATURE = 0x06064B50;
+
+	/**
+	*	Sizes of the fixed parts of the records.
+	*/
+	static const size_t LOCAL_HEADER_SIZE = 30;
+	static const size_t CENTRAL_HEADER_SIZE = 46;
+	static const size_t END_SIZE = 22;
+	static const size_t END64_LOCATOR_SIZE = 20;
+	static const size_t END64_SIZE = 56;
+
+	static const size_t MAX_COMMENT_LENGTH = 0xFFFF;
+
+	/**
+	*	Value of 32 bit fields whose value is stored in the ZIP64 extra field instead.
+	*/
+	static const uint32_t ZIP64_VALUE = 0xFFFFFFFF;
+
+	static const uint16_t EXTRA_ZIP64 = 0x0001;
+
+	static const uint16_t FLAG_ENCRYPTED = 1 << 0;
+
+	static const uint16_t METHOD_STORED = 0;
+	static const uint16_t METHOD_DEFLATE = 8;
+
+	/**
+	*	Maximum number of files in a single ZIP file.
+	*/
+	static const size_t MAX_FILES = 1024 * 1024;
+
+	/**
+	*	Maximum size of the central directory.
+	*/
+	static const uint64_t MAX_DIRECTORY_SIZE = 256 * 1024 * 1024;
+
+	/**
+	*	Deflated files are decompressed as a whole, so their size is limited. Larger files should be stored.
+	*/
+	static const uint64_t MAX_DEFLATE_LENGTH = 256 * 1024 * 1024;
+
+private:
+	Zip() = delete;
+	Zip( const Zip& ) = delete;
+	Zip& operator=( const Zip& ) = delete;
+};
+
+/**
+*	Checksums of a pack file's contents, stored next to it in a file named after the pack file with EXTENSION appended.
+*	The pack file is split into blocks of blocksize bytes, and the header is followed by the CRC-32C of each block.
+*	All values are little endian.
+*/
+struct PackChecksums final
+{
+	static const char IDENTIFIER[ 4 ];
+
+	static const char* const EXTENSION;
+
+	static const uint32_t VERSION = 1;
+
+	struct Header_t
+	{
+		char identifier[ 4 ];
+		uint32_t version;
+
+		uint32_t blocksize;
+		uint32_t reserved;
+
+		/**
+		*	Size of the pack file.
+		*/
+		int64_t filesize;
+	};
+
+	static const uint32_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+	static const uint32_t MAX_BLOCK_SIZE = 64 * 1024 * 1024;
+
+	/**
+	*	@return Number of blocks that a pack file of the given size is split into.
+	*/
+	static uint64_t GetBlockCount( const uint64_t uiFileSize, const uint32_t uiBlockSize )
+	{
+		return ( uiFileSize + uiBlockSize - 1 ) / uiBlockSize;
+	}
+
+private:
+	PackChecksums() = delete;
+	PackChecksums( const PackChecksums& ) = delete;
+	PackChecksums& operator=( const PackChecksums& ) = delete;
+};
+
+/**
+*	Identifies the type of pack file.
+*/
+inline PackType IdentifyPackType( const Header_t& header )
+{
+	if( memcmp( header.identifier, Pack32_t::Info_t::IDENTIFIER, sizeof( header.identifier ) ) == 0 )
+		return PackType::PACK_32BIT;
+	else if( memcmp( header.identifier, Pack64_t::Info_t::IDENTIFIER, sizeof( header.identifier ) ) == 0 )
+		return PackType::PACK_64BIT;
+	else if( memcmp( header.identifier, CompressedPack::IDENTIFIER, sizeof( header.identifier ) ) == 0 )
+		return PackType::PACK_COMPRESSED;
+	else if( memcmp( header.identifier, HashedPack::IDENTIFIER, sizeof( header.identifier ) ) == 0 )
+		return PackType::PACK_HASHED;
+	else if( memcmp( header.identifier, Wad::IDENTIFIER_WAD2, sizeof( header.identifier ) ) == 0 ||
+			 memcmp( header.identifier, Wad::IDENTIFIER_WAD3, sizeof( header.identifier ) ) == 0 )
+		return PackType::WAD;
+	else if( memcmp( header.identifier, Zip::IDENTIFIER_LOCAL, sizeof( header.identifier ) ) == 0 ||
+			 memcmp( header.identifier, Zip::IDENTIFIER_EMPTY, sizeof( header.identifier ) ) == 0 )
+		return PackType::ZIP;
+
+	return PackType::NOT_A_PACK;
+}
+
+/**
+*	Size that is large enough to hold the header of any type of pack file.
+*/
+const size_t MAX_HEADER_SIZE = 64;
+
+/**
+*	Gets the range of a pack file that holds its directory. Together with the header, that's all that is read when the pack file is added.
+*	@param pHeader Start of the pack file, MAX_HEADER_SIZE bytes.
+*	@param[ out ] uiOffset Offset of the directory.
+*	@param[ out ] uiLength Length of the directory.
+*	@return Whether the header gives the range of the directory. ZIP files find their directory from the end of the file instead,
+*		and refer to headers throughout the file.
+*/
+bool GetDirectoryRange( const uint8_t* pHeader, uint64_t& uiOffset, uint64_t& uiLength );
+
 struct PackAppend_t
 {
 	char identifier[ 8 ];
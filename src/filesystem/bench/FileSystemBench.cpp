@@ -0,0 +1,570 @@
+/**
+*	@file
+*	Filesystem microbenchmarks. Builds a synthetic game directory with loose files and pack files, and times common operations on it.
+*	Usage: bench_filesystem [-dir <scratch directory>] [-paths <search path count>] [-scale <iteration multiplier>] [-mmap] [-threadsafe] [-keep] [-json <results file>]
+*/
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <experimental/filesystem>
+#include <string>
+#include <vector>
+
+#include "interface.h"
+
+#include "FileSystem2.h"
+
+#include "PackFile.h"
+
+#include "bench/CBenchResults.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace
+{
+struct Options_t : public BenchOptions_t
+{
+	std::string szDirectory = "fsbench";
+
+	/**
+	*	Number of loose search paths that lookups go through.
+	*/
+	size_t uiSearchPaths = 8;
+
+	FileSystemOptions_t options = FileSystemOption::NONE;
+
+	/**
+	*	Whether to keep the scratch directory afterwards.
+	*/
+	bool bKeep = false;
+};
+
+/**
+*	Sizes of the pack file sets that are enumerated.
+*/
+const size_t ENUMERATION_SIZES[] = { 1000, 10000, 100000 };
+
+/**
+*	Block sizes that pack entries are read with.
+*/
+const size_t READ_BLOCK_SIZES[] = { 512, 4 * 1024, 64 * 1024, 1024 * 1024 };
+
+/**
+*	Size of the pack entry that read throughput is measured with.
+*/
+const size_t READ_ENTRY_SIZE = 64 * 1024 * 1024;
+
+/**
+*	Size of the text file that line reads are measured with.
+*/
+const size_t TEXT_FILE_SIZE = 16 * 1024 * 1024;
+
+CBenchResults g_Results( "filesystem" );
+
+void Report( const char* pszName, const uint64_t uiOperations, const double flSeconds, const uint64_t uiBytes = 0 )
+{
+	g_Results.Report( pszName, uiOperations, flSeconds, uiBytes );
+}
+
+bool WriteFile( const fs::path& path, const std::string& szContents )
+{
+	std::error_code error;
+
+	fs::create_directories( path.parent_path(), error );
+
+	FILE* pFile = fopen( path.u8string().c_str(), "wb" );
+
+	if( !pFile )
+		return false;
+
+	const bool bSuccess = szContents.empty() || fwrite( szContents.data(), szContents.size(), 1, pFile ) == 1;
+
+	return fclose( pFile ) == 0 && bSuccess;
+}
+
+/**
+*	Writes a 32 bit pack file. Each entry is filled with a pattern based on its index.
+*/
+bool WritePackFile( const fs::path& path, const std::vector<std::pair<std::string, size_t>>& files )
+{
+	typedef pack::Pack32_t PackType;
+
+	FILE* pFile = fopen( path.u8string().c_str(), "wb" );
+
+	if( !pFile )
+		return false;
+
+	PackType::Header_t header{};
+
+	bool bSuccess = fwrite( &header, sizeof( header ), 1, pFile ) == 1;
+
+	std::vector<PackType::Entry_t> entries( files.size() );
+
+	std::vector<uint8_t> data;
+
+	int32_t iOffset = sizeof( header );
+
+	for( size_t uiIndex = 0; bSuccess && uiIndex < files.size(); ++uiIndex )
+	{
+		auto& entry = entries[ uiIndex ];
+
+		strncpy( entry.szFileName, files[ uiIndex ].first.c_str(), sizeof( entry.szFileName ) );
+		entry.filepos = iOffset;
+		entry.filelen = static_cast<int32_t>( files[ uiIndex ].second );
+
+		data.resize( files[ uiIndex ].second );
+
+		for( size_t uiByte = 0; uiByte < data.size(); ++uiByte )
+		{
+			data[ uiByte ] = static_cast<uint8_t>( uiIndex + uiByte );
+		}
+
+		bSuccess = data.empty() || fwrite( data.data(), data.size(), 1, pFile ) == 1;
+
+		iOffset += entry.filelen;
+	}
+
+	memcpy( header.identifier, PackType::Info_t::IDENTIFIER, sizeof( header.identifier ) );
+	header.dirofs = iOffset;
+	header.dirlen = static_cast<int32_t>( entries.size() * sizeof( PackType::Entry_t ) );
+
+	bSuccess = bSuccess && ( entries.empty() || fwrite( entries.data(), header.dirlen, 1, pFile ) == 1 );
+
+	bSuccess = bSuccess && fseek( pFile, 0, SEEK_SET ) == 0 && fwrite( &header, sizeof( header ), 1, pFile ) == 1;
+
+	return fclose( pFile ) == 0 && bSuccess;
+}
+
+std::string MakeTextFile( const size_t uiSize )
+{
+	std::string szText;
+
+	szText.reserve( uiSize + 128 );
+
+	for( size_t uiLine = 0; szText.size() < uiSize; ++uiLine )
+	{
+		char szLine[ 128 ];
+
+		//Varying line lengths, like configs and scripts.
+		snprintf( szLine, sizeof( szLine ), "\"key%u\" \"%.*s\"\n", static_cast<unsigned int>( uiLine ),
+				  static_cast<int>( 8 + uiLine % 64 ), "value value value value value value value value value value value value value" );
+
+		szText += szLine;
+	}
+
+	return szText;
+}
+
+/**
+*	Creates the loose search paths and pack files that the benchmarks use.
+*/
+bool CreateGameDirectory( const Options_t& options )
+{
+	const fs::path root( options.szDirectory );
+
+	std::error_code error;
+
+	fs::remove_all( root, error );
+
+	//Every search path has some files so lookups have to search the index, and only the last one has the files being looked for.
+	for( size_t uiPath = 0; uiPath < options.uiSearchPaths; ++uiPath )
+	{
+		const auto path = root / ( "path" + std::to_string( uiPath ) );
+
+		for( size_t uiFile = 0; uiFile < 100; ++uiFile )
+		{
+			if( !WriteFile( path / "models" / ( "model" + std::to_string( uiPath ) + "_" + std::to_string( uiFile ) + ".mdl" ), "x" ) )
+				return false;
+		}
+	}
+
+	const auto lastPath = root / ( "path" + std::to_string( options.uiSearchPaths - 1 ) );
+
+	const auto szText = MakeTextFile( TEXT_FILE_SIZE );
+
+	if( !WriteFile( lastPath / "loose.cfg", std::string( 1024, 'c' ) ) ||
+		!WriteFile( lastPath / "text.txt", szText ) )
+		return false;
+
+	if( !WritePackFile( root / "read.pak", { { "read.bin", READ_ENTRY_SIZE }, { "packed.cfg", 1024 } } ) )
+		return false;
+
+	{
+		const auto path = root / "text.pak";
+
+		//Written here rather than with WritePackFile so the entry holds text instead of a pattern.
+		FILE* pFile = fopen( path.u8string().c_str(), "wb" );
+
+		if( !pFile )
+			return false;
+
+		pack::Pack32_t::Header_t header{};
+		pack::Pack32_t::Entry_t entry{};
+
+		strncpy( entry.szFileName, "text.txt", sizeof( entry.szFileName ) );
+		entry.filepos = sizeof( header );
+		entry.filelen = static_cast<int32_t>( szText.size() );
+
+		memcpy( header.identifier, pack::Pack32_t::Info_t::IDENTIFIER, sizeof( header.identifier ) );
+		header.dirofs = entry.filepos + entry.filelen;
+		header.dirlen = sizeof( entry );
+
+		const bool bSuccess = fwrite( &header, sizeof( header ), 1, pFile ) == 1 &&
+			fwrite( szText.data(), szText.size(), 1, pFile ) == 1 &&
+			fwrite( &entry, sizeof( entry ), 1, pFile ) == 1;
+
+		if( fclose( pFile ) != 0 || !bSuccess )
+			return false;
+	}
+
+	//Pack files hold at most MAX_FILES entries, so larger sets are split.
+	for( const auto uiCount : ENUMERATION_SIZES )
+	{
+		const auto directory = root / ( "enum" + std::to_string( uiCount ) );
+
+		fs::create_directories( directory, error );
+
+		const size_t uiPerPack = pack::Pack32_t::MAX_FILES;
+
+		for( size_t uiFirst = 0, uiPack = 0; uiFirst < uiCount; uiFirst += uiPerPack, ++uiPack )
+		{
+			std::vector<std::pair<std::string, size_t>> files;
+
+			for( size_t uiIndex = uiFirst; uiIndex < std::min( uiCount, uiFirst + uiPerPack ); ++uiIndex )
+			{
+				files.emplace_back( "sound/dir" + std::to_string( uiIndex % 50 ) + "/file" + std::to_string( uiIndex ) + ".wav", 16 );
+			}
+
+			if( !WritePackFile( directory / ( "pak" + std::to_string( uiPack ) + ".pak" ), files ) )
+				return false;
+		}
+	}
+
+	return true;
+}
+
+/**
+*	Adds the loose search paths and the read pack files.
+*/
+void MountGameDirectory( IFileSystem2& fileSystem, const Options_t& options )
+{
+	fileSystem.RemoveAllSearchPaths();
+
+	const fs::path root( options.szDirectory );
+
+	for( size_t uiPath = 0; uiPath < options.uiSearchPaths; ++uiPath )
+	{
+		fileSystem.AddSearchPath( ( root / ( "path" + std::to_string( uiPath ) ) ).u8string().c_str(), "GAME" );
+	}
+
+	fileSystem.AddPackFile( ( root / "read.pak" ).u8string().c_str(), "GAME" );
+	fileSystem.AddPackFile( ( root / "text.pak" ).u8string().c_str(), "PACK" );
+}
+
+void BenchOpenClose( IFileSystem2& fileSystem, const Options_t& options )
+{
+	const size_t uiCount = options.Scale( 20000 );
+
+	for( const auto pszFileName : { "loose.cfg", "packed.cfg" } )
+	{
+		CBenchTimer timer;
+
+		size_t uiOpened = 0;
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			auto hFile = fileSystem.Open( pszFileName, "rb" );
+
+			if( hFile != FILESYSTEM_INVALID_HANDLE )
+			{
+				++uiOpened;
+				fileSystem.Close( hFile );
+			}
+		}
+
+		const auto flSeconds = timer.GetSeconds();
+
+		char szName[ 64 ];
+
+		snprintf( szName, sizeof( szName ), "Open/Close %s", pszFileName );
+
+		Report( szName, uiOpened, flSeconds );
+	}
+}
+
+void BenchFileExists( IFileSystem2& fileSystem, const Options_t& options )
+{
+	const size_t uiCount = options.Scale( 100000 );
+
+	char szName[ 64 ];
+
+	//Files in the last search path, so all of them are considered.
+	{
+		const std::string szFileName = "models/model" + std::to_string( options.uiSearchPaths - 1 ) + "_50.mdl";
+
+		CBenchTimer timer;
+
+		size_t uiFound = 0;
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			if( fileSystem.FileExists( szFileName.c_str() ) )
+				++uiFound;
+		}
+
+		snprintf( szName, sizeof( szName ), "FileExists hit (%u paths)", static_cast<unsigned int>( options.uiSearchPaths ) );
+
+		Report( szName, uiFound, timer.GetSeconds() );
+	}
+
+	//The same missing file repeatedly, then a different missing file every time.
+	for( const bool bUnique : { false, true } )
+	{
+		std::vector<std::string> fileNames( bUnique ? uiCount : 1 );
+
+		for( size_t uiIndex = 0; uiIndex < fileNames.size(); ++uiIndex )
+		{
+			fileNames[ uiIndex ] = "models/missing" + std::to_string( uiIndex ) + ".mdl";
+		}
+
+		CBenchTimer timer;
+
+		size_t uiMissing = 0;
+
+		for( size_t uiIndex = 0; uiIndex < uiCount; ++uiIndex )
+		{
+			if( !fileSystem.FileExists( fileNames[ uiIndex % fileNames.size() ].c_str() ) )
+				++uiMissing;
+		}
+
+		snprintf( szName, sizeof( szName ), "FileExists %s miss (%u paths)", bUnique ? "unique" : "repeated", static_cast<unsigned int>( options.uiSearchPaths ) );
+
+		Report( szName, uiMissing, timer.GetSeconds() );
+	}
+}
+
+void BenchPackRead( IFileSystem2& fileSystem, const Options_t& options )
+{
+	auto hFile = fileSystem.Open( "read.bin", "rb" );
+
+	if( hFile == FILESYSTEM_INVALID_HANDLE )
+	{
+		printf( "Couldn't open read.bin\n" );
+		return;
+	}
+
+	std::vector<uint8_t> buffer( READ_BLOCK_SIZES[ sizeof( READ_BLOCK_SIZES ) / sizeof( READ_BLOCK_SIZES[ 0 ] ) - 1 ] );
+
+	const size_t uiPasses = options.Scale( 4 );
+
+	for( const auto uiBlockSize : READ_BLOCK_SIZES )
+	{
+		uint64_t uiReads = 0;
+		uint64_t uiBytes = 0;
+
+		CBenchTimer timer;
+
+		for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+		{
+			fileSystem.Seek( hFile, 0, FILESYSTEM_SEEK_HEAD );
+
+			for( int iRead; ( iRead = fileSystem.Read( buffer.data(), static_cast<int>( uiBlockSize ), hFile ) ) > 0; )
+			{
+				++uiReads;
+				uiBytes += iRead;
+			}
+		}
+
+		const auto flSeconds = timer.GetSeconds();
+
+		char szName[ 64 ];
+
+		snprintf( szName, sizeof( szName ), "Pack Read %u byte blocks", static_cast<unsigned int>( uiBlockSize ) );
+
+		Report( szName, uiReads, flSeconds, uiBytes );
+	}
+
+	fileSystem.Close( hFile );
+}
+
+void BenchReadLine( IFileSystem2& fileSystem, const Options_t& options )
+{
+	const size_t uiPasses = options.Scale( 2 );
+
+	for( const auto pszPathID : { "GAME", "PACK" } )
+	{
+		auto hFile = fileSystem.Open( "text.txt", "rb", pszPathID );
+
+		if( hFile == FILESYSTEM_INVALID_HANDLE )
+		{
+			printf( "Couldn't open text.txt in %s\n", pszPathID );
+			continue;
+		}
+
+		char szLine[ 256 ];
+
+		uint64_t uiLines = 0;
+		uint64_t uiBytes = 0;
+
+		CBenchTimer timer;
+
+		for( size_t uiPass = 0; uiPass < uiPasses; ++uiPass )
+		{
+			fileSystem.Seek( hFile, 0, FILESYSTEM_SEEK_HEAD );
+
+			while( fileSystem.ReadLine( szLine, sizeof( szLine ), hFile ) )
+			{
+				++uiLines;
+				uiBytes += strlen( szLine );
+			}
+		}
+
+		const auto flSeconds = timer.GetSeconds();
+
+		fileSystem.Close( hFile );
+
+		char szName[ 64 ];
+
+		snprintf( szName, sizeof( szName ), "ReadLine %s", strcmp( pszPathID, "PACK" ) ? "loose file" : "pack entry" );
+
+		Report( szName, uiLines, flSeconds, uiBytes );
+	}
+}
+
+void BenchEnumeration( IFileSystem2& fileSystem, const Options_t& options )
+{
+	const fs::path root( options.szDirectory );
+
+	for( const auto uiCount : ENUMERATION_SIZES )
+	{
+		fileSystem.RemoveAllSearchPaths();
+
+		const auto directory = root / ( "enum" + std::to_string( uiCount ) );
+
+		char szName[ 64 ];
+
+		{
+			CBenchTimer timer;
+
+			size_t uiPacks = 0;
+
+			for( size_t uiPack = 0; uiPack * pack::Pack32_t::MAX_FILES < uiCount; ++uiPack )
+			{
+				if( fileSystem.AddPackFile( ( directory / ( "pak" + std::to_string( uiPack ) + ".pak" ) ).u8string().c_str(), "GAME" ) )
+					++uiPacks;
+			}
+
+			snprintf( szName, sizeof( szName ), "AddPackFile (%u entries)", static_cast<unsigned int>( uiCount ) );
+
+			Report( szName, uiPacks, timer.GetSeconds() );
+		}
+
+		//The first enumeration also pays for loading the directories.
+		for( const auto pszPass : { "first", "repeat" } )
+		{
+			CBenchTimer timer;
+
+			size_t uiFound = 0;
+
+			FileFindHandle_t hFind;
+
+			for( auto pszFileName = fileSystem.FindFirst( "sound/*", &hFind ); pszFileName; pszFileName = fileSystem.FindNext( hFind ) )
+			{
+				++uiFound;
+			}
+
+			if( hFind != FILESYSTEM_INVALID_FIND_HANDLE )
+				fileSystem.FindClose( hFind );
+
+			snprintf( szName, sizeof( szName ), "FindFirst/FindNext %s (%u entries)", pszPass, static_cast<unsigned int>( uiCount ) );
+
+			Report( szName, uiFound, timer.GetSeconds() );
+		}
+	}
+}
+}
+
+int main( int argc, char* argv[] )
+{
+	Options_t options;
+
+	for( int iArg = 1; iArg < argc; ++iArg )
+	{
+		if( options.ParseArg( argc, argv, iArg ) )
+			continue;
+
+		const char* pszArg = argv[ iArg ];
+		const char* pszValue = iArg + 1 < argc ? argv[ iArg + 1 ] : nullptr;
+
+		if( !strcmp( pszArg, "-dir" ) && pszValue )
+		{
+			options.szDirectory = pszValue;
+			++iArg;
+		}
+		else if( !strcmp( pszArg, "-paths" ) && pszValue )
+		{
+			options.uiSearchPaths = std::max<size_t>( 1, strtoul( pszValue, nullptr, 10 ) );
+			++iArg;
+		}
+		else if( !strcmp( pszArg, "-mmap" ) )
+		{
+			options.options |= FileSystemOption::MAP_PACK_FILES;
+		}
+		else if( !strcmp( pszArg, "-threadsafe" ) )
+		{
+			options.options |= FileSystemOption::THREAD_SAFE;
+		}
+		else if( !strcmp( pszArg, "-keep" ) )
+		{
+			options.bKeep = true;
+		}
+		else
+		{
+			printf( "Usage: bench_filesystem [-dir <scratch directory>] [-paths <search path count>] [-scale <iteration multiplier>] [-mmap] [-threadsafe] [-keep] [-json <results file>]\n" );
+			return EXIT_FAILURE;
+		}
+	}
+
+	auto pFileSystem = static_cast<IFileSystem2*>( CreateInterface( FILESYSTEM2_INTERFACE_VERSION, nullptr ) );
+
+	if( !pFileSystem )
+	{
+		printf( "Couldn't get the filesystem interface\n" );
+		return EXIT_FAILURE;
+	}
+
+	printf( "Creating benchmark files in \"%s\"\n", options.szDirectory.c_str() );
+
+	if( !CreateGameDirectory( options ) )
+	{
+		printf( "Couldn't create benchmark files\n" );
+		return EXIT_FAILURE;
+	}
+
+	pFileSystem->SetOptions( options.options );
+
+	MountGameDirectory( *pFileSystem, options );
+
+	BenchOpenClose( *pFileSystem, options );
+	BenchFileExists( *pFileSystem, options );
+	BenchPackRead( *pFileSystem, options );
+	BenchReadLine( *pFileSystem, options );
+	BenchEnumeration( *pFileSystem, options );
+
+	pFileSystem->RemoveAllSearchPaths();
+
+	if( !options.bKeep )
+	{
+		std::error_code error;
+
+		fs::remove_all( options.szDirectory, error );
+	}
+
+	if( !g_Results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,562 @@
+/**
+*	@file
+*	Replays a recorded level load trace against a mount configuration, for measuring file I/O offline.
+*	Every open, read and close in the trace is done again in the order it was recorded, with a seek before each read that doesn't continue where the previous one ended.
+*	Cold passes discard the filesystem's block cache, remount the search paths and ask the operating system to drop the mounted files from its page cache first.
+*	Warm passes run right after another pass, so everything the trace touches is cached.
+*	Usage: replay_filesystem -trace <trace file> -path <directory or pack file> [-path ...] [-pathid <path ID>] [-mode cold|warm|both] [-passes <warm pass count>]
+*		[-speed recorded|max] [-mmap] [-threadsafe] [-blockcache <megabytes>] [-scale <warm pass multiplier>] [-json <results file>]
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <experimental/filesystem>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "interface.h"
+
+#include "FileSystem2.h"
+
+#include "CLoadTrace.h"
+
+#include "bench/CBenchResults.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace
+{
+enum class Mode
+{
+	COLD,
+	WARM,
+	BOTH
+};
+
+struct Options_t : public BenchOptions_t
+{
+	std::string szTraceFile;
+
+	/**
+	*	Directories and pack files to mount, in search order.
+	*/
+	std::vector<std::string> paths;
+
+	std::string szPathID = "GAME";
+
+	Mode mode = Mode::BOTH;
+
+	/**
+	*	Number of measured warm passes.
+	*/
+	size_t uiWarmPasses = 1;
+
+	/**
+	*	Whether to wait until each event's recorded time before doing it, instead of replaying as fast as possible.
+	*/
+	bool bRecordedSpeed = false;
+
+	FileSystemOptions_t options = FileSystemOption::NONE;
+
+	size_t uiBlockCacheSize = 0;
+};
+
+/**
+*	Operations whose latency is measured separately.
+*/
+enum Phase
+{
+	PHASE_OPEN = 0,
+	PHASE_SEEK,
+	PHASE_READ,
+	PHASE_CLOSE,
+
+	PHASE_COUNT
+};
+
+const char* const PHASE_NAMES[ PHASE_COUNT ] =
+{
+	"open",
+	"seek",
+	"read",
+	"close"
+};
+
+/**
+*	Largest single read, so a corrupt trace can't make the buffer huge.
+*/
+const uint32_t MAX_READ_LENGTH = 64 * 1024 * 1024;
+
+CBenchResults g_Results( "replay" );
+
+struct PassResults_t
+{
+	/**
+	*	Latency of each operation, in seconds, per phase.
+	*/
+	std::vector<double> latencies[ PHASE_COUNT ];
+
+	uint64_t uiBytesRead = 0;
+
+	/**
+	*	Opens that failed, whose reads and closes are skipped.
+	*/
+	size_t uiFailedOpens = 0;
+
+	/**
+	*	Reads that returned less than was recorded, which means the mounted files aren't the ones that were traced.
+	*/
+	size_t uiShortReads = 0;
+
+	double flSeconds = 0;
+};
+
+bool ReadTrace( const std::string& szFileName, CLoadTrace& trace )
+{
+	FILE* pFile = fopen( szFileName.c_str(), "rb" );
+
+	if( !pFile )
+		return false;
+
+	std::vector<uint8_t> data;
+
+	uint8_t buffer[ 64 * 1024 ];
+
+	for( size_t uiRead; ( uiRead = fread( buffer, 1, sizeof( buffer ), pFile ) ) > 0; )
+	{
+		data.insert( data.end(), buffer, buffer + uiRead );
+	}
+
+	fclose( pFile );
+
+	return trace.Deserialize( data.data(), data.size() );
+}
+
+bool IsPackFile( const std::string& szPath )
+{
+	std::error_code error;
+
+	return fs::is_regular_file( szPath, error );
+}
+
+void Mount( IFileSystem2& fileSystem, const Options_t& options )
+{
+	fileSystem.RemoveAllSearchPaths();
+
+	for( const auto& szPath : options.paths )
+	{
+		if( IsPackFile( szPath ) )
+			fileSystem.AddPackFile( szPath.c_str(), options.szPathID.c_str() );
+		else
+			fileSystem.AddSearchPath( szPath.c_str(), options.szPathID.c_str() );
+	}
+}
+
+/**
+*	Asks the operating system to drop a file from its page cache. Only pages that are no longer in use are dropped.
+*/
+void EvictFile( const fs::path& path )
+{
+#if !defined( WIN32 ) && defined( POSIX_FADV_DONTNEED )
+	const int fd = open( path.u8string().c_str(), O_RDONLY );
+
+	if( fd == -1 )
+		return;
+
+	posix_fadvise( fd, 0, 0, POSIX_FADV_DONTNEED );
+
+	close( fd );
+#endif
+}
+
+/**
+*	Drops every mounted file from the page cache.
+*/
+void EvictPageCache( const Options_t& options )
+{
+#if defined( WIN32 ) || !defined( POSIX_FADV_DONTNEED )
+	static bool bWarned = false;
+
+	if( !bWarned )
+	{
+		printf( "Can't drop files from the page cache on this platform, cold passes only start with cold filesystem caches\n" );
+		bWarned = true;
+	}
+#endif
+
+	std::error_code error;
+
+	for( const auto& szPath : options.paths )
+	{
+		if( IsPackFile( szPath ) )
+		{
+			EvictFile( szPath );
+			continue;
+		}
+
+		for( fs::recursive_directory_iterator it( szPath, error ), end; !error && it != end; it.increment( error ) )
+		{
+			if( fs::is_regular_file( it->status() ) )
+				EvictFile( it->path() );
+		}
+	}
+}
+
+/**
+*	Starts a pass with nothing cached.
+*/
+void MakeCold( IFileSystem2& fileSystem, const Options_t& options )
+{
+	//Setting the size discards all cached blocks.
+	fileSystem.SetBlockCacheSize( options.uiBlockCacheSize );
+
+	Mount( fileSystem, options );
+
+	EvictPageCache( options );
+}
+
+/**
+*	Replays the trace once.
+*/
+void Replay( IFileSystem2& fileSystem, const Options_t& options, const std::vector<CLoadTrace::Event_t>& events,
+			 const std::vector<std::string>& fileNames, PassResults_t& results )
+{
+	struct OpenFile_t
+	{
+		FileHandle_t hFile;
+		uint64_t uiPosition;
+	};
+
+	//Handles that are open for each file, most recent last. Events only say which file they belong to, so a file opened more than once uses its newest handle.
+	std::unordered_map<uint32_t, std::vector<OpenFile_t>> openFiles;
+
+	std::vector<uint8_t> buffer;
+
+	const auto startTime = std::chrono::steady_clock::now();
+
+	for( const auto& event : events )
+	{
+		if( options.bRecordedSpeed )
+			std::this_thread::sleep_until( startTime + std::chrono::microseconds( event.uiTime ) );
+
+		auto& handles = openFiles[ event.uiFile ];
+
+		switch( event.type )
+		{
+		case CLoadTrace::EventType::OPEN:
+			{
+				CBenchTimer timer;
+
+				auto hFile = fileSystem.Open( fileNames[ event.uiFile ].c_str(), "rb" );
+
+				results.latencies[ PHASE_OPEN ].push_back( timer.GetSeconds() );
+
+				if( hFile != FILESYSTEM_INVALID_HANDLE )
+					handles.push_back( { hFile, 0 } );
+				else
+					++results.uiFailedOpens;
+
+				break;
+			}
+
+		case CLoadTrace::EventType::READ:
+			{
+				if( handles.empty() )
+					break;
+
+				auto& file = handles.back();
+
+				if( event.uiOffset != file.uiPosition )
+				{
+					CBenchTimer timer;
+
+					fileSystem.Seek64( file.hFile, static_cast<int64_t>( event.uiOffset ), FILESYSTEM_SEEK_HEAD );
+
+					results.latencies[ PHASE_SEEK ].push_back( timer.GetSeconds() );
+
+					file.uiPosition = event.uiOffset;
+				}
+
+				const uint32_t uiLength = std::min( event.uiLength, MAX_READ_LENGTH );
+
+				if( buffer.size() < uiLength )
+					buffer.resize( uiLength );
+
+				CBenchTimer timer;
+
+				const int iRead = fileSystem.Read( buffer.data(), static_cast<int>( uiLength ), file.hFile );
+
+				results.latencies[ PHASE_READ ].push_back( timer.GetSeconds() );
+
+				if( iRead > 0 )
+				{
+					results.uiBytesRead += static_cast<uint64_t>( iRead );
+					file.uiPosition += static_cast<uint64_t>( iRead );
+				}
+
+				if( iRead < static_cast<int>( uiLength ) )
+					++results.uiShortReads;
+
+				break;
+			}
+
+		case CLoadTrace::EventType::CLOSE:
+			{
+				if( handles.empty() )
+					break;
+
+				CBenchTimer timer;
+
+				fileSystem.Close( handles.back().hFile );
+
+				results.latencies[ PHASE_CLOSE ].push_back( timer.GetSeconds() );
+
+				handles.pop_back();
+
+				break;
+			}
+		}
+	}
+
+	//Version 1 traces don't record closes, and files may still have been open when recording stopped.
+	for( auto& files : openFiles )
+	{
+		for( auto& file : files.second )
+		{
+			CBenchTimer timer;
+
+			fileSystem.Close( file.hFile );
+
+			results.latencies[ PHASE_CLOSE ].push_back( timer.GetSeconds() );
+		}
+	}
+
+	results.flSeconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - startTime ).count();
+}
+
+/**
+*	@param flFraction Between 0 and 1. The latencies must be sorted.
+*/
+double GetPercentile( const std::vector<double>& latencies, const double flFraction )
+{
+	if( latencies.empty() )
+		return 0;
+
+	const auto uiIndex = static_cast<size_t>( flFraction * ( latencies.size() - 1 ) + 0.5 );
+
+	return latencies[ std::min( uiIndex, latencies.size() - 1 ) ];
+}
+
+/**
+*	Reports the total time of each phase, and its median, 99th percentile and slowest operation as results with a single operation,
+*	so the percentiles show up as their ns_per_op.
+*/
+void ReportPass( const char* pszPass, PassResults_t& results )
+{
+	char szName[ 64 ];
+
+	snprintf( szName, sizeof( szName ), "%s pass", pszPass );
+
+	size_t uiOperations = 0;
+
+	for( const auto& latencies : results.latencies )
+	{
+		uiOperations += latencies.size();
+	}
+
+	g_Results.Report( szName, uiOperations, results.flSeconds, results.uiBytesRead );
+
+	for( int iPhase = 0; iPhase < PHASE_COUNT; ++iPhase )
+	{
+		auto& latencies = results.latencies[ iPhase ];
+
+		if( latencies.empty() )
+			continue;
+
+		std::sort( latencies.begin(), latencies.end() );
+
+		double flTotal = 0;
+
+		for( const auto flLatency : latencies )
+		{
+			flTotal += flLatency;
+		}
+
+		snprintf( szName, sizeof( szName ), "%s %s", pszPass, PHASE_NAMES[ iPhase ] );
+		g_Results.Report( szName, latencies.size(), flTotal );
+
+		snprintf( szName, sizeof( szName ), "%s %s p50", pszPass, PHASE_NAMES[ iPhase ] );
+		g_Results.Report( szName, 1, GetPercentile( latencies, 0.5 ) );
+
+		snprintf( szName, sizeof( szName ), "%s %s p99", pszPass, PHASE_NAMES[ iPhase ] );
+		g_Results.Report( szName, 1, GetPercentile( latencies, 0.99 ) );
+
+		snprintf( szName, sizeof( szName ), "%s %s max", pszPass, PHASE_NAMES[ iPhase ] );
+		g_Results.Report( szName, 1, latencies.back() );
+	}
+
+	if( results.uiFailedOpens > 0 || results.uiShortReads > 0 )
+	{
+		printf( "%s pass: %u files couldn't be opened, %u reads returned less than recorded\n", pszPass,
+				static_cast<unsigned int>( results.uiFailedOpens ), static_cast<unsigned int>( results.uiShortReads ) );
+	}
+}
+
+void PrintUsage()
+{
+	printf( "Usage: replay_filesystem -trace <trace file> -path <directory or pack file> [-path ...] [-pathid <path ID>] [-mode cold|warm|both] [-passes <warm pass count>]\n"
+			"\t[-speed recorded|max] [-mmap] [-threadsafe] [-blockcache <megabytes>] [-scale <warm pass multiplier>] [-json <results file>]\n" );
+}
+}
+
+int main( int argc, char* argv[] )
+{
+	Options_t options;
+
+	for( int iArg = 1; iArg < argc; ++iArg )
+	{
+		if( options.ParseArg( argc, argv, iArg ) )
+			continue;
+
+		const char* pszArg = argv[ iArg ];
+		const char* pszValue = iArg + 1 < argc ? argv[ iArg + 1 ] : nullptr;
+
+		if( !strcmp( pszArg, "-trace" ) && pszValue )
+		{
+			options.szTraceFile = pszValue;
+			++iArg;
+		}
+		else if( !strcmp( pszArg, "-path" ) && pszValue )
+		{
+			options.paths.emplace_back( pszValue );
+			++iArg;
+		}
+		else if( !strcmp( pszArg, "-pathid" ) && pszValue )
+		{
+			options.szPathID = pszValue;
+			++iArg;
+		}
+		else if( !strcmp( pszArg, "-mode" ) && pszValue && ( !strcmp( pszValue, "cold" ) || !strcmp( pszValue, "warm" ) || !strcmp( pszValue, "both" ) ) )
+		{
+			options.mode = !strcmp( pszValue, "cold" ) ? Mode::COLD : !strcmp( pszValue, "warm" ) ? Mode::WARM : Mode::BOTH;
+			++iArg;
+		}
+		else if( !strcmp( pszArg, "-passes" ) && pszValue )
+		{
+			options.uiWarmPasses = std::max<size_t>( 1, strtoul( pszValue, nullptr, 10 ) );
+			++iArg;
+		}
+		else if( !strcmp( pszArg, "-speed" ) && pszValue && ( !strcmp( pszValue, "recorded" ) || !strcmp( pszValue, "max" ) ) )
+		{
+			options.bRecordedSpeed = !strcmp( pszValue, "recorded" );
+			++iArg;
+		}
+		else if( !strcmp( pszArg, "-mmap" ) )
+		{
+			options.options |= FileSystemOption::MAP_PACK_FILES;
+		}
+		else if( !strcmp( pszArg, "-threadsafe" ) )
+		{
+			options.options |= FileSystemOption::THREAD_SAFE;
+		}
+		else if( !strcmp( pszArg, "-blockcache" ) && pszValue )
+		{
+			options.uiBlockCacheSize = strtoul( pszValue, nullptr, 10 ) * 1024 * 1024;
+			++iArg;
+		}
+		else
+		{
+			PrintUsage();
+			return EXIT_FAILURE;
+		}
+	}
+
+	if( options.szTraceFile.empty() || options.paths.empty() )
+	{
+		PrintUsage();
+		return EXIT_FAILURE;
+	}
+
+	CLoadTrace trace;
+
+	if( !ReadTrace( options.szTraceFile, trace ) )
+	{
+		printf( "Couldn't read trace \"%s\"\n", options.szTraceFile.c_str() );
+		return EXIT_FAILURE;
+	}
+
+	std::vector<CLoadTrace::Event_t> events;
+	std::vector<std::string> fileNames;
+
+	trace.GetEvents( events, fileNames );
+
+	printf( "Replaying %u events on %u files from \"%s\"\n", static_cast<unsigned int>( events.size() ),
+			static_cast<unsigned int>( fileNames.size() ), options.szTraceFile.c_str() );
+
+	auto pFileSystem = static_cast<IFileSystem2*>( CreateInterface( FILESYSTEM2_INTERFACE_VERSION, nullptr ) );
+
+	if( !pFileSystem )
+	{
+		printf( "Couldn't get the filesystem interface\n" );
+		return EXIT_FAILURE;
+	}
+
+	pFileSystem->SetOptions( options.options );
+
+	MakeCold( *pFileSystem, options );
+
+	if( options.mode != Mode::WARM )
+	{
+		PassResults_t results;
+
+		Replay( *pFileSystem, options, events, fileNames, results );
+
+		ReportPass( "cold", results );
+	}
+	else
+	{
+		//Only fills the caches.
+		PassResults_t results;
+
+		Replay( *pFileSystem, options, events, fileNames, results );
+	}
+
+	if( options.mode != Mode::COLD )
+	{
+		const size_t uiWarmPasses = options.Scale( options.uiWarmPasses );
+
+		for( size_t uiPass = 0; uiPass < uiWarmPasses; ++uiPass )
+		{
+			PassResults_t results;
+
+			Replay( *pFileSystem, options, events, fileNames, results );
+
+			char szName[ 32 ];
+
+			if( uiWarmPasses > 1 )
+				snprintf( szName, sizeof( szName ), "warm %u", static_cast<unsigned int>( uiPass + 1 ) );
+			else
+				snprintf( szName, sizeof( szName ), "warm" );
+
+			ReportPass( szName, results );
+		}
+	}
+
+	pFileSystem->RemoveAllSearchPaths();
+
+	if( !g_Results.WriteResultsFile( options ) )
+		return EXIT_FAILURE;
+
+	return EXIT_SUCCESS;
+}
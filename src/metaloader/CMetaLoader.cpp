@@ -16,6 +16,9 @@ CMetaLoader g_MetaLoader;
 
 EXPOSE_SINGLE_INTERFACE_GLOBALVAR( CMetaLoader, IMetaLoader, IMETALOADER_NAME, g_MetaLoader );
 
+const Uint32 CMetaLoader::MAX_HOST_WINDOW_ID;
+const unsigned int CMetaLoader::TOOL_RELOAD_CHECK_INTERVAL_MS;
+
 namespace
 {
 static const char* const STRIP_COMMANDS[] = 
@@ -23,6 +26,11 @@ static const char* const STRIP_COMMANDS[] =
 	"-game",	//Always strip -game so it can be reused.
 	nullptr
 };
+
+/**
+*	The startup trace is written to this file if -startuptrace isn't given a name.
+*/
+const char DEFAULT_STARTUP_TRACE_FILE[] = "startup_trace.json";
 }
 
 const char* CMetaLoader::GetGameDirectory( char* pszDest, size_t uiSizeInCharacters ) const
@@ -44,6 +52,52 @@ SDL_Window* CMetaLoader::GetEngineWindow() const
 	return m_pEngineWindow;
 }
 
+void CMetaLoader::SetEngineWindow( SDL_Window* pWindow )
+{
+	m_pEngineWindow = pWindow;
+}
+
+void CMetaLoader::BeginStartupPhase( const char* pszName )
+{
+	m_StartupProfiler.BeginPhase( pszName );
+}
+
+void CMetaLoader::EndStartupPhase()
+{
+	m_StartupProfiler.EndPhase();
+}
+
+void CMetaLoader::FinishStartup()
+{
+	m_StartupProfiler.Finish();
+	m_StartupProfiler.PrintReport();
+
+	//Written to the game directory, for comparing startup times between builds.
+	if( const char* pszTraceFile = GetCommandLine()->GetValue( "-startuptrace" ) )
+	{
+		if( !( *pszTraceFile ) || *pszTraceFile == '-' || *pszTraceFile == '+' )
+			pszTraceFile = DEFAULT_STARTUP_TRACE_FILE;
+
+		m_StartupProfiler.WriteTrace( *m_pFileSystem, pszTraceFile );
+	}
+}
+
+SDL_Window* CMetaLoader::FindHostWindow()
+{
+	//GoldSource's window has focus while it's starting up.
+	if( auto pWindow = SDL_GetKeyboardFocus() )
+		return pWindow;
+
+	//Window IDs are handed out in order starting at 1, and GoldSource only creates a few windows.
+	for( Uint32 uiID = 1; uiID <= MAX_HOST_WINDOW_ID; ++uiID )
+	{
+		if( auto pWindow = SDL_GetWindowFromID( uiID ) )
+			return pWindow;
+	}
+
+	return nullptr;
+}
+
 void CMetaLoader::SetGameDirectory( const char* pszGameDir )
 {
 	ASSERT( pszGameDir );
@@ -65,6 +119,8 @@ void CMetaLoader::Run( const bool bIsListenServer )
 
 bool CMetaLoader::RunLoader()
 {
+	m_StartupProfiler.Start();
+
 	//TODO: until we can draw the console onscreen, use a console window. - Solokiller
 #ifdef WIN32
 	AllocConsole();
@@ -77,12 +133,16 @@ bool CMetaLoader::RunLoader()
 		return false;
 	}
 
-	//Must be done before setting the working directory to prevent library load failure. - Solokiller
-	if( !Steam_InitWrappers() )
-		return false;
+	{
+		CScopedStartupPhase phase( *this, "SteamWrappers" );
 
-	//Shut down the older API so tools can safely use the newer one.
-	SteamAPI_Shutdown();
+		//Must be done before setting the working directory to prevent library load failure. - Solokiller
+		if( !Steam_InitWrappers() )
+			return false;
+
+		//Shut down the older API so tools can safely use the newer one.
+		SteamAPI_Shutdown();
+	}
 
 	//Set the working directory to the game directory that the engine is running in.
 	//Needed so asset loading works. Note that any mods that rely on ./valve to exist will break. - Solokiller
@@ -115,18 +175,26 @@ bool CMetaLoader::RunLoader()
 			return false;
 	}
 
-	if( GetCommandLine()->GetValue( "-dumpcmdline" ) )
+	if( GetCommandLine()->HasKey( "-dumpcmdline" ) )
 	{
 		Msg( "%s\n", GetCommandLine()->GetCommandLineString() );
 	}
 
-	if( !LoadFileSystem() )
-		return false;
+	{
+		CScopedStartupPhase phase( *this, "LoadFileSystem" );
+
+		if( !LoadFileSystem() )
+			return false;
+	}
 
-	if( !SetupFileSystem() )
 	{
-		Msg( "Failed to set up filesystem\n" );
-		return false;
+		CScopedStartupPhase phase( *this, "SetupFileSystem" );
+
+		if( !SetupFileSystem() )
+		{
+			Msg( "Failed to set up filesystem\n" );
+			return false;
+		}
 	}
 
 	if( m_bIsListenServer )
@@ -139,12 +207,10 @@ bool CMetaLoader::RunLoader()
 		}
 		*/
 
-		//Find the engine's window and make it invisible.
-		m_pEngineWindow = FindEngineWindow();
-
-		if( m_pEngineWindow )
+		//Find GoldSource's window and make it invisible.
+		if( auto pHostWindow = FindHostWindow() )
 		{
-			SDL_HideWindow( m_pEngineWindow );
+			SDL_HideWindow( pHostWindow );
 		}
 	}
 
@@ -161,30 +227,141 @@ bool CMetaLoader::RunLoader()
 		if( !pszToolName )
 			pszToolName = DEFAULT_IMETATOOL_NAME;
 
-		if( !m_ToolLib.Load( CLibArgs( pszToolLib ).DisablePrefixes( true ).Path( filepaths::TOOLS_DIR ) ) )
-		{
-			Msg( "Couldn't load tool \"%s\" library \"%s\"\n", pszToolName, pszToolLib );
+		m_szToolLib = pszToolLib;
+		m_szToolName = pszToolName;
+	}
+
+	m_bToolReloadEnabled = GetCommandLine()->HasKey( "-toolreload" );
+
+	if( !LoadTool() )
+		return false;
+
+	FinishStartup();
+
+	while( true )
+	{
+		if( !m_pTool->Run() )
 			return false;
-		}
 
-		auto factory = reinterpret_cast<CreateInterfaceFn>( m_ToolLib.GetFunctionAddress( CREATEINTERFACE_PROCNAME ) );
+		if( !m_bToolReloadPending )
+			return true;
 
-		if( !factory )
-		{
-			Msg( "Couldn't get tool \"%s\" library \"%s\" factory\n", pszToolName, pszToolLib );
+		if( !ReloadTool() )
 			return false;
-		}
+	}
+}
+
+void CMetaLoader::Shutdown()
+{
+	UnloadTool();
+
+	m_Interfaces.Clear();
+
+	if( m_pFileSystem )
+	{
+		m_pFileSystem->Unmount();
+		m_pFileSystem = nullptr;
+	}
+
+	m_FileSystemLib.Free();
+
+	Log_Shutdown();
+
+	if( m_bIsListenServer )
+	{
+		SDL_Quit();
+	}
+}
+
+bool CMetaLoader::ShouldReloadTool()
+{
+	if( !m_bToolReloadEnabled || m_ToolLibPath.empty() )
+		return false;
 
-		m_pTool = static_cast<IMetaTool*>( factory( pszToolName, nullptr ) );
+	if( m_bToolReloadPending )
+		return true;
 
-		if( !m_pTool )
+	const auto now = std::chrono::steady_clock::now();
+
+	if( now < m_NextToolReloadCheck )
+		return false;
+
+	m_NextToolReloadCheck = now + std::chrono::milliseconds( TOOL_RELOAD_CHECK_INTERVAL_MS );
+
+	std::error_code error;
+
+	//Fails while the library is being replaced.
+	const auto writeTime = std::experimental::filesystem::last_write_time( m_ToolLibPath, error );
+
+	if( error )
+		return false;
+
+	if( writeTime == m_ToolWriteTime )
+	{
+		m_bToolChanged = false;
+		return false;
+	}
+
+	//Wait until the library stops changing, so one that's still being written isn't loaded.
+	if( !m_bToolChanged || writeTime != m_ToolChangedWriteTime )
+	{
+		m_bToolChanged = true;
+		m_ToolChangedWriteTime = writeTime;
+		return false;
+	}
+
+	Msg( "Tool library \"%s\" was rebuilt, reloading\n", m_ToolLibPath.string().c_str() );
+
+	m_bToolReloadPending = true;
+
+	return true;
+}
+
+bool CMetaLoader::LoadTool()
+{
+	const char* const pszToolLib = m_szToolLib.c_str();
+	const char* const pszToolName = m_szToolName.c_str();
+
+	{
+		CScopedStartupPhase phase( *this, "LoadToolLibrary" );
+
+		bool bLoaded;
+
+		if( m_bToolReloadEnabled )
+		{
+			bLoaded = LoadToolCopy();
+		}
+		else
 		{
-			Msg( "Couldn't create tool \"%s\" from library \"%s\"\n", pszToolName, pszToolLib );
+			bLoaded = m_ToolLib.Load( CLibArgs( pszToolLib ).DisablePrefixes( true ).Path( filepaths::TOOLS_DIR ) );
+		}
+
+		if( !bLoaded )
+		{
+			Msg( "Couldn't load tool \"%s\" library \"%s\"\n", pszToolName, pszToolLib );
 			return false;
 		}
+	}
 
-		//We know this is available since we called it earlier. - Solokiller
-		auto filesystemFactory = reinterpret_cast<CreateInterfaceFn>( m_FileSystemLib.GetFunctionAddress( CREATEINTERFACE_PROCNAME ) );
+	if( !m_Interfaces.AddLibrary( m_ToolLib ) )
+	{
+		Msg( "Couldn't get tool \"%s\" library \"%s\" factory\n", pszToolName, pszToolLib );
+		return false;
+	}
+
+	m_pTool = static_cast<IMetaTool*>( m_Interfaces.Find( pszToolName, m_ToolLib.GetName().c_str() ) );
+
+	if( !m_pTool )
+	{
+		Msg( "Couldn't create tool \"%s\" from library \"%s\"\n", pszToolName, pszToolLib );
+		return false;
+	}
+
+	//We know this is available since we called it earlier. - Solokiller
+	auto filesystemFactory = m_Interfaces.GetFactory( m_FileSystemLib.GetName().c_str() );
+
+	{
+		CScopedStartupPhase phase( *this, "ToolStartup" );
 
 		if( !m_pTool->Startup( *this, &filesystemFactory, 1 ) )
 		{
@@ -193,10 +370,56 @@ bool CMetaLoader::RunLoader()
 		}
 	}
 
-	return m_pTool->Run();
+	return true;
 }
 
-void CMetaLoader::Shutdown()
+bool CMetaLoader::LoadToolCopy()
+{
+	namespace fs = std::experimental::filesystem;
+
+	const auto& platform = CPlatform::GetCurrentPlatform();
+
+	m_ToolLibPath.clear();
+
+	for( size_t uiIndex = 0; uiIndex < platform.GetNumLibExts(); ++uiIndex )
+	{
+		fs::path path = fs::path( filepaths::TOOLS_DIR ) / ( m_szToolLib + platform.GetLibExts()[ uiIndex ] );
+
+		if( fs::exists( path ) )
+		{
+			m_ToolLibPath = std::move( path );
+			break;
+		}
+	}
+
+	if( m_ToolLibPath.empty() )
+		return false;
+
+	std::error_code error;
+
+	m_ToolWriteTime = fs::last_write_time( m_ToolLibPath, error );
+
+	if( error )
+		return false;
+
+	m_bToolChanged = false;
+
+	//The library is loaded from a copy, so it can be rebuilt while it's in use. Each copy has its own name,
+	//so the new one is loaded even if the old one couldn't be unloaded.
+	m_ToolCopyPath = m_ToolLibPath;
+	m_ToolCopyPath.replace_filename( m_ToolLibPath.stem().string() + "_reload" + std::to_string( m_uiToolLoadCount++ ) + m_ToolLibPath.extension().string() );
+
+	if( !fs::copy_file( m_ToolLibPath, m_ToolCopyPath, fs::copy_options::overwrite_existing, error ) )
+	{
+		Msg( "Couldn't copy tool library to \"%s\": %s\n", m_ToolCopyPath.string().c_str(), error.message().c_str() );
+		m_ToolCopyPath.clear();
+		return false;
+	}
+
+	return m_ToolLib.Load( m_ToolCopyPath.string().c_str() );
+}
+
+void CMetaLoader::UnloadTool()
 {
 	if( m_pTool )
 	{
@@ -204,16 +427,39 @@ void CMetaLoader::Shutdown()
 		m_pTool = nullptr;
 	}
 
-	m_ToolLib.Free();
-
-	m_FileSystemLib.Free();
+	if( m_ToolLib.IsLoaded() )
+	{
+		m_Interfaces.RemoveFactory( m_ToolLib.GetName().c_str() );
+		m_ToolLib.Free();
+	}
 
-	if( m_bIsListenServer )
+	if( !m_ToolCopyPath.empty() )
 	{
-		SDL_Quit();
+		std::error_code error;
+
+		std::experimental::filesystem::remove( m_ToolCopyPath, error );
+
+		m_ToolCopyPath.clear();
 	}
 }
 
+bool CMetaLoader::ReloadTool()
+{
+	const auto start = std::chrono::steady_clock::now();
+
+	UnloadTool();
+
+	m_bToolReloadPending = false;
+
+	if( !LoadTool() )
+		return false;
+
+	Msg( "Reloaded tool \"%s\" in %.1f ms\n", m_szToolName.c_str(),
+		 std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now() - start ).count() );
+
+	return true;
+}
+
 bool CMetaLoader::LoadFileSystem()
 {
 	if( !m_FileSystemLib.Load( CLibArgs( "FileSystem" ).DisablePrefixes( true ).Path( filepaths::BIN_DIR ) ) )
@@ -222,15 +468,13 @@ bool CMetaLoader::LoadFileSystem()
 		return false;
 	}
 
-	auto filesystemFactory = reinterpret_cast<CreateInterfaceFn>( m_FileSystemLib.GetFunctionAddress( CREATEINTERFACE_PROCNAME ) );
-
-	if( !filesystemFactory )
+	if( !m_Interfaces.AddLibrary( m_FileSystemLib ) )
 	{
 		Msg( "Couldn't find filesystem factory\n" );
 		return false;
 	}
 
-	m_pFileSystem = static_cast<IFileSystem2*>( filesystemFactory( FILESYSTEM2_INTERFACE_VERSION, nullptr ) );
+	m_pFileSystem = static_cast<IFileSystem2*>( m_Interfaces.Find( FILESYSTEM2_INTERFACE_VERSION, m_FileSystemLib.GetName().c_str() ) );
 
 	if( !m_pFileSystem )
 	{
@@ -243,6 +487,83 @@ bool CMetaLoader::LoadFileSystem()
 
 bool CMetaLoader::SetupFileSystem()
 {
+	if( GetCommandLine()->HasKey( "-fs_mmap" ) )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::MAP_PACK_FILES );
+	}
+
+	//Server instances run commands that use the filesystem on their own threads.
+	if( GetCommandLine()->HasKey( "-fs_threadsafe" ) || GetCommandLine()->GetInt( "-instances", 0 ) > 0 )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::THREAD_SAFE );
+	}
+
+	if( GetCommandLine()->HasKey( "-fs_caseinsensitive" ) )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::CASE_INSENSITIVE );
+	}
+
+	if( GetCommandLine()->HasKey( "-fs_watch" ) )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::WATCH_LOOSE_PATHS );
+	}
+
+	if( GetCommandLine()->HasKey( "-fs_sharebuffers" ) )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::SHARE_READ_BUFFERS );
+	}
+
+	if( GetCommandLine()->HasKey( "-fs_writebehind" ) )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::WRITE_BEHIND );
+	}
+
+	if( GetCommandLine()->HasKey( "-fs_verifypacks" ) )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::VERIFY_PACK_FILES );
+	}
+
+	if( GetCommandLine()->HasKey( "-fs_cachefiles" ) )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::CACHE_LOOSE_FILES );
+	}
+
+	//Before the block cache is allocated.
+	if( GetCommandLine()->HasKey( "-largepages" ) )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::LARGE_PAGES );
+	}
+
+	if( const char* pszBlockCacheMiB = GetCommandLine()->GetValue( "-fs_blockcache" ) )
+	{
+		m_pFileSystem->SetBlockCacheSize( static_cast<size_t>( strtoul( pszBlockCacheMiB, nullptr, 10 ) ) * 1024 * 1024 );
+	}
+
+	if( const char* pszDirectStreamMiB = GetCommandLine()->GetValue( "-fs_directstream" ) )
+	{
+		m_pFileSystem->SetDirectStreamingThreshold( static_cast<uint64_t>( strtoul( pszDirectStreamMiB, nullptr, 10 ) ) * 1024 * 1024 );
+	}
+
+	if( GetCommandLine()->HasKey( "-fs_mountindex" ) )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::CACHE_MOUNT_INDEX );
+	}
+
+	if( GetCommandLine()->HasKey( "-fs_lockfree" ) )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::LOCK_FREE_LOOKUPS );
+	}
+
+	if( GetCommandLine()->HasKey( "-fs_arenas" ) )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::PACK_DIRECTORY_ARENAS );
+	}
+
+	if( GetCommandLine()->HasKey( "-memtracking" ) )
+	{
+		m_pFileSystem->SetOptions( m_pFileSystem->GetOptions() | FileSystemOption::TRACK_MEMORY );
+	}
+
 	m_pFileSystem->AddSearchPath( ".", "ROOT" );
 
 	//This will let us get files from the original game directory. - Solokiller
@@ -253,16 +574,3 @@ bool CMetaLoader::SetupFileSystem()
 
 	return true;
 }
-
-SDL_Window* CMetaLoader::FindEngineWindow()
-{
-	for( Uint32 uiID = 0; uiID < std::numeric_limits<Uint32>::max(); ++uiID )
-	{
-		SDL_Window* pWindow = SDL_GetWindowFromID( uiID );
-
-		if( pWindow )
-			return pWindow;
-	}
-
-	return nullptr;
-}
@@ -1,12 +1,16 @@
 #ifndef METALOADER_CMETALOADER_H
 #define METALOADER_CMETALOADER_H
 
+#include <chrono>
 #include <experimental/filesystem>
+#include <string>
 
 #include "Platform.h"
 
+#include "lib/CInterfaceCache.h"
 #include "lib/CLibrary.h"
 
+#include "CStartupProfiler.h"
 #include "IMetaLoader.h"
 
 class IFileSystem2;
@@ -15,6 +19,17 @@ class IMetaTool;
 
 class CMetaLoader : public IMetaLoader
 {
+public:
+	/**
+	*	Highest window ID that is checked when looking for GoldSource's window.
+	*/
+	static const Uint32 MAX_HOST_WINDOW_ID = 16;
+
+	/**
+	*	How often the tool library is checked for changes when tool reloading is enabled, in milliseconds.
+	*/
+	static const unsigned int TOOL_RELOAD_CHECK_INTERVAL_MS = 500;
+
 public:
 
 	CMetaLoader() = default;
@@ -23,8 +38,16 @@ public:
 
 	SDL_Window* GetEngineWindow() const override;
 
+	void SetEngineWindow( SDL_Window* pWindow ) override;
+
+	void BeginStartupPhase( const char* pszName ) override;
+
+	void EndStartupPhase() override;
+
 	bool IsListenServer() const override { return m_bIsListenServer; }
 
+	bool ShouldReloadTool() override;
+
 	/**
 	*	Gets the game directory directly. The above is safer since it avoids passing a pointer to an address in this library.
 	*/
@@ -43,7 +66,35 @@ private:
 
 	bool SetupFileSystem();
 
-	SDL_Window* FindEngineWindow();
+	/**
+	*	Loads the tool library, creates the tool and starts it up.
+	*/
+	bool LoadTool();
+
+	/**
+	*	Copies the tool library and loads the copy. Used when tool reloading is enabled.
+	*/
+	bool LoadToolCopy();
+
+	/**
+	*	Shuts down the tool and frees its library.
+	*/
+	void UnloadTool();
+
+	/**
+	*	Replaces the tool with the rebuilt one. The filesystem stays mounted.
+	*/
+	bool ReloadTool();
+
+	/**
+	*	@return GoldSource's window, or null if it couldn't be found.
+	*/
+	SDL_Window* FindHostWindow();
+
+	/**
+	*	Prints the startup report, and writes the startup trace if -startuptrace was given.
+	*/
+	void FinishStartup();
 
 private:
 	char m_szGameDir[ MAX_PATH ] = {};
@@ -58,9 +109,50 @@ private:
 
 	IFileSystem2* m_pFileSystem = nullptr;
 
+	std::string m_szToolLib;
+	std::string m_szToolName;
+
 	CLibrary m_ToolLib;
 
 	IMetaTool* m_pTool = nullptr;
+
+	/**
+	*	Whether -toolreload was given.
+	*/
+	bool m_bToolReloadEnabled = false;
+
+	/**
+	*	Whether the tool has been told to return so it can be reloaded.
+	*/
+	bool m_bToolReloadPending = false;
+
+	/**
+	*	Library the tool was loaded from, and the copy that is actually loaded. Only set when tool reloading is enabled.
+	*/
+	std::experimental::filesystem::path m_ToolLibPath;
+	std::experimental::filesystem::path m_ToolCopyPath;
+
+	/**
+	*	Number of times the tool has been loaded. Used to give each copy its own name.
+	*/
+	unsigned int m_uiToolLoadCount = 0;
+
+	std::experimental::filesystem::file_time_type m_ToolWriteTime;
+
+	/**
+	*	Whether the library has changed since it was loaded, and when it was last seen changing.
+	*/
+	bool m_bToolChanged = false;
+	std::experimental::filesystem::file_time_type m_ToolChangedWriteTime;
+
+	std::chrono::steady_clock::time_point m_NextToolReloadCheck;
+
+	/**
+	*	Factories of the filesystem and tool libraries.
+	*/
+	CInterfaceCache m_Interfaces;
+
+	CStartupProfiler m_StartupProfiler;
 };
 
 extern CMetaLoader g_MetaLoader;
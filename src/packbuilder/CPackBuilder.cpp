@@ -0,0 +1,371 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <experimental/filesystem>
+#include <unordered_map>
+
+#include "Platform.h"
+
+#include "Common.h"
+#include "Logging.h"
+
+#include "CLoadTrace.h"
+#include "CPathIndex.h"
+
+#include "TextureConverter.h"
+
+#include "CPackBuilder.h"
+
+namespace fs = std::experimental::filesystem;
+
+namespace
+{
+const char DEFAULT_LOAD_TRACE_DIR[] = "loadtraces";
+
+const char LOAD_TRACE_EXTENSION[] = ".fstrace";
+
+const char TGA_EXTENSION[] = ".tga";
+
+bool ReadWholeFile( const std::string& szFileName, std::vector<uint8_t>& data )
+{
+	FILE* pFile = fopen64( szFileName.c_str(), "rb" );
+
+	if( !pFile )
+		return false;
+
+	fseek64( pFile, 0, SEEK_END );
+
+	const auto iSize = ftell64( pFile );
+
+	fseek64( pFile, 0, SEEK_SET );
+
+	data.resize( static_cast<size_t>( std::max<int64_t>( iSize, 0 ) ) );
+
+	const bool bRead = data.empty() || fread( data.data(), data.size(), 1, pFile ) == 1;
+
+	fclose( pFile );
+
+	return bRead;
+}
+
+bool WriteWholeFile( const std::string& szFileName, const std::vector<uint8_t>& data )
+{
+	FILE* pFile = fopen64( szFileName.c_str(), "wb" );
+
+	if( !pFile )
+		return false;
+
+	const bool bWritten = data.empty() || fwrite( data.data(), data.size(), 1, pFile ) == 1;
+
+	return fclose( pFile ) == 0 && bWritten;
+}
+
+bool LoadTrace( const std::string& szFileName, CLoadTrace& trace )
+{
+	std::vector<uint8_t> data;
+
+	return ReadWholeFile( szFileName, data ) && trace.Deserialize( data.data(), data.size() );
+}
+}
+
+CPackBuilder g_PackBuilder;
+
+EXPOSE_SINGLE_INTERFACE_GLOBALVAR( CPackBuilder, IMetaTool, DEFAULT_IMETATOOL_NAME, g_PackBuilder );
+
+bool CPackBuilder::Startup( IMetaLoader& loader, CreateInterfaceFn* pFactories, const size_t uiNumFactories )
+{
+	return true;
+}
+
+bool CPackBuilder::Run()
+{
+	const char* pszDirectory = GetCommandLine()->GetValue( "-packdir" );
+	const char* pszOutput = GetCommandLine()->GetValue( "-packout" );
+
+	if( !pszDirectory || !( *pszDirectory ) || !pszOutput || !( *pszOutput ) )
+	{
+		Msg( "Usage: -packdir <directory> -packout <file> [-packformat PACK|PK64|PKZ1|PKH1] [-packtraces <paths>] [-packblocksize <bytes>] [-packtextures RGBA8|BC1|BC3]\n" );
+		return false;
+	}
+
+	auto type = pack::PackType::PACK_64BIT;
+
+	if( const char* pszFormat = GetCommandLine()->GetValue( "-packformat" ) )
+	{
+		if( stricmp( pszFormat, "PACK" ) == 0 )
+			type = pack::PackType::PACK_32BIT;
+		else if( stricmp( pszFormat, "PK64" ) == 0 )
+			type = pack::PackType::PACK_64BIT;
+		else if( stricmp( pszFormat, "PKZ1" ) == 0 )
+			type = pack::PackType::PACK_COMPRESSED;
+		else if( stricmp( pszFormat, "PKH1" ) == 0 )
+			type = pack::PackType::PACK_HASHED;
+		else
+		{
+			Msg( "Unknown pack format \"%s\"\n", pszFormat );
+			return false;
+		}
+	}
+
+	const uint32_t uiBlockSize = static_cast<uint32_t>( GetCommandLine()->GetInt( "-packblocksize", static_cast<int>( pack::CompressedPack::DEFAULT_BLOCK_SIZE ) ) );
+
+	if( const char* pszTextures = GetCommandLine()->GetValue( "-packtextures" ) )
+	{
+		texfile::Format format;
+
+		if( stricmp( pszTextures, "RGBA8" ) == 0 )
+			format = texfile::Format::RGBA8;
+		else if( stricmp( pszTextures, "BC1" ) == 0 )
+			format = texfile::Format::BC1;
+		else if( stricmp( pszTextures, "BC3" ) == 0 )
+			format = texfile::Format::BC3;
+		else
+		{
+			Msg( "Unknown texture format \"%s\"\n", pszTextures );
+			return false;
+		}
+
+		if( !ConvertTextures( pszDirectory, format ) )
+			return false;
+	}
+
+	if( !CollectFiles( pszDirectory, pszOutput ) )
+		return false;
+
+	std::vector<std::string> traces;
+
+	CollectLoadTraces( GetCommandLine()->GetValue( "-packtraces" ), traces );
+
+	const auto uiOrdered = OrderByLoadTraces( traces );
+
+	Msg( "Packing %u files from \"%s\", %u ordered by %u load traces\n", 
+		 static_cast<unsigned int>( m_Files.size() ), pszDirectory, static_cast<unsigned int>( uiOrdered ), static_cast<unsigned int>( traces.size() ) );
+
+	if( !pack::WritePackFile( pszOutput, type, m_Files, uiBlockSize ) )
+		return false;
+
+	Msg( "Wrote \"%s\"\n", pszOutput );
+
+	//Lets servers verify the pack file when it's mounted.
+	if( !pack::WriteChecksumFile( pszOutput ) )
+		return false;
+
+	Msg( "Wrote \"%s%s\"\n", pszOutput, pack::PackChecksums::EXTENSION );
+
+	return true;
+}
+
+void CPackBuilder::Shutdown()
+{
+	m_Files.clear();
+}
+
+bool CPackBuilder::ConvertTextures( const char* pszDirectory, const texfile::Format format ) const
+{
+	std::error_code error;
+
+	fs::recursive_directory_iterator it( pszDirectory, error );
+
+	if( error )
+	{
+		Msg( "Couldn't open directory \"%s\": %s\n", pszDirectory, error.message().c_str() );
+		return false;
+	}
+
+	size_t uiConverted = 0;
+	size_t uiUpToDate = 0;
+
+	std::vector<uint8_t> image;
+	std::vector<uint8_t> texture;
+
+	for( fs::recursive_directory_iterator end; it != end; it.increment( error ) )
+	{
+		if( error )
+		{
+			Msg( "Error while listing directory \"%s\": %s\n", pszDirectory, error.message().c_str() );
+			return false;
+		}
+
+		if( !fs::is_regular_file( it->status() ) || stricmp( it->path().extension().u8string().c_str(), TGA_EXTENSION ) != 0 )
+			continue;
+
+		auto texturePath = it->path();
+
+		texturePath.replace_extension( texfile::EXTENSION );
+
+		//Only convert images that changed since the last run.
+		if( fs::exists( texturePath, error ) && fs::last_write_time( texturePath, error ) >= fs::last_write_time( it->path(), error ) )
+		{
+			++uiUpToDate;
+			continue;
+		}
+
+		const auto szImage = it->path().u8string();
+
+		if( !ReadWholeFile( szImage, image ) )
+		{
+			Msg( "Couldn't read \"%s\"\n", szImage.c_str() );
+			return false;
+		}
+
+		//Images DecodeTGA can't handle are left to the engine to load as they are.
+		if( !ConvertTGAToTexture( image.data(), image.size(), format, texture ) )
+		{
+			Msg( "Can't convert \"%s\", skipping\n", szImage.c_str() );
+			continue;
+		}
+
+		if( !WriteWholeFile( texturePath.u8string(), texture ) )
+		{
+			Msg( "Couldn't write \"%s\"\n", texturePath.u8string().c_str() );
+			return false;
+		}
+
+		++uiConverted;
+	}
+
+	Msg( "Converted %u images, %u were up to date\n", static_cast<unsigned int>( uiConverted ), static_cast<unsigned int>( uiUpToDate ) );
+
+	return true;
+}
+
+bool CPackBuilder::CollectFiles( const char* pszDirectory, const char* pszOutput )
+{
+	m_Files.clear();
+
+	std::error_code error;
+
+	const auto outputPath = fs::absolute( pszOutput );
+
+	fs::recursive_directory_iterator it( pszDirectory, error );
+
+	if( error )
+	{
+		Msg( "Couldn't open directory \"%s\": %s\n", pszDirectory, error.message().c_str() );
+		return false;
+	}
+
+	const auto root = fs::path( pszDirectory );
+
+	for( fs::recursive_directory_iterator end; it != end; it.increment( error ) )
+	{
+		if( error )
+		{
+			Msg( "Error while listing directory \"%s\": %s\n", pszDirectory, error.message().c_str() );
+			return false;
+		}
+
+		if( !fs::is_regular_file( it->status() ) )
+			continue;
+
+		//Don't pack the output of a previous run.
+		if( fs::absolute( it->path() ) == outputPath )
+			continue;
+
+		const auto szPath = it->path().u8string();
+
+		//Normalizing also drops the separator between the directory and the relative path.
+		auto szFileName = CPathIndex::NormalizeKey( szPath.c_str() + root.u8string().length() );
+
+		m_Files.push_back( { std::move( szFileName ), szPath } );
+	}
+
+	std::sort( m_Files.begin(), m_Files.end(), []( const pack::PackInput_t& lhs, const pack::PackInput_t& rhs )
+	{
+		return lhs.szFileName < rhs.szFileName;
+	} );
+
+	return true;
+}
+
+void CPackBuilder::CollectLoadTraces( const char* pszTraces, std::vector<std::string>& traces ) const
+{
+	traces.clear();
+
+	std::string szTraces = pszTraces ? pszTraces : DEFAULT_LOAD_TRACE_DIR;
+
+	for( size_t uiStart = 0; uiStart < szTraces.length(); )
+	{
+		auto uiEnd = szTraces.find( ';', uiStart );
+
+		if( uiEnd == std::string::npos )
+			uiEnd = szTraces.length();
+
+		const fs::path path( szTraces.substr( uiStart, uiEnd - uiStart ) );
+
+		uiStart = uiEnd + 1;
+
+		if( path.empty() )
+			continue;
+
+		std::error_code error;
+
+		if( !fs::is_directory( path, error ) )
+		{
+			if( fs::exists( path, error ) )
+				traces.emplace_back( path.u8string() );
+			else if( pszTraces )
+				Msg( "Load trace \"%s\" does not exist\n", path.u8string().c_str() );
+
+			continue;
+		}
+
+		std::vector<std::string> directoryTraces;
+
+		for( fs::directory_iterator it( path, error ), end; !error && it != end; it.increment( error ) )
+		{
+			if( fs::is_regular_file( it->status() ) && it->path().extension() == LOAD_TRACE_EXTENSION )
+				directoryTraces.emplace_back( it->path().u8string() );
+		}
+
+		std::sort( directoryTraces.begin(), directoryTraces.end() );
+
+		traces.insert( traces.end(), directoryTraces.begin(), directoryTraces.end() );
+	}
+}
+
+size_t CPackBuilder::OrderByLoadTraces( const std::vector<std::string>& traces )
+{
+	//Position of each file in the new layout. Files are placed with the first trace that reads them.
+	std::unordered_map<std::string, size_t> order;
+
+	CLoadTrace trace;
+
+	std::vector<CLoadTrace::ScheduleEntry_t> schedule;
+
+	for( const auto& szTrace : traces )
+	{
+		if( !LoadTrace( szTrace, trace ) )
+		{
+			Msg( "Load trace \"%s\" is invalid, skipping\n", szTrace.c_str() );
+			continue;
+		}
+
+		trace.GetSchedule( schedule );
+
+		for( const auto& entry : schedule )
+		{
+			order.emplace( entry.szFileName, order.size() );
+		}
+	}
+
+	const auto uiUnordered = order.size();
+
+	auto getOrder = [ & ]( const pack::PackInput_t& file )
+	{
+		auto it = order.find( file.szFileName );
+
+		return it != order.end() ? it->second : uiUnordered;
+	};
+
+	//Stable so files that no trace reads stay sorted by name.
+	std::stable_sort( m_Files.begin(), m_Files.end(), [ & ]( const pack::PackInput_t& lhs, const pack::PackInput_t& rhs )
+	{
+		return getOrder( lhs ) < getOrder( rhs );
+	} );
+
+	return static_cast<size_t>( std::count_if( m_Files.begin(), m_Files.end(), [ & ]( const pack::PackInput_t& file )
+	{
+		return getOrder( file ) != uiUnordered;
+	} ) );
+}
@@ -0,0 +1,69 @@
+#ifndef PACKBUILDER_CPACKBUILDER_H
+#define PACKBUILDER_CPACKBUILDER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "IMetaTool.h"
+
+#include "PackWriter.h"
+#include "TextureFile.h"
+
+/**
+*	Tool that builds a pack file out of a directory.
+*	File data is laid out in the order that recorded level load traces first read the files in,
+*	so each level's files are contiguous and loading them becomes a sequential read.
+*	Files that no trace reads are placed after them, sorted by name.
+*
+*	Command line:
+*	-packdir <directory>		Directory to pack. Required.
+*	-packout <file>				Pack file to write. Required.
+*	-packformat <format>		PACK, PK64, PKZ1 or PKH1. Defaults to PK64. Use PKH1 for directories with more files than the others allow.
+*	-packtraces <paths>			Semicolon separated list of load traces, or directories containing them. Defaults to loadtraces.
+*	-packblocksize <bytes>		Block size for PKZ1 and PKH1 pack files.
+*	-packtextures <format>		Convert TGA images to precompiled textures in RGBA8, BC1 or BC3 first, and pack those too.
+*								Textures are written next to their images, and only rewritten if the image is newer.
+*/
+class CPackBuilder final : public IMetaTool
+{
+public:
+	CPackBuilder() = default;
+
+	bool Startup( IMetaLoader& loader, CreateInterfaceFn* pFactories, const size_t uiNumFactories ) override;
+
+	bool Run() override;
+
+	void Shutdown() override;
+
+private:
+	/**
+	*	Converts the TGA images in the given directory to texture files.
+	*/
+	bool ConvertTextures( const char* pszDirectory, const texfile::Format format ) const;
+
+	/**
+	*	Adds all files in the given directory.
+	*/
+	bool CollectFiles( const char* pszDirectory, const char* pszOutput );
+
+	/**
+	*	Gets the load traces to order files by.
+	*/
+	void CollectLoadTraces( const char* pszTraces, std::vector<std::string>& traces ) const;
+
+	/**
+	*	Orders the files by the time they're first read in the given load traces.
+	*	@return Number of files that were ordered by a trace.
+	*/
+	size_t OrderByLoadTraces( const std::vector<std::string>& traces );
+
+private:
+	std::vector<pack::PackInput_t> m_Files;
+
+private:
+	CPackBuilder( const CPackBuilder& ) = delete;
+	CPackBuilder& operator=( const CPackBuilder& ) = delete;
+};
+
+#endif //PACKBUILDER_CPACKBUILDER_H
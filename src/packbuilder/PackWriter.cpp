@@ -0,0 +1,531 @@
+#include <algorithm>
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <unordered_set>
+
+#include "Platform.h"
+
+#include "ByteSwap.h"
+#include "CRC32C.h"
+#include "Logging.h"
+#include "LZ4.h"
+
+#include "PackWriter.h"
+
+namespace pack
+{
+namespace
+{
+bool ReadInputFile( const PackInput_t& file, std::vector<uint8_t>& data )
+{
+	FILE* pFile = fopen64( file.szPath.c_str(), "rb" );
+
+	if( !pFile )
+	{
+		Warning( "WritePackFile: Couldn't open \"%s\"\n", file.szPath.c_str() );
+		return false;
+	}
+
+	fseek64( pFile, 0, SEEK_END );
+
+	const auto iSize = ftell64( pFile );
+
+	fseek64( pFile, 0, SEEK_SET );
+
+	bool bSuccess = iSize >= 0;
+
+	if( bSuccess )
+	{
+		data.resize( static_cast<size_t>( iSize ) );
+
+		bSuccess = data.empty() || fread( data.data(), data.size(), 1, pFile ) == 1;
+	}
+
+	fclose( pFile );
+
+	if( !bSuccess )
+		Warning( "WritePackFile: Couldn't read \"%s\"\n", file.szPath.c_str() );
+
+	return bSuccess;
+}
+
+template<typename ENTRY>
+bool SetEntryName( ENTRY& entry, const PackInput_t& file )
+{
+	//Names that fill the entire field are not null terminated.
+	if( file.szFileName.length() > sizeof( entry.szFileName ) )
+	{
+		Warning( "WritePackFile: File name \"%s\" is too long (Max %u characters)\n", 
+				 file.szFileName.c_str(), static_cast<unsigned int>( sizeof( entry.szFileName ) ) );
+		return false;
+	}
+
+	memset( entry.szFileName, 0, sizeof( entry.szFileName ) );
+	memcpy( entry.szFileName, file.szFileName.c_str(), file.szFileName.length() );
+
+	return true;
+}
+
+/**
+*	Compresses a file into blocks, preceded by the seek table.
+*	@return Whether the stored data is smaller than the file.
+*/
+bool CompressEntry( const std::vector<uint8_t>& data, const uint32_t uiBlockSize, std::vector<uint8_t>& stored )
+{
+	const auto uiBlockCount = static_cast<size_t>( CompressedPack::GetBlockCount( data.size(), uiBlockSize ) );
+
+	std::vector<uint64_t> offsets;
+
+	offsets.reserve( uiBlockCount + 1 );
+
+	stored.assign( ( uiBlockCount + 1 ) * sizeof( uint64_t ), 0 );
+
+	std::vector<uint8_t> block( lz4::GetMaxCompressedSize( uiBlockSize ) );
+
+	for( size_t uiBlock = 0; uiBlock < uiBlockCount; ++uiBlock )
+	{
+		offsets.push_back( LittleValue( static_cast<uint64_t>( stored.size() ) ) );
+
+		const auto pSource = data.data() + uiBlock * uiBlockSize;
+		const auto uiLength = std::min<size_t>( uiBlockSize, data.size() - uiBlock * uiBlockSize );
+
+		const auto uiCompressed = lz4::Compress( pSource, uiLength, block.data(), block.size() );
+
+		//Blocks that don't get smaller are stored as is.
+		if( uiCompressed == 0 || uiCompressed >= uiLength )
+			stored.insert( stored.end(), pSource, pSource + uiLength );
+		else
+			stored.insert( stored.end(), block.data(), block.data() + uiCompressed );
+	}
+
+	offsets.push_back( LittleValue( static_cast<uint64_t>( stored.size() ) ) );
+
+	memcpy( stored.data(), offsets.data(), offsets.size() * sizeof( uint64_t ) );
+
+	return stored.size() < data.size();
+}
+
+template<typename PackType>
+bool WritePack( FILE* pFile, const std::vector<PackInput_t>& files )
+{
+	typedef typename PackType::size_type size_type;
+
+	if( files.size() > PackType::MAX_FILES )
+	{
+		Warning( "WritePackFile(%s): Too many files (Max %u, got %u)\n", 
+				 PackType::Info_t::NAME, static_cast<unsigned int>( PackType::MAX_FILES ), static_cast<unsigned int>( files.size() ) );
+		return false;
+	}
+
+	const auto iMaxOffset = static_cast<int64_t>( std::numeric_limits<size_type>::max() );
+
+	typename PackType::Header_t header{};
+
+	if( fwrite( &header, sizeof( header ), 1, pFile ) != 1 )
+		return false;
+
+	std::vector<typename PackType::Entry_t> entries( files.size() );
+
+	std::vector<uint8_t> data;
+
+	for( size_t uiIndex = 0; uiIndex < files.size(); ++uiIndex )
+	{
+		const auto& file = files[ uiIndex ];
+		auto& entry = entries[ uiIndex ];
+
+		if( !SetEntryName( entry, file ) || !ReadInputFile( file, data ) )
+			return false;
+
+		const auto iOffset = ftell64( pFile );
+
+		if( iOffset < 0 || static_cast<int64_t>( data.size() ) > iMaxOffset - iOffset )
+		{
+			Warning( "WritePackFile(%s): Pack file is too large to add \"%s\"\n", PackType::Info_t::NAME, file.szFileName.c_str() );
+			return false;
+		}
+
+		if( !data.empty() && fwrite( data.data(), data.size(), 1, pFile ) != 1 )
+			return false;
+
+		entry.filepos = LittleValue( static_cast<size_type>( iOffset ) );
+		entry.filelen = LittleValue( static_cast<size_type>( data.size() ) );
+	}
+
+	const auto iDirOffset = ftell64( pFile );
+	const auto uiDirLength = entries.size() * sizeof( typename PackType::Entry_t );
+
+	if( iDirOffset < 0 || static_cast<int64_t>( uiDirLength ) > iMaxOffset - iDirOffset )
+	{
+		Warning( "WritePackFile(%s): Pack file is too large to add the directory\n", PackType::Info_t::NAME );
+		return false;
+	}
+
+	if( !entries.empty() && fwrite( entries.data(), uiDirLength, 1, pFile ) != 1 )
+		return false;
+
+	memcpy( header.identifier, PackType::Info_t::IDENTIFIER, sizeof( header.identifier ) );
+	header.dirofs = LittleValue( static_cast<size_type>( iDirOffset ) );
+	header.dirlen = LittleValue( static_cast<size_type>( uiDirLength ) );
+
+	fseek64( pFile, 0, SEEK_SET );
+
+	return fwrite( &header, sizeof( header ), 1, pFile ) == 1;
+}
+
+bool WriteCompressedPack( FILE* pFile, const std::vector<PackInput_t>& files, const uint32_t uiBlockSize )
+{
+	if( files.size() > CompressedPack::MAX_FILES )
+	{
+		Warning( "WritePackFile(%s): Too many files (Max %u, got %u)\n", 
+				 CompressedPack::NAME, static_cast<unsigned int>( CompressedPack::MAX_FILES ), static_cast<unsigned int>( files.size() ) );
+		return false;
+	}
+
+	if( uiBlockSize == 0 || uiBlockSize > CompressedPack::MAX_BLOCK_SIZE )
+	{
+		Warning( "WritePackFile(%s): Invalid block size %u (Max %u)\n", CompressedPack::NAME, uiBlockSize, CompressedPack::MAX_BLOCK_SIZE );
+		return false;
+	}
+
+	CompressedPack::Header_t header{};
+
+	if( fwrite( &header, sizeof( header ), 1, pFile ) != 1 )
+		return false;
+
+	std::vector<CompressedPack::Entry_t> entries( files.size() );
+
+	std::vector<uint8_t> data;
+	std::vector<uint8_t> stored;
+
+	for( size_t uiIndex = 0; uiIndex < files.size(); ++uiIndex )
+	{
+		const auto& file = files[ uiIndex ];
+		auto& entry = entries[ uiIndex ];
+
+		if( !SetEntryName( entry, file ) || !ReadInputFile( file, data ) )
+			return false;
+
+		const auto iOffset = ftell64( pFile );
+
+		if( iOffset < 0 )
+			return false;
+
+		//Files that don't get any smaller are stored uncompressed.
+		const bool bCompressed = !data.empty() && CompressEntry( data, uiBlockSize, stored );
+
+		const auto& output = bCompressed ? stored : data;
+
+		if( !output.empty() && fwrite( output.data(), output.size(), 1, pFile ) != 1 )
+			return false;
+
+		entry.filepos = LittleValue( static_cast<int64_t>( iOffset ) );
+		entry.filelen = LittleValue( static_cast<int64_t>( data.size() ) );
+		entry.storedlen = LittleValue( static_cast<int64_t>( output.size() ) );
+		entry.codec = LittleValue( static_cast<uint32_t>( bCompressed ? Codec::LZ4 : Codec::NONE ) );
+	}
+
+	const auto iDirOffset = ftell64( pFile );
+
+	if( iDirOffset < 0 )
+		return false;
+
+	if( !entries.empty() && fwrite( entries.data(), entries.size() * sizeof( CompressedPack::Entry_t ), 1, pFile ) != 1 )
+		return false;
+
+	memcpy( header.identifier, CompressedPack::IDENTIFIER, sizeof( header.identifier ) );
+	header.blocksize = LittleValue( uiBlockSize );
+	header.dirofs = LittleValue( static_cast<int64_t>( iDirOffset ) );
+	header.dirlen = LittleValue( static_cast<int64_t>( entries.size() * sizeof( CompressedPack::Entry_t ) ) );
+
+	fseek64( pFile, 0, SEEK_SET );
+
+	return fwrite( &header, sizeof( header ), 1, pFile ) == 1;
+}
+
+bool WriteHashedPack( FILE* pFile, const std::vector<PackInput_t>& files, const uint32_t uiBlockSize )
+{
+	if( files.size() > HashedPack::MAX_FILES )
+	{
+		Warning( "WritePackFile(%s): Too many files (Max %u, got %u)\n", 
+				 HashedPack::NAME, static_cast<unsigned int>( HashedPack::MAX_FILES ), static_cast<unsigned int>( files.size() ) );
+		return false;
+	}
+
+	if( uiBlockSize == 0 || uiBlockSize > CompressedPack::MAX_BLOCK_SIZE )
+	{
+		Warning( "WritePackFile(%s): Invalid block size %u (Max %u)\n", HashedPack::NAME, uiBlockSize, CompressedPack::MAX_BLOCK_SIZE );
+		return false;
+	}
+
+	//Names are stored with forward slashes, and the filesystem keeps the first of any duplicates, so leave them out.
+	std::vector<std::string> names;
+	std::vector<size_t> inputs;
+
+	{
+		std::unordered_set<std::string> seen;
+
+		for( size_t uiIndex = 0; uiIndex < files.size(); ++uiIndex )
+		{
+			auto szName = files[ uiIndex ].szFileName;
+
+			std::replace( szName.begin(), szName.end(), '\\', '/' );
+
+			if( !seen.insert( szName ).second )
+			{
+				Warning( "WritePackFile(%s): Skipping duplicate file \"%s\"\n", HashedPack::NAME, szName.c_str() );
+				continue;
+			}
+
+			names.emplace_back( std::move( szName ) );
+			inputs.push_back( uiIndex );
+		}
+	}
+
+	HashedPack::Header_t header{};
+
+	if( fwrite( &header, sizeof( header ), 1, pFile ) != 1 )
+		return false;
+
+	//Entries in input order; sorted by name when the directory is written.
+	std::vector<HashedPack::Entry_t> entries( names.size() );
+
+	std::vector<uint8_t> data;
+	std::vector<uint8_t> stored;
+
+	for( size_t uiIndex = 0; uiIndex < names.size(); ++uiIndex )
+	{
+		auto& entry = entries[ uiIndex ];
+
+		if( !ReadInputFile( files[ inputs[ uiIndex ] ], data ) )
+			return false;
+
+		const auto iOffset = ftell64( pFile );
+
+		if( iOffset < 0 )
+			return false;
+
+		//Files that don't get any smaller are stored uncompressed.
+		const bool bCompressed = !data.empty() && CompressEntry( data, uiBlockSize, stored );
+
+		const auto& output = bCompressed ? stored : data;
+
+		if( !output.empty() && fwrite( output.data(), output.size(), 1, pFile ) != 1 )
+			return false;
+
+		entry.filepos = LittleValue( static_cast<int64_t>( iOffset ) );
+		entry.filelen = LittleValue( static_cast<int64_t>( data.size() ) );
+		entry.storedlen = LittleValue( static_cast<int64_t>( output.size() ) );
+		entry.codec = LittleValue( static_cast<uint32_t>( bCompressed ? Codec::LZ4 : Codec::NONE ) );
+	}
+
+	std::vector<size_t> order( names.size() );
+
+	std::iota( order.begin(), order.end(), 0 );
+
+	std::sort( order.begin(), order.end(), 
+		[ & ]( const size_t lhs, const size_t rhs )
+		{
+			return names[ lhs ] < names[ rhs ];
+		}
+	);
+
+	//One bucket per entry on average keeps lookups to a comparison or two.
+	uint32_t uiBucketCount = 1;
+
+	while( uiBucketCount < names.size() )
+		uiBucketCount <<= 1;
+
+	std::vector<HashedPack::Entry_t> sortedEntries( names.size() );
+	std::vector<uint32_t> hashes( names.size() );
+	std::vector<char> nameBlob;
+
+	for( size_t uiIndex = 0; uiIndex < order.size(); ++uiIndex )
+	{
+		const auto& szName = names[ order[ uiIndex ] ];
+
+		if( nameBlob.size() + szName.length() + 1 > HashedPack::MAX_NAME_BYTES )
+		{
+			Warning( "WritePackFile(%s): File names are too long in total\n", HashedPack::NAME );
+			return false;
+		}
+
+		auto& entry = sortedEntries[ uiIndex ];
+
+		entry = entries[ order[ uiIndex ] ];
+
+		hashes[ uiIndex ] = HashedPack::HashName( szName.c_str() );
+
+		entry.nameofs = LittleValue( static_cast<uint32_t>( nameBlob.size() ) );
+		entry.namehash = LittleValue( hashes[ uiIndex ] );
+
+		nameBlob.insert( nameBlob.end(), szName.c_str(), szName.c_str() + szName.length() + 1 );
+	}
+
+	//Count the entries in each bucket, then turn the counts into offsets and fill in the slots.
+	std::vector<uint32_t> buckets( uiBucketCount + 1, 0 );
+	std::vector<uint32_t> slots( names.size() );
+
+	for( const auto uiHash : hashes )
+	{
+		++buckets[ ( uiHash & ( uiBucketCount - 1 ) ) + 1 ];
+	}
+
+	std::partial_sum( buckets.begin(), buckets.end(), buckets.begin() );
+
+	{
+		std::vector<uint32_t> next( buckets.begin(), buckets.end() - 1 );
+
+		for( size_t uiIndex = 0; uiIndex < hashes.size(); ++uiIndex )
+		{
+			slots[ next[ hashes[ uiIndex ] & ( uiBucketCount - 1 ) ]++ ] = LittleValue( static_cast<uint32_t>( uiIndex ) );
+		}
+	}
+
+	for( auto& uiOffset : buckets )
+	{
+		uiOffset = LittleValue( uiOffset );
+	}
+
+	const auto iDirOffset = ftell64( pFile );
+
+	if( iDirOffset < 0 )
+		return false;
+
+	const size_t uiDirLength = sortedEntries.size() * sizeof( HashedPack::Entry_t ) + buckets.size() * sizeof( uint32_t ) + 
+		slots.size() * sizeof( uint32_t ) + nameBlob.size();
+
+	if( ( !sortedEntries.empty() && fwrite( sortedEntries.data(), sortedEntries.size() * sizeof( HashedPack::Entry_t ), 1, pFile ) != 1 ) ||
+		fwrite( buckets.data(), buckets.size() * sizeof( uint32_t ), 1, pFile ) != 1 ||
+		( !slots.empty() && fwrite( slots.data(), slots.size() * sizeof( uint32_t ), 1, pFile ) != 1 ) ||
+		( !nameBlob.empty() && fwrite( nameBlob.data(), nameBlob.size(), 1, pFile ) != 1 ) )
+	{
+		return false;
+	}
+
+	memcpy( header.identifier, HashedPack::IDENTIFIER, sizeof( header.identifier ) );
+	header.blocksize = LittleValue( uiBlockSize );
+	header.bucketcount = LittleValue( uiBucketCount );
+	header.entrycount = LittleValue( static_cast<uint32_t>( sortedEntries.size() ) );
+	header.dirofs = LittleValue( static_cast<int64_t>( iDirOffset ) );
+	header.dirlen = LittleValue( static_cast<int64_t>( uiDirLength ) );
+
+	fseek64( pFile, 0, SEEK_SET );
+
+	return fwrite( &header, sizeof( header ), 1, pFile ) == 1;
+}
+}
+
+bool WritePackFile( const char* pszFileName, const PackType type, const std::vector<PackInput_t>& files, const uint32_t uiBlockSize )
+{
+	assert( pszFileName );
+
+	FILE* pFile = fopen64( pszFileName, "wb" );
+
+	if( !pFile )
+	{
+		Warning( "WritePackFile: Couldn't open \"%s\" for writing\n", pszFileName );
+		return false;
+	}
+
+	bool bSuccess = false;
+
+	switch( type )
+	{
+	case PackType::PACK_32BIT:		bSuccess = WritePack<Pack32_t>( pFile, files ); break;
+	case PackType::PACK_64BIT:		bSuccess = WritePack<Pack64_t>( pFile, files ); break;
+	case PackType::PACK_COMPRESSED:	bSuccess = WriteCompressedPack( pFile, files, uiBlockSize ); break;
+	case PackType::PACK_HASHED:		bSuccess = WriteHashedPack( pFile, files, uiBlockSize ); break;
+
+	default:
+		Warning( "WritePackFile: Unsupported pack type %d\n", static_cast<int>( type ) );
+		break;
+	}
+
+	if( fclose( pFile ) != 0 )
+		bSuccess = false;
+
+	if( !bSuccess )
+	{
+		Warning( "WritePackFile: Couldn't write \"%s\"\n", pszFileName );
+		remove( pszFileName );
+	}
+
+	return bSuccess;
+}
+
+bool WriteChecksumFile( const char* pszFileName, const uint32_t uiBlockSize )
+{
+	assert( pszFileName );
+
+	if( uiBlockSize == 0 || uiBlockSize > PackChecksums::MAX_BLOCK_SIZE )
+	{
+		Warning( "WriteChecksumFile: Invalid block size %u (Max %u)\n", uiBlockSize, PackChecksums::MAX_BLOCK_SIZE );
+		return false;
+	}
+
+	FILE* pPackFile = fopen64( pszFileName, "rb" );
+
+	if( !pPackFile )
+	{
+		Warning( "WriteChecksumFile: Couldn't open \"%s\"\n", pszFileName );
+		return false;
+	}
+
+	std::vector<uint32_t> checksums;
+
+	std::vector<uint8_t> block( uiBlockSize );
+
+	int64_t iFileSize = 0;
+
+	for( size_t uiRead; ( uiRead = fread( block.data(), 1, block.size(), pPackFile ) ) > 0; )
+	{
+		checksums.push_back( LittleValue( crc32c::Compute( block.data(), uiRead ) ) );
+
+		iFileSize += uiRead;
+	}
+
+	bool bSuccess = !ferror( pPackFile );
+
+	fclose( pPackFile );
+
+	if( !bSuccess )
+	{
+		Warning( "WriteChecksumFile: Couldn't read \"%s\"\n", pszFileName );
+		return false;
+	}
+
+	const std::string szChecksumFileName = std::string( pszFileName ) + PackChecksums::EXTENSION;
+
+	FILE* pFile = fopen64( szChecksumFileName.c_str(), "wb" );
+
+	if( !pFile )
+	{
+		Warning( "WriteChecksumFile: Couldn't open \"%s\" for writing\n", szChecksumFileName.c_str() );
+		return false;
+	}
+
+	PackChecksums::Header_t header{};
+
+	memcpy( header.identifier, PackChecksums::IDENTIFIER, sizeof( header.identifier ) );
+	header.version = LittleValue( PackChecksums::VERSION );
+	header.blocksize = LittleValue( uiBlockSize );
+	header.filesize = LittleValue( iFileSize );
+
+	bSuccess = fwrite( &header, sizeof( header ), 1, pFile ) == 1 &&
+		( checksums.empty() || fwrite( checksums.data(), checksums.size() * sizeof( uint32_t ), 1, pFile ) == 1 );
+
+	if( fclose( pFile ) != 0 )
+		bSuccess = false;
+
+	if( !bSuccess )
+	{
+		Warning( "WriteChecksumFile: Couldn't write \"%s\"\n", szChecksumFileName.c_str() );
+		remove( szChecksumFileName.c_str() );
+	}
+
+	return bSuccess;
+}
+}
@@ -0,0 +1,54 @@
+#ifndef PACKBUILDER_PACKWRITER_H
+#define PACKBUILDER_PACKWRITER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "PackFile.h"
+
+/**
+*	@file
+*	Functions to write pack files. Uses the structures in PackFile.h so they match what the filesystem reads.
+*/
+
+namespace pack
+{
+/**
+*	A file to add to a pack file.
+*/
+struct PackInput_t
+{
+	/**
+	*	Name of the file in the pack file.
+	*/
+	std::string szFileName;
+
+	/**
+	*	Path of the file on disk.
+	*/
+	std::string szPath;
+};
+
+/**
+*	Writes a pack file. File data is written in the order that the files are given in.
+*	@param pszFileName Name of the pack file to write.
+*	@param type Type of pack file to write.
+*	@param files Files to add.
+*	@param uiBlockSize If writing a compressed or hashed pack file, the size of the blocks that files are compressed in.
+*	@return Whether the pack file was written. If not, no file is left behind.
+*/
+bool WritePackFile( const char* pszFileName, const PackType type, const std::vector<PackInput_t>& files,
+					const uint32_t uiBlockSize = CompressedPack::DEFAULT_BLOCK_SIZE );
+
+/**
+*	Writes the checksum file of a pack file, which the filesystem uses to verify the pack file when it's mounted.
+*	@param pszFileName Name of the pack file. The checksum file is written next to it.
+*	@param uiBlockSize Size of the blocks that are checksummed separately.
+*	@return Whether the checksum file was written. If not, no file is left behind.
+*	@see PackChecksums
+*/
+bool WriteChecksumFile( const char* pszFileName, const uint32_t uiBlockSize = PackChecksums::DEFAULT_BLOCK_SIZE );
+}
+
+#endif //PACKBUILDER_PACKWRITER_H
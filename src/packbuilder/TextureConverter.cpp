@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#include "VGUI1/TGADecoder.h"
+
+#include "TextureConverter.h"
+
+namespace
+{
+uint16_t To565( const int r, const int g, const int b )
+{
+	return static_cast<uint16_t>( ( ( r * 31 + 127 ) / 255 ) << 11 | ( ( g * 63 + 127 ) / 255 ) << 5 | ( ( b * 31 + 127 ) / 255 ) );
+}
+
+void From565( const uint16_t uiColor, int* pRGB )
+{
+	const int r = ( uiColor >> 11 ) & 31;
+	const int g = ( uiColor >> 5 ) & 63;
+	const int b = uiColor & 31;
+
+	pRGB[ 0 ] = ( r << 3 ) | ( r >> 2 );
+	pRGB[ 1 ] = ( g << 2 ) | ( g >> 4 );
+	pRGB[ 2 ] = ( b << 3 ) | ( b >> 2 );
+}
+
+void WriteLE16( uint8_t* pOut, const uint16_t uiValue )
+{
+	pOut[ 0 ] = static_cast<uint8_t>( uiValue );
+	pOut[ 1 ] = static_cast<uint8_t>( uiValue >> 8 );
+}
+
+/**
+*	Halves an image with a box filter. Odd rows and columns are folded into their neighbor.
+*/
+void Downsample( const std::vector<uint8_t>& src, const uint32_t uiWidth, const uint32_t uiHeight, std::vector<uint8_t>& dest )
+{
+	const uint32_t uiDestWidth = std::max( uiWidth / 2, 1U );
+	const uint32_t uiDestHeight = std::max( uiHeight / 2, 1U );
+
+	dest.resize( static_cast<size_t>( uiDestWidth ) * uiDestHeight * 4 );
+
+	for( uint32_t y = 0; y < uiDestHeight; ++y )
+	{
+		const uint32_t y0 = std::min( y * 2, uiHeight - 1 );
+		const uint32_t y1 = std::min( y * 2 + 1, uiHeight - 1 );
+
+		for( uint32_t x = 0; x < uiDestWidth; ++x )
+		{
+			const uint32_t x0 = std::min( x * 2, uiWidth - 1 );
+			const uint32_t x1 = std::min( x * 2 + 1, uiWidth - 1 );
+
+			for( uint32_t uiChannel = 0; uiChannel < 4; ++uiChannel )
+			{
+				const unsigned int uiSum =
+					src[ ( y0 * uiWidth + x0 ) * 4 + uiChannel ] + src[ ( y0 * uiWidth + x1 ) * 4 + uiChannel ] +
+					src[ ( y1 * uiWidth + x0 ) * 4 + uiChannel ] + src[ ( y1 * uiWidth + x1 ) * 4 + uiChannel ];
+
+				dest[ ( y * uiDestWidth + x ) * 4 + uiChannel ] = static_cast<uint8_t>( ( uiSum + 2 ) / 4 );
+			}
+		}
+	}
+}
+
+/**
+*	Copies a 4x4 block out of an image. Blocks that stick out of the image repeat its last row and column.
+*/
+void GetBlock( const std::vector<uint8_t>& image, const uint32_t uiWidth, const uint32_t uiHeight, const uint32_t uiBlockX, const uint32_t uiBlockY, uint8_t* pBlock )
+{
+	for( uint32_t y = 0; y < 4; ++y )
+	{
+		const uint32_t uiY = std::min( uiBlockY * 4 + y, uiHeight - 1 );
+
+		for( uint32_t x = 0; x < 4; ++x )
+		{
+			const uint32_t uiX = std::min( uiBlockX * 4 + x, uiWidth - 1 );
+
+			memcpy( pBlock + ( y * 4 + x ) * 4, image.data() + ( static_cast<size_t>( uiY ) * uiWidth + uiX ) * 4, 4 );
+		}
+	}
+}
+
+/**
+*	Stores a level in the given format.
+*/
+void EncodeLevel( const std::vector<uint8_t>& image, const uint32_t uiWidth, const uint32_t uiHeight, const texfile::Format format, uint8_t* pOut )
+{
+	if( format == texfile::Format::RGBA8 )
+	{
+		memcpy( pOut, image.data(), image.size() );
+		return;
+	}
+
+	const size_t uiBlockSize = format == texfile::Format::BC1 ? 8 : 16;
+
+	uint8_t block[ 16 * 4 ];
+
+	for( uint32_t uiBlockY = 0; uiBlockY < ( uiHeight + 3 ) / 4; ++uiBlockY )
+	{
+		for( uint32_t uiBlockX = 0; uiBlockX < ( uiWidth + 3 ) / 4; ++uiBlockX, pOut += uiBlockSize )
+		{
+			GetBlock( image, uiWidth, uiHeight, uiBlockX, uiBlockY, block );
+
+			if( format == texfile::Format::BC1 )
+				EncodeBC1Block( block, pOut );
+			else
+				EncodeBC3Block( block, pOut );
+		}
+	}
+}
+}
+
+void EncodeBC1Block( const uint8_t* pBlock, uint8_t* pOut )
+{
+	//Endpoints are the corners of the colors' bounding box, inset a bit so the extremes aren't overrepresented.
+	int iMin[ 3 ] = { 255, 255, 255 };
+	int iMax[ 3 ] = { 0, 0, 0 };
+
+	for( int iPixel = 0; iPixel < 16; ++iPixel )
+	{
+		for( int iChannel = 0; iChannel < 3; ++iChannel )
+		{
+			iMin[ iChannel ] = std::min<int>( iMin[ iChannel ], pBlock[ iPixel * 4 + iChannel ] );
+			iMax[ iChannel ] = std::max<int>( iMax[ iChannel ], pBlock[ iPixel * 4 + iChannel ] );
+		}
+	}
+
+	for( int iChannel = 0; iChannel < 3; ++iChannel )
+	{
+		const int iInset = ( iMax[ iChannel ] - iMin[ iChannel ] ) / 16;
+
+		iMin[ iChannel ] += iInset;
+		iMax[ iChannel ] -= iInset;
+	}
+
+	uint16_t uiColor0 = To565( iMax[ 0 ], iMax[ 1 ], iMax[ 2 ] );
+	uint16_t uiColor1 = To565( iMin[ 0 ], iMin[ 1 ], iMin[ 2 ] );
+
+	//color0 > color1 selects the four color mode. Equal colors only have one color anyway.
+	if( uiColor0 < uiColor1 )
+		std::swap( uiColor0, uiColor1 );
+
+	int iPalette[ 4 ][ 3 ];
+
+	From565( uiColor0, iPalette[ 0 ] );
+	From565( uiColor1, iPalette[ 1 ] );
+
+	for( int iChannel = 0; iChannel < 3; ++iChannel )
+	{
+		iPalette[ 2 ][ iChannel ] = ( 2 * iPalette[ 0 ][ iChannel ] + iPalette[ 1 ][ iChannel ] ) / 3;
+		iPalette[ 3 ][ iChannel ] = ( iPalette[ 0 ][ iChannel ] + 2 * iPalette[ 1 ][ iChannel ] ) / 3;
+	}
+
+	uint32_t uiIndices = 0;
+
+	for( int iPixel = 0; iPixel < 16; ++iPixel )
+	{
+		int iBest = 0;
+		int iBestDistance = INT32_MAX;
+
+		for( int iIndex = 0; iIndex < 4; ++iIndex )
+		{
+			int iDistance = 0;
+
+			for( int iChannel = 0; iChannel < 3; ++iChannel )
+			{
+				const int iDelta = pBlock[ iPixel * 4 + iChannel ] - iPalette[ iIndex ][ iChannel ];
+
+				iDistance += iDelta * iDelta;
+			}
+
+			if( iDistance < iBestDistance )
+			{
+				iBest = iIndex;
+				iBestDistance = iDistance;
+			}
+		}
+
+		uiIndices |= static_cast<uint32_t>( iBest ) << ( iPixel * 2 );
+	}
+
+	WriteLE16( pOut, uiColor0 );
+	WriteLE16( pOut + 2, uiColor1 );
+	WriteLE16( pOut + 4, static_cast<uint16_t>( uiIndices ) );
+	WriteLE16( pOut + 6, static_cast<uint16_t>( uiIndices >> 16 ) );
+}
+
+void EncodeBC3Block( const uint8_t* pBlock, uint8_t* pOut )
+{
+	int iMin = 255;
+	int iMax = 0;
+
+	for( int iPixel = 0; iPixel < 16; ++iPixel )
+	{
+		iMin = std::min<int>( iMin, pBlock[ iPixel * 4 + 3 ] );
+		iMax = std::max<int>( iMax, pBlock[ iPixel * 4 + 3 ] );
+	}
+
+	//alpha0 > alpha1 selects 8 interpolated values. Equal values only have one value anyway.
+	int iPalette[ 8 ] = { iMax, iMin };
+
+	for( int iIndex = 1; iIndex < 7; ++iIndex )
+	{
+		iPalette[ iIndex + 1 ] = ( ( 7 - iIndex ) * iMax + iIndex * iMin ) / 7;
+	}
+
+	uint64_t uiIndices = 0;
+
+	for( int iPixel = 0; iPixel < 16; ++iPixel )
+	{
+		const int iAlpha = pBlock[ iPixel * 4 + 3 ];
+
+		int iBest = 0;
+
+		for( int iIndex = 1; iIndex < 8; ++iIndex )
+		{
+			if( std::abs( iAlpha - iPalette[ iIndex ] ) < std::abs( iAlpha - iPalette[ iBest ] ) )
+				iBest = iIndex;
+		}
+
+		uiIndices |= static_cast<uint64_t>( iBest ) << ( iPixel * 3 );
+	}
+
+	pOut[ 0 ] = static_cast<uint8_t>( iMax );
+	pOut[ 1 ] = static_cast<uint8_t>( iMin );
+
+	for( int iByte = 0; iByte < 6; ++iByte )
+	{
+		pOut[ 2 + iByte ] = static_cast<uint8_t>( uiIndices >> ( iByte * 8 ) );
+	}
+
+	EncodeBC1Block( pBlock, pOut + 8 );
+}
+
+bool ConvertTGAToTexture( const uint8_t* pData, const size_t uiSize, const texfile::Format format, std::vector<uint8_t>& file )
+{
+	TGAImage_t image;
+
+	if( !DecodeTGA( pData, uiSize, false, image ) )
+		return false;
+
+	const uint32_t uiWidth = static_cast<uint32_t>( image.iWidth );
+	const uint32_t uiHeight = static_cast<uint32_t>( image.iHeight );
+
+	uint32_t uiLevelCount = 1;
+
+	while( uiLevelCount < texfile::MAX_LEVELS && ( ( uiWidth >> uiLevelCount ) || ( uiHeight >> uiLevelCount ) ) )
+	{
+		++uiLevelCount;
+	}
+
+	texfile::Header_t header;
+
+	memcpy( header.identifier, texfile::IDENTIFIER, sizeof( header.identifier ) );
+	header.version = texfile::VERSION;
+	header.format = static_cast<uint32_t>( format );
+	header.width = uiWidth;
+	header.height = uiHeight;
+	header.levelcount = uiLevelCount;
+
+	texfile::Level_t levels[ texfile::MAX_LEVELS ];
+
+	size_t uiOffset = sizeof( header ) + uiLevelCount * sizeof( texfile::Level_t );
+
+	for( uint32_t uiLevel = 0; uiLevel < uiLevelCount; ++uiLevel )
+	{
+		auto& level = levels[ uiLevel ];
+
+		level.width = std::max( uiWidth >> uiLevel, 1U );
+		level.height = std::max( uiHeight >> uiLevel, 1U );
+		level.size = static_cast<uint32_t>( texfile::GetLevelSize( format, level.width, level.height ) );
+		level.offset = static_cast<uint32_t>( uiOffset );
+
+		uiOffset += level.size;
+	}
+
+	file.assign( uiOffset, 0 );
+
+	memcpy( file.data(), &header, sizeof( header ) );
+	memcpy( file.data() + sizeof( header ), levels, uiLevelCount * sizeof( texfile::Level_t ) );
+
+	std::vector<uint8_t> current = std::move( image.rgba );
+	std::vector<uint8_t> next;
+
+	for( uint32_t uiLevel = 0; uiLevel < uiLevelCount; ++uiLevel )
+	{
+		const auto& level = levels[ uiLevel ];
+
+		EncodeLevel( current, level.width, level.height, format, file.data() + level.offset );
+
+		if( uiLevel + 1 < uiLevelCount )
+		{
+			Downsample( current, level.width, level.height, next );
+			current.swap( next );
+		}
+	}
+
+	return true;
+}
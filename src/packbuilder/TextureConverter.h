@@ -0,0 +1,39 @@
+#ifndef PACKBUILDER_TEXTURECONVERTER_H
+#define PACKBUILDER_TEXTURECONVERTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "TextureFile.h"
+
+/**
+*	@file
+*	Converts TGA images to precompiled texture files.
+*/
+
+/**
+*	Converts a TGA image to a texture file with a full mip chain.
+*	Alpha is stored as it is in the image. BC1 drops it entirely.
+*	@param pData Contents of the TGA file.
+*	@param format Format to store the levels in.
+*	@param[ out ] file Contents of the texture file.
+*	@return Whether the image could be converted. Fails for images DecodeTGA doesn't support.
+*/
+bool ConvertTGAToTexture( const uint8_t* pData, const size_t uiSize, const texfile::Format format, std::vector<uint8_t>& file );
+
+/**
+*	Compresses a 4x4 block of RGBA pixels. Alpha is ignored.
+*	@param pBlock 16 pixels, row by row.
+*	@param[ out ] pOut 8 bytes.
+*/
+void EncodeBC1Block( const uint8_t* pBlock, uint8_t* pOut );
+
+/**
+*	Compresses a 4x4 block of RGBA pixels with interpolated alpha.
+*	@param pBlock 16 pixels, row by row.
+*	@param[ out ] pOut 16 bytes.
+*/
+void EncodeBC3Block( const uint8_t* pBlock, uint8_t* pOut );
+
+#endif //PACKBUILDER_TEXTURECONVERTER_H
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+#include "Logging.h"
+
+#include "CSteamCallStats.h"
+
+CSteamCallStats g_SteamCallStats;
+
+const size_t CSteamCallStats::NUM_BUCKETS;
+
+void CSteamCallStats::Record( const char* pszName, const CallType type, const Clock::duration duration, const bool bFailed )
+{
+	const uint64_t uiUS = static_cast<uint64_t>( std::max<int64_t>( 0, std::chrono::duration_cast<std::chrono::microseconds>( duration ).count() ) );
+
+	size_t uiBucket = 0;
+
+	for( uint64_t uiLimit = 10; uiBucket < NUM_BUCKETS - 1 && uiUS >= uiLimit; uiLimit *= 10 )
+	{
+		++uiBucket;
+	}
+
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	auto& entry = m_Entries[ pszName ];
+
+	entry.type = type;
+
+	++entry.uiCount;
+
+	if( bFailed )
+		++entry.uiFailures;
+
+	entry.uiTotalUS += uiUS;
+	entry.uiMaxUS = std::max( entry.uiMaxUS, uiUS );
+
+	++entry.uiBuckets[ uiBucket ];
+}
+
+void CSteamCallStats::PrintReport() const
+{
+	std::vector<std::pair<std::string, Entry_t>> entries;
+
+	{
+		std::lock_guard<std::mutex> lock( m_Mutex );
+
+		entries.assign( m_Entries.begin(), m_Entries.end() );
+	}
+
+	if( entries.empty() )
+	{
+		Msg( "No Steam calls recorded%s\n", IsEnabled() ? "" : ", recording is disabled" );
+		return;
+	}
+
+	std::sort( entries.begin(), entries.end(), []( const std::pair<std::string, Entry_t>& lhs, const std::pair<std::string, Entry_t>& rhs )
+	{
+		return lhs.second.uiTotalUS > rhs.second.uiTotalUS;
+	} );
+
+	Msg( "%-48s %8s %10s %10s  %s\n", "call", "count", "avg ms", "max ms", "<10us <100us <1ms <10ms <100ms <1s >=1s" );
+
+	for( const auto& entry : entries )
+	{
+		const auto& stats = entry.second;
+
+		char szName[ 64 ];
+
+		snprintf( szName, sizeof( szName ), "%s%s", entry.first.c_str(), stats.type == CallType::CALL_RESULT ? " (result)" : "" );
+
+		//Written as one message so lines from other threads don't end up in the middle.
+		char szLine[ 256 ];
+
+		int iLength = snprintf( szLine, sizeof( szLine ), "%-48s %8u %10.3f %10.3f ", szName, static_cast<unsigned int>( stats.uiCount ),
+								stats.uiCount > 0 ? stats.uiTotalUS / ( 1000.0 * stats.uiCount ) : 0.0, stats.uiMaxUS / 1000.0 );
+
+		for( auto uiBucket : stats.uiBuckets )
+		{
+			if( iLength >= 0 && static_cast<size_t>( iLength ) < sizeof( szLine ) )
+				iLength += snprintf( szLine + iLength, sizeof( szLine ) - iLength, " %u", static_cast<unsigned int>( uiBucket ) );
+		}
+
+		if( stats.uiFailures > 0 && iLength >= 0 && static_cast<size_t>( iLength ) < sizeof( szLine ) )
+			snprintf( szLine + iLength, sizeof( szLine ) - iLength, " (%u failed)", static_cast<unsigned int>( stats.uiFailures ) );
+
+		Msg( "%s\n", szLine );
+	}
+}
+
+void CSteamCallStats::Reset()
+{
+	std::lock_guard<std::mutex> lock( m_Mutex );
+
+	m_Entries.clear();
+}
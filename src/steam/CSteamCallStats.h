@@ -0,0 +1,192 @@
+#ifndef STEAM_CSTEAMCALLSTATS_H
+#define STEAM_CSTEAMCALLSTATS_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "steam_api.h"
+
+/**
+*	Records how often Steam API calls are made and how long they take, so frame spikes can be attributed to them.
+*	Calls through the Steam API wrappers are recorded automatically. Interface methods are recorded by calling them through Time,
+*	and async call results by using CTimedCallResult instead of CCallResult.
+*	Disabled by default, in which case recording costs a single check. Thread-safe.
+*/
+class CSteamCallStats final
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/**
+	*	Calls are sorted into buckets by decade of microseconds: under 10 us, under 100 us, and so on. The last bucket has everything else.
+	*/
+	static const size_t NUM_BUCKETS = 7;
+
+	/**
+	*	What kind of call a name was recorded for.
+	*/
+	enum class CallType
+	{
+		CALL = 0,
+
+		/**
+		*	Time from making an async call until its result arrived.
+		*/
+		CALL_RESULT
+	};
+
+	struct Entry_t
+	{
+		CallType type = CallType::CALL;
+
+		uint64_t uiCount = 0;
+
+		/**
+		*	Number of async call results that failed because of an I/O error.
+		*/
+		uint64_t uiFailures = 0;
+
+		uint64_t uiTotalUS = 0;
+		uint64_t uiMaxUS = 0;
+
+		uint64_t uiBuckets[ NUM_BUCKETS ] = {};
+	};
+
+public:
+	CSteamCallStats() = default;
+
+	bool IsEnabled() const { return m_bEnabled.load( std::memory_order_relaxed ); }
+
+	void SetEnabled( const bool bEnabled ) { m_bEnabled.store( bEnabled, std::memory_order_relaxed ); }
+
+	/**
+	*	Records a call.
+	*	@param pszName Name of the call, e.g. ISteamUser::BeginAuthSession.
+	*/
+	void Record( const char* pszName, const CallType type, const Clock::duration duration, const bool bFailed = false );
+
+	/**
+	*	Calls a function and records how long it took if recording is enabled.
+	*	@return What the function returned.
+	*/
+	template<typename FUNC>
+	auto Time( const char* pszName, FUNC func ) -> decltype( func() )
+	{
+		CScopedCall call( *this, pszName );
+
+		return func();
+	}
+
+	/**
+	*	Prints every call that has been recorded, slowest in total first.
+	*/
+	void PrintReport() const;
+
+	void Reset();
+
+private:
+	/**
+	*	Records a call for as long as it's in scope.
+	*/
+	class CScopedCall final
+	{
+	public:
+		CScopedCall( CSteamCallStats& stats, const char* pszName )
+			: m_Stats( stats )
+			, m_pszName( stats.IsEnabled() ? pszName : nullptr )
+		{
+			if( m_pszName )
+				m_Start = Clock::now();
+		}
+
+		~CScopedCall()
+		{
+			if( m_pszName )
+				m_Stats.Record( m_pszName, CallType::CALL, Clock::now() - m_Start );
+		}
+
+	private:
+		CSteamCallStats& m_Stats;
+		const char* const m_pszName;
+		Clock::time_point m_Start;
+
+	private:
+		CScopedCall( const CScopedCall& ) = delete;
+		CScopedCall& operator=( const CScopedCall& ) = delete;
+	};
+
+private:
+	std::atomic<bool> m_bEnabled{ false };
+
+	mutable std::mutex m_Mutex;
+
+	std::unordered_map<std::string, Entry_t> m_Entries;
+
+private:
+	CSteamCallStats( const CSteamCallStats& ) = delete;
+	CSteamCallStats& operator=( const CSteamCallStats& ) = delete;
+};
+
+extern CSteamCallStats g_SteamCallStats;
+
+/**
+*	Works like CCallResult, and records the time from Set until the result arrives under the given name.
+*/
+template<typename T, typename P>
+class CTimedCallResult final
+{
+public:
+	using func_t = void ( T::* )( P*, bool );
+
+public:
+	/**
+	*	@param pszName Name of the call, e.g. ISteamUserStats::RequestUserStats. Must stay valid.
+	*/
+	explicit CTimedCallResult( const char* pszName )
+		: m_pszName( pszName )
+	{
+	}
+
+	void Set( SteamAPICall_t hAPICall, T* pObj, func_t func )
+	{
+		m_pObj = pObj;
+		m_Func = func;
+		m_Start = CSteamCallStats::Clock::now();
+
+		m_Result.Set( hAPICall, this, &CTimedCallResult::OnResult );
+	}
+
+	bool IsActive() const { return m_Result.IsActive(); }
+
+	void Cancel() { m_Result.Cancel(); }
+
+private:
+	void OnResult( P* pParam, bool bIOFailure )
+	{
+		if( g_SteamCallStats.IsEnabled() )
+			g_SteamCallStats.Record( m_pszName, CSteamCallStats::CallType::CALL_RESULT, CSteamCallStats::Clock::now() - m_Start, bIOFailure );
+
+		( m_pObj->*m_Func )( pParam, bIOFailure );
+	}
+
+private:
+	const char* const m_pszName;
+
+	CCallResult<CTimedCallResult, P> m_Result;
+
+	T* m_pObj = nullptr;
+	func_t m_Func = nullptr;
+
+	CSteamCallStats::Clock::time_point m_Start;
+
+private:
+	CTimedCallResult( const CTimedCallResult& ) = delete;
+	CTimedCallResult& operator=( const CTimedCallResult& ) = delete;
+};
+
+#endif //STEAM_CSTEAMCALLSTATS_H
@@ -6,6 +6,7 @@
 #include "Logging.h"
 #include "lib/CLibrary.h"
 
+#include "CSteamCallStats.h"
 #include "SteamWrapper.h"
 
 #define _DEFINE_WRAPPER( funcName, returnType, callConv )		\
@@ -18,7 +19,7 @@ S_API returnType callConv funcName()							\
 {																\
 	assert( g_p##funcName );									\
 																\
-	return g_p##funcName();										\
+	return g_SteamCallStats.Time( #funcName, g_p##funcName );	\
 }
 
 #define DEFINE_WRAPPER( funcName, returnType )		\
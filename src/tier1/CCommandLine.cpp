@@ -1,13 +1,42 @@
 #include <cassert>
+#include <cctype>
+#include <cstdlib>
 #include <cstring>
 #include <sstream>
 
+#include "CStringPool.h"
 #include "Platform.h"
 
 #include "CCommandLine.h"
 
 const char CCommandLine::META_PREFIX[] = "-meta:";
 
+const size_t CCommandLine::MAX_KEY_LENGTH;
+
+namespace
+{
+/**
+*	Lowercases a key into a buffer.
+*	@return Whether the key fit.
+*/
+bool LowercaseKey( const char* pszKey, char* pszDest, const size_t uiDestSize )
+{
+	size_t uiIndex = 0;
+
+	for( ; pszKey[ uiIndex ]; ++uiIndex )
+	{
+		if( uiIndex + 1 >= uiDestSize )
+			return false;
+
+		pszDest[ uiIndex ] = static_cast<char>( tolower( static_cast<unsigned char>( pszKey[ uiIndex ] ) ) );
+	}
+
+	pszDest[ uiIndex ] = '\0';
+
+	return true;
+}
+}
+
 CCommandLine::~CCommandLine()
 {
 	Clear();
@@ -17,11 +46,13 @@ bool CCommandLine::Initialize( const size_t uiArgC, char** ppszArgV, const char*
 {
 	Clear();
 
+	auto& pool = GetStringPool();
+
 	m_Arguments.resize( uiArgC );
 
 	for( size_t uiArg = 0; uiArg < uiArgC; ++uiArg )
 	{
-		m_Arguments[ uiArg ] = ppszArgV[ uiArg ];
+		m_Arguments[ uiArg ] = pool.Intern( ppszArgV[ uiArg ] );
 	}
 
 	/*	Change all -meta:<command> lines into -<command>
@@ -31,14 +62,15 @@ bool CCommandLine::Initialize( const size_t uiArgC, char** ppszArgV, const char*
 	*	then rename the rest. - Solokiller
 	*/
 	{
-		std::vector<std::string> commandsToRemove;
+		//Interned as well, so arguments are compared by pointer.
+		std::vector<const char*> commandsToRemove;
 
 		//Build the list.
-		for( const auto& arg : m_Arguments )
+		for( auto pszArg : m_Arguments )
 		{
-			if( strncmp( arg.c_str(), META_PREFIX, META_PREFIX_LENGTH ) == 0 )
+			if( strncmp( pszArg, META_PREFIX, META_PREFIX_LENGTH ) == 0 )
 			{
-				commandsToRemove.emplace_back( arg.substr( META_PREFIX_LENGTH ) );
+				commandsToRemove.emplace_back( pool.Intern( pszArg + META_PREFIX_LENGTH ) );
 			}
 		}
 
@@ -47,23 +79,23 @@ bool CCommandLine::Initialize( const size_t uiArgC, char** ppszArgV, const char*
 		{
 			for( auto ppszStrip = ppszStripCommands; *ppszStrip; ++ppszStrip )
 			{
-				commandsToRemove.emplace_back( *ppszStrip );
+				commandsToRemove.emplace_back( pool.Intern( *ppszStrip ) );
 			}
 		}
 
 		//Remove the duplicates.
-		for( const auto& command : commandsToRemove )
+		for( auto pszCommand : commandsToRemove )
 		{
 			for( auto it = m_Arguments.begin(); it != m_Arguments.end(); )
 			{
-				if( *it == command )
+				if( *it == pszCommand )
 				{
 					it = m_Arguments.erase( it );
 
 					//Check if there was a value for the command. Values have neither - or + as their first character.
 					if( it != m_Arguments.end() )
 					{
-						const char prefix = it->at( 0 );
+						const char prefix = ( *it )[ 0 ];
 
 						//It's a value, remove it.
 						if( prefix != '-' && prefix != '+' )
@@ -80,11 +112,11 @@ bool CCommandLine::Initialize( const size_t uiArgC, char** ppszArgV, const char*
 		//Rename the rest.
 		for( auto it = m_Arguments.begin(); it != m_Arguments.end(); )
 		{
-			if( strncmp( it->c_str(), META_PREFIX, META_PREFIX_LENGTH ) == 0 )
+			if( strncmp( *it, META_PREFIX, META_PREFIX_LENGTH ) == 0 )
 			{
-				if( it->length() > META_PREFIX_LENGTH )
+				if( strlen( *it ) > META_PREFIX_LENGTH )
 				{
-					( *it ) = it->substr( META_PREFIX_LENGTH );
+					( *it ) = pool.Intern( *it + META_PREFIX_LENGTH );
 
 					++it;
 				}
@@ -103,11 +135,13 @@ bool CCommandLine::Initialize( const size_t uiArgC, char** ppszArgV, const char*
 
 	m_Arguments.shrink_to_fit();
 
+	BuildIndex();
+
 	std::stringstream stream;
 
 	for( size_t uiArg = 0; uiArg < m_Arguments.size(); ++uiArg )
 	{
-		const char* pszArg = m_Arguments[ uiArg ].c_str();
+		const char* pszArg = m_Arguments[ uiArg ];
 
 		//TODO: refactor into function. - Solokiller
 		const bool bHasWhitespace = []( const char* pszString ) -> bool
@@ -168,7 +202,7 @@ const char* CCommandLine::GetArgument( const size_t uiArgument ) const
 	if( uiArgument >= m_Arguments.size() )
 		return nullptr;
 
-	return m_Arguments[ uiArgument ].c_str();
+	return m_Arguments[ uiArgument ];
 }
 
 const char* CCommandLine::operator[]( const size_t uiArgument ) const
@@ -178,15 +212,33 @@ const char* CCommandLine::operator[]( const size_t uiArgument ) const
 
 size_t CCommandLine::IndexOf( const char* const pszKey ) const
 {
-	for( size_t uiArg = 0; uiArg < m_Arguments.size(); ++uiArg )
+	assert( pszKey );
+
+	char szKey[ MAX_KEY_LENGTH ];
+
+	if( !LowercaseKey( pszKey, szKey, sizeof( szKey ) ) )
 	{
-		if( stricmp( pszKey, m_Arguments[ uiArg ].c_str() ) == 0 )
+		//Not worth indexing, so just scan for it.
+		for( size_t uiArg = 0; uiArg < m_Arguments.size(); ++uiArg )
 		{
-			return uiArg;
+			if( stricmp( pszKey, m_Arguments[ uiArg ] ) == 0 )
+			{
+				return uiArg;
+			}
 		}
+
+		return INVALID_INDEX;
 	}
 
-	return INVALID_INDEX;
+	//Keys that were never interned can't be on the command line.
+	const char* pszInterned = GetStringPool().Find( szKey );
+
+	if( !pszInterned )
+		return INVALID_INDEX;
+
+	auto it = m_Index.find( pszInterned );
+
+	return it != m_Index.end() ? it->second : INVALID_INDEX;
 }
 
 const char* CCommandLine::GetValue( const char* const pszKey ) const
@@ -197,13 +249,103 @@ const char* CCommandLine::GetValue( const char* const pszKey ) const
 		return nullptr;
 
 	if( uiIndex + 1 < m_Arguments.size() )
-		return m_Arguments[ uiIndex + 1 ].c_str();
+		return m_Arguments[ uiIndex + 1 ];
 
 	return "";
 }
 
+bool CCommandLine::HasKey( const char* const pszKey ) const
+{
+	return IndexOf( pszKey ) != INVALID_INDEX;
+}
+
+int CCommandLine::GetInt( const char* const pszKey, const int iDefault ) const
+{
+	const char* pszValue = FindValue( pszKey );
+
+	if( !pszValue )
+		return iDefault;
+
+	char* pszEnd;
+
+	const long iValue = strtol( pszValue, &pszEnd, 10 );
+
+	return ( pszEnd != pszValue && !( *pszEnd ) ) ? static_cast<int>( iValue ) : iDefault;
+}
+
+float CCommandLine::GetFloat( const char* const pszKey, const float flDefault ) const
+{
+	const char* pszValue = FindValue( pszKey );
+
+	if( !pszValue )
+		return flDefault;
+
+	char* pszEnd;
+
+	const float flValue = strtof( pszValue, &pszEnd );
+
+	return ( pszEnd != pszValue && !( *pszEnd ) ) ? flValue : flDefault;
+}
+
+bool CCommandLine::GetBool( const char* const pszKey, const bool bDefault ) const
+{
+	if( !HasKey( pszKey ) )
+		return bDefault;
+
+	const char* pszValue = FindValue( pszKey );
+
+	if( !pszValue )
+		return true;
+
+	return stricmp( pszValue, "0" ) != 0 &&
+		stricmp( pszValue, "false" ) != 0 &&
+		stricmp( pszValue, "no" ) != 0 &&
+		stricmp( pszValue, "off" ) != 0;
+}
+
 void CCommandLine::Clear()
 {
 	m_szCommandLine.clear();
 	m_Arguments.clear();
+	m_Index.clear();
+}
+
+void CCommandLine::BuildIndex()
+{
+	auto& pool = GetStringPool();
+
+	m_Index.clear();
+	m_Index.reserve( m_Arguments.size() );
+
+	char szKey[ MAX_KEY_LENGTH ];
+
+	for( size_t uiArg = 0; uiArg < m_Arguments.size(); ++uiArg )
+	{
+		//Longer arguments are found by scanning instead.
+		if( !LowercaseKey( m_Arguments[ uiArg ], szKey, sizeof( szKey ) ) )
+			continue;
+
+		//Keeps the first occurrence.
+		m_Index.emplace( pool.Intern( szKey ), uiArg );
+	}
+}
+
+const char* CCommandLine::FindValue( const char* const pszKey ) const
+{
+	const size_t uiIndex = IndexOf( pszKey );
+
+	if( uiIndex == INVALID_INDEX || uiIndex + 1 >= m_Arguments.size() )
+		return nullptr;
+
+	const char* pszValue = m_Arguments[ uiIndex + 1 ];
+
+	//Values have neither - or + as their first character.
+	if( pszValue[ 0 ] == '-' || pszValue[ 0 ] == '+' )
+	{
+		//Negative numbers are values.
+		if( !isdigit( static_cast<unsigned char>( pszValue[ 1 ] ) ) && pszValue[ 1 ] != '.' )
+			return nullptr;
+	}
+
+	return pszValue;
 }
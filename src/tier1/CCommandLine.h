@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "ICommandLine.h"
@@ -10,12 +11,20 @@
 class CCommandLine final : public ICommandLine
 {
 private:
-	typedef std::vector<std::string> Arguments_t;
+	/**
+	*	Arguments are interned in the string pool.
+	*/
+	typedef std::vector<const char*> Arguments_t;
 
 	static const char META_PREFIX[];
 
 	static const size_t META_PREFIX_LENGTH = 6;
 
+	/**
+	*	Longest key that is looked up through the index. Longer keys can't be on the command line as a single argument anyway.
+	*/
+	static const size_t MAX_KEY_LENGTH = 256;
+
 public:
 	CCommandLine() = default;
 	~CCommandLine();
@@ -34,13 +43,36 @@ public:
 
 	const char* GetValue( const char* const pszKey ) const override;
 
+	bool HasKey( const char* const pszKey ) const override;
+
+	int GetInt( const char* const pszKey, const int iDefault = 0 ) const override;
+
+	float GetFloat( const char* const pszKey, const float flDefault = 0 ) const override;
+
+	bool GetBool( const char* const pszKey, const bool bDefault = false ) const override;
+
 private:
 	void Clear();
 
+	/**
+	*	Indexes the arguments by their lowercase form.
+	*/
+	void BuildIndex();
+
+	/**
+	*	@return The value that follows a key, or null if the key isn't there or isn't followed by a value.
+	*/
+	const char* FindValue( const char* const pszKey ) const;
+
 private:
 	std::string m_szCommandLine;
 
 	Arguments_t m_Arguments;
+
+	/**
+	*	Maps each distinct argument, lowercased and interned, to the index of its first occurrence.
+	*/
+	std::unordered_map<const char*, size_t> m_Index;
 };
 
 
@@ -48,7 +48,8 @@ public:
 	virtual const char* operator[]( const size_t uiArgument ) const = 0;
 
 	/**
-	*	Gets the index of a key.
+	*	Gets the index of a key. Keys are compared case insensitively, and the first occurrence is used.
+	*	Arguments are indexed when the command line is initialized, so this doesn't scan the arguments.
 	*	@param pszKey Key to search for.
 	*	@return If the key was found, returns the index. Otherwise, returns INVALID_INDEX.
 	*/
@@ -60,6 +61,29 @@ public:
 	*	@return If the key was found, returns the value. Otherwise, returns null. If the key is the last argument, returns an empty string.
 	*/
 	virtual const char* GetValue( const char* const pszKey ) const = 0;
+
+	/**
+	*	@return Whether the key is on the command line.
+	*/
+	virtual bool HasKey( const char* const pszKey ) const = 0;
+
+	/**
+	*	Gets the value for a key as an integer.
+	*	@return The value, or iDefault if the key wasn't found or its value isn't an integer.
+	*/
+	virtual int GetInt( const char* const pszKey, const int iDefault = 0 ) const = 0;
+
+	/**
+	*	Gets the value for a key as a float.
+	*	@return The value, or flDefault if the key wasn't found or its value isn't a number.
+	*/
+	virtual float GetFloat( const char* const pszKey, const float flDefault = 0 ) const = 0;
+
+	/**
+	*	Gets the value for a key as a boolean. A key without a value is true, as are values other than 0, false, no and off.
+	*	@return The value, or bDefault if the key wasn't found.
+	*/
+	virtual bool GetBool( const char* const pszKey, const bool bDefault = false ) const = 0;
 };
 
 inline ICommandLine::~ICommandLine()